@@ -0,0 +1,203 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+'''
+Write a window of blocks of the chain of a running node, with the headers
+before them and the coins they spend, to a fixture file for the ChainFixture
+benchmarks of bench_bitcoin:
+
+    contrib/devtools/gen-bench-fixture.py --datadir=$HOME/.certurium --start=150000 --count=100 fixture.dat
+    BENCH_CHAIN_FIXTURE=fixture.dat src/bench/bench_bitcoin -suite=chain
+
+The node must not be pruned below the window, as the coins come from the undo
+data that getblock returns at verbosity 3.
+
+The file holds, as serialized by the node:
+
+    4 bytes    magic "BFIX"
+    uint32     version, 1
+    string     network of the chain, as getblockchaininfo names it
+    int32      height of the first header
+    headers    vector<CBlockHeader> of the headers before the window
+    blocks     compact size of the number of blocks, then each CBlock
+               followed by the CBlockUndo of the coins it spends
+'''
+
+import argparse
+import base64
+from decimal import Decimal
+from http.client import HTTPConnection
+import json
+import os
+import struct
+import sys
+
+FIXTURE_MAGIC = b'BFIX'
+FIXTURE_VERSION = 1
+# Headers the median time past of a block looks back at, itself included
+MEDIAN_TIME_SPAN = 11
+# Flags of nSequence of BIP 68
+SEQUENCE_LOCKTIME_DISABLE_FLAG = 1 << 31
+SEQUENCE_LOCKTIME_TYPE_FLAG = 1 << 22
+# Number of special scripts of ScriptCompression, which uncompressed scripts skip
+SPECIAL_SCRIPTS = 6
+RPC_BATCH_SIZE = 1000
+DEFAULT_RPC_PORT = 13581
+
+
+class RPC:
+    def __init__(self, host, port, username, password):
+        authpair = f'{username}:{password}'.encode('utf-8')
+        self.authhdr = b'Basic ' + base64.b64encode(authpair)
+        self.conn = HTTPConnection(host, port=port, timeout=300)
+
+    def batch(self, calls):
+        '''Run a list of (method, params) calls, returning their results.'''
+        results = []
+        for i in range(0, len(calls), RPC_BATCH_SIZE):
+            request = [{'version': '1.1', 'method': method, 'params': params, 'id': i + n}
+                       for n, (method, params) in enumerate(calls[i:i + RPC_BATCH_SIZE])]
+            self.conn.request('POST', '/', json.dumps(request),
+                              {'Authorization': self.authhdr, 'Content-type': 'application/json'})
+            resp = self.conn.getresponse()
+            body = resp.read().decode('utf-8')
+            if resp.status != 200 and not body:
+                sys.exit(f'JSON-RPC: HTTP error {resp.status}')
+            for reply in sorted(json.loads(body, parse_float=Decimal), key=lambda r: r['id']):
+                if reply.get('error') is not None:
+                    sys.exit(f'JSON-RPC: {reply["error"]}')
+                results.append(reply['result'])
+        return results
+
+    def call(self, method, *params):
+        return self.batch([(method, list(params))])[0]
+
+
+def ser_compact_size(n):
+    if n < 253:
+        return struct.pack('<B', n)
+    if n <= 0xffff:
+        return struct.pack('<BH', 253, n)
+    if n <= 0xffffffff:
+        return struct.pack('<BI', 254, n)
+    return struct.pack('<BQ', 255, n)
+
+
+def ser_varint(n):
+    '''VARINT of serialize.h, the base-128 encoding with the offset of each continuation.'''
+    out = bytearray()
+    while True:
+        out.insert(0, (n & 0x7f) | (0x80 if out else 0))
+        if n <= 0x7f:
+            return bytes(out)
+        n = (n >> 7) - 1
+
+
+def compress_amount(n):
+    '''CompressAmount of compressor.cpp.'''
+    if n == 0:
+        return 0
+    e = 0
+    while n % 10 == 0 and e < 9:
+        n //= 10
+        e += 1
+    if e < 9:
+        d = n % 10
+        n //= 10
+        return 1 + (n * 9 + d - 1) * 10 + e
+    return 1 + (n - 1) * 10 + 9
+
+
+def ser_coin(prevout):
+    '''A Coin as TxInUndoFormatter writes it, the script left uncompressed.'''
+    height = prevout['height']
+    out = ser_varint(height * 2 + int(prevout['generated']))
+    if height > 0:
+        out += b'\x00'
+    out += ser_varint(compress_amount(int(prevout['value'] * 100_000_000)))
+    script = bytes.fromhex(prevout['scriptPubKey']['hex'])
+    return out + ser_varint(len(script) + SPECIAL_SCRIPTS) + script
+
+
+def ser_block_undo(block):
+    '''The CBlockUndo of a block of getblock at verbosity 3.'''
+    out = ser_compact_size(len(block['tx']) - 1)
+    for tx in block['tx'][1:]:
+        out += ser_compact_size(len(tx['vin']))
+        for txin in tx['vin']:
+            if 'prevout' not in txin:
+                sys.exit(f'No undo data for block {block["hash"]}, is the node pruned?')
+            out += ser_coin(txin['prevout'])
+    return out
+
+
+def lowest_time_locked_height(block):
+    '''The lowest height of the coins a block spends with a time-based relative lock-time, if any.'''
+    heights = [txin['prevout']['height'] for tx in block['tx'][1:] if tx['version'] >= 2 for txin in tx['vin']
+               if not txin['sequence'] & SEQUENCE_LOCKTIME_DISABLE_FLAG and txin['sequence'] & SEQUENCE_LOCKTIME_TYPE_FLAG]
+    return min(heights, default=None)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--datadir', help='data directory of the node, whose .cookie is used if no rpcuser is given; '
+                        'for other networks than main the directory of the network')
+    parser.add_argument('--rpcuser')
+    parser.add_argument('--rpcpassword')
+    parser.add_argument('--host', default='127.0.0.1')
+    parser.add_argument('--port', type=int, default=DEFAULT_RPC_PORT)
+    parser.add_argument('--start', type=int, required=True, help='height of the first block of the window, at least 1')
+    parser.add_argument('--count', type=int, default=100, help='number of blocks of the window (default: %(default)s)')
+    parser.add_argument('output', help='fixture file to write')
+    args = parser.parse_args()
+
+    if args.start < 1 or args.count < 1:
+        parser.error('--start and --count must be at least 1')
+    if os.path.exists(args.output):
+        parser.error(f'{args.output} already exists')
+    if args.rpcuser is None:
+        if args.datadir is None:
+            parser.error('either --datadir or --rpcuser is required')
+        with open(os.path.join(os.path.expanduser(args.datadir), '.cookie'), 'r', encoding='utf8') as f:
+            args.rpcuser, args.rpcpassword = f.read().strip().split(':', 1)
+    rpc = RPC(args.host, args.port, args.rpcuser, args.rpcpassword)
+
+    info = rpc.call('getblockchaininfo')
+    end = args.start + args.count
+    if end - 1 > info['blocks']:
+        sys.exit(f'The window ends at height {end - 1}, above the tip at {info["blocks"]}')
+
+    hashes = rpc.batch([('getblockhash', [height]) for height in range(args.start, end)])
+    blocks = rpc.batch([('getblock', [h, 0]) for h in hashes])
+    undos = []
+    first_height = args.start - 1
+    for h in hashes:
+        block = rpc.call('getblock', h, 3)
+        undos.append(ser_block_undo(block))
+        locked_height = lowest_time_locked_height(block)
+        if locked_height is not None:
+            first_height = min(first_height, locked_height - 1)
+        print(f'Read block {block["height"]}', end='\r', file=sys.stderr)
+    first_height = max(0, first_height - (MEDIAN_TIME_SPAN - 1))
+
+    header_hashes = rpc.batch([('getblockhash', [height]) for height in range(first_height, args.start)])
+    headers = rpc.batch([('getblockheader', [h, False]) for h in header_hashes])
+
+    with open(args.output, 'wb') as f:
+        f.write(FIXTURE_MAGIC)
+        f.write(struct.pack('<I', FIXTURE_VERSION))
+        f.write(ser_compact_size(len(info['chain'])) + info['chain'].encode('utf-8'))
+        f.write(struct.pack('<i', first_height))
+        f.write(ser_compact_size(len(headers)))
+        for header in headers:
+            f.write(bytes.fromhex(header))
+        f.write(ser_compact_size(len(blocks)))
+        for block, undo in zip(blocks, undos):
+            f.write(bytes.fromhex(block))
+            f.write(undo)
+    print(f'Wrote blocks {args.start} to {end - 1} and {len(headers)} headers from height {first_height} of {info["chain"]} to {args.output}', file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+import sys
+import ctypes
+from bcc import BPF, USDT
+
+"""Example logging the synchronized checkpoints processed by Certurium
+    utilizing the checkpointsync:process_checkpoint tracepoint."""
+
+# USAGE:  ./contrib/tracing/log_sync_checkpoints.py path/to/certuriumd
+
+# BCC: The C program to be compiled to an eBPF program (by BCC) and loaded into
+# a sandboxed Linux kernel VM.
+program = """
+# include <uapi/linux/ptrace.h>
+
+typedef signed long long i64;
+
+struct data_t
+{
+  u8 hash[32];
+  int outcome;
+  i64 duration;
+};
+
+// BPF perf buffer to push the data to user space.
+BPF_PERF_OUTPUT(checkpoints);
+
+int trace_process_checkpoint(struct pt_regs *ctx) {
+  struct data_t data = {};
+  bpf_usdt_readarg_p(1, ctx, &data.hash, 32);
+  bpf_usdt_readarg(2, ctx, &data.outcome);
+  bpf_usdt_readarg(3, ctx, &data.duration);
+  checkpoints.perf_submit(ctx, &data, sizeof(data));
+  return 0;
+}
+"""
+
+OUTCOMES = [
+    'ACCEPTED',
+    'BAD_SIGNATURE',
+    'MISSING_HEADERS',
+    'INVALID',
+    'PENDING',
+    'WRITE_FAILED'
+]
+
+
+class Data(ctypes.Structure):
+    # define output data structure corresponding to struct data_t
+    _fields_ = [
+        ("hash", ctypes.c_ubyte * 32),
+        ("outcome", ctypes.c_int),
+        ("duration", ctypes.c_int64)
+    ]
+
+
+def print_event(event):
+    print("%-64s %-16s %-15d" % (
+        bytes(event.hash[::-1]).hex(),
+        OUTCOMES[event.outcome],
+        event.duration
+    ))
+
+
+def main(certuriumd_path):
+    certuriumd_with_usdts = USDT(path=str(certuriumd_path))
+
+    # attaching the trace functions defined in the BPF program
+    # to the tracepoints
+    certuriumd_with_usdts.enable_probe(
+        probe="checkpointsync:process_checkpoint", fn_name="trace_process_checkpoint")
+    b = BPF(text=program, usdt_contexts=[certuriumd_with_usdts])
+
+    def handle_checkpoint(_, data, size):
+        """ Checkpoint handler.
+          Called each time a synchronized checkpoint is processed."""
+        event = ctypes.cast(data, ctypes.POINTER(Data)).contents
+        print_event(event)
+
+    b["checkpoints"].open_perf_buffer(handle_checkpoint)
+    print("Logging synchronized checkpoints. Ctrl-C to end...")
+    print("%-64s %-16s %-15s" % ("Checkpoint", "Outcome", "Duration (µs)"))
+
+    while True:
+        try:
+            b.perf_buffer_poll()
+        except KeyboardInterrupt:
+            exit(0)
+
+
+if __name__ == "__main__":
+    if len(sys.argv) < 2:
+        print("USAGE: ", sys.argv[0], "path/to/certuriumd")
+        exit(1)
+
+    path = sys.argv[1]
+    main(path)
@@ -9,6 +9,7 @@
 #include <hash.h>
 #include <logging.h>
 #include <logging/timer.h>
+#include <memusage.h>
 #include <netaddress.h>
 #include <protocol.h>
 #include <random.h>
@@ -284,6 +285,11 @@ void AddrManImpl::Unserialize(Stream& s_)
                     ADDRMAN_TRIED_BUCKET_COUNT * ADDRMAN_BUCKET_SIZE));
     }
 
+    // Size the tables once instead of rehashing them while loading
+    mapInfo.reserve(nNew + nTried);
+    mapAddr.reserve(nNew + nTried);
+    vRandom.reserve(nNew + nTried);
+
     // Deserialize entries from the new table.
     for (int n = 0; n < nNew; n++) {
         AddrInfo& info = mapInfo[n];
@@ -392,6 +398,8 @@ void AddrManImpl::Unserialize(Stream& s_)
     if (nLost + nLostUnk > 0) {
         LogPrint(BCLog::ADDRMAN, "addrman lost %i new and %i tried addresses due to collisions or invalid addresses\n", nLostUnk, nLost);
     }
+    m_size = vRandom.size();
+    ++m_generation;
 
     const int check_code{CheckAddrman()};
     if (check_code != 0) {
@@ -425,6 +433,7 @@ AddrInfo* AddrManImpl::Create(const CAddress& addr, const CNetAddr& addrSource,
     mapAddr[addr] = nId;
     mapInfo[nId].nRandomPos = vRandom.size();
     vRandom.push_back(nId);
+    m_size = vRandom.size();
     if (pnId)
         *pnId = nId;
     return &mapInfo[nId];
@@ -465,6 +474,7 @@ void AddrManImpl::Delete(int nId)
 
     SwapRandom(info.nRandomPos, vRandom.size() - 1);
     vRandom.pop_back();
+    m_size = vRandom.size();
     mapAddr.erase(info);
     mapInfo.erase(nId);
     nNew--;
@@ -1070,8 +1080,20 @@ int AddrManImpl::CheckAddrman() const
 
 size_t AddrManImpl::size() const
 {
-    LOCK(cs); // TODO: Cache this in an atomic to avoid this overhead
-    return vRandom.size();
+    return m_size;
+}
+
+uint64_t AddrManImpl::Generation() const
+{
+    return m_generation;
+}
+
+size_t AddrManImpl::DynamicMemoryUsage() const
+{
+    LOCK(cs);
+    // The buckets of the new and tried tables are arrays of this object
+    return memusage::MallocUsage(sizeof(*this)) + memusage::DynamicUsage(mapInfo) + memusage::DynamicUsage(mapAddr) +
+           memusage::DynamicUsage(vRandom) + memusage::DynamicUsage(m_tried_collisions);
 }
 
 bool AddrManImpl::Add(const std::vector<CAddress>& vAddr, const CNetAddr& source, std::chrono::seconds time_penalty)
@@ -1079,6 +1101,7 @@ bool AddrManImpl::Add(const std::vector<CAddress>& vAddr, const CNetAddr& source
     LOCK(cs);
     Check();
     auto ret = Add_(vAddr, source, time_penalty);
+    ++m_generation;
     Check();
     return ret;
 }
@@ -1088,6 +1111,7 @@ bool AddrManImpl::Good(const CService& addr, NodeSeconds time)
     LOCK(cs);
     Check();
     auto ret = Good_(addr, /*test_before_evict=*/true, time);
+    ++m_generation;
     Check();
     return ret;
 }
@@ -1097,6 +1121,7 @@ void AddrManImpl::Attempt(const CService& addr, bool fCountFailure, NodeSeconds
     LOCK(cs);
     Check();
     Attempt_(addr, fCountFailure, time);
+    ++m_generation;
     Check();
 }
 
@@ -1105,6 +1130,7 @@ void AddrManImpl::ResolveCollisions()
     LOCK(cs);
     Check();
     ResolveCollisions_();
+    ++m_generation;
     Check();
 }
 
@@ -1128,10 +1154,33 @@ std::pair<CAddress, NodeSeconds> AddrManImpl::Select(bool newOnly) const
 
 std::vector<CAddress> AddrManImpl::GetAddr(size_t max_addresses, size_t max_pct, std::optional<Network> network) const
 {
-    LOCK(cs);
-    Check();
-    const auto addresses = GetAddr_(max_addresses, max_pct, network);
-    Check();
+    const auto now{Now<NodeSeconds>()};
+    {
+        LOCK(m_addr_response_mutex);
+        const auto it{m_addr_response_cache.find(network)};
+        if (it != m_addr_response_cache.end()) {
+            const CachedAddrResponse& cached{it->second};
+            if (cached.m_generation == m_generation && cached.m_max_addresses == max_addresses &&
+                cached.m_max_pct == max_pct && now >= cached.m_created &&
+                now < cached.m_created + ADDRMAN_GETADDR_CACHE_LIFETIME) {
+                return cached.m_addresses;
+            }
+        }
+    }
+
+    uint64_t generation;
+    std::vector<CAddress> addresses;
+    {
+        LOCK(cs);
+        Check();
+        // Read under cs, so that a mutation racing with this call invalidates the response
+        generation = m_generation;
+        addresses = GetAddr_(max_addresses, max_pct, network);
+        Check();
+    }
+
+    LOCK(m_addr_response_mutex);
+    m_addr_response_cache[network] = CachedAddrResponse{generation, max_addresses, max_pct, now, addresses};
     return addresses;
 }
 
@@ -1140,6 +1189,7 @@ void AddrManImpl::Connected(const CService& addr, NodeSeconds time)
     LOCK(cs);
     Check();
     Connected_(addr, time);
+    ++m_generation;
     Check();
 }
 
@@ -1148,6 +1198,7 @@ void AddrManImpl::SetServices(const CService& addr, ServiceFlags nServices)
     LOCK(cs);
     Check();
     SetServices_(addr, nServices);
+    ++m_generation;
     Check();
 }
 
@@ -1191,6 +1242,16 @@ size_t AddrMan::size() const
     return m_impl->size();
 }
 
+uint64_t AddrMan::Generation() const
+{
+    return m_impl->Generation();
+}
+
+size_t AddrMan::DynamicMemoryUsage() const
+{
+    return m_impl->DynamicMemoryUsage();
+}
+
 bool AddrMan::Add(const std::vector<CAddress>& vAddr, const CNetAddr& source, std::chrono::seconds time_penalty)
 {
     return m_impl->Add(vAddr, source, time_penalty);
@@ -102,6 +102,12 @@ public:
     //! Return the number of (unique) addresses in all tables.
     size_t size() const;
 
+    //! Return a counter that changes whenever an entry may have been added, removed or updated.
+    uint64_t Generation() const;
+
+    //! Return the memory used by the tables of addresses, in bytes.
+    size_t DynamicMemoryUsage() const;
+
     /**
      * Attempt to add one or more addresses to addrman's new table.
      *
@@ -148,6 +154,8 @@ public:
 
     /**
      * Return all or many randomly selected addresses, optionally by network.
+     * While addrman is unchanged, the same selection is returned again for up to
+     * ADDRMAN_GETADDR_CACHE_LIFETIME without waiting for its lock.
      *
      * @param[in] max_addresses  Maximum number of addresses to return (0 = all).
      * @param[in] max_pct        Maximum percentage of addresses to return (0 = all).
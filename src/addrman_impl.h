@@ -15,7 +15,9 @@
 #include <uint256.h>
 #include <util/time.h>
 
+#include <atomic>
 #include <cstdint>
+#include <map>
 #include <optional>
 #include <set>
 #include <unordered_map>
@@ -32,6 +34,8 @@ static constexpr int ADDRMAN_NEW_BUCKET_COUNT{1 << ADDRMAN_NEW_BUCKET_COUNT_LOG2
 /** Maximum allowed number of entries in buckets for new and tried addresses */
 static constexpr int32_t ADDRMAN_BUCKET_SIZE_LOG2{6};
 static constexpr int ADDRMAN_BUCKET_SIZE{1 << ADDRMAN_BUCKET_SIZE_LOG2};
+/** How long a GetAddr response may be served again while addrman is unchanged */
+static constexpr auto ADDRMAN_GETADDR_CACHE_LIFETIME{1min};
 
 /**
  * Extended statistics about a CAddress
@@ -112,7 +116,11 @@ public:
     template <typename Stream>
     void Unserialize(Stream& s_) EXCLUSIVE_LOCKS_REQUIRED(!cs);
 
-    size_t size() const EXCLUSIVE_LOCKS_REQUIRED(!cs);
+    size_t size() const;
+
+    uint64_t Generation() const;
+
+    size_t DynamicMemoryUsage() const EXCLUSIVE_LOCKS_REQUIRED(!cs);
 
     bool Add(const std::vector<CAddress>& vAddr, const CNetAddr& source, std::chrono::seconds time_penalty)
         EXCLUSIVE_LOCKS_REQUIRED(!cs);
@@ -131,7 +139,7 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!cs);
 
     std::vector<CAddress> GetAddr(size_t max_addresses, size_t max_pct, std::optional<Network> network) const
-        EXCLUSIVE_LOCKS_REQUIRED(!cs);
+        EXCLUSIVE_LOCKS_REQUIRED(!cs, !m_addr_response_mutex);
 
     void Connected(const CService& addr, NodeSeconds time)
         EXCLUSIVE_LOCKS_REQUIRED(!cs);
@@ -209,6 +217,27 @@ private:
     //! Holds addrs inserted into tried table that collide with existing entries. Test-before-evict discipline used to resolve these collisions.
     std::set<int> m_tried_collisions;
 
+    //! Number of entries in vRandom, readable without taking cs.
+    std::atomic<size_t> m_size{0};
+
+    //! Incremented under cs by every call that may change an entry, invalidating cached GetAddr responses.
+    std::atomic<uint64_t> m_generation{0};
+
+    //! A GetAddr response, valid while m_generation is unchanged and it has not expired.
+    struct CachedAddrResponse {
+        uint64_t m_generation;
+        size_t m_max_addresses;
+        size_t m_max_pct;
+        NodeSeconds m_created;
+        std::vector<CAddress> m_addresses;
+    };
+
+    //! Protects m_addr_response_cache, so that cache hits never wait for cs.
+    mutable Mutex m_addr_response_mutex;
+
+    //! Last GetAddr response per network filter.
+    mutable std::map<std::optional<Network>, CachedAddrResponse> m_addr_response_cache GUARDED_BY(m_addr_response_mutex);
+
     /** Perform consistency checks every m_consistency_check_ratio operations (if non-zero). */
     const int32_t m_consistency_check_ratio;
 
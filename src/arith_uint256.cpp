@@ -8,6 +8,74 @@
 #include <uint256.h>
 #include <crypto/common.h>
 
+#ifdef __SIZEOF_INT128__
+namespace {
+/**
+ * A base_uint value in 64-bit limbs, least significant first, for the
+ * multiplication and division loops to take half as many steps as on the
+ * 32-bit limbs, with 128-bit intermediate products.
+ */
+template <unsigned int BITS>
+struct Limbs64 {
+    static constexpr int WIDTH = BITS / 64;
+    uint64_t n[WIDTH] = {};
+
+    Limbs64() = default;
+    explicit Limbs64(const uint32_t* pn)
+    {
+        for (int i = 0; i < WIDTH; i++)
+            n[i] = pn[2 * i] | (uint64_t)pn[2 * i + 1] << 32;
+    }
+
+    void Store(uint32_t* pn) const
+    {
+        for (int i = 0; i < WIDTH; i++) {
+            pn[2 * i] = n[i] & 0xffffffff;
+            pn[2 * i + 1] = n[i] >> 32;
+        }
+    }
+
+    bool operator>=(const Limbs64& b) const
+    {
+        for (int i = WIDTH - 1; i >= 0; i--) {
+            if (n[i] != b.n[i])
+                return n[i] > b.n[i];
+        }
+        return true;
+    }
+
+    void operator-=(const Limbs64& b)
+    {
+        uint64_t borrow = 0;
+        for (int i = 0; i < WIDTH; i++) {
+            const unsigned __int128 d = (unsigned __int128)n[i] - b.n[i] - borrow;
+            n[i] = (uint64_t)d;
+            borrow = (uint64_t)(d >> 64) & 1;
+        }
+    }
+
+    void ShiftLeft(unsigned int shift)
+    {
+        const int k = shift / 64;
+        shift %= 64;
+        for (int i = WIDTH - 1; i >= 0; i--) {
+            uint64_t v = i - k >= 0 ? n[i - k] << shift : 0;
+            if (shift != 0 && i - k - 1 >= 0)
+                v |= n[i - k - 1] >> (64 - shift);
+            n[i] = v;
+        }
+    }
+
+    void ShiftRight1()
+    {
+        for (int i = 0; i < WIDTH - 1; i++)
+            n[i] = (n[i] >> 1) | (n[i + 1] << 63);
+        n[WIDTH - 1] >>= 1;
+    }
+};
+} // namespace
+#endif
+
 
 template <unsigned int BITS>
 base_uint<BITS>::base_uint(const std::string& str)
@@ -66,6 +134,22 @@ base_uint<BITS>& base_uint<BITS>::operator*=(uint32_t b32)
 template <unsigned int BITS>
 base_uint<BITS>& base_uint<BITS>::operator*=(const base_uint& b)
 {
+#ifdef __SIZEOF_INT128__
+    if constexpr (BITS % 64 == 0) {
+        const Limbs64<BITS> x(pn), y(b.pn);
+        Limbs64<BITS> r;
+        for (int j = 0; j < r.WIDTH; j++) {
+            uint64_t carry = 0;
+            for (int i = 0; i + j < r.WIDTH; i++) {
+                const unsigned __int128 n = (unsigned __int128)x.n[j] * y.n[i] + r.n[i + j] + carry;
+                r.n[i + j] = (uint64_t)n;
+                carry = n >> 64;
+            }
+        }
+        r.Store(pn);
+        return *this;
+    }
+#endif
     base_uint<BITS> a;
     for (int j = 0; j < WIDTH; j++) {
         uint64_t carry = 0;
@@ -91,6 +175,37 @@ base_uint<BITS>& base_uint<BITS>::operator/=(const base_uint& b)
         throw uint_error("Division by zero");
     if (div_bits > num_bits) // the result is certainly 0.
         return *this;
+#ifdef __SIZEOF_INT128__
+    if constexpr (BITS % 64 == 0) {
+        Limbs64<BITS> q(num.pn);
+        if (div_bits <= 64) {
+            // Long division by a single limb, as used for the difficulty retarget
+            const uint64_t d = div.GetLow64();
+            unsigned __int128 rem = 0;
+            for (int i = q.WIDTH - 1; i >= 0; i--) {
+                rem = rem << 64 | q.n[i];
+                q.n[i] = (uint64_t)(rem / d);
+                rem %= d;
+            }
+            q.Store(pn);
+            return *this;
+        }
+        Limbs64<BITS> n64(num.pn), d64(div.pn);
+        q = Limbs64<BITS>();
+        int shift = num_bits - div_bits;
+        d64.ShiftLeft(shift);
+        while (shift >= 0) {
+            if (n64 >= d64) {
+                n64 -= d64;
+                q.n[shift / 64] |= (uint64_t)1 << (shift & 63);
+            }
+            d64.ShiftRight1();
+            shift--;
+        }
+        q.Store(pn);
+        return *this;
+    }
+#endif
     int shift = num_bits - div_bits;
     div <<= shift; // shift so that div and num align.
     while (shift >= 0) {
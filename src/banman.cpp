@@ -12,6 +12,50 @@
 #include <util/time.h>
 #include <util/translation.h>
 
+#include <cassert>
+
+void BannedSubnetIndex::Insert(const CSubNet& sub_net, int64_t ban_until)
+{
+    if (!sub_net.IsValid()) return;
+    if (m_nodes.empty()) m_nodes.emplace_back();
+
+    const std::vector<unsigned char> bytes{sub_net.GetNetworkAddr().GetAddrBytes()};
+    const size_t prefix_bits{sub_net.GetPrefixBits()};
+    assert(prefix_bits <= 8 * bytes.size());
+    uint32_t node{0};
+    for (size_t i = 0; i < prefix_bits; ++i) {
+        const int bit{(bytes[i / 8] >> (7 - i % 8)) & 1};
+        if (m_nodes[node].children[bit] == 0) {
+            m_nodes[node].children[bit] = m_nodes.size();
+            m_nodes.emplace_back();
+        }
+        node = m_nodes[node].children[bit];
+    }
+    m_entries.push_back(Entry{sub_net, ban_until, m_nodes[node].entry});
+    m_nodes[node].entry = m_entries.size() - 1;
+}
+
+void BannedSubnetIndex::Clear()
+{
+    m_nodes.clear();
+    m_entries.clear();
+}
+
+bool BannedSubnetIndex::IsBanned(const CNetAddr& net_addr, int64_t now) const
+{
+    if (m_nodes.empty()) return false;
+
+    const std::vector<unsigned char> bytes{net_addr.GetAddrBytes()};
+    uint32_t node{0};
+    for (size_t i = 0;; ++i) {
+        for (int32_t entry = m_nodes[node].entry; entry != -1; entry = m_entries[entry].next) {
+            if (now < m_entries[entry].ban_until && m_entries[entry].sub_net.Match(net_addr)) return true;
+        }
+        if (i == 8 * bytes.size()) return false;
+        node = m_nodes[node].children[(bytes[i / 8] >> (7 - i % 8)) & 1];
+        if (node == 0) return false;
+    }
+}
 
 BanMan::BanMan(fs::path ban_file, CClientUIInterface* client_interface, int64_t default_ban_time)
     : m_client_interface(client_interface), m_ban_db(std::move(ban_file)), m_default_ban_time(default_ban_time)
@@ -34,6 +78,7 @@ void BanMan::LoadBanlist()
     const auto start{SteadyClock::now()};
     if (m_ban_db.Read(m_banned)) {
         SweepBanned(); // sweep out unused entries
+        IndexBanned();
 
         LogPrint(BCLog::NET, "Loaded %d banned node addresses/subnets  %dms\n", m_banned.size(),
                  Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
@@ -41,6 +86,7 @@ void BanMan::LoadBanlist()
         LogPrintf("Recreating the banlist database\n");
         m_banned = {};
         m_is_dirty = true;
+        IndexBanned();
     }
 }
 
@@ -73,6 +119,7 @@ void BanMan::ClearBanned()
         LOCK(m_cs_banned);
         m_banned.clear();
         m_is_dirty = true;
+        IndexBanned();
     }
     DumpBanlist(); //store banlist to disk
     if (m_client_interface) m_client_interface->BannedListChanged();
@@ -88,15 +135,7 @@ bool BanMan::IsBanned(const CNetAddr& net_addr)
 {
     auto current_time = GetTime();
     LOCK(m_cs_banned);
-    for (const auto& it : m_banned) {
-        CSubNet sub_net = it.first;
-        CBanEntry ban_entry = it.second;
-
-        if (current_time < ban_entry.nBanUntil && sub_net.Match(net_addr)) {
-            return true;
-        }
-    }
-    return false;
+    return m_banned_index.IsBanned(net_addr, current_time);
 }
 
 bool BanMan::IsBanned(const CSubNet& sub_net)
@@ -142,6 +181,8 @@ void BanMan::Ban(const CSubNet& sub_net, int64_t ban_time_offset, bool since_uni
         if (m_banned[sub_net].nBanUntil < ban_entry.nBanUntil) {
             m_banned[sub_net] = ban_entry;
             m_is_dirty = true;
+            // The earlier, shorter ban of this subnet is dropped on the next rebuild
+            m_banned_index.Insert(sub_net, ban_entry.nBanUntil);
         } else
             return;
     }
@@ -163,6 +204,7 @@ bool BanMan::Unban(const CSubNet& sub_net)
         LOCK(m_cs_banned);
         if (m_banned.erase(sub_net) == 0) return false;
         m_is_dirty = true;
+        IndexBanned();
     }
     if (m_client_interface) m_client_interface->BannedListChanged();
     DumpBanlist(); //store banlist to disk immediately
@@ -197,12 +239,24 @@ void BanMan::SweepBanned()
         }
     }
 
+    if (notify_ui) IndexBanned();
+
     // update UI
     if (notify_ui && m_client_interface) {
         m_client_interface->BannedListChanged();
     }
 }
 
+void BanMan::IndexBanned()
+{
+    AssertLockHeld(m_cs_banned);
+
+    m_banned_index.Clear();
+    for (const auto& [sub_net, ban_entry] : m_banned) {
+        m_banned_index.Insert(sub_net, ban_entry.nBanUntil);
+    }
+}
+
 bool BanMan::BannedSetIsDirty()
 {
     LOCK(m_cs_banned);
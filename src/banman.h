@@ -9,11 +9,14 @@
 #include <common/bloom.h>
 #include <fs.h>
 #include <net_types.h> // For banmap_t
+#include <netaddress.h>
 #include <sync.h>
 
+#include <array>
 #include <chrono>
 #include <cstdint>
 #include <memory>
+#include <vector>
 
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static constexpr unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24; // Default 24-hour ban
@@ -22,8 +25,37 @@ static constexpr unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24; // Def
 static constexpr std::chrono::minutes DUMP_BANS_INTERVAL{15};
 
 class CClientUIInterface;
-class CNetAddr;
-class CSubNet;
+
+/**
+ * Binary prefix trie over the address bytes of banned subnets. Looking up an address
+ * follows its bits once, so the cost depends on the prefix length instead of on the
+ * number of banned subnets.
+ */
+class BannedSubnetIndex
+{
+public:
+    //! Index a subnet banned until ban_until. Invalid subnets are ignored.
+    void Insert(const CSubNet& sub_net, int64_t ban_until);
+
+    void Clear();
+
+    //! Return whether an indexed subnet that matches net_addr is banned later than now.
+    bool IsBanned(const CNetAddr& net_addr, int64_t now) const;
+
+private:
+    struct Node {
+        std::array<uint32_t, 2> children{}; //!< index in m_nodes, 0 if none (the root is never a child)
+        int32_t entry{-1};                   //!< first subnet with exactly this prefix, -1 if none
+    };
+    struct Entry {
+        CSubNet sub_net; //!< rechecked on a hit, as different networks may share address bytes
+        int64_t ban_until;
+        int32_t next; //!< next subnet with the same prefix, -1 if none
+    };
+
+    std::vector<Node> m_nodes;
+    std::vector<Entry> m_entries;
+};
 
 // Banman manages two related but distinct concepts:
 //
@@ -86,9 +118,12 @@ private:
     void SetBannedSetDirty(bool dirty = true);
     //!clean unused entries (if bantime has expired)
     void SweepBanned() EXCLUSIVE_LOCKS_REQUIRED(m_cs_banned);
+    //!rebuild m_banned_index after m_banned changed
+    void IndexBanned() EXCLUSIVE_LOCKS_REQUIRED(m_cs_banned);
 
     RecursiveMutex m_cs_banned;
     banmap_t m_banned GUARDED_BY(m_cs_banned);
+    BannedSubnetIndex m_banned_index GUARDED_BY(m_cs_banned);
     bool m_is_dirty GUARDED_BY(m_cs_banned){false};
     CClientUIInterface* m_client_interface = nullptr;
     CBanDB m_ban_db;
@@ -12,6 +12,7 @@
 #include <assert.h>
 #include <string.h>
 
+#include <algorithm>
 #include <limits>
 
 /** All alphanumeric characters except for "0", "I", "O", and "l" */
@@ -35,6 +36,10 @@ static const int8_t mapBase58[256] = {
     -1,-1,-1,-1,-1,-1,-1,-1, -1,-1,-1,-1,-1,-1,-1,-1,
 };
 
+/** Base58 digits packed in one limb of the numbers below, and the value of a full limb. */
+static constexpr int LIMB_DIGITS{5};
+static constexpr uint64_t LIMB_BASE{58ULL * 58 * 58 * 58 * 58};
+
 [[nodiscard]] static bool DecodeBase58(const char* psz, std::vector<unsigned char>& vch, int max_ret_len)
 {
     // Skip leading spaces.
@@ -42,45 +47,57 @@ static const int8_t mapBase58[256] = {
         psz++;
     // Skip and count leading '1's.
     int zeroes = 0;
-    int length = 0;
     while (*psz == '1') {
         zeroes++;
         if (zeroes > max_ret_len) return false;
         psz++;
     }
-    // Allocate enough space in big-endian base256 representation.
-    int size = strlen(psz) * 733 /1000 + 1; // log(58) / log(256), rounded up.
-    std::vector<unsigned char> b256(size);
-    // Process the characters.
+    // The number in little-endian 32-bit limbs, without leading zero limbs.
+    std::vector<uint32_t> limbs;
+    limbs.reserve(strlen(psz) * 733 / 4000 + 1); // log(58) / log(256), rounded up.
+    // Process the characters, up to LIMB_DIGITS at a time.
     static_assert(std::size(mapBase58) == 256, "mapBase58.size() should be 256"); // guarantee not out of range
     while (*psz && !IsSpace(*psz)) {
-        // Decode base58 character
-        int carry = mapBase58[(uint8_t)*psz];
-        if (carry == -1)  // Invalid b58 character
-            return false;
-        int i = 0;
-        for (std::vector<unsigned char>::reverse_iterator it = b256.rbegin(); (carry != 0 || i < length) && (it != b256.rend()); ++it, ++i) {
-            carry += 58 * (*it);
-            *it = carry % 256;
-            carry /= 256;
+        uint64_t carry = 0;
+        uint64_t base = 1;
+        for (int i = 0; i < LIMB_DIGITS && *psz && !IsSpace(*psz); ++i, ++psz) {
+            // Decode base58 character
+            int digit = mapBase58[(uint8_t)*psz];
+            if (digit == -1)  // Invalid b58 character
+                return false;
+            carry = carry * 58 + digit;
+            base *= 58;
+        }
+        // Apply "b256 = b256 * base + carry".
+        for (uint32_t& limb : limbs) {
+            carry += limb * base;
+            limb = uint32_t(carry);
+            carry >>= 32;
+        }
+        if (carry != 0) limbs.push_back(uint32_t(carry));
+        int length = limbs.size() * 4;
+        if (!limbs.empty()) {
+            for (uint32_t top = limbs.back(); top < 0x1000000; top <<= 8) length--;
         }
-        assert(carry == 0);
-        length = i;
         if (length + zeroes > max_ret_len) return false;
-        psz++;
     }
     // Skip trailing spaces.
     while (IsSpace(*psz))
         psz++;
     if (*psz != 0)
         return false;
-    // Skip leading zeroes in b256.
-    std::vector<unsigned char>::iterator it = b256.begin() + (size - length);
-    // Copy result into output vector.
-    vch.reserve(zeroes + (b256.end() - it));
+    // Copy result into output vector, skipping the leading zeroes of the top limb.
+    vch.reserve(zeroes + limbs.size() * 4);
     vch.assign(zeroes, 0x00);
-    while (it != b256.end())
-        vch.push_back(*(it++));
+    bool leading = true;
+    for (auto it = limbs.rbegin(); it != limbs.rend(); ++it) {
+        for (int shift = 24; shift >= 0; shift -= 8) {
+            const unsigned char byte = *it >> shift;
+            if (leading && byte == 0) continue;
+            leading = false;
+            vch.push_back(byte);
+        }
+    }
     return true;
 }
 
@@ -88,39 +105,52 @@ std::string EncodeBase58(Span<const unsigned char> input)
 {
     // Skip & count leading zeroes.
     int zeroes = 0;
-    int length = 0;
     while (input.size() > 0 && input[0] == 0) {
         input = input.subspan(1);
         zeroes++;
     }
-    // Allocate enough space in big-endian base58 representation.
-    int size = input.size() * 138 / 100 + 1; // log(256) / log(58), rounded up.
-    std::vector<unsigned char> b58(size);
-    // Process the bytes.
+    // The number in little-endian limbs of LIMB_DIGITS base58 digits, without leading zero limbs.
+    std::vector<uint32_t> limbs;
+    limbs.reserve(input.size() * 138 / 500 + 1); // log(256) / log(58), rounded up.
+    // Process the bytes, 4 at a time.
     while (input.size() > 0) {
-        int carry = input[0];
-        int i = 0;
-        // Apply "b58 = b58 * 256 + ch".
-        for (std::vector<unsigned char>::reverse_iterator it = b58.rbegin(); (carry != 0 || i < length) && (it != b58.rend()); it++, i++) {
-            carry += 256 * (*it);
-            *it = carry % 58;
-            carry /= 58;
+        const size_t count = std::min<size_t>(input.size(), 4);
+        uint64_t carry = 0;
+        for (size_t i = 0; i < count; ++i) {
+            carry = carry << 8 | input[i];
         }
-
-        assert(carry == 0);
-        length = i;
-        input = input.subspan(1);
+        // Apply "b58 = b58 * 256^count + carry".
+        const unsigned shift = 8 * count;
+        for (uint32_t& limb : limbs) {
+            carry += uint64_t{limb} << shift;
+            limb = carry % LIMB_BASE;
+            carry /= LIMB_BASE;
+        }
+        while (carry != 0) {
+            limbs.push_back(carry % LIMB_BASE);
+            carry /= LIMB_BASE;
+        }
+        input = input.subspan(count);
     }
-    // Skip leading zeroes in base58 result.
-    std::vector<unsigned char>::iterator it = b58.begin() + (size - length);
-    while (it != b58.end() && *it == 0)
-        it++;
-    // Translate the result into a string.
+    // Translate the result into a string, skipping the leading zeroes of the top limb.
     std::string str;
-    str.reserve(zeroes + (b58.end() - it));
+    str.reserve(zeroes + limbs.size() * LIMB_DIGITS);
     str.assign(zeroes, '1');
-    while (it != b58.end())
-        str += pszBase58[*(it++)];
+    char digits[LIMB_DIGITS];
+    for (auto it = limbs.rbegin(); it != limbs.rend(); ++it) {
+        uint32_t limb = *it;
+        for (int i = LIMB_DIGITS - 1; i >= 0; --i) {
+            digits[i] = limb % 58;
+            limb /= 58;
+        }
+        int first = 0;
+        if (it == limbs.rbegin()) {
+            while (digits[first] == 0) first++;
+        }
+        for (int i = first; i < LIMB_DIGITS; ++i) {
+            str += pszBase58[int(digits[i])];
+        }
+    }
     return str;
 }
 
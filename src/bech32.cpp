@@ -4,7 +4,6 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <bech32.h>
-#include <util/vector.h>
 
 #include <array>
 #include <assert.h>
@@ -124,10 +123,31 @@ uint32_t EncodingConstant(Encoding encoding) {
     return encoding == Encoding::BECH32 ? 1 : 0x2bc830a3;
 }
 
+/** The multiples {c0}k(x) PolyMod adds for each value of c0, the XOR of the ones for its set bits. */
+constexpr std::array<uint32_t, 32> GeneratePolyModTable()
+{
+    constexpr uint32_t generator[5] = {0x3b6a57b2, 0x26508e6d, 0x1ea119fa, 0x3d4233dd, 0x2a1462b3};
+    std::array<uint32_t, 32> table{};
+    for (int c0 = 0; c0 < 32; ++c0) {
+        for (int n = 0; n < 5; ++n) {
+            if (c0 >> n & 1) table[c0] ^= generator[n];
+        }
+    }
+    return table;
+}
+
+constexpr std::array<uint32_t, 32> POLYMOD_TABLE = GeneratePolyModTable();
+
+/** Process one more value in PolyMod, see there. */
+inline uint32_t PolyModStep(uint32_t c, uint8_t v_i)
+{
+    return ((c & 0x1ffffff) << 5) ^ v_i ^ POLYMOD_TABLE[c >> 25];
+}
+
 /** This function will compute what 6 5-bit values to XOR into the last 6 input values, in order to
  *  make the checksum 0. These 6 values are packed together in a single 30-bit integer. The higher
- *  bits correspond to earlier values. */
-uint32_t PolyMod(const data& v)
+ *  bits correspond to earlier values. `c` is the result for values processed before v. */
+uint32_t PolyMod(const data& v, uint32_t c = 1)
 {
     // The input is interpreted as a list of coefficients of a polynomial over F = GF(32), with an
     // implicit 1 in front. If the input is [v0,v1,v2,v3,v4], that polynomial is v(x) =
@@ -174,7 +194,6 @@ uint32_t PolyMod(const data& v)
     // That guarantees it is, in fact, the generator of a primitive BCH code with cycle
     // length 1023 and distance 4. See https://en.wikipedia.org/wiki/BCH_code for more details.
 
-    uint32_t c = 1;
     for (const auto v_i : v) {
         // We want to update `c` to correspond to a polynomial with one extra term. If the initial
         // value of `c` consists of the coefficients of c(x) = f(x) mod g(x), we modify it to
@@ -190,13 +209,11 @@ uint32_t PolyMod(const data& v)
         // If we call (x^6 mod g(x)) = k(x), this can be written as
         // c'(x) = (c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i) + c0*k(x)
 
-        // First, determine the value of c0:
-        uint8_t c0 = c >> 25;
-
-        // Then compute c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i:
-        c = ((c & 0x1ffffff) << 5) ^ v_i;
+        // First, determine the value of c0 = c >> 25, then compute
+        // c1*x^5 + c2*x^4 + c3*x^3 + c4*x^2 + c5*x + v_i = ((c & 0x1ffffff) << 5) ^ v_i.
 
-        // Finally, for each set bit n in c0, conditionally add {2^n}k(x). These constants can be
+        // Finally, for each set bit n in c0, add {2^n}k(x), which PolyModStep looks up for all of
+        // c0 at once in POLYMOD_TABLE. These constants can be
         // computed using the following Sage code (continuing the code above):
         //
         // for i in [1,2,4,8,16]: # Print out {1,2,4,8,16}*(g(x) mod x^6), packed in hex integers.
@@ -205,12 +222,12 @@ uint32_t PolyMod(const data& v)
         //         v = v*32 + coef.integer_representation()
         //     print("0x%x" % v)
         //
-        if (c0 & 1)  c ^= 0x3b6a57b2; //     k(x) = {29}x^5 + {22}x^4 + {20}x^3 + {21}x^2 + {29}x + {18}
-        if (c0 & 2)  c ^= 0x26508e6d; //  {2}k(x) = {19}x^5 +  {5}x^4 +     x^3 +  {3}x^2 + {19}x + {13}
-        if (c0 & 4)  c ^= 0x1ea119fa; //  {4}k(x) = {15}x^5 + {10}x^4 +  {2}x^3 +  {6}x^2 + {15}x + {26}
-        if (c0 & 8)  c ^= 0x3d4233dd; //  {8}k(x) = {30}x^5 + {20}x^4 +  {4}x^3 + {12}x^2 + {30}x + {29}
-        if (c0 & 16) c ^= 0x2a1462b3; // {16}k(x) = {21}x^5 +     x^4 +  {8}x^3 + {24}x^2 + {21}x + {19}
-
+        //     k(x) = {29}x^5 + {22}x^4 + {20}x^3 + {21}x^2 + {29}x + {18} = 0x3b6a57b2
+        //  {2}k(x) = {19}x^5 +  {5}x^4 +     x^3 +  {3}x^2 + {19}x + {13} = 0x26508e6d
+        //  {4}k(x) = {15}x^5 + {10}x^4 +  {2}x^3 +  {6}x^2 + {15}x + {26} = 0x1ea119fa
+        //  {8}k(x) = {30}x^5 + {20}x^4 +  {4}x^3 + {12}x^2 + {30}x + {29} = 0x3d4233dd
+        // {16}k(x) = {21}x^5 +     x^4 +  {8}x^3 + {24}x^2 + {21}x + {19} = 0x2a1462b3
+        c = PolyModStep(c, v_i);
     }
     return c;
 }
@@ -308,19 +325,17 @@ bool CheckCharacters(const std::string& str, std::vector<int>& errors)
     return errors.empty();
 }
 
-/** Expand a HRP for use in checksum computation. */
-data ExpandHRP(const std::string& hrp)
+/** PolyMod of the expanded HRP followed by values and a number of zeroes, without building that list.
+ *  The HRP is expanded into the high bits of its characters, a zero, and their low 5 bits. */
+uint32_t PolyModHRP(const std::string& hrp, const data& values, size_t zeroes = 0)
 {
-    data ret;
-    ret.reserve(hrp.size() + 90);
-    ret.resize(hrp.size() * 2 + 1);
-    for (size_t i = 0; i < hrp.size(); ++i) {
-        unsigned char c = hrp[i];
-        ret[i] = c >> 5;
-        ret[i + hrp.size() + 1] = c & 0x1f;
-    }
-    ret[hrp.size()] = 0;
-    return ret;
+    uint32_t c = 1;
+    for (const unsigned char ch : hrp) c = PolyModStep(c, ch >> 5);
+    c = PolyModStep(c, 0);
+    for (const unsigned char ch : hrp) c = PolyModStep(c, ch & 0x1f);
+    c = PolyMod(values, c);
+    for (size_t i = 0; i < zeroes; ++i) c = PolyModStep(c, 0);
+    return c;
 }
 
 /** Verify a checksum. */
@@ -331,7 +346,7 @@ Encoding VerifyChecksum(const std::string& hrp, const data& values)
     // list of values would result in a new valid list. For that reason, Bech32 requires the
     // resulting checksum to be 1 instead. In Bech32m, this constant was amended. See
     // https://gist.github.com/sipa/14c248c288c3880a3b191f978a34508e for details.
-    const uint32_t check = PolyMod(Cat(ExpandHRP(hrp), values));
+    const uint32_t check = PolyModHRP(hrp, values);
     if (check == EncodingConstant(Encoding::BECH32)) return Encoding::BECH32;
     if (check == EncodingConstant(Encoding::BECH32M)) return Encoding::BECH32M;
     return Encoding::INVALID;
@@ -340,9 +355,8 @@ Encoding VerifyChecksum(const std::string& hrp, const data& values)
 /** Create a checksum. */
 data CreateChecksum(Encoding encoding, const std::string& hrp, const data& values)
 {
-    data enc = Cat(ExpandHRP(hrp), values);
-    enc.resize(enc.size() + 6); // Append 6 zeroes
-    uint32_t mod = PolyMod(enc) ^ EncodingConstant(encoding); // Determine what to XOR into those 6 zeroes.
+    // Append 6 zeroes, and determine what to XOR into them.
+    uint32_t mod = PolyModHRP(hrp, values, /*zeroes=*/6) ^ EncodingConstant(encoding);
     data ret(6);
     for (size_t i = 0; i < 6; ++i) {
         // Convert the 5-bit groups in mod to checksum values.
@@ -360,10 +374,14 @@ std::string Encode(Encoding encoding, const std::string& hrp, const data& values
     // result will always be invalid.
     for (const char& c : hrp) assert(c < 'A' || c > 'Z');
     data checksum = CreateChecksum(encoding, hrp, values);
-    data combined = Cat(values, checksum);
-    std::string ret = hrp + '1';
-    ret.reserve(ret.size() + combined.size());
-    for (const auto c : combined) {
+    std::string ret;
+    ret.reserve(hrp.size() + 1 + values.size() + checksum.size());
+    ret += hrp;
+    ret += '1';
+    for (const auto c : values) {
+        ret += CHARSET[c];
+    }
+    for (const auto c : checksum) {
         ret += CHARSET[c];
     }
     return ret;
@@ -441,9 +459,9 @@ std::pair<std::string, std::vector<int>> LocateErrors(const std::string& str) {
     std::optional<Encoding> error_encoding;
     for (Encoding encoding : {Encoding::BECH32, Encoding::BECH32M}) {
         std::vector<int> possible_errors;
-        // Recall that (ExpandHRP(hrp) ++ values) is interpreted as a list of coefficients of a polynomial
+        // Recall that (expanded hrp ++ values) is interpreted as a list of coefficients of a polynomial
         // over GF(32). PolyMod computes the "remainder" of this polynomial modulo the generator G(x).
-        uint32_t residue = PolyMod(Cat(ExpandHRP(hrp), values)) ^ EncodingConstant(encoding);
+        uint32_t residue = PolyModHRP(hrp, values) ^ EncodingConstant(encoding);
 
         // All valid codewords should be multiples of G(x), so this remainder (after XORing with the encoding
         // constant) should be 0 - hence 0 indicates there are no errors present.
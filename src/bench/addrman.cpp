@@ -10,6 +10,7 @@
 #include <util/time.h>
 
 #include <optional>
+#include <thread>
 #include <vector>
 
 /* A "source" is a source address from which we have received a bunch of other addresses. */
@@ -133,7 +134,41 @@ static void AddrManAddThenGood(benchmark::Bench& bench)
     });
 }
 
+static void AddrManContention(benchmark::Bench& bench)
+{
+    static constexpr size_t NUM_READERS{3};
+    static constexpr size_t OPS_PER_THREAD{100};
+
+    AddrMan addrman{EMPTY_NETGROUPMAN, /*deterministic=*/false, ADDRMAN_CONSISTENCY_CHECK_RATIO};
+
+    FillAddrMan(addrman);
+
+    bench.batch(OPS_PER_THREAD * (NUM_READERS + 1)).unit("op").run([&] {
+        // Readers answer getaddr and open connections while a writer records connection attempts
+        std::vector<std::thread> threads;
+        for (size_t reader = 0; reader < NUM_READERS; ++reader) {
+            threads.emplace_back([&] {
+                for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                    if (i % 4 == 0) {
+                        assert(addrman.GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/std::nullopt).size() > 0);
+                    } else {
+                        assert(addrman.Select().first.GetPort() > 0);
+                        assert(addrman.size() > 0);
+                    }
+                }
+            });
+        }
+        threads.emplace_back([&] {
+            for (size_t i = 0; i < OPS_PER_THREAD; ++i) {
+                addrman.Attempt(g_addresses[i % NUM_SOURCES][i % NUM_ADDRESSES_PER_SOURCE], /*fCountFailure=*/false);
+            }
+        });
+        for (auto& thread : threads) thread.join();
+    });
+}
+
 BENCHMARK(AddrManAdd);
 BENCHMARK(AddrManSelect);
 BENCHMARK(AddrManGetAddr);
 BENCHMARK(AddrManAddThenGood);
+BENCHMARK(AddrManContention);
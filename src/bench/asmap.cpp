@@ -0,0 +1,73 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <random.h>
+#include <util/asmap.h>
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+/** Append val in the variable length encoding read by DecodeBits() in util/asmap.cpp. */
+static void EncodeBits(std::vector<bool>& out, uint32_t val, uint32_t minval, const std::vector<uint8_t>& bit_sizes)
+{
+    val -= minval;
+    for (size_t i = 0; i < bit_sizes.size(); ++i) {
+        const uint32_t class_size{uint32_t{1} << bit_sizes[i]};
+        if (i + 1 != bit_sizes.size()) {
+            if (val >= class_size) {
+                out.push_back(true);
+                val -= class_size;
+                continue;
+            }
+            out.push_back(false);
+        }
+        for (int b = bit_sizes[i] - 1; b >= 0; --b) out.push_back((val >> b) & 1);
+        return;
+    }
+}
+
+/** Encode a random binary tree of JUMP and RETURN instructions of at most the given depth. */
+static std::vector<bool> RandomAsmap(FastRandomContext& rng, int depth)
+{
+    std::vector<bool> out;
+    if (depth == 0 || rng.randrange(4) == 0) {
+        out.push_back(false); // RETURN
+        EncodeBits(out, 1 + rng.randrange(400000), 1, {15, 16, 17, 18, 19, 20, 21, 22, 23, 24});
+        return out;
+    }
+    const std::vector<bool> unset{RandomAsmap(rng, depth - 1)};
+    const std::vector<bool> set{RandomAsmap(rng, depth - 1)};
+    out.push_back(true); // JUMP
+    out.push_back(false);
+    EncodeBits(out, unset.size(), 17, {5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27, 28, 29, 30});
+    out.insert(out.end(), unset.begin(), unset.end());
+    out.insert(out.end(), set.begin(), set.end());
+    return out;
+}
+
+static void AsmapLookup(benchmark::Bench& bench, bool compiled)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const std::vector<bool> asmap{RandomAsmap(rng, /*depth=*/20)};
+    assert(SanityCheckASMap(asmap, 128));
+    const CompiledAsmap compiled_asmap{asmap};
+
+    std::vector<std::vector<bool>> ips(1024, std::vector<bool>(128));
+    for (auto& ip : ips) {
+        for (size_t bit = 0; bit < ip.size(); ++bit) ip[bit] = rng.randbool();
+    }
+    size_t i{0};
+    bench.run([&] {
+        const std::vector<bool>& ip{ips[i++ % ips.size()]};
+        ankerl::nanobench::doNotOptimizeAway(compiled ? compiled_asmap.Interpret(ip) : Interpret(asmap, ip));
+    });
+}
+
+static void AsmapInterpret(benchmark::Bench& bench) { AsmapLookup(bench, /*compiled=*/false); }
+static void AsmapCompiled(benchmark::Bench& bench) { AsmapLookup(bench, /*compiled=*/true); }
+
+BENCHMARK(AsmapInterpret);
+BENCHMARK(AsmapCompiled);
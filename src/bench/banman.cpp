@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <banman.h>
+#include <bench/bench.h>
+#include <netaddress.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+
+#include <limits>
+#include <vector>
+
+/** Number of subnets of an imported blocklist. */
+static constexpr size_t NUM_BANNED_SUBNETS{20000};
+
+static CNetAddr RandomIPv4(FastRandomContext& rng)
+{
+    return CNetAddr{in_addr{static_cast<uint32_t>(rng.rand32())}};
+}
+
+static std::vector<CSubNet> CreateBannedSubnets()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<CSubNet> subnets;
+    for (size_t i = 0; i < NUM_BANNED_SUBNETS; ++i) {
+        subnets.emplace_back(RandomIPv4(rng), static_cast<uint8_t>(16 + rng.randrange(17)));
+    }
+    return subnets;
+}
+
+static void BannedSubnetScan(benchmark::Bench& bench)
+{
+    const std::vector<CSubNet> subnets{CreateBannedSubnets()};
+    FastRandomContext rng{/*fDeterministic=*/true};
+    bench.run([&] {
+        const CNetAddr addr{RandomIPv4(rng)};
+        bool banned{false};
+        for (const CSubNet& sub_net : subnets) {
+            if (sub_net.Match(addr)) {
+                banned = true;
+                break;
+            }
+        }
+        ankerl::nanobench::doNotOptimizeAway(banned);
+    });
+}
+
+static void BannedSubnetIndexLookup(benchmark::Bench& bench)
+{
+    BannedSubnetIndex index;
+    for (const CSubNet& sub_net : CreateBannedSubnets()) {
+        index.Insert(sub_net, std::numeric_limits<int64_t>::max());
+    }
+    FastRandomContext rng{/*fDeterministic=*/true};
+    const int64_t now{GetTime()};
+    bench.run([&] {
+        ankerl::nanobench::doNotOptimizeAway(index.IsBanned(RandomIPv4(rng), now));
+    });
+}
+
+static void BanManIsDiscouraged(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    BanMan banman{testing_setup->m_args.GetDataDirBase() / "banlist", /*client_interface=*/nullptr, DEFAULT_MISBEHAVING_BANTIME};
+    FastRandomContext rng{/*fDeterministic=*/true};
+    for (int i = 0; i < 50000; ++i) {
+        banman.Discourage(RandomIPv4(rng));
+    }
+    bench.run([&] {
+        ankerl::nanobench::doNotOptimizeAway(banman.IsDiscouraged(RandomIPv4(rng)));
+    });
+}
+
+BENCHMARK(BannedSubnetScan);
+BENCHMARK(BannedSubnetIndexLookup);
+BENCHMARK(BanManIsDiscouraged);
@@ -6,13 +6,19 @@
 
 #include <fs.h>
 #include <test/util/setup_common.h>
+#include <tinyformat.h>
+#include <univalue.h>
 
+#include <algorithm>
 #include <chrono>
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <iterator>
 #include <map>
+#include <optional>
 #include <regex>
+#include <sstream>
 #include <string>
 #include <vector>
 
@@ -24,6 +30,34 @@ const std::function<std::vector<const char*>()> G_TEST_COMMAND_LINE_ARGUMENTS{};
 
 namespace {
 
+//! The bench files of each suite but "util", without their extension
+const std::map<std::string, std::vector<std::string>> SUITE_FILES{
+    {"crypto", {"base58", "bech32", "chacha20", "chacha_poly_aead", "crypto_hash", "hasher", "hashpadding", "poly1305"}},
+    {"pow", {"headers_sync", "pow"}},
+    {"validation", {"block_assemble", "block_index", "block_storage", "ccoins_caching", "checkblock", "checkqueue", "coins_db", "duplicate_inputs", "merkle_root", "reorg", "verify_script"}},
+    {"mempool", {"mempool_eviction", "mempool_stress", "txorphanage"}},
+    {"net", {"addrman", "asmap", "banman", "blockencodings", "message_receive", "p2p_load", "peer_eviction", "txrequest"}},
+    {"wallet", {"coin_selection", "descriptors", "wallet_balance", "wallet_loading", "wallet_notifications"}},
+    {"rpc", {"rpc_blockchain", "rpc_mempool"}},
+    {"chain", {"chain_fixture"}},
+};
+const std::string DEFAULT_SUITE{"util"};
+
+std::string SuiteOfFile(const char* file)
+{
+    const std::string stem{fs::PathToString(fs::PathFromString(file).stem())};
+    for (const auto& [suite, files] : SUITE_FILES) {
+        if (std::find(files.begin(), files.end(), stem) != files.end()) return suite;
+    }
+    return DEFAULT_SUITE;
+}
+
+/** Time per operation, as the ns/op column shows it, of a benchmark result */
+double NanosecondsPerOp(const ankerl::nanobench::Result& result)
+{
+    return result.median(ankerl::nanobench::Result::Measure::elapsed) / result.config().mBatch * 1e9;
+}
+
 void GenerateTemplateResults(const std::vector<ankerl::nanobench::Result>& benchmarkResults, const fs::path& file, const char* tpl)
 {
     if (benchmarkResults.empty() || file.empty()) {
@@ -39,20 +73,107 @@ void GenerateTemplateResults(const std::vector<ankerl::nanobench::Result>& bench
     }
 }
 
+/** Write the results as nanobench's JSON template does, with the environment of the run. */
+void GenerateJsonResults(const std::vector<ankerl::nanobench::Result>& benchmarkResults, const fs::path& file, const std::map<std::string, std::string>& environment)
+{
+    if (benchmarkResults.empty() || file.empty()) {
+        return;
+    }
+    std::ostringstream rendered;
+    ankerl::nanobench::render(ankerl::nanobench::templates::json(), benchmarkResults, rendered);
+    UniValue json;
+    if (!json.read(rendered.str())) {
+        std::cout << "Could not render the results as JSON" << std::endl;
+        return;
+    }
+    UniValue env(UniValue::VOBJ);
+    for (const auto& [key, value] : environment) {
+        env.pushKV(key, value);
+    }
+    json.pushKV("environment", env);
+    std::ofstream fout{file};
+    if (fout.is_open()) {
+        fout << json.write(4) << std::endl;
+        std::cout << "Created " << file << std::endl;
+    } else {
+        std::cout << "Could not write to file " << file << std::endl;
+    }
+}
+
+/**
+ * Compare the results with those of the JSON output of an earlier run,
+ * printing the change of each benchmark of both. Returns false if one is
+ * slower by more than the tolerance, or if the baseline cannot be read.
+ */
+bool CompareResults(const std::vector<ankerl::nanobench::Result>& benchmarkResults, const benchmark::Args& args)
+{
+    std::ifstream fin{args.compare};
+    UniValue baseline;
+    if (!fin.is_open() || !baseline.read(std::string{std::istreambuf_iterator<char>{fin}, std::istreambuf_iterator<char>{}}) ||
+        !baseline.isObject() || !baseline["results"].isArray()) {
+        std::cout << "Could not read the baseline " << args.compare << std::endl;
+        return false;
+    }
+
+    const UniValue& baseline_env{baseline["environment"]};
+    for (const auto& [key, value] : args.environment) {
+        const UniValue& baseline_value{baseline_env.isObject() ? baseline_env[key] : NullUniValue};
+        if (!baseline_value.isStr() || baseline_value.get_str() != value) {
+            tfm::format(std::cout, "Warning: the %s of the baseline differs: %s\n", key, baseline_value.isStr() ? baseline_value.get_str() : "unknown");
+        }
+    }
+
+    std::map<std::string, double> baseline_ns;
+    for (const UniValue& result : baseline["results"].getValues()) {
+        if (!result["name"].isStr() || !result["median(elapsed)"].isNum() || !result["batch"].isNum()) continue;
+        baseline_ns[result["name"].get_str()] = result["median(elapsed)"].get_real() / result["batch"].get_real() * 1e9;
+    }
+
+    tfm::format(std::cout, "\nComparison with %s, reporting slowdowns above %.1f%%\n\n", fs::PathToString(args.compare), args.compare_tolerance);
+    tfm::format(std::cout, "| %19s | %19s | %9s | benchmark\n", "baseline ns/op", "ns/op", "change");
+    tfm::format(std::cout, "|--------------------:|--------------------:|----------:|:----------\n");
+    size_t regressions{0};
+    for (const auto& result : benchmarkResults) {
+        const std::string& name{result.config().mBenchmarkName};
+        const double ns{NanosecondsPerOp(result)};
+        const auto it{baseline_ns.find(name)};
+        if (it == baseline_ns.end() || it->second <= 0) {
+            tfm::format(std::cout, "| %19s | %19.2f | %9s | `%s`\n", "", ns, "new", name);
+            continue;
+        }
+        const double change{(ns / it->second - 1) * 100};
+        const bool regression{change > args.compare_tolerance};
+        if (regression) ++regressions;
+        tfm::format(std::cout, "| %19.2f | %19.2f | %+8.1f%% | `%s`%s\n", it->second, ns, change, name, regression ? " REGRESSION" : "");
+    }
+    tfm::format(std::cout, "\n%d of %d benchmarks regressed\n", regressions, benchmarkResults.size());
+    return regressions == 0;
+}
+
 } // namespace
 
+std::vector<std::string> benchmark::Suites()
+{
+    std::vector<std::string> suites;
+    for (const auto& [suite, files] : SUITE_FILES) {
+        suites.push_back(suite);
+    }
+    suites.push_back(DEFAULT_SUITE);
+    return suites;
+}
+
 benchmark::BenchRunner::BenchmarkMap& benchmark::BenchRunner::benchmarks()
 {
-    static std::map<std::string, BenchFunction> benchmarks_map;
+    static BenchmarkMap benchmarks_map;
     return benchmarks_map;
 }
 
-benchmark::BenchRunner::BenchRunner(std::string name, benchmark::BenchFunction func)
+benchmark::BenchRunner::BenchRunner(std::string name, benchmark::BenchFunction func, const char* file)
 {
-    benchmarks().insert(std::make_pair(name, func));
+    benchmarks().insert(std::make_pair(name, Benchmark{func, SuiteOfFile(file)}));
 }
 
-void benchmark::BenchRunner::RunAll(const Args& args)
+bool benchmark::BenchRunner::RunAll(const Args& args)
 {
     std::regex reFilter(args.regex_filter);
     std::smatch baseMatch;
@@ -66,6 +187,9 @@ void benchmark::BenchRunner::RunAll(const Args& args)
         if (!std::regex_match(p.first, baseMatch, reFilter)) {
             continue;
         }
+        if (!args.suite.empty() && p.second.suite != args.suite) {
+            continue;
+        }
 
         if (args.is_list_only) {
             std::cout << p.first << std::endl;
@@ -84,11 +208,11 @@ void benchmark::BenchRunner::RunAll(const Args& args)
         }
 
         if (args.asymptote.empty()) {
-            p.second(bench);
+            p.second.func(bench);
         } else {
             for (auto n : args.asymptote) {
                 bench.complexityN(n);
-                p.second(bench);
+                p.second.func(bench);
             }
             std::cout << bench.complexityBigO() << std::endl;
         }
@@ -101,5 +225,12 @@ void benchmark::BenchRunner::RunAll(const Args& args)
     GenerateTemplateResults(benchmarkResults, args.output_csv, "# Benchmark, evals, iterations, total, min, max, median\n"
                                                                "{{#result}}{{name}}, {{epochs}}, {{average(iterations)}}, {{sumProduct(iterations, elapsed)}}, {{minimum(elapsed)}}, {{maximum(elapsed)}}, {{median(elapsed)}}\n"
                                                                "{{/result}}");
-    GenerateTemplateResults(benchmarkResults, args.output_json, ankerl::nanobench::templates::json());
+    GenerateJsonResults(benchmarkResults, args.output_json, args.environment);
+
+    if (args.compare.empty() || args.is_list_only) return true;
+    if (args.sanity_check) {
+        std::cout << "Not comparing with the baseline in a run with --sanity-check." << std::endl;
+        return true;
+    }
+    return CompareResults(benchmarkResults, args);
 }
@@ -49,22 +49,41 @@ struct Args {
     fs::path output_csv;
     fs::path output_json;
     std::string regex_filter;
+    //! Suite to run the benchmarks of, all if empty
+    std::string suite;
+    //! JSON output of an earlier run to compare the results with, if not empty
+    fs::path compare;
+    //! Slowdown of a benchmark, in percent, that the comparison reports as a regression
+    double compare_tolerance;
+    //! What the results depend on besides the code, like the implementations chosen for the CPU
+    std::map<std::string, std::string> environment;
 };
 
+/**
+ * The suites benchmarks are grouped in, by the file that defines them,
+ * like "crypto" or "wallet". Benchmarks of files of no suite are in "util".
+ */
+std::vector<std::string> Suites();
+
 class BenchRunner
 {
-    typedef std::map<std::string, BenchFunction> BenchmarkMap;
+    struct Benchmark {
+        BenchFunction func;
+        std::string suite;
+    };
+    typedef std::map<std::string, Benchmark> BenchmarkMap;
     static BenchmarkMap& benchmarks();
 
 public:
-    BenchRunner(std::string name, BenchFunction func);
+    BenchRunner(std::string name, BenchFunction func, const char* file);
 
-    static void RunAll(const Args& args);
+    /** Run the benchmarks, returning false if comparing them with args.compare found a regression. */
+    static bool RunAll(const Args& args);
 };
 } // namespace benchmark
 
-// BENCHMARK(foo) expands to:  benchmark::BenchRunner bench_11foo("foo", foo);
+// BENCHMARK(foo) expands to:  benchmark::BenchRunner bench_11foo("foo", foo, __FILE__);
 #define BENCHMARK(n) \
-    benchmark::BenchRunner PASTE2(bench_, PASTE2(__LINE__, n))(STRINGIZE(n), n);
+    benchmark::BenchRunner PASTE2(bench_, PASTE2(__LINE__, n))(STRINGIZE(n), n, __FILE__);
 
 #endif // BITCOIN_BENCH_BENCH_H
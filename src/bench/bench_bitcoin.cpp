@@ -2,33 +2,46 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <bench/bench.h>
 
 #include <clientversion.h>
+#include <crypto/chacha20.h>
+#include <crypto/neoscrypt_multiway.h>
 #include <crypto/sha256.h>
 #include <fs.h>
 #include <util/strencodings.h>
+#include <util/string.h>
 #include <util/system.h>
 
+#include <algorithm>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <vector>
 
 static const char* DEFAULT_BENCH_FILTER = ".*";
 static constexpr int64_t DEFAULT_MIN_TIME_MS{10};
+static constexpr int64_t DEFAULT_COMPARE_TOLERANCE_PERCENT{10};
 
 static void SetupBenchArgs(ArgsManager& argsman)
 {
     SetupHelpOptions(argsman);
 
+    argsman.AddArg("-compare=<baseline.json>", "Compare the results with the JSON file of an earlier run, given with -output-json, and fail if a benchmark got slower", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-compare-tolerance=<percent>", strprintf("How much slower than the baseline of -compare a benchmark may be, in percent (default: %d)", DEFAULT_COMPARE_TOLERANCE_PERCENT), ArgsManager::ALLOW_ANY | ArgsManager::DISALLOW_NEGATION, OptionsCategory::OPTIONS);
     argsman.AddArg("-asymptote=<n1,n2,n3,...>", "Test asymptotic growth of the runtime of an algorithm, if supported by the benchmark", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-filter=<regex>", strprintf("Regular expression filter to select benchmark by name (default: %s)", DEFAULT_BENCH_FILTER), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-list", "List benchmarks without executing them", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-min-time=<milliseconds>", strprintf("Minimum runtime per benchmark, in milliseconds (default: %d)", DEFAULT_MIN_TIME_MS), ArgsManager::ALLOW_ANY | ArgsManager::DISALLOW_NEGATION, OptionsCategory::OPTIONS);
     argsman.AddArg("-output-csv=<output.csv>", "Generate CSV file with the most important benchmark results", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-output-json=<output.json>", "Generate JSON file with all benchmark results", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-suite=<name>", strprintf("Run only the benchmarks of a suite, one of: %s", Join(benchmark::Suites(), ", ")), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-sanity-check", "Run benchmarks for only one iteration", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 }
 
@@ -49,7 +62,17 @@ int main(int argc, char** argv)
 {
     ArgsManager argsman;
     SetupBenchArgs(argsman);
-    SHA256AutoDetect();
+    benchmark::Args args;
+    args.environment["version"] = FormatFullVersion();
+    args.environment["sha256"] = SHA256AutoDetect();
+    args.environment["neoscrypt"] = NeoScryptAutoDetect();
+    args.environment["chacha20"] = ChaCha20AutoDetect();
+#ifdef USE_FAST_HASHERS
+    args.environment["hashers"] = "siphash-1-3";
+#else
+    args.environment["hashers"] = "siphash-2-4";
+#endif
+    args.environment["threads"] = ToString(std::thread::hardware_concurrency());
     std::string error;
     if (!argsman.ParseParameters(argc, argv, error)) {
         tfm::format(std::cerr, "Error parsing command line arguments: %s\n", error);
@@ -91,6 +114,12 @@ int main(int argc, char** argv)
                      "\n"
                      "    NANOBENCH_SUPPRESS_WARNINGS=1 ./bench_bitcoin\n"
                      "\n"
+                     "  The benchmarks of the chain suite run on blocks of a real chain, written by\n"
+                     "  contrib/devtools/gen-bench-fixture.py, that the environment variable\n"
+                     "  BENCH_CHAIN_FIXTURE names. They are skipped without it:\n"
+                     "\n"
+                     "    BENCH_CHAIN_FIXTURE=fixture.dat ./bench_bitcoin -suite=chain\n"
+                     "\n"
                      "Notes:\n"
                      "\n"
                      "  1. pyperf\n"
@@ -106,7 +135,6 @@ int main(int argc, char** argv)
         return EXIT_SUCCESS;
     }
 
-    benchmark::Args args;
     args.asymptote = parseAsymptote(argsman.GetArg("-asymptote", ""));
     args.is_list_only = argsman.GetBoolArg("-list", false);
     args.min_time = std::chrono::milliseconds(argsman.GetIntArg("-min-time", DEFAULT_MIN_TIME_MS));
@@ -114,8 +142,24 @@ int main(int argc, char** argv)
     args.output_json = argsman.GetPathArg("-output-json");
     args.regex_filter = argsman.GetArg("-filter", DEFAULT_BENCH_FILTER);
     args.sanity_check = argsman.GetBoolArg("-sanity-check", false);
+    args.suite = argsman.GetArg("-suite", "");
+    args.compare = argsman.GetPathArg("-compare");
+    args.compare_tolerance = argsman.GetIntArg("-compare-tolerance", DEFAULT_COMPARE_TOLERANCE_PERCENT);
+    if (args.compare_tolerance < 0) {
+        tfm::format(std::cerr, "Error: -compare-tolerance must not be negative\n");
+        return EXIT_FAILURE;
+    }
+    const auto suites{benchmark::Suites()};
+    if (!args.suite.empty() && std::find(suites.begin(), suites.end(), args.suite) == suites.end()) {
+        tfm::format(std::cerr, "Error: unknown -suite=%s, use one of: %s\n", args.suite, Join(suites, ", "));
+        return EXIT_FAILURE;
+    }
 
-    benchmark::BenchRunner::RunAll(args);
+    if (!args.is_list_only) {
+        for (const auto& [key, value] : args.environment) {
+            tfm::format(std::cout, "%s: %s\n", key, value);
+        }
+    }
 
-    return EXIT_SUCCESS;
+    return benchmark::BenchRunner::RunAll(args) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
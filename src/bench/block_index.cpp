@@ -0,0 +1,109 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <chain.h>
+#include <memusage.h>
+#include <node/blockmap.h>
+#include <random.h>
+#include <tinyformat.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+//! Blocks in the synthetic block index, several years of 60-second blocks
+constexpr size_t NUM_BLOCKS{5'000'000};
+//! GetAncestor() walks done on the loaded index
+constexpr size_t NUM_WALKS{100'000};
+
+//! The block index container before node::BlockMap
+using UnorderedBlockMap = std::unordered_map<uint256, CBlockIndex, BlockHasher>;
+
+size_t MapUsage(const UnorderedBlockMap& map) { return memusage::DynamicUsage(map); }
+size_t MapUsage(const node::BlockMap& map) { return map.DynamicMemoryUsage(); }
+
+struct Record {
+    uint256 hash;
+    uint256 prev_hash;
+    int height;
+};
+
+/**
+ * Load the records into a fresh map the way BlockManager::LoadBlockIndex()
+ * does: insert every block and its parent in key order, build the skip
+ * pointers in height order, then walk to random ancestors of the tip.
+ * Returns the memory used by the map.
+ */
+template <typename Map>
+size_t LoadBlockIndex(const std::vector<Record>& records, FastRandomContext& rng)
+{
+    Map map;
+    auto insert = [&map](const uint256& hash) -> CBlockIndex* {
+        if (hash.IsNull()) return nullptr;
+        const auto [it, inserted]{map.try_emplace(hash)};
+        if (inserted) it->second.phashBlock = &it->first;
+        return &it->second;
+    };
+    std::vector<CBlockIndex*> by_height(records.size());
+    for (const Record& record : records) {
+        CBlockIndex* index{insert(record.hash)};
+        index->pprev = insert(record.prev_hash);
+        index->nHeight = record.height;
+        by_height[record.height] = index;
+    }
+    for (CBlockIndex* index : by_height) {
+        index->BuildSkip();
+    }
+
+    const CBlockIndex* tip{by_height.back()};
+    for (size_t i = 0; i < NUM_WALKS; ++i) {
+        const int height{static_cast<int>(rng.randrange(records.size()))};
+        assert(tip->GetAncestor(height) == by_height[height]);
+    }
+    return MapUsage(map);
+}
+
+template <typename Map>
+void BlockIndexLoad(benchmark::Bench& bench, const char* name)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<Record> records(NUM_BLOCKS);
+    uint256 prev_hash;
+    for (size_t height = 0; height < NUM_BLOCKS; ++height) {
+        records[height] = Record{rng.rand256(), prev_hash, static_cast<int>(height)};
+        prev_hash = records[height].hash;
+    }
+    // The block index database is iterated in key order
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) { return a.hash < b.hash; });
+
+    size_t usage{0};
+    bench.epochs(std::min<size_t>(bench.epochs(), 3)).unit("block").batch(NUM_BLOCKS).run([&] {
+        usage = LoadBlockIndex<Map>(records, rng);
+    });
+    if (std::ostream* out{bench.output()}) {
+        *out << strprintf("%s: %u blocks, %u MiB for the block index, %u bytes per block\n",
+                          name, NUM_BLOCKS, usage >> 20, usage / NUM_BLOCKS);
+    }
+}
+} // namespace
+
+static void BlockIndexLoadUnorderedMap(benchmark::Bench& bench)
+{
+    BlockIndexLoad<UnorderedBlockMap>(bench, "BlockIndexLoadUnorderedMap");
+}
+
+static void BlockIndexLoadBlockMap(benchmark::Bench& bench)
+{
+    BlockIndexLoad<node::BlockMap>(bench, "BlockIndexLoadBlockMap");
+}
+
+BENCHMARK(BlockIndexLoadUnorderedMap);
+BENCHMARK(BlockIndexLoadBlockMap);
@@ -0,0 +1,90 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+
+#include <chainparams.h>
+#include <clientversion.h>
+#include <compressor.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <tinyformat.h>
+#include <validation.h>
+
+#include <cassert>
+#include <ostream>
+#include <vector>
+
+static CBlock GetBenchBlock()
+{
+    CBlock block;
+    CDataStream{benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION} >> block;
+    return block;
+}
+
+static void CompressBlock(benchmark::Bench& bench)
+{
+    const CBlock block{GetBenchBlock()};
+    std::vector<uint8_t> data;
+    bench.unit("block").run([&] {
+        data.clear();
+        CVectorWriter{SER_DISK, CLIENT_VERSION, data, 0} << Using<CompressedBlockFormatter>(block);
+    });
+    if (std::ostream* out{bench.output()}) {
+        *out << strprintf("CompressBlock: %u bytes compressed to %u bytes\n", benchmark::data::block413567.size(), data.size());
+    }
+}
+
+static void DecompressBlock(benchmark::Bench& bench)
+{
+    std::vector<uint8_t> data;
+    CVectorWriter{SER_DISK, CLIENT_VERSION, data, 0} << Using<CompressedBlockFormatter>(GetBenchBlock());
+    bench.unit("block").run([&] {
+        CBlock block;
+        SpanReader{SER_DISK, CLIENT_VERSION, data} >> Using<CompressedBlockFormatter>(block);
+        assert(block.vtx.size() > 1);
+    });
+}
+
+/**
+ * Read the block from a block file in the page cache, without the mapping, to
+ * compare the time spent decompressing with the latency of the storage, which
+ * has to be added: the compressed block needs fewer bytes from the device.
+ */
+static void ReadBlockFromDisk(benchmark::Bench& bench, bool compress)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>()};
+    node::BlockManager& blockman{testing_setup->m_node.chainman->m_blockman};
+    const CBlock block{GetBenchBlock()};
+    node::fCompressBlockFiles = compress;
+    node::fBlockFileMmap = false;
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return blockman.SaveBlockToDisk(block, 1, testing_setup->m_node.chainman->ActiveChain(), Params(), nullptr))};
+    assert(!pos.IsNull());
+
+    bench.unit("block").run([&] {
+        CBlock read;
+        const bool ok{node::ReadBlockFromDisk(read, pos, Params().GetConsensus(), /*check_pow=*/false)};
+        assert(ok && read.vtx.size() == block.vtx.size());
+    });
+    node::fCompressBlockFiles = node::DEFAULT_COMPRESS_BLOCK_FILES;
+    node::fBlockFileMmap = node::DEFAULT_BLOCK_FILE_MMAP;
+}
+
+static void ReadBlockFromDiskRegular(benchmark::Bench& bench)
+{
+    ReadBlockFromDisk(bench, /*compress=*/false);
+}
+
+static void ReadBlockFromDiskCompressed(benchmark::Bench& bench)
+{
+    ReadBlockFromDisk(bench, /*compress=*/true);
+}
+
+BENCHMARK(CompressBlock);
+BENCHMARK(DecompressBlock);
+BENCHMARK(ReadBlockFromDiskRegular);
+BENCHMARK(ReadBlockFromDiskCompressed);
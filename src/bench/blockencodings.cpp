@@ -0,0 +1,68 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/script.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+static constexpr size_t BLOCK_TXS{3000};
+
+/**
+ * Reconstruct a compact block of BLOCK_TXS transactions from a mempool of
+ * mempool_size transactions. One transaction of the block is missing from
+ * the mempool, so every mempool transaction is looked at, as happens for any
+ * block that misses one.
+ */
+static void BlockEncodingsInitData(benchmark::Bench& bench, size_t mempool_size)
+{
+    const auto testing_setup = MakeNoLogFileContext<const TestingSetup>();
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    FastRandomContext det_rand{/*fDeterministic=*/true};
+
+    CBlock block;
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].scriptSig = CScript() << OP_1;
+    tx.vout.resize(1);
+    tx.vout[0].scriptPubKey = CScript() << OP_TRUE;
+    tx.vout[0].nValue = 1;
+    block.vtx.push_back(MakeTransactionRef(tx));
+    {
+        LOCK2(cs_main, pool.cs);
+        TestMemPoolEntryHelper entry;
+        for (size_t i = 0; i < mempool_size; ++i) {
+            tx.vin[0].prevout = COutPoint{det_rand.rand256(), 0};
+            const CTransactionRef ref{MakeTransactionRef(tx)};
+            pool.addUnchecked(entry.FromTx(ref));
+            if (i % (mempool_size / (BLOCK_TXS - 1)) == 0 && block.vtx.size() < BLOCK_TXS) block.vtx.push_back(ref);
+        }
+    }
+    tx.vin[0].prevout = COutPoint{det_rand.rand256(), 0};
+    block.vtx.push_back(MakeTransactionRef(tx));
+
+    const CBlockHeaderAndShortTxIDs cmpctblock{block};
+    const std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
+
+    bench.unit("block").run([&] {
+        PartiallyDownloadedBlock partial_block{&pool};
+        const ReadStatus status{partial_block.InitData(cmpctblock, extra_txn)};
+        assert(status == READ_STATUS_OK);
+        assert(!partial_block.IsTxAvailable(block.vtx.size() - 1));
+    });
+}
+
+static void BlockEncodingsInitData50k(benchmark::Bench& bench) { BlockEncodingsInitData(bench, /*mempool_size=*/50000); }
+static void BlockEncodingsInitData300k(benchmark::Bench& bench) { BlockEncodingsInitData(bench, /*mempool_size=*/300000); }
+
+BENCHMARK(BlockEncodingsInitData50k);
+BENCHMARK(BlockEncodingsInitData300k);
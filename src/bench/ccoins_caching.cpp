@@ -4,10 +4,16 @@
 
 #include <bench/bench.h>
 #include <coins.h>
+#include <memusage.h>
 #include <policy/policy.h>
+#include <random.h>
 #include <script/signingprovider.h>
 #include <test/util/transaction_utils.h>
+#include <tinyformat.h>
 
+#include <cassert>
+#include <ostream>
+#include <unordered_map>
 #include <vector>
 
 // Microbenchmark for simple accesses to a CCoinsViewCache database. Note from
@@ -51,4 +57,64 @@ static void CCoinsCaching(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+namespace {
+//! Coins added to and looked up in the map per run
+constexpr size_t NUM_COINS{100'000};
+
+//! The UTXO cache map before CCoinsMap used a PoolAllocator
+using UnpooledCoinsMap = std::unordered_map<COutPoint, CCoinsCacheEntry, SaltedOutpointHasher>;
+
+/**
+ * Fill the map with fresh coins, look all of them up and clear it again, as
+ * the UTXO cache does between flushes. Returns the memory used when full.
+ */
+template <typename Map>
+size_t AddFetchClear(Map& map, const std::vector<COutPoint>& outpoints)
+{
+    for (const COutPoint& outpoint : outpoints) {
+        map.try_emplace(outpoint, Coin{CTxOut{1, CScript{} << OP_TRUE}, 1, false}, CCoinsCacheEntry::DIRTY | CCoinsCacheEntry::FRESH);
+    }
+    for (const COutPoint& outpoint : outpoints) {
+        assert(map.find(outpoint) != map.end());
+    }
+    const size_t usage{memusage::DynamicUsage(map)};
+    map.clear();
+    return usage;
+}
+
+template <typename Map>
+void CoinsMapAddFetch(benchmark::Bench& bench, Map& map, const char* name)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<COutPoint> outpoints;
+    outpoints.reserve(NUM_COINS);
+    for (size_t i = 0; i < NUM_COINS; ++i) {
+        outpoints.emplace_back(rng.rand256(), rng.randrange(4));
+    }
+
+    size_t usage{0};
+    bench.unit("coin").batch(NUM_COINS).run([&] {
+        usage = AddFetchClear(map, outpoints);
+    });
+    if (std::ostream* out{bench.output()}) {
+        *out << strprintf("%s: %u coins, %u bytes per coin\n", name, NUM_COINS, usage / NUM_COINS);
+    }
+}
+} // namespace
+
+static void CCoinsMapAddFetchUnpooled(benchmark::Bench& bench)
+{
+    UnpooledCoinsMap map;
+    CoinsMapAddFetch(bench, map, "CCoinsMapAddFetchUnpooled");
+}
+
+static void CCoinsMapAddFetchPooled(benchmark::Bench& bench)
+{
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, SaltedOutpointHasher{}, CCoinsMap::key_equal{}, &resource};
+    CoinsMapAddFetch(bench, map, "CCoinsMapAddFetchPooled");
+}
+
 BENCHMARK(CCoinsCaching);
+BENCHMARK(CCoinsMapAddFetchUnpooled);
+BENCHMARK(CCoinsMapAddFetchPooled);
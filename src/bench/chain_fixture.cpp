@@ -0,0 +1,254 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <blockfilter.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <consensus/validation.h>
+#include <fs.h>
+#include <kernel/validation_cache_sizes.h>
+#include <powcache.h>
+#include <primitives/block.h>
+#include <script/sigcache.h>
+#include <serialize.h>
+#include <streams.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <undo.h>
+#include <util/check.h>
+#include <validation.h>
+#include <version.h>
+
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+/**
+ * Benchmarks of a window of blocks of a real chain, as written by
+ * contrib/devtools/gen-bench-fixture.py, so that they measure the
+ * transactions and headers of this chain rather than those of
+ * bench/data/block413567.raw. The file is given with the environment
+ * variable BENCH_CHAIN_FIXTURE; without it the benchmarks are skipped.
+ */
+
+static const char* const FIXTURE_ENV{"BENCH_CHAIN_FIXTURE"};
+static constexpr std::array<uint8_t, 4> FIXTURE_MAGIC{'B', 'F', 'I', 'X'};
+static constexpr uint32_t FIXTURE_VERSION{1};
+//! Size of the script execution and signature caches while connecting the blocks
+static constexpr size_t FIXTURE_CACHE_BYTES{1 << 20};
+
+struct ChainFixture {
+    //! Network of the blocks, as named by CBaseChainParams
+    std::string chain;
+    //! The headers that precede the blocks, starting at first_height
+    int32_t first_height;
+    std::vector<CBlockHeader> headers;
+    std::vector<CBlock> blocks;
+    std::vector<CBlockUndo> undos;
+
+    //! Index entries of the headers and then the blocks, each one pointing to the one before
+    std::deque<uint256> hashes;
+    std::deque<CBlockIndex> index;
+
+    CBlockIndex& BlockIndex(size_t block) { return index[headers.size() + block]; }
+
+    /**
+     * Build the index entries. Nothing is known below first_height, which
+     * the fixture starts low enough for the median time past of the blocks
+     * and of the coins their time-based relative lock-times refer to.
+     */
+    void BuildIndex()
+    {
+        auto add = [&](const CBlockHeader& header) {
+            CBlockIndex* prev{index.empty() ? nullptr : &index.back()};
+            CBlockIndex& entry{index.emplace_back(header)};
+            entry.phashBlock = &hashes.emplace_back(header.GetHash());
+            entry.pprev = prev;
+            entry.nHeight = first_height + static_cast<int>(index.size()) - 1;
+        };
+        for (const CBlockHeader& header : headers) add(header);
+        for (const CBlock& block : blocks) add(block);
+    }
+};
+
+/** Load the fixture that BENCH_CHAIN_FIXTURE names, or return std::nullopt if it is not set or cannot be read. */
+static std::optional<ChainFixture> LoadChainFixture()
+{
+    const char* path{std::getenv(FIXTURE_ENV)};
+    if (path == nullptr || *path == '\0') {
+        std::cerr << "Skipped, set " << FIXTURE_ENV << " to a file of contrib/devtools/gen-bench-fixture.py to run it." << std::endl;
+        return std::nullopt;
+    }
+    CAutoFile file{fsbridge::fopen(fs::PathFromString(path), "rb"), SER_DISK, CLIENT_VERSION};
+    if (file.IsNull()) {
+        std::cerr << "Could not open the chain fixture " << path << std::endl;
+        return std::nullopt;
+    }
+    ChainFixture fixture;
+    try {
+        std::array<uint8_t, 4> magic;
+        uint32_t version;
+        file.read(MakeWritableByteSpan(magic));
+        file >> version;
+        if (magic != FIXTURE_MAGIC || version != FIXTURE_VERSION) {
+            std::cerr << "The chain fixture " << path << " is not a file of version " << FIXTURE_VERSION << std::endl;
+            return std::nullopt;
+        }
+        file >> fixture.chain >> fixture.first_height >> fixture.headers;
+        const uint64_t num_blocks{ReadCompactSize(file)};
+        for (uint64_t i = 0; i < num_blocks; ++i) {
+            file >> fixture.blocks.emplace_back() >> fixture.undos.emplace_back();
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Could not read the chain fixture " << path << ": " << e.what() << std::endl;
+        return std::nullopt;
+    }
+    if (fixture.headers.empty() || fixture.blocks.empty()) {
+        std::cerr << "The chain fixture " << path << " has no blocks" << std::endl;
+        return std::nullopt;
+    }
+    return fixture;
+}
+
+/**
+ * Connect each block of the fixture to a view of the coins it spends. The
+ * script execution and signature caches are emptied before every round, as
+ * ConnectBlock fills them when it only checks a block, so that the scripts
+ * are verified as they are for new blocks of the chain. The merkle root is
+ * checked as when a block is accepted, its proof of work is not.
+ */
+static void ChainFixtureConnectBlock(benchmark::Bench& bench)
+{
+    auto fixture{LoadChainFixture()};
+    if (!fixture) return;
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(fixture->chain)};
+    Chainstate& chainstate{testing_setup->m_node.chainman->ActiveChainstate()};
+    const Consensus::Params& consensus{Params().GetConsensus()};
+    fixture->BuildIndex();
+
+    CCoinsView empty;
+    std::vector<std::unique_ptr<CCoinsViewCache>> spent_coins;
+    for (size_t i = 0; i < fixture->blocks.size(); ++i) {
+        const CBlock& block{fixture->blocks[i]};
+        const CBlockUndo& undo{fixture->undos[i]};
+        assert(undo.vtxundo.size() + 1 == block.vtx.size());
+        CCoinsViewCache& view{*spent_coins.emplace_back(std::make_unique<CCoinsViewCache>(&empty))};
+        for (size_t tx = 1; tx < block.vtx.size(); ++tx) {
+            const auto& vin{block.vtx[tx]->vin};
+            assert(undo.vtxundo[tx - 1].vprevout.size() == vin.size());
+            for (size_t input = 0; input < vin.size(); ++input) {
+                view.AddCoin(vin[input].prevout, Coin{undo.vtxundo[tx - 1].vprevout[input]}, /*possible_overwrite=*/false);
+            }
+        }
+        view.SetBestBlock(block.hashPrevBlock);
+    }
+
+    bench.unit("block").batch(fixture->blocks.size()).run([&] {
+        Assert(InitSignatureCache(FIXTURE_CACHE_BYTES));
+        Assert(InitScriptExecutionCache(FIXTURE_CACHE_BYTES));
+        LOCK(cs_main);
+        for (size_t i = 0; i < fixture->blocks.size(); ++i) {
+            const CBlock& block{fixture->blocks[i]};
+            BlockValidationState state;
+            bool checked{CheckBlock(block, state, consensus, /*fCheckPOW=*/false, /*fCheckMerkleRoot=*/true)};
+            assert(checked);
+            CCoinsViewCache view{spent_coins[i].get()};
+            bool connected{chainstate.ConnectBlock(block, state, &fixture->BlockIndex(i), view, /*fJustCheck=*/true)};
+            assert(connected);
+        }
+    });
+
+    const kernel::ValidationCacheSizes cache_sizes;
+    Assert(InitSignatureCache(cache_sizes.signature_cache_bytes));
+    Assert(InitScriptExecutionCache(cache_sizes.script_execution_cache_bytes));
+}
+
+/** Check the NeoScrypt proof of work of the headers of the fixture, as a headers message of them would be. */
+static void ChainFixtureHasValidProofOfWork(benchmark::Bench& bench)
+{
+    auto fixture{LoadChainFixture()};
+    if (!fixture) return;
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(fixture->chain)};
+    const Consensus::Params& consensus{Params().GetConsensus()};
+    Assert(InitPoWHashCache(0));
+
+    std::vector<CBlockHeader> headers{fixture->headers};
+    headers.insert(headers.end(), fixture->blocks.begin(), fixture->blocks.end());
+    bench.unit("header").batch(headers.size()).run([&] {
+        bool valid{HasValidProofOfWork(headers, consensus)};
+        assert(valid);
+    });
+
+    Assert(InitPoWHashCache(DEFAULT_MAX_POW_CACHE_BYTES));
+}
+
+/**
+ * Reconstruct each block of the fixture from a compact block and a mempool
+ * holding the transactions of all of them, as a node does that relayed the
+ * transactions before the blocks came.
+ */
+static void ChainFixtureCmpctBlockReconstruct(benchmark::Bench& bench)
+{
+    auto fixture{LoadChainFixture()};
+    if (!fixture) return;
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(fixture->chain)};
+    CTxMemPool& pool{*Assert(testing_setup->m_node.mempool)};
+
+    std::vector<CBlockHeaderAndShortTxIDs> cmpctblocks;
+    {
+        LOCK2(cs_main, pool.cs);
+        TestMemPoolEntryHelper entry;
+        for (const CBlock& block : fixture->blocks) {
+            for (size_t tx = 1; tx < block.vtx.size(); ++tx) {
+                pool.addUnchecked(entry.FromTx(block.vtx[tx]));
+            }
+            cmpctblocks.emplace_back(block);
+        }
+    }
+    const std::vector<std::pair<uint256, CTransactionRef>> extra_txn;
+
+    bench.unit("block").batch(cmpctblocks.size()).run([&] {
+        for (const CBlockHeaderAndShortTxIDs& cmpctblock : cmpctblocks) {
+            PartiallyDownloadedBlock partial_block{&pool};
+            ReadStatus status{partial_block.InitData(cmpctblock, extra_txn)};
+            assert(status == READ_STATUS_OK);
+            CBlock block;
+            status = partial_block.FillBlock(block, {});
+            assert(status == READ_STATUS_OK);
+        }
+    });
+}
+
+/** Build the basic filters of the blocks of the fixture and their header chain, as the block filter index does. */
+static void ChainFixtureBlockFilter(benchmark::Bench& bench)
+{
+    auto fixture{LoadChainFixture()};
+    if (!fixture) return;
+
+    bench.unit("block").batch(fixture->blocks.size()).run([&] {
+        uint256 header{};
+        for (size_t i = 0; i < fixture->blocks.size(); ++i) {
+            const BlockFilter filter{BlockFilterType::BASIC, fixture->blocks[i], fixture->undos[i]};
+            header = filter.ComputeHeader(header);
+        }
+        ankerl::nanobench::doNotOptimizeAway(header);
+    });
+}
+
+BENCHMARK(ChainFixtureConnectBlock);
+BENCHMARK(ChainFixtureHasValidProofOfWork);
+BENCHMARK(ChainFixtureCmpctBlockReconstruct);
+BENCHMARK(ChainFixtureBlockFilter);
@@ -20,11 +20,8 @@ static const unsigned int QUEUE_BATCH_SIZE = 128;
 // This Benchmark tests the CheckQueue with a slightly realistic workload,
 // where checks all contain a prevector that is indirect 50% of the time
 // and there is a little bit of work done between calls to Add.
-static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+static void RunPrevectorJobs(benchmark::Bench& bench, int worker_threads)
 {
-    // We shouldn't ever be running with the checkqueue on a single core machine.
-    if (GetNumCores() <= 1) return;
-
     const ECCVerifyHandle verify_handle;
     ECC_Start();
 
@@ -44,9 +41,7 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
         };
     };
     CCheckQueue<PrevectorJob> queue {QUEUE_BATCH_SIZE};
-    // The main thread should be counted to prevent thread oversubscription, and
-    // to decrease the variance of benchmark results.
-    queue.StartWorkerThreads(GetNumCores() - 1);
+    queue.StartWorkerThreads(worker_threads);
 
     // create all the data once, then submit copies in the benchmark.
     FastRandomContext insecure_rand(true);
@@ -70,4 +65,30 @@ static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
     queue.StopWorkerThreads();
     ECC_Stop();
 }
+
+static void CCheckQueueSpeedPrevectorJob(benchmark::Bench& bench)
+{
+    // We shouldn't ever be running with the checkqueue on a single core machine.
+    if (GetNumCores() <= 1) return;
+
+    // The main thread should be counted to prevent thread oversubscription, and
+    // to decrease the variance of benchmark results.
+    RunPrevectorJobs(bench, GetNumCores() - 1);
+}
+
+// The same workload with a fixed number of worker threads, to show how the
+// queue scales, including past the number of cores.
+static void CCheckQueuePrevectorJob_1(benchmark::Bench& bench) { RunPrevectorJobs(bench, 1); }
+static void CCheckQueuePrevectorJob_2(benchmark::Bench& bench) { RunPrevectorJobs(bench, 2); }
+static void CCheckQueuePrevectorJob_4(benchmark::Bench& bench) { RunPrevectorJobs(bench, 4); }
+static void CCheckQueuePrevectorJob_8(benchmark::Bench& bench) { RunPrevectorJobs(bench, 8); }
+static void CCheckQueuePrevectorJob_16(benchmark::Bench& bench) { RunPrevectorJobs(bench, 16); }
+static void CCheckQueuePrevectorJob_32(benchmark::Bench& bench) { RunPrevectorJobs(bench, 32); }
+
 BENCHMARK(CCheckQueueSpeedPrevectorJob);
+BENCHMARK(CCheckQueuePrevectorJob_1);
+BENCHMARK(CCheckQueuePrevectorJob_2);
+BENCHMARK(CCheckQueuePrevectorJob_4);
+BENCHMARK(CCheckQueuePrevectorJob_8);
+BENCHMARK(CCheckQueuePrevectorJob_16);
+BENCHMARK(CCheckQueuePrevectorJob_32);
@@ -83,6 +83,46 @@ static void CoinSelection(benchmark::Bench& bench)
     });
 }
 
+// Coin selection from the pool of a wallet with many UTXOs of different amounts, where Branch
+// and Bound runs concurrently with the knapsack solver.
+static void CoinSelectionLargePool(benchmark::Bench& bench)
+{
+    NodeContext node;
+    auto chain = interfaces::MakeChain(node);
+    CWallet wallet(chain.get(), "", gArgs, CreateDummyWalletDatabase());
+    std::vector<std::unique_ptr<CWalletTx>> wtxs;
+    LOCK(wallet.cs_wallet);
+
+    for (int i = 0; i < 20000; ++i) {
+        addCoin((i % 997 + 1) * COIN / 100 + i, wallet, wtxs);
+    }
+
+    wallet::CoinsResult available_coins;
+    for (const auto& wtx : wtxs) {
+        const auto txout = wtx->tx->vout.at(0);
+        available_coins.coins[OutputType::BECH32].emplace_back(COutPoint(wtx->GetHash(), 0), txout, /*depth=*/6 * 24, CalculateMaximumSignedInputSize(txout, &wallet, /*coin_control=*/nullptr), /*spendable=*/true, /*solvable=*/true, /*safe=*/true, wtx->GetTxTime(), /*from_me=*/true, /*fees=*/ 0);
+    }
+
+    const CoinEligibilityFilter filter_standard(1, 6, 0);
+    FastRandomContext rand{};
+    const CoinSelectionParams coin_selection_params{
+        rand,
+        /*change_output_size=*/ 34,
+        /*change_spend_size=*/ 148,
+        /*min_change_target=*/ CHANGE_LOWER,
+        /*effective_feerate=*/ CFeeRate(1000),
+        /*long_term_feerate=*/ CFeeRate(1000),
+        /*discard_feerate=*/ CFeeRate(1000),
+        /*tx_noinputs_size=*/ 10,
+        /*avoid_partial=*/ false,
+    };
+    bench.run([&] {
+        auto result = AttemptSelection(wallet, 123 * COIN, filter_standard, available_coins, coin_selection_params, /*allow_mixed_output_types=*/true);
+        assert(result);
+        assert(result->GetSelectedValue() >= 123 * COIN);
+    });
+}
+
 // Copied from src/wallet/test/coinselector_tests.cpp
 static void add_coin(const CAmount& nValue, int nInput, std::vector<OutputGroup>& set)
 {
@@ -121,5 +161,20 @@ static void BnBExhaustion(benchmark::Bench& bench)
     });
 }
 
+static void BnBLargePool(benchmark::Bench& bench)
+{
+    // Many UTXOs close to each other in value, no exact match for the target
+    std::vector<OutputGroup> utxo_pool;
+    for (int i = 0; i < 20000; ++i) {
+        add_coin(10 * COIN + 7 * (i % 4999), i % 8, utxo_pool);
+    }
+
+    bench.run([&] {
+        SelectCoinsBnB(utxo_pool, 35 * COIN + 3, 1, SteadyClock::now() + wallet::BNB_MAX_SEARCH_TIME);
+    });
+}
+
 BENCHMARK(CoinSelection);
+BENCHMARK(CoinSelectionLargePool);
 BENCHMARK(BnBExhaustion);
+BENCHMARK(BnBLargePool);
@@ -0,0 +1,91 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <coins.h>
+#include <key.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+
+#include <cassert>
+#include <vector>
+
+static constexpr size_t NUM_COINS{1000};
+
+/** Coins with the usual mix of output types, to measure the compression of their scripts along with the database. */
+static std::vector<std::pair<COutPoint, Coin>> CreateCoins()
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    CKey key;
+    key.MakeNewKey(true);
+    const CPubKey pubkey{key.GetPubKey()};
+    const std::vector<CScript> scripts{GetScriptForDestination(PKHash(pubkey)),
+                                       GetScriptForDestination(WitnessV0KeyHash(pubkey)),
+                                       GetScriptForDestination(WitnessV1Taproot(XOnlyPubKey(pubkey))),
+                                       GetScriptForDestination(ScriptHash(CScript() << OP_TRUE))};
+    std::vector<std::pair<COutPoint, Coin>> coins;
+    for (size_t i = 0; i < NUM_COINS; ++i) {
+        const CTxOut txout{static_cast<CAmount>(rng.randrange(50 * COIN)), scripts[i % scripts.size()]};
+        coins.emplace_back(COutPoint{rng.rand256(), static_cast<uint32_t>(rng.randrange(4))}, Coin{txout, static_cast<int>(rng.randrange(700000)), false});
+    }
+    return coins;
+}
+
+static void CoinsDBWrite(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const BasicTestingSetup>()};
+    CCoinsViewDB db{"coinsdb_bench", /*nCacheSize=*/8 << 20, /*fMemory=*/true, /*fWipe=*/true};
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+    for (auto& [outpoint, coin] : CreateCoins()) {
+        map.emplace(outpoint, CCoinsCacheEntry{std::move(coin), CCoinsCacheEntry::DIRTY});
+    }
+    const uint256 best_block{uint256::ONE};
+
+    bench.batch(NUM_COINS).unit("coin").run([&] {
+        const bool ok{db.BatchWrite(map, best_block, /*erase=*/false)};
+        assert(ok);
+    });
+}
+
+static void CoinsDBRead(benchmark::Bench& bench, bool many)
+{
+    const auto testing_setup{MakeNoLogFileContext<const BasicTestingSetup>()};
+    CCoinsViewDB db{"coinsdb_bench", /*nCacheSize=*/8 << 20, /*fMemory=*/true, /*fWipe=*/true};
+    const std::vector<std::pair<COutPoint, Coin>> coins{CreateCoins()};
+    std::vector<COutPoint> outpoints;
+    {
+        CCoinsMapMemoryResource resource;
+        CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
+        for (const auto& [outpoint, coin] : coins) {
+            map.emplace(outpoint, CCoinsCacheEntry{Coin{coin}, CCoinsCacheEntry::DIRTY});
+            outpoints.push_back(outpoint);
+        }
+        const bool ok{db.BatchWrite(map, uint256::ONE)};
+        assert(ok);
+    }
+
+    std::vector<Coin> read(outpoints.size());
+    bench.batch(NUM_COINS).unit("coin").run([&] {
+        if (many) {
+            db.GetCoins(outpoints, read);
+        } else {
+            for (size_t i = 0; i < outpoints.size(); ++i) {
+                const bool found{db.GetCoin(outpoints[i], read[i])};
+                assert(found);
+            }
+        }
+        assert(read.back().out == coins.back().second.out);
+    });
+}
+
+static void CoinsDBGetCoin(benchmark::Bench& bench) { CoinsDBRead(bench, /*many=*/false); }
+static void CoinsDBGetCoins(benchmark::Bench& bench) { CoinsDBRead(bench, /*many=*/true); }
+
+BENCHMARK(CoinsDBWrite);
+BENCHMARK(CoinsDBGetCoin);
+BENCHMARK(CoinsDBGetCoins);
@@ -72,6 +72,23 @@ static void SHA256D64_1024(benchmark::Bench& bench)
     });
 }
 
+static void SHA256DMany_1000(benchmark::Bench& bench)
+{
+    // Messages of the size of typical transactions
+    std::vector<std::vector<uint8_t>> msgs;
+    std::vector<const uint8_t*> inputs;
+    std::vector<size_t> lengths;
+    for (size_t i = 0; i < 1000; ++i) {
+        msgs.emplace_back(150 + (i * 37) % 400, 0);
+        inputs.push_back(msgs.back().data());
+        lengths.push_back(msgs.back().size());
+    }
+    std::vector<uint8_t> out(32 * msgs.size());
+    bench.batch(msgs.size()).unit("message").run([&] {
+        SHA256DMany(out.data(), inputs.data(), lengths.data(), msgs.size());
+    });
+}
+
 static void SHA512(benchmark::Bench& bench)
 {
     uint8_t hash[CSHA512::OUTPUT_SIZE];
@@ -81,6 +98,14 @@ static void SHA512(benchmark::Bench& bench)
     });
 }
 
+static void SHA512Iterate64_1000(benchmark::Bench& bench)
+{
+    uint8_t hash[CSHA512::OUTPUT_SIZE] = {0};
+    bench.batch(1000).unit("hash").run([&] {
+        SHA512Iterate64(hash, 1000);
+    });
+}
+
 static void SipHash_32b(benchmark::Bench& bench)
 {
     uint256 x;
@@ -106,6 +131,13 @@ static void FastRandom_1bit(benchmark::Bench& bench)
     });
 }
 
+static void GetRand_64bit(benchmark::Bench& bench)
+{
+    bench.run([&] {
+        GetRand<uint64_t>();
+    });
+}
+
 static void MuHash(benchmark::Bench& bench)
 {
     MuHash3072 acc;
@@ -154,13 +186,16 @@ BENCHMARK(RIPEMD160);
 BENCHMARK(SHA1);
 BENCHMARK(SHA256);
 BENCHMARK(SHA512);
+BENCHMARK(SHA512Iterate64_1000);
 BENCHMARK(SHA3_256_1M);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
 BENCHMARK(SHA256D64_1024);
+BENCHMARK(SHA256DMany_1000);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
+BENCHMARK(GetRand_64bit);
 
 BENCHMARK(MuHash);
 BENCHMARK(MuHashMul);
@@ -27,4 +27,20 @@ static void ExpandDescriptor(benchmark::Bench& bench)
     });
 }
 
+static void ExpandDescriptorRange(benchmark::Bench& bench)
+{
+    const auto desc_str = "wpkh(xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y/0/*)";
+    FlatSigningProvider provider;
+    std::string error;
+    auto desc = Parse(desc_str, provider, error);
+
+    bench.run([&] {
+        DescriptorCache cache;
+        std::vector<std::vector<CScript>> scripts;
+        bool success = ExpandRange(*desc, 0, 1000, provider, cache, scripts, /*num_threads=*/1);
+        assert(success);
+    });
+}
+
 BENCHMARK(ExpandDescriptor);
+BENCHMARK(ExpandDescriptorRange);
@@ -71,6 +71,45 @@ static void GCSFilterDecodeSkipCheck(benchmark::Bench& bench)
     });
 }
 
+static void GCSFilterConstructBlock(benchmark::Bench& bench)
+{
+    // About the number of elements of the filter of a full block
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 5000; ++i) {
+        GCSFilter::Element element(25);
+        element[0] = static_cast<unsigned char>(i);
+        element[1] = static_cast<unsigned char>(i >> 8);
+        elements.insert(std::move(element));
+    }
+
+    uint64_t siphash_k0 = 0;
+    bench.run([&] {
+        GCSFilter filter({siphash_k0, 0, BASIC_FILTER_P, BASIC_FILTER_M}, elements);
+
+        siphash_k0++;
+    });
+}
+
+static void GCSFilterMatchAny(benchmark::Bench& bench)
+{
+    auto elements = GenerateGCSTestElements();
+
+    GCSFilter filter({0, 0, BASIC_FILTER_P, BASIC_FILTER_M}, elements);
+
+    // A wallet rescan matches the scripts of all its keys against each filter
+    GCSFilter::ElementSet queries;
+    for (int i = 0; i < 1000; ++i) {
+        GCSFilter::Element element(32);
+        element[2] = static_cast<unsigned char>(i);
+        element[3] = static_cast<unsigned char>(i >> 8);
+        queries.insert(std::move(element));
+    }
+
+    bench.run([&] {
+        filter.MatchAny(queries);
+    });
+}
+
 static void GCSFilterMatch(benchmark::Bench& bench)
 {
     auto elements = GenerateGCSTestElements();
@@ -83,6 +122,8 @@ static void GCSFilterMatch(benchmark::Bench& bench)
 }
 BENCHMARK(GCSBlockFilterGetHash);
 BENCHMARK(GCSFilterConstruct);
+BENCHMARK(GCSFilterConstructBlock);
 BENCHMARK(GCSFilterDecode);
 BENCHMARK(GCSFilterDecodeSkipCheck);
 BENCHMARK(GCSFilterMatch);
+BENCHMARK(GCSFilterMatchAny);
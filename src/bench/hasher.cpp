@@ -0,0 +1,81 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <crypto/siphash.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+//! Coins in the map, about those of a small dbcache
+static constexpr size_t MAP_COINS{100000};
+
+static void HasherSipHash24Txid(benchmark::Bench& bench)
+{
+    uint256 x;
+    uint64_t k1{0};
+    bench.run([&] {
+        *((uint64_t*)x.begin()) = SipHashUint256(0, ++k1, x);
+    });
+}
+
+static void HasherSipHash13Txid(benchmark::Bench& bench)
+{
+    uint256 x;
+    uint64_t k1{0};
+    bench.run([&] {
+        *((uint64_t*)x.begin()) = SipHash13Uint256(0, ++k1, x);
+    });
+}
+
+static void HasherSipHash24Outpoint(benchmark::Bench& bench)
+{
+    uint256 x;
+    uint64_t k1{0};
+    bench.run([&] {
+        *((uint64_t*)x.begin()) = SipHashUint256Extra(0, ++k1, x, 1);
+    });
+}
+
+static void HasherSipHash13Outpoint(benchmark::Bench& bench)
+{
+    uint256 x;
+    uint64_t k1{0};
+    bench.run([&] {
+        *((uint64_t*)x.begin()) = SipHash13Uint256Extra(0, ++k1, x, 1);
+    });
+}
+
+/** Look up the coins of a map keyed with SaltedOutpointHasher, as configured, half of which it has. */
+static void HasherOutpointMapLookup(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::unordered_map<COutPoint, uint32_t, SaltedOutpointHasher> map;
+    std::vector<COutPoint> outpoints;
+    for (size_t i = 0; i < MAP_COINS; ++i) {
+        const COutPoint outpoint{rng.rand256(), static_cast<uint32_t>(rng.randrange(4))};
+        if (i % 2 == 0) map.emplace(outpoint, i);
+        outpoints.push_back(outpoint);
+    }
+    size_t i{0};
+    size_t found{0};
+    bench.run([&] {
+        found += map.count(outpoints[i]);
+        if (++i == outpoints.size()) i = 0;
+    });
+    assert(found > 0);
+}
+
+BENCHMARK(HasherSipHash24Txid);
+BENCHMARK(HasherSipHash13Txid);
+BENCHMARK(HasherSipHash24Outpoint);
+BENCHMARK(HasherSipHash13Outpoint);
+BENCHMARK(HasherOutpointMapLookup);
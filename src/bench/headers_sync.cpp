@@ -0,0 +1,94 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <headerssync.h>
+#include <pow.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <tinyformat.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <cassert>
+#include <ostream>
+#include <vector>
+
+namespace {
+//! Headers per message, as in net_processing
+constexpr size_t HEADERS_PER_MESSAGE{2000};
+
+/**
+ * Run both phases of a headers sync of the given chain against a fresh
+ * HeadersSyncState, the way net_processing feeds it, and return the largest
+ * amount of memory the state used for commitments and buffered headers.
+ */
+size_t SimulateHeadersSync(const CChainParams& chain_params, const CBlockIndex* chain_start,
+                           const std::vector<CBlockHeader>& headers)
+{
+    HeadersSyncState sync{/*id=*/0, chain_params.GetConsensus(), chain_params.HeadersSync(), chain_start,
+                          /*minimum_required_work=*/GetBlockProof(CBlockIndex{headers.front()}) * arith_uint256{headers.size()}};
+    size_t peak_memory{0};
+    size_t accepted{0};
+    for (int phase = 0; phase < 2; ++phase) {
+        for (size_t begin = 0; begin < headers.size(); begin += HEADERS_PER_MESSAGE) {
+            const size_t end{std::min(headers.size(), begin + HEADERS_PER_MESSAGE)};
+            const auto result{sync.ProcessNextHeaders({headers.begin() + begin, headers.begin() + end},
+                                                      /*full_headers_message=*/end - begin == HEADERS_PER_MESSAGE)};
+            assert(result.success);
+            accepted += result.pow_validated_headers.size();
+            peak_memory = std::max(peak_memory, sync.GetMemoryUsage());
+        }
+    }
+    assert(accepted == headers.size());
+    return peak_memory;
+}
+
+void HeadersSyncSimulation(benchmark::Bench& bench, size_t chain_length)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::REGTEST)};
+    const CChainParams& chain_params{Params()};
+    const CBlockIndex* chain_start{WITH_LOCK(::cs_main, return testing_setup->m_node.chainman->ActiveChain().Genesis())};
+
+    // Regtest allows minimum difficulty blocks, whose proof of work is not
+    // checked by HeadersSyncState, so the chain needs no mining.
+    std::vector<CBlockHeader> headers(chain_length);
+    uint256 prev_hash{chain_start->GetBlockHash()};
+    uint32_t time{chain_start->nTime};
+    for (CBlockHeader& header : headers) {
+        header.nVersion = 4;
+        header.hashPrevBlock = prev_hash;
+        header.nTime = time += chain_params.GetConsensus().nPowTargetSpacing;
+        header.nBits = UintToArith256(chain_params.GetConsensus().powLimit).GetCompact();
+        prev_hash = header.GetHash();
+    }
+
+    const size_t peak_memory{SimulateHeadersSync(chain_params, chain_start, headers)};
+    bench.batch(chain_length).unit("header").run([&] {
+        SimulateHeadersSync(chain_params, chain_start, headers);
+    });
+    if (std::ostream* out{bench.output()}) {
+        *out << strprintf("HeadersSync_%u: commitment period %u, redownload buffer %u headers, peak memory per peer %u bytes\n",
+                          chain_length, chain_params.HeadersSync().commitment_period,
+                          chain_params.HeadersSync().redownload_buffer_size, peak_memory);
+    }
+}
+} // namespace
+
+static void HeadersSync_10000(benchmark::Bench& bench)
+{
+    HeadersSyncSimulation(bench, 10000);
+}
+
+static void HeadersSync_100000(benchmark::Bench& bench)
+{
+    HeadersSyncSimulation(bench, 100000);
+}
+
+BENCHMARK(HeadersSync_10000);
+BENCHMARK(HeadersSync_100000);
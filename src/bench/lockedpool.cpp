@@ -6,11 +6,18 @@
 
 #include <support/lockedpool.h>
 
+#include <array>
+#include <thread>
 #include <vector>
 
 #define ASIZE 2048
 #define MSIZE 2048
 
+static constexpr int POOL_THREADS{8};
+static constexpr size_t POOL_ALLOCS_PER_THREAD{1024};
+//! The size of a private key, as CKey allocates it
+static constexpr size_t KEY_SIZE{32};
+
 static void BenchLockedPool(benchmark::Bench& bench)
 {
     void *synth_base = reinterpret_cast<void*>(0x08000000);
@@ -39,4 +46,37 @@ static void BenchLockedPool(benchmark::Bench& bench)
     addr.clear();
 }
 
+/**
+ * Threads allocating and freeing key sized chunks of the pool at once, a few
+ * at a time, as threads signing for their wallets do. Either with the caches
+ * of the threads, or from the pool each time.
+ */
+static void LockedPoolThreads(benchmark::Bench& bench, bool thread_cache)
+{
+    LockedPoolManager& pool{LockedPoolManager::Instance()};
+    LockedPool& shared{pool};
+    bench.batch(POOL_THREADS * POOL_ALLOCS_PER_THREAD).unit("alloc").run([&] {
+        std::vector<std::thread> threads;
+        for (int t = 0; t < POOL_THREADS; ++t) {
+            threads.emplace_back([&] {
+                std::array<void*, 8> chunks;
+                for (size_t i = 0; i < POOL_ALLOCS_PER_THREAD; i += chunks.size()) {
+                    for (void*& chunk : chunks) {
+                        chunk = thread_cache ? pool.alloc(KEY_SIZE) : shared.alloc(KEY_SIZE);
+                    }
+                    for (void* chunk : chunks) {
+                        thread_cache ? pool.free(chunk, KEY_SIZE) : shared.free(chunk);
+                    }
+                }
+            });
+        }
+        for (std::thread& thread : threads) thread.join();
+    });
+}
+
+static void LockedPoolThreadsShared(benchmark::Bench& bench) { LockedPoolThreads(bench, /*thread_cache=*/false); }
+static void LockedPoolThreadsCached(benchmark::Bench& bench) { LockedPoolThreads(bench, /*thread_cache=*/true); }
+
 BENCHMARK(BenchLockedPool);
+BENCHMARK(LockedPoolThreadsShared);
+BENCHMARK(LockedPoolThreadsCached);
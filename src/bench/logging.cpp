@@ -40,9 +40,20 @@ static void LoggingNoFile(benchmark::Bench& bench)
         LogPrint(BCLog::NET, "%s\n", "test");
     });
 }
+// The cost on the logging thread with the writer thread, which drops what it can not keep up with
+static void LoggingAsyncYoThreadNames(benchmark::Bench& bench)
+{
+    Logging(bench, {"-logthreadnames=1", "-logasync"}, [] { LogPrintf("%s\n", "test"); });
+}
+static void LoggingAsyncYoCategory(benchmark::Bench& bench)
+{
+    Logging(bench, {"-logthreadnames=0", "-debug=net", "-logasync"}, [] { LogPrint(BCLog::NET, "%s\n", "test"); });
+}
 
 BENCHMARK(LoggingYoThreadNames);
 BENCHMARK(LoggingNoThreadNames);
 BENCHMARK(LoggingYoCategory);
 BENCHMARK(LoggingNoCategory);
 BENCHMARK(LoggingNoFile);
+BENCHMARK(LoggingAsyncYoThreadNames);
+BENCHMARK(LoggingAsyncYoCategory);
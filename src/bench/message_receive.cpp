@@ -0,0 +1,78 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+
+#include <chainparams.h>
+#include <hash.h>
+#include <net.h>
+#include <primitives/block.h>
+#include <protocol.h>
+#include <streams.h>
+#include <util/system.h>
+#include <version.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <vector>
+
+/** Append a message with the header of the network to a recorded stream. */
+template <typename... Args>
+static void RecordMessage(const CChainParams& chain_params, std::vector<unsigned char>& stream, const char* type, const Args&... args)
+{
+    std::vector<unsigned char> payload;
+    CVectorWriter{SER_NETWORK, PROTOCOL_VERSION, payload, 0, args...};
+    CMessageHeader hdr{chain_params.MessageStart(), type, static_cast<unsigned int>(payload.size())};
+    const uint256 hash{Hash(payload)};
+    std::memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
+    CVectorWriter{SER_NETWORK, PROTOCOL_VERSION, stream, stream.size(), hdr};
+    stream.insert(stream.end(), payload.begin(), payload.end());
+}
+
+/** Feed the messages a peer relays with a block through the deserializer, in socket sized reads. */
+static void MessageReceive(benchmark::Bench& bench, bool use_pool)
+{
+    ArgsManager bench_args;
+    const auto chain_params{CreateChainParams(bench_args, CBaseChainParams::MAIN)};
+
+    CBlock block;
+    CDataStream{benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION} >> block;
+
+    // Announce and relay each transaction, then the header and the block
+    std::vector<unsigned char> stream;
+    for (const auto& tx : block.vtx) {
+        RecordMessage(*chain_params, stream, NetMsgType::INV, std::vector<CInv>{CInv{MSG_WTX, tx->GetWitnessHash()}});
+        RecordMessage(*chain_params, stream, NetMsgType::TX, *tx);
+    }
+    RecordMessage(*chain_params, stream, NetMsgType::HEADERS, std::vector<CBlock>{CBlock{block.GetBlockHeader()}});
+    RecordMessage(*chain_params, stream, NetMsgType::BLOCK, block);
+
+    NetBufferPool pool;
+    V1TransportDeserializer deserializer{*chain_params, /*node_id=*/0, SER_NETWORK, INIT_PROTO_VERSION,
+                                         use_pool ? &pool : nullptr};
+    bench.unit("message").batch(2 * block.vtx.size() + 2).run([&] {
+        Span<const uint8_t> bytes{stream};
+        while (!bytes.empty()) {
+            Span<const uint8_t> chunk{bytes.first(std::min<size_t>(bytes.size(), 0x10000))};
+            bytes = bytes.subspan(chunk.size());
+            while (!chunk.empty()) {
+                const int handled{deserializer.Read(chunk)};
+                assert(handled >= 0);
+                if (deserializer.Complete()) {
+                    bool reject_message;
+                    const CNetMessage msg{deserializer.GetMessage(/*time=*/0us, reject_message)};
+                    assert(!reject_message);
+                }
+            }
+        }
+    });
+}
+
+static void MessageReceiveNoPool(benchmark::Bench& bench) { MessageReceive(bench, /*use_pool=*/false); }
+static void MessageReceivePooled(benchmark::Bench& bench) { MessageReceive(bench, /*use_pool=*/true); }
+
+BENCHMARK(MessageReceiveNoPool);
+BENCHMARK(MessageReceivePooled);
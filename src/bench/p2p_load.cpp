@@ -0,0 +1,219 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <blockencodings.h>
+#include <chainparams.h>
+#include <consensus/amount.h>
+#include <consensus/consensus.h>
+#include <net.h>
+#include <net_processing.h>
+#include <netmessagemaker.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <protocol.h>
+#include <random.h>
+#include <test/util/mining.h>
+#include <test/util/net.h>
+#include <test/util/script.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <util/time.h>
+#include <validation.h>
+#include <validationinterface.h>
+
+#include <cassert>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+static constexpr int NUM_PEERS{32};
+//! Announcements of an inv message, as a peer trickles them
+static constexpr size_t INV_ANNOUNCEMENTS{35};
+//! Headers of a headers message, as a peer sends them on a reorg
+static constexpr int HEADERS_PER_MESSAGE{8};
+static constexpr size_t ADDR_PER_MESSAGE{10};
+//! Transactions relayed in a round, one mature coinbase spent by each
+static constexpr int NUM_TXS{COINBASE_MATURITY};
+//! Fee of the transactions, paying about twice the minimum relay fee
+static constexpr CAmount TX_FEE{20000};
+
+/**
+ * A node with NUM_PEERS inbound peers connected in process, and the traffic
+ * they relay to it in a round of each message type. The peers announce
+ * transactions and addresses, relay transactions, and announce the blocks
+ * of the tip with headers and compact blocks, as peers of a node that is in
+ * sync with the network do.
+ */
+class P2PLoad
+{
+public:
+    const std::unique_ptr<const TestingSetup> m_setup{MakeNoLogFileContext<const TestingSetup>()};
+    ConnmanTestMsg& m_connman{*static_cast<ConnmanTestMsg*>(m_setup->m_node.connman.get())};
+    PeerManager& m_peerman{*m_setup->m_node.peerman};
+    CTxMemPool& m_pool{*m_setup->m_node.mempool};
+    std::vector<CNode*> m_peers;
+    //! Messages of a round of each type, with the peer that sends them
+    std::vector<std::pair<CNode*, CSerializedNetMsg>> m_invs, m_txs, m_headers, m_cmpctblocks, m_addrs;
+
+    P2PLoad()
+    {
+        FastRandomContext det_rand{/*fDeterministic=*/true};
+        std::vector<CTxIn> coinbases;
+        for (int i = 0; i < NUM_TXS + COINBASE_MATURITY; ++i) {
+            coinbases.push_back(MineBlock(m_setup->m_node, P2WSH_OP_TRUE));
+        }
+        SyncWithValidationInterfaceQueue();
+
+        ChainstateManager& chainman{*m_setup->m_node.chainman};
+        const CBlockIndex* tip{WITH_LOCK(cs_main, return chainman.ActiveChain().Tip())};
+        SetMockTime(tip->GetBlockTime());
+        assert(!chainman.ActiveChainstate().IsInitialBlockDownload());
+
+        for (NodeId id = 0; id < NUM_PEERS; ++id) {
+            in_addr addr;
+            addr.s_addr = det_rand.rand32();
+            m_peers.push_back(new CNode{id,
+                                        /*sock=*/nullptr,
+                                        CAddress{CService{CNetAddr{addr}, Params().GetDefaultPort()}, NODE_NONE},
+                                        /*nKeyedNetGroupIn=*/det_rand.rand64(),
+                                        /*nLocalHostNonceIn=*/0,
+                                        CAddress{},
+                                        /*addrNameIn=*/"",
+                                        ConnectionType::INBOUND,
+                                        /*inbound_onion=*/false});
+            CNode& peer{*m_peers.back()};
+            m_connman.Handshake(peer,
+                                /*successfully_connected=*/true,
+                                /*remote_services=*/ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+                                /*local_services=*/ServiceFlags(NODE_NETWORK | NODE_WITNESS),
+                                /*version=*/PROTOCOL_VERSION,
+                                /*relay_txs=*/true);
+            assert(!peer.fDisconnect);
+            m_connman.AddTestNode(peer);
+        }
+
+        const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+        for (CNode* peer : m_peers) {
+            std::vector<CInv> invs;
+            for (size_t i = 0; i < INV_ANNOUNCEMENTS; ++i) {
+                invs.emplace_back(MSG_TX, det_rand.rand256());
+            }
+            m_invs.emplace_back(peer, msg_maker.Make(NetMsgType::INV, invs));
+
+            std::vector<CAddress> addrs;
+            for (size_t i = 0; i < ADDR_PER_MESSAGE; ++i) {
+                in_addr addr;
+                addr.s_addr = det_rand.rand32();
+                addrs.emplace_back(CService{CNetAddr{addr}, Params().GetDefaultPort()}, NODE_NETWORK);
+                addrs.back().nTime = Now<NodeSeconds>();
+            }
+            m_addrs.emplace_back(peer, msg_maker.Make(NetMsgType::ADDR, addrs));
+        }
+
+        // Each peer relays headers and compact blocks of the blocks of the tip
+        const CBlockIndex* pindex{tip};
+        for (int i = 0; i < NUM_PEERS; ++i, pindex = pindex->pprev) {
+            std::vector<CBlockHeader> headers;
+            for (const CBlockIndex* header{pindex}; headers.size() < HEADERS_PER_MESSAGE; header = header->pprev) {
+                headers.insert(headers.begin(), header->GetBlockHeader());
+            }
+            m_headers.emplace_back(m_peers[i], msg_maker.Make(NetMsgType::HEADERS, std::vector<CBlock>(headers.begin(), headers.end())));
+
+            CBlock block;
+            assert(node::ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+            m_cmpctblocks.emplace_back(m_peers[i], msg_maker.Make(NetMsgType::CMPCTBLOCK, CBlockHeaderAndShortTxIDs{block}));
+        }
+
+        for (int i = 0; i < NUM_TXS; ++i) {
+            const COutPoint& prevout{coinbases[i].prevout};
+            const CAmount value{WITH_LOCK(cs_main, return chainman.ActiveChainstate().CoinsTip().AccessCoin(prevout).out.nValue)};
+            CMutableTransaction tx;
+            tx.vin.emplace_back(prevout);
+            tx.vin[0].scriptWitness.stack.push_back(WITNESS_STACK_ELEM_OP_TRUE);
+            tx.vout.emplace_back(value - TX_FEE, P2WSH_OP_TRUE);
+            m_txs.emplace_back(m_peers[i % NUM_PEERS], msg_maker.Make(NetMsgType::TX, CTransaction{tx}));
+        }
+    }
+
+    ~P2PLoad()
+    {
+        SyncWithValidationInterfaceQueue();
+        for (CNode* peer : m_peers) {
+            m_peerman.FinalizeNode(*peer);
+        }
+        m_connman.ClearTestNodes();
+    }
+
+    /** Receive and process a message from its peer, and let the peer manager send what it queued for the peer. */
+    void Process(std::pair<CNode*, CSerializedNetMsg>& msg)
+    {
+        CNode& peer{*msg.first};
+        (void)m_connman.ReceiveMsgFrom(peer, msg.second);
+        m_connman.ProcessMessagesOnce(peer);
+        {
+            LOCK(peer.cs_sendProcessing);
+            m_peerman.SendMessages(&peer);
+        }
+        // Nothing reads the messages queued for the peer, drop them
+        LOCK(peer.cs_vSend);
+        peer.ClearSendQueues();
+        peer.fPauseSend = false;
+        assert(!peer.fDisconnect);
+    }
+
+    /** Relay the transactions of a round, removing them from the mempool first, so that no round finds them there. */
+    void ProcessTxs()
+    {
+        m_pool.clear();
+        for (auto& msg : m_txs) Process(msg);
+        assert(m_pool.size() == m_txs.size());
+    }
+};
+
+static void P2PLoadMessages(benchmark::Bench& bench, std::vector<std::pair<CNode*, CSerializedNetMsg>> P2PLoad::*msgs)
+{
+    P2PLoad load;
+    auto& round{load.*msgs};
+    bench.unit("message").batch(round.size()).run([&] {
+        for (auto& msg : round) load.Process(msg);
+    });
+}
+
+static void P2PLoadInv(benchmark::Bench& bench) { P2PLoadMessages(bench, &P2PLoad::m_invs); }
+static void P2PLoadHeaders(benchmark::Bench& bench) { P2PLoadMessages(bench, &P2PLoad::m_headers); }
+static void P2PLoadCmpctBlock(benchmark::Bench& bench) { P2PLoadMessages(bench, &P2PLoad::m_cmpctblocks); }
+static void P2PLoadAddr(benchmark::Bench& bench) { P2PLoadMessages(bench, &P2PLoad::m_addrs); }
+
+static void P2PLoadTx(benchmark::Bench& bench)
+{
+    P2PLoad load;
+    bench.unit("message").batch(load.m_txs.size()).run([&] { load.ProcessTxs(); });
+}
+
+/** Throughput of the node under a round of every type of message, the peers taking turns. */
+static void P2PLoadMixed(benchmark::Bench& bench)
+{
+    P2PLoad load;
+    const size_t batch{load.m_invs.size() + load.m_txs.size() + load.m_headers.size() + load.m_cmpctblocks.size() + load.m_addrs.size()};
+    bench.unit("message").batch(batch).run([&] {
+        load.m_pool.clear();
+        for (size_t i = 0; i < load.m_txs.size(); ++i) {
+            load.Process(load.m_txs[i]);
+            if (i >= NUM_PEERS) continue;
+            load.Process(load.m_invs[i]);
+            load.Process(load.m_headers[i]);
+            load.Process(load.m_cmpctblocks[i]);
+            load.Process(load.m_addrs[i]);
+        }
+    });
+}
+
+BENCHMARK(P2PLoadInv);
+BENCHMARK(P2PLoadTx);
+BENCHMARK(P2PLoadHeaders);
+BENCHMARK(P2PLoadCmpctBlock);
+BENCHMARK(P2PLoadAddr);
+BENCHMARK(P2PLoadMixed);
@@ -0,0 +1,159 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+
+#include <arith_uint256.h>
+#include <chain.h>
+#include <chainparams.h>
+#include <crypto/neoscrypt.h>
+#include <crypto/neoscrypt_multiway.h>
+#include <node/blockstorage.h>
+#include <pow.h>
+#include <powcache.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <vector>
+
+namespace {
+/** Disable the proof-of-work hash cache, so that every iteration hashes. */
+struct NoPoWHashCache {
+    NoPoWHashCache() { Assert(InitPoWHashCache(0)); }
+    ~NoPoWHashCache() { Assert(InitPoWHashCache(DEFAULT_MAX_POW_CACHE_BYTES)); }
+};
+
+void NeoScryptProfile(benchmark::Bench& bench, unsigned int profile)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<unsigned char> in{rng.randbytes(80)};
+    unsigned char out[32];
+    bench.unit("hash").run([&] {
+        neoscrypt(in.data(), out, profile);
+        ++in[76];
+    });
+}
+} // namespace
+
+static void NeoScrypt(benchmark::Bench& bench)
+{
+    NeoScryptProfile(bench, 0);
+}
+
+static void NeoScryptSSE2(benchmark::Bench& bench)
+{
+    // Selects the SSE2 core of the assembly implementation, as set in init.cpp
+    NeoScryptProfile(bench, 0x1000);
+}
+
+static void NeoScryptMany_8(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<unsigned char> in{rng.randbytes(80 * 8)};
+    unsigned char out[32 * 8];
+    bench.batch(8).unit("hash").run([&] {
+        NeoScryptMany(out, in.data(), 8);
+        ++in[76];
+    });
+}
+
+static void BlockHeaderPoWHash(benchmark::Bench& bench)
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashMerkleRoot = GetRandHash();
+    bench.unit("header").run([&] {
+        ankerl::nanobench::doNotOptimizeAway(header.GetPoWHash());
+        ++header.nNonce;
+    });
+}
+
+static void HasValidProofOfWork2000(benchmark::Bench& bench)
+{
+    const auto testing_setup{MakeNoLogFileContext<const TestingSetup>(CBaseChainParams::REGTEST)};
+    const Consensus::Params& consensus{Params().GetConsensus()};
+    NoPoWHashCache no_cache;
+
+    std::vector<CBlockHeader> headers(2000);
+    for (CBlockHeader& header : headers) {
+        header.nVersion = 4;
+        header.hashMerkleRoot = GetRandHash();
+        header.nBits = UintToArith256(consensus.powLimit).GetCompact();
+        while (!CheckProofOfWork(header.GetPoWHash(), header.nBits, consensus)) ++header.nNonce;
+    }
+
+    bench.batch(headers.size()).unit("header").run([&] {
+        bool valid{HasValidProofOfWork(headers, consensus)};
+        assert(valid);
+    });
+}
+
+static void ReadBlockFromDiskBench(benchmark::Bench& bench, bool check_pow)
+{
+    const auto testing_setup{MakeNoLogFileContext<TestChain100Setup>(CBaseChainParams::REGTEST)};
+    const Consensus::Params& consensus{Params().GetConsensus()};
+    NoPoWHashCache no_cache;
+
+    const FlatFilePos pos{WITH_LOCK(cs_main, return testing_setup->m_node.chainman->ActiveChain().Tip()->GetBlockPos())};
+    bench.unit("block").run([&] {
+        CBlock block;
+        bool read{node::ReadBlockFromDisk(block, pos, consensus, check_pow)};
+        assert(read);
+    });
+}
+
+static void ReadBlockFromDiskCheckPoW(benchmark::Bench& bench)
+{
+    ReadBlockFromDiskBench(bench, /*check_pow=*/true);
+}
+
+static void ReadBlockFromDiskNoPoW(benchmark::Bench& bench)
+{
+    ReadBlockFromDiskBench(bench, /*check_pow=*/false);
+}
+
+static void GetBlockProofBench(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<CBlockIndex> blocks(1000);
+    for (CBlockIndex& block : blocks) {
+        // Targets from the proof-of-work limit to far above the current difficulty
+        block.nBits = (0x1a + rng.randrange(0x06)) << 24 | (0x00ffff & rng.rand32()) | 0x008000;
+    }
+    bench.batch(blocks.size()).unit("block").run([&] {
+        arith_uint256 work;
+        for (const CBlockIndex& block : blocks) work += GetBlockProof(block);
+        ankerl::nanobench::doNotOptimizeAway(work);
+    });
+}
+
+static void CalculateNextWorkRequiredBench(benchmark::Bench& bench)
+{
+    const auto chain_params{CreateChainParams(ArgsManager{}, CBaseChainParams::MAIN)};
+    const Consensus::Params& consensus{chain_params->GetConsensus()};
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<std::pair<int64_t, arith_uint256>> past_data;
+    int64_t time{1700000000};
+    for (int64_t i = 0; i < DIFFICULTY_ADJUST_WINDOW; ++i) {
+        arith_uint256 target;
+        target.SetCompact(0x1b000000 | (0x00ffff & rng.rand32()) | 0x008000);
+        past_data.emplace_back(time, target);
+        time -= consensus.nPowTargetSpacing / 2 + rng.randrange(consensus.nPowTargetSpacing);
+    }
+    bench.unit("retarget").run([&] {
+        ankerl::nanobench::doNotOptimizeAway(CalculateNextWorkRequired(past_data, consensus));
+    });
+}
+
+BENCHMARK(NeoScrypt);
+BENCHMARK(NeoScryptSSE2);
+BENCHMARK(NeoScryptMany_8);
+BENCHMARK(BlockHeaderPoWHash);
+BENCHMARK(HasValidProofOfWork2000);
+BENCHMARK(ReadBlockFromDiskCheckPoW);
+BENCHMARK(ReadBlockFromDiskNoPoW);
+BENCHMARK(GetBlockProofBench);
+BENCHMARK(CalculateNextWorkRequiredBench);
@@ -0,0 +1,63 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <chain.h>
+#include <consensus/validation.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <cassert>
+#include <vector>
+
+static constexpr int NUM_CHAINS{20};
+static constexpr int CHAIN_LENGTH{5};
+
+/**
+ * Reorg one block of signed transactions out and back in. Disconnecting it
+ * returns its transactions to the mempool, which verifies their signatures
+ * again because connecting the block removed them from the signature cache.
+ */
+static void ReorgMempool(benchmark::Bench& bench)
+{
+    auto testing_setup = MakeNoLogFileContext<TestChain100Setup>(CBaseChainParams::REGTEST, {"-checkmempool=0"});
+    ChainstateManager& chainman = *testing_setup->m_node.chainman;
+    Chainstate& chainstate = chainman.ActiveChainstate();
+    const CTxMemPool& pool = *testing_setup->m_node.mempool;
+    const CScript script_pub_key{CScript() << ToByteVector(testing_setup->coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+
+    // Mature enough coinbases to start a chain of transactions from each
+    std::vector<CTransactionRef> coinbases{testing_setup->m_coinbase_txns.front()};
+    for (int i = 1; i < NUM_CHAINS; ++i) {
+        coinbases.push_back(testing_setup->CreateAndProcessBlock({}, script_pub_key).vtx.at(0));
+    }
+    testing_setup->mineBlocks(COINBASE_MATURITY);
+
+    std::vector<CMutableTransaction> txns;
+    for (const CTransactionRef& coinbase : coinbases) {
+        CTransactionRef parent{coinbase};
+        for (int i = 0; i < CHAIN_LENGTH; ++i) {
+            txns.push_back(testing_setup->CreateValidMempoolTransaction(parent, /*input_vout=*/0, /*input_height=*/0, testing_setup->coinbaseKey,
+                                                                        script_pub_key, parent->vout[0].nValue - 10000, /*submit=*/false));
+            parent = MakeTransactionRef(txns.back());
+        }
+    }
+    const CBlock block{testing_setup->CreateAndProcessBlock(txns, script_pub_key)};
+    CBlockIndex* pindex{WITH_LOCK(::cs_main, return chainman.m_blockman.LookupBlockIndex(block.GetHash()))};
+    assert(WITH_LOCK(::cs_main, return chainman.ActiveTip()) == pindex);
+
+    bench.unit("reorg").run([&] {
+        BlockValidationState state;
+        assert(chainstate.InvalidateBlock(state, pindex));
+        assert(WITH_LOCK(pool.cs, return pool.size()) == txns.size());
+        WITH_LOCK(::cs_main, chainstate.ResetBlockFailureFlags(pindex));
+        assert(chainstate.ActivateBestChain(state));
+        assert(WITH_LOCK(pool.cs, return pool.size()) == 0);
+    });
+}
+
+BENCHMARK(ReorgMempool);
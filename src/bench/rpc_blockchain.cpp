@@ -6,12 +6,15 @@
 #include <bench/data.h>
 
 #include <rpc/blockchain.h>
+#include <rpc/request.h>
 #include <streams.h>
 #include <test/util/setup_common.h>
 #include <validation.h>
 
 #include <univalue.h>
 
+#include <cassert>
+
 namespace {
 
 struct TestBlockAndIndex {
@@ -58,3 +61,31 @@ static void BlockToJsonVerboseWrite(benchmark::Bench& bench)
 }
 
 BENCHMARK(BlockToJsonVerboseWrite);
+
+static void BlockToJsonVerboseRead(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    const std::string str{blockToJSON(data.testing_setup->m_node.chainman->m_blockman, data.block, &data.blockindex, &data.blockindex, TxVerbosity::SHOW_DETAILS_AND_PREVOUT).write()};
+    bench.run([&] {
+        UniValue univalue;
+        bool ok = univalue.read(str);
+        assert(ok);
+        ankerl::nanobench::doNotOptimizeAway(univalue);
+    });
+}
+
+BENCHMARK(BlockToJsonVerboseRead);
+
+static void BlockToJsonVerboseStream(benchmark::Bench& bench)
+{
+    TestBlockAndIndex data;
+    bench.run([&] {
+        size_t size{0};
+        JSONStreamWriter writer{[&](std::string&& str, bool last) { size += str.size(); }};
+        blockToJSON(data.testing_setup->m_node.chainman->m_blockman, data.block, &data.blockindex, &data.blockindex, TxVerbosity::SHOW_DETAILS_AND_PREVOUT, writer);
+        writer.Finish();
+        ankerl::nanobench::doNotOptimizeAway(size);
+    });
+}
+
+BENCHMARK(BlockToJsonVerboseStream);
@@ -10,6 +10,8 @@
 
 #include <univalue.h>
 
+#include <cassert>
+
 
 static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
@@ -17,12 +19,8 @@ static void AddTx(const CTransactionRef& tx, const CAmount& fee, CTxMemPool& poo
     pool.addUnchecked(CTxMemPoolEntry(tx, fee, /*time=*/0, /*entry_height=*/1, /*spends_coinbase=*/false, /*sigops_cost=*/4, lp));
 }
 
-static void RpcMempool(benchmark::Bench& bench)
+static void FillMempool(CTxMemPool& pool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, pool.cs)
 {
-    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
-    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
-    LOCK2(cs_main, pool.cs);
-
     for (int i = 0; i < 1000; ++i) {
         CMutableTransaction tx = CMutableTransaction();
         tx.vin.resize(1);
@@ -34,10 +32,52 @@ static void RpcMempool(benchmark::Bench& bench)
         const CTransactionRef tx_r{MakeTransactionRef(tx)};
         AddTx(tx_r, /*fee=*/i, pool);
     }
+}
+
+static void RpcMempool(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
 
     bench.run([&] {
         (void)MempoolToJSON(pool, /*verbose=*/true);
     });
 }
 
+static void RpcMempoolWrite(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
+    const UniValue mempool{MempoolToJSON(pool, /*verbose=*/true)};
+
+    bench.run([&] {
+        auto str = mempool.write();
+        ankerl::nanobench::doNotOptimizeAway(str);
+    });
+}
+
+static void RpcMempoolLookup(benchmark::Bench& bench)
+{
+    const auto testing_setup = MakeNoLogFileContext<const ChainTestingSetup>(CBaseChainParams::MAIN);
+    CTxMemPool& pool = *Assert(testing_setup->m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    FillMempool(pool);
+    UniValue mempool;
+    bool ok = mempool.read(MempoolToJSON(pool, /*verbose=*/true).write());
+    assert(ok);
+
+    // Look up every entry of the parsed reply, as a client of getrawmempool would
+    bench.batch(mempool.size()).unit("entry").run([&] {
+        for (const std::string& txid : mempool.getKeys()) {
+            ankerl::nanobench::doNotOptimizeAway(find_value(mempool, txid));
+        }
+    });
+}
+
 BENCHMARK(RpcMempool);
+BENCHMARK(RpcMempoolWrite);
+BENCHMARK(RpcMempoolLookup);
@@ -0,0 +1,50 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <sync.h>
+#include <txorphanage.h>
+
+#include <cassert>
+#include <vector>
+
+static constexpr int NUM_PEERS{500};
+static constexpr int ORPHANS_PER_PEER{2};
+static constexpr int INPUTS_PER_ORPHAN{4};
+
+/**
+ * Orphans of many peers, of which a block conflicts with some, until all
+ * peers disconnect.
+ */
+static void TxOrphanageManyPeers(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<CTransactionRef> orphans;
+    CMutableTransaction spender;
+    for (int i = 0; i < NUM_PEERS * ORPHANS_PER_PEER; ++i) {
+        CMutableTransaction mtx;
+        for (int j = 0; j < INPUTS_PER_ORPHAN; ++j) mtx.vin.emplace_back(COutPoint{rng.rand256(), 0});
+        mtx.vout.emplace_back(COIN, CScript{});
+        orphans.push_back(MakeTransactionRef(mtx));
+        if (i % 10 == 0) spender.vin.push_back(mtx.vin.front());
+    }
+    CBlock block;
+    block.vtx.push_back(MakeTransactionRef(spender));
+
+    bench.batch(orphans.size()).unit("orphan").run([&] {
+        TxOrphanage orphanage;
+        LOCK(g_cs_orphans);
+        for (size_t i = 0; i < orphans.size(); ++i) {
+            orphanage.AddTx(orphans[i], /*peer=*/i % NUM_PEERS);
+        }
+        orphanage.EraseForBlock(block);
+        for (NodeId peer = 0; peer < NUM_PEERS; ++peer) orphanage.EraseForPeer(peer);
+        assert(orphanage.Size() == 0);
+    });
+}
+
+BENCHMARK(TxOrphanageManyPeers);
@@ -0,0 +1,60 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <primitives/transaction.h>
+#include <random.h>
+#include <txrequest.h>
+#include <uint256.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+static constexpr int NUM_PEERS{500};
+static constexpr size_t NUM_TXS{1000};
+static constexpr int ANNOUNCERS_PER_TX{8};
+
+/**
+ * Replay a trace of transactions announced by several of many peers each:
+ * every peer that announced a transaction asks for what it can request, the
+ * first one is sent the request and responds, and all peers disconnect at the
+ * end.
+ */
+static void TxRequestTrackerTrace(benchmark::Bench& bench)
+{
+    FastRandomContext rng{/*fDeterministic=*/true};
+    std::vector<GenTxid> txs;
+    std::vector<std::vector<NodeId>> announcers(NUM_TXS);
+    for (size_t i = 0; i < NUM_TXS; ++i) {
+        txs.push_back(GenTxid::Wtxid(rng.rand256()));
+        for (int j = 0; j < ANNOUNCERS_PER_TX; ++j) announcers[i].push_back(rng.randrange(NUM_PEERS));
+    }
+
+    bench.batch(NUM_TXS).unit("tx").run([&] {
+        TxRequestTracker tracker{/*deterministic=*/true};
+        std::chrono::microseconds now{1};
+        for (size_t i = 0; i < NUM_TXS; ++i) {
+            for (const NodeId peer : announcers[i]) {
+                tracker.ReceivedInv(peer, txs[i], /*preferred=*/peer % 4 == 0, now);
+            }
+            now += std::chrono::microseconds{1};
+            for (const NodeId peer : announcers[i]) {
+                for (const GenTxid& gtxid : tracker.GetRequestable(peer, now)) {
+                    tracker.RequestedTx(peer, gtxid.GetHash(), now + std::chrono::seconds{60});
+                }
+            }
+            // Half of the peers send the transaction, which makes the others forget it.
+            if (i % 2 == 0) {
+                tracker.ReceivedResponse(announcers[i].front(), txs[i].GetHash());
+                tracker.ForgetTxHash(txs[i].GetHash());
+            }
+        }
+        for (NodeId peer = 0; peer < NUM_PEERS; ++peer) tracker.DisconnectedPeer(peer);
+        assert(tracker.Size() == 0);
+    });
+}
+
+BENCHMARK(TxRequestTrackerTrace);
@@ -7,12 +7,21 @@
 #if defined(HAVE_CONSENSUS_LIB)
 #include <script/bitcoinconsensus.h>
 #endif
+#include <primitives/transaction.h>
 #include <script/script.h>
+#include <script/sigcache.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
 #include <script/standard.h>
 #include <streams.h>
+#include <test/util/setup_common.h>
 #include <test/util/transaction_utils.h>
+#include <validation.h>
 
+#include <algorithm>
 #include <array>
+#include <cassert>
+#include <vector>
 
 // Microbenchmark for verification of a basic P2WPKH script. Can be easily
 // modified to measure performance of other types of scripts.
@@ -75,6 +84,60 @@ static void VerifyScriptBench(benchmark::Bench& bench)
     ECC_Stop();
 }
 
+// Verification of the inputs of a block, a third pay-to-pubkey-hash and the rest
+// pay-to-witness-pubkey-hash, in slices of the size the script check queue uses.
+static void VerifyBlockScripts(benchmark::Bench& bench, bool batched)
+{
+    const auto testing_setup = MakeNoLogFileContext<const BasicTestingSetup>();
+    const uint32_t flags{SCRIPT_VERIFY_WITNESS | SCRIPT_VERIFY_P2SH};
+    const size_t num_txs{500};
+    const size_t num_inputs{2};
+    const size_t batch_size{128};
+
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    keystore.AddKeyPubKey(key, key.GetPubKey());
+    const CKeyID hash{key.GetPubKey().GetID()};
+
+    std::vector<CTransaction> txs;
+    std::vector<CTxOut> spent_outputs;
+    for (size_t i = 0; i < num_txs; ++i) {
+        CMutableTransaction mtx;
+        for (size_t j = 0; j < num_inputs; ++j) {
+            const int n = i * num_inputs + j;
+            spent_outputs.emplace_back(1000, n % 3 == 0 ? GetScriptForDestination(PKHash(hash)) : GetScriptForDestination(WitnessV0KeyHash(hash)));
+            mtx.vin.emplace_back(COutPoint(uint256::ONE, n));
+        }
+        mtx.vout.emplace_back(1000 * num_inputs, CScript() << OP_1);
+        for (size_t j = 0; j < num_inputs; ++j) {
+            const bool signed_input = SignSignature(keystore, spent_outputs[i * num_inputs + j].scriptPubKey, mtx, j, 1000, SIGHASH_ALL);
+            assert(signed_input);
+        }
+        txs.emplace_back(mtx);
+    }
+    std::vector<PrecomputedTransactionData> txdata(txs.begin(), txs.end());
+    std::vector<CScriptCheck> checks;
+    for (size_t i = 0; i < spent_outputs.size(); ++i) {
+        checks.emplace_back(spent_outputs[i], txs[i / num_inputs], i % num_inputs, flags, /*cacheIn=*/false, &txdata[i / num_inputs]);
+    }
+
+    bench.unit("input").batch(checks.size()).run([&] {
+        for (size_t begin = 0; begin < checks.size(); begin += batch_size) {
+            SignatureBatch batch;
+            bool ok{true};
+            for (size_t i = begin; i < std::min(checks.size(), begin + batch_size); ++i) {
+                ok &= checks[i](batched ? &batch : nullptr);
+            }
+            if (batched) ok &= batch.Verify();
+            assert(ok);
+        }
+    });
+}
+
+static void VerifyBlockScriptsSingle(benchmark::Bench& bench) { VerifyBlockScripts(bench, /*batched=*/false); }
+static void VerifyBlockScriptsBatched(benchmark::Bench& bench) { VerifyBlockScripts(bench, /*batched=*/true); }
+
 static void VerifyNestedIfScript(benchmark::Bench& bench)
 {
     std::vector<std::vector<unsigned char>> stack;
@@ -97,4 +160,6 @@ static void VerifyNestedIfScript(benchmark::Bench& bench)
 }
 
 BENCHMARK(VerifyScriptBench);
+BENCHMARK(VerifyBlockScriptsSingle);
+BENCHMARK(VerifyBlockScriptsBatched);
 BENCHMARK(VerifyNestedIfScript);
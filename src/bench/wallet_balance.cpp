@@ -20,7 +20,7 @@ using wallet::DBErrors;
 using wallet::GetBalance;
 using wallet::WALLET_FLAG_DESCRIPTORS;
 
-static void WalletBalance(benchmark::Bench& bench, const bool set_dirty, const bool add_mine)
+static void WalletBalance(benchmark::Bench& bench, const bool set_dirty, const bool add_mine, const bool set_tx_dirty = false)
 {
     const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
 
@@ -44,20 +44,29 @@ static void WalletBalance(benchmark::Bench& bench, const bool set_dirty, const b
     SyncWithValidationInterfaceQueue();
 
     auto bal = GetBalance(wallet); // Cache
+    const uint256 changed_tx{WITH_LOCK(wallet.cs_wallet, return wallet.mapWallet.begin()->first)};
 
     bench.run([&] {
         if (set_dirty) wallet.MarkDirty();
+        if (set_tx_dirty) {
+            // A single transaction changed, e.g. because it was confirmed
+            LOCK(wallet.cs_wallet);
+            wallet.mapWallet.at(changed_tx).MarkDirty();
+            wallet.MarkBalanceDirty(changed_tx);
+        }
         bal = GetBalance(wallet);
         if (add_mine) assert(bal.m_mine_trusted > 0);
     });
 }
 
 static void WalletBalanceDirty(benchmark::Bench& bench) { WalletBalance(bench, /*set_dirty=*/true, /*add_mine=*/true); }
+static void WalletBalanceTxDirty(benchmark::Bench& bench) { WalletBalance(bench, /*set_dirty=*/false, /*add_mine=*/true, /*set_tx_dirty=*/true); }
 static void WalletBalanceClean(benchmark::Bench& bench) { WalletBalance(bench, /*set_dirty=*/false, /*add_mine=*/true); }
 static void WalletBalanceMine(benchmark::Bench& bench) { WalletBalance(bench, /*set_dirty=*/false, /*add_mine=*/true); }
 static void WalletBalanceWatch(benchmark::Bench& bench) { WalletBalance(bench, /*set_dirty=*/false, /*add_mine=*/false); }
 
 BENCHMARK(WalletBalanceDirty);
+BENCHMARK(WalletBalanceTxDirty);
 BENCHMARK(WalletBalanceClean);
 BENCHMARK(WalletBalanceMine);
 BENCHMARK(WalletBalanceWatch);
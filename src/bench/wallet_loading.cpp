@@ -76,7 +76,7 @@ static std::unique_ptr<WalletDatabase> DuplicateMockDatabase(WalletDatabase& dat
     return new_database;
 }
 
-static void WalletLoading(benchmark::Bench& bench, bool legacy_wallet)
+static void WalletLoading(benchmark::Bench& bench, bool legacy_wallet, int num_txs = 1000)
 {
     const auto test_setup = MakeNoLogFileContext<TestingSetup>();
     test_setup->m_args.ForceSetArg("-unsafesqlitesync", "1");
@@ -98,7 +98,7 @@ static void WalletLoading(benchmark::Bench& bench, bool legacy_wallet)
     auto wallet = BenchLoadWallet(std::move(database), context, options);
 
     // Generate a bunch of transactions and addresses to put into the wallet
-    for (int i = 0; i < 1000; ++i) {
+    for (int i = 0; i < num_txs; ++i) {
         AddTx(*wallet);
     }
 
@@ -118,10 +118,14 @@ static void WalletLoading(benchmark::Bench& bench, bool legacy_wallet)
 
 #ifdef USE_BDB
 static void WalletLoadingLegacy(benchmark::Bench& bench) { WalletLoading(bench, /*legacy_wallet=*/true); }
+static void WalletLoadingLegacyLarge(benchmark::Bench& bench) { WalletLoading(bench, /*legacy_wallet=*/true, /*num_txs=*/10000); }
 BENCHMARK(WalletLoadingLegacy);
+BENCHMARK(WalletLoadingLegacyLarge);
 #endif
 
 #ifdef USE_SQLITE
 static void WalletLoadingDescriptors(benchmark::Bench& bench) { WalletLoading(bench, /*legacy_wallet=*/false); }
+static void WalletLoadingDescriptorsLarge(benchmark::Bench& bench) { WalletLoading(bench, /*legacy_wallet=*/false, /*num_txs=*/10000); }
 BENCHMARK(WalletLoadingDescriptors);
+BENCHMARK(WalletLoadingDescriptorsLarge);
 #endif
@@ -0,0 +1,65 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <bench/bench.h>
+#include <bench/data.h>
+#include <interfaces/chain.h>
+#include <interfaces/handler.h>
+#include <node/context.h>
+#include <primitives/block.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+#include <validationinterface.h>
+#include <version.h>
+#include <wallet/wallet.h>
+
+#include <memory>
+#include <vector>
+
+using wallet::CWallet;
+using wallet::CreateMockWalletDatabase;
+using wallet::DBErrors;
+using wallet::WALLET_FLAG_DESCRIPTORS;
+
+/**
+ * Time from the validation signals of a block and its transactions to the
+ * moment all wallets have processed them, through the chain notifications
+ * interface that wallets register with.
+ */
+static void WalletNotifications(benchmark::Bench& bench, size_t num_wallets)
+{
+    const auto test_setup = MakeNoLogFileContext<const TestingSetup>();
+
+    std::vector<std::unique_ptr<CWallet>> wallets;
+    std::vector<std::unique_ptr<interfaces::Handler>> handlers;
+    for (size_t i = 0; i < num_wallets; ++i) {
+        auto& wallet{wallets.emplace_back(std::make_unique<CWallet>(test_setup->m_node.chain.get(), "", gArgs, CreateMockWalletDatabase()))};
+        {
+            LOCK(wallet->cs_wallet);
+            wallet->SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+            wallet->SetupDescriptorScriptPubKeyMans();
+            if (wallet->LoadWallet() != DBErrors::LOAD_OK) assert(false);
+        }
+        handlers.push_back(test_setup->m_node.chain->handleNotifications({wallet.get(), [](CWallet*) {}}));
+    }
+
+    auto block{std::make_shared<CBlock>()};
+    CDataStream{benchmark::data::block413567, SER_NETWORK, PROTOCOL_VERSION} >> *block;
+    const std::shared_ptr<const CBlock> connected{block};
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return test_setup->m_node.chainman->ActiveTip())};
+
+    bench.unit("block").run([&] {
+        uint64_t sequence{0};
+        for (const auto& tx : connected->vtx) GetMainSignals().TransactionAddedToMempool(tx, ++sequence);
+        GetMainSignals().BlockConnected(connected, tip);
+        SyncWithValidationInterfaceQueue();
+    });
+}
+
+static void WalletNotificationsOneWallet(benchmark::Bench& bench) { WalletNotifications(bench, /*num_wallets=*/1); }
+static void WalletNotificationsEightWallets(benchmark::Bench& bench) { WalletNotifications(bench, /*num_wallets=*/8); }
+
+BENCHMARK(WalletNotificationsOneWallet);
+BENCHMARK(WalletNotificationsEightWallets);
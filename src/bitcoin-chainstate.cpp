@@ -6,6 +6,10 @@
 // by a program wishing to use Bitcoin Core's consensus engine as it is right
 // now.
 //
+// With -replay, it also serves as a reproducible validation benchmark: the
+// blocks of another datadir's blk files are replayed into DATADIR, and the
+// time spent per phase is reported as JSON.
+//
 // DEVELOPER NOTE: Since this is a "demo-only", experimental, etc. executable,
 //                 it may diverge from Bitcoin Core's coding style.
 //
@@ -16,43 +20,216 @@
 #include <kernel/validation_cache_sizes.h>
 
 #include <chainparams.h>
+#include <chainparamsbase.h>
+#include <consensus/consensus.h>
 #include <consensus/validation.h>
 #include <core_io.h>
 #include <node/blockstorage.h>
 #include <node/caches.h>
 #include <node/chainstate.h>
+#include <powcache.h>
+#include <protocol.h>
 #include <scheduler.h>
 #include <script/sigcache.h>
+#include <streams.h>
+#include <txdb.h>
+#include <univalue.h>
 #include <util/system.h>
 #include <util/thread.h>
 #include <validation.h>
 #include <validationinterface.h>
 
+#include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cstring>
+#include <deque>
 #include <filesystem>
 #include <functional>
 #include <iosfwd>
+#include <limits>
+#include <map>
+
+static void SetupReplayArgs(ArgsManager& argsman)
+{
+    SetupChainParamsBaseOptions(argsman);
+    argsman.AddArg("-replay=<dir>", "Replay the blocks of the blk files in <dir>, e.g. the blocks directory of another datadir, and report the time spent per phase as JSON", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-from=<n>", "Only report on the blocks replayed once the tip reached height <n> (default: 0)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-to=<n>", "Stop replaying once the tip reached height <n> (default: all blocks)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)", -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-dbcache=<n>", strprintf("Database cache size <n> MiB (%d to %d, default: %d)", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-assumevalid=<hex>", "Assume the scripts of this block and its ancestors are valid (default: 0, check all scripts)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-skippow", "Do not check the proof of work of the replayed blocks", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+}
+
+static double Millis(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::milli>{d}.count();
+}
+
+/**
+ * Replay the blocks of the blk files in blocks_dir until the tip reaches
+ * to_height, and report on the blocks connected once it reached from_height.
+ * Blocks are stored out of order in blk files, so the ones whose parent is not
+ * known yet are kept until it is.
+ */
+static bool ReplayBlocks(ChainstateManager& chainman, const fs::path& blocks_dir, int from_height, int to_height, bool check_pow, UniValue& report)
+{
+    using Clock = std::chrono::steady_clock;
+    const CChainParams& chainparams = chainman.GetParams();
+    Clock::duration read{}, deserialize{}, pow{}, process{}, flush{};
+    int64_t blocks{0};
+    ConnectBlockTimings start_timings;
+    bool measuring{false};
+    Clock::time_point start_time;
+    const auto start_measuring = [&] {
+        measuring = true;
+        read = deserialize = pow = process = {};
+        start_timings = WITH_LOCK(cs_main, return GetConnectBlockTimings());
+        start_time = Clock::now();
+    };
+    const auto tip_height = [&] { return WITH_LOCK(cs_main, return chainman.ActiveHeight()); };
+    if (tip_height() >= from_height) start_measuring();
+
+    std::multimap<uint256, std::shared_ptr<const CBlock>> unknown_parent;
+    for (int file_num = 0; tip_height() < to_height; ++file_num) {
+        AutoFile file{fsbridge::fopen(blocks_dir / fs::u8path(strprintf("blk%05u.dat", file_num)), "rb")};
+        if (file.IsNull()) break;
+        while (tip_height() < to_height) {
+            // Read a block record, stopping at the zeroes the file was preallocated with
+            auto time{Clock::now()};
+            CMessageHeader::MessageStartChars magic;
+            unsigned int size;
+            std::vector<unsigned char> data;
+            try {
+                file.read(MakeWritableByteSpan(magic));
+                if (std::memcmp(magic, chainparams.MessageStart(), CMessageHeader::MESSAGE_START_SIZE) != 0) break;
+                file >> size;
+                if (size < 80 || size > MAX_BLOCK_SERIALIZED_SIZE) break;
+                data.resize(size);
+                file.read(MakeWritableByteSpan(data));
+            } catch (const std::ios_base::failure&) {
+                break;
+            }
+            read += Clock::now() - time;
+
+            time = Clock::now();
+            auto block{std::make_shared<CBlock>()};
+            try {
+                SpanReader{SER_DISK, CLIENT_VERSION, data} >> *block;
+            } catch (const std::ios_base::failure& e) {
+                std::cerr << "Block decode failed in blk" << file_num << ": " << e.what() << std::endl;
+                return false;
+            }
+            deserialize += Clock::now() - time;
+
+            {
+                LOCK(cs_main);
+                const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(block->GetHash());
+                if (pindex && (pindex->nStatus & BLOCK_HAVE_DATA)) continue;
+                if (!chainman.m_blockman.LookupBlockIndex(block->hashPrevBlock)) {
+                    unknown_parent.emplace(block->hashPrevBlock, std::move(block));
+                    continue;
+                }
+            }
+
+            // Process the block and then the ones waiting for it
+            std::deque<std::shared_ptr<const CBlock>> queue{std::move(block)};
+            while (!queue.empty() && tip_height() < to_height) {
+                const std::shared_ptr<const CBlock> next{std::move(queue.front())};
+                queue.pop_front();
+                if (check_pow) {
+                    // Validation finds the proof of work hash in the cache
+                    time = Clock::now();
+                    GetPoWHashCached(*next);
+                    pow += Clock::now() - time;
+                }
+                time = Clock::now();
+                if (!chainman.ProcessNewBlock(next, /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/nullptr)) {
+                    std::cerr << "Failed to process block " << next->GetHash().ToString() << std::endl;
+                    return false;
+                }
+                process += Clock::now() - time;
+                if (measuring) {
+                    ++blocks;
+                } else if (tip_height() >= from_height) {
+                    start_measuring();
+                }
+                const auto [begin, end] = unknown_parent.equal_range(next->GetHash());
+                for (auto it = begin; it != end; ++it) queue.push_back(std::move(it->second));
+                unknown_parent.erase(begin, end);
+            }
+        }
+    }
+    if (!measuring) {
+        std::cerr << "The tip did not reach height " << from_height << std::endl;
+        return false;
+    }
+
+    const auto time{Clock::now()};
+    {
+        LOCK(cs_main);
+        chainman.ActiveChainstate().ForceFlushStateToDisk();
+    }
+    flush += Clock::now() - time;
+    const Clock::duration total{Clock::now() - start_time};
+
+    const ConnectBlockTimings timings{WITH_LOCK(cs_main, return GetConnectBlockTimings())};
+    const auto validation_ms = [](int64_t end_us, int64_t start_us) { return (end_us - start_us) / 1000.0; };
+    UniValue phases(UniValue::VOBJ);
+    phases.pushKV("read", Millis(read));
+    phases.pushKV("deserialize", Millis(deserialize));
+    phases.pushKV("pow", Millis(pow));
+    phases.pushKV("connect_inputs", validation_ms(timings.connect_inputs_us, start_timings.connect_inputs_us));
+    phases.pushKV("scripts", validation_ms(timings.verify_scripts_us, start_timings.verify_scripts_us));
+    phases.pushKV("flush", validation_ms(timings.flush_us, start_timings.flush_us) + Millis(flush));
+    report.pushKV("blocks", blocks);
+    report.pushKV("from_height", from_height);
+    report.pushKV("tip_height", tip_height());
+    report.pushKV("phases_ms", phases);
+    report.pushKV("connect_block_ms", validation_ms(timings.total_us, start_timings.total_us));
+    report.pushKV("process_block_ms", Millis(process));
+    report.pushKV("total_ms", Millis(total));
+    return true;
+}
 
 int main(int argc, char* argv[])
 {
     // SETUP: Argument parsing and handling
-    if (argc != 2) {
+    SetupReplayArgs(gArgs);
+    std::string parse_error;
+    int datadir_arg{1};
+    while (datadir_arg < argc && argv[datadir_arg][0] == '-') ++datadir_arg;
+    if (!gArgs.ParseParameters(argc, argv, parse_error) || datadir_arg != argc - 1) {
+        if (!parse_error.empty()) std::cerr << "Error: " << parse_error << std::endl;
         std::cerr
-            << "Usage: " << argv[0] << " DATADIR" << std::endl
+            << "Usage: " << argv[0] << " [options] DATADIR" << std::endl
             << "Display DATADIR information, and process hex-encoded blocks on standard input." << std::endl
+            << "With -replay=<dir>, replay the blocks of the blk files in <dir> into DATADIR instead," << std::endl
+            << "and print the time spent per phase as JSON." << std::endl
             << std::endl
             << "IMPORTANT: THIS EXECUTABLE IS EXPERIMENTAL, FOR TESTING ONLY, AND EXPECTED TO" << std::endl
-            << "           BREAK IN FUTURE VERSIONS. DO NOT USE ON YOUR ACTUAL DATADIR." << std::endl;
+            << "           BREAK IN FUTURE VERSIONS. DO NOT USE ON YOUR ACTUAL DATADIR." << std::endl
+            << std::endl
+            << gArgs.GetHelpMessage();
         return 1;
     }
-    std::filesystem::path abs_datadir = std::filesystem::absolute(argv[1]);
+    std::filesystem::path abs_datadir = std::filesystem::absolute(argv[datadir_arg]);
     std::filesystem::create_directories(abs_datadir);
     gArgs.ForceSetArg("-datadir", abs_datadir.string());
 
 
     // SETUP: Misc Globals
-    SelectParams(CBaseChainParams::MAIN);
+    try {
+        SelectParams(gArgs.GetChainName());
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
     const CChainParams& chainparams = Params();
+    if (gArgs.IsArgSet("-assumevalid")) {
+        hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", ""));
+    }
 
     kernel::Context kernel_context{};
     // We can't use a goto here, but we can use an assert since none of the
@@ -66,6 +243,7 @@ int main(int argc, char* argv[])
     kernel::ValidationCacheSizes validation_cache_sizes{};
     Assert(InitSignatureCache(validation_cache_sizes.signature_cache_bytes));
     Assert(InitScriptExecutionCache(validation_cache_sizes.script_execution_cache_bytes));
+    Assert(InitPoWHashCache(validation_cache_sizes.pow_hash_cache_bytes));
 
 
     // SETUP: Scheduling and Background Signals
@@ -78,18 +256,26 @@ int main(int argc, char* argv[])
 
     GetMainSignals().RegisterBackgroundSignalScheduler(scheduler);
 
+    // Same number of script check threads as the node would use with -par
+    int script_threads = gArgs.GetIntArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
+    if (script_threads <= 0) script_threads += GetNumCores();
+    script_threads = std::clamp(script_threads - 1, 0, MAX_SCRIPTCHECK_THREADS);
+    if (script_threads >= 1) StartScriptCheckWorkerThreads(script_threads);
+
 
     // SETUP: Chainstate
     const ChainstateManager::Options chainman_opts{
         .chainparams = chainparams,
         .adjusted_time_callback = NodeClock::now,
+        .check_pow = !gArgs.GetBoolArg("-skippow", false),
     };
     ChainstateManager chainman{chainman_opts};
 
+    const int64_t total_cache{std::clamp<int64_t>(gArgs.GetIntArg("-dbcache", nDefaultDbCache), nMinDbCache, nMaxDbCache) << 20};
     node::CacheSizes cache_sizes;
     cache_sizes.block_tree_db = 2 << 20;
     cache_sizes.coins_db = 2 << 22;
-    cache_sizes.coins = (450 << 20) - (2 << 20) - (2 << 22);
+    cache_sizes.coins = total_cache - cache_sizes.block_tree_db - cache_sizes.coins_db;
     node::ChainstateLoadOptions options;
     options.check_interrupt = [] { return false; };
     auto [status, error] = node::LoadChainstate(chainman, cache_sizes, options);
@@ -129,6 +315,18 @@ int main(int argc, char* argv[])
         }
     }
 
+    if (gArgs.IsArgSet("-replay")) {
+        UniValue report(UniValue::VOBJ);
+        const int to_height{static_cast<int>(gArgs.GetIntArg("-to", std::numeric_limits<int>::max()))};
+        if (ReplayBlocks(chainman, gArgs.GetPathArg("-replay"), gArgs.GetIntArg("-from", 0), to_height, chainman_opts.check_pow, report)) {
+            report.pushKV("par", script_threads + 1);
+            report.pushKV("dbcache", total_cache >> 20);
+            report.pushKV("assumevalid", hashAssumeValid.GetHex());
+            std::cout << report.write(2) << std::endl;
+        }
+        goto epilogue;
+    }
+
     for (std::string line; std::getline(std::cin, line);) {
         if (line.empty()) {
             std::cerr << "Empty line found" << std::endl;
@@ -28,6 +28,7 @@
 #include <cmath>
 #include <cstdio>
 #include <functional>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -53,6 +54,8 @@ static const char DEFAULT_RPCCONNECT[] = "127.0.0.1";
 static const int DEFAULT_HTTP_CLIENT_TIMEOUT=900;
 static constexpr int DEFAULT_WAIT_CLIENT_TIMEOUT = 0;
 static const bool DEFAULT_NAMED=false;
+static constexpr int DEFAULT_BATCH_CONNECTIONS{4};
+static constexpr int MAX_BATCH_CONNECTIONS{64};
 static const int CONTINUE_EXECUTION=-1;
 static constexpr int8_t UNKNOWN_NETWORK{-1};
 static constexpr std::array NETWORKS{"ipv4", "ipv6", "onion", "i2p", "cjdns"};
@@ -81,6 +84,8 @@ static void SetupCliArgs(ArgsManager& argsman)
                              "RPC generatetoaddress nblocks and maxtries arguments. Example: bitcoin-cli -generate 4 1000",
                              DEFAULT_NBLOCKS, DEFAULT_MAX_TRIES),
                    ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-batch", "Read commands from standard input, one per line of whitespace-separated arguments which may be quoted, and send them over persistent connections. The results are printed in input order as they arrive.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-batchconnections=<n>", strprintf("Number of persistent connections -batch sends its commands over concurrently, from 1 to %d (default: %d)", MAX_BATCH_CONNECTIONS, DEFAULT_BATCH_CONNECTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-addrinfo", "Get the number of addresses known to the node, per network and total, after filtering for quality and recency. The total number of addresses known to the node may be higher.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-getinfo", "Get general information from the remote server. Note that unlike server-side RPC calls, the results of -getinfo is the result of multiple non-atomic requests. Some entries in the result may represent results from different states (e.g. wallet balance may be as of a different block from the chain state reported)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-netinfo", "Get network peer connection information from the remote server. An optional integer argument from 0 to 4 can be passed for different peers listings (default: 0). Pass \"help\" for detailed help documentation.", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -146,6 +151,7 @@ static int AppInitRPC(int argc, char* argv[])
             strUsage += "\n"
                 "Usage:  certurium-cli [options] <command> [params]  Send command to " PACKAGE_NAME "\n"
                 "or:     certurium-cli [options] -named <command> [name=value]...  Send command to " PACKAGE_NAME " (with named arguments)\n"
+                "or:     certurium-cli [options] -batch              Send the commands read from standard input, one per line\n"
                 "or:     certurium-cli [options] help                List commands\n"
                 "or:     certurium-cli [options] help <command>      Get help for a command\n";
             strUsage += "\n" + gArgs.GetHelpMessage();
@@ -714,71 +720,52 @@ public:
     }
 };
 
-static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, const std::vector<std::string>& args, const std::optional<std::string>& rpcwallet = {})
+/** Return the host and port to connect to for RPC. */
+static void GetRPCHostPort(std::string& host, uint16_t& port)
 {
-    std::string host;
     // In preference order, we choose the following for the port:
     //     1. -rpcport
     //     2. port in -rpcconnect (ie following : in ipv4 or ]: in ipv6)
     //     3. default port for chain
-    uint16_t port{BaseParams().RPCPort()};
+    port = BaseParams().RPCPort();
     SplitHostPort(gArgs.GetArg("-rpcconnect", DEFAULT_RPCCONNECT), port, host);
     port = static_cast<uint16_t>(gArgs.GetIntArg("-rpcport", port));
+}
 
-    // Obtain event base
-    raii_event_base base = obtain_event_base();
-
-    // Synchronously look up hostname
-    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
-
-    // Set connection timeout
-    {
-        const int timeout = gArgs.GetIntArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT);
-        if (timeout > 0) {
-            evhttp_connection_set_timeout(evcon.get(), timeout);
-        } else {
-            // Indefinite request timeouts are not possible in libevent-http, so we
-            // set the timeout to a very long time period instead.
+/** Set the request timeout of a connection from -rpcclienttimeout. */
+static void SetClientTimeout(struct evhttp_connection* evcon)
+{
+    const int timeout = gArgs.GetIntArg("-rpcclienttimeout", DEFAULT_HTTP_CLIENT_TIMEOUT);
+    if (timeout > 0) {
+        evhttp_connection_set_timeout(evcon, timeout);
+    } else {
+        // Indefinite request timeouts are not possible in libevent-http, so we
+        // set the timeout to a very long time period instead.
 
-            constexpr int YEAR_IN_SECONDS = 31556952; // Average length of year in Gregorian calendar
-            evhttp_connection_set_timeout(evcon.get(), 5 * YEAR_IN_SECONDS);
-        }
+        constexpr int YEAR_IN_SECONDS = 31556952; // Average length of year in Gregorian calendar
+        evhttp_connection_set_timeout(evcon, 5 * YEAR_IN_SECONDS);
     }
+}
 
-    HTTPReply response;
-    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
-    if (req == nullptr) {
-        throw std::runtime_error("create http request failed");
-    }
-
-    evhttp_request_set_error_cb(req.get(), http_error_cb);
-
-    // Get credentials
+/** Return the user:password credentials, setting failed_cookie if no password is set and no cookie was found. */
+static std::string GetRPCUserColonPass(bool& failed_cookie)
+{
     std::string strRPCUserColonPass;
-    bool failedToGetAuthCookie = false;
+    failed_cookie = false;
     if (gArgs.GetArg("-rpcpassword", "") == "") {
         // Try fall back to cookie-based authentication if no password is provided
         if (!GetAuthCookie(&strRPCUserColonPass)) {
-            failedToGetAuthCookie = true;
+            failed_cookie = true;
         }
     } else {
         strRPCUserColonPass = gArgs.GetArg("-rpcuser", "") + ":" + gArgs.GetArg("-rpcpassword", "");
     }
+    return strRPCUserColonPass;
+}
 
-    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
-    assert(output_headers);
-    evhttp_add_header(output_headers, "Host", host.c_str());
-    evhttp_add_header(output_headers, "Connection", "close");
-    evhttp_add_header(output_headers, "Content-Type", "application/json");
-    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(strRPCUserColonPass)).c_str());
-
-    // Attach request data
-    std::string strRequest = rh->PrepareRequest(strMethod, args).write() + "\n";
-    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
-    assert(output_buffer);
-    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
-
-    // check if we should use a special wallet endpoint
+/** Return the endpoint to post requests to, which is a special wallet endpoint if rpcwallet is set. */
+static std::string GetRPCEndpoint(const std::optional<std::string>& rpcwallet)
+{
     std::string endpoint = "/";
     if (rpcwallet) {
         char* encodedURI = evhttp_uriencode(rpcwallet->data(), rpcwallet->size(), false);
@@ -789,14 +776,36 @@ static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, co
             throw CConnectionFailed("uri-encode failed");
         }
     }
-    int r = evhttp_make_request(evcon.get(), req.get(), EVHTTP_REQ_POST, endpoint.c_str());
+    return endpoint;
+}
+
+/** Add the headers and the body of a JSON-RPC request, and post it on a connection. */
+static void MakeRPCRequest(struct evhttp_connection* evcon, raii_evhttp_request req, const std::string& host,
+                           const std::string& user_colon_pass, const std::string& endpoint, const UniValue& request, bool keep_alive)
+{
+    struct evkeyvalq* output_headers = evhttp_request_get_output_headers(req.get());
+    assert(output_headers);
+    evhttp_add_header(output_headers, "Host", host.c_str());
+    if (!keep_alive) evhttp_add_header(output_headers, "Connection", "close");
+    evhttp_add_header(output_headers, "Content-Type", "application/json");
+    evhttp_add_header(output_headers, "Authorization", (std::string("Basic ") + EncodeBase64(user_colon_pass)).c_str());
+
+    // Attach request data
+    std::string strRequest = request.write() + "\n";
+    struct evbuffer* output_buffer = evhttp_request_get_output_buffer(req.get());
+    assert(output_buffer);
+    evbuffer_add(output_buffer, strRequest.data(), strRequest.size());
+
+    int r = evhttp_make_request(evcon, req.get(), EVHTTP_REQ_POST, endpoint.c_str());
     req.release(); // ownership moved to evcon in above call
     if (r != 0) {
         throw CConnectionFailed("send http request failed");
     }
+}
 
-    event_base_dispatch(base.get());
-
+/** Check the HTTP reply to a JSON-RPC request and parse it with a request handler. */
+static UniValue ParseRPCReply(BaseRequestHandler* rh, const HTTPReply& response, const std::string& host, uint16_t port, bool failedToGetAuthCookie)
+{
     if (response.status == 0) {
         std::string responseErrorMessage;
         if (response.error != -1) {
@@ -829,6 +838,41 @@ static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, co
     return reply;
 }
 
+static UniValue CallRPC(BaseRequestHandler* rh, const std::string& strMethod, const std::vector<std::string>& args, const std::optional<std::string>& rpcwallet = {})
+{
+    std::string host;
+    uint16_t port;
+    GetRPCHostPort(host, port);
+
+    // Obtain event base
+    raii_event_base base = obtain_event_base();
+
+    // Synchronously look up hostname
+    raii_evhttp_connection evcon = obtain_evhttp_connection_base(base.get(), host, port);
+
+    // Set connection timeout
+    SetClientTimeout(evcon.get());
+
+    HTTPReply response;
+    raii_evhttp_request req = obtain_evhttp_request(http_request_done, (void*)&response);
+    if (req == nullptr) {
+        throw std::runtime_error("create http request failed");
+    }
+
+    evhttp_request_set_error_cb(req.get(), http_error_cb);
+
+    // Get credentials
+    bool failedToGetAuthCookie;
+    const std::string strRPCUserColonPass{GetRPCUserColonPass(failedToGetAuthCookie)};
+
+    MakeRPCRequest(evcon.get(), std::move(req), host, strRPCUserColonPass, GetRPCEndpoint(rpcwallet),
+                   rh->PrepareRequest(strMethod, args), /*keep_alive=*/false);
+
+    event_base_dispatch(base.get());
+
+    return ParseRPCReply(rh, response, host, port, failedToGetAuthCookie);
+}
+
 /**
  * ConnectAndCallRPC wraps CallRPC with -rpcwait and an exception handler.
  *
@@ -1094,6 +1138,184 @@ static void SetGenerateToAddressArgs(const std::string& address, std::vector<std
     args.emplace(args.begin() + 1, address);
 }
 
+/** Split a line of -batch input into words, honoring single and double quotes. */
+static std::vector<std::string> SplitBatchLine(const std::string& line)
+{
+    std::vector<std::string> words;
+    std::string word;
+    bool in_word{false};
+    char quote{0};
+    for (size_t i = 0; i < line.size(); ++i) {
+        const char c{line[i]};
+        if (quote) {
+            if (c == quote) {
+                quote = 0;
+            } else if (c == '\\' && quote == '"' && i + 1 < line.size() && (line[i + 1] == '"' || line[i + 1] == '\\')) {
+                word += line[++i];
+            } else {
+                word += c;
+            }
+        } else if (c == '"' || c == '\'') {
+            quote = c;
+            in_word = true;
+        } else if (c == ' ' || c == '\t' || c == '\r') {
+            if (in_word) words.push_back(std::move(word));
+            word.clear();
+            in_word = false;
+        } else {
+            word += c;
+            in_word = true;
+        }
+    }
+    if (quote) throw std::runtime_error("unterminated quote in command");
+    if (in_word) words.push_back(std::move(word));
+    return words;
+}
+
+/**
+ * Send the commands read from standard input over persistent connections.
+ *
+ * Each connection sends the next command once the reply to its previous one
+ * arrived, so that up to -batchconnections commands are processed by the
+ * server concurrently. Results are printed in input order, as soon as all
+ * earlier ones are known.
+ */
+class BatchRPC
+{
+public:
+    explicit BatchRPC(std::optional<std::string> rpcwallet) : m_rpcwallet{std::move(rpcwallet)} {}
+
+    //! Run all commands and return the exit code of the first one that failed, or 0.
+    int Run()
+    {
+        const int connections{static_cast<int>(gArgs.GetIntArg("-batchconnections", DEFAULT_BATCH_CONNECTIONS))};
+        if (connections < 1 || connections > MAX_BATCH_CONNECTIONS) {
+            throw std::runtime_error(strprintf("-batchconnections must be from 1 to %d", MAX_BATCH_CONNECTIONS));
+        }
+        GetRPCHostPort(m_host, m_port);
+        m_user_colon_pass = GetRPCUserColonPass(m_failed_cookie);
+        m_endpoint = GetRPCEndpoint(m_rpcwallet);
+
+        m_base = obtain_event_base();
+        for (int i = 0; i < connections; ++i) {
+            auto& conn{*m_connections.emplace_back(std::make_unique<Connection>())};
+            conn.batch = this;
+            conn.evcon = obtain_evhttp_connection_base(m_base.get(), m_host, m_port);
+            SetClientTimeout(conn.evcon.get());
+            SendNext(conn);
+        }
+        if (m_in_flight > 0) event_base_dispatch(m_base.get());
+        return m_ret;
+    }
+
+private:
+    //! A persistent connection with the command it is waiting for the reply to
+    struct Connection {
+        BatchRPC* batch{nullptr};
+        raii_evhttp_connection evcon;
+        size_t index{0};
+        HTTPReply reply;
+    };
+
+    DefaultRequestHandler m_rh;
+    const std::optional<std::string> m_rpcwallet;
+    std::string m_host;
+    uint16_t m_port{0};
+    std::string m_user_colon_pass;
+    bool m_failed_cookie{false};
+    std::string m_endpoint;
+    //! Declared before the connections, which must be freed before their event base
+    raii_event_base m_base;
+    std::vector<std::unique_ptr<Connection>> m_connections;
+    size_t m_in_flight{0};
+    //! Index of the next command read, and of the next result to print
+    size_t m_next_index{0};
+    size_t m_next_print{0};
+    //! Results which are known but wait for an earlier one to be printed
+    std::map<size_t, std::pair<std::string, int>> m_results;
+    int m_ret{0};
+
+    static void RequestDone(struct evhttp_request* req, void* ctx)
+    {
+        Connection& conn{*static_cast<Connection*>(ctx)};
+        http_request_done(req, &conn.reply);
+        conn.batch->OnReply(conn);
+    }
+
+    static void RequestError(enum evhttp_request_error err, void* ctx)
+    {
+        static_cast<Connection*>(ctx)->reply.error = err;
+    }
+
+    //! Send the next command of the input on a connection, or stop once the input and all replies are done.
+    void SendNext(Connection& conn)
+    {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            const size_t first{line.find_first_not_of(" \t\r")};
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            const size_t index{m_next_index++};
+            try {
+                std::vector<std::string> args{SplitBatchLine(line)};
+                const std::string method{args.at(0)};
+                args.erase(args.begin());
+
+                raii_evhttp_request req = obtain_evhttp_request(RequestDone, &conn);
+                if (req == nullptr) {
+                    throw std::runtime_error("create http request failed");
+                }
+                evhttp_request_set_error_cb(req.get(), RequestError);
+                conn.index = index;
+                conn.reply = HTTPReply{};
+                MakeRPCRequest(conn.evcon.get(), std::move(req), m_host, m_user_colon_pass, m_endpoint,
+                               m_rh.PrepareRequest(method, args), /*keep_alive=*/true);
+                ++m_in_flight;
+                return;
+            } catch (const std::exception& e) {
+                AddResult(index, std::string("error: ") + e.what(), EXIT_FAILURE);
+            }
+        }
+        // The idle persistent connections keep the event loop running
+        if (m_in_flight == 0) event_base_loopexit(m_base.get(), nullptr);
+    }
+
+    void OnReply(Connection& conn)
+    {
+        --m_in_flight;
+        std::string strPrint;
+        int nRet = 0;
+        try {
+            const UniValue reply{ParseRPCReply(&m_rh, conn.reply, m_host, m_port, m_failed_cookie)};
+            const UniValue& error = find_value(reply, "error");
+            if (error.isNull()) {
+                ParseResult(find_value(reply, "result"), strPrint);
+            } else {
+                ParseError(error, strPrint, nRet);
+            }
+        } catch (const std::exception& e) {
+            strPrint = std::string("error: ") + e.what();
+            nRet = EXIT_FAILURE;
+        }
+        AddResult(conn.index, std::move(strPrint), nRet);
+        SendNext(conn);
+    }
+
+    //! Record the result of a command, and print the results which are next in input order.
+    void AddResult(size_t index, std::string strPrint, int nRet)
+    {
+        m_results.emplace(index, std::make_pair(std::move(strPrint), nRet));
+        for (auto it = m_results.begin(); it != m_results.end() && it->first == m_next_print; it = m_results.erase(it), ++m_next_print) {
+            const auto& [print, ret] = it->second;
+            if (ret != 0 && m_ret == 0) m_ret = ret;
+            if (print != "") {
+                tfm::format(ret == 0 ? std::cout : std::cerr, "%s\n", print);
+            }
+        }
+        std::cout.flush();
+    }
+};
+
 static int CommandLineRPC(int argc, char *argv[])
 {
     std::string strPrint;
@@ -1120,6 +1342,22 @@ static int CommandLineRPC(int argc, char *argv[])
             gArgs.ForceSetArg("-rpcpassword", rpcPass);
         }
         std::vector<std::string> args = std::vector<std::string>(&argv[1], &argv[argc]);
+        if (gArgs.GetBoolArg("-batch", false)) {
+            if (!args.empty()) {
+                throw std::runtime_error("-batch reads the commands from standard input and takes no command line arguments");
+            }
+            for (const char* arg : {"-stdin", "-stdinwalletpassphrase", "-getinfo", "-netinfo", "-generate", "-addrinfo"}) {
+                if (gArgs.IsArgSet(arg)) throw std::runtime_error(strprintf("-batch cannot be combined with %s", arg));
+            }
+            if (gArgs.GetBoolArg("-rpcwait", false)) {
+                // Wait for the server once, before any command is sent
+                DefaultRequestHandler rh;
+                ConnectAndCallRPC(&rh, "uptime", /*args=*/{});
+            }
+            std::optional<std::string> wallet_name{};
+            if (gArgs.IsArgSet("-rpcwallet")) wallet_name = gArgs.GetArg("-rpcwallet", "");
+            return BatchRPC{wallet_name}.Run();
+        }
         if (gArgs.GetBoolArg("-stdinwalletpassphrase", false)) {
             NO_STDIN_ECHO();
             std::string walletPass;
@@ -14,17 +14,27 @@
 #include <validation.h>
 #include <util/system.h>
 
-#include <unordered_map>
+#include <limits>
+#include <vector>
 
-CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block) :
-        nonce(GetRand<uint64_t>()),
-        shorttxids(block.vtx.size() - 1), prefilledtxn(1), header(block) {
+CBlockHeaderAndShortTxIDs::CBlockHeaderAndShortTxIDs(const CBlock& block, const std::vector<size_t>& prefill) :
+        nonce(GetRand<uint64_t>()), header(block) {
     FillShortTxIDSelector();
-    //TODO: Use our mempool prior to block acceptance to predictively fill more than just the coinbase
-    prefilledtxn[0] = {0, block.vtx[0]};
+    shorttxids.reserve(block.vtx.size() - 1);
+    prefilledtxn.reserve(1 + prefill.size());
+    prefilledtxn.push_back({0, block.vtx[0]});
+    // Prefilled indexes are stored relative to the previous prefilled transaction
+    size_t last_prefilled{0};
+    auto next_prefill{prefill.begin()};
     for (size_t i = 1; i < block.vtx.size(); i++) {
         const CTransaction& tx = *block.vtx[i];
-        shorttxids[i - 1] = GetShortID(tx.GetWitnessHash());
+        if (next_prefill != prefill.end() && *next_prefill == i) {
+            prefilledtxn.push_back({static_cast<uint16_t>(i - last_prefilled - 1), block.vtx[i]});
+            last_prefilled = i;
+            ++next_prefill;
+        } else {
+            shorttxids.push_back(GetShortID(tx.GetWitnessHash()));
+        }
     }
 }
 
@@ -44,7 +54,70 @@ uint64_t CBlockHeaderAndShortTxIDs::GetShortID(const uint256& txhash) const {
     return SipHashUint256(shorttxidk0, shorttxidk1, txhash) & 0xffffffffffffL;
 }
 
+namespace {
+/**
+ * Open addressing table from the short IDs of a compact block to their
+ * positions in the block, looked up once for every mempool transaction.
+ * The peer picks the short IDs, so their slots come from a hash that is
+ * salted per table, and a run of more than MAX_PROBES occupied slots is
+ * refused.
+ */
+class ShortIdTable
+{
+private:
+    //! Short IDs have 48 bits, so no short ID equals this
+    static constexpr uint64_t EMPTY{std::numeric_limits<uint64_t>::max()};
+    //! With at most a quarter of the slots used, a block of 16000 transactions
+    //! should need a longer run less than once per billion block transfers.
+    static constexpr size_t MAX_PROBES{48};
+
+    const uint64_t m_k0{GetRand<uint64_t>()};
+    const uint64_t m_k1{GetRand<uint64_t>() | 1};
+    int m_shift;
+    size_t m_mask;
+    std::vector<uint64_t> m_ids;
+    std::vector<uint16_t> m_positions;
+
+    size_t Slot(uint64_t shortid) const { return ((shortid + m_k0) * m_k1) >> m_shift; }
 
+public:
+    enum class InsertResult { OK, DUPLICATE, OVERFULL };
+
+    explicit ShortIdTable(size_t count)
+    {
+        int bits{2};
+        while ((size_t{1} << bits) < count * 4) ++bits;
+        m_shift = 64 - bits;
+        m_mask = (size_t{1} << bits) - 1;
+        m_ids.assign(size_t{1} << bits, EMPTY);
+        m_positions.resize(size_t{1} << bits);
+    }
+
+    InsertResult Insert(uint64_t shortid, uint16_t position)
+    {
+        size_t slot{Slot(shortid)};
+        for (size_t probes{0}; probes < MAX_PROBES; ++probes, slot = (slot + 1) & m_mask) {
+            if (m_ids[slot] == shortid) return InsertResult::DUPLICATE;
+            if (m_ids[slot] == EMPTY) {
+                m_ids[slot] = shortid;
+                m_positions[slot] = position;
+                return InsertResult::OK;
+            }
+        }
+        return InsertResult::OVERFULL;
+    }
+
+    /** The position of a short ID in the block, or nullptr if it is not in it. */
+    const uint16_t* Find(uint64_t shortid) const
+    {
+        // There always is an empty slot, as at most a quarter of them is used
+        for (size_t slot{Slot(shortid)};; slot = (slot + 1) & m_mask) {
+            if (m_ids[slot] == shortid) return &m_positions[slot];
+            if (m_ids[slot] == EMPTY) return nullptr;
+        }
+    }
+};
+} // namespace
 
 ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& cmpctblock, const std::vector<std::pair<uint256, CTransactionRef>>& extra_txn) {
     if (cmpctblock.header.IsNull() || (cmpctblock.shorttxids.empty() && cmpctblock.prefilledtxn.empty()))
@@ -78,47 +151,39 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
     // Because well-formed cmpctblock messages will have a (relatively) uniform distribution
     // of short IDs, any highly-uneven distribution of elements can be safely treated as a
     // READ_STATUS_FAILED.
-    std::unordered_map<uint64_t, uint16_t> shorttxids(cmpctblock.shorttxids.size());
+    ShortIdTable shorttxids(cmpctblock.shorttxids.size());
     uint16_t index_offset = 0;
     for (size_t i = 0; i < cmpctblock.shorttxids.size(); i++) {
         while (txn_available[i + index_offset])
             index_offset++;
-        shorttxids[cmpctblock.shorttxids[i]] = i + index_offset;
-        // To determine the chance that the number of entries in a bucket exceeds N,
-        // we use the fact that the number of elements in a single bucket is
-        // binomially distributed (with n = the number of shorttxids S, and p =
-        // 1 / the number of buckets), that in the worst case the number of buckets is
-        // equal to S (due to std::unordered_map having a default load factor of 1.0),
-        // and that the chance for any bucket to exceed N elements is at most
-        // buckets * (the chance that any given bucket is above N elements).
-        // Thus: P(max_elements_per_bucket > N) <= S * (1 - cdf(binomial(n=S,p=1/S), N)).
-        // If we assume blocks of up to 16000, allowing 12 elements per bucket should
-        // only fail once per ~1 million block transfers (per peer and connection).
-        if (shorttxids.bucket_size(shorttxids.bucket(cmpctblock.shorttxids[i])) > 12)
+        switch (shorttxids.Insert(cmpctblock.shorttxids[i], i + index_offset)) {
+        case ShortIdTable::InsertResult::OK:
+            break;
+        case ShortIdTable::InsertResult::OVERFULL:
             return READ_STATUS_FAILED;
+        case ShortIdTable::InsertResult::DUPLICATE:
+            // TODO: in the shortid-collision case, we should instead request both transactions
+            // which collided. Falling back to full-block-request here is overkill.
+            return READ_STATUS_FAILED; // Short ID collision
+        }
     }
-    // TODO: in the shortid-collision case, we should instead request both transactions
-    // which collided. Falling back to full-block-request here is overkill.
-    if (shorttxids.size() != cmpctblock.shorttxids.size())
-        return READ_STATUS_FAILED; // Short ID collision
 
     std::vector<bool> have_txn(txn_available.size());
     {
     LOCK(pool->cs);
     for (size_t i = 0; i < pool->vTxHashes.size(); i++) {
         uint64_t shortid = cmpctblock.GetShortID(pool->vTxHashes[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = pool->vTxHashes[i].second->GetSharedTx();
-                have_txn[idit->second]  = true;
+        if (const uint16_t* position{shorttxids.Find(shortid)}) {
+            if (!have_txn[*position]) {
+                txn_available[*position] = pool->vTxHashes[i].second->GetSharedTx();
+                have_txn[*position]  = true;
                 mempool_count++;
             } else {
                 // If we find two mempool txn that match the short id, just request it.
                 // This should be rare enough that the extra bandwidth doesn't matter,
                 // but eating a round-trip due to FillBlock failure would be annoying
-                if (txn_available[idit->second]) {
-                    txn_available[idit->second].reset();
+                if (txn_available[*position]) {
+                    txn_available[*position].reset();
                     mempool_count--;
                 }
             }
@@ -126,18 +191,19 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         // Though ideally we'd continue scanning for the two-txn-match-shortid case,
         // the performance win of an early exit here is too good to pass up and worth
         // the extra risk.
-        if (mempool_count == shorttxids.size())
+        if (mempool_count == cmpctblock.shorttxids.size())
             break;
     }
     }
 
     for (size_t i = 0; i < extra_txn.size(); i++) {
+        // Skip the slots the pool has not filled or has freed
+        if (!extra_txn[i].second) continue;
         uint64_t shortid = cmpctblock.GetShortID(extra_txn[i].first);
-        std::unordered_map<uint64_t, uint16_t>::iterator idit = shorttxids.find(shortid);
-        if (idit != shorttxids.end()) {
-            if (!have_txn[idit->second]) {
-                txn_available[idit->second] = extra_txn[i].second;
-                have_txn[idit->second]  = true;
+        if (const uint16_t* position{shorttxids.Find(shortid)}) {
+            if (!have_txn[*position]) {
+                txn_available[*position] = extra_txn[i].second;
+                have_txn[*position]  = true;
                 mempool_count++;
                 extra_count++;
             } else {
@@ -147,9 +213,9 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
                 // but eating a round-trip due to FillBlock failure would be annoying
                 // Note that we don't want duplication between extra_txn and mempool to
                 // trigger this case, so we compare witness hashes first
-                if (txn_available[idit->second] &&
-                        txn_available[idit->second]->GetWitnessHash() != extra_txn[i].second->GetWitnessHash()) {
-                    txn_available[idit->second].reset();
+                if (txn_available[*position] &&
+                        txn_available[*position]->GetWitnessHash() != extra_txn[i].second->GetWitnessHash()) {
+                    txn_available[*position].reset();
                     mempool_count--;
                     extra_count--;
                 }
@@ -158,7 +224,7 @@ ReadStatus PartiallyDownloadedBlock::InitData(const CBlockHeaderAndShortTxIDs& c
         // Though ideally we'd continue scanning for the two-txn-match-shortid case,
         // the performance win of an early exit here is too good to pass up and worth
         // the extra risk.
-        if (mempool_count == shorttxids.size())
+        if (mempool_count == cmpctblock.shorttxids.size())
             break;
     }
 
@@ -104,7 +104,11 @@ public:
     // Dummy for deserialization
     CBlockHeaderAndShortTxIDs() {}
 
-    CBlockHeaderAndShortTxIDs(const CBlock& block);
+    /**
+     * Encode a block, prefilling its coinbase and the transactions at the
+     * given indexes, which must be in increasing order and past the coinbase.
+     */
+    explicit CBlockHeaderAndShortTxIDs(const CBlock& block, const std::vector<size_t>& prefill = {});
 
     uint64_t GetShortID(const uint256& txhash) const;
 
@@ -2,10 +2,13 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <algorithm>
+#include <array>
 #include <mutex>
 #include <set>
 
 #include <blockfilter.h>
+#include <crypto/common.h>
 #include <crypto/siphash.h>
 #include <hash.h>
 #include <primitives/transaction.h>
@@ -32,14 +35,56 @@ uint64_t GCSFilter::HashToRange(const Element& element) const
     return FastRange64(hash, m_F);
 }
 
+/// Below this many values, std::sort is faster than a radix sort.
+static constexpr size_t RADIX_SORT_MIN_SIZE{256};
+
+/**
+ * Sort values below range with an LSD radix sort over their significant
+ * bytes. The hashes of a filter are uniformly distributed over the range, so
+ * this takes a few linear passes instead of a comparison sort.
+ */
+static void SortHashedSet(std::vector<uint64_t>& values, uint64_t range)
+{
+    if (values.size() < RADIX_SORT_MIN_SIZE) {
+        std::sort(values.begin(), values.end());
+        return;
+    }
+
+    const int passes = (CountBits(range - 1) + 7) / 8;
+    std::array<std::array<size_t, 256>, 8> counts{};
+    for (uint64_t value : values) {
+        for (int pass = 0; pass < passes; ++pass) {
+            ++counts[pass][(value >> (8 * pass)) & 0xff];
+        }
+    }
+
+    std::vector<uint64_t> sorted(values.size());
+    for (int pass = 0; pass < passes; ++pass) {
+        std::array<size_t, 256>& offsets = counts[pass];
+        // All values share this byte, so the pass would not change their order
+        if (std::find(offsets.begin(), offsets.end(), values.size()) != offsets.end()) continue;
+        size_t offset = 0;
+        for (size_t& count : offsets) {
+            offset += std::exchange(count, offset);
+        }
+        for (uint64_t value : values) {
+            sorted[offsets[(value >> (8 * pass)) & 0xff]++] = value;
+        }
+        values.swap(sorted);
+    }
+}
+
 std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
 {
     std::vector<uint64_t> hashed_elements;
     hashed_elements.reserve(elements.size());
+    // Set up the keyed SipHash state once, and copy it for every element
+    const CSipHasher hasher(m_params.m_siphash_k0, m_params.m_siphash_k1);
     for (const Element& element : elements) {
-        hashed_elements.push_back(HashToRange(element));
+        const uint64_t hash = CSipHasher(hasher).Write(element.data(), element.size()).Finalize();
+        hashed_elements.push_back(FastRange64(hash, m_F));
     }
-    std::sort(hashed_elements.begin(), hashed_elements.end());
+    SortHashedSet(hashed_elements, m_F);
     return hashed_elements;
 }
 
@@ -63,11 +108,11 @@ GCSFilter::GCSFilter(const Params& params, std::vector<unsigned char> encoded_fi
 
     // Verify that the encoded filter contains exactly N elements. If it has too much or too little
     // data, a std::ios_base::failure exception will be raised.
-    BitStreamReader<SpanReader> bitreader{stream};
+    GolombRiceReader reader{Span{m_encoded}.subspan(m_encoded.size() - stream.size())};
     for (uint64_t i = 0; i < m_N; ++i) {
-        GolombRiceDecode(bitreader, m_params.m_P);
+        reader.Decode(m_params.m_P);
     }
-    if (!stream.empty()) {
+    if (!reader.empty()) {
         throw std::ios_base::failure("encoded_filter contains excess data");
     }
 }
@@ -90,16 +135,16 @@ GCSFilter::GCSFilter(const Params& params, const ElementSet& elements)
         return;
     }
 
-    BitStreamWriter<CVectorWriter> bitwriter(stream);
+    GolombRiceWriter writer(m_encoded);
 
     uint64_t last_value = 0;
     for (uint64_t value : BuildHashedSet(elements)) {
         uint64_t delta = value - last_value;
-        GolombRiceEncode(bitwriter, m_params.m_P, delta);
+        writer.Encode(m_params.m_P, delta);
         last_value = value;
     }
 
-    bitwriter.Flush();
+    writer.Flush();
 }
 
 bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
@@ -110,12 +155,12 @@ bool GCSFilter::MatchInternal(const uint64_t* element_hashes, size_t size) const
     uint64_t N = ReadCompactSize(stream);
     assert(N == m_N);
 
-    BitStreamReader<SpanReader> bitreader{stream};
+    GolombRiceReader reader{Span{m_encoded}.subspan(m_encoded.size() - stream.size())};
 
     uint64_t value = 0;
     size_t hashes_index = 0;
     for (uint32_t i = 0; i < m_N; ++i) {
-        uint64_t delta = GolombRiceDecode(bitreader, m_params.m_P);
+        uint64_t delta = reader.Decode(m_params.m_P);
         value += delta;
 
         while (true) {
@@ -79,8 +79,7 @@ CBlockIndex* CChain::FindEarliestAtLeast(int64_t nTime, int height) const
 /** Turn the lowest '1' bit in the binary representation of a number into a '0'. */
 int static inline InvertLowestOne(int n) { return n & (n - 1); }
 
-/** Compute what height to jump back to with the CBlockIndex::pskip pointer. */
-int static inline GetSkipHeight(int height) {
+int GetSkipHeight(int height) {
     if (height < 2)
         return 0;
 
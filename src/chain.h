@@ -175,6 +175,9 @@ public:
     //! (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
     arith_uint256 nChainWork{};
 
+    //! (memory only) Sum of the targets of this block and its predecessors in the difficulty window, see GetTargetWindowSum()
+    arith_uint256 nTargetWindowSum{};
+
     //! Number of transactions in this block.
     //! Note: in a potential headers-first mode, this number cannot be relied upon
     //! Note: this value is faked during UTXO snapshot load to ensure that
@@ -213,6 +216,11 @@ public:
     //! (memory only) Maximum nTime in the chain up to and including this block.
     unsigned int nTimeMax{0};
 
+    //! (memory only) Median time past of this block, set by the block manager
+    //! once pprev is known, or 0 if not set.
+    //! @sa GetMedianTimePast
+    uint32_t nMedianTimePast{0};
+
     CBlockIndex()
     {
     }
@@ -293,7 +301,8 @@ public:
 
     static constexpr int nMedianTimeSpan = 11;
 
-    int64_t GetMedianTimePast() const
+    /** Median of the times of this block and the nMedianTimeSpan - 1 blocks before it. */
+    int64_t ComputeMedianTimePast() const
     {
         int64_t pmedian[nMedianTimeSpan];
         int64_t* pbegin = &pmedian[nMedianTimeSpan];
@@ -307,6 +316,11 @@ public:
         return pbegin[(pend - pbegin) / 2];
     }
 
+    int64_t GetMedianTimePast() const
+    {
+        return nMedianTimePast ? int64_t{nMedianTimePast} : ComputeMedianTimePast();
+    }
+
     std::string ToString() const;
 
     //! Check whether this block index entry is valid up to the passed validity level.
@@ -358,6 +372,8 @@ public:
 };
 
 arith_uint256 GetBlockProof(const CBlockIndex& block);
+/** Compute what height to jump back to with the CBlockIndex::pskip pointer. */
+int GetSkipHeight(int height);
 /** Return the time it would take to redo the work difference between from and to, assuming the current hashrate corresponds to the difficulty at tip, in seconds. */
 int64_t GetBlockProofEquivalentTime(const CBlockIndex& to, const CBlockIndex& from, const CBlockIndex& tip, const Consensus::Params&);
 /** Find the forking point between two chain tips. */
@@ -14,6 +14,7 @@
 #include <util/system.h>
 
 #include <assert.h>
+#include <cmath>
 
 static CBlock CreateGenesisBlock(const char* pszTimestamp, const CScript& genesisOutputScript, uint32_t nTime, uint32_t nNonce, uint32_t nBits, int32_t nVersion, const CAmount& genesisReward)
 {
@@ -51,6 +52,26 @@ static CBlock CreateTestGenesisBlock(uint32_t nTime, uint32_t nNonce, uint32_t n
     return CreateGenesisBlock(pszTimestamp, genesisOutputScript, nTime, nNonce, nBits, nVersion, genesisReward);
 }
 
+/**
+ * Headers sync parameters for a chain with the given block spacing.
+ *
+ * Bitcoin's values, a commitment every 584 blocks and a buffer of 13959
+ * headers, were computed for 600-second blocks with the simulation script on
+ * https://gist.github.com/sipa/016ae445c132cdf65a2791534dfb7ae1. A peer
+ * syncing L headers costs about L/period bits of commitments plus 48 bytes
+ * per buffered header, which is minimal for a period proportional to sqrt(L).
+ * The number of headers grows as 1/spacing, so the period is scaled by
+ * sqrt(600/spacing). The buffer keeps ~23.9 commitments, which leaves the
+ * odds of a fake chain passing the redownload unchanged. The resulting memory
+ * and sync time are measured by bench/headers_sync.cpp.
+ */
+static HeadersSyncParams HeadersSyncParamsForSpacing(int64_t pow_target_spacing)
+{
+    assert(pow_target_spacing > 0);
+    const size_t period{static_cast<size_t>(std::llround(584 * std::sqrt(600.0 / pow_target_spacing)))};
+    return HeadersSyncParams{/*commitment_period=*/period, /*redownload_buffer_size=*/period * 13959 / 584};
+}
+
 /**
  * Main network on which people trade goods and services.
  */
@@ -103,6 +124,7 @@ public:
         nPruneAfterHeight = 100000;
         m_assumed_blockchain_size = 496;
         m_assumed_chain_state_size = 6;
+        m_headers_sync_params = HeadersSyncParamsForSpacing(consensus.nPowTargetSpacing);
 
         genesis = CreateGenesisBlock(1585921268, 20253191, 0x1d7fffff, 1, 11922745 * COIN);
         consensus.hashGenesisBlock = genesis.GetHash();
@@ -197,6 +219,7 @@ public:
         nPruneAfterHeight = 1000;
         m_assumed_blockchain_size = 42;
         m_assumed_chain_state_size = 2;
+        m_headers_sync_params = HeadersSyncParamsForSpacing(consensus.nPowTargetSpacing);
 
         genesis = CreateTestGenesisBlock(1585906807, 74527479, 0x1d7fffff, 1, 11919324 * COIN);
         consensus.hashGenesisBlock = genesis.GetHash();
@@ -330,6 +353,7 @@ public:
 
         nDefaultPort = 38333;
         nPruneAfterHeight = 1000;
+        m_headers_sync_params = HeadersSyncParamsForSpacing(consensus.nPowTargetSpacing);
 
         genesis = CreateGenesisBlock(1598918400, 52613770, 0x1e0377ae, 1, 50 * COIN);
         consensus.hashGenesisBlock = genesis.GetHash();
@@ -377,6 +401,7 @@ public:
         consensus.checkpointPubKey = "02dd65a7949c22c405c551637e1e5fdf813e378a61117e6f977c86e09f55a971ca";
         consensus.fPowAllowMinDifficultyBlocks = true;
         consensus.fPowNoRetargeting = true;
+        consensus.fPowSha256d = args.GetBoolArg("-fastpow", false);
         consensus.nRuleChangeActivationThreshold = 108; // 75% for testchains
         consensus.nMinerConfirmationWindow = 144; // Faster than normal for regtest (144 instead of 2016)
 
@@ -401,6 +426,7 @@ public:
         nPruneAfterHeight = args.GetBoolArg("-fastprune", false) ? 100 : 1000;
         m_assumed_blockchain_size = 0;
         m_assumed_chain_state_size = 0;
+        m_headers_sync_params = HeadersSyncParamsForSpacing(consensus.nPowTargetSpacing);
 
         UpdateActivationParametersFromArgs(args);
 
@@ -537,6 +563,9 @@ const CChainParams &Params() {
 
 std::unique_ptr<const CChainParams> CreateChainParams(const ArgsManager& args, const std::string& chain)
 {
+    if (chain != CBaseChainParams::REGTEST && args.GetBoolArg("-fastpow", false)) {
+        throw std::runtime_error(strprintf("-fastpow is only supported on %s.", CBaseChainParams::REGTEST));
+    }
     if (chain == CBaseChainParams::MAIN) {
         return std::unique_ptr<CChainParams>(new CMainParams());
     } else if (chain == CBaseChainParams::TESTNET) {
@@ -553,4 +582,5 @@ void SelectParams(const std::string& network)
 {
     SelectBaseParams(network);
     globalChainParams = CreateChainParams(gArgs, network);
+    g_pow_hash_sha256d = globalChainParams->GetConsensus().fPowSha256d;
 }
@@ -62,6 +62,16 @@ struct ChainTxData {
     double dTxRate;   //!< estimated number of transactions per second after that timestamp
 };
 
+/**
+ * Memory/security trade-off of the headers presync, see HeadersSyncState.
+ */
+struct HeadersSyncParams {
+    //! Distance in blocks between the 1-bit commitments stored during PRESYNC
+    size_t commitment_period;
+    //! Number of redownloaded headers to hold back until they are checked against commitments
+    size_t redownload_buffer_size;
+};
+
 /**
  * CChainParams defines various tweakable parameters of a given instance of the
  * Bitcoin system.
@@ -122,6 +132,7 @@ public:
     const MapAssumeutxo& Assumeutxo() const { return m_assumeutxo_data; }
 
     const ChainTxData& TxData() const { return chainTxData; }
+    const HeadersSyncParams& HeadersSync() const { return m_headers_sync_params; }
 protected:
     CChainParams() {}
 
@@ -131,6 +142,7 @@ protected:
     uint64_t nPruneAfterHeight;
     uint64_t m_assumed_blockchain_size;
     uint64_t m_assumed_chain_state_size;
+    HeadersSyncParams m_headers_sync_params;
     std::vector<std::string> vSeeds;
     std::vector<unsigned char> base58Prefixes[MAX_BASE58_TYPES];
     std::string bech32_hrp;
@@ -51,15 +51,22 @@
 
 #include <key.h>
 #include <key_io.h>
+#include <streams.h>
 #include <txdb.h>
 #include <uint256.h>
 #include <txmempool.h>
 #include <consensus/validation.h>
 #include <consensus/consensus.h>
+#include <util/time.h>
+#include <util/trace.h>
 #include <validation.h>
 
 #include <univalue.h>
 
+#include <atomic>
+#include <deque>
+#include <set>
+
 using namespace std;
 
 // Synchronized checkpoint (centrally broadcasted)
@@ -71,6 +78,69 @@ CSyncCheckpoint checkpointMessagePending;
 uint256 hashInvalidCheckpoint = ArithToUint256(arith_uint256(0));
 RecursiveMutex cs_hashSyncCheckpoint;
 string strCheckpointWarning;
+// Cached -checkpointdepth, see SetCheckpointDepth
+static std::atomic<int> nCheckpointDepth{DEFAULT_AUTOCHECKPOINT};
+static std::atomic<uint64_t> nCheckpointBroadcasts{0};
+static std::atomic<int64_t> nLastSelectMicros{0};
+static std::atomic<int64_t> nLastBroadcastMicros{0};
+static std::atomic<int64_t> nTotalBroadcastMicros{0};
+// Read with std::atomic_load, so CheckSyncCheckpoint needs no lock
+static std::shared_ptr<const SyncCheckpointSnapshot> g_sync_checkpoint_snapshot;
+
+void PublishSyncCheckpoint(const uint256& hashCheckpoint, const CBlockIndex* pindexCheckpoint)
+{
+    auto snapshot = std::make_shared<const SyncCheckpointSnapshot>(SyncCheckpointSnapshot{
+        hashCheckpoint, pindexCheckpoint, pindexCheckpoint ? pindexCheckpoint->nHeight : -1});
+    std::atomic_store(&g_sync_checkpoint_snapshot, std::shared_ptr<const SyncCheckpointSnapshot>(std::move(snapshot)));
+}
+
+std::shared_ptr<const SyncCheckpointSnapshot> GetSyncCheckpointSnapshot()
+{
+    return std::atomic_load(&g_sync_checkpoint_snapshot);
+}
+
+// Read with std::atomic_load by PeerManagerImpl::SendMessages
+static std::shared_ptr<const SyncCheckpointRelay> g_sync_checkpoint_relay;
+
+void RelaySyncCheckpoint(const CSyncCheckpoint& checkpoint)
+{
+    if (checkpoint.IsNull())
+        return;
+    auto relay = std::make_shared<SyncCheckpointRelay>();
+    relay->hashCheckpoint = checkpoint.hashCheckpoint;
+    relay->msg = CNetMsgMaker(PROTOCOL_VERSION).Make(NetMsgType::CHECKPOINT, checkpoint);
+    std::atomic_store(&g_sync_checkpoint_relay, std::shared_ptr<const SyncCheckpointRelay>(std::move(relay)));
+}
+
+std::shared_ptr<const SyncCheckpointRelay> GetSyncCheckpointRelay()
+{
+    return std::atomic_load(&g_sync_checkpoint_relay);
+}
+
+// Hashes of signed checkpoint messages whose signature has been verified, so
+// that duplicates of a checkpoint do not cost a signature verification each
+static const size_t MAX_VERIFIED_CHECKPOINTS = 128;
+static Mutex cs_verifiedCheckpoints;
+static std::set<uint256> setVerifiedCheckpoints GUARDED_BY(cs_verifiedCheckpoints);
+static std::deque<uint256> vVerifiedCheckpoints GUARDED_BY(cs_verifiedCheckpoints);
+
+static bool IsVerifiedCheckpoint(const uint256& hashSigned)
+{
+    LOCK(cs_verifiedCheckpoints);
+    return setVerifiedCheckpoints.count(hashSigned);
+}
+
+static void AddVerifiedCheckpoint(const uint256& hashSigned)
+{
+    LOCK(cs_verifiedCheckpoints);
+    if (!setVerifiedCheckpoints.insert(hashSigned).second)
+        return;
+    vVerifiedCheckpoints.push_back(hashSigned);
+    if (vVerifiedCheckpoints.size() > MAX_VERIFIED_CHECKPOINTS) {
+        setVerifiedCheckpoints.erase(vVerifiedCheckpoints.front());
+        vVerifiedCheckpoints.pop_front();
+    }
+}
 
 // Only descendant of current sync-checkpoint is allowed
 bool ValidateSyncCheckpoint(uint256 hashCheckpoint, Chainstate& chainState)
@@ -119,6 +189,8 @@ bool WriteSyncCheckpoint(const uint256& hashCheckpoint, Chainstate& chainState)
 
     chainState.ForceFlushStateToDisk();
     hashSyncCheckpoint = hashCheckpoint;
+    const auto it = chainState.m_blockman.m_block_index.find(hashCheckpoint);
+    PublishSyncCheckpoint(hashCheckpoint, it != chainState.m_blockman.m_block_index.end() ? &it->second : nullptr);
     return true;
 }
 
@@ -147,12 +219,7 @@ bool AcceptPendingSyncCheckpoint(Chainstate& chainState)
     checkpointMessagePending.SetNull();
 
     // Relay the checkpoint
-    if (g_connman && !checkpointMessage.IsNull())
-    {
-        g_connman->ForEachNode([](CNode* pnode) {
-            checkpointMessage.RelayTo(pnode);
-        });
-    }
+    RelaySyncCheckpoint(checkpointMessage);
 
     return true;
 }
@@ -160,46 +227,34 @@ bool AcceptPendingSyncCheckpoint(Chainstate& chainState)
 // Automatically select a suitable sync-checkpoint
 uint256 AutoSelectSyncCheckpoint(CChain& chain)
 {
-    // Search backward for a block with specified depth policy
-    const CBlockIndex *pindex = chain.Tip();
-    while (pindex->pprev && pindex->nHeight + (int)gArgs.GetIntArg("-checkpointdepth", DEFAULT_AUTOCHECKPOINT) > chain.Tip()->nHeight)
-        pindex = pindex->pprev;
-    return pindex->GetBlockHash();
+    const int64_t nTimeStart = GetTimeMicros();
+    // Select the block with the specified depth policy below the tip; a
+    // negative depth never goes below the tip itself
+    const int nHeight = std::max(0, chain.Height() - std::max(0, GetCheckpointDepth()));
+    const uint256 hashCheckpoint = chain[nHeight]->GetBlockHash();
+    nLastSelectMicros = GetTimeMicros() - nTimeStart;
+    return hashCheckpoint;
 }
 
 // Check against synchronized checkpoint
 bool CheckSyncCheckpoint(const CBlockIndex* pindexNew, Chainstate& chainState)
-{    
-    LOCK(cs_hashSyncCheckpoint);
+{
     assert(pindexNew != NULL);
     if (pindexNew->nHeight == 0)
         return true;
-    const uint256& hashBlock = pindexNew->GetBlockHash();
-    int nHeight = pindexNew->nHeight;
 
     // Checkpoint should always be accepted block
-    assert(chainState.m_blockman.m_block_index.count(hashSyncCheckpoint));
-    const CBlockIndex* pindexSync = &chainState.m_blockman.m_block_index[hashSyncCheckpoint];
-    assert(chainState.m_chain.Contains(pindexSync));
-
-    if (nHeight > pindexSync->nHeight)
-    {
-        // Trace back to same height as sync-checkpoint
-        const CBlockIndex* pindex = pindexNew;
-        while (pindex->nHeight > pindexSync->nHeight && !chainState.m_chain.Contains(pindex))
-            if (!(pindex = pindex->pprev))
-                return error("%s: pprev null - block index structure failure", __func__);
-
-        // At this point we could have:
-        // 1. Found block in our blockchain
-        // 2. Reached pindexSync->nHeight without finding it
-        if (!chainState.m_chain.Contains(pindex))
-            return error("%s: Only descendants of checkpoint accepted", __func__);
-    }
-    if (nHeight == pindexSync->nHeight && hashBlock != hashSyncCheckpoint)
+    const std::shared_ptr<const SyncCheckpointSnapshot> sync = GetSyncCheckpointSnapshot();
+    assert(sync && sync->pindex);
+    assert(chainState.m_chain.Contains(sync->pindex));
+
+    // A block at or above the checkpoint height must descend from the
+    // checkpoint. Blocks below it are in the block index already, as
+    // pindexNew is an entry of it.
+    if (pindexNew->nHeight > sync->nHeight && pindexNew->GetAncestor(sync->nHeight) != sync->pindex)
+        return error("%s: Only descendants of checkpoint accepted", __func__);
+    if (pindexNew->nHeight == sync->nHeight && pindexNew != sync->pindex)
         return error("%s: Same height with sync-checkpoint", __func__);
-    if (nHeight < pindexSync->nHeight && !chainState.m_blockman.m_block_index.count(hashBlock))
-        return error("%s: Lower height than sync-checkpoint", __func__);
     return true;
 }
 
@@ -243,6 +298,26 @@ bool SetCheckpointPrivKey(string strPrivKey)
     return true;
 }
 
+void SetCheckpointDepth(int nDepth)
+{
+    nCheckpointDepth = nDepth;
+}
+
+int GetCheckpointDepth()
+{
+    return nCheckpointDepth;
+}
+
+SyncCheckpointStats GetSyncCheckpointStats()
+{
+    SyncCheckpointStats stats;
+    stats.nBroadcasts = nCheckpointBroadcasts;
+    stats.nLastSelectMicros = nLastSelectMicros;
+    stats.nLastBroadcastMicros = nLastBroadcastMicros;
+    stats.nTotalBroadcastMicros = nTotalBroadcastMicros;
+    return stats;
+}
+
 bool SendSyncCheckpoint(uint256 hashCheckpoint, CConnman* connman, ChainstateManager& chainman)
 {
     // P2P disabled
@@ -257,6 +332,8 @@ bool SendSyncCheckpoint(uint256 hashCheckpoint, CConnman* connman, ChainstateMan
     if (hashCheckpoint == uint256())
         return true;
 
+    const int64_t nTimeStart = GetTimeMicros();
+
     CSyncCheckpoint checkpoint;
     checkpoint.hashCheckpoint = hashCheckpoint;
     CDataStream sMsg(SER_NETWORK, PROTOCOL_VERSION);
@@ -276,43 +353,69 @@ bool SendSyncCheckpoint(uint256 hashCheckpoint, CConnman* connman, ChainstateMan
     if(!checkpoint.ProcessSyncCheckpoint(chainman))
         return error("%s: Failed to process checkpoint.", __func__);
 
-    // Relay checkpoint
-    connman->ForEachNode([checkpoint](CNode* pnode) {
-        checkpoint.RelayTo(pnode);
-    });
-
+    const int64_t nTimeBroadcast = GetTimeMicros() - nTimeStart;
+    ++nCheckpointBroadcasts;
+    nLastBroadcastMicros = nTimeBroadcast;
+    nTotalBroadcastMicros += nTimeBroadcast;
     return true;
 }
 
 // Verify signature of sync-checkpoint message
 bool CSyncCheckpoint::CheckSignature()
 {
-    string strMasterPubKey = Params().GetConsensus().checkpointPubKey;
-    CPubKey key(ParseHex(strMasterPubKey));
-    if (!key.Verify(Hash(vchMsg), vchSig))
-        return error("%s: verify signature failed", __func__);
+    // Cache on the signature too, so a copy with a bad signature is not let through
+    const uint256 hashSigned = Hash(vchMsg, vchSig);
+    if (!IsVerifiedCheckpoint(hashSigned))
+    {
+        string strMasterPubKey = Params().GetConsensus().checkpointPubKey;
+        CPubKey key(ParseHex(strMasterPubKey));
+        if (!key.Verify(GetHash(), vchSig))
+            return error("%s: verify signature failed", __func__);
+        AddVerifiedCheckpoint(hashSigned);
+    }
 
     // Now unserialize the data
-    CDataStream sMsg(vchMsg, SER_NETWORK, PROTOCOL_VERSION);
-    sMsg >> *(CUnsignedSyncCheckpoint*)this;
+    SpanReader{SER_NETWORK, PROTOCOL_VERSION, vchMsg} >> *(CUnsignedSyncCheckpoint*)this;
     return true;
 }
 
+namespace {
+/** Outcome of processing a checkpoint, as passed to the checkpointsync:process_checkpoint tracepoint. */
+enum class CheckpointOutcome : int32_t {
+    ACCEPTED,
+    BAD_SIGNATURE,
+    MISSING_HEADERS,
+    INVALID,
+    PENDING,
+    WRITE_FAILED,
+};
+} // namespace
+
 // Process synchronized checkpoint
 bool CSyncCheckpoint::ProcessSyncCheckpoint(ChainstateManager& chainman)
 {
+    const auto time_start{SteadyClock::now()};
+    const auto traced = [&](CheckpointOutcome outcome) {
+        TRACE3(checkpointsync, process_checkpoint,
+            hashCheckpoint.data(),
+            (int32_t)outcome,
+            Ticks<std::chrono::microseconds>(SteadyClock::now() - time_start)
+        );
+        return outcome == CheckpointOutcome::ACCEPTED;
+    };
+
     if (!CheckSignature())
-        return false;
+        return traced(CheckpointOutcome::BAD_SIGNATURE);
 
     LOCK(cs_hashSyncCheckpoint);
     if (!chainman.BlockIndex().count(hashCheckpoint))
     {
         LogPrintf("%s: Missing headers for received sync-checkpoint %s\n", __func__, hashCheckpoint.ToString());
-        return false;
+        return traced(CheckpointOutcome::MISSING_HEADERS);
     }
 
     if (!ValidateSyncCheckpoint(hashCheckpoint, chainman.ActiveChainstate()))
-        return false;
+        return traced(CheckpointOutcome::INVALID);
 
     bool pass = chainman.ActiveChain().Contains(&chainman.BlockIndex()[hashCheckpoint]);
 
@@ -323,15 +426,18 @@ bool CSyncCheckpoint::ProcessSyncCheckpoint(ChainstateManager& chainman)
         checkpointMessagePending = *this;
         LogPrintf("%s: pending for sync-checkpoint %s\n", __func__, hashCheckpoint.ToString());
 
-        return false;
+        return traced(CheckpointOutcome::PENDING);
     }
 
-    if (!WriteSyncCheckpoint(hashCheckpoint, chainman.ActiveChainstate()))
-        return error("%s: failed to write sync checkpoint %s\n", __func__, hashCheckpoint.ToString());
+    if (!WriteSyncCheckpoint(hashCheckpoint, chainman.ActiveChainstate())) {
+        error("%s: failed to write sync checkpoint %s\n", __func__, hashCheckpoint.ToString());
+        return traced(CheckpointOutcome::WRITE_FAILED);
+    }
 
     checkpointMessage = *this;
     hashPendingCheckpoint = ArithToUint256(arith_uint256(0));
     checkpointMessagePending.SetNull();
+    RelaySyncCheckpoint(checkpointMessage);
 
-    return true;
+    return traced(CheckpointOutcome::ACCEPTED);
 }
@@ -27,6 +27,44 @@ extern uint256 hashInvalidCheckpoint;
 extern RecursiveMutex cs_hashSyncCheckpoint;
 extern std::string strCheckpointWarning;
 
+/** Immutable view of the active sync-checkpoint, published on every change */
+struct SyncCheckpointSnapshot {
+    uint256 hash;
+    //! Block index entry of the checkpoint, nullptr if it is not known
+    const CBlockIndex* pindex;
+    int nHeight;
+};
+
+/** Timing of the automatic checkpoints sent by a checkpoint master */
+struct SyncCheckpointStats {
+    //! Number of checkpoints signed and relayed by SendSyncCheckpoint
+    uint64_t nBroadcasts{0};
+    //! Duration of the last AutoSelectSyncCheckpoint call
+    int64_t nLastSelectMicros{0};
+    //! Duration of the last successful SendSyncCheckpoint call
+    int64_t nLastBroadcastMicros{0};
+    //! Total duration of all successful SendSyncCheckpoint calls
+    int64_t nTotalBroadcastMicros{0};
+};
+
+SyncCheckpointStats GetSyncCheckpointStats();
+
+/** The accepted sync-checkpoint message, serialized once for relay to all peers */
+struct SyncCheckpointRelay {
+    uint256 hashCheckpoint;
+    CSerializedNetMsg msg;
+};
+
+/** Publish checkpoint for relay; peers are sent it from SendMessages */
+void RelaySyncCheckpoint(const CSyncCheckpoint& checkpoint);
+/** Return the checkpoint message to relay, or nullptr if there is none */
+std::shared_ptr<const SyncCheckpointRelay> GetSyncCheckpointRelay();
+
+/** Atomically replace the published sync-checkpoint snapshot */
+void PublishSyncCheckpoint(const uint256& hashCheckpoint, const CBlockIndex* pindexCheckpoint);
+/** Return the current sync-checkpoint snapshot without taking cs_hashSyncCheckpoint */
+std::shared_ptr<const SyncCheckpointSnapshot> GetSyncCheckpointSnapshot();
+
 bool WriteSyncCheckpoint(const uint256& hashCheckpoint, Chainstate& chainState);
 bool AcceptPendingSyncCheckpoint(Chainstate& chainState);
 uint256 AutoSelectSyncCheckpoint(CChain& chain);
@@ -34,6 +72,8 @@ bool CheckSyncCheckpoint(const CBlockIndex* pindexNew, Chainstate& chainState);
 bool ResetSyncCheckpoint(Chainstate& chainState);
 bool CheckCheckpointPubKey(Chainstate& chainState);
 bool SetCheckpointPrivKey(std::string strPrivKey);
+void SetCheckpointDepth(int nDepth);
+int GetCheckpointDepth();
 bool SendSyncCheckpoint(uint256 hashCheckpoint, CConnman* connman, ChainstateManager& chainman);
 bool SetBestChain(CValidationState& state, CBlockIndex* pindexNew);
 
@@ -106,18 +146,6 @@ public:
         return Hash(vchMsg);
     }
 
-    bool RelayTo(CNode* pfrom) const
-    {
-        // returns true if wasn't already sent
-        if (g_connman && pfrom->hashCheckpointKnown != hashCheckpoint)
-        {
-            pfrom->hashCheckpointKnown = hashCheckpoint;
-            g_connman->PushMessage(pfrom, CNetMsgMaker(pfrom->GetCommonVersion()).Make(NetMsgType::CHECKPOINT, *this));
-            return true;
-        }
-        return false;
-    }
-
     bool CheckSignature();
     bool ProcessSyncCheckpoint(ChainstateManager& chainman);
 };
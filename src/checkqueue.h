@@ -7,15 +7,32 @@
 
 #include <sync.h>
 #include <tinyformat.h>
+#include <util/metrics.h>
 #include <util/syscall_sandbox.h>
+#include <util/system.h>
 #include <util/threadnames.h>
 
 #include <algorithm>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <vector>
 
 template <typename T>
 class CCheckQueueControl;
 
+/**
+ * A check type can define a Batch type for work that is cheaper in bulk. The
+ * queue then passes a pointer to one Batch to all the checks it runs in one
+ * go, and only counts them as successful if the Batch's Verify() is too.
+ */
+template <typename T, typename = void>
+struct HasCheckBatch : std::false_type {};
+template <typename T>
+struct HasCheckBatch<T, std::void_t<typename T::Batch>> : std::true_type {};
+
 /**
  * Queue for verifications that have to be performed.
   * The verifications are represented by a type T, which must provide an
@@ -25,11 +42,23 @@ class CCheckQueueControl;
   * onto the queue, where they are processed by N-1 worker threads. When
   * the master is done adding work, it temporarily joins the worker pool
   * as an N'th worker, until all jobs are done.
+  *
+  * Every worker, including the master, has its own deque of checks. The
+  * master spreads the checks it adds over these deques, and a worker takes
+  * from the back of its own deque first and steals from the front of the
+  * others once that is empty. The shared mutex only protects the counters,
+  * so neither adding nor taking checks moves them while holding it.
   */
 template <typename T>
 class CCheckQueue
 {
 private:
+    //! Checks waiting for one worker, which others can steal from
+    struct WorkerQueue {
+        Mutex m_mutex;
+        std::deque<T> m_checks GUARDED_BY(m_mutex);
+    };
+
     //! Mutex to protect the inner state
     Mutex m_mutex;
 
@@ -39,9 +68,15 @@ private:
     //! Master thread blocks on this when out of work
     std::condition_variable m_master_cv;
 
-    //! The queue of elements to be processed.
-    //! As the order of booleans doesn't matter, it is used as a LIFO (stack)
-    std::vector<T> queue GUARDED_BY(m_mutex);
+    //! The deques of elements to be processed, the master's first and then one per worker thread.
+    //! Only resized by StartWorkerThreads, when nothing is queued.
+    std::vector<std::unique_ptr<WorkerQueue>> m_queues;
+
+    //! The deque Add starts with next. Only used by the master.
+    size_t m_next_queue{0};
+
+    //! The number of elements in the deques that no worker has claimed yet.
+    unsigned int nQueued GUARDED_BY(m_mutex){0};
 
     //! The number of workers (including the master) that are idle.
     int nIdle GUARDED_BY(m_mutex){0};
@@ -65,8 +100,36 @@ private:
     std::vector<std::thread> m_worker_threads;
     bool m_request_stop GUARDED_BY(m_mutex){false};
 
+    /**
+     * Move count claimed elements into vChecks, from the back of deque index
+     * and then from the front of the others. Claimed elements are always in
+     * some deque, so this only has to go round again if they were added
+     * behind it while it was looking.
+     */
+    void Take(size_t index, unsigned int count, std::vector<T>& vChecks)
+    {
+        while (vChecks.size() < count) {
+            for (size_t i = 0; i < m_queues.size() && vChecks.size() < count; ++i) {
+                WorkerQueue& worker_queue = *m_queues[(index + i) % m_queues.size()];
+                LOCK(worker_queue.m_mutex);
+                std::deque<T>& checks = worker_queue.m_checks;
+                while (!checks.empty() && vChecks.size() < count) {
+                    // Swap jobs to the local batch vector instead of copying.
+                    vChecks.emplace_back();
+                    if (i == 0) {
+                        vChecks.back().swap(checks.back());
+                        checks.pop_back();
+                    } else {
+                        vChecks.back().swap(checks.front());
+                        checks.pop_front();
+                    }
+                }
+            }
+        }
+    }
+
     /** Internal function that does bulk of the verification work. */
-    bool Loop(bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    bool Loop(size_t index, bool fMaster) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         std::condition_variable& cond = fMaster ? m_master_cv : m_worker_cv;
         std::vector<T> vChecks;
@@ -88,7 +151,7 @@ private:
                     nTotal++;
                 }
                 // logically, the do loop starts here
-                while (queue.empty() && !m_request_stop) {
+                while (nQueued == 0 && !m_request_stop) {
                     if (fMaster && nTodo == 0) {
                         nTotal--;
                         bool fRet = fAllOk;
@@ -110,21 +173,29 @@ private:
                 //   all workers finish approximately simultaneously.
                 // * Try to account for idle jobs which will instantly start helping.
                 // * Don't do batches smaller than 1 (duh), or larger than nBatchSize.
-                nNow = std::max(1U, std::min(nBatchSize, (unsigned int)queue.size() / (nTotal + nIdle + 1)));
-                vChecks.resize(nNow);
-                for (unsigned int i = 0; i < nNow; i++) {
-                    // We want the lock on the m_mutex to be as short as possible, so swap jobs from the global
-                    // queue to the local batch vector instead of copying.
-                    vChecks[i].swap(queue.back());
-                    queue.pop_back();
-                }
+                nNow = std::max(1U, std::min(nBatchSize, nQueued / (nTotal + nIdle + 1)));
+                // Claim them here, and move them out of the deques without holding m_mutex
+                nQueued -= nNow;
                 // Check whether we need to do work at all
                 fOk = fAllOk;
             }
+            Take(index, nNow, vChecks);
+            const auto start{std::chrono::steady_clock::now()};
             // execute work
-            for (T& check : vChecks)
+            if constexpr (HasCheckBatch<T>::value) {
+                typename T::Batch batch;
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check(&batch);
                 if (fOk)
-                    fOk = check();
+                    fOk = batch.Verify();
+            } else {
+                for (T& check : vChecks)
+                    if (fOk)
+                        fOk = check();
+            }
+            Metrics().checkqueue_checks.Add(vChecks.size());
+            Metrics().checkqueue_busy_micros.Add(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
             vChecks.clear();
         } while (true);
     }
@@ -137,10 +208,14 @@ public:
     explicit CCheckQueue(unsigned int nBatchSizeIn)
         : nBatchSize(nBatchSizeIn)
     {
+        m_queues.push_back(std::make_unique<WorkerQueue>());
     }
 
-    //! Create a pool of new worker threads.
-    void StartWorkerThreads(const int threads_num) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    //! Create a pool of new worker threads, named <thread_name>.<n> and running under the given sandbox policy,
+    //! at batch scheduling priority if batch_priority is set.
+    void StartWorkerThreads(const int threads_num, const std::string& thread_name = "scriptch",
+                            const SyscallSandboxPolicy policy = SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK,
+                            const bool batch_priority = false) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         {
             LOCK(m_mutex);
@@ -149,11 +224,17 @@ public:
             fAllOk = true;
         }
         assert(m_worker_threads.empty());
+        m_queues.resize(1);
+        m_next_queue = 0;
         for (int n = 0; n < threads_num; ++n) {
-            m_worker_threads.emplace_back([this, n]() {
-                util::ThreadRename(strprintf("scriptch.%i", n));
-                SetSyscallSandboxPolicy(SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK);
-                Loop(false /* worker thread */);
+            m_queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (int n = 0; n < threads_num; ++n) {
+            m_worker_threads.emplace_back([this, n, thread_name, policy, batch_priority]() {
+                util::ThreadRename(strprintf("%s.%i", thread_name, n));
+                if (batch_priority) ScheduleBatchPriority();
+                SetSyscallSandboxPolicy(policy);
+                Loop(n + 1, false /* worker thread */);
             });
         }
     }
@@ -161,7 +242,7 @@ public:
     //! Wait until execution finishes, and return whether all evaluations were successful.
     bool Wait() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        return Loop(true /* master thread */);
+        return Loop(0, true /* master thread */);
     }
 
     //! Add a batch of checks to the queue
@@ -171,12 +252,21 @@ public:
             return;
         }
 
+        // Hand out the checks in slices of up to nBatchSize, one deque after the other
+        for (size_t begin = 0; begin < vChecks.size(); begin += nBatchSize) {
+            const size_t end = std::min<size_t>(vChecks.size(), begin + nBatchSize);
+            WorkerQueue& worker_queue = *m_queues[m_next_queue];
+            m_next_queue = (m_next_queue + 1) % m_queues.size();
+            LOCK(worker_queue.m_mutex);
+            for (size_t i = begin; i < end; ++i) {
+                worker_queue.m_checks.emplace_back();
+                vChecks[i].swap(worker_queue.m_checks.back());
+            }
+        }
+
         {
             LOCK(m_mutex);
-            for (T& check : vChecks) {
-                queue.emplace_back();
-                check.swap(queue.back());
-            }
+            nQueued += vChecks.size();
             nTodo += vChecks.size();
         }
 
@@ -4,6 +4,7 @@
 
 #include <common/bloom.h>
 
+#include <crypto/siphash.h>
 #include <hash.h>
 #include <primitives/transaction.h>
 #include <random.h>
@@ -17,6 +18,7 @@
 #include <cmath>
 #include <cstdlib>
 #include <limits>
+#include <utility>
 #include <vector>
 
 static constexpr double LN2SQUARED = 0.4804530139182014246671025263266649717305529515945455;
@@ -186,10 +188,15 @@ CRollingBloomFilter::CRollingBloomFilter(const unsigned int nElements, const dou
     reset();
 }
 
-/* Similar to CBloomFilter::Hash */
-static inline uint32_t RollingBloomHash(unsigned int nHashNum, uint32_t nTweak, Span<const unsigned char> vDataToHash)
+/* Unlike CBloomFilter, whose hash functions are part of BIP37, the rolling
+ * filter hashes a key once. Its nHashFuncs positions are h1 + n * h2 for the
+ * two halves of the SipHash (double hashing), which is as good as independent
+ * hash functions for the false positive rate. */
+static inline std::pair<uint32_t, uint32_t> RollingBloomHash(uint64_t k0, uint64_t k1, Span<const unsigned char> vDataToHash)
 {
-    return MurmurHash3(nHashNum * 0xFBA4C795 + nTweak, vDataToHash);
+    const uint64_t hash = CSipHasher(k0, k1).Write(vDataToHash.data(), vDataToHash.size()).Finalize();
+    // Make h2 odd so that the positions of a key do not repeat.
+    return {uint32_t(hash), uint32_t(hash >> 32) | 1};
 }
 
 void CRollingBloomFilter::insert(Span<const unsigned char> vKey)
@@ -212,8 +219,9 @@ void CRollingBloomFilter::insert(Span<const unsigned char> vKey)
     }
     nEntriesThisGeneration++;
 
+    const auto [h1, h2] = RollingBloomHash(m_k0, m_k1, vKey);
     for (int n = 0; n < nHashFuncs; n++) {
-        uint32_t h = RollingBloomHash(n, nTweak, vKey);
+        uint32_t h = h1 + n * h2;
         int bit = h & 0x3F;
         /* FastMod works with the upper bits of h, so it is safe to ignore that the lower bits of h are already used for bit. */
         uint32_t pos = FastRange32(h, data.size());
@@ -225,8 +233,9 @@ void CRollingBloomFilter::insert(Span<const unsigned char> vKey)
 
 bool CRollingBloomFilter::contains(Span<const unsigned char> vKey) const
 {
+    const auto [h1, h2] = RollingBloomHash(m_k0, m_k1, vKey);
     for (int n = 0; n < nHashFuncs; n++) {
-        uint32_t h = RollingBloomHash(n, nTweak, vKey);
+        uint32_t h = h1 + n * h2;
         int bit = h & 0x3F;
         uint32_t pos = FastRange32(h, data.size());
         /* If the relevant bit is not set in either data[pos & ~1] or data[pos | 1], the filter does not contain vKey */
@@ -239,7 +248,8 @@ bool CRollingBloomFilter::contains(Span<const unsigned char> vKey) const
 
 void CRollingBloomFilter::reset()
 {
-    nTweak = GetRand<unsigned int>();
+    m_k0 = GetRand<uint64_t>();
+    m_k1 = GetRand<uint64_t>();
     nEntriesThisGeneration = 0;
     nGeneration = 1;
     std::fill(data.begin(), data.end(), 0);
@@ -120,7 +120,8 @@ private:
     int nEntriesThisGeneration;
     int nGeneration;
     std::vector<uint64_t> data;
-    unsigned int nTweak;
+    //! Salt of the SipHash all of nHashFuncs positions of a key are derived from
+    uint64_t m_k0, m_k1;
     int nHashFuncs;
 };
 
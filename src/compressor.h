@@ -6,7 +6,9 @@
 #ifndef BITCOIN_COMPRESSOR_H
 #define BITCOIN_COMPRESSOR_H
 
+#include <consensus/amount.h>
 #include <prevector.h>
+#include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <script/script.h>
 #include <serialize.h>
@@ -115,4 +117,89 @@ struct TxOutCompression
     FORMATTER_METHODS(CTxOut, obj) { READWRITE(Using<AmountCompression>(obj.nValue), Using<ScriptCompression>(obj.scriptPubKey)); }
 };
 
+/** Transaction input in compressed block files, with VARINTs and nSequence inverted so that final values take one byte. */
+struct CompressedTxInFormatter
+{
+    template <typename Stream>
+    void Ser(Stream& s, const CTxIn& in)
+    {
+        s << in.prevout.hash << VARINT(in.prevout.n) << in.scriptSig << VARINT(~in.nSequence);
+    }
+
+    template <typename Stream>
+    void Unser(Stream& s, CTxIn& in)
+    {
+        s >> in.prevout.hash >> VARINT(in.prevout.n) >> in.scriptSig >> VARINT(in.nSequence);
+        in.nSequence = ~in.nSequence;
+    }
+};
+
+/**
+ * Compact serialization of transactions, for compressed block files.
+ *
+ * Integers are stored as VARINTs, and outputs as in the UTXO set. Outputs that
+ * TxOutCompression cannot restore exactly, with an amount outside of the
+ * money range or an oversized script, make the transaction store its
+ * outputs in the regular format instead, so the transaction hash is always
+ * preserved.
+ */
+struct CompressedTxFormatter
+{
+    static constexpr uint8_t FLAG_WITNESS{1};
+    static constexpr uint8_t FLAG_RAW_OUTPUTS{2};
+
+    template <typename Stream>
+    void Ser(Stream& s, const CTransactionRef& tx)
+    {
+        uint8_t flags{0};
+        if (tx->HasWitness()) flags |= FLAG_WITNESS;
+        for (const CTxOut& out : tx->vout) {
+            if (!MoneyRange(out.nValue) || out.scriptPubKey.size() > MAX_SCRIPT_SIZE) flags |= FLAG_RAW_OUTPUTS;
+        }
+        s << VARINT(static_cast<uint32_t>(tx->nVersion)) << flags;
+        s << Using<VectorFormatter<CompressedTxInFormatter>>(tx->vin);
+        if (flags & FLAG_RAW_OUTPUTS) {
+            s << tx->vout;
+        } else {
+            s << Using<VectorFormatter<TxOutCompression>>(tx->vout);
+        }
+        if (flags & FLAG_WITNESS) {
+            for (const CTxIn& in : tx->vin) s << in.scriptWitness.stack;
+        }
+        s << VARINT(tx->nLockTime);
+    }
+
+    template <typename Stream>
+    void Unser(Stream& s, CTransactionRef& tx)
+    {
+        CMutableTransaction mtx;
+        uint32_t version;
+        uint8_t flags;
+        s >> VARINT(version) >> flags;
+        if (flags & ~(FLAG_WITNESS | FLAG_RAW_OUTPUTS)) throw std::ios_base::failure("Unknown compressed transaction flags");
+        mtx.nVersion = static_cast<int32_t>(version);
+        s >> Using<VectorFormatter<CompressedTxInFormatter>>(mtx.vin);
+        if (flags & FLAG_RAW_OUTPUTS) {
+            s >> mtx.vout;
+        } else {
+            s >> Using<VectorFormatter<TxOutCompression>>(mtx.vout);
+        }
+        if (flags & FLAG_WITNESS) {
+            for (CTxIn& in : mtx.vin) s >> in.scriptWitness.stack;
+        }
+        s >> VARINT(mtx.nLockTime);
+        tx = MakeTransactionRef(std::move(mtx));
+    }
+};
+
+/** Compact serialization of blocks, the header followed by CompressedTxFormatter transactions. */
+struct CompressedBlockFormatter
+{
+    FORMATTER_METHODS(CBlock, obj)
+    {
+        READWRITEAS(CBlockHeader, obj);
+        READWRITE(Using<VectorFormatter<CompressedTxFormatter>>(obj.vtx));
+    }
+};
+
 #endif // BITCOIN_COMPRESSOR_H
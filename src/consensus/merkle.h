@@ -24,4 +24,23 @@ uint256 BlockMerkleRoot(const CBlock& block, bool* mutated = nullptr);
  */
 uint256 BlockWitnessMerkleRoot(const CBlock& block, bool* mutated = nullptr);
 
+/*
+ * Compute the Merkle branch of the leaf at the given position: the hashes that
+ * together with the leaf reproduce the Merkle root, from the bottom up.
+ */
+std::vector<uint256> ComputeMerkleBranch(std::vector<uint256> hashes, uint32_t position);
+
+/*
+ * Compute the Merkle root from the leaf at the given position and its branch,
+ * as returned by ComputeMerkleBranch().
+ */
+uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& branch, uint32_t position);
+
+/*
+ * Compute the Merkle branch of the transaction at the given position in a
+ * block. The branch of position 0 does not depend on the coinbase, so miners
+ * can recompute the root for any coinbase they construct.
+ */
+std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position);
+
 #endif // BITCOIN_CONSENSUS_MERKLE_H
@@ -109,6 +109,8 @@ struct Params {
     std::string checkpointPubKey;
     bool fPowAllowMinDifficultyBlocks;
     bool fPowNoRetargeting;
+    /** Whether the proof-of-work hash is the SHA256d block hash instead of NeoScrypt (regtest-only, see -fastpow) */
+    bool fPowSha256d{false};
     int64_t nPowTargetSpacing;
     int64_t nPowTargetTimespan;
     std::chrono::seconds PowTargetSpacing() const
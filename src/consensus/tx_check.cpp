@@ -7,8 +7,40 @@
 #include <consensus/amount.h>
 #include <primitives/transaction.h>
 #include <consensus/validation.h>
+#include <span.h>
+
+#include <algorithm>
+
+/** Inputs of at most this many are compared pairwise, rather than sorted, to look for duplicates */
+static constexpr size_t MAX_PAIRWISE_DUPLICATE_CHECK{8};
+
+static bool HasDuplicateInputs(Span<const CTxIn> inputs, std::vector<COutPoint>& scratch)
+{
+    if (inputs.size() <= MAX_PAIRWISE_DUPLICATE_CHECK) {
+        for (size_t i = 1; i < inputs.size(); ++i) {
+            for (size_t j = 0; j < i; ++j) {
+                if (inputs[i].prevout == inputs[j].prevout) return true;
+            }
+        }
+        return false;
+    }
+
+    scratch.clear();
+    scratch.reserve(inputs.size());
+    for (const CTxIn& txin : inputs) {
+        scratch.push_back(txin.prevout);
+    }
+    std::sort(scratch.begin(), scratch.end());
+    return std::adjacent_find(scratch.begin(), scratch.end()) != scratch.end();
+}
 
 bool CheckTransaction(const CTransaction& tx, TxValidationState& state)
+{
+    std::vector<COutPoint> scratch;
+    return CheckTransaction(tx, state, scratch);
+}
+
+bool CheckTransaction(const CTransaction& tx, TxValidationState& state, std::vector<COutPoint>& scratch)
 {
     // Basic checks that don't depend on any context
     if (tx.vin.empty())
@@ -16,7 +48,7 @@ bool CheckTransaction(const CTransaction& tx, TxValidationState& state)
     if (tx.vout.empty())
         return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-vout-empty");
     // Size limits (this doesn't take the witness into account, as that hasn't been checked for malleability)
-    if (::GetSerializeSize(tx, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT)
+    if (tx.GetStrippedSize() * WITNESS_SCALE_FACTOR > MAX_BLOCK_WEIGHT)
         return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-oversize");
 
     // Check for negative or overflow output values (see CVE-2010-5139)
@@ -37,15 +69,15 @@ bool CheckTransaction(const CTransaction& tx, TxValidationState& state)
     // of a tx as spent, it does not check if the tx has duplicate inputs.
     // Failure to run this check will result in either a crash or an inflation bug, depending on the implementation of
     // the underlying coins database.
-    std::set<COutPoint> vInOutPoints;
-    for (const auto& txin : tx.vin) {
-        if (!vInOutPoints.insert(txin.prevout).second)
-            return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-inputs-duplicate");
-
-        if(txin.prevout == COutPoint(uint256S("2e3cac6c9c4283caae1d11a575bbf9bdce153a35d537917c63a2f3f995983fd8"), 312)) {
-            return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-inputs-blocked");
-        }
-    }
+    static const COutPoint BLOCKED_OUTPOINT{uint256S("2e3cac6c9c4283caae1d11a575bbf9bdce153a35d537917c63a2f3f995983fd8"), 312};
+    // An input spending the blocked outpoint is only reported when no
+    // duplicate comes before it, so only the inputs up to it are looked at.
+    const auto blocked{std::find_if(tx.vin.begin(), tx.vin.end(), [](const CTxIn& txin) { return txin.prevout == BLOCKED_OUTPOINT; })};
+    const size_t inputs_to_check = blocked == tx.vin.end() ? tx.vin.size() : blocked - tx.vin.begin() + 1;
+    if (HasDuplicateInputs(Span{tx.vin}.first(inputs_to_check), scratch))
+        return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-inputs-duplicate");
+    if (blocked != tx.vin.end())
+        return state.Invalid(TxValidationResult::TX_CONSENSUS, "bad-txns-inputs-blocked");
 
     if (tx.IsCoinBase())
     {
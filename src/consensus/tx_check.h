@@ -12,9 +12,17 @@
  * belongs in tx_verify.h/cpp instead.
  */
 
+#include <vector>
+
+class COutPoint;
 class CTransaction;
 class TxValidationState;
 
 bool CheckTransaction(const CTransaction& tx, TxValidationState& state);
+/**
+ * Same as above, with \p scratch used as memory to look for duplicate inputs.
+ * Callers checking many transactions can pass the same one to each call.
+ */
+bool CheckTransaction(const CTransaction& tx, TxValidationState& state, std::vector<COutPoint>& scratch);
 
 #endif // BITCOIN_CONSENSUS_TX_CHECK_H
@@ -142,7 +142,7 @@ static bool DecodeTx(CMutableTransaction& tx, const std::vector<unsigned char>&
     // Try decoding with extended serialization support, and remember if the result successfully
     // consumes the entire input.
     if (try_witness) {
-        CDataStream ssData(tx_data, SER_NETWORK, PROTOCOL_VERSION);
+        SpanReader ssData{SER_NETWORK, PROTOCOL_VERSION, tx_data};
         try {
             ssData >> tx_extended;
             if (ssData.empty()) ok_extended = true;
@@ -160,7 +160,7 @@ static bool DecodeTx(CMutableTransaction& tx, const std::vector<unsigned char>&
 
     // Try decoding with legacy serialization, and remember if the result successfully consumes the entire input.
     if (try_no_witness) {
-        CDataStream ssData(tx_data, SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+        SpanReader ssData{SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS, tx_data};
         try {
             ssData >> tx_legacy;
             if (ssData.empty()) ok_legacy = true;
@@ -207,7 +207,7 @@ bool DecodeHexBlockHeader(CBlockHeader& header, const std::string& hex_header)
     if (!IsHex(hex_header)) return false;
 
     const std::vector<unsigned char> header_data{ParseHex(hex_header)};
-    CDataStream ser_header(header_data, SER_NETWORK, PROTOCOL_VERSION);
+    SpanReader ser_header{SER_NETWORK, PROTOCOL_VERSION, header_data};
     try {
         ser_header >> header;
     } catch (const std::exception&) {
@@ -222,7 +222,7 @@ bool DecodeHexBlk(CBlock& block, const std::string& strHexBlk)
         return false;
 
     std::vector<unsigned char> blockData(ParseHex(strHexBlk));
-    CDataStream ssBlock(blockData, SER_NETWORK, PROTOCOL_VERSION);
+    SpanReader ssBlock{SER_NETWORK, PROTOCOL_VERSION, blockData};
     try {
         ssBlock >> block;
     }
@@ -8,8 +8,67 @@
 #include <crypto/common.h>
 #include <crypto/chacha20.h>
 
+#include <compat/cpuid.h>
+
+#include <assert.h>
 #include <string.h>
 
+#if defined(__linux__) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__))
+namespace chacha20_sse2
+{
+void Blocks_4way(const uint32_t* input, const unsigned char* m, unsigned char* c);
+}
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+namespace chacha20_neon
+{
+void Blocks_4way(const uint32_t* input, const unsigned char* m, unsigned char* c);
+}
+#endif
+
+namespace chacha20_avx2
+{
+void Blocks_8way(const uint32_t* input, const unsigned char* m, unsigned char* c);
+}
+
+namespace chacha20_avx512
+{
+void Blocks_16way(const uint32_t* input, const unsigned char* m, unsigned char* c);
+}
+
+namespace {
+typedef void (*BlocksFn)(const uint32_t* input, const unsigned char* m, unsigned char* c);
+
+//! Multi-block implementation, and the number of blocks it computes at once
+BlocksFn Blocks = nullptr;
+size_t BlocksLanes = 0;
+
+/**
+ * Run the multi-block implementation over the whole groups of blocks in
+ * bytes, advancing the block counter. Returns the number of bytes done, the
+ * rest is left to the single-block code.
+ */
+size_t MultiBlock(uint32_t input[16], const unsigned char* m, unsigned char* c, size_t bytes)
+{
+    if (!Blocks) return 0;
+    const size_t group{64 * BlocksLanes};
+    size_t done{0};
+    for (; bytes - done >= group; done += group) {
+        Blocks(input, m ? m + done : nullptr, c + done);
+        const uint64_t counter{(input[12] | (uint64_t{input[13]} << 32)) + BlocksLanes};
+        input[12] = uint32_t(counter);
+        input[13] = uint32_t(counter >> 32);
+    }
+    return done;
+}
+} // namespace
+
 constexpr static inline uint32_t rotl32(uint32_t v, int c) { return (v << c) | (v >> (32 - c)); }
 
 #define QUARTERROUND(a,b,c,d) \
@@ -81,6 +140,10 @@ void ChaCha20::Keystream(unsigned char* c, size_t bytes)
     unsigned char tmp[64];
     unsigned int i;
 
+    if (!bytes) return;
+    const size_t multi_block{MultiBlock(input, nullptr, c, bytes)};
+    c += multi_block;
+    bytes -= multi_block;
     if (!bytes) return;
 
     j0 = input[0];
@@ -192,6 +255,11 @@ void ChaCha20::Crypt(const unsigned char* m, unsigned char* c, size_t bytes)
     unsigned char tmp[64];
     unsigned int i;
 
+    if (!bytes) return;
+    const size_t multi_block{MultiBlock(input, m, c, bytes)};
+    m += multi_block;
+    c += multi_block;
+    bytes -= multi_block;
     if (!bytes) return;
 
     j0 = input[0];
@@ -316,3 +384,108 @@ void ChaCha20::Crypt(const unsigned char* m, unsigned char* c, size_t bytes)
         m += 64;
     }
 }
+
+namespace {
+bool SelfTest()
+{
+    unsigned char key[32];
+    for (size_t i = 0; i < sizeof(key); ++i) key[i] = (unsigned char)(i * 37 + 1);
+    unsigned char message[16 * 64 + 17];
+    for (size_t i = 0; i < sizeof(message); ++i) message[i] = (unsigned char)(i * 11 + (i >> 6));
+
+    // Start just below a carry into the high word of the block counter
+    auto run = [&](unsigned char* keystream, unsigned char* ciphertext) {
+        ChaCha20 chacha{key, sizeof(key)};
+        chacha.SetIV(0x0706050403020100);
+        chacha.Seek(0xfffffffd);
+        chacha.Keystream(keystream, sizeof(message));
+        chacha.Crypt(message, ciphertext, sizeof(message));
+    };
+    unsigned char expected_keystream[sizeof(message)], expected_ciphertext[sizeof(message)];
+    const BlocksFn blocks{Blocks};
+    Blocks = nullptr;
+    run(expected_keystream, expected_ciphertext);
+    Blocks = blocks;
+
+    unsigned char keystream[sizeof(message)], ciphertext[sizeof(message)];
+    run(keystream, ciphertext);
+    return !memcmp(keystream, expected_keystream, sizeof(message)) && !memcmp(ciphertext, expected_ciphertext, sizeof(message));
+}
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Return the state components enabled by the OS in XCR0. */
+uint32_t EnabledXCR0()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return a;
+}
+#endif
+} // namespace
+
+std::string ChaCha20AutoDetect()
+{
+    std::string ret = "standard";
+    Blocks = nullptr;
+    BlocksLanes = 0;
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    [[maybe_unused]] bool enabled_avx = false;
+    [[maybe_unused]] bool enabled_avx512 = false;
+    [[maybe_unused]] bool have_avx2 = false;
+    [[maybe_unused]] bool have_avx512 = false;
+
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        const uint32_t xcr0{EnabledXCR0()};
+        enabled_avx = (xcr0 & 0x06) == 0x06;
+        enabled_avx512 = (xcr0 & 0xE6) == 0xE6;
+    }
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (eax >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        have_avx512 = ((ebx >> 16) & 1) && ((ebx >> 31) & 1);
+    }
+
+#if defined(__x86_64__) || defined(__amd64__)
+    Blocks = chacha20_sse2::Blocks_4way;
+    BlocksLanes = 4;
+    ret = "sse2(4way)";
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && enabled_avx) {
+        Blocks = chacha20_avx2::Blocks_8way;
+        BlocksLanes = 8;
+        ret = "avx2(8way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx512 && enabled_avx512) {
+        Blocks = chacha20_avx512::Blocks_16way;
+        BlocksLanes = 16;
+        ret = "avx512(16way)";
+    }
+#endif
+#endif // defined(USE_ASM) && defined(HAVE_GETCPUID)
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    // Advanced SIMD is mandatory on AArch64, but honour a kernel that hides it.
+    bool have_neon = true;
+#if defined(__linux__)
+    have_neon = getauxval(AT_HWCAP) & HWCAP_ASIMD;
+#endif
+    if (have_neon) {
+        Blocks = chacha20_neon::Blocks_4way;
+        BlocksLanes = 4;
+        ret = "neon(4way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
@@ -7,6 +7,12 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string>
+
+/** Autodetect the best available multi-block ChaCha20 implementation.
+ *  Returns the name of the implementation.
+ */
+std::string ChaCha20AutoDetect();
 
 /** A class for ChaCha20 256-bit stream cipher developed by Daniel J. Bernstein
     https://cr.yp.to/chacha/chacha-20080128.pdf */
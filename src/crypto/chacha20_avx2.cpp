@@ -0,0 +1,47 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <crypto/chacha20_lanes.h>
+
+#include <cstdint>
+#include <immintrin.h>
+
+namespace chacha20_avx2 {
+namespace {
+
+struct Ops {
+    using Vec = __m256i;
+    static constexpr size_t LANES{8};
+
+    static inline Vec Add(Vec x, Vec y) { return _mm256_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x)
+    {
+        if constexpr (n == 16) {
+            return _mm256_shuffle_epi8(x, _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13));
+        } else if constexpr (n == 8) {
+            return _mm256_shuffle_epi8(x, _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                                           3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14));
+        } else {
+            return _mm256_or_si256(_mm256_slli_epi32(x, n), _mm256_srli_epi32(x, 32 - n));
+        }
+    }
+    static inline Vec Load(const uint32_t* p) { return _mm256_load_si256((const __m256i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm256_store_si256((__m256i*)p, x); }
+};
+
+} // namespace
+
+void Blocks_8way(const uint32_t* input, const unsigned char* m, unsigned char* c)
+{
+    chacha20_lanes::Engine<Ops>::Blocks(input, m, c);
+}
+
+} // namespace chacha20_avx2
+
+#endif
@@ -0,0 +1,36 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX512
+
+#include <crypto/chacha20_lanes.h>
+
+#include <cstdint>
+#include <immintrin.h>
+
+namespace chacha20_avx512 {
+namespace {
+
+struct Ops {
+    using Vec = __m512i;
+    static constexpr size_t LANES{16};
+
+    static inline Vec Add(Vec x, Vec y) { return _mm512_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm512_xor_si512(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x) { return _mm512_rol_epi32(x, n); }
+    static inline Vec Load(const uint32_t* p) { return _mm512_load_si512((const void*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm512_store_si512((void*)p, x); }
+};
+
+} // namespace
+
+void Blocks_16way(const uint32_t* input, const unsigned char* m, unsigned char* c)
+{
+    chacha20_lanes::Engine<Ops>::Blocks(input, m, c);
+}
+
+} // namespace chacha20_avx512
+
+#endif
@@ -0,0 +1,86 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_CHACHA20_LANES_H
+#define BITCOIN_CRYPTO_CHACHA20_LANES_H
+
+#include <crypto/common.h>
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Multi-block ChaCha20 keystream.
+ *
+ * Ops::LANES consecutive blocks of one stream are computed in lockstep: every
+ * vector holds the same 32-bit state word of all blocks, which differ only in
+ * their block counter. The words are transposed back into blocks when they
+ * are written out.
+ *
+ * This header is only to be included by the instruction set specific
+ * chacha20_*.cpp files, each of which instantiates Blocks() with its own Ops.
+ */
+namespace chacha20_lanes {
+namespace {
+
+template <typename Ops>
+struct Engine {
+    using Vec = typename Ops::Vec;
+    static constexpr size_t LANES{Ops::LANES};
+
+    template <int n>
+    static inline Vec Rotl(Vec x) { return Ops::template Rotl<n>(x); }
+
+    static inline void Quarter(Vec& a, Vec& b, Vec& c, Vec& d)
+    {
+        a = Ops::Add(a, b); d = Rotl<16>(Ops::Xor(d, a));
+        c = Ops::Add(c, d); b = Rotl<12>(Ops::Xor(b, c));
+        a = Ops::Add(a, b); d = Rotl<8>(Ops::Xor(d, a));
+        c = Ops::Add(c, d); b = Rotl<7>(Ops::Xor(b, c));
+    }
+
+    /**
+     * Write LANES blocks of keystream, starting at the block counter in
+     * input[12..13], into c, or XOR them with m into c if m is not null.
+     */
+    static void Blocks(const uint32_t input[16], const unsigned char* m, unsigned char* c)
+    {
+        alignas(64) uint32_t words[16][LANES];
+        const uint64_t counter{input[12] | (uint64_t{input[13]} << 32)};
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            for (int i = 0; i < 16; ++i) words[i][lane] = input[i];
+            words[12][lane] = uint32_t(counter + lane);
+            words[13][lane] = uint32_t((counter + lane) >> 32);
+        }
+
+        Vec j[16], x[16];
+        for (int i = 0; i < 16; ++i) x[i] = j[i] = Ops::Load(words[i]);
+        for (int round = 0; round < 20; round += 2) {
+            Quarter(x[0], x[4], x[8], x[12]);
+            Quarter(x[1], x[5], x[9], x[13]);
+            Quarter(x[2], x[6], x[10], x[14]);
+            Quarter(x[3], x[7], x[11], x[15]);
+            Quarter(x[0], x[5], x[10], x[15]);
+            Quarter(x[1], x[6], x[11], x[12]);
+            Quarter(x[2], x[7], x[8], x[13]);
+            Quarter(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) Ops::Store(words[i], Ops::Add(x[i], j[i]));
+
+        for (size_t lane = 0; lane < LANES; ++lane) {
+            unsigned char* out{c + 64 * lane};
+            if (m) {
+                const unsigned char* in{m + 64 * lane};
+                for (int i = 0; i < 16; ++i) WriteLE32(out + 4 * i, words[i][lane] ^ ReadLE32(in + 4 * i));
+            } else {
+                for (int i = 0; i < 16; ++i) WriteLE32(out + 4 * i, words[i][lane]);
+            }
+        }
+    }
+};
+
+} // namespace
+} // namespace chacha20_lanes
+
+#endif // BITCOIN_CRYPTO_CHACHA20_LANES_H
@@ -0,0 +1,43 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+#include <crypto/chacha20_lanes.h>
+
+#include <arm_neon.h>
+#include <cstdint>
+
+namespace chacha20_neon {
+namespace {
+
+struct Ops {
+    using Vec = uint32x4_t;
+    static constexpr size_t LANES{4};
+
+    static inline Vec Add(Vec x, Vec y) { return vaddq_u32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return veorq_u32(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x)
+    {
+        if constexpr (n == 16) {
+            return vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(x)));
+        } else {
+            return vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - n);
+        }
+    }
+    static inline Vec Load(const uint32_t* p) { return vld1q_u32(p); }
+    static inline void Store(uint32_t* p, Vec x) { vst1q_u32(p, x); }
+};
+
+} // namespace
+
+void Blocks_4way(const uint32_t* input, const unsigned char* m, unsigned char* c)
+{
+    chacha20_lanes::Engine<Ops>::Blocks(input, m, c);
+}
+
+} // namespace chacha20_neon
+
+#endif
@@ -0,0 +1,36 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include <crypto/chacha20_lanes.h>
+
+#include <cstdint>
+#include <emmintrin.h>
+
+namespace chacha20_sse2 {
+namespace {
+
+struct Ops {
+    using Vec = __m128i;
+    static constexpr size_t LANES{4};
+
+    static inline Vec Add(Vec x, Vec y) { return _mm_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+    static inline Vec Load(const uint32_t* p) { return _mm_load_si128((const __m128i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm_store_si128((__m128i*)p, x); }
+};
+
+} // namespace
+
+void Blocks_4way(const uint32_t* input, const unsigned char* m, unsigned char* c)
+{
+    chacha20_lanes::Engine<Ops>::Blocks(input, m, c);
+}
+
+} // namespace chacha20_sse2
+
+#endif
@@ -2176,6 +2176,27 @@ void neoscrypt_fastkdf_opt(const unsigned char *password, const unsigned char *s
 #endif /* !(OPT) */
 
 
+/* Decode the SMix parameters of a profile, see neoscrypt() below */
+static void neoscrypt_profile(unsigned int profile, unsigned int *N, unsigned int *r,
+  unsigned int *dblmix, unsigned int *mixmode) {
+    *N = 128;
+    *r = 2;
+    *dblmix = 1;
+    *mixmode = 0x14;
+
+    if(profile & 0x1) {
+        *N = 1024;        /* N = (1 << (Nfactor + 1)); */
+        *r = 1;           /* r = (1 << rfactor); */
+        *dblmix = 0;      /* Salsa only */
+        *mixmode = 0x08;  /* 8 rounds */
+    }
+
+    if(profile >> 31) {
+        *N = (1 << (((profile >> 8) & 0x1F) + 1));
+        *r = (1 << ((profile >> 5) & 0x7));
+    }
+}
+
 #ifndef USE_ASM
 
 /* Configurable optimised block mixer */
@@ -2281,27 +2302,16 @@ static void neoscrypt_blkmix(unsigned int *X, unsigned int *Y, unsigned int r, u
  *     .....
  *     11110 = N of 2147483648;
  *   profile bits 30 to 13 are reserved */
-void neoscrypt(const unsigned char *password, unsigned char *output, unsigned int profile) {
-    const size_t stack_align = 0x40;
-    unsigned int N = 128, r = 2, dblmix = 1, mixmode = 0x14;
+void neoscrypt_r(const unsigned char *password, unsigned char *output,
+  unsigned int profile, void *scratch) {
+    unsigned int N, r, dblmix, mixmode;
     unsigned int kdf, i, j;
     unsigned int *X, *Y, *Z, *V;
 
-    if(profile & 0x1) {
-        N = 1024;        /* N = (1 << (Nfactor + 1)); */
-        r = 1;           /* r = (1 << rfactor); */
-        dblmix = 0;      /* Salsa only */
-        mixmode = 0x08;  /* 8 rounds */
-    }
-
-    if(profile >> 31) {
-        N = (1 << (((profile >> 8) & 0x1F) + 1));
-        r = (1 << ((profile >> 5) & 0x7));
-    }
+    neoscrypt_profile(profile, &N, &r, &dblmix, &mixmode);
 
-    unsigned char stack[(N + 3) * r * 2 * BLOCK_SIZE + stack_align];
     /* X = r * 2 * BLOCK_SIZE */
-    X = (unsigned int *) (((size_t)stack & ~(stack_align - 1)) + stack_align);
+    X = (unsigned int *) scratch;
     /* Z is a copy of X for ChaCha */
     Z = &X[32 * r];
     /* Y is an X sized temporal space */
@@ -2397,4 +2407,44 @@ void neoscrypt(const unsigned char *password, unsigned char *output, unsigned in
 
 }
 
+/* Scratch space of the default profile, small enough for any thread stack */
+#define NEOSCRYPT_STACK_SCRATCH ((128 + 3) * 2 * 2 * BLOCK_SIZE)
+
+void neoscrypt(const unsigned char *password, unsigned char *output, unsigned int profile) {
+    const size_t stack_align = 0x40;
+    const size_t size = neoscrypt_scratch_size(profile);
+    unsigned char *mem;
+
+    if(size <= NEOSCRYPT_STACK_SCRATCH) {
+        unsigned char stack[NEOSCRYPT_STACK_SCRATCH + stack_align];
+        neoscrypt_r(password, output, profile,
+          (void *) (((size_t)stack & ~(stack_align - 1)) + stack_align));
+        return;
+    }
+
+    /* Large custom profiles would overflow the stack */
+    mem = (unsigned char *) malloc(size + stack_align);
+    if(!mem) abort();
+    neoscrypt_r(password, output, profile,
+      (void *) (((size_t)mem & ~(stack_align - 1)) + stack_align));
+    free(mem);
+}
+
+#else
+
+/* The assembly neoscrypt() works in its own fixed size stack frame */
+void neoscrypt_r(const unsigned char *password, unsigned char *output,
+  unsigned int profile, void *scratch) {
+    (void) scratch;
+    neoscrypt(password, output, profile);
+}
+
 #endif /* !(USE_ASM) */
+
+size_t neoscrypt_scratch_size(unsigned int profile) {
+    unsigned int N, r, dblmix, mixmode;
+
+    neoscrypt_profile(profile, &N, &r, &dblmix, &mixmode);
+
+    return((size_t)(N + 3) * r * 2 * BLOCK_SIZE);
+}
@@ -6,13 +6,27 @@ extern "C" {
 #include "bitcoin-config.h"
 #endif
 
+#include <stddef.h>
+
 void neoscrypt(const unsigned char *password, unsigned char *output,
   unsigned int profile);
 
+/* Size in bytes of the scratch space neoscrypt_r() needs for a profile */
+size_t neoscrypt_scratch_size(unsigned int profile);
+
+/* Re-entrant neoscrypt() working in caller-owned scratch space, which must be
+ * 64-byte aligned and at least neoscrypt_scratch_size(profile) bytes long */
+void neoscrypt_r(const unsigned char *password, unsigned char *output,
+  unsigned int profile, void *scratch);
+
 void neoscrypt_blake2s(const void *input, const unsigned int input_size,
   const void *key, const unsigned char key_size,
   void *output, const unsigned char output_size);
 
+void neoscrypt_fastkdf(const unsigned char *password, unsigned int password_len,
+  const unsigned char *salt, unsigned int salt_len, unsigned int N,
+  unsigned char *output, unsigned int output_len);
+
 void neoscrypt_copy(void *dstp, const void *srcp, unsigned int len);
 void neoscrypt_erase(void *dstp, unsigned int len);
 void neoscrypt_xor(void *dstp, const void *srcp, unsigned int len);
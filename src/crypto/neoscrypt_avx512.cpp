@@ -0,0 +1,61 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX512
+
+#include <crypto/neoscrypt_lanes.h>
+
+#include <cstdint>
+#include <immintrin.h>
+
+namespace neoscrypt_avx512 {
+namespace {
+
+struct Ops4 {
+    using Vec = __m128i;
+    static constexpr size_t LANES{4};
+
+    static inline Vec Add(Vec x, Vec y) { return _mm_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x) { return _mm_rol_epi32(x, n); }
+    static inline Vec Load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm_storeu_si128((__m128i*)p, x); }
+    static inline Vec Gather(const uint32_t* base, const uint32_t* index)
+    {
+        return _mm_i32gather_epi32((const int*)base, Load(index), 4);
+    }
+};
+
+struct Ops8 {
+    using Vec = __m256i;
+    static constexpr size_t LANES{8};
+
+    static inline Vec Add(Vec x, Vec y) { return _mm256_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm256_xor_si256(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x) { return _mm256_rol_epi32(x, n); }
+    static inline Vec Load(const uint32_t* p) { return _mm256_loadu_si256((const __m256i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm256_storeu_si256((__m256i*)p, x); }
+    static inline Vec Gather(const uint32_t* base, const uint32_t* index)
+    {
+        return _mm256_i32gather_epi32((const int*)base, Load(index), 4);
+    }
+};
+
+} // namespace
+
+void Hash_4way(const unsigned char* input, unsigned char* output)
+{
+    neoscrypt_lanes::Engine<Ops4>::Hash(input, output);
+}
+
+void Hash_8way(const unsigned char* input, unsigned char* output)
+{
+    neoscrypt_lanes::Engine<Ops8>::Hash(input, output);
+}
+
+} // namespace neoscrypt_avx512
+
+#endif
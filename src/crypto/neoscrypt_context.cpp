@@ -0,0 +1,31 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/neoscrypt_context.h>
+
+#include <crypto/neoscrypt.h>
+
+#include <cstdint>
+
+namespace {
+constexpr size_t SCRATCH_ALIGN{64};
+} // namespace
+
+void NeoScryptContext::Hash(const unsigned char* input, unsigned char* output, unsigned int profile)
+{
+    const size_t size{neoscrypt_scratch_size(profile)};
+    if (size > m_size) {
+        m_mem.reset(new unsigned char[size + SCRATCH_ALIGN]);
+        const uintptr_t base{reinterpret_cast<uintptr_t>(m_mem.get())};
+        m_scratch = reinterpret_cast<void*>((base + SCRATCH_ALIGN - 1) & ~uintptr_t{SCRATCH_ALIGN - 1});
+        m_size = size;
+    }
+    neoscrypt_r(input, output, profile, m_scratch);
+}
+
+NeoScryptContext& NeoScryptThreadContext()
+{
+    static thread_local NeoScryptContext context;
+    return context;
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_NEOSCRYPT_CONTEXT_H
+#define BITCOIN_CRYPTO_NEOSCRYPT_CONTEXT_H
+
+#include <cstddef>
+#include <memory>
+
+/** Caller-owned scratch space for neoscrypt_r().
+ *
+ * The memory is allocated on first use, 64-byte aligned, and only grows when
+ * a profile needs more than the largest one hashed so far. It is not
+ * thread-safe: keep one context per thread, e.g. NeoScryptThreadContext().
+ */
+class NeoScryptContext
+{
+private:
+    std::unique_ptr<unsigned char[]> m_mem;
+    void* m_scratch{nullptr};
+    size_t m_size{0};
+
+public:
+    /** Hash an 80-byte input into a 32-byte output with the given profile. */
+    void Hash(const unsigned char* input, unsigned char* output, unsigned int profile);
+
+    /** Size in bytes of the scratch space currently held. */
+    size_t Size() const { return m_size; }
+};
+
+/** Return the NeoScrypt context of the calling thread. */
+NeoScryptContext& NeoScryptThreadContext();
+
+#endif // BITCOIN_CRYPTO_NEOSCRYPT_CONTEXT_H
@@ -0,0 +1,171 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
+#define BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
+
+#include <crypto/neoscrypt.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+/**
+ * Multi-buffer implementation of the default NeoScrypt profile
+ * (N = 128, r = 2, ChaCha20/20 and Salsa20/20 with FastKDF-BLAKE2s).
+ *
+ * Ops::LANES independent 80-byte inputs are hashed in lockstep: every vector
+ * holds the same 32-bit state word of all lanes, so the Salsa and ChaCha
+ * cores run on all lanes at once. The data-dependent reads of the second
+ * SMix loop are done with Ops::Gather. The FastKDF steps are run per lane.
+ *
+ * This header is only to be included by the instruction set specific
+ * neoscrypt_*.cpp files, each of which instantiates Hash() with its own Ops.
+ */
+namespace neoscrypt_lanes {
+namespace {
+
+constexpr size_t N{128};
+//! Words in one SMix state, 2 * r blocks of 16 words
+constexpr size_t WORDS{64};
+//! Size in bytes of the FastKDF input and output buffer for one lane
+constexpr size_t KDF_BYTES{WORDS * 4};
+
+template <typename Ops>
+struct Engine {
+    using Vec = typename Ops::Vec;
+    static constexpr size_t LANES{Ops::LANES};
+
+    template <int n>
+    static inline Vec Rotl(Vec x) { return Ops::template Rotl<n>(x); }
+
+    static inline void Salsa(Vec* B)
+    {
+        Vec x[16];
+        for (int i = 0; i < 16; ++i) x[i] = B[i];
+        auto quarter = [](Vec& a, Vec& b, Vec& c, Vec& d) {
+            b = Ops::Xor(b, Rotl<7>(Ops::Add(a, d)));
+            c = Ops::Xor(c, Rotl<9>(Ops::Add(b, a)));
+            d = Ops::Xor(d, Rotl<13>(Ops::Add(c, b)));
+            a = Ops::Xor(a, Rotl<18>(Ops::Add(d, c)));
+        };
+        for (int round = 0; round < 20; round += 2) {
+            quarter(x[0], x[4], x[8], x[12]);
+            quarter(x[5], x[9], x[13], x[1]);
+            quarter(x[10], x[14], x[2], x[6]);
+            quarter(x[15], x[3], x[7], x[11]);
+            quarter(x[0], x[1], x[2], x[3]);
+            quarter(x[5], x[6], x[7], x[4]);
+            quarter(x[10], x[11], x[8], x[9]);
+            quarter(x[15], x[12], x[13], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) B[i] = Ops::Add(B[i], x[i]);
+    }
+
+    static inline void ChaCha(Vec* B)
+    {
+        Vec x[16];
+        for (int i = 0; i < 16; ++i) x[i] = B[i];
+        auto quarter = [](Vec& a, Vec& b, Vec& c, Vec& d) {
+            a = Ops::Add(a, b); d = Rotl<16>(Ops::Xor(d, a));
+            c = Ops::Add(c, d); b = Rotl<12>(Ops::Xor(b, c));
+            a = Ops::Add(a, b); d = Rotl<8>(Ops::Xor(d, a));
+            c = Ops::Add(c, d); b = Rotl<7>(Ops::Xor(b, c));
+        };
+        for (int round = 0; round < 20; round += 2) {
+            quarter(x[0], x[4], x[8], x[12]);
+            quarter(x[1], x[5], x[9], x[13]);
+            quarter(x[2], x[6], x[10], x[14]);
+            quarter(x[3], x[7], x[11], x[15]);
+            quarter(x[0], x[5], x[10], x[15]);
+            quarter(x[1], x[6], x[11], x[12]);
+            quarter(x[2], x[7], x[8], x[13]);
+            quarter(x[3], x[4], x[9], x[14]);
+        }
+        for (int i = 0; i < 16; ++i) B[i] = Ops::Add(B[i], x[i]);
+    }
+
+    static inline void XorBlock(Vec* dst, const Vec* src)
+    {
+        for (int i = 0; i < 16; ++i) dst[i] = Ops::Xor(dst[i], src[i]);
+    }
+
+    /** NeoScrypt block mix for r = 2: Xa ^= Xd; M(Xa); Xb ^= Xa; M(Xb);
+     *  Xc ^= Xb; M(Xc); Xd ^= Xc; M(Xd); then swap Xb and Xc. */
+    template <bool chacha>
+    static inline void BlkMix(Vec* X)
+    {
+        for (int b = 0; b < 4; ++b) {
+            XorBlock(&X[16 * b], &X[16 * ((b + 3) & 3)]);
+            if (chacha) {
+                ChaCha(&X[16 * b]);
+            } else {
+                Salsa(&X[16 * b]);
+            }
+        }
+        for (int i = 16; i < 32; ++i) {
+            const Vec t{X[i]};
+            X[i] = X[i + 16];
+            X[i + 16] = t;
+        }
+    }
+
+    /** Sequential memory-hard mix of X, using V (N * WORDS * LANES words) as scratch space. */
+    template <bool chacha>
+    static void SMix(Vec* X, uint32_t* V)
+    {
+        for (size_t i = 0; i < N; ++i) {
+            uint32_t* row{&V[i * WORDS * LANES]};
+            for (size_t w = 0; w < WORDS; ++w) Ops::Store(&row[w * LANES], X[w]);
+            BlkMix<chacha>(X);
+        }
+        uint32_t last[LANES];
+        uint32_t index[LANES];
+        for (size_t i = 0; i < N; ++i) {
+            // integerify(X) mod N, separately for every lane
+            Ops::Store(last, X[WORDS - 16]);
+            for (size_t l = 0; l < LANES; ++l) {
+                index[l] = (last[l] & (N - 1)) * WORDS * LANES + l;
+            }
+            for (size_t w = 0; w < WORDS; ++w) {
+                X[w] = Ops::Xor(X[w], Ops::Gather(&V[w * LANES], index));
+            }
+            BlkMix<chacha>(X);
+        }
+    }
+
+    /** Hash LANES consecutive 80-byte inputs into LANES consecutive 32-byte outputs. */
+    static void Hash(const unsigned char* input, unsigned char* output)
+    {
+        static thread_local std::vector<uint32_t> scratch;
+        scratch.resize(N * WORDS * LANES);
+
+        alignas(64) uint32_t words[WORDS][LANES];
+        unsigned char kdf[KDF_BYTES];
+        for (size_t l = 0; l < LANES; ++l) {
+            const unsigned char* password{input + 80 * l};
+            neoscrypt_fastkdf(password, 80, password, 80, 32, kdf, KDF_BYTES);
+            for (size_t w = 0; w < WORDS; ++w) std::memcpy(&words[w][l], kdf + 4 * w, 4);
+        }
+
+        Vec X[WORDS], Z[WORDS];
+        for (size_t w = 0; w < WORDS; ++w) X[w] = Z[w] = Ops::Load(words[w]);
+
+        // ChaCha first, Salsa second, then XOR them together
+        SMix<true>(Z, scratch.data());
+        SMix<false>(X, scratch.data());
+        for (size_t w = 0; w < WORDS; ++w) Ops::Store(words[w], Ops::Xor(X[w], Z[w]));
+
+        for (size_t l = 0; l < LANES; ++l) {
+            for (size_t w = 0; w < WORDS; ++w) std::memcpy(kdf + 4 * w, &words[w][l], 4);
+            neoscrypt_fastkdf(input + 80 * l, 80, kdf, KDF_BYTES, 32, output + 32 * l, 32);
+        }
+    }
+};
+
+} // namespace
+} // namespace neoscrypt_lanes
+
+#endif // BITCOIN_CRYPTO_NEOSCRYPT_LANES_H
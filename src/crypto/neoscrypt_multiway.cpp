@@ -0,0 +1,184 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <crypto/neoscrypt_multiway.h>
+
+#include <crypto/common.h>
+#include <crypto/neoscrypt.h>
+#include <crypto/neoscrypt_context.h>
+
+#include <compat/cpuid.h>
+
+#include <assert.h>
+#include <string.h>
+
+#if defined(__linux__) && defined(__aarch64__) && defined(__ARM_NEON)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__))
+namespace neoscrypt_sse2
+{
+void Hash_4way(const unsigned char* input, unsigned char* output);
+}
+#endif
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+namespace neoscrypt_neon
+{
+void Hash_4way(const unsigned char* input, unsigned char* output);
+}
+#endif
+
+namespace neoscrypt_avx2
+{
+void Hash_4way(const unsigned char* input, unsigned char* output);
+void Hash_8way(const unsigned char* input, unsigned char* output);
+}
+
+namespace neoscrypt_avx512
+{
+void Hash_4way(const unsigned char* input, unsigned char* output);
+void Hash_8way(const unsigned char* input, unsigned char* output);
+}
+
+namespace {
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+//! Let the assembly implementation use its SSE2 core, as done for block hashing
+constexpr unsigned int SCALAR_PROFILE{0x1000};
+#else
+constexpr unsigned int SCALAR_PROFILE{0};
+#endif
+
+typedef void (*HashFn)(const unsigned char* input, unsigned char* output);
+
+HashFn Hash_4way = nullptr;
+HashFn Hash_8way = nullptr;
+
+bool SelfTest()
+{
+    unsigned char input[8 * 80];
+    for (size_t i = 0; i < sizeof(input); ++i) input[i] = (unsigned char)(i * 37 + (i >> 5));
+
+    unsigned char expected[8 * 32];
+    for (size_t i = 0; i < 8; ++i) neoscrypt(input + 80 * i, expected + 32 * i, SCALAR_PROFILE);
+
+    unsigned char out[8 * 32];
+    if (Hash_4way) {
+        memset(out, 0, sizeof(out));
+        Hash_4way(input, out);
+        if (memcmp(out, expected, 4 * 32)) return false;
+    }
+    if (Hash_8way) {
+        memset(out, 0, sizeof(out));
+        Hash_8way(input, out);
+        if (memcmp(out, expected, 8 * 32)) return false;
+    }
+    return true;
+}
+
+#if defined(USE_ASM) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+/** Return the state components enabled by the OS in XCR0. */
+uint32_t EnabledXCR0()
+{
+    uint32_t a, d;
+    __asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+    return a;
+}
+#endif
+} // namespace
+
+std::string NeoScryptAutoDetect()
+{
+    std::string ret = "standard";
+    Hash_4way = nullptr;
+    Hash_8way = nullptr;
+#if defined(USE_ASM) && defined(HAVE_GETCPUID)
+    [[maybe_unused]] bool enabled_avx = false;
+    [[maybe_unused]] bool enabled_avx512 = false;
+    [[maybe_unused]] bool have_avx2 = false;
+    [[maybe_unused]] bool have_avx512 = false;
+
+    uint32_t eax, ebx, ecx, edx;
+    GetCPUID(1, 0, eax, ebx, ecx, edx);
+    const bool have_xsave = (ecx >> 27) & 1;
+    const bool have_avx = (ecx >> 28) & 1;
+    if (have_xsave && have_avx) {
+        const uint32_t xcr0{EnabledXCR0()};
+        enabled_avx = (xcr0 & 0x06) == 0x06;
+        enabled_avx512 = (xcr0 & 0xE6) == 0xE6;
+    }
+    GetCPUID(0, 0, eax, ebx, ecx, edx);
+    if (eax >= 7) {
+        GetCPUID(7, 0, eax, ebx, ecx, edx);
+        have_avx2 = (ebx >> 5) & 1;
+        // AVX-512F plus AVX-512VL, for the rotates on 128 and 256-bit registers
+        have_avx512 = ((ebx >> 16) & 1) && ((ebx >> 31) & 1);
+    }
+
+#if defined(__x86_64__) || defined(__amd64__)
+    Hash_4way = neoscrypt_sse2::Hash_4way;
+    ret = "sse2(4way)";
+#endif
+
+#if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && enabled_avx) {
+        Hash_4way = neoscrypt_avx2::Hash_4way;
+        Hash_8way = neoscrypt_avx2::Hash_8way;
+        ret = "avx2(4way,8way)";
+    }
+#endif
+
+#if defined(ENABLE_AVX512) && !defined(BUILD_BITCOIN_INTERNAL)
+    if (have_avx2 && have_avx512 && enabled_avx512) {
+        Hash_4way = neoscrypt_avx512::Hash_4way;
+        Hash_8way = neoscrypt_avx512::Hash_8way;
+        ret = "avx512vl(4way,8way)";
+    }
+#endif
+#endif // defined(USE_ASM) && defined(HAVE_GETCPUID)
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+    // Advanced SIMD is mandatory on AArch64, but honour a kernel that hides it.
+    bool have_neon = true;
+#if defined(__linux__)
+    have_neon = getauxval(AT_HWCAP) & HWCAP_ASIMD;
+#endif
+    if (have_neon) {
+        Hash_4way = neoscrypt_neon::Hash_4way;
+        ret = "neon(4way)";
+    }
+#endif
+
+    assert(SelfTest());
+    return ret;
+}
+
+void NeoScryptMany(unsigned char* output, const unsigned char* input, size_t count)
+{
+    if (Hash_8way) {
+        while (count >= 8) {
+            Hash_8way(input, output);
+            output += 8 * 32;
+            input += 8 * 80;
+            count -= 8;
+        }
+    }
+    if (Hash_4way) {
+        while (count >= 4) {
+            Hash_4way(input, output);
+            output += 4 * 32;
+            input += 4 * 80;
+            count -= 4;
+        }
+    }
+    while (count) {
+        NeoScryptThreadContext().Hash(input, output, SCALAR_PROFILE);
+        output += 32;
+        input += 80;
+        --count;
+    }
+}
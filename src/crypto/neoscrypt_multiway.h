@@ -0,0 +1,23 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_CRYPTO_NEOSCRYPT_MULTIWAY_H
+#define BITCOIN_CRYPTO_NEOSCRYPT_MULTIWAY_H
+
+#include <stddef.h>
+#include <string>
+
+/** Autodetect the best available multi-buffer NeoScrypt implementation.
+ *  Returns the name of the implementation.
+ */
+std::string NeoScryptAutoDetect();
+
+/** Compute multiple NeoScrypt hashes (default profile) of 80-byte block headers.
+ *  output:  pointer to a count*32 byte output buffer
+ *  input:   pointer to a count*80 byte input buffer
+ *  count:   the number of hashes to compute.
+ */
+void NeoScryptMany(unsigned char* output, const unsigned char* input, size_t count);
+
+#endif // BITCOIN_CRYPTO_NEOSCRYPT_MULTIWAY_H
@@ -0,0 +1,48 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__aarch64__) && defined(__ARM_NEON)
+
+#include <crypto/neoscrypt_lanes.h>
+
+#include <arm_neon.h>
+#include <cstdint>
+
+namespace neoscrypt_neon {
+namespace {
+
+struct Ops {
+    using Vec = uint32x4_t;
+    static constexpr size_t LANES{4};
+
+    static inline Vec Add(Vec x, Vec y) { return vaddq_u32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return veorq_u32(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x)
+    {
+        if constexpr (n == 16) {
+            return vreinterpretq_u32_u16(vrev32q_u16(vreinterpretq_u16_u32(x)));
+        } else {
+            return vsriq_n_u32(vshlq_n_u32(x, n), x, 32 - n);
+        }
+    }
+    static inline Vec Load(const uint32_t* p) { return vld1q_u32(p); }
+    static inline void Store(uint32_t* p, Vec x) { vst1q_u32(p, x); }
+    static inline Vec Gather(const uint32_t* base, const uint32_t* index)
+    {
+        const uint32_t words[4] = {base[index[0]], base[index[1]], base[index[2]], base[index[3]]};
+        return vld1q_u32(words);
+    }
+};
+
+} // namespace
+
+void Hash_4way(const unsigned char* input, unsigned char* output)
+{
+    neoscrypt_lanes::Engine<Ops>::Hash(input, output);
+}
+
+} // namespace neoscrypt_neon
+
+#endif
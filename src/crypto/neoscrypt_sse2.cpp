@@ -0,0 +1,40 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__x86_64__) || defined(__amd64__)
+
+#include <crypto/neoscrypt_lanes.h>
+
+#include <cstdint>
+#include <emmintrin.h>
+
+namespace neoscrypt_sse2 {
+namespace {
+
+struct Ops {
+    using Vec = __m128i;
+    static constexpr size_t LANES{4};
+
+    static inline Vec Add(Vec x, Vec y) { return _mm_add_epi32(x, y); }
+    static inline Vec Xor(Vec x, Vec y) { return _mm_xor_si128(x, y); }
+    template <int n>
+    static inline Vec Rotl(Vec x) { return _mm_or_si128(_mm_slli_epi32(x, n), _mm_srli_epi32(x, 32 - n)); }
+    static inline Vec Load(const uint32_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+    static inline void Store(uint32_t* p, Vec x) { _mm_storeu_si128((__m128i*)p, x); }
+    static inline Vec Gather(const uint32_t* base, const uint32_t* index)
+    {
+        return _mm_setr_epi32(base[index[0]], base[index[1]], base[index[2]], base[index[3]]);
+    }
+};
+
+} // namespace
+
+void Hash_4way(const unsigned char* input, unsigned char* output)
+{
+    neoscrypt_lanes::Engine<Ops>::Hash(input, output);
+}
+
+} // namespace neoscrypt_sse2
+
+#endif
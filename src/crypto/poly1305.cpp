@@ -3,13 +3,120 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 // Based on the public domain implementation by Andrew Moon
-// poly1305-donna-unrolled.c from https://github.com/floodyberry/poly1305-donna
+// poly1305-donna-unrolled.c and poly1305-donna-64.h from
+// https://github.com/floodyberry/poly1305-donna
 
 #include <crypto/common.h>
 #include <crypto/poly1305.h>
 
 #include <string.h>
 
+#ifdef __SIZEOF_INT128__
+/**
+ * Radix 2^44 implementation for platforms with 64x64->128 bit multiplication.
+ * It takes 9 multiplications per block, where the radix 2^26 one takes 25.
+ */
+void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m, size_t inlen, const unsigned char key[POLY1305_KEYLEN]) {
+    typedef unsigned __int128 uint128_t;
+    static constexpr uint64_t MASK44{0xfffffffffff};
+    static constexpr uint64_t MASK42{0x3ffffffffff};
+    uint64_t t0,t1;
+    uint64_t h0,h1,h2;
+    uint64_t r0,r1,r2;
+    uint64_t s1,s2;
+    uint64_t g0,g1,g2;
+    uint64_t c, hibit;
+    uint128_t d0,d1,d2;
+    unsigned char mp[16];
+
+    /* clamp key */
+    t0 = ReadLE64(key+0);
+    t1 = ReadLE64(key+8);
+
+    /* precompute multipliers */
+    r0 = t0 & 0xffc0fffffff;
+    r1 = ((t0 >> 44) | (t1 << 20)) & 0xfffffc0ffff;
+    r2 = (t1 >> 24) & 0x00ffffffc0f;
+
+    s1 = r1 * (5 << 2);
+    s2 = r2 * (5 << 2);
+
+    /* init state */
+    h0 = 0;
+    h1 = 0;
+    h2 = 0;
+
+    hibit = uint64_t{1} << 40;
+    while (inlen) {
+        if (inlen >= 16) {
+            t0 = ReadLE64(m+0);
+            t1 = ReadLE64(m+8);
+            m += 16;
+            inlen -= 16;
+        } else {
+            /* final bytes */
+            size_t j;
+            for (j = 0; j < inlen; j++) mp[j] = m[j];
+            mp[j++] = 1;
+            for (; j < 16; j++) mp[j] = 0;
+            inlen = 0;
+            hibit = 0;
+
+            t0 = ReadLE64(mp+0);
+            t1 = ReadLE64(mp+8);
+        }
+
+        h0 += t0 & MASK44;
+        h1 += ((t0 >> 44) | (t1 << 20)) & MASK44;
+        h2 += ((t1 >> 24) & MASK42) | hibit;
+
+        d0 = (uint128_t)h0 * r0 + (uint128_t)h1 * s2 + (uint128_t)h2 * s1;
+        d1 = (uint128_t)h0 * r1 + (uint128_t)h1 * r0 + (uint128_t)h2 * s2;
+        d2 = (uint128_t)h0 * r2 + (uint128_t)h1 * r1 + (uint128_t)h2 * r0;
+
+                   c = (uint64_t)(d0 >> 44); h0 = (uint64_t)d0 & MASK44;
+        d1 += c;   c = (uint64_t)(d1 >> 44); h1 = (uint64_t)d1 & MASK44;
+        d2 += c;   c = (uint64_t)(d2 >> 42); h2 = (uint64_t)d2 & MASK42;
+        h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+        h1 += c;
+    }
+
+    /* fully carry h */
+                 c = h1 >> 44; h1 &= MASK44;
+    h2 +=     c; c = h2 >> 42; h2 &= MASK42;
+    h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+    h1 +=     c; c = h1 >> 44; h1 &= MASK44;
+    h2 +=     c; c = h2 >> 42; h2 &= MASK42;
+    h0 += c * 5; c = h0 >> 44; h0 &= MASK44;
+    h1 +=     c;
+
+    /* compute h + -p */
+    g0 = h0 + 5; c = g0 >> 44; g0 &= MASK44;
+    g1 = h1 + c; c = g1 >> 44; g1 &= MASK44;
+    g2 = h2 + c - (uint64_t{1} << 42);
+
+    /* select h if h < p, or h + -p if h >= p */
+    c = (g2 >> 63) - 1;
+    g0 &= c;
+    g1 &= c;
+    g2 &= c;
+    c = ~c;
+    h0 = (h0 & c) | g0;
+    h1 = (h1 & c) | g1;
+    h2 = (h2 & c) | g2;
+
+    /* h = (h + pad) */
+    t0 = ReadLE64(&key[16]);
+    t1 = ReadLE64(&key[24]);
+
+    h0 += t0 & MASK44; c = h0 >> 44; h0 &= MASK44;
+    h1 += (((t0 >> 44) | (t1 << 20)) & MASK44) + c; c = h1 >> 44; h1 &= MASK44;
+    h2 += ((t1 >> 24) & MASK42) + c; h2 &= MASK42;
+
+    WriteLE64(&out[0], h0 | (h1 << 44));
+    WriteLE64(&out[8], (h1 >> 20) | (h2 << 24));
+}
+#else
 #define mul32x32_64(a,b) ((uint64_t)(a) * (b))
 
 void poly1305_auth(unsigned char out[POLY1305_TAGLEN], const unsigned char *m, size_t inlen, const unsigned char key[POLY1305_KEYLEN]) {
@@ -139,3 +246,4 @@ poly1305_donna_finish:
     WriteLE32(&out[ 8], f2); f3 += (f2 >> 32);
     WriteLE32(&out[12], f3);
 }
+#endif
@@ -8,6 +8,9 @@
 #include <assert.h>
 #include <string.h>
 
+#include <algorithm>
+#include <vector>
+
 #include <compat/cpuid.h>
 
 #if defined(__linux__) && defined(ENABLE_ARM_SHANI) && !defined(BUILD_BITCOIN_INTERNAL)
@@ -37,6 +40,7 @@ void Transform_4way(unsigned char* out, const unsigned char* in);
 namespace sha256d64_avx2
 {
 void Transform_8way(unsigned char* out, const unsigned char* in);
+void Transform_8way_states(uint32_t* s, const unsigned char* const* chunks);
 }
 
 namespace sha256d64_x86_shani
@@ -436,6 +440,7 @@ void TransformD64(unsigned char* out, const unsigned char* in)
 
 typedef void (*TransformType)(uint32_t*, const unsigned char*, size_t);
 typedef void (*TransformD64Type)(unsigned char*, const unsigned char*);
+typedef void (*TransformMultiType)(uint32_t*, const unsigned char* const*);
 
 template<TransformType tr>
 void TransformD64Wrapper(unsigned char* out, const unsigned char* in)
@@ -481,6 +486,7 @@ TransformD64Type TransformD64 = sha256::TransformD64;
 TransformD64Type TransformD64_2way = nullptr;
 TransformD64Type TransformD64_4way = nullptr;
 TransformD64Type TransformD64_8way = nullptr;
+TransformMultiType TransformMulti_8way = nullptr;
 
 bool SelfTest() {
     // Input state (equal to the initial SHA256 state)
@@ -564,6 +570,20 @@ bool SelfTest() {
         if (!std::equal(out, out + 256, result_d64)) return false;
     }
 
+    // Test TransformMulti_8way, if available: lane i continues from the state after i transformations.
+    if (TransformMulti_8way) {
+        uint32_t states[64];
+        const unsigned char* chunks[8];
+        for (size_t i = 0; i < 8; ++i) {
+            std::copy(result[i], result[i] + 8, states + 8 * i);
+            chunks[i] = data + 1 + 64 * i;
+        }
+        TransformMulti_8way(states, chunks);
+        for (size_t i = 0; i < 8; ++i) {
+            if (!std::equal(states + 8 * i, states + 8 * i + 8, result[i + 1])) return false;
+        }
+    }
+
     return true;
 }
 
@@ -630,6 +650,7 @@ std::string SHA256AutoDetect()
 #if defined(ENABLE_AVX2) && !defined(BUILD_BITCOIN_INTERNAL)
     if (have_avx2 && have_avx && enabled_avx) {
         TransformD64_8way = sha256d64_avx2::Transform_8way;
+        TransformMulti_8way = sha256d64_avx2::Transform_8way_states;
         ret += ",avx2(8way)";
     }
 #endif
@@ -761,3 +782,106 @@ void SHA256D64(unsigned char* out, const unsigned char* in, size_t blocks)
         --blocks;
     }
 }
+
+namespace {
+/** Single SHA-256 of many messages, 8 at a time in the lanes of TransformMulti_8way. */
+void SHA256Many(unsigned char* out, const unsigned char* const* in, const size_t* lens, size_t count)
+{
+    struct Lane {
+        size_t msg;
+        size_t pos;
+        size_t full_blocks;
+        size_t blocks;
+        //! Remainder of the message with its padding, in one or two blocks
+        unsigned char tail[128];
+    };
+    static const unsigned char idle[64] = {0};
+    uint32_t s[64] = {0};
+    Lane lanes[8];
+    bool live[8];
+    size_t next = 0;
+    auto start = [&](size_t l) {
+        if (next == count) return false;
+        Lane& lane = lanes[l];
+        const size_t len = lens[next];
+        const size_t rem = len % 64;
+        lane.msg = next++;
+        lane.pos = 0;
+        lane.full_blocks = len / 64;
+        lane.blocks = lane.full_blocks + (rem < 56 ? 1 : 2);
+        std::fill(lane.tail, lane.tail + 128, 0);
+        std::copy(in[lane.msg] + 64 * lane.full_blocks, in[lane.msg] + len, lane.tail);
+        lane.tail[rem] = 0x80;
+        WriteBE64(lane.tail + 64 * (lane.blocks - lane.full_blocks) - 8, uint64_t{len} << 3);
+        sha256::Initialize(s + 8 * l);
+        return true;
+    };
+    auto output = [&](size_t l) {
+        for (int i = 0; i < 8; ++i) {
+            WriteBE32(out + 32 * lanes[l].msg + 4 * i, s[8 * l + i]);
+        }
+    };
+
+    size_t live_count = 0;
+    for (size_t l = 0; l < 8; ++l) {
+        live[l] = start(l);
+        live_count += live[l];
+    }
+    // Once few long messages are left, a single lane Transform finishes them faster
+    while (live_count > 2) {
+        const unsigned char* chunks[8];
+        for (size_t l = 0; l < 8; ++l) {
+            const Lane& lane = lanes[l];
+            if (!live[l]) {
+                chunks[l] = idle;
+            } else if (lane.pos < lane.full_blocks) {
+                chunks[l] = in[lane.msg] + 64 * lane.pos;
+            } else {
+                chunks[l] = lane.tail + 64 * (lane.pos - lane.full_blocks);
+            }
+        }
+        TransformMulti_8way(s, chunks);
+        for (size_t l = 0; l < 8; ++l) {
+            if (!live[l] || ++lanes[l].pos < lanes[l].blocks) continue;
+            output(l);
+            live[l] = start(l);
+            live_count -= !live[l];
+        }
+    }
+    for (size_t l = 0; l < 8; ++l) {
+        if (!live[l]) continue;
+        Lane& lane = lanes[l];
+        if (lane.pos < lane.full_blocks) {
+            Transform(s + 8 * l, in[lane.msg] + 64 * lane.pos, lane.full_blocks - lane.pos);
+            lane.pos = lane.full_blocks;
+        }
+        Transform(s + 8 * l, lane.tail + 64 * (lane.pos - lane.full_blocks), lane.blocks - lane.pos);
+        output(l);
+    }
+}
+} // namespace
+
+size_t SHA256DManyLanes()
+{
+    return TransformMulti_8way ? 8 : 1;
+}
+
+void SHA256DMany(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count)
+{
+    if (!TransformMulti_8way) {
+        for (size_t i = 0; i < count; ++i) {
+            unsigned char hash[CSHA256::OUTPUT_SIZE];
+            CSHA256().Write(inputs[i], lengths[i]).Finalize(hash);
+            CSHA256().Write(hash, sizeof(hash)).Finalize(output + 32 * i);
+        }
+        return;
+    }
+    SHA256Many(output, inputs, lengths, count);
+    // The first hashes are read into the lanes before they are overwritten
+    std::vector<const unsigned char*> hashes(count);
+    for (size_t i = 0; i < count; ++i) {
+        hashes[i] = output + 32 * i;
+    }
+    const std::vector<size_t> hash_lengths(count, CSHA256::OUTPUT_SIZE);
+    SHA256Many(output, hashes.data(), hash_lengths.data(), count);
+}
@@ -38,4 +38,15 @@ std::string SHA256AutoDetect();
  */
 void SHA256D64(unsigned char* output, const unsigned char* input, size_t blocks);
 
+/** Compute the double-SHA256's of many messages of any length, in parallel lanes when available.
+ *  output:  pointer to a count*32 byte output buffer
+ *  inputs:  pointers to the count messages
+ *  lengths: the lengths of the count messages
+ *  count:   the number of hashes to compute.
+ */
+void SHA256DMany(unsigned char* output, const unsigned char* const* inputs, const size_t* lengths, size_t count);
+
+/** The number of messages SHA256DMany() hashes at once: 1 if it has no faster way than one by one. */
+size_t SHA256DManyLanes();
+
 #endif // BITCOIN_CRYPTO_SHA256_H
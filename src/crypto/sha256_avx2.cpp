@@ -70,6 +70,88 @@ void inline Write8(unsigned char* out, int offset, __m256i v) {
     WriteLE32(out + 224 + offset, _mm256_extract_epi32(v, 0));
 }
 
+__m256i inline Read8(const unsigned char* const* chunks, int offset) {
+    __m256i ret = _mm256_set_epi32(
+        ReadLE32(chunks[7] + offset),
+        ReadLE32(chunks[6] + offset),
+        ReadLE32(chunks[5] + offset),
+        ReadLE32(chunks[4] + offset),
+        ReadLE32(chunks[3] + offset),
+        ReadLE32(chunks[2] + offset),
+        ReadLE32(chunks[1] + offset),
+        ReadLE32(chunks[0] + offset)
+    );
+    return _mm256_shuffle_epi8(ret, _mm256_set_epi32(0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL, 0x0C0D0E0FUL, 0x08090A0BUL, 0x04050607UL, 0x00010203UL));
+}
+
+/** Gather word i of the 8 states laid out one after the other in s. */
+__m256i inline Load8(const uint32_t* s, int i) {
+    return _mm256_set_epi32(s[56 + i], s[48 + i], s[40 + i], s[32 + i], s[24 + i], s[16 + i], s[8 + i], s[i]);
+}
+
+void inline Store8(uint32_t* s, int i, __m256i v) {
+    s[i] = _mm256_extract_epi32(v, 0);
+    s[8 + i] = _mm256_extract_epi32(v, 1);
+    s[16 + i] = _mm256_extract_epi32(v, 2);
+    s[24 + i] = _mm256_extract_epi32(v, 3);
+    s[32 + i] = _mm256_extract_epi32(v, 4);
+    s[40 + i] = _mm256_extract_epi32(v, 5);
+    s[48 + i] = _mm256_extract_epi32(v, 6);
+    s[56 + i] = _mm256_extract_epi32(v, 7);
+}
+
+const uint32_t ROUND_CONSTANTS[64] = {
+    0x428a2f98ul, 0x71374491ul, 0xb5c0fbcful, 0xe9b5dba5ul, 0x3956c25bul, 0x59f111f1ul, 0x923f82a4ul, 0xab1c5ed5ul,
+    0xd807aa98ul, 0x12835b01ul, 0x243185beul, 0x550c7dc3ul, 0x72be5d74ul, 0x80deb1feul, 0x9bdc06a7ul, 0xc19bf174ul,
+    0xe49b69c1ul, 0xefbe4786ul, 0x0fc19dc6ul, 0x240ca1ccul, 0x2de92c6ful, 0x4a7484aaul, 0x5cb0a9dcul, 0x76f988daul,
+    0x983e5152ul, 0xa831c66dul, 0xb00327c8ul, 0xbf597fc7ul, 0xc6e00bf3ul, 0xd5a79147ul, 0x06ca6351ul, 0x14292967ul,
+    0x27b70a85ul, 0x2e1b2138ul, 0x4d2c6dfcul, 0x53380d13ul, 0x650a7354ul, 0x766a0abbul, 0x81c2c92eul, 0x92722c85ul,
+    0xa2bfe8a1ul, 0xa81a664bul, 0xc24b8b70ul, 0xc76c51a3ul, 0xd192e819ul, 0xd6990624ul, 0xf40e3585ul, 0x106aa070ul,
+    0x19a4c116ul, 0x1e376c08ul, 0x2748774cul, 0x34b0bcb5ul, 0x391c0cb3ul, 0x4ed8aa4aul, 0x5b9cca4ful, 0x682e6ff3ul,
+    0x748f82eeul, 0x78a5636ful, 0x84c87814ul, 0x8cc70208ul, 0x90befffaul, 0xa4506cebul, 0xbef9a3f7ul, 0xc67178f2ul,
+};
+
+}
+
+void Transform_8way_states(uint32_t* s, const unsigned char* const* chunks)
+{
+    __m256i a = Load8(s, 0);
+    __m256i b = Load8(s, 1);
+    __m256i c = Load8(s, 2);
+    __m256i d = Load8(s, 3);
+    __m256i e = Load8(s, 4);
+    __m256i f = Load8(s, 5);
+    __m256i g = Load8(s, 6);
+    __m256i h = Load8(s, 7);
+
+    __m256i w[16];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = Read8(chunks, 4 * i);
+    }
+    // Message schedule word i, expanded in place from the 16 before it
+    auto schedule = [&w](int i) {
+        if (i >= 16) Inc(w[i & 15], sigma1(w[(i + 14) & 15]), w[(i + 9) & 15], sigma0(w[(i + 1) & 15]));
+        return Add(K(ROUND_CONSTANTS[i]), w[i & 15]);
+    };
+    for (int i = 0; i < 64; i += 8) {
+        Round(a, b, c, d, e, f, g, h, schedule(i));
+        Round(h, a, b, c, d, e, f, g, schedule(i + 1));
+        Round(g, h, a, b, c, d, e, f, schedule(i + 2));
+        Round(f, g, h, a, b, c, d, e, schedule(i + 3));
+        Round(e, f, g, h, a, b, c, d, schedule(i + 4));
+        Round(d, e, f, g, h, a, b, c, schedule(i + 5));
+        Round(c, d, e, f, g, h, a, b, schedule(i + 6));
+        Round(b, c, d, e, f, g, h, a, schedule(i + 7));
+    }
+
+    Store8(s, 0, Add(a, Load8(s, 0)));
+    Store8(s, 1, Add(b, Load8(s, 1)));
+    Store8(s, 2, Add(c, Load8(s, 2)));
+    Store8(s, 3, Add(d, Load8(s, 3)));
+    Store8(s, 4, Add(e, Load8(s, 4)));
+    Store8(s, 5, Add(f, Load8(s, 5)));
+    Store8(s, 6, Add(g, Load8(s, 6)));
+    Store8(s, 7, Add(h, Load8(s, 7)));
 }
 
 void Transform_8way(unsigned char* out, const unsigned char* in)
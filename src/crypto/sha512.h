@@ -26,4 +26,8 @@ public:
     uint64_t Size() const { return bytes; }
 };
 
+/** Replace the 64 bytes at hash by their SHA-512 hash, count times in a row, as key derivation
+ *  functions do. The state stays in words from one hash to the next. */
+void SHA512Iterate64(unsigned char* hash, uint64_t count);
+
 #endif // BITCOIN_CRYPTO_SHA512_H
@@ -0,0 +1,29 @@
+// Copyright (c) 2014-2019 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// The portable SHA-512 implementation, compiled with BMI2 so that rotations use rorx.
+
+#ifdef ENABLE_BMI2
+
+#include <crypto/sha512_impl.h>
+
+#include <stdint.h>
+
+namespace sha512_bmi2
+{
+void Transform(uint64_t* s, const unsigned char* chunk)
+{
+    sha512::TransformWords(s, ReadBE64(chunk + 0), ReadBE64(chunk + 8), ReadBE64(chunk + 16), ReadBE64(chunk + 24),
+                           ReadBE64(chunk + 32), ReadBE64(chunk + 40), ReadBE64(chunk + 48), ReadBE64(chunk + 56),
+                           ReadBE64(chunk + 64), ReadBE64(chunk + 72), ReadBE64(chunk + 80), ReadBE64(chunk + 88),
+                           ReadBE64(chunk + 96), ReadBE64(chunk + 104), ReadBE64(chunk + 112), ReadBE64(chunk + 120));
+}
+
+void Iterate64(unsigned char* hash, uint64_t count)
+{
+    sha512::Iterate64(hash, count);
+}
+} // namespace sha512_bmi2
+
+#endif
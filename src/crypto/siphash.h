@@ -44,4 +44,11 @@ public:
 uint64_t SipHashUint256(uint64_t k0, uint64_t k1, const uint256& val);
 uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
 
+/** SipHash-1-3 of a uint256, with one compression round per word and three
+ *  finalization rounds instead of two and four. It is the variant hash tables
+ *  use elsewhere to resist hash flooding; it is not meant as a MAC.
+ */
+uint64_t SipHash13Uint256(uint64_t k0, uint64_t k1, const uint256& val);
+uint64_t SipHash13Uint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra);
+
 #endif // BITCOIN_CRYPTO_SIPHASH_H
@@ -27,9 +27,43 @@
  *
  * 2. @ref cache is a cache which is performant in memory usage and lookup speed. It
  * is lockfree for erase operations. Elements are lazily erased on the next insert.
+ *
+ * 3. @ref Counters keeps usage statistics of a cache, updated by its users.
  */
 namespace CuckooCache
 {
+/** Snapshot of the usage statistics of a cache. */
+struct Stats {
+    uint64_t inserts{0};
+    uint64_t hits{0};
+    uint64_t misses{0};
+    //! Elements that were dropped by an insert before they were erased
+    uint64_t evictions{0};
+    uint32_t capacity{0};
+};
+
+/** Usage counters of a cache. The cache does not count lookups itself, so the
+ *  owner updates these, possibly from several threads at once. */
+struct Counters {
+    std::atomic<uint64_t> inserts{0};
+    std::atomic<uint64_t> hits{0};
+    std::atomic<uint64_t> misses{0};
+    std::atomic<uint64_t> evictions{0};
+
+    void Lookup(bool hit) { (hit ? hits : misses).fetch_add(1, std::memory_order_relaxed); }
+    void Insert(bool evicted)
+    {
+        inserts.fetch_add(1, std::memory_order_relaxed);
+        if (evicted) evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    Stats Get(uint32_t capacity) const
+    {
+        return {inserts.load(std::memory_order_relaxed), hits.load(std::memory_order_relaxed),
+                misses.load(std::memory_order_relaxed), evictions.load(std::memory_order_relaxed), capacity};
+    }
+};
+
 /** @ref bit_packed_atomic_flags implements a container for garbage collection flags
  * that is only thread unsafe on calls to setup. This class bit-packs collection
  * flags for memory efficiency.
@@ -376,6 +410,29 @@ public:
         return std::make_pair(num_elems, approx_size_bytes);
     }
 
+    /** resize changes the number of elements the cache can store, like
+     * setup, but keeps the elements that are not marked for erasure (as far
+     * as they fit). It is not thread safe.
+     *
+     * @param new_size the desired number of elements to store
+     * @returns the maximum number of elements storable
+     */
+    uint32_t resize(uint32_t new_size)
+    {
+        std::vector<Element> old_table;
+        old_table.swap(table);
+        bit_packed_atomic_flags old_flags{0};
+        std::swap(old_flags, collection_flags);
+        const uint32_t ret = setup(new_size);
+        for (uint32_t i = 0; i < old_table.size(); ++i) {
+            if (!old_flags.bit_is_set(i)) insert(std::move(old_table[i]));
+        }
+        return ret;
+    }
+
+    /** @returns the maximum number of elements storable */
+    uint32_t capacity() const { return size; }
+
     /** insert loops at most depth_limit times trying to insert a hash
      * at various locations in the table via a variant of the Cuckoo Algorithm
      * with eight hash locations.
@@ -396,8 +453,9 @@ public:
      * @post one of the following: All previously inserted elements and e are
      * now in the table, one previously inserted element is evicted from the
      * table, the entry attempted to be inserted is evicted.
+     * @returns true if an element was evicted
      */
-    inline void insert(Element e)
+    inline bool insert(Element e)
     {
         epoch_check();
         uint32_t last_loc = invalid();
@@ -409,7 +467,7 @@ public:
             if (table[loc] == e) {
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return false;
             }
         for (uint8_t depth = 0; depth < depth_limit; ++depth) {
             // First try to insert to an empty slot, if one exists
@@ -419,7 +477,7 @@ public:
                 table[loc] = std::move(e);
                 please_keep(loc);
                 epoch_flags[loc] = last_epoch;
-                return;
+                return false;
             }
             /** Swap with the element at the location that was
             * not the last one looked at. Example:
@@ -445,6 +503,20 @@ public:
             // Recompute the locs -- unfortunately happens one too many times!
             locs = compute_hashes(e);
         }
+        return true;
+    }
+
+    /** prefetch loads the hash locations of an element into the CPU cache, so
+     * that looking up many elements with contains overlaps their memory accesses.
+     *
+     * @param e the element that will be looked up
+     */
+    inline void prefetch(const Element& e) const
+    {
+#if defined(__GNUC__)
+        for (const uint32_t loc : compute_hashes(e))
+            __builtin_prefetch(&table[loc]);
+#endif
     }
 
     /** contains iterates through the hash locations for a given element
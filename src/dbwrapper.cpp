@@ -9,13 +9,16 @@
 #include <random.h>
 #include <tinyformat.h>
 #include <util/strencodings.h>
+#include <util/string.h>
 #include <util/system.h>
+#include <util/translation.h>
 
 #include <algorithm>
 #include <cassert>
 #include <cstdarg>
 #include <cstdint>
 #include <cstdio>
+#include <cstring>
 #include <leveldb/cache.h>
 #include <leveldb/db.h>
 #include <leveldb/env.h>
@@ -26,6 +29,8 @@
 #include <leveldb/status.h>
 #include <memory>
 #include <optional>
+#include <sstream>
+#include <utility>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -110,13 +115,79 @@ static void SetMaxOpenFiles(leveldb::Options *options) {
              options->max_open_files, default_open_files);
 }
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+const std::vector<std::string> DB_OPTION_NAMES{"chainstate", "blockindex", "txindex", "blockfilterindex", "coinstatsindex"};
+
+namespace {
+/** Apply one -leveldboption value to options if it is for db_name. Returns false if it is not valid. */
+bool ApplyDBOption(const std::string& arg, const std::string& db_name, DBOptions& options, bilingual_str& error)
+{
+    const size_t dot{arg.find('.')};
+    const size_t equals{arg.find('=')};
+    if (dot == std::string::npos || equals == std::string::npos || equals < dot) {
+        error = strprintf(_("Invalid -leveldboption '%s', expected <database>.<option>=<value>"), arg);
+        return false;
+    }
+    const std::string name{arg.substr(0, dot)};
+    const std::string key{arg.substr(dot + 1, equals - dot - 1)};
+    const std::optional<int64_t> value{ToIntegral<int64_t>(arg.substr(equals + 1))};
+    if (std::find(DB_OPTION_NAMES.begin(), DB_OPTION_NAMES.end(), name) == DB_OPTION_NAMES.end()) {
+        error = strprintf(_("Unknown database '%s' in -leveldboption, expected one of %s"), name, Join(DB_OPTION_NAMES, ", "));
+        return false;
+    }
+    if (!value || *value < 0) {
+        error = strprintf(_("Invalid value in -leveldboption '%s'"), arg);
+        return false;
+    }
+    DBOptions parsed{options};
+    if (key == "write_buffer_size") {
+        parsed.write_buffer_size = *value;
+    } else if (key == "block_size" && *value > 0) {
+        parsed.block_size = *value;
+    } else if (key == "bloom_bits" && *value <= 64) {
+        parsed.bloom_bits = *value;
+    } else if (key == "max_file_size" && *value > 0) {
+        parsed.max_file_size = *value;
+    } else if (key == "compression" && *value <= 1) {
+        parsed.compression = *value;
+    } else {
+        error = strprintf(_("Invalid option in -leveldboption '%s', expected write_buffer_size, block_size, bloom_bits (up to 64), max_file_size or compression (0 or 1)"), arg);
+        return false;
+    }
+    if (name == db_name) options = parsed;
+    return true;
+}
+} // namespace
+
+bool CheckDBOptions(const ArgsManager& args, bilingual_str& error)
+{
+    DBOptions ignored;
+    for (const std::string& arg : args.GetArgs("-leveldboption")) {
+        if (!ApplyDBOption(arg, "", ignored, error)) return false;
+    }
+    return true;
+}
+
+DBOptions GetDBOptions(const ArgsManager& args, const std::string& db_name)
+{
+    DBOptions options;
+    bilingual_str error;
+    for (const std::string& arg : args.GetArgs("-leveldboption")) {
+        // Invalid settings are rejected by CheckDBOptions() at startup.
+        ApplyDBOption(arg, db_name, options, error);
+    }
+    return options;
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const DBOptions& db_options)
 {
     leveldb::Options options;
     options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
-    options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
-    options.filter_policy = leveldb::NewBloomFilterPolicy(10);
-    options.compression = leveldb::kNoCompression;
+    // up to two write buffers may be held in memory simultaneously
+    options.write_buffer_size = db_options.write_buffer_size ? db_options.write_buffer_size : nCacheSize / 4;
+    options.block_size = db_options.block_size;
+    options.max_file_size = db_options.max_file_size;
+    options.filter_policy = db_options.bloom_bits ? leveldb::NewBloomFilterPolicy(db_options.bloom_bits) : nullptr;
+    options.compression = db_options.compression ? leveldb::kSnappyCompression : leveldb::kNoCompression;
     options.info_log = new CBitcoinLevelDBLogger();
     if (leveldb::kMajorVersion > 1 || (leveldb::kMajorVersion == 1 && leveldb::kMinorVersion >= 16)) {
         // LevelDB versions before 1.16 consider short writes to be corruption. Only trigger error
@@ -127,15 +198,108 @@ static leveldb::Options GetOptions(size_t nCacheSize)
     return options;
 }
 
-CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
-    : m_name{fs::PathToString(path.stem())}
+namespace dbwrapper_private {
+/**
+ * Environment of a database that defers the background work LevelDB
+ * schedules while compactions are paused and no write is going on. LevelDB
+ * schedules at most one background job at a time and only schedules the next
+ * one when it is done, so deferred work runs in the order it was scheduled.
+ */
+class CompactionEnv : public leveldb::EnvWrapper
+{
+    using Work = std::pair<void (*)(void*), void*>;
+
+    Mutex m_mutex;
+    int m_pauses GUARDED_BY(m_mutex){0};
+    int m_writes GUARDED_BY(m_mutex){0};
+    std::vector<Work> m_deferred GUARDED_BY(m_mutex);
+    uint64_t m_deferred_count GUARDED_BY(m_mutex){0};
+
+    void Release(std::vector<Work> work)
+    {
+        for (const auto& [function, arg] : work) target()->Schedule(function, arg);
+    }
+
+public:
+    explicit CompactionEnv(leveldb::Env* target) : leveldb::EnvWrapper{target} {}
+
+    void Schedule(void (*function)(void*), void* arg) override EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        {
+            LOCK(m_mutex);
+            if (m_pauses > 0 && m_writes == 0) {
+                m_deferred.emplace_back(function, arg);
+                ++m_deferred_count;
+                return;
+            }
+        }
+        target()->Schedule(function, arg);
+    }
+
+    void Pause() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        ++m_pauses;
+    }
+
+    void Resume() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::vector<Work> work;
+        {
+            LOCK(m_mutex);
+            assert(m_pauses > 0);
+            if (--m_pauses == 0) work.swap(m_deferred);
+        }
+        Release(std::move(work));
+    }
+
+    /** Let all background work run until EndWrite(), for a write or any other call that may wait for it. */
+    void BeginWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::vector<Work> work;
+        {
+            LOCK(m_mutex);
+            ++m_writes;
+            work.swap(m_deferred);
+        }
+        Release(std::move(work));
+    }
+
+    void EndWrite() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        assert(m_writes > 0);
+        --m_writes;
+    }
+
+    bool IsPaused() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex) { return WITH_LOCK(m_mutex, return m_pauses > 0); }
+    uint64_t GetDeferredCount() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex) { return WITH_LOCK(m_mutex, return m_deferred_count); }
+};
+} // namespace dbwrapper_private
+
+namespace {
+/** Lets the background work of a database run while it is alive, see CompactionEnv::BeginWrite(). */
+class WriteScope
+{
+    dbwrapper_private::CompactionEnv& m_env;
+
+public:
+    explicit WriteScope(dbwrapper_private::CompactionEnv& env) : m_env{env} { m_env.BeginWrite(); }
+    ~WriteScope() { m_env.EndWrite(); }
+    WriteScope(const WriteScope&) = delete;
+    WriteScope& operator=(const WriteScope&) = delete;
+};
+} // namespace
+
+CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate, const DBOptions& db_options)
+    : m_db_options{db_options}, m_block_cache_size{nCacheSize / 2}, m_name{fs::PathToString(path.stem())}
 {
     penv = nullptr;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, db_options);
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -149,6 +313,8 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
         TryCreateDirectories(path);
         LogPrintf("Opening LevelDB in %s\n", fs::PathToString(path));
     }
+    m_compaction_env = std::make_unique<dbwrapper_private::CompactionEnv>(options.env);
+    options.env = m_compaction_env.get();
     // PathToString() return value is safe to pass to leveldb open function,
     // because on POSIX leveldb passes the byte string directly to ::open(), and
     // on Windows it converts from UTF-8 to UTF-16 before calling ::CreateFileW
@@ -185,6 +351,8 @@ CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bo
 
 CDBWrapper::~CDBWrapper()
 {
+    // Closing the database waits for its background work
+    m_compaction_env->BeginWrite();
     delete pdb;
     pdb = nullptr;
     delete options.filter_policy;
@@ -204,7 +372,11 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     if (log_memory) {
         mem_before = DynamicMemoryUsage() / 1024.0 / 1024;
     }
-    leveldb::Status status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    leveldb::Status status;
+    {
+        const WriteScope write{*m_compaction_env};
+        status = pdb->Write(fSync ? syncoptions : writeoptions, &batch.batch);
+    }
     dbwrapper_private::HandleError(status);
     if (log_memory) {
         double mem_after = DynamicMemoryUsage() / 1024.0 / 1024;
@@ -214,6 +386,90 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     return true;
 }
 
+DBStats CDBWrapper::GetStats() const
+{
+    DBStats stats;
+    stats.memory_usage = DynamicMemoryUsage();
+    stats.block_cache_usage = options.block_cache->TotalCharge();
+    stats.block_cache_capacity = m_block_cache_size;
+    stats.options = m_db_options;
+    stats.options.write_buffer_size = options.write_buffer_size;
+    stats.compactions_paused = m_compaction_env->IsPaused();
+    stats.deferred_compactions = m_compaction_env->GetDeferredCount();
+    {
+        LOCK(m_idle_compaction_mutex);
+        stats.idle_compacted_ranges = m_idle_compacted_ranges;
+        stats.idle_compaction_done = !m_idle_compaction_next.has_value();
+    }
+
+    // The leveldb.stats property is a table with a line per level after
+    // three lines of headers, and only lists levels with files or compactions.
+    std::string text;
+    if (!pdb->GetProperty("leveldb.stats", &text)) {
+        LogPrint(BCLog::LEVELDB, "Failed to get stats property\n");
+        return stats;
+    }
+    std::istringstream lines{text};
+    std::string line;
+    for (int header = 0; header < 3 && std::getline(lines, line); ++header) {}
+    while (std::getline(lines, line)) {
+        std::istringstream fields{line};
+        DBStats::Level level;
+        if (fields >> level.level >> level.files >> level.size_mb >> level.compaction_seconds >> level.read_mb >> level.write_mb) {
+            stats.levels.push_back(level);
+        }
+    }
+    return stats;
+}
+
+CDBWrapper::CompactionPause::CompactionPause(CDBWrapper& db) : m_db{db}
+{
+    m_db.m_compaction_env->Pause();
+}
+
+CDBWrapper::CompactionPause::~CompactionPause()
+{
+    m_db.m_compaction_env->Resume();
+}
+
+bool CDBWrapper::CompactNextRange()
+{
+    LOCK(m_idle_compaction_mutex);
+    if (!m_idle_compaction_next) return false;
+
+    std::unique_ptr<leveldb::Iterator> it{pdb->NewIterator(iteroptions)};
+    it->Seek(*m_idle_compaction_next);
+    if (!it->Valid()) {
+        dbwrapper_private::HandleError(it->status());
+        LogPrintf("Finished idle compaction of %s in %d ranges\n", m_name, m_idle_compacted_ranges);
+        m_idle_compaction_next.reset();
+        return false;
+    }
+    const std::string begin{it->key().ToString().substr(0, 2)};
+    it.reset();
+    if (m_idle_compacted_ranges == 0) LogPrintf("Starting idle compaction of %s\n", m_name);
+    // The first key after the range, if there is one: begin with its last byte
+    // incremented, after dropping the trailing bytes that cannot be
+    std::string end{begin};
+    while (!end.empty() && static_cast<unsigned char>(end.back()) == 0xff) end.pop_back();
+    if (!end.empty()) ++end.back();
+
+    const leveldb::Slice begin_slice{begin}, end_slice{end};
+    {
+        // A manual compaction waits for the background work
+        const WriteScope write{*m_compaction_env};
+        pdb->CompactRange(&begin_slice, end.empty() ? nullptr : &end_slice);
+    }
+    ++m_idle_compacted_ranges;
+    if (end.empty()) {
+        LogPrintf("Finished idle compaction of %s in %d ranges\n", m_name, m_idle_compacted_ranges);
+        m_idle_compaction_next.reset();
+        return false;
+    }
+    m_idle_compaction_next = end;
+    return true;
+}
+
 size_t CDBWrapper::DynamicMemoryUsage() const
 {
     std::string memory;
@@ -244,6 +500,20 @@ std::vector<unsigned char> CDBWrapper::CreateObfuscateKey() const
     return ret;
 }
 
+std::optional<Span<const unsigned char>> CDBWrapper::ReadImpl(const leveldb::Slice& key) const
+{
+    static thread_local std::string value;
+    const leveldb::Status status{pdb->Get(readoptions, key, &value)};
+    if (!status.ok()) {
+        if (status.IsNotFound()) return std::nullopt;
+        LogPrintf("LevelDB read failure: %s\n", status.ToString());
+        dbwrapper_private::HandleError(status);
+    }
+    const Span<unsigned char> data{reinterpret_cast<unsigned char*>(value.data()), value.size()};
+    dbwrapper_private::Xor(data, obfuscate_key);
+    return data;
+}
+
 bool CDBWrapper::IsEmpty()
 {
     std::unique_ptr<CDBIterator> it(NewIterator());
@@ -273,4 +543,24 @@ const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w)
     return w.obfuscate_key;
 }
 
+void Xor(Span<unsigned char> data, const std::vector<unsigned char>& key)
+{
+    if (key.empty()) return;
+    size_t i{0};
+    if (key.size() == sizeof(uint64_t)) {
+        uint64_t key_word;
+        std::memcpy(&key_word, key.data(), sizeof(key_word));
+        for (; i + sizeof(uint64_t) <= data.size(); i += sizeof(uint64_t)) {
+            uint64_t word;
+            std::memcpy(&word, data.data() + i, sizeof(word));
+            word ^= key_word;
+            std::memcpy(data.data() + i, &word, sizeof(word));
+        }
+    }
+    for (size_t j = i % key.size(); i < data.size(); ++i) {
+        data[i] ^= key[j++];
+        if (j == key.size()) j = 0;
+    }
+}
+
 } // namespace dbwrapper_private
@@ -8,9 +8,11 @@
 #include <clientversion.h>
 #include <fs.h>
 #include <logging.h>
+#include <prevector.h>
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <sync.h>
 
 #include <cstddef>
 #include <cstdint>
@@ -21,6 +23,10 @@
 #include <leveldb/slice.h>
 #include <leveldb/status.h>
 #include <leveldb/write_batch.h>
+#include <algorithm>
+#include <memory>
+#include <numeric>
+#include <optional>
 #include <stdexcept>
 #include <string>
 #include <vector>
@@ -31,6 +37,63 @@ class Env;
 static const size_t DBWRAPPER_PREALLOC_KEY_SIZE = 64;
 static const size_t DBWRAPPER_PREALLOC_VALUE_SIZE = 1024;
 
+class ArgsManager;
+struct bilingual_str;
+
+/**
+ * LevelDB settings of a database that can be tuned with
+ * -leveldboption=<database>.<option>=<value>, as the databases are used in
+ * very different ways.
+ */
+struct DBOptions {
+    //! Size of the memory table, 0 for a quarter of the cache size
+    size_t write_buffer_size{0};
+    //! Approximate size of the uncompressed data in a table block
+    size_t block_size{4 * 1024};
+    //! Bits per key of the bloom filters, 0 for no filters
+    int bloom_bits{10};
+    //! Size of a table file before a new one is started
+    size_t max_file_size{2 * 1024 * 1024};
+    //! Whether table blocks are compressed with Snappy
+    bool compression{false};
+};
+
+//! Names of the databases that accept -leveldboption settings
+extern const std::vector<std::string> DB_OPTION_NAMES;
+
+/** Check that all -leveldboption settings are for a known database and option, with a valid value. */
+[[nodiscard]] bool CheckDBOptions(const ArgsManager& args, bilingual_str& error);
+
+/** Return the options of database db_name, with its -leveldboption settings applied. */
+DBOptions GetDBOptions(const ArgsManager& args, const std::string& db_name);
+
+/** Statistics of a LevelDB database, see CDBWrapper::GetStats() */
+struct DBStats {
+    struct Level {
+        int level;
+        int files;
+        double size_mb;
+        //! Time spent on compactions into this level
+        double compaction_seconds;
+        double read_mb;
+        double write_mb;
+    };
+    //! Levels that have files or had compactions
+    std::vector<Level> levels;
+    size_t memory_usage;
+    size_t block_cache_usage;
+    size_t block_cache_capacity;
+    DBOptions options;
+    //! Whether background compactions are paused, see CDBWrapper::CompactionPause
+    bool compactions_paused;
+    //! How often background work was deferred by a pause
+    uint64_t deferred_compactions;
+    //! Key ranges compacted by CDBWrapper::CompactNextRange()
+    uint64_t idle_compacted_ranges;
+    //! Whether CDBWrapper::CompactNextRange() compacted the whole database
+    bool idle_compaction_done;
+};
+
 class dbwrapper_error : public std::runtime_error
 {
 public:
@@ -47,12 +110,50 @@ namespace dbwrapper_private {
  */
 void HandleError(const leveldb::Status& status);
 
+class CompactionEnv;
+
 /** Work around circular dependency, as well as for testing in dbwrapper_tests.
  * Database obfuscation should be considered an implementation detail of the
  * specific database.
  */
 const std::vector<unsigned char>& GetObfuscateKey(const CDBWrapper &w);
 
+/** Apply or undo the XOR-obfuscation of data with key, a word at a time for the usual 8 byte key. */
+void Xor(Span<unsigned char> data, const std::vector<unsigned char>& key);
+
+/**
+ * Stream that serializes a key into a buffer of its own, which only needs the
+ * heap for keys larger than DBWRAPPER_PREALLOC_KEY_SIZE, so that reads do not
+ * allocate for their keys.
+ */
+class KeyWriter
+{
+private:
+    prevector<DBWRAPPER_PREALLOC_KEY_SIZE, char> m_key;
+
+public:
+    template <typename K>
+    explicit KeyWriter(const K& key) { ::Serialize(*this, key); }
+
+    template <typename T>
+    KeyWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    void write(Span<const std::byte> src)
+    {
+        const char* data{reinterpret_cast<const char*>(src.data())};
+        m_key.insert(m_key.end(), data, data + src.size());
+    }
+
+    int GetVersion() const { return CLIENT_VERSION; }
+    int GetType() const { return SER_DISK; }
+
+    leveldb::Slice Slice() const { return {m_key.data(), m_key.size()}; }
+};
+
 };
 
 /** Batch of changes queued to be written to a CDBWrapper */
@@ -131,6 +232,8 @@ class CDBIterator
 private:
     const CDBWrapper &parent;
     leveldb::Iterator *piter;
+    //! The value being deserialized, reused for all values of the iterator
+    std::vector<unsigned char> m_value;
 
 public:
 
@@ -159,7 +262,7 @@ public:
     template<typename K> bool GetKey(K& key) {
         leveldb::Slice slKey = piter->key();
         try {
-            CDataStream ssKey{MakeByteSpan(slKey), SER_DISK, CLIENT_VERSION};
+            SpanReader ssKey{SER_DISK, CLIENT_VERSION, {reinterpret_cast<const unsigned char*>(slKey.data()), slKey.size()}};
             ssKey >> key;
         } catch (const std::exception&) {
             return false;
@@ -170,8 +273,9 @@ public:
     template<typename V> bool GetValue(V& value) {
         leveldb::Slice slValue = piter->value();
         try {
-            CDataStream ssValue{MakeByteSpan(slValue), SER_DISK, CLIENT_VERSION};
-            ssValue.Xor(dbwrapper_private::GetObfuscateKey(parent));
+            m_value.assign(slValue.data(), slValue.data() + slValue.size());
+            dbwrapper_private::Xor(m_value, dbwrapper_private::GetObfuscateKey(parent));
+            SpanReader ssValue{SER_DISK, CLIENT_VERSION, m_value};
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -187,9 +291,18 @@ private:
     //! custom environment this database is using (may be nullptr in case of default environment)
     leveldb::Env* penv;
 
+    //! environment wrapping penv or the default one, which defers background work while compactions are paused
+    std::unique_ptr<dbwrapper_private::CompactionEnv> m_compaction_env;
+
     //! database options used
     leveldb::Options options;
 
+    //! tunable options this database was opened with
+    DBOptions m_db_options;
+
+    //! capacity of options.block_cache
+    size_t m_block_cache_size;
+
     //! options used when reading from the database
     leveldb::ReadOptions readoptions;
 
@@ -219,6 +332,18 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    mutable Mutex m_idle_compaction_mutex;
+    //! The key CompactNextRange() continues from, or std::nullopt once it compacted the last range
+    std::optional<std::string> m_idle_compaction_next GUARDED_BY(m_idle_compaction_mutex){std::string{}};
+    uint64_t m_idle_compacted_ranges GUARDED_BY(m_idle_compaction_mutex){0};
+
+    /**
+     * Look up a key and return its deobfuscated value, or std::nullopt if it
+     * is not found. The value is held in a buffer of the calling thread, which
+     * its next read reuses, so reads do not allocate once it has grown.
+     */
+    std::optional<Span<const unsigned char>> ReadImpl(const leveldb::Slice& key) const;
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -227,8 +352,9 @@ public:
      * @param[in] fWipe       If true, remove all existing data.
      * @param[in] obfuscate   If true, store data obfuscated via simple XOR. If false, XOR
      *                        with a zero'd byte array.
+     * @param[in] db_options  LevelDB settings, see GetDBOptions().
      */
-    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false);
+    CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory = false, bool fWipe = false, bool obfuscate = false, const DBOptions& db_options = {});
     ~CDBWrapper();
 
     CDBWrapper(const CDBWrapper&) = delete;
@@ -237,22 +363,10 @@ public:
     template <typename K, typename V>
     bool Read(const K& key, V& value) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
-        ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
-
-        std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
-        }
+        const std::optional<Span<const unsigned char>> value_data{ReadImpl(dbwrapper_private::KeyWriter{key}.Slice())};
+        if (!value_data) return false;
         try {
-            CDataStream ssValue{MakeByteSpan(strValue), SER_DISK, CLIENT_VERSION};
-            ssValue.Xor(obfuscate_key);
+            SpanReader ssValue{SER_DISK, CLIENT_VERSION, *value_data};
             ssValue >> value;
         } catch (const std::exception&) {
             return false;
@@ -260,6 +374,52 @@ public:
         return true;
     }
 
+    /**
+     * Read the values of many keys at once. values[i] is set to the value of
+     * keys[i], or to std::nullopt if it is not found or cannot be
+     * deserialized. The keys are looked up in database order with a single
+     * iterator, which is faster than calling Read() for each of them in
+     * random order, and sees a consistent state of the database.
+     *
+     * @returns the number of values found.
+     */
+    template <typename K, typename V>
+    size_t ReadMany(const std::vector<K>& keys, std::vector<std::optional<V>>& values) const
+    {
+        std::vector<dbwrapper_private::KeyWriter> serialized_keys;
+        serialized_keys.reserve(keys.size());
+        for (const K& key : keys) serialized_keys.emplace_back(key);
+        // The default bytewise comparator orders keys like Slice::compare does.
+        std::vector<size_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return serialized_keys[a].Slice().compare(serialized_keys[b].Slice()) < 0; });
+
+        values.assign(keys.size(), std::nullopt);
+        size_t found{0};
+        std::unique_ptr<leveldb::Iterator> it{pdb->NewIterator(readoptions)};
+        std::vector<unsigned char> value_data;
+        for (size_t i : order) {
+            const leveldb::Slice slKey{serialized_keys[i].Slice()};
+            it->Seek(slKey);
+            if (!it->Valid() || it->key() != slKey) continue;
+            const leveldb::Slice slValue{it->value()};
+            try {
+                value_data.assign(slValue.data(), slValue.data() + slValue.size());
+                dbwrapper_private::Xor(value_data, obfuscate_key);
+                SpanReader ssValue{SER_DISK, CLIENT_VERSION, value_data};
+                ssValue >> values[i].emplace();
+                ++found;
+            } catch (const std::exception&) {
+                values[i].reset();
+            }
+        }
+        if (!it->status().ok()) {
+            LogPrintf("LevelDB read failure: %s\n", it->status().ToString());
+            dbwrapper_private::HandleError(it->status());
+        }
+        return found;
+    }
+
     template <typename K, typename V>
     bool Write(const K& key, const V& value, bool fSync = false)
     {
@@ -271,20 +431,7 @@ public:
     template <typename K>
     bool Exists(const K& key) const
     {
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey.reserve(DBWRAPPER_PREALLOC_KEY_SIZE);
-        ssKey << key;
-        leveldb::Slice slKey((const char*)ssKey.data(), ssKey.size());
-
-        std::string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
-        if (!status.ok()) {
-            if (status.IsNotFound())
-                return false;
-            LogPrintf("LevelDB read failure: %s\n", status.ToString());
-            dbwrapper_private::HandleError(status);
-        }
-        return true;
+        return ReadImpl(dbwrapper_private::KeyWriter{key}.Slice()).has_value();
     }
 
     template <typename K>
@@ -297,12 +444,50 @@ public:
 
     bool WriteBatch(CDBBatch& batch, bool fSync = false);
 
+    /**
+     * Defer the background work LevelDB schedules, compacting its memory
+     * table and table files, while an instance is alive, so that it does not
+     * compete for the disk with reads that should be fast. Writes to the
+     * database let all background work run until they are done, as LevelDB
+     * may have to wait for it to make room for them, so a pause cannot stall
+     * a write.
+     */
+    class CompactionPause
+    {
+        CDBWrapper& m_db;
+
+    public:
+        explicit CompactionPause(CDBWrapper& db);
+        ~CompactionPause();
+        CompactionPause(const CompactionPause&) = delete;
+        CompactionPause& operator=(const CompactionPause&) = delete;
+    };
+
+    /**
+     * Compact the range of keys that start with the same two bytes as the
+     * first key not compacted yet, so that the whole database can be
+     * compacted at idle times, a range at a time. Returns false once the
+     * last range is compacted.
+     */
+    bool CompactNextRange() EXCLUSIVE_LOCKS_REQUIRED(!m_idle_compaction_mutex);
+
     // Get an estimate of LevelDB memory usage (in bytes).
     size_t DynamicMemoryUsage() const;
 
-    CDBIterator *NewIterator()
+    //! Get the per-level statistics, memory and block cache usage and options of the database.
+    DBStats GetStats() const EXCLUSIVE_LOCKS_REQUIRED(!m_idle_compaction_mutex);
+
+    /**
+     * Create an iterator. By default, the blocks it reads are not added to
+     * the block cache, so a sequential scan does not evict the blocks that
+     * point reads use. Set fill_cache for an iterator that only seeks to and
+     * reads a few entries that are likely to be read again.
+     */
+    CDBIterator *NewIterator(bool fill_cache = false)
     {
-        return new CDBIterator(*this, pdb->NewIterator(iteroptions));
+        leveldb::ReadOptions options{iteroptions};
+        options.fill_cache = fill_cache;
+        return new CDBIterator(*this, pdb->NewIterator(options));
     }
 
     /**
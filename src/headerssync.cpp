@@ -7,42 +7,49 @@
 #include <pow.h>
 #include <timedata.h>
 #include <util/check.h>
+#include <util/trace.h>
 
-// The two constants below are computed using the simulation script on
-// https://gist.github.com/sipa/016ae445c132cdf65a2791534dfb7ae1
-
-//! Store a commitment to a header every HEADER_COMMITMENT_PERIOD blocks.
-constexpr size_t HEADER_COMMITMENT_PERIOD{584};
-
-//! Only feed headers to validation once this many headers on top have been
-//! received and validated against commitments.
-constexpr size_t REDOWNLOAD_BUFFER_SIZE{13959}; // 13959/584 = ~23.9 commitments
+// Fastest block rate allowed by the MTP rule: the median of the last
+// nMedianTimeSpan timestamps has to increase, which takes at least
+// (nMedianTimeSpan + 1) / 2 new blocks per second. This does not depend on
+// the block spacing of the chain.
+static constexpr int64_t MAX_BLOCKS_PER_SECOND{(CBlockIndex::nMedianTimeSpan + 1) / 2};
+static_assert(MAX_BLOCKS_PER_SECOND == 6);
 
 // Our memory analysis assumes 48 bytes for a CompressedHeader (so we should
 // re-calculate parameters if we compress further)
 static_assert(sizeof(CompressedHeader) == 48);
 
 HeadersSyncState::HeadersSyncState(NodeId id, const Consensus::Params& consensus_params,
-        const CBlockIndex* chain_start, const arith_uint256& minimum_required_work) :
-    m_id(id), m_consensus_params(consensus_params),
+        const HeadersSyncParams& params, const CBlockIndex* chain_start,
+        const arith_uint256& minimum_required_work) :
+    m_id(id), m_consensus_params(consensus_params), m_params(params),
     m_chain_start(chain_start),
     m_minimum_required_work(minimum_required_work),
     m_current_chain_work(chain_start->nChainWork),
-    m_commit_offset(GetRand<unsigned>(HEADER_COMMITMENT_PERIOD)),
+    m_commit_offset(GetRand<unsigned>(m_params.commitment_period)),
     m_last_header_received(m_chain_start->GetBlockHeader()),
-    m_current_height(chain_start->nHeight)
+    m_current_height(chain_start->nHeight),
+    m_presync_window(*chain_start),
+    m_redownload_window(*chain_start)
 {
     // Estimate the number of blocks that could possibly exist on the peer's
-    // chain *right now* using 6 blocks/second (fastest blockrate given the MTP
-    // rule) times the number of seconds from the last allowed block until
+    // chain *right now* using MAX_BLOCKS_PER_SECOND (fastest blockrate given
+    // the MTP rule) times the number of seconds from the last allowed block until
     // today. This serves as a memory bound on how many commitments we might
     // store from this peer, and we can safely give up syncing if the peer
     // exceeds this bound, because it's not possible for a consensus-valid
     // chain to be longer than this (at the current time -- in the future we
     // could try again, if necessary, to sync a longer chain).
-    m_max_commitments = 6*(Ticks<std::chrono::seconds>(GetAdjustedTime() - NodeSeconds{std::chrono::seconds{chain_start->GetMedianTimePast()}}) + MAX_FUTURE_BLOCK_TIME) / HEADER_COMMITMENT_PERIOD;
+    m_max_commitments = MAX_BLOCKS_PER_SECOND*(Ticks<std::chrono::seconds>(GetAdjustedTime() - NodeSeconds{std::chrono::seconds{chain_start->GetMedianTimePast()}}) + MAX_FUTURE_BLOCK_TIME) / m_params.commitment_period;
 
     LogPrint(BCLog::NET, "Initial headers sync started with peer=%d: height=%i, max_commitments=%i, min_work=%s\n", m_id, m_current_height, m_max_commitments, m_minimum_required_work.ToString());
+    TRACE4(headerssync, state_change,
+        (int64_t)m_id,
+        (int32_t)State::PRESYNC,
+        m_current_height,
+        (int64_t)m_chain_start->nHeight
+    );
 }
 
 /** Free any memory in use, and mark this object as no longer usable. This is
@@ -51,6 +58,12 @@ HeadersSyncState::HeadersSyncState(NodeId id, const Consensus::Params& consensus
 void HeadersSyncState::Finalize()
 {
     Assume(m_download_state != State::FINAL);
+    TRACE4(headerssync, state_change,
+        (int64_t)m_id,
+        (int32_t)State::FINAL,
+        m_current_height,
+        m_redownload_buffer_last_height
+    );
     m_header_commitments = {};
     m_last_header_received.SetNull();
     m_redownloaded_headers = {};
@@ -168,8 +181,15 @@ bool HeadersSyncState::ValidateAndStoreHeadersCommitments(const std::vector<CBlo
         m_redownload_buffer_first_prev_hash = m_chain_start->GetBlockHash();
         m_redownload_buffer_last_hash = m_chain_start->GetBlockHash();
         m_redownload_chain_work = m_chain_start->nChainWork;
+        m_redownload_window = DifficultyWindow{*m_chain_start};
         m_download_state = State::REDOWNLOAD;
         LogPrint(BCLog::NET, "Initial headers sync transition with peer=%d: reached sufficient work at height=%i, redownloading from height=%i\n", m_id, m_current_height, m_redownload_buffer_last_height);
+        TRACE4(headerssync, state_change,
+            (int64_t)m_id,
+            (int32_t)State::REDOWNLOAD,
+            m_current_height,
+            m_redownload_buffer_last_height
+        );
     }
     return true;
 }
@@ -181,18 +201,18 @@ bool HeadersSyncState::ValidateAndProcessSingleHeader(const CBlockHeader& curren
 
     int next_height = m_current_height + 1;
 
-    // Verify that the difficulty isn't growing too fast; an adversary with
-    // limited hashing capability has a greater chance of producing a high
-    // work chain if they compress the work into as few blocks as possible,
-    // so don't let anyone give a chain that would violate the difficulty
-    // adjustment maximum.
-    if (!PermittedDifficultyTransition(m_consensus_params, next_height,
-                m_last_header_received.nBits, current.nBits)) {
+    // Verify that the difficulty follows the adjustment rule; an adversary
+    // with limited hashing capability has a greater chance of producing a
+    // high work chain if they compress the work into as few blocks as
+    // possible, so don't let anyone give a chain with any other target. The
+    // damped 60-block average permits almost any transition between two
+    // neighbouring headers, so the exact target is checked from the window.
+    if (current.nBits != m_presync_window.GetNextWorkRequired(m_consensus_params)) {
         LogPrint(BCLog::NET, "Initial headers sync aborted with peer=%d: invalid difficulty transition at height=%i (presync phase)\n", m_id, next_height);
         return false;
     }
 
-    if (next_height % HEADER_COMMITMENT_PERIOD == m_commit_offset) {
+    if (next_height % m_params.commitment_period == m_commit_offset) {
         // Add a commitment.
         m_header_commitments.push_back(m_hasher(current.GetHash()) & 1);
         if (m_header_commitments.size() > m_max_commitments) {
@@ -208,6 +228,7 @@ bool HeadersSyncState::ValidateAndProcessSingleHeader(const CBlockHeader& curren
     m_current_chain_work += GetBlockProof(CBlockIndex(current));
     m_last_header_received = current;
     m_current_height = next_height;
+    m_presync_window.Push(current.nTime, current.nBits);
 
     return true;
 }
@@ -226,16 +247,8 @@ bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& he
         return false;
     }
 
-    // Check that the difficulty adjustments are within our tolerance:
-    uint32_t previous_nBits{0};
-    if (!m_redownloaded_headers.empty()) {
-        previous_nBits = m_redownloaded_headers.back().nBits;
-    } else {
-        previous_nBits = m_chain_start->nBits;
-    }
-
-    if (!PermittedDifficultyTransition(m_consensus_params, next_height,
-                previous_nBits, header.nBits)) {
+    // Check that the difficulty follows the adjustment rule:
+    if (header.nBits != m_redownload_window.GetNextWorkRequired(m_consensus_params)) {
         LogPrint(BCLog::NET, "Initial headers sync aborted with peer=%d: invalid difficulty transition at height=%i (redownload phase)\n", m_id, next_height);
         return false;
     }
@@ -253,7 +266,7 @@ bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& he
     // it's possible our peer has extended its chain between our first sync and
     // our second, and we don't want to return failure after we've seen our
     // target blockhash just because we ran out of commitments.
-    if (!m_process_all_remaining_headers && next_height % HEADER_COMMITMENT_PERIOD == m_commit_offset) {
+    if (!m_process_all_remaining_headers && next_height % m_params.commitment_period == m_commit_offset) {
         if (m_header_commitments.size() == 0) {
             LogPrint(BCLog::NET, "Initial headers sync aborted with peer=%d: commitment overrun at height=%i (redownload phase)\n", m_id, next_height);
             // Somehow our peer managed to feed us a different chain and
@@ -273,6 +286,7 @@ bool HeadersSyncState::ValidateAndStoreRedownloadedHeader(const CBlockHeader& he
     m_redownloaded_headers.push_back(header);
     m_redownload_buffer_last_height = next_height;
     m_redownload_buffer_last_hash = header.GetHash();
+    m_redownload_window.Push(header.nTime, header.nBits);
 
     return true;
 }
@@ -284,7 +298,7 @@ std::vector<CBlockHeader> HeadersSyncState::PopHeadersReadyForAcceptance()
     Assume(m_download_state == State::REDOWNLOAD);
     if (m_download_state != State::REDOWNLOAD) return ret;
 
-    while (m_redownloaded_headers.size() > REDOWNLOAD_BUFFER_SIZE ||
+    while (m_redownloaded_headers.size() > m_params.redownload_buffer_size ||
             (m_redownloaded_headers.size() > 0 && m_process_all_remaining_headers)) {
         ret.emplace_back(m_redownloaded_headers.front().GetFullHeader(m_redownload_buffer_first_prev_hash));
         m_redownloaded_headers.pop_front();
@@ -293,6 +307,32 @@ std::vector<CBlockHeader> HeadersSyncState::PopHeadersReadyForAcceptance()
     return ret;
 }
 
+size_t HeadersSyncState::GetMemoryUsage() const
+{
+    return (m_header_commitments.size() + 7) / 8 + m_redownloaded_headers.size() * sizeof(CompressedHeader);
+}
+
+bool HeadersSyncState::HasValidTargets(const std::vector<CBlockHeader>& headers) const
+{
+    if (headers.empty()) return true;
+
+    DifficultyWindow window{m_presync_window};
+    if (m_download_state == State::PRESYNC) {
+        if (headers[0].hashPrevBlock != m_last_header_received.GetHash()) return true;
+    } else if (m_download_state == State::REDOWNLOAD) {
+        if (headers[0].hashPrevBlock != m_redownload_buffer_last_hash) return true;
+        window = m_redownload_window;
+    } else {
+        return true;
+    }
+
+    for (const CBlockHeader& header : headers) {
+        if (header.nBits != window.GetNextWorkRequired(m_consensus_params)) return false;
+        window.Push(header.nTime, header.nBits);
+    }
+    return true;
+}
+
 CBlockLocator HeadersSyncState::NextHeadersRequestLocator() const
 {
     Assume(m_download_state != State::FINAL);
@@ -7,8 +7,10 @@
 
 #include <arith_uint256.h>
 #include <chain.h>
+#include <chainparams.h>
 #include <consensus/params.h>
 #include <net.h> // For NodeId
+#include <pow.h>
 #include <primitives/block.h>
 #include <uint256.h>
 #include <util/bitdeque.h>
@@ -132,11 +134,13 @@ public:
      *
      * id: node id (for logging)
      * consensus_params: parameters needed for difficulty adjustment validation
+     * params: commitment period and redownload buffer size of the chain
      * chain_start: best known fork point that the peer's headers branch from
      * minimum_required_work: amount of chain work required to accept the chain
      */
     HeadersSyncState(NodeId id, const Consensus::Params& consensus_params,
-            const CBlockIndex* chain_start, const arith_uint256& minimum_required_work);
+            const HeadersSyncParams& params, const CBlockIndex* chain_start,
+            const arith_uint256& minimum_required_work);
 
     /** Result data structure for ProcessNextHeaders. */
     struct ProcessingResult {
@@ -175,6 +179,21 @@ public:
      */
     CBlockLocator NextHeadersRequestLocator() const;
 
+    /** Check the nBits of headers that continue the chain of the current
+     * phase against the exact difficulty adjustment, without changing any
+     * state. This is much cheaper than checking their proof of work, so it
+     * can reject a bad batch before any NeoScrypt hashing.
+     *
+     * Returns false only if the headers connect to the last header we have
+     * and one of them has the wrong nBits; headers that do not connect are
+     * left for ProcessNextHeaders() to deal with.
+     */
+    bool HasValidTargets(const std::vector<CBlockHeader>& headers) const;
+
+    /** Return the number of bytes used for commitments and buffered headers,
+     *  which is what the headers sync parameters trade off. */
+    size_t GetMemoryUsage() const;
+
 private:
     /** Clear out all download state that might be in progress (freeing any used
      * memory), and mark this object as no longer usable.
@@ -207,6 +226,9 @@ private:
     /** We use the consensus params in our anti-DoS calculations */
     const Consensus::Params& m_consensus_params;
 
+    /** Commitment period and redownload buffer size, see HeadersSyncParams */
+    const HeadersSyncParams m_params;
+
     /** Store the last block in our block index that the peer's chain builds from */
     const CBlockIndex* m_chain_start{nullptr};
 
@@ -225,7 +247,7 @@ private:
     /** The (secret) offset on the heights for which to create commitments.
      *
      * m_header_commitments entries are created at any height h for which
-     * (h % HEADER_COMMITMENT_PERIOD) == m_commit_offset. */
+     * (h % m_params.commitment_period) == m_commit_offset. */
     const unsigned m_commit_offset;
 
     /** m_max_commitments is a bound we calculate on how long an honest peer's chain could be,
@@ -241,6 +263,10 @@ private:
     /** Height of m_last_header_received */
     int64_t m_current_height{0};
 
+    /** Difficulty window ending at m_last_header_received, giving the exact
+     * nBits of the next header in PRESYNC. */
+    DifficultyWindow m_presync_window;
+
     /** During phase 2 (REDOWNLOAD), we buffer redownloaded headers in memory
      *  until enough commitments have been verified; those are stored in
      *  m_redownloaded_headers */
@@ -264,6 +290,9 @@ private:
     /** The accumulated work on the redownloaded chain. */
     arith_uint256 m_redownload_chain_work;
 
+    /** Difficulty window ending at the last redownloaded header. */
+    DifficultyWindow m_redownload_window;
+
     /** Set this to true once we encounter the target blockheader during phase
      * 2 (REDOWNLOAD). At this point, we can process and store all remaining
      * headers still in m_redownloaded_headers.
@@ -0,0 +1,136 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <httprpc.h>
+
+#include <cuckoocache.h>
+#include <httpserver.h>
+#include <net.h>
+#include <node/context.h>
+#include <node/memory_usage.h>
+#include <powcache.h>
+#include <rpc/protocol.h>
+#include <script/sigcache.h>
+#include <tinyformat.h>
+#include <util/metrics.h>
+#include <validation.h>
+
+#include <any>
+#include <string>
+#include <vector>
+
+using node::NodeContext;
+
+static const std::string METRICS_PATH{"/metrics"};
+static const std::string METRICS_PREFIX{"certurium_"};
+
+/** Write the HELP and TYPE lines of a metric family in the Prometheus text format */
+static void AppendFamily(std::string& out, const std::string& name, const std::string& type, const std::string& help)
+{
+    out += strprintf("# HELP %s%s %s\n# TYPE %s%s %s\n", METRICS_PREFIX, name, help, METRICS_PREFIX, name, type);
+}
+
+static void AppendSample(std::string& out, const std::string& name, const std::string& labels, uint64_t value)
+{
+    out += strprintf("%s%s%s %u\n", METRICS_PREFIX, name, labels.empty() ? "" : "{" + labels + "}", value);
+}
+
+static void AppendHistogram(std::string& out, const std::string& name, const std::string& labels, const MetricHistogram& histogram)
+{
+    const MetricHistogram::Snapshot snapshot{histogram.Get()};
+    const std::string sep{labels.empty() ? "" : ","};
+    uint64_t cumulative{0};
+    for (size_t i = 0; i < snapshot.buckets.size(); ++i) {
+        cumulative += snapshot.buckets[i];
+        const std::string le{i < MetricHistogram::BUCKET_BOUNDS.size() ? strprintf("%g", MetricHistogram::BUCKET_BOUNDS[i] / 1e6) : "+Inf"};
+        out += strprintf("%s%s_bucket{%s%sle=\"%s\"} %u\n", METRICS_PREFIX, name, labels, sep, le, cumulative);
+    }
+    out += strprintf("%s%s_sum%s %.6f\n", METRICS_PREFIX, name, labels.empty() ? "" : "{" + labels + "}", snapshot.sum.count() / 1e6);
+    out += strprintf("%s%s_count%s %u\n", METRICS_PREFIX, name, labels.empty() ? "" : "{" + labels + "}", cumulative);
+}
+
+/**
+ * Serve the metrics in the Prometheus text format. Everything is read from
+ * counters updated without locking, so that scraping never waits for cs_main.
+ */
+static bool HTTPReq_Metrics(const std::any& context, HTTPRequest* req, const std::string&)
+{
+    if (req->GetRequestMethod() != HTTPRequest::GET) {
+        req->WriteReply(HTTP_BAD_METHOD, "Only GET is supported\r\n");
+        return false;
+    }
+    const NodeContext* const node{std::any_cast<NodeContext*>(context)};
+    const NodeMetrics& metrics{Metrics()};
+    std::string out;
+
+    AppendFamily(out, "block_connect_seconds", "histogram", "Time spent in the phases of connecting a block to the tip");
+    for (const auto& [phase, histogram] : {
+             std::pair<const char*, const MetricHistogram&>{"load", metrics.block_load},
+             {"sanity", metrics.block_sanity},
+             {"connect_txs", metrics.block_connect_txs},
+             {"verify", metrics.block_verify},
+             {"index", metrics.block_index},
+             {"connect", metrics.block_connect},
+             {"flush", metrics.block_flush},
+             {"chainstate", metrics.block_chainstate},
+             {"postprocess", metrics.block_postprocess},
+             {"total", metrics.block_total},
+         }) {
+        AppendHistogram(out, "block_connect_seconds", strprintf("phase=\"%s\"", phase), histogram);
+    }
+    AppendFamily(out, "mempool_accept_seconds", "histogram", "Time spent accepting a transaction to the mempool");
+    AppendHistogram(out, "mempool_accept_seconds", "", metrics.mempool_accept);
+    AppendFamily(out, "coins_db_flush_seconds", "histogram", "Time spent writing the coins cache to the database");
+    AppendHistogram(out, "coins_db_flush_seconds", "", metrics.coins_db_flush);
+
+    AppendFamily(out, "checkqueue_checks_total", "counter", "Script checks run by the check queue threads");
+    AppendSample(out, "checkqueue_checks_total", "", metrics.checkqueue_checks.Value());
+    AppendFamily(out, "checkqueue_busy_seconds_total", "counter", "Time the check queue threads spent running checks");
+    out += strprintf("%scheckqueue_busy_seconds_total %.6f\n", METRICS_PREFIX, metrics.checkqueue_busy_micros.Value() / 1e6);
+
+    const CuckooCache::Stats sigcache{GetSignatureCacheStats()};
+    const PoWHashCacheStats powcache{GetPoWHashCacheStats()};
+    AppendFamily(out, "cache_hits_total", "counter", "Lookups answered from a cache");
+    AppendSample(out, "cache_hits_total", "cache=\"signature\"", sigcache.hits);
+    AppendSample(out, "cache_hits_total", "cache=\"pow\"", powcache.hits);
+    AppendFamily(out, "cache_misses_total", "counter", "Lookups a cache could not answer");
+    AppendSample(out, "cache_misses_total", "cache=\"signature\"", sigcache.misses);
+    AppendSample(out, "cache_misses_total", "cache=\"pow\"", powcache.misses);
+
+    AppendFamily(out, "net_message_bytes_total", "counter", "Bytes of the messages exchanged with all peers, per message type");
+    for (const NetMsgTypeBytes& bytes : GetTotalBytesPerMsgType()) {
+        AppendSample(out, "net_message_bytes_total", strprintf("direction=\"sent\",type=\"%s\"", bytes.msg_type), bytes.sent);
+        AppendSample(out, "net_message_bytes_total", strprintf("direction=\"received\",type=\"%s\"", bytes.msg_type), bytes.recv);
+    }
+
+    // Measured by the scheduler, which waits for cs_main instead of the scrape
+    const std::vector<node::SubsystemMemoryUsage> memory_usage{node::GetMemoryUsageSnapshot()};
+    if (!memory_usage.empty()) {
+        AppendFamily(out, "memory_usage_bytes", "gauge", "Memory used by a subsystem of the node, as measured at most a minute ago");
+        for (const node::SubsystemMemoryUsage& usage : memory_usage) {
+            AppendSample(out, "memory_usage_bytes", strprintf("subsystem=\"%s\"", usage.name), usage.bytes);
+        }
+    }
+
+    if (node && node->chainman) {
+        if (const auto tip{node->chainman->TipSnapshot()}) {
+            AppendFamily(out, "chain_height", "gauge", "Height of the active chain tip");
+            AppendSample(out, "chain_height", "", tip->height);
+        }
+    }
+
+    req->WriteHeader("Content-Type", "text/plain; version=0.0.4; charset=utf-8");
+    req->WriteReply(HTTP_OK, out);
+    return true;
+}
+
+void StartHTTPMetrics(const std::any& context)
+{
+    RegisterHTTPHandler(METRICS_PATH, true, [context](HTTPRequest* req, const std::string& path) { return HTTPReq_Metrics(context, req, path); });
+}
+
+void StopHTTPMetrics()
+{
+    UnregisterHTTPHandler(METRICS_PATH, true);
+}
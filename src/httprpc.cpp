@@ -6,6 +6,7 @@
 
 #include <crypto/hmac_sha256.h>
 #include <httpserver.h>
+#include <rpc/cbor.h>
 #include <rpc/protocol.h>
 #include <rpc/server.h>
 #include <util/strencodings.h>
@@ -71,7 +72,26 @@ static std::vector<std::vector<std::string>> g_rpcauth;
 static std::map<std::string, std::set<std::string>> g_rpc_whitelist;
 static bool g_rpc_whitelist_default = false;
 
-static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id)
+/** Whether the client asked for replies encoded as CBOR instead of JSON */
+static bool WantsCBOR(HTTPRequest* req)
+{
+    const auto [present, accept] = req->GetHeader("accept");
+    return present && accept.find(CBOR_CONTENT_TYPE) != std::string::npos;
+}
+
+/** Send a reply, as JSON or as CBOR if the client asked for it */
+static void WriteRPCReply(HTTPRequest* req, int status, const UniValue& reply, bool cbor)
+{
+    if (cbor) {
+        req->WriteHeader("Content-Type", CBOR_CONTENT_TYPE);
+        req->WriteReply(status, EncodeCBOR(reply));
+    } else {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(status, reply.write() + "\n");
+    }
+}
+
+static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const UniValue& id, bool cbor)
 {
     // Send error reply from json-rpc error object
     int nStatus = HTTP_INTERNAL_SERVER_ERROR;
@@ -82,10 +102,7 @@ static void JSONErrorReply(HTTPRequest* req, const UniValue& objError, const Uni
     else if (code == RPC_METHOD_NOT_FOUND)
         nStatus = HTTP_NOT_FOUND;
 
-    std::string strReply = JSONRPCReply(NullUniValue, objError, id);
-
-    req->WriteHeader("Content-Type", "application/json");
-    req->WriteReply(nStatus, strReply);
+    WriteRPCReply(req, nStatus, JSONRPCReplyObj(NullUniValue, objError, id), cbor);
 }
 
 //This function checks username and password against -rpcauth
@@ -174,6 +191,7 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         return false;
     }
 
+    const bool cbor{WantsCBOR(req)};
     try {
         // Parse request
         UniValue valRequest;
@@ -183,7 +201,7 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
         // Set the URI
         jreq.URI = req->GetURI();
 
-        std::string strReply;
+        UniValue reply;
         bool user_has_whitelist = g_rpc_whitelist.count(jreq.authUser);
         if (!user_has_whitelist && g_rpc_whitelist_default) {
             LogPrintf("RPC User %s not allowed to call any methods\n", jreq.authUser);
@@ -198,10 +216,26 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                 req->WriteReply(HTTP_FORBIDDEN);
                 return false;
             }
+            // Methods with large results may stream them as JSON, and the reply is sent as a
+            // chunked reply once it outgrows the buffer of the stream
+            const std::string reply_suffix{",\"error\":null,\"id\":" + jreq.id.write() + "}\n"};
+            JSONStreamWriter result_stream{[&](std::string&& data, bool last) {
+                if (!req->IsReplyStarted()) {
+                    req->WriteHeader("Content-Type", "application/json");
+                    data.insert(0, "{\"result\":");
+                }
+                if (last) data += reply_suffix;
+                req->WriteReplyPart(HTTP_OK, data, last);
+            }};
+            if (!cbor) jreq.result_stream = &result_stream;
             UniValue result = tableRPC.execute(jreq);
+            if (!result_stream.Empty()) {
+                result_stream.Finish();
+                return true;
+            }
 
             // Send reply
-            strReply = JSONRPCReply(result, NullUniValue, jreq.id);
+            reply = JSONRPCReplyObj(result, NullUniValue, jreq.id);
 
         // array of requests
         } else if (valRequest.isArray()) {
@@ -221,18 +255,22 @@ static bool HTTPReq_JSONRPC(const std::any& context, HTTPRequest* req)
                     }
                 }
             }
-            strReply = JSONRPCExecBatch(jreq, valRequest.get_array());
+            // Let idle RPC workers help with the calls of large batches
+            const int max_helpers = gArgs.GetIntArg("-rpcthreads", DEFAULT_HTTP_THREADS) - 1;
+            reply = JSONRPCExecBatch(jreq, valRequest.get_array(), EnqueueHTTPWork, max_helpers);
         }
         else
             throw JSONRPCError(RPC_PARSE_ERROR, "Top-level object parse error");
 
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strReply);
+        WriteRPCReply(req, HTTP_OK, reply, cbor);
     } catch (const UniValue& objError) {
-        JSONErrorReply(req, objError, jreq.id);
+        // A streamed reply that failed after it was started can only be cut short
+        if (req->IsReplyStarted()) return false;
+        JSONErrorReply(req, objError, jreq.id, cbor);
         return false;
     } catch (const std::exception& e) {
-        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id);
+        if (req->IsReplyStarted()) return false;
+        JSONErrorReply(req, JSONRPCError(RPC_PARSE_ERROR, e.what()), jreq.id, cbor);
         return false;
     }
     return true;
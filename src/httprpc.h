@@ -31,4 +31,12 @@ void InterruptREST();
  */
 void StopREST();
 
+/** Start serving node metrics over HTTP.
+ * Precondition; HTTP has been started.
+ */
+void StartHTTPMetrics(const std::any& context);
+/** Stop serving node metrics over HTTP.
+ */
+void StopHTTPMetrics();
+
 #endif // BITCOIN_HTTPRPC_H
@@ -27,6 +27,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <sys/types.h>
 #include <sys/stat.h>
@@ -35,6 +38,7 @@
 #include <event2/bufferevent.h>
 #include <event2/http.h>
 #include <event2/keyvalq_struct.h>
+#include <event2/listener.h>
 #include <event2/thread.h>
 #include <event2/util.h>
 
@@ -63,6 +67,17 @@ private:
     HTTPRequestHandler func;
 };
 
+/** Work item running a function that is not tied to a request */
+class HTTPFunctionItem final : public HTTPClosure
+{
+public:
+    explicit HTTPFunctionItem(std::function<void()> func) : m_func(std::move(func)) {}
+    void operator()() override { m_func(); }
+
+private:
+    const std::function<void()> m_func;
+};
+
 /** Simple work queue for distributing work over multiple threads.
  * Work items are simply callable objects.
  */
@@ -133,10 +148,17 @@ struct HTTPPathHandler
 
 /** HTTP module state */
 
-//! libevent event loop
-static struct event_base* eventBase = nullptr;
-//! HTTP server
-static struct evhttp* eventHTTP = nullptr;
+/** libevent event loop with its own HTTP server, dispatched by its own thread */
+struct HTTPEventLoop {
+    struct event_base* base{nullptr};
+    struct evhttp* http{nullptr};
+    //! Bound listening sockets
+    std::vector<evhttp_bound_socket*> bound_sockets;
+    std::thread thread;
+};
+
+//! Event loops accepting and parsing requests. The first one also runs the events of EventBase().
+static std::vector<HTTPEventLoop> g_http_event_loops;
 //! List of subnets to allow RPC connections from
 static std::vector<CSubNet> rpc_allow_subnets;
 //! Work queue for handling longer requests off the event loop thread
@@ -144,8 +166,6 @@ static std::unique_ptr<WorkQueue<HTTPClosure>> g_work_queue{nullptr};
 //! Handlers for (sub)paths
 static GlobalMutex g_httppathhandlers_mutex;
 static std::vector<HTTPPathHandler> pathHandlers GUARDED_BY(g_httppathhandlers_mutex);
-//! Bound listening sockets
-static std::vector<evhttp_bound_socket *> boundSockets;
 
 /** Check if a network address is allowed to access the HTTP server */
 static bool ClientAllowed(const CNetAddr& netaddr)
@@ -282,9 +302,9 @@ static void http_reject_request_cb(struct evhttp_request* req, void*)
 }
 
 /** Event dispatcher thread */
-static bool ThreadHTTP(struct event_base* base)
+static bool ThreadHTTP(struct event_base* base, int loop_num)
 {
-    util::ThreadRename("http");
+    util::ThreadRename(loop_num == 0 ? "http" : strprintf("http.%i", loop_num));
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::NET_HTTP_SERVER);
     LogPrint(BCLog::HTTP, "Entering http event loop\n");
     event_base_dispatch(base);
@@ -293,8 +313,8 @@ static bool ThreadHTTP(struct event_base* base)
     return event_base_got_break(base) == 0;
 }
 
-/** Bind HTTP server to specified addresses */
-static bool HTTPBindAddresses(struct evhttp* http)
+/** Determine the addresses to bind the HTTP server to */
+static std::vector<std::pair<std::string, uint16_t>> GetHTTPEndpoints()
 {
     uint16_t http_port{static_cast<uint16_t>(gArgs.GetIntArg("-rpcport", BaseParams().RPCPort()))};
     std::vector<std::pair<std::string, uint16_t>> endpoints;
@@ -317,22 +337,44 @@ static bool HTTPBindAddresses(struct evhttp* http)
             endpoints.push_back(std::make_pair(host, port));
         }
     }
+    return endpoints;
+}
 
-    // Bind addresses
-    for (std::vector<std::pair<std::string, uint16_t> >::iterator i = endpoints.begin(); i != endpoints.end(); ++i) {
-        LogPrint(BCLog::HTTP, "Binding RPC on address %s port %i\n", i->first, i->second);
-        evhttp_bound_socket *bind_handle = evhttp_bind_socket_with_handle(http, i->first.empty() ? nullptr : i->first.c_str(), i->second);
+/** Bind a listening socket that other event loops can bind to the same address as well */
+static evhttp_bound_socket* HTTPBindReusablePort(HTTPEventLoop& loop, const std::string& host, uint16_t port)
+{
+    CService addr;
+    if (!Lookup(host.empty() ? "0.0.0.0" : host, addr, port, /*fAllowLookup=*/true)) return nullptr;
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr((struct sockaddr*)&sockaddr, &len)) return nullptr;
+    // The listener sets SO_REUSEPORT, so that the kernel spreads the connections over the loops
+    const unsigned flags{LEV_OPT_CLOSE_ON_FREE | LEV_OPT_CLOSE_ON_EXEC | LEV_OPT_REUSEABLE | LEV_OPT_REUSEABLE_PORT};
+    struct evconnlistener* listener = evconnlistener_new_bind(loop.base, nullptr, nullptr, flags, -1, (struct sockaddr*)&sockaddr, len);
+    if (!listener) return nullptr;
+    evhttp_bound_socket* bind_handle = evhttp_bind_listener(loop.http, listener);
+    if (!bind_handle) evconnlistener_free(listener);
+    return bind_handle;
+}
+
+/** Bind HTTP server of an event loop to specified addresses */
+static bool HTTPBindAddresses(HTTPEventLoop& loop, const std::vector<std::pair<std::string, uint16_t>>& endpoints, bool reuse_port, bool log)
+{
+    for (const auto& [host, port] : endpoints) {
+        if (log) LogPrint(BCLog::HTTP, "Binding RPC on address %s port %i\n", host, port);
+        evhttp_bound_socket* bind_handle = reuse_port ? HTTPBindReusablePort(loop, host, port) :
+                                                        evhttp_bind_socket_with_handle(loop.http, host.empty() ? nullptr : host.c_str(), port);
         if (bind_handle) {
             CNetAddr addr;
-            if (i->first.empty() || (LookupHost(i->first, addr, false) && addr.IsBindAny())) {
+            if (log && (host.empty() || (LookupHost(host, addr, false) && addr.IsBindAny()))) {
                 LogPrintf("WARNING: the RPC server is not safe to expose to untrusted networks such as the public internet\n");
             }
-            boundSockets.push_back(bind_handle);
+            loop.bound_sockets.push_back(bind_handle);
         } else {
-            LogPrintf("Binding RPC on address %s port %i failed.\n", i->first, i->second);
+            LogPrintf("Binding RPC on address %s port %i failed.\n", host, port);
         }
     }
-    return !boundSockets.empty();
+    return !loop.bound_sockets.empty();
 }
 
 /** Simple wrapper to set thread name and run work queue */
@@ -380,24 +422,45 @@ bool InitHTTPServer()
     evthread_use_pthreads();
 #endif
 
-    raii_event_base base_ctr = obtain_event_base();
-
-    /* Create a new evhttp object to handle requests. */
-    raii_evhttp http_ctr = obtain_evhttp(base_ctr.get());
-    struct evhttp* http = http_ctr.get();
-    if (!http) {
-        LogPrintf("couldn't create evhttp. Exiting.\n");
-        return false;
+    int event_threads = std::max((long)gArgs.GetIntArg("-rpceventthreads", DEFAULT_HTTP_EVENT_THREADS), 1L);
+#ifdef WIN32
+    if (event_threads > 1) {
+        LogPrintf("WARNING: -rpceventthreads is not supported on Windows, using a single HTTP event thread\n");
+        event_threads = 1;
     }
+#endif
+    const std::vector<std::pair<std::string, uint16_t>> endpoints{GetHTTPEndpoints()};
+    for (int i = 0; i < event_threads; ++i) {
+        raii_event_base base_ctr = obtain_event_base();
+
+        /* Create a new evhttp object to handle requests. */
+        raii_evhttp http_ctr = obtain_evhttp(base_ctr.get());
+        struct evhttp* http = http_ctr.get();
+        if (!http) {
+            LogPrintf("couldn't create evhttp. Exiting.\n");
+            return false;
+        }
 
-    evhttp_set_timeout(http, gArgs.GetIntArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
-    evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
-    evhttp_set_max_body_size(http, MAX_SIZE);
-    evhttp_set_gencb(http, http_request_cb, nullptr);
-
-    if (!HTTPBindAddresses(http)) {
-        LogPrintf("Unable to bind any endpoint for RPC server\n");
-        return false;
+        evhttp_set_timeout(http, gArgs.GetIntArg("-rpcservertimeout", DEFAULT_HTTP_SERVER_TIMEOUT));
+        evhttp_set_max_headers_size(http, MAX_HEADERS_SIZE);
+        evhttp_set_max_body_size(http, MAX_SIZE);
+        evhttp_set_gencb(http, http_request_cb, nullptr);
+
+        HTTPEventLoop loop;
+        loop.base = base_ctr.get();
+        loop.http = http;
+        if (!HTTPBindAddresses(loop, endpoints, /*reuse_port=*/event_threads > 1, /*log=*/i == 0)) {
+            if (i == 0) {
+                LogPrintf("Unable to bind any endpoint for RPC server\n");
+                return false;
+            }
+            LogPrintf("Unable to bind RPC endpoints for HTTP event thread %d, using %d event threads\n", i, i);
+            break;
+        }
+        // transfer ownership to the event loop via .release()
+        base_ctr.release();
+        http_ctr.release();
+        g_http_event_loops.push_back(std::move(loop));
     }
 
     LogPrint(BCLog::HTTP, "Initialized HTTP server\n");
@@ -405,9 +468,6 @@ bool InitHTTPServer()
     LogPrintfCategory(BCLog::HTTP, "creating work queue of depth %d\n", workQueueDepth);
 
     g_work_queue = std::make_unique<WorkQueue<HTTPClosure>>(workQueueDepth);
-    // transfer ownership to eventBase/HTTP via .release()
-    eventBase = base_ctr.release();
-    eventHTTP = http_ctr.release();
     return true;
 }
 
@@ -419,15 +479,16 @@ void UpdateHTTPServerLogging(bool enable) {
     }
 }
 
-static std::thread g_thread_http;
 static std::vector<std::thread> g_thread_http_workers;
 
 void StartHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Starting HTTP server\n");
     int rpcThreads = std::max((long)gArgs.GetIntArg("-rpcthreads", DEFAULT_HTTP_THREADS), 1L);
-    LogPrintfCategory(BCLog::HTTP, "starting %d worker threads\n", rpcThreads);
-    g_thread_http = std::thread(ThreadHTTP, eventBase);
+    LogPrintfCategory(BCLog::HTTP, "starting %d event threads and %d worker threads\n", g_http_event_loops.size(), rpcThreads);
+    for (size_t i = 0; i < g_http_event_loops.size(); ++i) {
+        g_http_event_loops[i].thread = std::thread(ThreadHTTP, g_http_event_loops[i].base, i);
+    }
 
     for (int i = 0; i < rpcThreads; i++) {
         g_thread_http_workers.emplace_back(HTTPWorkQueueRun, g_work_queue.get(), i);
@@ -437,9 +498,9 @@ void StartHTTPServer()
 void InterruptHTTPServer()
 {
     LogPrint(BCLog::HTTP, "Interrupting HTTP server\n");
-    if (eventHTTP) {
+    for (const HTTPEventLoop& loop : g_http_event_loops) {
         // Reject requests on current connections
-        evhttp_set_gencb(eventHTTP, http_reject_request_cb, nullptr);
+        evhttp_set_gencb(loop.http, http_reject_request_cb, nullptr);
     }
     if (g_work_queue) {
         g_work_queue->Interrupt();
@@ -456,31 +517,41 @@ void StopHTTPServer()
         }
         g_thread_http_workers.clear();
     }
-    // Unlisten sockets, these are what make the event loop running, which means
-    // that after this and all connections are closed the event loop will quit.
-    for (evhttp_bound_socket *socket : boundSockets) {
-        evhttp_del_accept_socket(eventHTTP, socket);
-    }
-    boundSockets.clear();
-    if (eventBase) {
-        LogPrint(BCLog::HTTP, "Waiting for HTTP event thread to exit\n");
-        if (g_thread_http.joinable()) g_thread_http.join();
+    // Unlisten sockets, these are what make the event loops running, which means
+    // that after this and all connections are closed the event loops will quit.
+    for (HTTPEventLoop& loop : g_http_event_loops) {
+        for (evhttp_bound_socket* socket : loop.bound_sockets) {
+            evhttp_del_accept_socket(loop.http, socket);
+        }
+        loop.bound_sockets.clear();
     }
-    if (eventHTTP) {
-        evhttp_free(eventHTTP);
-        eventHTTP = nullptr;
+    if (!g_http_event_loops.empty()) {
+        LogPrint(BCLog::HTTP, "Waiting for HTTP event threads to exit\n");
+        for (HTTPEventLoop& loop : g_http_event_loops) {
+            if (loop.thread.joinable()) loop.thread.join();
+        }
     }
-    if (eventBase) {
-        event_base_free(eventBase);
-        eventBase = nullptr;
+    for (HTTPEventLoop& loop : g_http_event_loops) {
+        evhttp_free(loop.http);
+        event_base_free(loop.base);
     }
+    g_http_event_loops.clear();
     g_work_queue.reset();
     LogPrint(BCLog::HTTP, "Stopped HTTP server\n");
 }
 
+bool EnqueueHTTPWork(std::function<void()> func)
+{
+    if (!g_work_queue) return false;
+    auto item{std::make_unique<HTTPFunctionItem>(std::move(func))};
+    if (!g_work_queue->Enqueue(item.get())) return false;
+    item.release(); /* queue took ownership */
+    return true;
+}
+
 struct event_base* EventBase()
 {
-    return eventBase;
+    return g_http_event_loops.empty() ? nullptr : g_http_event_loops.front().base;
 }
 
 static void httpevent_callback_fn(evutil_socket_t, short, void* data)
@@ -509,12 +580,38 @@ void HTTPEvent::trigger(struct timeval* tv)
     else
         evtimer_add(ev, tv); // trigger after timeval passed
 }
+
+/** Event base of the event loop the connection of a request belongs to, which replies to it */
+static struct event_base* RequestEventBase(struct evhttp_request* req)
+{
+    evhttp_connection* conn = evhttp_request_get_connection(req);
+    return conn ? evhttp_connection_get_base(conn) : EventBase();
+}
+
+/** Re-enable reading from the socket after a reply. This is the second part of the libevent
+ * workaround in http_request_cb. */
+static void ResumeReading(evhttp_connection* conn)
+{
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 HTTPRequest::HTTPRequest(struct evhttp_request* _req, bool _replySent) : req(_req), replySent(_replySent)
 {
 }
 
 HTTPRequest::~HTTPRequest()
 {
+    if (m_chunked) {
+        LogPrintf("%s: Incomplete chunked reply\n", __func__);
+        WriteReplyPart(HTTP_OK, "", /*last=*/true);
+    }
     if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrintf("%s: Unhandled request\n", __func__);
@@ -577,25 +674,84 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply)
     assert(evb);
     evbuffer_add(evb, strReply.data(), strReply.size());
     auto req_copy = req;
-    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus]{
+    HTTPEvent* ev = new HTTPEvent(RequestEventBase(req), true, [req_copy, nStatus]{
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
-        }
+        ResumeReading(evhttp_request_get_connection(req_copy));
     });
     ev->trigger(nullptr);
     replySent = true;
     req = nullptr; // transferred back to main thread
 }
 
+void HTTPRequest::WriteReplyPart(int nStatus, const std::string& part, bool last)
+{
+    if (!m_chunked && last) {
+        WriteReply(nStatus, part);
+        return;
+    }
+    struct evbuffer* evb = nullptr;
+    if (!part.empty()) {
+        evb = evbuffer_new();
+        assert(evb);
+        evbuffer_add(evb, part.data(), part.size());
+    }
+    SendReplyPart(nStatus, evb, last);
+}
+
+void HTTPRequest::WriteReplyPart(int nStatus, Span<const uint8_t> part, std::shared_ptr<const void> owner, bool last)
+{
+    if (!m_chunked && last) {
+        WriteReply(nStatus, std::string(part.begin(), part.end()));
+        return;
+    }
+    struct evbuffer* evb = nullptr;
+    if (!part.empty()) {
+        evb = evbuffer_new();
+        assert(evb);
+        // The buffer refers to part, and releases its owner once it was sent
+        auto owner_copy = new std::shared_ptr<const void>(std::move(owner));
+        evbuffer_add_reference(evb, part.data(), part.size(), [](const void*, size_t, void* extra) {
+            delete static_cast<std::shared_ptr<const void>*>(extra);
+        }, owner_copy);
+    }
+    SendReplyPart(nStatus, evb, last);
+}
+
+void HTTPRequest::SendReplyPart(int nStatus, struct evbuffer* evb, bool last)
+{
+    assert(!replySent && req);
+    auto req_copy = req;
+    if (!m_chunked) {
+        if (ShutdownRequested()) {
+            WriteHeader("Connection", "close");
+        }
+        HTTPEvent* ev = new HTTPEvent(RequestEventBase(req), true, [req_copy, nStatus]{
+            evhttp_send_reply_start(req_copy, nStatus, nullptr);
+        });
+        ev->trigger(nullptr);
+        m_chunked = true;
+    }
+    // The events of a request are handled in the order they are triggered
+    HTTPEvent* ev = new HTTPEvent(RequestEventBase(req), true, [req_copy, evb, last]{
+        if (evb) {
+            evhttp_send_reply_chunk(req_copy, evb);
+            evbuffer_free(evb);
+        }
+        if (last) {
+            // Ending the reply frees the request if the connection is gone
+            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
+            evhttp_send_reply_end(req_copy);
+            ResumeReading(conn);
+        }
+    });
+    ev->trigger(nullptr);
+    if (last) {
+        m_chunked = false;
+        replySent = true;
+        req = nullptr; // transferred back to main thread
+    }
+}
+
 CService HTTPRequest::GetPeer() const
 {
     evhttp_connection* con = evhttp_request_get_connection(req);
@@ -5,14 +5,19 @@
 #ifndef BITCOIN_HTTPSERVER_H
 #define BITCOIN_HTTPSERVER_H
 
+#include <span.h>
+
 #include <functional>
+#include <memory>
 #include <optional>
 #include <string>
 
 static const int DEFAULT_HTTP_THREADS=4;
+static const int DEFAULT_HTTP_EVENT_THREADS=1;
 static const int DEFAULT_HTTP_WORKQUEUE=16;
 static const int DEFAULT_HTTP_SERVER_TIMEOUT=30;
 
+struct evbuffer;
 struct evhttp_request;
 struct event_base;
 class CService;
@@ -50,6 +55,11 @@ void UnregisterHTTPHandler(const std::string &prefix, bool exactMatch);
  */
 struct event_base* EventBase();
 
+/** Run func on an HTTP worker thread. Returns false if the work queue is full
+ * or stopped, in which case func is not run.
+ */
+bool EnqueueHTTPWork(std::function<void()> func);
+
 /** In-flight HTTP request.
  * Thin C++ wrapper around evhttp_request.
  */
@@ -58,6 +68,11 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    //! Whether a chunked reply was started with WriteReplyPart and not completed yet
+    bool m_chunked{false};
+
+    /** Send evb, which may be null, as the next part of a chunked reply and free it. */
+    void SendReplyPart(int nStatus, struct evbuffer* evb, bool last);
 
 public:
     explicit HTTPRequest(struct evhttp_request* req, bool replySent = false);
@@ -124,6 +139,25 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Write a part of an HTTP reply whose body is produced in pieces. The parts are sent as a
+     * chunked reply with status nStatus, unless the first part is also the last, in which case
+     * this is the same as WriteReply.
+     *
+     * @note Once a part was written no other reply can be sent, and do not call any other
+     * HTTPRequest methods after writing the last part. An incomplete reply is ended when the
+     * request is destroyed.
+     */
+    void WriteReplyPart(int nStatus, const std::string& part, bool last);
+    /**
+     * Write a part of a reply like above without copying it. part must stay valid while owner
+     * is held, which is until the part was sent.
+     */
+    void WriteReplyPart(int nStatus, Span<const uint8_t> part, std::shared_ptr<const void> owner, bool last);
+
+    /** Whether parts of the reply were sent already, so that the reply cannot be changed. */
+    bool IsReplyStarted() const { return m_chunked; }
 };
 
 /** Get the query parameter value from request uri for a specified key, or std::nullopt if the key
@@ -238,6 +238,19 @@ bool Session::Connect(const CService& to, Connection& conn, bool& proxy_error)
     }
 }
 
+bool Session::Create()
+{
+    try {
+        LOCK(m_mutex);
+        CreateIfNotCreatedAlready();
+        return true;
+    } catch (const std::runtime_error& e) {
+        Log("Error creating session: %s", e.what());
+        CheckControlSock();
+    }
+    return false;
+}
+
 // Private methods
 
 std::string Session::Reply::Get(const std::string& key) const
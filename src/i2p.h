@@ -118,6 +118,13 @@ public:
      */
     bool Connect(const CService& to, Connection& conn, bool& proxy_error) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
 
+    /**
+     * Create the session with the SAM proxy now rather than when it is first used. This
+     * waits for the proxy to build the session's tunnels.
+     * @return true on success
+     */
+    bool Create() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
 private:
     /**
      * A reply from the SAM proxy.
@@ -0,0 +1,303 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/addressindex.h>
+
+#include <chainparams.h>
+#include <crypto/sha256.h>
+#include <dbwrapper.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <script/script.h>
+#include <serialize.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+
+using node::ReadBlockFromDisk;
+using node::UndoReadFromDisk;
+
+static constexpr uint8_t DB_ADDRESS_HISTORY{'h'};
+static constexpr uint8_t DB_ADDRESS_UNSPENT{'u'};
+
+namespace {
+
+/* History entries are keyed by script hash and then by height (big-endian,
+ * so they are iterated in height order), txid, index and whether the entry
+ * spends an output. The value is the signed value of the entry. */
+struct DBHistoryKey {
+    uint256 script_hash;
+    uint32_t height{0};
+    uint256 txid;
+    uint32_t index{0};
+    bool spending{false};
+
+    DBHistoryKey() = default;
+    DBHistoryKey(const uint256& script_hash_in, uint32_t height_in, const uint256& txid_in, uint32_t index_in, bool spending_in)
+        : script_hash(script_hash_in), height(height_in), txid(txid_in), index(index_in), spending(spending_in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_HISTORY);
+        s << script_hash;
+        ser_writedata32be(s, height);
+        s << txid;
+        ser_writedata32be(s, index);
+        ser_writedata8(s, spending);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_ADDRESS_HISTORY) {
+            throw std::ios_base::failure("Invalid format for addressindex DB history key");
+        }
+        s >> script_hash;
+        height = ser_readdata32be(s);
+        s >> txid;
+        index = ser_readdata32be(s);
+        spending = ser_readdata8(s);
+    }
+};
+
+/* Unspent outputs are keyed by script hash, txid and output index. */
+struct DBUnspentKey {
+    uint256 script_hash;
+    uint256 txid;
+    uint32_t vout{0};
+
+    DBUnspentKey() = default;
+    DBUnspentKey(const uint256& script_hash_in, const uint256& txid_in, uint32_t vout_in)
+        : script_hash(script_hash_in), txid(txid_in), vout(vout_in) {}
+
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        ser_writedata8(s, DB_ADDRESS_UNSPENT);
+        s << script_hash << txid;
+        ser_writedata32be(s, vout);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        const uint8_t prefix{ser_readdata8(s)};
+        if (prefix != DB_ADDRESS_UNSPENT) {
+            throw std::ios_base::failure("Invalid format for addressindex DB unspent key");
+        }
+        s >> script_hash >> txid;
+        vout = ser_readdata32be(s);
+    }
+};
+
+struct DBUnspentVal {
+    CAmount value{0};
+    int height{0};
+
+    SERIALIZE_METHODS(DBUnspentVal, obj) { READWRITE(obj.value, obj.height); }
+};
+
+} // namespace
+
+std::unique_ptr<AddressIndex> g_address_index;
+
+AddressIndex::AddressIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "addressindex")
+{
+    fs::path path{gArgs.GetDataDirNet() / "indexes" / "addressindex"};
+    fs::create_directories(path);
+
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe,
+                                           /*f_obfuscate=*/false, GetDBOptions(gArgs, "addressindex"));
+}
+
+uint256 AddressIndex::GetScriptHash(const CScript& script)
+{
+    uint256 script_hash;
+    CSHA256().Write(script.data(), script.size()).Finalize(script_hash.begin());
+    return script_hash;
+}
+
+std::vector<AddressIndex::Delta> AddressIndex::ComputeDeltas(const CBlock& block, const CBlockUndo& block_undo)
+{
+    std::vector<Delta> deltas;
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const CTransaction& tx{*block.vtx[i]};
+        const uint256& txid{tx.GetHash()};
+
+        // The coinbase tx has no undo data since no former output is spent
+        if (!tx.IsCoinBase()) {
+            const CTxUndo& tx_undo{block_undo.vtxundo.at(i - 1)};
+            for (uint32_t j = 0; j < tx.vin.size(); ++j) {
+                const Coin& coin{tx_undo.vprevout.at(j)};
+                // Outputs that could not be spent were not indexed
+                if (coin.out.scriptPubKey.IsUnspendable()) continue;
+                Delta& delta{deltas.emplace_back()};
+                delta.script_hash = GetScriptHash(coin.out.scriptPubKey);
+                delta.txid = txid;
+                delta.index = j;
+                delta.spending = true;
+                delta.value = coin.out.nValue;
+                delta.prev_txid = tx.vin[j].prevout.hash;
+                delta.prev_vout = tx.vin[j].prevout.n;
+                delta.prev_height = coin.nHeight;
+            }
+        }
+
+        for (uint32_t j = 0; j < tx.vout.size(); ++j) {
+            const CTxOut& out{tx.vout[j]};
+            if (out.scriptPubKey.IsUnspendable()) continue;
+            Delta& delta{deltas.emplace_back()};
+            delta.script_hash = GetScriptHash(out.scriptPubKey);
+            delta.txid = txid;
+            delta.index = j;
+            delta.value = out.nValue;
+        }
+    }
+    return deltas;
+}
+
+std::any AddressIndex::CustomPrepare(const interfaces::BlockInfo& block) const
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (block.height == 0) return std::vector<Delta>{};
+
+    CBlockUndo read_undo;
+    // The initial sync reads the undo data in advance
+    const CBlockUndo* block_undo{block.undo_data};
+    if (!block_undo) {
+        // pindex variable gives indexing code access to node internals. It
+        // will be removed in upcoming commit
+        const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
+        if (!UndoReadFromDisk(read_undo, pindex)) {
+            return {};
+        }
+        block_undo = &read_undo;
+    }
+    return ComputeDeltas(*Assert(block.data), *block_undo);
+}
+
+bool AddressIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    return CustomAppendPrepared(block, CustomPrepare(block));
+}
+
+bool AddressIndex::CustomAppendPrepared(const interfaces::BlockInfo& block, std::any&& prepared)
+{
+    const std::vector<Delta>* deltas{std::any_cast<std::vector<Delta>>(&prepared)};
+    if (!deltas) {
+        return false;
+    }
+
+    // An output spent in the block it was created in is added and erased again in order
+    CDBBatch batch(*m_db);
+    for (const Delta& delta : *deltas) {
+        batch.Write(DBHistoryKey{delta.script_hash, uint32_t(block.height), delta.txid, delta.index, delta.spending},
+                    delta.spending ? -delta.value : delta.value);
+        if (delta.spending) {
+            batch.Erase(DBUnspentKey{delta.script_hash, delta.prev_txid, delta.prev_vout});
+        } else {
+            batch.Write(DBUnspentKey{delta.script_hash, delta.txid, delta.index}, DBUnspentVal{delta.value, block.height});
+        }
+    }
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    LOCK(cs_main);
+    const CBlockIndex* iter_tip{m_chainstate->m_blockman.LookupBlockIndex(current_tip.hash)};
+    const CBlockIndex* new_tip_index{m_chainstate->m_blockman.LookupBlockIndex(new_tip.hash)};
+    const auto& consensus_params{Params().GetConsensus()};
+
+    CDBBatch batch(*m_db);
+    do {
+        CBlock block;
+        CBlockUndo block_undo;
+        if (!ReadBlockFromDisk(block, iter_tip, consensus_params) || !UndoReadFromDisk(block_undo, iter_tip)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, iter_tip->GetBlockHash().ToString());
+        }
+
+        // Undo the deltas in reverse, so outputs spent in their own block end up erased
+        const std::vector<Delta> deltas{ComputeDeltas(block, block_undo)};
+        for (auto it = deltas.rbegin(); it != deltas.rend(); ++it) {
+            batch.Erase(DBHistoryKey{it->script_hash, uint32_t(iter_tip->nHeight), it->txid, it->index, it->spending});
+            if (it->spending) {
+                batch.Write(DBUnspentKey{it->script_hash, it->prev_txid, it->prev_vout}, DBUnspentVal{it->value, it->prev_height});
+            } else {
+                batch.Erase(DBUnspentKey{it->script_hash, it->txid, it->index});
+            }
+        }
+
+        iter_tip = iter_tip->GetAncestor(iter_tip->nHeight - 1);
+    } while (new_tip_index != iter_tip);
+
+    return m_db->WriteBatch(batch);
+}
+
+bool AddressIndex::FindHistory(const uint256& script_hash, size_t skip, size_t count, std::vector<AddressHistoryEntry>& history) const
+{
+    history.clear();
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    DBHistoryKey key;
+    for (db_it->Seek(DBHistoryKey{script_hash, 0, uint256::ZERO, 0, false}); history.size() < count; db_it->Next()) {
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        AddressHistoryEntry& entry{history.emplace_back()};
+        if (!db_it->GetValue(entry.value)) {
+            return error("%s: unable to read value in %s at key (%c, %s)",
+                         __func__, GetName(), DB_ADDRESS_HISTORY, script_hash.ToString());
+        }
+        entry.height = key.height;
+        entry.txid = key.txid;
+        entry.index = key.index;
+        entry.spending = key.spending;
+    }
+    return true;
+}
+
+bool AddressIndex::FindUnspent(const uint256& script_hash, size_t skip, size_t count, std::vector<AddressUnspentEntry>& unspent) const
+{
+    unspent.clear();
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    DBUnspentKey key;
+    for (db_it->Seek(DBUnspentKey{script_hash, uint256::ZERO, 0}); unspent.size() < count; db_it->Next()) {
+        if (!db_it->GetKey(key) || key.script_hash != script_hash) break;
+        if (skip > 0) {
+            --skip;
+            continue;
+        }
+        DBUnspentVal value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at key (%c, %s)",
+                         __func__, GetName(), DB_ADDRESS_UNSPENT, script_hash.ToString());
+        }
+        unspent.push_back({key.txid, key.vout, value.value, value.height});
+    }
+    return true;
+}
+
+bool AddressIndex::GetBalance(const uint256& script_hash, AddressBalance& balance) const
+{
+    balance = {};
+    std::unique_ptr<CDBIterator> db_it(m_db->NewIterator());
+    DBHistoryKey key;
+    for (db_it->Seek(DBHistoryKey{script_hash, 0, uint256::ZERO, 0, false}); db_it->GetKey(key) && key.script_hash == script_hash; db_it->Next()) {
+        CAmount value;
+        if (!db_it->GetValue(value)) {
+            return error("%s: unable to read value in %s at key (%c, %s)",
+                         __func__, GetName(), DB_ADDRESS_HISTORY, script_hash.ToString());
+        }
+        balance.balance += value;
+        if (!key.spending) balance.received += value;
+        ++balance.history_count;
+    }
+    return true;
+}
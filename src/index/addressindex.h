@@ -0,0 +1,114 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_ADDRESSINDEX_H
+#define BITCOIN_INDEX_ADDRESSINDEX_H
+
+#include <consensus/amount.h>
+#include <index/base.h>
+#include <uint256.h>
+
+#include <cstdint>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+class CScript;
+
+/** A transaction of the history of a script: one of its outputs paying to the script, or one of its inputs spending such an output */
+struct AddressHistoryEntry {
+    int height{0};
+    uint256 txid;
+    //! Index of the output, or of the input when spending
+    uint32_t index{0};
+    bool spending{false};
+    //! Value of the output; negative when spending it
+    CAmount value{0};
+};
+
+/** An unspent output paying to a script */
+struct AddressUnspentEntry {
+    uint256 txid;
+    uint32_t vout{0};
+    CAmount value{0};
+    int height{0};
+};
+
+/** Totals over the history of a script */
+struct AddressBalance {
+    //! Value of the unspent outputs
+    CAmount balance{0};
+    //! Value of all outputs ever paid to the script
+    CAmount received{0};
+    //! Number of history entries
+    uint64_t history_count{0};
+};
+
+/**
+ * AddressIndex maps each script, by its SHA256 hash as used by the Electrum
+ * protocol, to the history of outputs paying to it and inputs spending
+ * them, ordered by height, and to its unspent outputs. Unspendable outputs
+ * and the genesis block are not indexed.
+ */
+class AddressIndex final : public BaseIndex
+{
+public:
+    /** A change a transaction of a block makes to the outputs of a script */
+    struct Delta {
+        uint256 script_hash;
+        uint256 txid;
+        //! Index of the output, or of the input when spending
+        uint32_t index{0};
+        bool spending{false};
+        //! Value of the output, positive also when spending it
+        CAmount value{0};
+        //! The output spent, and its height, when spending
+        uint256 prev_txid;
+        uint32_t prev_vout{0};
+        int prev_height{0};
+    };
+
+private:
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+    bool AllowPrune() const override { return false; }
+
+    /** Compute the deltas of a block, in the order its transactions apply them. */
+    static std::vector<Delta> ComputeDeltas(const CBlock& block, const CBlockUndo& block_undo);
+
+protected:
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomNeedsUndoData() const override { return true; }
+
+    /** Compute the deltas of the block, or return nothing if its undo data cannot be read. */
+    std::any CustomPrepare(const interfaces::BlockInfo& block) const override;
+
+    bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any&& prepared) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit AddressIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// The key of a script in the index.
+    static uint256 GetScriptHash(const CScript& script);
+
+    /// Look up the history of a script, skipping the first skip entries and returning at most count.
+    bool FindHistory(const uint256& script_hash, size_t skip, size_t count, std::vector<AddressHistoryEntry>& history) const;
+
+    /// Look up the unspent outputs of a script, ordered by txid, skipping the first skip and returning at most count.
+    bool FindUnspent(const uint256& script_hash, size_t skip, size_t count, std::vector<AddressUnspentEntry>& unspent) const;
+
+    /// Sum up the history of a script.
+    bool GetBalance(const uint256& script_hash, AddressBalance& balance) const;
+};
+
+/// The global address index. May be null.
+extern std::unique_ptr<AddressIndex> g_address_index;
+
+#endif // BITCOIN_INDEX_ADDRESSINDEX_H
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <chainparams.h>
+#include <checkqueue.h>
 #include <index/base.h>
 #include <interfaces/chain.h>
 #include <kernel/chain.h>
@@ -11,6 +12,7 @@
 #include <node/interface_ui.h>
 #include <shutdown.h>
 #include <tinyformat.h>
+#include <undo.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
 #include <util/thread.h>
@@ -22,12 +24,65 @@
 #include <utility>
 
 using node::ReadBlockFromDisk;
+using node::UndoReadFromDisk;
 
 constexpr uint8_t DB_BEST_BLOCK{'B'};
 
 constexpr auto SYNC_LOG_INTERVAL{30s};
 constexpr auto SYNC_LOCATOR_WRITE_INTERVAL{30s};
 
+int g_index_sync_threads{DEFAULT_INDEX_SYNC_THREADS};
+
+/** A block of the initial sync of an index, read and prepared by an IndexSyncRead */
+struct IndexSyncBlock {
+    const CBlockIndex* m_index{nullptr};
+    CBlock m_block;
+    CBlockUndo m_undo;
+    std::any m_prepared;
+    //! Whether the block, and any undo data the index needs, were read
+    bool m_read{false};
+};
+
+/**
+ * Closure reading a block of the initial sync of an index, and its undo data
+ * if the index needs it, and running CustomPrepare on it, so that this is
+ * done for a batch of blocks in parallel while they are appended in order.
+ * The index and block must outlive the closure.
+ */
+class IndexSyncRead
+{
+private:
+    const BaseIndex* m_base_index{nullptr};
+    IndexSyncBlock* m_sync_block{nullptr};
+
+public:
+    IndexSyncRead() = default;
+    IndexSyncRead(const BaseIndex& base_index, IndexSyncBlock& sync_block)
+        : m_base_index(&base_index), m_sync_block(&sync_block) {}
+
+    //! Always succeeds, so that the sync thread reports which block could not be read.
+    bool operator()()
+    {
+        const CBlockIndex* pindex{m_sync_block->m_index};
+        if (!ReadBlockFromDisk(m_sync_block->m_block, pindex, Params().GetConsensus())) return true;
+        interfaces::BlockInfo block_info{kernel::MakeBlockInfo(pindex, &m_sync_block->m_block)};
+        if (m_base_index->CustomNeedsUndoData()) {
+            // The genesis block has no undo data
+            if (pindex->nHeight > 0 && !UndoReadFromDisk(m_sync_block->m_undo, pindex)) return true;
+            block_info.undo_data = &m_sync_block->m_undo;
+        }
+        m_sync_block->m_prepared = m_base_index->CustomPrepare(block_info);
+        m_sync_block->m_read = true;
+        return true;
+    }
+
+    void swap(IndexSyncRead& read) noexcept
+    {
+        std::swap(m_base_index, read.m_base_index);
+        std::swap(m_sync_block, read.m_sync_block);
+    }
+};
+
 template <typename... Args>
 static void FatalError(const char* fmt, const Args&... args)
 {
@@ -47,8 +102,8 @@ CBlockLocator GetLocator(interfaces::Chain& chain, const uint256& block_hash)
     return locator;
 }
 
-BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate) :
-    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate)
+BaseIndex::DB::DB(const fs::path& path, size_t n_cache_size, bool f_memory, bool f_wipe, bool f_obfuscate, const DBOptions& db_options) :
+    CDBWrapper(path, n_cache_size, f_memory, f_wipe, f_obfuscate, db_options)
 {}
 
 bool BaseIndex::DB::ReadBestBlock(CBlockLocator& locator) const
@@ -151,10 +206,9 @@ void BaseIndex::ThreadSync()
     SetSyscallSandboxPolicy(SyscallSandboxPolicy::TX_INDEX);
     const CBlockIndex* pindex = m_best_block_index.load();
     if (!m_synced) {
-        auto& consensus_params = Params().GetConsensus();
-
         std::chrono::steady_clock::time_point last_log_time{0s};
         std::chrono::steady_clock::time_point last_locator_write_time{0s};
+        std::vector<IndexSyncBlock> batch;
         while (true) {
             if (m_interrupt) {
                 SetBestBlockIndex(pindex);
@@ -180,38 +234,66 @@ void BaseIndex::ThreadSync()
                                __func__, GetName());
                     return;
                 }
-                pindex = pindex_next;
-            }
-
-            auto current_time{std::chrono::steady_clock::now()};
-            if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
-                LogPrintf("Syncing %s with block chain from height %d\n",
-                          GetName(), pindex->nHeight);
-                last_log_time = current_time;
+                // pindex_next is on the active chain, and so are the blocks the batch continues with
+                batch = std::vector<IndexSyncBlock>(std::min<size_t>(INDEX_SYNC_BATCH_SIZE, m_chainstate->m_chain.Height() - pindex_next->nHeight + 1));
+                for (IndexSyncBlock& sync_block : batch) {
+                    sync_block.m_index = pindex_next;
+                    pindex_next = m_chainstate->m_chain.Next(pindex_next);
+                }
             }
 
-            if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
-                SetBestBlockIndex(pindex->pprev);
-                last_locator_write_time = current_time;
-                // No need to handle errors in Commit. See rationale above.
-                Commit();
+            std::vector<IndexSyncRead> reads;
+            reads.reserve(batch.size());
+            for (IndexSyncBlock& sync_block : batch) {
+                reads.emplace_back(*this, sync_block);
             }
-
-            CBlock block;
-            interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex);
-            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-                FatalError("%s: Failed to read block %s from disk",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
+            if (m_sync_queue) {
+                CCheckQueueControl<IndexSyncRead> control(m_sync_queue.get());
+                control.Add(reads);
+                control.Wait();
             } else {
-                block_info.data = &block;
+                for (IndexSyncRead& read : reads) read();
             }
-            if (!CustomAppend(block_info)) {
-                FatalError("%s: Failed to write block %s to index database",
-                           __func__, pindex->GetBlockHash().ToString());
-                return;
+
+            for (IndexSyncBlock& sync_block : batch) {
+                if (m_interrupt) {
+                    SetBestBlockIndex(pindex);
+                    // No need to handle errors in Commit. See rationale above.
+                    Commit();
+                    return;
+                }
+
+                auto current_time{std::chrono::steady_clock::now()};
+                if (last_log_time + SYNC_LOG_INTERVAL < current_time) {
+                    LogPrintf("Syncing %s with block chain from height %d\n",
+                              GetName(), sync_block.m_index->nHeight);
+                    last_log_time = current_time;
+                }
+
+                if (last_locator_write_time + SYNC_LOCATOR_WRITE_INTERVAL < current_time) {
+                    SetBestBlockIndex(sync_block.m_index->pprev);
+                    last_locator_write_time = current_time;
+                    // No need to handle errors in Commit. See rationale above.
+                    Commit();
+                }
+
+                pindex = sync_block.m_index;
+                if (!sync_block.m_read) {
+                    FatalError("%s: Failed to read block %s from disk",
+                               __func__, pindex->GetBlockHash().ToString());
+                    return;
+                }
+                interfaces::BlockInfo block_info = kernel::MakeBlockInfo(pindex, &sync_block.m_block);
+                if (CustomNeedsUndoData()) block_info.undo_data = &sync_block.m_undo;
+                if (!CustomAppendPrepared(block_info, std::move(sync_block.m_prepared))) {
+                    FatalError("%s: Failed to write block %s to index database",
+                               __func__, pindex->GetBlockHash().ToString());
+                    return;
+                }
             }
         }
+        // The worker threads are not needed once the index is in sync
+        if (m_sync_queue) m_sync_queue->StopWorkerThreads();
     }
 
     if (pindex) {
@@ -393,6 +475,11 @@ bool BaseIndex::Start()
         return false;
     }
 
+    if (g_index_sync_threads > 0) {
+        // Every read is a block, so they are handed out one at a time
+        m_sync_queue = std::make_unique<CCheckQueue<IndexSyncRead>>(/*nBatchSizeIn=*/1);
+        m_sync_queue->StartWorkerThreads(g_index_sync_threads, GetName(), SyscallSandboxPolicy::TX_INDEX);
+    }
     m_thread_sync = std::thread(&util::TraceThread, GetName(), [this] { ThreadSync(); });
     return true;
 }
@@ -404,6 +491,9 @@ void BaseIndex::Stop()
     if (m_thread_sync.joinable()) {
         m_thread_sync.join();
     }
+    if (m_sync_queue) {
+        m_sync_queue->StopWorkerThreads();
+    }
 }
 
 IndexSummary BaseIndex::GetSummary() const
@@ -10,15 +10,30 @@
 #include <threadinterrupt.h>
 #include <validationinterface.h>
 
+#include <any>
+#include <memory>
 #include <string>
 
 class CBlock;
 class CBlockIndex;
 class Chainstate;
+class IndexSyncRead;
+template <typename T>
+class CCheckQueue;
 namespace interfaces {
 class Chain;
 } // namespace interfaces
 
+/** Default for -indexsyncthreads */
+static constexpr int DEFAULT_INDEX_SYNC_THREADS{2};
+/** Maximum number of block reading threads of an index */
+static constexpr int MAX_INDEX_SYNC_THREADS{16};
+/** Number of blocks of each batch read in parallel during the initial sync of an index */
+static constexpr size_t INDEX_SYNC_BATCH_SIZE{32};
+
+/** Number of extra threads each index reads blocks with during its initial sync */
+extern int g_index_sync_threads;
+
 struct IndexSummary {
     std::string name;
     bool synced{false};
@@ -44,7 +59,8 @@ protected:
     {
     public:
         DB(const fs::path& path, size_t n_cache_size,
-           bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false);
+           bool f_memory = false, bool f_wipe = false, bool f_obfuscate = false,
+           const DBOptions& db_options = {});
 
         /// Read block locator of the chain that the index is in sync with.
         bool ReadBestBlock(CBlockLocator& locator) const;
@@ -69,6 +85,11 @@ private:
     std::thread m_thread_sync;
     CThreadInterrupt m_interrupt;
 
+    /// Reads the blocks of the initial sync, and runs CustomPrepare on them,
+    /// in parallel with g_index_sync_threads worker threads.
+    std::unique_ptr<CCheckQueue<IndexSyncRead>> m_sync_queue;
+    friend class IndexSyncRead;
+
     /// Read best block locator and check that data needed to sync has not been pruned.
     bool Init();
 
@@ -103,12 +124,27 @@ protected:
 
     void ChainStateFlushed(const CBlockLocator& locator) override;
 
+    std::string ValidationInterfaceName() const override { return m_name; }
+
     /// Initialize internal state from the database and block index.
     [[nodiscard]] virtual bool CustomInit(const std::optional<interfaces::BlockKey>& block) { return true; }
 
-    /// Write update index entries for a newly connected block.
+    /// Write update index entries for a newly connected block. During the
+    /// initial sync, block.undo_data is set if CustomNeedsUndoData() is true.
     [[nodiscard]] virtual bool CustomAppend(const interfaces::BlockInfo& block) { return true; }
 
+    /// Whether the initial sync should read the undo data of blocks for CustomPrepare and CustomAppend.
+    virtual bool CustomNeedsUndoData() const { return false; }
+
+    /// Compute what a block's index entries need from the block alone, e.g.
+    /// its filter. During the initial sync this runs on worker threads, ahead
+    /// of the CustomAppendPrepared call for the block that gets the result,
+    /// so it must not depend on or change the index state.
+    virtual std::any CustomPrepare(const interfaces::BlockInfo& block) const { return {}; }
+
+    /// CustomAppend with the result of CustomPrepare for the block.
+    [[nodiscard]] virtual bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any&& prepared) { return CustomAppend(block); }
+
     /// Virtual method called internally by Commit that can be overridden to atomically
     /// commit more index state.
     virtual bool CustomCommit(CDBBatch& batch) { return true; }
@@ -148,6 +184,9 @@ public:
 
     /// Get a summary of the index and its state.
     IndexSummary GetSummary() const;
+
+    /// Get statistics of the index database.
+    DBStats GetDBStats() const { return GetDB().GetStats(); }
 };
 
 #endif // BITCOIN_INDEX_BASE_H
@@ -3,11 +3,14 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <map>
+#include <optional>
 
+#include <checkqueue.h>
 #include <dbwrapper.h>
 #include <hash.h>
 #include <index/blockfilterindex.h>
 #include <node/blockstorage.h>
+#include <util/syscall_sandbox.h>
 #include <util/system.h>
 #include <validation.h>
 
@@ -91,6 +94,42 @@ struct DBHashKey {
     }
 };
 
+/**
+ * Closure matching a block filter against a set of elements, so that the
+ * filters of a batch are matched in parallel. The filter, elements and
+ * result must outlive the closure.
+ */
+class FilterMatch
+{
+private:
+    const BlockFilter* m_filter{nullptr};
+    const GCSFilter::ElementSet* m_elements{nullptr};
+    unsigned char* m_match{nullptr};
+
+public:
+    FilterMatch() = default;
+    FilterMatch(const BlockFilter& filter, const GCSFilter::ElementSet& elements, unsigned char& match)
+        : m_filter(&filter), m_elements(&elements), m_match(&match) {}
+
+    //! Fails only if the filter cannot be decoded.
+    bool operator()()
+    {
+        try {
+            *m_match = m_filter->GetFilter().MatchAny(*m_elements);
+        } catch (const std::ios_base::failure&) {
+            return false;
+        }
+        return true;
+    }
+
+    void swap(FilterMatch& match) noexcept
+    {
+        std::swap(m_filter, match.m_filter);
+        std::swap(m_elements, match.m_elements);
+        std::swap(m_match, match.m_match);
+    }
+};
+
 }; // namespace
 
 static std::map<BlockFilterType, BlockFilterIndex> g_filter_indexes;
@@ -106,7 +145,8 @@ BlockFilterIndex::BlockFilterIndex(std::unique_ptr<interfaces::Chain> chain, Blo
     fs::path path = gArgs.GetDataDirNet() / "indexes" / "blockfilter" / fs::u8path(filter_name);
     fs::create_directories(path);
 
-    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe);
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe,
+                                           /*f_obfuscate=*/false, GetDBOptions(gArgs, "blockfilterindex"));
     m_filter_fileseq = std::make_unique<FlatFileSeq>(std::move(path), "fltr", FLTR_FILE_CHUNK_SIZE);
 }
 
@@ -145,13 +185,9 @@ bool BlockFilterIndex::CustomCommit(CDBBatch& batch)
     return true;
 }
 
-bool BlockFilterIndex::ReadFilterFromDisk(const FlatFilePos& pos, const uint256& hash, BlockFilter& filter) const
+/** Read the filter at the current position of a filter file, returning the number of bytes read, or 0 on failure. */
+static size_t ReadFilterFromFile(AutoFile& filein, BlockFilterType filter_type, const uint256& hash, BlockFilter& filter)
 {
-    AutoFile filein{m_filter_fileseq->Open(pos, true)};
-    if (filein.IsNull()) {
-        return false;
-    }
-
     // Check that the hash of the encoded_filter matches the one stored in the db.
     uint256 block_hash;
     std::vector<uint8_t> encoded_filter;
@@ -159,13 +195,54 @@ bool BlockFilterIndex::ReadFilterFromDisk(const FlatFilePos& pos, const uint256&
         filein >> block_hash >> encoded_filter;
         uint256 result;
         CHash256().Write(encoded_filter).Finalize(result);
-        if (result != hash) return error("Checksum mismatch in filter decode.");
-        filter = BlockFilter(GetFilterType(), block_hash, std::move(encoded_filter), /*skip_decode_check=*/true);
+        if (result != hash) {
+            error("Checksum mismatch in filter decode.");
+            return 0;
+        }
+        const size_t data_size{GetSerializeSize(block_hash, CLIENT_VERSION) + GetSerializeSize(encoded_filter, CLIENT_VERSION)};
+        filter = BlockFilter(filter_type, block_hash, std::move(encoded_filter), /*skip_decode_check=*/true);
+        return data_size;
     }
     catch (const std::exception& e) {
-        return error("%s: Failed to deserialize block filter from disk: %s", __func__, e.what());
+        error("%s: Failed to deserialize block filter from disk: %s", __func__, e.what());
+        return 0;
+    }
+}
+
+bool BlockFilterIndex::ReadFilterFromDisk(const FlatFilePos& pos, const uint256& hash, BlockFilter& filter) const
+{
+    AutoFile filein{m_filter_fileseq->Open(pos, true)};
+    if (filein.IsNull()) {
+        return false;
     }
 
+    return ReadFilterFromFile(filein, GetFilterType(), hash, filter) > 0;
+}
+
+/** Read the filters of a range of entries, opening each filter file once and only seeking where
+ *  the filters of consecutive entries are not stored next to each other. */
+static bool ReadFiltersFromDisk(FlatFileSeq& fileseq, BlockFilterType filter_type,
+                                const std::vector<DBVal>& entries, std::vector<BlockFilter>& filters_out)
+{
+    filters_out.resize(entries.size());
+    std::optional<AutoFile> filein;
+    FlatFilePos file_pos;
+    for (size_t i = 0; i < entries.size(); ++i) {
+        const FlatFilePos& pos{entries[i].pos};
+        if (!filein || file_pos.nFile != pos.nFile) {
+            filein.emplace(fileseq.Open(pos, true));
+            if (filein->IsNull()) {
+                return false;
+            }
+        } else if (file_pos.nPos != pos.nPos && fseek(filein->Get(), pos.nPos, SEEK_SET)) {
+            return error("%s: Failed to seek to %s in filter file", __func__, pos.ToString());
+        }
+        const size_t data_size{ReadFilterFromFile(*filein, filter_type, entries[i].hash, filters_out[i])};
+        if (data_size == 0) {
+            return false;
+        }
+        file_pos = FlatFilePos{pos.nFile, static_cast<unsigned int>(pos.nPos + data_size)};
+    }
     return true;
 }
 
@@ -215,19 +292,37 @@ size_t BlockFilterIndex::WriteFilterToDisk(FlatFilePos& pos, const BlockFilter&
     return data_size;
 }
 
-bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
+std::any BlockFilterIndex::CustomPrepare(const interfaces::BlockInfo& block) const
 {
-    CBlockUndo block_undo;
-    uint256 prev_header;
-
-    if (block.height > 0) {
+    CBlockUndo read_undo;
+    // The initial sync reads the undo data in advance
+    const CBlockUndo* block_undo{block.undo_data ? block.undo_data : &read_undo};
+    if (block.height > 0 && !block.undo_data) {
         // pindex variable gives indexing code access to node internals. It
         // will be removed in upcoming commit
         const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
-        if (!UndoReadFromDisk(block_undo, pindex)) {
-            return false;
+        if (!UndoReadFromDisk(read_undo, pindex)) {
+            return {};
         }
+    }
+    return BlockFilter(m_filter_type, *Assert(block.data), *block_undo);
+}
 
+bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    return CustomAppendPrepared(block, CustomPrepare(block));
+}
+
+bool BlockFilterIndex::CustomAppendPrepared(const interfaces::BlockInfo& block, std::any&& prepared)
+{
+    const BlockFilter* filter_ptr{std::any_cast<BlockFilter>(&prepared)};
+    if (!filter_ptr) {
+        return false;
+    }
+    const BlockFilter& filter{*filter_ptr};
+    uint256 prev_header;
+
+    if (block.height > 0) {
         std::pair<uint256, DBVal> read_out;
         if (!m_db->Read(DBHeightKey(block.height - 1), read_out)) {
             return false;
@@ -242,8 +337,6 @@ bool BlockFilterIndex::CustomAppend(const interfaces::BlockInfo& block)
         prev_header = read_out.second.header;
     }
 
-    BlockFilter filter(m_filter_type, *Assert(block.data), block_undo);
-
     size_t bytes_written = WriteFilterToDisk(m_next_filter_pos, filter);
     if (bytes_written == 0) return false;
 
@@ -341,7 +434,8 @@ static bool LookupRange(CDBWrapper& db, const std::string& index_name, int start
     std::vector<std::pair<uint256, DBVal>> values(results_size);
 
     DBHeightKey key(start_height);
-    std::unique_ptr<CDBIterator> db_it(db.NewIterator());
+    // Peers ask for the same recent ranges over and over, so keep them cached.
+    std::unique_ptr<CDBIterator> db_it(db.NewIterator(/*fill_cache=*/true));
     db_it->Seek(DBHeightKey(start_height));
     for (int height = start_height; height <= stop_index->nHeight; ++height) {
         if (!db_it->Valid() || !db_it->GetKey(key) || key.height != height) {
@@ -429,16 +523,73 @@ bool BlockFilterIndex::LookupFilterRange(int start_height, const CBlockIndex* st
         return false;
     }
 
-    filters_out.resize(entries.size());
-    auto filter_pos_it = filters_out.begin();
-    for (const auto& entry : entries) {
-        if (!ReadFilterFromDisk(entry.pos, entry.hash, *filter_pos_it)) {
-            return false;
+    return ReadFiltersFromDisk(*m_filter_fileseq, GetFilterType(), entries, filters_out);
+}
+
+bool BlockFilterIndex::MatchFilterRange(int start_height, const CBlockIndex* stop_index, const GCSFilter::ElementSet& elements,
+                                        std::vector<const CBlockIndex*>& matches_out, int n_threads,
+                                        const std::function<bool(int)>& interrupt) const
+{
+    matches_out.clear();
+    if (start_height < 0 || start_height > stop_index->nHeight) {
+        return error("%s: invalid start height %d for stop height %d", __func__, start_height, stop_index->nHeight);
+    }
+
+    std::unique_ptr<CCheckQueue<FilterMatch>> queue;
+    if (n_threads > 0) {
+        queue = std::make_unique<CCheckQueue<FilterMatch>>(/*nBatchSizeIn=*/16);
+        queue->StartWorkerThreads(n_threads, "fltrmatch", SyscallSandboxPolicy::TX_INDEX);
+    }
+
+    bool success{true};
+    for (int height = start_height; height <= stop_index->nHeight; height += FILTER_MATCH_BATCH_SIZE) {
+        if (interrupt && interrupt(height)) {
+            success = false;
+            break;
+        }
+
+        // Only the entries of one batch are held in memory at a time
+        const CBlockIndex* batch_stop{stop_index->GetAncestor(std::min(height + FILTER_MATCH_BATCH_SIZE - 1, stop_index->nHeight))};
+        std::vector<DBVal> entries;
+        std::vector<BlockFilter> filters;
+        if (!LookupRange(*m_db, m_name, height, batch_stop, entries) ||
+            !ReadFiltersFromDisk(*m_filter_fileseq, GetFilterType(), entries, filters)) {
+            success = false;
+            break;
+        }
+
+        std::vector<unsigned char> matched(filters.size());
+        std::vector<FilterMatch> matches;
+        matches.reserve(filters.size());
+        for (size_t i = 0; i < filters.size(); ++i) {
+            matches.emplace_back(filters[i], elements, matched[i]);
+        }
+        bool decoded{true};
+        if (queue) {
+            CCheckQueueControl<FilterMatch> control(queue.get());
+            control.Add(matches);
+            decoded = control.Wait();
+        } else {
+            for (FilterMatch& match : matches) {
+                if (!match()) {
+                    decoded = false;
+                    break;
+                }
+            }
+        }
+        if (!decoded) {
+            success = error("%s: Failed to decode a filter of %s between heights %d and %d",
+                            __func__, GetName(), height, batch_stop->nHeight);
+            break;
+        }
+
+        for (size_t i = 0; i < matched.size(); ++i) {
+            if (matched[i]) matches_out.push_back(batch_stop->GetAncestor(height + i));
         }
-        ++filter_pos_it;
     }
 
-    return true;
+    if (queue) queue->StopWorkerThreads();
+    return success;
 }
 
 bool BlockFilterIndex::LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
@@ -12,9 +12,14 @@
 #include <index/base.h>
 #include <util/hasher.h>
 
+#include <functional>
+
 /** Interval between compact filter checkpoints. See BIP 157. */
 static constexpr int CFCHECKPT_INTERVAL = 1000;
 
+/** Number of consecutive filters MatchFilterRange reads and matches at a time. */
+static constexpr int FILTER_MATCH_BATCH_SIZE{1000};
+
 /**
  * BlockFilterIndex is used to store and retrieve block filters, hashes, and headers for a range of
  * blocks by height. An index is constructed for each supported filter type with its own database
@@ -47,6 +52,13 @@ protected:
 
     bool CustomAppend(const interfaces::BlockInfo& block) override;
 
+    bool CustomNeedsUndoData() const override { return true; }
+
+    /** Build the filter of the block, or return nothing if its undo data cannot be read. */
+    std::any CustomPrepare(const interfaces::BlockInfo& block) const override;
+
+    bool CustomAppendPrepared(const interfaces::BlockInfo& block, std::any&& prepared) override;
+
     bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
 
     BaseIndex::DB& GetDB() const LIFETIMEBOUND override { return *m_db; }
@@ -68,6 +80,16 @@ public:
     bool LookupFilterRange(int start_height, const CBlockIndex* stop_index,
                            std::vector<BlockFilter>& filters_out) const;
 
+    /**
+     * Get the blocks between two heights on a chain whose filters match any of the elements. The
+     * filters are read in one sweep, FILTER_MATCH_BATCH_SIZE at a time, and each batch is matched on
+     * n_threads worker threads, or on the calling thread if there are none. interrupt is called with
+     * the first height of each batch; if it returns true the scan stops and false is returned.
+     */
+    bool MatchFilterRange(int start_height, const CBlockIndex* stop_index, const GCSFilter::ElementSet& elements,
+                          std::vector<const CBlockIndex*>& matches_out, int n_threads = 0,
+                          const std::function<bool(int)>& interrupt = {}) const;
+
     /** Get a range of filter hashes between two heights on a chain. */
     bool LookupFilterHashRange(int start_height, const CBlockIndex* stop_index,
                                std::vector<uint256>& hashes_out) const;
@@ -0,0 +1,187 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/blockstatsindex.h>
+
+#include <chain.h>
+#include <consensus/consensus.h>
+#include <consensus/validation.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <undo.h>
+#include <util/system.h>
+#include <validation.h>
+#include <version.h>
+
+#include <algorithm>
+
+using node::UndoReadFromDisk;
+
+static constexpr uint8_t DB_BLOCK_STATS{'s'};
+
+// Estimate of the memory a coin takes in the UTXO set besides its output
+static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
+
+template<typename T>
+static T CalculateTruncatedMedian(std::vector<T>& scores)
+{
+    size_t size = scores.size();
+    if (size == 0) {
+        return 0;
+    }
+
+    std::sort(scores.begin(), scores.end());
+    if (size % 2 == 0) {
+        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
+    } else {
+        return scores[size / 2];
+    }
+}
+
+void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight)
+{
+    if (scores.empty()) {
+        return;
+    }
+
+    std::sort(scores.begin(), scores.end());
+
+    // 10th, 25th, 50th, 75th, and 90th percentile weight units.
+    const double weights[NUM_GETBLOCKSTATS_PERCENTILES] = {
+        total_weight / 10.0, total_weight / 4.0, total_weight / 2.0, (total_weight * 3.0) / 4.0, (total_weight * 9.0) / 10.0
+    };
+
+    int64_t next_percentile_index = 0;
+    int64_t cumulative_weight = 0;
+    for (const auto& element : scores) {
+        cumulative_weight += element.second;
+        while (next_percentile_index < NUM_GETBLOCKSTATS_PERCENTILES && cumulative_weight >= weights[next_percentile_index]) {
+            result[next_percentile_index] = element.first;
+            ++next_percentile_index;
+        }
+    }
+
+    // Fill any remaining percentiles with the last value.
+    for (int64_t i = next_percentile_index; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
+        result[i] = scores.back().first;
+    }
+}
+
+std::optional<BlockStats> ComputeBlockStats(const CBlock& block, const CBlockUndo& block_undo)
+{
+    if (!block.vtx.empty() && block_undo.vtxundo.size() != block.vtx.size() - 1) return std::nullopt;
+
+    BlockStats stats;
+    stats.txs = block.vtx.size();
+    CAmount minfee = MAX_MONEY;
+    CAmount minfeerate = MAX_MONEY;
+    int64_t mintxsize = MAX_BLOCK_SERIALIZED_SIZE;
+    std::vector<CAmount> fee_array;
+    std::vector<std::pair<CAmount, int64_t>> feerate_array;
+    std::vector<int64_t> txsize_array;
+
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        const auto& tx = block.vtx.at(i);
+        stats.outs += tx->vout.size();
+
+        CAmount tx_total_out = 0;
+        for (const CTxOut& out : tx->vout) {
+            tx_total_out += out.nValue;
+            stats.utxo_size_inc += GetSerializeSize(out, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+        }
+
+        if (tx->IsCoinBase()) {
+            continue;
+        }
+
+        stats.ins += tx->vin.size(); // Don't count coinbase's fake input
+        stats.total_out += tx_total_out; // Don't count coinbase reward
+
+        const int64_t tx_size = tx->GetTotalSize();
+        txsize_array.push_back(tx_size);
+        stats.maxtxsize = std::max(stats.maxtxsize, tx_size);
+        mintxsize = std::min(mintxsize, tx_size);
+        stats.total_size += tx_size;
+
+        const int64_t weight = GetTransactionWeight(*tx);
+        stats.total_weight += weight;
+
+        if (tx->HasWitness()) {
+            ++stats.swtxs;
+            stats.swtotal_size += tx_size;
+            stats.swtotal_weight += weight;
+        }
+
+        CAmount tx_total_in = 0;
+        const auto& txundo = block_undo.vtxundo.at(i - 1);
+        for (const Coin& coin : txundo.vprevout) {
+            const CTxOut& prevoutput = coin.out;
+
+            tx_total_in += prevoutput.nValue;
+            stats.utxo_size_inc -= GetSerializeSize(prevoutput, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
+        }
+
+        const CAmount txfee = tx_total_in - tx_total_out;
+        if (!MoneyRange(txfee)) return std::nullopt;
+        fee_array.push_back(txfee);
+        stats.maxfee = std::max(stats.maxfee, txfee);
+        minfee = std::min(minfee, txfee);
+        stats.totalfee += txfee;
+
+        // New feerate uses satoshis per virtual byte instead of per serialized byte
+        const CAmount feerate = weight ? (txfee * WITNESS_SCALE_FACTOR) / weight : 0;
+        feerate_array.emplace_back(feerate, weight);
+        stats.maxfeerate = std::max(stats.maxfeerate, feerate);
+        minfeerate = std::min(minfeerate, feerate);
+    }
+
+    stats.minfee = minfee == MAX_MONEY ? 0 : minfee;
+    stats.minfeerate = minfeerate == MAX_MONEY ? 0 : minfeerate;
+    stats.mintxsize = mintxsize == MAX_BLOCK_SERIALIZED_SIZE ? 0 : mintxsize;
+    stats.medianfee = CalculateTruncatedMedian(fee_array);
+    stats.mediantxsize = CalculateTruncatedMedian(txsize_array);
+    CalculatePercentilesByWeight(stats.feerate_percentiles.data(), feerate_array, stats.total_weight);
+    return stats;
+}
+
+std::unique_ptr<BlockStatsIndex> g_block_stats_index;
+
+BlockStatsIndex::BlockStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "blockstatsindex")
+{
+    fs::path path{gArgs.GetDataDirNet() / "indexes" / "blockstats"};
+    fs::create_directories(path);
+
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe,
+                                           /*f_obfuscate=*/false, GetDBOptions(gArgs, "blockstatsindex"));
+}
+
+bool BlockStatsIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    CBlockUndo read_undo;
+    // The initial sync reads the undo data in advance. The genesis block has none.
+    const CBlockUndo* block_undo{block.undo_data};
+    if (!block_undo && block.height > 0) {
+        const CBlockIndex* pindex = WITH_LOCK(cs_main, return m_chainstate->m_blockman.LookupBlockIndex(block.hash));
+        if (!UndoReadFromDisk(read_undo, pindex)) {
+            return false;
+        }
+    }
+    if (!block_undo) block_undo = &read_undo;
+
+    const std::optional<BlockStats> stats{ComputeBlockStats(*Assert(block.data), *block_undo)};
+    if (!stats) {
+        return error("%s: Undo data does not match block %s", __func__, block.hash.ToString());
+    }
+    return m_db->Write(std::make_pair(DB_BLOCK_STATS, block.hash), *stats);
+}
+
+std::optional<BlockStats> BlockStatsIndex::LookUpStats(const CBlockIndex& block_index) const
+{
+    BlockStats stats;
+    if (!m_db->Read(std::make_pair(DB_BLOCK_STATS, block_index.GetBlockHash()), stats)) {
+        return std::nullopt;
+    }
+    return stats;
+}
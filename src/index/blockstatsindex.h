@@ -0,0 +1,102 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_BLOCKSTATSINDEX_H
+#define BITCOIN_INDEX_BLOCKSTATSINDEX_H
+
+#include <consensus/amount.h>
+#include <index/base.h>
+#include <serialize.h>
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class CBlockUndo;
+
+static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
+
+/**
+ * The statistics of getblockstats that only depend on a block and the outputs
+ * it spends. Minimums are 0 for a block without transactions besides the
+ * coinbase, and feerates are in satoshis per virtual byte.
+ */
+struct BlockStats {
+    int64_t txs{0};
+    int64_t ins{0};
+    int64_t outs{0};
+    CAmount total_out{0};
+    CAmount totalfee{0};
+    CAmount minfee{0};
+    CAmount maxfee{0};
+    CAmount medianfee{0};
+    CAmount minfeerate{0};
+    CAmount maxfeerate{0};
+    std::array<CAmount, NUM_GETBLOCKSTATS_PERCENTILES> feerate_percentiles{};
+    int64_t total_size{0};
+    int64_t total_weight{0};
+    int64_t mintxsize{0};
+    int64_t maxtxsize{0};
+    int64_t mediantxsize{0};
+    int64_t swtxs{0};
+    int64_t swtotal_size{0};
+    int64_t swtotal_weight{0};
+    int64_t utxo_size_inc{0};
+
+    SERIALIZE_METHODS(BlockStats, obj)
+    {
+        READWRITE(obj.txs, obj.ins, obj.outs, obj.total_out, obj.totalfee, obj.minfee, obj.maxfee, obj.medianfee,
+                  obj.minfeerate, obj.maxfeerate);
+        for (auto& feerate : obj.feerate_percentiles) READWRITE(feerate);
+        READWRITE(obj.total_size, obj.total_weight, obj.mintxsize, obj.maxtxsize, obj.mediantxsize,
+                  obj.swtxs, obj.swtotal_size, obj.swtotal_weight, obj.utxo_size_inc);
+    }
+};
+
+/**
+ * Compute the statistics of block, whose spent outputs are in block_undo.
+ * Returns std::nullopt if block_undo does not belong to block.
+ */
+std::optional<BlockStats> ComputeBlockStats(const CBlock& block, const CBlockUndo& block_undo);
+
+/** Used by getblockstats to get feerates at different percentiles by weight  */
+void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
+
+/**
+ * BlockStatsIndex stores the BlockStats of every block it syncs, so that
+ * getblockstats need not read and go through the block and its undo data.
+ * Entries are keyed by block hash, as the statistics of a block do not
+ * depend on the chain it is in; those of blocks disconnected are kept.
+ */
+class BlockStatsIndex final : public BaseIndex
+{
+private:
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+    bool AllowPrune() const override { return true; }
+
+protected:
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomNeedsUndoData() const override { return true; }
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit BlockStatsIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the statistics of a block. Returns std::nullopt if the index
+    /// has not synced the block yet.
+    std::optional<BlockStats> LookUpStats(const CBlockIndex& block_index) const;
+};
+
+/// The global block statistics index. May be null.
+extern std::unique_ptr<BlockStatsIndex> g_block_stats_index;
+
+#endif // BITCOIN_INDEX_BLOCKSTATSINDEX_H
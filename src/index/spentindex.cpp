@@ -0,0 +1,162 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <index/spentindex.h>
+
+#include <chainparams.h>
+#include <crypto/common.h>
+#include <dbwrapper.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <serialize.h>
+#include <util/system.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <map>
+#include <utility>
+#include <vector>
+
+using node::ReadBlockFromDisk;
+
+static constexpr uint8_t DB_SPENT_OUTPUT{'o'};
+
+namespace {
+
+/* Spent outputs are keyed by the first eight bytes of their txid and their
+ * index. The value is the list of inputs spending an output with that key. */
+struct DBOutPointKey {
+    uint64_t txid_prefix;
+    uint32_t vout;
+
+    explicit DBOutPointKey(const COutPoint& outpoint) : txid_prefix(ReadLE64(outpoint.hash.begin())), vout(outpoint.n) {}
+    DBOutPointKey(uint64_t txid_prefix_in, uint32_t vout_in) : txid_prefix(txid_prefix_in), vout(vout_in) {}
+
+    SERIALIZE_METHODS(DBOutPointKey, obj)
+    {
+        uint8_t prefix{DB_SPENT_OUTPUT};
+        READWRITE(prefix);
+        if (prefix != DB_SPENT_OUTPUT) {
+            throw std::ios_base::failure("Invalid format for spentindex DB key");
+        }
+
+        READWRITE(obj.txid_prefix, VARINT(obj.vout));
+    }
+};
+
+struct DBSpender {
+    uint256 txid;
+    uint32_t vin;
+    int height;
+
+    SERIALIZE_METHODS(DBSpender, obj) { READWRITE(obj.txid, VARINT(obj.vin), VARINT_MODE(obj.height, VarIntMode::NONNEGATIVE_SIGNED)); }
+};
+
+/** Add the inputs of a block to the spender lists of the outputs they spend, or remove them when disconnecting it. */
+bool WriteSpenders(CDBWrapper& db, const CBlock& block, int height, bool connect)
+{
+    std::map<std::pair<uint64_t, uint32_t>, std::vector<DBSpender>> spenders;
+    for (const auto& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (uint32_t j = 0; j < tx->vin.size(); ++j) {
+            const DBOutPointKey key{tx->vin[j].prevout};
+            auto [it, inserted]{spenders.try_emplace({key.txid_prefix, key.vout})};
+            if (inserted && !db.Read(key, it->second)) {
+                it->second.clear();
+            }
+            std::vector<DBSpender>& entries{it->second};
+            if (connect) {
+                entries.push_back({tx->GetHash(), j, height});
+            } else {
+                entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const DBSpender& entry) {
+                    return entry.vin == j && entry.txid == tx->GetHash();
+                }), entries.end());
+            }
+        }
+    }
+
+    CDBBatch batch(db);
+    for (const auto& [key, entries] : spenders) {
+        if (entries.empty()) {
+            batch.Erase(DBOutPointKey{key.first, key.second});
+        } else {
+            batch.Write(DBOutPointKey{key.first, key.second}, entries);
+        }
+    }
+    return db.WriteBatch(batch);
+}
+
+} // namespace
+
+std::unique_ptr<SpentIndex> g_spent_index;
+
+SpentIndex::SpentIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory, bool f_wipe)
+    : BaseIndex(std::move(chain), "spentindex")
+{
+    fs::path path{gArgs.GetDataDirNet() / "indexes" / "spentindex"};
+    fs::create_directories(path);
+
+    m_db = std::make_unique<BaseIndex::DB>(path / "db", n_cache_size, f_memory, f_wipe,
+                                           /*f_obfuscate=*/false, GetDBOptions(gArgs, "spentindex"));
+}
+
+bool SpentIndex::CustomAppend(const interfaces::BlockInfo& block)
+{
+    // Exclude genesis block transaction because outputs are not spendable.
+    if (block.height == 0) return true;
+
+    return WriteSpenders(*m_db, *Assert(block.data), block.height, /*connect=*/true);
+}
+
+bool SpentIndex::CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip)
+{
+    LOCK(cs_main);
+    const CBlockIndex* iter_tip{m_chainstate->m_blockman.LookupBlockIndex(current_tip.hash)};
+    const CBlockIndex* new_tip_index{m_chainstate->m_blockman.LookupBlockIndex(new_tip.hash)};
+    const auto& consensus_params{Params().GetConsensus()};
+
+    do {
+        CBlock block;
+        if (!ReadBlockFromDisk(block, iter_tip, consensus_params)) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, iter_tip->GetBlockHash().ToString());
+        }
+        if (!WriteSpenders(*m_db, block, iter_tip->nHeight, /*connect=*/false)) {
+            return false;
+        }
+
+        iter_tip = iter_tip->GetAncestor(iter_tip->nHeight - 1);
+    } while (new_tip_index != iter_tip);
+
+    return true;
+}
+
+bool SpentIndex::FindSpender(const COutPoint& outpoint, SpentIndexEntry& spender) const
+{
+    std::vector<DBSpender> entries;
+    if (!m_db->Read(DBOutPointKey{outpoint}, entries)) {
+        return false;
+    }
+
+    // An entry may belong to another output with the same key, so check that
+    // the transaction it names really spends this one
+    for (const DBSpender& entry : entries) {
+        const CBlockIndex* pindex{WITH_LOCK(cs_main, return m_chainstate->m_chain[entry.height])};
+        if (!pindex) continue;
+        CBlock block;
+        if (!ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
+            return error("%s: Failed to read block %s from disk",
+                         __func__, pindex->GetBlockHash().ToString());
+        }
+        for (const auto& tx : block.vtx) {
+            if (tx->GetHash() != entry.txid) continue;
+            if (entry.vin < tx->vin.size() && tx->vin[entry.vin].prevout == outpoint) {
+                spender = {entry.txid, entry.vin, pindex->GetBlockHash(), entry.height};
+                return true;
+            }
+            break;
+        }
+    }
+    return false;
+}
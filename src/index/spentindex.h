@@ -0,0 +1,55 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_INDEX_SPENTINDEX_H
+#define BITCOIN_INDEX_SPENTINDEX_H
+
+#include <index/base.h>
+#include <uint256.h>
+
+#include <cstdint>
+
+class COutPoint;
+
+/** The input of a block transaction spending an output */
+struct SpentIndexEntry {
+    uint256 txid;
+    uint32_t vin{0};
+    uint256 block_hash;
+    int height{0};
+};
+
+/**
+ * SpentIndex maps every output spent in the active chain to the input that
+ * spends it. To keep the keys small, outputs are keyed by the first eight
+ * bytes of their txid and their index, so a key may hold several spenders;
+ * the lookup picks the one whose transaction really spends the output.
+ */
+class SpentIndex final : public BaseIndex
+{
+private:
+    std::unique_ptr<BaseIndex::DB> m_db;
+
+    bool AllowPrune() const override { return false; }
+
+protected:
+    bool CustomAppend(const interfaces::BlockInfo& block) override;
+
+    bool CustomRewind(const interfaces::BlockKey& current_tip, const interfaces::BlockKey& new_tip) override;
+
+    BaseIndex::DB& GetDB() const override { return *m_db; }
+
+public:
+    /// Constructs the index, which becomes available to be queried.
+    explicit SpentIndex(std::unique_ptr<interfaces::Chain> chain, size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
+
+    /// Look up the input spending an output. Returns false if the output is
+    /// not spent in the chain the index is synced to.
+    bool FindSpender(const COutPoint& outpoint, SpentIndexEntry& spender) const;
+};
+
+/// The global spent output index. May be null.
+extern std::unique_ptr<SpentIndex> g_spent_index;
+
+#endif // BITCOIN_INDEX_SPENTINDEX_H
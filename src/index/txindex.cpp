@@ -4,46 +4,89 @@
 
 #include <index/txindex.h>
 
+#include <chainparams.h>
 #include <index/disktxpos.h>
 #include <node/blockstorage.h>
+#include <primitives/block.h>
 #include <util/system.h>
 #include <validation.h>
 
+#include <algorithm>
+#include <tuple>
+
 using node::OpenBlockFile;
 
 constexpr uint8_t DB_TXINDEX{'t'};
+constexpr uint8_t DB_TXINDEX_COMPACT{'T'};
 
 std::unique_ptr<TxIndex> g_txindex;
 
+namespace {
+/**
+ * Key of a transaction in the compact format. It holds the first 8 bytes of
+ * the txid and the position of the transaction, and the value is empty.
+ * Transactions whose txids share the prefix each have a key of their own,
+ * and the lookup reads all of them to find the one with the full txid.
+ */
+struct CompactTxKey {
+    uint8_t key{DB_TXINDEX_COMPACT};
+    uint64_t txid_prefix{0};
+    CDiskTxPos pos;
+
+    SERIALIZE_METHODS(CompactTxKey, obj) { READWRITE(obj.key, obj.txid_prefix, obj.pos); }
+};
+} // namespace
 
 /** Access to the txindex database (indexes/txindex/) */
 class TxIndex::DB : public BaseIndex::DB
 {
+    //! Whether the database has entries of the format with full txid keys,
+    //! written before the compact one. These are still read.
+    bool m_has_full_keys{false};
+
 public:
     explicit DB(size_t n_cache_size, bool f_memory = false, bool f_wipe = false);
 
-    /// Read the disk location of the transaction data with the given hash. Returns false if the
-    /// transaction hash is not indexed.
-    bool ReadTxPos(const uint256& txid, CDiskTxPos& pos) const;
+    /// Read the disk locations of the transactions whose txid may be the given one.
+    void ReadTxPos(const uint256& txid, std::vector<CDiskTxPos>& positions);
 
     /// Write a batch of transaction positions to the DB.
     bool WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos);
 };
 
 TxIndex::DB::DB(size_t n_cache_size, bool f_memory, bool f_wipe) :
-    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "txindex", n_cache_size, f_memory, f_wipe)
-{}
+    BaseIndex::DB(gArgs.GetDataDirNet() / "indexes" / "txindex", n_cache_size, f_memory, f_wipe,
+                  /*f_obfuscate=*/false, GetDBOptions(gArgs, "txindex"))
+{
+    std::unique_ptr<CDBIterator> it{NewIterator()};
+    it->Seek(DB_TXINDEX);
+    std::pair<uint8_t, uint256> key;
+    m_has_full_keys = it->Valid() && it->GetKey(key) && key.first == DB_TXINDEX;
+    if (m_has_full_keys) {
+        LogPrintf("txindex: also reading the entries written before the compact format, reindex to compact them\n");
+    }
+}
 
-bool TxIndex::DB::ReadTxPos(const uint256 &txid, CDiskTxPos& pos) const
+void TxIndex::DB::ReadTxPos(const uint256& txid, std::vector<CDiskTxPos>& positions)
 {
-    return Read(std::make_pair(DB_TXINDEX, txid), pos);
+    const uint64_t prefix{txid.GetUint64(0)};
+    std::unique_ptr<CDBIterator> it{NewIterator(/*fill_cache=*/true)};
+    for (it->Seek(std::make_pair(DB_TXINDEX_COMPACT, prefix)); it->Valid(); it->Next()) {
+        CompactTxKey key;
+        if (!it->GetKey(key) || key.key != DB_TXINDEX_COMPACT || key.txid_prefix != prefix) break;
+        positions.push_back(key.pos);
+    }
+    CDiskTxPos pos;
+    if (m_has_full_keys && Read(std::make_pair(DB_TXINDEX, txid), pos)) {
+        positions.push_back(pos);
+    }
 }
 
 bool TxIndex::DB::WriteTxs(const std::vector<std::pair<uint256, CDiskTxPos>>& v_pos)
 {
     CDBBatch batch(*this);
     for (const auto& tuple : v_pos) {
-        batch.Write(std::make_pair(DB_TXINDEX, tuple.first), tuple.second);
+        batch.Write(CompactTxKey{.txid_prefix = tuple.first.GetUint64(0), .pos = tuple.second}, uint8_t{0});
     }
     return WriteBatch(batch);
 }
@@ -65,7 +108,7 @@ bool TxIndex::CustomAppend(const interfaces::BlockInfo& block)
     vPos.reserve(block.data->vtx.size());
     for (const auto& tx : block.data->vtx) {
         vPos.emplace_back(tx->GetHash(), pos);
-        pos.nTxOffset += ::GetSerializeSize(*tx, CLIENT_VERSION);
+        pos.nTxOffset += tx->GetTotalSize();
     }
     return m_db->WriteTxs(vPos);
 }
@@ -74,28 +117,87 @@ BaseIndex::DB& TxIndex::GetDB() const { return *m_db; }
 
 bool TxIndex::FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const
 {
-    CDiskTxPos postx;
-    if (!m_db->ReadTxPos(tx_hash, postx)) {
-        return false;
-    }
+    const auto found{FindTxs(Span{&tx_hash, 1})};
+    if (!found[0]) return false;
+    std::tie(block_hash, tx) = *found[0];
+    return true;
+}
 
-    CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
-    if (file.IsNull()) {
-        return error("%s: OpenBlockFile failed", __func__);
+std::vector<std::optional<std::pair<uint256, CTransactionRef>>> TxIndex::FindTxs(Span<const uint256> tx_hashes) const
+{
+    std::vector<std::optional<std::pair<uint256, CTransactionRef>>> found(tx_hashes.size());
+
+    // The positions that may hold the transactions, with the index of the hash looked for,
+    // sorted so that the transactions of one block are read in order after its header
+    std::vector<std::pair<CDiskTxPos, size_t>> candidates;
+    std::vector<CDiskTxPos> positions;
+    for (size_t i = 0; i < tx_hashes.size(); ++i) {
+        positions.clear();
+        m_db->ReadTxPos(tx_hashes[i], positions);
+        for (const CDiskTxPos& pos : positions) candidates.emplace_back(pos, i);
     }
-    CBlockHeader header;
-    try {
-        file >> header;
-        if (fseek(file.Get(), postx.nTxOffset, SEEK_CUR)) {
-            return error("%s: fseek(...) failed", __func__);
+    std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+        return std::tie(a.first.nFile, a.first.nPos, a.first.nTxOffset) < std::tie(b.first.nFile, b.first.nPos, b.first.nTxOffset);
+    });
+
+    // A transaction that is in more than one block was indexed again after a reorg. Return the
+    // one of the active chain, as the entry of the reorged block used to be overwritten.
+    const auto add = [&](size_t i, const uint256& block_hash, const CTransactionRef& tx) {
+        if (tx->GetHash() != tx_hashes[i]) return; // only the txid prefix matches
+        if (found[i]) {
+            LOCK(cs_main);
+            const CBlockIndex* block_index{m_chainstate->m_blockman.LookupBlockIndex(block_hash)};
+            if (!block_index || !m_chainstate->m_chain.Contains(block_index)) return;
         }
-        file >> tx;
-    } catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s", __func__, e.what());
-    }
-    if (tx->GetHash() != tx_hash) {
-        return error("%s: txid mismatch", __func__);
+        found[i].emplace(block_hash, tx);
+    };
+
+    for (auto block_begin = candidates.begin(); block_begin != candidates.end();) {
+        const FlatFilePos block_pos{block_begin->first.nFile, block_begin->first.nPos};
+        const auto block_end{std::find_if(block_begin, candidates.end(), [&](const auto& candidate) {
+            return static_cast<const FlatFilePos&>(candidate.first) != block_pos;
+        })};
+
+        CAutoFile file(OpenBlockFile({block_pos.nFile, block_pos.nPos - 8}, true), SER_DISK, CLIENT_VERSION);
+        if (file.IsNull()) {
+            error("%s: OpenBlockFile failed", __func__);
+            block_begin = block_end;
+            continue;
+        }
+        CMessageHeader::MessageStartChars blk_start;
+        unsigned int blk_size;
+        CBlockHeader header;
+        try {
+            file >> blk_start >> blk_size;
+            if (node::IsCompressedBlockRecord(blk_start, Params().MessageStart())) {
+                // The offsets are those of the regular serialization, so read the whole block
+                CBlock block;
+                if (!node::ReadBlockFromDisk(block, block_pos, Params().GetConsensus())) {
+                    throw std::runtime_error("failed to read compressed block");
+                }
+                const uint256 block_hash{block.GetHash()};
+                for (auto candidate = block_begin; candidate != block_end; ++candidate) {
+                    const uint256& tx_hash{tx_hashes[candidate->second]};
+                    const auto it{std::find_if(block.vtx.begin(), block.vtx.end(), [&](const CTransactionRef& block_tx) { return block_tx->GetHash() == tx_hash; })};
+                    if (it != block.vtx.end()) add(candidate->second, block_hash, *it);
+                }
+            } else {
+                file >> header;
+                const uint256 block_hash{header.GetHash()};
+                const long txs_begin{ftell(file.Get())};
+                for (auto candidate = block_begin; candidate != block_end; ++candidate) {
+                    if (fseek(file.Get(), txs_begin + candidate->first.nTxOffset, SEEK_SET)) {
+                        throw std::runtime_error("fseek(...) failed");
+                    }
+                    CTransactionRef tx;
+                    file >> tx;
+                    add(candidate->second, block_hash, tx);
+                }
+            }
+        } catch (const std::exception& e) {
+            error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+        block_begin = block_end;
     }
-    block_hash = header.GetHash();
-    return true;
+    return found;
 }
@@ -6,11 +6,16 @@
 #define BITCOIN_INDEX_TXINDEX_H
 
 #include <index/base.h>
+#include <span.h>
+
+#include <optional>
+#include <utility>
+#include <vector>
 
 /**
  * TxIndex is used to look up transactions included in the blockchain by hash.
  * The index is written to a LevelDB database and records the filesystem
- * location of each transaction by transaction hash.
+ * location of each transaction under the first 8 bytes of its hash.
  */
 class TxIndex final : public BaseIndex
 {
@@ -41,6 +46,14 @@ public:
     /// @param[out]  tx  The transaction itself.
     /// @return  true if transaction is found, false otherwise
     bool FindTx(const uint256& tx_hash, uint256& block_hash, CTransactionRef& tx) const;
+
+    /// Look up several transactions by hash. The transactions of one block are read
+    /// after opening its file and reading its header once.
+    ///
+    /// @param[in]   tx_hashes  The hashes of the transactions to be returned.
+    /// @return  for each hash, the hash of the block the transaction is found in and the
+    ///          transaction itself, or std::nullopt if the transaction is not found
+    std::vector<std::optional<std::pair<uint256, CTransactionRef>>> FindTxs(Span<const uint256> tx_hashes) const;
 };
 
 /// The global transaction index, used in GetTransaction. May be null.
@@ -20,13 +20,18 @@
 #include <chainparams.h>
 #include <checkpointsync.h>
 #include <consensus/amount.h>
+#include <dbwrapper.h>
 #include <deploymentstatus.h>
 #include <fs.h>
 #include <hash.h>
 #include <httprpc.h>
 #include <httpserver.h>
+#include <index/addressindex.h>
+#include <index/base.h>
 #include <index/blockfilterindex.h>
+#include <index/blockstatsindex.h>
 #include <index/coinstatsindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <init/common.h>
 #include <interfaces/chain.h>
@@ -38,20 +43,28 @@
 #include <net_processing.h>
 #include <netbase.h>
 #include <netgroup.h>
+#include <node/block_prefetch.h>
 #include <node/blockstorage.h>
+#include <node/headerstore.h>
 #include <node/caches.h>
 #include <node/chainstate.h>
 #include <node/context.h>
+#include <node/headers_file.h>
 #include <node/interface_ui.h>
+#include <node/memory_usage.h>
 #include <node/mempool_args.h>
 #include <node/mempool_persist_args.h>
 #include <node/miner.h>
+#include <node/peerman_args.h>
+#include <node/startup.h>
+#include <node/txreconciliation.h>
 #include <node/validation_cache_args.h>
 #include <policy/feerate.h>
 #include <policy/fees.h>
 #include <policy/fees_args.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <powcache.h>
 #include <protocol.h>
 #include <rpc/blockchain.h>
 #include <rpc/register.h>
@@ -88,6 +101,7 @@
 #include <cstdio>
 #include <fstream>
 #include <functional>
+#include <future>
 #include <set>
 #include <string>
 #include <thread>
@@ -111,23 +125,46 @@ using kernel::DumpMempool;
 using kernel::ValidationCacheSizes;
 
 using node::ApplyArgsManOptions;
+using node::BlockAssembler;
+using node::BlockPrefetcher;
+using node::CBlockTemplate;
 using node::CacheSizes;
 using node::CalculateCacheSizes;
+using node::DEFAULT_GENERATE_THREADS;
 using node::DEFAULT_PERSIST_MEMPOOL;
 using node::DEFAULT_PRINTPRIORITY;
 using node::DEFAULT_STOPAFTERBLOCKIMPORT;
 using node::LoadChainstate;
+using node::LoadHeadersFile;
+using node::MEMORY_USAGE_SNAPSHOT_INTERVAL;
 using node::MempoolPath;
 using node::ShouldPersistMempool;
+using node::StartupProfiler;
+using node::HeaderStore;
+using node::g_header_store;
 using node::NodeContext;
 using node::ThreadImport;
+using node::UpdateMemoryUsageSnapshot;
 using node::VerifyLoadedChainstate;
+using node::DEFAULT_TRUST_INDEXED_BLOCK_POW;
+using node::DEFAULT_BLOCK_FILE_MMAP;
+using node::DEFAULT_COMPRESS_BLOCK_FILES;
+using node::DEFAULT_BLOCK_INDEX_SNAPSHOT;
+using node::DEFAULT_BLOCK_PREFETCH_THREADS;
 using node::fPruneMode;
 using node::fReindex;
+using node::fTrustIndexedBlockPoW;
+using node::fBlockFileMmap;
+using node::fCompressBlockFiles;
+using node::fBlockIndexSnapshot;
 using node::nPruneTarget;
 
 static const bool DEFAULT_PROXYRANDOMIZE = true;
 static const bool DEFAULT_REST_ENABLE = false;
+static const bool DEFAULT_METRICS_ENABLE = false;
+static const bool DEFAULT_COMPACT_DB_AFTER_IBD = true;
+//! How often a range of keys is compacted with -compactdbafteribd
+static constexpr std::chrono::seconds IDLE_DB_COMPACTION_INTERVAL{10};
 
 std::unique_ptr<CConnman> g_connman;
 
@@ -209,8 +246,20 @@ void Interrupt(NodeContext& node)
     if (g_coin_stats_index) {
         g_coin_stats_index->Interrupt();
     }
+    if (g_block_stats_index) {
+        g_block_stats_index->Interrupt();
+    }
+    if (g_address_index) {
+        g_address_index->Interrupt();
+    }
+    if (g_spent_index) {
+        g_spent_index->Interrupt();
+    }
 }
 
+//! Keeps g_header_store in sync with the best header in -headersonly mode
+static boost::signals2::connection header_store_connection;
+
 void Shutdown(NodeContext& node)
 {
     static Mutex g_shutdown_mutex;
@@ -228,6 +277,7 @@ void Shutdown(NodeContext& node)
 
     StopHTTPRPC();
     StopREST();
+    StopHTTPMetrics();
     StopRPC();
     StopHTTPServer();
     for (const auto& client : node.chain_clients) {
@@ -246,7 +296,11 @@ void Shutdown(NodeContext& node)
     // CScheduler/checkqueue, scheduler and load block thread.
     if (node.scheduler) node.scheduler->stop();
     if (node.chainman && node.chainman->m_load_block.joinable()) node.chainman->m_load_block.join();
+    if (node.chainman && node.chainman->m_verify_blocks.joinable()) node.chainman->m_verify_blocks.join();
+    if (node.chainman) node.chainman->StopBackgroundValidation();
     StopScriptCheckWorkerThreads();
+    StopPoWCheckWorkerThreads();
+    StopPrefetchWorkerThreads();
 
     // After the threads that potentially access these pointers have been stopped,
     // destruct and reset all to nullptr.
@@ -277,6 +331,9 @@ void Shutdown(NodeContext& node)
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
 
+    header_store_connection.disconnect();
+    g_header_store.reset();
+
     // Stop and delete all indexes only after flushing background callbacks.
     if (g_txindex) {
         g_txindex->Stop();
@@ -286,6 +343,18 @@ void Shutdown(NodeContext& node)
         g_coin_stats_index->Stop();
         g_coin_stats_index.reset();
     }
+    if (g_block_stats_index) {
+        g_block_stats_index->Stop();
+        g_block_stats_index.reset();
+    }
+    if (g_address_index) {
+        g_address_index->Stop();
+        g_address_index.reset();
+    }
+    if (g_spent_index) {
+        g_spent_index->Stop();
+        g_spent_index.reset();
+    }
     ForEachBlockFilterIndex([](BlockFilterIndex& index) { index.Stop(); });
     DestroyAllBlockFilterIndexes();
 
@@ -303,6 +372,9 @@ void Shutdown(NodeContext& node)
                 chainstate->ResetCoinsViews();
             }
         }
+        if (fBlockIndexSnapshot && !node.chainman->m_blockman.m_block_index.empty()) {
+            node.chainman->m_blockman.WriteBlockIndexSnapshot();
+        }
     }
     for (const auto& client : node.chain_clients) {
         client->stop();
@@ -317,6 +389,7 @@ void Shutdown(NodeContext& node)
 #endif
 
     node.chain_clients.clear();
+    node.block_prefetcher.reset();
     UnregisterAllValidationInterfaces();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     node.kernel.reset();
@@ -334,6 +407,7 @@ void Shutdown(NodeContext& node)
     }
 
     LogPrintf("%s: done\n", __func__);
+    LogInstance().StopWriter();
 }
 
 /**
@@ -412,28 +486,41 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-alertnotify=<cmd>", "Execute command when an alert is raised (%s in cmd is replaced by message)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-assumevalid=<hex>", strprintf("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex(), signetChainParams->GetConsensus().defaultAssumeValid.GetHex()), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-asynccoinsflush", strprintf("Write the coins cache to the coin database on a background thread, so block validation does not wait for it (default: %u)", DEFAULT_ASYNC_COINS_FLUSH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-addressindex", strprintf("Maintain an index of the outputs and spends of every script, used by the getaddresshistory, getaddressutxos and getaddressbalance RPCs (default: %u)", DEFAULT_ADDRESSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksdir=<dir>", "Specify directory to hold blocks subdirectory for *.dat files (default: <datadir>)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-fastprune", "Use smaller block files and lower minimum prune height for testing purposes", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
 #if HAVE_SYSTEM
     argsman.AddArg("-blocknotify=<cmd>", "Execute command when the best block changes (%s in cmd is replaced by block hash)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 #endif
     argsman.AddArg("-blockreconstructionextratxn=<n>", strprintf("Extra transactions to keep in memory for compact block reconstructions (default: %u)", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockstatsindex", strprintf("Maintain an index of the statistics of each block, used by the getblockstats RPC (default: %u)", DEFAULT_BLOCKSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blocksonly", strprintf("Whether to reject transactions from network peers. Automatic broadcast and rebroadcast of any transactions from inbound peers is disabled, unless the peer has the 'forcerelay' permission. RPC transactions are not affected. (default: %u)", DEFAULT_BLOCKSONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-headersonly", strprintf("Only download and store the headers of the best chain, not its blocks, and serve them to peers from %s in the blocks directory. Implies -blocksonly. (default: %u)", "headers.dat", DEFAULT_HEADERS_ONLY), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-coinstatsindex", strprintf("Maintain coinstats index used by the gettxoutsetinfo RPC (default: %u)", DEFAULT_COINSTATSINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-conf=<file>", strprintf("Specify path to read-only configuration file. Relative paths will be prefixed by datadir location (only useable from command line, not configuration file) (default: %s)", BITCOIN_CONF_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-datadir=<dir>", "Specify data directory", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbbatchsize", strprintf("Maximum database write batch size in bytes (default: %u)", nDefaultDbBatchSize), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-leveldboption=<db>.<option>=<n>", strprintf("Set a LevelDB option of one database (%s). Options are write_buffer_size, block_size, max_file_size (bytes), bloom_bits (bits per key, 0 for no bloom filter) and compression (0 or 1). Can be specified multiple times", Join(DB_OPTION_NAMES, ", ")), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-backgroundcache=<n>", strprintf("Percentage of -dbcache for the background validation of an assumeutxo snapshot while the chain is synced on top of it (1 to 50, default: %d)", kernel::DEFAULT_BACKGROUND_CACHE_PERCENT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-compactdbafteribd", strprintf("Once the initial block download is done, compact the chainstate and block index databases in the background, a range of keys every %d seconds, so that compactions left behind by the sync do not delay new blocks (default: %u)", count_seconds(IDLE_DB_COMPACTION_INTERVAL), DEFAULT_COMPACT_DB_AFTER_IBD), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-dbcache=<n>", strprintf("Maximum database cache size <n> MiB (%d to %d, default: %d). In addition, unused mempool memory is shared for this cache (see -maxmempool).", nMinDbCache, nMaxDbCache, nDefaultDbCache), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-includeconf=<file>", "Specify additional configuration file, relative to the -datadir path (only useable from configuration file, not command line)", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-loadblock=<file>", "Imports blocks from external file on startup", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-loadheaders=<file>", "Imports block headers from a file written by dumpheaders on startup, before connecting to peers, checking their proof of work in parallel (see -powthreads). Can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxmempool=<n>", strprintf("Keep the transaction memory pool below <n> megabytes (default: %u)", DEFAULT_MAX_MEMPOOL_SIZE_MB), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-maxorphantx=<n>", strprintf("Keep at most <n> unconnectable transactions in memory (default: %u)", DEFAULT_MAX_ORPHAN_TRANSACTIONS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-mempoolexpiry=<n>", strprintf("Do not keep transactions in the mempool longer than <n> hours (default: %u)", DEFAULT_MEMPOOL_EXPIRY_HOURS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-mempooldeltaevents=<n>", strprintf("Keep the last <n> transactions added to or removed from the mempool, so that getmempooldelta can report them (default: %u)", DEFAULT_MEMPOOL_DELTA_EVENTS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s, signet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex(), signetChainParams->GetConsensus().nMinimumChainWork.GetHex()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::OPTIONS);
     argsman.AddArg("-par=<n>", strprintf("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-persistmempool", strprintf("Whether to save the mempool on shutdown and load on restart (default: %u)", DEFAULT_PERSIST_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-pid=<file>", strprintf("Specify pid file. Relative paths will be prefixed by a net-specific datadir location. (default: %s)", BITCOIN_PID_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-powthreads=<n>", strprintf("Set the number of header proof-of-work verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        -GetNumCores(), MAX_POWCHECK_THREADS, DEFAULT_POWCHECK_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-prefetchthreads=<n>", strprintf("Set the number of threads that look up the inputs of a block in the coin database before it is connected (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)",
+        -GetNumCores(), MAX_PREFETCH_THREADS, DEFAULT_PREFETCH_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-prune=<n>", strprintf("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >=%u = automatically prune block files to stay under the specified target size in MiB)", MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
@@ -448,12 +535,21 @@ void SetupServerArgs(ArgsManager& argsman)
 #else
     hidden_args.emplace_back("-sysperms");
 #endif
+    argsman.AddArg("-blockfilemmap", strprintf("Read blocks from memory-mapped block files instead of copying them out of the files (default: %u)", DEFAULT_BLOCK_FILE_MMAP), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-compressblockfiles", strprintf("Write new blocks to the block files in a compressed format, which is read transparently but cannot be read by older versions (default: %u)", DEFAULT_COMPRESS_BLOCK_FILES), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-trustindexedblockpow", strprintf("Skip the proof-of-work check when reading a block from disk whose header is already in the validated block index, comparing its hash against the index entry instead (default: %u)", DEFAULT_TRUST_INDEXED_BLOCK_POW), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-blockindexsnapshot", strprintf("Write a snapshot of the block index to the blocks directory at shutdown, and load it at startup instead of the block index database when it is still up to date (default: %u)", DEFAULT_BLOCK_INDEX_SNAPSHOT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-spentindex", strprintf("Maintain an index of the input spending each output, used by the gettxspendingprevout RPC for outputs spent in the block chain (default: %u)", DEFAULT_SPENTINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-txindex", strprintf("Maintain a full transaction index, used by the getrawtransaction rpc call (default: %u)", DEFAULT_TXINDEX), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-utxomuhash", strprintf("Keep the MuHash of the UTXO set up to date as blocks are connected, so gettxoutsetinfo with hash_type muhash needs no scan of the UTXO set (default: %u)", DEFAULT_UTXO_MUHASH), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-validationsignalthreads=<n>", strprintf("Number of threads delivering validation notifications to their subscribers, each of which has its own queue. With 0, all subscribers are served by the scheduler thread (default: %d)", DEFAULT_VALIDATION_SIGNAL_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     argsman.AddArg("-blockfilterindex=<type>",
                  strprintf("Maintain an index of compact filters by block (default: %s, values: %s).", DEFAULT_BLOCKFILTERINDEX, ListBlockFilterTypes()) +
                  " If <type> is not supplied or if <type> = 1, indexes for all known types are enabled.",
                  ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    argsman.AddArg("-indexsyncthreads=<n>", strprintf("Number of threads each index reads and processes blocks with while it catches up with the block chain, in addition to its sync thread (0 to %d, default: %d)", MAX_INDEX_SYNC_THREADS, DEFAULT_INDEX_SYNC_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
     gArgs.AddArg("-checkpointkey", "ACP private key", 0, OptionsCategory::OPTIONS);
+    argsman.AddArg("-checkpointdepth=<n>", strprintf("Number of blocks below the tip at which a checkpoint master selects automatic checkpoints (default: %d)", DEFAULT_AUTOCHECKPOINT), ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
 
     argsman.AddArg("-addnode=<ip>", strprintf("Add a node to connect to and attempt to keep the connection open (see the addnode RPC help for more info). This option can be specified multiple times to add multiple nodes; connections are limited to %u at a time and are counted separately from the -maxconnections limit.", MAX_ADDNODE_CONNECTIONS), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::CONNECTION);
     argsman.AddArg("-asmap=<file>", strprintf("Specify asn mapping used for bucketing of the peers (default: %s). Relative paths will be prefixed by the net-specific datadir location.", DEFAULT_ASMAP_FILENAME), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
@@ -474,11 +570,13 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-maxsendbuffer=<n>", strprintf("Maximum per-connection send buffer, <n>*1000 bytes (default: %u)", DEFAULT_MAXSENDBUFFER), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-maxtimeadjustment", strprintf("Maximum allowed median peer time offset adjustment. Local perspective of time may be influenced by outbound peers forward or backward by this amount (default: %u seconds).", DEFAULT_MAX_TIME_ADJUSTMENT), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-maxuploadtarget=<n>", strprintf("Tries to keep outbound traffic under the given target per 24h. Limit does not apply to peers with 'download' permission or blocks created within past week. 0 = no limit (default: %s). Optional suffix units [k|K|m|M|g|G|t|T] (default: M). Lowercase is 1000 base while uppercase is 1024 base", DEFAULT_MAX_UPLOAD_TARGET), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-msgpreparethreads=<n>", strprintf("Number of threads that check the proof of work of received headers and blocks ahead of message processing, sharded by peer (0 to disable, maximum: %d, default: %d)", MAX_MESSAGE_PREPARE_THREADS, DEFAULT_MESSAGE_PREPARE_THREADS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     argsman.AddArg("-onion=<ip:port>", "Use separate SOCKS5 proxy to reach peers via Tor onion services, set -noonion to disable (default: -proxy)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-i2psam=<ip:port>", "I2P SAM proxy to reach I2P peers and accept I2P connections (default: none)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-i2pacceptincoming", "If set and -i2psam is also set then incoming I2P connections are accepted via the SAM proxy. If this is not set but -i2psam is set then only outgoing connections will be made to the I2P network. Ignored if -i2psam is not set. Listening for incoming I2P connections is done through the SAM proxy, not by binding to a local address and port (default: 1)", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-onlynet=<net>", "Make automatic outbound connections only to network <net> (" + Join(GetNetworkNames(), ", ") + "). Inbound and manual connections are not affected by this option. It can be specified multiple times to allow multiple networks.", ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     argsman.AddArg("-peerbloomfilters", strprintf("Support filtering of blocks and transaction with bloom filters (default: %u)", DEFAULT_PEERBLOOMFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
+    argsman.AddArg("-txreconciliation", strprintf("Enable transaction reconciliations per BIP 330 (default: %d)", DEFAULT_TXRECONCILIATION_ENABLE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::CONNECTION);
     argsman.AddArg("-peerblockfilters", strprintf("Serve compact block filters to peers per BIP 157 (default: %u)", DEFAULT_PEERBLOCKFILTERS), ArgsManager::ALLOW_ANY, OptionsCategory::CONNECTION);
     // TODO: remove the sentence "Nodes not using ... incoming connections." once the changes from
     // https://github.com/bitcoin/bitcoin/pull/23542 have become widespread.
@@ -521,25 +619,56 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-zmqpubrawblock=<address>", "Enable publish raw block in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawtx=<address>", "Enable publish raw transaction in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubsequence=<address>", "Enable publish hash block and tx sequence in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubtemplate=<address>", "Enable publish new block template in <address>", ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubtemplatefeedelta=<n>", strprintf("Also publish a new block template for the same tip when its fees improve by at least <n> satoshis (default: %d)", CZMQNotificationInterface::DEFAULT_TEMPLATE_FEE_DELTA), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubhashblockhwm=<n>", strprintf("Set publish hash block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubhashtxhwm=<n>", strprintf("Set publish hash transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawblockhwm=<n>", strprintf("Set publish raw block outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubrawtxhwm=<n>", strprintf("Set publish raw transaction outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
     argsman.AddArg("-zmqpubsequencehwm=<n>", strprintf("Set publish hash sequence message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubtemplatehwm=<n>", strprintf("Set publish new block template outbound message high water mark (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubhashblockbatch=<n>", strprintf("Collect publish hash block messages for <n> milliseconds before sending them together (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count()), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubhashtxbatch=<n>", strprintf("Collect publish hash transaction messages for <n> milliseconds before sending them together (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count()), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubrawblockbatch=<n>", strprintf("Collect publish raw block messages for <n> milliseconds before sending them together (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count()), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubrawtxbatch=<n>", strprintf("Collect publish raw transaction messages for <n> milliseconds before sending them together (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count()), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubsequencebatch=<n>", strprintf("Collect publish hash sequence messages for <n> milliseconds before sending them together (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count()), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubtemplatebatch=<n>", strprintf("Collect publish new block template messages for <n> milliseconds before sending them together (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count()), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubhashblockqueue=<n>", strprintf("Set maximum number of publish hash block messages waiting to be sent, later ones are dropped (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubhashtxqueue=<n>", strprintf("Set maximum number of publish hash transaction messages waiting to be sent, later ones are dropped (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubrawblockqueue=<n>", strprintf("Set maximum number of publish raw block messages waiting to be sent, later ones are dropped (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubrawtxqueue=<n>", strprintf("Set maximum number of publish raw transaction messages waiting to be sent, later ones are dropped (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubsequencequeue=<n>", strprintf("Set maximum number of publish hash sequence messages waiting to be sent, later ones are dropped (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
+    argsman.AddArg("-zmqpubtemplatequeue=<n>", strprintf("Set maximum number of publish new block template messages waiting to be sent, later ones are dropped (default: %d)", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE), ArgsManager::ALLOW_ANY, OptionsCategory::ZMQ);
 #else
     hidden_args.emplace_back("-zmqpubhashblock=<address>");
     hidden_args.emplace_back("-zmqpubhashtx=<address>");
     hidden_args.emplace_back("-zmqpubrawblock=<address>");
     hidden_args.emplace_back("-zmqpubrawtx=<address>");
     hidden_args.emplace_back("-zmqpubsequence=<n>");
+    hidden_args.emplace_back("-zmqpubtemplate=<address>");
+    hidden_args.emplace_back("-zmqpubtemplatefeedelta=<n>");
     hidden_args.emplace_back("-zmqpubhashblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubhashtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawblockhwm=<n>");
     hidden_args.emplace_back("-zmqpubrawtxhwm=<n>");
     hidden_args.emplace_back("-zmqpubsequencehwm=<n>");
+    hidden_args.emplace_back("-zmqpubtemplatehwm=<n>");
+    hidden_args.emplace_back("-zmqpubhashblockbatch=<n>");
+    hidden_args.emplace_back("-zmqpubhashtxbatch=<n>");
+    hidden_args.emplace_back("-zmqpubrawblockbatch=<n>");
+    hidden_args.emplace_back("-zmqpubrawtxbatch=<n>");
+    hidden_args.emplace_back("-zmqpubsequencebatch=<n>");
+    hidden_args.emplace_back("-zmqpubtemplatebatch=<n>");
+    hidden_args.emplace_back("-zmqpubhashblockqueue=<n>");
+    hidden_args.emplace_back("-zmqpubhashtxqueue=<n>");
+    hidden_args.emplace_back("-zmqpubrawblockqueue=<n>");
+    hidden_args.emplace_back("-zmqpubrawtxqueue=<n>");
+    hidden_args.emplace_back("-zmqpubsequencequeue=<n>");
+    hidden_args.emplace_back("-zmqpubtemplatequeue=<n>");
 #endif
 
     argsman.AddArg("-checkblocks=<n>", strprintf("How many blocks to check at startup (default: %u, 0 = all)", DEFAULT_CHECKBLOCKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-checkblocksbackground", strprintf("Check the blocks of -checkblocks after startup instead of before, shutting down if they fail (default: %u)", DEFAULT_CHECKBLOCKS_BACKGROUND), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checklevel=<n>", strprintf("How thorough the block verification of -checkblocks is: %s (0-4, default: %u)", Join(CHECKLEVEL_DOC, ", "), DEFAULT_CHECKLEVEL), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkblockindex", strprintf("Do a consistency check for the block tree, chainstate, and other validation data structures occasionally. (default: %u, regtest: %u)", defaultChainParams->DefaultConsistencyChecks(), regtestChainParams->DefaultConsistencyChecks()), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-checkaddrman=<n>", strprintf("Run addrman consistency checks every <n> operations. Use 0 to disable. (default: %u)", DEFAULT_ADDRMAN_CONSISTENCY_CHECKS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
@@ -554,8 +683,11 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-limitdescendantsize=<n>", strprintf("Do not accept transactions if any ancestor would have more than <n> kilobytes of in-mempool descendants (default: %u).", DEFAULT_DESCENDANT_SIZE_LIMIT_KVB), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-addrmantest", "Allows to test address relay on localhost", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-capturemessages", "Capture all P2P messages to disk", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-lockstats", strprintf("Record how often and for how long each lock site is waited for and held, see the getlockstats RPC (default: %u)", DEFAULT_LOCKSTATS), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-mocktime=<n>", "Replace actual time with " + UNIX_EPOCH_TIME + " (default: 0)", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxsigcachesize=<n>", strprintf("Limit sum of signature cache and script execution cache sizes to <n> MiB (default: %u)", DEFAULT_MAX_SIG_CACHE_BYTES >> 20), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-scriptcachegrowthlimit=<n>", "Let blocks that miss the script execution cache while it is full grow it up to <n> MiB (default: 0, never grow)", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
+    argsman.AddArg("-maxpowcachesize=<n>", strprintf("Limit size of the proof-of-work hash cache to <n> MiB, 0 to disable (default: %u)", DEFAULT_MAX_POW_CACHE_BYTES >> 20), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-maxtipage=<n>", strprintf("Maximum tip age in seconds to consider node in initial block download (default: %u)", DEFAULT_MAX_TIP_AGE), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-printpriority", strprintf("Log transaction fee rate in " + CURRENCY_UNIT + "/kvB when mining blocks (default: %u)", DEFAULT_PRINTPRIORITY), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::DEBUG_TEST);
     argsman.AddArg("-uacomment=<cmt>", "Append comment to the user agent string", ArgsManager::ALLOW_ANY, OptionsCategory::DEBUG_TEST);
@@ -569,6 +701,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-datacarrier", strprintf("Relay and mine data carrier transactions (default: %u)", DEFAULT_ACCEPT_DATACARRIER), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
     argsman.AddArg("-datacarriersize", strprintf("Maximum size of data in data carrier transactions we relay and mine (default: %u)", MAX_OP_RETURN_RELAY), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
     argsman.AddArg("-mempoolfullrbf", strprintf("Accept transaction replace-by-fee without requiring replaceability signaling (default: %u)", DEFAULT_MEMPOOL_FULL_RBF), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
+    argsman.AddArg("-clustermempool", strprintf("Select block transactions and evict transactions when the mempool is full by the feerate chunks of linearized clusters of related transactions, instead of by ancestor and descendant packages (default: %u)", DEFAULT_CLUSTER_MEMPOOL), ArgsManager::ALLOW_ANY, OptionsCategory::NODE_RELAY);
     argsman.AddArg("-permitbaremultisig", strprintf("Relay non-P2SH multisig (default: %u)", DEFAULT_PERMIT_BAREMULTISIG), ArgsManager::ALLOW_ANY,
                    OptionsCategory::NODE_RELAY);
     argsman.AddArg("-minrelaytxfee=<amt>", strprintf("Fees (in %s/kvB) smaller than this are considered zero fee for relaying, mining and transaction creation (default: %s)",
@@ -580,8 +713,10 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-blockmaxweight=<n>", strprintf("Set maximum BIP141 block weight (default: %d)", DEFAULT_BLOCK_MAX_WEIGHT), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockmintxfee=<amt>", strprintf("Set lowest fee rate (in %s/kvB) for transactions to be included in block creation. (default: %s)", CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
     argsman.AddArg("-blockversion=<n>", "Override block version to test forking scenarios", ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::BLOCK_CREATION);
+    argsman.AddArg("-generatethreads=<n>", strprintf("Number of threads the generate RPCs use to search for a valid block nonce (0 = one per core, default: %d)", DEFAULT_GENERATE_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::BLOCK_CREATION);
 
     argsman.AddArg("-rest", strprintf("Accept public REST requests (default: %u)", DEFAULT_REST_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
+    argsman.AddArg("-metrics", strprintf("Serve node metrics in the Prometheus text format at /metrics on the RPC port, without authentication (default: %u)", DEFAULT_METRICS_ENABLE), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcallowip=<ip>", "Allow JSON-RPC connections from specified source. Valid for <ip> are a single IP (e.g. 1.2.3.4), a network/netmask (e.g. 1.2.3.4/255.255.255.0) or a network/CIDR (e.g. 1.2.3.4/24). This option can be specified multiple times", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcauth=<userpw>", "Username and HMAC-SHA-256 hashed password for JSON-RPC connections. The field <userpw> comes in the format: <USERNAME>:<SALT>$<HASH>. A canonical python script is included in share/rpcauth. The client then connects normally using the rpcuser=<USERNAME>/rpcpassword=<PASSWORD> pair of arguments. This option can be specified multiple times", ArgsManager::ALLOW_ANY | ArgsManager::SENSITIVE, OptionsCategory::RPC);
     argsman.AddArg("-rpcbind=<addr>[:port]", "Bind to given address to listen for JSON-RPC connections. Do not expose the RPC server to untrusted networks such as the public internet! This option is ignored unless -rpcallowip is also passed. Port is optional and overrides -rpcport. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1 and ::1 i.e., localhost)", ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY | ArgsManager::SENSITIVE, OptionsCategory::RPC);
@@ -591,6 +726,7 @@ void SetupServerArgs(ArgsManager& argsman)
     argsman.AddArg("-rpcport=<port>", strprintf("Listen for JSON-RPC connections on <port> (default: %u, testnet: %u, signet: %u, regtest: %u)", defaultBaseParams->RPCPort(), testnetBaseParams->RPCPort(), signetBaseParams->RPCPort(), regtestBaseParams->RPCPort()), ArgsManager::ALLOW_ANY | ArgsManager::NETWORK_ONLY, OptionsCategory::RPC);
     argsman.AddArg("-rpcserialversion", strprintf("Sets the serialization of raw transaction or block hex returned in non-verbose mode, non-segwit(0) or segwit(1) (default: %d)", DEFAULT_RPC_SERIALIZE_VERSION), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcservertimeout=<n>", strprintf("Timeout during HTTP requests (default: %d)", DEFAULT_HTTP_SERVER_TIMEOUT), ArgsManager::ALLOW_ANY | ArgsManager::DEBUG_ONLY, OptionsCategory::RPC);
+    argsman.AddArg("-rpceventthreads=<n>", strprintf("Set the number of threads accepting and parsing RPC requests, each with its own event loop. More than one share the RPC ports through SO_REUSEPORT, which is not supported on Windows (default: %d)", DEFAULT_HTTP_EVENT_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcthreads=<n>", strprintf("Set the number of threads to service RPC calls (default: %d)", DEFAULT_HTTP_THREADS), ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
     argsman.AddArg("-rpcuser=<user>", "Username for JSON-RPC connections", ArgsManager::ALLOW_ANY | ArgsManager::SENSITIVE, OptionsCategory::RPC);
     argsman.AddArg("-rpcwhitelist=<whitelist>", "Set a whitelist to filter incoming RPC calls for a specific user. The field <whitelist> comes in the format: <USERNAME>:<rpc 1>,<rpc 2>,...,<rpc n>. If multiple whitelists are set for a given user, they are set-intersected. See -rpcwhitelistdefault documentation for information on default whitelist behavior.", ArgsManager::ALLOW_ANY, OptionsCategory::RPC);
@@ -652,6 +788,7 @@ static bool AppInitServers(NodeContext& node)
     if (!StartHTTPRPC(&node))
         return false;
     if (args.GetBoolArg("-rest", DEFAULT_REST_ENABLE)) StartREST(&node);
+    if (args.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) StartHTTPMetrics(&node);
     StartHTTPServer();
     return true;
 }
@@ -717,6 +854,12 @@ void InitParameterInteraction(ArgsManager& args)
             LogPrintf("%s: parameter interaction: -externalip set -> setting -discover=0\n", __func__);
     }
 
+    // headers-only nodes do not validate transactions either
+    if (args.GetBoolArg("-headersonly", DEFAULT_HEADERS_ONLY)) {
+        if (args.SoftSetBoolArg("-blocksonly", true))
+            LogPrintf("%s: parameter interaction: -headersonly=1 -> setting -blocksonly=1\n", __func__);
+    }
+
     // disable whitelistrelay in blocksonly mode
     if (args.GetBoolArg("-blocksonly", DEFAULT_BLOCKSONLY)) {
         if (args.SoftSetBoolArg("-whitelistrelay", false))
@@ -830,6 +973,8 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
     nNeoScryptOptions |= 0x1000;
 #endif
 
+    SetLockStatsEnabled(args.GetBoolArg("-lockstats", DEFAULT_LOCKSTATS));
+
     // also see: InitParameterInteraction()
 
     // Error if network-specific options (-addnode, -connect, etc) are
@@ -889,6 +1034,12 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
     if (args.GetIntArg("-prune", 0)) {
         if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+            return InitError(_("Prune mode is incompatible with -addressindex."));
+        }
+        if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+            return InitError(_("Prune mode is incompatible with -spentindex."));
+        }
         if (args.GetBoolArg("-reindex-chainstate", false)) {
             return InitError(_("Prune mode is incompatible with -reindex-chainstate. Use full -reindex instead."));
         }
@@ -967,6 +1118,18 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         fPruneMode = true;
     }
 
+    {
+        bilingual_str db_options_error;
+        if (!CheckDBOptions(args, db_options_error)) {
+            return InitError(db_options_error);
+        }
+    }
+
+    fCompressBlockFiles = args.GetBoolArg("-compressblockfiles", DEFAULT_COMPRESS_BLOCK_FILES);
+    fBlockFileMmap = args.GetBoolArg("-blockfilemmap", DEFAULT_BLOCK_FILE_MMAP);
+    fTrustIndexedBlockPoW = args.GetBoolArg("-trustindexedblockpow", DEFAULT_TRUST_INDEXED_BLOCK_POW);
+    fBlockIndexSnapshot = args.GetBoolArg("-blockindexsnapshot", DEFAULT_BLOCK_INDEX_SNAPSHOT);
+
     nConnectTimeout = args.GetIntArg("-timeout", DEFAULT_CONNECT_TIMEOUT);
     if (nConnectTimeout <= 0) {
         nConnectTimeout = DEFAULT_CONNECT_TIMEOUT;
@@ -1011,6 +1174,12 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         if (g_enabled_filter_types.count(BlockFilterType::BASIC)) {
             return InitError(_("-reindex-chainstate option is not compatible with -blockfilterindex. Please temporarily disable blockfilterindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
         }
+        if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -addressindex. Please temporarily disable addressindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
+        if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+            return InitError(_("-reindex-chainstate option is not compatible with -spentindex. Please temporarily disable spentindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
+        }
         if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
             return InitError(_("-reindex-chainstate option is not compatible with -txindex. Please temporarily disable txindex while using -reindex-chainstate, or replace -reindex-chainstate with -reindex to fully rebuild all indexes."));
         }
@@ -1021,6 +1190,7 @@ bool AppInitParameterInteraction(const ArgsManager& args, bool use_syscall_sandb
         if (!SetCheckpointPrivKey(gArgs.GetArg("-checkpointkey", "")))
             return InitError(_("Unable to sign checkpoint, wrong checkpointkey?"));
     }
+    SetCheckpointDepth(args.GetIntArg("-checkpointdepth", DEFAULT_AUTOCHECKPOINT));
 
 #if defined(USE_SYSCALL_SANDBOX)
     if (args.IsArgSet("-sandbox") && !args.IsArgNegated("-sandbox")) {
@@ -1109,6 +1279,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     const ArgsManager& args = *Assert(node.args);
     const CChainParams& chainparams = Params();
 
+    assert(!node.startup_profiler);
+    node.startup_profiler = std::make_unique<StartupProfiler>();
+    StartupProfiler& profiler = *node.startup_profiler;
+
     auto opt_max_upload = ParseByteUnits(args.GetArg("-maxuploadtarget", DEFAULT_MAX_UPLOAD_TARGET), ByteUnit::M);
     if (!opt_max_upload) {
         return InitError(strprintf(_("Unable to parse -maxuploadtarget: '%s'"), args.GetArg("-maxuploadtarget", "")));
@@ -1138,10 +1312,13 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     ValidationCacheSizes validation_cache_sizes{};
     ApplyArgsManOptions(args, validation_cache_sizes);
     if (!InitSignatureCache(validation_cache_sizes.signature_cache_bytes)
-        || !InitScriptExecutionCache(validation_cache_sizes.script_execution_cache_bytes))
+        || !InitScriptExecutionCache(validation_cache_sizes.script_execution_cache_bytes, validation_cache_sizes.script_execution_cache_growth_limit_bytes))
     {
         return InitError(strprintf(_("Unable to allocate memory for -maxsigcachesize: '%s' MiB"), args.GetIntArg("-maxsigcachesize", DEFAULT_MAX_SIG_CACHE_BYTES >> 20)));
     }
+    if (!InitPoWHashCache(validation_cache_sizes.pow_hash_cache_bytes)) {
+        return InitError(strprintf(_("Unable to allocate memory for -maxpowcachesize: '%s' MiB"), args.GetIntArg("-maxpowcachesize", DEFAULT_MAX_POW_CACHE_BYTES >> 20)));
+    }
 
     int script_threads = args.GetIntArg("-par", DEFAULT_SCRIPTCHECK_THREADS);
     if (script_threads <= 0) {
@@ -1162,6 +1339,36 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         StartScriptCheckWorkerThreads(script_threads);
     }
 
+    int pow_threads = args.GetIntArg("-powthreads", DEFAULT_POWCHECK_THREADS);
+    if (pow_threads <= 0) {
+        // -powthreads=0 means autodetect, -powthreads=-n means "leave n cores free"
+        pow_threads += GetNumCores();
+    }
+
+    // Subtract 1 because the message handler thread takes part in the checks,
+    // and cap at MAX_POWCHECK_THREADS
+    pow_threads = std::min(std::max(pow_threads - 1, 0), MAX_POWCHECK_THREADS);
+
+    LogPrintf("Header proof-of-work verification uses %d additional threads\n", pow_threads);
+    if (pow_threads >= 1) {
+        StartPoWCheckWorkerThreads(pow_threads);
+    }
+
+    int prefetch_threads = args.GetIntArg("-prefetchthreads", DEFAULT_PREFETCH_THREADS);
+    if (prefetch_threads <= 0) {
+        // -prefetchthreads=0 means autodetect, -prefetchthreads=-n means "leave n cores free"
+        prefetch_threads += GetNumCores();
+    }
+
+    // Subtract 1 because the validation thread takes part in the lookups,
+    // and cap at MAX_PREFETCH_THREADS
+    prefetch_threads = std::min(std::max(prefetch_threads - 1, 0), MAX_PREFETCH_THREADS);
+
+    LogPrintf("Block input prefetching uses %d additional threads\n", prefetch_threads);
+    if (prefetch_threads >= 1) {
+        StartPrefetchWorkerThreads(prefetch_threads);
+    }
+
     assert(!node.scheduler);
     node.scheduler = std::make_unique<CScheduler>();
 
@@ -1173,7 +1380,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         RandAddPeriodic();
     }, std::chrono::minutes{1});
 
-    GetMainSignals().RegisterBackgroundSignalScheduler(*node.scheduler);
+    GetMainSignals().RegisterBackgroundSignalScheduler(*node.scheduler, std::max<int>(0, args.GetIntArg("-validationsignalthreads", DEFAULT_VALIDATION_SIGNAL_THREADS)));
 
     // Create client interfaces for wallets that are supposed to be loaded
     // according to -wallet and -disablewallet options. This only constructs
@@ -1205,11 +1412,13 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     }
 
     // ********************************************************* Step 5: verify wallet database integrity
+    StartupProfiler::Timer verify_wallets_timer{profiler, "verify_wallets"};
     for (const auto& client : node.chain_clients) {
         if (!client->verify()) {
             return false;
         }
     }
+    verify_wallets_timer.Stop();
 
     // ********************************************************* Step 6: network initialization
     // Note that we absolutely cannot open any actual connections
@@ -1221,6 +1430,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     fDiscover = args.GetBoolArg("-discover", true);
     const bool ignores_incoming_txs{args.GetBoolArg("-blocksonly", DEFAULT_BLOCKSONLY)};
 
+    // The peer address and ban databases and the fee estimates are read on
+    // threads of their own, while the block chain loads. Each is waited for
+    // right before its first use.
+    std::future<std::optional<bilingual_str>> load_addrman, load_banlist, load_fee_estimates;
     {
 
         // Read asmap file if configured
@@ -1251,25 +1464,27 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
         // Initialize addrman
         assert(!node.addrman);
-        uiInterface.InitMessage(_("Loading P2P addresses…").translated);
-        if (const auto error{LoadAddrman(*node.netgroupman, args, node.addrman)}) {
-            return InitError(*error);
-        }
+        load_addrman = profiler.Start("addrman", [&node, &args] {
+            uiInterface.InitMessage(_("Loading P2P addresses…").translated);
+            return LoadAddrman(*node.netgroupman, args, node.addrman);
+        });
     }
 
     assert(!node.banman);
-    node.banman = std::make_unique<BanMan>(gArgs.GetDataDirNet() / "banlist", &uiInterface, args.GetIntArg("-bantime", DEFAULT_MISBEHAVING_BANTIME));
-    assert(!node.connman);
-    node.connman = std::make_unique<CConnman>(GetRand<uint64_t>(),
-                                              GetRand<uint64_t>(),
-                                              *node.addrman, *node.netgroupman, args.GetBoolArg("-networkactive", true));
-
-    g_connman = std::unique_ptr<CConnman>(node.connman.get());
+    load_banlist = profiler.Start("banlist", [&node, &args]() -> std::optional<bilingual_str> {
+        node.banman = std::make_unique<BanMan>(gArgs.GetDataDirNet() / "banlist", &uiInterface, args.GetIntArg("-bantime", DEFAULT_MISBEHAVING_BANTIME));
+        return std::nullopt;
+    });
 
     assert(!node.fee_estimator);
     // Don't initialize fee estimation with old data if we don't relay transactions,
     // as they would never get updated.
-    if (!ignores_incoming_txs) node.fee_estimator = std::make_unique<CBlockPolicyEstimator>(FeeestPath(args));
+    if (!ignores_incoming_txs) {
+        load_fee_estimates = profiler.Start("fee_estimates", [&node, &args, &chainparams]() -> std::optional<bilingual_str> {
+            node.fee_estimator = std::make_unique<CBlockPolicyEstimator>(FeeestPath(args), chainparams.GetConsensus().PowTargetSpacing());
+            return std::nullopt;
+        });
+    }
 
     // sanitize comments per BIP-0014, format user agent and check total size
     std::vector<std::string> uacomments;
@@ -1393,7 +1608,13 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     }
 
 #if ENABLE_ZMQ
-    g_zmq_notification_interface = CZMQNotificationInterface::Create();
+    g_zmq_notification_interface = CZMQNotificationInterface::Create(
+        [&node](const CBlockTemplate* previous) -> std::unique_ptr<CBlockTemplate> {
+            if (!node.chainman || !node.mempool) return nullptr;
+            Chainstate& chainstate{node.chainman->ActiveChainstate()};
+            if (chainstate.IsInitialBlockDownload()) return nullptr;
+            return BlockAssembler{chainstate, node.mempool.get()}.CreateNewBlock(CScript() << OP_TRUE, previous);
+        });
 
     if (g_zmq_notification_interface) {
         RegisterValidationInterface(g_zmq_notification_interface);
@@ -1413,6 +1634,12 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         LogPrintf("* Using %.1f MiB for transaction index database\n", cache_sizes.tx_index * (1.0 / 1024 / 1024));
     }
+    if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        LogPrintf("* Using %.1f MiB for address index database\n", cache_sizes.address_index * (1.0 / 1024 / 1024));
+    }
+    if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        LogPrintf("* Using %.1f MiB for spent output index database\n", cache_sizes.spent_index * (1.0 / 1024 / 1024));
+    }
     for (BlockFilterType filter_type : g_enabled_filter_types) {
         LogPrintf("* Using %.1f MiB for %s block filter index database\n",
                   cache_sizes.filter_index * (1.0 / 1024 / 1024), BlockFilterTypeName(filter_type));
@@ -1422,6 +1649,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     assert(!node.mempool);
     assert(!node.chainman);
 
+    if (load_fee_estimates.valid()) load_fee_estimates.get();
     CTxMemPool::Options mempool_opts{
         .estimator = node.fee_estimator.get(),
         .check_ratio = chainparams.DefaultConsistencyChecks() ? 1 : 0,
@@ -1443,6 +1671,8 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         const ChainstateManager::Options chainman_opts{
             .chainparams = chainparams,
             .adjusted_time_callback = GetAdjustedTime,
+            .background_cache_percent = int(std::clamp<int64_t>(args.GetIntArg("-backgroundcache", kernel::DEFAULT_BACKGROUND_CACHE_PERCENT), 1, 50)),
+            .stop_at_height = int(args.GetIntArg("-stopatheight", DEFAULT_STOPATHEIGHT)),
         };
         node.chainman = std::make_unique<ChainstateManager>(chainman_opts);
         ChainstateManager& chainman = *node.chainman;
@@ -1454,6 +1684,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         options.prune = node::fPruneMode;
         options.check_blocks = args.GetIntArg("-checkblocks", DEFAULT_CHECKBLOCKS);
         options.check_level = args.GetIntArg("-checklevel", DEFAULT_CHECKLEVEL);
+        options.check_in_background = args.GetBoolArg("-checkblocksbackground", DEFAULT_CHECKBLOCKS_BACKGROUND);
         options.check_interrupt = ShutdownRequested;
         options.coins_error_cb = [] {
             uiInterface.ThreadSafeMessageBox(
@@ -1473,7 +1704,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
             }
         };
 
-        auto [status, error] = catch_exceptions([&]{ return LoadChainstate(chainman, cache_sizes, options); });
+        auto [status, error] = profiler.Time("load_chainstate", [&]{ return catch_exceptions([&]{ return LoadChainstate(chainman, cache_sizes, options); }); });
 
         if (status == node::ChainstateLoadStatus::SUCCESS) {        
             uiInterface.InitMessage(_("Checking ACP ...").translated);
@@ -1486,7 +1717,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                 LogPrintfCategory(BCLog::PRUNE, "pruned datadir may not have more than %d blocks; only checking available blocks\n",
                                   MIN_BLOCKS_TO_KEEP);
             }
-            std::tie(status, error) = catch_exceptions([&]{ return VerifyLoadedChainstate(chainman, options);});
+            std::tie(status, error) = profiler.Time("verify_chainstate", [&]{ return catch_exceptions([&]{ return VerifyLoadedChainstate(chainman, options);}); });
             if (status == node::ChainstateLoadStatus::SUCCESS) {
                 fLoaded = true;
                 LogPrintf(" block index %15dms\n", Ticks<std::chrono::milliseconds>(SteadyClock::now() - load_block_index_start_time));
@@ -1527,12 +1758,36 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     ChainstateManager& chainman = *Assert(node.chainman);
 
+    if (args.GetBoolArg("-utxomuhash", DEFAULT_UTXO_MUHASH)) {
+        uiInterface.InitMessage(_("Computing UTXO set MuHash…").translated);
+        LOCK(cs_main);
+        if (!chainman.ActiveChainstate().InitUTXOMuHash()) {
+            return InitError(_("Error reading the UTXO set to compute its MuHash"));
+        }
+    }
+
+    if (const auto error{load_addrman.get()}) {
+        return InitError(*error);
+    }
+    load_banlist.get();
+
+    assert(!node.connman);
+    node.connman = std::make_unique<CConnman>(GetRand<uint64_t>(),
+                                              GetRand<uint64_t>(),
+                                              *node.addrman, *node.netgroupman, args.GetBoolArg("-networkactive", true));
+
+    g_connman = std::unique_ptr<CConnman>(node.connman.get());
+
     assert(!node.peerman);
+    PeerManager::Options peerman_opts{};
+    ApplyArgsManOptions(args, peerman_opts);
     node.peerman = PeerManager::make(*node.connman, *node.addrman, node.banman.get(),
-                                     chainman, *node.mempool, ignores_incoming_txs);
+                                     chainman, *node.mempool, peerman_opts);
     RegisterValidationInterface(node.peerman.get());
 
     // ********************************************************* Step 8: start indexers
+    StartupProfiler::Timer indexes_timer{profiler, "indexes"};
+    g_index_sync_threads = std::clamp<int64_t>(args.GetIntArg("-indexsyncthreads", DEFAULT_INDEX_SYNC_THREADS), 0, MAX_INDEX_SYNC_THREADS);
     if (args.GetBoolArg("-txindex", DEFAULT_TXINDEX)) {
         if (const auto error{WITH_LOCK(cs_main, return CheckLegacyTxindex(*Assert(chainman.m_blockman.m_block_tree_db)))}) {
             return InitError(*error);
@@ -1558,12 +1813,58 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         }
     }
 
+    if (args.GetBoolArg("-blockstatsindex", DEFAULT_BLOCKSTATSINDEX)) {
+        g_block_stats_index = std::make_unique<BlockStatsIndex>(interfaces::MakeChain(node), /* cache size */ 0, false, fReindex);
+        if (!g_block_stats_index->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+        g_address_index = std::make_unique<AddressIndex>(interfaces::MakeChain(node), cache_sizes.address_index, false, fReindex);
+        if (!g_address_index->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+        g_spent_index = std::make_unique<SpentIndex>(interfaces::MakeChain(node), cache_sizes.spent_index, false, fReindex);
+        if (!g_spent_index->Start()) {
+            return false;
+        }
+    }
+
+    if (args.GetBoolArg("-headersonly", DEFAULT_HEADERS_ONLY)) {
+        g_header_store = std::make_unique<HeaderStore>(gArgs.GetBlocksDirPath() / "headers.dat");
+        if (!g_header_store->Open()) {
+            return InitError(_("Error opening the header store"));
+        }
+        {
+            LOCK(cs_main);
+            if (chainman.m_best_header && !g_header_store->Sync(*chainman.m_best_header)) {
+                return InitError(_("Error writing to the header store"));
+            }
+        }
+        header_store_connection = uiInterface.NotifyHeaderTip_connect([&chainman](SynchronizationState, int64_t, int64_t, bool presync) {
+            if (presync) return;
+            LOCK(cs_main);
+            if (chainman.m_best_header && !g_header_store->Sync(*chainman.m_best_header)) {
+                AbortNode("Failed to write to the header store");
+            }
+        });
+    }
+
+    indexes_timer.Stop();
+
     // ********************************************************* Step 9: load wallet
+    StartupProfiler::Timer load_wallets_timer{profiler, "load_wallets"};
+    node.block_prefetcher = std::make_unique<BlockPrefetcher>(chainman, DEFAULT_BLOCK_PREFETCH_THREADS);
     for (const auto& client : node.chain_clients) {
         if (!client->load()) {
             return false;
         }
     }
+    load_wallets_timer.Stop();
 
     // ********************************************************* Step 10: data directory maintenance
 
@@ -1577,6 +1878,9 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
                 chainstate->PruneAndFlush();
             }
         }
+    } else if (g_header_store) {
+        // Blocks are not stored, only headers are served
+        nLocalServices = ServiceFlags(nLocalServices & ~NODE_NETWORK_LIMITED);
     } else {
         LogPrintf("Setting NODE_NETWORK on non-prune mode\n");
         nLocalServices = ServiceFlags(nLocalServices | NODE_NETWORK);
@@ -1620,9 +1924,12 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         vImportFiles.push_back(fs::PathFromString(strFile));
     }
 
-    chainman.m_load_block = std::thread(&util::TraceThread, "loadblk", [=, &chainman, &args] {
+    chainman.m_load_block = std::thread(&util::TraceThread, "loadblk", [=, &chainman, &args, &profiler] {
+        // Importing blocks and loading the mempool go on after startup is done
+        StartupProfiler::Timer import_timer{profiler, "import", /*parallel=*/true};
         ThreadImport(chainman, vImportFiles, args, ShouldPersistMempool(args) ? MempoolPath(args) : fs::path{});
     });
+    chainman.StartBackgroundValidation();
 
     // Wait for genesis block to be processed
     {
@@ -1640,7 +1947,19 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
         return false;
     }
 
+    // Import headers before peers are asked for them
+    for (const std::string& headers_file : args.GetArgs("-loadheaders")) {
+        StartupProfiler::Timer load_headers_timer{profiler, "load_headers"};
+        const util::Result<size_t> imported{LoadHeadersFile(chainman, fs::PathFromString(headers_file))};
+        if (!imported) return InitError(ErrorString(imported));
+        LogPrintf("Imported %d headers from %s\n", *imported, headers_file);
+    }
+    if (ShutdownRequested()) {
+        return false;
+    }
+
     // ********************************************************* Step 12: start node
+    StartupProfiler::Timer start_node_timer{profiler, "start_node"};
 
     int chain_active_height;
 
@@ -1677,6 +1996,10 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     connOptions.m_msgproc = node.peerman.get();
     connOptions.nSendBufferMaxSize = 1000 * args.GetIntArg("-maxsendbuffer", DEFAULT_MAXSENDBUFFER);
     connOptions.nReceiveFloodSize = 1000 * args.GetIntArg("-maxreceivebuffer", DEFAULT_MAXRECEIVEBUFFER);
+    connOptions.m_message_prepare_threads = args.GetIntArg("-msgpreparethreads", DEFAULT_MESSAGE_PREPARE_THREADS);
+    connOptions.whitelist_forcerelay = args.GetBoolArg("-whitelistforcerelay", DEFAULT_WHITELISTFORCERELAY);
+    connOptions.whitelist_relay = args.GetBoolArg("-whitelistrelay", DEFAULT_WHITELISTRELAY);
+    connOptions.m_capture_messages = args.GetBoolArg("-capturemessages", false);
     connOptions.m_added_nodes = args.GetArgs("-addnode");
     connOptions.nMaxOutboundLimit = *opt_max_upload;
     connOptions.m_peer_connect_timeout = peer_connect_timeout;
@@ -1799,6 +2122,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     if (!node.connman->Start(*node.scheduler, connOptions)) {
         return false;
     }
+    start_node_timer.Stop();
 
     // ********************************************************* Step 13: finished
 
@@ -1811,6 +2135,7 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
     // hash=0x0. This will lead to erroroneous responses for things like
     // waitforblockheight.
     RPCNotifyBlockChange(WITH_LOCK(chainman.GetMutex(), return chainman.ActiveTip()));
+    profiler.Finish();
     SetRPCWarmupFinished();
 
     uiInterface.InitMessage(_("Done loading").translated);
@@ -1826,6 +2151,24 @@ bool AppInitMain(NodeContext& node, interfaces::BlockAndHeaderTipInfo* tip_info)
 
     if (node.peerman) node.peerman->StartScheduledTasks(*node.scheduler);
 
+    if (args.GetBoolArg("-metrics", DEFAULT_METRICS_ENABLE)) {
+        UpdateMemoryUsageSnapshot(node);
+        node.scheduler->scheduleEvery([&node] { UpdateMemoryUsageSnapshot(node); }, MEMORY_USAGE_SNAPSHOT_INTERVAL);
+    }
+
+    if (args.GetBoolArg("-compactdbafteribd", DEFAULT_COMPACT_DB_AFTER_IBD)) {
+        node.scheduler->scheduleEvery([chainman = &chainman] {
+            CCoinsViewDB* coins_db;
+            {
+                LOCK(cs_main);
+                if (chainman->ActiveChainstate().IsInitialBlockDownload()) return;
+                coins_db = &chainman->ActiveChainstate().CoinsDB();
+            }
+            // The block index database is compacted once the chainstate one is done
+            if (!coins_db->CompactNextRange()) chainman->m_blockman.m_block_tree_db->CompactNextRange();
+        }, IDLE_DB_COMPACTION_INTERVAL);
+    }
+
 #if HAVE_SYSTEM
     StartupNotify(args);
 #endif
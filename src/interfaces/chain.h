@@ -5,6 +5,7 @@
 #ifndef BITCOIN_INTERFACES_CHAIN_H
 #define BITCOIN_INTERFACES_CHAIN_H
 
+#include <blockfilter.h>
 #include <primitives/transaction.h> // For CTransactionRef
 #include <util/settings.h>          // For util::SettingsValue
 
@@ -147,6 +148,18 @@ public:
     //! or contents.
     virtual bool findBlock(const uint256& hash, const FoundBlock& block={}) = 0;
 
+    //! Return the contents of a block, or nullptr if the node does not have
+    //! it, reading the up to prefetch blocks after it in the active chain in
+    //! the background, for callers that read them next.
+    virtual std::shared_ptr<const CBlock> readBlockAhead(const uint256& hash, int prefetch) = 0;
+
+    //! Returns whether a block filter index is available.
+    virtual bool hasBlockFilterIndex(BlockFilterType filter_type) = 0;
+
+    //! Returns whether any of the elements match the block via a BIP 157 block filter
+    //! or std::nullopt if the block filter for this block couldn't be found.
+    virtual std::optional<bool> blockFilterMatchesAny(BlockFilterType filter_type, const uint256& block_hash, const GCSFilter::ElementSet& filter_set) = 0;
+
     //! Find first block in the chain with timestamp >= the given time
     //! and height >= than the given height, return false if there is no block
     //! with a high enough timestamp and height. Optionally return block
@@ -202,6 +215,14 @@ public:
         bool relay,
         std::string& err_string) = 0;
 
+    //! Add transactions to the memory pool like broadcastTransaction(), under a
+    //! single lock acquisition and announcing them to peers together. Return
+    //! for each transaction whether it was added, and fill in err_strings.
+    virtual std::vector<bool> broadcastTransactions(const std::vector<CTransactionRef>& txs,
+        const std::vector<CAmount>& max_tx_fees,
+        bool relay,
+        std::vector<std::string>& err_strings) = 0;
+
     //! Calculate mempool ancestor and descendant counts for the given transaction.
     virtual void getTransactionAncestry(const uint256& txid, size_t& ancestors, size_t& descendants, size_t* ancestorsize = nullptr, CAmount* ancestorfees = nullptr) = 0;
 
@@ -271,9 +292,9 @@ public:
     //! Register handler for notifications.
     virtual std::unique_ptr<Handler> handleNotifications(std::shared_ptr<Notifications> notifications) = 0;
 
-    //! Wait for pending notifications to be processed unless block hash points to the current
-    //! chain tip.
-    virtual void waitForNotificationsIfTipChanged(const uint256& old_tip) = 0;
+    //! Wait for the pending notifications of a handler to be processed unless block hash points
+    //! to the current chain tip. The notifications of other handlers are not waited for.
+    virtual void waitForNotificationsIfTipChanged(const uint256& old_tip, const Notifications& notifications) = 0;
 
     //! Register handler for RPC. Command is not copied, so reference
     //! needs to remain valid until Handler is disconnected.
@@ -182,8 +182,10 @@ public:
     //! Get transaction information.
     virtual WalletTx getWalletTx(const uint256& txid) = 0;
 
-    //! Get list of all wallet transactions.
-    virtual std::set<WalletTx> getWalletTxs() = 0;
+    //! Get up to `count` wallet transactions from newer to older: the ones placed before the
+    //! transaction `txid` in the wallet, or the newest ones if `txid` is null. If `txid` was
+    //! removed meanwhile, continue from `order_pos`, the WalletTx::order_pos it had.
+    virtual std::vector<WalletTx> getWalletTxsBefore(const uint256& txid, int64_t order_pos, size_t count) = 0;
 
     //! Try to get updated status for a particular transaction, if possible without blocking.
     virtual bool tryGetTxStatus(const uint256& txid,
@@ -277,6 +279,9 @@ public:
     //! Return whether is a legacy wallet
     virtual bool isLegacy() = 0;
 
+    //! Return the memory used by the transactions of the wallet, in bytes.
+    virtual size_t getMemoryUsage() = 0;
+
     //! Register handler for unload message.
     using UnloadFn = std::function<void()>;
     virtual std::unique_ptr<Handler> handleUnload(UnloadFn fn) = 0;
@@ -395,6 +400,7 @@ struct WalletTx
     int64_t time;
     std::map<std::string, std::string> value_map;
     bool is_coinbase;
+    int64_t order_pos;
 
     bool operator<(const WalletTx& a) const { return tx->GetHash() < a.tx->GetHash(); }
 };
@@ -0,0 +1,91 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_KERNEL_BITCOINKERNEL_H
+#define BITCOIN_KERNEL_BITCOINKERNEL_H
+
+#include <stdint.h>
+
+#if defined(BUILD_BITCOIN_INTERNAL) && defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+  #if defined(_WIN32)
+    #if defined(HAVE_DLLEXPORT_ATTRIBUTE)
+      #define EXPORT_SYMBOL __declspec(dllexport)
+    #else
+      #define EXPORT_SYMBOL
+    #endif
+  #elif defined(HAVE_DEFAULT_VISIBILITY_ATTRIBUTE)
+    #define EXPORT_SYMBOL __attribute__ ((visibility ("default")))
+  #endif
+#elif defined(MSC_VER) && !defined(STATIC_LIBBITCOINKERNEL)
+  #define EXPORT_SYMBOL __declspec(dllimport)
+#endif
+
+#ifndef EXPORT_SYMBOL
+  #define EXPORT_SYMBOL
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BITCOINKERNEL_API_VER 1
+
+typedef enum bitcoinkernel_error_t
+{
+    bitcoinkernel_ERR_OK = 0,
+    bitcoinkernel_ERR_BLOCK_DESERIALIZE,
+    bitcoinkernel_ERR_BLOCK_SIZE_MISMATCH,
+    bitcoinkernel_ERR_SPENT_OUTPUTS_MISMATCH,
+    bitcoinkernel_ERR_INVALID_FLAGS,
+} bitcoinkernel_error;
+
+/**
+ * Verify taproot (BIP341 and BIP342) spends. To be combined with the
+ * bitcoinconsensus_SCRIPT_FLAGS_VERIFY_* flags of bitcoinconsensus.h; it is
+ * only accepted here, as it needs every output a transaction spends.
+ */
+#define bitcoinkernel_SCRIPT_FLAGS_VERIFY_TAPROOT (1U << 17)
+
+/** An output spent by an input of a block. */
+typedef struct bitcoinkernel_spent_output
+{
+    const unsigned char* script_pubkey;
+    unsigned int script_pubkey_len;
+    int64_t amount;
+} bitcoinkernel_spent_output;
+
+/** Worker threads to verify scripts with, see bitcoinkernel_verify_block_scripts. */
+typedef struct bitcoinkernel_script_verifier bitcoinkernel_script_verifier;
+
+/// Start a script verifier with worker_threads threads besides the calling one.
+/// Returns nullptr if the threads cannot be started.
+EXPORT_SYMBOL bitcoinkernel_script_verifier* bitcoinkernel_script_verifier_create(unsigned int worker_threads);
+
+/// Stop the threads of a verifier and free it. No call may be using it.
+EXPORT_SYMBOL void bitcoinkernel_script_verifier_destroy(bitcoinkernel_script_verifier* verifier);
+
+/// Verify the scripts of all inputs of the serialized block pointed to by
+/// block, except the coinbase's, under the script verification flags.
+/// spent_outputs holds the output each of these inputs spends, in the order
+/// of the transactions and of their inputs. The inputs are checked on the
+/// threads of verifier, and results[i] is set to 1 if the input spending
+/// spent_outputs[i] is valid and to 0 if it is not, so results must have room
+/// for spent_outputs_len entries.
+/// Returns 1 if all inputs are valid. Calls with the same verifier run one
+/// after the other.
+/// If not nullptr, err will contain an error/success code for the operation;
+/// results are only set if it is bitcoinkernel_ERR_OK.
+EXPORT_SYMBOL int bitcoinkernel_verify_block_scripts(bitcoinkernel_script_verifier* verifier,
+                                                     const unsigned char* block, unsigned int block_len,
+                                                     const bitcoinkernel_spent_output* spent_outputs, unsigned int spent_outputs_len,
+                                                     unsigned int flags, int* results, bitcoinkernel_error* err);
+
+#ifdef __cplusplus
+} // extern "C"
+#endif
+
+#undef EXPORT_SYMBOL
+
+#endif // BITCOIN_KERNEL_BITCOINKERNEL_H
@@ -0,0 +1,143 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kernel/bitcoinkernel.h>
+
+#include <checkqueue.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <pubkey.h>
+#include <script/bitcoinconsensus.h>
+#include <script/interpreter.h>
+#include <span.h>
+#include <streams.h>
+#include <version.h>
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+static_assert(bitcoinkernel_SCRIPT_FLAGS_VERIFY_TAPROOT == SCRIPT_VERIFY_TAPROOT, "taproot flag must match the interpreter's");
+
+namespace {
+
+/** The verification of one input, which records its result instead of stopping the queue at the first failure. */
+class InputScriptCheck
+{
+private:
+    const CTransaction* m_tx{nullptr};
+    unsigned int m_input{0};
+    const PrecomputedTransactionData* m_txdata{nullptr};
+    unsigned int m_flags{0};
+    int* m_result{nullptr};
+
+public:
+    InputScriptCheck() = default;
+    InputScriptCheck(const CTransaction& tx, unsigned int input, const PrecomputedTransactionData& txdata, unsigned int flags, int* result)
+        : m_tx{&tx}, m_input{input}, m_txdata{&txdata}, m_flags{flags}, m_result{result} {}
+
+    bool operator()()
+    {
+        const CTxIn& txin{m_tx->vin[m_input]};
+        const CTxOut& prevout{m_txdata->m_spent_outputs[m_input]};
+        *m_result = VerifyScript(txin.scriptSig, prevout.scriptPubKey, &txin.scriptWitness, m_flags,
+                                 TransactionSignatureChecker{m_tx, m_input, prevout.nValue, *m_txdata, MissingDataBehavior::FAIL}, nullptr);
+        return true;
+    }
+
+    void swap(InputScriptCheck& check) noexcept
+    {
+        std::swap(m_tx, check.m_tx);
+        std::swap(m_input, check.m_input);
+        std::swap(m_txdata, check.m_txdata);
+        std::swap(m_flags, check.m_flags);
+        std::swap(m_result, check.m_result);
+    }
+};
+
+inline int set_error(bitcoinkernel_error* ret, bitcoinkernel_error serror)
+{
+    if (ret)
+        *ret = serror;
+    return 0;
+}
+} // namespace
+
+struct bitcoinkernel_script_verifier
+{
+    ECCVerifyHandle handle;
+    //! Same batch size as the script check queue of validation
+    CCheckQueue<InputScriptCheck> queue{128};
+
+    ~bitcoinkernel_script_verifier() { queue.StopWorkerThreads(); }
+};
+
+bitcoinkernel_script_verifier* bitcoinkernel_script_verifier_create(unsigned int worker_threads)
+{
+    try {
+        auto verifier{std::make_unique<bitcoinkernel_script_verifier>()};
+        verifier->queue.StartWorkerThreads(worker_threads, "kernelch");
+        return verifier.release();
+    } catch (const std::exception&) {
+        return nullptr;
+    }
+}
+
+void bitcoinkernel_script_verifier_destroy(bitcoinkernel_script_verifier* verifier)
+{
+    delete verifier;
+}
+
+int bitcoinkernel_verify_block_scripts(bitcoinkernel_script_verifier* verifier,
+                                       const unsigned char* block, unsigned int block_len,
+                                       const bitcoinkernel_spent_output* spent_outputs, unsigned int spent_outputs_len,
+                                       unsigned int flags, int* results, bitcoinkernel_error* err)
+{
+    if ((flags & ~(bitcoinconsensus_SCRIPT_FLAGS_VERIFY_ALL | bitcoinkernel_SCRIPT_FLAGS_VERIFY_TAPROOT)) != 0) {
+        return set_error(err, bitcoinkernel_ERR_INVALID_FLAGS);
+    }
+    CBlock cblock;
+    try {
+        SpanReader stream{SER_NETWORK, PROTOCOL_VERSION, Span{block, block_len}};
+        stream >> cblock;
+        if (!stream.empty()) return set_error(err, bitcoinkernel_ERR_BLOCK_SIZE_MISMATCH);
+    } catch (const std::exception&) {
+        return set_error(err, bitcoinkernel_ERR_BLOCK_DESERIALIZE);
+    }
+
+    size_t num_inputs{0};
+    for (size_t i = 1; i < cblock.vtx.size(); ++i) num_inputs += cblock.vtx[i]->vin.size();
+    if (num_inputs != spent_outputs_len) return set_error(err, bitcoinkernel_ERR_SPENT_OUTPUTS_MISMATCH);
+    set_error(err, bitcoinkernel_ERR_OK);
+    if (num_inputs == 0) return 1;
+
+    // The checks point into txdata, which is not resized while it is in use
+    std::vector<PrecomputedTransactionData> txdata(cblock.vtx.size());
+    std::vector<InputScriptCheck> checks;
+    size_t spent_pos{0};
+    {
+        CCheckQueueControl<InputScriptCheck> control(&verifier->queue);
+        for (size_t i = 1; i < cblock.vtx.size(); ++i) {
+            const CTransaction& tx{*cblock.vtx[i]};
+            std::vector<CTxOut> tx_spent_outputs;
+            tx_spent_outputs.reserve(tx.vin.size());
+            for (size_t j = 0; j < tx.vin.size(); ++j) {
+                const bitcoinkernel_spent_output& spent{spent_outputs[spent_pos + j]};
+                tx_spent_outputs.emplace_back(spent.amount, CScript(spent.script_pubkey, spent.script_pubkey + spent.script_pubkey_len));
+            }
+            txdata[i].Init(tx, std::move(tx_spent_outputs), /*force=*/true);
+            for (unsigned int j = 0; j < tx.vin.size(); ++j) {
+                checks.emplace_back(tx, j, txdata[i], flags, &results[spent_pos + j]);
+            }
+            spent_pos += tx.vin.size();
+            // Hand the checks of each transaction over as they are ready, so the workers start early
+            control.Add(checks);
+            checks.clear();
+        }
+        control.Wait();
+    }
+    return std::all_of(results, results + spent_outputs_len, [](int result) { return result == 1; });
+}
@@ -14,6 +14,8 @@ class CChainParams;
 
 namespace kernel {
 
+static constexpr int DEFAULT_BACKGROUND_CACHE_PERCENT{5};
+
 /**
  * An options struct for `ChainstateManager`, more ergonomically referred to as
  * `ChainstateManager::Options` due to the using-declaration in
@@ -22,6 +24,13 @@ namespace kernel {
 struct ChainstateManagerOpts {
     const CChainParams& chainparams;
     const std::function<NodeClock::time_point()> adjusted_time_callback{nullptr};
+    //! If false, the proof of work of new headers and blocks is not checked, to benchmark replaying trusted blocks
+    bool check_pow{true};
+    //! Percentage of the coins caches for the background chainstate of a
+    //! snapshot while the snapshot chainstate is in initial block download
+    int background_cache_percent{DEFAULT_BACKGROUND_CACHE_PERCENT};
+    //! Height of the active chain at which a shutdown is requested, or 0 to never stop (-stopatheight)
+    int stop_at_height{0};
 };
 
 } // namespace kernel
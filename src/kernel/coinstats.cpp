@@ -200,4 +200,75 @@ static void FinalizeHash(MuHash3072& muhash, CCoinsStats& stats)
 }
 static void FinalizeHash(std::nullptr_t, CCoinsStats& stats) {}
 
+SerializedUTXOHasher::SerializedUTXOHasher(const uint256& block_hash)
+{
+    CCoinsStats stats{0, block_hash};
+    PrepareHash(m_hasher, stats);
+}
+
+bool SerializedUTXOHasher::Add(const COutPoint& outpoint, const Coin& coin)
+{
+    if (!m_outputs.empty() && outpoint.hash != m_txid) {
+        ApplyHash(m_hasher, m_txid, m_outputs);
+        m_outputs.clear();
+    }
+    m_txid = outpoint.hash;
+    return m_outputs.emplace(outpoint.n, coin).second;
+}
+
+uint256 SerializedUTXOHasher::Finalize()
+{
+    if (!m_outputs.empty()) {
+        ApplyHash(m_hasher, m_txid, m_outputs);
+        m_outputs.clear();
+    }
+    CCoinsStats stats;
+    FinalizeHash(m_hasher, stats);
+    return stats.hashSerialized;
+}
+
+void UTXOSetMuHash::Insert(const COutPoint& outpoint, const Coin& coin)
+{
+    muhash.Insert(MakeUCharSpan(TxOutSer(outpoint, coin)));
+    ++coins_count;
+    bogo_size += GetBogoSize(coin.out.scriptPubKey);
+    total_amount += coin.out.nValue;
+}
+
+void UTXOSetMuHash::Remove(const COutPoint& outpoint, const Coin& coin)
+{
+    muhash.Remove(MakeUCharSpan(TxOutSer(outpoint, coin)));
+    --coins_count;
+    bogo_size -= GetBogoSize(coin.out.scriptPubKey);
+    total_amount -= coin.out.nValue;
+}
+
+UTXOSetMuHash& UTXOSetMuHash::operator+=(const UTXOSetMuHash& delta)
+{
+    muhash *= delta.muhash;
+    coins_count += delta.coins_count;
+    bogo_size += delta.bogo_size;
+    total_amount += delta.total_amount;
+    return *this;
+}
+
+std::optional<UTXOSetMuHash> ComputeUTXOSetMuHash(CCoinsView* view, const std::function<void()>& interruption_point)
+{
+    std::unique_ptr<CCoinsViewCursor> pcursor(view->Cursor());
+    assert(pcursor);
+
+    UTXOSetMuHash result;
+    for (; pcursor->Valid(); pcursor->Next()) {
+        if (interruption_point) interruption_point();
+        COutPoint key;
+        Coin coin;
+        if (!pcursor->GetKey(key) || !pcursor->GetValue(coin)) {
+            error("%s: unable to read value", __func__);
+            return std::nullopt;
+        }
+        result.Insert(key, coin);
+    }
+    return result;
+}
+
 } // namespace kernel
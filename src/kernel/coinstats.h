@@ -5,17 +5,20 @@
 #ifndef BITCOIN_KERNEL_COINSTATS_H
 #define BITCOIN_KERNEL_COINSTATS_H
 
+#include <coins.h>
 #include <consensus/amount.h>
+#include <crypto/muhash.h>
+#include <hash.h>
+#include <serialize.h>
 #include <streams.h>
 #include <uint256.h>
 
 #include <cstdint>
 #include <functional>
+#include <map>
 #include <optional>
 
 class CCoinsView;
-class Coin;
-class COutPoint;
 class CScript;
 namespace node {
 class BlockManager;
@@ -74,6 +77,51 @@ uint64_t GetBogoSize(const CScript& script_pub_key);
 
 CDataStream TxOutSer(const COutPoint& outpoint, const Coin& coin);
 
+/**
+ * Computes the HASH_SERIALIZED commitment of a UTXO set from its coins in
+ * database order, e.g. as they are read from a UTXO snapshot, so that the
+ * set does not have to be read back from the database to be checked.
+ */
+class SerializedUTXOHasher
+{
+    HashWriter m_hasher{};
+    uint256 m_txid{};
+    //! Outputs of m_txid added since the last transaction was hashed
+    std::map<uint32_t, Coin> m_outputs{};
+
+public:
+    explicit SerializedUTXOHasher(const uint256& block_hash);
+
+    /**
+     * Add the next coin. Returns false if the outpoint was already added as
+     * part of the same transaction, which hashing cannot tell apart.
+     */
+    [[nodiscard]] bool Add(const COutPoint& outpoint, const Coin& coin);
+
+    uint256 Finalize();
+};
+
+/**
+ * MuHash and totals of a UTXO set, kept up to date as blocks are connected
+ * and disconnected (see -utxomuhash), so they are known without a scan of
+ * the set. A delta of a block is built the same way and added with +=.
+ */
+struct UTXOSetMuHash {
+    MuHash3072 muhash{};
+    uint64_t coins_count{0};
+    uint64_t bogo_size{0};
+    CAmount total_amount{0};
+
+    void Insert(const COutPoint& outpoint, const Coin& coin);
+    void Remove(const COutPoint& outpoint, const Coin& coin);
+    UTXOSetMuHash& operator+=(const UTXOSetMuHash& delta);
+
+    SERIALIZE_METHODS(UTXOSetMuHash, obj) { READWRITE(obj.muhash, obj.coins_count, obj.bogo_size, obj.total_amount); }
+};
+
+/** Compute the UTXOSetMuHash of all coins in view. */
+std::optional<UTXOSetMuHash> ComputeUTXOSetMuHash(CCoinsView* view, const std::function<void()>& interruption_point = {});
+
 std::optional<CCoinsStats> ComputeUTXOStats(CoinStatsHashType hash_type, CCoinsView* view, node::BlockManager& blockman, const std::function<void()>& interruption_point = {});
 } // namespace kernel
 
@@ -4,6 +4,8 @@
 
 #include <kernel/context.h>
 
+#include <crypto/chacha20.h>
+#include <crypto/neoscrypt_multiway.h>
 #include <crypto/sha256.h>
 #include <key.h>
 #include <logging.h>
@@ -19,6 +21,10 @@ Context::Context()
 {
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    std::string neoscrypt_algo = NeoScryptAutoDetect();
+    LogPrintf("Using the '%s' multi-buffer NeoScrypt implementation\n", neoscrypt_algo);
+    std::string chacha20_algo = ChaCha20AutoDetect();
+    LogPrintf("Using the '%s' multi-block ChaCha20 implementation\n", chacha20_algo);
     RandomInit();
     ECC_Start();
     ecc_verify_handle.reset(new ECCVerifyHandle());
@@ -22,6 +22,10 @@ static constexpr unsigned int DEFAULT_MAX_MEMPOOL_SIZE_MB{300};
 static constexpr unsigned int DEFAULT_MEMPOOL_EXPIRY_HOURS{336};
 /** Default for -mempoolfullrbf, if the transaction replaceability signaling is ignored */
 static constexpr bool DEFAULT_MEMPOOL_FULL_RBF{false};
+/** Default for -clustermempool, if mining and eviction use linearized cluster chunks */
+static constexpr bool DEFAULT_CLUSTER_MEMPOOL{false};
+/** Default for -mempooldeltaevents, how many additions and removals getmempooldelta can report */
+static constexpr unsigned int DEFAULT_MEMPOOL_DELTA_EVENTS{100'000};
 
 namespace kernel {
 /**
@@ -53,6 +57,10 @@ struct MemPoolOptions {
     bool permit_bare_multisig{DEFAULT_PERMIT_BAREMULTISIG};
     bool require_standard{true};
     bool full_rbf{DEFAULT_MEMPOOL_FULL_RBF};
+    /** Mine and evict the chunks of linearized clusters instead of ancestor and descendant packages */
+    bool cluster_mode{DEFAULT_CLUSTER_MEMPOOL};
+    /** How many of the latest additions and removals are kept for getmempooldelta */
+    size_t max_delta_events{DEFAULT_MEMPOOL_DELTA_EVENTS};
     MemPoolLimits limits{};
 };
 } // namespace kernel
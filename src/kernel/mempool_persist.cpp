@@ -37,6 +37,9 @@ namespace kernel {
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
 
+/** Number of transactions whose scripts are verified together while loading */
+static constexpr size_t MEMPOOL_LOAD_BATCH_SIZE{1000};
+
 bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active_chainstate, FopenFn mockable_fopen_function)
 {
     if (load_path.empty()) return false;
@@ -64,21 +67,40 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
         uint64_t num;
         file >> num;
         while (num) {
-            --num;
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
-            if (amountdelta) {
-                pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+            // Read a batch of transactions and verify their scripts in parallel.
+            // Then submit them in the order they were dumped in, which puts
+            // parents before their children.
+            std::vector<CTransactionRef> txs;
+            std::vector<int64_t> times;
+            while (num && txs.size() < MEMPOOL_LOAD_BATCH_SIZE) {
+                --num;
+                CTransactionRef tx;
+                int64_t nTime;
+                int64_t nFeeDelta;
+                file >> tx;
+                file >> nTime;
+                file >> nFeeDelta;
+
+                CAmount amountdelta = nFeeDelta;
+                if (amountdelta) {
+                    pool.PrioritiseTransaction(tx->GetHash(), amountdelta);
+                }
+                if (nTime > TicksSinceEpoch<std::chrono::seconds>(now - pool.m_expiry)) {
+                    txs.push_back(std::move(tx));
+                    times.push_back(nTime);
+                } else {
+                    ++expired;
+                }
             }
-            if (nTime > TicksSinceEpoch<std::chrono::seconds>(now - pool.m_expiry)) {
-                LOCK(cs_main);
-                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, nTime, /*bypass_limits=*/false, /*test_accept=*/false);
+            if (ShutdownRequested())
+                return false;
+
+            PrevalidateTransactionScripts(active_chainstate, txs);
+
+            LOCK(cs_main);
+            for (size_t i = 0; i < txs.size(); ++i) {
+                const CTransactionRef& tx = txs[i];
+                const auto& accepted = AcceptToMemoryPool(active_chainstate, tx, times[i], /*bypass_limits=*/false, /*test_accept=*/false);
                 if (accepted.m_result_type == MempoolAcceptResult::ResultType::VALID) {
                     ++count;
                 } else {
@@ -92,11 +114,9 @@ bool LoadMempool(CTxMemPool& pool, const fs::path& load_path, Chainstate& active
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
+                if (ShutdownRequested())
+                    return false;
             }
-            if (ShutdownRequested())
-                return false;
         }
         std::map<uint256, CAmount> mapDeltas;
         file >> mapDeltas;
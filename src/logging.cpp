@@ -6,11 +6,13 @@
 #include <fs.h>
 #include <logging.h>
 #include <util/string.h>
+#include <util/thread.h>
 #include <util/threadnames.h>
 #include <util/time.h>
 
 #include <algorithm>
 #include <array>
+#include <cstring>
 #include <mutex>
 #include <optional>
 
@@ -81,11 +83,59 @@ bool BCLog::Logger::StartLogging()
     }
     if (m_print_to_console) fflush(stdout);
 
+    if (m_log_async) {
+        if (!m_queue) {
+            m_queue = std::make_unique<LogRecord[]>(LOG_QUEUE_SIZE);
+            for (size_t i = 0; i < LOG_QUEUE_SIZE; ++i) m_queue[i].seq = i;
+        }
+        m_writer_stop = false;
+        m_writer_running = true;
+        m_queue_active = m_print_callbacks.empty();
+        m_writer = std::thread(&util::TraceThread, "logger", [this] { ThreadWriter(); });
+    }
+
     return true;
 }
 
+void BCLog::Logger::StopWriter()
+{
+    if (!m_writer.joinable()) return;
+    {
+        StdLockGuard scoped_lock(m_cs);
+        m_queue_active = false;
+        m_writer_running = false;
+    }
+    {
+        std::lock_guard<std::mutex> lock{m_writer_mutex};
+        m_writer_stop = true;
+    }
+    m_writer_cv.notify_one();
+    m_writer.join();
+
+    StdLockGuard scoped_lock(m_cs);
+    while (DrainQueue() > 0) {}
+}
+
+std::list<std::function<void(const std::string&)>>::iterator BCLog::Logger::PushBackCallback(std::function<void(const std::string&)> fun)
+{
+    StdLockGuard scoped_lock(m_cs);
+    // Write what is queued first, so the callback only sees later messages
+    m_queue_active = false;
+    if (m_queue) while (DrainQueue() > 0) {}
+    m_print_callbacks.push_back(std::move(fun));
+    return --m_print_callbacks.end();
+}
+
+void BCLog::Logger::DeleteCallback(std::list<std::function<void(const std::string&)>>::iterator it)
+{
+    StdLockGuard scoped_lock(m_cs);
+    m_print_callbacks.erase(it);
+    m_queue_active = m_writer_running && m_print_callbacks.empty();
+}
+
 void BCLog::Logger::DisconnectTestLogger()
 {
+    StopWriter();
     StdLockGuard scoped_lock(m_cs);
     m_buffering = true;
     if (m_fileout != nullptr) fclose(m_fileout);
@@ -132,6 +182,7 @@ bool BCLog::Logger::WillLogCategoryLevel(BCLog::LogFlags category, BCLog::Level
 
     if (!WillLogCategory(category)) return false;
 
+    if ((m_categories_with_level.load(std::memory_order_relaxed) & category) == 0) return level >= LogLevel();
     StdLockGuard scoped_lock(m_cs);
     const auto it{m_category_log_levels.find(category)};
     return level >= (it == m_category_log_levels.end() ? LogLevel() : it->second);
@@ -180,6 +231,8 @@ const CLogCategoryDesc LogCategories[] =
 #endif
     {BCLog::UTIL, "util"},
     {BCLog::BLOCKSTORE, "blockstorage"},
+    {BCLog::SCAN, "scan"},
+    {BCLog::TXRECONCILIATION, "txreconciliation"},
     {BCLog::ALL, "1"},
     {BCLog::ALL, "all"},
 };
@@ -280,6 +333,10 @@ std::string LogCategoryToStr(BCLog::LogFlags category)
         return "util";
     case BCLog::LogFlags::BLOCKSTORE:
         return "blockstorage";
+    case BCLog::LogFlags::SCAN:
+        return "scan";
+    case BCLog::LogFlags::TXRECONCILIATION:
+        return "txreconciliation";
     case BCLog::LogFlags::ALL:
         return "all";
     }
@@ -335,7 +392,7 @@ std::string BCLog::Logger::LogLevelsString() const
     return Join(std::vector<BCLog::Level>{levels.begin(), levels.end()}, ", ", [this](BCLog::Level level) { return LogLevelToStr(level); });
 }
 
-std::string BCLog::Logger::LogTimestampStr(const std::string& str)
+std::string BCLog::Logger::LogTimestampStr(const std::string& str, int64_t time_micros, std::chrono::seconds mocktime)
 {
     std::string strStamped;
 
@@ -343,13 +400,12 @@ std::string BCLog::Logger::LogTimestampStr(const std::string& str)
         return str;
 
     if (m_started_new_line) {
-        int64_t nTimeMicros = GetTimeMicros();
+        int64_t nTimeMicros = time_micros;
         strStamped = FormatISO8601DateTime(nTimeMicros/1000000);
         if (m_log_time_micros) {
             strStamped.pop_back();
             strStamped += strprintf(".%06dZ", nTimeMicros%1000000);
         }
-        std::chrono::seconds mocktime = GetMockTime();
         if (mocktime > 0s) {
             strStamped += " (mocktime: " + FormatISO8601DateTime(count_seconds(mocktime)) + ")";
         }
@@ -382,9 +438,9 @@ namespace BCLog {
     }
 } // namespace BCLog
 
-void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level)
+std::string BCLog::Logger::FormatLogStr(const std::string& str, std::string_view source_location, std::string_view threadname,
+                                       LogFlags category, Level level, int64_t time_micros, std::chrono::seconds mocktime)
 {
-    StdLockGuard scoped_lock(m_cs);
     std::string str_prefixed = LogEscapeMessage(str);
 
     if ((category != LogFlags::NONE || level != Level::None) && m_started_new_line) {
@@ -407,32 +463,29 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
         str_prefixed.insert(0, s);
     }
 
-    if (m_log_sourcelocations && m_started_new_line) {
-        str_prefixed.insert(0, "[" + RemovePrefix(source_file, "./") + ":" + ToString(source_line) + "] [" + logging_function + "] ");
+    if (!source_location.empty() && m_started_new_line) {
+        str_prefixed.insert(0, source_location);
     }
 
     if (m_log_threadnames && m_started_new_line) {
-        const auto& threadname = util::ThreadGetInternalName();
-        str_prefixed.insert(0, "[" + (threadname.empty() ? "unknown" : threadname) + "] ");
+        str_prefixed.insert(0, "[" + (threadname.empty() ? std::string{"unknown"} : std::string{threadname}) + "] ");
     }
 
-    str_prefixed = LogTimestampStr(str_prefixed);
+    str_prefixed = LogTimestampStr(str_prefixed, time_micros, mocktime);
 
     m_started_new_line = !str.empty() && str[str.size()-1] == '\n';
 
-    if (m_buffering) {
-        // buffer if we haven't started logging yet
-        m_msgs_before_open.push_back(str_prefixed);
-        return;
-    }
+    return str_prefixed;
+}
 
+void BCLog::Logger::WriteLogStr(const std::string& str)
+{
     if (m_print_to_console) {
         // print to console
-        fwrite(str_prefixed.data(), 1, str_prefixed.size(), stdout);
-        fflush(stdout);
+        fwrite(str.data(), 1, str.size(), stdout);
     }
     for (const auto& cb : m_print_callbacks) {
-        cb(str_prefixed);
+        cb(str);
     }
     if (m_print_to_file) {
         assert(m_fileout != nullptr);
@@ -447,8 +500,143 @@ void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& loggi
                 m_fileout = new_fileout;
             }
         }
-        FileWriteStr(str_prefixed, m_fileout);
+        FileWriteStr(str, m_fileout);
+    }
+}
+
+void BCLog::Logger::PushRecord(const std::string& str, const std::string& source_location, LogFlags category, Level level)
+{
+    // Reserve a slot, a bounded MPSC queue where the sequence of a slot tells
+    // whether it is free for the position a caller wants to fill
+    uint64_t pos{m_queue_push.load(std::memory_order_relaxed)};
+    LogRecord* record;
+    while (true) {
+        record = &m_queue[pos % LOG_QUEUE_SIZE];
+        const uint64_t seq{record->seq.load(std::memory_order_acquire)};
+        if (seq == pos) {
+            if (m_queue_push.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (seq < pos) {
+            // The writer has not freed the slot from the previous round
+            ++m_dropped;
+            return;
+        } else {
+            pos = m_queue_push.load(std::memory_order_relaxed);
+        }
+    }
+
+    record->time_micros = GetTimeMicros();
+    record->mocktime = GetMockTime();
+    record->category = category;
+    record->level = level;
+    record->threadname_size = 0;
+    if (m_log_threadnames) {
+        const std::string& threadname{util::ThreadGetInternalName()};
+        record->threadname_size = std::min(threadname.size(), record->threadname.size());
+        std::memcpy(record->threadname.data(), threadname.data(), record->threadname_size);
+    }
+    record->source_size = source_location.size();
+    record->size = source_location.size() + str.size();
+    if (record->size <= LOG_RECORD_TEXT_SIZE) {
+        std::memcpy(record->text.data(), source_location.data(), source_location.size());
+        std::memcpy(record->text.data() + source_location.size(), str.data(), str.size());
+    } else {
+        record->overflow = source_location + str;
+    }
+    record->seq.store(pos + 1);
+
+    if (m_writer_idle.load()) {
+        // Taking the mutex orders this with the writer going to sleep
+        { std::lock_guard<std::mutex> lock{m_writer_mutex}; }
+        m_writer_cv.notify_one();
+    }
+}
+
+size_t BCLog::Logger::DrainQueue()
+{
+    // Write the messages together, one write per batch
+    std::string batch;
+    size_t count{0};
+    while (count < LOG_QUEUE_SIZE) {
+        LogRecord& record{m_queue[m_queue_pop % LOG_QUEUE_SIZE]};
+        if (record.seq.load(std::memory_order_acquire) != m_queue_pop + 1) break;
+
+        std::string text;
+        if (record.size <= LOG_RECORD_TEXT_SIZE) {
+            text.assign(record.text.data(), record.size);
+        } else {
+            text = std::move(record.overflow);
+            record.overflow.clear();
+        }
+        const std::string threadname{record.threadname.data(), record.threadname_size};
+        const std::string str_prefixed{FormatLogStr(text.substr(record.source_size), std::string_view{text}.substr(0, record.source_size),
+                                                    threadname, record.category, record.level, record.time_micros, record.mocktime)};
+        record.seq.store(m_queue_pop + LOG_QUEUE_SIZE, std::memory_order_release);
+        ++m_queue_pop;
+
+        batch += str_prefixed;
+        ++count;
+    }
+
+    const uint64_t dropped{m_dropped.load()};
+    if (dropped != m_dropped_reported && m_started_new_line) {
+        batch += FormatLogStr(strprintf("%u log messages were dropped because the logger fell behind\n", dropped - m_dropped_reported),
+                              {}, util::ThreadGetInternalName(), LogFlags::NONE, Level::Warning, GetTimeMicros(), GetMockTime());
+        m_dropped_reported = dropped;
+    }
+    if (!batch.empty()) {
+        WriteLogStr(batch);
+        if (m_print_to_console) fflush(stdout);
+    }
+    return count;
+}
+
+void BCLog::Logger::ThreadWriter()
+{
+    while (true) {
+        size_t written;
+        {
+            StdLockGuard scoped_lock(m_cs);
+            written = DrainQueue();
+        }
+        if (written > 0) continue;
+
+        std::unique_lock<std::mutex> lock{m_writer_mutex};
+        if (m_writer_stop) break;
+        m_writer_idle = true;
+        // Check again once callers see the writer idle, so that no message waits for the timeout
+        bool ready;
+        {
+            StdLockGuard scoped_lock(m_cs);
+            ready = m_queue[m_queue_pop % LOG_QUEUE_SIZE].seq.load() == m_queue_pop + 1;
+        }
+        if (!ready) m_writer_cv.wait_for(lock, std::chrono::milliseconds{100});
+        m_writer_idle = false;
+    }
+}
+
+void BCLog::Logger::LogPrintStr(const std::string& str, const std::string& logging_function, const std::string& source_file, int source_line, BCLog::LogFlags category, BCLog::Level level)
+{
+    std::string source_location;
+    if (m_log_sourcelocations) {
+        source_location = "[" + RemovePrefix(source_file, "./") + ":" + ToString(source_line) + "] [" + logging_function + "] ";
     }
+
+    if (m_queue_active.load(std::memory_order_relaxed)) {
+        PushRecord(str, source_location, category, level);
+        return;
+    }
+
+    StdLockGuard scoped_lock(m_cs);
+    std::string str_prefixed = FormatLogStr(str, source_location, util::ThreadGetInternalName(), category, level, GetTimeMicros(), GetMockTime());
+
+    if (m_buffering) {
+        // buffer if we haven't started logging yet
+        m_msgs_before_open.push_back(str_prefixed);
+        return;
+    }
+
+    WriteLogStr(str_prefixed);
+    if (m_print_to_console) fflush(stdout);
 }
 
 void BCLog::Logger::ShrinkDebugFile()
@@ -510,5 +698,6 @@ bool BCLog::Logger::SetCategoryLogLevel(const std::string& category_str, const s
 
     StdLockGuard scoped_lock(m_cs);
     m_category_log_levels[flag] = level.value();
+    m_categories_with_level |= flag;
     return true;
 }
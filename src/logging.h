@@ -11,12 +11,18 @@
 #include <tinyformat.h>
 #include <util/string.h>
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
 #include <list>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <vector>
 
@@ -25,6 +31,7 @@ static const bool DEFAULT_LOGIPS        = false;
 static const bool DEFAULT_LOGTIMESTAMPS = true;
 static const bool DEFAULT_LOGTHREADNAMES = false;
 static const bool DEFAULT_LOGSOURCELOCATIONS = false;
+static const bool DEFAULT_LOGASYNC = true;
 extern const char * const DEFAULT_DEBUGLOGFILE;
 
 extern bool fLogIPs;
@@ -66,6 +73,8 @@ namespace BCLog {
 #endif
         UTIL        = (1 << 25),
         BLOCKSTORE  = (1 << 26),
+        SCAN        = (1 << 27),
+        TXRECONCILIATION = (1 << 28),
         ALL         = ~(uint32_t)0,
     };
     enum class Level {
@@ -78,6 +87,29 @@ namespace BCLog {
     };
     constexpr auto DEFAULT_LOG_LEVEL{Level::Debug};
 
+    //! Number of messages the asynchronous writer holds before it drops new ones
+    static constexpr size_t LOG_QUEUE_SIZE{4096};
+    //! Bytes of a queued message that are copied without allocating
+    static constexpr size_t LOG_RECORD_TEXT_SIZE{256};
+
+    /** A message waiting for the asynchronous writer, with what is needed to prefix it later. */
+    struct LogRecord {
+        //! Position in the queue this slot is free for, or one past it once filled
+        std::atomic<uint64_t> seq{0};
+        int64_t time_micros;
+        std::chrono::seconds mocktime;
+        LogFlags category;
+        Level level;
+        //! Source location prefix at the start of the text, if any
+        uint32_t source_size;
+        uint32_t size;
+        uint32_t threadname_size;
+        std::array<char, 32> threadname;
+        std::array<char, LOG_RECORD_TEXT_SIZE> text;
+        //! The text of a message longer than LOG_RECORD_TEXT_SIZE
+        std::string overflow;
+    };
+
     class Logger
     {
     private:
@@ -104,11 +136,43 @@ namespace BCLog {
         /** Log categories bitfield. */
         std::atomic<uint32_t> m_categories{0};
 
-        std::string LogTimestampStr(const std::string& str);
+        /** Bitfield of the categories with an entry in m_category_log_levels. */
+        std::atomic<uint32_t> m_categories_with_level{0};
+
+        std::string LogTimestampStr(const std::string& str, int64_t time_micros, std::chrono::seconds mocktime) EXCLUSIVE_LOCKS_REQUIRED(m_cs);
 
         /** Slots that connect to the print signal */
         std::list<std::function<void(const std::string&)>> m_print_callbacks GUARDED_BY(m_cs) {};
 
+        /**
+         * Ring buffer of the messages for the writer thread. Callers reserve a
+         * slot without locking and only copy their message into it; prefixing
+         * and writing happens on the writer thread. When the writer falls
+         * behind, new messages are dropped and counted.
+         */
+        std::unique_ptr<LogRecord[]> m_queue;
+        std::atomic<uint64_t> m_queue_push{0};
+        uint64_t m_queue_pop GUARDED_BY(m_cs){0};
+        std::atomic<uint64_t> m_dropped{0};
+        uint64_t m_dropped_reported GUARDED_BY(m_cs){0};
+        //! Whether the writer thread runs
+        bool m_writer_running GUARDED_BY(m_cs){false};
+        //! Set while messages go through the queue: the writer runs and no print callback is connected
+        std::atomic<bool> m_queue_active{false};
+        std::thread m_writer;
+        std::mutex m_writer_mutex;
+        std::condition_variable m_writer_cv;
+        std::atomic<bool> m_writer_stop{false};
+        std::atomic<bool> m_writer_idle{false};
+
+        std::string FormatLogStr(const std::string& str, std::string_view source_location, std::string_view threadname,
+                                 LogFlags category, Level level, int64_t time_micros, std::chrono::seconds mocktime) EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        void WriteLogStr(const std::string& str) EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        void PushRecord(const std::string& str, const std::string& source_location, LogFlags category, Level level);
+        /** Write the filled slots at the head of the queue, at most a bounded number. Returns how many. */
+        size_t DrainQueue() EXCLUSIVE_LOCKS_REQUIRED(m_cs);
+        void ThreadWriter();
+
     public:
         bool m_print_to_console = false;
         bool m_print_to_file = false;
@@ -117,6 +181,8 @@ namespace BCLog {
         bool m_log_time_micros = DEFAULT_LOGTIMEMICROS;
         bool m_log_threadnames = DEFAULT_LOGTHREADNAMES;
         bool m_log_sourcelocations = DEFAULT_LOGSOURCELOCATIONS;
+        //! Write from a background thread once logging is started
+        bool m_log_async = false;
 
         fs::path m_file_path;
         std::atomic<bool> m_reopen_file{false};
@@ -127,27 +193,25 @@ namespace BCLog {
         /** Returns whether logs will be written to any output */
         bool Enabled() const
         {
+            if (m_queue_active.load(std::memory_order_relaxed)) return true;
             StdLockGuard scoped_lock(m_cs);
             return m_buffering || m_print_to_console || m_print_to_file || !m_print_callbacks.empty();
         }
 
-        /** Connect a slot to the print signal and return the connection */
-        std::list<std::function<void(const std::string&)>>::iterator PushBackCallback(std::function<void(const std::string&)> fun)
-        {
-            StdLockGuard scoped_lock(m_cs);
-            m_print_callbacks.push_back(std::move(fun));
-            return --m_print_callbacks.end();
-        }
+        /** Connect a slot to the print signal and return the connection. Callbacks
+         * see messages as they are logged, so the writer thread is bypassed while
+         * any is connected. */
+        std::list<std::function<void(const std::string&)>>::iterator PushBackCallback(std::function<void(const std::string&)> fun);
 
         /** Delete a connection */
-        void DeleteCallback(std::list<std::function<void(const std::string&)>>::iterator it)
-        {
-            StdLockGuard scoped_lock(m_cs);
-            m_print_callbacks.erase(it);
-        }
+        void DeleteCallback(std::list<std::function<void(const std::string&)>>::iterator it);
 
         /** Start logging (and flush all buffered messages) */
         bool StartLogging();
+        /** Write the queued messages and stop the writer thread, if any */
+        void StopWriter();
+        /** Number of messages dropped because the writer thread fell behind */
+        uint64_t DroppedMessages() const { return m_dropped.load(); }
         /** Only for testing */
         void DisconnectTestLogger();
 
@@ -162,6 +226,9 @@ namespace BCLog {
         {
             StdLockGuard scoped_lock(m_cs);
             m_category_log_levels = levels;
+            uint32_t categories{0};
+            for (const auto& [category, level] : levels) categories |= category;
+            m_categories_with_level = categories;
         }
         bool SetCategoryLogLevel(const std::string& category_str, const std::string& level_str);
 
@@ -54,6 +54,17 @@ CMerkleBlock::CMerkleBlock(const CBlock& block, CBloomFilter* filter, const std:
     txn = CPartialMerkleTree(vHashes, vMatch);
 }
 
+CMerkleBlock::CMerkleBlock(const CBlockHeader& block_header, const std::vector<uint256>& block_txids, const std::set<uint256>& match)
+    : header{block_header}
+{
+    std::vector<bool> vMatch;
+    vMatch.reserve(block_txids.size());
+    for (const uint256& txid : block_txids) {
+        vMatch.push_back(match.count(txid) > 0);
+    }
+    txn = CPartialMerkleTree(block_txids, vMatch);
+}
+
 uint256 CPartialMerkleTree::CalcHash(int height, unsigned int pos, const std::vector<uint256> &vTxid) {
     //we can never have zero txs in a merkle block, we always need the coinbase tx
     //if we do not have this assert, we can hit a memory access violation when indexing into vTxid
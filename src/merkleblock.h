@@ -146,6 +146,9 @@ public:
     // Create from a CBlock, matching the txids in the set
     CMerkleBlock(const CBlock& block, const std::set<uint256>& txids) : CMerkleBlock(block, nullptr, &txids) { }
 
+    // Create from the header and the txids of a block, matching the txids in the set
+    CMerkleBlock(const CBlockHeader& block_header, const std::vector<uint256>& block_txids, const std::set<uint256>& match);
+
     CMerkleBlock() {}
 
     SERIALIZE_METHODS(CMerkleBlock, obj) { READWRITE(obj.header, obj.txn); }
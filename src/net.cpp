@@ -28,9 +28,11 @@
 #include <scheduler.h>
 #include <util/sock.h>
 #include <util/strencodings.h>
+#include <util/metrics.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
 #include <util/thread.h>
+#include <util/threadnames.h>
 #include <util/trace.h>
 #include <util/translation.h>
 
@@ -52,6 +54,8 @@
 #include <array>
 #include <cstdint>
 #include <functional>
+#include <future>
+#include <list>
 #include <optional>
 #include <unordered_map>
 
@@ -106,6 +110,50 @@ static const uint64_t SELECT_TIMEOUT_MILLISECONDS = 50;
 
 const std::string NET_MESSAGE_TYPE_OTHER = "*other*";
 
+namespace {
+/** Bytes sent and received per message type by all peers. The map is not
+ *  modified after construction, so the counters are updated without locking. */
+class MsgTypeBytes
+{
+    std::unordered_map<std::string, std::pair<MetricCounter, MetricCounter>> m_bytes;
+
+public:
+    MsgTypeBytes()
+    {
+        for (const std::string& msg_type : getAllNetMessageTypes()) m_bytes[msg_type];
+        m_bytes[NET_MESSAGE_TYPE_OTHER];
+    }
+
+    void Add(const std::string& msg_type, bool recv, uint64_t bytes)
+    {
+        auto it{m_bytes.find(msg_type)};
+        if (it == m_bytes.end()) it = m_bytes.find(NET_MESSAGE_TYPE_OTHER);
+        (recv ? it->second.second : it->second.first).Add(bytes);
+    }
+
+    std::vector<NetMsgTypeBytes> Get() const
+    {
+        std::vector<NetMsgTypeBytes> result;
+        for (const auto& [msg_type, counters] : m_bytes) {
+            result.push_back({msg_type, counters.first.Value(), counters.second.Value()});
+        }
+        std::sort(result.begin(), result.end(), [](const auto& a, const auto& b) { return a.msg_type < b.msg_type; });
+        return result;
+    }
+};
+
+MsgTypeBytes& TotalBytesPerMsgType()
+{
+    static MsgTypeBytes bytes;
+    return bytes;
+}
+} // namespace
+
+std::vector<NetMsgTypeBytes> GetTotalBytesPerMsgType()
+{
+    return TotalBytesPerMsgType().Get();
+}
+
 static const uint64_t RANDOMIZER_ID_NETGROUP = 0x6c0edd8036ef4036ULL; // SHA256("netgroup")[0:8]
 static const uint64_t RANDOMIZER_ID_LOCALHOSTNONCE = 0xd93e69e2bbfa5735ULL; // SHA256("localhostnonce")[0:8]
 static const uint64_t RANDOMIZER_ID_ADDRCACHE = 0x1cf2e4ddd306dda9ULL; // SHA256("addrcache")[0:8]
@@ -496,7 +544,10 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
             if (m_i2p_sam_session) {
                 connected = m_i2p_sam_session->Connect(addrConnect, conn, proxyConnectionFailed);
             } else {
-                i2p_transient_session = std::make_unique<i2p::sam::Session>(proxy.proxy, &interruptNet);
+                i2p_transient_session = TakeI2PTransientSession();
+                if (!i2p_transient_session) {
+                    i2p_transient_session = std::make_unique<i2p::sam::Session>(proxy.proxy, &interruptNet);
+                }
                 connected = i2p_transient_session->Connect(addrConnect, conn, proxyConnectionFailed);
             }
 
@@ -556,7 +607,10 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
                              pszDest ? pszDest : "",
                              conn_type,
                              /*inbound_onion=*/false,
-                             CNodeOptions{ .i2p_sam_session = std::move(i2p_transient_session) });
+                             CNodeOptions{
+                               .i2p_sam_session = std::move(i2p_transient_session),
+                               .recv_buffer_pool = &m_recv_buffer_pool,
+                             });
     pnode->AddRef();
 
     // We're making a new connection, harvest entropy from the time (and our peer count)
@@ -631,6 +685,7 @@ void CNode::CopyStats(CNodeStats& stats)
         LOCK(cs_vSend);
         X(mapSendBytesPerMsgType);
         X(nSendBytes);
+        X(m_send_queue_stats);
     }
     {
         LOCK(cs_vRecv);
@@ -673,6 +728,7 @@ bool CNode::ReceiveMsgBytes(Span<const uint8_t> msg_bytes, bool& complete)
                 // Message deserialization failed. Drop the message but don't disconnect the peer.
                 // store the size of the corrupt message
                 mapRecvBytesPerMsgType.at(NET_MESSAGE_TYPE_OTHER) += msg.m_raw_message_size;
+                TotalBytesPerMsgType().Add(NET_MESSAGE_TYPE_OTHER, /*recv=*/true, msg.m_raw_message_size);
                 continue;
             }
 
@@ -684,6 +740,7 @@ bool CNode::ReceiveMsgBytes(Span<const uint8_t> msg_bytes, bool& complete)
             }
             assert(i != mapRecvBytesPerMsgType.end());
             i->second += msg.m_raw_message_size;
+            TotalBytesPerMsgType().Add(msg.m_type, /*recv=*/true, msg.m_raw_message_size);
 
             // push the message to the process queue,
             vRecvMsg.push_back(std::move(msg));
@@ -695,6 +752,52 @@ bool CNode::ReceiveMsgBytes(Span<const uint8_t> msg_bytes, bool& complete)
     return true;
 }
 
+SerializeData NetBufferPool::Acquire(size_t size)
+{
+    SerializeData buffer;
+    if (size > MAX_BUFFER_SIZE) return buffer;
+    // Smallest class holding size bytes
+    size_t size_class{0};
+    while ((MIN_BUFFER_SIZE << size_class) < size) ++size_class;
+    {
+        LOCK(m_mutex);
+        auto& free{m_free[size_class]};
+        if (!free.empty()) {
+            buffer = std::move(free.back());
+            free.pop_back();
+            m_pooled_bytes -= buffer.capacity();
+            return buffer;
+        }
+    }
+    buffer.reserve(MIN_BUFFER_SIZE << size_class);
+    return buffer;
+}
+
+void NetBufferPool::Release(SerializeData&& buffer)
+{
+    const size_t capacity{buffer.capacity()};
+    if (capacity < MIN_BUFFER_SIZE || capacity > MAX_BUFFER_SIZE) return;
+    // Largest class buffer can hold, so that a buffer taken from a class always fits it
+    size_t size_class{NUM_CLASSES - 1};
+    while ((MIN_BUFFER_SIZE << size_class) > capacity) --size_class;
+    buffer.clear();
+    LOCK(m_mutex);
+    if (m_pooled_bytes + capacity > MAX_POOLED_BYTES) return;
+    m_free[size_class].push_back(std::move(buffer));
+    m_pooled_bytes += capacity;
+}
+
+size_t NetBufferPool::PooledBytes() const
+{
+    LOCK(m_mutex);
+    return m_pooled_bytes;
+}
+
+CNetMessage::~CNetMessage()
+{
+    if (m_buffer_pool) m_buffer_pool->Release(m_recv.TakeBuffer());
+}
+
 int V1TransportDeserializer::readHeader(Span<const uint8_t> msg_bytes)
 {
     // copy data to temporary parsing buffer
@@ -729,6 +832,11 @@ int V1TransportDeserializer::readHeader(Span<const uint8_t> msg_bytes)
         return -1;
     }
 
+    // Take the buffer from the pool, at most as large as readData allocates ahead
+    if (m_buffer_pool && hdr.nMessageSize > 0) {
+        vRecv.AdoptBuffer(m_buffer_pool->Acquire(std::min<size_t>(hdr.nMessageSize, 256 * 1024)));
+    }
+
     // switch state to reading message data
     in_data = true;
 
@@ -765,7 +873,7 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
     // Initialize out parameter
     reject_message = false;
     // decompose a single CNetMessage from the TransportDeserializer
-    CNetMessage msg(std::move(vRecv));
+    CNetMessage msg(std::move(vRecv), m_buffer_pool);
 
     // store message type string, time, and sizes
     msg.m_type = hdr.GetCommand();
@@ -797,13 +905,23 @@ CNetMessage V1TransportDeserializer::GetMessage(const std::chrono::microseconds
     return msg;
 }
 
+void CSerializedNetMsg::SharePayload()
+{
+    if (m_shared_payload) return;
+    auto payload{std::make_shared<SharedNetPayload>()};
+    payload->hash = Hash(data);
+    payload->data = std::move(data);
+    data.clear();
+    m_shared_payload = std::move(payload);
+}
+
 void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vector<unsigned char>& header) const
 {
-    // create dbl-sha256 checksum
-    uint256 hash = Hash(msg.data);
+    // create dbl-sha256 checksum, computed once for shared payloads
+    const uint256 hash{msg.m_shared_payload ? msg.m_shared_payload->hash : Hash(msg.data)};
 
     // create header
-    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.data.size());
+    CMessageHeader hdr(Params().MessageStart(), msg.m_type.c_str(), msg.Payload().size());
     memcpy(hdr.pchChecksum, hash.begin(), CMessageHeader::CHECKSUM_SIZE);
 
     // serialize header
@@ -811,34 +929,116 @@ void V1TransportSerializer::prepareForTransport(CSerializedNetMsg& msg, std::vec
     CVectorWriter{SER_NETWORK, INIT_PROTO_VERSION, header, 0, hdr};
 }
 
+SendPriority GetSendPriority(const std::string& msg_type)
+{
+    if (msg_type == NetMsgType::TX || msg_type == NetMsgType::INV || msg_type == NetMsgType::NOTFOUND ||
+        msg_type == NetMsgType::MERKLEBLOCK) {
+        return SendPriority::TX;
+    }
+    if (msg_type == NetMsgType::ADDR || msg_type == NetMsgType::ADDRV2) return SendPriority::ADDR;
+    return SendPriority::BLOCK;
+}
+
+std::string SendPriorityAsString(SendPriority priority)
+{
+    switch (priority) {
+    case SendPriority::BLOCK: return "block";
+    case SendPriority::TX: return "tx";
+    case SendPriority::ADDR: return "addr";
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
+void CNode::ClearSendQueues()
+{
+    for (size_t queue = 0; queue < NUM_SEND_PRIORITIES; ++queue) {
+        m_send_queues[queue].clear();
+        m_send_queue_stats[queue].queued_bytes = 0;
+    }
+    m_send_partial.reset();
+    nSendOffset = 0;
+    nSendSize = 0;
+}
+
 size_t CConnman::SocketSendData(CNode& node) const
 {
-    auto it = node.vSendMsg.begin();
     size_t nSentSize = 0;
-
-    while (it != node.vSendMsg.end()) {
-        const auto& data = *it;
-        assert(data.size() > node.nSendOffset);
-        int nBytes = 0;
+    std::array<Span<const unsigned char>, Sock::MAX_SEND_BUFFERS> buffers;
+    // The queue of each message gathered, in the order they are sent
+    std::vector<size_t> gathered_queues;
+
+    while (node.HasQueuedMessages()) {
+        // Gather the queued messages, so headers and payloads of several of
+        // them go out in one call: first the rest of the message partially
+        // sent, then the queues by priority
+        size_t count = 0;
+        size_t gathered = 0;
+        gathered_queues.clear();
+        auto gather = [&](const CNode::QueuedNetMsg& msg, size_t offset) {
+            for (const std::vector<unsigned char>* buffer : {msg.header.get(), msg.payload.get()}) {
+                if (!buffer || count == buffers.size()) continue;
+                if (offset >= buffer->size()) {
+                    offset -= buffer->size();
+                    continue;
+                }
+                buffers[count] = Span{*buffer}.subspan(offset);
+                gathered += buffers[count].size();
+                offset = 0;
+                ++count;
+            }
+        };
+        if (node.m_send_partial) {
+            gather(node.m_send_queues[*node.m_send_partial].front(), node.nSendOffset);
+            gathered_queues.push_back(*node.m_send_partial);
+        }
+        for (size_t queue = 0; queue < NUM_SEND_PRIORITIES && count < buffers.size(); ++queue) {
+            auto msg_it = node.m_send_queues[queue].begin();
+            if (node.m_send_partial == queue) ++msg_it;
+            for (; msg_it != node.m_send_queues[queue].end() && count < buffers.size(); ++msg_it) {
+                gather(*msg_it, 0);
+                gathered_queues.push_back(queue);
+            }
+        }
+        assert(count > 0);
+        ssize_t nBytes = 0;
         {
             LOCK(node.m_sock_mutex);
             if (!node.m_sock) {
                 break;
             }
-            nBytes = node.m_sock->Send(reinterpret_cast<const char*>(data.data()) + node.nSendOffset, data.size() - node.nSendOffset, MSG_NOSIGNAL | MSG_DONTWAIT);
+            nBytes = node.m_sock->SendMany(Span{buffers}.first(count), MSG_NOSIGNAL | MSG_DONTWAIT);
         }
         if (nBytes > 0) {
             node.m_last_send = GetTime<std::chrono::seconds>();
             node.nSendBytes += nBytes;
-            node.nSendOffset += nBytes;
             nSentSize += nBytes;
-            if (node.nSendOffset == data.size()) {
+            // Remove the messages sent completely, and note the one partially sent
+            size_t sent = nBytes;
+            const auto now{SteadyClock::now()};
+            for (const size_t queue : gathered_queues) {
+                const CNode::QueuedNetMsg& msg{node.m_send_queues[queue].front()};
+                const size_t left = msg.size() - node.nSendOffset;
+                if (sent < left) {
+                    node.nSendOffset += sent;
+                    node.m_send_partial = queue;
+                    break;
+                }
+                sent -= left;
                 node.nSendOffset = 0;
-                node.nSendSize -= data.size();
-                node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
-                it++;
-            } else {
-                // could not send full message; stop sending more
+                node.m_send_partial.reset();
+                node.nSendSize -= msg.size();
+                SendQueueStats& stats{node.m_send_queue_stats[queue]};
+                const auto delay{std::chrono::duration_cast<std::chrono::microseconds>(now - msg.queued_time)};
+                stats.queued_bytes -= msg.size();
+                ++stats.sent_msgs;
+                stats.total_delay += delay;
+                stats.max_delay = std::max(stats.max_delay, delay);
+                node.m_send_queues[queue].pop_front();
+                if (sent == 0) break;
+            }
+            node.fPauseSend = node.nSendSize > nSendBufferMaxSize;
+            if (size_t(nBytes) < gathered) {
+                // could not send everything; stop sending more
                 break;
             }
         } else {
@@ -855,11 +1055,10 @@ size_t CConnman::SocketSendData(CNode& node) const
         }
     }
 
-    if (it == node.vSendMsg.end()) {
+    if (!node.HasQueuedMessages()) {
         assert(node.nSendOffset == 0);
-        assert(node.nSendSize == 0);
+        assert(!node.m_send_partial);
     }
-    node.vSendMsg.erase(node.vSendMsg.begin(), it);
     return nSentSize;
 }
 
@@ -953,8 +1152,8 @@ void CConnman::CreateNodeFromAcceptedSocket(std::unique_ptr<Sock>&& sock,
     AddWhitelistPermissionFlags(permission_flags, addr);
     if (NetPermissions::HasFlag(permission_flags, NetPermissionFlags::Implicit)) {
         NetPermissions::ClearFlag(permission_flags, NetPermissionFlags::Implicit);
-        if (gArgs.GetBoolArg("-whitelistforcerelay", DEFAULT_WHITELISTFORCERELAY)) NetPermissions::AddFlag(permission_flags, NetPermissionFlags::ForceRelay);
-        if (gArgs.GetBoolArg("-whitelistrelay", DEFAULT_WHITELISTRELAY)) NetPermissions::AddFlag(permission_flags, NetPermissionFlags::Relay);
+        if (whitelist_forcerelay) NetPermissions::AddFlag(permission_flags, NetPermissionFlags::ForceRelay);
+        if (whitelist_relay) NetPermissions::AddFlag(permission_flags, NetPermissionFlags::Relay);
         NetPermissions::AddFlag(permission_flags, NetPermissionFlags::Mempool);
         NetPermissions::AddFlag(permission_flags, NetPermissionFlags::NoBan);
     }
@@ -1031,6 +1230,7 @@ void CConnman::CreateNodeFromAcceptedSocket(std::unique_ptr<Sock>&& sock,
                              CNodeOptions{
                                .permission_flags = permission_flags,
                                .prefer_evict = discouraged,
+                               .recv_buffer_pool = &m_recv_buffer_pool,
                              });
     pnode->AddRef();
     m_msgproc->InitializeNode(*pnode, nodeServices);
@@ -1205,31 +1405,54 @@ Sock::EventsPerSock CConnman::GenerateWaitSockets(Span<CNode* const> nodes)
         // * Hand off all complete messages to the processor, to be handled without
         //   blocking here.
 
-        bool select_recv = !pnode->fPauseRecv;
-        bool select_send;
-        {
-            LOCK(pnode->cs_vSend);
-            select_send = !pnode->vSendMsg.empty();
-        }
+        const Sock::Event requested{RequestedEvents(*pnode)};
 
         LOCK(pnode->m_sock_mutex);
         if (!pnode->m_sock) {
             continue;
         }
 
-        Sock::Event requested{0};
-        if (select_send) {
-            requested = Sock::SEND;
-        } else if (select_recv) {
-            requested = Sock::RECV;
-        }
-
         events_per_sock.emplace(pnode->m_sock, Sock::Events{requested});
     }
 
     return events_per_sock;
 }
 
+Sock::Event CConnman::RequestedEvents(CNode& node)
+{
+    bool select_recv = !node.fPauseRecv;
+    bool select_send;
+    {
+        LOCK(node.cs_vSend);
+        select_send = node.HasQueuedMessages();
+    }
+
+    if (select_send) return Sock::SEND;
+    if (select_recv) return Sock::RECV;
+    return 0;
+}
+
+bool CConnman::UpdatePolledSockets(Span<CNode* const> nodes)
+{
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        if (!m_sock_poller->Set(hListenSocket.sock, Sock::RECV)) return false;
+    }
+
+    for (CNode* pnode : nodes) {
+        const Sock::Event requested{RequestedEvents(*pnode)};
+
+        LOCK(pnode->m_sock_mutex);
+        if (!pnode->m_sock) {
+            continue;
+        }
+        if (!m_sock_poller->Set(pnode->m_sock, requested)) return false;
+    }
+
+    // Sockets of disconnected nodes are closed once released here
+    m_sock_poller->RemoveUnset();
+    return true;
+}
+
 void CConnman::SocketHandler()
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
@@ -1245,9 +1468,20 @@ void CConnman::SocketHandler()
         // listening sockets in one call ("readiness" as in poll(2) or
         // select(2)). If none are ready, wait for a short while and return
         // empty sets.
-        events_per_sock = GenerateWaitSockets(snap.Nodes());
-        if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
-            interruptNet.sleep_for(timeout);
+        if (m_sock_poller && !UpdatePolledSockets(snap.Nodes())) {
+            LogPrintf("Failed to register a socket for polling (%s), waiting on sockets one call at a time from now on\n",
+                      NetworkErrorString(WSAGetLastError()));
+            m_sock_poller.reset();
+        }
+        if (m_sock_poller) {
+            if (m_sock_poller->Size() == 0 || !m_sock_poller->Wait(timeout, events_per_sock)) {
+                interruptNet.sleep_for(timeout);
+            }
+        } else {
+            events_per_sock = GenerateWaitSockets(snap.Nodes());
+            if (events_per_sock.empty() || !events_per_sock.begin()->first->WaitMany(timeout, events_per_sock)) {
+                interruptNet.sleep_for(timeout);
+            }
         }
 
         // Service (send/receive) each of the already connected nodes.
@@ -1311,6 +1545,7 @@ void CConnman::SocketHandlerConnected(const std::vector<CNode*>& nodes,
                         // vRecvMsg contains only completed CNetMessage
                         // the single possible partially deserialized message are held by TransportDeserializer
                         nSizeAdded += it->m_raw_message_size;
+                        if (!m_message_prepare_shards.empty()) PrepareMessage(*pnode, *it);
                     }
                     {
                         LOCK(pnode->cs_vProcessMsg);
@@ -1421,8 +1656,39 @@ void CConnman::ThreadDNSAddressSeed()
     //   (done in ThreadOpenConnections)
     const std::chrono::seconds seeds_wait_time = (addrman.size() >= DNSSEEDS_DELAY_PEER_THRESHOLD ? DNSSEEDS_DELAY_MANY_PEERS : DNSSEEDS_DELAY_FEW_PEERS);
 
+    // The seeds queried at once are looked up in parallel. Their addresses are
+    // added before waiting for the next ones, which checks whether they helped.
+    struct SeedLookup {
+        std::string seed;
+        CNetAddr source;
+        ServiceFlags services;
+        std::future<std::optional<std::vector<CNetAddr>>> ips;
+    };
+    std::vector<SeedLookup> lookups;
+    const auto add_lookup_results = [&] {
+        for (SeedLookup& lookup : lookups) {
+            const std::optional<std::vector<CNetAddr>> ips{lookup.ips.get()};
+            if (!ips) {
+                // We now avoid directly using results from DNS Seeds which do not support service bit filtering,
+                // instead using them as a addrfetch to get nodes with our desired service bits.
+                AddAddrFetch(lookup.seed);
+                continue;
+            }
+            std::vector<CAddress> vAdd;
+            for (const CNetAddr& ip : *ips) {
+                CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()), lookup.services);
+                addr.nTime = rng.rand_uniform_delay(Now<NodeSeconds>() - 3 * 24h, -4 * 24h); // use a random age between 3 and 7 days old
+                vAdd.push_back(addr);
+                found++;
+            }
+            addrman.Add(vAdd, lookup.source);
+        }
+        lookups.clear();
+    };
+
     for (const std::string& seed : seeds) {
         if (seeds_right_now == 0) {
+            add_lookup_results();
             seeds_right_now += DNSSEEDS_TO_QUERY_AT_ONCE;
 
             if (addrman.size() > 0) {
@@ -1470,39 +1736,39 @@ void CConnman::ThreadDNSAddressSeed()
         if (HaveNameProxy()) {
             AddAddrFetch(seed);
         } else {
-            std::vector<CNetAddr> vIPs;
-            std::vector<CAddress> vAdd;
             ServiceFlags requiredServiceBits = GetDesirableServiceFlags(NODE_NONE);
             std::string host = strprintf("x%x.%s", requiredServiceBits, seed);
             CNetAddr resolveSource;
             if (!resolveSource.SetInternal(host)) {
                 continue;
             }
-            unsigned int nMaxIPs = 256; // Limits number of IPs learned from a DNS seed
-            if (LookupHost(host, vIPs, nMaxIPs, true)) {
-                for (const CNetAddr& ip : vIPs) {
-                    CAddress addr = CAddress(CService(ip, Params().GetDefaultPort()), requiredServiceBits);
-                    addr.nTime = rng.rand_uniform_delay(Now<NodeSeconds>() - 3 * 24h, -4 * 24h); // use a random age between 3 and 7 days old
-                    vAdd.push_back(addr);
-                    found++;
-                }
-                addrman.Add(vAdd, resolveSource);
-            } else {
-                // We now avoid directly using results from DNS Seeds which do not support service bit filtering,
-                // instead using them as a addrfetch to get nodes with our desired service bits.
-                AddAddrFetch(seed);
-            }
+            lookups.push_back({seed, resolveSource, requiredServiceBits, std::async(std::launch::async, [host] {
+                util::ThreadRename("dnsseed.lookup");
+                std::vector<CNetAddr> vIPs;
+                unsigned int nMaxIPs = 256; // Limits number of IPs learned from a DNS seed
+                if (!LookupHost(host, vIPs, nMaxIPs, true)) return std::optional<std::vector<CNetAddr>>{};
+                return std::optional{std::move(vIPs)};
+            })});
         }
         --seeds_right_now;
     }
+    add_lookup_results();
     LogPrintf("%d addresses found from DNS seeds\n", found);
 }
 
 void CConnman::DumpAddresses()
 {
+    LOCK(m_dump_addresses_mutex);
+    // Read before writing, so that changes made during the write are flushed next time
+    const uint64_t generation{addrman.Generation()};
+    if (m_dumped_addrman_generation == generation) {
+        LogPrint(BCLog::NET, "Skipped flushing unchanged addresses to peers.dat\n");
+        return;
+    }
+
     const auto start{SteadyClock::now()};
 
-    DumpPeerAddresses(::gArgs, addrman);
+    if (DumpPeerAddresses(::gArgs, addrman)) m_dumped_addrman_generation = generation;
 
     LogPrint(BCLog::NET, "Flushed %d addresses to peers.dat  %dms\n",
              addrman.size(), Ticks<std::chrono::milliseconds>(SteadyClock::now() - start));
@@ -1614,6 +1880,16 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
         LogPrintf("Fixed seeds are disabled\n");
     }
 
+    // Connection attempts run on threads of their own, so that a peer that
+    // does not answer does not hold up the others. Returning waits for them.
+    struct PendingConnection {
+        std::vector<unsigned char> group;
+        ConnectionType conn_type;
+        CSemaphoreGrant grant;
+        std::future<void> done;
+    };
+    std::list<PendingConnection> pending;
+
     while (!interruptNet)
     {
         ProcessAddrFetch();
@@ -1621,6 +1897,18 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
         if (!interruptNet.sleep_for(std::chrono::milliseconds(500)))
             return;
 
+        // Forget the finished attempts before counting the peers below, which
+        // then include the connections they made
+        for (auto it = pending.begin(); it != pending.end();) {
+            if (it->done.wait_for(0s) != std::future_status::ready) {
+                ++it;
+                continue;
+            }
+            it->done.get();
+            it = pending.erase(it);
+        }
+        if (pending.size() >= MAX_PENDING_OUTBOUND_CONNECTIONS) continue;
+
         CSemaphoreGrant grant(*semOutbound);
         if (interruptNet)
             return;
@@ -1700,6 +1988,11 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
                 } // no default case, so the compiler can warn about missing cases
             }
         }
+        for (const PendingConnection& attempt : pending) {
+            if (attempt.conn_type == ConnectionType::OUTBOUND_FULL_RELAY) nOutboundFullRelay++;
+            if (attempt.conn_type == ConnectionType::BLOCK_RELAY) nOutboundBlockRelay++;
+            setConnected.insert(attempt.group);
+        }
 
         ConnectionType conn_type = ConnectionType::OUTBOUND_FULL_RELAY;
         auto now = GetTime<std::chrono::microseconds>();
@@ -1724,6 +2017,9 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
             // OUTBOUND_FULL_RELAY
         } else if (nOutboundBlockRelay < m_max_outbound_block_relay) {
             conn_type = ConnectionType::BLOCK_RELAY;
+        } else if (!pending.empty()) {
+            // Wait for the attempts in flight before making an extra connection
+            continue;
         } else if (GetTryNewOutboundPeer()) {
             // OUTBOUND_FULL_RELAY
         } else if (now > next_extra_block_relay && m_start_extra_block_relay_peers) {
@@ -1855,7 +2151,15 @@ void CConnman::ThreadOpenConnections(const std::vector<std::string> connect)
                 LogPrint(BCLog::NET, "Making feeler connection to %s\n", addrConnect.ToString());
             }
 
-            OpenNetworkConnection(addrConnect, (int)setConnected.size() >= std::min(nMaxConnections - 1, 2), &grant, nullptr, conn_type);
+            const bool count_failure{(int)setConnected.size() >= std::min(nMaxConnections - 1, 2)};
+            PendingConnection& attempt{pending.emplace_back()};
+            attempt.group = m_netgroupman.GetGroup(addrConnect);
+            attempt.conn_type = conn_type;
+            grant.MoveTo(attempt.grant);
+            attempt.done = std::async(std::launch::async, [this, addrConnect, count_failure, conn_type, grant = &attempt.grant] {
+                util::ThreadRename("opencon.attempt");
+                OpenNetworkConnection(addrConnect, count_failure, grant, nullptr, conn_type);
+            });
         }
     }
 }
@@ -2032,6 +2336,39 @@ void CConnman::ThreadMessageHandler()
     }
 }
 
+void CConnman::ThreadMessagePrepare(MessagePrepareShard& shard)
+{
+    SetSyscallSandboxPolicy(SyscallSandboxPolicy::MESSAGE_HANDLER);
+    while (true) {
+        std::function<void()> work;
+        {
+            WAIT_LOCK(shard.m_mutex, lock);
+            shard.m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(shard.m_mutex) { return flagInterruptMsgProc || !shard.m_work.empty(); });
+            if (flagInterruptMsgProc) return;
+            work = std::move(shard.m_work.front());
+            shard.m_work.pop_front();
+        }
+        work();
+    }
+}
+
+void CConnman::PrepareMessage(const CNode& node, const CNetMessage& msg)
+{
+    std::function<void()> work{m_msgproc->PrepareMessage(node, msg)};
+    if (!work) return;
+
+    // Mapping nodes to a fixed shard runs the work of each in order
+    MessagePrepareShard& shard{*m_message_prepare_shards[node.GetId() % m_message_prepare_shards.size()]};
+    {
+        LOCK(shard.m_mutex);
+        // The work only gets ahead of ProcessMessages, which does it anyway,
+        // so a peer flooding its shard just loses the head start
+        if (shard.m_work.size() >= MAX_MESSAGE_PREPARE_QUEUE) return;
+        shard.m_work.push_back(std::move(work));
+    }
+    shard.m_cond.notify_one();
+}
+
 void CConnman::ThreadI2PAcceptIncoming()
 {
     static constexpr auto err_wait_begin = 1s;
@@ -2071,6 +2408,57 @@ void CConnman::ThreadI2PAcceptIncoming()
     }
 }
 
+void CConnman::ThreadI2PTransientSessions()
+{
+    static constexpr auto err_wait_begin = 1s;
+    static constexpr auto err_wait_cap = 5min;
+    auto err_wait = err_wait_begin;
+
+    while (!interruptNet) {
+        std::unique_ptr<i2p::sam::Session> expired;
+        size_t ready;
+        {
+            LOCK(m_i2p_transient_sessions_mutex);
+            // Do not keep one destination around for long before it is used
+            if (!m_i2p_transient_sessions.empty() &&
+                SteadyClock::now() - m_i2p_transient_sessions.front().first > I2P_TRANSIENT_SESSION_LIFETIME) {
+                expired = std::move(m_i2p_transient_sessions.front().second);
+                m_i2p_transient_sessions.pop_front();
+            }
+            ready = m_i2p_transient_sessions.size();
+        }
+        expired.reset();
+
+        Proxy i2p_sam;
+        if (ready >= I2P_TRANSIENT_SESSIONS_READY || !GetProxy(NET_I2P, i2p_sam)) {
+            interruptNet.sleep_for(1s);
+            continue;
+        }
+
+        auto session{std::make_unique<i2p::sam::Session>(i2p_sam.proxy, &interruptNet)};
+        if (!session->Create()) {
+            interruptNet.sleep_for(err_wait);
+            if (err_wait < err_wait_cap) {
+                err_wait *= 2;
+            }
+            continue;
+        }
+        err_wait = err_wait_begin;
+
+        LOCK(m_i2p_transient_sessions_mutex);
+        m_i2p_transient_sessions.emplace_back(SteadyClock::now(), std::move(session));
+    }
+}
+
+std::unique_ptr<i2p::sam::Session> CConnman::TakeI2PTransientSession()
+{
+    LOCK(m_i2p_transient_sessions_mutex);
+    if (m_i2p_transient_sessions.empty()) return nullptr;
+    auto session{std::move(m_i2p_transient_sessions.front().second)};
+    m_i2p_transient_sessions.pop_front();
+    return session;
+}
+
 bool CConnman::BindListenPort(const CService& addrBind, bilingual_str& strError, NetPermissionFlags permissions)
 {
     int nOne = 1;
@@ -2331,7 +2719,14 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
         fMsgProcWake = false;
     }
 
+    // Prepare received messages, before the socket handler hands any out
+    for (int i = 0; i < m_message_prepare_threads; ++i) {
+        auto& shard{m_message_prepare_shards.emplace_back(std::make_unique<MessagePrepareShard>())};
+        shard->m_thread = std::thread(&util::TraceThread, strprintf("msgprep.%i", i), [this, &shard = *shard] { ThreadMessagePrepare(shard); });
+    }
+
     // Send and receive from sockets, accept connections
+    m_sock_poller = SockPoller::Make();
     threadSocketHandler = std::thread(&util::TraceThread, "net", [this] { ThreadSocketHandler(); });
 
     if (!gArgs.GetBoolArg("-dnsseed", DEFAULT_DNSSEED))
@@ -2362,6 +2757,10 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     if (m_i2p_sam_session) {
         threadI2PAcceptIncoming =
             std::thread(&util::TraceThread, "i2paccept", [this] { ThreadI2PAcceptIncoming(); });
+    } else if (GetProxy(NET_I2P, i2p_sam)) {
+        // Outbound I2P connections use transient sessions, which are created ahead of time
+        threadI2PTransientSessions =
+            std::thread(&util::TraceThread, "i2psessions", [this] { ThreadI2PTransientSessions(); });
     }
 
     // Dump network addresses
@@ -2392,6 +2791,11 @@ void CConnman::Interrupt()
         flagInterruptMsgProc = true;
     }
     condMsgProc.notify_all();
+    for (const auto& shard : m_message_prepare_shards) {
+        // Taking the lock orders the flag before a waiting thread checks it
+        WITH_LOCK(shard->m_mutex, );
+        shard->m_cond.notify_all();
+    }
 
     interruptNet();
     InterruptSocks5(true);
@@ -2414,6 +2818,9 @@ void CConnman::StopThreads()
     if (threadI2PAcceptIncoming.joinable()) {
         threadI2PAcceptIncoming.join();
     }
+    if (threadI2PTransientSessions.joinable()) {
+        threadI2PTransientSessions.join();
+    }
     if (threadMessageHandler.joinable())
         threadMessageHandler.join();
     if (threadOpenConnections.joinable())
@@ -2424,6 +2831,11 @@ void CConnman::StopThreads()
         threadDNSAddressSeed.join();
     if (threadSocketHandler.joinable())
         threadSocketHandler.join();
+    m_sock_poller.reset();
+    for (const auto& shard : m_message_prepare_shards) {
+        if (shard->m_thread.joinable()) shard->m_thread.join();
+    }
+    m_message_prepare_shards.clear();
 }
 
 void CConnman::StopNodes()
@@ -2454,6 +2866,7 @@ void CConnman::StopNodes()
         DeleteNode(pnode);
     }
     m_nodes_disconnected.clear();
+    WITH_LOCK(m_i2p_transient_sessions_mutex, m_i2p_transient_sessions.clear());
     vhListenSocket.clear();
     semOutbound.reset();
     semAddnode.reset();
@@ -2566,6 +2979,17 @@ size_t CConnman::GetNodeCount(ConnectionDirection flags) const
     return nNum;
 }
 
+size_t CConnman::GetPeerBufferMemoryUsage() const
+{
+    size_t usage{m_recv_buffer_pool.PooledBytes()};
+    LOCK(m_nodes_mutex);
+    for (CNode* pnode : m_nodes) {
+        WITH_LOCK(pnode->cs_vSend, usage += pnode->nSendSize);
+        WITH_LOCK(pnode->cs_vProcessMsg, usage += pnode->nProcessQueueSize);
+    }
+    return usage;
+}
+
 void CConnman::GetNodeStats(std::vector<CNodeStats>& vstats) const
 {
     vstats.clear();
@@ -2738,7 +3162,7 @@ CNode::CNode(NodeId idIn,
              ConnectionType conn_type_in,
              bool inbound_onion,
              CNodeOptions&& node_opts)
-    : m_deserializer{std::make_unique<V1TransportDeserializer>(V1TransportDeserializer(Params(), idIn, SER_NETWORK, INIT_PROTO_VERSION))},
+    : m_deserializer{std::make_unique<V1TransportDeserializer>(V1TransportDeserializer(Params(), idIn, SER_NETWORK, INIT_PROTO_VERSION, node_opts.recv_buffer_pool))},
       m_serializer{std::make_unique<V1TransportSerializer>(V1TransportSerializer())},
       m_permission_flags{node_opts.permission_flags},
       m_sock{sock},
@@ -2775,10 +3199,11 @@ bool CConnman::NodeFullyConnected(const CNode* pnode)
 void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
 {
     AssertLockNotHeld(m_total_bytes_sent_mutex);
-    size_t nMessageSize = msg.data.size();
+    const Span<const unsigned char> payload{msg.Payload()};
+    size_t nMessageSize = payload.size();
     LogPrint(BCLog::NET, "sending %s (%d bytes) peer=%d\n", msg.m_type, nMessageSize, pnode->GetId());
-    if (gArgs.GetBoolArg("-capturemessages", false)) {
-        CaptureMessage(pnode->addr, msg.m_type, msg.data, /*is_incoming=*/false);
+    if (m_capture_messages) {
+        CaptureMessage(pnode->addr, msg.m_type, payload, /*is_incoming=*/false);
     }
 
     TRACE6(net, outbound_message,
@@ -2786,8 +3211,8 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
         pnode->m_addr_name.c_str(),
         pnode->ConnectionTypeAsString().c_str(),
         msg.m_type.c_str(),
-        msg.data.size(),
-        msg.data.data()
+        payload.size(),
+        payload.data()
     );
 
     // make sure we use the appropriate network transport format
@@ -2798,15 +3223,28 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg)
     size_t nBytesSent = 0;
     {
         LOCK(pnode->cs_vSend);
-        bool optimisticSend(pnode->vSendMsg.empty());
+        bool optimisticSend(!pnode->HasQueuedMessages());
 
         //log total amount of bytes per message type
         pnode->mapSendBytesPerMsgType[msg.m_type] += nTotalSize;
+        TotalBytesPerMsgType().Add(msg.m_type, /*recv=*/false, nTotalSize);
         pnode->nSendSize += nTotalSize;
 
         if (pnode->nSendSize > nSendBufferMaxSize) pnode->fPauseSend = true;
-        pnode->vSendMsg.push_back(std::move(serializedHeader));
-        if (nMessageSize) pnode->vSendMsg.push_back(std::move(msg.data));
+        CNode::QueuedNetMsg queued;
+        queued.header = std::make_shared<const std::vector<unsigned char>>(std::move(serializedHeader));
+        if (nMessageSize) {
+            if (msg.m_shared_payload) {
+                // Reference the shared payload instead of copying it
+                queued.payload = std::shared_ptr<const std::vector<unsigned char>>(msg.m_shared_payload, &msg.m_shared_payload->data);
+            } else {
+                queued.payload = std::make_shared<const std::vector<unsigned char>>(std::move(msg.data));
+            }
+        }
+        queued.queued_time = SteadyClock::now();
+        const size_t queue{static_cast<size_t>(GetSendPriority(msg.m_type))};
+        pnode->m_send_queue_stats[queue].queued_bytes += nTotalSize;
+        pnode->m_send_queues[queue].push_back(std::move(queued));
 
         // If write queue empty, attempt "optimistic write"
         if (optimisticSend) nBytesSent = SocketSendData(*pnode);
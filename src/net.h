@@ -23,12 +23,16 @@
 #include <random.h>
 #include <span.h>
 #include <streams.h>
+#include <support/allocators/zeroafterfree.h>
 #include <sync.h>
 #include <threadinterrupt.h>
 #include <uint256.h>
 #include <util/check.h>
 #include <util/sock.h>
+#include <util/time.h>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
 #include <condition_variable>
 #include <cstdint>
@@ -70,6 +74,12 @@ static const int MAX_ADDNODE_CONNECTIONS = 8;
 static const int MAX_BLOCK_RELAY_ONLY_CONNECTIONS = 2;
 /** Maximum number of feeler connections */
 static const int MAX_FEELER_CONNECTIONS = 1;
+/** Maximum number of automatic outbound connection attempts in flight at once */
+static const size_t MAX_PENDING_OUTBOUND_CONNECTIONS = 4;
+/** Number of transient I2P sessions kept ready for outbound I2P connections */
+static constexpr size_t I2P_TRANSIENT_SESSIONS_READY{2};
+/** Time after which a transient I2P session that is ready but unused is replaced */
+static constexpr auto I2P_TRANSIENT_SESSION_LIFETIME{10min};
 /** -listen default */
 static const bool DEFAULT_LISTEN = true;
 /** The maximum number of peer connections to maintain. */
@@ -88,6 +98,12 @@ static constexpr bool DEFAULT_DNSSEED{true};
 static constexpr bool DEFAULT_FIXEDSEEDS{true};
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
+/** Default number of threads preparing received messages ahead of the message handler */
+static constexpr int DEFAULT_MESSAGE_PREPARE_THREADS{2};
+/** Maximum number of threads preparing received messages */
+static constexpr int MAX_MESSAGE_PREPARE_THREADS{16};
+/** Maximum number of messages waiting for a preparation thread; further ones are processed unprepared */
+static constexpr size_t MAX_MESSAGE_PREPARE_QUEUE{128};
 
 typedef int64_t NodeId;
 
@@ -102,6 +118,12 @@ struct AddedNodeInfo
 class CNodeStats;
 class CClientUIInterface;
 
+/** A message payload serialized once and referenced by every peer it is sent to, with its checksum hash */
+struct SharedNetPayload {
+    std::vector<unsigned char> data;
+    uint256 hash;
+};
+
 struct CSerializedNetMsg {
     CSerializedNetMsg() = default;
     CSerializedNetMsg(CSerializedNetMsg&&) = default;
@@ -110,16 +132,30 @@ struct CSerializedNetMsg {
     CSerializedNetMsg(const CSerializedNetMsg& msg) = delete;
     CSerializedNetMsg& operator=(const CSerializedNetMsg&) = delete;
 
+    /** Copy the message. A shared payload is referenced, not copied. */
     CSerializedNetMsg Copy() const
     {
         CSerializedNetMsg copy;
         copy.data = data;
         copy.m_type = m_type;
+        copy.m_shared_payload = m_shared_payload;
         return copy;
     }
 
+    /** Move the payload into a shared buffer, so that copies of the message reference it. */
+    void SharePayload();
+
+    /** The payload, whether it is owned or shared. */
+    Span<const unsigned char> Payload() const
+    {
+        if (m_shared_payload) return m_shared_payload->data;
+        return data;
+    }
+
+    //! The owned payload; empty when the payload is shared
     std::vector<unsigned char> data;
     std::string m_type;
+    std::shared_ptr<const SharedNetPayload> m_shared_payload;
 };
 
 /**
@@ -184,6 +220,46 @@ extern std::map<CNetAddr, LocalServiceInfo> mapLocalHost GUARDED_BY(g_maplocalho
 extern const std::string NET_MESSAGE_TYPE_OTHER;
 using mapMsgTypeSize = std::map</* message type */ std::string, /* total bytes */ uint64_t>;
 
+struct NetMsgTypeBytes {
+    std::string msg_type;
+    uint64_t sent;
+    uint64_t recv;
+};
+
+/** Bytes sent and received per message type by all peers since startup, read without locking */
+std::vector<NetMsgTypeBytes> GetTotalBytesPerMsgType();
+
+/**
+ * Classes of the messages sent to a peer, in the order their send queues are
+ * drained, so that a block announced to a peer does not wait behind the
+ * transactions it requested. Messages of a class are sent in the order they
+ * were queued.
+ */
+enum class SendPriority : uint8_t {
+    //! Blocks, compact blocks, block transactions and headers, and the control messages
+    BLOCK,
+    //! Transaction relay, and the merkle blocks its transactions follow
+    TX,
+    //! Address relay
+    ADDR,
+};
+static constexpr size_t NUM_SEND_PRIORITIES{3};
+
+/** The send queue a message of the given type goes into. */
+SendPriority GetSendPriority(const std::string& msg_type);
+/** Name of a send queue, as getpeerinfo reports it. */
+std::string SendPriorityAsString(SendPriority priority);
+
+/** Messages waiting in and sent from a send queue of a peer */
+struct SendQueueStats {
+    //! Total size of the messages queued
+    size_t queued_bytes{0};
+    //! How many messages were sent, and how long they waited in the queue in total and at most
+    uint64_t sent_msgs{0};
+    std::chrono::microseconds total_delay{0};
+    std::chrono::microseconds max_delay{0};
+};
+
 class CNodeStats
 {
 public:
@@ -203,6 +279,7 @@ public:
     int m_starting_height;
     uint64_t nSendBytes;
     mapMsgTypeSize mapSendBytesPerMsgType;
+    std::array<SendQueueStats, NUM_SEND_PRIORITIES> m_send_queue_stats;
     uint64_t nRecvBytes;
     mapMsgTypeSize mapRecvBytesPerMsgType;
     NetPermissionFlags m_permission_flags;
@@ -220,6 +297,39 @@ public:
     ConnectionType m_conn_type;
 };
 
+/**
+ * Size-classed pool of message receive buffers, so that receiving a message reuses the
+ * allocation of one already processed instead of going through malloc and free each time.
+ * Free buffers are kept by capacity in power-of-two classes, up to a total budget.
+ * Buffers are taken by the socket handler and returned once the message handler is done
+ * with them, so the free lists are guarded by a mutex held only to pop or push one.
+ */
+class NetBufferPool
+{
+public:
+    /** Capacities of the smallest and largest size class; smaller or larger buffers are not kept. */
+    static constexpr size_t MIN_BUFFER_SIZE{256};
+    static constexpr size_t MAX_BUFFER_SIZE{256 * 1024};
+    /** Upper bound on the total capacity of the buffers kept for reuse. */
+    static constexpr size_t MAX_POOLED_BYTES{8 << 20};
+
+    /** Get an empty buffer that holds size bytes without reallocating, if size fits a class. */
+    SerializeData Acquire(size_t size) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Keep a buffer for reuse, unless it fits no class or the pool is full. */
+    void Release(SerializeData&& buffer) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Total capacity of the buffers currently kept. */
+    size_t PooledBytes() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    static constexpr size_t MIN_CLASS_BITS{8};
+    static constexpr size_t NUM_CLASSES{11};
+    static_assert(MIN_BUFFER_SIZE == size_t{1} << MIN_CLASS_BITS);
+    static_assert(MAX_BUFFER_SIZE == size_t{1} << (MIN_CLASS_BITS + NUM_CLASSES - 1));
+
+    mutable Mutex m_mutex;
+    std::array<std::vector<SerializeData>, NUM_CLASSES> m_free GUARDED_BY(m_mutex);
+    size_t m_pooled_bytes GUARDED_BY(m_mutex){0};
+};
 
 /** Transport protocol agnostic message container.
  * Ideally it should only contain receive time, payload,
@@ -232,8 +342,12 @@ public:
     uint32_t m_message_size{0};          //!< size of the payload
     uint32_t m_raw_message_size{0};      //!< used wire size of the message (including header/checksum)
     std::string m_type;
+    NetBufferPool* m_buffer_pool{nullptr}; //!< pool the receive buffer is returned to, if any
 
-    CNetMessage(CDataStream&& recv_in) : m_recv(std::move(recv_in)) {}
+    CNetMessage(CDataStream&& recv_in, NetBufferPool* buffer_pool = nullptr) : m_recv(std::move(recv_in)), m_buffer_pool{buffer_pool} {}
+    CNetMessage(CNetMessage&&) = default;
+    CNetMessage& operator=(CNetMessage&&) = default;
+    ~CNetMessage();
 
     void SetVersion(int nVersionIn)
     {
@@ -269,6 +383,7 @@ private:
     CDataStream hdrbuf;             // partially received header
     CMessageHeader hdr;             // complete header
     CDataStream vRecv;              // received message data
+    NetBufferPool* const m_buffer_pool; // where vRecv is taken from, if any
     unsigned int nHdrPos;
     unsigned int nDataPos;
 
@@ -288,11 +403,13 @@ private:
     }
 
 public:
-    V1TransportDeserializer(const CChainParams& chain_params, const NodeId node_id, int nTypeIn, int nVersionIn)
+    V1TransportDeserializer(const CChainParams& chain_params, const NodeId node_id, int nTypeIn, int nVersionIn,
+                            NetBufferPool* buffer_pool = nullptr)
         : m_chain_params(chain_params),
           m_node_id(node_id),
           hdrbuf(nTypeIn, nVersionIn),
-          vRecv(nTypeIn, nVersionIn)
+          vRecv(nTypeIn, nVersionIn),
+          m_buffer_pool(buffer_pool)
     {
         Reset();
     }
@@ -340,6 +457,8 @@ struct CNodeOptions
     NetPermissionFlags permission_flags = NetPermissionFlags::None;
     std::unique_ptr<i2p::sam::Session> i2p_sam_session = nullptr;
     bool prefer_evict = false;
+    /** Pool the receive buffers are taken from, which must outlive the node. */
+    NetBufferPool* recv_buffer_pool = nullptr;
 };
 
 /** Information about a peer */
@@ -364,12 +483,26 @@ public:
      */
     std::shared_ptr<Sock> m_sock GUARDED_BY(m_sock_mutex);
 
-    /** Total size of all vSendMsg entries */
+    /** A message queued for sending; payloads relayed to several peers are shared */
+    struct QueuedNetMsg {
+        std::shared_ptr<const std::vector<unsigned char>> header;
+        //! Null for a message without payload
+        std::shared_ptr<const std::vector<unsigned char>> payload;
+        SteadyClock::time_point queued_time;
+
+        size_t size() const { return header->size() + (payload ? payload->size() : 0); }
+    };
+
+    /** Total size of the messages of all send queues */
     size_t nSendSize GUARDED_BY(cs_vSend){0};
-    /** Offset inside the first vSendMsg already sent */
+    /** Offset inside the message of m_send_partial already sent */
     size_t nSendOffset GUARDED_BY(cs_vSend){0};
     uint64_t nSendBytes GUARDED_BY(cs_vSend){0};
-    std::deque<std::vector<unsigned char>> vSendMsg GUARDED_BY(cs_vSend);
+    /** The queued messages of each SendPriority */
+    std::array<std::deque<QueuedNetMsg>, NUM_SEND_PRIORITIES> m_send_queues GUARDED_BY(cs_vSend);
+    /** The queue whose first message is partially sent, and so is sent first */
+    std::optional<size_t> m_send_partial GUARDED_BY(cs_vSend);
+    std::array<SendQueueStats, NUM_SEND_PRIORITIES> m_send_queue_stats GUARDED_BY(cs_vSend);
     Mutex cs_vSend;
     Mutex m_sock_mutex;
     Mutex cs_vRecv;
@@ -550,6 +683,15 @@ public:
         return nRefCount;
     }
 
+    /** Whether any send queue holds a message. */
+    bool HasQueuedMessages() const EXCLUSIVE_LOCKS_REQUIRED(cs_vSend)
+    {
+        return nSendSize > 0;
+    }
+
+    /** Drop the queued messages without sending them. */
+    void ClearSendQueues() EXCLUSIVE_LOCKS_REQUIRED(cs_vSend);
+
     /**
      * Receive bytes from the buffer and deserialize them into messages.
      *
@@ -655,6 +797,17 @@ public:
     */
     virtual bool SendMessages(CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(pnode->cs_sendProcessing) = 0;
 
+    /**
+    * Return the parts of processing a received message that need no lock and
+    * no peer state, to be run on a message preparation thread ahead of
+    * ProcessMessages. The work of a node is run in the order its messages were
+    * received, but it may also not run at all.
+    *
+    * @param[in]   node            The node which we have received the message from.
+    * @param[in]   msg             The message, which the work must not refer to.
+    * @return                      The work to run, or an empty function if there is none
+    */
+    virtual std::function<void()> PrepareMessage(const CNode& node, const CNetMessage& msg) = 0;
 
 protected:
     /**
@@ -695,6 +848,10 @@ public:
         std::vector<std::string> m_specified_outgoing;
         std::vector<std::string> m_added_nodes;
         bool m_i2p_accept_incoming;
+        int m_message_prepare_threads = DEFAULT_MESSAGE_PREPARE_THREADS;
+        bool whitelist_forcerelay = DEFAULT_WHITELISTFORCERELAY;
+        bool whitelist_relay = DEFAULT_WHITELISTRELAY;
+        bool m_capture_messages = false;
     };
 
     void Init(const Options& connOptions) EXCLUSIVE_LOCKS_REQUIRED(!m_added_nodes_mutex, !m_total_bytes_sent_mutex)
@@ -725,6 +882,10 @@ public:
             m_added_nodes = connOptions.m_added_nodes;
         }
         m_onion_binds = connOptions.onion_binds;
+        m_message_prepare_threads = std::clamp(connOptions.m_message_prepare_threads, 0, MAX_MESSAGE_PREPARE_THREADS);
+        whitelist_forcerelay = connOptions.whitelist_forcerelay;
+        whitelist_relay = connOptions.whitelist_relay;
+        m_capture_messages = connOptions.m_capture_messages;
     }
 
     CConnman(uint64_t seed0, uint64_t seed1, AddrMan& addrman, const NetGroupManager& netgroupman,
@@ -825,6 +986,8 @@ public:
     bool AddConnection(const std::string& address, ConnectionType conn_type);
 
     size_t GetNodeCount(ConnectionDirection) const;
+    /** Bytes of the messages queued to be sent to or processed from peers, and of the receive buffers kept for reuse. */
+    size_t GetPeerBufferMemoryUsage() const;
     void GetNodeStats(std::vector<CNodeStats>& vstats) const;
     bool DisconnectNode(const std::string& node);
     bool DisconnectNode(const CSubNet& subnet);
@@ -909,7 +1072,21 @@ private:
     void ProcessAddrFetch() EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex);
     void ThreadOpenConnections(std::vector<std::string> connect) EXCLUSIVE_LOCKS_REQUIRED(!m_addr_fetches_mutex, !m_added_nodes_mutex, !m_nodes_mutex);
     void ThreadMessageHandler() EXCLUSIVE_LOCKS_REQUIRED(!mutexMsgProc);
+
+    /** A thread running the preparation work of the received messages of the nodes mapped to it */
+    struct MessagePrepareShard {
+        Mutex m_mutex;
+        std::condition_variable m_cond;
+        std::deque<std::function<void()>> m_work GUARDED_BY(m_mutex);
+        std::thread m_thread;
+    };
+    void ThreadMessagePrepare(MessagePrepareShard& shard);
+    /** Queue the preparation work of a received message on the shard of its node */
+    void PrepareMessage(const CNode& node, const CNetMessage& msg);
     void ThreadI2PAcceptIncoming();
+    void ThreadI2PTransientSessions() EXCLUSIVE_LOCKS_REQUIRED(!m_i2p_transient_sessions_mutex);
+    /** Take a transient I2P session that is ready, or return nullptr if there is none. */
+    std::unique_ptr<i2p::sam::Session> TakeI2PTransientSession() EXCLUSIVE_LOCKS_REQUIRED(!m_i2p_transient_sessions_mutex);
     void AcceptConnection(const ListenSocket& hListenSocket);
 
     /**
@@ -937,6 +1114,16 @@ private:
      */
     Sock::EventsPerSock GenerateWaitSockets(Span<CNode* const> nodes);
 
+    /** The events to wait for on the socket of a node. */
+    static Sock::Event RequestedEvents(CNode& node);
+
+    /**
+     * Bring the sockets waited on by `m_sock_poller` up to date.
+     * @param[in] nodes Wait on these nodes' sockets and the listening sockets.
+     * @return false if a socket could not be registered
+     */
+    bool UpdatePolledSockets(Span<CNode* const> nodes);
+
     /**
      * Check connected and listening sockets for IO readiness and process them accordingly.
      */
@@ -982,7 +1169,7 @@ private:
     NodeId GetNewNodeId();
 
     size_t SocketSendData(CNode& node) const EXCLUSIVE_LOCKS_REQUIRED(node.cs_vSend);
-    void DumpAddresses();
+    void DumpAddresses() EXCLUSIVE_LOCKS_REQUIRED(!m_dump_addresses_mutex);
 
     // Network stats
     void RecordBytesRecv(uint64_t bytes);
@@ -1013,6 +1200,21 @@ private:
     // whitelisted (as well as those connecting to whitelisted binds).
     std::vector<NetWhitelistPermissions> vWhitelistedRange;
 
+    /**
+     * flag for adding 'forcerelay' permission to whitelisted inbound
+     * and manual peers with default permissions.
+     */
+    bool whitelist_forcerelay{DEFAULT_WHITELISTFORCERELAY};
+
+    /**
+     * flag for adding 'relay' permission to whitelisted inbound
+     * and manual peers with default permissions.
+     */
+    bool whitelist_relay{DEFAULT_WHITELISTRELAY};
+
+    /** Whether the messages sent to peers are captured to disk (-capturemessages) */
+    bool m_capture_messages{false};
+
     unsigned int nSendBufferMaxSize{0};
     unsigned int nReceiveFloodSize{0};
 
@@ -1020,6 +1222,10 @@ private:
     std::atomic<bool> fNetworkActive{true};
     bool fAddressesInitialized{false};
     AddrMan& addrman;
+    //! Serializes peers.dat writes of the scheduler and of shutdown.
+    Mutex m_dump_addresses_mutex;
+    //! AddrMan::Generation() of the last successful peers.dat write, to skip writing an unchanged addrman.
+    std::optional<uint64_t> m_dumped_addrman_generation GUARDED_BY(m_dump_addresses_mutex);
     const NetGroupManager& m_netgroupman;
     std::deque<std::string> m_addr_fetches GUARDED_BY(m_addr_fetches_mutex);
     Mutex m_addr_fetches_mutex;
@@ -1028,6 +1234,8 @@ private:
     std::vector<CNode*> m_nodes GUARDED_BY(m_nodes_mutex);
     std::list<CNode*> m_nodes_disconnected;
     mutable RecursiveMutex m_nodes_mutex;
+    /** Receive buffers shared by all nodes, which are deleted before it. */
+    NetBufferPool m_recv_buffer_pool;
     std::atomic<NodeId> nLastNodeId{0};
     unsigned int nPrevNodeCount{0};
 
@@ -1106,6 +1314,11 @@ private:
     Mutex mutexMsgProc;
     std::atomic<bool> flagInterruptMsgProc{false};
 
+    /** Number of message preparation threads; none prepare messages if zero */
+    int m_message_prepare_threads{0};
+    /** Message preparation threads, which nodes are mapped to by their id */
+    std::vector<std::unique_ptr<MessagePrepareShard>> m_message_prepare_shards;
+
     /**
      * This is signaled when network activity should cease.
      * A pointer to it is saved in `m_i2p_sam_session`, so make sure that
@@ -1121,12 +1334,28 @@ private:
      */
     std::unique_ptr<i2p::sam::Session> m_i2p_sam_session;
 
+    /**
+     * Transient I2P sessions created ahead of time and when they were created, oldest
+     * first. Without `m_i2p_sam_session` every outbound I2P connection gets a session of
+     * its own, which then does not have to wait for its tunnels to be built.
+     */
+    Mutex m_i2p_transient_sessions_mutex;
+    std::deque<std::pair<SteadyClock::time_point, std::unique_ptr<i2p::sam::Session>>> m_i2p_transient_sessions GUARDED_BY(m_i2p_transient_sessions_mutex);
+
+    /**
+     * Sockets waited on by the socket handler. Null if the platform has no
+     * epoll or kqueue, in which case `Sock::WaitMany()` waits on them.
+     * Only accessed by the socket handler thread while it runs.
+     */
+    std::unique_ptr<SockPoller> m_sock_poller;
+
     std::thread threadDNSAddressSeed;
     std::thread threadSocketHandler;
     std::thread threadOpenAddedConnections;
     std::thread threadOpenConnections;
     std::thread threadMessageHandler;
     std::thread threadI2PAcceptIncoming;
+    std::thread threadI2PTransientSessions;
 
     /** flag for deciding to connect to an extra outbound peer,
      *  in excess of m_max_outbound_full_relay
@@ -21,9 +21,13 @@
 #include <netbase.h>
 #include <netmessagemaker.h>
 #include <node/blockstorage.h>
+#include <node/headerstore.h>
+#include <node/txreconciliation.h>
 #include <policy/fees.h>
+#include <policy/packages.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
+#include <powcache.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <random.h>
@@ -37,29 +41,38 @@
 #include <txorphanage.h>
 #include <txrequest.h>
 #include <util/check.h> // For NDEBUG compile time check
+#include <util/hasher.h>
 #include <util/strencodings.h>
 #include <util/system.h>
 #include <util/trace.h>
 #include <validation.h>
 
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <chrono>
-#include <future>
+#include <deque>
+#include <functional>
+#include <list>
 #include <memory>
 #include <optional>
 #include <typeinfo>
+#include <unordered_map>
 
 using node::ReadBlockFromDisk;
 using node::ReadRawBlockFromDisk;
 using node::fImporting;
 using node::fPruneMode;
 using node::fReindex;
+using node::g_header_store;
+using node::HeaderStore;
 
 /** How long to cache transactions in mapRelay for normal relay */
 static constexpr auto RELAY_TX_CACHE_TIME = 15min;
 /** How long a transaction has to be in the mempool before it can unconditionally be relayed (even when not in mapRelay). */
 static constexpr auto UNCONDITIONAL_RELAY_DELAY = 2min;
+/** Maximum number of transactions rejected for their feerate alone that are kept for a child to pay for them */
+static constexpr size_t MAX_FEE_REJECTED_PARENTS{100};
 /** Headers download timeout.
  *  Timeout = base + per_header * (expected number of headers) */
 static constexpr auto HEADERS_DOWNLOAD_TIMEOUT_BASE = 15min;
@@ -110,13 +123,23 @@ static constexpr auto OVERLOADED_PEER_TX_DELAY{2s};
 static constexpr auto GETDATA_TX_INTERVAL{60s};
 /** Limit to avoid sending big packets. Not used in processing incoming GETDATA for compatibility */
 static const unsigned int MAX_GETDATA_SZ = 1000;
-/** Number of blocks that can be requested at any given time from a single peer. */
+/** Number of blocks that can be requested at any given time from a single peer, before
+ *  its block download throughput is measured. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
-/** Time during which a peer must stall block download progress before being disconnected. */
+/** Upper bound on the blocks in transit from a peer whose throughput allows more. */
+static constexpr int MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER{1024};
+/** Weight of the newest sample in the smoothed block sizes and download throughputs */
+static constexpr double BLOCK_DOWNLOAD_SMOOTHING{0.1};
+/** Minimum time during which a peer must stall block download progress before being
+ *  disconnected, and the time allowed to a peer whose throughput is not measured yet. */
 static constexpr auto BLOCK_STALLING_TIMEOUT{2s};
+/** Maximum time allowed to a peer whose measured throughput needs longer for its blocks in flight */
+static constexpr auto MAX_BLOCK_STALLING_TIMEOUT{64s};
 /** Number of headers sent in one getheaders result. We rely on the assumption that if a peer sends
  *  less than this number, we reached its tip. Changing this value is a protocol upgrade. */
 static const unsigned int MAX_HEADERS_RESULTS = 2000;
+/** Serialized size of a block header, which BLOCK and CMPCTBLOCK messages start with */
+static constexpr size_t BLOCK_HEADER_SIZE{80};
 /** Maximum depth of blocks we're willing to serve as compact blocks to peers
  *  when requested. For older blocks, a regular BLOCK response will be sent. */
 static const int MAX_CMPCTBLOCK_DEPTH = 5;
@@ -124,9 +147,12 @@ static const int MAX_CMPCTBLOCK_DEPTH = 5;
 static const int MAX_BLOCKTXN_DEPTH = 10;
 /** Size of the "block download window": how far ahead of our current height do we fetch?
  *  Larger windows tolerate larger download speed differences between peer, but increase the potential
- *  degree of disordering of blocks on disk (which make reindexing and pruning harder). We'll probably
- *  want to make this a per-peer adaptive value at some point. */
+ *  degree of disordering of blocks on disk (which make reindexing and pruning harder). The window
+ *  spans BLOCK_DOWNLOAD_WINDOW_BYTES of blocks of the average size received, at least
+ *  BLOCK_DOWNLOAD_WINDOW and at most MAX_BLOCK_DOWNLOAD_WINDOW blocks. */
 static const unsigned int BLOCK_DOWNLOAD_WINDOW = 1024;
+static constexpr double BLOCK_DOWNLOAD_WINDOW_BYTES{128 << 20};
+static constexpr unsigned int MAX_BLOCK_DOWNLOAD_WINDOW{32768};
 /** Block download timeout base, expressed in multiples of the block interval (i.e. 10 min) */
 static constexpr double BLOCK_DOWNLOAD_TIMEOUT_BASE = 1;
 /** Additional block download timeout per parallel downloading peer (i.e. 5 min) */
@@ -183,6 +209,15 @@ static constexpr double MAX_ADDR_RATE_PER_SECOND{0.1};
 static constexpr size_t MAX_ADDR_PROCESSING_TOKEN_BUCKET{MAX_ADDR_TO_SEND};
 /** The compactblocks version we support. See BIP 152. */
 static constexpr uint64_t CMPCTBLOCKS_VERSION{2};
+/** Total size of the recently served blocks kept in their wire serialization */
+static constexpr size_t MAX_RAW_BLOCK_CACHE_BYTES{16 << 20};
+/** How long a served transaction is kept in its wire serialization for other peers requesting it */
+static constexpr auto TX_MSG_CACHE_LIFETIME{30s};
+/** Total size of the served transactions kept in their wire serialization */
+static constexpr size_t MAX_TX_MSG_CACHE_BYTES{8 << 20};
+/** Total size of the transactions we prefill in compact blocks besides the coinbase, beyond
+ *  which a getblocktxn round trip is cheaper than sending them to every high-bandwidth peer */
+static constexpr size_t MAX_CMPCTBLOCK_PREFILL_BYTES{10000};
 
 // Internal stuff
 namespace {
@@ -192,6 +227,8 @@ struct QueuedBlock {
     const CBlockIndex* pindex;
     /** Optional, used for CMPCTBLOCK downloads */
     std::unique_ptr<PartiallyDownloadedBlock> partialBlock;
+    /** When the block was requested */
+    std::chrono::microseconds m_requested{0us};
 };
 
 /**
@@ -392,6 +429,10 @@ struct Peer {
     /** Whether we've sent our peer a sendheaders message. **/
     std::atomic<bool> m_sent_sendheaders{false};
 
+    /** Time point to relay the current sync-checkpoint to this peer, if it
+     *  does not know it yet. Only accessed by SendMessages. */
+    std::chrono::microseconds m_next_checkpoint_send{0};
+
     explicit Peer(NodeId id, ServiceFlags our_services)
         : m_id{id}
         , m_our_services{our_services}
@@ -435,6 +476,10 @@ struct CNodeState {
     //! When the first entry in vBlocksInFlight started downloading. Don't care when vBlocksInFlight is empty.
     std::chrono::microseconds m_downloading_since{0us};
     int nBlocksInFlight{0};
+    //! Smoothed throughput of the blocks downloaded from this peer, or 0 before the first one.
+    double m_block_bytes_per_second{0};
+    //! When the last block requested from this peer arrived.
+    std::chrono::microseconds m_last_block_received{0us};
     //! Whether we consider this a preferred download peer.
     bool fPreferredDownload{false};
     //! Whether this peer wants invs or headers (when possible) for block announcements.
@@ -443,6 +488,11 @@ struct CNodeState {
     bool m_requested_hb_cmpctblocks{false};
     /** Whether this peer will send us cmpctblocks if we request them. */
     bool m_provides_cmpctblocks{false};
+    /** Compact blocks from this peer we reconstructed without a round trip, after requesting
+     *  missing transactions, or gave up on and downloaded in full. */
+    uint64_t m_cmpctblocks_reconstructed{0};
+    uint64_t m_cmpctblocks_reconstructed_after_request{0};
+    uint64_t m_cmpctblocks_failed{0};
 
     /** State used to enforce CHAIN_SYNC_TIMEOUT and EXTRA_PEER_CHECK_INTERVAL logic.
       *
@@ -498,7 +548,7 @@ class PeerManagerImpl final : public PeerManager
 public:
     PeerManagerImpl(CConnman& connman, AddrMan& addrman,
                     BanMan* banman, ChainstateManager& chainman,
-                    CTxMemPool& pool, bool ignore_incoming_txs);
+                    CTxMemPool& pool, Options opts);
 
     /** Overridden from CValidationInterface. */
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected) override
@@ -511,14 +561,16 @@ public:
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock) override
         EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+    std::string ValidationInterfaceName() const override { return "peerman"; }
 
     /** Implement NetEventsInterface */
     void InitializeNode(CNode& node, ServiceFlags our_services) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void FinalizeNode(const CNode& node) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_headers_presync_mutex);
     bool ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_tx_msg_cache_mutex);
     bool SendMessages(CNode* pto) override EXCLUSIVE_LOCKS_REQUIRED(pto->cs_sendProcessing)
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex);
+    std::function<void()> PrepareMessage(const CNode& node, const CNetMessage& msg) override;
 
     /** Implement PeerManager */
     void StartScheduledTasks(CScheduler& scheduler) override;
@@ -526,14 +578,14 @@ public:
     std::optional<std::string> FetchBlock(NodeId peer_id, const CBlockIndex& block_index) override
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     bool GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) const override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
-    bool IgnoresIncomingTxs() override { return m_ignore_incoming_txs; }
+    bool IgnoresIncomingTxs() override { return m_opts.ignore_incoming_txs; }
     void SendPings() override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void RelayTransaction(const uint256& txid, const uint256& wtxid) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
     void SetBestHeight(int height) override { m_best_height = height; };
     void UnitTestMisbehaving(NodeId peer_id, int howmuch) override EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex) { Misbehaving(*Assert(GetPeerRef(peer_id)), howmuch, ""); };
     void ProcessMessage(CNode& pfrom, const std::string& msg_type, CDataStream& vRecv,
                         const std::chrono::microseconds time_received, const std::atomic<bool>& interruptMsgProc) override
-        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex, !m_recent_confirmed_transactions_mutex, !m_most_recent_block_mutex, !m_headers_presync_mutex, !m_tx_msg_cache_mutex);
     void UpdateLastBlockAnnounceTime(NodeId node, int64_t time_in_seconds) override;
 
 private:
@@ -592,6 +644,21 @@ private:
 
     void ProcessOrphanTx(std::set<uint256>& orphan_work_set) EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans)
         EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
+
+    /**
+     * Try to accept a transaction along with parents whose feerate is too low
+     * on their own, and relay those that get into the mempool.
+     *
+     * @param[in]      package          The parents, sorted, followed by the child.
+     * @param[in]      peer             The peer that sent the last of them.
+     * @param[in,out]  orphan_work_set  The children in the orphanage of the accepted transactions are added to it.
+     * @return                          Whether all transactions of the package are in the mempool
+     */
+    bool ProcessPackage(const Package& package, NodeId peer, std::set<uint256>& orphan_work_set)
+        EXCLUSIVE_LOCKS_REQUIRED(cs_main, g_cs_orphans) EXCLUSIVE_LOCKS_REQUIRED(!m_peer_mutex);
+
+    /** Keep a transaction rejected for its feerate alone, for a child to pay for it. */
+    void AddFeeRejectedParent(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     /** Process a single headers message from a peer.
      *
      * @param[in]   pfrom     CNode of the peer
@@ -661,6 +728,10 @@ private:
      * This returns true if a getheaders is actually sent, and false otherwise.
      */
     bool MaybeSendGetHeaders(CNode& pfrom, const CBlockLocator& locator, Peer& peer);
+    /** Request the headers following a full batch before validating it, so that validation
+     *  overlaps with the round trip. Only done for continuous batches connecting to our block
+     *  index with enough work to skip the low-work headers sync. Returns true if sent. */
+    bool MaybePipelineGetHeaders(CNode& pfrom, Peer& peer, const std::vector<CBlockHeader>& headers);
     /** Potentially fetch blocks from this peer upon receipt of a new headers tip */
     void HeadersDirectFetchBlocks(CNode& pfrom, const Peer& peer, const CBlockIndex* pindexLast);
     /** Update peer state based on received headers message */
@@ -717,10 +788,16 @@ private:
     std::chrono::seconds m_stale_tip_check_time GUARDED_BY(cs_main){0s};
 
     /** Whether this node is running in -blocksonly mode */
-    const bool m_ignore_incoming_txs;
+    const Options m_opts;
 
     bool RejectIncomingTxs(const CNode& peer) const;
 
+    /** Reconciles transaction announcements with the peers supporting it, if enabled (BIP 330) */
+    std::unique_ptr<TxReconciliationTracker> m_txreconciliation;
+
+    /** Announce to a peer the transactions a reconciliation found it misses. */
+    void AnnounceReconciledTxs(CNode& node, Peer& peer, const std::vector<uint256>& wtxids) LOCKS_EXCLUDED(::cs_main);
+
     /** Whether we've completed initial sync yet, for determining when to turn
       * on extra block-relay-only peers. */
     bool m_initial_sync_finished GUARDED_BY(cs_main){false};
@@ -811,6 +888,16 @@ private:
     CRollingBloomFilter m_recent_rejects GUARDED_BY(::cs_main){120'000, 0.000'001};
     uint256 hashRecentRejectsChainTip GUARDED_BY(cs_main);
 
+    /**
+     * Transactions recently rejected for their feerate alone, by txid, and
+     * their wtxids. These are kept out of m_recent_rejects, which would make
+     * us drop a child that pays for its parent, so that the child can be
+     * accepted along with them as a package. Reset along with
+     * m_recent_rejects.
+     */
+    std::map<uint256, CTransactionRef> m_fee_rejected_parents GUARDED_BY(cs_main);
+    std::set<uint256> m_fee_rejected_wtxids GUARDED_BY(cs_main);
+
     /*
      * Filter for transactions that have been recently confirmed.
      * We use this to avoid requesting transactions that have already been
@@ -844,6 +931,10 @@ private:
     std::shared_ptr<const CBlock> m_most_recent_block GUARDED_BY(m_most_recent_block_mutex);
     std::shared_ptr<const CBlockHeaderAndShortTxIDs> m_most_recent_compact_block GUARDED_BY(m_most_recent_block_mutex);
     uint256 m_most_recent_block_hash GUARDED_BY(m_most_recent_block_mutex);
+    //! The compact block, serialized once with a shared payload for all peers it is announced to
+    CSerializedNetMsg m_most_recent_compact_block_msg GUARDED_BY(m_most_recent_block_mutex);
+    //! The witness block, serialized with a shared payload when a peer first requests it
+    CSerializedNetMsg m_most_recent_block_msg GUARDED_BY(m_most_recent_block_mutex);
 
     // Data about the low-work headers synchronization, aggregated from all peers' HeadersSyncStates.
     /** Mutex guarding the other m_headers_presync_* variables. */
@@ -888,6 +979,25 @@ private:
      */
     void FindNextBlocksToDownload(const Peer& peer, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, NodeId& nodeStaller) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
+    /** Add to vBlocks, until it has at most count entries, the not-in-flight blocks the background
+     *  chainstate of a snapshot needs after from_tip, up to BlockDownloadWindow() of them and
+     *  no further than target_block, the snapshot's base. Only peers whose best known block
+     *  descends from target_block are asked.
+     */
+    void TryDownloadingHistoricalBlocks(const Peer& peer, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, const CBlockIndex* from_tip, const CBlockIndex* target_block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** Update the download measurements with a block a peer sent us, if we requested it from them. */
+    void MeasureBlockDownload(NodeId nodeid, const uint256& hash, size_t block_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Number of blocks to keep in flight from a peer: twice its bandwidth-delay product. */
+    int BlocksInTransitLimit(const CNodeState& state, std::chrono::microseconds rtt) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** Number of blocks the download window spans ahead of the last block in common with a peer. */
+    unsigned int BlockDownloadWindow() const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /** How long a peer may stall the download window: twice what it should need for its blocks in flight. */
+    std::chrono::microseconds BlockStallingTimeout(const CNodeState& state, std::chrono::microseconds rtt) const EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** Smoothed size of the blocks received, or 0 before the first one. */
+    double m_block_size_estimate GUARDED_BY(cs_main){0};
+
     std::map<uint256, std::pair<NodeId, std::list<QueuedBlock>::iterator> > mapBlocksInFlight GUARDED_BY(cs_main);
 
     /** When our tip was last updated. */
@@ -897,7 +1007,7 @@ private:
     CTransactionRef FindTxForGetData(const CNode& peer, const GenTxid& gtxid, const std::chrono::seconds mempool_req, const std::chrono::seconds now) LOCKS_EXCLUDED(cs_main);
 
     void ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic<bool>& interruptMsgProc)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, peer.m_getdata_requests_mutex) LOCKS_EXCLUDED(::cs_main);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, !m_tx_msg_cache_mutex, peer.m_getdata_requests_mutex) LOCKS_EXCLUDED(::cs_main);
 
     /** Process a new block. Perform any post-processing housekeeping */
     void ProcessBlock(CNode& node, const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked);
@@ -927,12 +1037,20 @@ private:
 
     void AddToCompactExtraTransactions(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
 
+    /** Forget the extra transactions a block confirmed, so their slots take new ones. */
+    void RemoveCompactExtraTransactions(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(g_cs_orphans);
+
     /** Orphan/conflicted/etc transactions that are kept for compact block reconstruction.
      *  The last -blockreconstructionextratxn/DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN of
-     *  these are kept in a ring buffer */
+     *  these are kept in a ring buffer, whose slots freed by confirmed transactions are
+     *  filled first */
     std::vector<std::pair<uint256, CTransactionRef>> vExtraTxnForCompact GUARDED_BY(g_cs_orphans);
     /** Offset into vExtraTxnForCompact to insert the next tx */
     size_t vExtraTxnForCompactIt GUARDED_BY(g_cs_orphans) = 0;
+    /** Slot of each wtxid in vExtraTxnForCompact, to keep a transaction only once */
+    std::unordered_map<uint256, size_t, SaltedTxidHasher> m_extra_txn_slots GUARDED_BY(g_cs_orphans);
+    /** Slots of vExtraTxnForCompact freed by confirmed transactions */
+    std::vector<size_t> m_extra_txn_free_slots GUARDED_BY(g_cs_orphans);
 
     /** Check whether the last unknown block a peer advertised is not yet known. */
     void ProcessBlockAvailability(NodeId nodeid) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -949,7 +1067,40 @@ private:
     bool BlockRequestAllowed(const CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     bool AlreadyHaveBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
-        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex);
+        EXCLUSIVE_LOCKS_REQUIRED(!m_most_recent_block_mutex, !m_tx_msg_cache_mutex);
+
+    /** Answer a getheaders message in -headersonly mode, from the records of g_header_store. */
+    void ProcessGetHeadersFromStore(CNode& pfrom, const CBlockLocator& locator, const uint256& hash_stop)
+        EXCLUSIVE_LOCKS_REQUIRED(!cs_main);
+
+    /**
+     * Return the block of index serialized as sent in a block message, with
+     * or without witness data, from m_raw_block_cache or read from disk
+     * without deserializing it.
+     */
+    std::optional<node::RawBlock> GetRawBlock(const CBlockIndex& index, bool with_witness) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    /** Recently served blocks in their wire serialization, most recent first,
+     *  keyed by block hash and whether witness data is included. */
+    std::list<std::pair<std::pair<uint256, bool>, node::RawBlock>> m_raw_block_cache GUARDED_BY(cs_main);
+    /** Total size of the blocks in m_raw_block_cache */
+    size_t m_raw_block_cache_bytes GUARDED_BY(cs_main){0};
+
+    /**
+     * Return a tx message for a transaction, with or without witness data. The
+     * message is serialized once and its payload shared by all peers it is
+     * sent to within TX_MSG_CACHE_LIFETIME.
+     */
+    CSerializedNetMsg GetTxMessage(const CTransaction& tx, bool with_witness, std::chrono::seconds now)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_tx_msg_cache_mutex);
+
+    Mutex m_tx_msg_cache_mutex;
+    /** Recently served tx messages by wtxid, indexed by whether witness data is included */
+    std::unordered_map<uint256, std::array<CSerializedNetMsg, 2>, SaltedTxidHasher> m_tx_msg_cache GUARDED_BY(m_tx_msg_cache_mutex);
+    /** The wtxids of m_tx_msg_cache, in the order they were added, with the time they were added */
+    std::deque<std::pair<std::chrono::seconds, uint256>> m_tx_msg_cache_order GUARDED_BY(m_tx_msg_cache_mutex);
+    /** Total size of the payloads in m_tx_msg_cache */
+    size_t m_tx_msg_cache_bytes GUARDED_BY(m_tx_msg_cache_mutex){0};
 
     /**
      * Validation logic for compact filters request handling.
@@ -1151,7 +1302,7 @@ bool PeerManagerImpl::BlockRequested(NodeId nodeid, const CBlockIndex& block, st
     RemoveBlockRequest(hash);
 
     std::list<QueuedBlock>::iterator it = state->vBlocksInFlight.insert(state->vBlocksInFlight.end(),
-            {&block, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&m_mempool) : nullptr)});
+            {&block, std::unique_ptr<PartiallyDownloadedBlock>(pit ? new PartiallyDownloadedBlock(&m_mempool) : nullptr), GetTime<std::chrono::microseconds>()});
     state->nBlocksInFlight++;
     if (state->nBlocksInFlight == 1) {
         // We're starting a block download (batch) from this peer.
@@ -1172,7 +1323,7 @@ void PeerManagerImpl::MaybeSetPeerAsAnnouncingHeaderAndIDs(NodeId nodeid)
     // When in -blocksonly mode, never request high-bandwidth mode from peers. Our
     // mempool will not contain the transactions necessary to reconstruct the
     // compact block.
-    if (m_ignore_incoming_txs) return;
+    if (m_opts.ignore_incoming_txs) return;
 
     CNodeState* nodestate = State(nodeid);
     if (!nodestate || !nodestate->m_provides_cmpctblocks) {
@@ -1311,10 +1462,10 @@ void PeerManagerImpl::FindNextBlocksToDownload(const Peer& peer, unsigned int co
 
     std::vector<const CBlockIndex*> vToFetch;
     const CBlockIndex *pindexWalk = state->pindexLastCommonBlock;
-    // Never fetch further than the best block we know the peer has, or more than BLOCK_DOWNLOAD_WINDOW + 1 beyond the last
+    // Never fetch further than the best block we know the peer has, or more than BlockDownloadWindow() + 1 beyond the last
     // linked block we have in common with this peer. The +1 is so we can detect stalling, namely if we would be able to
     // download that next block if the window were 1 larger.
-    int nWindowEnd = state->pindexLastCommonBlock->nHeight + BLOCK_DOWNLOAD_WINDOW;
+    int nWindowEnd = state->pindexLastCommonBlock->nHeight + BlockDownloadWindow();
     int nMaxHeight = std::min<int>(state->pindexBestKnownBlock->nHeight, nWindowEnd + 1);
     NodeId waitingfor = -1;
     while (pindexWalk->nHeight < nMaxHeight) {
@@ -1367,6 +1518,84 @@ void PeerManagerImpl::FindNextBlocksToDownload(const Peer& peer, unsigned int co
     }
 }
 
+void PeerManagerImpl::TryDownloadingHistoricalBlocks(const Peer& peer, unsigned int count, std::vector<const CBlockIndex*>& vBlocks, const CBlockIndex* from_tip, const CBlockIndex* target_block)
+{
+    assert(from_tip);
+    assert(target_block);
+    if (vBlocks.size() >= count || from_tip->nHeight >= target_block->nHeight) return;
+
+    CNodeState* state = State(peer.m_id);
+    assert(state != nullptr);
+    if (state->pindexBestKnownBlock == nullptr || state->pindexBestKnownBlock->GetAncestor(target_block->nHeight) != target_block) {
+        // This peer cannot provide the blocks leading up to the snapshot.
+        return;
+    }
+
+    // The background chainstate connects these in order, so there is no point in fetching
+    // further ahead than the window the active chainstate uses
+    const CBlockIndex* window_end{target_block->GetAncestor(std::min<int>(from_tip->nHeight + BlockDownloadWindow(), target_block->nHeight))};
+    std::vector<const CBlockIndex*> to_fetch(window_end->nHeight - from_tip->nHeight);
+    for (const CBlockIndex* pindex{window_end}; pindex != from_tip; pindex = pindex->pprev) {
+        to_fetch[pindex->nHeight - from_tip->nHeight - 1] = pindex;
+    }
+    for (const CBlockIndex* pindex : to_fetch) {
+        if (!CanServeWitnesses(peer) && DeploymentActiveAt(*pindex, m_chainman, Consensus::DEPLOYMENT_SEGWIT)) {
+            // We wouldn't download this block or its descendants from this peer.
+            return;
+        }
+        if (pindex->nStatus & BLOCK_HAVE_DATA || IsBlockRequested(pindex->GetBlockHash())) continue;
+        vBlocks.push_back(pindex);
+        if (vBlocks.size() == count) return;
+    }
+}
+
+void PeerManagerImpl::MeasureBlockDownload(NodeId nodeid, const uint256& hash, size_t block_size)
+{
+    m_block_size_estimate = m_block_size_estimate > 0 ? (1 - BLOCK_DOWNLOAD_SMOOTHING) * m_block_size_estimate + BLOCK_DOWNLOAD_SMOOTHING * block_size : block_size;
+
+    const auto it{mapBlocksInFlight.find(hash)};
+    if (it == mapBlocksInFlight.end() || it->second.first != nodeid) return;
+    CNodeState* state{State(nodeid)};
+    assert(state != nullptr);
+    // A block requested while others were in flight waits for them, so it is only
+    // timed from the later of its request and the arrival of the previous one
+    const auto now{GetTime<std::chrono::microseconds>()};
+    const auto start{std::max(it->second.second->m_requested, state->m_last_block_received)};
+    state->m_last_block_received = now;
+    if (now <= start) return;
+    const double bytes_per_second{block_size / std::chrono::duration<double>(now - start).count()};
+    state->m_block_bytes_per_second = state->m_block_bytes_per_second > 0 ?
+        (1 - BLOCK_DOWNLOAD_SMOOTHING) * state->m_block_bytes_per_second + BLOCK_DOWNLOAD_SMOOTHING * bytes_per_second : bytes_per_second;
+}
+
+int PeerManagerImpl::BlocksInTransitLimit(const CNodeState& state, std::chrono::microseconds rtt) const
+{
+    if (state.m_block_bytes_per_second <= 0 || m_block_size_estimate <= 0 || rtt == std::chrono::microseconds::max()) {
+        return MAX_BLOCKS_IN_TRANSIT_PER_PEER;
+    }
+    // While the limit holds back a peer, its measured throughput is what the limit lets through,
+    // so doubling the product grows the limit until the link itself is the bottleneck
+    const double bdp_blocks{2 * state.m_block_bytes_per_second * std::chrono::duration<double>(rtt).count() / m_block_size_estimate};
+    return static_cast<int>(std::clamp<double>(bdp_blocks, MAX_BLOCKS_IN_TRANSIT_PER_PEER, MAX_ADAPTIVE_BLOCKS_IN_TRANSIT_PER_PEER));
+}
+
+unsigned int PeerManagerImpl::BlockDownloadWindow() const
+{
+    if (m_block_size_estimate <= 0) return BLOCK_DOWNLOAD_WINDOW;
+    return static_cast<unsigned int>(std::clamp<double>(BLOCK_DOWNLOAD_WINDOW_BYTES / m_block_size_estimate, BLOCK_DOWNLOAD_WINDOW, MAX_BLOCK_DOWNLOAD_WINDOW));
+}
+
+std::chrono::microseconds PeerManagerImpl::BlockStallingTimeout(const CNodeState& state, std::chrono::microseconds rtt) const
+{
+    if (state.m_block_bytes_per_second <= 0 || m_block_size_estimate <= 0 || rtt == std::chrono::microseconds::max()) {
+        return BLOCK_STALLING_TIMEOUT;
+    }
+    const std::chrono::duration<double> expected{std::chrono::duration<double>(rtt).count() +
+                                                 state.nBlocksInFlight * m_block_size_estimate / state.m_block_bytes_per_second};
+    return std::clamp<std::chrono::microseconds>(std::chrono::duration_cast<std::chrono::microseconds>(2 * expected),
+                                                 BLOCK_STALLING_TIMEOUT, MAX_BLOCK_STALLING_TIMEOUT);
+}
+
 } // namespace
 
 void PeerManagerImpl::PushNodeVersion(CNode& pnode, const Peer& peer)
@@ -1381,7 +1610,7 @@ void PeerManagerImpl::PushNodeVersion(CNode& pnode, const Peer& peer)
     CService addr_you = addr.IsRoutable() && !IsProxy(addr) && addr.IsAddrV1Compatible() ? addr : CService();
     uint64_t your_services{addr.nServices};
 
-    const bool tx_relay = !m_ignore_incoming_txs && !pnode.IsBlockOnlyConn() && !pnode.IsFeelerConn();
+    const bool tx_relay = !m_opts.ignore_incoming_txs && !pnode.IsBlockOnlyConn() && !pnode.IsFeelerConn();
     m_connman.PushMessage(&pnode, CNetMsgMaker(INIT_PROTO_VERSION).Make(NetMsgType::VERSION, PROTOCOL_VERSION, my_services, nTime,
             your_services, addr_you, // Together the pre-version-31402 serialization of CAddress "addrYou" (without nTime)
             my_services, CService(), // Together the pre-version-31402 serialization of CAddress "addrMe" (without nTime)
@@ -1484,6 +1713,7 @@ void PeerManagerImpl::FinalizeNode(const CNode& node)
         m_wtxid_relay_peers -= peer->m_wtxid_relay;
         assert(m_wtxid_relay_peers >= 0);
     }
+    if (m_txreconciliation) m_txreconciliation->ForgetPeer(nodeid);
     CNodeState *state = State(nodeid);
     assert(state != nullptr);
 
@@ -1556,6 +1786,9 @@ bool PeerManagerImpl::GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) c
             return false;
         stats.nSyncHeight = state->pindexBestKnownBlock ? state->pindexBestKnownBlock->nHeight : -1;
         stats.nCommonHeight = state->pindexLastCommonBlock ? state->pindexLastCommonBlock->nHeight : -1;
+        stats.m_cmpctblocks_reconstructed = state->m_cmpctblocks_reconstructed;
+        stats.m_cmpctblocks_reconstructed_after_request = state->m_cmpctblocks_reconstructed_after_request;
+        stats.m_cmpctblocks_failed = state->m_cmpctblocks_failed;
         for (const QueuedBlock& queue : state->vBlocksInFlight) {
             if (queue.pindex)
                 stats.vHeightInFlight.push_back(queue.pindex->nHeight);
@@ -1601,13 +1834,35 @@ bool PeerManagerImpl::GetNodeStateStats(NodeId nodeid, CNodeStateStats& stats) c
 
 void PeerManagerImpl::AddToCompactExtraTransactions(const CTransactionRef& tx)
 {
-    size_t max_extra_txn = gArgs.GetIntArg("-blockreconstructionextratxn", DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN);
-    if (max_extra_txn <= 0)
+    if (m_opts.max_extra_txs <= 0)
         return;
     if (!vExtraTxnForCompact.size())
-        vExtraTxnForCompact.resize(max_extra_txn);
-    vExtraTxnForCompact[vExtraTxnForCompactIt] = std::make_pair(tx->GetWitnessHash(), tx);
-    vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % max_extra_txn;
+        vExtraTxnForCompact.resize(m_opts.max_extra_txs);
+    const uint256& wtxid{tx->GetWitnessHash()};
+    if (m_extra_txn_slots.count(wtxid)) return;
+    size_t slot;
+    if (!m_extra_txn_free_slots.empty()) {
+        slot = m_extra_txn_free_slots.back();
+        m_extra_txn_free_slots.pop_back();
+    } else {
+        slot = vExtraTxnForCompactIt;
+        vExtraTxnForCompactIt = (vExtraTxnForCompactIt + 1) % m_opts.max_extra_txs;
+        if (vExtraTxnForCompact[slot].second) m_extra_txn_slots.erase(vExtraTxnForCompact[slot].first);
+    }
+    vExtraTxnForCompact[slot] = std::make_pair(wtxid, tx);
+    m_extra_txn_slots.emplace(wtxid, slot);
+}
+
+void PeerManagerImpl::RemoveCompactExtraTransactions(const CBlock& block)
+{
+    if (m_extra_txn_slots.empty()) return;
+    for (const auto& ptx : block.vtx) {
+        const auto it{m_extra_txn_slots.find(ptx->GetWitnessHash())};
+        if (it == m_extra_txn_slots.end()) continue;
+        vExtraTxnForCompact[it->second] = {};
+        m_extra_txn_free_slots.push_back(it->second);
+        m_extra_txn_slots.erase(it);
+    }
 }
 
 void PeerManagerImpl::Misbehaving(Peer& peer, int howmuch, const std::string& message)
@@ -1763,22 +2018,27 @@ std::optional<std::string> PeerManagerImpl::FetchBlock(NodeId peer_id, const CBl
 
 std::unique_ptr<PeerManager> PeerManager::make(CConnman& connman, AddrMan& addrman,
                                                BanMan* banman, ChainstateManager& chainman,
-                                               CTxMemPool& pool, bool ignore_incoming_txs)
+                                               CTxMemPool& pool, Options opts)
 {
-    return std::make_unique<PeerManagerImpl>(connman, addrman, banman, chainman, pool, ignore_incoming_txs);
+    return std::make_unique<PeerManagerImpl>(connman, addrman, banman, chainman, pool, opts);
 }
 
 PeerManagerImpl::PeerManagerImpl(CConnman& connman, AddrMan& addrman,
                                  BanMan* banman, ChainstateManager& chainman,
-                                 CTxMemPool& pool, bool ignore_incoming_txs)
+                                 CTxMemPool& pool, Options opts)
     : m_chainparams(chainman.GetParams()),
       m_connman(connman),
       m_addrman(addrman),
       m_banman(banman),
       m_chainman(chainman),
       m_mempool(pool),
-      m_ignore_incoming_txs(ignore_incoming_txs)
+      m_opts{opts}
 {
+    // While Erlay support is incomplete, it must be enabled explicitly via -txreconciliation.
+    // This argument can go away after Erlay support is complete.
+    if (opts.reconcile_txs) {
+        m_txreconciliation = std::make_unique<TxReconciliationTracker>(TXRECONCILIATION_VERSION);
+    }
 }
 
 void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
@@ -1803,6 +2063,7 @@ void PeerManagerImpl::StartScheduledTasks(CScheduler& scheduler)
 void PeerManagerImpl::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
     m_orphanage.EraseForBlock(*pblock);
+    WITH_LOCK(g_cs_orphans, RemoveCompactExtraTransactions(*pblock));
     m_last_tip_update = GetTime<std::chrono::seconds>();
 
     {
@@ -1843,7 +2104,23 @@ void PeerManagerImpl::BlockDisconnected(const std::shared_ptr<const CBlock> &blo
  */
 void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& pblock)
 {
-    auto pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs>(*pblock);
+    // Prefill the transactions that were not in our mempool, such as recent orphans and
+    // replaced transactions or ones we only learned from the block: peers reconstructing
+    // from their mempools most likely miss them too, and would need a round trip
+    std::vector<size_t> prefill;
+    size_t prefill_bytes{0};
+    {
+        LOCK(m_mempool.cs);
+        for (size_t i = 1; i < pblock->vtx.size(); ++i) {
+            const CTransaction& tx{*pblock->vtx[i]};
+            if (m_mempool.exists(GenTxid::Wtxid(tx.GetWitnessHash()))) continue;
+            const size_t tx_size{tx.GetTotalSize()};
+            if (prefill_bytes + tx_size > MAX_CMPCTBLOCK_PREFILL_BYTES) continue;
+            prefill_bytes += tx_size;
+            prefill.push_back(i);
+        }
+    }
+    auto pcmpctblock = std::make_shared<const CBlockHeaderAndShortTxIDs>(*pblock, prefill);
     const CNetMsgMaker msgMaker(PROTOCOL_VERSION);
 
     LOCK(cs_main);
@@ -1855,17 +2132,19 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
     if (!DeploymentActiveAt(*pindex, m_chainman, Consensus::DEPLOYMENT_SEGWIT)) return;
 
     uint256 hashBlock(pblock->GetHash());
-    const std::shared_future<CSerializedNetMsg> lazy_ser{
-        std::async(std::launch::deferred, [&] { return msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock); })};
+    CSerializedNetMsg ser_cmpctblock{msgMaker.Make(NetMsgType::CMPCTBLOCK, *pcmpctblock)};
+    ser_cmpctblock.SharePayload();
 
     {
         LOCK(m_most_recent_block_mutex);
         m_most_recent_block_hash = hashBlock;
         m_most_recent_block = pblock;
         m_most_recent_compact_block = pcmpctblock;
+        m_most_recent_compact_block_msg = ser_cmpctblock.Copy();
+        m_most_recent_block_msg = {};
     }
 
-    m_connman.ForEachNode([this, pindex, &lazy_ser, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
+    m_connman.ForEachNode([this, pindex, &ser_cmpctblock, &hashBlock](CNode* pnode) EXCLUSIVE_LOCKS_REQUIRED(::cs_main) {
         AssertLockHeld(::cs_main);
 
         if (pnode->GetCommonVersion() < INVALID_CB_NO_BAN_VERSION || pnode->fDisconnect)
@@ -1879,7 +2158,6 @@ void PeerManagerImpl::NewPoWValidBlock(const CBlockIndex *pindex, const std::sha
             LogPrint(BCLog::NET, "%s sending header-and-ids %s to peer=%d\n", "PeerManager::NewPoWValidBlock",
                     hashBlock.ToString(), pnode->GetId());
 
-            const CSerializedNetMsg& ser_cmpctblock{lazy_ser.get()};
             m_connman.PushMessage(pnode, ser_cmpctblock.Copy());
             state.pindexBestHeaderSent = pindex;
         }
@@ -1975,10 +2253,14 @@ bool PeerManagerImpl::AlreadyHaveTx(const GenTxid& gtxid)
         // txs a second chance.
         hashRecentRejectsChainTip = m_chainman.ActiveChain().Tip()->GetBlockHash();
         m_recent_rejects.reset();
+        m_fee_rejected_parents.clear();
+        m_fee_rejected_wtxids.clear();
     }
 
     const uint256& hash = gtxid.GetHash();
 
+    if (gtxid.IsWtxid() ? m_fee_rejected_wtxids.count(hash) : m_fee_rejected_parents.count(hash)) return true;
+
     if (m_orphanage.HaveTx(gtxid)) return true;
 
     {
@@ -2023,6 +2305,34 @@ void PeerManagerImpl::RelayTransaction(const uint256& txid, const uint256& wtxid
     };
 }
 
+void PeerManagerImpl::AnnounceReconciledTxs(CNode& node, Peer& peer, const std::vector<uint256>& wtxids)
+{
+    auto tx_relay = peer.GetTxRelay();
+    if (!tx_relay || wtxids.empty()) return;
+
+    std::vector<CInv> invs;
+    {
+        LOCK(cs_main);
+        LOCK(tx_relay->m_tx_inventory_mutex);
+        for (const uint256& wtxid : wtxids) {
+            if (tx_relay->m_tx_inventory_known_filter.contains(wtxid)) continue;
+            // Not in the mempool anymore? don't bother announcing it.
+            const auto txinfo{m_mempool.info(GenTxid::Wtxid(wtxid))};
+            if (!txinfo.tx) continue;
+            State(node.GetId())->m_recently_announced_invs.insert(wtxid);
+            tx_relay->m_tx_inventory_known_filter.insert(wtxid);
+            tx_relay->m_tx_inventory_known_filter.insert(txinfo.tx->GetHash());
+            invs.emplace_back(MSG_WTX, wtxid);
+        }
+    }
+
+    const CNetMsgMaker msgMaker(node.GetCommonVersion());
+    for (size_t i = 0; i < invs.size(); i += MAX_INV_SZ) {
+        const std::vector<CInv> chunk(invs.begin() + i, invs.begin() + std::min(invs.size(), i + MAX_INV_SZ));
+        m_connman.PushMessage(&node, msgMaker.Make(NetMsgType::INV, chunk));
+    }
+}
+
 void PeerManagerImpl::RelayAddress(NodeId originator,
                                    const CAddress& addr,
                                    bool fReachable)
@@ -2073,6 +2383,74 @@ void PeerManagerImpl::RelayAddress(NodeId originator,
     }
 }
 
+void PeerManagerImpl::ProcessGetHeadersFromStore(CNode& pfrom, const CBlockLocator& locator, const uint256& hash_stop)
+{
+    const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
+    int height{-1};
+    const CBlockIndex* best_header;
+    {
+        LOCK(cs_main);
+        // Blocks are not connected in -headersonly mode, so the best header
+        // chain is the one that has to have the work, see below.
+        best_header = m_chainman.m_best_header;
+        if (best_header == nullptr ||
+                (best_header->nChainWork < nMinimumChainWork && !pfrom.HasPermission(NetPermissionFlags::Download))) {
+            LogPrint(BCLog::NET, "Ignoring getheaders from peer=%d because best header chain has too little work; sending empty response\n", pfrom.GetId());
+            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::HEADERS, std::vector<CBlock>()));
+            return;
+        }
+        if (locator.IsNull()) {
+            // If locator is null, return the hashStop header
+            const CBlockIndex* pindex{m_chainman.m_blockman.LookupBlockIndex(hash_stop)};
+            if (!pindex || !g_header_store->Contains(pindex->nHeight, hash_stop)) return;
+            height = pindex->nHeight;
+        } else {
+            // Continue after the last header the caller has in the store, or
+            // after genesis if it has none of them
+            height = 1;
+            for (const uint256& hash : locator.vHave) {
+                const CBlockIndex* pindex{m_chainman.m_blockman.LookupBlockIndex(hash)};
+                if (pindex && g_header_store->Contains(pindex->nHeight, hash)) {
+                    height = pindex->nHeight + 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    // Copy the headers straight from the records, each followed by the 0x00
+    // nTx count that a serialized CBlock would have
+    std::vector<unsigned char> records;
+    const size_t count{g_header_store->Read(height, locator.IsNull() ? 1 : MAX_HEADERS_RESULTS, records)};
+    LogPrint(BCLog::NET, "getheaders %d to %s from peer=%d\n", count ? height : -1, hash_stop.IsNull() ? "end" : hash_stop.ToString(), pfrom.GetId());
+    std::vector<unsigned char> payload;
+    payload.reserve(9 + count * (HeaderStore::HEADER_SIZE + 1));
+    size_t sent{0};
+    uint256 last_hash;
+    while (sent < count) {
+        const unsigned char* header{records.data() + sent * HeaderStore::RECORD_SIZE};
+        payload.insert(payload.end(), header, header + HeaderStore::HEADER_SIZE);
+        payload.push_back(0);
+        last_hash = Hash(Span{header, HeaderStore::HEADER_SIZE});
+        ++sent;
+        if (last_hash == hash_stop) break;
+    }
+    std::vector<unsigned char> message;
+    CVectorWriter writer{SER_NETWORK, PROTOCOL_VERSION, message, 0};
+    WriteCompactSize(writer, sent);
+    message.insert(message.end(), payload.begin(), payload.end());
+
+    {
+        LOCK(cs_main);
+        // As in the getheaders handling from the block index, reset the best
+        // header sent to the last one sent, or to the best header if the
+        // peer has all of them already.
+        const CBlockIndex* last_sent{sent ? m_chainman.m_blockman.LookupBlockIndex(last_hash) : nullptr};
+        State(pfrom.GetId())->pindexBestHeaderSent = last_sent ? last_sent : best_header;
+    }
+    m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::HEADERS, Span<const unsigned char>{message}));
+}
+
 void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv& inv)
 {
     std::shared_ptr<const CBlock> a_recent_block;
@@ -2140,16 +2518,18 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         return;
     }
     std::shared_ptr<const CBlock> pblock;
+    // Compact blocks are not made for old blocks; the full block is sent instead.
+    const bool send_compact{inv.IsMsgCmpctBlk() && CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH};
+    std::optional<node::RawBlock> raw_block;
     if (a_recent_block && a_recent_block->GetHash() == pindex->GetBlockHash()) {
         pblock = a_recent_block;
-    } else if (inv.IsMsgWitnessBlk()) {
-        // Fast-path: in this case it is possible to serve the block directly from disk,
-        // as the network format matches the format on disk
-        std::vector<uint8_t> block_data;
-        if (!ReadRawBlockFromDisk(block_data, pindex->GetBlockPos(), m_chainparams.MessageStart())) {
-            assert(!"cannot load block from disk");
-        }
-        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, Span{block_data}));
+    } else if (auto recent_block{m_chainman.m_blockman.GetRecentBlock(pindex->GetBlockHash())}) {
+        pblock = std::move(recent_block);
+    } else if ((inv.IsMsgBlk() || inv.IsMsgWitnessBlk() || (inv.IsMsgCmpctBlk() && !send_compact)) &&
+               (raw_block = GetRawBlock(*pindex, /*with_witness=*/!inv.IsMsgBlk()))) {
+        // Fast-path: serve the block as stored on disk, without deserializing it,
+        // with the witness data cut out for a non-witness block request
+        m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, raw_block->data));
         // Don't set pblock as we've sent the block
     } else {
         // Send block from disk
@@ -2163,7 +2543,23 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
         if (inv.IsMsgBlk()) {
             m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::BLOCK, *pblock));
         } else if (inv.IsMsgWitnessBlk()) {
-            m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            // Every peer fetching the most recent block shares one serialization of it
+            std::optional<CSerializedNetMsg> cached_block_msg;
+            if (pblock == a_recent_block) {
+                LOCK(m_most_recent_block_mutex);
+                if (m_most_recent_block == pblock) {
+                    if (!m_most_recent_block_msg.m_shared_payload) {
+                        m_most_recent_block_msg = msgMaker.Make(NetMsgType::BLOCK, *pblock);
+                        m_most_recent_block_msg.SharePayload();
+                    }
+                    cached_block_msg = m_most_recent_block_msg.Copy();
+                }
+            }
+            if (cached_block_msg.has_value()) {
+                m_connman.PushMessage(&pfrom, std::move(cached_block_msg.value()));
+            } else {
+                m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::BLOCK, *pblock));
+            }
         } else if (inv.IsMsgFilteredBlk()) {
             bool sendMerkleBlock = false;
             CMerkleBlock merkleBlock;
@@ -2182,9 +2578,10 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
                 // they must either disconnect and retry or request the full block.
                 // Thus, the protocol spec specified allows for us to provide duplicate txn here,
                 // however we MUST always provide at least what the remote peer needs
+                const auto now{GetTime<std::chrono::seconds>()};
                 typedef std::pair<unsigned int, uint256> PairType;
                 for (PairType& pair : merkleBlock.vMatchedTxn)
-                    m_connman.PushMessage(&pfrom, msgMaker.Make(SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, *pblock->vtx[pair.first]));
+                    m_connman.PushMessage(&pfrom, GetTxMessage(*pblock->vtx[pair.first], /*with_witness=*/false, now));
             }
             // else
             // no response
@@ -2193,8 +2590,17 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
             // they won't have a useful mempool to match against a compact block,
             // and we don't feel like constructing the object for them, so
             // instead we respond with the full, non-compact block.
-            if (CanDirectFetch() && pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_CMPCTBLOCK_DEPTH) {
+            if (send_compact) {
+                std::optional<CSerializedNetMsg> cached_cmpctblock_msg;
                 if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
+                    LOCK(m_most_recent_block_mutex);
+                    if (m_most_recent_compact_block == a_recent_compact_block) {
+                        cached_cmpctblock_msg = m_most_recent_compact_block_msg.Copy();
+                    }
+                }
+                if (cached_cmpctblock_msg.has_value()) {
+                    m_connman.PushMessage(&pfrom, std::move(cached_cmpctblock_msg.value()));
+                } else if (a_recent_compact_block && a_recent_compact_block->header.GetHash() == pindex->GetBlockHash()) {
                     m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::CMPCTBLOCK, *a_recent_compact_block));
                 } else {
                     CBlockHeaderAndShortTxIDs cmpctblock{*pblock};
@@ -2221,6 +2627,37 @@ void PeerManagerImpl::ProcessGetBlockData(CNode& pfrom, Peer& peer, const CInv&
     }
 }
 
+std::optional<node::RawBlock> PeerManagerImpl::GetRawBlock(const CBlockIndex& index, bool with_witness)
+{
+    AssertLockHeld(cs_main);
+    const std::pair<uint256, bool> key{index.GetBlockHash(), with_witness};
+    const auto it{std::find_if(m_raw_block_cache.begin(), m_raw_block_cache.end(), [&](const auto& entry) { return entry.first == key; })};
+    if (it != m_raw_block_cache.end()) {
+        m_raw_block_cache.splice(m_raw_block_cache.begin(), m_raw_block_cache, it);
+        return it->second;
+    }
+
+    node::RawBlock block;
+    if (!ReadRawBlockFromDisk(block, index.GetBlockPos(), m_chainparams.MessageStart())) {
+        assert(!"cannot load block from disk");
+    }
+    if (!with_witness) {
+        auto stripped{node::StripRawBlockWitness(block)};
+        if (!stripped) return std::nullopt;
+        block = std::move(*stripped);
+    }
+
+    if (block.data.size() <= MAX_RAW_BLOCK_CACHE_BYTES) {
+        m_raw_block_cache.emplace_front(key, block);
+        m_raw_block_cache_bytes += block.data.size();
+        while (m_raw_block_cache_bytes > MAX_RAW_BLOCK_CACHE_BYTES) {
+            m_raw_block_cache_bytes -= m_raw_block_cache.back().second.data.size();
+            m_raw_block_cache.pop_back();
+        }
+    }
+    return block;
+}
+
 CTransactionRef PeerManagerImpl::FindTxForGetData(const CNode& peer, const GenTxid& gtxid, const std::chrono::seconds mempool_req, const std::chrono::seconds now)
 {
     auto txinfo = m_mempool.info(gtxid);
@@ -2248,6 +2685,31 @@ CTransactionRef PeerManagerImpl::FindTxForGetData(const CNode& peer, const GenTx
     return {};
 }
 
+CSerializedNetMsg PeerManagerImpl::GetTxMessage(const CTransaction& tx, bool with_witness, std::chrono::seconds now)
+{
+    LOCK(m_tx_msg_cache_mutex);
+    // Forget the transactions served too long ago, and the oldest ones while the cache is too big
+    while (!m_tx_msg_cache_order.empty() &&
+           (m_tx_msg_cache_order.front().first + TX_MSG_CACHE_LIFETIME < now || m_tx_msg_cache_bytes > MAX_TX_MSG_CACHE_BYTES)) {
+        const auto it{m_tx_msg_cache.find(m_tx_msg_cache_order.front().second)};
+        for (const CSerializedNetMsg& msg : it->second) {
+            if (msg.m_shared_payload) m_tx_msg_cache_bytes -= msg.m_shared_payload->data.size();
+        }
+        m_tx_msg_cache.erase(it);
+        m_tx_msg_cache_order.pop_front();
+    }
+
+    const auto [it, inserted]{m_tx_msg_cache.try_emplace(tx.GetWitnessHash())};
+    if (inserted) m_tx_msg_cache_order.emplace_back(now, tx.GetWitnessHash());
+    CSerializedNetMsg& msg{it->second[with_witness]};
+    if (!msg.m_shared_payload) {
+        msg = CNetMsgMaker(PROTOCOL_VERSION).Make(with_witness ? 0 : SERIALIZE_TRANSACTION_NO_WITNESS, NetMsgType::TX, tx);
+        msg.SharePayload();
+        m_tx_msg_cache_bytes += msg.m_shared_payload->data.size();
+    }
+    return msg.Copy();
+}
+
 void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic<bool>& interruptMsgProc)
 {
     AssertLockNotHeld(cs_main);
@@ -2282,8 +2744,7 @@ void PeerManagerImpl::ProcessGetData(CNode& pfrom, Peer& peer, const std::atomic
         CTransactionRef tx = FindTxForGetData(pfrom, ToGenTxid(inv), mempool_req, now);
         if (tx) {
             // WTX and WITNESS_TX imply we serialize with witness
-            int nSendFlags = (inv.IsMsgTx() ? SERIALIZE_TRANSACTION_NO_WITNESS : 0);
-            m_connman.PushMessage(&pfrom, msgMaker.Make(nSendFlags, NetMsgType::TX, *tx));
+            m_connman.PushMessage(&pfrom, GetTxMessage(*tx, /*with_witness=*/!inv.IsMsgTx(), now));
             m_mempool.RemoveUnbroadcastTx(tx->GetHash());
             // As we're going to send tx, make sure its unconfirmed parents are made requestable.
             std::vector<uint256> parent_ids_to_add;
@@ -2563,7 +3024,7 @@ bool PeerManagerImpl::TryLowWorkHeadersSync(Peer& peer, CNode& pfrom, const CBlo
             // advancing to the first unknown header would be a small effect.
             LOCK(peer.m_headers_sync_mutex);
             peer.m_headers_sync.reset(new HeadersSyncState(peer.m_id, m_chainparams.GetConsensus(),
-                chain_start_header, minimum_chain_work));
+                m_chainparams.HeadersSync(), chain_start_header, minimum_chain_work));
 
             // Now a HeadersSyncState object for tracking this synchronization is created,
             // process the headers using it as normal.
@@ -2614,6 +3075,29 @@ bool PeerManagerImpl::MaybeSendGetHeaders(CNode& pfrom, const CBlockLocator& loc
     return false;
 }
 
+bool PeerManagerImpl::MaybePipelineGetHeaders(CNode& pfrom, Peer& peer, const std::vector<CBlockHeader>& headers)
+{
+    if (WITH_LOCK(peer.m_headers_sync_mutex, return peer.m_headers_sync != nullptr)) return false;
+    if (!CheckHeadersAreContinuous(headers)) return false;
+
+    CBlockLocator locator;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* chain_start{m_chainman.m_blockman.LookupBlockIndex(headers[0].hashPrevBlock)};
+        if (!chain_start) return false;
+        if (chain_start->nChainWork + CalculateHeadersWork(headers) < GetAntiDoSWorkThreshold() &&
+            !pfrom.HasPermission(NetPermissionFlags::NoBan)) {
+            return false;
+        }
+        locator = GetLocator(chain_start);
+    }
+    // The peer continues after the last header it sent, which we have not accepted yet
+    locator.vHave.insert(locator.vHave.begin(), headers.back().GetHash());
+    if (!MaybeSendGetHeaders(pfrom, locator, peer)) return false;
+    LogPrint(BCLog::NET, "pipelined getheaders after %s to peer=%d\n", headers.back().GetHash().ToString(), pfrom.GetId());
+    return true;
+}
+
 /*
  * Given a new headers tip ending in pindexLast, potentially request blocks towards that tip.
  * We require that the given tip have at least as much work as our tip, and for
@@ -2621,6 +3105,9 @@ bool PeerManagerImpl::MaybeSendGetHeaders(CNode& pfrom, const CBlockLocator& loc
  */
 void PeerManagerImpl::HeadersDirectFetchBlocks(CNode& pfrom, const Peer& peer, const CBlockIndex* pindexLast)
 {
+    // Blocks are not downloaded in -headersonly mode
+    if (g_header_store) return;
+
     const CNetMsgMaker msgMaker(pfrom.GetCommonVersion());
 
     LOCK(cs_main);
@@ -2667,7 +3154,7 @@ void PeerManagerImpl::HeadersDirectFetchBlocks(CNode& pfrom, const Peer& peer, c
                         pindexLast->GetBlockHash().ToString(), pindexLast->nHeight);
             }
             if (vGetData.size() > 0) {
-                if (!m_ignore_incoming_txs &&
+                if (!m_opts.ignore_incoming_txs &&
                         nodestate->m_provides_cmpctblocks &&
                         vGetData.size() == 1 &&
                         mapBlocksInFlight.size() == 1 &&
@@ -2762,6 +3249,19 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, Peer& peer,
         return;
     }
 
+    // If these headers continue a low-work headers sync, the exact target of
+    // each of them is known, and checking that is far cheaper than checking
+    // their proof of work. Reject a batch with a bad target before hashing it.
+    const bool invalid_targets{WITH_LOCK(peer.m_headers_sync_mutex,
+            return peer.m_headers_sync && CheckHeadersAreContinuous(headers) && !peer.m_headers_sync->HasValidTargets(headers))};
+    if (invalid_targets) {
+        Misbehaving(peer, 100, "header with invalid difficulty target");
+        return;
+    }
+
+    // Ask for the next batch before spending the NeoScrypt cost of checking this one
+    const bool pipelined{nCount == MAX_HEADERS_RESULTS && MaybePipelineGetHeaders(pfrom, peer, headers)};
+
     // Before we do any processing, make sure these pass basic sanity checks.
     // We'll rely on headers having valid proof-of-work further down, as an
     // anti-DoS criteria (note: this check is required before passing any
@@ -2872,7 +3372,7 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, Peer& peer,
     Assume(pindexLast);
 
     // Consider fetching more headers if we are not using our headers-sync mechanism.
-    if (nCount == MAX_HEADERS_RESULTS && !have_headers_sync) {
+    if (nCount == MAX_HEADERS_RESULTS && !have_headers_sync && !pipelined) {
         // Headers message had its maximum size; the peer may have more headers.
         if (MaybeSendGetHeaders(pfrom, GetLocator(pindexLast), peer)) {
             LogPrint(BCLog::NET, "more getheaders (%d) to end to peer=%d (startheight:%d)\n",
@@ -2888,6 +3388,60 @@ void PeerManagerImpl::ProcessHeadersMessage(CNode& pfrom, Peer& peer,
     return;
 }
 
+/** Whether a transaction was only rejected because its feerate is too low. */
+static bool IsFeeRejection(const TxValidationState& state)
+{
+    return state.GetResult() == TxValidationResult::TX_MEMPOOL_POLICY &&
+           (state.GetRejectReason() == "min relay fee not met" || state.GetRejectReason() == "mempool min fee not met");
+}
+
+void PeerManagerImpl::AddFeeRejectedParent(const CTransactionRef& tx)
+{
+    AssertLockHeld(cs_main);
+    // As for the transactions for compact blocks, keep the memory bounded.
+    if (RecursiveDynamicUsage(*tx) >= 100000) return;
+    if (m_fee_rejected_parents.size() >= MAX_FEE_REJECTED_PARENTS) {
+        // Evict the one with the lowest txid, which is as good as a random one.
+        auto it = m_fee_rejected_parents.begin();
+        m_fee_rejected_wtxids.erase(it->second->GetWitnessHash());
+        m_fee_rejected_parents.erase(it);
+    }
+    if (m_fee_rejected_parents.emplace(tx->GetHash(), tx).second) {
+        m_fee_rejected_wtxids.insert(tx->GetWitnessHash());
+    }
+}
+
+bool PeerManagerImpl::ProcessPackage(const Package& package, NodeId peer, std::set<uint256>& orphan_work_set)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(g_cs_orphans);
+
+    const PackageMempoolAcceptResult result{ProcessNewPackage(m_chainman.ActiveChainstate(), m_mempool, package, /*test_accept=*/false)};
+    bool all_accepted{result.m_state.IsValid()};
+    for (const CTransactionRef& tx : package) {
+        const auto it{result.m_tx_results.find(tx->GetWitnessHash())};
+        if (it == result.m_tx_results.end() || it->second.m_result_type == MempoolAcceptResult::ResultType::INVALID) {
+            all_accepted = false;
+            continue;
+        }
+        if (it->second.m_result_type == MempoolAcceptResult::ResultType::VALID) {
+            LogPrint(BCLog::MEMPOOL, "   accepted %s in a package from peer=%d\n", tx->GetHash().ToString(), peer);
+            RelayTransaction(tx->GetHash(), tx->GetWitnessHash());
+        }
+        m_txrequest.ForgetTxHash(tx->GetHash());
+        m_txrequest.ForgetTxHash(tx->GetWitnessHash());
+        m_orphanage.AddChildrenToWorkSet(*tx, orphan_work_set);
+        m_orphanage.EraseTx(tx->GetHash());
+        m_fee_rejected_wtxids.erase(tx->GetWitnessHash());
+        m_fee_rejected_parents.erase(tx->GetHash());
+    }
+    if (!all_accepted) {
+        LogPrint(BCLog::MEMPOOLREJ, "package of %s from peer=%d was not accepted: %s\n", package.back()->GetHash().ToString(),
+                 peer, result.m_state.ToString());
+    }
+    return all_accepted;
+}
+
 /**
  * Reconsider orphan transactions after a parent has been accepted to the mempool.
  *
@@ -3252,8 +3806,6 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::SENDADDRV2));
         }
 
-        m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::VERACK));
-
         pfrom.m_has_all_wanted_services = HasAllDesirableServiceFlags(nServices);
         peer->m_their_services = nServices;
         pfrom.SetAddrLocal(addrMe);
@@ -3277,6 +3829,24 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             if (fRelay) pfrom.m_relays_txs = true;
         }
 
+        if (greatest_common_version >= WTXID_RELAY_VERSION && m_txreconciliation) {
+            // Per BIP-330, we announce txreconciliation support if:
+            // - protocol version per the peer's VERSION message supports WTXID_RELAY;
+            // - transaction relay is supported per the peer's VERSION message;
+            // - this is not a block-relay-only connection and not a feeler;
+            // - this is not an addr fetch connection;
+            // - we are not in -blocksonly mode.
+            const auto* tx_relay = peer->GetTxRelay();
+            if (tx_relay && WITH_LOCK(tx_relay->m_bloom_filter_mutex, return tx_relay->m_relay_txs) &&
+                !pfrom.IsAddrFetchConn() && !pfrom.IsFeelerConn() && !m_opts.ignore_incoming_txs) {
+                const uint64_t recon_salt = m_txreconciliation->PreRegisterPeer(pfrom.GetId());
+                m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::SENDTXRCNCL,
+                                                             TXRECONCILIATION_VERSION, recon_salt));
+            }
+        }
+
+        m_connman.PushMessage(&pfrom, msg_maker.Make(NetMsgType::VERACK));
+
         // Potentially mark this peer as a preferred download peer.
         {
             LOCK(cs_main);
@@ -3343,13 +3913,6 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             m_addrman.Good(pfrom.addr);
         }
 
-        // Relay sync-checkpoint
-        {
-            LOCK(cs_hashSyncCheckpoint);
-            if (!checkpointMessage.IsNull())
-                checkpointMessage.RelayTo(&pfrom);
-        }
-
         std::string remoteAddr;
         if (fLogIPs)
             remoteAddr = ", peeraddr=" + pfrom.addr.ToString();
@@ -3426,6 +3989,15 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                        tx_relay->m_next_inv_send_time == 0s));
         }
 
+        if (m_txreconciliation) {
+            if (!peer->m_wtxid_relay || !m_txreconciliation->IsPeerRegistered(pfrom.GetId())) {
+                // We could have optimistically pre-registered/registered the peer. In that case,
+                // we should forget about the reconciliation state here if this wasn't followed
+                // by WTXIDRELAY (since WTXIDRELAY can't be announced later).
+                m_txreconciliation->ForgetPeer(pfrom.GetId());
+            }
+        }
+
         pfrom.fSuccessfullyConnected = true;
         return;
     }
@@ -3489,11 +4061,104 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         return;
     }
 
+    // Received from a peer demonstrating readiness to announce transactions via reconciliations.
+    // This feature negotiation must happen between VERSION and VERACK to avoid relay problems
+    // from switching announcement protocols after the connection is up.
+    if (msg_type == NetMsgType::SENDTXRCNCL) {
+        if (!m_txreconciliation) {
+            LogPrint(BCLog::NET, "sendtxrcncl from peer=%d ignored, as our node does not have txreconciliation enabled\n", pfrom.GetId());
+            return;
+        }
+
+        if (pfrom.fSuccessfullyConnected) {
+            LogPrint(BCLog::NET, "sendtxrcncl received after verack from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+
+        // Peer must not offer us reconciliations if we specified no tx relay support in VERSION.
+        if (RejectIncomingTxs(pfrom)) {
+            LogPrint(BCLog::NET, "sendtxrcncl received from peer=%d to which we indicated no tx relay; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+
+        // Peer must not offer us reconciliations if they specified no tx relay support in VERSION.
+        // This flag might also be false in other cases, but the RejectIncomingTxs check above
+        // eliminates them, so that this flag fully represents what we are looking for.
+        const auto* tx_relay = peer->GetTxRelay();
+        if (!tx_relay || !WITH_LOCK(tx_relay->m_bloom_filter_mutex, return tx_relay->m_relay_txs)) {
+            LogPrint(BCLog::NET, "sendtxrcncl received from peer=%d which indicated no tx relay to us; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+
+        uint32_t peer_txreconcl_version;
+        uint64_t remote_salt;
+        vRecv >> peer_txreconcl_version >> remote_salt;
+
+        const ReconciliationRegisterResult result = m_txreconciliation->RegisterPeer(pfrom.GetId(), pfrom.IsInboundConn(),
+                                                                                     peer_txreconcl_version, remote_salt);
+        switch (result) {
+        case ReconciliationRegisterResult::NOT_FOUND:
+            LogPrint(BCLog::NET, "Ignore unexpected txreconciliation signal from peer=%d\n", pfrom.GetId());
+            break;
+        case ReconciliationRegisterResult::SUCCESS:
+            break;
+        case ReconciliationRegisterResult::ALREADY_REGISTERED:
+            LogPrint(BCLog::NET, "txreconciliation protocol violation from peer=%d (sendtxrcncl received from already registered peer); disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        case ReconciliationRegisterResult::PROTOCOL_VIOLATION:
+            LogPrint(BCLog::NET, "txreconciliation protocol violation from peer=%d; disconnecting\n", pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+        return;
+    }
+
     if (!pfrom.fSuccessfullyConnected) {
         LogPrint(BCLog::NET, "Unsupported message \"%s\" prior to verack from peer=%d\n", SanitizeString(msg_type), pfrom.GetId());
         return;
     }
 
+    if (msg_type == NetMsgType::REQRECON || msg_type == NetMsgType::SKETCH || msg_type == NetMsgType::RECONCILDIFF) {
+        if (!m_txreconciliation || !m_txreconciliation->IsPeerRegistered(pfrom.GetId())) {
+            LogPrint(BCLog::NET, "%s received from peer=%d we do not reconcile transactions with; disconnecting\n", msg_type, pfrom.GetId());
+            pfrom.fDisconnect = true;
+            return;
+        }
+
+        bool valid{false};
+        std::vector<uint256> txs_to_announce;
+        if (msg_type == NetMsgType::REQRECON) {
+            uint16_t peer_set_size, peer_q;
+            vRecv >> peer_set_size >> peer_q;
+            std::vector<unsigned char> skdata;
+            valid = m_txreconciliation->HandleReconciliationRequest(pfrom.GetId(), peer_set_size, peer_q, skdata);
+            if (valid) m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::SKETCH, skdata));
+        } else if (msg_type == NetMsgType::SKETCH) {
+            std::vector<unsigned char> skdata;
+            vRecv >> skdata;
+            bool success;
+            std::vector<uint32_t> txs_to_request;
+            valid = m_txreconciliation->HandleSketch(pfrom.GetId(), skdata, success, txs_to_announce, txs_to_request);
+            if (valid) m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::RECONCILDIFF, uint8_t{success}, txs_to_request));
+        } else {
+            uint8_t success;
+            std::vector<uint32_t> ask_shortids;
+            vRecv >> success >> ask_shortids;
+            valid = m_txreconciliation->HandleReconciliationDifference(pfrom.GetId(), success, ask_shortids, txs_to_announce);
+        }
+        if (!valid) {
+            LogPrint(BCLog::NET, "txreconciliation protocol violation from peer=%d (%s); disconnecting\n", pfrom.GetId(), msg_type);
+            pfrom.fDisconnect = true;
+            return;
+        }
+        AnnounceReconciledTxs(pfrom, *peer, txs_to_announce);
+        return;
+    }
+
     if (msg_type == NetMsgType::ADDR || msg_type == NetMsgType::ADDRV2) {
         int stream_version = vRecv.GetVersion();
         if (msg_type == NetMsgType::ADDRV2) {
@@ -3643,6 +4308,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 LogPrint(BCLog::NET, "got inv: %s  %s peer=%d\n", inv.ToString(), fAlreadyHave ? "have" : "new", pfrom.GetId());
 
                 AddKnownTx(*peer, inv.hash);
+                if (m_txreconciliation && gtxid.IsWtxid()) m_txreconciliation->TryRemovingFromSet(pfrom.GetId(), inv.hash);
                 if (!fAlreadyHave && !m_chainman.ActiveChainstate().IsInitialBlockDownload()) {
                     AddTxAnnouncement(pfrom, gtxid, current_time);
                 }
@@ -3799,11 +4465,10 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             }
 
             if (pindex->nHeight >= m_chainman.ActiveChain().Height() - MAX_BLOCKTXN_DEPTH) {
-                CBlock block;
-                bool ret = ReadBlockFromDisk(block, pindex, m_chainparams.GetConsensus());
-                assert(ret);
+                const std::shared_ptr<const CBlock> block{m_chainman.m_blockman.ReadBlock(*pindex, m_chainparams.GetConsensus())};
+                assert(block);
 
-                SendBlockTransactions(pfrom, *peer, block, req);
+                SendBlockTransactions(pfrom, *peer, *block, req);
                 return;
             }
         }
@@ -3838,6 +4503,11 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             return;
         }
 
+        if (g_header_store) {
+            ProcessGetHeadersFromStore(pfrom, locator, hashStop);
+            return;
+        }
+
         LOCK(cs_main);
 
         // Note that if we were to be on a chain that forks from the checkpointed
@@ -4007,6 +4677,22 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             }
             std::sort(unique_parents.begin(), unique_parents.end());
             unique_parents.erase(std::unique(unique_parents.begin(), unique_parents.end()), unique_parents.end());
+
+            // Parents rejected for their feerate alone may get in along with this transaction.
+            Package package;
+            for (const uint256& parent_txid : unique_parents) {
+                const auto it{m_fee_rejected_parents.find(parent_txid)};
+                if (it != m_fee_rejected_parents.end()) package.push_back(it->second);
+            }
+            if (!package.empty()) {
+                package.push_back(ptx);
+                if (ProcessPackage(package, pfrom.GetId(), peer->m_orphan_work_set)) {
+                    pfrom.m_last_tx_time = GetTime<std::chrono::seconds>();
+                    ProcessOrphanTx(peer->m_orphan_work_set);
+                    return;
+                }
+            }
+
             for (const uint256& parent_txid : unique_parents) {
                 if (m_recent_rejects.contains(parent_txid)) {
                     fRejectedParents = true;
@@ -4036,8 +4722,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 m_txrequest.ForgetTxHash(tx.GetWitnessHash());
 
                 // DoS prevention: do not allow m_orphanage to grow unbounded (see CVE-2012-3789)
-                unsigned int nMaxOrphanTx = (unsigned int)std::max((int64_t)0, gArgs.GetIntArg("-maxorphantx", DEFAULT_MAX_ORPHAN_TRANSACTIONS));
-                m_orphanage.LimitOrphans(nMaxOrphanTx);
+                m_orphanage.LimitOrphans(m_opts.max_orphan_txs);
             } else {
                 LogPrint(BCLog::MEMPOOL, "not keeping orphan with rejected parents %s\n",tx.GetHash().ToString());
                 // We will continue to reject this tx since it has rejected
@@ -4051,6 +4736,22 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 m_txrequest.ForgetTxHash(tx.GetHash());
                 m_txrequest.ForgetTxHash(tx.GetWitnessHash());
             }
+        } else if (IsFeeRejection(state)) {
+            // A child of this transaction in the orphanage may pay for it.
+            std::set<uint256> children;
+            m_orphanage.AddChildrenToWorkSet(tx, children);
+            for (const uint256& child_txid : children) {
+                const CTransactionRef child{m_orphanage.GetTx(child_txid).first};
+                if (child && ProcessPackage({ptx, child}, pfrom.GetId(), peer->m_orphan_work_set)) {
+                    pfrom.m_last_tx_time = GetTime<std::chrono::seconds>();
+                    ProcessOrphanTx(peer->m_orphan_work_set);
+                    return;
+                }
+            }
+            // Otherwise one may still arrive, so do not add it to m_recent_rejects.
+            AddFeeRejectedParent(ptx);
+            m_txrequest.ForgetTxHash(tx.GetHash());
+            m_txrequest.ForgetTxHash(tx.GetWitnessHash());
         } else {
             if (state.GetResult() != TxValidationResult::TX_WITNESS_STRIPPED) {
                 // We can add the wtxid of this transaction to our reject filter.
@@ -4155,6 +4856,9 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             }
         }
 
+        // Only the header is of use in -headersonly mode
+        if (g_header_store) return;
+
         // When we succeed in decoding a block's txids from a cmpctblock
         // message we typically jump to the BLOCKTXN handling code, with a
         // dummy (empty) BLOCKTXN message, to re-use the logic there in
@@ -4232,6 +4936,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                     return;
                 } else if (status == READ_STATUS_FAILED) {
                     // Duplicate txindexes, the block is now in-flight, so just request it
+                    ++nodestate->m_cmpctblocks_failed;
                     std::vector<CInv> vInv(1);
                     vInv[0] = CInv(MSG_BLOCK | GetFetchFlags(*peer), cmpctblock.header.GetHash());
                     m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::GETDATA, vInv));
@@ -4268,6 +4973,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 std::vector<CTransactionRef> dummy;
                 status = tempBlock.FillBlock(*pblock, dummy);
                 if (status == READ_STATUS_OK) {
+                    ++nodestate->m_cmpctblocks_reconstructed;
                     fBlockReconstructed = true;
                 }
             }
@@ -4359,6 +5065,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 return;
             } else if (status == READ_STATUS_FAILED) {
                 // Might have collided, fall back to getdata now :(
+                ++State(pfrom.GetId())->m_cmpctblocks_failed;
                 std::vector<CInv> invs;
                 invs.push_back(CInv(MSG_BLOCK | GetFetchFlags(*peer), resp.blockhash));
                 m_connman.PushMessage(&pfrom, msgMaker.Make(NetMsgType::GETDATA, invs));
@@ -4382,6 +5089,9 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
                 // updated, etc.
                 RemoveBlockRequest(resp.blockhash); // it is now an empty pointer
                 fBlockRead = true;
+                // No transactions were missing if the compact block handler jumped here
+                CNodeState& nodestate{*State(pfrom.GetId())};
+                ++(resp.txn.empty() ? nodestate.m_cmpctblocks_reconstructed : nodestate.m_cmpctblocks_reconstructed_after_request);
                 // mapBlockSource is used for potentially punishing peers and
                 // updating which peers send us compact blocks, so the race
                 // between here and cs_main in ProcessNewBlock is fine.
@@ -4450,12 +5160,13 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
 
     if (msg_type == NetMsgType::BLOCK)
     {
-        // Ignore block received while importing
-        if (fImporting || fReindex) {
+        // Ignore block received while importing, or that were never requested in -headersonly mode
+        if (fImporting || fReindex || g_header_store) {
             LogPrint(BCLog::NET, "Unexpected block message received from peer %d\n", pfrom.GetId());
             return;
         }
 
+        const size_t block_size{vRecv.size()};
         std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
         vRecv >> *pblock;
 
@@ -4469,6 +5180,7 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
             // Always process the block if we requested it, since we may
             // need it even when it's not a candidate for a new best tip.
             forceProcessing = IsBlockRequested(hash);
+            MeasureBlockDownload(pfrom.GetId(), hash, block_size);
             RemoveBlockRequest(hash);
             // mapBlockSource is only used for punishing peers and setting
             // which peers send us compact blocks, so the race between here and
@@ -4629,14 +5341,9 @@ void PeerManagerImpl::ProcessMessage(CNode& pfrom, const std::string& msg_type,
         CSyncCheckpoint checkpoint;
         vRecv >> checkpoint;
 
+        // Accepted checkpoints are relayed to the other peers by SendMessages
         if (checkpoint.ProcessSyncCheckpoint(m_chainman))
-        {
-            // Relay checkpoint
             pfrom.hashCheckpointKnown = checkpoint.hashCheckpoint;
-            m_connman.ForEachNode([checkpoint](CNode* pnode) {
-                checkpoint.RelayTo(pnode);
-            });
-        }
         return;
     }
 
@@ -4859,7 +5566,7 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
         msg.m_recv.data()
     );
 
-    if (gArgs.GetBoolArg("-capturemessages", false)) {
+    if (m_opts.capture_messages) {
         CaptureMessage(pfrom->addr, msg.m_type, MakeUCharSpan(msg.m_recv), /*is_incoming=*/true);
     }
 
@@ -4881,6 +5588,40 @@ bool PeerManagerImpl::ProcessMessages(CNode* pfrom, std::atomic<bool>& interrupt
     return fMoreWork;
 }
 
+std::function<void()> PeerManagerImpl::PrepareMessage(const CNode& node, const CNetMessage& msg)
+{
+    // Hash the proof of work of received headers ahead of processing them,
+    // so the NeoScrypt cost of one peer's headers doesn't hold up the others
+    if (msg.m_type == NetMsgType::HEADERS) {
+        return [payload = CDataStream{msg.m_recv}]() mutable {
+            std::vector<CBlockHeader> headers;
+            try {
+                const uint64_t count{ReadCompactSize(payload)};
+                if (count > MAX_HEADERS_RESULTS) return;
+                headers.resize(count);
+                for (CBlockHeader& header : headers) {
+                    payload >> header;
+                    ReadCompactSize(payload); // ignore tx count; assume it is 0.
+                }
+            } catch (const std::exception&) {
+                // Leave malformed messages to ProcessMessage
+                return;
+            }
+            std::vector<uint256> pow_hashes(headers.size());
+            GetPoWHashesCached(headers.data(), headers.size(), pow_hashes.data());
+        };
+    }
+    if ((msg.m_type == NetMsgType::BLOCK || msg.m_type == NetMsgType::CMPCTBLOCK) && msg.m_recv.size() >= BLOCK_HEADER_SIZE) {
+        // Only copy the header, which both messages start with
+        return [payload = CDataStream{Span{msg.m_recv}.first(BLOCK_HEADER_SIZE), msg.m_recv.GetType(), msg.m_recv.GetVersion()}]() mutable {
+            CBlockHeader header;
+            payload >> header;
+            GetPoWHashCached(header);
+        };
+    }
+    return {};
+}
+
 void PeerManagerImpl::ConsiderEviction(CNode& pto, Peer& peer, std::chrono::seconds time_in_seconds)
 {
     AssertLockHeld(cs_main);
@@ -5204,7 +5945,7 @@ void PeerManagerImpl::MaybeSendSendHeaders(CNode& node, Peer& peer)
 
 void PeerManagerImpl::MaybeSendFeefilter(CNode& pto, Peer& peer, std::chrono::microseconds current_time)
 {
-    if (m_ignore_incoming_txs) return;
+    if (m_opts.ignore_incoming_txs) return;
     if (pto.GetCommonVersion() < FEEFILTER_VERSION) return;
     // peers with the forcerelay permission should not filter txs to us
     if (pto.HasPermission(NetPermissionFlags::ForceRelay)) return;
@@ -5271,7 +6012,7 @@ bool PeerManagerImpl::RejectIncomingTxs(const CNode& peer) const
     // block-relay-only peers may never send txs to us
     if (peer.IsBlockOnlyConn()) return true;
     // In -blocksonly mode, peers need the 'relay' permission to send txs to us
-    if (m_ignore_incoming_txs && !peer.HasPermission(NetPermissionFlags::Relay)) return true;
+    if (m_opts.ignore_incoming_txs && !peer.HasPermission(NetPermissionFlags::Relay)) return true;
     return false;
 }
 
@@ -5462,16 +6203,15 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                     {
                         LOCK(m_most_recent_block_mutex);
                         if (m_most_recent_block_hash == pBestIndex->GetBlockHash()) {
-                            cached_cmpctblock_msg = msgMaker.Make(NetMsgType::CMPCTBLOCK, *m_most_recent_compact_block);
+                            cached_cmpctblock_msg = m_most_recent_compact_block_msg.Copy();
                         }
                     }
                     if (cached_cmpctblock_msg.has_value()) {
                         m_connman.PushMessage(pto, std::move(cached_cmpctblock_msg.value()));
                     } else {
-                        CBlock block;
-                        bool ret = ReadBlockFromDisk(block, pBestIndex, consensusParams);
-                        assert(ret);
-                        CBlockHeaderAndShortTxIDs cmpctblock{block};
+                        const std::shared_ptr<const CBlock> block{m_chainman.m_blockman.ReadBlock(*pBestIndex, consensusParams)};
+                        assert(block);
+                        CBlockHeaderAndShortTxIDs cmpctblock{*block};
                         m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::CMPCTBLOCK, cmpctblock));
                     }
                     state.pindexBestHeaderSent = pBestIndex;
@@ -5518,6 +6258,22 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
             peer->m_blocks_for_headers_relay.clear();
         }
 
+        //
+        // Message: checkpoint
+        //
+        // Sent on the same Poisson schedule as transaction inventory, so a new
+        // checkpoint does not fan out to all peers at once.
+        if (const auto relay{GetSyncCheckpointRelay()};
+            relay && pto->hashCheckpointKnown != relay->hashCheckpoint && peer->m_next_checkpoint_send < current_time) {
+            pto->hashCheckpointKnown = relay->hashCheckpoint;
+            m_connman.PushMessage(pto, relay->msg.Copy());
+            if (pto->IsInboundConn()) {
+                peer->m_next_checkpoint_send = NextInvToInbounds(current_time, INBOUND_INVENTORY_BROADCAST_INTERVAL);
+            } else {
+                peer->m_next_checkpoint_send = GetExponentialRand(current_time, OUTBOUND_INVENTORY_BROADCAST_INTERVAL);
+            }
+        }
+
         //
         // Message: inventory
         //
@@ -5628,6 +6384,11 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
                             continue;
                         }
                         if (tx_relay->m_bloom_filter && !tx_relay->m_bloom_filter->IsRelevantAndUpdate(*txinfo.tx)) continue;
+                        // Reconciling peers learn of most transactions by reconciliation; only a few are flooded to them
+                        if (m_txreconciliation && peer->m_wtxid_relay && !m_txreconciliation->ShouldFanoutTo(wtxid, pto->GetId()) &&
+                            m_txreconciliation->AddToSet(pto->GetId(), wtxid)) {
+                            continue;
+                        }
                         // Send
                         State(pto->GetId())->m_recently_announced_invs.insert(hash);
                         vInv.push_back(inv);
@@ -5669,8 +6430,16 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
         if (!vInv.empty())
             m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::INV, vInv));
 
-        // Detect whether we're stalling
-        if (state.m_stalling_since.count() && state.m_stalling_since < current_time - BLOCK_STALLING_TIMEOUT) {
+        // Start a reconciliation of transaction announcements when one is due
+        if (m_txreconciliation) {
+            if (const auto request{m_txreconciliation->InitiateReconciliationRequest(pto->GetId(), current_time)}) {
+                m_connman.PushMessage(pto, msgMaker.Make(NetMsgType::REQRECON, request->first, request->second));
+            }
+        }
+
+        // Detect whether we're stalling, allowing for the time our measurements say the peer needs
+        const std::chrono::microseconds rtt{pto->m_min_ping_time.load()};
+        if (state.m_stalling_since.count() && state.m_stalling_since < current_time - BlockStallingTimeout(state, rtt)) {
             // Stalling only triggers when the block download window cannot move. During normal steady state,
             // the download window should be much larger than the to-be-downloaded set of blocks, so disconnection
             // should only happen during initial block download.
@@ -5733,10 +6502,17 @@ bool PeerManagerImpl::SendMessages(CNode* pto)
         // Message: getdata (blocks)
         //
         std::vector<CInv> vGetData;
-        if (CanServeBlocks(*peer) && ((sync_blocks_and_headers_from_peer && !IsLimitedPeer(*peer)) || !m_chainman.ActiveChainstate().IsInitialBlockDownload()) && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
+        const int max_blocks_in_transit{BlocksInTransitLimit(state, rtt)};
+        if (!g_header_store && CanServeBlocks(*peer) && ((sync_blocks_and_headers_from_peer && !IsLimitedPeer(*peer)) || !m_chainman.ActiveChainstate().IsInitialBlockDownload()) && state.nBlocksInFlight < max_blocks_in_transit) {
             std::vector<const CBlockIndex*> vToDownload;
             NodeId staller = -1;
-            FindNextBlocksToDownload(*peer, MAX_BLOCKS_IN_TRANSIT_PER_PEER - state.nBlocksInFlight, vToDownload, staller);
+            FindNextBlocksToDownload(*peer, max_blocks_in_transit - state.nBlocksInFlight, vToDownload, staller);
+            // Leave what the tip does not need to the background chainstate of a snapshot, from
+            // peers that keep the whole chain
+            if (const Chainstate* background{m_chainman.BackgroundSyncChainstate()}; background && !IsLimitedPeer(*peer)) {
+                TryDownloadingHistoricalBlocks(*peer, max_blocks_in_transit - state.nBlocksInFlight, vToDownload,
+                                               background->m_chain.Tip(), Assert(m_chainman.GetSnapshotBaseBlock()));
+            }
             for (const CBlockIndex *pindex : vToDownload) {
                 uint32_t nFetchFlags = GetFetchFlags(*peer);
                 vGetData.push_back(CInv(MSG_BLOCK | nFetchFlags, pindex->GetBlockHash()));
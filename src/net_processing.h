@@ -7,6 +7,7 @@
 #define BITCOIN_NET_PROCESSING_H
 
 #include <net.h>
+#include <node/txreconciliation.h>
 #include <validationinterface.h>
 
 class AddrMan;
@@ -16,8 +17,9 @@ class ChainstateManager;
 
 /** Default for -maxorphantx, maximum number of orphan transactions kept in memory */
 static const unsigned int DEFAULT_MAX_ORPHAN_TRANSACTIONS = 100;
-/** Default number of orphan+recently-replaced txn to keep around for block reconstruction */
-static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 100;
+/** Default number of orphan+recently-replaced txn to keep around for block reconstruction,
+ *  sized for the replacements seen between one-minute blocks */
+static const unsigned int DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN = 300;
 static const bool DEFAULT_PEERBLOOMFILTERS = false;
 static const bool DEFAULT_PEERBLOCKFILTERS = false;
 /** Threshold for marking a node to be discouraged, e.g. disconnected and added to the discouragement filter. */
@@ -36,6 +38,9 @@ struct CNodeStateStats {
     bool m_addr_relay_enabled{false};
     ServiceFlags their_services;
     int64_t presync_height{-1};
+    uint64_t m_cmpctblocks_reconstructed{0};
+    uint64_t m_cmpctblocks_reconstructed_after_request{0};
+    uint64_t m_cmpctblocks_failed{0};
 };
 
 class CConnman;
@@ -43,9 +48,23 @@ class CConnman;
 class PeerManager : public CValidationInterface, public NetEventsInterface
 {
 public:
+    /** Configuration of PeerManager, read once at startup rather than while processing messages. */
+    struct Options {
+        //! Whether this node is running in -blocksonly mode
+        bool ignore_incoming_txs{DEFAULT_BLOCKSONLY};
+        //! Whether transaction reconciliation (Erlay) is enabled (-txreconciliation)
+        bool reconcile_txs{DEFAULT_TXRECONCILIATION_ENABLE};
+        //! Maximum number of orphan transactions kept in memory (-maxorphantx)
+        uint32_t max_orphan_txs{DEFAULT_MAX_ORPHAN_TRANSACTIONS};
+        //! Number of extra transactions kept for compact block reconstruction (-blockreconstructionextratxn)
+        size_t max_extra_txs{DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN};
+        //! Whether received messages are captured to disk (-capturemessages)
+        bool capture_messages{false};
+    };
+
     static std::unique_ptr<PeerManager> make(CConnman& connman, AddrMan& addrman,
                                              BanMan* banman, ChainstateManager& chainman,
-                                             CTxMemPool& pool, bool ignore_incoming_txs);
+                                             CTxMemPool& pool, Options opts);
     virtual ~PeerManager() { }
 
     /**
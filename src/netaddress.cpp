@@ -1068,6 +1068,31 @@ bool CSubNet::Match(const CNetAddr &addr) const
     return true;
 }
 
+size_t CSubNet::GetPrefixBits() const
+{
+    // GetAddrBytes() prefixes IPv4 addresses with the IPv4-mapped IPv6 range
+    const size_t skipped_bits{8 * (network.GetAddrBytes().size() - network.m_addr.size())};
+    switch (network.m_net) {
+    case NET_IPV4:
+    case NET_IPV6: {
+        size_t cidr{0};
+        for (size_t i = 0; i < network.m_addr.size() && netmask[i] != 0x00; ++i) {
+            cidr += NetmaskBits(netmask[i]);
+        }
+        return skipped_bits + cidr;
+    }
+    case NET_ONION:
+    case NET_I2P:
+    case NET_CJDNS:
+    case NET_INTERNAL:
+        return skipped_bits + 8 * network.m_addr.size();
+    case NET_UNROUTABLE:
+    case NET_MAX:
+        return 0;
+    } // no default case, so the compiler can warn about missing cases
+    assert(false);
+}
+
 std::string CSubNet::ToString() const
 {
     std::string suffix;
@@ -508,6 +508,15 @@ public:
 
     bool Match(const CNetAddr& addr) const;
 
+    /** The (normalized) network start of this subnet. */
+    const CNetAddr& GetNetworkAddr() const { return network; }
+
+    /**
+     * Number of leading bits of GetNetworkAddr().GetAddrBytes() that an address of the same
+     * network must share to Match() this subnet.
+     */
+    size_t GetPrefixBits() const;
+
     std::string ToString() const;
     bool IsValid() const;
 
@@ -106,6 +106,6 @@ uint32_t NetGroupManager::GetMappedAS(const CNetAddr& address) const
             }
         }
     }
-    uint32_t mapped_as = Interpret(m_asmap, ip_bits);
+    uint32_t mapped_as = m_compiled_asmap.Interpret(ip_bits);
     return mapped_as;
 }
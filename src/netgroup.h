@@ -7,6 +7,7 @@
 
 #include <netaddress.h>
 #include <uint256.h>
+#include <util/asmap.h>
 
 #include <vector>
 
@@ -16,7 +17,7 @@
 class NetGroupManager {
 public:
     explicit NetGroupManager(std::vector<bool> asmap)
-        : m_asmap{std::move(asmap)}
+        : m_asmap{std::move(asmap)}, m_compiled_asmap{m_asmap}
     {}
 
     /** Get a checksum identifying the asmap being used. */
@@ -61,6 +62,9 @@ private:
      * This is initialized in the constructor, const, and therefore is
      * thread-safe. */
     const std::vector<bool> m_asmap;
+
+    /** m_asmap decoded once, to look up addresses without decoding it again. */
+    const CompiledAsmap m_compiled_asmap;
 };
 
 #endif // BITCOIN_NETGROUP_H
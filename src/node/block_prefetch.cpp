@@ -0,0 +1,144 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/block_prefetch.h>
+
+#include <chain.h>
+#include <flatfile.h>
+#include <logging.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <tinyformat.h>
+#include <util/thread.h>
+#include <validation.h>
+
+#include <utility>
+
+namespace node {
+BlockPrefetcher::BlockPrefetcher(ChainstateManager& chainman, int num_threads)
+    : m_chainman{chainman}
+{
+    for (int i = 0; i < num_threads; ++i) {
+        m_threads.emplace_back(&util::TraceThread, strprintf("blkprefetch.%i", i), [this] { ThreadRead(); });
+    }
+}
+
+BlockPrefetcher::~BlockPrefetcher()
+{
+    WITH_LOCK(m_mutex, m_stop = true);
+    m_cond.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+std::shared_ptr<const CBlock> BlockPrefetcher::ReadBlock(const CBlockIndex& index) const
+{
+    FlatFilePos pos;
+    bool check_pow{true};
+    {
+        LOCK(cs_main);
+        pos = index.GetBlockPos();
+        check_pow = !index.IsValid(BLOCK_VALID_TREE);
+    }
+    auto block{std::make_shared<CBlock>()};
+    if (!ReadBlockFromDisk(*block, pos, m_chainman.GetConsensus(), check_pow)) return nullptr;
+    if (block->GetHash() != index.GetBlockHash()) {
+        LogPrintf("ERROR: %s: GetHash() doesn't match index for %s at %s\n", __func__, index.ToString(), pos.ToString());
+        return nullptr;
+    }
+    return block;
+}
+
+void BlockPrefetcher::ThreadRead()
+{
+    WAIT_LOCK(m_mutex, lock);
+    while (true) {
+        m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) { return !m_queue.empty() || m_stop; });
+        if (m_stop) return;
+        const uint256 hash{m_queue.front()};
+        m_queue.pop_front();
+        const auto it{m_entries.find(hash)};
+        // The entry may have been read by a consumer that could not wait for it
+        if (it == m_entries.end() || it->second.done) continue;
+        const CBlockIndex& index{*it->second.index};
+        std::shared_ptr<const CBlock> block;
+        {
+            REVERSE_LOCK(lock);
+            block = ReadBlock(index);
+        }
+        Done(hash, std::move(block));
+        m_cond.notify_all();
+    }
+}
+
+void BlockPrefetcher::Done(const uint256& hash, std::shared_ptr<const CBlock> block)
+{
+    AssertLockHeld(m_mutex);
+    const auto it{m_entries.find(hash)};
+    if (it == m_entries.end() || it->second.done) return;
+    it->second.done = true;
+    it->second.block = std::move(block);
+    m_done.push_back(hash);
+    while (m_done.size() > MAX_PREFETCHED_BLOCKS) {
+        m_entries.erase(m_done.front());
+        m_done.pop_front();
+    }
+}
+
+std::shared_ptr<const CBlock> BlockPrefetcher::GetBlock(const uint256& hash, size_t window)
+{
+    // Find the block and the ones to read ahead of the consumer
+    std::vector<std::pair<uint256, const CBlockIndex*>> blocks;
+    {
+        LOCK(cs_main);
+        const CBlockIndex* index{m_chainman.m_blockman.LookupBlockIndex(hash)};
+        if (!index || !(index->nStatus & BLOCK_HAVE_DATA)) return nullptr;
+        blocks.emplace_back(hash, index);
+        const CChain& active{m_chainman.ActiveChain()};
+        if (active.Contains(index)) {
+            for (const CBlockIndex* next{active.Next(index)}; next && blocks.size() <= window; next = active.Next(next)) {
+                if (!(next->nStatus & BLOCK_HAVE_DATA)) break;
+                blocks.emplace_back(next->GetBlockHash(), next);
+            }
+        }
+    }
+    if (m_threads.empty()) return ReadBlock(*blocks.front().second);
+
+    WAIT_LOCK(m_mutex, lock);
+    bool queued{false};
+    for (const auto& [block_hash, index] : blocks) {
+        if (m_entries.try_emplace(block_hash, Entry{index, /*done=*/false, /*block=*/nullptr}).second) {
+            m_queue.push_back(block_hash);
+            queued = true;
+        }
+    }
+    if (queued) m_cond.notify_all();
+
+    // Wait for the block, reading it here if no thread started on it yet
+    auto it{m_entries.find(hash)};
+    if (!it->second.done && !m_queue.empty() && m_queue.front() == hash) {
+        m_queue.pop_front();
+        const CBlockIndex& index{*it->second.index};
+        std::shared_ptr<const CBlock> block;
+        {
+            REVERSE_LOCK(lock);
+            block = ReadBlock(index);
+        }
+        Done(hash, block);
+        m_cond.notify_all();
+        return block;
+    }
+    m_cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_mutex) {
+        it = m_entries.find(hash);
+        return it == m_entries.end() || it->second.done;
+    });
+    if (it == m_entries.end()) {
+        // Dropped by others reading beyond MAX_PREFETCHED_BLOCKS meanwhile
+        REVERSE_LOCK(lock);
+        return ReadBlock(*blocks.front().second);
+    }
+    return it->second.block;
+}
+} // namespace node
@@ -0,0 +1,83 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCK_PREFETCH_H
+#define BITCOIN_NODE_BLOCK_PREFETCH_H
+
+#include <sync.h>
+#include <uint256.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+class CBlock;
+class CBlockIndex;
+class ChainstateManager;
+
+namespace node {
+//! Threads reading blocks ahead of their consumers
+static constexpr int DEFAULT_BLOCK_PREFETCH_THREADS{2};
+//! Blocks kept once read, for the consumers that have yet to get them
+static constexpr size_t MAX_PREFETCHED_BLOCKS{64};
+
+/**
+ * Reads blocks ahead of the consumers that scan the active chain, like wallet
+ * rescans, so that reading a block from disk overlaps with inspecting the
+ * ones before it. A consumer gets a block with the blocks that follow it in
+ * the active chain being read meanwhile, up to a window of them.
+ *
+ * Blocks are kept by hash while being read and once read, up to
+ * MAX_PREFETCHED_BLOCKS of them, so that consumers scanning the same blocks,
+ * like the rescans of several wallets, share one read of each.
+ *
+ * The proof of work of the blocks read is not computed again, as with
+ * -trustindexedblockpow: each is checked to have the hash of its block index
+ * entry, whose header passed the check when it was added to the index.
+ */
+class BlockPrefetcher
+{
+public:
+    BlockPrefetcher(ChainstateManager& chainman, int num_threads);
+    ~BlockPrefetcher();
+
+    /**
+     * Get the block with the given hash, and start reading the up to window
+     * blocks after it in the active chain. Returns nullptr if the block is
+     * unknown or cannot be read.
+     */
+    std::shared_ptr<const CBlock> GetBlock(const uint256& hash, size_t window) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    struct Entry {
+        const CBlockIndex* index;
+        bool done{false};
+        //! The block read, or nullptr if it could not be read
+        std::shared_ptr<const CBlock> block;
+    };
+
+    /** Read the block of an index entry, checking it has the hash of the entry. Returns nullptr if it cannot be read. */
+    std::shared_ptr<const CBlock> ReadBlock(const CBlockIndex& index) const;
+    void ThreadRead() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Note that the entry for hash was read, dropping the oldest blocks read beyond MAX_PREFETCHED_BLOCKS. */
+    void Done(const uint256& hash, std::shared_ptr<const CBlock> block) EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+
+    ChainstateManager& m_chainman;
+    Mutex m_mutex;
+    std::condition_variable m_cond;
+    std::map<uint256, Entry> m_entries GUARDED_BY(m_mutex);
+    //! Blocks to read, in the order their consumers need them
+    std::deque<uint256> m_queue GUARDED_BY(m_mutex);
+    //! Blocks read, the oldest first
+    std::deque<uint256> m_done GUARDED_BY(m_mutex);
+    bool m_stop GUARDED_BY(m_mutex){false};
+    std::vector<std::thread> m_threads;
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCK_PREFETCH_H
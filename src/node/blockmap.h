@@ -0,0 +1,185 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_BLOCKMAP_H
+#define BITCOIN_NODE_BLOCKMAP_H
+
+#include <chain.h>
+#include <memusage.h>
+#include <uint256.h>
+#include <util/hasher.h>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace node {
+/**
+ * Map of block hash to CBlockIndex, with the subset of the std::unordered_map
+ * interface used for the block index.
+ *
+ * Entries, each a block hash and its CBlockIndex, are stored one after the
+ * other in fixed-size chunks that are never moved or freed before the map,
+ * so pointers to them stay valid. They are found through a separate open
+ * addressing table of 32-bit entry numbers. Compared to a node-based map this
+ * avoids a heap allocation, a next pointer and a bucket pointer per entry,
+ * and keeps entries that were created together, such as a chain of headers,
+ * next to each other in memory. Entries cannot be removed.
+ *
+ * Iteration is in insertion order.
+ */
+class BlockMap
+{
+public:
+    using key_type = uint256;
+    using mapped_type = CBlockIndex;
+    using value_type = std::pair<const uint256, CBlockIndex>;
+
+private:
+    //! Entries per chunk, 2^CHUNK_SHIFT
+    static constexpr size_t CHUNK_SHIFT{12};
+    static constexpr size_t CHUNK_SIZE{size_t{1} << CHUNK_SHIFT};
+    //! Initial size of the lookup table, a power of two
+    static constexpr size_t MIN_TABLE_SIZE{64};
+
+    struct Chunk {
+        alignas(value_type) unsigned char data[CHUNK_SIZE * sizeof(value_type)];
+    };
+
+    std::vector<std::unique_ptr<Chunk>> m_chunks;
+    //! Lookup table of entry number + 1, or 0 for an empty slot. Its size is a power of two.
+    std::vector<uint32_t> m_table;
+    uint32_t m_size{0};
+
+    value_type& Entry(uint32_t pos) const
+    {
+        return reinterpret_cast<value_type*>(m_chunks[pos >> CHUNK_SHIFT]->data)[pos & (CHUNK_SIZE - 1)];
+    }
+
+    //! Return the slot of hash in the lookup table, or of the empty slot where it would go.
+    size_t FindSlot(const uint256& hash) const
+    {
+        const size_t mask{m_table.size() - 1};
+        for (size_t slot = BlockHasher{}(hash) & mask;; slot = (slot + 1) & mask) {
+            if (m_table[slot] == 0 || Entry(m_table[slot] - 1).first == hash) return slot;
+        }
+    }
+
+    void GrowTable()
+    {
+        std::vector<uint32_t> old_table(m_table.size() * 2, 0);
+        m_table.swap(old_table);
+        for (uint32_t number : old_table) {
+            if (number != 0) m_table[FindSlot(Entry(number - 1).first)] = number;
+        }
+    }
+
+public:
+    template <bool is_const>
+    class Iterator
+    {
+        using Map = std::conditional_t<is_const, const BlockMap, BlockMap>;
+        Map* m_map{nullptr};
+        uint32_t m_pos{0};
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = BlockMap::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = std::conditional_t<is_const, const value_type*, value_type*>;
+        using reference = std::conditional_t<is_const, const value_type&, value_type&>;
+
+        Iterator() = default;
+        Iterator(Map* map, uint32_t pos) : m_map{map}, m_pos{pos} {}
+        //! Allow conversion from iterator to const_iterator
+        Iterator(const Iterator<false>& other) : m_map{other.m_map}, m_pos{other.m_pos} {}
+
+        reference operator*() const { return m_map->Entry(m_pos); }
+        pointer operator->() const { return &m_map->Entry(m_pos); }
+        Iterator& operator++() { ++m_pos; return *this; }
+        Iterator operator++(int) { Iterator copy{*this}; ++m_pos; return copy; }
+        friend bool operator==(const Iterator& a, const Iterator& b) { return a.m_pos == b.m_pos; }
+        friend bool operator!=(const Iterator& a, const Iterator& b) { return a.m_pos != b.m_pos; }
+
+        friend class Iterator<true>;
+    };
+    using iterator = Iterator<false>;
+    using const_iterator = Iterator<true>;
+
+    BlockMap() : m_table(MIN_TABLE_SIZE, 0) {}
+    BlockMap(const BlockMap&) = delete;
+    BlockMap& operator=(const BlockMap&) = delete;
+
+    ~BlockMap()
+    {
+        for (uint32_t pos = 0; pos < m_size; ++pos) {
+            Entry(pos).~value_type();
+        }
+    }
+
+    iterator begin() { return {this, 0}; }
+    iterator end() { return {this, m_size}; }
+    const_iterator begin() const { return {this, 0}; }
+    const_iterator end() const { return {this, m_size}; }
+
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    iterator find(const uint256& hash)
+    {
+        const uint32_t number{m_table[FindSlot(hash)]};
+        return number == 0 ? end() : iterator{this, number - 1};
+    }
+
+    const_iterator find(const uint256& hash) const
+    {
+        const uint32_t number{m_table[FindSlot(hash)]};
+        return number == 0 ? end() : const_iterator{this, number - 1};
+    }
+
+    size_t count(const uint256& hash) const { return m_table[FindSlot(hash)] != 0; }
+
+    /** Insert an entry constructed from args if hash is not present yet. */
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const uint256& hash, Args&&... args)
+    {
+        size_t slot{FindSlot(hash)};
+        if (m_table[slot] != 0) return {iterator{this, m_table[slot] - 1}, false};
+
+        // Keep the load factor of the lookup table at most 3/4
+        if ((size_t{m_size} + 1) * 4 > m_table.size() * 3) {
+            GrowTable();
+            slot = FindSlot(hash);
+        }
+        if (m_size == m_chunks.size() * CHUNK_SIZE) {
+            m_chunks.push_back(std::make_unique<Chunk>());
+        }
+        new (&Entry(m_size)) value_type(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple(std::forward<Args>(args)...));
+        m_table[slot] = ++m_size;
+        return {iterator{this, m_size - 1}, true};
+    }
+
+    /** Make room for n entries without growing the lookup table. */
+    void reserve(size_t n)
+    {
+        while (n * 4 > m_table.size() * 3) GrowTable();
+        m_chunks.reserve((n + CHUNK_SIZE - 1) >> CHUNK_SHIFT);
+    }
+
+    CBlockIndex& operator[](const uint256& hash) { return try_emplace(hash).first->second; }
+
+    size_t DynamicMemoryUsage() const
+    {
+        return m_chunks.size() * memusage::MallocUsage(sizeof(Chunk)) + memusage::DynamicUsage(m_chunks) + memusage::DynamicUsage(m_table);
+    }
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_BLOCKMAP_H
@@ -6,12 +6,18 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <checkpointsync.h>
 #include <clientversion.h>
+#include <compressor.h>
 #include <consensus/validation.h>
+#include <crc32c/crc32c.h>
+#include <crypto/common.h>
 #include <flatfile.h>
 #include <fs.h>
 #include <hash.h>
 #include <pow.h>
+#include <powcache.h>
+#include <random.h>
 #include <reverse_iterator.h>
 #include <shutdown.h>
 #include <signet.h>
@@ -19,18 +25,34 @@
 #include <undo.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <validation.h>
 
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <list>
 #include <map>
+#include <memory>
+#include <thread>
 #include <unordered_map>
 
-extern uint256 hashSyncCheckpoint;
-
 namespace node {
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fPruneMode = false;
 uint64_t nPruneTarget = 0;
+bool fTrustIndexedBlockPoW = DEFAULT_TRUST_INDEXED_BLOCK_POW;
+bool fBlockIndexSnapshot = DEFAULT_BLOCK_INDEX_SNAPSHOT;
+bool fBlockFileMmap = DEFAULT_BLOCK_FILE_MMAP;
+bool fCompressBlockFiles = DEFAULT_COMPRESS_BLOCK_FILES;
 
 bool CBlockIndexWorkComparator::operator()(const CBlockIndex* pa, const CBlockIndex* pb) const
 {
@@ -108,7 +130,9 @@ CBlockIndex* BlockManager::AddToBlockIndex(const CBlockHeader& block, CBlockInde
         pindexNew->BuildSkip();
     }
     pindexNew->nTimeMax = (pindexNew->pprev ? std::max(pindexNew->pprev->nTimeMax, pindexNew->nTime) : pindexNew->nTime);
+    pindexNew->nMedianTimePast = pindexNew->ComputeMedianTimePast();
     pindexNew->nChainWork = (pindexNew->pprev ? pindexNew->pprev->nChainWork : 0) + GetBlockProof(*pindexNew);
+    pindexNew->nTargetWindowSum = GetTargetWindowSum(*pindexNew);
     pindexNew->RaiseValidity(BLOCK_VALID_TREE);
     if (best_header == nullptr || best_header->nChainWork < pindexNew->nChainWork) {
         best_header = pindexNew;
@@ -149,10 +173,20 @@ void BlockManager::PruneOneBlockFile(const int fileNumber)
         }
     }
 
+    const CBlockFileInfo old_info{m_blockfile_info[fileNumber]};
     m_blockfile_info[fileNumber].SetNull();
+    UpdateFileHeightIndex(fileNumber, old_info);
     m_dirty_fileinfo.insert(fileNumber);
 }
 
+void BlockManager::UpdateFileHeightIndex(int file, const CBlockFileInfo& old_info)
+{
+    AssertLockHeld(cs_LastBlockFile);
+    if (old_info.nSize > 0) m_files_by_height_last.erase({old_info.nHeightLast, file});
+    const CBlockFileInfo& info{m_blockfile_info[file]};
+    if (info.nSize > 0) m_files_by_height_last.emplace(info.nHeightLast, file);
+}
+
 void BlockManager::FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nManualPruneHeight, int chain_tip_height)
 {
     assert(fPruneMode && nManualPruneHeight > 0);
@@ -164,11 +198,13 @@ void BlockManager::FindFilesToPruneManual(std::set<int>& setFilesToPrune, int nM
 
     // last block to prune is the lesser of (user-specified height, MIN_BLOCKS_TO_KEEP from the tip)
     unsigned int nLastBlockWeCanPrune = std::min((unsigned)nManualPruneHeight, chain_tip_height - MIN_BLOCKS_TO_KEEP);
+    std::vector<int> prunable;
+    for (const auto& [height_last, fileNumber] : m_files_by_height_last) {
+        if (height_last > nLastBlockWeCanPrune) break;
+        if (fileNumber < m_last_blockfile) prunable.push_back(fileNumber);
+    }
     int count = 0;
-    for (int fileNumber = 0; fileNumber < m_last_blockfile; fileNumber++) {
-        if (m_blockfile_info[fileNumber].nSize == 0 || m_blockfile_info[fileNumber].nHeightLast > nLastBlockWeCanPrune) {
-            continue;
-        }
+    for (const int fileNumber : prunable) {
         PruneOneBlockFile(fileNumber);
         setFilesToPrune.insert(fileNumber);
         count++;
@@ -192,7 +228,6 @@ void BlockManager::FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPr
     // So we should leave a buffer under our target to account for another allocation
     // before the next pruning.
     uint64_t nBuffer = BLOCKFILE_CHUNK_SIZE + UNDOFILE_CHUNK_SIZE;
-    uint64_t nBytesToPrune;
     int count = 0;
 
     if (nCurrentUsage + nBuffer >= nPruneTarget) {
@@ -205,26 +240,28 @@ void BlockManager::FindFilesToPrune(std::set<int>& setFilesToPrune, uint64_t nPr
             nBuffer += nPruneTarget / 10;
         }
 
-        for (int fileNumber = 0; fileNumber < m_last_blockfile; fileNumber++) {
-            nBytesToPrune = m_blockfile_info[fileNumber].nSize + m_blockfile_info[fileNumber].nUndoSize;
-
-            if (m_blockfile_info[fileNumber].nSize == 0) {
-                continue;
-            }
-
+        // Files are visited from the one with the lowest highest block up
+        std::vector<int> prunable;
+        for (const auto& [height_last, fileNumber] : m_files_by_height_last) {
             if (nCurrentUsage + nBuffer < nPruneTarget) { // are we below our target?
                 break;
             }
 
-            // don't prune files that could have a block within MIN_BLOCKS_TO_KEEP of the main chain's tip but keep scanning
-            if (m_blockfile_info[fileNumber].nHeightLast > nLastBlockWeCanPrune) {
+            // don't prune files that could have a block within MIN_BLOCKS_TO_KEEP of the main chain's tip; neither can any later one
+            if (height_last > nLastBlockWeCanPrune) {
+                break;
+            }
+            if (fileNumber >= m_last_blockfile) {
                 continue;
             }
 
+            nCurrentUsage -= m_blockfile_info[fileNumber].nSize + m_blockfile_info[fileNumber].nUndoSize;
+            prunable.push_back(fileNumber);
+        }
+        for (const int fileNumber : prunable) {
             PruneOneBlockFile(fileNumber);
             // Queue up the files for removal
             setFilesToPrune.insert(fileNumber);
-            nCurrentUsage -= nBytesToPrune;
             count++;
         }
     }
@@ -256,9 +293,247 @@ CBlockIndex* BlockManager::InsertBlockIndex(const uint256& hash)
     return pindex;
 }
 
+/**
+ * Compute the block proof of, and build the skip pointer of, every index in
+ * sorted_by_height, splitting them into one height band per thread.
+ *
+ * BuildSkip() only reads the skip pointers of the ancestors between the skip
+ * height and the block itself. When the skip height is above the first height
+ * of the band, those ancestors are all in the band and were handled before by
+ * the same thread. The few blocks whose skip height is not are built afterwards,
+ * in height order, on this thread. Skip pointers that are still unset are not a
+ * problem, as GetAncestor() follows pprev instead.
+ */
+static void BuildProofsAndSkips(const std::vector<CBlockIndex*>& sorted_by_height, std::vector<arith_uint256>& proofs)
+{
+    //! Bands smaller than this are not worth a thread
+    static constexpr size_t MIN_BAND_SIZE{10000};
+    const size_t num_threads{std::clamp<size_t>(sorted_by_height.size() / MIN_BAND_SIZE, 1, std::min(GetNumCores(), MAX_BLOCK_INDEX_LOAD_THREADS))};
+    const size_t band_size{(sorted_by_height.size() + num_threads - 1) / num_threads};
+
+    std::vector<std::vector<CBlockIndex*>> deferred(num_threads);
+    auto build_band = [&](size_t band) {
+        const size_t begin{band * band_size};
+        const size_t end{std::min(sorted_by_height.size(), begin + band_size)};
+        if (begin >= end) return;
+        const int band_height{sorted_by_height[begin]->nHeight};
+        for (size_t i = begin; i < end; ++i) {
+            if ((i & 0xfff) == 0 && ShutdownRequested()) return;
+            CBlockIndex* pindex{sorted_by_height[i]};
+            proofs[i] = GetBlockProof(*pindex);
+            if (!pindex->pprev) continue;
+            if (GetSkipHeight(pindex->nHeight) > band_height) {
+                pindex->BuildSkip();
+            } else {
+                deferred[band].push_back(pindex);
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t band = 1; band < num_threads; ++band) {
+        threads.emplace_back(build_band, band);
+    }
+    build_band(0);
+    for (std::thread& thread : threads) thread.join();
+
+    for (const auto& band : deferred) {
+        for (CBlockIndex* pindex : band) {
+            pindex->BuildSkip();
+        }
+    }
+}
+
+namespace {
+/**
+ * The block index snapshot file (blocks/index.snapshot) consists of
+ * - a header: format version (4 bytes), snapshot id (32), entry count (8);
+ * - fixed-size entries, ordered by height, so a parent always comes before
+ *   its children and is referred to by its entry number;
+ * - the double-SHA256 of everything before it.
+ * All integers are little endian.
+ */
+constexpr uint32_t BLOCK_INDEX_SNAPSHOT_VERSION{1};
+constexpr size_t SNAPSHOT_HEADER_SIZE{4 + 32 + 8};
+//! hash, parent entry number, nHeight, nFile, nDataPos, nUndoPos, nVersion,
+//! hashMerkleRoot, nTime, nBits, nNonce, nStatus, nTx
+constexpr size_t SNAPSHOT_ENTRY_SIZE{32 + 4 + 5 * 4 + 32 + 5 * 4};
+constexpr uint32_t SNAPSHOT_NO_PARENT{std::numeric_limits<uint32_t>::max()};
+
+fs::path GetBlockIndexSnapshotPath(const std::string& suffix = "")
+{
+    return gArgs.GetBlocksDirPath() / fs::u8path("index.snapshot" + suffix);
+}
+} // namespace
+
+bool BlockManager::WriteBlockIndexSnapshot()
+{
+    AssertLockHeld(::cs_main);
+    if (!m_dirty_blockindex.empty()) {
+        return error("%s: Block index has not been flushed", __func__);
+    }
+    std::vector<CBlockIndex*> sorted{GetAllBlockIndices()};
+    std::sort(sorted.begin(), sorted.end(), CBlockIndexHeightOnlyComparator());
+
+    const uint256 snapshot_id{GetRandHash()};
+    std::vector<unsigned char> data(SNAPSHOT_HEADER_SIZE + sorted.size() * SNAPSHOT_ENTRY_SIZE + uint256::size());
+    WriteLE32(data.data(), BLOCK_INDEX_SNAPSHOT_VERSION);
+    std::memcpy(data.data() + 4, snapshot_id.begin(), 32);
+    WriteLE64(data.data() + 36, sorted.size());
+
+    std::unordered_map<const CBlockIndex*, uint32_t> entry_numbers;
+    entry_numbers.reserve(sorted.size());
+    unsigned char* entry{data.data() + SNAPSHOT_HEADER_SIZE};
+    for (const CBlockIndex* pindex : sorted) {
+        const uint32_t number(entry_numbers.size());
+        entry_numbers.emplace(pindex, number);
+        std::memcpy(entry, pindex->phashBlock->begin(), 32);
+        WriteLE32(entry + 32, pindex->pprev ? entry_numbers.at(pindex->pprev) : SNAPSHOT_NO_PARENT);
+        WriteLE32(entry + 36, pindex->nHeight);
+        WriteLE32(entry + 40, pindex->nFile);
+        WriteLE32(entry + 44, pindex->nDataPos);
+        WriteLE32(entry + 48, pindex->nUndoPos);
+        WriteLE32(entry + 52, pindex->nVersion);
+        std::memcpy(entry + 56, pindex->hashMerkleRoot.begin(), 32);
+        WriteLE32(entry + 88, pindex->nTime);
+        WriteLE32(entry + 92, pindex->nBits);
+        WriteLE32(entry + 96, pindex->nNonce);
+        WriteLE32(entry + 100, pindex->nStatus);
+        WriteLE32(entry + 104, pindex->nTx);
+        entry += SNAPSHOT_ENTRY_SIZE;
+    }
+    HashWriter hasher{};
+    hasher.write(MakeByteSpan(data).first(data.size() - uint256::size()));
+    const uint256 checksum{hasher.GetHash()};
+    std::memcpy(entry, checksum.begin(), 32);
+
+    // Write to a temporary file first, so an interrupted write never replaces
+    // a complete snapshot with a partial one
+    const fs::path path{GetBlockIndexSnapshotPath()};
+    const fs::path path_tmp{GetBlockIndexSnapshotPath(".new")};
+    AutoFile file{fsbridge::fopen(path_tmp, "wb")};
+    if (file.IsNull()) {
+        return error("%s: Failed to open file %s", __func__, fs::PathToString(path_tmp));
+    }
+    try {
+        file.write(MakeByteSpan(data));
+    } catch (const std::exception& e) {
+        file.fclose();
+        fs::remove(path_tmp);
+        return error("%s: Failed to write block index snapshot: %s", __func__, e.what());
+    }
+    if (!FileCommit(file.Get())) {
+        file.fclose();
+        fs::remove(path_tmp);
+        return error("%s: Failed to flush file %s", __func__, fs::PathToString(path_tmp));
+    }
+    file.fclose();
+    if (!RenameOver(path_tmp, path)) {
+        fs::remove(path_tmp);
+        return error("%s: Rename-into-place failed", __func__);
+    }
+    if (!m_block_tree_db->WriteBlockIndexSnapshotId(snapshot_id)) {
+        return error("%s: Failed to write block index snapshot id", __func__);
+    }
+    LogPrintf("Wrote block index snapshot with %u entries (%u MiB)\n", sorted.size(), data.size() >> 20);
+    return true;
+}
+
+bool BlockManager::LoadBlockIndexSnapshot(bool& loaded)
+{
+    AssertLockHeld(::cs_main);
+    loaded = false;
+    uint256 snapshot_id;
+    if (!m_block_index.empty() || !m_block_tree_db->ReadBlockIndexSnapshotId(snapshot_id)) {
+        LogPrintf("No up-to-date block index snapshot, loading the block index from the database\n");
+        return true;
+    }
+
+    const fs::path path{GetBlockIndexSnapshotPath()};
+    std::vector<unsigned char> data;
+    {
+        AutoFile file{fsbridge::fopen(path, "rb")};
+        std::error_code ec;
+        const auto size{fs::file_size(path, ec)};
+        if (file.IsNull() || ec) {
+            LogPrintf("Block index snapshot %s not found, loading the block index from the database\n", fs::PathToString(path));
+            return true;
+        }
+        data.resize(size);
+        try {
+            file.read(MakeWritableByteSpan(data));
+        } catch (const std::exception& e) {
+            LogPrintf("Failed to read block index snapshot: %s\n", e.what());
+            return true;
+        }
+    }
+
+    // Check everything before touching m_block_index, so that any mismatch
+    // can fall back to the database
+    const auto reject{[](const std::string& reason) {
+        LogPrintf("Ignoring block index snapshot: %s\n", reason);
+        return true;
+    }};
+    if (data.size() < SNAPSHOT_HEADER_SIZE + uint256::size()) return reject("truncated");
+    const size_t checksum_pos{data.size() - uint256::size()};
+    HashWriter hasher{};
+    hasher.write(MakeByteSpan(data).first(checksum_pos));
+    if (std::memcmp(hasher.GetHash().begin(), data.data() + checksum_pos, uint256::size()) != 0) return reject("checksum mismatch");
+    if (ReadLE32(data.data()) != BLOCK_INDEX_SNAPSHOT_VERSION) return reject("unknown version");
+    if (std::memcmp(data.data() + 4, snapshot_id.begin(), 32) != 0) return reject("does not match the block tree database");
+    const uint64_t count{ReadLE64(data.data() + 36)};
+    if (count > std::numeric_limits<uint32_t>::max() || count * SNAPSHOT_ENTRY_SIZE != checksum_pos - SNAPSHOT_HEADER_SIZE) return reject("bad size");
+
+    const unsigned char* entries{data.data() + SNAPSHOT_HEADER_SIZE};
+    for (uint32_t i = 0; i < count; ++i) {
+        const unsigned char* entry{entries + i * SNAPSHOT_ENTRY_SIZE};
+        const uint32_t parent{ReadLE32(entry + 32)};
+        const int height = ReadLE32(entry + 36);
+        if (parent == SNAPSHOT_NO_PARENT ? height != 0 : parent >= i || height != int(ReadLE32(entries + parent * SNAPSHOT_ENTRY_SIZE + 36)) + 1) {
+            return reject(strprintf("entry %u has an inconsistent parent", i));
+        }
+    }
+
+    m_block_index.reserve(count);
+    std::vector<CBlockIndex*> by_entry(count);
+    for (uint32_t i = 0; i < count; ++i) {
+        if (ShutdownRequested()) return false;
+        const unsigned char* entry{entries + i * SNAPSHOT_ENTRY_SIZE};
+        uint256 hash;
+        std::memcpy(hash.begin(), entry, 32);
+        const auto [it, inserted]{m_block_index.try_emplace(hash)};
+        if (!inserted) {
+            return error("%s: Duplicate block %s in block index snapshot", __func__, hash.ToString());
+        }
+        CBlockIndex* pindex{&it->second};
+        pindex->phashBlock = &it->first;
+        const uint32_t parent{ReadLE32(entry + 32)};
+        pindex->pprev = parent == SNAPSHOT_NO_PARENT ? nullptr : by_entry[parent];
+        pindex->nHeight = ReadLE32(entry + 36);
+        pindex->nFile = ReadLE32(entry + 40);
+        pindex->nDataPos = ReadLE32(entry + 44);
+        pindex->nUndoPos = ReadLE32(entry + 48);
+        pindex->nVersion = ReadLE32(entry + 52);
+        std::memcpy(pindex->hashMerkleRoot.begin(), entry + 56, 32);
+        pindex->nTime = ReadLE32(entry + 88);
+        pindex->nBits = ReadLE32(entry + 92);
+        pindex->nNonce = ReadLE32(entry + 96);
+        pindex->nStatus = ReadLE32(entry + 100);
+        pindex->nTx = ReadLE32(entry + 104);
+        by_entry[i] = pindex;
+    }
+    LogPrintf("Loaded %u block index entries from snapshot %s\n", count, fs::PathToString(path));
+    loaded = true;
+    return true;
+}
+
 bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
 {
-    if (!m_block_tree_db->LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); })) {
+    bool snapshot_loaded{false};
+    if (fBlockIndexSnapshot && !LoadBlockIndexSnapshot(snapshot_loaded)) {
+        return false;
+    }
+    if (!snapshot_loaded && !m_block_tree_db->LoadBlockIndexGuts(consensus_params, [this](const uint256& hash) EXCLUSIVE_LOCKS_REQUIRED(cs_main) { return this->InsertBlockIndex(hash); })) {
         return false;
     }
 
@@ -267,10 +542,17 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
     std::sort(vSortedByHeight.begin(), vSortedByHeight.end(),
               CBlockIndexHeightOnlyComparator());
 
-    for (CBlockIndex* pindex : vSortedByHeight) {
+    std::vector<arith_uint256> proofs(vSortedByHeight.size());
+    BuildProofsAndSkips(vSortedByHeight, proofs);
+    if (ShutdownRequested()) return false;
+
+    for (size_t i = 0; i < vSortedByHeight.size(); ++i) {
         if (ShutdownRequested()) return false;
-        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + GetBlockProof(*pindex);
+        CBlockIndex* pindex{vSortedByHeight[i]};
+        pindex->nChainWork = (pindex->pprev ? pindex->pprev->nChainWork : 0) + proofs[i];
+        pindex->nTargetWindowSum = GetTargetWindowSum(*pindex);
         pindex->nTimeMax = (pindex->pprev ? std::max(pindex->pprev->nTimeMax, pindex->nTime) : pindex->nTime);
+        pindex->nMedianTimePast = pindex->ComputeMedianTimePast();
 
         // We can link the chain of blocks for which we've received transactions at some point, or
         // blocks that are assumed-valid on the basis of snapshot load (see
@@ -292,9 +574,6 @@ bool BlockManager::LoadBlockIndex(const Consensus::Params& consensus_params)
             pindex->nStatus |= BLOCK_FAILED_CHILD;
             m_dirty_blockindex.insert(pindex);
         }
-        if (pindex->pprev) {
-            pindex->BuildSkip();
-        }
     }
 
     return true;
@@ -343,12 +622,20 @@ bool BlockManager::LoadBlockIndexDB(const Consensus::Params& consensus_params)
             break;
         }
     }
+    {
+        LOCK(cs_LastBlockFile);
+        m_files_by_height_last.clear();
+        for (size_t nFile = 0; nFile < m_blockfile_info.size(); ++nFile) {
+            UpdateFileHeightIndex(nFile, CBlockFileInfo{});
+        }
+    }
 
     // Load hashSyncCheckpoint
     if (!m_block_tree_db->ReadSyncCheckpoint(hashSyncCheckpoint))
          LogPrintf("LoadBlockIndexDB(): synchronized checkpoint not read\n");
     else
          LogPrintf("LoadBlockIndexDB(): synchronized checkpoint %s\n", hashSyncCheckpoint.ToString().c_str());
+    PublishSyncCheckpoint(hashSyncCheckpoint, LookupBlockIndex(hashSyncCheckpoint));
 
     // Check presence of blk files
     LogPrintf("Checking all blk files are present...\n");
@@ -367,6 +654,14 @@ bool BlockManager::LoadBlockIndexDB(const Consensus::Params& consensus_params)
 
     // Check whether we have ever pruned block & undo files
     m_block_tree_db->ReadFlag("prunedblockfiles", m_have_pruned);
+    if (m_have_pruned) {
+        // The files of a prune shortly before a crash may not have been deleted yet
+        std::set<int> pruned_files;
+        for (int nFile = 0; nFile < m_last_blockfile; ++nFile) {
+            if (m_blockfile_info[nFile].nSize == 0) pruned_files.insert(nFile);
+        }
+        QueueUnlinkPrunedFiles(pruned_files);
+    }
     if (m_have_pruned) {
         LogPrintf("LoadBlockIndexDB(): Block files have previously been pruned\n");
     }
@@ -459,72 +754,286 @@ CBlockFileInfo* BlockManager::GetBlockFileInfo(size_t n)
     return &m_blockfile_info.at(n);
 }
 
-static bool UndoWriteToDisk(const CBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+namespace {
+/**
+ * Combines data appended to the files of a flat file sequence into large
+ * writes. Appended data is buffered until MAX_FILE_WRITE_BUFFER bytes are
+ * pending, data is appended elsewhere, or the pending range is about to be
+ * read or flushed, and then written with a single call.
+ */
+class FlatFileWriter
 {
-    // Open history file to append
-    CAutoFile fileout(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return error("%s: OpenUndoFile failed", __func__);
+    FlatFileSeq (*const m_seq)();
+    Mutex m_mutex;
+    //! Position of the first pending byte
+    FlatFilePos m_pos GUARDED_BY(m_mutex);
+    std::vector<uint8_t> m_buffer GUARDED_BY(m_mutex);
+
+    bool WriteLocked() EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        if (m_buffer.empty()) return true;
+        FILE* file{m_seq().Open(m_pos)};
+        if (!file) return error("%s: failed to open file %d", __func__, m_pos.nFile);
+        // The buffer is written directly, not copied into the stdio buffer
+        setvbuf(file, nullptr, _IONBF, 0);
+        const bool written{fwrite(m_buffer.data(), 1, m_buffer.size(), file) == m_buffer.size()};
+        if (fclose(file) != 0 || !written) {
+            return error("%s: failed to write %u bytes at %s", __func__, m_buffer.size(), m_pos.ToString());
+        }
+        m_buffer.clear();
+        return true;
     }
 
-    // Write index header
-    unsigned int nSize = GetSerializeSize(blockundo, fileout.GetVersion());
-    fileout << messageStart << nSize;
+public:
+    explicit FlatFileWriter(FlatFileSeq (*seq)()) : m_seq{seq} {}
+
+    /** Append data at pos, which is expected to be the end of the data written to its file. */
+    bool Append(const FlatFilePos& pos, Span<const uint8_t> data) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_buffer.empty() || pos.nFile != m_pos.nFile || pos.nPos != m_pos.nPos + m_buffer.size()) {
+            if (!WriteLocked()) return false;
+            m_pos = pos;
+        }
+        m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+        return m_buffer.size() < MAX_FILE_WRITE_BUFFER || WriteLocked();
+    }
 
-    // Write undo data
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0) {
-        return error("%s: ftell failed", __func__);
+    /** Write the pending data. */
+    bool Write() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return WriteLocked();
     }
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << blockundo;
 
-    // calculate & write checksum
-    HashWriter hasher{};
-    hasher << hashBlock;
-    hasher << blockundo;
-    fileout << hasher.GetHash();
+    /** Write the pending data if it belongs to file n_file. */
+    bool WriteIfPending(int n_file) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_buffer.empty() || m_pos.nFile != n_file) return true;
+        return WriteLocked();
+    }
+
+    /** Write the pending data if it holds the record starting at pos, or whose data starts there, so it can be read. */
+    bool WriteIfPending(const FlatFilePos& pos) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_buffer.empty() || m_pos.nFile != pos.nFile || pos.nPos < m_pos.nPos) return true;
+        return WriteLocked();
+    }
+
+    /** Forget the pending data of a file that is about to be deleted. */
+    void Discard(int n_file) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_pos.nFile == n_file) m_buffer.clear();
+    }
+};
+
+FlatFileWriter g_block_file_writer{BlockFileSeq};
+FlatFileWriter g_undo_file_writer{UndoFileSeq};
+
+/** Serialize the magic, size, and data of a record to be appended at pos, pointing pos to the data. */
+template <typename T>
+std::vector<uint8_t> SerializeRecord(const T& data, FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    std::vector<uint8_t> record;
+    CVectorWriter writer{SER_DISK, CLIENT_VERSION, record, 0};
+    const unsigned int size = GetSerializeSize(data, CLIENT_VERSION);
+    record.reserve(size + 8 + sizeof(uint256));
+    writer << message_start << size << data;
+    pos.nPos += 8;
+    return record;
+}
+} // namespace
+
+CompactBlockUndo::CompactBlockUndo(std::vector<uint8_t> data) : m_data{std::move(data)}
+{
+    SpanReader reader{SER_DISK, CLIENT_VERSION, m_data};
+    const uint64_t count{ReadCompactSize(reader)};
+    // The undo data of a transaction takes at least a byte
+    if (count > reader.size()) throw std::ios_base::failure("Undo transaction count out of range");
+    m_txs.reserve(count);
+    size_t total{0};
+    for (uint64_t i = 0; i < count; ++i) {
+        const uint64_t size{ReadCompactSize(reader)};
+        m_txs.emplace_back(total, size);
+        total += size;
+        if (total > reader.size()) throw std::ios_base::failure("Undo transaction sizes out of range");
+    }
+    if (total != reader.size()) throw std::ios_base::failure("Undo transaction sizes do not match the undo data");
+    const size_t offset{m_data.size() - reader.size()};
+    for (auto& [tx_offset, size] : m_txs) tx_offset += offset;
+}
+
+CompactBlockUndo::CompactBlockUndo(const CBlockUndo& blockundo)
+{
+    std::vector<uint8_t> txs;
+    CVectorWriter txs_writer{SER_DISK, CLIENT_VERSION, txs, 0};
+    m_txs.reserve(blockundo.vtxundo.size());
+    for (const CTxUndo& txundo : blockundo.vtxundo) {
+        const size_t tx_offset{txs.size()};
+        txs_writer << Using<CompactTxUndoFormatter>(txundo);
+        m_txs.emplace_back(tx_offset, txs.size() - tx_offset);
+    }
+
+    CVectorWriter writer{SER_DISK, CLIENT_VERSION, m_data, 0};
+    WriteCompactSize(writer, m_txs.size());
+    for (const auto& [tx_offset, size] : m_txs) WriteCompactSize(writer, size);
+    const size_t offset{m_data.size()};
+    m_data.insert(m_data.end(), txs.begin(), txs.end());
+    for (auto& [tx_offset, size] : m_txs) tx_offset += offset;
+}
+
+CTxUndo CompactBlockUndo::GetTxUndo(size_t i) const
+{
+    const auto& [offset, size] = m_txs.at(i);
+    SpanReader reader{SER_DISK, CLIENT_VERSION, Span{m_data}.subspan(offset, size)};
+    CTxUndo txundo;
+    reader >> Using<CompactTxUndoFormatter>(txundo);
+    if (!reader.empty()) throw std::ios_base::failure("Undo transaction size does not match its undo data");
+    return txundo;
+}
+
+CBlockUndo CompactBlockUndo::GetBlockUndo() const
+{
+    CBlockUndo blockundo;
+    blockundo.vtxundo.reserve(m_txs.size());
+    for (size_t i = 0; i < m_txs.size(); ++i) {
+        blockundo.vtxundo.push_back(GetTxUndo(i));
+    }
+    return blockundo;
+}
+
+bool IsCompactUndoRecord(const unsigned char* magic, const CMessageHeader::MessageStartChars& message_start)
+{
+    return IsCompressedBlockRecord(magic, message_start);
+}
+
+/** The CRC32C a compact undo record ends with: of the hash of the previous block, then the undo data */
+static uint32_t UndoChecksum(const uint256& hashBlock, Span<const uint8_t> data)
+{
+    return crc32c::Extend(crc32c::Crc32c(hashBlock.begin(), hashBlock.size()), data.data(), data.size());
+}
 
+static bool UndoWriteToDisk(const CompactBlockUndo& blockundo, FlatFilePos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
+{
+    const FlatFilePos record_pos{pos};
+    CMessageHeader::MessageStartChars compact_start;
+    std::copy(std::begin(messageStart), std::end(messageStart), std::begin(compact_start));
+    compact_start[CMessageHeader::MESSAGE_START_SIZE - 1] = ~compact_start[CMessageHeader::MESSAGE_START_SIZE - 1];
+    std::vector<uint8_t> record{SerializeRecord(blockundo.GetData(), pos, compact_start)};
+    CVectorWriter{SER_DISK, CLIENT_VERSION, record, record.size()} << UndoChecksum(hashBlock, blockundo.GetData());
+
+    if (!g_undo_file_writer.Append(record_pos, record)) {
+        return error("%s: failed to write undo data", __func__);
+    }
     return true;
 }
 
-bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+/**
+ * Read the undo record of pindex. A compact undo record is read into
+ * compact, undo data in the older format into legacy, which is what is_compact
+ * tells.
+ */
+static bool ReadUndoRecord(const CBlockIndex* pindex, CompactBlockUndo& compact, CBlockUndo& legacy, bool& is_compact)
 {
     const FlatFilePos pos{WITH_LOCK(::cs_main, return pindex->GetUndoPos())};
 
     if (pos.IsNull()) {
         return error("%s: no undo data available", __func__);
     }
+    if (pos.nPos < 8) {
+        return error("%s: undo data position out of range", __func__);
+    }
+    if (!g_undo_file_writer.WriteIfPending(pos)) {
+        return error("%s: failed to write pending undo data", __func__);
+    }
 
-    // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    // Open history file to read, at the magic and size of the record
+    CAutoFile filein(OpenUndoFile(FlatFilePos{pos.nFile, pos.nPos - 8}, true), SER_DISK, CLIENT_VERSION);
     if (filein.IsNull()) {
         return error("%s: OpenUndoFile failed", __func__);
     }
 
-    // Read block
-    uint256 hashChecksum;
-    CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
+    const CMessageHeader::MessageStartChars& message_start{Params().MessageStart()};
     try {
+        CMessageHeader::MessageStartChars magic;
+        unsigned int size;
+        filein >> magic >> size;
+        is_compact = IsCompactUndoRecord(magic, message_start);
+        if (is_compact) {
+            if (size > MAX_SIZE) {
+                return error("%s: undo record size out of range", __func__);
+            }
+            std::vector<uint8_t> data(size);
+            uint32_t checksum;
+            filein >> Span{data} >> checksum;
+            if (checksum != UndoChecksum(pindex->pprev->GetBlockHash(), data)) {
+                return error("%s: Checksum mismatch", __func__);
+            }
+            compact = CompactBlockUndo{std::move(data)};
+            return true;
+        }
+        if (memcmp(magic, message_start, CMessageHeader::MESSAGE_START_SIZE) != 0) {
+            return error("%s: unknown undo record magic", __func__);
+        }
+
+        uint256 hashChecksum;
+        CHashVerifier<CAutoFile> verifier(&filein); // We need a CHashVerifier as reserializing may lose data
         verifier << pindex->pprev->GetBlockHash();
-        verifier >> blockundo;
+        verifier >> legacy;
         filein >> hashChecksum;
+        // Verify checksum
+        if (hashChecksum != verifier.GetHash()) {
+            return error("%s: Checksum mismatch", __func__);
+        }
     } catch (const std::exception& e) {
         return error("%s: Deserialize or I/O error - %s", __func__, e.what());
     }
 
-    // Verify checksum
-    if (hashChecksum != verifier.GetHash()) {
-        return error("%s: Checksum mismatch", __func__);
+    return true;
+}
+
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CompactBlockUndo compact;
+    bool is_compact;
+    if (!ReadUndoRecord(pindex, compact, blockundo, is_compact)) return false;
+    if (!is_compact) return true;
+    try {
+        blockundo = compact.GetBlockUndo();
+    } catch (const std::exception& e) {
+        return error("%s: Deserialize error - %s", __func__, e.what());
     }
+    return true;
+}
 
+bool UndoReadFromDisk(CompactBlockUndo& blockundo, const CBlockIndex* pindex)
+{
+    CBlockUndo legacy;
+    bool is_compact;
+    if (!ReadUndoRecord(pindex, blockundo, legacy, is_compact)) return false;
+    if (!is_compact) blockundo = CompactBlockUndo{legacy};
     return true;
 }
 
+BlockManager::~BlockManager()
+{
+    if (m_unlink_thread.joinable()) {
+        WITH_LOCK(m_unlink_mutex, m_unlink_stop = true);
+        m_unlink_cv.notify_all();
+        m_unlink_thread.join();
+    }
+    if (!g_block_file_writer.Write() || !g_undo_file_writer.Write()) {
+        LogPrintf("Failed to write buffered block and undo data\n");
+    }
+}
+
 void BlockManager::FlushUndoFile(int block_file, bool finalize)
 {
     FlatFilePos undo_pos_old(block_file, m_blockfile_info[block_file].nUndoSize);
-    if (!UndoFileSeq().Flush(undo_pos_old, finalize)) {
+    if (!g_undo_file_writer.WriteIfPending(block_file) || !UndoFileSeq().Flush(undo_pos_old, finalize)) {
         AbortNode("Flushing undo file to disk failed. This is likely the result of an I/O error.");
     }
 }
@@ -532,6 +1041,10 @@ void BlockManager::FlushUndoFile(int block_file, bool finalize)
 void BlockManager::FlushBlockFile(bool fFinalize, bool finalize_undo)
 {
     LOCK(cs_LastBlockFile);
+    // Everything written so far has to be on disk before the block index refers to it
+    if (!g_block_file_writer.Write() || !g_undo_file_writer.Write()) {
+        AbortNode("Writing block and undo data to disk failed. This is likely the result of an I/O error.");
+    }
     FlatFilePos block_pos_old(m_last_blockfile, m_blockfile_info[m_last_blockfile].nSize);
     if (!BlockFileSeq().Flush(block_pos_old, fFinalize)) {
         AbortNode("Flushing block file to disk failed. This is likely the result of an I/O error.");
@@ -552,16 +1065,294 @@ uint64_t BlockManager::CalculateCurrentUsage()
     return retval;
 }
 
+namespace {
+/** A block file mapped read-only into memory, unmapped when the last reference goes away. */
+class MappedBlockFile
+{
+    const uint8_t* m_data{nullptr};
+    size_t m_size{0};
+
+    MappedBlockFile(const uint8_t* data, size_t size) : m_data{data}, m_size{size} {}
+
+public:
+    MappedBlockFile(const MappedBlockFile&) = delete;
+    MappedBlockFile& operator=(const MappedBlockFile&) = delete;
+
+    ~MappedBlockFile()
+    {
+#ifndef WIN32
+        munmap(const_cast<uint8_t*>(m_data), m_size);
+#endif
+    }
+
+    /** Map the whole file at path, or return nullptr if it cannot be mapped. */
+    static std::shared_ptr<const MappedBlockFile> Open(const fs::path& path)
+    {
+#ifndef WIN32
+        const int fd{open(path.c_str(), O_RDONLY | O_CLOEXEC)};
+        if (fd == -1) return nullptr;
+        struct stat st;
+        void* data{MAP_FAILED};
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        }
+        // The mapping stays valid after the descriptor is closed.
+        close(fd);
+        if (data == MAP_FAILED) return nullptr;
+        return std::shared_ptr<const MappedBlockFile>{new MappedBlockFile{static_cast<const uint8_t*>(data), static_cast<size_t>(st.st_size)}};
+#else
+        return nullptr;
+#endif
+    }
+
+    Span<const uint8_t> Data() const { return {m_data, m_size}; }
+};
+
+/** The most recently used block file mappings, most recent first. */
+Mutex g_block_file_maps_mutex;
+std::list<std::pair<int, std::shared_ptr<const MappedBlockFile>>> g_block_file_maps GUARDED_BY(g_block_file_maps_mutex);
+
+/**
+ * Return a mapping of block file n_file that covers at least its first end
+ * bytes, mapping the file (again, as it may have grown) if needed.
+ */
+std::shared_ptr<const MappedBlockFile> GetMappedBlockFile(int n_file, size_t end) EXCLUSIVE_LOCKS_REQUIRED(!g_block_file_maps_mutex)
+{
+    LOCK(g_block_file_maps_mutex);
+    auto it{std::find_if(g_block_file_maps.begin(), g_block_file_maps.end(), [&](const auto& entry) { return entry.first == n_file; })};
+    if (it != g_block_file_maps.end()) {
+        if (it->second->Data().size() >= end) {
+            g_block_file_maps.splice(g_block_file_maps.begin(), g_block_file_maps, it);
+            return it->second;
+        }
+        g_block_file_maps.erase(it);
+    }
+    auto file{MappedBlockFile::Open(BlockFileSeq().FileName(FlatFilePos{n_file, 0}))};
+    if (!file || file->Data().size() < end) return nullptr;
+    g_block_file_maps.emplace_front(n_file, file);
+    if (g_block_file_maps.size() > MAX_MAPPED_BLOCK_FILES) g_block_file_maps.pop_back();
+    return file;
+}
+
+/** Forget the mapping of a block file that is about to be deleted. */
+void UnmapBlockFile(int n_file) EXCLUSIVE_LOCKS_REQUIRED(!g_block_file_maps_mutex)
+{
+    LOCK(g_block_file_maps_mutex);
+    g_block_file_maps.remove_if([&](const auto& entry) { return entry.first == n_file; });
+}
+
+/**
+ * Find the block stored at pos, after its magic and size, in the memory-mapped
+ * block file. Return the mapping, which keeps block valid, or nullptr if the
+ * block files are not mapped or the block is not there, in which case the
+ * caller falls back to reading the file.
+ */
+std::shared_ptr<const MappedBlockFile> MapBlock(const FlatFilePos& pos, Span<const uint8_t>& header, Span<const uint8_t>& block)
+{
+    if (!fBlockFileMmap || pos.IsNull() || pos.nPos < 8) return nullptr;
+    auto file{GetMappedBlockFile(pos.nFile, pos.nPos)};
+    if (!file) return nullptr;
+    const uint32_t blk_size{ReadLE32(file->Data().data() + pos.nPos - 4)};
+    if (blk_size > MAX_SIZE) return nullptr;
+    if (file->Data().size() < size_t{pos.nPos} + blk_size) {
+        file = GetMappedBlockFile(pos.nFile, size_t{pos.nPos} + blk_size);
+        if (!file) return nullptr;
+    }
+    header = file->Data().subspan(pos.nPos - 8, 8);
+    block = file->Data().subspan(pos.nPos, blk_size);
+    return file;
+}
+} // namespace
+
+/** Forget what is mapped and buffered of a blk/rev pair that is about to be deleted. */
+static void ReleasePrunedFile(int n_file)
+{
+    // Drop the mapping so the space is given back when the file is removed
+    UnmapBlockFile(n_file);
+    g_block_file_writer.Discard(n_file);
+    g_undo_file_writer.Discard(n_file);
+}
+
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
 {
     for (std::set<int>::iterator it = setFilesToPrune.begin(); it != setFilesToPrune.end(); ++it) {
         FlatFilePos pos(*it, 0);
+        ReleasePrunedFile(*it);
         fs::remove(BlockFileSeq().FileName(pos));
         fs::remove(UndoFileSeq().FileName(pos));
         LogPrint(BCLog::BLOCKSTORE, "Prune: %s deleted blk/rev (%05u)\n", __func__, *it);
     }
 }
 
+void BlockManager::QueueUnlinkPrunedFiles(const std::set<int>& setFilesToPrune)
+{
+    if (setFilesToPrune.empty()) return;
+    for (const int n_file : setFilesToPrune) ReleasePrunedFile(n_file);
+    {
+        LOCK(m_unlink_mutex);
+        m_files_to_unlink.insert(m_files_to_unlink.end(), setFilesToPrune.begin(), setFilesToPrune.end());
+        if (!m_unlink_thread.joinable()) {
+            m_unlink_thread = std::thread(&util::TraceThread, "pruneunlink", [this] { UnlinkThread(); });
+        }
+    }
+    m_unlink_cv.notify_all();
+}
+
+void BlockManager::WaitForUnlinks()
+{
+    WAIT_LOCK(m_unlink_mutex, lock);
+    m_unlink_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_unlink_mutex) { return m_files_to_unlink.empty() && !m_unlinking; });
+}
+
+void BlockManager::AddBlockTxids(const uint256& block_hash, std::shared_ptr<const std::vector<uint256>> txids)
+{
+    AssertLockHeld(m_block_txids_mutex);
+    const auto it{m_block_txids_by_hash.find(block_hash)};
+    if (it != m_block_txids_by_hash.end()) {
+        m_block_txids.splice(m_block_txids.begin(), m_block_txids, it->second);
+        return;
+    }
+    m_block_txids.emplace_front(block_hash, std::move(txids));
+    m_block_txids_by_hash.emplace(block_hash, m_block_txids.begin());
+    if (m_block_txids.size() > MAX_CACHED_BLOCK_TXIDS) {
+        m_block_txids_by_hash.erase(m_block_txids.back().first);
+        m_block_txids.pop_back();
+    }
+}
+
+static std::shared_ptr<const std::vector<uint256>> GetTxids(const CBlock& block)
+{
+    auto txids{std::make_shared<std::vector<uint256>>()};
+    txids->reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) txids->push_back(tx->GetHash());
+    return txids;
+}
+
+void BlockManager::CacheBlockTxids(const CBlock& block)
+{
+    auto txids{GetTxids(block)};
+    LOCK(m_block_txids_mutex);
+    AddBlockTxids(block.GetHash(), std::move(txids));
+}
+
+std::shared_ptr<const std::vector<uint256>> BlockManager::GetBlockTxids(const CBlockIndex& index, const Consensus::Params& consensus_params)
+{
+    const uint256 block_hash{index.GetBlockHash()};
+    {
+        LOCK(m_block_txids_mutex);
+        const auto it{m_block_txids_by_hash.find(block_hash)};
+        if (it != m_block_txids_by_hash.end()) {
+            m_block_txids.splice(m_block_txids.begin(), m_block_txids, it->second);
+            return it->second->second;
+        }
+    }
+    CBlock block;
+    if (!ReadBlockFromDisk(block, &index, consensus_params)) return nullptr;
+    auto txids{GetTxids(block)};
+    LOCK(m_block_txids_mutex);
+    AddBlockTxids(block_hash, txids);
+    return txids;
+}
+
+BlockManager::RecentBlock& BlockManager::RecentBlockEntry(const uint256& block_hash)
+{
+    AssertLockHeld(m_recent_blocks_mutex);
+    const auto it{m_recent_blocks_by_hash.find(block_hash)};
+    if (it != m_recent_blocks_by_hash.end()) {
+        m_recent_blocks.splice(m_recent_blocks.begin(), m_recent_blocks, it->second);
+        return *it->second;
+    }
+    m_recent_blocks.push_front(RecentBlock{block_hash, nullptr, nullptr});
+    m_recent_blocks_by_hash.emplace(block_hash, m_recent_blocks.begin());
+    if (m_recent_blocks.size() > MAX_RECENT_BLOCKS) {
+        m_recent_blocks_by_hash.erase(m_recent_blocks.back().hash);
+        m_recent_blocks.pop_back();
+    }
+    return m_recent_blocks.front();
+}
+
+const BlockManager::RecentBlock* BlockManager::FindRecentBlock(const uint256& block_hash)
+{
+    AssertLockHeld(m_recent_blocks_mutex);
+    const auto it{m_recent_blocks_by_hash.find(block_hash)};
+    if (it == m_recent_blocks_by_hash.end()) return nullptr;
+    m_recent_blocks.splice(m_recent_blocks.begin(), m_recent_blocks, it->second);
+    return &*it->second;
+}
+
+void BlockManager::CacheRecentBlock(std::shared_ptr<const CBlock> block)
+{
+    const uint256 block_hash{block->GetHash()};
+    LOCK(m_recent_blocks_mutex);
+    RecentBlockEntry(block_hash).block = std::move(block);
+}
+
+void BlockManager::CacheRecentBlockUndo(const uint256& block_hash, std::shared_ptr<const CBlockUndo> undo)
+{
+    LOCK(m_recent_blocks_mutex);
+    RecentBlockEntry(block_hash).undo = std::move(undo);
+}
+
+std::shared_ptr<const CBlock> BlockManager::GetRecentBlock(const uint256& block_hash)
+{
+    LOCK(m_recent_blocks_mutex);
+    const RecentBlock* recent{FindRecentBlock(block_hash)};
+    return recent ? recent->block : nullptr;
+}
+
+std::shared_ptr<const CBlock> BlockManager::ReadBlock(const CBlockIndex& index, const Consensus::Params& consensus_params)
+{
+    if (auto recent{GetRecentBlock(index.GetBlockHash())}) return recent;
+    auto block{std::make_shared<CBlock>()};
+    if (!ReadBlockFromDisk(*block, &index, consensus_params)) return nullptr;
+    return block;
+}
+
+std::shared_ptr<const CBlockUndo> BlockManager::GetRecentBlockUndo(const uint256& block_hash)
+{
+    LOCK(m_recent_blocks_mutex);
+    const RecentBlock* recent{FindRecentBlock(block_hash)};
+    return recent ? recent->undo : nullptr;
+}
+
+std::shared_ptr<const CBlockUndo> BlockManager::ReadBlockUndo(const CBlockIndex& index)
+{
+    if (auto recent{GetRecentBlockUndo(index.GetBlockHash())}) return recent;
+    auto undo{std::make_shared<CBlockUndo>()};
+    if (!UndoReadFromDisk(*undo, &index)) return nullptr;
+    return undo;
+}
+
+void BlockManager::UnlinkThread()
+{
+    WAIT_LOCK(m_unlink_mutex, lock);
+    while (true) {
+        // Files still queued at shutdown are deleted before the thread stops
+        m_unlink_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_unlink_mutex) { return !m_files_to_unlink.empty() || m_unlink_stop; });
+        if (m_files_to_unlink.empty()) return;
+        const std::vector<int> files{std::move(m_files_to_unlink)};
+        m_files_to_unlink.clear();
+        m_unlinking = true;
+        {
+            REVERSE_LOCK(lock);
+            for (const int n_file : files) {
+                const FlatFilePos pos{n_file, 0};
+                try {
+                    const bool removed_block{fs::remove(BlockFileSeq().FileName(pos))};
+                    const bool removed_undo{fs::remove(UndoFileSeq().FileName(pos))};
+                    if (removed_block || removed_undo) {
+                        LogPrint(BCLog::BLOCKSTORE, "Prune: %s deleted blk/rev (%05u)\n", __func__, n_file);
+                    }
+                } catch (const fs::filesystem_error& e) {
+                    LogPrintf("Prune: failed to delete blk/rev (%05u): %s\n", n_file, fsbridge::get_filesystem_error_message(e));
+                }
+            }
+        }
+        m_unlinking = false;
+        m_unlink_cv.notify_all();
+    }
+}
+
 static FlatFileSeq BlockFileSeq()
 {
     return FlatFileSeq(gArgs.GetBlocksDirPath(), "blk", gArgs.GetBoolArg("-fastprune", false) ? 0x4000 /* 16kb */ : BLOCKFILE_CHUNK_SIZE);
@@ -574,6 +1365,10 @@ static FlatFileSeq UndoFileSeq()
 
 FILE* OpenBlockFile(const FlatFilePos& pos, bool fReadOnly)
 {
+    // Buffered blocks are written before they are read
+    if (fReadOnly && !g_block_file_writer.WriteIfPending(pos)) {
+        return nullptr;
+    }
     return BlockFileSeq().Open(pos, fReadOnly);
 }
 
@@ -621,12 +1416,14 @@ bool BlockManager::FindBlockPos(FlatFilePos& pos, unsigned int nAddSize, unsigne
         m_last_blockfile = nFile;
     }
 
+    const CBlockFileInfo old_info{m_blockfile_info[nFile]};
     m_blockfile_info[nFile].AddBlock(nHeight, nTime);
     if (fKnown) {
         m_blockfile_info[nFile].nSize = std::max(pos.nPos + nAddSize, m_blockfile_info[nFile].nSize);
     } else {
         m_blockfile_info[nFile].nSize += nAddSize;
     }
+    UpdateFileHeightIndex(nFile, old_info);
 
     if (!fKnown) {
         bool out_of_space;
@@ -665,26 +1462,21 @@ bool BlockManager::FindUndoPos(BlockValidationState& state, int nFile, FlatFileP
     return true;
 }
 
-static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart)
+static bool WriteBlockToDisk(const CBlock& block, FlatFilePos& pos, const CMessageHeader::MessageStartChars& messageStart, bool compress)
 {
-    // Open history file to append
-    CAutoFile fileout(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (fileout.IsNull()) {
-        return error("WriteBlockToDisk: OpenBlockFile failed");
+    const FlatFilePos record_pos{pos};
+    std::vector<uint8_t> record;
+    if (compress) {
+        CMessageHeader::MessageStartChars compressed_start;
+        std::copy(std::begin(messageStart), std::end(messageStart), std::begin(compressed_start));
+        compressed_start[CMessageHeader::MESSAGE_START_SIZE - 1] = ~compressed_start[CMessageHeader::MESSAGE_START_SIZE - 1];
+        record = SerializeRecord(Using<CompressedBlockFormatter>(block), pos, compressed_start);
+    } else {
+        record = SerializeRecord(block, pos, messageStart);
     }
-
-    // Write index header
-    unsigned int nSize = GetSerializeSize(block, fileout.GetVersion());
-    fileout << messageStart << nSize;
-
-    // Write block
-    long fileOutPos = ftell(fileout.Get());
-    if (fileOutPos < 0) {
-        return error("WriteBlockToDisk: ftell failed");
+    if (!g_block_file_writer.Append(record_pos, record)) {
+        return error("WriteBlockToDisk: failed to write block");
     }
-    pos.nPos = (unsigned int)fileOutPos;
-    fileout << block;
-
     return true;
 }
 
@@ -694,10 +1486,12 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
     // Write undo information to disk
     if (pindex->GetUndoPos().IsNull()) {
         FlatFilePos _pos;
-        if (!FindUndoPos(state, pindex->nFile, _pos, ::GetSerializeSize(blockundo, CLIENT_VERSION) + 40)) {
+        const CompactBlockUndo compact_undo{blockundo};
+        // The record magic and size, then the undo data and its CRC32C
+        if (!FindUndoPos(state, pindex->nFile, _pos, compact_undo.GetData().size() + 12)) {
             return error("ConnectBlock(): FindUndoPos failed");
         }
-        if (!UndoWriteToDisk(blockundo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart())) {
+        if (!UndoWriteToDisk(compact_undo, _pos, pindex->pprev->GetBlockHash(), chainparams.MessageStart())) {
             return AbortNode(state, "Failed to write undo data");
         }
         // rev files are written in block height order, whereas blk files are written as blocks come in (often out of order)
@@ -718,25 +1512,57 @@ bool BlockManager::WriteUndoDataForBlock(const CBlockUndo& blockundo, BlockValid
     return true;
 }
 
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams)
+bool IsCompressedBlockRecord(const unsigned char* magic, const CMessageHeader::MessageStartChars& message_start)
+{
+    constexpr size_t last{CMessageHeader::MESSAGE_START_SIZE - 1};
+    return memcmp(magic, message_start, last) == 0 && magic[last] == static_cast<unsigned char>(~message_start[last]);
+}
+
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams, bool check_pow)
 {
     block.SetNull();
 
-    // Open history file to read
-    CAutoFile filein(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
-    if (filein.IsNull()) {
-        return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+    if (!g_block_file_writer.WriteIfPending(pos)) {
+        return error("ReadBlockFromDisk: failed to write pending blocks for %s", pos.ToString());
     }
+    Span<const uint8_t> header, data;
+    if (const auto file{MapBlock(pos, header, data)}) {
+        // Deserialize straight from the mapping
+        try {
+            SpanReader reader{SER_DISK, CLIENT_VERSION, data};
+            if (IsCompressedBlockRecord(header.data(), Params().MessageStart())) {
+                reader >> Using<CompressedBlockFormatter>(block);
+            } else {
+                reader >> block;
+            }
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize error - %s at %s", __func__, e.what(), pos.ToString());
+        }
+    } else {
+        // Open history file to read, at the record header if there is one
+        const bool has_header{pos.nPos >= 8};
+        CAutoFile filein(OpenBlockFile(has_header ? FlatFilePos{pos.nFile, pos.nPos - 8} : pos, true), SER_DISK, CLIENT_VERSION);
+        if (filein.IsNull()) {
+            return error("ReadBlockFromDisk: OpenBlockFile failed for %s", pos.ToString());
+        }
 
-    // Read block
-    try {
-        filein >> block;
-    } catch (const std::exception& e) {
-        return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        // Read block
+        try {
+            CMessageHeader::MessageStartChars blk_start{};
+            unsigned int blk_size;
+            if (has_header) filein >> blk_start >> blk_size;
+            if (IsCompressedBlockRecord(blk_start, Params().MessageStart())) {
+                filein >> Using<CompressedBlockFormatter>(block);
+            } else {
+                filein >> block;
+            }
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
+        }
     }
 
     // Check the header
-    if (!CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams)) {
+    if (check_pow && !CheckProofOfWork(GetPoWHashCached(block), block.nBits, consensusParams)) {
         return error("ReadBlockFromDisk: Errors in block header at %s", pos.ToString());
     }
 
@@ -750,9 +1576,17 @@ bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::P
 
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams)
 {
-    const FlatFilePos block_pos{WITH_LOCK(cs_main, return pindex->GetBlockPos())};
+    FlatFilePos block_pos;
+    bool check_pow{true};
+    {
+        LOCK(cs_main);
+        block_pos = pindex->GetBlockPos();
+        // The header of a BLOCK_VALID_TREE entry passed CheckBlockHeader when
+        // it was added to the index, so a matching hash below proves the PoW.
+        check_pow = !(fTrustIndexedBlockPoW && pindex->IsValid(BLOCK_VALID_TREE));
+    }
 
-    if (!ReadBlockFromDisk(block, block_pos, consensusParams)) {
+    if (!ReadBlockFromDisk(block, block_pos, consensusParams, check_pow)) {
         return false;
     }
     if (block.GetHash() != pindex->GetBlockHash()) {
@@ -762,8 +1596,37 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus
     return true;
 }
 
+bool ReadRawBlockFromDisk(RawBlock& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
+{
+    if (!g_block_file_writer.WriteIfPending(pos)) {
+        return error("%s: failed to write pending blocks for %s", __func__, pos.ToString());
+    }
+    Span<const uint8_t> header, data;
+    auto file{MapBlock(pos, header, data)};
+    // Compressed records are expanded into a buffer below
+    if (file && !IsCompressedBlockRecord(header.data(), message_start)) {
+        if (memcmp(header.data(), message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+            return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
+                         HexStr(header.first(CMessageHeader::MESSAGE_START_SIZE)),
+                         HexStr(message_start));
+        }
+        block.data = data;
+        block.owner = std::move(file);
+        return true;
+    }
+
+    auto buffer{std::make_shared<std::vector<uint8_t>>()};
+    if (!ReadRawBlockFromDisk(*buffer, pos, message_start)) return false;
+    block.data = *buffer;
+    block.owner = std::move(buffer);
+    return true;
+}
+
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start)
 {
+    if (!g_block_file_writer.WriteIfPending(pos)) {
+        return error("%s: failed to write pending blocks for %s", __func__, pos.ToString());
+    }
     FlatFilePos hpos = pos;
     hpos.nPos -= 8; // Seek back 8 bytes for meta header
     CAutoFile filein(OpenBlockFile(hpos, true), SER_DISK, CLIENT_VERSION);
@@ -777,7 +1640,8 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
 
         filein >> blk_start >> blk_size;
 
-        if (memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
+        const bool compressed{IsCompressedBlockRecord(blk_start, message_start)};
+        if (!compressed && memcmp(blk_start, message_start, CMessageHeader::MESSAGE_START_SIZE)) {
             return error("%s: Block magic mismatch for %s: %s versus expected %s", __func__, pos.ToString(),
                          HexStr(blk_start),
                          HexStr(message_start));
@@ -790,6 +1654,14 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
 
         block.resize(blk_size); // Zeroing of memory is intentional here
         filein.read(MakeWritableByteSpan(block));
+
+        if (compressed) {
+            // Return the block in the regular serialization
+            CBlock expanded;
+            SpanReader{SER_DISK, CLIENT_VERSION, block} >> Using<CompressedBlockFormatter>(expanded);
+            block.clear();
+            CVectorWriter{SER_DISK, CLIENT_VERSION, block, 0} << expanded;
+        }
     } catch (const std::exception& e) {
         return error("%s: Read from block file failed: %s for %s", __func__, e.what(), pos.ToString());
     }
@@ -797,10 +1669,102 @@ bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, c
     return true;
 }
 
+namespace {
+/** Position in a serialized block, throwing std::ios_base::failure when reading past its end. */
+class RawBlockCursor
+{
+    const Span<const uint8_t> m_data;
+    size_t m_pos{0};
+
+public:
+    explicit RawBlockCursor(Span<const uint8_t> data) : m_data{data} {}
+
+    size_t Pos() const { return m_pos; }
+    size_t Remaining() const { return m_data.size() - m_pos; }
+    uint8_t Peek(size_t offset) const { return m_data[m_pos + offset]; }
+
+    void Skip(uint64_t n)
+    {
+        if (n > Remaining()) throw std::ios_base::failure("RawBlockCursor::Skip(): end of data");
+        m_pos += n;
+    }
+
+    uint64_t ReadCompactSize()
+    {
+        SpanReader reader{SER_NETWORK, PROTOCOL_VERSION, m_data.subspan(m_pos)};
+        const uint64_t n{::ReadCompactSize(reader)};
+        m_pos = m_data.size() - reader.size();
+        return n;
+    }
+
+    //! Skip a compact size prefixed byte vector, such as a script or witness stack item
+    void SkipBytes() { Skip(ReadCompactSize()); }
+};
+} // namespace
+
+std::optional<RawBlock> StripRawBlockWitness(const RawBlock& block)
+{
+    RawBlockCursor cursor{block.data};
+    // Parts of block that are kept, copied only once witness data is found
+    std::vector<uint8_t> stripped;
+    size_t keep_from{0};
+    bool has_witness{false};
+    const auto keep_until = [&](size_t end) {
+        if (!has_witness) stripped.reserve(block.data.size());
+        has_witness = true;
+        stripped.insert(stripped.end(), block.data.begin() + keep_from, block.data.begin() + end);
+    };
+
+    try {
+        cursor.Skip(80); // block header
+        for (uint64_t n_tx{cursor.ReadCompactSize()}; n_tx > 0; --n_tx) {
+            cursor.Skip(4); // nVersion
+            bool tx_witness{false};
+            if (cursor.Remaining() >= 2 && cursor.Peek(0) == 0) {
+                // An empty vin is the witness marker, followed by the flags
+                if (cursor.Peek(1) != 1) return std::nullopt;
+                tx_witness = true;
+                keep_until(cursor.Pos());
+                cursor.Skip(2);
+                keep_from = cursor.Pos();
+            }
+            const uint64_t n_in{cursor.ReadCompactSize()};
+            for (uint64_t i{0}; i < n_in; ++i) {
+                cursor.Skip(36); // prevout
+                cursor.SkipBytes(); // scriptSig
+                cursor.Skip(4); // nSequence
+            }
+            for (uint64_t n_out{cursor.ReadCompactSize()}; n_out > 0; --n_out) {
+                cursor.Skip(8); // nValue
+                cursor.SkipBytes(); // scriptPubKey
+            }
+            if (tx_witness) {
+                keep_until(cursor.Pos());
+                for (uint64_t i{0}; i < n_in; ++i) {
+                    for (uint64_t n_items{cursor.ReadCompactSize()}; n_items > 0; --n_items) {
+                        cursor.SkipBytes();
+                    }
+                }
+                keep_from = cursor.Pos();
+            }
+            cursor.Skip(4); // nLockTime
+        }
+    } catch (const std::ios_base::failure&) {
+        return std::nullopt;
+    }
+    if (cursor.Remaining() != 0) return std::nullopt;
+    if (!has_witness) return block;
+
+    keep_until(block.data.size());
+    auto buffer{std::make_shared<const std::vector<uint8_t>>(std::move(stripped))};
+    return RawBlock{buffer, *buffer};
+}
+
 /** Store block on disk. If dbp is non-nullptr, the file is known to already reside on disk */
 FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight, CChain& active_chain, const CChainParams& chainparams, const FlatFilePos* dbp)
 {
-    unsigned int nBlockSize = ::GetSerializeSize(block, CLIENT_VERSION);
+    const bool compress{fCompressBlockFiles && dbp == nullptr};
+    unsigned int nBlockSize = compress ? ::GetSerializeSize(Using<CompressedBlockFormatter>(block), CLIENT_VERSION) : ::GetSerializeSize(block, CLIENT_VERSION);
     FlatFilePos blockPos;
     if (dbp != nullptr) {
         blockPos = *dbp;
@@ -810,7 +1774,7 @@ FlatFilePos BlockManager::SaveBlockToDisk(const CBlock& block, int nHeight, CCha
         return FlatFilePos();
     }
     if (dbp == nullptr) {
-        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart())) {
+        if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart(), compress)) {
             AbortNode("Failed to write block");
             return FlatFilePos();
         }
@@ -8,13 +8,23 @@
 #include <attributes.h>
 #include <chain.h>
 #include <fs.h>
+#include <node/blockmap.h>
 #include <protocol.h>
+#include <span.h>
 #include <sync.h>
 #include <txdb.h>
+#include <util/hasher.h>
 
 #include <atomic>
+#include <condition_variable>
 #include <cstdint>
+#include <list>
+#include <memory>
+#include <optional>
+#include <set>
+#include <thread>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 extern RecursiveMutex cs_main;
@@ -26,6 +36,7 @@ class CBlockFileInfo;
 class CBlockUndo;
 class CChain;
 class CChainParams;
+class CTxUndo;
 class Chainstate;
 class ChainstateManager;
 struct CCheckpointData;
@@ -36,6 +47,21 @@ struct Params;
 
 namespace node {
 static constexpr bool DEFAULT_STOPAFTERBLOCKIMPORT{false};
+static constexpr bool DEFAULT_TRUST_INDEXED_BLOCK_POW{false};
+static constexpr bool DEFAULT_BLOCK_INDEX_SNAPSHOT{false};
+/** Memory-mapping block files needs plenty of address space, so only default to it on 64-bit POSIX systems */
+#if !defined(WIN32) && SIZE_MAX > UINT32_MAX
+static constexpr bool DEFAULT_BLOCK_FILE_MMAP{true};
+#else
+static constexpr bool DEFAULT_BLOCK_FILE_MMAP{false};
+#endif
+static constexpr bool DEFAULT_COMPRESS_BLOCK_FILES{false};
+/** The maximum number of block files kept memory-mapped at once */
+static constexpr size_t MAX_MAPPED_BLOCK_FILES{16};
+/** The number of blocks whose txids are cached for merkle proofs */
+static constexpr size_t MAX_CACHED_BLOCK_TXIDS{64};
+/** The number of recently received or connected blocks, and their undo data, kept in memory */
+static constexpr size_t MAX_RECENT_BLOCKS{8};
 
 /** The pre-allocation chunk size for blk?????.dat files (since 0.8) */
 static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
@@ -43,6 +69,8 @@ static const unsigned int BLOCKFILE_CHUNK_SIZE = 0x1000000; // 16 MiB
 static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 /** The maximum size of a blk?????.dat file (since 0.8) */
 static const unsigned int MAX_BLOCKFILE_SIZE = 0x8000000; // 128 MiB
+/** Blocks and undo data appended to their files are combined into writes of up to this size */
+static constexpr size_t MAX_FILE_WRITE_BUFFER{4 << 20}; // 4 MiB
 
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
@@ -51,12 +79,16 @@ extern std::atomic_bool fReindex;
 extern bool fPruneMode;
 /** Number of bytes of block files that we're trying to stay below. */
 extern uint64_t nPruneTarget;
-
-// Because validation code takes pointers to the map's CBlockIndex objects, if
-// we ever switch to another associative container, we need to either use a
-// container that has stable addressing (true of all std associative
-// containers), or make the key a `std::unique_ptr<CBlockIndex>`
-using BlockMap = std::unordered_map<uint256, CBlockIndex, BlockHasher>;
+/** True if blocks read through their index entry may skip the proof-of-work
+ * check when the header is already part of the validated block index. */
+extern bool fTrustIndexedBlockPoW;
+/** True if the block index is loaded from, and written to, a snapshot file
+ * next to the block tree database when possible. */
+extern bool fBlockIndexSnapshot;
+/** True if blocks are read from memory-mapped block files. */
+extern bool fBlockFileMmap;
+/** True if new blocks are written to the block files in the compressed format. */
+extern bool fCompressBlockFiles;
 
 struct CBlockIndexWorkComparator {
     bool operator()(const CBlockIndex* pa, const CBlockIndex* pb) const;
@@ -91,6 +123,13 @@ private:
      */
     bool LoadBlockIndex(const Consensus::Params& consensus_params)
         EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    /**
+     * Fill an empty m_block_index from the block index snapshot file, if the
+     * block tree database records that it is up to date. Sets loaded to
+     * whether it was used; returns false only if it was found to be
+     * inconsistent after part of it has been loaded.
+     */
+    bool LoadBlockIndexSnapshot(bool& loaded) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     void FlushBlockFile(bool fFinalize = false, bool finalize_undo = false);
     void FlushUndoFile(int block_file, bool finalize = false);
     bool FindBlockPos(FlatFilePos& pos, unsigned int nAddSize, unsigned int nHeight, CChain& active_chain, uint64_t nTime, bool fKnown);
@@ -119,6 +158,46 @@ private:
     RecursiveMutex cs_LastBlockFile;
     std::vector<CBlockFileInfo> m_blockfile_info;
     int m_last_blockfile = 0;
+    /**
+     * The non-empty entries of m_blockfile_info as (nHeightLast, file number),
+     * so the files old enough to be pruned are found in the order of their
+     * blocks without scanning all of them.
+     */
+    std::set<std::pair<unsigned int, int>> m_files_by_height_last GUARDED_BY(cs_LastBlockFile);
+    //! Update m_files_by_height_last after m_blockfile_info[file] changed from old_info
+    void UpdateFileHeightIndex(int file, const CBlockFileInfo& old_info) EXCLUSIVE_LOCKS_REQUIRED(cs_LastBlockFile);
+
+    Mutex m_unlink_mutex;
+    std::condition_variable m_unlink_cv;
+    //! Numbers of the pruned blk/rev pairs waiting for the unlink thread
+    std::vector<int> m_files_to_unlink GUARDED_BY(m_unlink_mutex);
+    //! Whether the unlink thread is deleting files it took from m_files_to_unlink
+    bool m_unlinking GUARDED_BY(m_unlink_mutex){false};
+    bool m_unlink_stop GUARDED_BY(m_unlink_mutex){false};
+    //! Runs UnlinkThread(), started by the first QueueUnlinkPrunedFiles()
+    std::thread m_unlink_thread;
+    void UnlinkThread() EXCLUSIVE_LOCKS_REQUIRED(!m_unlink_mutex);
+
+    Mutex m_block_txids_mutex;
+    //! The txids of the MAX_CACHED_BLOCK_TXIDS blocks used last, most recent first
+    std::list<std::pair<uint256, std::shared_ptr<const std::vector<uint256>>>> m_block_txids GUARDED_BY(m_block_txids_mutex);
+    std::unordered_map<uint256, decltype(m_block_txids)::iterator, BlockHasher> m_block_txids_by_hash GUARDED_BY(m_block_txids_mutex);
+    void AddBlockTxids(const uint256& block_hash, std::shared_ptr<const std::vector<uint256>> txids) EXCLUSIVE_LOCKS_REQUIRED(m_block_txids_mutex);
+
+    struct RecentBlock {
+        uint256 hash;
+        std::shared_ptr<const CBlock> block;
+        //! Set once the block is connected
+        std::shared_ptr<const CBlockUndo> undo;
+    };
+    Mutex m_recent_blocks_mutex;
+    //! The last MAX_RECENT_BLOCKS blocks received or connected, most recently used first
+    std::list<RecentBlock> m_recent_blocks GUARDED_BY(m_recent_blocks_mutex);
+    std::unordered_map<uint256, decltype(m_recent_blocks)::iterator, BlockHasher> m_recent_blocks_by_hash GUARDED_BY(m_recent_blocks_mutex);
+    //! Find the entry of a block, moved to the front, or add one for it
+    RecentBlock& RecentBlockEntry(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(m_recent_blocks_mutex);
+    //! Find the entry of a block, moved to the front, or return nullptr
+    const RecentBlock* FindRecentBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(m_recent_blocks_mutex);
     /** Global flag to indicate we should check to see if there are
      *  block/undo files that should be deleted.  Set on startup
      *  or if we allocate more file space when we're in prune mode
@@ -140,6 +219,45 @@ private:
     std::unordered_map<std::string, PruneLockInfo> m_prune_locks GUARDED_BY(::cs_main);
 
 public:
+    /** Writes the block and undo data that is still buffered, and deletes the pruned files still queued. */
+    ~BlockManager();
+
+    /**
+     * Delete the files of setFilesToPrune, as UnlinkPrunedFiles() does, on a
+     * background thread, so that flushing does not wait for the file system.
+     * Their blocks must already be marked as pruned in the block index.
+     */
+    void QueueUnlinkPrunedFiles(const std::set<int>& setFilesToPrune) EXCLUSIVE_LOCKS_REQUIRED(!m_unlink_mutex);
+    /** Wait until the files passed to QueueUnlinkPrunedFiles() are deleted. */
+    void WaitForUnlinks() EXCLUSIVE_LOCKS_REQUIRED(!m_unlink_mutex);
+
+    /** Keep the txids of a block, e.g. one just connected, for GetBlockTxids(). */
+    void CacheBlockTxids(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(!m_block_txids_mutex);
+    /**
+     * Return the txids of a block, in order, to build merkle proofs from.
+     * Those of recently connected or used blocks are cached, otherwise the
+     * block is read from disk. Returns nullptr if reading it fails.
+     */
+    std::shared_ptr<const std::vector<uint256>> GetBlockTxids(const CBlockIndex& index, const Consensus::Params& consensus_params)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_block_txids_mutex);
+
+    /** Keep a block just received or connected in memory, for ReadBlock(). */
+    void CacheRecentBlock(std::shared_ptr<const CBlock> block) EXCLUSIVE_LOCKS_REQUIRED(!m_recent_blocks_mutex);
+    /** Keep the undo data of a block just connected in memory, for ReadBlockUndo(). */
+    void CacheRecentBlockUndo(const uint256& block_hash, std::shared_ptr<const CBlockUndo> undo) EXCLUSIVE_LOCKS_REQUIRED(!m_recent_blocks_mutex);
+    /** Return a block if it is one of the recent blocks kept in memory, otherwise nullptr. */
+    std::shared_ptr<const CBlock> GetRecentBlock(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_recent_blocks_mutex);
+    /**
+     * Return the block of index, kept in memory if it is one of the recent
+     * blocks, otherwise read from disk. Returns nullptr if reading it fails.
+     */
+    std::shared_ptr<const CBlock> ReadBlock(const CBlockIndex& index, const Consensus::Params& consensus_params)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_recent_blocks_mutex);
+    /** Return the undo data of a block if it is one of the recent blocks kept in memory, otherwise nullptr. */
+    std::shared_ptr<const CBlockUndo> GetRecentBlockUndo(const uint256& block_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_recent_blocks_mutex);
+    /** Return the undo data of index, as ReadBlock() does for its block. */
+    std::shared_ptr<const CBlockUndo> ReadBlockUndo(const CBlockIndex& index) EXCLUSIVE_LOCKS_REQUIRED(!m_recent_blocks_mutex);
+
     BlockMap m_block_index GUARDED_BY(cs_main);
 
     std::vector<CBlockIndex*> GetAllBlockIndices() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
@@ -153,6 +271,13 @@ public:
     std::unique_ptr<CBlockTreeDB> m_block_tree_db GUARDED_BY(::cs_main);
 
     bool WriteBlockIndexDB() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /**
+     * Write all block index entries to the block index snapshot file and
+     * record it in the block tree database, so the next startup can load it
+     * instead of the database records. To be called at shutdown, after the
+     * last WriteBlockIndexDB(), which invalidates the snapshot.
+     */
+    bool WriteBlockIndexSnapshot() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
     bool LoadBlockIndexDB(const Consensus::Params& consensus_params) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     CBlockIndex* AddToBlockIndex(const CBlockHeader& block, CBlockIndex*& best_header) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -204,12 +329,90 @@ fs::path GetBlockPosFilename(const FlatFilePos& pos);
  */
 void UnlinkPrunedFiles(const std::set<int>& setFilesToPrune);
 
+/**
+ * Whether the record magic of a block in a block file marks it as compressed.
+ * Compressed blocks are stored with CompressedBlockFormatter, after the
+ * network magic with its last byte inverted, so that the first byte still
+ * matches when scanning block files for records. Reading blocks handles
+ * both formats.
+ */
+bool IsCompressedBlockRecord(const unsigned char* magic, const CMessageHeader::MessageStartChars& message_start);
+
 /** Functions for disk access for blocks */
-bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams);
+bool ReadBlockFromDisk(CBlock& block, const FlatFilePos& pos, const Consensus::Params& consensusParams, bool check_pow = true);
+/**
+ * Read the block referenced by pindex and verify its hash matches the index.
+ * With fTrustIndexedBlockPoW set, the proof-of-work check is replaced by that
+ * hash comparison for entries that are at least BLOCK_VALID_TREE, as their
+ * header was checked when it was accepted into the index.
+ */
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
 bool ReadRawBlockFromDisk(std::vector<uint8_t>& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
 
+/** A serialized block as stored on disk, and the memory holding it. */
+struct RawBlock {
+    //! Keeps data valid: the mapped block file, or a buffer the block was read into
+    std::shared_ptr<const void> owner;
+    Span<const uint8_t> data;
+};
+
+/**
+ * Read the serialized block at pos. With fBlockFileMmap set, data points into
+ * the memory-mapped block file, so the block is neither copied nor read with
+ * a system call.
+ */
+bool ReadRawBlockFromDisk(RawBlock& block, const FlatFilePos& pos, const CMessageHeader::MessageStartChars& message_start);
+
+/**
+ * Return block, a serialized block with witness data as stored on disk, in
+ * the serialization without witness data. A block without witness data is
+ * returned as is, otherwise the stripped copy is held by the returned owner.
+ * Return std::nullopt if block cannot be parsed.
+ */
+std::optional<RawBlock> StripRawBlockWitness(const RawBlock& block);
+
+/**
+ * The undo data of a block as stored in compact undo records: the number of
+ * transactions, the size of the undo data of each, and then that data,
+ * encoded with CompactTxUndoFormatter. It is kept serialized, so that the
+ * undo data of one transaction can be decoded without decoding all of it.
+ */
+class CompactBlockUndo
+{
+    std::vector<uint8_t> m_data;
+    //! Offset and size in m_data of the undo data of each transaction
+    std::vector<std::pair<size_t, size_t>> m_txs;
+
+public:
+    CompactBlockUndo() = default;
+    /** Take serialized undo data. Throws std::ios_base::failure if its sizes do not add up. */
+    explicit CompactBlockUndo(std::vector<uint8_t> data);
+    explicit CompactBlockUndo(const CBlockUndo& blockundo);
+
+    Span<const uint8_t> GetData() const { return m_data; }
+    //! The number of transactions, not counting the coinbase
+    size_t size() const { return m_txs.size(); }
+    /** Decode the undo data of the transaction at index i + 1 of the block. Throws std::ios_base::failure if it is malformed. */
+    CTxUndo GetTxUndo(size_t i) const;
+    /** Decode the undo data of all transactions. Throws std::ios_base::failure if it is malformed. */
+    CBlockUndo GetBlockUndo() const;
+};
+
+/**
+ * Whether the record magic of undo data in an undo file marks it as a
+ * compact undo record. Those are marked as compressed blocks are, see
+ * IsCompressedBlockRecord(), and hold a CompactBlockUndo, followed by a
+ * CRC32C of the hash of the previous block and the undo data, instead of a
+ * double SHA256. Reading undo data handles both formats.
+ */
+bool IsCompactUndoRecord(const unsigned char* magic, const CMessageHeader::MessageStartChars& message_start);
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CBlockIndex* pindex);
+/**
+ * Read the undo data of pindex, decoding the undo data of a transaction only
+ * when it is asked for. Undo data in the older format is converted.
+ */
+bool UndoReadFromDisk(CompactBlockUndo& blockundo, const CBlockIndex* pindex);
 
 void ThreadImport(ChainstateManager& chainman, std::vector<fs::path> vImportFiles, const ArgsManager& args, const fs::path& mempool_path);
 } // namespace node
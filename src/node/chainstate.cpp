@@ -9,11 +9,13 @@
 #include <consensus/params.h>
 #include <node/blockstorage.h>
 #include <node/caches.h>
+#include <shutdown.h>
 #include <sync.h>
 #include <threadsafety.h>
 #include <tinyformat.h>
 #include <txdb.h>
 #include <uint256.h>
+#include <util/thread.h>
 #include <util/time.h>
 #include <util/translation.h>
 #include <validation.h>
@@ -22,6 +24,7 @@
 #include <atomic>
 #include <cassert>
 #include <memory>
+#include <thread>
 #include <vector>
 
 namespace node {
@@ -155,23 +158,52 @@ ChainstateLoadResult VerifyLoadedChainstate(ChainstateManager& chainman, const C
         return options.reindex || options.reindex_chainstate || chainstate->CoinsTip().GetBestBlock().IsNull();
     };
 
-    LOCK(cs_main);
-
-    for (Chainstate* chainstate : chainman.GetAll()) {
-        if (!is_coinsview_empty(chainstate)) {
-            const CBlockIndex* tip = chainstate->m_chain.Tip();
-            if (tip && tip->nTime > GetTime() + MAX_FUTURE_BLOCK_TIME) {
-                return {ChainstateLoadStatus::FAILURE, _("The block database contains a block which appears to be from the future. "
-                                                         "This may be due to your computer's date and time being set incorrectly. "
-                                                         "Only rebuild the block database if you are sure that your computer's date and time are correct")};
+    std::vector<Chainstate*> chainstates;
+    {
+        LOCK(cs_main);
+        for (Chainstate* chainstate : chainman.GetAll()) {
+            if (!is_coinsview_empty(chainstate)) {
+                const CBlockIndex* tip = chainstate->m_chain.Tip();
+                if (tip && tip->nTime > GetTime() + MAX_FUTURE_BLOCK_TIME) {
+                    return {ChainstateLoadStatus::FAILURE, _("The block database contains a block which appears to be from the future. "
+                                                             "This may be due to your computer's date and time being set incorrectly. "
+                                                             "Only rebuild the block database if you are sure that your computer's date and time are correct")};
+                }
+                chainstates.push_back(chainstate);
             }
+        }
+    }
 
-            if (!CVerifyDB().VerifyDB(
-                    *chainstate, chainman.GetConsensus(), chainstate->CoinsDB(),
-                    options.check_level,
-                    options.check_blocks)) {
-                return {ChainstateLoadStatus::FAILURE, _("Corrupted block database detected")};
+    if (options.check_in_background) {
+        if (chainstates.empty()) return {ChainstateLoadStatus::SUCCESS, {}};
+        VerifyDBStatus& status{chainman.m_verify_blocks_status};
+        status.check_level = options.check_level;
+        status.check_blocks = options.check_blocks;
+        status.running = true;
+        chainman.m_verify_blocks = std::thread(&util::TraceThread, "verifyblk", [&chainman, &status, chainstates, check_level = options.check_level, check_blocks = options.check_blocks] {
+            bool ok{true};
+            for (Chainstate* chainstate : chainstates) {
+                // The node is running, so the coins of the tip may not have been flushed
+                CCoinsView& coins_tip{WITH_LOCK(::cs_main, return chainstate->CoinsTip())};
+                ok = CVerifyDB(&status).VerifyDB(*chainstate, chainman.GetConsensus(), coins_tip, check_level, check_blocks);
+                if (!ok) break;
+            }
+            status.ok = ok;
+            status.running = false;
+            if (!ok) {
+                AbortNode("Corrupted block database detected",
+                          _("Corrupted block database detected. Please restart with -reindex or -reindex-chainstate to recover."));
             }
+        });
+        return {ChainstateLoadStatus::SUCCESS, {}};
+    }
+
+    for (Chainstate* chainstate : chainstates) {
+        if (!CVerifyDB().VerifyDB(
+                *chainstate, chainman.GetConsensus(), WITH_LOCK(::cs_main, return chainstate->CoinsDB()),
+                options.check_level,
+                options.check_blocks)) {
+            return {ChainstateLoadStatus::FAILURE, _("Corrupted block database detected")};
         }
     }
 
@@ -27,6 +27,9 @@ struct ChainstateLoadOptions {
     bool prune{false};
     int64_t check_blocks{DEFAULT_CHECKBLOCKS};
     int64_t check_level{DEFAULT_CHECKLEVEL};
+    //! Verify the blocks in ChainstateManager::m_verify_blocks rather than
+    //! before VerifyLoadedChainstate returns, aborting the node on a failure.
+    bool check_in_background{false};
     std::function<bool()> check_interrupt;
     std::function<void()> coins_error_cb;
 };
@@ -11,6 +11,8 @@
 #include <net.h>
 #include <net_processing.h>
 #include <netgroup.h>
+#include <node/block_prefetch.h>
+#include <node/startup.h>
 #include <policy/fees.h>
 #include <scheduler.h>
 #include <txmempool.h>
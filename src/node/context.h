@@ -30,6 +30,9 @@ class WalletLoader;
 } // namespace interfaces
 
 namespace node {
+class BlockPrefetcher;
+class StartupProfiler;
+
 //! NodeContext struct containing references to chain state and connection
 //! state.
 //!
@@ -52,6 +55,8 @@ struct NodeContext {
     std::unique_ptr<CBlockPolicyEstimator> fee_estimator;
     std::unique_ptr<PeerManager> peerman;
     std::unique_ptr<ChainstateManager> chainman;
+    //! Reader of blocks ahead of wallet rescans, shared by the wallets
+    std::unique_ptr<BlockPrefetcher> block_prefetcher;
     std::unique_ptr<BanMan> banman;
     ArgsManager* args{nullptr}; // Currently a raw pointer because the memory is not managed by this struct
     std::unique_ptr<interfaces::Chain> chain;
@@ -62,6 +67,8 @@ struct NodeContext {
     interfaces::WalletLoader* wallet_loader{nullptr};
     std::unique_ptr<CScheduler> scheduler;
     std::function<void()> rpc_interruption_point = [] {};
+    //! Timing of the stages of AppInitMain, reported by getstartupinfo
+    std::unique_ptr<StartupProfiler> startup_profiler;
 
     //! Declare default constructor and destructor that are not inline, so code
     //! instantiating the NodeContext struct doesn't need to #include class
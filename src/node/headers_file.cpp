@@ -0,0 +1,110 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/headers_file.h>
+
+#include <chain.h>
+#include <chainparams.h>
+#include <consensus/validation.h>
+#include <logging.h>
+#include <primitives/block.h>
+#include <shutdown.h>
+#include <streams.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/translation.h>
+#include <validation.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <system_error>
+#include <vector>
+
+namespace node {
+//! Size of a serialized header, without the transaction count of a headers message
+static constexpr uint64_t HEADER_SIZE{80};
+//! Headers imported between two progress messages
+static constexpr size_t HEADERS_PER_LOG{100 * HEADERS_FILE_BATCH};
+
+void WriteHeadersFile(const CBlockIndex& tip, AutoFile& file)
+{
+    // Block index entries are never changed or freed once added, so they can be read without cs_main
+    for (int height = 0; height <= tip.nHeight; ++height) {
+        file << Assert(tip.GetAncestor(height))->GetBlockHeader();
+    }
+}
+
+util::Result<size_t> LoadHeadersFile(ChainstateManager& chainman, const fs::path& path)
+{
+    AutoFile file{fsbridge::fopen(path, "rb")};
+    if (file.IsNull()) {
+        return util::Error{strprintf(_("Could not open headers file %s"), fs::quoted(fs::PathToString(path)))};
+    }
+    std::error_code ec;
+    const uintmax_t size{fs::file_size(path, ec)};
+    if (ec || size % HEADER_SIZE != 0) {
+        return util::Error{strprintf(_("Headers file %s is truncated"), fs::quoted(fs::PathToString(path)))};
+    }
+
+    const Consensus::Params& consensus{chainman.GetConsensus()};
+    const MapCheckpoints& checkpoints{chainman.GetParams().Checkpoints().mapCheckpoints};
+    //! Height of the header before the batch
+    std::optional<int> height;
+    size_t imported{0};
+    std::vector<CBlockHeader> headers;
+    for (uint64_t left{size / HEADER_SIZE}; left > 0;) {
+        if (ShutdownRequested()) break;
+        headers.resize(std::min<uint64_t>(left, HEADERS_FILE_BATCH));
+        left -= headers.size();
+        for (CBlockHeader& header : headers) {
+            file >> header;
+        }
+
+        if (!height) {
+            if (headers.front().GetHash() == consensus.hashGenesisBlock) {
+                // The genesis block is known, and need not have valid proof of work
+                height = 0;
+                headers.erase(headers.begin());
+                ++imported;
+                if (headers.empty()) continue;
+            } else {
+                LOCK(cs_main);
+                const CBlockIndex* prev{chainman.m_blockman.LookupBlockIndex(headers.front().hashPrevBlock)};
+                if (!prev) {
+                    return util::Error{strprintf(_("The first header of headers file %s does not connect to a known header"), fs::quoted(fs::PathToString(path)))};
+                }
+                height = prev->nHeight;
+            }
+        }
+
+        if (fCheckpointsEnabled) {
+            for (auto it{checkpoints.upper_bound(*height)}; it != checkpoints.end() && it->first <= *height + int(headers.size()); ++it) {
+                if (headers[it->first - *height - 1].GetHash() != it->second) {
+                    return util::Error{strprintf(_("The header at height %d of headers file %s does not match the checkpoint"), it->first, fs::quoted(fs::PathToString(path)))};
+                }
+            }
+        }
+
+        // A known last header implies known ancestors, as with an interrupted earlier import
+        const bool known{WITH_LOCK(cs_main, return chainman.m_blockman.LookupBlockIndex(headers.back().GetHash()) != nullptr)};
+        if (!known) {
+            if (!HasValidProofOfWork(headers, consensus)) {
+                return util::Error{strprintf(_("A header after height %d of headers file %s has invalid proof of work"), *height, fs::quoted(fs::PathToString(path)))};
+            }
+            BlockValidationState state;
+            if (!chainman.ProcessNewBlockHeaders(headers, /*min_pow_checked=*/true, state)) {
+                return util::Error{strprintf(_("A header after height %d of headers file %s is invalid: %s"), *height, fs::quoted(fs::PathToString(path)), state.ToString())};
+            }
+        }
+
+        *height += headers.size();
+        if ((imported + headers.size()) / HEADERS_PER_LOG != imported / HEADERS_PER_LOG) {
+            LogPrintf("Imported headers up to height %d from %s\n", *height, fs::PathToString(path));
+        }
+        imported += headers.size();
+    }
+    return imported;
+}
+} // namespace node
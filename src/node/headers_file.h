@@ -0,0 +1,43 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_HEADERS_FILE_H
+#define BITCOIN_NODE_HEADERS_FILE_H
+
+#include <fs.h>
+#include <util/result.h>
+
+#include <cstddef>
+
+class AutoFile;
+class CBlockIndex;
+class ChainstateManager;
+
+namespace node {
+//! Headers of a headers file checked and imported at a time. The proof-of-work
+//! hashes of a batch must fit the proof-of-work hash cache.
+static constexpr size_t HEADERS_FILE_BATCH{2000};
+
+/**
+ * Write the headers of the chain ending in tip, from the genesis block on, to
+ * file as a headers file: 80 byte headers one after the other.
+ */
+void WriteHeadersFile(const CBlockIndex& tip, AutoFile& file);
+
+/**
+ * Import a headers file, as written by WriteHeadersFile(), into the block
+ * index. It does not have to start with the genesis block, as long as its
+ * first header connects to a known one. Each batch of headers is checked
+ * against the checkpoints, then for proof of work on the proof-of-work check
+ * threads and last in context by ProcessNewBlockHeaders(), which finds the
+ * proof-of-work hashes in the cache. Batches that are known already are
+ * skipped.
+ *
+ * @returns the number of headers imported, or an error about the first
+ *          invalid header, in which case the headers before it were imported.
+ */
+util::Result<size_t> LoadHeadersFile(ChainstateManager& chainman, const fs::path& path);
+} // namespace node
+
+#endif // BITCOIN_NODE_HEADERS_FILE_H
@@ -0,0 +1,185 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/headerstore.h>
+
+#include <chain.h>
+#include <hash.h>
+#include <logging.h>
+#include <powcache.h>
+#include <span.h>
+#include <streams.h>
+#include <util/system.h>
+#include <version.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+namespace node {
+std::unique_ptr<HeaderStore> g_header_store;
+
+/** Number of records the file is mapped for at least, so that it is not remapped for every header. */
+static constexpr size_t MIN_MAPPED_RECORDS{1 << 20};
+/** Number of headers Sync hashes and writes at a time. */
+static constexpr size_t SYNC_BATCH_SIZE{2000};
+
+HeaderStore::HeaderStore(fs::path path) : m_path{std::move(path)} {}
+
+HeaderStore::~HeaderStore()
+{
+    LOCK(m_mutex);
+    Unmap();
+    if (m_file) fclose(m_file);
+}
+
+void HeaderStore::Unmap() const
+{
+#ifndef WIN32
+    if (m_map) munmap(const_cast<unsigned char*>(m_map), m_map_size);
+#endif
+    m_map = nullptr;
+    m_map_size = 0;
+}
+
+bool HeaderStore::Open()
+{
+    LOCK(m_mutex);
+    m_file = fsbridge::fopen(m_path, "rb+");
+    if (!m_file) m_file = fsbridge::fopen(m_path, "wb+");
+    if (!m_file) return error("%s: cannot open %s", __func__, fs::PathToString(m_path));
+    if (fseek(m_file, 0, SEEK_END) != 0) return error("%s: cannot seek in %s", __func__, fs::PathToString(m_path));
+    const long size{ftell(m_file)};
+    if (size < 0) return error("%s: cannot get the size of %s", __func__, fs::PathToString(m_path));
+    m_count = size / RECORD_SIZE;
+    if (size_t(size) != m_count * RECORD_SIZE) {
+        LogPrintf("Dropping a partial record at the end of %s\n", fs::PathToString(m_path));
+        if (!TruncateFile(m_file, m_count * RECORD_SIZE)) return error("%s: cannot truncate %s", __func__, fs::PathToString(m_path));
+    }
+    return true;
+}
+
+int HeaderStore::Size() const
+{
+    LOCK(m_mutex);
+    return m_count;
+}
+
+bool HeaderStore::ReadRecords(int height, size_t count, const unsigned char*& records, std::vector<unsigned char>& buffer) const
+{
+    assert(height >= 0 && height + count <= size_t(m_count));
+    const size_t end{(height + count) * RECORD_SIZE};
+#ifndef WIN32
+    if (end > m_map_size) {
+        // Map room for the records to come too. Only the part of the mapping within the file is read.
+        Unmap();
+        const size_t map_size{std::max(end, MIN_MAPPED_RECORDS * RECORD_SIZE) * 2};
+        void* map{mmap(nullptr, map_size, PROT_READ, MAP_SHARED, fileno(m_file), 0)};
+        if (map != MAP_FAILED) {
+            m_map = static_cast<const unsigned char*>(map);
+            m_map_size = map_size;
+        }
+    }
+    if (m_map) {
+        records = m_map + height * RECORD_SIZE;
+        return true;
+    }
+#endif
+    buffer.resize(count * RECORD_SIZE);
+    if (fseek(m_file, height * RECORD_SIZE, SEEK_SET) != 0 || fread(buffer.data(), 1, buffer.size(), m_file) != buffer.size()) {
+        return error("%s: cannot read %s", __func__, fs::PathToString(m_path));
+    }
+    records = buffer.data();
+    return true;
+}
+
+uint256 HeaderStore::RecordHash(int height) const
+{
+    const unsigned char* record;
+    std::vector<unsigned char> buffer;
+    if (!ReadRecords(height, 1, record, buffer)) return uint256{};
+    return Hash(Span{record, HEADER_SIZE});
+}
+
+bool HeaderStore::Sync(const CBlockIndex& tip)
+{
+    LOCK(m_mutex);
+    // Find the last record the chain of tip shares, usually the last one
+    int height{std::min(m_count - 1, tip.nHeight)};
+    while (height >= 0 && RecordHash(height) != tip.GetAncestor(height)->GetBlockHash()) {
+        --height;
+    }
+    if (height + 1 < m_count) {
+        LogPrint(BCLog::VALIDATION, "Dropping %d headers after height %d from the header store\n", m_count - height - 1, height);
+        m_count = height + 1;
+        if (fflush(m_file) != 0 || !TruncateFile(m_file, m_count * RECORD_SIZE)) {
+            return error("%s: cannot truncate %s", __func__, fs::PathToString(m_path));
+        }
+    }
+    if (tip.nHeight < m_count) return true;
+
+    // Append the headers after it, earliest first, a slice at a time
+    std::vector<const CBlockIndex*> blocks(tip.nHeight - height);
+    for (const CBlockIndex* pindex = &tip; pindex->nHeight > height; pindex = pindex->pprev) {
+        blocks[pindex->nHeight - height - 1] = pindex;
+    }
+    if (fseek(m_file, m_count * RECORD_SIZE, SEEK_SET) != 0) return error("%s: cannot seek in %s", __func__, fs::PathToString(m_path));
+    std::vector<CBlockHeader> headers;
+    std::vector<uint256> pow_hashes;
+    std::vector<unsigned char> records;
+    for (size_t begin = 0; begin < blocks.size(); begin += SYNC_BATCH_SIZE) {
+        const size_t end{std::min(blocks.size(), begin + SYNC_BATCH_SIZE)};
+        headers.clear();
+        for (size_t i = begin; i < end; ++i) headers.push_back(blocks[i]->GetBlockHeader());
+        pow_hashes.resize(headers.size());
+        GetPoWHashesCached(headers.data(), headers.size(), pow_hashes.data());
+        records.clear();
+        for (size_t i = 0; i < headers.size(); ++i) {
+            CVectorWriter{SER_NETWORK, PROTOCOL_VERSION, records, records.size(), headers[i]};
+            records.insert(records.end(), pow_hashes[i].begin(), pow_hashes[i].end());
+        }
+        if (fwrite(records.data(), 1, records.size(), m_file) != records.size()) {
+            return error("%s: cannot write to %s", __func__, fs::PathToString(m_path));
+        }
+        m_count += headers.size();
+    }
+    if (fflush(m_file) != 0) return error("%s: cannot write to %s", __func__, fs::PathToString(m_path));
+    return true;
+}
+
+std::optional<std::pair<CBlockHeader, uint256>> HeaderStore::Get(int height) const
+{
+    LOCK(m_mutex);
+    if (height < 0 || height >= m_count) return std::nullopt;
+    const unsigned char* record;
+    std::vector<unsigned char> buffer;
+    if (!ReadRecords(height, 1, record, buffer)) return std::nullopt;
+    std::pair<CBlockHeader, uint256> ret;
+    SpanReader{SER_NETWORK, PROTOCOL_VERSION, Span{record, HEADER_SIZE}} >> ret.first;
+    std::copy(record + HEADER_SIZE, record + RECORD_SIZE, ret.second.begin());
+    return ret;
+}
+
+bool HeaderStore::Contains(int height, const uint256& hash) const
+{
+    LOCK(m_mutex);
+    return height >= 0 && height < m_count && RecordHash(height) == hash;
+}
+
+size_t HeaderStore::Read(int height, size_t count, std::vector<unsigned char>& records) const
+{
+    LOCK(m_mutex);
+    records.clear();
+    if (height < 0 || height >= m_count) return 0;
+    count = std::min<size_t>(count, m_count - height);
+    const unsigned char* data;
+    if (!ReadRecords(height, count, data, records)) return 0;
+    if (data != records.data()) records.assign(data, data + count * RECORD_SIZE);
+    return count;
+}
+} // namespace node
@@ -0,0 +1,92 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_HEADERSTORE_H
+#define BITCOIN_NODE_HEADERSTORE_H
+
+#include <fs.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+class CBlockIndex;
+
+/** Default for -headersonly. */
+static constexpr bool DEFAULT_HEADERS_ONLY{false};
+
+namespace node {
+/**
+ * Append-only file of the best header chain, with one fixed size record per
+ * height: the 80 byte header followed by its NeoScrypt proof-of-work hash.
+ * Records are read from a read-only memory mapping of the file where
+ * possible, so ranges of headers are served without going through the block
+ * index. When the best header chain reorganizes, the records after the fork
+ * are dropped before the new ones are appended.
+ */
+class HeaderStore
+{
+public:
+    static constexpr size_t HEADER_SIZE{80};
+    static constexpr size_t RECORD_SIZE{HEADER_SIZE + 32};
+
+    explicit HeaderStore(fs::path path);
+    ~HeaderStore();
+
+    HeaderStore(const HeaderStore&) = delete;
+    HeaderStore& operator=(const HeaderStore&) = delete;
+
+    /** Open or create the file, dropping a partially written last record. */
+    [[nodiscard]] bool Open() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Number of records, which are those of heights 0 to Size() - 1. */
+    int Size() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Make the records those of the chain ending in tip: keep the ones up to
+     * where it forks from them and append its headers after that.
+     */
+    [[nodiscard]] bool Sync(const CBlockIndex& tip) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** The header at a height and its proof-of-work hash, if stored. */
+    std::optional<std::pair<CBlockHeader, uint256>> Get(int height) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /** Whether the record at a height is the one of a block hash. */
+    bool Contains(int height, const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    /**
+     * Copy the records of up to count heights from height on into records,
+     * RECORD_SIZE bytes each. Returns the number of records copied.
+     */
+    size_t Read(int height, size_t count, std::vector<unsigned char>& records) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+private:
+    const fs::path m_path;
+    mutable Mutex m_mutex;
+    FILE* m_file GUARDED_BY(m_mutex){nullptr};
+    //! Number of complete records in the file
+    int m_count GUARDED_BY(m_mutex){0};
+    //! Read-only mapping of the file, which may extend beyond its end, or nullptr to read the file instead
+    mutable const unsigned char* m_map GUARDED_BY(m_mutex){nullptr};
+    mutable size_t m_map_size GUARDED_BY(m_mutex){0};
+
+    /** Point records at the bytes of count records from height on, copying them into buffer if not mapped. */
+    bool ReadRecords(int height, size_t count, const unsigned char*& records, std::vector<unsigned char>& buffer) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    /** Block hash of the record at height. */
+    uint256 RecordHash(int height) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+    void Unmap() const EXCLUSIVE_LOCKS_REQUIRED(m_mutex);
+};
+
+/** The header store in -headersonly mode, in which blocks are not downloaded, or nullptr. */
+extern std::unique_ptr<HeaderStore> g_header_store;
+} // namespace node
+
+#endif // BITCOIN_NODE_HEADERSTORE_H
@@ -8,6 +8,7 @@
 #include <chainparams.h>
 #include <deploymentstatus.h>
 #include <external_signer.h>
+#include <index/blockfilterindex.h>
 #include <init.h>
 #include <interfaces/chain.h>
 #include <interfaces/handler.h>
@@ -18,6 +19,7 @@
 #include <net_processing.h>
 #include <netaddress.h>
 #include <netbase.h>
+#include <node/block_prefetch.h>
 #include <node/blockstorage.h>
 #include <kernel/chain.h>
 #include <node/coin.h>
@@ -51,6 +53,7 @@
 #endif
 
 #include <any>
+#include <map>
 #include <memory>
 #include <optional>
 #include <utility>
@@ -415,6 +418,7 @@ public:
     explicit NotificationsProxy(std::shared_ptr<Chain::Notifications> notifications)
         : m_notifications(std::move(notifications)) {}
     virtual ~NotificationsProxy() = default;
+    std::string ValidationInterfaceName() const override { return "chain notifications"; }
     void TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) override
     {
         m_notifications->transactionAddedToMempool(tx, mempool_sequence);
@@ -439,12 +443,17 @@ public:
     std::shared_ptr<Chain::Notifications> m_notifications;
 };
 
+//! Registered proxies by their notifications, so that a handler can wait for its own notifications only
+GlobalMutex g_notifications_proxies_mutex;
+std::map<const Chain::Notifications*, std::shared_ptr<NotificationsProxy>> g_notifications_proxies GUARDED_BY(g_notifications_proxies_mutex);
+
 class NotificationsHandlerImpl : public Handler
 {
 public:
     explicit NotificationsHandlerImpl(std::shared_ptr<Chain::Notifications> notifications)
         : m_proxy(std::make_shared<NotificationsProxy>(std::move(notifications)))
     {
+        WITH_LOCK(g_notifications_proxies_mutex, g_notifications_proxies[m_proxy->m_notifications.get()] = m_proxy);
         RegisterSharedValidationInterface(m_proxy);
     }
     ~NotificationsHandlerImpl() override { disconnect(); }
@@ -452,6 +461,11 @@ public:
     {
         if (m_proxy) {
             UnregisterSharedValidationInterface(m_proxy);
+            {
+                LOCK(g_notifications_proxies_mutex);
+                const auto it{g_notifications_proxies.find(m_proxy->m_notifications.get())};
+                if (it != g_notifications_proxies.end() && it->second == m_proxy) g_notifications_proxies.erase(it);
+            }
             m_proxy.reset();
         }
     }
@@ -503,13 +517,13 @@ public:
     explicit ChainImpl(NodeContext& node) : m_node(node) {}
     std::optional<int> getHeight() override
     {
-        const int height{WITH_LOCK(::cs_main, return chainman().ActiveChain().Height())};
-        return height >= 0 ? std::optional{height} : std::nullopt;
+        if (const auto snapshot{chainman().TipSnapshot()}) return snapshot->height;
+        return std::nullopt;
     }
     uint256 getBlockHash(int height) override
     {
-        LOCK(::cs_main);
-        return Assert(chainman().ActiveChain()[height])->GetBlockHash();
+        const auto snapshot{chainman().TipSnapshot()};
+        return Assert(snapshot ? snapshot->tip->GetAncestor(height) : nullptr)->GetBlockHash();
     }
     bool haveBlockOnDisk(int height) override
     {
@@ -541,6 +555,27 @@ public:
         WAIT_LOCK(cs_main, lock);
         return FillBlock(chainman().m_blockman.LookupBlockIndex(hash), block, lock, chainman().ActiveChain());
     }
+    std::shared_ptr<const CBlock> readBlockAhead(const uint256& hash, int prefetch) override
+    {
+        if (m_node.block_prefetcher) return m_node.block_prefetcher->GetBlock(hash, std::max(prefetch, 0));
+        auto block{std::make_shared<CBlock>()};
+        if (!findBlock(hash, FoundBlock().data(*block)) || block->IsNull()) return nullptr;
+        return block;
+    }
+    bool hasBlockFilterIndex(BlockFilterType filter_type) override
+    {
+        return GetBlockFilterIndex(filter_type) != nullptr;
+    }
+    std::optional<bool> blockFilterMatchesAny(BlockFilterType filter_type, const uint256& block_hash, const GCSFilter::ElementSet& filter_set) override
+    {
+        const BlockFilterIndex* block_filter_index{GetBlockFilterIndex(filter_type)};
+        if (!block_filter_index) return std::nullopt;
+
+        BlockFilter filter;
+        const CBlockIndex* index{WITH_LOCK(::cs_main, return chainman().m_blockman.LookupBlockIndex(block_hash))};
+        if (index == nullptr || !block_filter_index->LookupFilter(index, filter)) return std::nullopt;
+        return filter.GetFilter().MatchAny(filter_set);
+    }
     bool findFirstBlockWithTimeAndHeight(int64_t min_time, int min_height, const FoundBlock& block) override
     {
         WAIT_LOCK(cs_main, lock);
@@ -635,6 +670,17 @@ public:
         // that Chain clients do not need to know about.
         return TransactionError::OK == err;
     }
+    std::vector<bool> broadcastTransactions(const std::vector<CTransactionRef>& txs,
+        const std::vector<CAmount>& max_tx_fees,
+        bool relay,
+        std::vector<std::string>& err_strings) override
+    {
+        const std::vector<TransactionError> errors{BroadcastTransactions(m_node, txs, max_tx_fees, err_strings, relay, /*wait_callback=*/false)};
+        std::vector<bool> accepted;
+        accepted.reserve(errors.size());
+        for (const TransactionError err : errors) accepted.push_back(TransactionError::OK == err);
+        return accepted;
+    }
     void getTransactionAncestry(const uint256& txid, size_t& ancestors, size_t& descendants, size_t* ancestorsize, CAmount* ancestorfees) override
     {
         ancestors = descendants = 0;
@@ -714,10 +760,20 @@ public:
     {
         return std::make_unique<NotificationsHandlerImpl>(std::move(notifications));
     }
-    void waitForNotificationsIfTipChanged(const uint256& old_tip) override
+    void waitForNotificationsIfTipChanged(const uint256& old_tip, const Notifications& notifications) override
     {
         if (!old_tip.IsNull() && old_tip == WITH_LOCK(::cs_main, return chainman().ActiveChain().Tip()->GetBlockHash())) return;
-        SyncWithValidationInterfaceQueue();
+        std::shared_ptr<NotificationsProxy> proxy;
+        {
+            LOCK(g_notifications_proxies_mutex);
+            const auto it{g_notifications_proxies.find(&notifications)};
+            if (it != g_notifications_proxies.end()) proxy = it->second;
+        }
+        if (proxy) {
+            SyncWithValidationInterfaceQueue(*proxy);
+        } else {
+            SyncWithValidationInterfaceQueue();
+        }
     }
     std::unique_ptr<Handler> handleRpc(const CRPCCommand& command) override
     {
@@ -0,0 +1,90 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/memory_usage.h>
+
+#include <addrman.h>
+#include <cuckoocache.h>
+#include <index/addressindex.h>
+#include <index/blockfilterindex.h>
+#include <index/blockstatsindex.h>
+#include <index/coinstatsindex.h>
+#include <index/spentindex.h>
+#include <index/txindex.h>
+#include <interfaces/wallet.h>
+#include <net.h>
+#include <node/context.h>
+#include <powcache.h>
+#include <script/sigcache.h>
+#include <sync.h>
+#include <txdb.h>
+#include <txmempool.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <memory>
+#include <utility>
+
+namespace node {
+static GlobalMutex g_snapshot_mutex;
+static std::vector<SubsystemMemoryUsage> g_snapshot GUARDED_BY(g_snapshot_mutex);
+
+std::vector<SubsystemMemoryUsage> GetMemoryUsage(const NodeContext& node)
+{
+    std::vector<SubsystemMemoryUsage> usage;
+    if (node.chainman) {
+        ChainstateManager& chainman{*node.chainman};
+        LOCK(cs_main);
+        size_t coins_cache{0}, coins_db{0};
+        for (Chainstate* chainstate : chainman.GetAll()) {
+            coins_cache += chainstate->CoinsTip().DynamicMemoryUsage();
+            coins_db += chainstate->CoinsDB().GetDBStats().memory_usage;
+        }
+        usage.push_back({"coins_cache", coins_cache});
+        usage.push_back({"coins_db", coins_db});
+        usage.push_back({"block_index", chainman.m_blockman.m_block_index.DynamicMemoryUsage()});
+        usage.push_back({"block_index_db", chainman.m_blockman.m_block_tree_db->DynamicMemoryUsage()});
+        // Both caches store the hashes of what they cache, and one bit of flags per entry besides
+        usage.push_back({"script_cache", size_t{GetScriptExecutionCacheStats().capacity} * sizeof(uint256)});
+    }
+    usage.push_back({"signature_cache", size_t{GetSignatureCacheStats().capacity} * sizeof(uint256)});
+    usage.push_back({"pow_cache", GetPoWHashCacheStats().memory_usage});
+    if (node.mempool) usage.push_back({"mempool", node.mempool->DynamicMemoryUsage()});
+    if (node.addrman) usage.push_back({"addrman", node.addrman->DynamicMemoryUsage()});
+    if (node.connman) usage.push_back({"peer_buffers", node.connman->GetPeerBufferMemoryUsage()});
+
+    size_t indexes{0};
+    if (g_txindex) indexes += g_txindex->GetDBStats().memory_usage;
+    if (g_coin_stats_index) indexes += g_coin_stats_index->GetDBStats().memory_usage;
+    if (g_block_stats_index) indexes += g_block_stats_index->GetDBStats().memory_usage;
+    if (g_address_index) indexes += g_address_index->GetDBStats().memory_usage;
+    if (g_spent_index) indexes += g_spent_index->GetDBStats().memory_usage;
+    ForEachBlockFilterIndex([&indexes](const BlockFilterIndex& index) {
+        indexes += index.GetDBStats().memory_usage;
+    });
+    usage.push_back({"indexes", indexes});
+
+    if (node.wallet_loader) {
+        size_t wallets{0};
+        for (const std::unique_ptr<interfaces::Wallet>& wallet : node.wallet_loader->getWallets()) {
+            wallets += wallet->getMemoryUsage();
+        }
+        usage.push_back({"wallets", wallets});
+    }
+    return usage;
+}
+
+void UpdateMemoryUsageSnapshot(const NodeContext& node)
+{
+    std::vector<SubsystemMemoryUsage> usage{GetMemoryUsage(node)};
+    LOCK(g_snapshot_mutex);
+    g_snapshot = std::move(usage);
+}
+
+std::vector<SubsystemMemoryUsage> GetMemoryUsageSnapshot()
+{
+    LOCK(g_snapshot_mutex);
+    return g_snapshot;
+}
+} // namespace node
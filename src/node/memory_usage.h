@@ -0,0 +1,45 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_MEMORY_USAGE_H
+#define BITCOIN_NODE_MEMORY_USAGE_H
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace node {
+struct NodeContext;
+
+//! How often the memory usage served at /metrics is measured
+static constexpr std::chrono::minutes MEMORY_USAGE_SNAPSHOT_INTERVAL{1};
+
+/** Memory used by a subsystem of the node, in bytes. */
+struct SubsystemMemoryUsage {
+    std::string name;
+    size_t bytes;
+};
+
+/**
+ * Measure the memory used by the subsystems of the node that are present:
+ * the coins caches and LevelDB databases of the chainstates, the block index,
+ * the mempool, addrman, the buffers of the peers, the signature, script
+ * execution and proof-of-work caches, the indexes and the wallets. The
+ * numbers come from the DynamicMemoryUsage() accounting of each subsystem,
+ * so they leave out allocator overhead and memory that is not accounted for.
+ */
+std::vector<SubsystemMemoryUsage> GetMemoryUsage(const NodeContext& node);
+
+/** Measure the memory usage for GetMemoryUsageSnapshot(), to be called from the scheduler. */
+void UpdateMemoryUsageSnapshot(const NodeContext& node);
+
+/**
+ * Return the last measurement of UpdateMemoryUsageSnapshot(), or nothing
+ * before the first one. Unlike GetMemoryUsage() it never waits for cs_main.
+ */
+std::vector<SubsystemMemoryUsage> GetMemoryUsageSnapshot();
+} // namespace node
+
+#endif // BITCOIN_NODE_MEMORY_USAGE_H
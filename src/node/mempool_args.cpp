@@ -19,6 +19,7 @@
 #include <util/system.h>
 #include <util/translation.h>
 
+#include <algorithm>
 #include <chrono>
 #include <memory>
 
@@ -46,6 +47,8 @@ std::optional<bilingual_str> ApplyArgsManOptions(const ArgsManager& argsman, con
 
     if (auto hours = argsman.GetIntArg("-mempoolexpiry")) mempool_opts.expiry = std::chrono::hours{*hours};
 
+    if (auto events = argsman.GetIntArg("-mempooldeltaevents")) mempool_opts.max_delta_events = std::max<int64_t>(*events, 0);
+
     // incremental relay fee sets the minimum feerate increase necessary for replacement in the mempool
     // and the amount the mempool min fee increases above the feerate of txs evicted due to mempool limiting.
     if (argsman.IsArgSet("-incrementalrelayfee")) {
@@ -94,6 +97,8 @@ std::optional<bilingual_str> ApplyArgsManOptions(const ArgsManager& argsman, con
 
     mempool_opts.full_rbf = argsman.GetBoolArg("-mempoolfullrbf", mempool_opts.full_rbf);
 
+    mempool_opts.cluster_mode = argsman.GetBoolArg("-clustermempool", mempool_opts.cluster_mode);
+
     ApplyArgsManOptions(argsman, mempool_opts.limits);
 
     return std::nullopt;
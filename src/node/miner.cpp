@@ -14,16 +14,23 @@
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
 #include <deploymentstatus.h>
+#include <hash.h>
 #include <policy/feerate.h>
 #include <policy/policy.h>
 #include <pow.h>
 #include <primitives/transaction.h>
+#include <shutdown.h>
 #include <timedata.h>
 #include <util/moneystr.h>
 #include <util/system.h>
 #include <validation.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#include <queue>
+#include <thread>
 #include <utility>
 
 namespace node {
@@ -56,6 +63,71 @@ void RegenerateCommitments(CBlock& block, ChainstateManager& chainman)
     block.hashMerkleRoot = BlockMerkleRoot(block);
 }
 
+uint256 GetTemplateId(const CBlock& block)
+{
+    std::vector<uint256> txids;
+    txids.reserve(block.vtx.size());
+    for (const auto& tx : block.vtx) {
+        if (!tx->IsCoinBase()) txids.push_back(tx->GetHash());
+    }
+    return (HashWriter{} << block.hashPrevBlock << txids).GetHash();
+}
+
+bool GrindNonce(CBlockHeader& block, const Consensus::Params& params, uint64_t& max_tries, int num_threads)
+{
+    // The NeoScrypt input is the 80-byte serialized header, with nNonce last
+    static constexpr size_t HEADER_SIZE{80};
+    static constexpr size_t NONCE_OFFSET{76};
+    // Nonces hashed together, the widest multi-buffer kernel
+    static constexpr uint64_t BATCH{8};
+
+    if (num_threads <= 0) num_threads = GetNumCores();
+    const uint64_t start{block.nNonce};
+    const uint64_t end{std::min<uint64_t>(start + max_tries, std::numeric_limits<uint32_t>::max())};
+    const uint64_t stride{BATCH * num_threads};
+    // Lowest valid nonce found so far; end if none
+    std::atomic<uint64_t> found{end};
+
+    auto worker = [&](uint64_t first) {
+        unsigned char input[HEADER_SIZE * BATCH];
+        unsigned char output[32 * BATCH];
+        for (uint64_t i = 0; i < BATCH; ++i) {
+            std::memcpy(input + i * HEADER_SIZE, &block.nVersion, HEADER_SIZE);
+        }
+        for (uint64_t nonce = first; nonce < found.load(std::memory_order_relaxed); nonce += stride) {
+            if (ShutdownRequested()) return;
+            const uint64_t count{std::min(BATCH, end - nonce)};
+            for (uint64_t i = 0; i < count; ++i) {
+                const uint32_t n{static_cast<uint32_t>(nonce + i)};
+                std::memcpy(input + i * HEADER_SIZE + NONCE_OFFSET, &n, sizeof(n));
+            }
+            PoWHashMany(output, input, count);
+            for (uint64_t i = 0; i < count; ++i) {
+                uint256 hash;
+                std::memcpy(hash.begin(), output + i * 32, 32);
+                if (!CheckProofOfWork(hash, block.nBits, params)) continue;
+                // Workers scan upwards, so keeping the minimum gives the same
+                // result as a nonce-by-nonce search
+                uint64_t prev{found.load()};
+                while (nonce + i < prev && !found.compare_exchange_weak(prev, nonce + i)) {}
+                return;
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < num_threads && start + t * BATCH < end; ++t) {
+        threads.emplace_back(worker, start + t * BATCH);
+    }
+    worker(start);
+    for (std::thread& thread : threads) thread.join();
+
+    const uint64_t nonce{found.load()};
+    block.nNonce = nonce;
+    max_tries -= nonce - start;
+    return nonce < end && !ShutdownRequested();
+}
+
 BlockAssembler::Options::Options()
 {
     blockMinFeeRate = CFeeRate(DEFAULT_BLOCK_MIN_TX_FEE);
@@ -101,9 +173,10 @@ void BlockAssembler::resetBlock()
     // These counters do not include coinbase tx
     nBlockTx = 0;
     nFees = 0;
+    m_package_skipped = false;
 }
 
-std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn)
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, const CBlockTemplate* previous)
 {
     int64_t nTimeStart = GetTimeMicros();
 
@@ -138,10 +211,19 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
 
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
+    bool fIncremental = false;
     if (m_mempool) {
         LOCK(m_mempool->cs);
-        addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated);
+        if (m_mempool->m_cluster_mode) {
+            addChunkTxs(*m_mempool, nPackagesSelected);
+        } else {
+            if (previous && previous->block.hashPrevBlock == pindexPrev->GetBlockHash()) {
+                fIncremental = addPreviousTxs(*m_mempool, *previous);
+            }
+            addPackageTxs(*m_mempool, nPackagesSelected, nDescendantsUpdated);
+        }
     }
+    pblocktemplate->m_all_packages_selected = !m_package_skipped;
 
     int64_t nTime1 = GetTimeMicros();
 
@@ -175,11 +257,94 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d %spackages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, fIncremental ? "new " : "", nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
 
+bool BlockAssembler::addPreviousTxs(const CTxMemPool& mempool, const CBlockTemplate& previous)
+{
+    AssertLockHeld(mempool.cs);
+
+    // If a package did not fit, a new package with a higher feerate could
+    // have displaced it; only a full selection gets that right.
+    if (!previous.m_all_packages_selected) return false;
+
+    // The transactions must all still be in the mempool. As the tip did not
+    // change, they are still final and valid in this order.
+    std::vector<CTxMemPool::txiter> entries;
+    entries.reserve(previous.block.vtx.size());
+    for (size_t i = 1; i < previous.block.vtx.size(); ++i) {
+        const auto it = mempool.GetIter(previous.block.vtx[i]->GetHash());
+        if (!it) return false;
+        entries.push_back(*it);
+    }
+    for (CTxMemPool::txiter it : entries) {
+        AddToBlock(it);
+    }
+    return true;
+}
+
+void BlockAssembler::addChunkTxs(const CTxMemPool& mempool, int& nPackagesSelected)
+{
+    AssertLockHeld(mempool.cs);
+
+    const std::vector<std::vector<CTxMemPool::Chunk>> clusters{mempool.GetClusterChunks()};
+    // The next chunk of each cluster, taken in order of feerate
+    std::vector<size_t> next(clusters.size(), 0);
+    auto lower_next_chunk = [&](size_t a, size_t b) {
+        const CTxMemPool::Chunk& chunk_a{clusters[a][next[a]]};
+        const CTxMemPool::Chunk& chunk_b{clusters[b][next[b]]};
+        const double f1{(double)chunk_a.fee * chunk_b.size};
+        const double f2{(double)chunk_b.fee * chunk_a.size};
+        return f1 == f2 ? a > b : f1 < f2;
+    };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(lower_next_chunk)> best_clusters(lower_next_chunk);
+    for (size_t i = 0; i < clusters.size(); ++i) best_clusters.push(i);
+
+    // Limit the number of attempts to add transactions to the block when it is
+    // close to full, as in addPackageTxs.
+    const int64_t MAX_CONSECUTIVE_FAILURES = 1000;
+    int64_t nConsecutiveFailed = 0;
+
+    while (!best_clusters.empty()) {
+        const size_t i{best_clusters.top()};
+        best_clusters.pop();
+        const CTxMemPool::Chunk& chunk{clusters[i][next[i]]};
+
+        if (chunk.fee < blockMinFeeRate.GetFee(static_cast<uint32_t>(chunk.size))) {
+            // Everything else we might consider has a lower fee rate
+            return;
+        }
+
+        // Later chunks of the cluster may depend on a chunk that is left out,
+        // so the rest of the cluster is left out as well
+        const CTxMemPool::setEntries package(chunk.txs.begin(), chunk.txs.end());
+        if (!TestPackage(chunk.size, chunk.sigops_cost)) {
+            m_package_skipped = true;
+            ++nConsecutiveFailed;
+            if (nConsecutiveFailed > MAX_CONSECUTIVE_FAILURES && nBlockWeight >
+                    nBlockMaxWeight - 4000) {
+                // Give up if we're close to full and haven't succeeded in a while
+                break;
+            }
+            continue;
+        }
+        if (!TestPackageTransactions(package)) {
+            continue;
+        }
+
+        // This chunk will make it in; the chunk is already in a valid order
+        nConsecutiveFailed = 0;
+        for (CTxMemPool::txiter it : chunk.txs) {
+            AddToBlock(it);
+        }
+        ++nPackagesSelected;
+
+        if (++next[i] < clusters[i].size()) best_clusters.push(i);
+    }
+}
+
 void BlockAssembler::onlyUnconfirmed(CTxMemPool::setEntries& testSet)
 {
     for (CTxMemPool::setEntries::iterator iit = testSet.begin(); iit != testSet.end(); ) {
@@ -300,6 +465,9 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
     // Keep track of entries that failed inclusion, to avoid duplicate work
     CTxMemPool::setEntries failedTx;
 
+    // Account for transactions added by addPreviousTxs
+    nDescendantsUpdated += UpdatePackagesForAdded(mempool, inBlock, mapModifiedTx);
+
     CTxMemPool::indexed_transaction_set::index<ancestor_score>::type::iterator mi = mempool.mapTx.get<ancestor_score>().begin();
     CTxMemPool::txiter iter;
 
@@ -377,6 +545,7 @@ void BlockAssembler::addPackageTxs(const CTxMemPool& mempool, int& nPackagesSele
         }
 
         if (!TestPackage(packageSize, packageSigOpsCost)) {
+            m_package_skipped = true;
             if (fUsingModified) {
                 // Since we always look at the best entry in mapModifiedTx,
                 // we must erase failed entries so that we can consider the
@@ -25,6 +25,8 @@ namespace Consensus { struct Params; };
 
 namespace node {
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Default for -generatethreads, the number of threads the generate RPCs grind nonces with */
+static const int DEFAULT_GENERATE_THREADS = 1;
 
 struct CBlockTemplate
 {
@@ -32,6 +34,9 @@ struct CBlockTemplate
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOpsCost;
     std::vector<unsigned char> vchCoinbaseCommitment;
+    //! Whether no package above the minimum fee rate was left out for lack of
+    //! space, so that the template can be extended with later packages
+    bool m_all_packages_selected{false};
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -141,6 +146,8 @@ private:
     uint64_t nBlockSigOpsCost;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
+    // Whether a package was skipped by TestPackage
+    bool m_package_skipped;
 
     // Chain context for the block
     int nHeight;
@@ -160,8 +167,13 @@ public:
     explicit BlockAssembler(Chainstate& chainstate, const CTxMemPool* mempool);
     explicit BlockAssembler(Chainstate& chainstate, const CTxMemPool* mempool, const Options& options);
 
-    /** Construct a new block template with coinbase to scriptPubKeyIn */
-    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn);
+    /** Construct a new block template with coinbase to scriptPubKeyIn
+     *
+     * If previous is given, built by a BlockAssembler with the same options on
+     * the current tip, had room for all packages and all its transactions are
+     * still in the mempool, the selection starts from its transactions and
+     * only adds the packages that were not in it, instead of starting over. */
+    std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, const CBlockTemplate* previous = nullptr);
 
     inline static std::optional<int64_t> m_last_block_num_txs{};
     inline static std::optional<int64_t> m_last_block_weight{};
@@ -178,6 +190,13 @@ private:
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
     void addPackageTxs(const CTxMemPool& mempool, int& nPackagesSelected, int& nDescendantsUpdated) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Add the chunks of the linearized mempool clusters, merged by feerate,
+      * for a mempool in cluster mode. Increments nPackagesSelected for each
+      * chunk added. */
+    void addChunkTxs(const CTxMemPool& mempool, int& nPackagesSelected) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
+    /** Add the transactions of previous, if it can be extended (see
+      * CreateNewBlock), in their original order. Returns whether it did. */
+    bool addPreviousTxs(const CTxMemPool& mempool, const CBlockTemplate& previous) EXCLUSIVE_LOCKS_REQUIRED(mempool.cs);
 
     // helper functions for addPackageTxs()
     /** Remove confirmed (inBlock) entries from given set */
@@ -197,6 +216,25 @@ int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParam
 
 /** Update an old GenerateCoinbaseCommitment from CreateNewBlock after the block txs have changed */
 void RegenerateCommitments(CBlock& block, ChainstateManager& chainman);
+
+/**
+ * Identify a block template by its previous block and the txids of its
+ * non-coinbase transactions, in order. Used as the getblocktemplate
+ * templateid and in template notifications.
+ */
+uint256 GetTemplateId(const CBlock& block);
+
+/**
+ * Search the nonces [block.nNonce, min(block.nNonce + max_tries, UINT32_MAX))
+ * for the lowest one that meets block.nBits, with num_threads threads (0 for
+ * one per core) hashing batches of nonces with PoWHashMany().
+ *
+ * Returns true with block.nNonce set to that nonce. Otherwise, or when a
+ * shutdown is requested, returns false with block.nNonce at the end of the
+ * range. Either way max_tries is reduced by the number of nonces before
+ * block.nNonce, as a nonce-by-nonce search would.
+ */
+bool GrindNonce(CBlockHeader& block, const Consensus::Params& params, uint64_t& max_tries, int num_threads);
 } // namespace node
 
 #endif // BITCOIN_NODE_MINER_H
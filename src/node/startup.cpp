@@ -0,0 +1,50 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/startup.h>
+
+#include <logging.h>
+#include <util/threadnames.h>
+
+#include <utility>
+
+namespace node {
+void StartupProfiler::Record(std::string name, SteadyClock::time_point begin, bool parallel)
+{
+    const auto now{SteadyClock::now()};
+    StartupStage stage{std::move(name), std::chrono::duration_cast<std::chrono::milliseconds>(begin - m_start),
+                       std::chrono::duration_cast<std::chrono::milliseconds>(now - begin), parallel};
+    LogPrint(BCLog::BENCH, "Startup stage %s: %dms\n", stage.name, count_milliseconds(stage.duration));
+    LOCK(m_mutex);
+    m_stages.push_back(std::move(stage));
+}
+
+std::future<std::optional<bilingual_str>> StartupProfiler::Start(std::string name, StageFunc stage)
+{
+    return std::async(std::launch::async, [this, name = std::move(name), stage = std::move(stage)]() {
+        util::ThreadRename("init." + name);
+        return Time(name, stage, /*parallel=*/true);
+    });
+}
+
+void StartupProfiler::Finish()
+{
+    const auto total{std::chrono::duration_cast<std::chrono::milliseconds>(SteadyClock::now() - m_start)};
+    LogPrintf("Startup took %dms\n", count_milliseconds(total));
+    LOCK(m_mutex);
+    m_total = total;
+}
+
+std::vector<StartupStage> StartupProfiler::GetStages() const
+{
+    LOCK(m_mutex);
+    return m_stages;
+}
+
+std::optional<std::chrono::milliseconds> StartupProfiler::GetTotal() const
+{
+    LOCK(m_mutex);
+    return m_total;
+}
+} // namespace node
@@ -0,0 +1,100 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_STARTUP_H
+#define BITCOIN_NODE_STARTUP_H
+
+#include <sync.h>
+#include <util/time.h>
+#include <util/translation.h>
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace node {
+/** How long one stage of node startup took. */
+struct StartupStage {
+    std::string name;
+    //! Time from the start of startup to the start of the stage
+    std::chrono::milliseconds begin;
+    std::chrono::milliseconds duration;
+    //! Whether the stage ran on its own thread, alongside other stages
+    bool parallel;
+};
+
+/**
+ * Times the stages of AppInitMain for getstartupinfo, and runs the stages
+ * that do not depend on the others on their own threads.
+ */
+class StartupProfiler
+{
+private:
+    const SteadyClock::time_point m_start{SteadyClock::now()};
+    mutable Mutex m_mutex;
+    std::vector<StartupStage> m_stages GUARDED_BY(m_mutex);
+    std::optional<std::chrono::milliseconds> m_total GUARDED_BY(m_mutex);
+
+    void Record(std::string name, SteadyClock::time_point begin, bool parallel) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+public:
+    /**
+     * Records the time from its construction to Stop() as a stage, or to its
+     * destruction when a stage returns early.
+     */
+    class Timer
+    {
+        StartupProfiler* m_profiler;
+        std::string m_name;
+        bool m_parallel;
+        SteadyClock::time_point m_begin{SteadyClock::now()};
+
+    public:
+        Timer(StartupProfiler& profiler, std::string name, bool parallel = false)
+            : m_profiler{&profiler}, m_name{std::move(name)}, m_parallel{parallel} {}
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+        ~Timer() { Stop(); }
+
+        void Stop()
+        {
+            if (m_profiler) m_profiler->Record(std::move(m_name), m_begin, m_parallel);
+            m_profiler = nullptr;
+        }
+    };
+
+    using StageFunc = std::function<std::optional<bilingual_str>()>;
+
+    /**
+     * Run a stage and record how long it took, including when it throws.
+     * Stages that run on a thread of their own set parallel.
+     */
+    template <typename F>
+    auto Time(std::string name, F&& stage, bool parallel = false)
+    {
+        Timer timer{*this, std::move(name), parallel};
+        return stage();
+    }
+
+    /**
+     * Start a stage on a thread of its own. The future returns the error of
+     * the stage, if any, or rethrows its exception. It must be waited for
+     * before anything the stage initializes is used.
+     */
+    std::future<std::optional<bilingual_str>> Start(std::string name, StageFunc stage);
+
+    /** Record that startup is done. Stages still running are added once they finish. */
+    void Finish() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+
+    std::vector<StartupStage> GetStages() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+    /** Time from the start of startup to Finish(), or std::nullopt while starting. */
+    std::optional<std::chrono::milliseconds> GetTotal() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex);
+};
+} // namespace node
+
+#endif // BITCOIN_NODE_STARTUP_H
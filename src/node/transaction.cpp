@@ -30,96 +30,135 @@ static TransactionError HandleATMPError(const TxValidationState& state, std::str
     }
 }
 
+/**
+ * Submit a transaction to the mempool, unless it is already confirmed or in the
+ * mempool. Sets wtxid to the wtxid to announce and accepted to whether the
+ * transaction was added to the mempool.
+ */
+static TransactionError SubmitTransaction(NodeContext& node, const CTransactionRef& tx, uint256& wtxid, bool& accepted,
+                                          std::string& err_string, const CAmount& max_tx_fee, bool relay) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    AssertLockHeld(cs_main);
+    const uint256& txid = tx->GetHash();
+    wtxid = tx->GetWitnessHash();
+    accepted = false;
+
+    // If the transaction is already confirmed in the chain, don't do anything
+    // and return early.
+    CCoinsViewCache &view = node.chainman->ActiveChainstate().CoinsTip();
+    for (size_t o = 0; o < tx->vout.size(); o++) {
+        const Coin& existingCoin = view.AccessCoin(COutPoint(txid, o));
+        // IsSpent doesn't mean the coin is spent, it means the output doesn't exist.
+        // So if the output does exist, then this transaction exists in the chain.
+        if (!existingCoin.IsSpent()) return TransactionError::ALREADY_IN_CHAIN;
+    }
+
+    if (auto mempool_tx = node.mempool->get(txid); mempool_tx) {
+        // There's already a transaction in the mempool with this txid. Don't
+        // try to submit this transaction to the mempool (since it'll be
+        // rejected as a TX_CONFLICT), but do attempt to reannounce the mempool
+        // transaction if relay=true.
+        //
+        // The mempool transaction may have the same or different witness (and
+        // wtxid) as this transaction. Use the mempool's wtxid for reannouncement.
+        wtxid = mempool_tx->GetWitnessHash();
+    } else {
+        // Transaction is not already in the mempool.
+        if (max_tx_fee > 0) {
+            // First, call ATMP with test_accept and check the fee. If ATMP
+            // fails here, return error immediately.
+            const MempoolAcceptResult result = node.chainman->ProcessTransaction(tx, /*test_accept=*/ true);
+            if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
+                return HandleATMPError(result.m_state, err_string);
+            } else if (result.m_base_fees.value() > max_tx_fee) {
+                return TransactionError::MAX_FEE_EXCEEDED;
+            }
+        }
+        // Try to submit the transaction to the mempool.
+        const MempoolAcceptResult result = node.chainman->ProcessTransaction(tx, /*test_accept=*/ false);
+        if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
+            return HandleATMPError(result.m_state, err_string);
+        }
+
+        // Transaction was accepted to the mempool.
+        accepted = true;
+
+        if (relay) {
+            // the mempool tracks locally submitted transactions to make a
+            // best-effort of initial broadcast
+            node.mempool->AddUnbroadcastTx(txid);
+        }
+    }
+    return TransactionError::OK;
+}
+
 TransactionError BroadcastTransaction(NodeContext& node, const CTransactionRef tx, std::string& err_string, const CAmount& max_tx_fee, bool relay, bool wait_callback)
 {
-    // BroadcastTransaction can be called by either sendrawtransaction RPC or the wallet.
+    std::vector<std::string> err_strings;
+    const std::vector<TransactionError> errors{BroadcastTransactions(node, {tx}, {max_tx_fee}, err_strings, relay, wait_callback)};
+    err_string = std::move(err_strings.front());
+    return errors.front();
+}
+
+std::vector<TransactionError> BroadcastTransactions(NodeContext& node, const std::vector<CTransactionRef>& txs, const std::vector<CAmount>& max_tx_fees,
+                                                    std::vector<std::string>& err_strings, bool relay, bool wait_callback)
+{
+    // BroadcastTransactions can be called by either the sendrawtransaction(s) RPCs or the wallet.
     // chainman, mempool and peerman are initialized before the RPC server and wallet are started
     // and reset after the RPC sever and wallet are stopped.
     assert(node.chainman);
     assert(node.mempool);
     assert(node.peerman);
+    assert(max_tx_fees.size() == txs.size());
 
     std::promise<void> promise;
-    uint256 txid = tx->GetHash();
-    uint256 wtxid = tx->GetWitnessHash();
+    std::vector<TransactionError> errors(txs.size(), TransactionError::OK);
+    std::vector<uint256> wtxids(txs.size());
+    err_strings.assign(txs.size(), "");
     bool callback_set = false;
 
     {
+        // Submit all the transactions under one lock, in order, so later
+        // transactions may spend earlier ones
         LOCK(cs_main);
-
-        // If the transaction is already confirmed in the chain, don't do anything
-        // and return early.
-        CCoinsViewCache &view = node.chainman->ActiveChainstate().CoinsTip();
-        for (size_t o = 0; o < tx->vout.size(); o++) {
-            const Coin& existingCoin = view.AccessCoin(COutPoint(txid, o));
-            // IsSpent doesn't mean the coin is spent, it means the output doesn't exist.
-            // So if the output does exist, then this transaction exists in the chain.
-            if (!existingCoin.IsSpent()) return TransactionError::ALREADY_IN_CHAIN;
+        bool any_accepted{false};
+        for (size_t i = 0; i < txs.size(); ++i) {
+            bool accepted;
+            errors[i] = SubmitTransaction(node, txs[i], wtxids[i], accepted, err_strings[i], max_tx_fees[i], relay);
+            any_accepted |= accepted;
         }
 
-        if (auto mempool_tx = node.mempool->get(txid); mempool_tx) {
-            // There's already a transaction in the mempool with this txid. Don't
-            // try to submit this transaction to the mempool (since it'll be
-            // rejected as a TX_CONFLICT), but do attempt to reannounce the mempool
-            // transaction if relay=true.
+        if (wait_callback && any_accepted) {
+            // For transactions broadcast from outside the wallet, make sure
+            // that the wallet has been notified of the transactions before
+            // continuing.
             //
-            // The mempool transaction may have the same or different witness (and
-            // wtxid) as this transaction. Use the mempool's wtxid for reannouncement.
-            wtxid = mempool_tx->GetWitnessHash();
-        } else {
-            // Transaction is not already in the mempool.
-            if (max_tx_fee > 0) {
-                // First, call ATMP with test_accept and check the fee. If ATMP
-                // fails here, return error immediately.
-                const MempoolAcceptResult result = node.chainman->ProcessTransaction(tx, /*test_accept=*/ true);
-                if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
-                    return HandleATMPError(result.m_state, err_string);
-                } else if (result.m_base_fees.value() > max_tx_fee) {
-                    return TransactionError::MAX_FEE_EXCEEDED;
-                }
-            }
-            // Try to submit the transaction to the mempool.
-            const MempoolAcceptResult result = node.chainman->ProcessTransaction(tx, /*test_accept=*/ false);
-            if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
-                return HandleATMPError(result.m_state, err_string);
-            }
-
-            // Transaction was accepted to the mempool.
-
-            if (relay) {
-                // the mempool tracks locally submitted transactions to make a
-                // best-effort of initial broadcast
-                node.mempool->AddUnbroadcastTx(txid);
-            }
-
-            if (wait_callback) {
-                // For transactions broadcast from outside the wallet, make sure
-                // that the wallet has been notified of the transaction before
-                // continuing.
-                //
-                // This prevents a race where a user might call sendrawtransaction
-                // with a transaction to/from their wallet, immediately call some
-                // wallet RPC, and get a stale result because callbacks have not
-                // yet been processed.
-                CallFunctionInValidationInterfaceQueue([&promise] {
-                    promise.set_value();
-                });
-                callback_set = true;
-            }
+            // This prevents a race where a user might call sendrawtransaction
+            // with a transaction to/from their wallet, immediately call some
+            // wallet RPC, and get a stale result because callbacks have not
+            // yet been processed.
+            CallFunctionInValidationInterfaceQueue([&promise] {
+                promise.set_value();
+            });
+            callback_set = true;
         }
     } // cs_main
 
     if (callback_set) {
         // Wait until Validation Interface clients have been notified of the
-        // transaction entering the mempool.
+        // transactions entering the mempool.
         promise.get_future().wait();
     }
 
     if (relay) {
-        node.peerman->RelayTransaction(txid, wtxid);
+        // The announcements are queued for all peers together and go out
+        // with their next inventory trickle
+        for (size_t i = 0; i < txs.size(); ++i) {
+            if (errors[i] == TransactionError::OK) node.peerman->RelayTransaction(txs[i]->GetHash(), wtxids[i]);
+        }
     }
 
-    return TransactionError::OK;
+    return errors;
 }
 
 CTransactionRef GetTransaction(const CBlockIndex* const block_index, const CTxMemPool* const mempool, const uint256& hash, const Consensus::Params& consensusParams, uint256& hashBlock)
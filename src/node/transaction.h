@@ -9,6 +9,9 @@
 #include <primitives/transaction.h>
 #include <util/error.h>
 
+#include <string>
+#include <vector>
+
 class CBlockIndex;
 class CTxMemPool;
 namespace Consensus {
@@ -44,6 +47,23 @@ static const CFeeRate DEFAULT_MAX_RAW_TX_FEE_RATE{COIN / 10};
  */
 [[nodiscard]] TransactionError BroadcastTransaction(NodeContext& node, CTransactionRef tx, std::string& err_string, const CAmount& max_tx_fee, bool relay, bool wait_callback);
 
+/**
+ * Submit transactions to the mempool and (optionally) relay them to all P2P peers,
+ * like BroadcastTransaction(), but under a single cs_main acquisition, waiting for
+ * the mempool entry notifications once and announcing them together. The
+ * transactions are submitted in order, so later ones may spend earlier ones.
+ *
+ * @param[in]  node reference to node context
+ * @param[in]  txs the transactions to broadcast
+ * @param[in]  max_tx_fees for each transaction, reject it if its fee is higher (if 0, accept any fee)
+ * @param[out] err_strings filled with the error string of each transaction, if available
+ * @param[in]  relay flag if both mempool insertion and p2p relay are requested
+ * @param[in]  wait_callback wait until callbacks have been processed to avoid stale result due to a sequentially RPC.
+ * return the error of each transaction
+ */
+[[nodiscard]] std::vector<TransactionError> BroadcastTransactions(NodeContext& node, const std::vector<CTransactionRef>& txs, const std::vector<CAmount>& max_tx_fees,
+                                                                  std::vector<std::string>& err_strings, bool relay, bool wait_callback);
+
 /**
  * Return transaction with a given hash.
  * If mempool is provided and block_index is not provided, check it first for the tx.
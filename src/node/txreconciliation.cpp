@@ -0,0 +1,443 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <crypto/siphash.h>
+#include <hash.h>
+#include <logging.h>
+#include <node/minisketchwrapper.h>
+#include <random.h>
+#include <util/check.h>
+#include <util/hasher.h>
+
+#include <minisketch.h>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <variant>
+
+namespace {
+
+/** Static salt component used to compute short txids for sketch construction, see BIP-330. */
+const std::string RECON_STATIC_SALT = "Tx Relay Salting";
+const HashWriter RECON_SALT_HASHER = TaggedHash(RECON_STATIC_SALT);
+
+/**
+ * Salt (specified by BIP-330) constructed from contributions from both peers. It is used
+ * to compute transaction short IDs, which are then used to construct a sketch representing a set
+ * of transactions we want to announce to the peer.
+ */
+uint256 ComputeSalt(uint64_t salt1, uint64_t salt2)
+{
+    // According to BIP-330, salts should be combined in ascending order.
+    return (HashWriter(RECON_SALT_HASHER) << std::min(salt1, salt2) << std::max(salt1, salt2)).GetSHA256();
+}
+
+/**
+ * Estimate the number of differences between our set and the peer's, per BIP-330: the
+ * difference in size plus q times the smaller set, plus one.
+ */
+size_t EstimateSketchCapacity(size_t local_set_size, size_t remote_set_size, uint16_t q)
+{
+    const size_t set_size_diff{local_set_size > remote_set_size ? local_set_size - remote_set_size : remote_set_size - local_set_size};
+    const size_t weighted_min_size{std::min(local_set_size, remote_set_size) * q / RECON_Q_PRECISION};
+    return std::min(set_size_diff + weighted_min_size + 1, MAX_SKETCH_CAPACITY);
+}
+
+/** Bytes per difference in a serialized sketch of 32-bit short IDs */
+constexpr size_t SKETCH_BYTES_PER_CAPACITY{4};
+
+/**
+ * Keeps track of txreconciliation-related per-peer state.
+ */
+class TxReconciliationState
+{
+public:
+    /**
+     * Reconciliation protocol assumes using one role consistently: either a reconciliation
+     * initiator (requesting sketches), or responder (sending sketches). We initiate with the
+     * peers we connected to.
+     */
+    bool m_we_initiate;
+
+    /**
+     * These values are used to salt short IDs, which is necessary for transaction reconciliations.
+     */
+    uint64_t m_k0, m_k1;
+
+    /** The transactions to reconcile with the peer since the last reconciliation. */
+    std::unordered_set<uint256, SaltedTxidHasher> m_local_set;
+
+    /**
+     * Responder: the set our last sketch was computed from, by short ID, kept until the
+     * peer tells us which of its transactions it misses.
+     */
+    std::unordered_map<uint32_t, uint256> m_set_snapshot;
+    bool m_snapshot_pending{false};
+
+    /** Initiator: when we sent the reqrecon the peer has not answered yet. */
+    std::optional<std::chrono::microseconds> m_request_sent;
+    /** Initiator: when to request the next sketch. */
+    std::chrono::microseconds m_next_request{0};
+
+    TxReconciliationState(bool we_initiate, uint64_t k0, uint64_t k1) : m_we_initiate(we_initiate), m_k0(k0), m_k1(k1) {}
+
+    /** Short ID of a transaction per BIP-330, in [1, 2^32 - 1]. */
+    uint32_t ComputeShortID(const uint256& wtxid) const
+    {
+        return 1 + (SipHashUint256(m_k0, m_k1, wtxid) % 0xFFFFFFFF);
+    }
+
+    /** Short IDs of the local set. */
+    std::unordered_map<uint32_t, uint256> LocalShortIDs() const
+    {
+        std::unordered_map<uint32_t, uint256> short_ids;
+        short_ids.reserve(m_local_set.size());
+        for (const uint256& wtxid : m_local_set) {
+            short_ids.emplace(ComputeShortID(wtxid), wtxid);
+        }
+        return short_ids;
+    }
+};
+
+/** Sketch of a set of short IDs with the given capacity. */
+Minisketch ComputeSketch(const std::unordered_map<uint32_t, uint256>& short_ids, size_t capacity)
+{
+    Minisketch sketch{node::MakeMinisketch32(capacity)};
+    for (const auto& [short_id, wtxid] : short_ids) {
+        sketch.Add(short_id);
+    }
+    return sketch;
+}
+
+} // namespace
+
+/** Actual implementation for TxReconciliationTracker's data structure. */
+class TxReconciliationTracker::Impl
+{
+private:
+    mutable Mutex m_txreconciliation_mutex;
+
+    // Local protocol version
+    uint32_t m_recon_version;
+
+    /**
+     * Keeps track of txreconciliation states of eligible peers.
+     * For pre-registered peers, the locally generated salt is stored.
+     * For registered peers, the locally generated salt is forgotten, and the state (including
+     * "full" salt) is stored instead.
+     */
+    std::unordered_map<NodeId, std::variant<uint64_t, TxReconciliationState>> m_states GUARDED_BY(m_txreconciliation_mutex);
+
+    /** Number of registered peers we initiate reconciliations with. */
+    size_t m_outbound_registered GUARDED_BY(m_txreconciliation_mutex){0};
+
+    /** Keys choosing the reconciling peers a transaction is flooded to. */
+    const uint64_t m_fanout_k0{GetRand<uint64_t>()};
+    const uint64_t m_fanout_k1{GetRand<uint64_t>()};
+
+    TxReconciliationState* GetRegisteredState(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(m_txreconciliation_mutex)
+    {
+        auto it = m_states.find(peer_id);
+        if (it == m_states.end()) return nullptr;
+        return std::get_if<TxReconciliationState>(&it->second);
+    }
+
+public:
+    explicit Impl(uint32_t recon_version) : m_recon_version(recon_version) {}
+
+    uint64_t PreRegisterPeer(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Pre-register peer=%d\n", peer_id);
+        const uint64_t local_salt{GetRand(UINT64_MAX)};
+
+        // We do this exactly once per peer (which are unique by NodeId, see GetNewNodeId) so it's
+        // safe to assume we don't have this record yet.
+        Assume(m_states.emplace(peer_id, local_salt).second);
+        return local_salt;
+    }
+
+    ReconciliationRegisterResult RegisterPeer(NodeId peer_id, bool is_peer_inbound, uint32_t peer_recon_version,
+                                              uint64_t remote_salt) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto recon_state = m_states.find(peer_id);
+
+        if (recon_state == m_states.end()) return ReconciliationRegisterResult::NOT_FOUND;
+
+        if (std::holds_alternative<TxReconciliationState>(recon_state->second)) {
+            return ReconciliationRegisterResult::ALREADY_REGISTERED;
+        }
+
+        uint64_t local_salt = *std::get_if<uint64_t>(&recon_state->second);
+
+        // If the peer supports the version which is lower than ours, we downgrade to the version
+        // it supports. For now, this only guarantees that nodes with future reconciliation
+        // versions have the choice of reconciling with this current version. However, they also
+        // have the choice to refuse supporting reconciliations if the common version is not
+        // satisfactory (e.g. too low).
+        const uint32_t recon_version{std::min(peer_recon_version, m_recon_version)};
+        // v1 is the lowest version, so suggesting something below must be a protocol violation.
+        if (recon_version < 1) return ReconciliationRegisterResult::PROTOCOL_VIOLATION;
+
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Register peer=%d (inbound=%i)\n",
+                      peer_id, is_peer_inbound);
+
+        const uint256 full_salt{ComputeSalt(local_salt, remote_salt)};
+        recon_state->second.emplace<TxReconciliationState>(!is_peer_inbound, full_salt.GetUint64(0), full_salt.GetUint64(1));
+        if (!is_peer_inbound) ++m_outbound_registered;
+        return ReconciliationRegisterResult::SUCCESS;
+    }
+
+    void ForgetPeer(NodeId peer_id) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        const auto it{m_states.find(peer_id)};
+        if (it == m_states.end()) return;
+        if (const auto* state{std::get_if<TxReconciliationState>(&it->second)}; state && state->m_we_initiate) {
+            --m_outbound_registered;
+        }
+        m_states.erase(it);
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Forget txreconciliation state of peer=%d\n", peer_id);
+    }
+
+    bool IsPeerRegistered(NodeId peer_id) const EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        auto recon_state = m_states.find(peer_id);
+        return (recon_state != m_states.end() &&
+                std::holds_alternative<TxReconciliationState>(recon_state->second));
+    }
+
+    bool ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        const auto it{m_states.find(peer_id)};
+        if (it == m_states.end()) return true;
+        const auto* state{std::get_if<TxReconciliationState>(&it->second)};
+        if (!state) return true;
+
+        const double fanout_rate{state->m_we_initiate ?
+            double(OUTBOUND_FANOUT_DESTINATIONS) / std::max<size_t>(m_outbound_registered, 1) :
+            INBOUND_FANOUT_DESTINATIONS_FRACTION};
+        const uint64_t hash{CSipHasher(m_fanout_k0, m_fanout_k1).Write(wtxid.begin(), wtxid.size()).Write(peer_id).Finalize()};
+        return (hash >> 11) * 0x1.0p-53 < fanout_rate;
+    }
+
+    bool AddToSet(NodeId peer_id, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || state->m_local_set.size() >= MAX_RECONSET_SIZE) return false;
+        state->m_local_set.insert(wtxid);
+        return true;
+    }
+
+    void TryRemovingFromSet(NodeId peer_id, const uint256& wtxid) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        if (TxReconciliationState* state{GetRegisteredState(peer_id)}) {
+            state->m_local_set.erase(wtxid);
+        }
+    }
+
+    std::optional<std::pair<uint16_t, uint16_t>> InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || !state->m_we_initiate) return std::nullopt;
+        if (state->m_next_request == 0us) {
+            // Give the first reconciliation a set to work on
+            state->m_next_request = now + RECON_REQUEST_INTERVAL;
+            return std::nullopt;
+        }
+        if (state->m_request_sent && now < *state->m_request_sent + RECON_RESPONSE_TIMEOUT) return std::nullopt;
+        if (now < state->m_next_request) return std::nullopt;
+
+        state->m_request_sent = now;
+        state->m_next_request = now + RECON_REQUEST_INTERVAL;
+        const uint16_t set_size{uint16_t(std::min<size_t>(state->m_local_set.size(), std::numeric_limits<uint16_t>::max()))};
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Request reconciliation of %u transactions from peer=%d\n",
+                      set_size, peer_id);
+        return std::make_pair(set_size, uint16_t(RECON_Q * RECON_Q_PRECISION));
+    }
+
+    bool HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q,
+                                     std::vector<unsigned char>& skdata) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || state->m_we_initiate) return false;
+
+        if (state->m_snapshot_pending) {
+            // The peer gave up on the previous reconciliation; reconcile its set again
+            for (const auto& [short_id, wtxid] : state->m_set_snapshot) {
+                state->m_local_set.insert(wtxid);
+            }
+        }
+
+        state->m_set_snapshot = state->LocalShortIDs();
+        state->m_local_set.clear();
+        state->m_snapshot_pending = true;
+        const size_t capacity{EstimateSketchCapacity(state->m_set_snapshot.size(), peer_set_size, peer_q)};
+        skdata = ComputeSketch(state->m_set_snapshot, capacity).Serialize();
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug, "Send sketch of %u transactions with capacity %u to peer=%d\n",
+                      state->m_set_snapshot.size(), capacity, peer_id);
+        return true;
+    }
+
+    bool HandleSketch(NodeId peer_id, Span<const unsigned char> skdata, bool& success,
+                      std::vector<uint256>& txs_to_announce, std::vector<uint32_t>& txs_to_request)
+        EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        success = false;
+        txs_to_announce.clear();
+        txs_to_request.clear();
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || !state->m_we_initiate) return false;
+        if (skdata.empty() || skdata.size() % SKETCH_BYTES_PER_CAPACITY != 0 ||
+            skdata.size() / SKETCH_BYTES_PER_CAPACITY > MAX_SKETCH_CAPACITY) {
+            return false;
+        }
+        // A late answer to a request given up on: the peer falls back to announcing its set
+        if (!state->m_request_sent) return true;
+        state->m_request_sent.reset();
+
+        const size_t capacity{skdata.size() / SKETCH_BYTES_PER_CAPACITY};
+        Minisketch remote_sketch{node::MakeMinisketch32(capacity)};
+        remote_sketch.Deserialize(skdata);
+
+        const std::unordered_map<uint32_t, uint256> local_short_ids{state->LocalShortIDs()};
+        state->m_local_set.clear();
+        Minisketch sketch{ComputeSketch(local_short_ids, capacity)};
+        sketch.Merge(remote_sketch);
+        const std::optional<std::vector<uint64_t>> differences{sketch.Decode(capacity)};
+        if (differences) {
+            success = true;
+            for (const uint64_t short_id : *differences) {
+                const auto it{local_short_ids.find(uint32_t(short_id))};
+                if (it != local_short_ids.end()) {
+                    txs_to_announce.push_back(it->second);
+                } else {
+                    txs_to_request.push_back(uint32_t(short_id));
+                }
+            }
+        } else {
+            for (const auto& [short_id, wtxid] : local_short_ids) {
+                txs_to_announce.push_back(wtxid);
+            }
+        }
+        LogPrintLevel(BCLog::TXRECONCILIATION, BCLog::Level::Debug,
+                      "Reconciliation with peer=%d %s: announce %u, request %u transactions\n",
+                      peer_id, success ? "succeeded" : "failed", txs_to_announce.size(), txs_to_request.size());
+        return true;
+    }
+
+    bool HandleReconciliationDifference(NodeId peer_id, bool success, Span<const uint32_t> ask_shortids,
+                                        std::vector<uint256>& txs_to_announce) EXCLUSIVE_LOCKS_REQUIRED(!m_txreconciliation_mutex)
+    {
+        AssertLockNotHeld(m_txreconciliation_mutex);
+        LOCK(m_txreconciliation_mutex);
+        txs_to_announce.clear();
+        TxReconciliationState* state{GetRegisteredState(peer_id)};
+        if (!state || state->m_we_initiate) return false;
+        if (!state->m_snapshot_pending) return true;
+
+        if (success) {
+            for (const uint32_t short_id : ask_shortids) {
+                const auto it{state->m_set_snapshot.find(short_id)};
+                if (it != state->m_set_snapshot.end()) txs_to_announce.push_back(it->second);
+            }
+        } else {
+            for (const auto& [short_id, wtxid] : state->m_set_snapshot) {
+                txs_to_announce.push_back(wtxid);
+            }
+        }
+        state->m_set_snapshot.clear();
+        state->m_snapshot_pending = false;
+        return true;
+    }
+};
+
+TxReconciliationTracker::TxReconciliationTracker(uint32_t recon_version) : m_impl{std::make_unique<TxReconciliationTracker::Impl>(recon_version)} {}
+
+TxReconciliationTracker::~TxReconciliationTracker() = default;
+
+uint64_t TxReconciliationTracker::PreRegisterPeer(NodeId peer_id)
+{
+    return m_impl->PreRegisterPeer(peer_id);
+}
+
+ReconciliationRegisterResult TxReconciliationTracker::RegisterPeer(NodeId peer_id, bool is_peer_inbound,
+                                                          uint32_t peer_recon_version, uint64_t remote_salt)
+{
+    return m_impl->RegisterPeer(peer_id, is_peer_inbound, peer_recon_version, remote_salt);
+}
+
+void TxReconciliationTracker::ForgetPeer(NodeId peer_id)
+{
+    m_impl->ForgetPeer(peer_id);
+}
+
+bool TxReconciliationTracker::IsPeerRegistered(NodeId peer_id) const
+{
+    return m_impl->IsPeerRegistered(peer_id);
+}
+
+bool TxReconciliationTracker::ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const
+{
+    return m_impl->ShouldFanoutTo(wtxid, peer_id);
+}
+
+bool TxReconciliationTracker::AddToSet(NodeId peer_id, const uint256& wtxid)
+{
+    return m_impl->AddToSet(peer_id, wtxid);
+}
+
+void TxReconciliationTracker::TryRemovingFromSet(NodeId peer_id, const uint256& wtxid)
+{
+    m_impl->TryRemovingFromSet(peer_id, wtxid);
+}
+
+std::optional<std::pair<uint16_t, uint16_t>> TxReconciliationTracker::InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now)
+{
+    return m_impl->InitiateReconciliationRequest(peer_id, now);
+}
+
+bool TxReconciliationTracker::HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q,
+                                                          std::vector<unsigned char>& skdata)
+{
+    return m_impl->HandleReconciliationRequest(peer_id, peer_set_size, peer_q, skdata);
+}
+
+bool TxReconciliationTracker::HandleSketch(NodeId peer_id, Span<const unsigned char> skdata, bool& success,
+                                           std::vector<uint256>& txs_to_announce, std::vector<uint32_t>& txs_to_request)
+{
+    return m_impl->HandleSketch(peer_id, skdata, success, txs_to_announce, txs_to_request);
+}
+
+bool TxReconciliationTracker::HandleReconciliationDifference(NodeId peer_id, bool success, Span<const uint32_t> ask_shortids,
+                                                             std::vector<uint256>& txs_to_announce)
+{
+    return m_impl->HandleReconciliationDifference(peer_id, success, ask_shortids, txs_to_announce);
+}
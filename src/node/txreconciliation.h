@@ -0,0 +1,158 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_NODE_TXRECONCILIATION_H
+#define BITCOIN_NODE_TXRECONCILIATION_H
+
+#include <net.h>
+#include <span.h>
+#include <uint256.h>
+#include <util/time.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+/** Whether transaction reconciliation protocol should be enabled by default. */
+static constexpr bool DEFAULT_TXRECONCILIATION_ENABLE{false};
+/** Supported transaction reconciliation protocol version */
+static constexpr uint32_t TXRECONCILIATION_VERSION{1};
+/** Maximum number of transactions kept in the reconciliation set of a peer; later ones are flooded. */
+static constexpr size_t MAX_RECONSET_SIZE{3000};
+/** Maximum number of differences a sketch can hold, bounding its size to 4 bytes per difference. */
+static constexpr size_t MAX_SKETCH_CAPACITY{2 << 12};
+/** Interval between the reconciliations we initiate with a peer. */
+static constexpr std::chrono::microseconds RECON_REQUEST_INTERVAL{8s};
+/** Time after which a reconciliation the peer did not answer is given up. */
+static constexpr std::chrono::microseconds RECON_RESPONSE_TIMEOUT{2min};
+/** Share of the inbound reconciling peers a transaction is still flooded to. */
+static constexpr double INBOUND_FANOUT_DESTINATIONS_FRACTION{0.1};
+/** Number of outbound reconciling peers a transaction is still flooded to, on average. */
+static constexpr size_t OUTBOUND_FANOUT_DESTINATIONS{1};
+/** Coefficient estimating the set difference from the smaller set, and its fixed-point precision in reqrecon. */
+static constexpr double RECON_Q{0.25};
+static constexpr uint16_t RECON_Q_PRECISION{(2 << 14) - 1};
+
+enum class ReconciliationRegisterResult {
+    NOT_FOUND,
+    SUCCESS,
+    ALREADY_REGISTERED,
+    PROTOCOL_VIOLATION,
+};
+
+/**
+ * Transaction reconciliation is a way for nodes to efficiently announce transactions.
+ * This object keeps track of all txreconciliation-related communications with the peers.
+ * The high-level protocol is:
+ * 0.  Txreconciliation protocol handshake.
+ * 1.  Once we receive a new transaction, add it to the set instead of announcing immediately.
+ * 2.  At regular intervals, a txreconciliation initiator requests a sketch from a peer, where a
+ *     sketch is a compressed representation of short form IDs of the transactions in their set.
+ * 3.  Once the initiator received a sketch from the peer, the initiator computes a local sketch,
+ *     and combines the two sketches to attempt finding the difference in *sets*.
+ * 4a. If the difference was not larger than estimated, see SUCCESS below.
+ * 4b. If the difference was larger than estimated, both sides fall back to announcing their
+ *     whole sets.
+ *
+ * SUCCESS. Once the initiator knows the difference, it announces the transactions the peer is
+ *     missing and asks the peer, by short ID, for the ones it is missing itself.
+ *
+ * A few transactions are still flooded to reconciling peers (low fan-out), so that they
+ * propagate quickly through the network; the rest reaches them through reconciliation.
+ * This is the node side of BIP 330 without sketch extensions.
+ */
+class TxReconciliationTracker
+{
+private:
+    class Impl;
+    const std::unique_ptr<Impl> m_impl;
+
+public:
+    explicit TxReconciliationTracker(uint32_t recon_version);
+
+    ~TxReconciliationTracker();
+
+    /**
+     * Step 0. Generates initial part of the state (salt) required to reconcile txs with the peer.
+     * The salt is used for short ID computation required for txreconciliation.
+     * The function returns the salt.
+     * A peer can't participate in future txreconciliations without this call.
+     * This function must be called only once per peer.
+     */
+    uint64_t PreRegisterPeer(NodeId peer_id);
+
+    /**
+     * Step 0. Once the peer agreed to reconcile txs with us, generate the state required to track
+     * ongoing reconciliations. Must be called only after pre-registering the peer and only once.
+     */
+    ReconciliationRegisterResult RegisterPeer(NodeId peer_id, bool is_peer_inbound,
+                                              uint32_t peer_recon_version, uint64_t remote_salt);
+
+    /**
+     * Attempts to forget txreconciliation-related state of the peer (if we previously stored any).
+     * After this, we won't be able to reconcile transactions with the peer.
+     */
+    void ForgetPeer(NodeId peer_id);
+
+    /**
+     * Check if a peer is registered to reconcile transactions with us.
+     */
+    bool IsPeerRegistered(NodeId peer_id) const;
+
+    /**
+     * Step 1. Whether a transaction should still be flooded to a registered peer. The choice is
+     * deterministic for a transaction and peer, and floods it to about
+     * INBOUND_FANOUT_DESTINATIONS_FRACTION of the inbound and OUTBOUND_FANOUT_DESTINATIONS of the
+     * outbound reconciling peers.
+     */
+    bool ShouldFanoutTo(const uint256& wtxid, NodeId peer_id) const;
+
+    /**
+     * Step 1. Add a transaction to the reconciliation set of a peer instead of announcing it.
+     * Returns false if the peer is not registered or its set is full, in which case the
+     * transaction should be flooded.
+     */
+    bool AddToSet(NodeId peer_id, const uint256& wtxid);
+
+    /**
+     * Remove a transaction from the reconciliation set of a peer, because the peer announced it.
+     */
+    void TryRemovingFromSet(NodeId peer_id, const uint256& wtxid);
+
+    /**
+     * Step 2. If a reconciliation we initiate with the peer is due, start it and return the fields
+     * of the reqrecon message to send: the size of our set and the q coefficient.
+     */
+    std::optional<std::pair<uint16_t, uint16_t>> InitiateReconciliationRequest(NodeId peer_id, std::chrono::microseconds now);
+
+    /**
+     * Step 2. Handle a reqrecon message of a peer that initiates reconciliations with us: move our
+     * set aside and return its sketch in skdata. Returns false on a protocol violation.
+     */
+    bool HandleReconciliationRequest(NodeId peer_id, uint16_t peer_set_size, uint16_t peer_q,
+                                     std::vector<unsigned char>& skdata);
+
+    /**
+     * Step 3. Handle the sketch of a peer we requested it from. Returns false on a protocol
+     * violation. Otherwise returns in success whether the difference could be decoded, in
+     * txs_to_announce the wtxids to announce to the peer (our whole set on failure), and in
+     * txs_to_request the short IDs of the transactions to ask the peer for in reconcildiff.
+     * A late sketch for a request we gave up on fails without announcing anything.
+     */
+    bool HandleSketch(NodeId peer_id, Span<const unsigned char> skdata, bool& success,
+                      std::vector<uint256>& txs_to_announce, std::vector<uint32_t>& txs_to_request);
+
+    /**
+     * Step 4. Handle the reconcildiff message of a peer that initiated a reconciliation with us.
+     * Returns false on a protocol violation. Otherwise returns in txs_to_announce the wtxids the
+     * peer asked for, or our whole set if it could not decode the difference.
+     */
+    bool HandleReconciliationDifference(NodeId peer_id, bool success, Span<const uint32_t> ask_shortids,
+                                        std::vector<uint256>& txs_to_announce);
+};
+
+#endif // BITCOIN_NODE_TXRECONCILIATION_H
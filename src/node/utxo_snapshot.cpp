@@ -0,0 +1,61 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/utxo_snapshot.h>
+
+#include <clientversion.h>
+#include <streams.h>
+
+#include <algorithm>
+#include <ios>
+#include <iterator>
+#include <limits>
+
+namespace node {
+std::vector<unsigned char> SerializeSnapshotChunk(const SnapshotCoins& coins)
+{
+    std::vector<unsigned char> data;
+    CVectorWriter writer{SER_DISK, CLIENT_VERSION, data, 0};
+    for (auto it = coins.begin(); it != coins.end();) {
+        const uint256& txid{it->first.hash};
+        auto tx_end{std::find_if(it, coins.end(), [&](const auto& entry) { return entry.first.hash != txid; })};
+        writer << txid;
+        WriteCompactSize(writer, std::distance(it, tx_end));
+        for (; it != tx_end; ++it) {
+            WriteCompactSize(writer, it->first.n);
+            writer << it->second;
+        }
+    }
+    return data;
+}
+
+bool DeserializeSnapshotChunk(Span<const unsigned char> data, uint64_t coins_count, SnapshotCoins& coins)
+{
+    coins.clear();
+    SpanReader reader{SER_DISK, CLIENT_VERSION, data};
+    try {
+        while (!reader.empty()) {
+            uint256 txid;
+            reader >> txid;
+            const uint64_t num_outputs{ReadCompactSize(reader)};
+            if (num_outputs == 0 || num_outputs > coins_count - coins.size()) return false;
+            for (uint64_t i = 0; i < num_outputs; ++i) {
+                const uint64_t n{ReadCompactSize(reader, /*range_check=*/false)};
+                if (n > std::numeric_limits<uint32_t>::max()) return false;
+                Coin coin;
+                reader >> coin;
+                coins.emplace_back(COutPoint{txid, static_cast<uint32_t>(n)}, std::move(coin));
+            }
+        }
+    } catch (const std::ios_base::failure&) {
+        return false;
+    }
+    return coins.size() == coins_count;
+}
+
+uint64_t GetSnapshotChunkSize(size_t data_size)
+{
+    return sizeof(uint64_t) + GetSizeOfCompactSize(data_size) + data_size + sizeof(uint256);
+}
+} // namespace node
@@ -6,15 +6,39 @@
 #ifndef BITCOIN_NODE_UTXO_SNAPSHOT_H
 #define BITCOIN_NODE_UTXO_SNAPSHOT_H
 
-#include <uint256.h>
+#include <coins.h>
+#include <primitives/transaction.h>
 #include <serialize.h>
+#include <span.h>
+#include <uint256.h>
+
+#include <array>
+#include <cstdint>
+#include <ios>
+#include <utility>
+#include <vector>
 
 namespace node {
+//! Magic bytes at the start of a UTXO snapshot
+static constexpr std::array<uint8_t, 5> SNAPSHOT_MAGIC_BYTES{'u', 't', 'x', 'o', 0xff};
+
+//! Size of the coin data after which a snapshot chunk is ended at the next transaction
+static constexpr size_t SNAPSHOT_CHUNK_SIZE{4 << 20};
+
 //! Metadata describing a serialized version of a UTXO set from which an
 //! assumeutxo Chainstate can be constructed.
+//!
+//! A snapshot consists of this metadata, followed by the coins in database
+//! order, split into chunks (see SnapshotChunkInfo). Each chunk holds the
+//! outputs of whole transactions, grouped by txid, and the hash of its data,
+//! so it can be checked and parsed on its own. An index of all chunks and
+//! the offset of that index end the file.
 class SnapshotMetadata
 {
 public:
+    //! Version of the snapshot format
+    static constexpr uint16_t VERSION{2};
+
     //! The hash of the block that reflects the tip of the chain for the
     //! UTXO set contained in this snapshot.
     uint256 m_base_blockhash;
@@ -31,8 +55,61 @@ public:
             m_base_blockhash(base_blockhash),
             m_coins_count(coins_count) { }
 
-    SERIALIZE_METHODS(SnapshotMetadata, obj) { READWRITE(obj.m_base_blockhash, obj.m_coins_count); }
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << Span{SNAPSHOT_MAGIC_BYTES} << VERSION << m_base_blockhash << m_coins_count;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
+    {
+        std::array<uint8_t, SNAPSHOT_MAGIC_BYTES.size()> magic;
+        uint16_t version;
+        s >> Span{magic} >> version;
+        if (magic != SNAPSHOT_MAGIC_BYTES) {
+            throw std::ios_base::failure("Invalid UTXO snapshot magic bytes");
+        }
+        if (version != VERSION) {
+            throw std::ios_base::failure("Unsupported UTXO snapshot version");
+        }
+        s >> m_base_blockhash >> m_coins_count;
+    }
 };
+
+//! Coins of a snapshot chunk, in database order
+using SnapshotCoins = std::vector<std::pair<COutPoint, Coin>>;
+
+/**
+ * Entry of the index at the end of a snapshot. In the file, a chunk is its
+ * number of coins, its coin data as a byte vector, and the hash of that data.
+ */
+struct SnapshotChunkInfo {
+    //! Offset of the chunk from the start of the file
+    uint64_t m_offset{0};
+    uint64_t m_coins_count{0};
+    //! Hash of the coin data of the chunk
+    uint256 m_hash{};
+
+    SERIALIZE_METHODS(SnapshotChunkInfo, obj) { READWRITE(obj.m_offset, obj.m_coins_count, obj.m_hash); }
+
+    friend bool operator==(const SnapshotChunkInfo& a, const SnapshotChunkInfo& b)
+    {
+        return a.m_offset == b.m_offset && a.m_coins_count == b.m_coins_count && a.m_hash == b.m_hash;
+    }
+};
+
+/** Serialize the coin data of a chunk. Outputs of one transaction must be next to each other. */
+std::vector<unsigned char> SerializeSnapshotChunk(const SnapshotCoins& coins);
+
+/**
+ * Parse the coin data of a chunk into coins. Returns false if it is
+ * malformed or does not hold exactly coins_count coins.
+ */
+[[nodiscard]] bool DeserializeSnapshotChunk(Span<const unsigned char> data, uint64_t coins_count, SnapshotCoins& coins);
+
+/** Size in the file of a chunk with data_size bytes of coin data. */
+uint64_t GetSnapshotChunkSize(size_t data_size);
 } // namespace node
 
 #endif // BITCOIN_NODE_UTXO_SNAPSHOT_H
@@ -99,6 +99,11 @@ private:
 
     double decay;
 
+    // The decay applied since the averages above were last renormalized.
+    // Their actual values are the stored ones times this factor, so that
+    // decaying them for a block doesn't have to touch every bucket.
+    double m_decay_factor{1};
+
     // Resolution (# of blocks) with which confirmations are tracked
     unsigned int scale;
 
@@ -111,6 +116,9 @@ private:
 
     void resizeInMemoryCounters(size_t newbuckets);
 
+    /** Apply the pending decay to the stored averages */
+    void Renormalize();
+
 public:
     /**
      * Create new TxConfirmStats. This is called by BlockPolicyEstimator's
@@ -141,7 +149,8 @@ public:
                   unsigned int bucketIndex, bool inBlock);
 
     /** Update our estimates by decaying our historical moving average and updating
-        with the data gathered from the current block */
+        with the data gathered from the current block. The decay is applied lazily,
+        so this takes constant time. */
     void UpdateMovingAverages();
 
     /**
@@ -216,24 +225,34 @@ void TxConfirmStats::Record(int blocksToConfirm, double feerate)
         return;
     int periodsToConfirm = (blocksToConfirm + scale - 1) / scale;
     unsigned int bucketindex = bucketMap.lower_bound(feerate)->second;
+    // Scale the data point up by the decay the stored averages are still missing
+    const double weight{1 / m_decay_factor};
     for (size_t i = periodsToConfirm; i <= confAvg.size(); i++) {
-        confAvg[i - 1][bucketindex]++;
+        confAvg[i - 1][bucketindex] += weight;
     }
-    txCtAvg[bucketindex]++;
-    m_feerate_avg[bucketindex] += feerate;
+    txCtAvg[bucketindex] += weight;
+    m_feerate_avg[bucketindex] += feerate * weight;
 }
 
 void TxConfirmStats::UpdateMovingAverages()
+{
+    m_decay_factor *= decay;
+    // Keep the stored values, which grow as the factor shrinks, well within range
+    if (m_decay_factor < 1e-50) Renormalize();
+}
+
+void TxConfirmStats::Renormalize()
 {
     assert(confAvg.size() == failAvg.size());
     for (unsigned int j = 0; j < buckets.size(); j++) {
         for (unsigned int i = 0; i < confAvg.size(); i++) {
-            confAvg[i][j] *= decay;
-            failAvg[i][j] *= decay;
+            confAvg[i][j] *= m_decay_factor;
+            failAvg[i][j] *= m_decay_factor;
         }
-        m_feerate_avg[j] *= decay;
-        txCtAvg[j] *= decay;
+        m_feerate_avg[j] *= m_decay_factor;
+        txCtAvg[j] *= m_decay_factor;
     }
+    m_decay_factor = 1;
 }
 
 // returns -1 on error conditions
@@ -273,9 +292,9 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
             newBucketRange = false;
         }
         curFarBucket = bucket;
-        nConf += confAvg[periodTarget - 1][bucket];
-        totalNum += txCtAvg[bucket];
-        failNum += failAvg[periodTarget - 1][bucket];
+        nConf += confAvg[periodTarget - 1][bucket] * m_decay_factor;
+        totalNum += txCtAvg[bucket] * m_decay_factor;
+        failNum += failAvg[periodTarget - 1][bucket] * m_decay_factor;
         for (unsigned int confct = confTarget; confct < GetMaxConfirms(); confct++)
             extraNum += unconfTxs[(nBlockHeight - confct) % bins][bucket];
         extraNum += oldUnconfTxs[bucket];
@@ -392,12 +411,21 @@ double TxConfirmStats::EstimateMedianVal(int confTarget, double sufficientTxVal,
 
 void TxConfirmStats::Write(AutoFile& fileout) const
 {
+    // Write the decayed values, so the file doesn't depend on the factor
+    const auto decayed = [&](std::vector<double> values) {
+        for (double& value : values) value *= m_decay_factor;
+        return values;
+    };
+    std::vector<std::vector<double>> conf_avg, fail_avg;
+    for (const auto& values : confAvg) conf_avg.push_back(decayed(values));
+    for (const auto& values : failAvg) fail_avg.push_back(decayed(values));
+
     fileout << Using<EncodedDoubleFormatter>(decay);
     fileout << scale;
-    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(m_feerate_avg);
-    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(txCtAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(confAvg);
-    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(failAvg);
+    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(decayed(m_feerate_avg));
+    fileout << Using<VectorFormatter<EncodedDoubleFormatter>>(decayed(txCtAvg));
+    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(conf_avg);
+    fileout << Using<VectorFormatter<VectorFormatter<EncodedDoubleFormatter>>>(fail_avg);
 }
 
 void TxConfirmStats::Read(AutoFile& filein, int nFileVersion, size_t numBuckets)
@@ -407,9 +435,11 @@ void TxConfirmStats::Read(AutoFile& filein, int nFileVersion, size_t numBuckets)
     // If there is a read failure, we'll just discard this entire object anyway
     size_t maxConfirms, maxPeriods;
 
-    // The current version will store the decay with each individual TxConfirmStats and also keep a scale factor
-    filein >> Using<EncodedDoubleFormatter>(decay);
-    if (decay <= 0 || decay >= 1) {
+    // The current version will store the decay with each individual TxConfirmStats and also keep a scale factor.
+    // The decay is derived from the block spacing, so the one of the file is only checked.
+    double file_decay;
+    filein >> Using<EncodedDoubleFormatter>(file_decay);
+    if (file_decay <= 0 || file_decay >= 1) {
         throw std::runtime_error("Corrupt estimates file. Decay must be between 0 and 1 (non-inclusive)");
     }
     filein >> scale;
@@ -451,6 +481,7 @@ void TxConfirmStats::Read(AutoFile& filein, int nFileVersion, size_t numBuckets)
     // Resize the current block variables which aren't stored in the data file
     // to match the number of confirms and buckets
     resizeInMemoryCounters(numBuckets);
+    m_decay_factor = 1;
 
     LogPrint(BCLog::ESTIMATEFEE, "Reading estimates: %u buckets counting confirms up to %u blocks\n",
              numBuckets, maxConfirms);
@@ -496,7 +527,7 @@ void TxConfirmStats::removeTx(unsigned int entryHeight, unsigned int nBestSeenHe
         assert(scale != 0);
         unsigned int periodsAgo = blocksAgo / scale;
         for (size_t i = 0; i < periodsAgo && i < failAvg.size(); i++) {
-            failAvg[i][bucketindex]++;
+            failAvg[i][bucketindex] += 1 / m_decay_factor;
         }
     }
 }
@@ -527,8 +558,19 @@ bool CBlockPolicyEstimator::_removeTx(const uint256& hash, bool inBlock)
     }
 }
 
-CBlockPolicyEstimator::CBlockPolicyEstimator(const fs::path& estimation_filepath)
-    : m_estimation_filepath{estimation_filepath}, nBestSeenHeight{0}, firstRecordedHeight{0}, historicalFirst{0}, historicalBest{0}, trackedTxs{0}, untrackedTxs{0}
+/** The decay per block that halves a moving average over halflife */
+static double DecayForHalfLife(std::chrono::seconds halflife, std::chrono::seconds block_spacing)
+{
+    assert(block_spacing > 0s && block_spacing < halflife);
+    return std::pow(0.5, double(block_spacing.count()) / halflife.count());
+}
+
+CBlockPolicyEstimator::CBlockPolicyEstimator(const fs::path& estimation_filepath, std::chrono::seconds block_spacing)
+    : m_estimation_filepath{estimation_filepath},
+      m_short_decay{DecayForHalfLife(SHORT_HALFLIFE_TIME, block_spacing)},
+      m_med_decay{DecayForHalfLife(MED_HALFLIFE_TIME, block_spacing)},
+      m_long_decay{DecayForHalfLife(LONG_HALFLIFE_TIME, block_spacing)},
+      nBestSeenHeight{0}, firstRecordedHeight{0}, historicalFirst{0}, historicalBest{0}, trackedTxs{0}, untrackedTxs{0}
 {
     static_assert(MIN_BUCKET_FEERATE > 0, "Min feerate must be nonzero");
     size_t bucketIndex = 0;
@@ -541,9 +583,9 @@ CBlockPolicyEstimator::CBlockPolicyEstimator(const fs::path& estimation_filepath
     bucketMap[INF_FEERATE] = bucketIndex;
     assert(bucketMap.size() == buckets.size());
 
-    feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
-    shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
-    longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+    feeStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, m_med_decay, MED_SCALE));
+    shortStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, m_short_decay, SHORT_SCALE));
+    longStats = std::unique_ptr<TxConfirmStats>(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, m_long_decay, LONG_SCALE));
 
     // If the fee estimation file is present, read recorded estimations
     AutoFile est_file{fsbridge::fopen(m_estimation_filepath, "rb")};
@@ -634,6 +676,9 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
         return;
     }
 
+    // Estimates are only recomputed once per block
+    m_smart_fee_cache.clear();
+
     // Must update nBestSeenHeight in sync with ClearCurrent so that
     // calls to removeTx (via processBlockTx) correctly calculate age
     // of unconfirmed txs to remove from tracking.
@@ -644,7 +689,7 @@ void CBlockPolicyEstimator::processBlock(unsigned int nBlockHeight,
     shortStats->ClearCurrent(nBlockHeight);
     longStats->ClearCurrent(nBlockHeight);
 
-    // Decay all exponential averages
+    // Decay all exponential averages (lazily)
     feeStats->UpdateMovingAverages();
     shortStats->UpdateMovingAverages();
     longStats->UpdateMovingAverages();
@@ -827,6 +872,33 @@ CFeeRate CBlockPolicyEstimator::estimateSmartFee(int confTarget, FeeCalculation
 {
     LOCK(m_cs_fee_estimator);
 
+    auto [it, inserted]{m_smart_fee_cache.try_emplace({confTarget, conservative})};
+    if (inserted) {
+        it->second.first = _estimateSmartFee(confTarget, &it->second.second, conservative);
+    }
+    if (feeCalc) *feeCalc = it->second.second;
+    return it->second.first;
+}
+
+std::vector<std::pair<CFeeRate, FeeCalculation>> CBlockPolicyEstimator::estimateSmartFeeCurve(int max_target, bool conservative) const
+{
+    LOCK(m_cs_fee_estimator);
+
+    std::vector<std::pair<CFeeRate, FeeCalculation>> curve;
+    for (int target = 1; target <= max_target; ++target) {
+        auto [it, inserted]{m_smart_fee_cache.try_emplace({target, conservative})};
+        if (inserted) {
+            it->second.first = _estimateSmartFee(target, &it->second.second, conservative);
+        }
+        curve.push_back(it->second);
+    }
+    return curve;
+}
+
+CFeeRate CBlockPolicyEstimator::_estimateSmartFee(int confTarget, FeeCalculation* feeCalc, bool conservative) const
+{
+    AssertLockHeld(m_cs_fee_estimator);
+
     if (feeCalc) {
         feeCalc->desiredTarget = confTarget;
         feeCalc->returnedTarget = confTarget;
@@ -965,9 +1037,9 @@ bool CBlockPolicyEstimator::Read(AutoFile& filein)
                 throw std::runtime_error("Corrupt estimates file. Must have between 2 and 1000 feerate buckets");
             }
 
-            std::unique_ptr<TxConfirmStats> fileFeeStats(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, MED_DECAY, MED_SCALE));
-            std::unique_ptr<TxConfirmStats> fileShortStats(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, SHORT_DECAY, SHORT_SCALE));
-            std::unique_ptr<TxConfirmStats> fileLongStats(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, LONG_DECAY, LONG_SCALE));
+            std::unique_ptr<TxConfirmStats> fileFeeStats(new TxConfirmStats(buckets, bucketMap, MED_BLOCK_PERIODS, m_med_decay, MED_SCALE));
+            std::unique_ptr<TxConfirmStats> fileShortStats(new TxConfirmStats(buckets, bucketMap, SHORT_BLOCK_PERIODS, m_short_decay, SHORT_SCALE));
+            std::unique_ptr<TxConfirmStats> fileLongStats(new TxConfirmStats(buckets, bucketMap, LONG_BLOCK_PERIODS, m_long_decay, LONG_SCALE));
             fileFeeStats->Read(filein, nVersionThatWrote, numBuckets);
             fileShortStats->Read(filein, nVersionThatWrote, numBuckets);
             fileLongStats->Read(filein, nVersionThatWrote, numBuckets);
@@ -988,6 +1060,7 @@ bool CBlockPolicyEstimator::Read(AutoFile& filein)
             nBestSeenHeight = nFileBestSeenHeight;
             historicalFirst = nFileHistoricalFirst;
             historicalBest = nFileHistoricalBest;
+            m_smart_fee_cache.clear();
         }
     }
     catch (const std::exception& e) {
@@ -1006,6 +1079,7 @@ void CBlockPolicyEstimator::FlushUnconfirmed() {
         auto mi = mapMemPoolTxs.begin();
         _removeTx(mi->first, false); // this calls erase() on mapMemPoolTxs
     }
+    m_smart_fee_cache.clear();
     int64_t endclear = GetTimeMicros();
     LogPrint(BCLog::ESTIMATEFEE, "Recorded %u unconfirmed txs from mempool in %gs\n", num_entries, (endclear - startclear)*0.000001);
 }
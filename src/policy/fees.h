@@ -14,10 +14,12 @@
 #include <uint256.h>
 
 #include <array>
+#include <chrono>
 #include <map>
 #include <memory>
 #include <set>
 #include <string>
+#include <utility>
 #include <vector>
 
 class AutoFile;
@@ -144,12 +146,13 @@ private:
     /** Historical estimates that are older than this aren't valid */
     static const unsigned int OLDEST_ESTIMATE_HISTORY = 6 * 1008;
 
-    /** Decay of .962 is a half-life of 18 blocks or about 3 hours */
-    static constexpr double SHORT_DECAY = .962;
-    /** Decay of .9952 is a half-life of 144 blocks or about 1 day */
-    static constexpr double MED_DECAY = .9952;
-    /** Decay of .99931 is a half-life of 1008 blocks or about 1 week */
-    static constexpr double LONG_DECAY = .99931;
+    /** Half-lives of the moving averages. The decay per block is derived from
+     * these and the block spacing, so that a horizon covers the same time on
+     * chains with shorter blocks. With 10 minute blocks they give decays
+     * of .962, .9952 and .99931. */
+    static constexpr std::chrono::hours SHORT_HALFLIFE_TIME{3};
+    static constexpr std::chrono::hours MED_HALFLIFE_TIME{24};
+    static constexpr std::chrono::hours LONG_HALFLIFE_TIME{24 * 7};
 
     /** Require greater than 60% of X feerate transactions to be confirmed within Y/2 blocks*/
     static constexpr double HALF_SUCCESS_PCT = .6;
@@ -181,9 +184,16 @@ private:
     static constexpr double FEE_SPACING = 1.05;
 
     const fs::path m_estimation_filepath;
+
+    /** Decay per block of the short, medium and long horizons */
+    const double m_short_decay;
+    const double m_med_decay;
+    const double m_long_decay;
 public:
-    /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values */
-    CBlockPolicyEstimator(const fs::path& estimation_filepath);
+    /** Create new BlockPolicyEstimator and initialize stats tracking classes with default values
+     * @param block_spacing the expected time between blocks, used to derive the decays
+     */
+    CBlockPolicyEstimator(const fs::path& estimation_filepath, std::chrono::seconds block_spacing);
     ~CBlockPolicyEstimator();
 
     /** Process all the transactions that have been included in a block */
@@ -211,6 +221,12 @@ public:
     CFeeRate estimateSmartFee(int confTarget, FeeCalculation *feeCalc, bool conservative) const
         EXCLUSIVE_LOCKS_REQUIRED(!m_cs_fee_estimator);
 
+    /** Estimate feerates as estimateSmartFee does for every target from 1 to
+     *  max_target, taking the lock only once. Entry i is for target i + 1.
+     */
+    std::vector<std::pair<CFeeRate, FeeCalculation>> estimateSmartFeeCurve(int max_target, bool conservative) const
+        EXCLUSIVE_LOCKS_REQUIRED(!m_cs_fee_estimator);
+
     /** Return a specific fee estimate calculation with a given success
      * threshold and time horizon, and optionally return detailed data about
      * calculation
@@ -268,9 +284,14 @@ private:
     std::vector<double> buckets GUARDED_BY(m_cs_fee_estimator); // The upper-bound of the range for the bucket (inclusive)
     std::map<double, unsigned int> bucketMap GUARDED_BY(m_cs_fee_estimator); // Map of bucket upper-bound to index into all vectors by bucket
 
+    /** Smart fee estimates by target and conservativeness, valid until the next block */
+    mutable std::map<std::pair<int, bool>, std::pair<CFeeRate, FeeCalculation>> m_smart_fee_cache GUARDED_BY(m_cs_fee_estimator);
+
     /** Process a transaction confirmed in a block*/
     bool processBlockTx(unsigned int nBlockHeight, const CTxMemPoolEntry* entry) EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
 
+    /** Helper for estimateSmartFee */
+    CFeeRate _estimateSmartFee(int confTarget, FeeCalculation* feeCalc, bool conservative) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
     double estimateCombinedFee(unsigned int confTarget, double successThreshold, bool checkShorterHorizon, EstimationResult *result) const EXCLUSIVE_LOCKS_REQUIRED(m_cs_fee_estimator);
     /** Helper for estimateSmartFee */
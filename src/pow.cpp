@@ -9,28 +9,51 @@
 #include <primitives/block.h>
 #include <uint256.h>
 
-static const int64_t DIFFICULTY_ADJUST_WINDOW = 60;
+static arith_uint256 BitsToArith256(uint32_t bits)
+{
+    arith_uint256 value;
+    value.SetCompact(bits);
+    return value;
+}
 
-unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
+/** Sum the targets of block and its predecessors in the difficulty window by walking the chain. */
+static arith_uint256 SumTargetWindow(const CBlockIndex& block)
 {
-    if (params.fPowAllowMinDifficultyBlocks)
-        return UintToArith256(params.powLimit).GetCompact();
+    arith_uint256 sum;
+    int64_t count = 0;
+    for (auto p = &block; p && count < DIFFICULTY_ADJUST_WINDOW; p = p->pprev, ++count) {
+        sum += BitsToArith256(p->nBits);
+    }
+    return sum;
+}
 
-    assert(pindexLast != nullptr);
-    const auto BitsToArith256 = [](uint32_t bits){
-        arith_uint256 value;
-        value.SetCompact(bits);
-        return value;
-    };
+arith_uint256 GetTargetWindowSum(const CBlockIndex& block)
+{
+    const CBlockIndex* pprev = block.pprev;
+    // Without state to extend (genesis, or an index that was built by hand), sum the window directly.
+    if (pprev == nullptr || pprev->nTargetWindowSum == 0) return SumTargetWindow(block);
+
+    arith_uint256 sum = pprev->nTargetWindowSum + BitsToArith256(block.nBits);
+    if (block.nHeight >= DIFFICULTY_ADJUST_WINDOW) {
+        // The sum is exact modulo 2^256, so dropping the oldest target is a plain subtraction.
+        const CBlockIndex* oldest = pprev->GetAncestor(block.nHeight - DIFFICULTY_ADJUST_WINDOW);
+        if (oldest == nullptr) return SumTargetWindow(block);
+        sum -= BitsToArith256(oldest->nBits);
+    }
+    return sum;
+}
 
+/**
+ * Compute the next target from the (timestamp, target) pairs of the last up to
+ * DIFFICULTY_ADJUST_WINDOW blocks, newest first. Near genesis, the window is
+ * filled up with simulated blocks based on the oldest real ones.
+ */
+static unsigned int CalculateNextWorkRequiredPadded(std::vector<std::pair<int64_t, arith_uint256>> past_data, const Consensus::Params& params)
+{
     const size_t needed_block_count = DIFFICULTY_ADJUST_WINDOW;
-    std::vector<std::pair<int64_t, arith_uint256>> past_data;
-    past_data.reserve(needed_block_count);
-    for (auto p = pindexLast; p; p = p->pprev) {
-        past_data.emplace_back(p->GetBlockTime(), BitsToArith256(p->nBits));
-        if (past_data.size() == needed_block_count)
-            return CalculateNextWorkRequired(past_data, params);
-    }
+    assert(!past_data.empty() && past_data.size() <= needed_block_count);
+    if (past_data.size() == needed_block_count)
+        return CalculateNextWorkRequired(past_data, params);
 
     const auto last_ts_delta = past_data.size() > 2 ?
         past_data.front().first - past_data.at(1).first :
@@ -48,23 +71,52 @@ unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHead
     return CalculateNextWorkRequired(past_data, params);
 }
 
+unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params& params)
+{
+    if (params.fPowAllowMinDifficultyBlocks)
+        return UintToArith256(params.powLimit).GetCompact();
+
+    assert(pindexLast != nullptr);
+
+    // Fast path: the window of pindexLast and its 59 predecessors is summed up in its block index entry.
+    if (pindexLast->nHeight >= DIFFICULTY_ADJUST_WINDOW - 1 && pindexLast->nTargetWindowSum != 0) {
+        const CBlockIndex* first = pindexLast->GetAncestor(pindexLast->nHeight - (DIFFICULTY_ADJUST_WINDOW - 1));
+        if (first != nullptr) {
+            if (params.fPowNoRetargeting)
+                return BitsToArith256(pindexLast->nBits).GetCompact();
+            return CalculateNextWorkRequired(pindexLast->nTargetWindowSum, pindexLast->GetBlockTime() - first->GetBlockTime(), params);
+        }
+    }
+
+    std::vector<std::pair<int64_t, arith_uint256>> past_data;
+    past_data.reserve(DIFFICULTY_ADJUST_WINDOW);
+    for (auto p = pindexLast; p && past_data.size() < size_t{DIFFICULTY_ADJUST_WINDOW}; p = p->pprev) {
+        past_data.emplace_back(p->GetBlockTime(), BitsToArith256(p->nBits));
+    }
+    return CalculateNextWorkRequiredPadded(std::move(past_data), params);
+}
+
 unsigned int CalculateNextWorkRequired(const std::vector<std::pair<int64_t, arith_uint256>>& past_data, const Consensus::Params& params)
 {
     if (params.fPowNoRetargeting)
         return past_data.front().second.GetCompact();
 
+    arith_uint256 target_sum;
+    for (const auto& data: past_data)
+        target_sum += data.second;
+    return CalculateNextWorkRequired(target_sum, past_data.front().first - past_data.back().first, params);
+}
 
+unsigned int CalculateNextWorkRequired(const arith_uint256& target_sum, int64_t ts_delta, const Consensus::Params& params)
+{
     const int64_t DAMP_FACTOR = 3;
     const auto BLOCK_TIME_WINDOW = (DIFFICULTY_ADJUST_WINDOW - 1) * params.nPowTargetSpacing;
     const auto UPPER_TIME_BOUND = BLOCK_TIME_WINDOW * 2;
     const auto LOWER_TIME_BOUND = BLOCK_TIME_WINDOW / 2;
 
     const arith_uint256 bnPowLimit = UintToArith256(params.powLimit);
-    arith_uint256 targetAvg;
-    for (const auto& data: past_data)
-        targetAvg += data.second;
+    arith_uint256 targetAvg = target_sum;
     targetAvg /= DIFFICULTY_ADJUST_WINDOW;
-    const auto ts_delta = past_data.front().first - past_data.back().first;
     const auto ts_damp = DAMP_FACTOR * targetAvg > bnPowLimit ?
         ts_delta :
         (ts_delta + (DAMP_FACTOR - 1) * BLOCK_TIME_WINDOW) / DAMP_FACTOR;
@@ -74,6 +126,56 @@ unsigned int CalculateNextWorkRequired(const std::vector<std::pair<int64_t, arit
     return target > bnPowLimit ? bnPowLimit.GetCompact() : target.GetCompact();
 }
 
+DifficultyWindow::DifficultyWindow(const CBlockIndex& tip)
+{
+    std::array<const CBlockIndex*, DIFFICULTY_ADJUST_WINDOW> blocks;
+    size_t count = 0;
+    for (auto p = &tip; p && count < blocks.size(); p = p->pprev) {
+        blocks[count++] = p;
+    }
+    // oldest first
+    while (count > 0) {
+        const CBlockIndex* block = blocks[--count];
+        Push(block->nTime, block->nBits);
+    }
+}
+
+void DifficultyWindow::Push(uint32_t time, uint32_t bits)
+{
+    m_newest = (m_newest + 1) % DIFFICULTY_ADJUST_WINDOW;
+    if (m_count == DIFFICULTY_ADJUST_WINDOW) {
+        // m_newest now points at the oldest entry, which drops out of the window
+        m_target_sum -= BitsToArith256(m_bits[m_newest]);
+    } else {
+        ++m_count;
+    }
+    m_times[m_newest] = time;
+    m_bits[m_newest] = bits;
+    m_target_sum += BitsToArith256(bits);
+}
+
+unsigned int DifficultyWindow::GetNextWorkRequired(const Consensus::Params& params) const
+{
+    if (params.fPowAllowMinDifficultyBlocks)
+        return UintToArith256(params.powLimit).GetCompact();
+
+    assert(m_count > 0);
+    if (m_count == DIFFICULTY_ADJUST_WINDOW) {
+        if (params.fPowNoRetargeting)
+            return BitsToArith256(m_bits[m_newest]).GetCompact();
+        const size_t oldest = (m_newest + 1) % DIFFICULTY_ADJUST_WINDOW;
+        return CalculateNextWorkRequired(m_target_sum, int64_t{m_times[m_newest]} - int64_t{m_times[oldest]}, params);
+    }
+
+    std::vector<std::pair<int64_t, arith_uint256>> past_data;
+    past_data.reserve(DIFFICULTY_ADJUST_WINDOW);
+    for (size_t i = 0; i < m_count; ++i) {
+        const size_t pos = (m_newest + DIFFICULTY_ADJUST_WINDOW - i) % DIFFICULTY_ADJUST_WINDOW;
+        past_data.emplace_back(m_times[pos], BitsToArith256(m_bits[pos]));
+    }
+    return CalculateNextWorkRequiredPadded(std::move(past_data), params);
+}
+
 // Check that on difficulty adjustments, the new difficulty does not increase
 // or decrease beyond the permitted limits.
 bool PermittedDifficultyTransition(const Consensus::Params& params, int64_t height, uint32_t old_nbits, uint32_t new_nbits)
@@ -131,6 +233,9 @@ bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&
     bool fOverflow;
     arith_uint256 bnTarget;
 
+    // The genesis block is mined for NeoScrypt, and its SHA256d hash is its block hash
+    if (params.fPowSha256d && hash == params.hashGenesisBlock) return true;
+
     bnTarget.SetCompact(nBits, &fNegative, &fOverflow);
 
     // Check range
@@ -9,14 +9,61 @@
 #include <arith_uint256.h>
 #include <consensus/params.h>
 
+#include <array>
 #include <stdint.h>
 
 class CBlockHeader;
 class CBlockIndex;
 class uint256;
 
+/** Number of blocks whose targets are averaged by the difficulty adjustment */
+static constexpr int64_t DIFFICULTY_ADJUST_WINDOW{60};
+
 unsigned int GetNextWorkRequired(const CBlockIndex* pindexLast, const CBlockHeader *pblock, const Consensus::Params&);
 unsigned int CalculateNextWorkRequired(const std::vector<std::pair<int64_t, arith_uint256>>& past_data, const Consensus::Params&);
+/**
+ * Compute the next target from the sum of the targets in the difficulty window
+ * and the time between its first and last block. Unlike the overload above,
+ * this does not handle fPowNoRetargeting.
+ */
+unsigned int CalculateNextWorkRequired(const arith_uint256& target_sum, int64_t ts_delta, const Consensus::Params&);
+
+/**
+ * Return the sum of the targets of block and its predecessors in the
+ * difficulty window, to be stored in CBlockIndex::nTargetWindowSum. This is
+ * O(1) when the predecessor already has its sum set, and lets
+ * GetNextWorkRequired() skip walking the window.
+ */
+arith_uint256 GetTargetWindowSum(const CBlockIndex& block);
+
+/**
+ * Timestamps and nBits of the last DIFFICULTY_ADJUST_WINDOW headers of a chain
+ * in a fixed-size ring buffer, plus the running sum of their targets. This
+ * gives the nBits required of the next header in O(1) for headers that are not
+ * in the block index, e.g. during headers presync, with the same result as
+ * GetNextWorkRequired().
+ */
+class DifficultyWindow
+{
+private:
+    std::array<uint32_t, DIFFICULTY_ADJUST_WINDOW> m_times{};
+    std::array<uint32_t, DIFFICULTY_ADJUST_WINDOW> m_bits{};
+    //! Number of headers in the window, at most DIFFICULTY_ADJUST_WINDOW
+    size_t m_count{0};
+    //! Position of the newest header in the ring buffer
+    size_t m_newest{0};
+    arith_uint256 m_target_sum;
+
+public:
+    /** Load the window that ends at the given block index entry. */
+    explicit DifficultyWindow(const CBlockIndex& tip);
+
+    /** Append the next header of the chain. */
+    void Push(uint32_t time, uint32_t bits);
+
+    /** Return the nBits the next header must have. */
+    unsigned int GetNextWorkRequired(const Consensus::Params& params) const;
+};
 
 /** Check whether a block hash satisfies the proof-of-work requirement specified by nBits */
 bool CheckProofOfWork(uint256 hash, unsigned int nBits, const Consensus::Params&);
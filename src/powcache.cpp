@@ -0,0 +1,150 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <powcache.h>
+
+#include <logging.h>
+#include <memusage.h>
+#include <primitives/block.h>
+#include <sync.h>
+#include <util/hasher.h>
+
+#include <atomic>
+#include <cstring>
+#include <vector>
+
+namespace {
+/**
+ * Direct-mapped table of block hash -> NeoScrypt hash. The slot of an entry
+ * is chosen with a salted SipHash of the block hash, so peers cannot craft
+ * headers that keep evicting each other. A colliding insert simply replaces
+ * the previous occupant, which keeps the memory usage fixed.
+ */
+class PoWHashCache
+{
+private:
+    struct Entry {
+        uint256 block_hash;
+        uint256 pow_hash;
+    };
+
+    const SaltedTxidHasher m_hasher;
+    mutable Mutex m_mutex;
+    std::vector<Entry> m_table GUARDED_BY(m_mutex);
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+
+    size_t Slot(const uint256& block_hash) const EXCLUSIVE_LOCKS_REQUIRED(m_mutex)
+    {
+        // m_table.size() is a power of two
+        return m_hasher(block_hash) & (m_table.size() - 1);
+    }
+
+public:
+    size_t Setup(size_t max_size_bytes) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        size_t num_entries{0};
+        const size_t max_entries{max_size_bytes / sizeof(Entry)};
+        if (max_entries > 0) {
+            num_entries = 1;
+            while (num_entries <= max_entries / 2) num_entries *= 2;
+        }
+        LOCK(m_mutex);
+        m_table.assign(num_entries, Entry{});
+        m_hits = 0;
+        m_misses = 0;
+        return num_entries;
+    }
+
+    bool Get(const uint256& block_hash, uint256& pow_hash) const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_table.empty()) return false;
+        const Entry& entry{m_table[Slot(block_hash)]};
+        if (entry.block_hash != block_hash) return false;
+        pow_hash = entry.pow_hash;
+        return true;
+    }
+
+    void Set(const uint256& block_hash, const uint256& pow_hash) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_table.empty()) return;
+        m_table[Slot(block_hash)] = Entry{block_hash, pow_hash};
+    }
+
+    void RecordLookup(bool hit)
+    {
+        ++(hit ? m_hits : m_misses);
+    }
+
+    PoWHashCacheStats Stats() const EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        PoWHashCacheStats stats;
+        stats.hits = m_hits;
+        stats.misses = m_misses;
+        LOCK(m_mutex);
+        stats.capacity = m_table.size();
+        stats.memory_usage = memusage::DynamicUsage(m_table);
+        return stats;
+    }
+};
+
+static PoWHashCache g_pow_hash_cache;
+} // namespace
+
+bool InitPoWHashCache(size_t max_size_bytes)
+{
+    const size_t num_entries{g_pow_hash_cache.Setup(max_size_bytes)};
+    LogPrintf("Using %zu MiB out of %zu MiB requested for proof-of-work hash cache, able to store %zu elements\n",
+              (num_entries * 2 * sizeof(uint256)) >> 20, max_size_bytes >> 20, num_entries);
+    return true;
+}
+
+uint256 GetPoWHashCached(const CBlockHeader& header)
+{
+    const uint256 block_hash{header.GetHash()};
+    uint256 pow_hash;
+    if (g_pow_hash_cache.Get(block_hash, pow_hash)) {
+        g_pow_hash_cache.RecordLookup(/*hit=*/true);
+        return pow_hash;
+    }
+    g_pow_hash_cache.RecordLookup(/*hit=*/false);
+    pow_hash = header.GetPoWHash();
+    g_pow_hash_cache.Set(block_hash, pow_hash);
+    return pow_hash;
+}
+
+void GetPoWHashesCached(const CBlockHeader* headers, size_t count, uint256* pow_hashes)
+{
+    // The NeoScrypt input is the 80-byte serialized header, see CBlockHeader::GetPoWHash()
+    static constexpr size_t HEADER_SIZE{80};
+    std::vector<uint256> block_hashes;
+    std::vector<size_t> missing;
+    std::vector<unsigned char> input;
+    block_hashes.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        block_hashes.push_back(headers[i].GetHash());
+        const bool hit{g_pow_hash_cache.Get(block_hashes.back(), pow_hashes[i])};
+        g_pow_hash_cache.RecordLookup(hit);
+        if (hit) continue;
+        missing.push_back(i);
+        const auto* begin{reinterpret_cast<const unsigned char*>(&headers[i].nVersion)};
+        input.insert(input.end(), begin, begin + HEADER_SIZE);
+    }
+    if (missing.empty()) return;
+
+    std::vector<unsigned char> output(missing.size() * uint256::size());
+    PoWHashMany(output.data(), input.data(), missing.size());
+    for (size_t j = 0; j < missing.size(); ++j) {
+        const size_t i{missing[j]};
+        std::memcpy(pow_hashes[i].begin(), output.data() + j * uint256::size(), uint256::size());
+        g_pow_hash_cache.Set(block_hashes[i], pow_hashes[i]);
+    }
+}
+
+PoWHashCacheStats GetPoWHashCacheStats()
+{
+    return g_pow_hash_cache.Stats();
+}
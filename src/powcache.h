@@ -0,0 +1,56 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_POWCACHE_H
+#define BITCOIN_POWCACHE_H
+
+#include <uint256.h>
+
+#include <cstddef>
+#include <cstdint>
+
+class CBlockHeader;
+
+//! Default size of the proof-of-work hash cache: 4MiB, or 65536 entries.
+static constexpr size_t DEFAULT_MAX_POW_CACHE_BYTES{4 << 20};
+
+struct PoWHashCacheStats {
+    //! Number of lookups answered from the cache
+    uint64_t hits{0};
+    //! Number of lookups that required a NeoScrypt computation
+    uint64_t misses{0};
+    //! Number of slots in the cache
+    size_t capacity{0};
+    //! Bytes allocated for the slots
+    size_t memory_usage{0};
+};
+
+/**
+ * Allocate the proof-of-work hash cache with room for at most max_size_bytes
+ * worth of entries. A size of zero disables the cache. To be called once in
+ * AppInitMain/BasicTestingSetup.
+ */
+[[nodiscard]] bool InitPoWHashCache(size_t max_size_bytes);
+
+/**
+ * Return the NeoScrypt proof-of-work hash of a header.
+ *
+ * Results are kept in a bounded, salted cache keyed by the block hash, which
+ * is shared by headers sync, block validation and block reads from disk, so
+ * the memory-hard hash of a given header is computed only once. Callers that
+ * hash short-lived candidate headers (e.g. mining) should use
+ * CBlockHeader::GetPoWHash() directly instead of polluting the cache.
+ */
+uint256 GetPoWHashCached(const CBlockHeader& header);
+
+/**
+ * Batch version of GetPoWHashCached(): write the proof-of-work hashes of
+ * headers[0..count) to pow_hashes[0..count). Headers missing from the cache
+ * are hashed together with the multi-buffer NeoScrypt implementation.
+ */
+void GetPoWHashesCached(const CBlockHeader* headers, size_t count, uint256* pow_hashes);
+
+PoWHashCacheStats GetPoWHashCacheStats();
+
+#endif // BITCOIN_POWCACHE_H
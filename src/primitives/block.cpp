@@ -6,25 +6,51 @@
 #include <primitives/block.h>
 
 #include <hash.h>
-#include <crypto/neoscrypt.h>
+#include <crypto/neoscrypt_context.h>
+#include <crypto/neoscrypt_multiway.h>
 #include <tinyformat.h>
 #include <crypto/common.h>
 #include <util/system.h>
+#include <util/time.h>
+#include <util/trace.h>
 
 uint256 CBlockHeader::GetHash() const
 {
     return SerializeHash(*this);
 }
 
+bool g_pow_hash_sha256d{false};
+
 uint256 CBlockHeader::GetPoWHash() const
 {
+    if (g_pow_hash_sha256d) return GetHash();
+
     uint256 hash;
 
-    neoscrypt((unsigned char *) &nVersion, (unsigned char *) &hash, nNeoScryptOptions);
+    const auto time_start{SteadyClock::now()};
+    NeoScryptThreadContext().Hash((const unsigned char*)&nVersion, hash.begin(), nNeoScryptOptions);
+
+    TRACE3(pow, neoscrypt_hash,
+        hash.data(),
+        nNeoScryptOptions,
+        Ticks<std::chrono::microseconds>(SteadyClock::now() - time_start)
+    );
 
     return(hash);
 }
 
+void PoWHashMany(unsigned char* output, const unsigned char* input, size_t count)
+{
+    static constexpr size_t HEADER_SIZE{80};
+    if (!g_pow_hash_sha256d) {
+        NeoScryptMany(output, input, count);
+        return;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        CHash256().Write({input + i * HEADER_SIZE, HEADER_SIZE}).Finalize({output + i * CHash256::OUTPUT_SIZE, CHash256::OUTPUT_SIZE});
+    }
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -11,6 +11,8 @@
 #include <uint256.h>
 #include <util/time.h>
 
+#include <cstddef>
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -66,6 +68,16 @@ public:
 };
 
 
+/**
+ * Whether CBlockHeader::GetPoWHash() and PoWHashMany() return the SHA256d
+ * block hash instead of NeoScrypt. Set by SelectParams() from
+ * Consensus::Params::fPowSha256d, so only regtest can enable it.
+ */
+extern bool g_pow_hash_sha256d;
+
+/** Compute the proof-of-work hashes of count 80-byte serialized headers, as CBlockHeader::GetPoWHash() does. */
+void PoWHashMany(unsigned char* output, const unsigned char* input, size_t count);
+
 class CBlock : public CBlockHeader
 {
 public:
@@ -86,10 +98,17 @@ public:
         *(static_cast<CBlockHeader*>(this)) = header;
     }
 
-    SERIALIZE_METHODS(CBlock, obj)
+    template <typename Stream>
+    void Serialize(Stream& s) const
+    {
+        s << static_cast<const CBlockHeader&>(*this) << vtx;
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream& s)
     {
-        READWRITEAS(CBlockHeader, obj);
-        READWRITE(obj.vtx);
+        s >> static_cast<CBlockHeader&>(*this);
+        UnserializeTransactions(s, vtx);
     }
 
     void SetNull()
@@ -6,9 +6,11 @@
 #include <primitives/transaction.h>
 
 #include <consensus/amount.h>
+#include <crypto/sha256.h>
 #include <hash.h>
 #include <script/script.h>
 #include <serialize.h>
+#include <streams.h>
 #include <tinyformat.h>
 #include <uint256.h>
 #include <util/strencodings.h>
@@ -70,21 +72,136 @@ uint256 CMutableTransaction::GetHash() const
     return SerializeHash(*this, SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
 }
 
-uint256 CTransaction::ComputeHash() const
+namespace {
+/**
+ * Stream writing the witness serialization of a transaction into the wtxid
+ * hasher, and all but its witness parts into the txid hasher, counting the
+ * bytes of both. Without witness data only the txid is hashed.
+ */
+class TxHashWriter
 {
-    return SerializeHash(*this, SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS);
-}
+    const bool m_has_witness;
+    CHash256 m_txid;
+    CHash256 m_wtxid;
+    uint32_t m_stripped_size{0};
+    uint32_t m_total_size{0};
+
+public:
+    //! Whether the bytes written now belong to the witness serialization only
+    bool m_witness_only{false};
+
+    explicit TxHashWriter(bool has_witness) : m_has_witness{has_witness} {}
+
+    int GetType() const { return SER_GETHASH; }
+    int GetVersion() const { return 0; }
+
+    void write(Span<const std::byte> src)
+    {
+        if (m_has_witness) m_wtxid.Write(UCharSpanCast(src));
+        m_total_size += src.size();
+        if (!m_witness_only) {
+            m_txid.Write(UCharSpanCast(src));
+            m_stripped_size += src.size();
+        }
+    }
 
-uint256 CTransaction::ComputeWitnessHash() const
+    template <typename T>
+    TxHashWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+
+    template <typename Digest>
+    Digest GetDigest()
+    {
+        Digest digest;
+        m_txid.Finalize(digest.hash);
+        if (m_has_witness) {
+            m_wtxid.Finalize(digest.witness_hash);
+        } else {
+            digest.witness_hash = digest.hash;
+        }
+        digest.stripped_size = m_stripped_size;
+        digest.total_size = m_total_size;
+        return digest;
+    }
+};
+} // namespace
+
+CTransaction::Digest CTransaction::ComputeDigest(const CMutableTransaction& tx)
 {
-    if (!HasWitness()) {
-        return hash;
+    if (!tx.HasWitness()) {
+        TxHashWriter writer{/*has_witness=*/false};
+        writer << tx.nVersion << tx.vin << tx.vout << tx.nLockTime;
+        return writer.GetDigest<Digest>();
+    }
+    // Same layout as SerializeTransaction() with witness data, where the
+    // marker, flags and witnesses are left out of the txid
+    TxHashWriter writer{/*has_witness=*/true};
+    writer << tx.nVersion;
+    writer.m_witness_only = true;
+    writer << std::vector<CTxIn>{} << uint8_t{1};
+    writer.m_witness_only = false;
+    writer << tx.vin << tx.vout;
+    writer.m_witness_only = true;
+    for (const CTxIn& txin : tx.vin) {
+        writer << txin.scriptWitness.stack;
     }
-    return SerializeHash(*this, SER_GETHASH, 0);
+    writer.m_witness_only = false;
+    writer << tx.nLockTime;
+    return writer.GetDigest<Digest>();
 }
 
-CTransaction::CTransaction(const CMutableTransaction& tx) : vin(tx.vin), vout(tx.vout), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
-CTransaction::CTransaction(CMutableTransaction&& tx) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{ComputeHash()}, m_witness_hash{ComputeWitnessHash()} {}
+CTransaction::CTransaction(const CMutableTransaction& tx) : CTransaction(CMutableTransaction{tx}) {}
+CTransaction::CTransaction(CMutableTransaction&& tx) : CTransaction(std::move(tx), ComputeDigest(tx)) {}
+CTransaction::CTransaction(CMutableTransaction&& tx, const Digest& digest) : vin(std::move(tx.vin)), vout(std::move(tx.vout)), nVersion(tx.nVersion), nLockTime(tx.nLockTime), hash{digest.hash}, m_witness_hash{digest.witness_hash}, m_stripped_size{digest.stripped_size}, m_total_size{digest.total_size} {}
+
+/** Fewest transactions worth serializing up front to hash them with SHA256DMany(). */
+static constexpr size_t MIN_BATCH_HASH_TXS{8};
+
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs)
+{
+    std::vector<CTransactionRef> refs;
+    refs.reserve(txs.size());
+    if (txs.size() < MIN_BATCH_HASH_TXS || SHA256DManyLanes() == 1) {
+        for (CMutableTransaction& tx : txs) {
+            refs.push_back(MakeTransactionRef(std::move(tx)));
+        }
+        return refs;
+    }
+
+    // Serialize the txid preimages of all transactions, followed by the wtxid
+    // preimages of the ones with witnesses
+    std::vector<unsigned char> data;
+    std::vector<size_t> ends;
+    ends.reserve(2 * txs.size());
+    for (const CMutableTransaction& tx : txs) {
+        CVectorWriter{SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS, data, data.size(), tx};
+        ends.push_back(data.size());
+    }
+    for (const CMutableTransaction& tx : txs) {
+        if (!tx.HasWitness()) continue;
+        CVectorWriter{SER_GETHASH, 0, data, data.size(), tx};
+        ends.push_back(data.size());
+    }
+    std::vector<const unsigned char*> preimages(ends.size());
+    std::vector<size_t> lengths(ends.size());
+    for (size_t i = 0; i < ends.size(); ++i) {
+        const size_t begin{i ? ends[i - 1] : 0};
+        preimages[i] = data.data() + begin;
+        lengths[i] = ends[i] - begin;
+    }
+    std::vector<uint256> hashes(ends.size());
+    SHA256DMany(hashes[0].begin(), preimages.data(), lengths.data(), hashes.size());
+
+    size_t witness_hash{txs.size()};
+    for (size_t i = 0; i < txs.size(); ++i) {
+        const size_t witness{txs[i].HasWitness() ? witness_hash++ : i};
+        refs.emplace_back(new CTransaction(std::move(txs[i]), {hashes[i], hashes[witness], uint32_t(lengths[i]), uint32_t(lengths[witness])}));
+    }
+    return refs;
+}
 
 CAmount CTransaction::GetValueOut() const
 {
@@ -98,11 +215,6 @@ CAmount CTransaction::GetValueOut() const
     return nValueOut;
 }
 
-unsigned int CTransaction::GetTotalSize() const
-{
-    return ::GetSerializeSize(*this, PROTOCOL_VERSION);
-}
-
 std::string CTransaction::ToString() const
 {
     std::string str;
@@ -304,9 +304,25 @@ private:
     /** Memory only. */
     const uint256 hash;
     const uint256 m_witness_hash;
+    //! Serialized size without witness data
+    const uint32_t m_stripped_size;
+    //! Serialized size with witness data
+    const uint32_t m_total_size;
 
-    uint256 ComputeHash() const;
-    uint256 ComputeWitnessHash() const;
+    /** What is cached about a transaction when it is constructed. */
+    struct Digest {
+        uint256 hash;
+        uint256 witness_hash;
+        uint32_t stripped_size;
+        uint32_t total_size;
+    };
+
+    /** Compute the txid, the wtxid and the sizes of a transaction in a single serialization pass. */
+    static Digest ComputeDigest(const CMutableTransaction& tx);
+
+    CTransaction(CMutableTransaction&& tx, const Digest& digest);
+
+    friend std::vector<std::shared_ptr<const CTransaction>> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
 
 public:
     /** Convert a CMutableTransaction into a CTransaction. */
@@ -338,7 +354,13 @@ public:
      * "Total Size" defined in BIP141 and BIP144.
      * @return Total transaction size in bytes
      */
-    unsigned int GetTotalSize() const;
+    unsigned int GetTotalSize() const { return m_total_size; }
+
+    /**
+     * Get the transaction size in bytes without witness data.
+     * "Base Size" defined in BIP141.
+     */
+    unsigned int GetStrippedSize() const { return m_stripped_size; }
 
     bool IsCoinBase() const
     {
@@ -414,6 +436,22 @@ struct CMutableTransaction
 typedef std::shared_ptr<const CTransaction> CTransactionRef;
 template <typename Tx> static inline CTransactionRef MakeTransactionRef(Tx&& txIn) { return std::make_shared<const CTransaction>(std::forward<Tx>(txIn)); }
 
+/**
+ * Convert the transactions of a block into CTransactionRefs, computing all
+ * their txids and wtxids together with SHA256DMany() where it hashes several
+ * messages at once.
+ */
+std::vector<CTransactionRef> MakeTransactionRefs(std::vector<CMutableTransaction>&& txs);
+
+/** Read a vector of transactions, hashing them together through MakeTransactionRefs(). */
+template <typename Stream>
+void UnserializeTransactions(Stream& s, std::vector<CTransactionRef>& vtx)
+{
+    std::vector<CMutableTransaction> txs;
+    s >> txs;
+    vtx = MakeTransactionRefs(std::move(txs));
+}
+
 /** A generic txid reference (txid or wtxid). */
 class GenTxid
 {
@@ -258,6 +258,27 @@ extern const char* CFCHECKPT;
  * @since protocol version 70016 as described by BIP 339.
  */
 extern const char* WTXIDRELAY;
+/**
+ * Contains a 4-byte version number and an 8-byte salt.
+ * The salt is used to compute short txids needed for efficient
+ * txreconciliation, as described by BIP 330.
+ */
+extern const char* SENDTXRCNCL;
+/**
+ * Requests a reconciliation sketch from a peer, with the size of the local
+ * reconciliation set and the q coefficient, as described by BIP 330.
+ */
+extern const char* REQRECON;
+/**
+ * Contains a reconciliation sketch of the sender's reconciliation set, in
+ * response to a reqrecon message, as described by BIP 330.
+ */
+extern const char* SKETCH;
+/**
+ * Contains whether decoding the set difference succeeded, and the short
+ * txids of the transactions the sender wants announced, as described by BIP 330.
+ */
+extern const char* RECONCILDIFF;
 
 /**
  * Contains a checkpoint braodcasted by a central checkpointing node
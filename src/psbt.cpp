@@ -467,7 +467,7 @@ bool DecodeBase64PSBT(PartiallySignedTransaction& psbt, const std::string& base6
 
 bool DecodeRawPSBT(PartiallySignedTransaction& psbt, Span<const std::byte> tx_data, std::string& error)
 {
-    CDataStream ss_data(tx_data, SER_NETWORK, PROTOCOL_VERSION);
+    SpanReader ss_data{SER_NETWORK, PROTOCOL_VERSION, UCharSpanCast(tx_data)};
     try {
         ss_data >> psbt;
         if (!ss_data.empty()) {
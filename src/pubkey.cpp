@@ -211,6 +211,27 @@ bool XOnlyPubKey::VerifySchnorr(const uint256& msg, Span<const unsigned char> si
     return secp256k1_schnorrsig_verify(secp256k1_context_verify, sigbytes.data(), msg.begin(), 32, &pubkey);
 }
 
+bool VerifySchnorrBatch(Span<const SchnorrSignatureCheck> checks)
+{
+    if (checks.size() == 1) return checks[0].pubkey.VerifySchnorr(checks[0].msg, checks[0].sig);
+
+    std::vector<secp256k1_xonly_pubkey> pubkeys(checks.size());
+    std::vector<const secp256k1_xonly_pubkey*> pubkey_ptrs(checks.size());
+    std::vector<const unsigned char*> msg_ptrs(checks.size());
+    std::vector<const unsigned char*> sig_ptrs(checks.size());
+    for (size_t i = 0; i < checks.size(); ++i) {
+        if (!secp256k1_xonly_pubkey_parse(secp256k1_context_verify, &pubkeys[i], checks[i].pubkey.data())) return false;
+        pubkey_ptrs[i] = &pubkeys[i];
+        msg_ptrs[i] = checks[i].msg.begin();
+        sig_ptrs[i] = checks[i].sig.data();
+    }
+    // Room for the multi-scalar multiplication of two points per signature
+    secp256k1_scratch_space* scratch = secp256k1_scratch_space_create(secp256k1_context_verify, 1024 + 4096 * checks.size());
+    const int ret = secp256k1_schnorrsig_verify_batch(secp256k1_context_verify, scratch, sig_ptrs.data(), msg_ptrs.data(), pubkey_ptrs.data(), checks.size());
+    if (scratch != nullptr) secp256k1_scratch_space_destroy(secp256k1_context_verify, scratch);
+    return ret;
+}
+
 static const HashWriter HASHER_TAPTWEAK{TaggedHash("TapTweak")};
 
 uint256 XOnlyPubKey::ComputeTapTweakHash(const uint256* merkle_root) const
@@ -12,6 +12,7 @@
 #include <span.h>
 #include <uint256.h>
 
+#include <array>
 #include <cstring>
 #include <optional>
 #include <vector>
@@ -291,6 +292,18 @@ public:
     SERIALIZE_METHODS(XOnlyPubKey, obj) { READWRITE(obj.m_keydata); }
 };
 
+/** A 64-byte Schnorr signature with the message and public key it is to be verified against. */
+struct SchnorrSignatureCheck {
+    XOnlyPubKey pubkey;
+    uint256 msg;
+    std::array<unsigned char, 64> sig;
+};
+
+/** Verify a batch of Schnorr signatures at once, which is much faster than
+ *  XOnlyPubKey::VerifySchnorr for each of them. Returns false if any of them
+ *  is invalid, without telling which. */
+bool VerifySchnorrBatch(Span<const SchnorrSignatureCheck> checks);
+
 struct CExtPubKey {
     unsigned char version[4];
     unsigned char nDepth;
@@ -64,6 +64,8 @@ public:
     PeerTableModel *getPeerTableModel();
     PeerTableSortProxy* peerTableSortProxy();
     BanTableModel *getBanTableModel();
+    //! Thread the models poll the node on, so that polling doesn't disturb the main event loop
+    QThread* pollThread() const { return m_thread; }
 
     //! Return number of connections, default is in- and outbound (total)
     int getNumConnections(unsigned int flags = CONNECTIONS_ALL) const;
@@ -11,6 +11,7 @@
 
 #include <qt/addresstablemodel.h>
 #include <qt/bitcoinunits.h>
+#include <qt/coincontrolmodel.h>
 #include <qt/guiutil.h>
 #include <qt/optionsmodel.h>
 #include <qt/platformstyle.h>
@@ -27,21 +28,19 @@
 #include <QCheckBox>
 #include <QCursor>
 #include <QDialogButtonBox>
-#include <QFlags>
-#include <QIcon>
+#include <QHeaderView>
 #include <QSettings>
-#include <QTreeWidget>
+#include <QThread>
+#include <QTimer>
 
 using wallet::CCoinControl;
 
 QList<CAmount> CoinControlDialog::payAmounts;
 bool CoinControlDialog::fSubtractFeeFromAmount = false;
 
-bool CCoinControlWidgetItem::operator<(const QTreeWidgetItem &other) const {
-    int column = treeWidget()->sortColumn();
-    if (column == CoinControlDialog::COLUMN_AMOUNT || column == CoinControlDialog::COLUMN_DATE || column == CoinControlDialog::COLUMN_CONFIRMATIONS)
-        return data(column, Qt::UserRole).toLongLong() < other.data(column, Qt::UserRole).toLongLong();
-    return QTreeWidgetItem::operator<(other);
+static QString ColumnText(const QModelIndex& index, int column)
+{
+    return index.sibling(index.row(), column).data().toString();
 }
 
 CoinControlDialog::CoinControlDialog(CCoinControl& coin_control, WalletModel* _model, const PlatformStyle *_platformStyle, QWidget *parent) :
@@ -49,9 +48,17 @@ CoinControlDialog::CoinControlDialog(CCoinControl& coin_control, WalletModel* _m
     ui(new Ui::CoinControlDialog),
     m_coin_control(coin_control),
     model(_model),
+    m_coin_model(new CoinControlModel(coin_control, _model, _platformStyle, this)),
+    m_load_thread(new QThread(this)),
+    m_load_worker(new QObject),
     platformStyle(_platformStyle)
 {
     ui->setupUi(this);
+    ui->treeWidget->setModel(m_coin_model);
+
+    m_load_worker->moveToThread(m_load_thread);
+    connect(m_load_thread, &QThread::finished, m_load_worker, &QObject::deleteLater);
+    m_load_thread->start();
 
     // context menu
     contextMenu = new QMenu(this);
@@ -94,7 +101,7 @@ CoinControlDialog::CoinControlDialog(CCoinControl& coin_control, WalletModel* _m
     connect(ui->radioListMode, &QRadioButton::toggled, this, &CoinControlDialog::radioListMode);
 
     // click on checkbox
-    connect(ui->treeWidget, &QTreeWidget::itemChanged, this, &CoinControlDialog::viewItemChanged);
+    connect(m_coin_model, &CoinControlModel::selectionChanged, this, &CoinControlDialog::coinSelectionChanged);
 
     // click on header
     ui->treeWidget->header()->setSectionsClickable(true);
@@ -106,15 +113,15 @@ CoinControlDialog::CoinControlDialog(CCoinControl& coin_control, WalletModel* _m
     // (un)select all
     connect(ui->pushButtonSelectAll, &QPushButton::clicked, this, &CoinControlDialog::buttonSelectAllClicked);
 
-    ui->treeWidget->setColumnWidth(COLUMN_CHECKBOX, 84);
-    ui->treeWidget->setColumnWidth(COLUMN_AMOUNT, 110);
-    ui->treeWidget->setColumnWidth(COLUMN_LABEL, 190);
-    ui->treeWidget->setColumnWidth(COLUMN_ADDRESS, 320);
-    ui->treeWidget->setColumnWidth(COLUMN_DATE, 130);
-    ui->treeWidget->setColumnWidth(COLUMN_CONFIRMATIONS, 110);
+    ui->treeWidget->setColumnWidth(CoinControlModel::Checkbox, 84);
+    ui->treeWidget->setColumnWidth(CoinControlModel::Amount, 110);
+    ui->treeWidget->setColumnWidth(CoinControlModel::Label, 190);
+    ui->treeWidget->setColumnWidth(CoinControlModel::Address, 320);
+    ui->treeWidget->setColumnWidth(CoinControlModel::Date, 130);
+    ui->treeWidget->setColumnWidth(CoinControlModel::Confirmations, 110);
 
     // default view is sorted by amount desc
-    sortView(COLUMN_AMOUNT, Qt::DescendingOrder);
+    sortView(CoinControlModel::Amount, Qt::DescendingOrder);
 
     // restore list mode and sortorder as a convenience feature
     QSettings settings;
@@ -127,9 +134,9 @@ CoinControlDialog::CoinControlDialog(CCoinControl& coin_control, WalletModel* _m
 
     if(_model->getOptionsModel() && _model->getAddressTableModel())
     {
-        updateView();
         updateLabelLocked();
         CoinControlDialog::updateLabels(m_coin_control, _model, this);
+        loadCoins();
     }
 }
 
@@ -140,6 +147,9 @@ CoinControlDialog::~CoinControlDialog()
     settings.setValue("nCoinControlSortColumn", sortColumn);
     settings.setValue("nCoinControlSortOrder", (int)sortOrder);
 
+    m_load_thread->quit();
+    m_load_thread->wait();
+
     delete ui;
 }
 
@@ -153,47 +163,24 @@ void CoinControlDialog::buttonBoxClicked(QAbstractButton* button)
 // (un)select all
 void CoinControlDialog::buttonSelectAllClicked()
 {
-    Qt::CheckState state = Qt::Checked;
-    for (int i = 0; i < ui->treeWidget->topLevelItemCount(); i++)
-    {
-        if (ui->treeWidget->topLevelItem(i)->checkState(COLUMN_CHECKBOX) != Qt::Unchecked)
-        {
-            state = Qt::Unchecked;
-            break;
-        }
-    }
-    ui->treeWidget->setEnabled(false);
-    for (int i = 0; i < ui->treeWidget->topLevelItemCount(); i++)
-            if (ui->treeWidget->topLevelItem(i)->checkState(COLUMN_CHECKBOX) != state)
-                ui->treeWidget->topLevelItem(i)->setCheckState(COLUMN_CHECKBOX, state);
-    ui->treeWidget->setEnabled(true);
-    if (state == Qt::Unchecked)
-        m_coin_control.UnSelectAll(); // just to be sure
-    CoinControlDialog::updateLabels(m_coin_control, model, this);
+    // select all unless some coins are selected already
+    m_coin_model->selectAll(m_coin_model->getTotals().quantity == 0);
 }
 
 // context menu
 void CoinControlDialog::showMenu(const QPoint &point)
 {
-    QTreeWidgetItem *item = ui->treeWidget->itemAt(point);
-    if(item)
+    const QModelIndex index = ui->treeWidget->indexAt(point);
+    if (index.isValid())
     {
-        contextMenuItem = item;
+        contextMenuIndex = index;
 
         // disable some items (like Copy Transaction ID, lock, unlock) for tree roots in context menu
-        if (item->data(COLUMN_ADDRESS, TxHashRole).toString().length() == 64) // transaction hash is 64 characters (this means it is a child node, so it is not a parent node in tree mode)
+        if (const CoinControlCoin* coin = m_coin_model->coin(index)) // this means it is a child node, so it is not a parent node in tree mode
         {
             m_copy_transaction_outpoint_action->setEnabled(true);
-            if (model->wallet().isLockedCoin(COutPoint(uint256S(item->data(COLUMN_ADDRESS, TxHashRole).toString().toStdString()), item->data(COLUMN_ADDRESS, VOutRole).toUInt())))
-            {
-                lockAction->setEnabled(false);
-                unlockAction->setEnabled(true);
-            }
-            else
-            {
-                lockAction->setEnabled(true);
-                unlockAction->setEnabled(false);
-            }
+            lockAction->setEnabled(!coin->locked);
+            unlockAction->setEnabled(coin->locked);
         }
         else // this means click on parent node in tree mode -> disable all
         {
@@ -210,33 +197,35 @@ void CoinControlDialog::showMenu(const QPoint &point)
 // context menu action: copy amount
 void CoinControlDialog::copyAmount()
 {
-    GUIUtil::setClipboard(BitcoinUnits::removeSpaces(contextMenuItem->text(COLUMN_AMOUNT)));
+    GUIUtil::setClipboard(BitcoinUnits::removeSpaces(ColumnText(contextMenuIndex, CoinControlModel::Amount)));
 }
 
 // context menu action: copy label
 void CoinControlDialog::copyLabel()
 {
-    if (ui->radioTreeMode->isChecked() && contextMenuItem->text(COLUMN_LABEL).length() == 0 && contextMenuItem->parent())
-        GUIUtil::setClipboard(contextMenuItem->parent()->text(COLUMN_LABEL));
+    const QModelIndex index = contextMenuIndex;
+    if (ui->radioTreeMode->isChecked() && ColumnText(index, CoinControlModel::Label).length() == 0 && index.parent().isValid())
+        GUIUtil::setClipboard(ColumnText(index.parent(), CoinControlModel::Label));
     else
-        GUIUtil::setClipboard(contextMenuItem->text(COLUMN_LABEL));
+        GUIUtil::setClipboard(ColumnText(index, CoinControlModel::Label));
 }
 
 // context menu action: copy address
 void CoinControlDialog::copyAddress()
 {
-    if (ui->radioTreeMode->isChecked() && contextMenuItem->text(COLUMN_ADDRESS).length() == 0 && contextMenuItem->parent())
-        GUIUtil::setClipboard(contextMenuItem->parent()->text(COLUMN_ADDRESS));
+    const QModelIndex index = contextMenuIndex;
+    if (ui->radioTreeMode->isChecked() && ColumnText(index, CoinControlModel::Address).length() == 0 && index.parent().isValid())
+        GUIUtil::setClipboard(ColumnText(index.parent(), CoinControlModel::Address));
     else
-        GUIUtil::setClipboard(contextMenuItem->text(COLUMN_ADDRESS));
+        GUIUtil::setClipboard(ColumnText(index, CoinControlModel::Address));
 }
 
 // context menu action: copy transaction id and vout index
 void CoinControlDialog::copyTransactionOutpoint()
 {
-    const QString address = contextMenuItem->data(COLUMN_ADDRESS, TxHashRole).toString();
-    const QString vout = contextMenuItem->data(COLUMN_ADDRESS, VOutRole).toString();
-    const QString outpoint = QString("%1:%2").arg(address).arg(vout);
+    const CoinControlCoin* coin = m_coin_model->coin(contextMenuIndex);
+    if (!coin) return;
+    const QString outpoint = QString("%1:%2").arg(QString::fromStdString(coin->outpoint.hash.GetHex())).arg(coin->outpoint.n);
 
     GUIUtil::setClipboard(outpoint);
 }
@@ -244,23 +233,14 @@ void CoinControlDialog::copyTransactionOutpoint()
 // context menu action: lock coin
 void CoinControlDialog::lockCoin()
 {
-    if (contextMenuItem->checkState(COLUMN_CHECKBOX) == Qt::Checked)
-        contextMenuItem->setCheckState(COLUMN_CHECKBOX, Qt::Unchecked);
-
-    COutPoint outpt(uint256S(contextMenuItem->data(COLUMN_ADDRESS, TxHashRole).toString().toStdString()), contextMenuItem->data(COLUMN_ADDRESS, VOutRole).toUInt());
-    model->wallet().lockCoin(outpt, /* write_to_db = */ true);
-    contextMenuItem->setDisabled(true);
-    contextMenuItem->setIcon(COLUMN_CHECKBOX, platformStyle->SingleColorIcon(":/icons/lock_closed"));
+    m_coin_model->setLocked(contextMenuIndex, true);
     updateLabelLocked();
 }
 
 // context menu action: unlock coin
 void CoinControlDialog::unlockCoin()
 {
-    COutPoint outpt(uint256S(contextMenuItem->data(COLUMN_ADDRESS, TxHashRole).toString().toStdString()), contextMenuItem->data(COLUMN_ADDRESS, VOutRole).toUInt());
-    model->wallet().unlockCoin(outpt);
-    contextMenuItem->setDisabled(false);
-    contextMenuItem->setIcon(COLUMN_CHECKBOX, QIcon());
+    m_coin_model->setLocked(contextMenuIndex, false);
     updateLabelLocked();
 }
 
@@ -311,14 +291,14 @@ void CoinControlDialog::sortView(int column, Qt::SortOrder order)
 {
     sortColumn = column;
     sortOrder = order;
-    ui->treeWidget->sortItems(column, order);
+    m_coin_model->sort(column, order);
     ui->treeWidget->header()->setSortIndicator(sortColumn, sortOrder);
 }
 
 // treeview: clicked on header
 void CoinControlDialog::headerSectionClicked(int logicalIndex)
 {
-    if (logicalIndex == COLUMN_CHECKBOX) // click on most left column -> do nothing
+    if (logicalIndex == CoinControlModel::Checkbox) // click on most left column -> do nothing
     {
         ui->treeWidget->header()->setSortIndicator(sortColumn, sortOrder);
     }
@@ -329,7 +309,7 @@ void CoinControlDialog::headerSectionClicked(int logicalIndex)
         else
         {
             sortColumn = logicalIndex;
-            sortOrder = ((sortColumn == COLUMN_LABEL || sortColumn == COLUMN_ADDRESS) ? Qt::AscendingOrder : Qt::DescendingOrder); // if label or address then default => asc, else default => desc
+            sortOrder = ((sortColumn == CoinControlModel::Label || sortColumn == CoinControlModel::Address) ? Qt::AscendingOrder : Qt::DescendingOrder); // if label or address then default => asc, else default => desc
         }
 
         sortView(sortColumn, sortOrder);
@@ -350,24 +330,11 @@ void CoinControlDialog::radioListMode(bool checked)
         updateView();
 }
 
-// checkbox clicked by user
-void CoinControlDialog::viewItemChanged(QTreeWidgetItem* item, int column)
+// checkbox clicked by user, or (un)select all
+void CoinControlDialog::coinSelectionChanged()
 {
-    if (column == COLUMN_CHECKBOX && item->data(COLUMN_ADDRESS, TxHashRole).toString().length() == 64) // transaction hash is 64 characters (this means it is a child node, so it is not a parent node in tree mode)
-    {
-        COutPoint outpt(uint256S(item->data(COLUMN_ADDRESS, TxHashRole).toString().toStdString()), item->data(COLUMN_ADDRESS, VOutRole).toUInt());
-
-        if (item->checkState(COLUMN_CHECKBOX) == Qt::Unchecked)
-            m_coin_control.UnSelect(outpt);
-        else if (item->isDisabled()) // locked (this happens if "check all" through parent node)
-            item->setCheckState(COLUMN_CHECKBOX, Qt::Unchecked);
-        else
-            m_coin_control.Select(outpt);
-
-        // selection changed -> update labels
-        if (ui->treeWidget->isEnabled()) // do not update on every click for (un)select all
-            CoinControlDialog::updateLabels(m_coin_control, model, this);
-    }
+    // the model keeps the totals of the selected coins, so they are not looked up again
+    CoinControlDialog::updateLabels(m_coin_control, model, this, m_coin_model->getTotals());
 }
 
 // shows count of locked unspent outputs
@@ -384,6 +351,14 @@ void CoinControlDialog::updateLabelLocked()
 }
 
 void CoinControlDialog::updateLabels(CCoinControl& m_coin_control, WalletModel *model, QDialog* dialog)
+{
+    if (!model)
+        return;
+
+    updateLabels(m_coin_control, model, dialog, CoinControlModel::selectedTotals(m_coin_control, model->wallet()));
+}
+
+void CoinControlDialog::updateLabels(CCoinControl& m_coin_control, WalletModel *model, QDialog* dialog, const CoinControlTotals& totals)
 {
     if (!model)
         return;
@@ -403,59 +378,14 @@ void CoinControlDialog::updateLabels(CCoinControl& m_coin_control, WalletModel *
         }
     }
 
-    CAmount nAmount             = 0;
+    CAmount nAmount             = totals.amount;
     CAmount nPayFee             = 0;
     CAmount nAfterFee           = 0;
     CAmount nChange             = 0;
     unsigned int nBytes         = 0;
-    unsigned int nBytesInputs   = 0;
-    unsigned int nQuantity      = 0;
-    bool fWitness               = false;
-
-    std::vector<COutPoint> vCoinControl;
-    m_coin_control.ListSelected(vCoinControl);
-
-    size_t i = 0;
-    for (const auto& out : model->wallet().getCoins(vCoinControl)) {
-        if (out.depth_in_main_chain < 0) continue;
-
-        // unselect already spent, very unlikely scenario, this could happen
-        // when selected are spent elsewhere, like rpc or another computer
-        const COutPoint& outpt = vCoinControl[i++];
-        if (out.is_spent)
-        {
-            m_coin_control.UnSelect(outpt);
-            continue;
-        }
-
-        // Quantity
-        nQuantity++;
-
-        // Amount
-        nAmount += out.txout.nValue;
-
-        // Bytes
-        CTxDestination address;
-        int witnessversion = 0;
-        std::vector<unsigned char> witnessprogram;
-        if (out.txout.scriptPubKey.IsWitnessProgram(witnessversion, witnessprogram))
-        {
-            nBytesInputs += (32 + 4 + 1 + (107 / WITNESS_SCALE_FACTOR) + 4);
-            fWitness = true;
-        }
-        else if(ExtractDestination(out.txout.scriptPubKey, address))
-        {
-            CPubKey pubkey;
-            PKHash* pkhash = std::get_if<PKHash>(&address);
-            if (pkhash && model->wallet().getPubKey(out.txout.scriptPubKey, ToKeyID(*pkhash), pubkey))
-            {
-                nBytesInputs += (pubkey.IsCompressed() ? 148 : 180);
-            }
-            else
-                nBytesInputs += 148; // in all error cases, simply assume 148 here
-        }
-        else nBytesInputs += 148;
-    }
+    unsigned int nBytesInputs   = totals.input_bytes;
+    unsigned int nQuantity      = totals.quantity;
+    bool fWitness               = totals.witness_inputs > 0;
 
     // calculation
     if (nQuantity > 0)
@@ -571,139 +501,50 @@ void CoinControlDialog::updateLabels(CCoinControl& m_coin_control, WalletModel *
 void CoinControlDialog::changeEvent(QEvent* e)
 {
     if (e->type() == QEvent::PaletteChange) {
-        updateView();
+        // the lock icons follow the palette
+        ui->treeWidget->viewport()->update();
     }
 
     QDialog::changeEvent(e);
 }
 
+void CoinControlDialog::loadCoins()
+{
+    // the wallet is read on a thread of its own, so that the dialog shows at once even with very many coins
+    ui->treeWidget->setEnabled(false);
+    ui->pushButtonSelectAll->setEnabled(false);
+    interfaces::Wallet& wallet = model->wallet();
+    QTimer::singleShot(0, m_load_worker, [this, &wallet] {
+        std::vector<CoinControlGroup> groups{CoinControlModel::loadCoins(wallet)};
+        QMetaObject::invokeMethod(this, [this, groups = std::move(groups)]() mutable {
+            m_coin_model->setCoins(std::move(groups));
+            updateView();
+            ui->treeWidget->setEnabled(true);
+            ui->pushButtonSelectAll->setEnabled(true);
+        }, Qt::QueuedConnection);
+    });
+}
+
 void CoinControlDialog::updateView()
 {
-    if (!model || !model->getOptionsModel() || !model->getAddressTableModel())
+    if (!m_coin_model->isLoaded())
         return;
 
     bool treeMode = ui->radioTreeMode->isChecked();
 
-    ui->treeWidget->clear();
-    ui->treeWidget->setEnabled(false); // performance, otherwise updateLabels would be called for every checked checkbox
     ui->treeWidget->setAlternatingRowColors(!treeMode);
-    QFlags<Qt::ItemFlag> flgCheckbox = Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
-    QFlags<Qt::ItemFlag> flgTristate = Qt::ItemIsSelectable | Qt::ItemIsEnabled | Qt::ItemIsUserCheckable | Qt::ItemIsAutoTristate;
-
-    BitcoinUnit nDisplayUnit = model->getOptionsModel()->getDisplayUnit();
-
-    for (const auto& coins : model->wallet().listCoins()) {
-        CCoinControlWidgetItem* itemWalletAddress{nullptr};
-        QString sWalletAddress = QString::fromStdString(EncodeDestination(coins.first));
-        QString sWalletLabel = model->getAddressTableModel()->labelForAddress(sWalletAddress);
-        if (sWalletLabel.isEmpty())
-            sWalletLabel = tr("(no label)");
-
-        if (treeMode)
-        {
-            // wallet address
-            itemWalletAddress = new CCoinControlWidgetItem(ui->treeWidget);
-
-            itemWalletAddress->setFlags(flgTristate);
-            itemWalletAddress->setCheckState(COLUMN_CHECKBOX, Qt::Unchecked);
-
-            // label
-            itemWalletAddress->setText(COLUMN_LABEL, sWalletLabel);
-
-            // address
-            itemWalletAddress->setText(COLUMN_ADDRESS, sWalletAddress);
-        }
-
-        CAmount nSum = 0;
-        int nChildren = 0;
-        for (const auto& outpair : coins.second) {
-            const COutPoint& output = std::get<0>(outpair);
-            const interfaces::WalletTxOut& out = std::get<1>(outpair);
-            nSum += out.txout.nValue;
-            nChildren++;
-
-            CCoinControlWidgetItem *itemOutput;
-            if (treeMode)    itemOutput = new CCoinControlWidgetItem(itemWalletAddress);
-            else             itemOutput = new CCoinControlWidgetItem(ui->treeWidget);
-            itemOutput->setFlags(flgCheckbox);
-            itemOutput->setCheckState(COLUMN_CHECKBOX,Qt::Unchecked);
-
-            // address
-            CTxDestination outputAddress;
-            QString sAddress = "";
-            if(ExtractDestination(out.txout.scriptPubKey, outputAddress))
-            {
-                sAddress = QString::fromStdString(EncodeDestination(outputAddress));
-
-                // if listMode or change => show bitcoin address. In tree mode, address is not shown again for direct wallet address outputs
-                if (!treeMode || (!(sAddress == sWalletAddress)))
-                    itemOutput->setText(COLUMN_ADDRESS, sAddress);
-            }
-
-            // label
-            if (!(sAddress == sWalletAddress)) // change
-            {
-                // tooltip from where the change comes from
-                itemOutput->setToolTip(COLUMN_LABEL, tr("change from %1 (%2)").arg(sWalletLabel).arg(sWalletAddress));
-                itemOutput->setText(COLUMN_LABEL, tr("(change)"));
-            }
-            else if (!treeMode)
-            {
-                QString sLabel = model->getAddressTableModel()->labelForAddress(sAddress);
-                if (sLabel.isEmpty())
-                    sLabel = tr("(no label)");
-                itemOutput->setText(COLUMN_LABEL, sLabel);
-            }
+    m_coin_model->setTreeMode(treeMode);
 
-            // amount
-            itemOutput->setText(COLUMN_AMOUNT, BitcoinUnits::format(nDisplayUnit, out.txout.nValue));
-            itemOutput->setData(COLUMN_AMOUNT, Qt::UserRole, QVariant((qlonglong)out.txout.nValue)); // padding so that sorting works correctly
-
-            // date
-            itemOutput->setText(COLUMN_DATE, GUIUtil::dateTimeStr(out.time));
-            itemOutput->setData(COLUMN_DATE, Qt::UserRole, QVariant((qlonglong)out.time));
-
-            // confirmations
-            itemOutput->setText(COLUMN_CONFIRMATIONS, QString::number(out.depth_in_main_chain));
-            itemOutput->setData(COLUMN_CONFIRMATIONS, Qt::UserRole, QVariant((qlonglong)out.depth_in_main_chain));
-
-            // transaction hash
-            itemOutput->setData(COLUMN_ADDRESS, TxHashRole, QString::fromStdString(output.hash.GetHex()));
-
-            // vout index
-            itemOutput->setData(COLUMN_ADDRESS, VOutRole, output.n);
-
-             // disable locked coins
-            if (model->wallet().isLockedCoin(output))
-            {
-                m_coin_control.UnSelect(output); // just to be sure
-                itemOutput->setDisabled(true);
-                itemOutput->setIcon(COLUMN_CHECKBOX, platformStyle->SingleColorIcon(":/icons/lock_closed"));
-            }
-
-            // set checkbox
-            if (m_coin_control.IsSelected(output))
-                itemOutput->setCheckState(COLUMN_CHECKBOX, Qt::Checked);
-        }
-
-        // amount
-        if (treeMode)
-        {
-            itemWalletAddress->setText(COLUMN_CHECKBOX, "(" + QString::number(nChildren) + ")");
-            itemWalletAddress->setText(COLUMN_AMOUNT, BitcoinUnits::format(nDisplayUnit, nSum));
-            itemWalletAddress->setData(COLUMN_AMOUNT, Qt::UserRole, QVariant((qlonglong)nSum));
-        }
-    }
+    // sort view
+    sortView(sortColumn, sortOrder);
 
     // expand all partially selected
     if (treeMode)
     {
-        for (int i = 0; i < ui->treeWidget->topLevelItemCount(); i++)
-            if (ui->treeWidget->topLevelItem(i)->checkState(COLUMN_CHECKBOX) == Qt::PartiallyChecked)
-                ui->treeWidget->topLevelItem(i)->setExpanded(true);
+        for (int i = 0; i < m_coin_model->rowCount(); i++) {
+            const QModelIndex index = m_coin_model->index(i, CoinControlModel::Checkbox);
+            if (index.data(Qt::CheckStateRole).toInt() == Qt::PartiallyChecked)
+                ui->treeWidget->expand(index);
+        }
     }
-
-    // sort view
-    sortView(sortColumn, sortOrder);
-    ui->treeWidget->setEnabled(true);
 }
@@ -12,11 +12,13 @@
 #include <QDialog>
 #include <QList>
 #include <QMenu>
+#include <QPersistentModelIndex>
 #include <QPoint>
 #include <QString>
-#include <QTreeWidgetItem>
 
+class CoinControlModel;
 class PlatformStyle;
+class QThread;
 class WalletModel;
 
 namespace wallet {
@@ -29,15 +31,7 @@ namespace Ui {
 
 #define ASYMP_UTF8 "\xE2\x89\x88"
 
-class CCoinControlWidgetItem : public QTreeWidgetItem
-{
-public:
-    explicit CCoinControlWidgetItem(QTreeWidget *parent, int type = Type) : QTreeWidgetItem(parent, type) {}
-    explicit CCoinControlWidgetItem(QTreeWidgetItem *parent, int type = Type) : QTreeWidgetItem(parent, type) {}
-
-    bool operator<(const QTreeWidgetItem &other) const override;
-};
-
+struct CoinControlTotals;
 
 class CoinControlDialog : public QDialog
 {
@@ -49,6 +43,8 @@ public:
 
     // static because also called from sendcoinsdialog
     static void updateLabels(wallet::CCoinControl& m_coin_control, WalletModel*, QDialog*);
+    /** Update the labels from totals of the selected coins that are already known. */
+    static void updateLabels(wallet::CCoinControl& m_coin_control, WalletModel*, QDialog*, const CoinControlTotals& totals);
 
     static QList<CAmount> payAmounts;
     static bool fSubtractFeeFromAmount;
@@ -60,11 +56,15 @@ private:
     Ui::CoinControlDialog *ui;
     wallet::CCoinControl& m_coin_control;
     WalletModel *model;
+    CoinControlModel* m_coin_model;
+    //! Loads the coins of the wallet, so that the dialog shows while a wallet with many coins is read
+    QThread* const m_load_thread;
+    QObject* const m_load_worker;
     int sortColumn;
     Qt::SortOrder sortOrder;
 
     QMenu *contextMenu;
-    QTreeWidgetItem *contextMenuItem;
+    QPersistentModelIndex contextMenuIndex;
     QAction* m_copy_transaction_outpoint_action;
     QAction *lockAction;
     QAction *unlockAction;
@@ -72,26 +72,9 @@ private:
     const PlatformStyle *platformStyle;
 
     void sortView(int, Qt::SortOrder);
+    void loadCoins();
     void updateView();
 
-    enum
-    {
-        COLUMN_CHECKBOX = 0,
-        COLUMN_AMOUNT,
-        COLUMN_LABEL,
-        COLUMN_ADDRESS,
-        COLUMN_DATE,
-        COLUMN_CONFIRMATIONS,
-    };
-
-    enum
-    {
-        TxHashRole = Qt::UserRole,
-        VOutRole
-    };
-
-    friend class CCoinControlWidgetItem;
-
 private Q_SLOTS:
     void showMenu(const QPoint &);
     void copyAmount();
@@ -109,7 +92,7 @@ private Q_SLOTS:
     void clipboardChange();
     void radioTreeMode(bool);
     void radioListMode(bool);
-    void viewItemChanged(QTreeWidgetItem*, int);
+    void coinSelectionChanged();
     void headerSectionClicked(int);
     void buttonBoxClicked(QAbstractButton*);
     void buttonSelectAllClicked();
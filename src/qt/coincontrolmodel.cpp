@@ -0,0 +1,506 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <qt/coincontrolmodel.h>
+
+#include <qt/bitcoinunits.h>
+#include <qt/guiutil.h>
+#include <qt/optionsmodel.h>
+#include <qt/platformstyle.h>
+#include <qt/walletmodel.h>
+
+#include <key_io.h>
+#include <pubkey.h>
+#include <script/standard.h>
+#include <wallet/coincontrol.h>
+
+#include <QIcon>
+
+#include <algorithm>
+#include <numeric>
+
+using wallet::CCoinControl;
+
+CoinControlModel::CoinControlModel(CCoinControl& coin_control, WalletModel* wallet_model, const PlatformStyle* platform_style, QObject* parent) :
+    QAbstractItemModel(parent),
+    m_coin_control(coin_control),
+    m_wallet_model(wallet_model),
+    m_platform_style(platform_style)
+{
+}
+
+unsigned int CoinControlModel::estimateInputBytes(interfaces::Wallet& wallet, const CTxOut& txout, bool& witness)
+{
+    witness = false;
+    int witnessversion = 0;
+    std::vector<unsigned char> witnessprogram;
+    if (txout.scriptPubKey.IsWitnessProgram(witnessversion, witnessprogram)) {
+        witness = true;
+        return 32 + 4 + 1 + (107 / WITNESS_SCALE_FACTOR) + 4;
+    }
+    CTxDestination address;
+    if (ExtractDestination(txout.scriptPubKey, address)) {
+        CPubKey pubkey;
+        PKHash* pkhash = std::get_if<PKHash>(&address);
+        if (pkhash && wallet.getPubKey(txout.scriptPubKey, ToKeyID(*pkhash), pubkey)) {
+            return pubkey.IsCompressed() ? 148 : 180;
+        }
+    }
+    return 148; // in all error cases, simply assume 148 here
+}
+
+std::vector<CoinControlGroup> CoinControlModel::loadCoins(interfaces::Wallet& wallet)
+{
+    std::vector<CoinControlGroup> groups;
+    for (const auto& [dest, coins] : wallet.listCoins()) {
+        CoinControlGroup& group{groups.emplace_back()};
+        group.address = QString::fromStdString(EncodeDestination(dest));
+        std::string label;
+        if (wallet.getAddress(dest, &label, /*is_mine=*/nullptr, /*purpose=*/nullptr)) {
+            group.label = QString::fromStdString(label);
+        }
+        group.coins.reserve(coins.size());
+        for (const auto& [outpoint, out] : coins) {
+            CoinControlCoin& coin{group.coins.emplace_back()};
+            coin.outpoint = outpoint;
+            coin.out = out;
+            CTxDestination address;
+            if (ExtractDestination(out.txout.scriptPubKey, address)) {
+                coin.address = QString::fromStdString(EncodeDestination(address));
+            }
+            coin.input_bytes = estimateInputBytes(wallet, out.txout, coin.witness);
+            coin.locked = wallet.isLockedCoin(outpoint);
+        }
+    }
+    return groups;
+}
+
+CoinControlTotals CoinControlModel::selectedTotals(CCoinControl& coin_control, interfaces::Wallet& wallet)
+{
+    CoinControlTotals totals;
+    std::vector<COutPoint> selected;
+    coin_control.ListSelected(selected);
+    const std::vector<interfaces::WalletTxOut> coins{wallet.getCoins(selected)};
+    for (size_t i = 0; i < coins.size(); ++i) {
+        const interfaces::WalletTxOut& out = coins[i];
+        if (out.depth_in_main_chain < 0) continue;
+
+        // unselect already spent, very unlikely scenario, this could happen
+        // when selected are spent elsewhere, like rpc or another computer
+        if (out.is_spent) {
+            coin_control.UnSelect(selected[i]);
+            continue;
+        }
+
+        bool witness;
+        ++totals.quantity;
+        totals.amount += out.txout.nValue;
+        totals.input_bytes += estimateInputBytes(wallet, out.txout, witness);
+        if (witness) ++totals.witness_inputs;
+    }
+    return totals;
+}
+
+void CoinControlModel::setCoins(std::vector<CoinControlGroup> groups)
+{
+    beginResetModel();
+    m_groups = std::move(groups);
+    m_list.clear();
+    for (size_t g = 0; g < m_groups.size(); ++g) {
+        CoinControlGroup& group = m_groups[g];
+        group.sum = 0;
+        group.selected = 0;
+        for (size_t c = 0; c < group.coins.size(); ++c) {
+            const CoinControlCoin& coin = group.coins[c];
+            // disable locked coins
+            if (coin.locked) m_coin_control.UnSelect(coin.outpoint); // just to be sure
+            group.sum += coin.out.txout.nValue;
+            if (m_coin_control.IsSelected(coin.outpoint)) ++group.selected;
+            m_list.emplace_back(g, c);
+        }
+    }
+    m_totals = selectedTotals(m_coin_control, m_wallet_model->wallet());
+    m_loaded = true;
+    endResetModel();
+    Q_EMIT selectionChanged();
+}
+
+void CoinControlModel::setTreeMode(bool tree_mode)
+{
+    if (tree_mode == m_tree_mode) return;
+    beginResetModel();
+    m_tree_mode = tree_mode;
+    endResetModel();
+}
+
+std::pair<size_t, std::optional<size_t>> CoinControlModel::locate(const QModelIndex& index) const
+{
+    if (!m_tree_mode) {
+        const auto& [group, coin] = m_list[index.row()];
+        return {group, coin};
+    }
+    if (index.internalId() == 0) return {index.row(), std::nullopt};
+    return {index.internalId() - 1, index.row()};
+}
+
+const CoinControlCoin* CoinControlModel::coin(const QModelIndex& index) const
+{
+    if (!index.isValid()) return nullptr;
+    const auto [group_index, coin_index] = locate(index);
+    if (!coin_index) return nullptr;
+    return &m_groups[group_index].coins[*coin_index];
+}
+
+QModelIndex CoinControlModel::index(int row, int column, const QModelIndex& parent) const
+{
+    if (!hasIndex(row, column, parent)) return QModelIndex();
+    // the coins of an address in tree mode keep the row of their address plus one, top level rows zero
+    if (!parent.isValid()) return createIndex(row, column, quintptr{0});
+    return createIndex(row, column, quintptr(parent.row() + 1));
+}
+
+QModelIndex CoinControlModel::parent(const QModelIndex& index) const
+{
+    if (!index.isValid() || index.internalId() == 0) return QModelIndex();
+    return createIndex(int(index.internalId() - 1), 0, quintptr{0});
+}
+
+int CoinControlModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.column() > 0) return 0;
+    if (!parent.isValid()) return m_tree_mode ? m_groups.size() : m_list.size();
+    if (m_tree_mode && parent.internalId() == 0) return m_groups[parent.row()].coins.size();
+    return 0;
+}
+
+int CoinControlModel::columnCount(const QModelIndex& parent) const
+{
+    Q_UNUSED(parent);
+    return Confirmations + 1;
+}
+
+Qt::CheckState CoinControlModel::groupCheckState(const CoinControlGroup& group) const
+{
+    if (group.selected == 0) return Qt::Unchecked;
+    if (group.selected == group.coins.size()) return Qt::Checked;
+    return Qt::PartiallyChecked;
+}
+
+QString CoinControlModel::coinLabel(const CoinControlGroup& group, const CoinControlCoin& coin) const
+{
+    if (coin.address != group.address) return tr("(change)");
+    // In tree mode, the label is shown with the address
+    if (m_tree_mode) return QString();
+    return group.label.isEmpty() ? tr("(no label)") : group.label;
+}
+
+QString CoinControlModel::coinAddress(const CoinControlGroup& group, const CoinControlCoin& coin) const
+{
+    // if listMode or change => show bitcoin address. In tree mode, address is not shown again for direct wallet address outputs
+    if (!m_tree_mode || coin.address != group.address) return coin.address;
+    return QString();
+}
+
+QVariant CoinControlModel::data(const QModelIndex& index, int role) const
+{
+    if (!index.isValid()) return QVariant();
+    const auto [group_index, coin_index] = locate(index);
+    const CoinControlGroup& group = m_groups[group_index];
+    const BitcoinUnit unit = m_wallet_model->getOptionsModel()->getDisplayUnit();
+
+    if (!coin_index) {
+        switch (role) {
+        case Qt::DisplayRole:
+            switch (index.column()) {
+            case Checkbox:
+                return "(" + QString::number(group.coins.size()) + ")";
+            case Amount:
+                return BitcoinUnits::format(unit, group.sum);
+            case Label:
+                return group.label.isEmpty() ? tr("(no label)") : group.label;
+            case Address:
+                return group.address;
+            } // no default case, so the compiler can warn about missing cases
+            return QVariant();
+        case Qt::CheckStateRole:
+            if (index.column() == Checkbox) return groupCheckState(group);
+            return QVariant();
+        }
+        return QVariant();
+    }
+
+    const CoinControlCoin& coin = group.coins[*coin_index];
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case Amount:
+            return BitcoinUnits::format(unit, coin.out.txout.nValue);
+        case Label:
+            return coinLabel(group, coin);
+        case Address:
+            return coinAddress(group, coin);
+        case Date:
+            return GUIUtil::dateTimeStr(coin.out.time);
+        case Confirmations:
+            return QString::number(coin.out.depth_in_main_chain);
+        } // no default case, so the compiler can warn about missing cases
+        return QVariant();
+    case Qt::ToolTipRole:
+        if (index.column() == Label && coin.address != group.address) {
+            // tooltip from where the change comes from
+            return tr("change from %1 (%2)").arg(group.label.isEmpty() ? tr("(no label)") : group.label).arg(group.address);
+        }
+        return QVariant();
+    case Qt::DecorationRole:
+        if (index.column() == Checkbox && coin.locked) return m_platform_style->SingleColorIcon(":/icons/lock_closed");
+        return QVariant();
+    case Qt::CheckStateRole:
+        if (index.column() == Checkbox) return m_coin_control.IsSelected(coin.outpoint) ? Qt::Checked : Qt::Unchecked;
+        return QVariant();
+    }
+    return QVariant();
+}
+
+bool CoinControlModel::select(CoinControlGroup& group, CoinControlCoin& coin, bool selected)
+{
+    if (selected == m_coin_control.IsSelected(coin.outpoint)) return false;
+    // locked (this happens if "check all" through parent node)
+    if (selected && coin.locked) return false;
+    const int sign{selected ? 1 : -1};
+    if (selected) {
+        m_coin_control.Select(coin.outpoint);
+        ++group.selected;
+    } else {
+        m_coin_control.UnSelect(coin.outpoint);
+        --group.selected;
+    }
+    m_totals.quantity += sign;
+    m_totals.amount += sign * coin.out.txout.nValue;
+    m_totals.input_bytes += sign * int(coin.input_bytes);
+    if (coin.witness) m_totals.witness_inputs += sign;
+    return true;
+}
+
+bool CoinControlModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+    if (!index.isValid() || index.column() != Checkbox || role != Qt::CheckStateRole) return false;
+    const bool selected{static_cast<Qt::CheckState>(value.toInt()) != Qt::Unchecked};
+    const auto [group_index, coin_index] = locate(index);
+    CoinControlGroup& group = m_groups[group_index];
+
+    bool changed{false};
+    if (coin_index) {
+        changed = select(group, group.coins[*coin_index], selected);
+    } else {
+        for (CoinControlCoin& coin : group.coins) {
+            changed |= select(group, coin, selected);
+        }
+    }
+    if (!changed) return false;
+
+    emitCheckStateChanged(index);
+    Q_EMIT selectionChanged();
+    return true;
+}
+
+void CoinControlModel::selectAll(bool select)
+{
+    for (CoinControlGroup& group : m_groups) {
+        for (CoinControlCoin& coin : group.coins) {
+            this->select(group, coin, select);
+        }
+    }
+    if (!select) {
+        // just to be sure, also unselect the coins that are not shown
+        m_coin_control.UnSelectAll();
+        m_totals = CoinControlTotals{};
+    }
+    emitAllCheckStatesChanged();
+    Q_EMIT selectionChanged();
+}
+
+void CoinControlModel::setLocked(const QModelIndex& index, bool locked)
+{
+    if (!index.isValid()) return;
+    const auto [group_index, coin_index] = locate(index);
+    if (!coin_index) return;
+    CoinControlGroup& group = m_groups[group_index];
+    CoinControlCoin& coin = group.coins[*coin_index];
+    if (locked) {
+        const bool unselected{select(group, coin, false)};
+        m_wallet_model->wallet().lockCoin(coin.outpoint, /*write_to_db=*/true);
+        coin.locked = true;
+        if (unselected) Q_EMIT selectionChanged();
+    } else {
+        m_wallet_model->wallet().unlockCoin(coin.outpoint);
+        coin.locked = false;
+    }
+    emitCheckStateChanged(index);
+    Q_EMIT dataChanged(index.sibling(index.row(), Checkbox), index.sibling(index.row(), Confirmations));
+}
+
+void CoinControlModel::emitCheckStateChanged(const QModelIndex& index)
+{
+    const QVector<int> roles{Qt::CheckStateRole};
+    const QModelIndex row = index.sibling(index.row(), Checkbox);
+    Q_EMIT dataChanged(row, row, roles);
+    if (!m_tree_mode) return;
+    if (row.parent().isValid()) {
+        Q_EMIT dataChanged(row.parent(), row.parent(), roles);
+    } else if (const int coins = rowCount(row); coins > 0) {
+        Q_EMIT dataChanged(this->index(0, Checkbox, row), this->index(coins - 1, Checkbox, row), roles);
+    }
+}
+
+void CoinControlModel::emitAllCheckStatesChanged()
+{
+    const int rows = rowCount();
+    if (rows == 0) return;
+    const QVector<int> roles{Qt::CheckStateRole};
+    Q_EMIT dataChanged(index(0, Checkbox), index(rows - 1, Checkbox), roles);
+    if (!m_tree_mode) return;
+    for (int row = 0; row < rows; ++row) {
+        const QModelIndex group = index(row, Checkbox);
+        if (const int coins = rowCount(group); coins > 0) {
+            Q_EMIT dataChanged(index(0, Checkbox, group), index(coins - 1, Checkbox, group), roles);
+        }
+    }
+}
+
+QVariant CoinControlModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation != Qt::Horizontal) return QVariant();
+    if (role == Qt::DisplayRole) {
+        switch (section) {
+        case Checkbox:
+            return QString();
+        case Amount:
+            return tr("Amount");
+        case Label:
+            return tr("Received with label");
+        case Address:
+            return tr("Received with address");
+        case Date:
+            return tr("Date");
+        case Confirmations:
+            return tr("Confirmations");
+        }
+    } else if (role == Qt::ToolTipRole && section == Confirmations) {
+        return tr("Confirmed");
+    }
+    return QVariant();
+}
+
+Qt::ItemFlags CoinControlModel::flags(const QModelIndex& index) const
+{
+    if (!index.isValid()) return Qt::NoItemFlags;
+    Qt::ItemFlags flags = Qt::ItemIsSelectable;
+    // disable locked coins
+    const CoinControlCoin* row_coin = coin(index);
+    if (!row_coin || !row_coin->locked) flags |= Qt::ItemIsEnabled;
+    if (index.column() == Checkbox) flags |= Qt::ItemIsUserCheckable;
+    return flags;
+}
+
+void CoinControlModel::sort(int column, Qt::SortOrder order)
+{
+    const auto sorted = [order](const auto& a, const auto& b) {
+        return order == Qt::AscendingOrder ? a < b : b < a;
+    };
+    const auto coin_less = [&](const CoinControlGroup& group_a, const CoinControlCoin& a, const CoinControlGroup& group_b, const CoinControlCoin& b) {
+        switch (column) {
+        case Amount:
+            return sorted(a.out.txout.nValue, b.out.txout.nValue);
+        case Label:
+            return sorted(coinLabel(group_a, a), coinLabel(group_b, b));
+        case Address:
+            return sorted(coinAddress(group_a, a), coinAddress(group_b, b));
+        case Date:
+            return sorted(a.out.time, b.out.time);
+        case Confirmations:
+            return sorted(a.out.depth_in_main_chain, b.out.depth_in_main_chain);
+        }
+        return false;
+    };
+    const auto group_less = [&](const CoinControlGroup& a, const CoinControlGroup& b) {
+        switch (column) {
+        case Amount:
+            return sorted(a.sum, b.sum);
+        case Label:
+            return sorted(a.label.isEmpty() ? tr("(no label)") : a.label, b.label.isEmpty() ? tr("(no label)") : b.label);
+        case Address:
+            return sorted(a.address, b.address);
+        }
+        return false;
+    };
+    // Positions are sorted rather than the rows, so that the rows kept by the
+    // views, like the expanded addresses, can be moved along.
+    const auto sort_positions = [](size_t size, const auto& less) {
+        std::vector<size_t> positions(size);
+        std::iota(positions.begin(), positions.end(), 0);
+        std::stable_sort(positions.begin(), positions.end(), less);
+        return positions;
+    };
+    const auto new_rows = [](const std::vector<size_t>& positions) {
+        std::vector<size_t> rows(positions.size());
+        for (size_t row = 0; row < positions.size(); ++row) rows[positions[row]] = row;
+        return rows;
+    };
+
+    Q_EMIT layoutAboutToBeChanged();
+    const QModelIndexList from{persistentIndexList()};
+    QModelIndexList to;
+    to.reserve(from.size());
+    if (m_tree_mode) {
+        const std::vector<size_t> group_positions{sort_positions(m_groups.size(), [&](size_t a, size_t b) {
+            return group_less(m_groups[a], m_groups[b]);
+        })};
+        std::vector<std::vector<size_t>> coin_rows(m_groups.size());
+        std::vector<CoinControlGroup> groups;
+        groups.reserve(m_groups.size());
+        for (const size_t g : group_positions) {
+            CoinControlGroup& group = m_groups[g];
+            const std::vector<size_t> coin_positions{sort_positions(group.coins.size(), [&](size_t a, size_t b) {
+                return coin_less(group, group.coins[a], group, group.coins[b]);
+            })};
+            std::vector<CoinControlCoin> coins;
+            coins.reserve(group.coins.size());
+            for (const size_t c : coin_positions) coins.push_back(std::move(group.coins[c]));
+            group.coins = std::move(coins);
+            coin_rows[g] = new_rows(coin_positions);
+            groups.push_back(std::move(group));
+        }
+        const std::vector<size_t> group_rows{new_rows(group_positions)};
+        m_groups = std::move(groups);
+        for (const QModelIndex& index : from) {
+            if (index.internalId() == 0) {
+                to.append(createIndex(int(group_rows[index.row()]), index.column(), quintptr{0}));
+            } else {
+                const size_t g = index.internalId() - 1;
+                to.append(createIndex(int(coin_rows[g][index.row()]), index.column(), quintptr(group_rows[g] + 1)));
+            }
+        }
+        // the coins moved within their groups, so the rows of the list are rebuilt
+        m_list.clear();
+        for (size_t g = 0; g < m_groups.size(); ++g) {
+            for (size_t c = 0; c < m_groups[g].coins.size(); ++c) m_list.emplace_back(g, c);
+        }
+    } else {
+        const std::vector<size_t> positions{sort_positions(m_list.size(), [&](size_t a, size_t b) {
+            const CoinControlGroup& group_a = m_groups[m_list[a].first];
+            const CoinControlGroup& group_b = m_groups[m_list[b].first];
+            return coin_less(group_a, group_a.coins[m_list[a].second], group_b, group_b.coins[m_list[b].second]);
+        })};
+        std::vector<std::pair<size_t, size_t>> list;
+        list.reserve(m_list.size());
+        for (const size_t row : positions) list.push_back(m_list[row]);
+        m_list = std::move(list);
+        const std::vector<size_t> rows{new_rows(positions)};
+        for (const QModelIndex& index : from) {
+            to.append(createIndex(int(rows[index.row()]), index.column(), quintptr{0}));
+        }
+    }
+    changePersistentIndexList(from, to);
+    Q_EMIT layoutChanged();
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_QT_COINCONTROLMODEL_H
+#define BITCOIN_QT_COINCONTROLMODEL_H
+
+#include <consensus/amount.h>
+#include <interfaces/wallet.h>
+#include <primitives/transaction.h>
+
+#include <QAbstractItemModel>
+#include <QModelIndex>
+#include <QString>
+#include <QVariant>
+
+#include <cstddef>
+#include <optional>
+#include <utility>
+#include <vector>
+
+class PlatformStyle;
+class WalletModel;
+
+namespace wallet {
+class CCoinControl;
+} // namespace wallet
+
+/** Totals of the coins selected with coin control, as CoinControlDialog::updateLabels() shows them */
+struct CoinControlTotals {
+    unsigned int quantity{0};
+    CAmount amount{0};
+    //! Estimated size of the inputs spending the coins
+    unsigned int input_bytes{0};
+    //! How many of them spend witness outputs
+    unsigned int witness_inputs{0};
+};
+
+/** A coin of the wallet, as loaded for CoinControlModel */
+struct CoinControlCoin {
+    COutPoint outpoint;
+    interfaces::WalletTxOut out;
+    //! The address the coin pays to, empty if it has none
+    QString address;
+    //! Estimated size of an input spending the coin
+    unsigned int input_bytes;
+    bool witness;
+    bool locked;
+};
+
+/** The coins of an address of the wallet, including the change they sent to other addresses, as listCoins() groups them */
+struct CoinControlGroup {
+    QString address;
+    QString label;
+    std::vector<CoinControlCoin> coins;
+    CAmount sum{0};
+    //! How many of the coins are selected
+    size_t selected{0};
+};
+
+/**
+ * Model of the coins of a wallet for CoinControlDialog, either as a tree of
+ * the addresses and their coins or as a list of the coins. Rows are only
+ * formatted when the view shows them, and the totals of the selected coins
+ * are kept up to date as coins are selected, so a wallet with very many
+ * coins does not slow the dialog down. The coins are loaded with
+ * loadCoins(), which can be called on a thread of its own.
+ */
+class CoinControlModel : public QAbstractItemModel
+{
+    Q_OBJECT
+
+public:
+    CoinControlModel(wallet::CCoinControl& coin_control, WalletModel* wallet_model, const PlatformStyle* platform_style, QObject* parent = nullptr);
+
+    enum ColumnIndex {
+        Checkbox = 0,
+        Amount = 1,
+        Label = 2,
+        Address = 3,
+        Date = 4,
+        Confirmations = 5,
+    };
+
+    /** Read the coins of wallet. It does not use the model, so that it can run on another thread. */
+    static std::vector<CoinControlGroup> loadCoins(interfaces::Wallet& wallet);
+    /** Estimate the size of an input spending txout, setting witness if it spends a witness output. */
+    static unsigned int estimateInputBytes(interfaces::Wallet& wallet, const CTxOut& txout, bool& witness);
+
+    /** Add up the selected coins from the wallet, unselecting the ones that were spent meanwhile. */
+    static CoinControlTotals selectedTotals(wallet::CCoinControl& coin_control, interfaces::Wallet& wallet);
+
+    /** Show groups, as loaded by loadCoins(), unselecting the coins that are locked. */
+    void setCoins(std::vector<CoinControlGroup> groups);
+    bool isLoaded() const { return m_loaded; }
+    void setTreeMode(bool tree_mode);
+    const CoinControlTotals& getTotals() const { return m_totals; }
+
+    /** Return the coin of a row, or nullptr for the row of an address in tree mode. */
+    const CoinControlCoin* coin(const QModelIndex& index) const;
+    /** Lock or unlock the coin of a row for spending, as shown by the wallet. */
+    void setLocked(const QModelIndex& index, bool locked);
+    /** Select all coins that are not locked if select is set, otherwise unselect all coins. */
+    void selectAll(bool select);
+
+    QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
+    QModelIndex parent(const QModelIndex& index) const override;
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role) const override;
+    bool setData(const QModelIndex& index, const QVariant& value, int role) override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role) const override;
+    Qt::ItemFlags flags(const QModelIndex& index) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+Q_SIGNALS:
+    /** The selection of coins and so the totals changed. */
+    void selectionChanged();
+
+private:
+    wallet::CCoinControl& m_coin_control;
+    WalletModel* const m_wallet_model;
+    const PlatformStyle* const m_platform_style;
+    bool m_loaded{false};
+    bool m_tree_mode{false};
+    std::vector<CoinControlGroup> m_groups;
+    //! The group and coin of each row in list mode
+    std::vector<std::pair<size_t, size_t>> m_list;
+    CoinControlTotals m_totals;
+
+    /** The group of a row, and its coin, or std::nullopt for the row of an address in tree mode. */
+    std::pair<size_t, std::optional<size_t>> locate(const QModelIndex& index) const;
+    /** Select or unselect a coin, updating the totals and its group, without notifying the views. Returns whether it changed. */
+    bool select(CoinControlGroup& group, CoinControlCoin& coin, bool selected);
+    Qt::CheckState groupCheckState(const CoinControlGroup& group) const;
+    QString coinLabel(const CoinControlGroup& group, const CoinControlCoin& coin) const;
+    QString coinAddress(const CoinControlGroup& group, const CoinControlCoin& coin) const;
+    /** Notify the views that the check state of a row changed, and of the rows above or below it in the tree. */
+    void emitCheckStateChanged(const QModelIndex& index);
+    void emitAllCheckStatesChanged();
+};
+
+#endif // BITCOIN_QT_COINCONTROLMODEL_H
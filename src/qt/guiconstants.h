@@ -43,6 +43,9 @@ static const bool DEFAULT_SPLASHSCREEN = true;
  */
 static const int TOOLTIP_WRAP_THRESHOLD = 80;
 
+/* Transaction list -- number of wallet transactions loaded at a time */
+static const int TRANSACTION_LOAD_WINDOW = 1000;
+
 /* Number of frames in spinner animation */
 #define SPINNER_FRAMES 36
 
@@ -12,17 +12,21 @@
 #include <utility>
 
 #include <QList>
+#include <QThread>
 #include <QTimer>
 
-PeerTableModel::PeerTableModel(interfaces::Node& node, QObject* parent) :
+PeerTableModel::PeerTableModel(interfaces::Node& node, QThread* poll_thread, QObject* parent) :
     QAbstractTableModel(parent),
     m_node(node),
     timer(nullptr)
 {
-    // set up timer for auto refresh
-    timer = new QTimer(this);
-    connect(timer, &QTimer::timeout, this, &PeerTableModel::refresh);
+    // set up timer for auto refresh, firing on the poll thread
+    timer = new QTimer;
     timer->setInterval(MODEL_UPDATE_DELAY);
+    connect(timer, &QTimer::timeout, [this] { pollPeersData(); });
+    connect(poll_thread, &QThread::finished, timer, &QObject::deleteLater);
+    timer->moveToThread(poll_thread);
+    QMetaObject::invokeMethod(timer, [timer = timer] { timer->start(); });
 
     // load initial data
     refresh();
@@ -32,12 +36,12 @@ PeerTableModel::~PeerTableModel() = default;
 
 void PeerTableModel::startAutoRefresh()
 {
-    timer->start();
+    m_auto_refresh = true;
 }
 
 void PeerTableModel::stopAutoRefresh()
 {
-    timer->stop();
+    m_auto_refresh = false;
 }
 
 int PeerTableModel::rowCount(const QModelIndex& parent) const
@@ -150,15 +154,49 @@ QModelIndex PeerTableModel::index(int row, int column, const QModelIndex& parent
 }
 
 void PeerTableModel::refresh()
+{
+    // A synchronous refresh supersedes a snapshot still waiting to be applied
+    WITH_LOCK(m_pending_mutex, m_pending_peers_data.reset());
+    updatePeersData(fetchPeersData());
+}
+
+QList<CNodeCombinedStats> PeerTableModel::fetchPeersData() const
 {
     interfaces::Node::NodesStats nodes_stats;
     m_node.getNodesStats(nodes_stats);
-    decltype(m_peers_data) new_peers_data;
-    new_peers_data.reserve(nodes_stats.size());
+    QList<CNodeCombinedStats> peers_data;
+    peers_data.reserve(nodes_stats.size());
     for (const auto& node_stats : nodes_stats) {
         const CNodeCombinedStats stats{std::get<0>(node_stats), std::get<2>(node_stats), std::get<1>(node_stats)};
-        new_peers_data.append(stats);
+        peers_data.append(stats);
+    }
+    return peers_data;
+}
+
+void PeerTableModel::pollPeersData()
+{
+    if (!m_auto_refresh) return;
+    QList<CNodeCombinedStats> peers_data{fetchPeersData()};
+
+    // Only post an update if none is pending, so that a busy GUI thread
+    // applies the newest snapshot once instead of every one in turn.
+    LOCK(m_pending_mutex);
+    const bool posted{m_pending_peers_data.has_value()};
+    m_pending_peers_data = std::move(peers_data);
+    if (!posted) {
+        QMetaObject::invokeMethod(this, [this] { applyPendingPeersData(); }, Qt::QueuedConnection);
     }
+}
+
+void PeerTableModel::applyPendingPeersData()
+{
+    std::optional<QList<CNodeCombinedStats>> peers_data;
+    WITH_LOCK(m_pending_mutex, peers_data.swap(m_pending_peers_data));
+    if (peers_data) updatePeersData(std::move(*peers_data));
+}
+
+void PeerTableModel::updatePeersData(QList<CNodeCombinedStats> new_peers_data)
+{
 
     // Handle peer addition or removal as suggested in Qt Docs. See:
     // - https://doc.qt.io/qt-5/model-view-programming.html#inserting-and-removing-rows
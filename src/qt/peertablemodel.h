@@ -7,6 +7,10 @@
 
 #include <net_processing.h> // For CNodeStateStats
 #include <net.h>
+#include <sync.h>
+
+#include <atomic>
+#include <optional>
 
 #include <QAbstractTableModel>
 #include <QList>
@@ -21,6 +25,7 @@ class Node;
 }
 
 QT_BEGIN_NAMESPACE
+class QThread;
 class QTimer;
 QT_END_NAMESPACE
 
@@ -34,13 +39,16 @@ Q_DECLARE_METATYPE(CNodeCombinedStats*)
 /**
    Qt model providing information about connected peers, similar to the
    "getpeerinfo" RPC call. Used by the rpc console UI.
+
+   While auto refresh is on, the peer stats are fetched on the poll thread and
+   only the newest snapshot is applied to the model on the GUI thread.
  */
 class PeerTableModel : public QAbstractTableModel
 {
     Q_OBJECT
 
 public:
-    explicit PeerTableModel(interfaces::Node& node, QObject* parent);
+    explicit PeerTableModel(interfaces::Node& node, QThread* poll_thread, QObject* parent);
     ~PeerTableModel();
     void startAutoRefresh();
     void stopAutoRefresh();
@@ -73,12 +81,22 @@ public:
     /*@}*/
 
 public Q_SLOTS:
-    void refresh();
+    void refresh() EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
 
 private:
     //! Internal peer data structure.
     QList<CNodeCombinedStats> m_peers_data{};
     interfaces::Node& m_node;
+    //! Whether the poll thread fetches the peer stats
+    std::atomic<bool> m_auto_refresh{false};
+    Mutex m_pending_mutex;
+    //! Newest snapshot fetched on the poll thread which is not applied yet
+    std::optional<QList<CNodeCombinedStats>> m_pending_peers_data GUARDED_BY(m_pending_mutex);
+
+    QList<CNodeCombinedStats> fetchPeersData() const;
+    void pollPeersData() EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    void applyPendingPeersData() EXCLUSIVE_LOCKS_REQUIRED(!m_pending_mutex);
+    void updatePeersData(QList<CNodeCombinedStats> new_peers_data);
     const QStringList columns{
         /*: Title of Peers Table column which contains a
             unique number used to identify a connection. */
@@ -18,9 +18,11 @@
 #include <core_io.h>
 #include <interfaces/handler.h>
 #include <uint256.h>
+#include <util/hasher.h>
 
 #include <algorithm>
 #include <functional>
+#include <unordered_map>
 
 #include <QColor>
 #include <QDateTime>
@@ -29,6 +31,7 @@
 #include <QLatin1Char>
 #include <QLatin1String>
 #include <QList>
+#include <QTimer>
 
 
 // Amount column is right-aligned it contains numbers
@@ -41,23 +44,6 @@ static int column_alignments[] = {
         Qt::AlignRight|Qt::AlignVCenter /* amount */
     };
 
-// Comparison operator for sort/binary search of model tx list
-struct TxLessThan
-{
-    bool operator()(const TransactionRecord &a, const TransactionRecord &b) const
-    {
-        return a.hash < b.hash;
-    }
-    bool operator()(const TransactionRecord &a, const uint256 &b) const
-    {
-        return a.hash < b;
-    }
-    bool operator()(const uint256 &a, const TransactionRecord &b) const
-    {
-        return a < b.hash;
-    }
-};
-
 // queue notifications to show a non freezing progress dialog e.g. for rescan
 struct TransactionNotification
 {
@@ -93,13 +79,21 @@ public:
 
     TransactionTableModel *parent;
 
-    /* Local cache of wallet.
-     * As it is in the same order as the CWallet, by definition
-     * this is sorted by sha256.
+    /* Local cache of wallet, in the order the transactions were loaded: windows of older
+     * transactions are appended as they are loaded, and so are new transactions. The
+     * records of a transaction are contiguous.
      */
     QList<TransactionRecord> cachedWallet;
+    /** First row of the records of each transaction in cachedWallet */
+    std::unordered_map<uint256, int, SaltedTxidHasher> txRows;
 
-    /** True when model finishes loading all wallet transactions on start */
+    /** Oldest transaction loaded so far, the next window starts after it */
+    uint256 m_last_loaded_txid;
+    int64_t m_last_loaded_order_pos{0};
+    /** True when all wallet transactions have been loaded */
+    bool m_loaded_all = false;
+
+    /** True when model finishes loading the first window of wallet transactions on start */
     bool m_loaded = false;
     /** True when transactions are being notified, for instance when scanning */
     bool m_loading = false;
@@ -108,22 +102,61 @@ public:
     void NotifyTransactionChanged(const uint256 &hash, ChangeType status);
     void DispatchNotifications();
 
-    /* Query entire wallet anew from core.
+    /* Query the newest transactions of the wallet from core, the older ones are loaded
+       in windows later on.
      */
     void refreshWallet(interfaces::Wallet& wallet)
     {
         assert(!m_loaded);
-        {
-            for (const auto& wtx : wallet.getWalletTxs()) {
-                if (TransactionRecord::showTransaction()) {
-                    cachedWallet.append(TransactionRecord::decomposeTransaction(wtx));
-                }
-            }
-        }
+        loadWindow(wallet);
         m_loaded = true;
         DispatchNotifications();
     }
 
+    /* Load the next window of older transactions from core. */
+    void loadWindow(interfaces::Wallet& wallet)
+    {
+        if (m_loaded_all) return;
+        const std::vector<interfaces::WalletTx> wtxs{wallet.getWalletTxsBefore(m_last_loaded_txid, m_last_loaded_order_pos, TRANSACTION_LOAD_WINDOW)};
+        m_loaded_all = wtxs.size() < size_t(TRANSACTION_LOAD_WINDOW);
+        if (!wtxs.empty()) {
+            m_last_loaded_txid = wtxs.back().tx->GetHash();
+            m_last_loaded_order_pos = wtxs.back().order_pos;
+        }
+
+        QList<TransactionRecord> toInsert;
+        for (const auto& wtx : wtxs) {
+            // A notification may have brought the transaction in before its window
+            if (TransactionRecord::showTransaction() && !txRows.count(wtx.tx->GetHash())) {
+                toInsert.append(TransactionRecord::decomposeTransaction(wtx));
+            }
+        }
+        appendRecords(toInsert);
+    }
+
+    /* Append the records of whole transactions to the model. */
+    void appendRecords(const QList<TransactionRecord>& records)
+    {
+        if (records.isEmpty()) return;
+        const int first = cachedWallet.size();
+        parent->beginInsertRows(QModelIndex(), first, first + records.size() - 1);
+        for (const TransactionRecord& rec : records) {
+            txRows.emplace(rec.hash, cachedWallet.size());
+            cachedWallet.append(rec);
+        }
+        parent->endInsertRows();
+    }
+
+    /* Rows [lower, upper) of the records of a transaction, empty if it is not in the model. */
+    std::pair<int, int> findRows(const uint256& hash) const
+    {
+        const auto it = txRows.find(hash);
+        if (it == txRows.end()) return {cachedWallet.size(), cachedWallet.size()};
+        int upper = it->second;
+        while (upper < cachedWallet.size() && cachedWallet[upper].hash == hash) ++upper;
+        return {it->second, upper};
+    }
+
     /* Update our model of the wallet incrementally, to synchronize our model of the wallet
        with that of the core.
 
@@ -134,13 +167,8 @@ public:
         qDebug() << "TransactionTablePriv::updateWallet: " + QString::fromStdString(hash.ToString()) + " " + QString::number(status);
 
         // Find bounds of this transaction in model
-        QList<TransactionRecord>::iterator lower = std::lower_bound(
-            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-        QList<TransactionRecord>::iterator upper = std::upper_bound(
-            cachedWallet.begin(), cachedWallet.end(), hash, TxLessThan());
-        int lowerIndex = (lower - cachedWallet.begin());
-        int upperIndex = (upper - cachedWallet.begin());
-        bool inModel = (lower != upper);
+        const auto [lowerIndex, upperIndex] = findRows(hash);
+        bool inModel = (lowerIndex != upperIndex);
 
         if(status == CT_UPDATED)
         {
@@ -171,20 +199,8 @@ public:
                     qWarning() << "TransactionTablePriv::updateWallet: Warning: Got CT_NEW, but transaction is not in wallet";
                     break;
                 }
-                // Added -- insert at the right position
-                QList<TransactionRecord> toInsert =
-                        TransactionRecord::decomposeTransaction(wtx);
-                if(!toInsert.isEmpty()) /* only if something to insert */
-                {
-                    parent->beginInsertRows(QModelIndex(), lowerIndex, lowerIndex+toInsert.size()-1);
-                    int insert_idx = lowerIndex;
-                    for (const TransactionRecord &rec : toInsert)
-                    {
-                        cachedWallet.insert(insert_idx, rec);
-                        insert_idx += 1;
-                    }
-                    parent->endInsertRows();
-                }
+                // Added -- append, the views sort the rows themselves
+                appendRecords(TransactionRecord::decomposeTransaction(wtx));
             }
             break;
         case CT_DELETED:
@@ -195,16 +211,23 @@ public:
             }
             // Removed -- remove entire transaction from table
             parent->beginRemoveRows(QModelIndex(), lowerIndex, upperIndex-1);
-            cachedWallet.erase(lower, upper);
+            cachedWallet.erase(cachedWallet.begin() + lowerIndex, cachedWallet.begin() + upperIndex);
+            txRows.erase(hash);
+            for (auto& [_, row] : txRows) {
+                if (row > lowerIndex) row -= upperIndex - lowerIndex;
+            }
             parent->endRemoveRows();
             break;
         case CT_UPDATED:
-            // Miscellaneous updates -- nothing to do, status update will take care of this, and is only computed for
+            // Miscellaneous updates -- the status update will take care of this, and is only computed for
             // visible transactions.
             for (int i = lowerIndex; i < upperIndex; i++) {
                 TransactionRecord *rec = &cachedWallet[i];
                 rec->status.needsUpdate = true;
             }
+            if (inModel) {
+                Q_EMIT parent->dataChanged(parent->index(lowerIndex, TransactionTableModel::Status), parent->index(upperIndex - 1, TransactionTableModel::Amount));
+            }
             break;
         }
     }
@@ -214,6 +237,25 @@ public:
         return cachedWallet.size();
     }
 
+    /* Runs [first, last] of rows whose status can still change with new blocks, in order. Once
+       a transaction is confirmed well enough or mature, only a reorg can change it, and the wallet
+       notifies that as an update.
+     */
+    std::vector<std::pair<int, int>> unsettledRows() const
+    {
+        std::vector<std::pair<int, int>> runs;
+        for (int i = 0; i < cachedWallet.size(); ++i) {
+            const TransactionStatus& status = cachedWallet[i].status;
+            if (status.status == TransactionStatus::Confirmed && !status.needsUpdate) continue;
+            if (!runs.empty() && runs.back().second == i - 1) {
+                runs.back().second = i;
+            } else {
+                runs.emplace_back(i, i);
+            }
+        }
+        return runs;
+    }
+
     TransactionRecord* index(interfaces::Wallet& wallet, const uint256& cur_block_hash, const int idx)
     {
         if (idx >= 0 && idx < cachedWallet.size()) {
@@ -260,6 +302,7 @@ TransactionTableModel::TransactionTableModel(const PlatformStyle *_platformStyle
 
     columns << QString() << QString() << tr("Date") << tr("Type") << tr("Label") << BitcoinUnits::getAmountColumnTitle(walletModel->getOptionsModel()->getDisplayUnit());
     priv->refreshWallet(walletModel->wallet());
+    if (!priv->m_loaded_all) QTimer::singleShot(0, this, &TransactionTableModel::loadMoreTransactions);
 
     connect(walletModel->getOptionsModel(), &OptionsModel::displayUnitChanged, this, &TransactionTableModel::updateDisplayUnit);
 }
@@ -289,10 +332,29 @@ void TransactionTableModel::updateConfirmations()
 {
     // Blocks came in since last poll.
     // Invalidate status (number of confirmations) and (possibly) description
-    //  for all rows. Qt is smart enough to only actually request the data for the
-    //  visible rows.
-    Q_EMIT dataChanged(index(0, Status), index(priv->size()-1, Status));
-    Q_EMIT dataChanged(index(0, ToAddress), index(priv->size()-1, ToAddress));
+    //  for the rows whose status can still change. Qt is smart enough to only
+    //  actually request the data for the visible rows.
+    for (const auto& [first, last] : priv->unsettledRows()) {
+        Q_EMIT dataChanged(index(first, Status), index(last, Status));
+        Q_EMIT dataChanged(index(first, ToAddress), index(last, ToAddress));
+    }
+}
+
+void TransactionTableModel::loadMoreTransactions()
+{
+    priv->loadWindow(walletModel->wallet());
+    // Leave the event loop a turn between windows to keep the GUI responsive
+    if (!priv->m_loaded_all) QTimer::singleShot(0, this, &TransactionTableModel::loadMoreTransactions);
+}
+
+bool TransactionTableModel::canFetchMore(const QModelIndex &parent) const
+{
+    return !parent.isValid() && !priv->m_loaded_all;
+}
+
+void TransactionTableModel::fetchMore(const QModelIndex &parent)
+{
+    if (!parent.isValid()) priv->loadWindow(walletModel->wallet());
 }
 
 int TransactionTableModel::rowCount(const QModelIndex &parent) const
@@ -34,6 +34,7 @@
 #include <QDebug>
 #include <QMessageBox>
 #include <QSet>
+#include <QThread>
 #include <QTimer>
 
 using wallet::CCoinControl;
@@ -49,8 +50,7 @@ WalletModel::WalletModel(std::unique_ptr<interfaces::Wallet> wallet, ClientModel
     addressTableModel(nullptr),
     transactionTableModel(nullptr),
     recentRequestsTableModel(nullptr),
-    cachedEncryptionStatus(Unencrypted),
-    timer(new QTimer(this))
+    cachedEncryptionStatus(Unencrypted)
 {
     fHaveWatchOnly = m_wallet->haveWatchOnly();
     addressTableModel = new AddressTableModel(this);
@@ -62,6 +62,7 @@ WalletModel::WalletModel(std::unique_ptr<interfaces::Wallet> wallet, ClientModel
 
 WalletModel::~WalletModel()
 {
+    stopPollBalance();
     unsubscribeFromCoreSignals();
 }
 
@@ -71,18 +72,37 @@ void WalletModel::startPollBalance()
     // so them don't need to waste resources recalculating it.
     pollBalanceChanged();
 
-    // This timer will be fired repeatedly to update the balance
+    if (!m_client_model || timer) return;
+
+    // This timer will be fired repeatedly on the poll thread of the client
+    // model to update the balance, so that the wallet is not queried on the
+    // main event loop.
     // Since the QTimer::timeout is a private signal, it cannot be used
     // in the GUIUtil::ExceptionSafeConnect directly.
-    connect(timer, &QTimer::timeout, this, &WalletModel::timerTimeout);
-    GUIUtil::ExceptionSafeConnect(this, &WalletModel::timerTimeout, this, &WalletModel::pollBalanceChanged);
-    timer->start(MODEL_UPDATE_DELAY);
+    timer = new QTimer;
+    timer->setInterval(MODEL_UPDATE_DELAY);
+    connect(timer, &QTimer::timeout, this, &WalletModel::timerTimeout, Qt::DirectConnection);
+    GUIUtil::ExceptionSafeConnect(this, &WalletModel::timerTimeout, this, &WalletModel::pollBalanceInBackground, Qt::DirectConnection);
+    timer->moveToThread(m_client_model->pollThread());
+    QMetaObject::invokeMethod(timer, [timer = timer] { timer->start(); });
+}
+
+void WalletModel::stopPollBalance()
+{
+    if (!timer) return;
+    // Stop the timer on its thread and wait for it, so that no poll is
+    // running or started once this returns.
+    if (timer->thread()->isRunning()) {
+        QMetaObject::invokeMethod(timer, [timer = timer] { timer->stop(); }, Qt::BlockingQueuedConnection);
+    }
+    timer->deleteLater();
+    timer = nullptr;
 }
 
 void WalletModel::setClientModel(ClientModel* client_model)
 {
+    if (!client_model) stopPollBalance();
     m_client_model = client_model;
-    if (!m_client_model) timer->stop();
 }
 
 void WalletModel::updateStatus()
@@ -96,9 +116,43 @@ void WalletModel::updateStatus()
 
 void WalletModel::pollBalanceChanged()
 {
+    std::optional<interfaces::WalletBalances> new_balances;
+    {
+        LOCK(m_poll_mutex);
+        new_balances = pollBalances();
+        if (new_balances) m_pending_balances.reset();
+    }
+    if (new_balances) updateBalances(*new_balances);
+}
+
+void WalletModel::pollBalanceInBackground()
+{
+    LOCK(m_poll_mutex);
+    auto new_balances{pollBalances()};
+    if (!new_balances) return;
+
+    // Only post an update if none is pending, so that a busy GUI thread
+    // applies the newest balances once instead of every poll in turn.
+    const bool posted{m_pending_balances.has_value()};
+    m_pending_balances = *new_balances;
+    if (!posted) {
+        QMetaObject::invokeMethod(this, [this] { applyPendingBalances(); }, Qt::QueuedConnection);
+    }
+}
+
+void WalletModel::applyPendingBalances()
+{
+    std::optional<interfaces::WalletBalances> new_balances;
+    WITH_LOCK(m_poll_mutex, new_balances.swap(m_pending_balances));
+    if (new_balances) updateBalances(*new_balances);
+}
+
+std::optional<interfaces::WalletBalances> WalletModel::pollBalances()
+{
+    AssertLockHeld(m_poll_mutex);
     // Avoid recomputing wallet balances unless a TransactionChanged or
     // BlockTip notification was received.
-    if (!fForceCheckBalanceChanged && m_cached_last_update_tip == getLastBlockProcessed()) return;
+    if (!fForceCheckBalanceChanged && m_cached_last_update_tip == getLastBlockProcessed()) return std::nullopt;
 
     // Try to get balances and return early if locks can't be acquired. This
     // avoids the GUI from getting stuck on periodical polls if the core is
@@ -107,19 +161,22 @@ void WalletModel::pollBalanceChanged()
     interfaces::WalletBalances new_balances;
     uint256 block_hash;
     if (!m_wallet->tryGetBalances(new_balances, block_hash)) {
-        return;
+        return std::nullopt;
     }
 
-    if (fForceCheckBalanceChanged || block_hash != m_cached_last_update_tip) {
-        fForceCheckBalanceChanged = false;
-
+    if (fForceCheckBalanceChanged.exchange(false) || block_hash != m_cached_last_update_tip) {
         // Balance and number of transactions might have changed
         m_cached_last_update_tip = block_hash;
-
-        checkBalanceChanged(new_balances);
-        if(transactionTableModel)
-            transactionTableModel->updateConfirmations();
+        return new_balances;
     }
+    return std::nullopt;
+}
+
+void WalletModel::updateBalances(const interfaces::WalletBalances& new_balances)
+{
+    checkBalanceChanged(new_balances);
+    if(transactionTableModel)
+        transactionTableModel->updateConfirmations();
 }
 
 void WalletModel::checkBalanceChanged(const interfaces::WalletBalances& new_balances)
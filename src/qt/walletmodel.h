@@ -16,7 +16,10 @@
 
 #include <interfaces/wallet.h>
 #include <support/allocators/secure.h>
+#include <sync.h>
 
+#include <atomic>
+#include <optional>
 #include <vector>
 
 #include <QObject>
@@ -175,7 +178,7 @@ private:
     interfaces::Node& m_node;
 
     bool fHaveWatchOnly;
-    bool fForceCheckBalanceChanged{false};
+    std::atomic<bool> fForceCheckBalanceChanged{false};
 
     // Wallet has an options model for wallet-specific options
     // (transaction fee, for example)
@@ -188,14 +191,25 @@ private:
     // Cache some values to be able to detect changes
     interfaces::WalletBalances m_cached_balances;
     EncryptionStatus cachedEncryptionStatus;
-    QTimer* timer;
+    //! Fires on the poll thread of the client model while the balance is polled
+    QTimer* timer{nullptr};
 
+    Mutex m_poll_mutex;
     // Block hash denoting when the last balance update was done.
-    uint256 m_cached_last_update_tip{};
+    uint256 m_cached_last_update_tip GUARDED_BY(m_poll_mutex){};
+    //! Newest balances polled on the poll thread which are not applied yet
+    std::optional<interfaces::WalletBalances> m_pending_balances GUARDED_BY(m_poll_mutex);
 
     void subscribeToCoreSignals();
     void unsubscribeFromCoreSignals();
     void checkBalanceChanged(const interfaces::WalletBalances& new_balances);
+    //! Return the balances if they might have changed since the last poll and the wallet is not busy
+    std::optional<interfaces::WalletBalances> pollBalances() EXCLUSIVE_LOCKS_REQUIRED(m_poll_mutex);
+    //! Poll the balances on the poll thread and post them to the GUI thread
+    void pollBalanceInBackground() EXCLUSIVE_LOCKS_REQUIRED(!m_poll_mutex);
+    void applyPendingBalances() EXCLUSIVE_LOCKS_REQUIRED(!m_poll_mutex);
+    void updateBalances(const interfaces::WalletBalances& new_balances);
+    void stopPollBalance();
 
 Q_SIGNALS:
     // Signal that balance in wallet changed
@@ -242,7 +256,7 @@ public Q_SLOTS:
     /* Watch-only added */
     void updateWatchOnlyFlag(bool fHaveWatchonly);
     /* Current, immature or unconfirmed balance might have changed - emit 'balanceChanged' if so */
-    void pollBalanceChanged();
+    void pollBalanceChanged() EXCLUSIVE_LOCKS_REQUIRED(!m_poll_mutex);
 };
 
 #endif // BITCOIN_QT_WALLETMODEL_H
@@ -584,9 +584,20 @@ void RandAddEvent(const uint32_t event_info) noexcept { GetRNGState().AddEvent(e
 
 bool g_mock_deterministic_tests{false};
 
+/** Draws of GetRandInternal() after which the context of a thread is seeded anew. */
+static constexpr unsigned int RAND_THREAD_RESEED_INTERVAL{1024};
+
 uint64_t GetRandInternal(uint64_t nMax) noexcept
 {
-    return FastRandomContext(g_mock_deterministic_tests).randrange(nMax);
+    if (g_mock_deterministic_tests) return FastRandomContext(true).randrange(nMax);
+    static thread_local FastRandomContext t_rng;
+    static thread_local unsigned int t_draws{0};
+    if (++t_draws == RAND_THREAD_RESEED_INTERVAL) {
+        // Moved-from contexts are reseeded on their next use
+        t_rng = FastRandomContext{};
+        t_draws = 0;
+    }
+    return t_rng.randrange(nMax);
 }
 
 uint256 GetRandHash() noexcept
@@ -609,7 +620,7 @@ uint256 FastRandomContext::rand256() noexcept
         FillByteBuffer();
     }
     uint256 ret;
-    memcpy(ret.begin(), bytebuf + 64 - bytebuf_size, 32);
+    memcpy(ret.begin(), bytebuf + sizeof(bytebuf) - bytebuf_size, 32);
     bytebuf_size -= 32;
     return ret;
 }
@@ -69,7 +69,12 @@
  * Thread-safe.
  */
 void GetRandBytes(Span<unsigned char> bytes) noexcept;
-/** Generate a uniform random integer in the range [0..range). Precondition: range > 0 */
+/**
+ * Generate a uniform random integer in the range [0..range). Precondition: range > 0
+ *
+ * Drawn from a FastRandomContext of the calling thread, which is reseeded from
+ * the internal PRNG every 1024 draws, so that most draws do not take a lock.
+ */
 uint64_t GetRandInternal(uint64_t nMax) noexcept;
 /** Generate a uniform random integer of type T in the range [0..nMax)
  *  nMax defaults to std::numeric_limits<T>::max()
@@ -145,7 +150,9 @@ private:
     bool requires_seed;
     ChaCha20 rng;
 
-    unsigned char bytebuf[64];
+    //! ChaCha20 blocks generated per refill, so that the fixed cost of a Keystream() call is shared
+    static constexpr int BYTEBUF_BLOCKS{4};
+    unsigned char bytebuf[64 * BYTEBUF_BLOCKS];
     int bytebuf_size;
 
     uint64_t bitbuf;
@@ -186,7 +193,7 @@ public:
     uint64_t rand64() noexcept
     {
         if (bytebuf_size < 8) FillByteBuffer();
-        uint64_t ret = ReadLE64(bytebuf + 64 - bytebuf_size);
+        uint64_t ret = ReadLE64(bytebuf + sizeof(bytebuf) - bytebuf_size);
         bytebuf_size -= 8;
         return ret;
     }
@@ -9,16 +9,19 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <core_io.h>
+#include <hash.h>
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
 #include <index/txindex.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <node/headerstore.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <rpc/blockchain.h>
 #include <rpc/mempool.h>
 #include <rpc/protocol.h>
+#include <rpc/request.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <streams.h>
@@ -35,11 +38,19 @@
 #include <univalue.h>
 
 using node::GetTransaction;
+using node::HeaderStore;
+using node::g_header_store;
 using node::NodeContext;
 using node::ReadBlockFromDisk;
+using node::ReadRawBlockFromDisk;
 
 static const size_t MAX_GETUTXOS_OUTPOINTS = 15; //allow a max of 15 outpoints to be queried at once
 static constexpr unsigned int MAX_REST_HEADERS_RESULTS = 2000;
+//! Maximum number of blocks and headers of a range request, which are streamed
+static constexpr unsigned int MAX_REST_BLOCK_RANGE_RESULTS = 1000;
+static constexpr unsigned int MAX_REST_HEADER_RANGE_RESULTS = 100000;
+//! Size above which the parts of a streamed reply are sent
+static constexpr size_t REST_STREAM_FLUSH_SIZE{64 * 1024};
 
 static const struct {
     RESTResponseFormat rf;
@@ -72,6 +83,16 @@ static bool RESTERR(HTTPRequest* req, enum HTTPStatusCode status, std::string me
     return false;
 }
 
+/** Sink sending a JSON document, streamed in pieces, as the reply to a request */
+static JSONStreamWriter::Sink JSONReplySink(HTTPRequest* req)
+{
+    return [req](std::string&& data, bool last) {
+        if (!req->IsReplyStarted()) req->WriteHeader("Content-Type", "application/json");
+        if (last) data += "\n";
+        req->WriteReplyPart(HTTP_OK, data, last);
+    };
+}
+
 /**
  * Get the node context.
  *
@@ -217,20 +238,39 @@ static bool rest_headers(const std::any& context,
     const CBlockIndex* tip = nullptr;
     std::vector<const CBlockIndex*> headers;
     headers.reserve(*parsed_count);
+    // In -headersonly mode the headers follow the best header chain, and are
+    // copied from the records of the header store
+    std::vector<unsigned char> records;
+    size_t num_records{0};
     {
         ChainstateManager* maybe_chainman = GetChainman(context, req);
         if (!maybe_chainman) return false;
         ChainstateManager& chainman = *maybe_chainman;
         LOCK(cs_main);
-        CChain& active_chain = chainman.ActiveChain();
-        tip = active_chain.Tip();
         const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(hash);
-        while (pindex != nullptr && active_chain.Contains(pindex)) {
-            headers.push_back(pindex);
-            if (headers.size() == *parsed_count) {
-                break;
+        if (g_header_store) {
+            tip = chainman.m_best_header;
+            if (pindex != nullptr && g_header_store->Contains(pindex->nHeight, hash)) {
+                num_records = g_header_store->Read(pindex->nHeight, *parsed_count, records);
+            }
+            if (rf == RESTResponseFormat::JSON) {
+                for (size_t i = 0; i < num_records; ++i) {
+                    const unsigned char* header{records.data() + i * HeaderStore::RECORD_SIZE};
+                    const CBlockIndex* record_index{chainman.m_blockman.LookupBlockIndex(Hash(Span{header, HeaderStore::HEADER_SIZE}))};
+                    if (record_index == nullptr) break;
+                    headers.push_back(record_index);
+                }
+            }
+        } else {
+            CChain& active_chain = chainman.ActiveChain();
+            tip = active_chain.Tip();
+            while (pindex != nullptr && active_chain.Contains(pindex)) {
+                headers.push_back(pindex);
+                if (headers.size() == *parsed_count) {
+                    break;
+                }
+                pindex = active_chain.Next(pindex);
             }
-            pindex = active_chain.Next(pindex);
         }
     }
 
@@ -240,6 +280,9 @@ static bool rest_headers(const std::any& context,
         for (const CBlockIndex *pindex : headers) {
             ssHeader << pindex->GetBlockHeader();
         }
+        for (size_t i = 0; i < num_records; ++i) {
+            ssHeader << Span{records.data() + i * HeaderStore::RECORD_SIZE, HeaderStore::HEADER_SIZE};
+        }
 
         std::string binaryHeader = ssHeader.str();
         req->WriteHeader("Content-Type", "application/octet-stream");
@@ -252,6 +295,9 @@ static bool rest_headers(const std::any& context,
         for (const CBlockIndex *pindex : headers) {
             ssHeader << pindex->GetBlockHeader();
         }
+        for (size_t i = 0; i < num_records; ++i) {
+            ssHeader << Span{records.data() + i * HeaderStore::RECORD_SIZE, HeaderStore::HEADER_SIZE};
+        }
 
         std::string strHex = HexStr(ssHeader) + "\n";
         req->WriteHeader("Content-Type", "text/plain");
@@ -329,10 +375,9 @@ static bool rest_block(const std::any& context,
     }
 
     case RESTResponseFormat::JSON: {
-        UniValue objBlock = blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
-        std::string strJSON = objBlock.write() + "\n";
-        req->WriteHeader("Content-Type", "application/json");
-        req->WriteReply(HTTP_OK, strJSON);
+        JSONStreamWriter writer{JSONReplySink(req)};
+        blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity, writer);
+        writer.Finish();
         return true;
     }
 
@@ -606,12 +651,13 @@ static bool rest_mempool(const std::any& context, HTTPRequest* req, const std::s
 
     switch (rf) {
     case RESTResponseFormat::JSON: {
-        std::string str_json;
         if (param == "contents") {
-            str_json = MempoolToJSON(*mempool, true).write() + "\n";
-        } else {
-            str_json = MempoolInfoToJSON(*mempool).write() + "\n";
+            JSONStreamWriter writer{JSONReplySink(req)};
+            MempoolToJSON(*mempool, writer);
+            writer.Finish();
+            return true;
         }
+        std::string str_json = MempoolInfoToJSON(*mempool).write() + "\n";
 
         req->WriteHeader("Content-Type", "application/json");
         req->WriteReply(HTTP_OK, str_json);
@@ -926,6 +972,134 @@ static bool rest_blockhash_by_height(const std::any& context, HTTPRequest* req,
     }
 }
 
+/** Parse the inclusive <start>/<end> heights of a range request of at most max_count entries */
+static bool ParseHeightRange(HTTPRequest* req, const std::string& param, unsigned int max_count, int32_t& start, int32_t& end)
+{
+    const std::vector<std::string> path = SplitString(param, '/');
+    if (path.size() != 2 || !ParseInt32(path[0], &start) || !ParseInt32(path[1], &end) || start < 0 || end < start) {
+        return RESTERR(req, HTTP_BAD_REQUEST, "Invalid URI format. Expected <start>/<end>.<ext> with 0 <= start <= end");
+    }
+    if (uint32_t(end - start) >= max_count) {
+        return RESTERR(req, HTTP_BAD_REQUEST, strprintf("Range is too large, at most %u entries can be requested", max_count));
+    }
+    return true;
+}
+
+/** Send the next part of a streamed reply, writing its content type first */
+static void WriteRangePart(HTTPRequest* req, RESTResponseFormat rf, const std::string& part, bool last)
+{
+    if (!req->IsReplyStarted()) req->WriteHeader("Content-Type", rf == RESTResponseFormat::BINARY ? "application/octet-stream" : "text/plain");
+    req->WriteReplyPart(HTTP_OK, part, last);
+}
+
+/**
+ * Stream the serialized blocks of a range of heights of the active chain, as a chunked reply
+ * of the raw block files. The blocks are neither deserialized nor checked again. A reply
+ * holding fewer blocks than requested was cut short because a block could not be read.
+ */
+static bool rest_block_range(const std::any& context, HTTPRequest* req, const std::string& str_uri_part)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, str_uri_part);
+    if (rf != RESTResponseFormat::BINARY && rf != RESTResponseFormat::HEX) {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: bin, hex)");
+    }
+    int32_t start, end;
+    if (!ParseHeightRange(req, param, MAX_REST_BLOCK_RANGE_RESULTS, start, end)) return false;
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    ChainstateManager& chainman = *maybe_chainman;
+    std::vector<FlatFilePos> positions;
+    {
+        LOCK(cs_main);
+        const CChain& active_chain = chainman.ActiveChain();
+        if (end > active_chain.Height()) {
+            return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+        }
+        positions.reserve(end - start + 1);
+        for (int32_t height = start; height <= end; ++height) {
+            const CBlockIndex* pindex = active_chain[height];
+            if (chainman.m_blockman.IsBlockPruned(pindex) || !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                return RESTERR(req, HTTP_NOT_FOUND, pindex->GetBlockHash().GetHex() + " not available (pruned data)");
+            }
+            positions.push_back(pindex->GetBlockPos());
+        }
+    }
+
+    const auto& message_start = chainman.GetParams().MessageStart();
+    for (size_t i = 0; i < positions.size(); ++i) {
+        node::RawBlock block;
+        if (!ReadRawBlockFromDisk(block, positions[i], message_start)) {
+            if (!req->IsReplyStarted()) return RESTERR(req, HTTP_NOT_FOUND, "Block at height " + ToString(start + i) + " not found");
+            LogPrint(BCLog::HTTP, "Block range reply cut short at height %d\n", start + i);
+            return false;
+        }
+        const bool last{i + 1 == positions.size()};
+        if (rf == RESTResponseFormat::HEX) {
+            WriteRangePart(req, rf, HexStr(block.data) + "\n", last);
+            continue;
+        }
+        // Send straight from the block file, or the buffer the block was read into
+        if (!req->IsReplyStarted()) req->WriteHeader("Content-Type", "application/octet-stream");
+        req->WriteReplyPart(HTTP_OK, block.data, std::move(block.owner), last);
+    }
+    return true;
+}
+
+/**
+ * Stream the serialized headers of a range of heights of the active chain, as a chunked reply.
+ * cs_main is only held to collect each part. A reply holding fewer headers than requested was
+ * cut short because the chain was reorganized below the headers left to send.
+ */
+static bool rest_header_range(const std::any& context, HTTPRequest* req, const std::string& str_uri_part)
+{
+    if (!CheckWarmup(req)) return false;
+    std::string param;
+    const RESTResponseFormat rf = ParseDataFormat(param, str_uri_part);
+    if (rf != RESTResponseFormat::BINARY && rf != RESTResponseFormat::HEX) {
+        return RESTERR(req, HTTP_NOT_FOUND, "output format not found (available: bin, hex)");
+    }
+    int32_t start, end;
+    if (!ParseHeightRange(req, param, MAX_REST_HEADER_RANGE_RESULTS, start, end)) return false;
+
+    ChainstateManager* maybe_chainman = GetChainman(context, req);
+    if (!maybe_chainman) return false;
+    ChainstateManager& chainman = *maybe_chainman;
+    const CBlockIndex* prev{nullptr};
+    for (int32_t height = start; height <= end;) {
+        CDataStream ss_headers(SER_NETWORK, PROTOCOL_VERSION);
+        std::string hex_headers;
+        {
+            LOCK(cs_main);
+            const CChain& active_chain = chainman.ActiveChain();
+            if (height == start && end > active_chain.Height()) {
+                return RESTERR(req, HTTP_NOT_FOUND, "Block height out of range");
+            }
+            // Stop rather than mix the headers of two chains
+            if (prev && active_chain[height - 1] != prev) {
+                LogPrint(BCLog::HTTP, "Header range reply cut short at height %d\n", height);
+                return false;
+            }
+            for (; height <= end && ss_headers.size() < REST_STREAM_FLUSH_SIZE; ++height) {
+                prev = active_chain[height];
+                if (!prev) {
+                    LogPrint(BCLog::HTTP, "Header range reply cut short at height %d\n", height);
+                    return false;
+                }
+                const size_t offset{ss_headers.size()};
+                ss_headers << prev->GetBlockHeader();
+                if (rf == RESTResponseFormat::HEX) {
+                    hex_headers += HexStr(Span{ss_headers}.subspan(offset)) + "\n";
+                }
+            }
+        }
+        WriteRangePart(req, rf, rf == RESTResponseFormat::HEX ? hex_headers : ss_headers.str(), /*last=*/height > end);
+    }
+    return true;
+}
+
 static const struct {
     const char* prefix;
     bool (*handler)(const std::any& context, HTTPRequest* req, const std::string& strReq);
@@ -940,6 +1114,8 @@ static const struct {
       {"/rest/headers/", rest_headers},
       {"/rest/getutxos", rest_getutxos},
       {"/rest/blockhashbyheight/", rest_blockhash_by_height},
+      {"/rest/blockrange/", rest_block_range},
+      {"/rest/headerrange/", rest_header_range},
 };
 
 void StartREST(const std::any& context)
@@ -15,24 +15,36 @@
 #include <consensus/validation.h>
 #include <script/signingprovider.h>
 #include <core_io.h>
+#include <cuckoocache.h>
 #include <deploymentinfo.h>
 #include <deploymentstatus.h>
 #include <fs.h>
 #include <hash.h>
+#include <key_io.h>
+#include <index/addressindex.h>
 #include <index/blockfilterindex.h>
+#include <index/blockstatsindex.h>
 #include <index/coinstatsindex.h>
+#include <index/spentindex.h>
+#include <index/txindex.h>
 #include <kernel/coinstats.h>
 #include <logging/timer.h>
+#include <memusage.h>
 #include <net.h>
 #include <net_processing.h>
 #include <node/blockstorage.h>
 #include <node/context.h>
+#include <node/headers_file.h>
 #include <node/utxo_snapshot.h>
+#include <powcache.h>
 #include <primitives/transaction.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
 #include <script/descriptor.h>
+#include <script/sigcache.h>
+#include <script/standard.h>
+#include <shutdown.h>
 #include <streams.h>
 #include <sync.h>
 #include <txdb.h>
@@ -40,8 +52,11 @@
 #include <undo.h>
 #include <univalue.h>
 #include <util/check.h>
+#include <util/hasher.h>
 #include <util/strencodings.h>
+#include <util/string.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <validation.h>
 #include <validationinterface.h>
@@ -50,16 +65,26 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <condition_variable>
+#include <functional>
+#include <map>
 #include <memory>
 #include <mutex>
+#include <thread>
+#include <unordered_set>
 
 using kernel::CCoinsStats;
 using kernel::CoinStatsHashType;
 
 using node::BlockManager;
+using node::CompactBlockUndo;
+using node::GetSnapshotChunkSize;
 using node::NodeContext;
-using node::ReadBlockFromDisk;
+using node::SerializeSnapshotChunk;
+using node::SNAPSHOT_CHUNK_SIZE;
+using node::SnapshotChunkInfo;
+using node::SnapshotCoins;
 using node::SnapshotMetadata;
 using node::UndoReadFromDisk;
 
@@ -72,6 +97,8 @@ struct CUpdatedBlock
 static GlobalMutex cs_blockchange;
 static std::condition_variable cond_blockchange;
 static CUpdatedBlock latestblock GUARDED_BY(cs_blockchange);
+// Read with std::atomic_load, so the RPCs polling the tip need no cs_main on a hit
+static std::shared_ptr<TipStatsCache> g_tip_stats_cache;
 
 /* Calculate the difficulty for a given block index.
  */
@@ -164,43 +191,80 @@ UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex
     return result;
 }
 
-UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+/** The fields of blockToJSON before the transactions */
+static UniValue blockSummaryToJSON(const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex)
 {
     UniValue result = blockheaderToJSON(tip, blockindex);
 
     result.pushKV("strippedsize", (int)::GetSerializeSize(block, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
     result.pushKV("size", (int)::GetSerializeSize(block, PROTOCOL_VERSION));
     result.pushKV("weight", (int)::GetBlockWeight(block));
-    UniValue txs(UniValue::VARR);
+    return result;
+}
 
+/** Pass the entries of the "tx" array of blockToJSON to fn, one at a time */
+static void blockTxsToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* blockindex, TxVerbosity verbosity, const std::function<void(UniValue&&)>& fn)
+{
     switch (verbosity) {
         case TxVerbosity::SHOW_TXID:
             for (const CTransactionRef& tx : block.vtx) {
-                txs.push_back(tx->GetHash().GetHex());
+                fn(tx->GetHash().GetHex());
             }
             break;
 
         case TxVerbosity::SHOW_DETAILS:
         case TxVerbosity::SHOW_DETAILS_AND_PREVOUT:
-            CBlockUndo blockUndo;
-            const bool have_undo{WITH_LOCK(::cs_main, return !blockman.IsBlockPruned(blockindex) && UndoReadFromDisk(blockUndo, blockindex))};
+            // The undo data of each transaction is decoded just before it is
+            // output, unless that of the whole block is kept in memory anyway
+            const std::shared_ptr<const CBlockUndo> block_undo{blockman.GetRecentBlockUndo(blockindex->GetBlockHash())};
+            std::optional<CompactBlockUndo> compact_undo;
+            if (!block_undo && !WITH_LOCK(::cs_main, return blockman.IsBlockPruned(blockindex))) {
+                compact_undo.emplace();
+                if (!UndoReadFromDisk(*compact_undo, blockindex) || compact_undo->size() + 1 != block.vtx.size()) compact_undo.reset();
+            }
 
             for (size_t i = 0; i < block.vtx.size(); ++i) {
                 const CTransactionRef& tx = block.vtx.at(i);
                 // coinbase transaction (i.e. i == 0) doesn't have undo data
-                const CTxUndo* txundo = (have_undo && i > 0) ? &blockUndo.vtxundo.at(i - 1) : nullptr;
+                const CTxUndo* txundo = (block_undo && i > 0) ? &block_undo->vtxundo.at(i - 1) : nullptr;
+                CTxUndo read_txundo;
+                if (compact_undo && i > 0) {
+                    try {
+                        read_txundo = compact_undo->GetTxUndo(i - 1);
+                        txundo = &read_txundo;
+                    } catch (const std::ios_base::failure&) {
+                        // Output the transaction without its prevouts, as when the undo data cannot be read
+                    }
+                }
                 UniValue objTx(UniValue::VOBJ);
                 TxToUniv(*tx, /*block_hash=*/uint256(), /*entry=*/objTx, /*include_hex=*/true, RPCSerializationFlags(), txundo, verbosity);
-                txs.push_back(objTx);
+                fn(std::move(objTx));
             }
             break;
     }
+}
 
+UniValue blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity)
+{
+    UniValue result = blockSummaryToJSON(block, tip, blockindex);
+    UniValue txs(UniValue::VARR);
+    blockTxsToJSON(blockman, block, blockindex, verbosity, [&](UniValue&& tx) { txs.push_back(std::move(tx)); });
     result.pushKV("tx", txs);
 
     return result;
 }
 
+void blockToJSON(BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity, JSONStreamWriter& writer)
+{
+    writer.BeginObject();
+    writer.Fields(blockSummaryToJSON(block, tip, blockindex));
+    writer.Key("tx");
+    writer.BeginArray();
+    blockTxsToJSON(blockman, block, blockindex, verbosity, [&](UniValue&& tx) { writer.Value(tx); });
+    writer.EndArray();
+    writer.EndObject();
+}
+
 static RPCHelpMan getblockcount()
 {
     return RPCHelpMan{"getblockcount",
@@ -216,6 +280,7 @@ static RPCHelpMan getblockcount()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    if (const auto snapshot{chainman.TipSnapshot()}) return snapshot->height;
     LOCK(cs_main);
     return chainman.ActiveChain().Height();
 },
@@ -236,6 +301,7 @@ static RPCHelpMan getbestblockhash()
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    if (const auto snapshot{chainman.TipSnapshot()}) return snapshot->tip->GetBlockHash().GetHex();
     LOCK(cs_main);
     return chainman.ActiveChain().Tip()->GetBlockHash().GetHex();
 },
@@ -244,6 +310,9 @@ static RPCHelpMan getbestblockhash()
 
 void RPCNotifyBlockChange(const CBlockIndex* pindex)
 {
+    // Called synchronously on tip changes, so a caller that connected a block never reads
+    // the values of the previous tip afterwards
+    std::atomic_store(&g_tip_stats_cache, pindex ? std::make_shared<TipStatsCache>(pindex) : nullptr);
     if(pindex) {
         LOCK(cs_blockchange);
         latestblock.hash = pindex->GetBlockHash();
@@ -252,6 +321,11 @@ void RPCNotifyBlockChange(const CBlockIndex* pindex)
     cond_blockchange.notify_all();
 }
 
+std::shared_ptr<TipStatsCache> GetTipStatsCache()
+{
+    return std::atomic_load(&g_tip_stats_cache);
+}
+
 static RPCHelpMan waitfornewblock()
 {
     return RPCHelpMan{"waitfornewblock",
@@ -404,6 +478,44 @@ static RPCHelpMan syncwithvalidationinterfacequeue()
     };
 }
 
+static RPCHelpMan getvalidationinterfaceinfo()
+{
+    return RPCHelpMan{"getvalidationinterfaceinfo",
+                "\nReturns the queue of validation notifications of each subscriber.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::ARR, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR, "name", "name of the subscriber"},
+                            {RPCResult::Type::NUM, "pending", "number of notifications waiting for the subscriber"},
+                            {RPCResult::Type::NUM, "delivered", "number of notifications the subscriber processed"},
+                            {RPCResult::Type::NUM, "last_lag", "time the last notification waited in the queue, in microseconds"},
+                            {RPCResult::Type::NUM, "max_lag", "longest time a notification waited in the queue, in microseconds"},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getvalidationinterfaceinfo","")
+            + HelpExampleRpc("getvalidationinterfaceinfo","")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue result(UniValue::VARR);
+    for (const ValidationSubscriberStats& stats : GetMainSignals().GetSubscriberStats()) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("name", stats.name);
+        obj.pushKV("pending", (uint64_t)stats.pending);
+        obj.pushKV("delivered", stats.delivered);
+        obj.pushKV("last_lag", count_microseconds(stats.last_lag));
+        obj.pushKV("max_lag", count_microseconds(stats.max_lag));
+        result.push_back(obj);
+    }
+    return result;
+},
+    };
+}
+
 static RPCHelpMan getdifficulty()
 {
     return RPCHelpMan{"getdifficulty",
@@ -417,6 +529,7 @@ static RPCHelpMan getdifficulty()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    if (const auto tip_stats{GetTipStatsCache()}) return tip_stats->difficulty;
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
     LOCK(cs_main);
     return GetDifficulty(chainman.ActiveChain().Tip());
@@ -576,34 +689,34 @@ static RPCHelpMan getblockheader()
 static CBlock GetBlockChecked(BlockManager& blockman, const CBlockIndex* pblockindex) EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
 {
     AssertLockHeld(::cs_main);
-    CBlock block;
     if (blockman.IsBlockPruned(pblockindex)) {
         throw JSONRPCError(RPC_MISC_ERROR, "Block not available (pruned data)");
     }
 
-    if (!ReadBlockFromDisk(block, pblockindex, Params().GetConsensus())) {
+    const std::shared_ptr<const CBlock> block{blockman.ReadBlock(*pblockindex, Params().GetConsensus())};
+    if (!block) {
         // Block not found on disk. This could be because we have the block
         // header in our index but not yet have the block or did not accept the
         // block.
         throw JSONRPCError(RPC_MISC_ERROR, "Block not found on disk");
     }
 
-    return block;
+    return *block;
 }
 
 static CBlockUndo GetUndoChecked(BlockManager& blockman, const CBlockIndex* pblockindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
 {
     AssertLockHeld(::cs_main);
-    CBlockUndo blockUndo;
     if (blockman.IsBlockPruned(pblockindex)) {
         throw JSONRPCError(RPC_MISC_ERROR, "Undo data not available (pruned data)");
     }
 
-    if (!UndoReadFromDisk(blockUndo, pblockindex)) {
+    const std::shared_ptr<const CBlockUndo> block_undo{blockman.ReadBlockUndo(*pblockindex)};
+    if (!block_undo) {
         throw JSONRPCError(RPC_MISC_ERROR, "Can't read undo data from disk");
     }
 
-    return blockUndo;
+    return *block_undo;
 }
 
 const RPCResult getblock_vin{
@@ -744,6 +857,10 @@ static RPCHelpMan getblock()
         tx_verbosity = TxVerbosity::SHOW_DETAILS_AND_PREVOUT;
     }
 
+    if (request.result_stream) {
+        blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity, *request.result_stream);
+        return NullUniValue;
+    }
     return blockToJSON(chainman.m_blockman, block, tip, pblockindex, tx_verbosity);
 },
     };
@@ -760,6 +877,13 @@ static RPCHelpMan getcheckpoint()
                 {RPCResult::Type::NUM, "height", "The height of the checkpoint in blocks"},
                 {RPCResult::Type::NUM, "timestamp", "The timestamp of the checkpoint"},
                 {RPCResult::Type::BOOL, "checkpointnmaster", "Checkpoint key was used"},
+                {RPCResult::Type::OBJ, "autocheckpoint", /*optional=*/true, "Automatic checkpoint statistics (only for a checkpoint master)", {
+                    {RPCResult::Type::NUM, "checkpointdepth", "The depth below the tip at which checkpoints are selected"},
+                    {RPCResult::Type::NUM, "broadcasts", "The number of checkpoints signed and relayed"},
+                    {RPCResult::Type::NUM, "lastselectlatency", "The duration of the last checkpoint selection, in microseconds"},
+                    {RPCResult::Type::NUM, "lastbroadcastlatency", "The duration of the last checkpoint broadcast, in microseconds"},
+                    {RPCResult::Type::NUM, "avgbroadcastlatency", "The average duration of a checkpoint broadcast, in microseconds"},
+                }},
             } },
                 RPCExamples{
                     HelpExampleCli("getcheckpoint", "")
@@ -781,6 +905,17 @@ static RPCHelpMan getcheckpoint()
     }
     
     result.pushKV("checkpointmaster", gArgs.IsArgSet("-checkpointkey"));
+    if (!CSyncCheckpoint::strMasterPrivKey.empty())
+    {
+        const SyncCheckpointStats stats = GetSyncCheckpointStats();
+        UniValue autocheckpoint(UniValue::VOBJ);
+        autocheckpoint.pushKV("checkpointdepth", GetCheckpointDepth());
+        autocheckpoint.pushKV("broadcasts", stats.nBroadcasts);
+        autocheckpoint.pushKV("lastselectlatency", stats.nLastSelectMicros);
+        autocheckpoint.pushKV("lastbroadcastlatency", stats.nLastBroadcastMicros);
+        autocheckpoint.pushKV("avgbroadcastlatency", stats.nBroadcasts ? stats.nTotalBroadcastMicros / (int64_t)stats.nBroadcasts : 0);
+        result.pushKV("autocheckpoint", autocheckpoint);
+    }
 
     return result;
 },
@@ -940,7 +1075,7 @@ static RPCHelpMan gettxoutsetinfo()
 {
     return RPCHelpMan{"gettxoutsetinfo",
                 "\nReturns statistics about the unspent transaction output set.\n"
-                "Note this call may take some time if you are not using coinstatsindex.\n",
+                "Note this call may take some time if you are not using coinstatsindex, or -utxomuhash with hash_type 'muhash'.\n",
                 {
                     {"hash_type", RPCArg::Type::STR, RPCArg::Default{"hash_serialized_2"}, "Which UTXO set hash should be calculated. Options: 'hash_serialized_2' (the legacy algorithm), 'muhash', 'none'."},
                     {"hash_or_height", RPCArg::Type::NUM, RPCArg::DefaultHint{"the current best block"}, "The block hash or height of the target height (only available with coinstatsindex).", "", {"", "string or numeric"}},
@@ -955,7 +1090,7 @@ static RPCHelpMan gettxoutsetinfo()
                         {RPCResult::Type::NUM, "bogosize", "Database-independent, meaningless metric indicating the UTXO set size"},
                         {RPCResult::Type::STR_HEX, "hash_serialized_2", /*optional=*/true, "The serialized hash (only present if 'hash_serialized_2' hash_type is chosen)"},
                         {RPCResult::Type::STR_HEX, "muhash", /*optional=*/true, "The serialized hash (only present if 'muhash' hash_type is chosen)"},
-                        {RPCResult::Type::NUM, "transactions", /*optional=*/true, "The number of transactions with unspent outputs (not available when coinstatsindex is used)"},
+                        {RPCResult::Type::NUM, "transactions", /*optional=*/true, "The number of transactions with unspent outputs (not available when coinstatsindex or -utxomuhash is used)"},
                         {RPCResult::Type::NUM, "disk_size", /*optional=*/true, "The estimated size of the chainstate on disk (not available when coinstatsindex is used)"},
                         {RPCResult::Type::STR_AMOUNT, "total_amount", "The total amount of coins in the UTXO set"},
                         {RPCResult::Type::STR_AMOUNT, "total_unspendable_amount", /*optional=*/true, "The total amount of coins permanently excluded from the UTXO set (only available if coinstatsindex is used)"},
@@ -996,6 +1131,26 @@ static RPCHelpMan gettxoutsetinfo()
     NodeContext& node = EnsureAnyNodeContext(request.context);
     ChainstateManager& chainman = EnsureChainman(node);
     Chainstate& active_chainstate = chainman.ActiveChainstate();
+
+    // The MuHash kept up to date with -utxomuhash needs no flush or scan
+    if (hash_type == CoinStatsHashType::MUHASH && request.params[1].isNull() && !(index_requested && g_coin_stats_index)) {
+        LOCK(::cs_main);
+        if (active_chainstate.m_utxo_muhash) {
+            kernel::UTXOSetMuHash utxo_muhash{*active_chainstate.m_utxo_muhash};
+            uint256 muhash;
+            utxo_muhash.muhash.Finalize(muhash);
+            const CBlockIndex& tip{*CHECK_NONFATAL(active_chainstate.m_chain.Tip())};
+            ret.pushKV("height", tip.nHeight);
+            ret.pushKV("bestblock", tip.GetBlockHash().GetHex());
+            ret.pushKV("txouts", utxo_muhash.coins_count);
+            ret.pushKV("bogosize", utxo_muhash.bogo_size);
+            ret.pushKV("muhash", muhash.GetHex());
+            ret.pushKV("total_amount", ValueFromAmount(utxo_muhash.total_amount));
+            ret.pushKV("disk_size", active_chainstate.CoinsDB().EstimateSize());
+            return ret;
+        }
+    }
+
     active_chainstate.ForceFlushStateToDisk();
 
     CCoinsView* coins_view;
@@ -1177,24 +1332,49 @@ static RPCHelpMan verifychain()
                     {"checklevel", RPCArg::Type::NUM, RPCArg::DefaultHint{strprintf("%d, range=0-4", DEFAULT_CHECKLEVEL)},
                         strprintf("How thorough the block verification is:\n%s", MakeUnorderedList(CHECKLEVEL_DOC))},
                     {"nblocks", RPCArg::Type::NUM, RPCArg::DefaultHint{strprintf("%d, 0=all", DEFAULT_CHECKBLOCKS)}, "The number of blocks to check."},
+                    {"status", RPCArg::Type::BOOL, RPCArg::Default{false}, "Instead of verifying, return the status of the verification started at startup with -checkblocksbackground."},
+                },
+                {
+                    RPCResult{"if status is false",
+                        RPCResult::Type::BOOL, "", "Verified or not"},
+                    RPCResult{"if status is true",
+                        RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::BOOL, "running", "Whether the verification is still running"},
+                            {RPCResult::Type::NUM, "checklevel", "The -checklevel it runs at"},
+                            {RPCResult::Type::NUM, "nblocks", "The number of blocks it checks, 0 for all"},
+                            {RPCResult::Type::NUM, "progress", "The percentage of the verification that is done"},
+                            {RPCResult::Type::BOOL, "verified", "Whether the blocks were verified so far, or in the end if it finished"},
+                        }},
                 },
-                RPCResult{
-                    RPCResult::Type::BOOL, "", "Verified or not"},
                 RPCExamples{
                     HelpExampleCli("verifychain", "")
+            + HelpExampleCli("-named verifychain", "status=true")
             + HelpExampleRpc("verifychain", "")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
-    const int check_level{request.params[0].isNull() ? DEFAULT_CHECKLEVEL : request.params[0].getInt<int>()};
+    const int check_level{request.params[0].isNull() ? static_cast<int>(DEFAULT_CHECKLEVEL) : request.params[0].getInt<int>()};
     const int check_depth{request.params[1].isNull() ? DEFAULT_CHECKBLOCKS : request.params[1].getInt<int>()};
 
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
-    LOCK(cs_main);
+
+    if (!request.params[2].isNull() && request.params[2].get_bool()) {
+        const VerifyDBStatus& status{chainman.m_verify_blocks_status};
+        const bool running{status.running};
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("running", running);
+        ret.pushKV("checklevel", status.check_level.load());
+        ret.pushKV("nblocks", status.check_blocks.load());
+        ret.pushKV("progress", running ? status.progress.load() : 100);
+        ret.pushKV("verified", status.ok.load());
+        return ret;
+    }
 
     Chainstate& active_chainstate = chainman.ActiveChainstate();
+    CCoinsViewCache& coins_tip = WITH_LOCK(cs_main, return active_chainstate.CoinsTip());
     return CVerifyDB().VerifyDB(
-        active_chainstate, chainman.GetParams().GetConsensus(), active_chainstate.CoinsTip(), check_level, check_depth);
+        active_chainstate, chainman.GetParams().GetConsensus(), coins_tip, check_level, check_depth);
 },
     };
 }
@@ -1309,6 +1489,14 @@ RPCHelpMan getblockchaininfo()
                 {RPCResult::Type::NUM, "pruneheight", /*optional=*/true, "height of the last block pruned, plus one (only present if pruning is enabled)"},
                 {RPCResult::Type::BOOL, "automatic_pruning", /*optional=*/true, "whether automatic pruning is enabled (only present if pruning is enabled)"},
                 {RPCResult::Type::NUM, "prune_target_size", /*optional=*/true, "the target size used by pruning (only present if automatic pruning is enabled)"},
+                {RPCResult::Type::OBJ, "backgroundvalidation", /*optional=*/true, "the validation of the blocks below an assumeutxo snapshot (only present while it is in progress)",
+                {
+                    {RPCResult::Type::NUM, "snapshotheight", "the height of the snapshot's block"},
+                    {RPCResult::Type::NUM, "blocks", "the height of the background chain"},
+                    {RPCResult::Type::STR_HEX, "bestblockhash", "the hash of the tip of the background chain"},
+                    {RPCResult::Type::NUM, "progress", "the fraction of the snapshot's height validated [0..1]"},
+                    {RPCResult::Type::NUM, "eta", /*optional=*/true, "estimate of the seconds left, from the rate since the background validation started"},
+                }},
                 {RPCResult::Type::STR, "warnings", "any network and blockchain warnings"},
             }},
         RPCExamples{
@@ -1329,7 +1517,8 @@ RPCHelpMan getblockchaininfo()
     obj.pushKV("blocks", height);
     obj.pushKV("headers", chainman.m_best_header ? chainman.m_best_header->nHeight : -1);
     obj.pushKV("bestblockhash", tip.GetBlockHash().GetHex());
-    obj.pushKV("difficulty", GetDifficulty(&tip));
+    const auto tip_stats{GetTipStatsCache()};
+    obj.pushKV("difficulty", tip_stats && tip_stats->tip == &tip ? tip_stats->difficulty : GetDifficulty(&tip));
     obj.pushKV("time", tip.GetBlockTime());
     obj.pushKV("mediantime", tip.GetMedianTimePast());
     obj.pushKV("verificationprogress", GuessVerificationProgress(chainman.GetParams().TxData(), &tip));
@@ -1348,6 +1537,17 @@ RPCHelpMan getblockchaininfo()
         }
     }
 
+    if (const Chainstate* background{chainman.BackgroundSyncChainstate()}) {
+        const CBlockIndex& snapshot_base{*CHECK_NONFATAL(chainman.GetSnapshotBaseBlock())};
+        const int background_height{background->m_chain.Height()};
+        UniValue background_validation(UniValue::VOBJ);
+        background_validation.pushKV("snapshotheight", snapshot_base.nHeight);
+        background_validation.pushKV("blocks", background_height);
+        background_validation.pushKV("bestblockhash", background->m_chain.Tip()->GetBlockHash().GetHex());
+        background_validation.pushKV("progress", snapshot_base.nHeight > 0 ? double(std::max(background_height, 0)) / snapshot_base.nHeight : 1.0);
+        if (const auto eta{chainman.BackgroundSyncETA()}) background_validation.pushKV("eta", count_seconds(*eta));
+        obj.pushKV("backgroundvalidation", background_validation);
+    }
     obj.pushKV("warnings", GetWarnings(false).original);
     return obj;
 },
@@ -1671,6 +1871,333 @@ static RPCHelpMan reconsiderblock()
     };
 }
 
+static UniValue CacheStatsToJSON(const CuckooCache::Stats& stats)
+{
+    const uint64_t lookups{stats.hits + stats.misses};
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("capacity", (uint64_t)stats.capacity);
+    ret.pushKV("inserts", stats.inserts);
+    ret.pushKV("hits", stats.hits);
+    ret.pushKV("misses", stats.misses);
+    ret.pushKV("evictions", stats.evictions);
+    ret.pushKV("hitrate", lookups > 0 ? double(stats.hits) / lookups : 0.0);
+    return ret;
+}
+
+static RPCHelpMan getvalidationcacheinfo()
+{
+    const std::vector<RPCResult> cache_fields{
+        {RPCResult::Type::NUM, "capacity", "The number of entries the cache can hold"},
+        {RPCResult::Type::NUM, "inserts", "The number of entries added"},
+        {RPCResult::Type::NUM, "hits", "The number of lookups that found their entry"},
+        {RPCResult::Type::NUM, "misses", "The number of lookups that did not"},
+        {RPCResult::Type::NUM, "evictions", "The number of entries dropped to make room for others"},
+        {RPCResult::Type::NUM, "hitrate", "The fraction of lookups that found their entry"},
+    };
+    return RPCHelpMan{"getvalidationcacheinfo",
+                "\nReturns statistics about the signature cache and the script execution cache.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "signature", "The cache of valid signatures", cache_fields},
+                        {RPCResult::Type::OBJ, "script", "The cache of transactions whose scripts are valid under given flags", cache_fields},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getvalidationcacheinfo", "")
+            + HelpExampleRpc("getvalidationcacheinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("signature", CacheStatsToJSON(GetSignatureCacheStats()));
+    ret.pushKV("script", CacheStatsToJSON(WITH_LOCK(cs_main, return GetScriptExecutionCacheStats())));
+    return ret;
+},
+    };
+}
+
+static RPCHelpMan getpowcacheinfo()
+{
+    return RPCHelpMan{"getpowcacheinfo",
+                "\nReturns statistics about the proof-of-work hash cache.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "capacity", "The number of entries the cache can hold"},
+                        {RPCResult::Type::NUM, "hits", "The number of proof-of-work hashes served from the cache"},
+                        {RPCResult::Type::NUM, "misses", "The number of proof-of-work hashes that had to be computed"},
+                        {RPCResult::Type::NUM, "hitrate", "The fraction of lookups served from the cache"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getpowcacheinfo", "")
+            + HelpExampleRpc("getpowcacheinfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const PoWHashCacheStats stats{GetPoWHashCacheStats()};
+    const uint64_t lookups{stats.hits + stats.misses};
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("capacity", (uint64_t)stats.capacity);
+    ret.pushKV("hits", stats.hits);
+    ret.pushKV("misses", stats.misses);
+    ret.pushKV("hitrate", lookups > 0 ? double(stats.hits) / lookups : 0.0);
+    return ret;
+},
+    };
+}
+
+namespace {
+/** Sizes, types and memory usage of a set of scripts, see getscriptstats. */
+struct ScriptStats {
+    uint64_t count{0};
+    uint64_t heap_allocated{0};
+    uint64_t dynamic_usage{0};
+    std::map<size_t, uint64_t> sizes;
+    std::map<std::string, uint64_t> types;
+
+    void Add(const CScript& script, bool is_output)
+    {
+        ++count;
+        if (script.size() > CSCRIPT_INLINE_SIZE) ++heap_allocated;
+        dynamic_usage += memusage::DynamicUsage(script);
+        ++sizes[script.size()];
+        if (is_output) {
+            std::vector<std::vector<unsigned char>> solutions;
+            ++types[GetTxnOutputType(Solver(script, solutions))];
+        }
+    }
+
+    UniValue ToJSON() const
+    {
+        UniValue ret(UniValue::VOBJ);
+        ret.pushKV("count", count);
+        ret.pushKV("heap_allocated", heap_allocated);
+        ret.pushKV("dynamic_usage", dynamic_usage);
+        UniValue sizes_json(UniValue::VOBJ);
+        for (const auto& [size, size_count] : sizes) sizes_json.pushKV(ToString(size), size_count);
+        ret.pushKV("sizes", sizes_json);
+        if (!types.empty()) {
+            UniValue types_json(UniValue::VOBJ);
+            for (const auto& [type, type_count] : types) types_json.pushKV(type, type_count);
+            ret.pushKV("types", types_json);
+        }
+        return ret;
+    }
+};
+} // namespace
+
+static std::vector<RPCResult> ScriptStatsDoc(bool with_types)
+{
+    std::vector<RPCResult> doc{
+        {RPCResult::Type::NUM, "count", "The number of scripts"},
+        {RPCResult::Type::NUM, "heap_allocated", "The number of scripts larger than inline_size, which are stored on the heap"},
+        {RPCResult::Type::NUM, "dynamic_usage", "The heap memory the scripts use, in bytes"},
+        {RPCResult::Type::OBJ_DYN, "sizes", "The number of scripts by size in bytes",
+            {{RPCResult::Type::NUM, "size", "The number of scripts of this size"}}},
+    };
+    if (with_types) {
+        doc.push_back({RPCResult::Type::OBJ_DYN, "types", "The number of scripts by output type",
+            {{RPCResult::Type::NUM, "type", "The number of scripts of this type"}}});
+    }
+    return doc;
+}
+
+static RPCHelpMan getscriptstats()
+{
+    return RPCHelpMan{"getscriptstats",
+                "\nReturns the size distribution of the scriptPubKeys in the UTXO set and, optionally, of the scripts in the last blocks.\n"
+                "This is what the number of bytes a script is stored in without a heap allocation is tuned by.\n"
+                "Note this call may take some time, as it reads the whole UTXO set.\n",
+                {
+                    {"blocks", RPCArg::Type::NUM, RPCArg::Default{0}, "The number of blocks up to the tip to read the scriptPubKeys and scriptSigs of"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "inline_size", "The size up to which scripts are stored without a heap allocation"},
+                        {RPCResult::Type::OBJ, "utxo", "The scriptPubKeys of the UTXO set", ScriptStatsDoc(/*with_types=*/true)},
+                        {RPCResult::Type::OBJ, "blocks", /*optional=*/true, "The scripts of the blocks read, if any",
+                        {
+                            {RPCResult::Type::NUM, "start_height", "The height of the first block read"},
+                            {RPCResult::Type::NUM, "end_height", "The height of the last block read"},
+                            {RPCResult::Type::OBJ, "outputs", "The scriptPubKeys of the outputs", ScriptStatsDoc(/*with_types=*/true)},
+                            {RPCResult::Type::OBJ, "scriptsigs", "The scriptSigs of the inputs, except the coinbase ones", ScriptStatsDoc(/*with_types=*/false)},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getscriptstats", "")
+            + HelpExampleCli("getscriptstats", "1000")
+            + HelpExampleRpc("getscriptstats", "1000")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const int num_blocks{request.params[0].isNull() ? 0 : request.params[0].getInt<int>()};
+    if (num_blocks < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative number of blocks");
+    }
+
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    ChainstateManager& chainman = EnsureChainman(node);
+    std::unique_ptr<CCoinsViewCursor> pcursor;
+    const CBlockIndex* tip;
+    {
+        LOCK(::cs_main);
+        Chainstate& active_chainstate = chainman.ActiveChainstate();
+        active_chainstate.ForceFlushStateToDisk();
+        pcursor = CHECK_NONFATAL(active_chainstate.CoinsDB().Cursor());
+        tip = CHECK_NONFATAL(active_chainstate.m_chain.Tip());
+    }
+
+    ScriptStats utxo_stats;
+    COutPoint key;
+    Coin coin;
+    for (unsigned int iter = 0; pcursor->Valid(); pcursor->Next(), ++iter) {
+        if (iter % 5000 == 0) node.rpc_interruption_point();
+        if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
+            utxo_stats.Add(coin.out.scriptPubKey, /*is_output=*/true);
+        }
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("inline_size", (uint64_t)CSCRIPT_INLINE_SIZE);
+    ret.pushKV("utxo", utxo_stats.ToJSON());
+    if (num_blocks > 0) {
+        ScriptStats output_stats, scriptsig_stats;
+        const CBlockIndex* pindex{tip};
+        int start_height{tip->nHeight};
+        for (int i = 0; i < num_blocks && pindex; ++i, pindex = pindex->pprev) {
+            const CBlock block{WITH_LOCK(::cs_main, return GetBlockChecked(chainman.m_blockman, pindex))};
+            for (const CTransactionRef& tx : block.vtx) {
+                for (const CTxOut& txout : tx->vout) output_stats.Add(txout.scriptPubKey, /*is_output=*/true);
+                if (tx->IsCoinBase()) continue;
+                for (const CTxIn& txin : tx->vin) scriptsig_stats.Add(txin.scriptSig, /*is_output=*/false);
+            }
+            start_height = pindex->nHeight;
+            node.rpc_interruption_point();
+        }
+        UniValue blocks(UniValue::VOBJ);
+        blocks.pushKV("start_height", start_height);
+        blocks.pushKV("end_height", tip->nHeight);
+        blocks.pushKV("outputs", output_stats.ToJSON());
+        blocks.pushKV("scriptsigs", scriptsig_stats.ToJSON());
+        ret.pushKV("blocks", blocks);
+    }
+    return ret;
+},
+    };
+}
+
+static UniValue DBStatsToJSON(const DBStats& stats)
+{
+    UniValue options(UniValue::VOBJ);
+    options.pushKV("write_buffer_size", (uint64_t)stats.options.write_buffer_size);
+    options.pushKV("block_size", (uint64_t)stats.options.block_size);
+    options.pushKV("bloom_bits", stats.options.bloom_bits);
+    options.pushKV("max_file_size", (uint64_t)stats.options.max_file_size);
+    options.pushKV("compression", stats.options.compression);
+
+    UniValue levels(UniValue::VARR);
+    for (const DBStats::Level& level : stats.levels) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("level", level.level);
+        entry.pushKV("files", level.files);
+        entry.pushKV("size_mb", level.size_mb);
+        entry.pushKV("compaction_seconds", level.compaction_seconds);
+        entry.pushKV("read_mb", level.read_mb);
+        entry.pushKV("write_mb", level.write_mb);
+        levels.push_back(entry);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("options", options);
+    ret.pushKV("memory_usage", (uint64_t)stats.memory_usage);
+    ret.pushKV("block_cache_usage", (uint64_t)stats.block_cache_usage);
+    ret.pushKV("block_cache_capacity", (uint64_t)stats.block_cache_capacity);
+    ret.pushKV("compactions_paused", stats.compactions_paused);
+    ret.pushKV("deferred_compactions", stats.deferred_compactions);
+    ret.pushKV("idle_compacted_ranges", stats.idle_compacted_ranges);
+    ret.pushKV("idle_compaction_done", stats.idle_compaction_done);
+    ret.pushKV("levels", levels);
+    return ret;
+}
+
+static RPCHelpMan getdbstats()
+{
+    return RPCHelpMan{"getdbstats",
+                "\nReturns LevelDB statistics of the chainstate, block index and index databases, to help tuning them with -leveldboption.\n"
+                "LevelDB does not count block cache hits, so only the cache usage is shown.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ_DYN, "", "",
+                    {
+                        {RPCResult::Type::OBJ, "name", "The database: chainstate, blockindex, or the name of an index", {
+                            {RPCResult::Type::OBJ, "options", "The LevelDB options the database was opened with", {
+                                {RPCResult::Type::NUM, "write_buffer_size", "The size of the memory table in bytes"},
+                                {RPCResult::Type::NUM, "block_size", "The approximate size of a table block in bytes"},
+                                {RPCResult::Type::NUM, "bloom_bits", "The number of bloom filter bits per key"},
+                                {RPCResult::Type::NUM, "max_file_size", "The size of a table file in bytes"},
+                                {RPCResult::Type::BOOL, "compression", "Whether table blocks are compressed"},
+                            }},
+                            {RPCResult::Type::NUM, "memory_usage", "The approximate memory usage of LevelDB in bytes"},
+                            {RPCResult::Type::NUM, "block_cache_usage", "The size of the cached table blocks in bytes"},
+                            {RPCResult::Type::NUM, "block_cache_capacity", "The size of the block cache in bytes"},
+                            {RPCResult::Type::BOOL, "compactions_paused", "Whether background compactions are paused while a new block is connected"},
+                            {RPCResult::Type::NUM, "deferred_compactions", "How often background compactions were deferred by such a pause"},
+                            {RPCResult::Type::NUM, "idle_compacted_ranges", "The number of key ranges compacted at idle times, see -compactdbafteribd"},
+                            {RPCResult::Type::BOOL, "idle_compaction_done", "Whether the whole database was compacted at idle times"},
+                            {RPCResult::Type::ARR, "levels", "The levels that have files or had compactions", {
+                                {RPCResult::Type::OBJ, "", "", {
+                                    {RPCResult::Type::NUM, "level", "The level"},
+                                    {RPCResult::Type::NUM, "files", "The number of table files"},
+                                    {RPCResult::Type::NUM, "size_mb", "The size of the table files in MB"},
+                                    {RPCResult::Type::NUM, "compaction_seconds", "The time spent on compactions into this level"},
+                                    {RPCResult::Type::NUM, "read_mb", "The MB read by these compactions"},
+                                    {RPCResult::Type::NUM, "write_mb", "The MB written by these compactions"},
+                                }},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getdbstats", "")
+            + HelpExampleRpc("getdbstats", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+
+    UniValue ret(UniValue::VOBJ);
+    {
+        LOCK(cs_main);
+        ret.pushKV("chainstate", DBStatsToJSON(chainman.ActiveChainstate().CoinsDB().GetDBStats()));
+        ret.pushKV("blockindex", DBStatsToJSON(chainman.m_blockman.m_block_tree_db->GetStats()));
+    }
+    if (g_txindex) {
+        ret.pushKV(g_txindex->GetSummary().name, DBStatsToJSON(g_txindex->GetDBStats()));
+    }
+    if (g_coin_stats_index) {
+        ret.pushKV(g_coin_stats_index->GetSummary().name, DBStatsToJSON(g_coin_stats_index->GetDBStats()));
+    }
+    if (g_block_stats_index) {
+        ret.pushKV(g_block_stats_index->GetSummary().name, DBStatsToJSON(g_block_stats_index->GetDBStats()));
+    }
+    if (g_address_index) {
+        ret.pushKV(g_address_index->GetSummary().name, DBStatsToJSON(g_address_index->GetDBStats()));
+    }
+    if (g_spent_index) {
+        ret.pushKV(g_spent_index->GetSummary().name, DBStatsToJSON(g_spent_index->GetDBStats()));
+    }
+    ForEachBlockFilterIndex([&ret](const BlockFilterIndex& index) {
+        ret.pushKV(index.GetSummary().name, DBStatsToJSON(index.GetDBStats()));
+    });
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan getchaintxstats()
 {
     return RPCHelpMan{"getchaintxstats",
@@ -1751,67 +2278,11 @@ static RPCHelpMan getchaintxstats()
     };
 }
 
-template<typename T>
-static T CalculateTruncatedMedian(std::vector<T>& scores)
-{
-    size_t size = scores.size();
-    if (size == 0) {
-        return 0;
-    }
-
-    std::sort(scores.begin(), scores.end());
-    if (size % 2 == 0) {
-        return (scores[size / 2 - 1] + scores[size / 2]) / 2;
-    } else {
-        return scores[size / 2];
-    }
-}
-
-void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight)
-{
-    if (scores.empty()) {
-        return;
-    }
-
-    std::sort(scores.begin(), scores.end());
-
-    // 10th, 25th, 50th, 75th, and 90th percentile weight units.
-    const double weights[NUM_GETBLOCKSTATS_PERCENTILES] = {
-        total_weight / 10.0, total_weight / 4.0, total_weight / 2.0, (total_weight * 3.0) / 4.0, (total_weight * 9.0) / 10.0
-    };
-
-    int64_t next_percentile_index = 0;
-    int64_t cumulative_weight = 0;
-    for (const auto& element : scores) {
-        cumulative_weight += element.second;
-        while (next_percentile_index < NUM_GETBLOCKSTATS_PERCENTILES && cumulative_weight >= weights[next_percentile_index]) {
-            result[next_percentile_index] = element.first;
-            ++next_percentile_index;
-        }
-    }
-
-    // Fill any remaining percentiles with the last value.
-    for (int64_t i = next_percentile_index; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
-        result[i] = scores.back().first;
-    }
-}
-
-template<typename T>
-static inline bool SetHasKeys(const std::set<T>& set) {return false;}
-template<typename T, typename Tk, typename... Args>
-static inline bool SetHasKeys(const std::set<T>& set, const Tk& key, const Args&... args)
-{
-    return (set.count(key) != 0) || SetHasKeys(set, args...);
-}
-
-// outpoint (needed for the utxo index) + nHeight + fCoinBase
-static constexpr size_t PER_UTXO_OVERHEAD = sizeof(COutPoint) + sizeof(uint32_t) + sizeof(bool);
-
 static RPCHelpMan getblockstats()
 {
     return RPCHelpMan{"getblockstats",
                 "\nCompute per block statistics for a given window. All amounts are in satoshis.\n"
-                "It won't work for some heights with pruning.\n",
+                "It won't work for some heights with pruning, unless -blockstatsindex has synced them.\n",
                 {
                     {"hash_or_height", RPCArg::Type::NUM, RPCArg::Optional::NO, "The block hash or height of the target block", "", {"", "string or numeric"}},
                     {"stats", RPCArg::Type::ARR, RPCArg::DefaultHint{"all values"}, "Values to plot (see result below)",
@@ -1882,151 +2353,55 @@ static RPCHelpMan getblockstats()
         }
     }
 
-    const CBlock& block = GetBlockChecked(chainman.m_blockman, &pindex);
-    const CBlockUndo& blockUndo = GetUndoChecked(chainman.m_blockman, &pindex);
-
-    const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
-    const bool do_mediantxsize = do_all || stats.count("mediantxsize") != 0;
-    const bool do_medianfee = do_all || stats.count("medianfee") != 0;
-    const bool do_feerate_percentiles = do_all || stats.count("feerate_percentiles") != 0;
-    const bool loop_inputs = do_all || do_medianfee || do_feerate_percentiles ||
-        SetHasKeys(stats, "utxo_size_inc", "totalfee", "avgfee", "avgfeerate", "minfee", "maxfee", "minfeerate", "maxfeerate");
-    const bool loop_outputs = do_all || loop_inputs || stats.count("total_out");
-    const bool do_calculate_size = do_mediantxsize ||
-        SetHasKeys(stats, "total_size", "avgtxsize", "mintxsize", "maxtxsize", "swtotal_size");
-    const bool do_calculate_weight = do_all || SetHasKeys(stats, "total_weight", "avgfeerate", "swtotal_weight", "avgfeerate", "feerate_percentiles", "minfeerate", "maxfeerate");
-    const bool do_calculate_sw = do_all || SetHasKeys(stats, "swtxs", "swtotal_size", "swtotal_weight");
-
-    CAmount maxfee = 0;
-    CAmount maxfeerate = 0;
-    CAmount minfee = MAX_MONEY;
-    CAmount minfeerate = MAX_MONEY;
-    CAmount total_out = 0;
-    CAmount totalfee = 0;
-    int64_t inputs = 0;
-    int64_t maxtxsize = 0;
-    int64_t mintxsize = MAX_BLOCK_SERIALIZED_SIZE;
-    int64_t outputs = 0;
-    int64_t swtotal_size = 0;
-    int64_t swtotal_weight = 0;
-    int64_t swtxs = 0;
-    int64_t total_size = 0;
-    int64_t total_weight = 0;
-    int64_t utxo_size_inc = 0;
-    std::vector<CAmount> fee_array;
-    std::vector<std::pair<CAmount, int64_t>> feerate_array;
-    std::vector<int64_t> txsize_array;
-
-    for (size_t i = 0; i < block.vtx.size(); ++i) {
-        const auto& tx = block.vtx.at(i);
-        outputs += tx->vout.size();
-
-        CAmount tx_total_out = 0;
-        if (loop_outputs) {
-            for (const CTxOut& out : tx->vout) {
-                tx_total_out += out.nValue;
-                utxo_size_inc += GetSerializeSize(out, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
-            }
-        }
-
-        if (tx->IsCoinBase()) {
-            continue;
-        }
-
-        inputs += tx->vin.size(); // Don't count coinbase's fake input
-        total_out += tx_total_out; // Don't count coinbase reward
-
-        int64_t tx_size = 0;
-        if (do_calculate_size) {
-
-            tx_size = tx->GetTotalSize();
-            if (do_mediantxsize) {
-                txsize_array.push_back(tx_size);
-            }
-            maxtxsize = std::max(maxtxsize, tx_size);
-            mintxsize = std::min(mintxsize, tx_size);
-            total_size += tx_size;
-        }
-
-        int64_t weight = 0;
-        if (do_calculate_weight) {
-            weight = GetTransactionWeight(*tx);
-            total_weight += weight;
-        }
-
-        if (do_calculate_sw && tx->HasWitness()) {
-            ++swtxs;
-            swtotal_size += tx_size;
-            swtotal_weight += weight;
-        }
-
-        if (loop_inputs) {
-            CAmount tx_total_in = 0;
-            const auto& txundo = blockUndo.vtxundo.at(i - 1);
-            for (const Coin& coin: txundo.vprevout) {
-                const CTxOut& prevoutput = coin.out;
-
-                tx_total_in += prevoutput.nValue;
-                utxo_size_inc -= GetSerializeSize(prevoutput, PROTOCOL_VERSION) + PER_UTXO_OVERHEAD;
-            }
-
-            CAmount txfee = tx_total_in - tx_total_out;
-            CHECK_NONFATAL(MoneyRange(txfee));
-            if (do_medianfee) {
-                fee_array.push_back(txfee);
-            }
-            maxfee = std::max(maxfee, txfee);
-            minfee = std::min(minfee, txfee);
-            totalfee += txfee;
-
-            // New feerate uses satoshis per virtual byte instead of per serialized byte
-            CAmount feerate = weight ? (txfee * WITNESS_SCALE_FACTOR) / weight : 0;
-            if (do_feerate_percentiles) {
-                feerate_array.emplace_back(std::make_pair(feerate, weight));
-            }
-            maxfeerate = std::max(maxfeerate, feerate);
-            minfeerate = std::min(minfeerate, feerate);
-        }
+    // The statistics index has them without reading the block and its undo data
+    std::optional<BlockStats> block_stats;
+    if (g_block_stats_index) {
+        block_stats = g_block_stats_index->LookUpStats(pindex);
+    }
+    if (!block_stats) {
+        const CBlock& block = GetBlockChecked(chainman.m_blockman, &pindex);
+        const CBlockUndo& blockUndo = GetUndoChecked(chainman.m_blockman, &pindex);
+        block_stats = CHECK_NONFATAL(ComputeBlockStats(block, blockUndo));
     }
 
-    CAmount feerate_percentiles[NUM_GETBLOCKSTATS_PERCENTILES] = { 0 };
-    CalculatePercentilesByWeight(feerate_percentiles, feerate_array, total_weight);
+    const bool do_all = stats.size() == 0; // Calculate everything if nothing selected (default)
+    const int64_t txs{block_stats->txs};
 
     UniValue feerates_res(UniValue::VARR);
     for (int64_t i = 0; i < NUM_GETBLOCKSTATS_PERCENTILES; i++) {
-        feerates_res.push_back(feerate_percentiles[i]);
+        feerates_res.push_back(block_stats->feerate_percentiles[i]);
     }
 
     UniValue ret_all(UniValue::VOBJ);
-    ret_all.pushKV("avgfee", (block.vtx.size() > 1) ? totalfee / (block.vtx.size() - 1) : 0);
-    ret_all.pushKV("avgfeerate", total_weight ? (totalfee * WITNESS_SCALE_FACTOR) / total_weight : 0); // Unit: sat/vbyte
-    ret_all.pushKV("avgtxsize", (block.vtx.size() > 1) ? total_size / (block.vtx.size() - 1) : 0);
+    ret_all.pushKV("avgfee", (txs > 1) ? block_stats->totalfee / (txs - 1) : 0);
+    ret_all.pushKV("avgfeerate", block_stats->total_weight ? (block_stats->totalfee * WITNESS_SCALE_FACTOR) / block_stats->total_weight : 0); // Unit: sat/vbyte
+    ret_all.pushKV("avgtxsize", (txs > 1) ? block_stats->total_size / (txs - 1) : 0);
     ret_all.pushKV("blockhash", pindex.GetBlockHash().GetHex());
     ret_all.pushKV("feerate_percentiles", feerates_res);
     ret_all.pushKV("height", (int64_t)pindex.nHeight);
-    ret_all.pushKV("ins", inputs);
-    ret_all.pushKV("maxfee", maxfee);
-    ret_all.pushKV("maxfeerate", maxfeerate);
-    ret_all.pushKV("maxtxsize", maxtxsize);
-    ret_all.pushKV("medianfee", CalculateTruncatedMedian(fee_array));
+    ret_all.pushKV("ins", block_stats->ins);
+    ret_all.pushKV("maxfee", block_stats->maxfee);
+    ret_all.pushKV("maxfeerate", block_stats->maxfeerate);
+    ret_all.pushKV("maxtxsize", block_stats->maxtxsize);
+    ret_all.pushKV("medianfee", block_stats->medianfee);
     ret_all.pushKV("mediantime", pindex.GetMedianTimePast());
-    ret_all.pushKV("mediantxsize", CalculateTruncatedMedian(txsize_array));
-    ret_all.pushKV("minfee", (minfee == MAX_MONEY) ? 0 : minfee);
-    ret_all.pushKV("minfeerate", (minfeerate == MAX_MONEY) ? 0 : minfeerate);
-    ret_all.pushKV("mintxsize", mintxsize == MAX_BLOCK_SERIALIZED_SIZE ? 0 : mintxsize);
-    ret_all.pushKV("outs", outputs);
+    ret_all.pushKV("mediantxsize", block_stats->mediantxsize);
+    ret_all.pushKV("minfee", block_stats->minfee);
+    ret_all.pushKV("minfeerate", block_stats->minfeerate);
+    ret_all.pushKV("mintxsize", block_stats->mintxsize);
+    ret_all.pushKV("outs", block_stats->outs);
     ret_all.pushKV("subsidy", GetBlockSubsidy(pindex.nHeight, chainman.GetParams().GetConsensus()));
-    ret_all.pushKV("swtotal_size", swtotal_size);
-    ret_all.pushKV("swtotal_weight", swtotal_weight);
-    ret_all.pushKV("swtxs", swtxs);
+    ret_all.pushKV("swtotal_size", block_stats->swtotal_size);
+    ret_all.pushKV("swtotal_weight", block_stats->swtotal_weight);
+    ret_all.pushKV("swtxs", block_stats->swtxs);
     ret_all.pushKV("time", pindex.GetBlockTime());
-    ret_all.pushKV("total_out", total_out);
-    ret_all.pushKV("total_size", total_size);
-    ret_all.pushKV("total_weight", total_weight);
-    ret_all.pushKV("totalfee", totalfee);
-    ret_all.pushKV("txs", (int64_t)block.vtx.size());
-    ret_all.pushKV("utxo_increase", outputs - inputs);
-    ret_all.pushKV("utxo_size_inc", utxo_size_inc);
+    ret_all.pushKV("total_out", block_stats->total_out);
+    ret_all.pushKV("total_size", block_stats->total_size);
+    ret_all.pushKV("total_weight", block_stats->total_weight);
+    ret_all.pushKV("totalfee", block_stats->totalfee);
+    ret_all.pushKV("txs", txs);
+    ret_all.pushKV("utxo_increase", block_stats->outs - block_stats->ins);
+    ret_all.pushKV("utxo_size_inc", block_stats->utxo_size_inc);
 
     if (do_all) {
         return ret_all;
@@ -2046,39 +2421,55 @@ static RPCHelpMan getblockstats()
 }
 
 namespace {
-//! Search for a given set of pubkey scripts
-bool FindScriptPubKey(std::atomic<int>& scan_progress, const std::atomic<bool>& should_abort, int64_t& count, CCoinsViewCursor* cursor, const std::set<CScript>& needles, std::map<COutPoint, Coin>& out_results, std::function<void()>& interruption_point)
-{
-    scan_progress = 0;
-    count = 0;
+//! Number of ranges of txids the UTXO set is split into for scantxoutset, so that its threads finish close together
+constexpr uint32_t SCAN_SHARDS{64};
+//! Maximum number of threads scanning the UTXO set
+constexpr int MAX_SCAN_THREADS{8};
+//! Number of values of the first two bytes of a txid, which the scan progress is measured in
+constexpr uint32_t SCAN_PREFIXES{0x10000};
+
+using ScriptSet = std::unordered_set<CScript, SaltedSipHasher>;
+
+//! Search the coins from cursor up to the first one whose txid starts with end_prefix for a given set of pubkey scripts
+bool FindScriptPubKey(std::atomic<uint32_t>& scanned_prefixes, std::atomic<int>& scan_progress, std::atomic<int64_t>& found, const std::atomic<bool>& should_abort, std::atomic<int64_t>& count, CCoinsViewCursor* cursor, uint32_t begin_prefix, uint32_t end_prefix, const ScriptSet& needles, std::map<COutPoint, Coin>& out_results)
+{
+    uint32_t prefix{begin_prefix};
+    const auto report_progress{[&](uint32_t high) {
+        scan_progress = (int)((scanned_prefixes += high - prefix) * 100.0 / SCAN_PREFIXES + 0.5);
+        prefix = high;
+    }};
+    int64_t local_count{0};
     while (cursor->Valid()) {
         COutPoint key;
         Coin coin;
-        if (!cursor->GetKey(key) || !cursor->GetValue(coin)) return false;
-        if (++count % 8192 == 0) {
-            interruption_point();
-            if (should_abort) {
-                // allow to abort the scan via the abort reference
-                return false;
-            }
-        }
-        if (count % 256 == 0) {
+        if (!cursor->GetKey(key)) return false;
+        const uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
+        if (high >= end_prefix) break;
+        if (!cursor->GetValue(coin)) return false;
+        if (++local_count % 256 == 0) {
+            count += 256;
+            // allow to abort the scan via the abort reference
+            if (should_abort) return false;
             // update progress reference every 256 item
-            uint32_t high = 0x100 * *key.hash.begin() + *(key.hash.begin() + 1);
-            scan_progress = (int)(high * 100.0 / 65536.0 + 0.5);
+            report_progress(high);
         }
         if (needles.count(coin.out.scriptPubKey)) {
             out_results.emplace(key, coin);
+            ++found;
         }
         cursor->Next();
     }
-    scan_progress = 100;
+    count += local_count % 256;
+    report_progress(end_prefix);
     return true;
 }
 } // namespace
 
 /** RAII object to prevent concurrency issue when scanning the txout set */
 static std::atomic<int> g_scan_progress;
+static std::atomic<uint32_t> g_scan_prefixes;
+static std::atomic<int64_t> g_scan_txouts;
+static std::atomic<int64_t> g_scan_found;
 static std::atomic<bool> g_scan_in_progress;
 static std::atomic<bool> g_should_abort_scan;
 class CoinsViewScanReserver
@@ -2102,10 +2493,65 @@ public:
         if (m_could_reserve) {
             g_scan_in_progress = false;
             g_scan_progress = 0;
+            g_scan_prefixes = 0;
+            g_scan_txouts = 0;
+            g_scan_found = 0;
         }
     }
 };
 
+/**
+ * Scan the UTXO set for a given set of pubkey scripts on up to MAX_SCAN_THREADS
+ * threads, each of which takes the next of the SCAN_SHARDS ranges of txids
+ * whose cursor is in cursors. The calling thread only waits for them and
+ * checks whether the RPC got interrupted.
+ */
+static bool ScanUTXOSet(const std::vector<std::unique_ptr<CCoinsViewCursor>>& cursors, const ScriptSet& needles, std::map<COutPoint, Coin>& out_results, std::function<void()>& interruption_point)
+{
+    const int num_threads{std::clamp(GetNumCores(), 1, MAX_SCAN_THREADS)};
+    std::vector<std::map<COutPoint, Coin>> results(cursors.size());
+    std::atomic<size_t> next_shard{0};
+    std::atomic<bool> failed{false};
+    Mutex mutex;
+    std::condition_variable cv;
+    int running{num_threads};
+
+    std::vector<std::thread> threads;
+    for (int n = 0; n < num_threads; ++n) {
+        threads.emplace_back(&util::TraceThread, strprintf("scantxout.%i", n), [&] {
+            for (size_t shard; !failed && (shard = next_shard++) < cursors.size();) {
+                const uint32_t begin_prefix = shard * SCAN_PREFIXES / cursors.size();
+                const uint32_t end_prefix = (shard + 1) * SCAN_PREFIXES / cursors.size();
+                if (!FindScriptPubKey(g_scan_prefixes, g_scan_progress, g_scan_found, g_should_abort_scan, g_scan_txouts,
+                                      cursors[shard].get(), begin_prefix, end_prefix, needles, results[shard])) {
+                    failed = true;
+                }
+            }
+            WITH_LOCK(mutex, --running);
+            cv.notify_all();
+        });
+    }
+    const auto join_threads{[&] {
+        for (std::thread& thread : threads) thread.join();
+    }};
+
+    while (WITH_LOCK(mutex, return running) > 0) {
+        try {
+            interruption_point();
+        } catch (...) {
+            g_should_abort_scan = true;
+            join_threads();
+            throw;
+        }
+        WAIT_LOCK(mutex, lock);
+        cv.wait_for(lock, std::chrono::milliseconds{100}, [&] { return running == 0; });
+    }
+    join_threads();
+
+    for (auto& shard_results : results) out_results.merge(shard_results);
+    return !failed;
+}
+
 static RPCHelpMan scantxoutset()
 {
     // scriptPubKey corresponding to mainnet address 12cbQLTFMXRnSzktFkuoG3eHoMeFtpTu3S
@@ -2165,6 +2611,8 @@ static RPCHelpMan scantxoutset()
             RPCResult{"when action=='status' and a scan is currently in progress", RPCResult::Type::OBJ, "", "",
             {
                 {RPCResult::Type::NUM, "progress", "Approximate percent complete"},
+                {RPCResult::Type::NUM, "txouts", "The number of unspent transaction outputs scanned so far"},
+                {RPCResult::Type::NUM, "found", "The number of matching unspent transaction outputs found so far"},
             }},
             RPCResult{"when action=='status' and no scan is in progress - possibly already completed", RPCResult::Type::NONE, "", ""},
         },
@@ -2188,6 +2636,8 @@ static RPCHelpMan scantxoutset()
             return UniValue::VNULL;
         }
         result.pushKV("progress", g_scan_progress.load());
+        result.pushKV("txouts", g_scan_txouts.load());
+        result.pushKV("found", g_scan_found.load());
         return result;
     } else if (request.params[0].get_str() == "abort") {
         CoinsViewScanReserver reserver;
@@ -2208,7 +2658,7 @@ static RPCHelpMan scantxoutset()
             throw JSONRPCError(RPC_MISC_ERROR, "scanobjects argument is required for the start action");
         }
 
-        std::set<CScript> needles;
+        ScriptSet needles;
         std::map<CScript, std::string> descriptors;
         CAmount total_in = 0;
 
@@ -2228,8 +2678,7 @@ static RPCHelpMan scantxoutset()
         std::vector<CTxOut> input_txos;
         std::map<COutPoint, Coin> coins;
         g_should_abort_scan = false;
-        int64_t count = 0;
-        std::unique_ptr<CCoinsViewCursor> pcursor;
+        std::vector<std::unique_ptr<CCoinsViewCursor>> cursors;
         const CBlockIndex* tip;
         NodeContext& node = EnsureAnyNodeContext(request.context);
         {
@@ -2237,12 +2686,19 @@ static RPCHelpMan scantxoutset()
             LOCK(cs_main);
             Chainstate& active_chainstate = chainman.ActiveChainstate();
             active_chainstate.ForceFlushStateToDisk();
-            pcursor = CHECK_NONFATAL(active_chainstate.CoinsDB().Cursor());
+            // The cursors of all shards see the same UTXO set, as none is written while cs_main is held
+            for (uint32_t shard = 0; shard < SCAN_SHARDS; ++shard) {
+                const uint32_t begin_prefix = shard * SCAN_PREFIXES / SCAN_SHARDS;
+                uint256 start;
+                *start.begin() = begin_prefix >> 8;
+                *(start.begin() + 1) = begin_prefix & 0xff;
+                cursors.push_back(CHECK_NONFATAL(active_chainstate.CoinsDB().Cursor(start)));
+            }
             tip = CHECK_NONFATAL(active_chainstate.m_chain.Tip());
         }
-        bool res = FindScriptPubKey(g_scan_progress, g_should_abort_scan, count, pcursor.get(), needles, coins, node.rpc_interruption_point);
+        bool res = ScanUTXOSet(cursors, needles, coins, node.rpc_interruption_point);
         result.pushKV("success", res);
-        result.pushKV("txouts", count);
+        result.pushKV("txouts", g_scan_txouts.load());
         result.pushKV("height", tip->nHeight);
         result.pushKV("bestblock", tip->GetBlockHash().GetHex());
 
@@ -2352,11 +2808,451 @@ static RPCHelpMan getblockfilter()
     };
 }
 
+/** RAII object to prevent concurrency issue when scanning blockfilters */
+static std::atomic<int> g_scanfilter_progress;
+static std::atomic<int> g_scanfilter_progress_height;
+static std::atomic<bool> g_scanfilter_in_progress;
+static std::atomic<bool> g_scanfilter_should_abort_scan;
+class BlockFiltersScanReserver
+{
+private:
+    bool m_could_reserve{false};
+public:
+    explicit BlockFiltersScanReserver() = default;
+
+    bool reserve() {
+        CHECK_NONFATAL(!m_could_reserve);
+        if (g_scanfilter_in_progress.exchange(true)) {
+            return false;
+        }
+        m_could_reserve = true;
+        return true;
+    }
+
+    ~BlockFiltersScanReserver() {
+        if (m_could_reserve) {
+            g_scanfilter_in_progress = false;
+            g_scanfilter_progress = 0;
+            g_scanfilter_progress_height = 0;
+        }
+    }
+};
+
+static RPCHelpMan scanblocks()
+{
+    return RPCHelpMan{"scanblocks",
+        "\nReturn the blocks whose block filters match any of the given descriptors.\n"
+        "Block filters may match blocks that do not pay to or spend from the descriptors.\n",
+        {
+            {"action", RPCArg::Type::STR, RPCArg::Optional::NO, "The action to execute\n"
+                "\"start\" for starting a scan\n"
+                "\"abort\" for aborting the current scan (returns true when abort was successful)\n"
+                "\"status\" for progress report (in %) of the current scan"},
+            {"scanobjects", RPCArg::Type::ARR, RPCArg::Optional::OMITTED, "Array of scan objects. Required for \"start\" action\n"
+                "Every scan object is either a string descriptor or an object:",
+            {
+                {"descriptor", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "An output descriptor"},
+                {"", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED, "An object with output descriptor and metadata",
+                {
+                    {"desc", RPCArg::Type::STR, RPCArg::Optional::NO, "An output descriptor"},
+                    {"range", RPCArg::Type::RANGE, RPCArg::Default{1000}, "The range of HD chain indexes to explore (either end or [begin,end])"},
+                }},
+            },
+                        "[scanobjects,...]"},
+            {"start_height", RPCArg::Type::NUM, RPCArg::Default{0}, "Height to start to scan from"},
+            {"stop_height", RPCArg::Type::NUM, RPCArg::DefaultHint{"chain tip"}, "Height to stop to scan"},
+            {"filtertype", RPCArg::Type::STR, RPCArg::Default{BlockFilterTypeName(BlockFilterType::BASIC)}, "The type name of the filter"},
+        },
+        {
+            RPCResult{"when action=='start'; only returns after scan completes", RPCResult::Type::OBJ, "", "", {
+                {RPCResult::Type::NUM, "from_height", "The height we started the scan from"},
+                {RPCResult::Type::NUM, "to_height", "The height we ended the scan at"},
+                {RPCResult::Type::ARR, "relevant_blocks", "Blocks that may have matched a scanobject.", {
+                    {RPCResult::Type::STR_HEX, "blockhash", "A relevant blockhash"},
+                }},
+                {RPCResult::Type::BOOL, "completed", "Whether the scan reached stop_height, or was aborted"},
+            }},
+            RPCResult{"when action=='status' and a scan is currently in progress", RPCResult::Type::OBJ, "", "", {
+                {RPCResult::Type::NUM, "progress", "Approximate percent complete"},
+                {RPCResult::Type::NUM, "current_height", "Height of the block currently being scanned"},
+            }},
+            RPCResult{"when action=='status' and no scan is in progress - possibly already completed", RPCResult::Type::NONE, "", ""},
+            RPCResult{"when action=='abort'", RPCResult::Type::BOOL, "", "True if scan will be aborted (not necessarily before this RPC returns), or false if there is no scan to abort"},
+        },
+        RPCExamples{
+            HelpExampleCli("scanblocks", "start '[\"addr(" + EXAMPLE_ADDRESS[0] + ")\"]' 300000") +
+            HelpExampleCli("scanblocks", "status") +
+            HelpExampleRpc("scanblocks", "\"start\", [\"addr(" + EXAMPLE_ADDRESS[0] + ")\"], 300000") +
+            HelpExampleRpc("scanblocks", "\"abort\"")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue ret(UniValue::VOBJ);
+    if (request.params[0].get_str() == "status") {
+        BlockFiltersScanReserver reserver;
+        if (reserver.reserve()) {
+            // no scan in progress
+            return NullUniValue;
+        }
+        ret.pushKV("progress", g_scanfilter_progress.load());
+        ret.pushKV("current_height", g_scanfilter_progress_height.load());
+        return ret;
+    } else if (request.params[0].get_str() == "abort") {
+        BlockFiltersScanReserver reserver;
+        if (reserver.reserve()) {
+            // reserve was possible which means no scan was running
+            return false;
+        }
+        // set the abort flag
+        g_scanfilter_should_abort_scan = true;
+        return true;
+    } else if (request.params[0].get_str() != "start") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid command");
+    }
+
+    BlockFiltersScanReserver reserver;
+    if (!reserver.reserve()) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Scan already in progress, use action \"abort\" or \"status\"");
+    }
+    if (request.params[1].isNull()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "scanobjects argument is required for the start action");
+    }
+
+    const std::string filtertype_name{request.params[4].isNull() ? BlockFilterTypeName(BlockFilterType::BASIC) : request.params[4].get_str()};
+    BlockFilterType filtertype;
+    if (!BlockFilterTypeByName(filtertype_name, filtertype)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Unknown filtertype");
+    }
+
+    BlockFilterIndex* index = GetBlockFilterIndex(filtertype);
+    if (!index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Index is not enabled for filtertype " + filtertype_name);
+    }
+
+    NodeContext& node = EnsureAnyNodeContext(request.context);
+    ChainstateManager& chainman = EnsureChainman(node);
+
+    // set the start-height
+    const CBlockIndex* start_index;
+    const CBlockIndex* stop_index;
+    {
+        LOCK(cs_main);
+        CChain& active_chain = chainman.ActiveChain();
+        start_index = active_chain.Genesis();
+        stop_index = active_chain.Tip();
+        if (!request.params[2].isNull()) {
+            start_index = active_chain[request.params[2].getInt<int>()];
+            if (!start_index) {
+                throw JSONRPCError(RPC_MISC_ERROR, "Invalid start_height");
+            }
+        }
+        if (!request.params[3].isNull()) {
+            stop_index = active_chain[request.params[3].getInt<int>()];
+            if (!stop_index || stop_index->nHeight < start_index->nHeight) {
+                throw JSONRPCError(RPC_MISC_ERROR, "Invalid stop_height");
+            }
+        }
+    }
+    CHECK_NONFATAL(start_index);
+    CHECK_NONFATAL(stop_index);
+
+    if (!index->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block filters are still in the process of being indexed.");
+    }
+
+    GCSFilter::ElementSet needles;
+    for (const UniValue& scanobject : request.params[1].get_array().getValues()) {
+        FlatSigningProvider provider;
+        for (const CScript& script : EvalDescriptorStringOrObject(scanobject, provider)) {
+            needles.emplace(script.begin(), script.end());
+        }
+    }
+
+    g_scanfilter_should_abort_scan = false;
+    const int start_height{start_index->nHeight};
+    const int range{stop_index->nHeight - start_height};
+    // One sweep over the filters, keeping the calling thread free to read them
+    const int n_threads{std::clamp(GetNumCores() - 1, 0, MAX_SCRIPTCHECK_THREADS)};
+    bool interrupted{false};
+    int scanned_height{start_height - 1};
+    std::vector<const CBlockIndex*> matches;
+    const bool completed{index->MatchFilterRange(start_height, stop_index, needles, matches, n_threads, [&](int height) {
+        scanned_height = height - 1;
+        g_scanfilter_progress_height = height;
+        g_scanfilter_progress = range == 0 ? 0 : int((height - start_height) * 100.0 / range);
+        interrupted = g_scanfilter_should_abort_scan || ShutdownRequested();
+        return interrupted;
+    })};
+    node.rpc_interruption_point();
+    if (!completed && !interrupted) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Failed to read block filters. This error is unexpected and indicates index corruption.");
+    }
+
+    UniValue blocks(UniValue::VARR);
+    for (const CBlockIndex* block_index : matches) {
+        blocks.push_back(block_index->GetBlockHash().GetHex());
+    }
+    ret.pushKV("from_height", start_height);
+    ret.pushKV("to_height", completed ? stop_index->nHeight : scanned_height);
+    ret.pushKV("relevant_blocks", blocks);
+    ret.pushKV("completed", completed);
+    return ret;
+},
+    };
+}
+
+//! Maximum number of entries the address index RPCs return per call
+static constexpr int MAX_ADDRESS_INDEX_PAGE_SIZE{1000};
+
+static std::vector<RPCArg> AddressIndexPageArgs()
+{
+    return {
+        {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+        {"skip", RPCArg::Type::NUM, RPCArg::Default{0}, "The number of entries to skip"},
+        {"count", RPCArg::Type::NUM, RPCArg::Default{100}, strprintf("The maximum number of entries to return (at most %d)", MAX_ADDRESS_INDEX_PAGE_SIZE)},
+    };
+}
+
+/** Get the address index script hash of the address, once the index caught up with the chain. */
+static uint256 ParseAddressIndexScriptHash(const UniValue& address)
+{
+    if (!g_address_index) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is not enabled. Use -addressindex");
+    }
+    const CTxDestination dest{DecodeDestination(address.get_str())};
+    if (!IsValidDestination(dest)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+    }
+    if (!g_address_index->BlockUntilSyncedToCurrentChain()) {
+        throw JSONRPCError(RPC_MISC_ERROR, strprintf("Address index is still syncing. Current height: %d", g_address_index->GetSummary().best_block_height));
+    }
+    return AddressIndex::GetScriptHash(GetScriptForDestination(dest));
+}
+
+static std::pair<size_t, size_t> ParseAddressIndexPage(const JSONRPCRequest& request)
+{
+    const int skip{request.params[1].isNull() ? 0 : request.params[1].getInt<int>()};
+    const int count{request.params[2].isNull() ? 100 : request.params[2].getInt<int>()};
+    if (skip < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative skip");
+    }
+    if (count < 0 || count > MAX_ADDRESS_INDEX_PAGE_SIZE) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("count must be between 0 and %d", MAX_ADDRESS_INDEX_PAGE_SIZE));
+    }
+    return {skip, count};
+}
+
+static RPCHelpMan getaddresshistory()
+{
+    return RPCHelpMan{"getaddresshistory",
+                "\nReturn the outputs paying to an address and the inputs spending them, in the order of the heights of their blocks.\n"
+                "Requires -addressindex.\n",
+                AddressIndexPageArgs(),
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "height", "The height the address index is synced to"},
+                        {RPCResult::Type::ARR, "history", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR_HEX, "txid", "The transaction id"},
+                                {RPCResult::Type::NUM, "height", "The height of the block of the transaction"},
+                                {RPCResult::Type::NUM, "index", "The index of the output, or of the input if spending"},
+                                {RPCResult::Type::BOOL, "spending", "Whether the input spends an output to the address"},
+                                {RPCResult::Type::STR_AMOUNT, "amount", "The value of the output, negative if spending it"},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleRpc("getaddresshistory", "\"" + EXAMPLE_ADDRESS[0] + "\", 100, 100")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const uint256 script_hash{ParseAddressIndexScriptHash(request.params[0])};
+    const auto [skip, count]{ParseAddressIndexPage(request)};
+    const int height{g_address_index->GetSummary().best_block_height};
+
+    std::vector<AddressHistoryEntry> history;
+    if (!g_address_index->FindHistory(script_hash, skip, count, history)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+    }
+
+    UniValue entries(UniValue::VARR);
+    for (const AddressHistoryEntry& entry : history) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.txid.GetHex());
+        obj.pushKV("height", entry.height);
+        obj.pushKV("index", int64_t{entry.index});
+        obj.pushKV("spending", entry.spending);
+        obj.pushKV("amount", ValueFromAmount(entry.value));
+        entries.push_back(std::move(obj));
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("height", height);
+    ret.pushKV("history", std::move(entries));
+    return ret;
+},
+    };
+}
+
+static RPCHelpMan getaddressutxos()
+{
+    return RPCHelpMan{"getaddressutxos",
+                "\nReturn the unspent outputs paying to an address, ordered by txid. Outputs spent in the mempool are included.\n"
+                "Requires -addressindex.\n",
+                AddressIndexPageArgs(),
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "height", "The height the address index is synced to"},
+                        {RPCResult::Type::ARR, "unspents", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR_HEX, "txid", "The transaction id"},
+                                {RPCResult::Type::NUM, "vout", "The output index"},
+                                {RPCResult::Type::STR_AMOUNT, "amount", "The value of the output"},
+                                {RPCResult::Type::NUM, "height", "The height of the block of the output"},
+                            }},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddressutxos", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleRpc("getaddressutxos", "\"" + EXAMPLE_ADDRESS[0] + "\", 0, 100")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const uint256 script_hash{ParseAddressIndexScriptHash(request.params[0])};
+    const auto [skip, count]{ParseAddressIndexPage(request)};
+    const int height{g_address_index->GetSummary().best_block_height};
+
+    std::vector<AddressUnspentEntry> unspent;
+    if (!g_address_index->FindUnspent(script_hash, skip, count, unspent)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+    }
+
+    UniValue entries(UniValue::VARR);
+    for (const AddressUnspentEntry& entry : unspent) {
+        UniValue obj(UniValue::VOBJ);
+        obj.pushKV("txid", entry.txid.GetHex());
+        obj.pushKV("vout", int64_t{entry.vout});
+        obj.pushKV("amount", ValueFromAmount(entry.value));
+        obj.pushKV("height", entry.height);
+        entries.push_back(std::move(obj));
+    }
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("height", height);
+    ret.pushKV("unspents", std::move(entries));
+    return ret;
+},
+    };
+}
+
+static RPCHelpMan getaddressbalance()
+{
+    return RPCHelpMan{"getaddressbalance",
+                "\nReturn the confirmed balance of an address and the total it received.\n"
+                "Requires -addressindex.\n",
+                {
+                    {"address", RPCArg::Type::STR, RPCArg::Optional::NO, "The address"},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "height", "The height the address index is synced to"},
+                        {RPCResult::Type::STR_AMOUNT, "balance", "The value of the unspent outputs paying to the address"},
+                        {RPCResult::Type::STR_AMOUNT, "received", "The value of all outputs that paid to the address"},
+                        {RPCResult::Type::NUM, "history_count", "The number of entries getaddresshistory returns for the address"},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getaddressbalance", "\"" + EXAMPLE_ADDRESS[0] + "\"") +
+                    HelpExampleRpc("getaddressbalance", "\"" + EXAMPLE_ADDRESS[0] + "\"")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const uint256 script_hash{ParseAddressIndexScriptHash(request.params[0])};
+    const int height{g_address_index->GetSummary().best_block_height};
+
+    AddressBalance balance;
+    if (!g_address_index->GetBalance(script_hash, balance)) {
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Unable to read the address index");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("height", height);
+    ret.pushKV("balance", ValueFromAmount(balance.balance));
+    ret.pushKV("received", ValueFromAmount(balance.received));
+    ret.pushKV("history_count", balance.history_count);
+    return ret;
+},
+    };
+}
+
 /**
  * Serialize the UTXO set to a file for loading elsewhere.
  *
  * @see SnapshotMetadata
  */
+static RPCHelpMan dumpheaders()
+{
+    return RPCHelpMan{
+        "dumpheaders",
+        "Write the headers of the active chain to disk, for new nodes to import with -loadheaders.",
+        {
+            {"path", RPCArg::Type::STR, RPCArg::Optional::NO, "Path to the output file. If relative, will be prefixed by datadir."},
+        },
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::NUM, "headers_written", "the number of headers written, from the genesis block to the tip"},
+                    {RPCResult::Type::STR_HEX, "base_hash", "the hash of the last header written"},
+                    {RPCResult::Type::NUM, "base_height", "the height of the last header written"},
+                    {RPCResult::Type::STR, "path", "the absolute path that the headers were written to"},
+                }
+        },
+        RPCExamples{
+            HelpExampleCli("dumpheaders", "headers.dat")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const ArgsManager& args{EnsureAnyArgsman(request.context)};
+    const fs::path path = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str()));
+    // Write to a temporary path and then move into `path` on completion
+    // to avoid confusion due to an interruption.
+    const fs::path temppath = fsbridge::AbsPathJoin(args.GetDataDirNet(), fs::u8path(request.params[0].get_str() + ".incomplete"));
+
+    if (fs::exists(path)) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            path.u8string() + " already exists. If you are sure this is what you want, "
+            "move it out of the way first");
+    }
+
+    AutoFile afile{fsbridge::fopen(temppath, "wb")};
+    if (afile.IsNull()) {
+        throw JSONRPCError(
+            RPC_INVALID_PARAMETER,
+            "Couldn't open file " + temppath.u8string() + " for writing.");
+    }
+
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return chainman.ActiveChain().Tip())};
+    node::WriteHeadersFile(*CHECK_NONFATAL(tip), afile);
+    afile.fclose();
+    fs::rename(temppath, path);
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("headers_written", tip->nHeight + 1);
+    result.pushKV("base_hash", tip->GetBlockHash().ToString());
+    result.pushKV("base_height", tip->nHeight);
+    result.pushKV("path", path.u8string());
+    return result;
+},
+    };
+}
+
 static RPCHelpMan dumptxoutset()
 {
     return RPCHelpMan{
@@ -2458,6 +3354,19 @@ UniValue CreateUTXOSnapshot(
 
     afile << metadata;
 
+    uint64_t offset{::GetSerializeSize(metadata, CLIENT_VERSION)};
+    std::vector<SnapshotChunkInfo> index;
+    SnapshotCoins chunk;
+    size_t chunk_size{0};
+    const auto write_chunk{[&] {
+        const std::vector<unsigned char> data{SerializeSnapshotChunk(chunk)};
+        const SnapshotChunkInfo& info{index.emplace_back(SnapshotChunkInfo{offset, chunk.size(), Hash(data)})};
+        afile << info.m_coins_count << data << info.m_hash;
+        offset += GetSnapshotChunkSize(data.size());
+        chunk.clear();
+        chunk_size = 0;
+    }};
+
     COutPoint key;
     Coin coin;
     unsigned int iter{0};
@@ -2466,13 +3375,17 @@ UniValue CreateUTXOSnapshot(
         if (iter % 5000 == 0) node.rpc_interruption_point();
         ++iter;
         if (pcursor->GetKey(key) && pcursor->GetValue(coin)) {
-            afile << key;
-            afile << coin;
+            // Chunks end at a transaction boundary
+            if (chunk_size >= SNAPSHOT_CHUNK_SIZE && key.hash != chunk.back().first.hash) write_chunk();
+            chunk_size += ::GetSerializeSize(coin, CLIENT_VERSION);
+            chunk.emplace_back(key, std::move(coin));
         }
 
         pcursor->Next();
     }
+    if (!chunk.empty()) write_chunk();
 
+    afile << index << offset;
     afile.fclose();
 
     UniValue result(UniValue::VOBJ);
@@ -2502,6 +3415,11 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &getchaintips},
         {"blockchain", &getdifficulty},
         {"blockchain", &getdeploymentinfo},
+        {"blockchain", &getpowcacheinfo},
+        {"blockchain", &getvalidationcacheinfo},
+        {"blockchain", &getdbstats},
+        {"blockchain", &dumpheaders},
+        {"blockchain", &getscriptstats},
         {"blockchain", &gettxout},
         {"blockchain", &gettxoutsetinfo},
         {"blockchain", &pruneblockchain},
@@ -2509,6 +3427,10 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"blockchain", &preciousblock},
         {"blockchain", &scantxoutset},
         {"blockchain", &getblockfilter},
+        {"blockchain", &scanblocks},
+        {"blockchain", &getaddresshistory},
+        {"blockchain", &getaddressutxos},
+        {"blockchain", &getaddressbalance},
         {"blockchain", &getcheckpoint},
         {"blockchain", &sendcheckpoint},
         {"hidden", &invalidateblock},
@@ -2517,6 +3439,7 @@ void RegisterBlockchainRPCCommands(CRPCTable& t)
         {"hidden", &waitforblock},
         {"hidden", &waitforblockheight},
         {"hidden", &syncwithvalidationinterfacequeue},
+        {"hidden", &getvalidationinterfaceinfo},
         {"hidden", &dumptxoutset},
     };
     for (const auto& c : commands) {
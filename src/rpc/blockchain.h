@@ -8,11 +8,15 @@
 #include <consensus/amount.h>
 #include <core_io.h>
 #include <fs.h>
+#include <index/blockstatsindex.h>
 #include <streams.h>
 #include <sync.h>
+#include <univalue.h>
 #include <validation.h>
 
 #include <any>
+#include <map>
+#include <memory>
 #include <stdint.h>
 #include <vector>
 
@@ -21,13 +25,11 @@ extern RecursiveMutex cs_main;
 class CBlock;
 class CBlockIndex;
 class Chainstate;
-class UniValue;
+class JSONStreamWriter;
 namespace node {
 struct NodeContext;
 } // namespace node
 
-static constexpr int NUM_GETBLOCKSTATS_PERCENTILES = 5;
-
 /**
  * Get the difficulty of the net wrt to the given block index.
  *
@@ -39,15 +41,32 @@ double GetDifficulty(const CBlockIndex* blockindex);
 /** Callback for when block tip changed. */
 void RPCNotifyBlockChange(const CBlockIndex*);
 
+/** Maximum number of network hash rate estimates kept for a tip */
+static constexpr size_t MAX_TIP_STATS_HASHPS_ENTRIES{16};
+
+/** Values of the active chain tip that monitoring RPCs poll, published on every tip change */
+struct TipStatsCache {
+    explicit TipStatsCache(const CBlockIndex* tip) : tip{tip}, difficulty{GetDifficulty(tip)} {}
+
+    //! The tip the values are computed for
+    const CBlockIndex* const tip;
+    const double difficulty;
+    Mutex cs;
+    //! getnetworkhashps results at the tip, by number of blocks looked back
+    std::map<int, UniValue> network_hashps GUARDED_BY(cs);
+};
+
+/** Return the cache of the tip last notified to RPCNotifyBlockChange without taking cs_main, or nullptr */
+std::shared_ptr<TipStatsCache> GetTipStatsCache();
+
 /** Block description to JSON */
 UniValue blockToJSON(node::BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity) LOCKS_EXCLUDED(cs_main);
+/** Block description to JSON, written to a stream one transaction at a time */
+void blockToJSON(node::BlockManager& blockman, const CBlock& block, const CBlockIndex* tip, const CBlockIndex* blockindex, TxVerbosity verbosity, JSONStreamWriter& writer) LOCKS_EXCLUDED(cs_main);
 
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* tip, const CBlockIndex* blockindex) LOCKS_EXCLUDED(cs_main);
 
-/** Used by getblockstats to get feerates at different percentiles by weight  */
-void CalculatePercentilesByWeight(CAmount result[NUM_GETBLOCKSTATS_PERCENTILES], std::vector<std::pair<CAmount, int64_t>>& scores, int64_t total_weight);
-
 /**
  * Helper to create UTXO snapshots given a chainstate and a file handle.
  * @return a UniValue map containing metadata about the snapshot.
@@ -0,0 +1,204 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <rpc/cbor.h>
+
+#include <univalue.h>
+#include <util/strencodings.h>
+
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace {
+
+enum MajorType : uint8_t {
+    UNSIGNED_INT = 0,
+    NEGATIVE_INT = 1,
+    BYTE_STRING = 2,
+    TEXT_STRING = 3,
+    ARRAY = 4,
+    MAP = 5,
+    TAG = 6,
+    SIMPLE = 7,
+};
+
+/** Decimal fraction, as an [exponent, mantissa] array */
+constexpr uint64_t TAG_DECIMAL_FRACTION{4};
+/** Byte string expected to be converted to base16 when converted to JSON */
+constexpr uint64_t TAG_EXPECTED_BASE16{23};
+
+constexpr uint8_t SIMPLE_FALSE{20};
+constexpr uint8_t SIMPLE_TRUE{21};
+constexpr uint8_t SIMPLE_NULL{22};
+
+/** Bound on the exponent of a number, far beyond what any reply contains */
+constexpr int64_t MAX_EXPONENT{1000000};
+
+void WriteHead(std::string& out, MajorType type, uint64_t arg)
+{
+    const uint8_t major = type << 5;
+    int len;
+    if (arg < 24) {
+        out += char(major | arg);
+        return;
+    } else if (arg <= std::numeric_limits<uint8_t>::max()) {
+        out += char(major | 24);
+        len = 1;
+    } else if (arg <= std::numeric_limits<uint16_t>::max()) {
+        out += char(major | 25);
+        len = 2;
+    } else if (arg <= std::numeric_limits<uint32_t>::max()) {
+        out += char(major | 26);
+        len = 4;
+    } else {
+        out += char(major | 27);
+        len = 8;
+    }
+    for (int i = len - 1; i >= 0; --i) {
+        out += char(arg >> (8 * i));
+    }
+}
+
+void WriteInt(std::string& out, bool negative, uint64_t magnitude)
+{
+    if (negative && magnitude > 0) {
+        WriteHead(out, NEGATIVE_INT, magnitude - 1);
+    } else {
+        WriteHead(out, UNSIGNED_INT, magnitude);
+    }
+}
+
+void WriteSignedInt(std::string& out, int64_t value)
+{
+    if (value < 0) {
+        WriteHead(out, NEGATIVE_INT, uint64_t(-(value + 1)));
+    } else {
+        WriteHead(out, UNSIGNED_INT, uint64_t(value));
+    }
+}
+
+/**
+ * Split a JSON number into its digits and decimal exponent. Returns false if the digits do
+ * not fit in 64 bits. integer is set if the number has neither a fraction nor an exponent.
+ */
+bool ParseNumber(const std::string& str, bool& negative, uint64_t& digits, int64_t& exponent, bool& integer)
+{
+    size_t pos{0};
+    negative = pos < str.size() && str[pos] == '-';
+    if (negative) ++pos;
+    digits = 0;
+    exponent = 0;
+    integer = true;
+
+    const auto add_digit = [&](char c) {
+        const uint64_t d = c - '0';
+        if (digits > (std::numeric_limits<uint64_t>::max() - d) / 10) return false;
+        digits = digits * 10 + d;
+        return true;
+    };
+    for (; pos < str.size() && IsDigit(str[pos]); ++pos) {
+        if (!add_digit(str[pos])) return false;
+    }
+    if (pos < str.size() && str[pos] == '.') {
+        integer = false;
+        for (++pos; pos < str.size() && IsDigit(str[pos]); ++pos) {
+            if (!add_digit(str[pos])) return false;
+            --exponent;
+        }
+    }
+    if (pos < str.size() && (str[pos] == 'e' || str[pos] == 'E')) {
+        integer = false;
+        ++pos;
+        bool negative_exponent{false};
+        if (pos < str.size() && (str[pos] == '+' || str[pos] == '-')) {
+            negative_exponent = str[pos] == '-';
+            ++pos;
+        }
+        int64_t e{0};
+        for (; pos < str.size() && IsDigit(str[pos]); ++pos) {
+            e = e * 10 + (str[pos] - '0');
+            if (e > MAX_EXPONENT) return false;
+        }
+        exponent += negative_exponent ? -e : e;
+    }
+    return pos == str.size();
+}
+
+bool IsLowerHex(const std::string& str)
+{
+    if (str.empty() || str.size() % 2 != 0) return false;
+    for (const char c : str) {
+        if (!IsDigit(c) && (c < 'a' || c > 'f')) return false;
+    }
+    return true;
+}
+
+void WriteText(std::string& out, const std::string& str)
+{
+    WriteHead(out, TEXT_STRING, str.size());
+    out += str;
+}
+
+void WriteValue(std::string& out, const UniValue& value)
+{
+    switch (value.getType()) {
+    case UniValue::VNULL:
+        WriteHead(out, SIMPLE, SIMPLE_NULL);
+        break;
+    case UniValue::VBOOL:
+        WriteHead(out, SIMPLE, value.isTrue() ? SIMPLE_TRUE : SIMPLE_FALSE);
+        break;
+    case UniValue::VNUM: {
+        bool negative, integer;
+        uint64_t digits;
+        int64_t exponent;
+        if (!ParseNumber(value.getValStr(), negative, digits, exponent, integer)) {
+            // Too many digits for an integer mantissa; keep the number as it is written
+            WriteText(out, value.getValStr());
+        } else if (integer) {
+            WriteInt(out, negative, digits);
+        } else {
+            WriteHead(out, TAG, TAG_DECIMAL_FRACTION);
+            WriteHead(out, ARRAY, 2);
+            WriteSignedInt(out, exponent);
+            WriteInt(out, negative, digits);
+        }
+        break;
+    }
+    case UniValue::VSTR:
+        if (IsLowerHex(value.get_str())) {
+            const std::vector<uint8_t> bytes{ParseHex(value.get_str())};
+            WriteHead(out, TAG, TAG_EXPECTED_BASE16);
+            WriteHead(out, BYTE_STRING, bytes.size());
+            out.append(bytes.begin(), bytes.end());
+        } else {
+            WriteText(out, value.get_str());
+        }
+        break;
+    case UniValue::VARR:
+        WriteHead(out, ARRAY, value.size());
+        for (const UniValue& entry : value.getValues()) {
+            WriteValue(out, entry);
+        }
+        break;
+    case UniValue::VOBJ:
+        WriteHead(out, MAP, value.size());
+        for (size_t i = 0; i < value.size(); ++i) {
+            WriteText(out, value.getKeys()[i]);
+            WriteValue(out, value.getValues()[i]);
+        }
+        break;
+    } // no default case, so the compiler can warn about missing cases
+}
+
+} // namespace
+
+std::string EncodeCBOR(const UniValue& value)
+{
+    std::string out;
+    WriteValue(out, value);
+    return out;
+}
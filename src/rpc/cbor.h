@@ -0,0 +1,27 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_RPC_CBOR_H
+#define BITCOIN_RPC_CBOR_H
+
+#include <string>
+
+class UniValue;
+
+/** Content type of RPC replies encoded with EncodeCBOR */
+static const char* const CBOR_CONTENT_TYPE = "application/cbor";
+
+/**
+ * Encode a JSON value as CBOR (RFC 8949), for clients that would rather not parse hex and
+ * decimal strings. The encoding carries the same information as the JSON text:
+ * - numbers without a fraction or exponent that fit in 64 bits are integers, other numbers
+ *   are decimal fractions (tag 4) of their digits, so that amounts stay exact;
+ * - non-empty strings of an even number of lowercase hex digits are byte strings marked for
+ *   base16 conversion to JSON (tag 23), so that hashes, scripts and serialized transactions
+ *   are sent as raw bytes;
+ * - other strings are text strings, and arrays, objects, booleans and null map directly.
+ */
+std::string EncodeCBOR(const UniValue& value);
+
+#endif // BITCOIN_RPC_CBOR_H
@@ -100,6 +100,96 @@ static RPCHelpMan estimatesmartfee()
     };
 }
 
+/** Percentiles of the mempool feerates reported by estimatefeecurve */
+static constexpr std::array<int, 5> MEMPOOL_FEERATE_PERCENTILES{10, 25, 50, 75, 90};
+
+static RPCHelpMan estimatefeecurve()
+{
+    return RPCHelpMan{"estimatefeecurve",
+        "\nReturns the estimates of estimatesmartfee for every supported confirmation target in both\n"
+        "estimate modes, together with percentiles of the feerates of the transactions in the mempool.\n",
+        {},
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::ARR, "estimates", "One entry per confirmation target, starting at 1",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "target", "the confirmation target"},
+                            {RPCResult::Type::NUM, "blocks", "block number where the estimates were found, as for estimatesmartfee"},
+                            {RPCResult::Type::NUM, "economical", /*optional=*/true, "economical estimate fee rate in " + CURRENCY_UNIT + "/kvB (only present if one was found)"},
+                            {RPCResult::Type::NUM, "conservative", /*optional=*/true, "conservative estimate fee rate in " + CURRENCY_UNIT + "/kvB (only present if one was found)"},
+                        }},
+                    }},
+                {RPCResult::Type::ARR_FIXED, "mempool_feerate_percentiles", "Feerates at the 10th, 25th, 50th, 75th and 90th percentile of the virtual size of the mempool, in " + CURRENCY_UNIT + "/kvB. "
+                "Transactions are ordered by their feerate including ancestors, as for mining. Empty if the mempool is empty.",
+                    {
+                        {RPCResult::Type::NUM, "", "The feerate at a percentile"},
+                    }},
+        }},
+        RPCExamples{
+            HelpExampleCli("estimatefeecurve", "") +
+            HelpExampleRpc("estimatefeecurve", "")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+        {
+            CBlockPolicyEstimator& fee_estimator = EnsureAnyFeeEstimator(request.context);
+            const NodeContext& node = EnsureAnyNodeContext(request.context);
+            const CTxMemPool& mempool = EnsureMemPool(node);
+
+            const int max_target = fee_estimator.HighestTargetTracked(FeeEstimateHorizon::LONG_HALFLIFE);
+            const auto economical{fee_estimator.estimateSmartFeeCurve(max_target, /*conservative=*/false)};
+            const auto conservative{fee_estimator.estimateSmartFeeCurve(max_target, /*conservative=*/true)};
+            const CFeeRate min_feerate{std::max(mempool.GetMinFee(), mempool.m_min_relay_feerate)};
+
+            UniValue estimates(UniValue::VARR);
+            for (int i = 0; i < max_target; ++i) {
+                UniValue estimate(UniValue::VOBJ);
+                estimate.pushKV("target", i + 1);
+                estimate.pushKV("blocks", conservative[i].second.returnedTarget);
+                if (economical[i].first != CFeeRate(0)) {
+                    estimate.pushKV("economical", ValueFromAmount(std::max(economical[i].first, min_feerate).GetFeePerK()));
+                }
+                if (conservative[i].first != CFeeRate(0)) {
+                    estimate.pushKV("conservative", ValueFromAmount(std::max(conservative[i].first, min_feerate).GetFeePerK()));
+                }
+                estimates.push_back(estimate);
+            }
+
+            UniValue percentiles(UniValue::VARR);
+            {
+                LOCK(mempool.cs);
+                uint64_t total_size{0};
+                for (const CTxMemPoolEntry& entry : mempool.mapTx) {
+                    total_size += entry.GetTxSize();
+                }
+                // Walk the mining order from its lowest feerate end, so that
+                // percentiles count the size with lower feerates
+                const auto& ancestor_index{mempool.mapTx.get<ancestor_score>()};
+                const CompareTxMemPoolEntryByAncestorFee compare;
+                uint64_t size_below{0};
+                size_t next{0};
+                for (auto it = ancestor_index.rbegin(); it != ancestor_index.rend() && next < MEMPOOL_FEERATE_PERCENTILES.size(); ++it) {
+                    size_below += it->GetTxSize();
+                    double mod_fee, size;
+                    compare.GetModFeeAndSize(*it, mod_fee, size);
+                    const CFeeRate feerate{CAmount(mod_fee), uint32_t(size)};
+                    while (next < MEMPOOL_FEERATE_PERCENTILES.size() && size_below * 100 >= total_size * MEMPOOL_FEERATE_PERCENTILES[next]) {
+                        percentiles.push_back(ValueFromAmount(feerate.GetFeePerK()));
+                        ++next;
+                    }
+                }
+            }
+
+            UniValue result(UniValue::VOBJ);
+            result.pushKV("estimates", estimates);
+            result.pushKV("mempool_feerate_percentiles", percentiles);
+            return result;
+        },
+    };
+}
+
 static RPCHelpMan estimaterawfee()
 {
     return RPCHelpMan{"estimaterawfee",
@@ -225,6 +315,7 @@ void RegisterFeeRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
         {"util", &estimatesmartfee},
+        {"util", &estimatefeecurve},
         {"hidden", &estimaterawfee},
     };
     for (const auto& c : commands) {
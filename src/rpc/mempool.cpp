@@ -10,6 +10,7 @@
 #include <chainparams.h>
 #include <core_io.h>
 #include <fs.h>
+#include <index/spentindex.h>
 #include <node/mempool_persist_args.h>
 #include <policy/rbf.h>
 #include <policy/settings.h>
@@ -28,6 +29,9 @@ using node::DEFAULT_MAX_RAW_TX_FEE_RATE;
 using node::MempoolPath;
 using node::NodeContext;
 
+/** Maximum number of transactions sendrawtransactions submits under one lock */
+static constexpr unsigned int MAX_SENDRAWTRANSACTIONS_COUNT{1000};
+
 static RPCHelpMan sendrawtransaction()
 {
     return RPCHelpMan{"sendrawtransaction",
@@ -89,6 +93,90 @@ static RPCHelpMan sendrawtransaction()
     };
 }
 
+static RPCHelpMan sendrawtransactions()
+{
+    return RPCHelpMan{"sendrawtransactions",
+        "\nSubmit raw transactions (serialized, hex-encoded) to local node and network.\n"
+        "\nLike calling sendrawtransaction for each of them, but the transactions are validated together\n"
+        "and announced to peers together. They are submitted in order, so a transaction may spend the\n"
+        "outputs of transactions before it. A failing transaction does not stop the others from being submitted.\n"
+        "\nThe maximum number of transactions allowed is " + ToString(MAX_SENDRAWTRANSACTIONS_COUNT) + ".\n"
+        "\nSee sendrawtransaction call.\n",
+        {
+            {"rawtxs", RPCArg::Type::ARR, RPCArg::Optional::NO, "An array of hex strings of raw transactions.",
+                {
+                    {"rawtx", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED, ""},
+                },
+            },
+            {"maxfeerate", RPCArg::Type::AMOUNT, RPCArg::Default{FormatMoney(DEFAULT_MAX_RAW_TX_FEE_RATE.GetFeePerK())},
+             "Reject transactions whose fee rate is higher than the specified value, expressed in " + CURRENCY_UNIT +
+                 "/kvB.\nSet to 0 to accept any fee rate.\n"},
+        },
+        RPCResult{
+            RPCResult::Type::ARR, "", "The result for each raw transaction, in the same order they were passed in.",
+            {
+                {RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::STR_HEX, "txid", "The transaction hash in hex"},
+                    {RPCResult::Type::STR_HEX, "wtxid", "The transaction witness hash in hex"},
+                    {RPCResult::Type::STR, "error", /*optional=*/true, "Why the transaction was not submitted (only present if it was not)"},
+                }},
+            }
+        },
+        RPCExamples{
+            HelpExampleCli("sendrawtransactions", R"('["signedhex1","signedhex2"]')") +
+            HelpExampleRpc("sendrawtransactions", "[\"signedhex1\",\"signedhex2\"]")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+        {
+            RPCTypeCheck(request.params, {
+                UniValue::VARR,
+                UniValueType(), // VNUM or VSTR, checked inside AmountFromValue()
+            });
+            const UniValue raw_transactions = request.params[0].get_array();
+            if (raw_transactions.size() < 1 || raw_transactions.size() > MAX_SENDRAWTRANSACTIONS_COUNT) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER,
+                                   "Array must contain between 1 and " + ToString(MAX_SENDRAWTRANSACTIONS_COUNT) + " transactions.");
+            }
+
+            const CFeeRate max_raw_tx_fee_rate = request.params[1].isNull() ?
+                                                     DEFAULT_MAX_RAW_TX_FEE_RATE :
+                                                     CFeeRate(AmountFromValue(request.params[1]));
+
+            std::vector<CTransactionRef> txns;
+            std::vector<CAmount> max_raw_tx_fees;
+            txns.reserve(raw_transactions.size());
+            max_raw_tx_fees.reserve(raw_transactions.size());
+            for (const auto& rawtx : raw_transactions.getValues()) {
+                CMutableTransaction mtx;
+                if (!DecodeHexTx(mtx, rawtx.get_str())) {
+                    throw JSONRPCError(RPC_DESERIALIZATION_ERROR,
+                                       "TX decode failed: " + rawtx.get_str() + " Make sure the tx has at least one input.");
+                }
+                const CTransactionRef& tx{txns.emplace_back(MakeTransactionRef(std::move(mtx)))};
+                max_raw_tx_fees.push_back(max_raw_tx_fee_rate.GetFee(GetVirtualTransactionSize(*tx)));
+            }
+
+            std::vector<std::string> err_strings;
+            AssertLockNotHeld(cs_main);
+            NodeContext& node = EnsureAnyNodeContext(request.context);
+            const std::vector<TransactionError> errors{BroadcastTransactions(node, txns, max_raw_tx_fees, err_strings, /*relay=*/true, /*wait_callback=*/true)};
+
+            UniValue rpc_result(UniValue::VARR);
+            for (size_t i = 0; i < txns.size(); ++i) {
+                UniValue result_inner(UniValue::VOBJ);
+                result_inner.pushKV("txid", txns[i]->GetHash().GetHex());
+                result_inner.pushKV("wtxid", txns[i]->GetWitnessHash().GetHex());
+                if (errors[i] != TransactionError::OK) {
+                    result_inner.pushKV("error", err_strings[i].empty() ? TransactionErrorString(errors[i]).original : err_strings[i]);
+                }
+                rpc_result.push_back(result_inner);
+            }
+            return rpc_result;
+        },
+    };
+}
+
 static RPCHelpMan testmempoolaccept()
 {
     return RPCHelpMan{"testmempoolaccept",
@@ -360,6 +448,19 @@ UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose, bool include_mempoo
     }
 }
 
+void MempoolToJSON(const CTxMemPool& pool, JSONStreamWriter& writer)
+{
+    LOCK(pool.cs);
+    writer.BeginObject();
+    for (const CTxMemPoolEntry& e : pool.mapTx) {
+        UniValue info(UniValue::VOBJ);
+        entryToJSON(pool, info, e);
+        writer.Key(e.GetTx().GetHash().ToString());
+        writer.Value(info);
+    }
+    writer.EndObject();
+}
+
 static RPCHelpMan getrawmempool()
 {
     return RPCHelpMan{"getrawmempool",
@@ -405,11 +506,97 @@ static RPCHelpMan getrawmempool()
         include_mempool_sequence = request.params[1].get_bool();
     }
 
+    if (fVerbose && !include_mempool_sequence && request.result_stream) {
+        MempoolToJSON(EnsureAnyMemPool(request.context), *request.result_stream);
+        return NullUniValue;
+    }
     return MempoolToJSON(EnsureAnyMemPool(request.context), fVerbose, include_mempool_sequence);
 },
     };
 }
 
+static RPCHelpMan getmempooldelta()
+{
+    return RPCHelpMan{"getmempooldelta",
+        "\nReturns the transactions that entered or left the memory pool since a mempool sequence value, as returned by\n"
+        "getrawmempool with mempool_sequence=true or by an earlier call. Only the last -mempooldeltaevents changes are kept;\n"
+        "when some of the changes asked for are no longer known, all transaction ids in the mempool are returned instead.\n",
+        {
+            {"since_sequence", RPCArg::Type::NUM, RPCArg::Optional::NO, "The mempool sequence value to report the changes from"},
+        },
+        {
+            RPCResult{"if the changes are known",
+                RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::BOOL, "full_resync", "false"},
+                    {RPCResult::Type::ARR, "events", "The changes, in the order they happened",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::NUM, "sequence", "The mempool sequence value of the change"},
+                            {RPCResult::Type::STR_HEX, "txid", "The transaction id"},
+                            {RPCResult::Type::STR, "type", "\"added\" if the transaction entered the mempool, \"removed\" if it left it for any reason, including being mined"},
+                        }},
+                    }},
+                    {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence value to pass in the next call"},
+                }},
+            RPCResult{"if the caller has to resync",
+                RPCResult::Type::OBJ, "", "",
+                {
+                    {RPCResult::Type::BOOL, "full_resync", "true"},
+                    {RPCResult::Type::ARR, "txids", "All transaction ids in the mempool",
+                    {
+                        {RPCResult::Type::STR_HEX, "", "The transaction id"},
+                    }},
+                    {RPCResult::Type::NUM, "mempool_sequence", "The mempool sequence value to pass in the next call"},
+                }},
+        },
+        RPCExamples{
+            HelpExampleCli("getmempooldelta", "1000")
+            + HelpExampleRpc("getmempooldelta", "1000")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const int64_t since{request.params[0].getInt<int64_t>()};
+    if (since < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "since_sequence must not be negative");
+    }
+    const CTxMemPool& pool = EnsureAnyMemPool(request.context);
+
+    std::optional<std::vector<MempoolDeltaEvent>> events;
+    std::vector<uint256> vtxid;
+    uint64_t mempool_sequence;
+    {
+        LOCK(pool.cs);
+        events = pool.GetDeltaEvents(since);
+        if (!events) pool.queryHashes(vtxid);
+        mempool_sequence = pool.GetSequence();
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("full_resync", !events);
+    if (events) {
+        UniValue a(UniValue::VARR);
+        for (const MempoolDeltaEvent& event : *events) {
+            UniValue o(UniValue::VOBJ);
+            o.pushKV("sequence", event.sequence);
+            o.pushKV("txid", event.txid.ToString());
+            o.pushKV("type", event.added ? "added" : "removed");
+            a.push_back(o);
+        }
+        ret.pushKV("events", a);
+    } else {
+        UniValue a(UniValue::VARR);
+        for (const uint256& hash : vtxid)
+            a.push_back(hash.ToString());
+        ret.pushKV("txids", a);
+    }
+    ret.pushKV("mempool_sequence", mempool_sequence);
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan getmempoolancestors()
 {
     return RPCHelpMan{"getmempoolancestors",
@@ -575,7 +762,8 @@ static RPCHelpMan getmempoolentry()
 static RPCHelpMan gettxspendingprevout()
 {
     return RPCHelpMan{"gettxspendingprevout",
-        "Scans the mempool to find transactions spending any of the given outputs",
+        "Scans the mempool to find transactions spending any of the given outputs.\n"
+        "With -spentindex, outputs spent in the block chain are looked up as well.",
         {
             {"outputs", RPCArg::Type::ARR, RPCArg::Optional::NO, "The transaction outputs that we want to check, and within each, the txid (string) vout (numeric).",
                 {
@@ -596,6 +784,8 @@ static RPCHelpMan gettxspendingprevout()
                     {RPCResult::Type::STR_HEX, "txid", "the transaction id of the checked output"},
                     {RPCResult::Type::NUM, "vout", "the vout value of the checked output"},
                     {RPCResult::Type::STR_HEX, "spendingtxid", /*optional=*/true, "the transaction id of the mempool transaction spending this output (omitted if unspent)"},
+                    {RPCResult::Type::NUM, "spendingvin", /*optional=*/true, "the input of the spending transaction (only for a spend in the block chain)"},
+                    {RPCResult::Type::STR_HEX, "blockhash", /*optional=*/true, "the block of the spending transaction (only for a spend in the block chain)"},
                 }},
             }
         },
@@ -633,23 +823,43 @@ static RPCHelpMan gettxspendingprevout()
             }
 
             const CTxMemPool& mempool = EnsureAnyMemPool(request.context);
-            LOCK(mempool.cs);
-
-            UniValue result{UniValue::VARR};
-
-            for (const COutPoint& prevout : prevouts) {
-                UniValue o(UniValue::VOBJ);
-                o.pushKV("txid", prevout.hash.ToString());
-                o.pushKV("vout", (uint64_t)prevout.n);
+            std::vector<UniValue> outputs;
+            std::vector<size_t> unspent_in_mempool;
+            {
+                LOCK(mempool.cs);
+                for (const COutPoint& prevout : prevouts) {
+                    UniValue o(UniValue::VOBJ);
+                    o.pushKV("txid", prevout.hash.ToString());
+                    o.pushKV("vout", (uint64_t)prevout.n);
+
+                    const CTransaction* spendingTx = mempool.GetConflictTx(prevout);
+                    if (spendingTx != nullptr) {
+                        o.pushKV("spendingtxid", spendingTx->GetHash().ToString());
+                    } else {
+                        unspent_in_mempool.push_back(outputs.size());
+                    }
 
-                const CTransaction* spendingTx = mempool.GetConflictTx(prevout);
-                if (spendingTx != nullptr) {
-                    o.pushKV("spendingtxid", spendingTx->GetHash().ToString());
+                    outputs.push_back(std::move(o));
                 }
+            }
 
-                result.push_back(o);
+            // The spent index reads blocks, so it is not queried under the mempool lock
+            if (g_spent_index && !unspent_in_mempool.empty()) {
+                g_spent_index->BlockUntilSyncedToCurrentChain();
+                for (size_t idx : unspent_in_mempool) {
+                    SpentIndexEntry spender;
+                    if (g_spent_index->FindSpender(prevouts[idx], spender)) {
+                        outputs[idx].pushKV("spendingtxid", spender.txid.ToString());
+                        outputs[idx].pushKV("spendingvin", uint64_t{spender.vin});
+                        outputs[idx].pushKV("blockhash", spender.block_hash.ToString());
+                    }
+                }
             }
 
+            UniValue result{UniValue::VARR};
+            for (UniValue& o : outputs) {
+                result.push_back(std::move(o));
+            }
             return result;
         },
     };
@@ -674,6 +884,44 @@ UniValue MempoolInfoToJSON(const CTxMemPool& pool)
     return ret;
 }
 
+static RPCHelpMan getmempoolusage()
+{
+    return RPCHelpMan{"getmempoolusage",
+        "Returns how the memory usage of the TX memory pool breaks down. The parts add up to the usage\n"
+        "reported by getmempoolinfo, which -maxmempool limits.",
+        {},
+        RPCResult{
+            RPCResult::Type::OBJ, "", "",
+            {
+                {RPCResult::Type::NUM, "usage", "Total memory usage for the mempool"},
+                {RPCResult::Type::NUM, "entries", "Memory usage of the mempool entries and the indexes over them"},
+                {RPCResult::Type::NUM, "transactions", "Memory usage of the transactions and their cached signature data"},
+                {RPCResult::Type::NUM, "relatives", "Memory usage of the sets of in-mempool parents and children of each transaction"},
+                {RPCResult::Type::NUM, "spends", "Memory usage of the map from spent outputs to the transactions spending them"},
+                {RPCResult::Type::NUM, "deltas", "Memory usage of the fee deltas set by prioritisetransaction"},
+                {RPCResult::Type::NUM, "txhashes", "Memory usage of the list of wtxids used for compact block reconstruction"},
+            }},
+        RPCExamples{
+            HelpExampleCli("getmempoolusage", "")
+            + HelpExampleRpc("getmempoolusage", "")
+        },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const CTxMemPool& pool = EnsureAnyMemPool(request.context);
+    const CTxMemPool::MemoryUsage usage{pool.GetMemoryUsage()};
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("usage", usage.entries + usage.transactions + usage.relatives + usage.spends + usage.deltas + usage.tx_hashes);
+    ret.pushKV("entries", usage.entries);
+    ret.pushKV("transactions", usage.transactions);
+    ret.pushKV("relatives", usage.relatives);
+    ret.pushKV("spends", usage.spends);
+    ret.pushKV("deltas", usage.deltas);
+    ret.pushKV("txhashes", usage.tx_hashes);
+    return ret;
+},
+    };
+}
+
 static RPCHelpMan getmempoolinfo()
 {
     return RPCHelpMan{"getmempoolinfo",
@@ -890,12 +1138,15 @@ void RegisterMempoolRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
         {"rawtransactions", &sendrawtransaction},
+        {"rawtransactions", &sendrawtransactions},
         {"rawtransactions", &testmempoolaccept},
         {"blockchain", &getmempoolancestors},
+        {"blockchain", &getmempooldelta},
         {"blockchain", &getmempooldescendants},
         {"blockchain", &getmempoolentry},
         {"blockchain", &gettxspendingprevout},
         {"blockchain", &getmempoolinfo},
+        {"blockchain", &getmempoolusage},
         {"blockchain", &getrawmempool},
         {"blockchain", &savemempool},
         {"hidden", &submitpackage},
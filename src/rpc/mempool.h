@@ -6,6 +6,7 @@
 #define BITCOIN_RPC_MEMPOOL_H
 
 class CTxMemPool;
+class JSONStreamWriter;
 class UniValue;
 
 /** Mempool information to JSON */
@@ -13,5 +14,7 @@ UniValue MempoolInfoToJSON(const CTxMemPool& pool);
 
 /** Mempool to JSON */
 UniValue MempoolToJSON(const CTxMemPool& pool, bool verbose = false, bool include_mempool_sequence = false);
+/** Verbose mempool to JSON, written to a stream one entry at a time */
+void MempoolToJSON(const CTxMemPool& pool, JSONStreamWriter& writer);
 
 #endif // BITCOIN_RPC_MEMPOOL_H
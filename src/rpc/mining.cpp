@@ -18,6 +18,7 @@
 #include <node/context.h>
 #include <node/miner.h>
 #include <pow.h>
+#include <powcache.h>
 #include <rpc/blockchain.h>
 #include <rpc/mining.h>
 #include <rpc/server.h>
@@ -27,6 +28,7 @@
 #include <script/script.h>
 #include <script/signingprovider.h>
 #include <shutdown.h>
+#include <streams.h>
 #include <timedata.h>
 #include <txmempool.h>
 #include <univalue.h>
@@ -38,15 +40,38 @@
 #include <validationinterface.h>
 #include <warnings.h>
 
+#include <deque>
 #include <memory>
+#include <optional>
+#include <set>
 #include <stdint.h>
 
 using node::BlockAssembler;
 using node::CBlockTemplate;
+using node::DEFAULT_GENERATE_THREADS;
+using node::GetTemplateId;
+using node::GrindNonce;
 using node::NodeContext;
 using node::RegenerateCommitments;
 using node::UpdateTime;
 
+namespace {
+/** A template recently returned by getblocktemplate */
+struct RecentTemplate {
+    uint256 prev_hash;
+    //! The transactions of the template after its coinbase
+    std::vector<CTransactionRef> txs;
+    //! The merkle branch of its coinbase, see BlockMerkleBranch()
+    std::vector<uint256> coinbase_branch;
+};
+} // namespace
+
+//! Recently returned templates by templateid, so that a client naming one of
+//! them only receives the data of new transactions, and a miner can submit a
+//! solution of one with submitsolution
+static std::map<uint256, RecentTemplate> g_recent_templates GUARDED_BY(cs_main);
+static std::deque<uint256> g_recent_template_ids GUARDED_BY(cs_main);
+
 /**
  * Return average network hashes per second based on the last 'lookup' blocks,
  * or from the last difficulty change if 'lookup' is nonpositive.
@@ -108,9 +133,25 @@ static RPCHelpMan getnetworkhashps()
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
 {
+    const int lookup{!request.params[0].isNull() ? request.params[0].getInt<int>() : 120};
+    const int height{!request.params[1].isNull() ? request.params[1].getInt<int>() : -1};
+
+    // Estimates at the tip are computed once per tip and served without cs_main afterwards
+    const auto tip_stats{GetTipStatsCache()};
+    const bool at_tip{tip_stats && (height < 0 || height >= tip_stats->tip->nHeight)};
+    if (at_tip) {
+        LOCK(tip_stats->cs);
+        if (const auto it{tip_stats->network_hashps.find(lookup)}; it != tip_stats->network_hashps.end()) return it->second;
+    }
+
     ChainstateManager& chainman = EnsureAnyChainman(request.context);
     LOCK(cs_main);
-    return GetNetworkHashPS(!request.params[0].isNull() ? request.params[0].getInt<int>() : 120, !request.params[1].isNull() ? request.params[1].getInt<int>() : -1, chainman.ActiveChain());
+    UniValue hashps{GetNetworkHashPS(lookup, height, chainman.ActiveChain())};
+    if (at_tip && chainman.ActiveChain().Tip() == tip_stats->tip) {
+        LOCK(tip_stats->cs);
+        if (tip_stats->network_hashps.size() < MAX_TIP_STATS_HASHPS_ENTRIES) tip_stats->network_hashps.emplace(lookup, hashps);
+    }
+    return hashps;
 },
     };
 }
@@ -120,10 +161,7 @@ static bool GenerateBlock(ChainstateManager& chainman, CBlock& block, uint64_t&
     block_hash.SetNull();
     block.hashMerkleRoot = BlockMerkleRoot(block);
 
-    while (max_tries > 0 && block.nNonce < std::numeric_limits<uint32_t>::max() && !CheckProofOfWork(block.GetPoWHash(), block.nBits, chainman.GetConsensus()) && !ShutdownRequested()) {
-        ++block.nNonce;
-        --max_tries;
-    }
+    GrindNonce(block, chainman.GetConsensus(), max_tries, gArgs.GetIntArg("-generatethreads", DEFAULT_GENERATE_THREADS));
     if (max_tries == 0 || ShutdownRequested()) {
         return false;
     }
@@ -423,7 +461,8 @@ static RPCHelpMan getmininginfo()
     obj.pushKV("blocks",           active_chain.Height());
     if (BlockAssembler::m_last_block_weight) obj.pushKV("currentblockweight", *BlockAssembler::m_last_block_weight);
     if (BlockAssembler::m_last_block_num_txs) obj.pushKV("currentblocktx", *BlockAssembler::m_last_block_num_txs);
-    obj.pushKV("difficulty",       (double)GetDifficulty(active_chain.Tip()));
+    const auto tip_stats{GetTipStatsCache()};
+    obj.pushKV("difficulty",       tip_stats && tip_stats->tip == active_chain.Tip() ? tip_stats->difficulty : GetDifficulty(active_chain.Tip()));
     obj.pushKV("networkhashps",    getnetworkhashps().HandleRequest(request));
     obj.pushKV("pooledtx",         (uint64_t)mempool.size());
     obj.pushKV("chain", chainman.GetParams().NetworkIDString());
@@ -500,6 +539,37 @@ static std::string gbt_vb_name(const Consensus::DeploymentPos pos) {
     return s;
 }
 
+/**
+ * Build the coinbase of a block template paying to the given script, and split
+ * its serialization around an extranonce pushed after the BIP34 height, the
+ * way stratum servers hand it out to miners as coinb1 and coinb2.
+ */
+static UniValue StratumCoinbase(const CBlock& block, int height, const CScript& script, int extranonce_size)
+{
+    CMutableTransaction coinbase{*block.vtx[0]};
+    coinbase.vin[0].scriptSig = CScript() << height;
+    const size_t prefix_script_size{coinbase.vin[0].scriptSig.size() + 1};
+    coinbase.vin[0].scriptSig << std::vector<unsigned char>(extranonce_size);
+    coinbase.vout[0].scriptPubKey = script;
+
+    CDataStream ss(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ss << coinbase;
+    // version, input count, prevout, scriptSig length, then the script up to the extranonce
+    const size_t prefix_size{4 + 1 + 36 + GetSizeOfCompactSize(coinbase.vin[0].scriptSig.size()) + prefix_script_size};
+    CHECK_NONFATAL(prefix_size + extranonce_size <= ss.size());
+
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : BlockMerkleBranch(block, 0)) {
+        branch.push_back(hash.GetHex());
+    }
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("prefix", HexStr(MakeUCharSpan(ss).first(prefix_size)));
+    result.pushKV("suffix", HexStr(MakeUCharSpan(ss).subspan(prefix_size + extranonce_size)));
+    result.pushKV("extranoncesize", extranonce_size);
+    result.pushKV("merklebranch", branch);
+    return result;
+}
+
 static RPCHelpMan getblocktemplate()
 {
     return RPCHelpMan{"getblocktemplate",
@@ -523,6 +593,9 @@ static RPCHelpMan getblocktemplate()
                     {"segwit", RPCArg::Type::STR, RPCArg::Optional::NO, "(literal) indicates client side segwit support"},
                     {"str", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "other client side supported softfork deployment"},
                 }},
+                {"coinbaseaddress", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Also return a coinbase paying to this address, split around the extranonce for stratum, and its merkle branch"},
+                {"extranoncesize", RPCArg::Type::NUM, RPCArg::Default{int{DEFAULT_GBT_EXTRANONCE_SIZE}}, "Size in bytes of the extranonce between the coinbase prefix and suffix"},
+                {"templateid", RPCArg::Type::STR_HEX, RPCArg::Optional::OMITTED_NAMED_ARG, "The templateid of a previous result; transactions it already contained are listed without 'data'"},
             },
                         "\"template_request\""},
         },
@@ -550,7 +623,7 @@ static RPCHelpMan getblocktemplate()
                 {
                     {RPCResult::Type::OBJ, "", "",
                     {
-                        {RPCResult::Type::STR_HEX, "data", "transaction data encoded in hexadecimal (byte-for-byte)"},
+                        {RPCResult::Type::STR_HEX, "data", /*optional=*/true, "transaction data encoded in hexadecimal (byte-for-byte); omitted if the transaction was in the requested templateid"},
                         {RPCResult::Type::STR_HEX, "txid", "transaction id encoded in little-endian hexadecimal"},
                         {RPCResult::Type::STR_HEX, "hash", "hash encoded in little-endian hexadecimal (including witness data)"},
                         {RPCResult::Type::ARR, "depends", "array of numbers",
@@ -567,6 +640,17 @@ static RPCHelpMan getblocktemplate()
                     {RPCResult::Type::STR_HEX, "key", "values must be in the coinbase (keys may be ignored)"},
                 }},
                 {RPCResult::Type::NUM, "coinbasevalue", "maximum allowable input to coinbase transaction, including the generation award and transaction fees (in satoshis)"},
+                {RPCResult::Type::OBJ, "coinbase", /*optional=*/true, "Only with coinbaseaddress",
+                {
+                    {RPCResult::Type::STR_HEX, "prefix", "serialized coinbase transaction (without witness) up to the extranonce"},
+                    {RPCResult::Type::STR_HEX, "suffix", "serialized coinbase transaction (without witness) after the extranonce"},
+                    {RPCResult::Type::NUM, "extranoncesize", "size in bytes of the extranonce"},
+                    {RPCResult::Type::ARR, "merklebranch", "hashes to combine with the coinbase txid, from the bottom up, to obtain the merkle root",
+                    {
+                        {RPCResult::Type::STR_HEX, "", "hash encoded in little-endian hexadecimal"},
+                    }},
+                }},
+                {RPCResult::Type::STR_HEX, "templateid", "an id to pass with a later request to omit the data of transactions already in this template"},
                 {RPCResult::Type::STR, "longpollid", "an id to include with a request to longpoll on an update to this template"},
                 {RPCResult::Type::STR, "target", "The hash target"},
                 {RPCResult::Type::NUM_TIME, "mintime", "The minimum timestamp appropriate for the next block time, expressed in " + UNIX_EPOCH_TIME},
@@ -597,6 +681,9 @@ static RPCHelpMan getblocktemplate()
 
     std::string strMode = "template";
     UniValue lpval = NullUniValue;
+    std::optional<CScript> coinbase_script;
+    int extranonce_size{DEFAULT_GBT_EXTRANONCE_SIZE};
+    std::optional<uint256> known_template_id;
     std::set<std::string> setClientRules;
     Chainstate& active_chainstate = chainman.ActiveChainstate();
     CChain& active_chain = active_chainstate.m_chain;
@@ -643,6 +730,26 @@ static RPCHelpMan getblocktemplate()
             return BIP22ValidationResult(state);
         }
 
+        const UniValue& coinbase_address = find_value(oparam, "coinbaseaddress");
+        if (!coinbase_address.isNull()) {
+            const CTxDestination destination = DecodeDestination(coinbase_address.get_str());
+            if (!IsValidDestination(destination)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Error: Invalid address");
+            }
+            coinbase_script = GetScriptForDestination(destination);
+        }
+        const UniValue& extranonce_size_val = find_value(oparam, "extranoncesize");
+        if (!extranonce_size_val.isNull()) {
+            extranonce_size = extranonce_size_val.getInt<int>();
+            if (extranonce_size < 1 || extranonce_size > MAX_GBT_EXTRANONCE_SIZE) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("extranoncesize must be between 1 and %d", MAX_GBT_EXTRANONCE_SIZE));
+            }
+        }
+        const UniValue& template_id = find_value(oparam, "templateid");
+        if (!template_id.isNull()) {
+            known_template_id = ParseHashV(template_id, "templateid");
+        }
+
         const UniValue& aClientRules = find_value(oparam, "rules");
         if (aClientRules.isArray()) {
             for (unsigned int i = 0; i < aClientRules.size(); ++i) {
@@ -743,9 +850,9 @@ static RPCHelpMan getblocktemplate()
         CBlockIndex* pindexPrevNew = active_chain.Tip();
         nStart = GetTime();
 
-        // Create new block
+        // Create new block, extending the previous template if it is for the same tip
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler{active_chainstate, &mempool}.CreateNewBlock(scriptDummy);
+        pblocktemplate = BlockAssembler{active_chainstate, &mempool}.CreateNewBlock(scriptDummy, pblocktemplate.get());
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
@@ -764,6 +871,27 @@ static RPCHelpMan getblocktemplate()
 
     UniValue aCaps(UniValue::VARR); aCaps.push_back("proposal");
 
+    const uint256 template_id{GetTemplateId(*pblock)};
+    if (!g_recent_templates.count(template_id)) {
+        RecentTemplate& recent{g_recent_templates[template_id]};
+        recent.prev_hash = pblock->hashPrevBlock;
+        recent.txs.assign(pblock->vtx.begin() + 1, pblock->vtx.end());
+        recent.coinbase_branch = BlockMerkleBranch(*pblock, 0);
+        g_recent_template_ids.push_back(template_id);
+        if (g_recent_template_ids.size() > MAX_GBT_RECENT_TEMPLATES) {
+            g_recent_templates.erase(g_recent_template_ids.front());
+            g_recent_template_ids.pop_front();
+        }
+    }
+    std::optional<std::set<uint256>> known_txids;
+    if (known_template_id) {
+        const auto known{g_recent_templates.find(*known_template_id)};
+        if (known != g_recent_templates.end()) {
+            known_txids.emplace();
+            for (const auto& tx : known->second.txs) known_txids->insert(tx->GetHash());
+        }
+    }
+
     UniValue transactions(UniValue::VARR);
     std::map<uint256, int64_t> setTxIndex;
     int i = 0;
@@ -777,7 +905,9 @@ static RPCHelpMan getblocktemplate()
 
         UniValue entry(UniValue::VOBJ);
 
-        entry.pushKV("data", EncodeHexTx(tx));
+        if (!known_txids || !known_txids->count(txHash)) {
+            entry.pushKV("data", EncodeHexTx(tx));
+        }
         entry.pushKV("txid", txHash.GetHex());
         entry.pushKV("hash", tx.GetWitnessHash().GetHex());
 
@@ -872,6 +1002,10 @@ static RPCHelpMan getblocktemplate()
     result.pushKV("transactions", transactions);
     result.pushKV("coinbaseaux", aux);
     result.pushKV("coinbasevalue", (int64_t)pblock->vtx[0]->vout[0].nValue);
+    if (coinbase_script) {
+        result.pushKV("coinbase", StratumCoinbase(*pblock, pindexPrev->nHeight + 1, *coinbase_script, extranonce_size));
+    }
+    result.pushKV("templateid", template_id.GetHex());
     result.pushKV("longpollid", active_chain.Tip()->GetBlockHash().GetHex() + ToString(nTransactionsUpdatedLast));
     result.pushKV("target", hashTarget.GetHex());
     result.pushKV("mintime", (int64_t)pindexPrev->GetMedianTimePast()+1);
@@ -923,8 +1057,26 @@ protected:
         found = true;
         state = stateIn;
     }
+    std::string ValidationInterfaceName() const override { return "submitblock"; }
 };
 
+/** Process a block submitted by RPC, returning the result of submitblock. */
+static UniValue ProcessSubmittedBlock(ChainstateManager& chainman, const std::shared_ptr<const CBlock>& blockptr)
+{
+    bool new_block;
+    auto sc = std::make_shared<submitblock_StateCatcher>(blockptr->GetHash());
+    RegisterSharedValidationInterface(sc);
+    bool accepted = chainman.ProcessNewBlock(blockptr, /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/&new_block);
+    UnregisterSharedValidationInterface(sc);
+    if (!new_block && accepted) {
+        return "duplicate";
+    }
+    if (!sc->found) {
+        return "inconclusive";
+    }
+    return BIP22ValidationResult(sc->state);
+}
+
 static RPCHelpMan submitblock()
 {
     // We allow 2 arguments for compliance with BIP22. Argument 2 is ignored.
@@ -978,18 +1130,91 @@ static RPCHelpMan submitblock()
         }
     }
 
-    bool new_block;
-    auto sc = std::make_shared<submitblock_StateCatcher>(block.GetHash());
-    RegisterSharedValidationInterface(sc);
-    bool accepted = chainman.ProcessNewBlock(blockptr, /*force_processing=*/true, /*min_pow_checked=*/true, /*new_block=*/&new_block);
-    UnregisterSharedValidationInterface(sc);
-    if (!new_block && accepted) {
-        return "duplicate";
+    return ProcessSubmittedBlock(chainman, blockptr);
+},
+    };
+}
+
+static RPCHelpMan submitsolution()
+{
+    return RPCHelpMan{"submitsolution",
+        "\nSubmit a solution of a template recently returned by getblocktemplate, as its block header and coinbase.\n"
+        "The other transactions of the block are those of the template, so they do not need to be sent, and the block\n"
+        "is rejected right away if its merkle root or proof of work is wrong. Otherwise it is processed as by submitblock.\n",
+        {
+            {"templateid", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "the templateid of the template"},
+            {"header", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "the hex-encoded block header"},
+            {"coinbase", RPCArg::Type::STR_HEX, RPCArg::Optional::NO, "the hex-encoded coinbase transaction"},
+        },
+        {
+            RPCResult{"If the block was accepted", RPCResult::Type::NONE, "", ""},
+            RPCResult{"Otherwise", RPCResult::Type::STR, "", "According to BIP22"},
+        },
+        RPCExamples{
+                    HelpExampleCli("submitsolution", "\"templateid\" \"header\" \"coinbase\"")
+            + HelpExampleRpc("submitsolution", "\"templateid\", \"header\", \"coinbase\"")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const uint256 template_id{ParseHashV(request.params[0], "templateid")};
+    CBlockHeader header;
+    if (!DecodeHexBlockHeader(header, request.params[1].get_str())) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Block header decode failed");
     }
-    if (!sc->found) {
-        return "inconclusive";
+    CMutableTransaction mtx;
+    if (!DecodeHexTx(mtx, request.params[2].get_str())) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Coinbase decode failed");
     }
-    return BIP22ValidationResult(sc->state);
+    CTransactionRef coinbase{MakeTransactionRef(std::move(mtx))};
+    if (!coinbase->IsCoinBase()) {
+        throw JSONRPCError(RPC_DESERIALIZATION_ERROR, "Transaction is not a coinbase");
+    }
+
+    ChainstateManager& chainman = EnsureAnyChainman(request.context);
+    std::shared_ptr<CBlock> blockptr = std::make_shared<CBlock>(header);
+    CBlock& block = *blockptr;
+    std::vector<uint256> coinbase_branch;
+    {
+        LOCK(cs_main);
+        const auto recent{g_recent_templates.find(template_id)};
+        if (recent == g_recent_templates.end()) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown templateid, the template may have expired");
+        }
+        if (header.hashPrevBlock != recent->second.prev_hash) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Block header does not build on the previous block of the template");
+        }
+        block.vtx.reserve(recent->second.txs.size() + 1);
+        block.vtx.push_back(coinbase);
+        block.vtx.insert(block.vtx.end(), recent->second.txs.begin(), recent->second.txs.end());
+        coinbase_branch = recent->second.coinbase_branch;
+        const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(block.hashPrevBlock);
+        if (pindex) {
+            chainman.UpdateUncommittedBlockStructures(block, pindex);
+        }
+    }
+
+    // Only the header and coinbase differ from the template, check them
+    // before validating the whole block
+    if (ComputeMerkleRootFromBranch(coinbase->GetHash(), coinbase_branch, 0) != header.hashMerkleRoot) {
+        return "bad-txnmrklroot";
+    }
+    if (!CheckProofOfWork(GetPoWHashCached(header), header.nBits, chainman.GetConsensus())) {
+        return "high-hash";
+    }
+    {
+        LOCK(cs_main);
+        const CBlockIndex* pindex = chainman.m_blockman.LookupBlockIndex(header.GetHash());
+        if (pindex) {
+            if (pindex->IsValid(BLOCK_VALID_SCRIPTS)) {
+                return "duplicate";
+            }
+            if (pindex->nStatus & BLOCK_FAILED_MASK) {
+                return "duplicate-invalid";
+            }
+        }
+    }
+
+    return ProcessSubmittedBlock(chainman, blockptr);
 },
     };
 }
@@ -1042,6 +1267,7 @@ void RegisterMiningRPCCommands(CRPCTable& t)
         {"mining", &getblocktemplate},
         {"mining", &submitblock},
         {"mining", &submitheader},
+        {"mining", &submitsolution},
 
         {"hidden", &generatetoaddress},
         {"hidden", &generatetodescriptor},
@@ -8,4 +8,11 @@
 /** Default max iterations to try in RPC generatetodescriptor, generatetoaddress, and generateblock. */
 static const uint64_t DEFAULT_MAX_TRIES{1000000};
 
+/** Default and maximum size of the extranonce in getblocktemplate's stratum coinbase. */
+static const int DEFAULT_GBT_EXTRANONCE_SIZE{8};
+static const int MAX_GBT_EXTRANONCE_SIZE{32};
+
+/** Number of recent templates whose transactions getblocktemplate remembers for templateid requests. */
+static const size_t MAX_GBT_RECENT_TEMPLATES{16};
+
 #endif // BITCOIN_RPC_MINING_H
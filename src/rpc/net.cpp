@@ -142,6 +142,12 @@ static RPCHelpMan getpeerinfo()
                     {RPCResult::Type::BOOL, "addr_relay_enabled", /*optional=*/true, "Whether we participate in address relay with this peer"},
                     {RPCResult::Type::NUM, "addr_processed", /*optional=*/true, "The total number of addresses processed, excluding those dropped due to rate limiting"},
                     {RPCResult::Type::NUM, "addr_rate_limited", /*optional=*/true, "The total number of addresses dropped due to rate limiting"},
+                    {RPCResult::Type::OBJ, "cmpctblock_reconstructions", /*optional=*/true, "The compact blocks received from this peer, by how they were reconstructed",
+                    {
+                        {RPCResult::Type::NUM, "immediate", "Reconstructed from prefilled, mempool and extra transactions alone"},
+                        {RPCResult::Type::NUM, "after_getblocktxn", "Reconstructed after requesting the missing transactions"},
+                        {RPCResult::Type::NUM, "failed", "Given up on and downloaded in full"},
+                    }},
                     {RPCResult::Type::ARR, "permissions", "Any special permissions that have been granted to this peer",
                     {
                         {RPCResult::Type::STR, "permission_type", Join(NET_PERMISSIONS_DOC, ",\n") + ".\n"},
@@ -153,6 +159,16 @@ static RPCHelpMan getpeerinfo()
                                                       "When a message type is not listed in this json object, the bytes sent are 0.\n"
                                                       "Only known message types can appear as keys in the object."}
                     }},
+                    {RPCResult::Type::OBJ_DYN, "send_queues", "The queues of messages to send to the peer, drained in the order block, tx, addr",
+                    {
+                        {RPCResult::Type::OBJ, "queue", "",
+                        {
+                            {RPCResult::Type::NUM, "queued_bytes", "The total size of the messages queued"},
+                            {RPCResult::Type::NUM, "sent_msgs", "The number of messages sent from the queue"},
+                            {RPCResult::Type::NUM, "mean_delay", "The mean time the sent messages waited in the queue, in seconds"},
+                            {RPCResult::Type::NUM, "max_delay", "The longest time a sent message waited in the queue, in seconds"},
+                        }},
+                    }},
                     {RPCResult::Type::OBJ_DYN, "bytesrecv_per_msg", "",
                     {
                         {RPCResult::Type::NUM, "msg", "The total bytes received aggregated by message type\n"
@@ -240,6 +256,11 @@ static RPCHelpMan getpeerinfo()
             obj.pushKV("addr_relay_enabled", statestats.m_addr_relay_enabled);
             obj.pushKV("addr_processed", statestats.m_addr_processed);
             obj.pushKV("addr_rate_limited", statestats.m_addr_rate_limited);
+            UniValue cmpctblock_reconstructions(UniValue::VOBJ);
+            cmpctblock_reconstructions.pushKV("immediate", statestats.m_cmpctblocks_reconstructed);
+            cmpctblock_reconstructions.pushKV("after_getblocktxn", statestats.m_cmpctblocks_reconstructed_after_request);
+            cmpctblock_reconstructions.pushKV("failed", statestats.m_cmpctblocks_failed);
+            obj.pushKV("cmpctblock_reconstructions", cmpctblock_reconstructions);
         }
         UniValue permissions(UniValue::VARR);
         for (const auto& permission : NetPermissions::ToStrings(stats.m_permission_flags)) {
@@ -254,6 +275,18 @@ static RPCHelpMan getpeerinfo()
         }
         obj.pushKV("bytessent_per_msg", sendPerMsgType);
 
+        UniValue send_queues(UniValue::VOBJ);
+        for (size_t queue = 0; queue < NUM_SEND_PRIORITIES; ++queue) {
+            const SendQueueStats& queue_stats{stats.m_send_queue_stats[queue]};
+            UniValue queue_obj(UniValue::VOBJ);
+            queue_obj.pushKV("queued_bytes", (uint64_t)queue_stats.queued_bytes);
+            queue_obj.pushKV("sent_msgs", queue_stats.sent_msgs);
+            queue_obj.pushKV("mean_delay", queue_stats.sent_msgs ? Ticks<SecondsDouble>(queue_stats.total_delay) / queue_stats.sent_msgs : 0.0);
+            queue_obj.pushKV("max_delay", Ticks<SecondsDouble>(queue_stats.max_delay));
+            send_queues.pushKV(SendPriorityAsString(static_cast<SendPriority>(queue)), queue_obj);
+        }
+        obj.pushKV("send_queues", send_queues);
+
         UniValue recvPerMsgType(UniValue::VOBJ);
         for (const auto& i : stats.mapRecvBytesPerMsgType) {
             if (i.second > 0)
@@ -6,21 +6,28 @@
 #include <chainparams.h>
 #include <httpserver.h>
 #include <index/blockfilterindex.h>
+#include <index/addressindex.h>
+#include <index/blockstatsindex.h>
 #include <index/coinstatsindex.h>
+#include <index/spentindex.h>
 #include <index/txindex.h>
 #include <interfaces/chain.h>
 #include <interfaces/echo.h>
 #include <interfaces/init.h>
 #include <interfaces/ipc.h>
 #include <node/context.h>
+#include <node/memory_usage.h>
+#include <node/startup.h>
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
 #include <scheduler.h>
+#include <sync.h>
 #include <univalue.h>
 #include <util/check.h>
 #include <util/syscall_sandbox.h>
 #include <util/system.h>
+#include <util/time.h>
 
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
@@ -210,6 +217,124 @@ static RPCHelpMan getmemoryinfo()
     };
 }
 
+static RPCHelpMan getmemoryusage()
+{
+    return RPCHelpMan{"getmemoryusage",
+                "Returns the memory used by the subsystems of the node, as they account for it, to help size -dbcache and -maxmempool.\n"
+                "Allocator overhead and memory that no subsystem accounts for are left out, so the total is below the resident size of the process.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "total", "The bytes used by all of the subsystems"},
+                        {RPCResult::Type::OBJ_DYN, "subsystems", "The bytes used by each subsystem",
+                        {
+                            {RPCResult::Type::NUM, "name", "The bytes used by the subsystem: coins_cache, coins_db, block_index, block_index_db, script_cache, "
+                                                           "signature_cache, pow_cache, mempool, addrman, peer_buffers, indexes or wallets"},
+                        }},
+                    }},
+                RPCExamples{
+                    HelpExampleCli("getmemoryusage", "")
+            + HelpExampleRpc("getmemoryusage", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const NodeContext& node = EnsureAnyNodeContext(request.context);
+
+    uint64_t total{0};
+    UniValue subsystems(UniValue::VOBJ);
+    for (const node::SubsystemMemoryUsage& usage : node::GetMemoryUsage(node)) {
+        total += usage.bytes;
+        subsystems.pushKV(usage.name, uint64_t{usage.bytes});
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("total", total);
+    result.pushKV("subsystems", subsystems);
+    return result;
+},
+    };
+}
+
+static UniValue LockHistogramToUniv(const std::array<uint64_t, LOCK_STATS_BUCKETS>& histogram)
+{
+    UniValue ret(UniValue::VARR);
+    for (const uint64_t count : histogram) ret.push_back(count);
+    return ret;
+}
+
+static RPCHelpMan getlockstats()
+{
+    return RPCHelpMan{"getlockstats",
+                "Returns how often and for how long the locks taken at each lock site were waited for and held,\n"
+                "longest total wait first. Statistics are only recorded while the lock profiler is enabled,\n"
+                "see -lockstats. The hold time of locks released to wait on a condition variable includes the wait.\n",
+                {
+                    {"reset", RPCArg::Type::BOOL, RPCArg::Default{false}, "Reset the statistics after returning them."},
+                    {"enable", RPCArg::Type::BOOL, RPCArg::Optional::OMITTED_NAMED_ARG, "Enable or disable the lock profiler afterwards."},
+                },
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::BOOL, "enabled", "Whether the lock profiler is enabled"},
+                        {RPCResult::Type::ARR, "sites", "",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "name", "Name of the lock, as written at the site"},
+                                {RPCResult::Type::STR, "file", "Source file of the site"},
+                                {RPCResult::Type::NUM, "line", "Source line of the site"},
+                                {RPCResult::Type::NUM, "count", "Number of times the lock was taken"},
+                                {RPCResult::Type::NUM, "contended", "Number of times the lock was held by another thread"},
+                                {RPCResult::Type::NUM, "wait_us", "Total time waited for the lock, in microseconds"},
+                                {RPCResult::Type::NUM, "max_wait_us", "Longest wait for the lock, in microseconds"},
+                                {RPCResult::Type::NUM, "holds", "Number of times the held lock was released"},
+                                {RPCResult::Type::NUM, "hold_us", "Total time the lock was held, in microseconds"},
+                                {RPCResult::Type::NUM, "max_hold_us", "Longest time the lock was held, in microseconds"},
+                                {RPCResult::Type::ARR_FIXED, "wait_histogram", strprintf("Number of waits below 2^i microseconds for bucket i, the last of the %d buckets counts all longer waits", LOCK_STATS_BUCKETS),
+                                    {{RPCResult::Type::NUM, "", ""}}},
+                                {RPCResult::Type::ARR_FIXED, "hold_histogram", "Number of holds, in the same buckets",
+                                    {{RPCResult::Type::NUM, "", ""}}},
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getlockstats", "")
+            + HelpExampleCli("getlockstats", "true")
+            + HelpExampleRpc("getlockstats", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    UniValue sites(UniValue::VARR);
+    for (const LockSiteInfo& info : GetLockStats()) {
+        UniValue site(UniValue::VOBJ);
+        site.pushKV("name", info.name);
+        site.pushKV("file", info.file);
+        site.pushKV("line", info.line);
+        site.pushKV("count", info.count);
+        site.pushKV("contended", info.contended);
+        site.pushKV("wait_us", count_microseconds(info.wait_time));
+        site.pushKV("max_wait_us", count_microseconds(info.max_wait));
+        site.pushKV("holds", info.holds);
+        site.pushKV("hold_us", count_microseconds(info.hold_time));
+        site.pushKV("max_hold_us", count_microseconds(info.max_hold));
+        site.pushKV("wait_histogram", LockHistogramToUniv(info.wait_histogram));
+        site.pushKV("hold_histogram", LockHistogramToUniv(info.hold_histogram));
+        sites.push_back(std::move(site));
+    }
+
+    if (!request.params[0].isNull() && request.params[0].get_bool()) ResetLockStats();
+    if (!request.params[1].isNull()) SetLockStatsEnabled(request.params[1].get_bool());
+
+    UniValue ret(UniValue::VOBJ);
+    ret.pushKV("enabled", LockStatsEnabled());
+    ret.pushKV("sites", std::move(sites));
+    return ret;
+},
+    };
+}
+
 static void EnableOrDisableLogCategories(UniValue cats, bool enable) {
     cats = cats.get_array();
     for (unsigned int i = 0; i < cats.size(); ++i) {
@@ -410,6 +535,18 @@ static RPCHelpMan getindexinfo()
         result.pushKVs(SummaryToJSON(g_coin_stats_index->GetSummary(), index_name));
     }
 
+    if (g_block_stats_index) {
+        result.pushKVs(SummaryToJSON(g_block_stats_index->GetSummary(), index_name));
+    }
+
+    if (g_address_index) {
+        result.pushKVs(SummaryToJSON(g_address_index->GetSummary(), index_name));
+    }
+
+    if (g_spent_index) {
+        result.pushKVs(SummaryToJSON(g_spent_index->GetSummary(), index_name));
+    }
+
     ForEachBlockFilterIndex([&result, &index_name](const BlockFilterIndex& index) {
         result.pushKVs(SummaryToJSON(index.GetSummary(), index_name));
     });
@@ -419,11 +556,65 @@ static RPCHelpMan getindexinfo()
     };
 }
 
+static RPCHelpMan getstartupinfo()
+{
+    return RPCHelpMan{"getstartupinfo",
+                "\nReturns how long the stages of node startup took.\n"
+                "Stages marked parallel ran on threads of their own, alongside the others; import goes on after startup.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "total", "Time from the start of initialization until the node was started, in milliseconds"},
+                        {RPCResult::Type::ARR, "stages", "The stages that finished, in the order they did",
+                        {
+                            {RPCResult::Type::OBJ, "", "",
+                            {
+                                {RPCResult::Type::STR, "name", "The name of the stage"},
+                                {RPCResult::Type::NUM, "start", "Time from the start of initialization until the stage started, in milliseconds"},
+                                {RPCResult::Type::NUM, "duration", "How long the stage took, in milliseconds"},
+                                {RPCResult::Type::BOOL, "parallel", "Whether the stage ran on a thread of its own"},
+                            }},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getstartupinfo", "")
+                  + HelpExampleRpc("getstartupinfo", "")
+                },
+                [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const NodeContext& node = EnsureAnyNodeContext(request.context);
+    if (!node.startup_profiler) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Startup was not profiled");
+    }
+
+    UniValue stages(UniValue::VARR);
+    for (const node::StartupStage& stage : node.startup_profiler->GetStages()) {
+        UniValue entry(UniValue::VOBJ);
+        entry.pushKV("name", stage.name);
+        entry.pushKV("start", count_milliseconds(stage.begin));
+        entry.pushKV("duration", count_milliseconds(stage.duration));
+        entry.pushKV("parallel", stage.parallel);
+        stages.push_back(entry);
+    }
+
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("total", count_milliseconds(*Assert(node.startup_profiler->GetTotal())));
+    result.pushKV("stages", stages);
+    return result;
+},
+    };
+}
+
 void RegisterNodeRPCCommands(CRPCTable& t)
 {
     static const CRPCCommand commands[]{
         {"control", &getmemoryinfo},
+        {"control", &getmemoryusage},
         {"control", &logging},
+        {"control", &getlockstats},
+        {"control", &getstartupinfo},
         {"util", &getindexinfo},
         {"hidden", &setmocktime},
         {"hidden", &mockscheduler},
@@ -14,12 +14,15 @@
 #include <script/script.h>
 #include <script/signingprovider.h>
 #include <script/standard.h>
+#include <sync.h>
 #include <tinyformat.h>
 #include <univalue.h>
 #include <util/check.h>
 #include <util/strencodings.h>
+#include <util/system.h>
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <optional>
 #include <string>
@@ -215,6 +218,20 @@ static RPCHelpMan getdescriptorinfo()
     };
 }
 
+/** A descriptor deriveaddresses parsed before, with the xpubs its expansion derived. */
+struct ParsedDescriptor {
+    std::shared_ptr<const Descriptor> desc;
+    FlatSigningProvider key_provider;
+    DescriptorCache cache;
+};
+
+/** Maximum number of descriptors deriveaddresses keeps parsed, after which they are all dropped. */
+static constexpr size_t MAX_PARSED_DESCRIPTORS{100};
+
+static Mutex g_parsed_descriptors_mutex;
+/** Descriptors without private keys, by their string, so repeated calls skip parsing and derivation. */
+static std::map<std::string, ParsedDescriptor> g_parsed_descriptors GUARDED_BY(g_parsed_descriptors_mutex);
+
 static RPCHelpMan deriveaddresses()
 {
     const std::string EXAMPLE_DESCRIPTOR = "wpkh([d34db33f/84h/0h/0h]xpub6DJ2dNUysrn5Vt36jH2KLBT2i1auw1tTSSomg8PhqNiUtx8QX2SvC9nrHu81fT41fvDUnhMjEzQgXnQjKEu3oaqMSzhSrHMxyyoEAmUHQbY/0/*)#cjjspncu";
@@ -256,11 +273,24 @@ static RPCHelpMan deriveaddresses()
                 std::tie(range_begin, range_end) = ParseDescriptorRange(request.params[1]);
             }
 
+            std::shared_ptr<const Descriptor> desc;
             FlatSigningProvider key_provider;
-            std::string error;
-            auto desc = Parse(desc_str, key_provider, error, /* require_checksum = */ true);
+            DescriptorCache cache;
+            {
+                LOCK(g_parsed_descriptors_mutex);
+                const auto it{g_parsed_descriptors.find(desc_str)};
+                if (it != g_parsed_descriptors.end()) {
+                    desc = it->second.desc;
+                    key_provider = it->second.key_provider;
+                    cache = it->second.cache;
+                }
+            }
             if (!desc) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, error);
+                std::string error;
+                desc = Parse(desc_str, key_provider, error, /* require_checksum = */ true);
+                if (!desc) {
+                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, error);
+                }
             }
 
             if (!desc->IsRange() && request.params.size() > 1) {
@@ -271,15 +301,23 @@ static RPCHelpMan deriveaddresses()
                 throw JSONRPCError(RPC_INVALID_PARAMETER, "Range must be specified for a ranged descriptor");
             }
 
-            UniValue addresses(UniValue::VARR);
+            std::vector<std::vector<CScript>> range_scripts;
+            if (!ExpandRange(*desc, range_begin, range_end, key_provider, cache, range_scripts, GetNumCores())) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Cannot derive script without private keys");
+            }
 
-            for (int64_t i = range_begin; i <= range_end; ++i) {
-                FlatSigningProvider provider;
-                std::vector<CScript> scripts;
-                if (!desc->Expand(i, key_provider, scripts, provider)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Cannot derive script without private keys");
+            // Keep descriptors without private keys around, so these never stay in memory
+            if (key_provider.keys.empty()) {
+                LOCK(g_parsed_descriptors_mutex);
+                if (g_parsed_descriptors.size() >= MAX_PARSED_DESCRIPTORS && !g_parsed_descriptors.count(desc_str)) {
+                    g_parsed_descriptors.clear();
                 }
+                g_parsed_descriptors[desc_str] = ParsedDescriptor{desc, key_provider, std::move(cache)};
+            }
+
+            UniValue addresses(UniValue::VARR);
 
+            for (const std::vector<CScript>& scripts : range_scripts) {
                 for (const CScript& script : scripts) {
                     CTxDestination dest;
                     if (!ExtractDestination(script, dest)) {
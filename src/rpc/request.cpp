@@ -12,9 +12,11 @@
 #include <util/system.h>
 #include <util/strencodings.h>
 
+#include <cassert>
 #include <fstream>
 #include <stdexcept>
 #include <string>
+#include <utility>
 #include <vector>
 
 /**
@@ -187,3 +189,86 @@ void JSONRPCRequest::parse(const UniValue& valRequest)
     else
         throw JSONRPCError(RPC_INVALID_REQUEST, "Params must be an array or object");
 }
+
+JSONStreamWriter::JSONStreamWriter(Sink sink, size_t flush_size)
+    : m_sink{std::move(sink)}, m_flush_size{flush_size} {}
+
+void JSONStreamWriter::Separate()
+{
+    m_empty = false;
+    if (m_after_key) {
+        m_after_key = false;
+        return;
+    }
+    if (m_has_entries.empty()) return;
+    if (m_has_entries.back()) m_buffer += ',';
+    m_has_entries.back() = true;
+}
+
+void JSONStreamWriter::MaybeFlush()
+{
+    if (m_buffer.size() < m_flush_size) return;
+    m_sink(std::move(m_buffer), /*last=*/false);
+    m_buffer.clear();
+}
+
+void JSONStreamWriter::BeginObject()
+{
+    Separate();
+    m_buffer += '{';
+    m_has_entries.push_back(false);
+}
+
+void JSONStreamWriter::EndObject()
+{
+    assert(!m_has_entries.empty() && !m_after_key);
+    m_buffer += '}';
+    m_has_entries.pop_back();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::BeginArray()
+{
+    Separate();
+    m_buffer += '[';
+    m_has_entries.push_back(false);
+}
+
+void JSONStreamWriter::EndArray()
+{
+    assert(!m_has_entries.empty() && !m_after_key);
+    m_buffer += ']';
+    m_has_entries.pop_back();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Key(const std::string& key)
+{
+    assert(!m_after_key);
+    Separate();
+    m_buffer += UniValue{key}.write();
+    m_buffer += ':';
+    m_after_key = true;
+}
+
+void JSONStreamWriter::Value(const UniValue& value)
+{
+    Separate();
+    m_buffer += value.write();
+    MaybeFlush();
+}
+
+void JSONStreamWriter::Fields(const UniValue& obj)
+{
+    for (size_t i = 0; i < obj.size(); ++i) {
+        Key(obj.getKeys()[i]);
+        Value(obj.getValues()[i]);
+    }
+}
+
+void JSONStreamWriter::Finish()
+{
+    assert(m_has_entries.empty() && !m_after_key);
+    m_sink(std::move(m_buffer), /*last=*/true);
+    m_buffer.clear();
+}
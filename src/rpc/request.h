@@ -7,7 +7,10 @@
 #define BITCOIN_RPC_REQUEST_H
 
 #include <any>
+#include <cstddef>
+#include <functional>
 #include <string>
+#include <vector>
 
 #include <univalue.h>
 
@@ -25,6 +28,49 @@ void DeleteAuthCookie();
 /** Parse JSON-RPC batch reply into a vector */
 std::vector<UniValue> JSONRPCProcessBatchReply(const UniValue& in);
 
+/**
+ * Writes a JSON document in pieces, so that a large result need not be built as a single
+ * UniValue tree and serialized as a whole before the first byte is sent. The values written
+ * into the document are still UniValues, but only one of them needs to be in memory at a time.
+ */
+class JSONStreamWriter
+{
+public:
+    /** Receives the document in order, in pieces of about the flush size. last is set for the final piece. */
+    using Sink = std::function<void(std::string&& data, bool last)>;
+
+    static constexpr size_t DEFAULT_FLUSH_SIZE{64 * 1024};
+
+    explicit JSONStreamWriter(Sink sink, size_t flush_size = DEFAULT_FLUSH_SIZE);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+    /** Write the key of the next value of the current object. */
+    void Key(const std::string& key);
+    void Value(const UniValue& value);
+    /** Write the keys and values of obj into the current object. */
+    void Fields(const UniValue& obj);
+
+    /** Whether nothing was written yet. */
+    bool Empty() const { return m_empty; }
+    /** Pass what is left of the document to the sink, as its last piece. */
+    void Finish();
+
+private:
+    void Separate();
+    void MaybeFlush();
+
+    const Sink m_sink;
+    const size_t m_flush_size;
+    std::string m_buffer;
+    //! For each object or array being written, whether it has entries yet
+    std::vector<bool> m_has_entries;
+    bool m_after_key{false};
+    bool m_empty{true};
+};
+
 class JSONRPCRequest
 {
 public:
@@ -36,6 +82,11 @@ public:
     std::string authUser;
     std::string peerAddr;
     std::any context;
+    /**
+     * If set, a method with a large result may write it here instead of returning it. It then
+     * returns null, and the caller completes the document.
+     */
+    JSONStreamWriter* result_stream{nullptr};
 
     void parse(const UniValue& valRequest);
 };
@@ -15,11 +15,16 @@
 
 #include <boost/signals2/signal.hpp>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <memory>
 #include <mutex>
+#include <set>
 #include <unordered_map>
+#include <vector>
 
 static GlobalMutex g_rpc_warmup_mutex;
 static std::atomic<bool> g_rpc_running{false};
@@ -376,13 +381,87 @@ static UniValue JSONRPCExecOne(JSONRPCRequest jreq, const UniValue& req)
     return rpc_result;
 }
 
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq)
+/** Methods that only read state, so that consecutive calls to them in a batch may run in any order */
+static const std::set<std::string> PARALLEL_BATCH_METHODS{
+    "decoderawtransaction",
+    "decodescript",
+    "getbestblockhash",
+    "getblock",
+    "getblockcount",
+    "getblockfilter",
+    "getblockhash",
+    "getblockheader",
+    "getblockstats",
+    "getmempoolancestors",
+    "getmempooldescendants",
+    "getmempoolentry",
+    "getrawtransaction",
+    "gettxout",
+    "gettxoutproof",
+    "verifytxoutproof",
+};
+
+static bool IsParallelBatchCall(const UniValue& req)
+{
+    if (!req.isObject()) return false;
+    const UniValue& method = find_value(req, "method");
+    return method.isStr() && PARALLEL_BATCH_METHODS.count(method.get_str());
+}
+
+/** Calls of a batch shared by the threads executing them */
+struct BatchRun {
+    const JSONRPCRequest& jreq;
+    const UniValue& vReq;
+    const size_t begin;
+    const size_t end;
+    //! Next call to claim. Calls at or past end must not be accessed, as the batch may be gone.
+    std::atomic<size_t> next;
+    Mutex mutex;
+    std::condition_variable cond;
+    std::vector<UniValue> replies GUARDED_BY(mutex);
+    size_t done GUARDED_BY(mutex){0};
+
+    BatchRun(const JSONRPCRequest& jreq_in, const UniValue& vReq_in, size_t begin_in, size_t end_in)
+        : jreq{jreq_in}, vReq{vReq_in}, begin{begin_in}, end{end_in}, next{begin_in}, replies(end_in - begin_in) {}
+
+    void Execute() EXCLUSIVE_LOCKS_REQUIRED(!mutex)
+    {
+        for (size_t i = next++; i < end; i = next++) {
+            UniValue reply{JSONRPCExecOne(jreq, vReq[i])};
+            LOCK(mutex);
+            replies[i - begin] = std::move(reply);
+            if (++done == end - begin) cond.notify_all();
+        }
+    }
+};
+
+UniValue JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCBatchHelper& helper, int max_helpers)
 {
     UniValue ret(UniValue::VARR);
-    for (unsigned int reqIdx = 0; reqIdx < vReq.size(); reqIdx++)
-        ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+    for (size_t reqIdx = 0; reqIdx < vReq.size();) {
+        size_t run_end = reqIdx;
+        while (run_end < vReq.size() && IsParallelBatchCall(vReq[run_end])) ++run_end;
+        if (!helper || max_helpers <= 0 || run_end - reqIdx < 2) {
+            ret.push_back(JSONRPCExecOne(jreq, vReq[reqIdx]));
+            ++reqIdx;
+            continue;
+        }
 
-    return ret.write() + "\n";
+        // Helpers that start after all calls are claimed return right away, and this thread
+        // executes calls as well, so the batch completes even if no helper ever runs.
+        auto run{std::make_shared<BatchRun>(jreq, vReq, reqIdx, run_end)};
+        const size_t helpers{std::min<size_t>(max_helpers, run_end - reqIdx - 1)};
+        for (size_t i = 0; i < helpers; ++i) {
+            if (!helper([run] { run->Execute(); })) break;
+        }
+        run->Execute();
+        WAIT_LOCK(run->mutex, lock);
+        run->cond.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(run->mutex) { return run->done == run_end - reqIdx; });
+        for (UniValue& reply : run->replies) ret.push_back(std::move(reply));
+        reqIdx = run_end;
+    }
+
+    return ret;
 }
 
 /**
@@ -172,7 +172,14 @@ extern CRPCTable tableRPC;
 void StartRPC();
 void InterruptRPC();
 void StopRPC();
-std::string JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq);
+/** Queue a function to run on another thread, returning false if it cannot be queued. */
+using RPCBatchHelper = std::function<bool(std::function<void()>)>;
+/**
+ * Execute the calls of a batch and return the array of their replies, in the order of the
+ * calls. Runs of consecutive calls to read-only methods are shared with up to
+ * max_helpers functions queued through helper, while the calling thread executes them too.
+ */
+UniValue JSONRPCExecBatch(const JSONRPCRequest& jreq, const UniValue& vReq, const RPCBatchHelper& helper = {}, int max_helpers = 0);
 
 // Retrieves any serialization flags requested in command line argument
 int RPCSerializationFlags();
@@ -13,12 +13,12 @@
 #include <rpc/server.h>
 #include <rpc/server_util.h>
 #include <rpc/util.h>
+#include <streams.h>
 #include <univalue.h>
 #include <util/strencodings.h>
 #include <validation.h>
 
 using node::GetTransaction;
-using node::ReadBlockFromDisk;
 
 static RPCHelpMan gettxoutproof()
 {
@@ -97,14 +97,15 @@ static RPCHelpMan gettxoutproof()
                 }
             }
 
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pblockindex, chainman.GetConsensus())) {
+            // The txids of recently connected or used blocks are cached, so the block need not be read.
+            const auto block_txids{chainman.m_blockman.GetBlockTxids(*pblockindex, chainman.GetConsensus())};
+            if (!block_txids) {
                 throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
             }
 
             unsigned int ntxFound = 0;
-            for (const auto& tx : block.vtx) {
-                if (setTxids.count(tx->GetHash())) {
+            for (const uint256& txid : *block_txids) {
+                if (setTxids.count(txid)) {
                     ntxFound++;
                 }
             }
@@ -113,7 +114,7 @@ static RPCHelpMan gettxoutproof()
             }
 
             CDataStream ssMB(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
-            CMerkleBlock mb(block, setTxids);
+            CMerkleBlock mb(pblockindex->GetBlockHeader(), *block_txids, setTxids);
             ssMB << mb;
             std::string strHex = HexStr(ssMB);
             return strHex;
@@ -138,9 +139,9 @@ static RPCHelpMan verifytxoutproof()
         RPCExamples{""},
         [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
         {
-            CDataStream ssMB(ParseHexV(request.params[0], "proof"), SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+            const std::vector<unsigned char> proof{ParseHexV(request.params[0], "proof")};
             CMerkleBlock merkleBlock;
-            ssMB >> merkleBlock;
+            SpanReader{SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS, proof} >> merkleBlock;
 
             UniValue res(UniValue::VARR);
 
@@ -17,7 +17,7 @@ CScheduler::CScheduler() = default;
 CScheduler::~CScheduler()
 {
     assert(nThreadsServicingQueue == 0);
-    if (stopWhenEmpty) assert(taskQueue.empty());
+    if (stopWhenEmpty) assert(!HasTasks());
 }
 
 
@@ -32,7 +32,7 @@ void CScheduler::serviceQueue()
     // is called.
     while (!shouldStop()) {
         try {
-            while (!shouldStop() && taskQueue.empty()) {
+            while (!shouldStop() && !HasTasks()) {
                 // Wait until there is something to do.
                 newTaskScheduled.wait(lock);
             }
@@ -40,7 +40,7 @@ void CScheduler::serviceQueue()
             // Wait until either there is a new task, or until
             // the time of the first item on the queue:
 
-            while (!shouldStop() && !taskQueue.empty()) {
+            while (!shouldStop() && !taskQueue.empty() && !NextTaskIsDue()) {
                 std::chrono::steady_clock::time_point timeToWaitFor = taskQueue.begin()->first;
                 if (newTaskScheduled.wait_until(lock, timeToWaitFor) == std::cv_status::timeout) {
                     break; // Exit loop after timeout, it means we reached the time of the event
@@ -49,11 +49,17 @@ void CScheduler::serviceQueue()
 
             // If there are multiple threads, the queue can empty while we're waiting (another
             // thread may service the task we were waiting on).
-            if (shouldStop() || taskQueue.empty())
+            if (shouldStop() || !HasTasks())
                 continue;
 
-            Function f = taskQueue.begin()->second;
-            taskQueue.erase(taskQueue.begin());
+            Function f;
+            if (NextTaskIsDue()) {
+                f = std::move(m_due_tasks.front().second);
+                m_due_tasks.pop_front();
+            } else {
+                f = std::move(taskQueue.begin()->second);
+                taskQueue.erase(taskQueue.begin());
+            }
 
             {
                 // Unlock before calling f, so it can reschedule itself or another task
@@ -72,9 +78,14 @@ void CScheduler::serviceQueue()
 
 void CScheduler::schedule(CScheduler::Function f, std::chrono::steady_clock::time_point t)
 {
+    const auto now{std::chrono::steady_clock::now()};
     {
         LOCK(newTaskMutex);
-        taskQueue.insert(std::make_pair(t, f));
+        if (t <= now && (m_due_tasks.empty() || m_due_tasks.back().first <= t)) {
+            m_due_tasks.emplace_back(t, std::move(f));
+        } else {
+            taskQueue.emplace(t, std::move(f));
+        }
     }
     newTaskScheduled.notify_one();
 }
@@ -95,6 +106,10 @@ void CScheduler::MockForward(std::chrono::seconds delta_seconds)
 
         // point taskQueue to temp_queue
         taskQueue = std::move(temp_queue);
+
+        for (auto& element : m_due_tasks) {
+            element.first -= delta_seconds;
+        }
     }
 
     // notify that the taskQueue needs to be processed
@@ -116,11 +131,15 @@ size_t CScheduler::getQueueInfo(std::chrono::steady_clock::time_point& first,
                                 std::chrono::steady_clock::time_point& last) const
 {
     LOCK(newTaskMutex);
-    size_t result = taskQueue.size();
+    size_t result = taskQueue.size() + m_due_tasks.size();
     if (!taskQueue.empty()) {
         first = taskQueue.begin()->first;
         last = taskQueue.rbegin()->first;
     }
+    if (!m_due_tasks.empty()) {
+        if (NextTaskIsDue()) first = m_due_tasks.front().first;
+        if (taskQueue.empty() || last < m_due_tasks.back().first) last = m_due_tasks.back().first;
+    }
     return result;
 }
 
@@ -146,15 +165,11 @@ void SingleThreadedSchedulerClient::MaybeScheduleProcessQueue()
 
 void SingleThreadedSchedulerClient::ProcessQueue()
 {
-    std::function<void()> callback;
     {
         LOCK(m_callbacks_mutex);
         if (m_are_callbacks_running) return;
         if (m_callbacks_pending.empty()) return;
         m_are_callbacks_running = true;
-
-        callback = std::move(m_callbacks_pending.front());
-        m_callbacks_pending.pop_front();
     }
 
     // RAII the setting of fCallbacksRunning and calling MaybeScheduleProcessQueue
@@ -172,7 +187,16 @@ void SingleThreadedSchedulerClient::ProcessQueue()
         }
     } raiicallbacksrunning(this);
 
-    callback();
+    for (size_t i = 0; i < MAX_CALLBACKS_PER_TASK; ++i) {
+        std::function<void()> callback;
+        {
+            LOCK(m_callbacks_mutex);
+            if (m_callbacks_pending.empty()) break;
+            callback = std::move(m_callbacks_pending.front());
+            m_callbacks_pending.pop_front();
+        }
+        callback();
+    }
 }
 
 void SingleThreadedSchedulerClient::AddToProcessQueue(std::function<void()> func)
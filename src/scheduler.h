@@ -12,8 +12,8 @@
 #include <chrono>
 #include <condition_variable>
 #include <cstddef>
+#include <deque>
 #include <functional>
-#include <list>
 #include <map>
 #include <thread>
 #include <utility>
@@ -104,10 +104,24 @@ private:
     mutable Mutex newTaskMutex;
     std::condition_variable newTaskScheduled;
     std::multimap<std::chrono::steady_clock::time_point, Function> taskQueue GUARDED_BY(newTaskMutex);
+    /**
+     * Tasks that were due when they were scheduled, such as the ones of
+     * SingleThreadedSchedulerClient, in the order of their times. They skip
+     * the taskQueue allocation and the wait. A due task with an earlier time
+     * than the last one here goes to taskQueue, so that tasks still run in the
+     * order of their times.
+     */
+    std::deque<std::pair<std::chrono::steady_clock::time_point, Function>> m_due_tasks GUARDED_BY(newTaskMutex);
     int nThreadsServicingQueue GUARDED_BY(newTaskMutex){0};
     bool stopRequested GUARDED_BY(newTaskMutex){false};
     bool stopWhenEmpty GUARDED_BY(newTaskMutex){false};
-    bool shouldStop() const EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex) { return stopRequested || (stopWhenEmpty && taskQueue.empty()); }
+    bool HasTasks() const EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex) { return !taskQueue.empty() || !m_due_tasks.empty(); }
+    bool shouldStop() const EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex) { return stopRequested || (stopWhenEmpty && !HasTasks()); }
+    //! Whether the next task to run is in m_due_tasks. Ties go to taskQueue, which got its task first.
+    bool NextTaskIsDue() const EXCLUSIVE_LOCKS_REQUIRED(newTaskMutex)
+    {
+        return !m_due_tasks.empty() && (taskQueue.empty() || m_due_tasks.front().first < taskQueue.begin()->first);
+    }
 };
 
 /**
@@ -123,10 +137,14 @@ private:
 class SingleThreadedSchedulerClient
 {
 private:
+    //! Callbacks run by each scheduler task, so that a busy client does not
+    //! need a task per callback, but still lets other tasks run in between
+    static constexpr size_t MAX_CALLBACKS_PER_TASK{64};
+
     CScheduler& m_scheduler;
 
     Mutex m_callbacks_mutex;
-    std::list<std::function<void()>> m_callbacks_pending GUARDED_BY(m_callbacks_mutex);
+    std::deque<std::function<void()>> m_callbacks_pending GUARDED_BY(m_callbacks_mutex);
     bool m_are_callbacks_running GUARDED_BY(m_callbacks_mutex) = false;
 
     void MaybeScheduleProcessQueue() EXCLUSIVE_LOCKS_REQUIRED(!m_callbacks_mutex);
@@ -17,9 +17,13 @@
 #include <util/strencodings.h>
 #include <util/vector.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cassert>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -1735,6 +1739,40 @@ std::unique_ptr<Descriptor> Parse(const std::string& descriptor, FlatSigningProv
     return nullptr;
 }
 
+bool ExpandRange(const Descriptor& desc, int begin, int end, const SigningProvider& provider, DescriptorCache& cache,
+                 std::vector<std::vector<CScript>>& output_scripts, int num_threads)
+{
+    assert(begin <= end);
+    output_scripts.assign(size_t(end - begin) + 1, {});
+
+    FlatSigningProvider out;
+    if (!desc.ExpandFromCache(begin, cache, output_scripts[0], out)) {
+        output_scripts[0].clear();
+        if (!desc.Expand(begin, provider, output_scripts[0], out, &cache)) return false;
+    }
+
+    // From here on the cache is only read, which is safe to do from several threads
+    std::atomic<bool> failed{false};
+    const auto expand = [&](size_t first, size_t last) {
+        for (size_t i = first; i < last && !failed; ++i) {
+            FlatSigningProvider out;
+            if (desc.ExpandFromCache(begin + i, cache, output_scripts[i], out)) continue;
+            output_scripts[i].clear();
+            if (!desc.Expand(begin + i, provider, output_scripts[i], out)) failed = true;
+        }
+    };
+    const size_t count{output_scripts.size() - 1};
+    const size_t threads{std::clamp<size_t>(num_threads, 1, std::max<size_t>(count / 256, 1))};
+    const size_t chunk{(count + threads - 1) / threads};
+    std::vector<std::thread> workers;
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(expand, 1 + t * chunk, std::min(1 + (t + 1) * chunk, count + 1));
+    }
+    expand(1, std::min(1 + chunk, count + 1));
+    for (std::thread& worker : workers) worker.join();
+    return !failed;
+}
+
 std::string GetDescriptorChecksum(const std::string& descriptor)
 {
     std::string ret;
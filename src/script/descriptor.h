@@ -158,6 +158,18 @@ struct Descriptor {
  */
 std::unique_ptr<Descriptor> Parse(const std::string& descriptor, FlatSigningProvider& out, std::string& error, bool require_checksum = false);
 
+/** Expand a ranged descriptor at every position from `begin` to `end` inclusive.
+ *
+ * The first position is expanded from `cache` if possible, and otherwise fills it with
+ * the xpubs the others are then derived from, on up to `num_threads` threads. Positions
+ * the cache cannot serve, like hardened derivations, fall back to `provider`.
+ *
+ * @param[out] output_scripts The expanded scriptPubKeys of each position, in order.
+ * @return false if a position could not be expanded.
+ */
+bool ExpandRange(const Descriptor& desc, int begin, int end, const SigningProvider& provider, DescriptorCache& cache,
+                 std::vector<std::vector<CScript>>& output_scripts, int num_threads);
+
 /** Get the checksum for a `descriptor`.
  *
  * - If it already has one, and it is correct, return the checksum in the input.
@@ -317,7 +317,9 @@ public:
 };
 }
 
-static bool EvalChecksigPreTapscript(const valtype& vchSig, const valtype& vchPubKey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& fSuccess)
+/** Helper for the pre-Tapscript OP_CHECKSIG and OP_CHECKSIGVERIFY, see EvalChecksig. If deferrable, the
+ *  script fails whenever the signature check does, and the checker may postpone verifying it. */
+static bool EvalChecksigPreTapscript(const valtype& vchSig, const valtype& vchPubKey, CScript::const_iterator pbegincodehash, CScript::const_iterator pend, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptError* serror, bool& fSuccess, bool deferrable = false)
 {
     assert(sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0);
 
@@ -335,7 +337,8 @@ static bool EvalChecksigPreTapscript(const valtype& vchSig, const valtype& vchPu
         //serror is set
         return false;
     }
-    fSuccess = checker.CheckECDSASignature(vchSig, vchPubKey, scriptCode, sigversion);
+    fSuccess = deferrable ? checker.CheckECDSASignatureDeferrable(vchSig, vchPubKey, scriptCode, sigversion) :
+                            checker.CheckECDSASignature(vchSig, vchPubKey, scriptCode, sigversion);
 
     if (!fSuccess && (flags & SCRIPT_VERIFY_NULLFAIL) && vchSig.size())
         return set_error(serror, SCRIPT_ERR_SIG_NULLFAIL);
@@ -403,8 +406,66 @@ static bool EvalChecksig(const valtype& sig, const valtype& pubkey, CScript::con
     assert(false);
 }
 
+/** Whether a script is OP_DUP OP_HASH160 <20 bytes> OP_EQUALVERIFY OP_CHECKSIG, as in P2PKH and P2WPKH. */
+static bool IsPayToPubKeyHashScript(const CScript& script)
+{
+    return script.size() == 25 && script[0] == OP_DUP && script[1] == OP_HASH160 && script[2] == 20 &&
+           script[23] == OP_EQUALVERIFY && script[24] == OP_CHECKSIG;
+}
+
+/**
+ * EvalScript() of a pay-to-pubkey-hash script, without the generic interpreter
+ * loop. It takes the same steps with the same stack limits and errors, and
+ * only applies to BASE and WITNESS_V0 scripts, which share the semantics of
+ * these opcodes.
+ */
+static bool EvalPayToPubKeyHashScript(std::vector<valtype>& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
+{
+    static const valtype vchFalse(0);
+    static const valtype vchTrue(1, 1);
+
+    set_error(serror, SCRIPT_ERR_UNKNOWN_ERROR);
+    execdata.m_codeseparator_pos = 0xFFFFFFFFUL;
+    execdata.m_codeseparator_pos_init = true;
+
+    // OP_DUP
+    if (stack.size() < 1) return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+    stack.push_back(stack.back());
+    if (stack.size() > MAX_STACK_SIZE) return set_error(serror, SCRIPT_ERR_STACK_SIZE);
+    // OP_HASH160
+    valtype vchHash(CHash160::OUTPUT_SIZE);
+    CHash160().Write(stack.back()).Finalize(vchHash);
+    stack.back() = std::move(vchHash);
+    // <20 bytes>, compared in place by OP_EQUALVERIFY
+    if (stack.size() + 1 > MAX_STACK_SIZE) {
+        stack.emplace_back(script.begin() + 3, script.begin() + 23);
+        return set_error(serror, SCRIPT_ERR_STACK_SIZE);
+    }
+    // OP_EQUALVERIFY
+    if (!std::equal(script.begin() + 3, script.begin() + 23, stack.back().begin())) {
+        stack.back() = vchFalse;
+        return set_error(serror, SCRIPT_ERR_EQUALVERIFY);
+    }
+    stack.pop_back();
+    // OP_CHECKSIG, whose result is the one of the script. This is never the scriptSig, which starts
+    // with an empty stack, but the scriptPubKey, redeemScript or witnessScript, which all fail on false.
+    if (stack.size() < 2) return set_error(serror, SCRIPT_ERR_INVALID_STACK_OPERATION);
+    const valtype& vchSig = stacktop(-2);
+    const valtype& vchPubKey = stacktop(-1);
+    bool fSuccess = true;
+    if (!EvalChecksigPreTapscript(vchSig, vchPubKey, script.begin(), script.end(), flags, checker, sigversion, serror, fSuccess, /*deferrable=*/true)) return false;
+    popstack(stack);
+    popstack(stack);
+    stack.push_back(fSuccess ? vchTrue : vchFalse);
+    return set_success(serror);
+}
+
 bool EvalScript(std::vector<std::vector<unsigned char> >& stack, const CScript& script, unsigned int flags, const BaseSignatureChecker& checker, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror)
 {
+    if ((sigversion == SigVersion::BASE || sigversion == SigVersion::WITNESS_V0) && IsPayToPubKeyHashScript(script)) {
+        return EvalPayToPubKeyHashScript(stack, script, flags, checker, sigversion, execdata, serror);
+    }
+
     static const CScriptNum bnZero(0);
     static const CScriptNum bnOne(1);
     // static const CScriptNum bnFalse(0);
@@ -1394,6 +1455,34 @@ uint256 GetSpentScriptsSHA256(const std::vector<CTxOut>& outputs_spent)
 
 } // namespace
 
+/** Stream appending to a byte vector. */
+class LegacySighashWriter
+{
+    std::vector<unsigned char>& m_data;
+
+public:
+    explicit LegacySighashWriter(std::vector<unsigned char>& data) : m_data{data} {}
+
+    void write(Span<const std::byte> src)
+    {
+        m_data.insert(m_data.end(), UCharCast(src.data()), UCharCast(src.data() + src.size()));
+    }
+
+    template <typename T>
+    LegacySighashWriter& operator<<(const T& obj)
+    {
+        ::Serialize(*this, obj);
+        return *this;
+    }
+};
+
+/** Offset of the scriptSig of input nIn in the legacy signature hash serialization of a transaction with all its inputs. */
+static size_t LegacySighashScriptOffset(size_t inputs, unsigned int nIn)
+{
+    // nVersion and the input count, then per input a 36 byte prevout, the script and a 4 byte nSequence
+    return 4 + GetSizeOfCompactSize(inputs) + 41 * size_t{nIn} + 36;
+}
+
 template <class T>
 void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent_outputs, bool force)
 {
@@ -1444,6 +1533,30 @@ void PrecomputedTransactionData::Init(const T& txTo, std::vector<CTxOut>&& spent
         m_spent_scripts_single_hash = GetSpentScriptsSHA256(m_spent_outputs);
         m_bip341_taproot_ready = true;
     }
+
+    // Treat every input without a witness as a legacy spend, whose SIGHASH_ALL signature hashes
+    // only differ in the scriptCode of the input being signed. Sharing their serialization pays
+    // off once there are several of them.
+    size_t legacy_inputs = 0;
+    for (const CTxIn& txin : txTo.vin) {
+        legacy_inputs += txin.scriptWitness.IsNull();
+    }
+    if (legacy_inputs >= 2) {
+        // An empty scriptCode serializes the same as the blanked out scriptSigs of the other inputs
+        const CScript blank;
+        LegacySighashWriter{m_legacy_all_serialization} << CTransactionSignatureSerializer<T>(txTo, blank, 0, SIGHASH_ALL);
+        const auto serialization{MakeByteSpan(m_legacy_all_serialization)};
+        HashWriter ss{};
+        size_t hashed = 0;
+        m_legacy_all_midstates.reserve(txTo.vin.size());
+        for (unsigned int nIn = 0; nIn < txTo.vin.size(); ++nIn) {
+            const size_t offset = LegacySighashScriptOffset(txTo.vin.size(), nIn);
+            ss.write(serialization.subspan(hashed, offset - hashed));
+            hashed = offset;
+            m_legacy_all_midstates.push_back(ss);
+        }
+        m_legacy_all_ready = true;
+    }
 }
 
 template <class T>
@@ -1626,6 +1739,17 @@ uint256 SignatureHash(const CScript& scriptCode, const T& txTo, unsigned int nIn
     // Wrapper to serialize only the necessary parts of the transaction being signed
     CTransactionSignatureSerializer<T> txTmp(txTo, scriptCode, nIn, nHashType);
 
+    if (cache && cache->m_legacy_all_ready && !(nHashType & SIGHASH_ANYONECANPAY) &&
+        (nHashType & 0x1f) != SIGHASH_SINGLE && (nHashType & 0x1f) != SIGHASH_NONE) {
+        // Continue the precomputed serialization with the scriptCode, in place of the blank script
+        assert(cache->m_legacy_all_midstates.size() == txTo.vin.size());
+        HashWriter ss{cache->m_legacy_all_midstates[nIn]};
+        txTmp.SerializeScriptCode(ss);
+        ss.write(MakeByteSpan(cache->m_legacy_all_serialization).subspan(LegacySighashScriptOffset(txTo.vin.size(), nIn) + 1));
+        ss << nHashType;
+        return ss.GetHash();
+    }
+
     // Serialize and hash
     HashWriter ss{};
     ss << txTmp << nHashType;
@@ -1646,6 +1770,18 @@ bool GenericTransactionSignatureChecker<T>::VerifySchnorrSignature(Span<const un
 
 template <class T>
 bool GenericTransactionSignatureChecker<T>::CheckECDSASignature(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
+{
+    return CheckECDSASignature(vchSigIn, vchPubKey, scriptCode, sigversion, /*deferrable=*/false);
+}
+
+template <class T>
+bool GenericTransactionSignatureChecker<T>::CheckECDSASignatureDeferrable(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
+{
+    return CheckECDSASignature(vchSigIn, vchPubKey, scriptCode, sigversion, /*deferrable=*/true);
+}
+
+template <class T>
+bool GenericTransactionSignatureChecker<T>::CheckECDSASignature(const std::vector<unsigned char>& vchSigIn, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, bool deferrable) const
 {
     CPubKey pubkey(vchPubKey);
     if (!pubkey.IsValid())
@@ -1663,7 +1799,7 @@ bool GenericTransactionSignatureChecker<T>::CheckECDSASignature(const std::vecto
 
     uint256 sighash = SignatureHash(scriptCode, *txTo, nIn, nHashType, amount, sigversion, this->txdata);
 
-    if (!VerifyECDSASignature(vchSig, pubkey, sighash))
+    if (deferrable ? !VerifyECDSASignatureDeferrable(vchSig, pubkey, sighash) : !VerifyECDSASignature(vchSig, pubkey, sighash))
         return false;
 
     return true;
@@ -165,6 +165,14 @@ struct PrecomputedTransactionData
     //! Whether the 3 fields above are initialized.
     bool m_bip143_segwit_ready = false;
 
+    // Legacy SIGHASH_ALL precomputed data, shared by the non-segwit inputs.
+    //! The transaction serialized as for a SIGHASH_ALL signature hash, with every scriptSig blanked out.
+    std::vector<unsigned char> m_legacy_all_serialization;
+    //! Hasher states after the serialization up to the blank scriptSig of each input.
+    std::vector<HashWriter> m_legacy_all_midstates;
+    //! Whether the 2 fields above are initialized.
+    bool m_legacy_all_ready = false;
+
     std::vector<CTxOut> m_spent_outputs;
     //! Whether m_spent_outputs is initialized.
     bool m_spent_outputs_ready = false;
@@ -248,6 +256,12 @@ public:
         return false;
     }
 
+    /** Check an ECDSA signature whose failure fails the whole script, so that verifying it may be deferred. */
+    virtual bool CheckECDSASignatureDeferrable(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const
+    {
+        return CheckECDSASignature(scriptSig, vchPubKey, scriptCode, sigversion);
+    }
+
     virtual bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror = nullptr) const
     {
         return false;
@@ -288,14 +302,22 @@ private:
     const CAmount amount;
     const PrecomputedTransactionData* txdata;
 
+    bool CheckECDSASignature(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion, bool deferrable) const;
+
 protected:
     virtual bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const;
+    //! Verify the signature of CheckECDSASignatureDeferrable
+    virtual bool VerifyECDSASignatureDeferrable(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const
+    {
+        return VerifyECDSASignature(vchSig, vchPubKey, sighash);
+    }
     virtual bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const;
 
 public:
     GenericTransactionSignatureChecker(const T* txToIn, unsigned int nInIn, const CAmount& amountIn, MissingDataBehavior mdb) : txTo(txToIn), m_mdb(mdb), nIn(nInIn), amount(amountIn), txdata(nullptr) {}
     GenericTransactionSignatureChecker(const T* txToIn, unsigned int nInIn, const CAmount& amountIn, const PrecomputedTransactionData& txdataIn, MissingDataBehavior mdb) : txTo(txToIn), m_mdb(mdb), nIn(nInIn), amount(amountIn), txdata(&txdataIn) {}
     bool CheckECDSASignature(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override;
+    bool CheckECDSASignatureDeferrable(const std::vector<unsigned char>& scriptSig, const std::vector<unsigned char>& vchPubKey, const CScript& scriptCode, SigVersion sigversion) const override;
     bool CheckSchnorrSignature(Span<const unsigned char> sig, Span<const unsigned char> pubkey, SigVersion sigversion, ScriptExecutionData& execdata, ScriptError* serror = nullptr) const override;
     bool CheckLockTime(const CScriptNum& nLockTime) const override;
     bool CheckSequence(const CScriptNum& nSequence) const override;
@@ -396,13 +396,22 @@ private:
     int64_t m_value;
 };
 
+/**
+ * Scripts of up to this many bytes are stored inside the CScript, larger ones
+ * on the heap. 36 holds the 34 byte P2WSH and P2TR scriptPubKeys as well as
+ * the 22 to 25 byte P2WPKH, P2SH and P2PKH ones; sizeof(CScript) is padded to
+ * a multiple of 8 for the heap pointer either way, so 36 costs nothing over
+ * 34. See the getscriptstats RPC for the sizes a chain actually uses.
+ */
+static constexpr unsigned int CSCRIPT_INLINE_SIZE{36};
+
 /**
  * We use a prevector for the script to reduce the considerable memory overhead
  *  of vectors in cases where they normally contain a small number of small elements.
  * Tests in October 2015 showed use of this reduced dbcache memory usage by 23%
  *  and made an initial sync 13% faster.
  */
-typedef prevector<28, unsigned char> CScriptBase;
+typedef prevector<CSCRIPT_INLINE_SIZE, unsigned char> CScriptBase;
 
 bool GetScriptOp(CScriptBase::const_iterator& pc, CScriptBase::const_iterator end, opcodetype& opcodeRet, std::vector<unsigned char>* pvchRet);
 
@@ -13,6 +13,7 @@
 #include <cuckoocache.h>
 
 #include <algorithm>
+#include <cassert>
 #include <mutex>
 #include <optional>
 #include <shared_mutex>
@@ -33,6 +34,7 @@ private:
     typedef CuckooCache::cache<uint256, SignatureCacheHasher> map_type;
     map_type setValid;
     std::shared_mutex cs_sigcache;
+    CuckooCache::Counters m_counters;
 
 public:
     CSignatureCache()
@@ -68,13 +70,41 @@ public:
     Get(const uint256& entry, const bool erase)
     {
         std::shared_lock<std::shared_mutex> lock(cs_sigcache);
-        return setValid.contains(entry, erase);
+        const bool hit{setValid.contains(entry, erase)};
+        m_counters.Lookup(hit);
+        return hit;
     }
 
     void Set(const uint256& entry)
     {
         std::unique_lock<std::shared_mutex> lock(cs_sigcache);
-        setValid.insert(entry);
+        m_counters.Insert(setValid.insert(entry));
+    }
+
+    /** Look up many entries, and whether to erase them, under one lock. */
+    void GetMany(Span<const std::pair<uint256, bool>> entries, std::vector<bool>& hits)
+    {
+        hits.resize(entries.size());
+        std::shared_lock<std::shared_mutex> lock(cs_sigcache);
+        // Fetch the buckets of all entries before looking at any
+        for (const auto& [entry, store] : entries) setValid.prefetch(entry);
+        for (size_t i = 0; i < entries.size(); ++i) {
+            hits[i] = setValid.contains(entries[i].first, !entries[i].second);
+            m_counters.Lookup(hits[i]);
+        }
+    }
+
+    void SetMany(Span<const uint256> entries)
+    {
+        if (entries.empty()) return;
+        std::unique_lock<std::shared_mutex> lock(cs_sigcache);
+        for (const uint256& entry : entries) m_counters.Insert(setValid.insert(entry));
+    }
+
+    CuckooCache::Stats GetStats()
+    {
+        std::shared_lock<std::shared_mutex> lock(cs_sigcache);
+        return m_counters.Get(setValid.capacity());
     }
     std::optional<std::pair<uint32_t, size_t>> setup_bytes(size_t n)
     {
@@ -104,6 +134,11 @@ bool InitSignatureCache(size_t max_size_bytes)
     return true;
 }
 
+CuckooCache::Stats GetSignatureCacheStats()
+{
+    return signatureCache.GetStats();
+}
+
 bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
@@ -117,12 +152,85 @@ bool CachingTransactionSignatureChecker::VerifyECDSASignature(const std::vector<
     return true;
 }
 
+bool CachingTransactionSignatureChecker::VerifyECDSASignatureDeferrable(const std::vector<unsigned char>& vchSig, const CPubKey& pubkey, const uint256& sighash) const
+{
+    if (m_batch == nullptr) return VerifyECDSASignature(vchSig, pubkey, sighash);
+    uint256 entry;
+    signatureCache.ComputeEntryECDSA(entry, sighash, vchSig, pubkey);
+    m_batch->AddECDSA(vchSig, pubkey, sighash, entry, store);
+    return true;
+}
+
 bool CachingTransactionSignatureChecker::VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const
 {
     uint256 entry;
     signatureCache.ComputeEntrySchnorr(entry, sighash, sig, pubkey);
+    if (m_batch != nullptr) {
+        m_batch->AddSchnorr(sig, pubkey, sighash, entry, store);
+        return true;
+    }
     if (signatureCache.Get(entry, !store)) return true;
     if (!TransactionSignatureChecker::VerifySchnorrSignature(sig, pubkey, sighash)) return false;
     if (store) signatureCache.Set(entry);
     return true;
 }
+
+void SignatureBatch::AddECDSA(const std::vector<unsigned char>& sig, const CPubKey& pubkey, const uint256& sighash, const uint256& cache_entry, bool store)
+{
+    m_ecdsa_checks.push_back({pubkey, sighash, sig});
+    m_ecdsa_cache_entries.emplace_back(cache_entry, store);
+}
+
+void SignatureBatch::AddSchnorr(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash, const uint256& cache_entry, bool store)
+{
+    assert(sig.size() == 64);
+    SchnorrSignatureCheck& check = m_schnorr_checks.emplace_back();
+    check.pubkey = pubkey;
+    check.msg = sighash;
+    std::copy(sig.begin(), sig.end(), check.sig.begin());
+    m_schnorr_cache_entries.emplace_back(cache_entry, store);
+}
+
+bool SignatureBatch::Verify()
+{
+    std::vector<bool> ecdsa_hits, schnorr_hits;
+    signatureCache.GetMany(m_ecdsa_cache_entries, ecdsa_hits);
+    signatureCache.GetMany(m_schnorr_cache_entries, schnorr_hits);
+
+    bool ret = true;
+    std::vector<uint256> verified;
+    for (size_t i = 0; i < m_ecdsa_checks.size(); ++i) {
+        if (ecdsa_hits[i]) continue;
+        if (!m_ecdsa_checks[i].pubkey.Verify(m_ecdsa_checks[i].msg, m_ecdsa_checks[i].sig)) {
+            ret = false;
+            continue;
+        }
+        if (m_ecdsa_cache_entries[i].second) verified.push_back(m_ecdsa_cache_entries[i].first);
+    }
+
+    // Only the Schnorr signatures missing the cache go into the batch
+    std::vector<SchnorrSignatureCheck> schnorr_checks;
+    std::vector<size_t> schnorr_indices;
+    for (size_t i = 0; i < m_schnorr_checks.size(); ++i) {
+        if (schnorr_hits[i]) continue;
+        schnorr_checks.push_back(m_schnorr_checks[i]);
+        schnorr_indices.push_back(i);
+    }
+    const bool batch_ok = VerifySchnorrBatch(schnorr_checks);
+    for (size_t j = 0; j < schnorr_checks.size(); ++j) {
+        // Only look for the invalid signatures if the batch failed
+        if (!batch_ok && !schnorr_checks[j].pubkey.VerifySchnorr(schnorr_checks[j].msg, schnorr_checks[j].sig)) {
+            ret = false;
+            continue;
+        }
+        const auto& [entry, store] = m_schnorr_cache_entries[schnorr_indices[j]];
+        if (store) verified.push_back(entry);
+    }
+    signatureCache.SetMany(verified);
+
+    m_ecdsa_checks.clear();
+    m_schnorr_checks.clear();
+    m_ecdsa_cache_entries.clear();
+    m_schnorr_cache_entries.clear();
+    return ret;
+}
@@ -6,11 +6,14 @@
 #ifndef BITCOIN_SCRIPT_SIGCACHE_H
 #define BITCOIN_SCRIPT_SIGCACHE_H
 
+#include <pubkey.h>
 #include <script/interpreter.h>
 #include <span.h>
+#include <uint256.h>
 #include <util/hasher.h>
 
 #include <optional>
+#include <utility>
 #include <vector>
 
 // DoS prevention: limit cache size to 32MiB (over 1000000 entries on 64-bit
@@ -19,19 +22,66 @@
 static constexpr size_t DEFAULT_MAX_SIG_CACHE_BYTES{32 << 20};
 
 class CPubKey;
+namespace CuckooCache {
+struct Stats;
+} // namespace CuckooCache
+
+/**
+ * Signatures whose verification was deferred, to look them all up in the
+ * signature cache at once, and to verify the Schnorr ones that miss it with
+ * VerifySchnorrBatch. This is only sound where an invalid signature makes the
+ * whole script fail: BIP341 and BIP342 guarantee it for Schnorr signatures,
+ * and CheckECDSASignatureDeferrable for the ECDSA ones added here.
+ * Signatures are only added to the signature cache once they are verified.
+ */
+class SignatureBatch
+{
+private:
+    struct ECDSASignatureCheck {
+        CPubKey pubkey;
+        uint256 msg;
+        std::vector<unsigned char> sig;
+    };
+
+    std::vector<ECDSASignatureCheck> m_ecdsa_checks;
+    std::vector<SchnorrSignatureCheck> m_schnorr_checks;
+    //! Signature cache entry of each check, and whether to store it
+    std::vector<std::pair<uint256, bool>> m_ecdsa_cache_entries;
+    std::vector<std::pair<uint256, bool>> m_schnorr_cache_entries;
+
+public:
+    void AddECDSA(const std::vector<unsigned char>& sig, const CPubKey& pubkey, const uint256& sighash, const uint256& cache_entry, bool store);
+    void AddSchnorr(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash, const uint256& cache_entry, bool store);
+
+    /**
+     * Verify and forget all signatures added so far. If the Schnorr batch
+     * fails, they are verified one by one so that the valid ones can still be
+     * cached. There is no batch verification for ECDSA signatures, which are
+     * verified one by one.
+     */
+    bool Verify();
+
+    size_t size() const { return m_ecdsa_checks.size() + m_schnorr_checks.size(); }
+};
 
 class CachingTransactionSignatureChecker : public TransactionSignatureChecker
 {
 private:
     bool store;
+    //! If not nullptr, Schnorr and deferrable ECDSA signatures are added to it instead of being looked up and verified
+    SignatureBatch* m_batch;
 
 public:
-    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn, MissingDataBehavior::ASSERT_FAIL), store(storeIn) {}
+    CachingTransactionSignatureChecker(const CTransaction* txToIn, unsigned int nInIn, const CAmount& amountIn, bool storeIn, PrecomputedTransactionData& txdataIn, SignatureBatch* batch = nullptr) : TransactionSignatureChecker(txToIn, nInIn, amountIn, txdataIn, MissingDataBehavior::ASSERT_FAIL), store(storeIn), m_batch(batch) {}
 
     bool VerifyECDSASignature(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
+    bool VerifyECDSASignatureDeferrable(const std::vector<unsigned char>& vchSig, const CPubKey& vchPubKey, const uint256& sighash) const override;
     bool VerifySchnorrSignature(Span<const unsigned char> sig, const XOnlyPubKey& pubkey, const uint256& sighash) const override;
 };
 
 [[nodiscard]] bool InitSignatureCache(size_t max_size_bytes);
 
+/** Usage statistics of the signature cache. */
+CuckooCache::Stats GetSignatureCacheStats();
+
 #endif // BITCOIN_SCRIPT_SIGCACHE_H
@@ -264,4 +264,120 @@ int secp256k1_schnorrsig_verify(const secp256k1_context* ctx, const unsigned cha
            secp256k1_fe_equal_var(&rx, &r.x);
 }
 
+typedef struct {
+    const secp256k1_context *ctx;
+    const unsigned char * const *sig64;
+    const unsigned char * const *msg32;
+    const secp256k1_xonly_pubkey * const *pubkeys;
+    unsigned char seed[32];
+} secp256k1_schnorrsig_verify_batch_data;
+
+/* Randomizer of signature i. The first one is 1, which saves a multiplication
+ * and does not weaken the check. */
+static void secp256k1_schnorrsig_batch_randomizer(secp256k1_scalar *a, const unsigned char *seed32, size_t i) {
+    secp256k1_sha256 sha;
+    unsigned char buf[32];
+    int j;
+
+    if (i == 0) {
+        secp256k1_scalar_set_int(a, 1);
+        return;
+    }
+    secp256k1_sha256_initialize(&sha);
+    secp256k1_sha256_write(&sha, seed32, 32);
+    for (j = 0; j < 8; j++) {
+        buf[j] = (i >> (8 * j)) & 0xFF;
+    }
+    secp256k1_sha256_write(&sha, buf, 8);
+    secp256k1_sha256_finalize(&sha, buf);
+    secp256k1_scalar_set_b32(a, buf, NULL);
+}
+
+/* Points 2*i and 2*i+1 are R_i and P_i, with scalars -a_i and -a_i*e_i. */
+static int secp256k1_schnorrsig_verify_batch_callback(secp256k1_scalar *sc, secp256k1_ge *pt, size_t idx, void *data) {
+    const secp256k1_schnorrsig_verify_batch_data *batch = (const secp256k1_schnorrsig_verify_batch_data *)data;
+    size_t i = idx / 2;
+    secp256k1_scalar a;
+
+    secp256k1_schnorrsig_batch_randomizer(&a, batch->seed, i);
+    if (idx % 2 == 0) {
+        secp256k1_fe rx;
+        if (!secp256k1_fe_set_b32(&rx, &batch->sig64[i][0]) || !secp256k1_ge_set_xo_var(pt, &rx, 0)) {
+            return 0;
+        }
+        secp256k1_scalar_negate(sc, &a);
+    } else {
+        secp256k1_scalar e;
+        unsigned char buf[32];
+        if (!secp256k1_xonly_pubkey_load(batch->ctx, pt, batch->pubkeys[i])) {
+            return 0;
+        }
+        secp256k1_fe_get_b32(buf, &pt->x);
+        secp256k1_schnorrsig_challenge(&e, &batch->sig64[i][0], batch->msg32[i], 32, buf);
+        secp256k1_scalar_mul(&e, &e, &a);
+        secp256k1_scalar_negate(sc, &e);
+    }
+    return 1;
+}
+
+int secp256k1_schnorrsig_verify_batch(const secp256k1_context* ctx, secp256k1_scratch_space *scratch, const unsigned char * const *sig64, const unsigned char * const *msg32, const secp256k1_xonly_pubkey * const *pubkeys, size_t n) {
+    secp256k1_schnorrsig_verify_batch_data data;
+    secp256k1_sha256 sha;
+    secp256k1_scalar s_sum;
+    secp256k1_gej rj;
+    size_t i;
+
+    VERIFY_CHECK(ctx != NULL);
+    ARG_CHECK(n == 0 || sig64 != NULL);
+    ARG_CHECK(n == 0 || msg32 != NULL);
+    ARG_CHECK(n == 0 || pubkeys != NULL);
+    ARG_CHECK(n <= SIZE_MAX / 2);
+
+    if (n == 0) {
+        return 1;
+    }
+
+    /* The randomizers are derived from all inputs, so that they cannot be
+     * chosen to cancel out invalid signatures. */
+    secp256k1_sha256_initialize(&sha);
+    for (i = 0; i < n; i++) {
+        secp256k1_ge pk;
+        unsigned char buf[32];
+        if (!secp256k1_xonly_pubkey_load(ctx, &pk, pubkeys[i])) {
+            return 0;
+        }
+        secp256k1_fe_get_b32(buf, &pk.x);
+        secp256k1_sha256_write(&sha, sig64[i], 64);
+        secp256k1_sha256_write(&sha, msg32[i], 32);
+        secp256k1_sha256_write(&sha, buf, 32);
+    }
+    secp256k1_sha256_finalize(&sha, data.seed);
+
+    /* s_sum = sum(a_i*s_i) */
+    secp256k1_scalar_set_int(&s_sum, 0);
+    for (i = 0; i < n; i++) {
+        secp256k1_scalar s;
+        secp256k1_scalar a;
+        int overflow;
+        secp256k1_scalar_set_b32(&s, &sig64[i][32], &overflow);
+        if (overflow) {
+            return 0;
+        }
+        secp256k1_schnorrsig_batch_randomizer(&a, data.seed, i);
+        secp256k1_scalar_mul(&s, &s, &a);
+        secp256k1_scalar_add(&s_sum, &s_sum, &s);
+    }
+
+    /* All signatures are valid iff s_sum*G - sum(a_i*R_i) - sum(a_i*e_i*P_i)
+     * is the point at infinity, except with negligible probability. */
+    data.ctx = ctx;
+    data.sig64 = sig64;
+    data.msg32 = msg32;
+    data.pubkeys = pubkeys;
+    if (!secp256k1_ecmult_multi_var(&ctx->error_callback, scratch, &rj, &s_sum, secp256k1_schnorrsig_verify_batch_callback, &data, 2 * n)) {
+        return 0;
+    }
+    return secp256k1_gej_is_infinity(&rj);
+}
+
 #endif
@@ -796,7 +796,7 @@ void test_schnorrsig_sign_verify(void) {
 
     {
         /* Flip a few bits in the signature and in the message and check that
-         * verify and verify_batch (TODO) fail */
+         * verify fails */
         size_t sig_idx = secp256k1_testrand_int(N_SIGS);
         size_t byte_idx = secp256k1_testrand_bits(5);
         unsigned char xorbyte = secp256k1_testrand_int(254)+1;
@@ -818,6 +818,37 @@ void test_schnorrsig_sign_verify(void) {
         CHECK(secp256k1_schnorrsig_verify(ctx, sig[sig_idx], msg[sig_idx], sizeof(msg[sig_idx]), &pk));
     }
 
+    /* Verify all signatures as a batch, with and without scratch space, and
+     * check that a single bad signature makes the batch fail */
+    {
+        const unsigned char *sig_ptrs[N_SIGS];
+        const unsigned char *msg_ptrs[N_SIGS];
+        const secp256k1_xonly_pubkey *pk_ptrs[N_SIGS];
+        secp256k1_scratch_space *scratch = secp256k1_scratch_space_create(ctx, 100000);
+        size_t sig_idx = secp256k1_testrand_int(N_SIGS);
+        unsigned char xorbyte = secp256k1_testrand_int(254)+1;
+
+        for (i = 0; i < N_SIGS; i++) {
+            sig_ptrs[i] = sig[i];
+            msg_ptrs[i] = msg[i];
+            pk_ptrs[i] = &pk;
+        }
+        CHECK(secp256k1_schnorrsig_verify_batch(ctx, scratch, NULL, NULL, NULL, 0));
+        CHECK(secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_ptrs, msg_ptrs, pk_ptrs, N_SIGS));
+        CHECK(secp256k1_schnorrsig_verify_batch(ctx, NULL, sig_ptrs, msg_ptrs, pk_ptrs, N_SIGS));
+        CHECK(secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_ptrs, msg_ptrs, pk_ptrs, 1));
+
+        sig[sig_idx][secp256k1_testrand_bits(5)] ^= xorbyte;
+        CHECK(!secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_ptrs, msg_ptrs, pk_ptrs, N_SIGS));
+        CHECK(!secp256k1_schnorrsig_verify_batch(ctx, NULL, sig_ptrs, msg_ptrs, pk_ptrs, N_SIGS));
+        CHECK(secp256k1_schnorrsig_sign32(ctx, sig[sig_idx], msg[sig_idx], &keypair, NULL));
+        msg[sig_idx][secp256k1_testrand_bits(5)] ^= xorbyte;
+        CHECK(!secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_ptrs, msg_ptrs, pk_ptrs, N_SIGS));
+        CHECK(secp256k1_schnorrsig_sign32(ctx, sig[sig_idx], msg[sig_idx], &keypair, NULL));
+        CHECK(secp256k1_schnorrsig_verify_batch(ctx, scratch, sig_ptrs, msg_ptrs, pk_ptrs, N_SIGS));
+        secp256k1_scratch_space_destroy(ctx, scratch);
+    }
+
     /* Test overflowing s */
     CHECK(secp256k1_schnorrsig_sign32(ctx, sig[0], msg[0], &keypair, NULL));
     CHECK(secp256k1_schnorrsig_verify(ctx, sig[0], msg[0], sizeof(msg[0]), &pk));
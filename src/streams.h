@@ -175,6 +175,14 @@ public:
         memcpy(dst.data(), m_data.data(), dst.size());
         m_data = m_data.subspan(dst.size());
     }
+
+    void ignore(size_t num_ignore)
+    {
+        if (num_ignore > m_data.size()) {
+            throw std::ios_base::failure("SpanReader::ignore(): end of data");
+        }
+        m_data = m_data.subspan(num_ignore);
+    }
 };
 
 /** Double ended buffer combining vector and stream-like interfaces.
@@ -250,6 +258,21 @@ public:
         m_read_pos = 0;
     }
 
+    /** Take over the allocation of a buffer, e.g. one reused from a pool, discarding any data. */
+    void AdoptBuffer(vector_type&& buffer)
+    {
+        vch = std::move(buffer);
+        vch.clear();
+        m_read_pos = 0;
+    }
+
+    /** Give up the underlying buffer and its allocation, leaving the stream empty. */
+    vector_type TakeBuffer()
+    {
+        m_read_pos = 0;
+        return std::exchange(vch, {});
+    }
+
     bool Rewind(std::optional<size_type> n = std::nullopt)
     {
         // Total rewind if no size is passed
@@ -0,0 +1,254 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+#define BITCOIN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <list>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * A memory resource for node-based containers, similar to
+ * std::pmr::unsynchronized_pool_resource but simpler and faster.
+ *
+ * Memory is allocated in large chunks, and blocks of up to
+ * MAX_BLOCK_SIZE_BYTES are carved out of them. A freed block is put on a
+ * free list for its size (a multiple of ELEM_ALIGN_BYTES), and reused by the
+ * next allocation of that size. Memory is only given back to the system when
+ * the resource is destroyed. Larger or over-aligned allocations are forwarded
+ * to ::operator new.
+ *
+ * This saves the per-allocation overhead of malloc and avoids fragmenting the
+ * heap when a container allocates and frees millions of nodes, e.g. the
+ * UTXO cache during initial block download.
+ *
+ * The resource is not thread safe, and must outlive all containers using it.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource final
+{
+    static_assert(ALIGN_BYTES > 0, "ALIGN_BYTES must be nonzero");
+    static_assert((ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+
+    //! Free list entry, constructed in place inside a freed block
+    struct ListNode {
+        ListNode* m_next;
+
+        explicit ListNode(ListNode* next) : m_next(next) {}
+    };
+    static_assert(std::is_trivially_destructible_v<ListNode>, "ListNode is never destroyed");
+
+    //! Granularity of the block sizes, large enough to hold a ListNode
+    static constexpr std::size_t ELEM_ALIGN_BYTES = std::max(alignof(ListNode), ALIGN_BYTES);
+    static_assert(sizeof(ListNode) <= ELEM_ALIGN_BYTES, "A block must be able to hold a ListNode");
+    static_assert((MAX_BLOCK_SIZE_BYTES & (ELEM_ALIGN_BYTES - 1)) == 0, "MAX_BLOCK_SIZE_BYTES must be a multiple of the alignment");
+
+    //! Size of every chunk, a multiple of ELEM_ALIGN_BYTES
+    const std::size_t m_chunk_size_bytes;
+
+    //! All chunks, freed in the destructor
+    std::list<std::byte*> m_allocated_chunks{};
+
+    //! m_free_lists[n] holds freed blocks of n * ELEM_ALIGN_BYTES bytes
+    std::array<ListNode*, MAX_BLOCK_SIZE_BYTES / ELEM_ALIGN_BYTES + 1> m_free_lists{};
+
+    //! Total size of the blocks in m_free_lists
+    std::size_t m_free_list_bytes{0};
+
+    //! Remaining unused memory of the last chunk
+    std::byte* m_available_memory_it = nullptr;
+    std::byte* m_available_memory_end = nullptr;
+
+    /** Number of ELEM_ALIGN_BYTES units needed for bytes, and index into m_free_lists. Zero bytes use one unit. */
+    [[nodiscard]] static constexpr std::size_t NumElemAlignBytes(std::size_t bytes)
+    {
+        return (bytes + ELEM_ALIGN_BYTES - 1) / ELEM_ALIGN_BYTES + (bytes == 0);
+    }
+
+    [[nodiscard]] static constexpr bool IsFreeListUsable(std::size_t bytes, std::size_t alignment)
+    {
+        return alignment <= ELEM_ALIGN_BYTES && bytes <= MAX_BLOCK_SIZE_BYTES;
+    }
+
+    void PlacementAddToList(void* p, ListNode*& node, std::size_t bytes)
+    {
+        node = new (p) ListNode{node};
+        m_free_list_bytes += bytes;
+    }
+
+    /**
+     * Allocate a new chunk to carve blocks out of. What is left of the
+     * previous chunk is always a multiple of ELEM_ALIGN_BYTES smaller than
+     * MAX_BLOCK_SIZE_BYTES, so it goes onto the matching free list.
+     */
+    void AllocateChunk()
+    {
+        const std::size_t remaining_bytes = std::distance(m_available_memory_it, m_available_memory_end);
+        if (remaining_bytes != 0) {
+            PlacementAddToList(m_available_memory_it, m_free_lists[remaining_bytes / ELEM_ALIGN_BYTES], remaining_bytes);
+        }
+
+        void* storage = ::operator new (m_chunk_size_bytes, std::align_val_t{ELEM_ALIGN_BYTES});
+        m_available_memory_it = new (storage) std::byte[m_chunk_size_bytes];
+        m_available_memory_end = m_available_memory_it + m_chunk_size_bytes;
+        m_allocated_chunks.emplace_back(m_available_memory_it);
+    }
+
+    //! Access to internals for testing purposes only
+    friend class PoolResourceTester;
+
+public:
+    /**
+     * Construct a PoolResource and allocate its first chunk. chunk_size_bytes
+     * is rounded up to a multiple of ELEM_ALIGN_BYTES.
+     */
+    explicit PoolResource(std::size_t chunk_size_bytes)
+        : m_chunk_size_bytes(NumElemAlignBytes(chunk_size_bytes) * ELEM_ALIGN_BYTES)
+    {
+        assert(m_chunk_size_bytes >= MAX_BLOCK_SIZE_BYTES);
+        AllocateChunk();
+    }
+
+    /** Construct a PoolResource with 256KiB chunks. */
+    PoolResource() : PoolResource(262144) {}
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+    PoolResource(PoolResource&&) = delete;
+    PoolResource& operator=(PoolResource&&) = delete;
+
+    ~PoolResource()
+    {
+        for (std::byte* chunk : m_allocated_chunks) {
+            ::operator delete ((void*)chunk, std::align_val_t{ELEM_ALIGN_BYTES});
+        }
+    }
+
+    /** Allocate a block, from a free list or the current chunk if possible. */
+    void* Allocate(std::size_t bytes, std::size_t alignment)
+    {
+        if (IsFreeListUsable(bytes, alignment)) {
+            const std::size_t num_alignments = NumElemAlignBytes(bytes);
+            if (m_free_lists[num_alignments] != nullptr) {
+                // Unlink the first free block; ListNode is trivially destructible
+                m_free_list_bytes -= num_alignments * ELEM_ALIGN_BYTES;
+                return std::exchange(m_free_lists[num_alignments], m_free_lists[num_alignments]->m_next);
+            }
+
+            const std::ptrdiff_t round_bytes = static_cast<std::ptrdiff_t>(num_alignments * ELEM_ALIGN_BYTES);
+            if (round_bytes > m_available_memory_end - m_available_memory_it) {
+                AllocateChunk();
+            }
+            return std::exchange(m_available_memory_it, m_available_memory_it + round_bytes);
+        }
+
+        return ::operator new (bytes, std::align_val_t{alignment});
+    }
+
+    /** Put a block onto its free list, or delete it if it did not come from a chunk. */
+    void Deallocate(void* p, std::size_t bytes, std::size_t alignment) noexcept
+    {
+        if (IsFreeListUsable(bytes, alignment)) {
+            const std::size_t num_alignments = NumElemAlignBytes(bytes);
+            PlacementAddToList(p, m_free_lists[num_alignments], num_alignments * ELEM_ALIGN_BYTES);
+        } else {
+            ::operator delete (p, std::align_val_t{alignment});
+        }
+    }
+
+    [[nodiscard]] std::size_t NumAllocatedChunks() const
+    {
+        return m_allocated_chunks.size();
+    }
+
+    /**
+     * Bytes of the chunks that are not in use, i.e. in the free lists or not
+     * handed out yet, which are reused before another chunk is allocated.
+     */
+    [[nodiscard]] std::size_t AvailableBytes() const
+    {
+        return m_free_list_bytes + (m_available_memory_end - m_available_memory_it);
+    }
+
+    [[nodiscard]] std::size_t ChunkSizeBytes() const
+    {
+        return m_chunk_size_bytes;
+    }
+};
+
+/**
+ * Allocator that forwards to a PoolResource. Containers using it must be
+ * constructed with a pointer to the resource, which all copies share.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES = alignof(T)>
+class PoolAllocator
+{
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* m_resource;
+
+    template <typename U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+public:
+    using value_type = T;
+    using ResourceType = PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+
+    //! Not explicit, so a container can be constructed with just the resource
+    PoolAllocator(ResourceType* resource) noexcept
+        : m_resource(resource)
+    {
+    }
+
+    PoolAllocator(const PoolAllocator& other) noexcept = default;
+    PoolAllocator& operator=(const PoolAllocator& other) noexcept = default;
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept
+        : m_resource(other.resource())
+    {
+    }
+
+    //! Needed because of the non-type template parameters
+    template <typename U>
+    struct rebind {
+        using other = PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>;
+    };
+
+    T* allocate(size_t n)
+    {
+        return static_cast<T*>(m_resource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, size_t n) noexcept
+    {
+        m_resource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    ResourceType* resource() const noexcept
+    {
+        return m_resource;
+    }
+};
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator==(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return a.resource() == b.resource();
+}
+
+template <class T1, class T2, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+bool operator!=(const PoolAllocator<T1, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& a,
+                const PoolAllocator<T2, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // BITCOIN_SUPPORT_ALLOCATORS_POOL_H
@@ -19,6 +19,8 @@
 #endif
 
 #include <algorithm>
+#include <array>
+#include <vector>
 #ifdef ARENA_DEBUG
 #include <iomanip>
 #include <iostream>
@@ -381,6 +383,105 @@ LockedPoolManager::LockedPoolManager(std::unique_ptr<LockedPageAllocator> alloca
 {
 }
 
+/**
+ * Chunks of locked memory freed by a thread, that its next allocations of
+ * the same sizes take without locking the pool. Chunks are grouped by size
+ * in steps of ARENA_ALIGN, which the arenas round sizes up to anyway.
+ */
+class LockedPoolThreadCache
+{
+public:
+    explicit LockedPoolThreadCache(LockedPoolManager& pool) : m_pool{pool} {}
+    ~LockedPoolThreadCache()
+    {
+        for (auto& chunks : m_chunks) {
+            for (void* ptr : chunks) m_pool.LockedPool::free(ptr);
+        }
+        m_pool.m_cached_bytes -= m_size;
+        m_pool.m_cached_chunks -= m_count;
+    }
+
+    void* Take(size_t size)
+    {
+        auto& chunks{m_chunks[Class(size)]};
+        if (chunks.empty()) return nullptr;
+        void* ptr{chunks.back()};
+        chunks.pop_back();
+        m_size -= ClassSize(size);
+        --m_count;
+        m_pool.m_cached_bytes -= ClassSize(size);
+        --m_pool.m_cached_chunks;
+        return ptr;
+    }
+
+    bool Keep(void* ptr, size_t size)
+    {
+        if (m_size + ClassSize(size) > LockedPoolManager::THREAD_CACHE_SIZE) return false;
+        m_chunks[Class(size)].push_back(ptr);
+        m_size += ClassSize(size);
+        ++m_count;
+        m_pool.m_cached_bytes += ClassSize(size);
+        ++m_pool.m_cached_chunks;
+        return true;
+    }
+
+    static bool Caches(size_t size) { return size > 0 && size <= LockedPoolManager::THREAD_CACHE_MAX_CHUNK; }
+
+private:
+    static constexpr size_t CLASSES{LockedPoolManager::THREAD_CACHE_MAX_CHUNK / LockedPool::ARENA_ALIGN};
+
+    static size_t ClassSize(size_t size) { return align_up(size, LockedPool::ARENA_ALIGN); }
+    static size_t Class(size_t size) { return ClassSize(size) / LockedPool::ARENA_ALIGN - 1; }
+
+    LockedPoolManager& m_pool;
+    std::array<std::vector<void*>, CLASSES> m_chunks;
+    //! Bytes and number of the chunks kept
+    size_t m_size{0};
+    size_t m_count{0};
+};
+
+#ifdef HAVE_THREAD_LOCAL
+/** The cache of the calling thread. Its chunks return to the pool when the thread exits. */
+static LockedPoolThreadCache& ThreadCache()
+{
+    static thread_local LockedPoolThreadCache cache{LockedPoolManager::Instance()};
+    return cache;
+}
+#endif
+
+void* LockedPoolManager::alloc(size_t size)
+{
+#ifdef HAVE_THREAD_LOCAL
+    if (LockedPoolThreadCache::Caches(size)) {
+        if (void* ptr{ThreadCache().Take(size)}) return ptr;
+        // Allocate the whole chunk that the cache rounds the size up to, as the arena does
+        return LockedPool::alloc(align_up(size, ARENA_ALIGN));
+    }
+#endif
+    return LockedPool::alloc(size);
+}
+
+void LockedPoolManager::free(void* ptr, size_t size)
+{
+#ifdef HAVE_THREAD_LOCAL
+    if (ptr && LockedPoolThreadCache::Caches(size) && ThreadCache().Keep(ptr, size)) return;
+#endif
+    LockedPool::free(ptr);
+}
+
+LockedPool::Stats LockedPoolManager::stats() const
+{
+    Stats r{LockedPool::stats()};
+    // Chunks move between the caches and the pool meanwhile, so the counts can be off by those
+    const size_t cached_bytes{std::min<size_t>(m_cached_bytes, r.used)};
+    const size_t cached_chunks{std::min<size_t>(m_cached_chunks, r.chunks_used)};
+    r.used -= cached_bytes;
+    r.free += cached_bytes;
+    r.chunks_used -= cached_chunks;
+    r.chunks_free += cached_chunks;
+    return r;
+}
+
 bool LockedPoolManager::LockingFailed()
 {
     // TODO: log something but how? without including util.h
@@ -6,6 +6,7 @@
 #define BITCOIN_SUPPORT_LOCKEDPOOL_H
 
 #include <stdint.h>
+#include <atomic>
 #include <list>
 #include <map>
 #include <mutex>
@@ -218,6 +219,13 @@ private:
 class LockedPoolManager : public LockedPool
 {
 public:
+    /** Largest chunk kept by the cache of a thread */
+    static const size_t THREAD_CACHE_MAX_CHUNK = 256;
+    /** Bytes of chunks kept by the cache of a thread, all chunk sizes together.
+     * Chunks in the caches remain locked but unused, so keep this small.
+     */
+    static const size_t THREAD_CACHE_SIZE = 4096;
+
     /** Return the current instance, or create it once */
     static LockedPoolManager& Instance()
     {
@@ -226,7 +234,25 @@ public:
         return *LockedPoolManager::_instance;
     }
 
+    /** Allocate size bytes, taking a chunk the calling thread freed before
+     * if it has one of that size, so that it does not lock the pool.
+     */
+    void* alloc(size_t size);
+    /** Free a chunk of size bytes, as allocated, keeping it in the cache of
+     * the calling thread for its next allocation of that size if there is
+     * room. The chunk must have been cleared already.
+     */
+    void free(void* ptr, size_t size);
+    using LockedPool::free;
+    /** Get pool usage statistics, counting the chunks in the caches of the threads as free */
+    Stats stats() const;
+
 private:
+    friend class LockedPoolThreadCache;
+    //! Chunks in the caches of the threads, counted as used by the pool
+    std::atomic<size_t> m_cached_bytes{0};
+    std::atomic<size_t> m_cached_chunks{0};
+
     explicit LockedPoolManager(std::unique_ptr<LockedPageAllocator> allocator);
 
     /** Create a new LockedPoolManager specialized to the OS */
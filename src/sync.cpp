@@ -13,11 +13,13 @@
 #include <util/strencodings.h>
 #include <util/threadnames.h>
 
+#include <algorithm>
 #include <map>
 #include <mutex>
 #include <set>
 #include <system_error>
 #include <thread>
+#include <tuple>
 #include <type_traits>
 #include <unordered_map>
 #include <utility>
@@ -324,3 +326,146 @@ bool LockStackEmpty()
 bool g_debug_lockorder_abort = true;
 
 #endif /* DEBUG_LOCKORDER */
+
+//
+// Lock profiler.
+// Counts, wait and hold times of the locks taken at each lock site are kept in a
+// fixed table of slots that is only ever appended to, so that recording a lock
+// needs no lock itself. A site is identified by the name, file and line string
+// pointers the LOCK macros pass; the same source line compiled into several
+// translation units may use several slots, which GetLockStats() merges.
+//
+
+std::atomic<bool> g_lock_stats_enabled{DEFAULT_LOCKSTATS};
+
+/** Maximum number of lock sites the profiler keeps statistics for. */
+static constexpr size_t LOCK_STATS_SITES{2048};
+
+struct LockSiteStats {
+    //! 0 while the slot is free, 1 while it is being claimed, 2 once name, file and line are set
+    std::atomic<int> state{0};
+    const char* name{nullptr};
+    const char* file{nullptr};
+    int line{0};
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> contended{0};
+    std::atomic<uint64_t> wait_ns{0};
+    std::atomic<uint64_t> max_wait_ns{0};
+    std::atomic<uint64_t> holds{0};
+    std::atomic<uint64_t> hold_ns{0};
+    std::atomic<uint64_t> max_hold_ns{0};
+    std::array<std::atomic<uint64_t>, LOCK_STATS_BUCKETS> wait_histogram{};
+    std::array<std::atomic<uint64_t>, LOCK_STATS_BUCKETS> hold_histogram{};
+};
+
+static std::array<LockSiteStats, LOCK_STATS_SITES> g_lock_sites;
+
+void SetLockStatsEnabled(bool enabled)
+{
+    g_lock_stats_enabled.store(enabled, std::memory_order_relaxed);
+}
+
+LockSiteStats* GetLockSiteStats(const char* name, const char* file, int line)
+{
+    const size_t start{(std::hash<const void*>{}(name) ^ std::hash<const void*>{}(file) * 31 ^ static_cast<size_t>(line) * 0x9e3779b9) % LOCK_STATS_SITES};
+    for (size_t i = 0; i < LOCK_STATS_SITES; ++i) {
+        LockSiteStats& site{g_lock_sites[(start + i) % LOCK_STATS_SITES]};
+        int state{site.state.load(std::memory_order_acquire)};
+        if (state == 0 && site.state.compare_exchange_strong(state, 1, std::memory_order_acquire)) {
+            site.name = name;
+            site.file = file;
+            site.line = line;
+            site.state.store(2, std::memory_order_release);
+            return &site;
+        }
+        // Another thread is claiming the slot, it is done in a few instructions
+        while (state == 1) state = site.state.load(std::memory_order_acquire);
+        if (site.name == name && site.file == file && site.line == line) return &site;
+    }
+    return nullptr;
+}
+
+static void RecordDuration(std::atomic<uint64_t>& total, std::atomic<uint64_t>& max,
+                           std::array<std::atomic<uint64_t>, LOCK_STATS_BUCKETS>& histogram, std::chrono::nanoseconds duration)
+{
+    const uint64_t ns{static_cast<uint64_t>(std::max<int64_t>(duration.count(), 0))};
+    total.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t prev_max{max.load(std::memory_order_relaxed)};
+    while (ns > prev_max && !max.compare_exchange_weak(prev_max, ns, std::memory_order_relaxed)) {}
+    const uint64_t micros{ns / 1000};
+    size_t bucket{0};
+    while (bucket + 1 < LOCK_STATS_BUCKETS && micros >= (uint64_t{1} << bucket)) ++bucket;
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+void RecordLockWait(LockSiteStats& site, std::chrono::nanoseconds wait, bool contended)
+{
+    site.count.fetch_add(1, std::memory_order_relaxed);
+    if (!contended) {
+        site.wait_histogram[0].fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    site.contended.fetch_add(1, std::memory_order_relaxed);
+    RecordDuration(site.wait_ns, site.max_wait_ns, site.wait_histogram, wait);
+}
+
+void RecordLockHold(LockSiteStats& site, std::chrono::nanoseconds hold)
+{
+    site.holds.fetch_add(1, std::memory_order_relaxed);
+    RecordDuration(site.hold_ns, site.max_hold_ns, site.hold_histogram, hold);
+}
+
+std::vector<LockSiteInfo> GetLockStats()
+{
+    using std::chrono::duration_cast, std::chrono::microseconds, std::chrono::nanoseconds;
+    const auto to_micros = [](const std::atomic<uint64_t>& ns) {
+        return duration_cast<microseconds>(nanoseconds{ns.load(std::memory_order_relaxed)});
+    };
+
+    std::map<std::tuple<std::string, std::string, int>, LockSiteInfo> merged;
+    for (const LockSiteStats& site : g_lock_sites) {
+        if (site.state.load(std::memory_order_acquire) != 2) continue;
+        const uint64_t count{site.count.load(std::memory_order_relaxed)};
+        const uint64_t holds{site.holds.load(std::memory_order_relaxed)};
+        if (count == 0 && holds == 0) continue;
+        LockSiteInfo& info{merged[{site.name, site.file, site.line}]};
+        info.name = site.name;
+        info.file = site.file;
+        info.line = site.line;
+        info.count += count;
+        info.contended += site.contended.load(std::memory_order_relaxed);
+        info.wait_time += to_micros(site.wait_ns);
+        info.max_wait = std::max(info.max_wait, to_micros(site.max_wait_ns));
+        info.holds += holds;
+        info.hold_time += to_micros(site.hold_ns);
+        info.max_hold = std::max(info.max_hold, to_micros(site.max_hold_ns));
+        for (size_t i = 0; i < LOCK_STATS_BUCKETS; ++i) {
+            info.wait_histogram[i] += site.wait_histogram[i].load(std::memory_order_relaxed);
+            info.hold_histogram[i] += site.hold_histogram[i].load(std::memory_order_relaxed);
+        }
+    }
+
+    std::vector<LockSiteInfo> ret;
+    ret.reserve(merged.size());
+    for (auto& [key, info] : merged) ret.push_back(std::move(info));
+    std::stable_sort(ret.begin(), ret.end(), [](const LockSiteInfo& a, const LockSiteInfo& b) {
+        return a.wait_time > b.wait_time;
+    });
+    return ret;
+}
+
+void ResetLockStats()
+{
+    for (LockSiteStats& site : g_lock_sites) {
+        site.count = 0;
+        site.contended = 0;
+        site.wait_ns = 0;
+        site.max_wait_ns = 0;
+        site.holds = 0;
+        site.hold_ns = 0;
+        site.max_hold_ns = 0;
+        for (auto& bucket : site.wait_histogram) bucket = 0;
+        for (auto& bucket : site.hold_histogram) bucket = 0;
+    }
+}
@@ -14,10 +14,15 @@
 #include <threadsafety.h>
 #include <util/macros.h>
 
+#include <array>
+#include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdint>
 #include <mutex>
 #include <string>
 #include <thread>
+#include <vector>
 
 ////////////////////////////////////////////////
 //                                            //
@@ -84,6 +89,49 @@ inline void DeleteLock(void* cs) {}
 inline bool LockStackEmpty() { return true; }
 #endif
 
+/** Default for -lockstats. */
+static constexpr bool DEFAULT_LOCKSTATS{false};
+/**
+ * Number of buckets of the lock profiler's wait and hold time histograms.
+ * Bucket i counts durations below 2^i microseconds, the last one all longer
+ * durations.
+ */
+static constexpr size_t LOCK_STATS_BUCKETS{20};
+
+/** Statistics of one lock site, i.e. a lock taken at a given source line. */
+struct LockSiteStats;
+
+/** Aggregated statistics of a lock site, as returned by GetLockStats(). */
+struct LockSiteInfo {
+    std::string name;
+    std::string file;
+    int line{0};
+    //! Number of times the lock was taken, and how often it had to be waited for
+    uint64_t count{0};
+    uint64_t contended{0};
+    std::chrono::microseconds wait_time{0};
+    std::chrono::microseconds max_wait{0};
+    //! Number of times the held lock was released, and for how long it was held
+    uint64_t holds{0};
+    std::chrono::microseconds hold_time{0};
+    std::chrono::microseconds max_hold{0};
+    std::array<uint64_t, LOCK_STATS_BUCKETS> wait_histogram{};
+    std::array<uint64_t, LOCK_STATS_BUCKETS> hold_histogram{};
+};
+
+extern std::atomic<bool> g_lock_stats_enabled;
+
+/** Whether the lock profiler records the locks taken with LOCK, LOCK2, TRY_LOCK and WAIT_LOCK. */
+inline bool LockStatsEnabled() { return g_lock_stats_enabled.load(std::memory_order_relaxed); }
+void SetLockStatsEnabled(bool enabled);
+/** Look up or register the statistics of a lock site. Returns nullptr if too many sites are registered. */
+LockSiteStats* GetLockSiteStats(const char* name, const char* file, int line);
+void RecordLockWait(LockSiteStats& site, std::chrono::nanoseconds wait, bool contended);
+void RecordLockHold(LockSiteStats& site, std::chrono::nanoseconds hold);
+/** Statistics of all lock sites taken while the profiler was enabled, longest total wait first. */
+std::vector<LockSiteInfo> GetLockStats();
+void ResetLockStats();
+
 /**
  * Template mixin that adds -Wthread-safety locking annotations and lock order
  * checking to a subset of the mutex API.
@@ -152,14 +200,34 @@ template <typename Mutex, typename Base = typename Mutex::UniqueLock>
 class SCOPED_LOCKABLE UniqueLock : public Base
 {
 private:
+    //! Lock profiler site of the held lock and when it was taken, if the profiler is enabled
+    LockSiteStats* m_stats_site{nullptr};
+    std::chrono::steady_clock::time_point m_stats_acquired;
+
     void Enter(const char* pszName, const char* pszFile, int nLine)
     {
         EnterCritical(pszName, pszFile, nLine, Base::mutex());
+        LockSiteStats* const site{LockStatsEnabled() ? GetLockSiteStats(pszName, pszFile, nLine) : nullptr};
+        if (site == nullptr) {
 #ifdef DEBUG_LOCKCONTENTION
-        if (Base::try_lock()) return;
-        LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
+            if (Base::try_lock()) return;
+            LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
 #endif
-        Base::lock();
+            Base::lock();
+            return;
+        }
+
+        const auto start{std::chrono::steady_clock::now()};
+        const bool contended{!Base::try_lock()};
+        if (contended) {
+#ifdef DEBUG_LOCKCONTENTION
+            LOG_TIME_MICROS_WITH_CATEGORY(strprintf("lock contention %s, %s:%d", pszName, pszFile, nLine), BCLog::LOCK);
+#endif
+            Base::lock();
+        }
+        m_stats_acquired = std::chrono::steady_clock::now();
+        m_stats_site = site;
+        RecordLockWait(*site, m_stats_acquired - start, contended);
     }
 
     bool TryEnter(const char* pszName, const char* pszFile, int nLine)
@@ -168,10 +236,24 @@ private:
         Base::try_lock();
         if (!Base::owns_lock()) {
             LeaveCritical();
+        } else if (LockStatsEnabled()) {
+            m_stats_site = GetLockSiteStats(pszName, pszFile, nLine);
+            if (m_stats_site) {
+                m_stats_acquired = std::chrono::steady_clock::now();
+                RecordLockWait(*m_stats_site, std::chrono::nanoseconds{0}, /*contended=*/false);
+            }
         }
         return Base::owns_lock();
     }
 
+    //! Record for how long the lock was held, before it is released.
+    void RecordRelease()
+    {
+        if (m_stats_site == nullptr) return;
+        RecordLockHold(*m_stats_site, std::chrono::steady_clock::now() - m_stats_acquired);
+        m_stats_site = nullptr;
+    }
+
 public:
     UniqueLock(Mutex& mutexIn, const char* pszName, const char* pszFile, int nLine, bool fTry = false) EXCLUSIVE_LOCK_FUNCTION(mutexIn) : Base(mutexIn, std::defer_lock)
     {
@@ -194,8 +276,10 @@ public:
 
     ~UniqueLock() UNLOCK_FUNCTION()
     {
-        if (Base::owns_lock())
+        if (Base::owns_lock()) {
+            RecordRelease();
             LeaveCritical();
+        }
     }
 
     operator bool()
@@ -215,6 +299,7 @@ public:
     public:
         explicit reverse_lock(UniqueLock& _lock, const char* _guardname, const char* _file, int _line) : lock(_lock), file(_file), line(_line) {
             CheckLastCritical((void*)lock.mutex(), lockname, _guardname, _file, _line);
+            lock.RecordRelease();
             lock.unlock();
             LeaveCritical();
             lock.swap(templock);
@@ -0,0 +1,123 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <consensus/amount.h>
+#include <index/addressindex.h>
+#include <interfaces/chain.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(addressindex_tests)
+
+static void IndexWaitSynced(BaseIndex& index)
+{
+    // Allow the AddressIndex to catch up with the block index that is syncing
+    // in a background thread.
+    const auto timeout = GetTime<std::chrono::seconds>() + 120s;
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(timeout > GetTime<std::chrono::milliseconds>());
+        UninterruptibleSleep(100ms);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_initial_sync, TestChain100Setup)
+{
+    AddressIndex index{interfaces::MakeChain(m_node), 1 << 20, true};
+    BOOST_REQUIRE(index.Start());
+    IndexWaitSynced(index);
+
+    // Every block after genesis pays its coinbase to the same key
+    const CScript coinbase_script{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const uint256 coinbase_hash{AddressIndex::GetScriptHash(coinbase_script)};
+    CAmount coinbase_total{0};
+    for (const auto& tx : m_coinbase_txns) coinbase_total += tx->vout[0].nValue;
+
+    std::vector<AddressHistoryEntry> history;
+    BOOST_REQUIRE(index.FindHistory(coinbase_hash, 0, 1000, history));
+    BOOST_REQUIRE_EQUAL(history.size(), m_coinbase_txns.size());
+    for (size_t i = 0; i < history.size(); ++i) {
+        BOOST_CHECK_EQUAL(history[i].height, int(i + 1));
+        BOOST_CHECK_EQUAL(history[i].txid, m_coinbase_txns[i]->GetHash());
+        BOOST_CHECK(!history[i].spending);
+    }
+
+    // Pages continue where the previous one stopped
+    std::vector<AddressHistoryEntry> page;
+    BOOST_REQUIRE(index.FindHistory(coinbase_hash, 10, 5, page));
+    BOOST_REQUIRE_EQUAL(page.size(), 5U);
+    BOOST_CHECK_EQUAL(page[0].txid, history[10].txid);
+
+    std::vector<AddressUnspentEntry> unspent;
+    BOOST_REQUIRE(index.FindUnspent(coinbase_hash, 0, 1000, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), m_coinbase_txns.size());
+
+    AddressBalance balance;
+    BOOST_REQUIRE(index.GetBalance(coinbase_hash, balance));
+    BOOST_CHECK_EQUAL(balance.balance, coinbase_total);
+    BOOST_CHECK_EQUAL(balance.received, coinbase_total);
+    BOOST_CHECK_EQUAL(balance.history_count, m_coinbase_txns.size());
+
+    // Other scripts have no history
+    BOOST_REQUIRE(index.FindHistory(AddressIndex::GetScriptHash(CScript() << OP_TRUE), 0, 1000, history));
+    BOOST_CHECK(history.empty());
+
+    index.Stop();
+}
+
+BOOST_FIXTURE_TEST_CASE(addressindex_spend, TestChain100Setup)
+{
+    AddressIndex index{interfaces::MakeChain(m_node), 1 << 20, true};
+    BOOST_REQUIRE(index.Start());
+    IndexWaitSynced(index);
+
+    const CScript coinbase_script{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const uint256 coinbase_hash{AddressIndex::GetScriptHash(coinbase_script)};
+    const CScript dest_script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+    const uint256 dest_hash{AddressIndex::GetScriptHash(dest_script)};
+    AddressBalance before;
+    BOOST_REQUIRE(index.GetBalance(coinbase_hash, before));
+
+    // Spend the first coinbase to another script of the same key
+    const CTransactionRef spent_tx{m_coinbase_txns[0]};
+    const CMutableTransaction spend{CreateValidMempoolTransaction(spent_tx, 0, 1, coinbaseKey, dest_script, 1 * COIN, /*submit=*/false)};
+    const CBlock block{CreateAndProcessBlock({spend}, coinbase_script)};
+    BOOST_REQUIRE(index.BlockUntilSyncedToCurrentChain());
+
+    std::vector<AddressHistoryEntry> history;
+    BOOST_REQUIRE(index.FindHistory(dest_hash, 0, 1000, history));
+    BOOST_REQUIRE_EQUAL(history.size(), 1U);
+    BOOST_CHECK_EQUAL(history[0].txid, spend.GetHash());
+    BOOST_CHECK_EQUAL(history[0].value, 1 * COIN);
+
+    // The spend is the last history entry of the coinbase script
+    BOOST_REQUIRE(index.FindHistory(coinbase_hash, 0, 1000, history));
+    const auto spend_entry{std::find_if(history.begin(), history.end(), [](const auto& entry) { return entry.spending; })};
+    BOOST_REQUIRE(spend_entry != history.end());
+    BOOST_CHECK_EQUAL(spend_entry->txid, spend.GetHash());
+    BOOST_CHECK_EQUAL(spend_entry->value, -spent_tx->vout[0].nValue);
+
+    AddressBalance after;
+    BOOST_REQUIRE(index.GetBalance(coinbase_hash, after));
+    BOOST_CHECK_EQUAL(after.balance, before.balance - spent_tx->vout[0].nValue + block.vtx[0]->vout[0].nValue);
+    BOOST_CHECK_EQUAL(after.history_count, before.history_count + 2);
+
+    std::vector<AddressUnspentEntry> unspent;
+    BOOST_REQUIRE(index.FindUnspent(coinbase_hash, 0, 1000, unspent));
+    BOOST_CHECK_EQUAL(unspent.size(), m_coinbase_txns.size());
+    for (const AddressUnspentEntry& entry : unspent) {
+        BOOST_CHECK(entry.txid != spent_tx->GetHash());
+    }
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
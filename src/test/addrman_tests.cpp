@@ -17,6 +17,7 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
 #include <optional>
 #include <string>
 
@@ -343,6 +344,76 @@ BOOST_AUTO_TEST_CASE(addrman_getaddr)
     BOOST_CHECK_EQUAL(addrman->size(), 2006U);
 }
 
+BOOST_AUTO_TEST_CASE(addrman_generation)
+{
+    auto addrman = std::make_unique<AddrMan>(EMPTY_NETGROUPMAN, DETERMINISTIC, GetCheckRatio(m_node));
+
+    CAddress addr = CAddress(ResolveService("250.1.1.1", 8333), NODE_NONE);
+    addr.nTime = Now<NodeSeconds>();
+    uint64_t generation{addrman->Generation()};
+    BOOST_CHECK(addrman->Add({addr}, ResolveIP("252.1.1.1")));
+    BOOST_CHECK(addrman->Generation() != generation);
+
+    // Reading does not count as a change, so an unchanged addrman need not be written again
+    generation = addrman->Generation();
+    (void)addrman->Select();
+    (void)addrman->GetAddr(/*max_addresses=*/0, /*max_pct=*/0, /*network=*/std::nullopt);
+    (void)addrman->FindAddressEntry(addr);
+    BOOST_CHECK_EQUAL(addrman->Generation(), generation);
+
+    BOOST_CHECK(addrman->Good(addr));
+    BOOST_CHECK(addrman->Generation() != generation);
+
+    // Loading from disk counts as a change too
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << *addrman;
+    auto addrman2 = std::make_unique<AddrMan>(EMPTY_NETGROUPMAN, DETERMINISTIC, GetCheckRatio(m_node));
+    generation = addrman2->Generation();
+    stream >> *addrman2;
+    BOOST_CHECK(addrman2->Generation() != generation);
+}
+
+BOOST_AUTO_TEST_CASE(addrman_getaddr_cache)
+{
+    auto addrman = std::make_unique<AddrMan>(EMPTY_NETGROUPMAN, DETERMINISTIC, GetCheckRatio(m_node));
+
+    for (unsigned int i = 1; i < 256; i++) {
+        CAddress addr = CAddress(ResolveService("250.1." + ToString(i) + ".1", 8333), NODE_NONE);
+        addr.nTime = Now<NodeSeconds>();
+        addrman->Add({addr}, ResolveIP("252.1." + ToString(i) + ".1"));
+    }
+
+    // An unchanged addrman serves the same response again
+    const std::vector<CAddress> vAddr1{addrman->GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/std::nullopt)};
+    BOOST_REQUIRE(!vAddr1.empty());
+    BOOST_CHECK(addrman->GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/std::nullopt) == vAddr1);
+    // Other parameters and networks are not answered from that response
+    BOOST_CHECK_EQUAL(addrman->GetAddr(/*max_addresses=*/0, /*max_pct=*/0, /*network=*/std::nullopt).size(), addrman->size());
+    BOOST_CHECK_EQUAL(addrman->GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/NET_ONION).size(), 0U);
+
+    // Any change to addrman invalidates the response
+    CAddress addr = CAddress(ResolveService("250.2.1.1", 8333), NODE_NONE);
+    addr.nTime = Now<NodeSeconds>();
+    BOOST_CHECK(addrman->Add({addr}, ResolveIP("252.2.1.1")));
+    BOOST_CHECK_EQUAL(addrman->GetAddr(/*max_addresses=*/0, /*max_pct=*/0, /*network=*/std::nullopt).size(), addrman->size());
+    addrman->SetServices(addr, NODE_NETWORK);
+    const std::vector<CAddress> vAddr2{addrman->GetAddr(/*max_addresses=*/0, /*max_pct=*/0, /*network=*/std::nullopt)};
+    const auto it{std::find(vAddr2.begin(), vAddr2.end(), addr)};
+    BOOST_REQUIRE(it != vAddr2.end());
+    BOOST_CHECK_EQUAL(it->nServices, NODE_NETWORK);
+
+    // So does its expiry
+    const auto vAddr3{addrman->GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/std::nullopt)};
+    SetMockTime(GetTime<std::chrono::seconds>() + ADDRMAN_GETADDR_CACHE_LIFETIME);
+    bool changed{false};
+    for (int i = 0; i < 10 && !changed; ++i) {
+        changed = addrman->GetAddr(/*max_addresses=*/2500, /*max_pct=*/23, /*network=*/std::nullopt) != vAddr3;
+        SetMockTime(GetTime<std::chrono::seconds>() + ADDRMAN_GETADDR_CACHE_LIFETIME);
+    }
+    BOOST_CHECK(changed);
+    SetMockTime(0);
+}
+
 
 BOOST_AUTO_TEST_CASE(caddrinfo_get_tried_bucket_legacy)
 {
@@ -458,6 +529,27 @@ BOOST_AUTO_TEST_CASE(caddrinfo_get_new_bucket_legacy)
     BOOST_CHECK(buckets.size() > 64);
 }
 
+BOOST_AUTO_TEST_CASE(compiled_asmap)
+{
+    const std::vector<bool> asmap = FromBytes(asmap_raw, sizeof(asmap_raw) * 8);
+    const CompiledAsmap compiled{asmap};
+    BOOST_CHECK(!compiled.empty());
+    BOOST_CHECK(CompiledAsmap{std::vector<bool>{}}.empty());
+
+    // Addresses within and outside of the mapped ranges agree with the interpreter
+    std::vector<bool> ip(128);
+    for (int i = 0; i < 96; ++i) ip[i] = i >= 80;
+    for (int i = 0; i < 1000; ++i) {
+        const uint32_t ipv4 = i % 2 ? 0x65000000 | InsecureRandBits(20) : InsecureRand32();
+        for (int bit = 0; bit < 32; ++bit) ip[96 + bit] = (ipv4 >> (31 - bit)) & 1;
+        BOOST_CHECK_EQUAL(compiled.Interpret(ip), Interpret(asmap, ip));
+    }
+    for (int i = 0; i < 1000; ++i) {
+        for (int bit = 0; bit < 128; ++bit) ip[bit] = InsecureRandBool();
+        BOOST_CHECK_EQUAL(compiled.Interpret(ip), Interpret(asmap, ip));
+    }
+}
+
 // The following three test cases use asmap.raw
 // We use an artificial minimal mock mapping
 // 250.0.0.0/8 AS1000
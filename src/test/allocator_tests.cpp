@@ -8,6 +8,7 @@
 #include <limits>
 #include <memory>
 #include <stdexcept>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -235,4 +236,59 @@ BOOST_AUTO_TEST_CASE(lockedpool_tests_live)
     BOOST_CHECK(pool.stats().used == initial.used);
 }
 
+BOOST_AUTO_TEST_CASE(lockedpool_tests_thread_cache)
+{
+#if !defined(HAVE_THREAD_LOCAL)
+    // The chunks freed are not cached on platforms where we don't have thread_local.
+    return;
+#endif
+    LockedPoolManager &pool = LockedPoolManager::Instance();
+    LockedPool::Stats initial = pool.stats();
+
+    // A chunk freed with its size is taken by the next allocation of that size,
+    // rounded up to the alignment, and counted as free meanwhile
+    void *a0 = pool.alloc(20);
+    BOOST_CHECK(a0);
+    BOOST_CHECK(pool.stats().used == initial.used + 32);
+    pool.free(a0, 20);
+    BOOST_CHECK(pool.stats().used == initial.used);
+    BOOST_CHECK(pool.alloc(32) == a0);
+    BOOST_CHECK(pool.stats().used == initial.used + 32);
+
+    // Chunks above THREAD_CACHE_MAX_CHUNK return to the pool
+    void *a1 = pool.alloc(LockedPoolManager::THREAD_CACHE_MAX_CHUNK + 1);
+    BOOST_CHECK(a1);
+    pool.free(a1, LockedPoolManager::THREAD_CACHE_MAX_CHUNK + 1);
+    BOOST_CHECK_THROW(pool.free(a1), std::runtime_error);
+
+    // A thread keeps the chunks it frees until it exits
+    void *taken = nullptr;
+    std::thread([&] {
+        pool.free(a0, 32);
+        taken = pool.alloc(32);
+        pool.free(taken, 32);
+    }).join();
+    BOOST_CHECK(taken == a0);
+    BOOST_CHECK_THROW(pool.free(a0), std::runtime_error);
+
+    // Chunks beyond THREAD_CACHE_SIZE return to the pool
+    std::vector<void*> chunks;
+    for (size_t i = 0; i <= LockedPoolManager::THREAD_CACHE_SIZE / LockedPoolManager::THREAD_CACHE_MAX_CHUNK; ++i) {
+        chunks.push_back(pool.alloc(LockedPoolManager::THREAD_CACHE_MAX_CHUNK));
+        BOOST_CHECK(chunks.back());
+    }
+    bool last_returned = false;
+    std::thread([&] {
+        for (void *chunk : chunks) pool.free(chunk, LockedPoolManager::THREAD_CACHE_MAX_CHUNK);
+        try {
+            pool.free(chunks.back());
+        } catch (const std::runtime_error&) {
+            last_returned = true;
+        }
+    }).join();
+    BOOST_CHECK(last_returned);
+
+    BOOST_CHECK(pool.stats().used == initial.used);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -13,8 +13,25 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <string>
+#include <vector>
+
 BOOST_FIXTURE_TEST_SUITE(banman_tests, BasicTestingSetup)
 
+static CNetAddr ResolveIP(const std::string& ip)
+{
+    CNetAddr addr;
+    BOOST_REQUIRE(LookupHost(ip, addr, /*fAllowLookup=*/false));
+    return addr;
+}
+
+static CSubNet ResolveSubNet(const std::string& subnet_str)
+{
+    CSubNet subnet;
+    BOOST_REQUIRE(LookupSubNet(subnet_str, subnet));
+    return subnet;
+}
+
 BOOST_AUTO_TEST_CASE(file)
 {
     SetMockTime(777s);
@@ -40,4 +57,80 @@ BOOST_AUTO_TEST_CASE(file)
     }
 }
 
+BOOST_AUTO_TEST_CASE(prefix_bits)
+{
+    // IPv4 subnets are prefixed by the IPv4-mapped range in GetAddrBytes()
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.0/24").GetPrefixBits(), 96U + 24U);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.4").GetPrefixBits(), 128U);
+    BOOST_CHECK_EQUAL(ResolveSubNet("1.2.3.0/255.255.0.0").GetPrefixBits(), 96U + 16U);
+    BOOST_CHECK_EQUAL(ResolveSubNet("2001:db8::/32").GetPrefixBits(), 32U);
+    BOOST_CHECK_EQUAL(ResolveSubNet("::/0").GetPrefixBits(), 0U);
+    BOOST_CHECK_EQUAL(ResolveSubNet("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion").GetPrefixBits(), 256U);
+}
+
+BOOST_AUTO_TEST_CASE(index_matches_scan)
+{
+    // Cluster the subnets and addresses so that many of them overlap
+    const auto random_addr = [&] {
+        if (InsecureRandBool()) {
+            return CNetAddr{in_addr{htonl(static_cast<uint32_t>(0x0a000000 | InsecureRandBits(12)))}};
+        }
+        in6_addr addr6{};
+        addr6.s6_addr[0] = 0x20;
+        addr6.s6_addr[1] = 0x01;
+        addr6.s6_addr[15] = static_cast<uint8_t>(InsecureRandBits(4));
+        return CNetAddr{addr6};
+    };
+
+    std::vector<std::pair<CSubNet, int64_t>> banned;
+    BannedSubnetIndex index;
+    for (int i = 0; i < 200; ++i) {
+        const CNetAddr addr{random_addr()};
+        banned.emplace_back(CSubNet{addr, static_cast<uint8_t>(InsecureRandRange(addr.IsIPv4() ? 33 : 129))}, InsecureRandRange(100));
+        index.Insert(banned.back().first, banned.back().second);
+    }
+    for (int i = 0; i < 2000; ++i) {
+        const CNetAddr addr{random_addr()};
+        const int64_t now = InsecureRandRange(100);
+        bool expected{false};
+        for (const auto& [sub_net, ban_until] : banned) {
+            expected |= now < ban_until && sub_net.Match(addr);
+        }
+        BOOST_CHECK_EQUAL(index.IsBanned(addr, now), expected);
+    }
+
+    // Different networks sharing address bytes stay apart
+    const CNetAddr onion{ResolveSubNet("pg6mmjiyjmcrsslvykfwnntlaru7p5svn6y2ymmju6nubxndf4pscryd.onion").GetNetworkAddr()};
+    BOOST_CHECK(!index.IsBanned(onion, 0));
+    index.Insert(CSubNet{onion}, 1);
+    BOOST_CHECK(index.IsBanned(onion, 0));
+    index.Clear();
+    BOOST_CHECK(!index.IsBanned(onion, 0));
+}
+
+BOOST_AUTO_TEST_CASE(ban_subnets)
+{
+    const fs::path banlist_path{m_args.GetDataDirBase() / "banlist_subnets"};
+    BanMan banman{banlist_path, /*client_interface=*/nullptr, /*default_ban_time=*/60};
+
+    const CNetAddr addr{ResolveIP("10.1.2.3")};
+    BOOST_CHECK(!banman.IsBanned(addr));
+    banman.Ban(ResolveSubNet("10.1.0.0/16"));
+    banman.Ban(ResolveSubNet("10.0.0.0/8"));
+    BOOST_CHECK(banman.IsBanned(addr));
+    BOOST_CHECK(!banman.IsBanned(ResolveIP("11.1.2.3")));
+    BOOST_CHECK(banman.Unban(ResolveSubNet("10.0.0.0/8")));
+    BOOST_CHECK(banman.IsBanned(addr));
+    BOOST_CHECK(banman.Unban(ResolveSubNet("10.1.0.0/16")));
+    BOOST_CHECK(!banman.IsBanned(addr));
+
+    // Expired bans no longer match
+    SetMockTime(GetTime<std::chrono::seconds>());
+    banman.Ban(addr);
+    BOOST_CHECK(banman.IsBanned(addr));
+    SetMockTime(GetTime<std::chrono::seconds>() + 61s);
+    BOOST_CHECK(!banman.IsBanned(addr));
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,108 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <kernel/bitcoinkernel.h>
+
+#include <coins.h>
+#include <key.h>
+#include <primitives/block.h>
+#include <script/bitcoinconsensus.h>
+#include <script/sign.h>
+#include <script/signingprovider.h>
+#include <script/standard.h>
+#include <streams.h>
+#include <util/translation.h>
+#include <version.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <map>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(bitcoinkernel_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(verify_block_scripts)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    BOOST_REQUIRE(keystore.AddKey(key));
+    const std::vector<CScript> script_pubkeys{GetScriptForDestination(PKHash(key.GetPubKey())),
+                                              GetScriptForDestination(WitnessV0KeyHash(key.GetPubKey()))};
+
+    // A block with a coinbase, a transaction spending one of each output type
+    // and one spending a single output
+    CBlock block;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vout.emplace_back(50 * COIN, script_pubkeys[0]);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    std::vector<CTxOut> spent;
+    for (const size_t num_inputs : {2, 1}) {
+        CMutableTransaction mtx;
+        std::map<COutPoint, Coin> coins;
+        for (size_t i = 0; i < num_inputs; ++i) {
+            const COutPoint prevout{InsecureRand256(), 0};
+            const CTxOut txout{COIN, script_pubkeys[i]};
+            mtx.vin.emplace_back(prevout);
+            coins.emplace(prevout, Coin{txout, 1, false});
+            spent.push_back(txout);
+        }
+        mtx.vout.emplace_back(COIN / 2, script_pubkeys[0]);
+        std::map<int, bilingual_str> input_errors;
+        BOOST_REQUIRE(SignTransaction(mtx, &keystore, coins, SIGHASH_ALL, input_errors));
+        block.vtx.push_back(MakeTransactionRef(mtx));
+    }
+    CDataStream stream{SER_NETWORK, PROTOCOL_VERSION};
+    stream << block;
+    const unsigned char* block_data{UCharCast(stream.data())};
+
+    const unsigned int flags{bitcoinconsensus_SCRIPT_FLAGS_VERIFY_ALL | bitcoinkernel_SCRIPT_FLAGS_VERIFY_TAPROOT};
+    bitcoinkernel_script_verifier* verifier{bitcoinkernel_script_verifier_create(2)};
+    BOOST_REQUIRE(verifier);
+    const auto verify{[&](std::vector<int>& results, bitcoinkernel_error& err) {
+        std::vector<bitcoinkernel_spent_output> spent_outputs;
+        for (const CTxOut& txout : spent) {
+            spent_outputs.push_back({txout.scriptPubKey.data(), static_cast<unsigned int>(txout.scriptPubKey.size()), txout.nValue});
+        }
+        results.assign(spent_outputs.size(), -1);
+        return bitcoinkernel_verify_block_scripts(verifier, block_data, stream.size(), spent_outputs.data(), spent_outputs.size(),
+                                                  flags, results.data(), &err);
+    }};
+
+    std::vector<int> results;
+    bitcoinkernel_error err;
+    BOOST_CHECK_EQUAL(verify(results, err), 1);
+    BOOST_CHECK_EQUAL(err, bitcoinkernel_ERR_OK);
+    BOOST_CHECK(results == std::vector<int>({1, 1, 1}));
+
+    // Each input gets its own result: the segwit signature commits to the amount
+    spent[1].nValue += 1;
+    BOOST_CHECK_EQUAL(verify(results, err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinkernel_ERR_OK);
+    BOOST_CHECK(results == std::vector<int>({1, 0, 1}));
+    spent[1].nValue -= 1;
+    spent[2].scriptPubKey = script_pubkeys[1];
+    BOOST_CHECK_EQUAL(verify(results, err), 0);
+    BOOST_CHECK(results == std::vector<int>({1, 1, 0}));
+
+    // Errors
+    spent.pop_back();
+    BOOST_CHECK_EQUAL(verify(results, err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinkernel_ERR_SPENT_OUTPUTS_MISMATCH);
+    BOOST_CHECK_EQUAL(bitcoinkernel_verify_block_scripts(verifier, block_data, stream.size(), nullptr, 0, 1U << 20, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinkernel_ERR_INVALID_FLAGS);
+    BOOST_CHECK_EQUAL(bitcoinkernel_verify_block_scripts(verifier, block_data, stream.size() - 1, nullptr, 0, flags, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinkernel_ERR_BLOCK_DESERIALIZE);
+    stream << uint8_t{0};
+    block_data = UCharCast(stream.data());
+    BOOST_CHECK_EQUAL(bitcoinkernel_verify_block_scripts(verifier, block_data, stream.size(), nullptr, 0, flags, nullptr, &err), 0);
+    BOOST_CHECK_EQUAL(err, bitcoinkernel_ERR_BLOCK_SIZE_MISMATCH);
+
+    bitcoinkernel_script_verifier_destroy(verifier);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
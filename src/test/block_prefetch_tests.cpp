@@ -0,0 +1,67 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <node/block_prefetch.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <uint256.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+using node::BlockPrefetcher;
+using node::MAX_PREFETCHED_BLOCKS;
+
+BOOST_AUTO_TEST_SUITE(block_prefetch_tests)
+
+//! Read the active chain from genesis through the prefetcher, comparing the blocks with ReadBlockFromDisk()
+static void CheckChain(ChainstateManager& chainman, BlockPrefetcher& prefetcher, size_t window)
+{
+    std::vector<const CBlockIndex*> chain;
+    {
+        LOCK(cs_main);
+        for (const CBlockIndex* index{chainman.ActiveChain().Genesis()}; index; index = chainman.ActiveChain().Next(index)) {
+            chain.push_back(index);
+        }
+    }
+    for (const CBlockIndex* index : chain) {
+        const std::shared_ptr<const CBlock> block{prefetcher.GetBlock(index->GetBlockHash(), window)};
+        BOOST_REQUIRE(block);
+        CBlock expected;
+        BOOST_REQUIRE(node::ReadBlockFromDisk(expected, index, Params().GetConsensus()));
+        BOOST_CHECK_EQUAL(block->GetHash(), expected.GetHash());
+        BOOST_CHECK_EQUAL(block->vtx.size(), expected.vtx.size());
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(prefetch_active_chain, TestChain100Setup)
+{
+    ChainstateManager& chainman{*m_node.chainman};
+
+    // Reading inline, without threads
+    {
+        BlockPrefetcher prefetcher{chainman, /*num_threads=*/0};
+        CheckChain(chainman, prefetcher, /*window=*/16);
+    }
+
+    // With the widest window, blocks are dropped before they are asked for and
+    // have to be read again.
+    for (const size_t window : {size_t{0}, size_t{16}, MAX_PREFETCHED_BLOCKS * 2}) {
+        BlockPrefetcher prefetcher{chainman, /*num_threads=*/2};
+        CheckChain(chainman, prefetcher, window);
+        // Scanned again, as by the rescan of another wallet
+        CheckChain(chainman, prefetcher, window);
+    }
+
+    BlockPrefetcher prefetcher{chainman, /*num_threads=*/2};
+    BOOST_CHECK(!prefetcher.GetBlock(uint256::ONE, /*window=*/16));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -300,6 +300,73 @@ BOOST_AUTO_TEST_CASE(EmptyBlockRoundTripTest)
     }
 }
 
+BOOST_AUTO_TEST_CASE(PrefilledExtraTxnRoundTripTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    CBlock block(BuildBlockTestCase());
+
+    // Prefill the last transaction and find the other one in the extra pool
+    CBlockHeaderAndShortTxIDs shortIDs{block, {2}};
+
+    CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+    stream << shortIDs;
+
+    CBlockHeaderAndShortTxIDs shortIDs2;
+    stream >> shortIDs2;
+    BOOST_CHECK_EQUAL(shortIDs2.BlockTxCount(), block.vtx.size());
+
+    // Free slots of the extra pool are skipped
+    const std::vector<std::pair<uint256, CTransactionRef>> extra{{}, {block.vtx[1]->GetWitnessHash(), block.vtx[1]}, {}};
+    PartiallyDownloadedBlock partialBlock(&pool);
+    BOOST_CHECK(partialBlock.InitData(shortIDs2, extra) == READ_STATUS_OK);
+    for (size_t i = 0; i < block.vtx.size(); i++) {
+        BOOST_CHECK(partialBlock.IsTxAvailable(i));
+    }
+
+    CBlock block2;
+    BOOST_CHECK(partialBlock.FillBlock(block2, {}) == READ_STATUS_OK);
+    BOOST_CHECK_EQUAL(block.GetHash().ToString(), block2.GetHash().ToString());
+}
+
+BOOST_AUTO_TEST_CASE(ShortIDCollisionTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    CBlock block(BuildBlockTestCase());
+
+    // Two transactions with the same short ID make the block be requested
+    {
+        TestHeaderAndShortIDs shortIDs(block);
+        shortIDs.shorttxids[1] = shortIDs.shorttxids[0];
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << shortIDs;
+        CBlockHeaderAndShortTxIDs shortIDs2;
+        stream >> shortIDs2;
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_FAILED);
+    }
+
+    // Short IDs that are close to each other still fit in the table
+    {
+        TestHeaderAndShortIDs shortIDs(block);
+        shortIDs.shorttxids.resize(3000);
+        for (size_t i = 0; i < shortIDs.shorttxids.size(); i++) {
+            shortIDs.shorttxids[i] = i;
+        }
+
+        CDataStream stream(SER_NETWORK, PROTOCOL_VERSION);
+        stream << shortIDs;
+        CBlockHeaderAndShortTxIDs shortIDs2;
+        stream >> shortIDs2;
+
+        PartiallyDownloadedBlock partialBlock(&pool);
+        BOOST_CHECK(partialBlock.InitData(shortIDs2, extra_txn) == READ_STATUS_OK);
+        BOOST_CHECK(partialBlock.IsTxAvailable(0));
+        BOOST_CHECK(!partialBlock.IsTxAvailable(1));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(TransactionsRequestSerializationTest) {
     BlockTransactionsRequest req1;
     req1.blockhash = InsecureRand256();
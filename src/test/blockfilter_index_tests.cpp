@@ -273,6 +273,49 @@ BOOST_FIXTURE_TEST_CASE(blockfilter_index_initial_sync, BuildChainTestingSetup)
     filter_index.Stop();
 }
 
+BOOST_FIXTURE_TEST_CASE(blockfilter_index_match_range, TestChain100Setup)
+{
+    BlockFilterIndex filter_index(interfaces::MakeChain(m_node), BlockFilterType::BASIC, 1 << 20, true);
+    BOOST_REQUIRE(filter_index.Start());
+    const auto timeout = GetTime<std::chrono::seconds>() + 120s;
+    while (!filter_index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(timeout > GetTime<std::chrono::milliseconds>());
+        UninterruptibleSleep(100ms);
+    }
+
+    // Every block after genesis pays its coinbase to the same key
+    const CScript coinbase_script{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const GCSFilter::ElementSet elements{GCSFilter::Element(coinbase_script.begin(), coinbase_script.end())};
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+
+    for (int n_threads : {0, 1, 3}) {
+        std::vector<const CBlockIndex*> matches;
+        BOOST_REQUIRE(filter_index.MatchFilterRange(1, tip, elements, matches, n_threads));
+        BOOST_REQUIRE_EQUAL(matches.size(), size_t(tip->nHeight));
+        for (size_t i = 0; i < matches.size(); ++i) {
+            BOOST_CHECK_EQUAL(matches[i], tip->GetAncestor(i + 1));
+        }
+    }
+
+    // No block pays to another script, except for a false positive
+    const CScript other_script{CScript() << OP_TRUE};
+    std::vector<const CBlockIndex*> matches;
+    BOOST_REQUIRE(filter_index.MatchFilterRange(0, tip, {GCSFilter::Element(other_script.begin(), other_script.end())}, matches, 2));
+    BOOST_CHECK(matches.size() <= 1);
+
+    // The scan stops at the first batch when interrupted
+    std::vector<int> batch_heights;
+    BOOST_CHECK(!filter_index.MatchFilterRange(0, tip, elements, matches, 0, [&](int height) {
+        batch_heights.push_back(height);
+        return true;
+    }));
+    BOOST_CHECK(batch_heights == std::vector<int>{0});
+    BOOST_CHECK(!filter_index.MatchFilterRange(tip->nHeight + 1, tip, elements, matches));
+
+    filter_index.Interrupt();
+    filter_index.Stop();
+}
+
 BOOST_FIXTURE_TEST_CASE(blockfilter_index_init_destroy, BasicTestingSetup)
 {
     BlockFilterIndex* filter_index;
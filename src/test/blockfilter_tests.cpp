@@ -10,6 +10,7 @@
 #include <serialize.h>
 #include <streams.h>
 #include <univalue.h>
+#include <util/golombrice.h>
 #include <util/strencodings.h>
 
 #include <boost/test/unit_test.hpp>
@@ -39,6 +40,59 @@ BOOST_AUTO_TEST_CASE(gcsfilter_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(golombrice_word_coder)
+{
+    // Values with long unary quotients and every remainder width, around the word boundaries
+    for (uint8_t P : {0, 1, 19, 32, 48}) {
+        std::vector<uint64_t> values;
+        for (int i = 0; i < 200; ++i) {
+            values.push_back(InsecureRand32() >> InsecureRandRange(32));
+        }
+        values.push_back(0);
+        values.push_back((uint64_t{130} << P) + 1);
+
+        std::vector<unsigned char> bit_encoded, word_encoded;
+        {
+            CVectorWriter stream(SER_NETWORK, 0, bit_encoded, 0);
+            BitStreamWriter<CVectorWriter> bitwriter(stream);
+            for (uint64_t value : values) GolombRiceEncode(bitwriter, P, value);
+        }
+        {
+            GolombRiceWriter writer(word_encoded);
+            for (uint64_t value : values) writer.Encode(P, value);
+        }
+        BOOST_CHECK(word_encoded == bit_encoded);
+
+        GolombRiceReader reader{word_encoded};
+        for (uint64_t value : values) {
+            BOOST_CHECK_EQUAL(reader.Decode(P), value);
+        }
+        BOOST_CHECK(reader.empty());
+        // Reading past the end fails, unless only padding is left that happens to decode
+        if (P > 7) BOOST_CHECK_THROW(reader.Decode(P), std::ios_base::failure);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(gcsfilter_large_set)
+{
+    // Large enough for the radix sort; matches must hold for every element
+    GCSFilter::ElementSet elements;
+    for (int i = 0; i < 5000; ++i) {
+        GCSFilter::Element element(32);
+        element[0] = static_cast<unsigned char>(i);
+        element[1] = static_cast<unsigned char>(i >> 8);
+        elements.insert(std::move(element));
+    }
+    GCSFilter filter({1, 2, BASIC_FILTER_P, BASIC_FILTER_M}, elements);
+    BOOST_CHECK_EQUAL(filter.GetN(), elements.size());
+    for (const auto& element : elements) {
+        BOOST_CHECK(filter.Match(element));
+    }
+    BOOST_CHECK(filter.MatchAny(elements));
+    GCSFilter decoded({1, 2, BASIC_FILTER_P, BASIC_FILTER_M}, filter.GetEncoded(), /*skip_decode_check=*/false);
+    BOOST_CHECK(decoded.GetEncoded() == filter.GetEncoded());
+}
+
 BOOST_AUTO_TEST_CASE(gcsfilter_default_constructor)
 {
     GCSFilter filter;
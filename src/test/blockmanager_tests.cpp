@@ -0,0 +1,316 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <clientversion.h>
+#include <flatfile.h>
+#include <fs.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/script.h>
+#include <streams.h>
+#include <test/util/setup_common.h>
+#include <undo.h>
+#include <validation.h>
+#include <util/system.h>
+#include <version.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdio>
+#include <ios>
+#include <memory>
+#include <set>
+#include <vector>
+
+BOOST_AUTO_TEST_SUITE(blockmanager_tests)
+
+BOOST_FIXTURE_TEST_CASE(read_mapped_block_files, TestChain100Setup)
+{
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+    for (const bool mmap : {false, true}) {
+        node::fBlockFileMmap = mmap;
+        for (const CBlockIndex* pindex{tip}; pindex->pprev; pindex = pindex->pprev) {
+            const FlatFilePos pos{WITH_LOCK(::cs_main, return pindex->GetBlockPos())};
+            CBlock block;
+            BOOST_REQUIRE(node::ReadBlockFromDisk(block, pindex, Params().GetConsensus()));
+
+            // The raw block matches the serialization of the deserialized one,
+            // read the same way or from a copy of the file
+            node::RawBlock raw;
+            BOOST_REQUIRE(node::ReadRawBlockFromDisk(raw, pos, Params().MessageStart()));
+            BOOST_CHECK(raw.owner);
+            std::vector<uint8_t> copy;
+            BOOST_REQUIRE(node::ReadRawBlockFromDisk(copy, pos, Params().MessageStart()));
+            BOOST_CHECK(Span<const uint8_t>{copy} == raw.data);
+            CDataStream ss{SER_DISK, CLIENT_VERSION};
+            ss << block;
+            BOOST_CHECK(MakeUCharSpan(ss) == raw.data);
+
+            // Wrong network magic is rejected
+            BOOST_CHECK(!node::ReadRawBlockFromDisk(raw, pos, CreateChainParams(*m_node.args, CBaseChainParams::MAIN)->MessageStart()));
+        }
+    }
+
+    // A block position beyond the end of the file is not mapped and fails to read
+    CBlock block;
+    FlatFilePos pos{WITH_LOCK(::cs_main, return tip->GetBlockPos())};
+    pos.nPos += 1 << 30;
+    BOOST_CHECK(!node::ReadBlockFromDisk(block, pos, Params().GetConsensus()));
+    node::fBlockFileMmap = node::DEFAULT_BLOCK_FILE_MMAP;
+}
+
+BOOST_FIXTURE_TEST_CASE(strip_raw_block_witness, BasicTestingSetup)
+{
+    CBlock block;
+    block.nVersion = 4;
+    block.nBits = 0x207fffff;
+    CMutableTransaction coinbase;
+    coinbase.vin.resize(1);
+    coinbase.vin[0].scriptSig = CScript{} << 1 << OP_0;
+    coinbase.vout.emplace_back(50 * COIN, CScript{} << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    CMutableTransaction spend;
+    spend.vin.emplace_back(COutPoint{InsecureRand256(), 0});
+    spend.vin.emplace_back(COutPoint{InsecureRand256(), 1});
+    spend.vout.emplace_back(COIN, CScript{} << OP_TRUE);
+    spend.vout.emplace_back(2 * COIN, CScript{} << OP_FALSE);
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    const auto serialize = [&](int flags) {
+        CDataStream ss{SER_NETWORK, PROTOCOL_VERSION | flags};
+        ss << block;
+        auto buffer{std::make_shared<const std::vector<uint8_t>>(UCharCast(ss.data()), UCharCast(ss.data() + ss.size()))};
+        return node::RawBlock{buffer, *buffer};
+    };
+
+    // Without witness data the block is returned as is
+    const node::RawBlock legacy{serialize(0)};
+    auto stripped{node::StripRawBlockWitness(legacy)};
+    BOOST_REQUIRE(stripped);
+    BOOST_CHECK(stripped->data.data() == legacy.data.data());
+
+    // Witness data of any transaction is cut out
+    spend.vin[1].scriptWitness.stack = {{1, 2, 3}, std::vector<unsigned char>(300, 4)};
+    block.vtx[1] = MakeTransactionRef(spend);
+    coinbase.vin[0].scriptWitness.stack = {std::vector<unsigned char>(32, 0)};
+    block.vtx[0] = MakeTransactionRef(coinbase);
+    const node::RawBlock witness{serialize(0)};
+    BOOST_CHECK(witness.data.size() > legacy.data.size());
+    stripped = node::StripRawBlockWitness(witness);
+    BOOST_REQUIRE(stripped);
+    BOOST_CHECK(stripped->data == serialize(SERIALIZE_TRANSACTION_NO_WITNESS).data);
+
+    // Truncated or padded blocks are rejected
+    BOOST_CHECK(!node::StripRawBlockWitness({witness.owner, witness.data.first(witness.data.size() - 1)}));
+    auto padded{std::make_shared<std::vector<uint8_t>>(witness.data.begin(), witness.data.end())};
+    padded->push_back(0);
+    BOOST_CHECK(!node::StripRawBlockWitness({padded, *padded}));
+}
+
+BOOST_FIXTURE_TEST_CASE(write_combined_blocks, BasicTestingSetup)
+{
+    node::BlockManager blockman;
+    CChain chain;
+    const CBlock& genesis{Params().GenesisBlock()};
+    const FlatFilePos pos1{blockman.SaveBlockToDisk(genesis, 0, chain, Params(), nullptr)};
+    const FlatFilePos pos2{blockman.SaveBlockToDisk(genesis, 0, chain, Params(), nullptr)};
+    BOOST_REQUIRE(!pos1.IsNull());
+    BOOST_CHECK_EQUAL(pos1.nFile, pos2.nFile);
+    BOOST_CHECK_EQUAL(pos2.nPos, pos1.nPos + ::GetSerializeSize(genesis, CLIENT_VERSION) + 8);
+
+    const auto read_magic = [](const FlatFilePos& pos) {
+        CAutoFile file{node::OpenBlockFile({pos.nFile, pos.nPos - 8}, true), SER_DISK, CLIENT_VERSION};
+        CMessageHeader::MessageStartChars magic{};
+        file >> magic;
+        return std::vector<unsigned char>(std::begin(magic), std::end(magic));
+    };
+    const std::vector<unsigned char> expected(std::begin(Params().MessageStart()), std::end(Params().MessageStart()));
+
+    // Both blocks are still buffered, in the preallocated part of the file
+    BOOST_CHECK(read_magic(pos1) != expected);
+
+    // Reading a buffered block writes it first
+    CBlock block;
+    BOOST_CHECK(node::ReadBlockFromDisk(block, pos2, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(block.GetHash(), genesis.GetHash());
+    BOOST_CHECK(read_magic(pos1) == expected);
+    BOOST_CHECK(read_magic(pos2) == expected);
+}
+
+BOOST_FIXTURE_TEST_CASE(read_compressed_blocks, TestChain100Setup)
+{
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+    CBlock block;
+    BOOST_REQUIRE(node::ReadBlockFromDisk(block, tip, Params().GetConsensus()));
+    std::vector<uint8_t> regular;
+    BOOST_REQUIRE(node::ReadRawBlockFromDisk(regular, WITH_LOCK(::cs_main, return tip->GetBlockPos()), Params().MessageStart()));
+
+    node::fCompressBlockFiles = true;
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return m_node.chainman->m_blockman.SaveBlockToDisk(block, tip->nHeight, m_node.chainman->ActiveChain(), Params(), nullptr))};
+    node::fCompressBlockFiles = node::DEFAULT_COMPRESS_BLOCK_FILES;
+    BOOST_REQUIRE(!pos.IsNull());
+
+    for (const bool mmap : {false, true}) {
+        node::fBlockFileMmap = mmap;
+        CBlock read;
+        BOOST_CHECK(node::ReadBlockFromDisk(read, pos, Params().GetConsensus()));
+        BOOST_CHECK_EQUAL(read.GetHash(), block.GetHash());
+        BOOST_CHECK_EQUAL(read.vtx.size(), block.vtx.size());
+
+        // Raw reads return the regular serialization
+        node::RawBlock raw;
+        BOOST_REQUIRE(node::ReadRawBlockFromDisk(raw, pos, Params().MessageStart()));
+        BOOST_CHECK(raw.data == Span<const uint8_t>{regular});
+    }
+    node::fBlockFileMmap = node::DEFAULT_BLOCK_FILE_MMAP;
+}
+
+BOOST_FIXTURE_TEST_CASE(read_recent_blocks, TestChain100Setup)
+{
+    node::BlockManager& blockman{m_node.chainman->m_blockman};
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+
+    // A block and undo data kept in memory are returned as they are
+    auto block{std::make_shared<CBlock>()};
+    BOOST_REQUIRE(node::ReadBlockFromDisk(*block, tip, Params().GetConsensus()));
+    auto undo{std::make_shared<CBlockUndo>()};
+    BOOST_REQUIRE(node::UndoReadFromDisk(*undo, tip));
+    blockman.CacheRecentBlock(block);
+    blockman.CacheRecentBlockUndo(tip->GetBlockHash(), undo);
+    BOOST_CHECK(blockman.ReadBlock(*tip, Params().GetConsensus()) == block);
+    BOOST_CHECK(blockman.ReadBlockUndo(*tip) == undo);
+
+    // Once MAX_RECENT_BLOCKS other blocks are kept, they are read from disk again
+    const CBlockIndex* pindex{tip->pprev};
+    for (size_t i = 0; i < node::MAX_RECENT_BLOCKS; ++i, pindex = pindex->pprev) {
+        auto other{std::make_shared<CBlock>()};
+        BOOST_REQUIRE(node::ReadBlockFromDisk(*other, pindex, Params().GetConsensus()));
+        blockman.CacheRecentBlock(other);
+    }
+    const auto read{blockman.ReadBlock(*tip, Params().GetConsensus())};
+    BOOST_REQUIRE(read);
+    BOOST_CHECK(read != block);
+    BOOST_CHECK_EQUAL(read->GetHash(), block->GetHash());
+    const auto read_undo{blockman.ReadBlockUndo(*tip)};
+    BOOST_REQUIRE(read_undo);
+    BOOST_CHECK(read_undo != undo);
+    BOOST_CHECK_EQUAL(read_undo->vtxundo.size(), undo->vtxundo.size());
+}
+
+static void CheckTxUndoEqual(const CTxUndo& a, const CTxUndo& b)
+{
+    BOOST_REQUIRE_EQUAL(a.vprevout.size(), b.vprevout.size());
+    for (size_t i = 0; i < a.vprevout.size(); ++i) {
+        BOOST_CHECK(a.vprevout[i].out == b.vprevout[i].out);
+        BOOST_CHECK_EQUAL(a.vprevout[i].nHeight, b.vprevout[i].nHeight);
+        BOOST_CHECK_EQUAL(a.vprevout[i].fCoinBase, b.vprevout[i].fCoinBase);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(compact_block_undo)
+{
+    const CScript p2pkh{CScript() << OP_DUP << OP_HASH160 << std::vector<uint8_t>(20, 1) << OP_EQUALVERIFY << OP_CHECKSIG};
+    const CScript other{CScript() << OP_1 << std::vector<uint8_t>(32, 2)};
+    CBlockUndo blockundo;
+    blockundo.vtxundo.resize(3);
+    // A transaction spending the same script often, also further back than a reference reaches
+    for (uint32_t i = 0; i < 2 * CompactTxUndoFormatter::MAX_SCRIPT_BACK_REFERENCE; ++i) {
+        const bool same{i == 0 || i == 2 * CompactTxUndoFormatter::MAX_SCRIPT_BACK_REFERENCE - 1};
+        blockundo.vtxundo[0].vprevout.emplace_back(CTxOut{i * COIN, same ? p2pkh : CScript() << OP_RETURN << int64_t{i}}, 100 + i, /*fCoinBaseIn=*/false);
+    }
+    blockundo.vtxundo[1].vprevout.emplace_back(CTxOut{50 * COIN, other}, 1, /*fCoinBaseIn=*/true);
+    blockundo.vtxundo[1].vprevout.emplace_back(CTxOut{7, p2pkh}, 0x7fffffff, /*fCoinBaseIn=*/false);
+    blockundo.vtxundo[1].vprevout.emplace_back(CTxOut{8, other}, 2, /*fCoinBaseIn=*/false);
+    blockundo.vtxundo[1].vprevout.emplace_back(CTxOut{9, other}, 3, /*fCoinBaseIn=*/false);
+
+    const node::CompactBlockUndo compact{blockundo};
+    BOOST_CHECK_LT(compact.GetData().size(), GetSerializeSize(blockundo, CLIENT_VERSION));
+    const node::CompactBlockUndo read{std::vector<uint8_t>{compact.GetData().begin(), compact.GetData().end()}};
+    BOOST_REQUIRE_EQUAL(read.size(), blockundo.vtxundo.size());
+    for (size_t i = 0; i < blockundo.vtxundo.size(); ++i) {
+        CheckTxUndoEqual(read.GetTxUndo(i), blockundo.vtxundo[i]);
+    }
+    BOOST_CHECK_EQUAL(read.GetBlockUndo().vtxundo.size(), blockundo.vtxundo.size());
+
+    // Sizes that do not add up to the undo data are rejected
+    std::vector<uint8_t> data{compact.GetData().begin(), compact.GetData().end()};
+    data.pop_back();
+    BOOST_CHECK_THROW(node::CompactBlockUndo{data}, std::ios_base::failure);
+    data = {compact.GetData().begin(), compact.GetData().end()};
+    data.push_back(0);
+    BOOST_CHECK_THROW(node::CompactBlockUndo{data}, std::ios_base::failure);
+    data = {0xfd, 0xff, 0xff};
+    BOOST_CHECK_THROW(node::CompactBlockUndo{data}, std::ios_base::failure);
+    data = {0};
+    BOOST_CHECK_EQUAL(node::CompactBlockUndo{data}.size(), 0U);
+
+    // So is a script reference further back than the first prevout
+    data = {1, 4, 1, 4 * 5 + 1, 0, 0};
+    const node::CompactBlockUndo bad_reference{data};
+    BOOST_CHECK_THROW(bad_reference.GetTxUndo(0), std::ios_base::failure);
+}
+
+BOOST_FIXTURE_TEST_CASE(read_compact_undo, TestChain100Setup)
+{
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+    CBlockUndo blockundo;
+    BOOST_REQUIRE(node::UndoReadFromDisk(blockundo, tip));
+    node::CompactBlockUndo compact;
+    BOOST_REQUIRE(node::UndoReadFromDisk(compact, tip));
+    BOOST_REQUIRE_EQUAL(compact.size(), blockundo.vtxundo.size());
+    for (size_t i = 0; i < compact.size(); ++i) {
+        CheckTxUndoEqual(compact.GetTxUndo(i), blockundo.vtxundo[i]);
+    }
+
+    // Undo data is written as compact undo records, reading it wrote it to the undo file
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return tip->GetUndoPos())};
+    AutoFile file{FlatFileSeq{gArgs.GetBlocksDirPath(), "rev", 1}.Open(FlatFilePos{pos.nFile, pos.nPos - 8}, /*read_only=*/true)};
+    BOOST_REQUIRE(!file.IsNull());
+    CMessageHeader::MessageStartChars magic;
+    file >> magic;
+    BOOST_CHECK(node::IsCompactUndoRecord(magic, Params().MessageStart()));
+}
+
+BOOST_FIXTURE_TEST_CASE(unlink_pruned_files, TestChain100Setup)
+{
+    // Stand-ins for pruned block files, behind the ones in use
+    const std::set<int> files{5, 6};
+    for (const int n_file : files) {
+        FILE* file{fsbridge::fopen(node::GetBlockPosFilename(FlatFilePos{n_file, 0}), "wb")};
+        BOOST_REQUIRE(file);
+        BOOST_REQUIRE(fputs("pruned", file) >= 0);
+        fclose(file);
+    }
+
+    node::BlockManager& blockman{m_node.chainman->m_blockman};
+    blockman.QueueUnlinkPrunedFiles(files);
+    blockman.WaitForUnlinks();
+    for (const int n_file : files) {
+        BOOST_CHECK(!fs::exists(node::GetBlockPosFilename(FlatFilePos{n_file, 0})));
+    }
+    // The files in use are kept, and queueing nothing does not block
+    BOOST_CHECK(fs::exists(node::GetBlockPosFilename(FlatFilePos{0, 0})));
+    blockman.QueueUnlinkPrunedFiles({});
+    blockman.WaitForUnlinks();
+}
+
+BOOST_FIXTURE_TEST_CASE(cached_median_time_past, TestChain100Setup)
+{
+    LOCK(::cs_main);
+    for (const CBlockIndex* pindex{m_node.chainman->ActiveChain().Tip()}; pindex; pindex = pindex->pprev) {
+        BOOST_CHECK(pindex->nMedianTimePast != 0);
+        BOOST_CHECK_EQUAL(pindex->GetMedianTimePast(), pindex->ComputeMedianTimePast());
+    }
+
+    // Entries that are not in a block index compute it
+    CBlockIndex index;
+    index.pprev = m_node.chainman->ActiveChain().Tip();
+    index.nTime = index.pprev->nTime + 1;
+    BOOST_CHECK_EQUAL(index.GetMedianTimePast(), index.ComputeMedianTimePast());
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,77 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/blockmap.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <utility>
+#include <vector>
+
+using node::BlockMap;
+
+BOOST_FIXTURE_TEST_SUITE(blockmap_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(blockmap_insert_find)
+{
+    BlockMap map;
+    BOOST_CHECK(map.empty());
+    BOOST_CHECK(map.begin() == map.end());
+
+    // Enough entries for several chunks and lookup table resizes
+    std::vector<uint256> hashes;
+    std::vector<CBlockIndex*> indices;
+    for (int i = 0; i < 10000; ++i) {
+        hashes.push_back(InsecureRand256());
+        const auto [it, inserted]{map.try_emplace(hashes.back())};
+        BOOST_CHECK(inserted);
+        it->second.nHeight = i;
+        indices.push_back(&it->second);
+    }
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+
+    for (size_t i = 0; i < hashes.size(); ++i) {
+        // Entries keep their address as the map grows
+        const auto it{map.find(hashes[i])};
+        BOOST_REQUIRE(it != map.end());
+        BOOST_CHECK(it->first == hashes[i]);
+        BOOST_CHECK_EQUAL(&it->second, indices[i]);
+        BOOST_CHECK_EQUAL(map.count(hashes[i]), 1U);
+
+        const auto [existing, inserted]{map.try_emplace(hashes[i])};
+        BOOST_CHECK(!inserted);
+        BOOST_CHECK_EQUAL(&existing->second, indices[i]);
+        BOOST_CHECK_EQUAL(&map[hashes[i]], indices[i]);
+    }
+    BOOST_CHECK_EQUAL(map.size(), hashes.size());
+
+    const uint256 missing{InsecureRand256()};
+    BOOST_CHECK(map.find(missing) == map.end());
+    BOOST_CHECK(std::as_const(map).find(missing) == map.end());
+    BOOST_CHECK_EQUAL(map.count(missing), 0U);
+
+    // Iteration is in insertion order
+    int height{0};
+    for (const auto& [hash, index] : std::as_const(map)) {
+        BOOST_CHECK(hash == hashes[height]);
+        BOOST_CHECK_EQUAL(index.nHeight, height);
+        ++height;
+    }
+    BOOST_CHECK_EQUAL(height, 10000);
+    BOOST_CHECK(map.DynamicMemoryUsage() >= map.size() * sizeof(BlockMap::value_type));
+}
+
+BOOST_AUTO_TEST_CASE(blockmap_construct)
+{
+    BlockMap map;
+    CBlockHeader header;
+    header.nTime = 1234;
+    const auto [it, inserted]{map.try_emplace(header.GetHash(), header)};
+    BOOST_CHECK(inserted);
+    BOOST_CHECK_EQUAL(it->second.nTime, 1234U);
+    BOOST_CHECK(it->second.pprev == nullptr);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
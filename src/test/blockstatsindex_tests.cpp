@@ -0,0 +1,88 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chainparams.h>
+#include <consensus/amount.h>
+#include <index/blockstatsindex.h>
+#include <interfaces/chain.h>
+#include <node/blockstorage.h>
+#include <primitives/block.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <undo.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+BOOST_AUTO_TEST_SUITE(blockstatsindex_tests)
+
+static void IndexWaitSynced(BaseIndex& index)
+{
+    // Allow the BlockStatsIndex to catch up with the block index that is syncing
+    // in a background thread.
+    const auto timeout = GetTime<std::chrono::seconds>() + 120s;
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(timeout > GetTime<std::chrono::milliseconds>());
+        UninterruptibleSleep(100ms);
+    }
+}
+
+static void CheckStatsMatchBlock(const BlockStatsIndex& index, const CBlockIndex& block_index)
+{
+    CBlock block;
+    CBlockUndo block_undo;
+    BOOST_REQUIRE(node::ReadBlockFromDisk(block, &block_index, Params().GetConsensus()));
+    if (block_index.nHeight > 0) BOOST_REQUIRE(node::UndoReadFromDisk(block_undo, &block_index));
+    const std::optional<BlockStats> expected{ComputeBlockStats(block, block_undo)};
+    const std::optional<BlockStats> indexed{index.LookUpStats(block_index)};
+    BOOST_REQUIRE(expected && indexed);
+    // The serialization covers every field
+    BOOST_CHECK(SerializeHash(*expected) == SerializeHash(*indexed));
+}
+
+BOOST_FIXTURE_TEST_CASE(blockstatsindex_lookup, TestChain100Setup)
+{
+    const CScript coinbase_script{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const CScript dest_script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+
+    // A block with a fee paying transaction before the index is started, so the initial sync finds it
+    const CMutableTransaction first_spend{CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, dest_script, 1 * COIN, /*submit=*/false)};
+    CreateAndProcessBlock({first_spend}, coinbase_script);
+
+    BlockStatsIndex index{interfaces::MakeChain(m_node), 1 << 20, true};
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+    BOOST_CHECK(!index.LookUpStats(*tip));
+    BOOST_REQUIRE(index.Start());
+    IndexWaitSynced(index);
+
+    const std::optional<BlockStats> stats{index.LookUpStats(*tip)};
+    BOOST_REQUIRE(stats);
+    BOOST_CHECK_EQUAL(stats->txs, 2);
+    BOOST_CHECK_EQUAL(stats->ins, 1);
+    BOOST_CHECK_EQUAL(stats->totalfee, m_coinbase_txns[0]->vout[0].nValue - 1 * COIN);
+    BOOST_CHECK_EQUAL(stats->minfee, stats->totalfee);
+    BOOST_CHECK_EQUAL(stats->total_out, 1 * COIN);
+    CheckStatsMatchBlock(index, *tip);
+    CheckStatsMatchBlock(index, *WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Genesis()));
+
+    // Blocks connected after the initial sync are indexed as well
+    const CBlock block{CreateAndProcessBlock({}, coinbase_script)};
+    BOOST_REQUIRE(index.BlockUntilSyncedToCurrentChain());
+    tip = WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip());
+    BOOST_REQUIRE_EQUAL(tip->GetBlockHash(), block.GetHash());
+    const std::optional<BlockStats> empty_stats{index.LookUpStats(*tip)};
+    BOOST_REQUIRE(empty_stats);
+    BOOST_CHECK_EQUAL(empty_stats->txs, 1);
+    BOOST_CHECK_EQUAL(empty_stats->totalfee, 0);
+    BOOST_CHECK_EQUAL(empty_stats->minfee, 0);
+    CheckStatsMatchBlock(index, *tip);
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,67 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/miner.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <txmempool.h>
+#include <validation.h>
+
+#include <set>
+
+#include <boost/test/unit_test.hpp>
+
+using node::BlockAssembler;
+using node::CBlockTemplate;
+
+namespace {
+std::set<uint256> TemplateTxids(const CBlockTemplate& tmpl)
+{
+    std::set<uint256> txids;
+    for (size_t i = 1; i < tmpl.block.vtx.size(); ++i) txids.insert(tmpl.block.vtx[i]->GetHash());
+    return txids;
+}
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(blocktemplate_tests, TestChain100Setup)
+
+BOOST_AUTO_TEST_CASE(incremental_template)
+{
+    const CScript script{GetScriptForRawPubKey(coinbaseKey.GetPubKey())};
+    auto create = [&](const CBlockTemplate* previous) {
+        return BlockAssembler{m_node.chainman->ActiveChainstate(), m_node.mempool.get()}.CreateNewBlock(script, previous);
+    };
+
+    const CTransactionRef parent{MakeTransactionRef(CreateValidMempoolTransaction(
+        m_coinbase_txns[0], /*input_vout=*/0, /*input_height=*/1, coinbaseKey, script, /*output_amount=*/10 * COIN))};
+    const auto first{create(nullptr)};
+    BOOST_CHECK(first->m_all_packages_selected);
+    BOOST_REQUIRE_EQUAL(first->block.vtx.size(), 2U);
+    BOOST_CHECK(*first->block.vtx[1] == *parent);
+
+    // A new child is appended to the previous selection
+    const CTransactionRef child{MakeTransactionRef(CreateValidMempoolTransaction(
+        parent, /*input_vout=*/0, /*input_height=*/101, coinbaseKey, script, /*output_amount=*/9 * COIN))};
+    const auto updated{create(first.get())};
+    BOOST_REQUIRE_EQUAL(updated->block.vtx.size(), 3U);
+    BOOST_CHECK(*updated->block.vtx[1] == *parent);
+    BOOST_CHECK(*updated->block.vtx[2] == *child);
+    BOOST_CHECK_EQUAL(updated->vTxFees[2], 1 * COIN);
+    BOOST_CHECK(TemplateTxids(*updated) == TemplateTxids(*create(nullptr)));
+
+    // Once a selected transaction leaves the mempool, the template is rebuilt
+    WITH_LOCK(m_node.mempool->cs, m_node.mempool->removeRecursive(*child, MemPoolRemovalReason::CONFLICT));
+    const auto rebuilt{create(updated.get())};
+    BOOST_REQUIRE_EQUAL(rebuilt->block.vtx.size(), 2U);
+    BOOST_CHECK(*rebuilt->block.vtx[1] == *parent);
+
+    // A template of a previous tip is not extended
+    CreateAndProcessBlock({}, script);
+    const auto next{create(rebuilt.get())};
+    BOOST_CHECK(next->block.hashPrevBlock != rebuilt->block.hashPrevBlock);
+    BOOST_CHECK(TemplateTxids(*next) == TemplateTxids(*create(nullptr)));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -53,9 +53,9 @@ public:
 
     uint256 GetBestBlock() const override { return hashBestBlock_; }
 
-    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock) override
+    bool BatchWrite(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase = true) override
     {
-        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); ) {
+        for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end(); it = erase ? mapCoins.erase(it) : std::next(it)) {
             if (it->second.flags & CCoinsCacheEntry::DIRTY) {
                 // Same optimization used in CCoinsViewDB is to only write dirty entries.
                 map_[it->first] = it->second.coin;
@@ -64,7 +64,6 @@ public:
                     map_.erase(it->first);
                 }
             }
-            mapCoins.erase(it++);
         }
         if (!hashBlock.IsNull())
             hashBestBlock_ = hashBlock;
@@ -80,7 +79,7 @@ public:
     void SelfTest() const
     {
         // Manually recompute the dynamic usage of the whole data, and compare it.
-        size_t ret = memusage::DynamicUsage(cacheCoins);
+        size_t ret = memusage::DynamicUsage(cacheCoins) - m_cache_coins_memory_resource.AvailableBytes();
         size_t count = 0;
         for (const auto& entry : cacheCoins) {
             ret += entry.second.coin.DynamicMemoryUsage();
@@ -216,7 +215,12 @@ void SimulationTest(CCoinsView* base, bool fake_best_block)
             if (stack.size() > 1 && InsecureRandBool() == 0) {
                 unsigned int flushIndex = InsecureRandRange(stack.size() - 1);
                 if (fake_best_block) stack[flushIndex]->SetBestBlock(InsecureRand256());
-                BOOST_CHECK(stack[flushIndex]->Flush());
+                if (InsecureRandBool()) {
+                    BOOST_CHECK(stack[flushIndex]->Flush());
+                } else {
+                    BOOST_CHECK(stack[flushIndex]->Sync());
+                    if (InsecureRandBool()) stack[flushIndex]->Trim(InsecureRandRange(stack[flushIndex]->DynamicMemoryUsage() + 1));
+                }
             }
         }
         if (InsecureRandRange(100) == 0) {
@@ -463,7 +467,7 @@ BOOST_AUTO_TEST_CASE(updatecoins_simulation_test)
             // Every 100 iterations, flush an intermediate cache
             if (stack.size() > 1 && InsecureRandBool() == 0) {
                 unsigned int flushIndex = InsecureRandRange(stack.size() - 1);
-                BOOST_CHECK(stack[flushIndex]->Flush());
+                BOOST_CHECK(InsecureRandBool() ? stack[flushIndex]->Flush() : stack[flushIndex]->Sync());
             }
         }
         if (InsecureRandRange(100) == 0) {
@@ -608,7 +612,8 @@ void GetCoinsMapEntry(const CCoinsMap& map, CAmount& value, char& flags)
 
 void WriteCoinsViewEntry(CCoinsView& view, CAmount value, char flags)
 {
-    CCoinsMap map;
+    CCoinsMapMemoryResource resource;
+    CCoinsMap map{0, CCoinsMap::hasher{}, CCoinsMap::key_equal{}, &resource};
     InsertCoinsMapEntry(map, value, flags);
     BOOST_CHECK(view.BatchWrite(map, {}));
 }
@@ -877,4 +882,93 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(ccoins_sync_trim)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache{&base};
+    std::vector<COutPoint> outpoints;
+    for (int i{0}; i < 100; ++i) {
+        outpoints.emplace_back(InsecureRand256(), 0);
+        Coin coin;
+        coin.out.nValue = i + 1;
+        coin.nHeight = 1;
+        cache.AddCoin(outpoints.back(), std::move(coin), /*possible_overwrite=*/false);
+    }
+    cache.SpendCoin(outpoints[0]);
+    cache.SetBestBlock(InsecureRand256());
+
+    // Sync writes the changes, removes the spent entry and keeps the others, unmodified
+    BOOST_CHECK(cache.Sync());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 99U);
+    for (const auto& [outpoint, entry] : cache.map()) {
+        BOOST_CHECK_EQUAL(entry.flags, 0);
+    }
+    Coin coin;
+    BOOST_CHECK(!base.GetCoin(outpoints[0], coin));
+    BOOST_CHECK(base.GetCoin(outpoints[1], coin));
+    BOOST_CHECK_EQUAL(coin.out.nValue, 2);
+    cache.SelfTest();
+
+    // Nothing is evicted while the cache is within the limit
+    cache.Trim(cache.DynamicMemoryUsage());
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 99U);
+
+    // All entries were used since they were added, so the first pass only
+    // clears their marks and the second evicts one
+    cache.Trim(cache.DynamicMemoryUsage() - 1);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 98U);
+    cache.SelfTest();
+
+    // Recently used entries are kept when others can be evicted instead
+    std::vector<COutPoint> used;
+    for (const COutPoint& outpoint : outpoints) {
+        if (used.size() == 10) break;
+        if (cache.map().count(outpoint)) {
+            BOOST_CHECK(!cache.AccessCoin(outpoint).IsSpent());
+            used.push_back(outpoint);
+        }
+    }
+    cache.Trim(cache.DynamicMemoryUsage() / 2);
+    BOOST_CHECK_LT(cache.GetCacheSize(), 98U);
+    BOOST_CHECK_GE(cache.GetCacheSize(), 10U);
+    for (const COutPoint& outpoint : used) {
+        BOOST_CHECK(cache.map().count(outpoint));
+    }
+    cache.SelfTest();
+
+    // Evicted coins are still in the base
+    BOOST_CHECK(cache.HaveCoin(outpoints[50]));
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoints[50]).out.nValue, 51);
+
+    cache.Trim(0);
+    BOOST_CHECK_EQUAL(cache.GetCacheSize(), 0U);
+    cache.SelfTest();
+}
+
+BOOST_AUTO_TEST_CASE(ccoins_emplace_fetched)
+{
+    CCoinsViewTest base;
+    CCoinsViewCacheTest cache{&base};
+    const COutPoint outpoint{InsecureRand256(), 0};
+    Coin coin;
+    coin.out.nValue = 1;
+    coin.nHeight = 1;
+
+    // A fetched coin is cached clean, and only counted once
+    cache.EmplaceFetchedCoin(COutPoint{outpoint}, Coin{coin});
+    BOOST_CHECK_EQUAL(cache.map().at(outpoint).flags, 0);
+    const size_t usage{cache.DynamicMemoryUsage()};
+    Coin other{coin};
+    other.out.nValue = 2;
+    cache.EmplaceFetchedCoin(COutPoint{outpoint}, std::move(other));
+    BOOST_CHECK_EQUAL(cache.AccessCoin(outpoint).out.nValue, 1);
+    BOOST_CHECK_EQUAL(cache.DynamicMemoryUsage(), usage);
+    cache.SelfTest();
+
+    // and not written to the base
+    cache.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(cache.Flush());
+    BOOST_CHECK(!base.HaveCoin(outpoint));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include <chrono>
+#include <vector>
 
 BOOST_AUTO_TEST_SUITE(coinstatsindex_tests)
 
@@ -82,6 +83,33 @@ BOOST_FIXTURE_TEST_CASE(coinstatsindex_initial_sync, TestChain100Setup)
     // Rest of shutdown sequence and destructors happen in ~TestingSetup()
 }
 
+BOOST_FIXTURE_TEST_CASE(coinstatsindex_parallel_sync, TestChain100Setup)
+{
+    const CBlockIndex* tip{WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip())};
+    const int default_threads{g_index_sync_threads};
+
+    // Blocks read ahead by worker threads give the same statistics as reading them one by one
+    std::vector<kernel::CCoinsStats> stats;
+    for (int threads : {0, 1, 3}) {
+        g_index_sync_threads = threads;
+        CoinStatsIndex index{interfaces::MakeChain(m_node), 1 << 20, true};
+        BOOST_REQUIRE(index.Start());
+        IndexWaitSynced(index);
+        const auto tip_stats{index.LookUpStats(*tip)};
+        BOOST_REQUIRE(tip_stats);
+        stats.push_back(*tip_stats);
+        index.Stop();
+    }
+    g_index_sync_threads = default_threads;
+
+    for (const kernel::CCoinsStats& sync_stats : stats) {
+        BOOST_CHECK_EQUAL(sync_stats.hashSerialized, stats.front().hashSerialized);
+        BOOST_CHECK_EQUAL(sync_stats.coins_count, stats.front().coins_count);
+        BOOST_CHECK_EQUAL(*sync_stats.total_amount, *stats.front().total_amount);
+        BOOST_CHECK_EQUAL(sync_stats.total_prevout_spent_amount, stats.front().total_prevout_spent_amount);
+    }
+}
+
 // Test shutdown between BlockConnected and ChainStateFlushed notifications,
 // make sure index is not corrupted and is able to reload.
 BOOST_FIXTURE_TEST_CASE(coinstatsindex_unclean_shutdown, TestChain100Setup)
@@ -3,7 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <compressor.h>
+#include <consensus/merkle.h>
+#include <primitives/block.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 
 #include <stdint.h>
@@ -134,4 +137,48 @@ BOOST_AUTO_TEST_CASE(compress_script_to_uncompressed_pubkey_id)
     BOOST_CHECK_EQUAL(out[0], 0x04 | (script[65] & 0x01)); // least significant bit (lsb) of last char of pubkey is mapped into out[0]
 }
 
+BOOST_AUTO_TEST_CASE(compressed_block_roundtrip)
+{
+    CBlock block;
+    block.nVersion = 4;
+    block.hashPrevBlock = InsecureRand256();
+    block.nBits = 0x1d00ffff;
+
+    CMutableTransaction coinbase;
+    coinbase.vin.emplace_back(COutPoint{});
+    coinbase.vin[0].scriptSig = CScript{} << 1 << OP_0;
+    coinbase.vin[0].scriptWitness.stack = {std::vector<unsigned char>(32, 0)};
+    coinbase.vout.emplace_back(50 * COIN, GetScriptForDestination(PKHash{uint160{}}));
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+
+    CMutableTransaction spend;
+    spend.nVersion = -1;
+    spend.nLockTime = 500000;
+    spend.vin.emplace_back(COutPoint{InsecureRand256(), 3}, CScript{} << OP_TRUE, 0xfffffffd);
+    spend.vin.emplace_back(COutPoint{InsecureRand256(), 0}, CScript{}, 0);
+    spend.vout.emplace_back(COIN, CScript{} << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(spend));
+
+    // Outputs TxOutCompression cannot restore exactly
+    spend.vout.emplace_back(MAX_MONEY + 1, CScript{} << OP_TRUE);
+    block.vtx.push_back(MakeTransactionRef(spend));
+    const std::vector<unsigned char> oversized(MAX_SCRIPT_SIZE + 1, OP_NOP);
+    spend.vout.back() = CTxOut{0, CScript(oversized.begin(), oversized.end())};
+    block.vtx.push_back(MakeTransactionRef(spend));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+
+    CDataStream compressed{SER_DISK, PROTOCOL_VERSION};
+    compressed << Using<CompressedBlockFormatter>(block);
+    BOOST_CHECK_LT(compressed.size(), ::GetSerializeSize(block, PROTOCOL_VERSION));
+
+    CBlock decompressed;
+    compressed >> Using<CompressedBlockFormatter>(decompressed);
+    BOOST_CHECK(compressed.empty());
+    BOOST_CHECK_EQUAL(decompressed.GetHash(), block.GetHash());
+    BOOST_REQUIRE_EQUAL(decompressed.vtx.size(), block.vtx.size());
+    for (size_t i = 0; i < block.vtx.size(); ++i) {
+        BOOST_CHECK_EQUAL(decompressed.vtx[i]->GetWitnessHash(), block.vtx[i]->GetWitnessHash());
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -8,6 +8,9 @@
 #include <crypto/hkdf_sha256_32.h>
 #include <crypto/hmac_sha256.h>
 #include <crypto/hmac_sha512.h>
+#include <crypto/neoscrypt.h>
+#include <crypto/neoscrypt_context.h>
+#include <crypto/neoscrypt_multiway.h>
 #include <crypto/poly1305.h>
 #include <crypto/ripemd160.h>
 #include <crypto/sha1.h>
@@ -295,6 +298,18 @@ BOOST_AUTO_TEST_CASE(sha512_testvectors) {
                "37de8c3ef5459d76a52cedc02dc499a3c9ed9dedbfb3281afd9653b8a112fafc");
 }
 
+BOOST_AUTO_TEST_CASE(sha512_iterate64_tests)
+{
+    for (uint64_t count : {0, 1, 2, 100, 1000}) {
+        unsigned char expected[CSHA512::OUTPUT_SIZE], hash[CSHA512::OUTPUT_SIZE];
+        for (unsigned char& c : expected) c = InsecureRandBits(8);
+        memcpy(hash, expected, sizeof(hash));
+        for (uint64_t i = 0; i < count; ++i) CSHA512().Write(expected, sizeof(expected)).Finalize(expected);
+        SHA512Iterate64(hash, count);
+        BOOST_CHECK_EQUAL(HexStr(hash), HexStr(expected));
+    }
+}
+
 BOOST_AUTO_TEST_CASE(hmac_sha256_testvectors) {
     // test cases 1, 2, 3, 4, 6 and 7 of RFC 4231
     TestHMACSHA256("0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b0b",
@@ -753,6 +768,70 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+BOOST_AUTO_TEST_CASE(sha256d_many)
+{
+    // Lengths around the padding boundaries, and more messages than lanes
+    std::vector<std::vector<unsigned char>> msgs;
+    for (size_t len : {0, 1, 31, 32, 55, 56, 63, 64, 65, 119, 120, 127, 128, 1000}) {
+        msgs.push_back(g_insecure_rand_ctx.randbytes(len));
+    }
+    for (int i = 0; i < 20; ++i) {
+        msgs.push_back(g_insecure_rand_ctx.randbytes(InsecureRandRange(600)));
+    }
+    for (size_t count = 0; count <= msgs.size(); ++count) {
+        std::vector<const unsigned char*> inputs;
+        std::vector<size_t> lengths;
+        std::vector<unsigned char> out1(32 * count), out2(32 * count);
+        for (size_t i = 0; i < count; ++i) {
+            inputs.push_back(msgs[i].data());
+            lengths.push_back(msgs[i].size());
+            CHash256().Write(msgs[i]).Finalize({out1.data() + 32 * i, 32});
+        }
+        SHA256DMany(out2.data(), inputs.data(), lengths.data(), count);
+        BOOST_CHECK(out1 == out2);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(neoscrypt_many)
+{
+    for (int i = 0; i <= 17; ++i) {
+        unsigned char in[80 * 17];
+        unsigned char out1[32 * 17], out2[32 * 17];
+        for (int j = 0; j < 80 * i; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        for (int j = 0; j < i; ++j) {
+            neoscrypt(in + 80 * j, out1 + 32 * j, 0);
+        }
+        NeoScryptMany(out2, in, i);
+        BOOST_CHECK(memcmp(out1, out2, 32 * i) == 0);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(neoscrypt_context)
+{
+    NeoScryptContext context;
+    BOOST_CHECK_EQUAL(context.Size(), 0U);
+    // default, SSE2 assembly and scrypt profiles
+    for (const unsigned int profile : {0x0U, 0x1000U, 0x1U}) {
+        unsigned char in[80];
+        unsigned char out1[32], out2[32];
+        for (int j = 0; j < 80; ++j) {
+            in[j] = InsecureRandBits(8);
+        }
+        neoscrypt(in, out1, profile);
+        context.Hash(in, out2, profile);
+        BOOST_CHECK(memcmp(out1, out2, 32) == 0);
+        BOOST_CHECK(context.Size() >= neoscrypt_scratch_size(profile));
+    }
+    // the scratch space is kept for the largest profile
+    const size_t size{context.Size()};
+    BOOST_CHECK_EQUAL(size, neoscrypt_scratch_size(0x1));
+    unsigned char in[80] = {0}, out[32];
+    context.Hash(in, out, 0);
+    BOOST_CHECK_EQUAL(context.Size(), size);
+}
+
 static void TestSHA3_256(const std::string& input, const std::string& output)
 {
     const auto in_bytes = ParseHex(input);
@@ -368,4 +368,46 @@ BOOST_AUTO_TEST_CASE(cuckoocache_generations)
     test_cache_generations<CuckooCache::cache<uint256, SignatureCacheHasher>>();
 }
 
+/** Test that resize keeps the elements that are not erased, and that insert reports evictions */
+BOOST_AUTO_TEST_CASE(cuckoocache_resize)
+{
+    SeedInsecureRand(SeedRand::ZEROS);
+    CuckooCache::cache<uint256, SignatureCacheHasher> cc{};
+    BOOST_CHECK_EQUAL(cc.setup(1024), 1024U);
+    BOOST_CHECK_EQUAL(cc.capacity(), 1024U);
+
+    std::vector<uint256> hashes(512);
+    for (uint256& hash : hashes) {
+        hash = InsecureRand256();
+        cc.insert(hash);
+    }
+    // Half full, so nothing is missing, and inserting again evicts nothing
+    for (const uint256& hash : hashes) BOOST_CHECK(cc.contains(hash, false));
+    BOOST_CHECK(!cc.insert(hashes[0]));
+    // Erase the first half
+    for (size_t i = 0; i < 256; ++i) BOOST_CHECK(cc.contains(hashes[i], true));
+
+    BOOST_CHECK_EQUAL(cc.resize(4096), 4096U);
+    BOOST_CHECK_EQUAL(cc.capacity(), 4096U);
+    for (size_t i = 0; i < 256; ++i) BOOST_CHECK(!cc.contains(hashes[i], false));
+    for (size_t i = 256; i < hashes.size(); ++i) BOOST_CHECK(cc.contains(hashes[i], false));
+
+    // Overfilling the cache has to evict elements
+    size_t evictions{0};
+    for (int i = 0; i < 8192; ++i) evictions += cc.insert(InsecureRand256());
+    BOOST_CHECK_GT(evictions, 0U);
+
+    CuckooCache::Counters counters;
+    counters.Lookup(true);
+    counters.Lookup(false);
+    counters.Lookup(false);
+    counters.Insert(true);
+    const CuckooCache::Stats stats{counters.Get(cc.capacity())};
+    BOOST_CHECK_EQUAL(stats.hits, 1U);
+    BOOST_CHECK_EQUAL(stats.misses, 2U);
+    BOOST_CHECK_EQUAL(stats.inserts, 1U);
+    BOOST_CHECK_EQUAL(stats.evictions, 1U);
+    BOOST_CHECK_EQUAL(stats.capacity, 4096U);
+}
+
 BOOST_AUTO_TEST_SUITE_END();
@@ -5,8 +5,15 @@
 #include <dbwrapper.h>
 #include <test/util/setup_common.h>
 #include <uint256.h>
+#include <util/system.h>
+#include <util/translation.h>
 
+#include <cstdint>
 #include <memory>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
 
 #include <boost/test/unit_test.hpp>
 
@@ -198,6 +205,120 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
     }
 }
 
+BOOST_AUTO_TEST_CASE(dbwrapper_read_many)
+{
+    // Perform tests both obfuscated and non-obfuscated.
+    for (const bool obfuscate : {false, true}) {
+        fs::path ph = m_args.GetDataDirBase() / (obfuscate ? "dbwrapper_read_many_obfuscate_true" : "dbwrapper_read_many_obfuscate_false");
+        CDBWrapper dbw(ph, (1 << 20), true, false, obfuscate);
+
+        // Every other key exists; ask for them in an order unrelated to the key order
+        std::vector<std::pair<uint8_t, uint32_t>> keys;
+        for (uint32_t i = 0; i < 200; ++i) {
+            keys.emplace_back('m', (i * 37) % 200);
+            if (keys.back().second % 2 == 0) BOOST_CHECK(dbw.Write(keys.back(), uint256{uint8_t(keys.back().second)}));
+        }
+        // A key that is asked for twice, and one with a value of another type
+        keys.emplace_back('m', 2);
+        BOOST_CHECK(dbw.Write(std::make_pair(uint8_t{'m'}, uint32_t{1000}), uint8_t{1}));
+        keys.emplace_back('m', 1000);
+
+        std::vector<std::optional<uint256>> values;
+        BOOST_CHECK_EQUAL(dbw.ReadMany(keys, values), 101U);
+        BOOST_REQUIRE_EQUAL(values.size(), keys.size());
+        for (size_t i = 0; i + 1 < keys.size(); ++i) {
+            if (keys[i].second % 2 == 0) {
+                BOOST_REQUIRE(values[i]);
+                BOOST_CHECK(*values[i] == uint256{uint8_t(keys[i].second)});
+            } else {
+                BOOST_CHECK(!values[i]);
+            }
+        }
+        BOOST_CHECK(!values.back());
+
+        // No keys give no values
+        BOOST_CHECK_EQUAL(dbw.ReadMany(std::vector<uint8_t>{}, values), 0U);
+        BOOST_CHECK(values.empty());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_options)
+{
+    ArgsManager args;
+    args.AddArg("-leveldboption", "", ArgsManager::ALLOW_ANY, OptionsCategory::OPTIONS);
+    const auto set_options{[&](std::vector<std::string> values) {
+        std::vector<const char*> argv{"ignored"};
+        for (const std::string& value : values) argv.push_back(value.c_str());
+        std::string error;
+        BOOST_REQUIRE(args.ParseParameters(argv.size(), argv.data(), error));
+    }};
+    bilingual_str error;
+
+    set_options({"-leveldboption=chainstate.bloom_bits=0", "-leveldboption=chainstate.block_size=16384",
+                 "-leveldboption=txindex.compression=1", "-leveldboption=chainstate.block_size=8192"});
+    BOOST_CHECK(CheckDBOptions(args, error));
+    const DBOptions chainstate{GetDBOptions(args, "chainstate")};
+    BOOST_CHECK_EQUAL(chainstate.bloom_bits, 0);
+    // The last setting wins
+    BOOST_CHECK_EQUAL(chainstate.block_size, 8192U);
+    BOOST_CHECK(!chainstate.compression);
+    BOOST_CHECK(GetDBOptions(args, "txindex").compression);
+    BOOST_CHECK_EQUAL(GetDBOptions(args, "blockindex").block_size, DBOptions{}.block_size);
+
+    for (const char* invalid : {"chainstate", "chainstate.bloom_bits", "chainstate=1", "wallet.block_size=1",
+                                       "chainstate.cache_size=1", "chainstate.block_size=0", "chainstate.compression=2",
+                                       "chainstate.max_file_size=-1", "chainstate.bloom_bits=x"}) {
+        set_options({std::string{"-leveldboption="} + invalid});
+        BOOST_CHECK_MESSAGE(!CheckDBOptions(args, error), invalid);
+    }
+
+    // The options are applied and reported with the statistics
+    fs::path ph = m_args.GetDataDirBase() / "dbwrapper_options";
+    CDBWrapper dbw(ph, (1 << 20), true, false, false, chainstate);
+    for (uint32_t i = 0; i < 1000; ++i) {
+        BOOST_CHECK(dbw.Write(i, InsecureRand256()));
+    }
+    const DBStats stats{dbw.GetStats()};
+    BOOST_CHECK_EQUAL(stats.options.block_size, 8192U);
+    BOOST_CHECK_EQUAL(stats.options.bloom_bits, 0);
+    BOOST_CHECK_EQUAL(stats.options.write_buffer_size, (1U << 20) / 4);
+    BOOST_CHECK_EQUAL(stats.block_cache_capacity, (1U << 20) / 2);
+    BOOST_CHECK_GT(stats.memory_usage, 0U);
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_compactions)
+{
+    DBOptions options;
+    // Small memory tables, so that writes need the background work often
+    options.write_buffer_size = 64 * 1024;
+    fs::path ph = m_args.GetDataDirBase() / "dbwrapper_compactions";
+    CDBWrapper dbw(ph, (1 << 20), true, false, false, options);
+    const auto key{[](uint32_t i) { return std::make_pair(std::make_pair(uint8_t('a' + i % 3), uint8_t(i % 2)), i); }};
+    {
+        // Writes do not wait for the end of a pause
+        const CDBWrapper::CompactionPause pause{dbw};
+        BOOST_CHECK(dbw.GetStats().compactions_paused);
+        for (uint32_t i = 0; i < 3000; ++i) {
+            BOOST_CHECK(dbw.Write(key(i), InsecureRand256()));
+        }
+    }
+    BOOST_CHECK(!dbw.GetStats().compactions_paused);
+
+    // Each of the six two-byte key prefixes is compacted on its own
+    BOOST_CHECK(!dbw.GetStats().idle_compaction_done);
+    int calls{1};
+    while (dbw.CompactNextRange()) ++calls;
+    // The last call finds no keys left
+    BOOST_CHECK_EQUAL(calls, 7);
+    const DBStats stats{dbw.GetStats()};
+    BOOST_CHECK_EQUAL(stats.idle_compacted_ranges, 6U);
+    BOOST_CHECK(stats.idle_compaction_done);
+    BOOST_CHECK(!dbw.CompactNextRange());
+    for (uint32_t i = 0; i < 3000; ++i) {
+        BOOST_CHECK(dbw.Exists(key(i)));
+    }
+}
+
 // Test that we do not obfuscation if there is existing data.
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
@@ -533,4 +533,38 @@ BOOST_AUTO_TEST_CASE(descriptor_test)
     Check("sh(wsh(thresh(1,pkh(L4gM1FBdyHNpkzsFh9ipnofLhpZRp2mwobpeULy1a6dBTvw8Ywtd),a:and_n(multi(1,xprvA1RpRA33e1JQ7ifknakTFpgNXPmW2YvmhqLQYMmrj4xJXXWYpDPS3xz7iAxn8L39njGVyuoseXzU6rcxFLJ8HFsTjSyQbLYnMpCqE2VbFWc,xprv9uPDJpEQgRQfDcW7BkF7eTya6RPxXeJCqCJGHuCJ4GiRVLzkTXBAJMu2qaMWPrS7AANYqdq6vcBcBUdJCVVFceUvJFjaPdGZ2y9WACViL4L/0),n:older(2)))))", "sh(wsh(thresh(1,pkh(03cdabb7f2dce7bfbd8a0b9570c6fd1e712e5d64045e9d6b517b3d5072251dc204),a:and_n(multi(1,xpub6ERApfZwUNrhLCkDtcHTcxd75RbzS1ed54G1LkBUHQVHQKqhMkhgbmJbZRkrgZw4koxb5JaHWkY4ALHY2grBGRjaDMzQLcgJvLJuZZvRcEL,xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y/0),n:older(2)))))", "sh(wsh(thresh(1,pkh(03cdabb7f2dce7bfbd8a0b9570c6fd1e712e5d64045e9d6b517b3d5072251dc204),a:and_n(multi(1,xpub6ERApfZwUNrhLCkDtcHTcxd75RbzS1ed54G1LkBUHQVHQKqhMkhgbmJbZRkrgZw4koxb5JaHWkY4ALHY2grBGRjaDMzQLcgJvLJuZZvRcEL,xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y/0),n:older(2)))))", UNSOLVABLE | MIXED_PUBKEYS, {{"a914767e9119ff3b3ac0cb6dcfe21de1842ccf85f1c487"}}, OutputType::P2SH_SEGWIT, {{},{0}});
 }
 
+BOOST_AUTO_TEST_CASE(descriptor_expand_range)
+{
+    // Derivations both unhardened, served from the cache, and hardened, which need the private key
+    for (const std::string desc_str : {"wpkh(xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y/1/*)",
+                                       "sh(wpkh(xprv9uPDJpEQgRQfDcW7BkF7eTya6RPxXeJCqCJGHuCJ4GiRVLzkTXBAJMu2qaMWPrS7AANYqdq6vcBcBUdJCVVFceUvJFjaPdGZ2y9WACViL4L/0/*'))"}) {
+        FlatSigningProvider keys;
+        std::string error;
+        const auto desc{Parse(desc_str, keys, error)};
+        BOOST_REQUIRE(desc);
+
+        for (const int num_threads : {1, 4}) {
+            DescriptorCache cache;
+            std::vector<std::vector<CScript>> range_scripts;
+            BOOST_REQUIRE(ExpandRange(*desc, 10, 1033, keys, cache, range_scripts, num_threads));
+            BOOST_REQUIRE_EQUAL(range_scripts.size(), 1024U);
+            for (size_t i = 0; i < range_scripts.size(); ++i) {
+                FlatSigningProvider out;
+                std::vector<CScript> scripts;
+                BOOST_REQUIRE(desc->Expand(10 + i, keys, scripts, out));
+                BOOST_CHECK(range_scripts[i] == scripts);
+            }
+        }
+    }
+
+    // Hardened derivations fail without the private key
+    FlatSigningProvider keys;
+    std::string error;
+    const auto desc{Parse("wpkh(xpub68NZiKmJWnxxS6aaHmn81bvJeTESw724CRDs6HbuccFQN9Ku14VQrADWgqbhhTHBaohPX4CjNLf9fq9MYo6oDaPPLPxSb7gwQN3ih19Zm4Y/*')", keys, error)};
+    BOOST_REQUIRE(desc);
+    DescriptorCache cache;
+    std::vector<std::vector<CScript>> range_scripts;
+    BOOST_CHECK(!ExpandRange(*desc, 0, 2, keys, cache, range_scripts, 1));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -44,6 +44,8 @@ FUZZ_TARGET(asmap_direct)
         }
         // No address input should trigger assertions in interpreter
         std::vector<bool> addr(buffer.begin() + sep_pos + 1, buffer.end());
-        (void)Interpret(asmap, addr);
+        const uint32_t asn{Interpret(asmap, addr)};
+        // The compiled asmap must agree with the interpreter
+        assert(CompiledAsmap{asmap}.Interpret(addr) == asn);
     }
 }
@@ -2,11 +2,14 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <hash.h>
 #include <pubkey.h>
 #include <script/interpreter.h>
 #include <test/fuzz/FuzzedDataProvider.h>
 #include <test/fuzz/fuzz.h>
+#include <test/fuzz/util.h>
 
+#include <cassert>
 #include <limits>
 
 void initialize_eval_script()
@@ -34,3 +37,49 @@ FUZZ_TARGET_INIT(eval_script, initialize_eval_script)
         (void)EvalScript(stack, script, flags, BaseSignatureChecker(), sig_version, nullptr);
     }
 }
+
+namespace {
+/** Signature checker whose results depend on the signature and public key, but not on the script code. */
+class ScriptCodeAgnosticChecker : public BaseSignatureChecker
+{
+public:
+    bool CheckECDSASignature(const std::vector<unsigned char>& sig, const std::vector<unsigned char>& pubkey, const CScript& script_code, SigVersion sigversion) const override
+    {
+        return !sig.empty() && ((sig.back() ^ pubkey.size()) & 1);
+    }
+};
+} // namespace
+
+FUZZ_TARGET_INIT(eval_script_pubkeyhash, initialize_eval_script)
+{
+    FuzzedDataProvider fuzzed_data_provider(buffer.data(), buffer.size());
+    const unsigned int flags = fuzzed_data_provider.ConsumeIntegral<unsigned int>();
+    const SigVersion sig_version = fuzzed_data_provider.PickValueInArray({SigVersion::BASE, SigVersion::WITNESS_V0});
+    std::vector<std::vector<unsigned char>> stack;
+    // A small stack, or one at the stack size limit
+    const size_t stack_size = fuzzed_data_provider.ConsumeBool() ?
+                                  fuzzed_data_provider.ConsumeIntegralInRange<size_t>(0, 3) :
+                                  fuzzed_data_provider.ConsumeIntegralInRange<size_t>(MAX_STACK_SIZE - 2, MAX_STACK_SIZE);
+    for (size_t i = 0; i < stack_size; ++i) {
+        stack.push_back(ConsumeRandomLengthByteVector(fuzzed_data_provider, 80));
+    }
+    // Mostly the hash of the key on the stack, for OP_CHECKSIG to be reached
+    std::vector<unsigned char> keyhash = fuzzed_data_provider.ConsumeBytes<unsigned char>(20);
+    if (!stack.empty() && fuzzed_data_provider.ConsumeBool()) keyhash = ToByteVector(Hash160(stack.back()));
+    keyhash.resize(20);
+    const CScript script = CScript() << OP_DUP << OP_HASH160 << keyhash << OP_EQUALVERIFY << OP_CHECKSIG;
+
+    // A leading OP_NOP makes the same script run through the generic interpreter loop. It only
+    // changes the script code, which the checker ignores.
+    CScript generic_script = CScript() << OP_NOP;
+    generic_script.insert(generic_script.end(), script.begin(), script.end());
+
+    const ScriptCodeAgnosticChecker checker;
+    std::vector<std::vector<unsigned char>> generic_stack{stack};
+    ScriptError serror, generic_serror;
+    const bool success = EvalScript(stack, script, flags, checker, sig_version, &serror);
+    const bool generic_success = EvalScript(generic_stack, generic_script, flags, checker, sig_version, &generic_serror);
+    assert(success == generic_success);
+    assert(serror == generic_serror);
+    assert(stack == generic_stack);
+}
@@ -15,6 +15,7 @@
 #include <cassert>
 #include <cstdint>
 #include <iosfwd>
+#include <optional>
 #include <unordered_set>
 #include <vector>
 
@@ -78,6 +79,25 @@ FUZZ_TARGET(golomb_rice)
 
     assert(encoded_deltas == decoded_deltas);
 
+    {
+        // The word-at-a-time encoder and decoder agree with the bit stream ones
+        std::vector<uint8_t> word_data;
+        CVectorWriter stream(SER_NETWORK, 0, word_data, 0);
+        WriteCompactSize(stream, static_cast<uint32_t>(encoded_deltas.size()));
+        GolombRiceWriter writer(word_data);
+        for (const uint64_t delta : encoded_deltas) {
+            writer.Encode(BASIC_FILTER_P, delta);
+        }
+        writer.Flush();
+        assert(word_data == golomb_rice_data);
+
+        GolombRiceReader reader{Span{golomb_rice_data}.subspan(GetSizeOfCompactSize(encoded_deltas.size()))};
+        for (const uint64_t delta : encoded_deltas) {
+            assert(reader.Decode(BASIC_FILTER_P) == delta);
+        }
+        assert(reader.empty());
+    }
+
     {
         const std::vector<uint8_t> random_bytes = ConsumeRandomLengthByteVector(fuzzed_data_provider, 1024);
         SpanReader stream{SER_NETWORK, 0, random_bytes};
@@ -88,11 +108,19 @@ FUZZ_TARGET(golomb_rice)
             return;
         }
         BitStreamReader<SpanReader> bitreader{stream};
+        GolombRiceReader reader{Span{random_bytes}.subspan(random_bytes.size() - stream.size())};
         for (uint32_t i = 0; i < std::min<uint32_t>(n, 1024); ++i) {
+            std::optional<uint64_t> bit_value, word_value;
+            try {
+                bit_value = GolombRiceDecode(bitreader, BASIC_FILTER_P);
+            } catch (const std::ios_base::failure&) {
+            }
             try {
-                (void)GolombRiceDecode(bitreader, BASIC_FILTER_P);
+                word_value = reader.Decode(BASIC_FILTER_P);
             } catch (const std::ios_base::failure&) {
             }
+            assert(bit_value == word_value);
+            if (!bit_value) break;
         }
     }
 }
@@ -71,6 +71,7 @@ const std::vector<std::string> RPC_COMMANDS_NOT_SAFE_FOR_FUZZING{
     "addnode",        // avoid DNS lookups
     "addpeeraddress", // avoid DNS lookups
     "analyzepsbt",    // avoid signed integer overflow in CFeeRate::GetFee(unsigned long) (https://github.com/bitcoin/bitcoin/issues/20607)
+    "dumpheaders",    // avoid writing to disk
     "dumptxoutset",   // avoid writing to disk
     "dumpwallet", // avoid writing to disk
     "echoipc",              // avoid assertion failure (Assertion `"EnsureAnyNodeContext(request.context).init" && check' failed.)
@@ -101,12 +102,16 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "disconnectnode",
     "echo",
     "echojson",
+    "estimatefeecurve",
     "estimaterawfee",
     "estimatesmartfee",
     "finalizepsbt",
     "generate",
     "generateblock",
     "getaddednodeinfo",
+    "getaddressbalance",
+    "getaddresshistory",
+    "getaddressutxos",
     "getbestblockhash",
     "getblock",
     "getblockchaininfo",
@@ -120,27 +125,37 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "getchaintips",
     "getchaintxstats",
     "getconnectioncount",
+    "getdbstats",
     "getdeploymentinfo",
     "getdescriptorinfo",
     "getdifficulty",
     "getindexinfo",
+    "getlockstats",
     "getmemoryinfo",
+    "getmemoryusage",
     "getmempoolancestors",
+    "getmempooldelta",
     "getmempooldescendants",
     "getmempoolentry",
     "gettxspendingprevout",
     "getmempoolinfo",
+    "getmempoolusage",
     "getmininginfo",
     "getnettotals",
     "getnetworkhashps",
     "getnetworkinfo",
     "getnodeaddresses",
     "getpeerinfo",
+    "getpowcacheinfo",
     "getrawmempool",
     "getrawtransaction",
     "getrpcinfo",
+    "getscriptstats",
+    "getstartupinfo",
     "gettxout",
     "gettxoutsetinfo",
+    "getvalidationcacheinfo",
+    "getvalidationinterfaceinfo",
     "help",
     "invalidateblock",
     "joinpsbts",
@@ -151,8 +166,10 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "preciousblock",
     "pruneblockchain",
     "reconsiderblock",
+    "scanblocks",
     "scantxoutset",
     "sendrawtransaction",
+    "sendrawtransactions",
     "setmocktime",
     "setnetworkactive",
     "signmessagewithprivkey",
@@ -160,6 +177,7 @@ const std::vector<std::string> RPC_COMMANDS_SAFE_FOR_FUZZING{
     "submitblock",
     "submitheader",
     "submitpackage",
+    "submitsolution",
     "syncwithvalidationinterfacequeue",
     "testmempoolaccept",
     "uptime",
@@ -68,6 +68,13 @@ ssize_t FuzzedSock::Send(const void* data, size_t len, int flags) const
     return r;
 }
 
+ssize_t FuzzedSock::SendMany(Span<const Span<const unsigned char>> buffers, int flags) const
+{
+    // Exercise partial sends that stop within or at the end of the first buffer
+    if (buffers.empty()) return 0;
+    return Send(buffers[0].data(), buffers[0].size(), flags);
+}
+
 ssize_t FuzzedSock::Recv(void* buf, size_t len, int flags) const
 {
     // Have a permanent error at recv_errnos[0] because when the fuzzed data is exhausted
@@ -147,4 +147,17 @@ BOOST_AUTO_TEST_CASE(siphash)
     }
 }
 
+BOOST_AUTO_TEST_CASE(siphash13)
+{
+    // Test vectors computed with the reference implementation, built with
+    // cROUNDS=1 and dROUNDS=3, of the bytes 0x00...0x1f and 0x00...0x23
+    const uint256 val{uint256S("1f1e1d1c1b1a191817161514131211100f0e0d0c0b0a09080706050403020100")};
+    BOOST_CHECK_EQUAL(SipHash13Uint256(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, val), 0x81157b6c16a7b60dull);
+    BOOST_CHECK_EQUAL(SipHash13Uint256Extra(0x0706050403020100ULL, 0x0F0E0D0C0B0A0908ULL, val, 0x23222120), 0x2cf508d3ada26206ull);
+
+    // Fewer rounds, so a different hash than SipHash-2-4's
+    BOOST_CHECK(SipHash13Uint256(1, 2, val) != SipHashUint256(1, 2, val));
+    BOOST_CHECK(SipHash13Uint256Extra(1, 2, val, 0) != SipHash13Uint256(1, 2, val));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -75,15 +75,22 @@ BOOST_AUTO_TEST_CASE(headers_sync_state)
     const int target_blocks = 15000;
     arith_uint256 chain_work = target_blocks*2;
 
+    // Use commitments dense enough that the second chain is caught with
+    // overwhelming probability, whatever the chain's own parameters are.
+    const HeadersSyncParams sync_params{/*commitment_period=*/584, /*redownload_buffer_size=*/13959};
+
+    // Regtest requires every block after genesis to have the minimum difficulty
+    const uint32_t nbits{UintToArith256(Params().GetConsensus().powLimit).GetCompact()};
+
     // Generate headers for two different chains (using differing merkle roots
     // to ensure the headers are different).
     GenerateHeaders(first_chain, target_blocks-1, Params().GenesisBlock().GetHash(),
             Params().GenesisBlock().nVersion, Params().GenesisBlock().nTime,
-            ArithToUint256(0), Params().GenesisBlock().nBits);
+            ArithToUint256(0), nbits);
 
     GenerateHeaders(second_chain, target_blocks-2, Params().GenesisBlock().GetHash(),
             Params().GenesisBlock().nVersion, Params().GenesisBlock().nTime,
-            ArithToUint256(1), Params().GenesisBlock().nBits);
+            ArithToUint256(1), nbits);
 
     const CBlockIndex* chain_start = WITH_LOCK(::cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(Params().GenesisBlock().GetHash()));
     std::vector<CBlockHeader> headers_batch;
@@ -92,7 +99,7 @@ BOOST_AUTO_TEST_CASE(headers_sync_state)
     // initially and then the rest.
     headers_batch.insert(headers_batch.end(), std::next(first_chain.begin()), first_chain.end());
 
-    hss.reset(new HeadersSyncState(0, Params().GetConsensus(), chain_start, chain_work));
+    hss.reset(new HeadersSyncState(0, Params().GetConsensus(), sync_params, chain_start, chain_work));
     (void)hss->ProcessNextHeaders({first_chain.front()}, true);
     // Pretend the first header is still "full", so we don't abort.
     auto result = hss->ProcessNextHeaders(headers_batch, true);
@@ -109,7 +116,7 @@ BOOST_AUTO_TEST_CASE(headers_sync_state)
     BOOST_CHECK(hss->GetState() == HeadersSyncState::State::FINAL);
 
     // Now try again, this time feeding the first chain twice.
-    hss.reset(new HeadersSyncState(0, Params().GetConsensus(), chain_start, chain_work));
+    hss.reset(new HeadersSyncState(0, Params().GetConsensus(), sync_params, chain_start, chain_work));
     (void)hss->ProcessNextHeaders(first_chain, true);
     BOOST_CHECK(hss->GetState() == HeadersSyncState::State::REDOWNLOAD);
 
@@ -123,7 +130,7 @@ BOOST_AUTO_TEST_CASE(headers_sync_state)
 
     // Finally, verify that just trying to process the second chain would not
     // succeed (too little work)
-    hss.reset(new HeadersSyncState(0, Params().GetConsensus(), chain_start, chain_work));
+    hss.reset(new HeadersSyncState(0, Params().GetConsensus(), sync_params, chain_start, chain_work));
     BOOST_CHECK(hss->GetState() == HeadersSyncState::State::PRESYNC);
      // Pretend just the first message is "full", so we don't abort.
     (void)hss->ProcessNextHeaders({second_chain.front()}, true);
@@ -143,4 +150,47 @@ BOOST_AUTO_TEST_CASE(headers_sync_state)
     BOOST_CHECK(result.success);
 }
 
+BOOST_AUTO_TEST_CASE(headers_sync_params)
+{
+    // Signet has 10-minute blocks and keeps the parameters computed for Bitcoin
+    const auto signet_params{CreateChainParams(*m_node.args, CBaseChainParams::SIGNET)};
+    BOOST_CHECK_EQUAL(signet_params->HeadersSync().commitment_period, 584U);
+    BOOST_CHECK_EQUAL(signet_params->HeadersSync().redownload_buffer_size, 13959U);
+
+    // The 60-second chains get a longer period with the same number of
+    // commitments in the redownload buffer.
+    for (const auto& chain : {CBaseChainParams::MAIN, CBaseChainParams::TESTNET, CBaseChainParams::REGTEST}) {
+        const auto chain_params{CreateChainParams(*m_node.args, chain)};
+        BOOST_CHECK_EQUAL(chain_params->GetConsensus().nPowTargetSpacing, 60);
+        BOOST_CHECK_EQUAL(chain_params->HeadersSync().commitment_period, 1847U);
+        BOOST_CHECK_EQUAL(chain_params->HeadersSync().redownload_buffer_size, 44147U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(headers_sync_invalid_target)
+{
+    const uint32_t nbits{UintToArith256(Params().GetConsensus().powLimit).GetCompact()};
+    const CBlockIndex* chain_start = WITH_LOCK(::cs_main, return m_node.chainman->m_blockman.LookupBlockIndex(Params().GenesisBlock().GetHash()));
+
+    std::vector<CBlockHeader> headers;
+    GenerateHeaders(headers, 100, Params().GenesisBlock().GetHash(),
+            Params().GenesisBlock().nVersion, Params().GenesisBlock().nTime,
+            ArithToUint256(0), nbits);
+
+    HeadersSyncState hss(0, Params().GetConsensus(), Params().HeadersSync(), chain_start, /*minimum_required_work=*/1000);
+    BOOST_CHECK(hss.HasValidTargets(headers));
+
+    // A header with a target other than the required one is caught before
+    // any processing, and makes the sync fail.
+    std::vector<CBlockHeader> bad_headers{headers};
+    bad_headers[50].nBits = Params().GenesisBlock().nBits;
+    BOOST_CHECK(!hss.HasValidTargets(bad_headers));
+    // Headers that do not continue the sync are not judged.
+    BOOST_CHECK(hss.HasValidTargets({bad_headers.begin() + 50, bad_headers.end()}));
+
+    const auto result{hss.ProcessNextHeaders(bad_headers, true)};
+    BOOST_CHECK(!result.success);
+    BOOST_CHECK(hss.GetState() == HeadersSyncState::State::FINAL);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
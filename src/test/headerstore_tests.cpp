@@ -0,0 +1,125 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <hash.h>
+#include <node/headerstore.h>
+#include <powcache.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <deque>
+
+using node::HeaderStore;
+
+BOOST_FIXTURE_TEST_SUITE(headerstore_tests, BasicTestingSetup)
+
+/** A chain of block index entries that own their hashes, built from arbitrary headers. */
+struct TestChain {
+    std::deque<uint256> hashes;
+    std::deque<CBlockIndex> entries;
+
+    /** Append count headers after prev, or start a chain at height 0 if prev is nullptr. */
+    CBlockIndex* Extend(CBlockIndex* prev, int count, uint32_t nonce)
+    {
+        for (int i = 0; i < count; ++i) {
+            CBlockHeader header;
+            header.nVersion = 1;
+            header.hashPrevBlock = prev ? prev->GetBlockHash() : uint256{};
+            header.nTime = 1600000000 + (prev ? prev->nHeight + 1 : 0);
+            header.nBits = 0x207fffff;
+            header.nNonce = nonce + i;
+            CBlockIndex& entry{entries.emplace_back(header)};
+            entry.phashBlock = &hashes.emplace_back(header.GetHash());
+            entry.pprev = prev;
+            entry.nHeight = prev ? prev->nHeight + 1 : 0;
+            prev = &entry;
+        }
+        return prev;
+    }
+};
+
+static void CheckRecords(const HeaderStore& store, const CBlockIndex& tip)
+{
+    BOOST_REQUIRE_EQUAL(store.Size(), tip.nHeight + 1);
+    std::vector<unsigned char> records;
+    BOOST_REQUIRE_EQUAL(store.Read(0, tip.nHeight + 1, records), size_t(tip.nHeight + 1));
+    for (const CBlockIndex* pindex = &tip; pindex; pindex = pindex->pprev) {
+        const auto stored{store.Get(pindex->nHeight)};
+        BOOST_REQUIRE(stored);
+        BOOST_CHECK_EQUAL(stored->first.GetHash(), pindex->GetBlockHash());
+        BOOST_CHECK_EQUAL(stored->second, GetPoWHashCached(pindex->GetBlockHeader()));
+        BOOST_CHECK(store.Contains(pindex->nHeight, pindex->GetBlockHash()));
+        const unsigned char* record{records.data() + pindex->nHeight * HeaderStore::RECORD_SIZE};
+        BOOST_CHECK_EQUAL(Hash(Span{record, HeaderStore::HEADER_SIZE}), pindex->GetBlockHash());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(headerstore_sync)
+{
+    const fs::path path{m_args.GetDataDirBase() / "headers.dat"};
+    TestChain chain;
+    CBlockIndex* fork_point{chain.Extend(nullptr, 6, 0)};
+    CBlockIndex* tip{chain.Extend(fork_point, 4, 100)};
+
+    {
+        HeaderStore store{path};
+        BOOST_REQUIRE(store.Open());
+        BOOST_CHECK_EQUAL(store.Size(), 0);
+        BOOST_CHECK(!store.Get(0));
+        BOOST_REQUIRE(store.Sync(*tip->pprev));
+        BOOST_REQUIRE(store.Sync(*tip));
+        CheckRecords(store, *tip);
+        BOOST_CHECK(!store.Get(tip->nHeight + 1));
+        BOOST_CHECK(!store.Contains(tip->nHeight, fork_point->GetBlockHash()));
+
+        // Reads past the end are cut short
+        std::vector<unsigned char> records;
+        BOOST_CHECK_EQUAL(store.Read(8, 100, records), 2U);
+        BOOST_CHECK_EQUAL(records.size(), 2 * HeaderStore::RECORD_SIZE);
+        BOOST_CHECK_EQUAL(store.Read(10, 1, records), 0U);
+    }
+
+    // The records are kept across reopening
+    HeaderStore store{path};
+    BOOST_REQUIRE(store.Open());
+    CheckRecords(store, *tip);
+
+    // A reorganization replaces the records after the fork point
+    CBlockIndex* fork_tip{chain.Extend(fork_point, 2, 200)};
+    BOOST_REQUIRE(store.Sync(*fork_tip));
+    CheckRecords(store, *fork_tip);
+    BOOST_CHECK(!store.Contains(tip->nHeight, tip->GetBlockHash()));
+}
+
+BOOST_AUTO_TEST_CASE(headerstore_partial_record)
+{
+    const fs::path path{m_args.GetDataDirBase() / "headers_partial.dat"};
+    TestChain chain;
+    CBlockIndex* tip{chain.Extend(nullptr, 3, 0)};
+    {
+        HeaderStore store{path};
+        BOOST_REQUIRE(store.Open());
+        BOOST_REQUIRE(store.Sync(*tip));
+    }
+
+    // An interrupted write leaves a partial record behind, which is dropped
+    FILE* file{fsbridge::fopen(path, "ab")};
+    BOOST_REQUIRE(file);
+    const unsigned char garbage[10]{};
+    BOOST_REQUIRE_EQUAL(fwrite(garbage, 1, sizeof(garbage), file), sizeof(garbage));
+    fclose(file);
+
+    HeaderStore store{path};
+    BOOST_REQUIRE(store.Open());
+    CheckRecords(store, *tip);
+    CBlockIndex* next{chain.Extend(tip, 1, 10)};
+    BOOST_REQUIRE(store.Sync(*next));
+    CheckRecords(store, *next);
+    BOOST_CHECK_EQUAL(fs::file_size(path), 5 * HeaderStore::RECORD_SIZE);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,12 +9,14 @@
 #include <test/util/net.h>
 #include <test/util/setup_common.h>
 #include <threadinterrupt.h>
+#include <util/strencodings.h>
 #include <util/system.h>
 
 #include <boost/test/unit_test.hpp>
 
 #include <memory>
 #include <string>
+#include <vector>
 
 BOOST_FIXTURE_TEST_SUITE(i2p_tests, BasicTestingSetup)
 
@@ -45,4 +47,36 @@ BOOST_AUTO_TEST_CASE(unlimited_recv)
     LogInstance().SetLogLevel(prev_log_level);
 }
 
+BOOST_AUTO_TEST_CASE(create_transient_session)
+{
+    const auto prev_log_level{LogInstance().LogLevel()};
+    LogInstance().SetLogLevel(BCLog::Level::Trace);
+    auto CreateSockOrig = CreateSock;
+
+    // The private key of a destination without a certificate
+    const std::string private_key{EncodeBase64(std::vector<unsigned char>(387, 0))};
+    std::string replies{"HELLO REPLY RESULT=OK VERSION=3.1\n"};
+    CreateSock = [&replies](const CService&) {
+        return std::make_unique<StaticContentsSock>(replies);
+    };
+
+    CThreadInterrupt interrupt;
+    {
+        // The proxy does not answer "SESSION CREATE"
+        i2p::sam::Session session(CService{}, &interrupt);
+        ASSERT_DEBUG_LOG("Error creating session");
+        BOOST_CHECK(!session.Create());
+    }
+
+    replies += "SESSION STATUS RESULT=OK DESTINATION=" + private_key + "\n";
+    {
+        i2p::sam::Session session(CService{}, &interrupt);
+        ASSERT_DEBUG_LOG("Transient SAM session");
+        BOOST_CHECK(session.Create());
+    }
+
+    CreateSock = CreateSockOrig;
+    LogInstance().SetLogLevel(prev_log_level);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
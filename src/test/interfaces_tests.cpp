@@ -15,6 +15,34 @@ using interfaces::FoundBlock;
 
 BOOST_FIXTURE_TEST_SUITE(interfaces_tests, TestChain100Setup)
 
+BOOST_AUTO_TEST_CASE(tipSnapshot)
+{
+    auto& chain = m_node.chain;
+    ChainstateManager& chainman = *Assert(m_node.chainman);
+    const CChain& active = WITH_LOCK(chainman.GetMutex(), return chainman.ActiveChain());
+    const auto check_tip{[&] {
+        const auto snapshot{chainman.TipSnapshot()};
+        BOOST_REQUIRE(snapshot);
+        BOOST_CHECK_EQUAL(snapshot->tip, WITH_LOCK(chainman.GetMutex(), return active.Tip()));
+        BOOST_CHECK_EQUAL(snapshot->height, active.Height());
+        BOOST_CHECK_EQUAL(snapshot->median_time_past, active.Tip()->GetMedianTimePast());
+        BOOST_CHECK(snapshot->chain_work == active.Tip()->nChainWork);
+        BOOST_CHECK_EQUAL(*chain->getHeight(), active.Height());
+        BOOST_CHECK_EQUAL(chain->getBlockHash(active.Height()), active.Tip()->GetBlockHash());
+        BOOST_CHECK_EQUAL(chain->getBlockHash(10), active[10]->GetBlockHash());
+    }};
+
+    // The snapshot follows the tip through connected and disconnected blocks
+    check_tip();
+    CreateAndProcessBlock({}, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    BOOST_CHECK_EQUAL(active.Height(), 101);
+    check_tip();
+    BlockValidationState state;
+    chainman.ActiveChainstate().InvalidateBlock(state, WITH_LOCK(chainman.GetMutex(), return active.Tip()));
+    BOOST_CHECK_EQUAL(active.Height(), 100);
+    check_tip();
+}
+
 BOOST_AUTO_TEST_CASE(findBlock)
 {
     LOCK(Assert(m_node.chainman)->GetMutex());
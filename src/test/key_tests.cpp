@@ -344,4 +344,32 @@ BOOST_AUTO_TEST_CASE(bip340_test_vectors)
     }
 }
 
+BOOST_AUTO_TEST_CASE(bip340_batch_verify)
+{
+    std::vector<SchnorrSignatureCheck> checks(20);
+    for (SchnorrSignatureCheck& check : checks) {
+        CKey key;
+        key.MakeNewKey(true);
+        check.pubkey = XOnlyPubKey{key.GetPubKey()};
+        check.msg = InsecureRand256();
+        BOOST_CHECK(key.SignSchnorr(check.msg, check.sig, nullptr, InsecureRand256()));
+    }
+    BOOST_CHECK(VerifySchnorrBatch({}));
+    BOOST_CHECK(VerifySchnorrBatch(Span{checks}.first(1)));
+    BOOST_CHECK(VerifySchnorrBatch(checks));
+
+    // A single invalid signature, message or key fails the whole batch
+    SchnorrSignatureCheck& check = checks[InsecureRandRange(checks.size())];
+    const size_t pos = InsecureRandRange(64);
+    check.sig[pos] ^= 1;
+    BOOST_CHECK(!VerifySchnorrBatch(checks));
+    check.sig[pos] ^= 1;
+    BOOST_CHECK(VerifySchnorrBatch(checks));
+    std::swap(checks.front().msg, checks.back().msg);
+    BOOST_CHECK(!VerifySchnorrBatch(checks));
+    std::swap(checks.front().msg, checks.back().msg);
+    std::swap(checks.front().pubkey, checks.back().pubkey);
+    BOOST_CHECK(!VerifySchnorrBatch(checks));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -138,6 +138,37 @@ BOOST_FIXTURE_TEST_CASE(logging_LogPrintMacros, LogSetup)
     BOOST_CHECK_EQUAL_COLLECTIONS(log_lines.begin(), log_lines.end(), expected.begin(), expected.end());
 }
 
+BOOST_FIXTURE_TEST_CASE(logging_async, LogSetup)
+{
+    // Restart logging with the writer thread
+    LogInstance().DisconnectTestLogger();
+    LogInstance().m_log_async = true;
+    BOOST_REQUIRE(LogInstance().StartLogging());
+
+    const std::string long_msg(BCLog::LOG_RECORD_TEXT_SIZE, 'x');
+    LogPrintf("foo12: %s\n", "bar12");
+    LogPrint(BCLog::NET, "foo13: %s\n", "bar13");
+    LogPrintf("foo14: %s", "bar14 ");
+    LogPrintf("%s\n", "continued");
+    LogPrintf("%s\n", long_msg);
+    LogInstance().StopWriter();
+    LogInstance().m_log_async = false;
+
+    std::ifstream file{tmp_log_path};
+    std::vector<std::string> log_lines;
+    for (std::string log; std::getline(file, log);) {
+        if (log.find("logger thread") == std::string::npos && !log.empty()) log_lines.push_back(log);
+    }
+    std::vector<std::string> expected = {
+        "foo12: bar12",
+        "[net] foo13: bar13",
+        "foo14: bar14 continued",
+        long_msg,
+    };
+    BOOST_CHECK_EQUAL_COLLECTIONS(log_lines.begin(), log_lines.end(), expected.begin(), expected.end());
+    BOOST_CHECK_EQUAL(LogInstance().DroppedMessages(), 0U);
+}
+
 BOOST_FIXTURE_TEST_CASE(logging_LogPrintMacros_CategoryName, LogSetup)
 {
     LogInstance().EnableCategory(BCLog::LogFlags::ALL);
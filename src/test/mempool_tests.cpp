@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <policy/policy.h>
+#include <script/interpreter.h>
 #include <txmempool.h>
 #include <util/system.h>
 #include <util/time.h>
@@ -800,4 +801,147 @@ BOOST_AUTO_TEST_CASE(MempoolAncestryTestsDiamond)
     BOOST_CHECK_EQUAL(descendants, 4ULL);
 }
 
+BOOST_AUTO_TEST_CASE(MempoolClusterChunksTest)
+{
+    CTxMemPool::Options opts;
+    opts.cluster_mode = true;
+    CTxMemPool pool{opts};
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // [tx1]    [tx2].0 <- [tx3]
+    //              .1 <- [tx4]
+    CTransactionRef tx1 = make_tx(/*output_values=*/{10 * COIN});
+    pool.addUnchecked(entry.Fee(2000LL).FromTx(tx1));
+    CTransactionRef tx2 = make_tx(/*output_values=*/{5 * COIN, 5 * COIN});
+    pool.addUnchecked(entry.Fee(1000LL).FromTx(tx2));
+    CTransactionRef tx3 = make_tx(/*output_values=*/{4 * COIN}, /*inputs=*/{tx2}, /*input_indices=*/{0});
+    pool.addUnchecked(entry.Fee(20000LL).FromTx(tx3));
+    CTransactionRef tx4 = make_tx(/*output_values=*/{4 * COIN}, /*inputs=*/{tx2}, /*input_indices=*/{1});
+    pool.addUnchecked(entry.Fee(100LL).FromTx(tx4));
+
+    // tx3 pays for tx2, so they are chunked together, and tx4 is left on its own
+    auto clusters = pool.GetClusterChunks();
+    BOOST_REQUIRE_EQUAL(clusters.size(), 2U);
+    if (clusters[0].size() != 1) std::swap(clusters[0], clusters[1]);
+    BOOST_REQUIRE_EQUAL(clusters[0].size(), 1U);
+    BOOST_CHECK_EQUAL(clusters[0][0].txs.front()->GetTx().GetHash(), tx1->GetHash());
+    const auto& chunks = clusters[1];
+    BOOST_REQUIRE_EQUAL(chunks.size(), 2U);
+    BOOST_REQUIRE_EQUAL(chunks[0].txs.size(), 2U);
+    BOOST_CHECK_EQUAL(chunks[0].txs[0]->GetTx().GetHash(), tx2->GetHash());
+    BOOST_CHECK_EQUAL(chunks[0].txs[1]->GetTx().GetHash(), tx3->GetHash());
+    BOOST_CHECK_EQUAL(chunks[0].fee, 21000);
+    BOOST_CHECK_EQUAL(chunks[0].size, int64_t(GetVirtualTransactionSize(*tx2) + GetVirtualTransactionSize(*tx3)));
+    BOOST_REQUIRE_EQUAL(chunks[1].txs.size(), 1U);
+    BOOST_CHECK_EQUAL(chunks[1].txs[0]->GetTx().GetHash(), tx4->GetHash());
+
+    // The worst chunk goes first: tx4, then tx1, whose feerate is below that of tx2 and tx3
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(tx4->GetHash())));
+    BOOST_CHECK_EQUAL(pool.size(), 3U);
+    pool.TrimToSize(pool.DynamicMemoryUsage() - 1);
+    BOOST_CHECK(!pool.exists(GenTxid::Txid(tx1->GetHash())));
+    BOOST_CHECK(pool.exists(GenTxid::Txid(tx2->GetHash())));
+    BOOST_CHECK(pool.exists(GenTxid::Txid(tx3->GetHash())));
+}
+
+BOOST_AUTO_TEST_CASE(MempoolMemoryUsageTest)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    // Up to two relatives are stored inline
+    CTransactionRef parent = make_tx(/*output_values=*/{COIN, COIN, COIN});
+    pool.addUnchecked(entry.FromTx(parent));
+    std::vector<CTransactionRef> children;
+    for (uint32_t i = 0; i < 2; ++i) {
+        children.push_back(make_tx(/*output_values=*/{COIN / 2}, /*inputs=*/{parent}, /*input_indices=*/{i}));
+        pool.addUnchecked(entry.FromTx(children.back()));
+    }
+    CTxMemPool::MemoryUsage usage{pool.GetMemoryUsage()};
+    BOOST_CHECK_EQUAL(usage.relatives, 0U);
+    BOOST_CHECK_EQUAL(usage.entries + usage.transactions + usage.relatives + usage.spends + usage.deltas + usage.tx_hashes, pool.DynamicMemoryUsage());
+
+    children.push_back(make_tx(/*output_values=*/{COIN / 2}, /*inputs=*/{parent}, /*input_indices=*/{2}));
+    pool.addUnchecked(entry.FromTx(children.back()));
+    usage = pool.GetMemoryUsage();
+    BOOST_CHECK_GT(usage.relatives, 0U);
+    BOOST_CHECK_EQUAL(usage.entries + usage.transactions + usage.relatives + usage.spends + usage.deltas + usage.tx_hashes, pool.DynamicMemoryUsage());
+
+    // Removing the relatives releases their usage
+    pool.removeRecursive(*children.back(), MemPoolRemovalReason::REPLACED);
+    pool.removeRecursive(*children.front(), MemPoolRemovalReason::REPLACED);
+    usage = pool.GetMemoryUsage();
+    BOOST_CHECK_EQUAL(usage.entries + usage.transactions + usage.relatives + usage.spends + usage.deltas + usage.tx_hashes, pool.DynamicMemoryUsage());
+}
+
+BOOST_AUTO_TEST_CASE(MempoolPrecomputedTxData)
+{
+    CTxMemPool& pool = *Assert(m_node.mempool);
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    CTransactionRef ta = make_tx(/*output_values=*/{10 * COIN});
+    CTransactionRef tb = make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{ta});
+    pool.addUnchecked(entry.FromTx(ta));
+    BOOST_CHECK(pool.GetPrecomputedTxData(ta->GetWitnessHash()) == nullptr);
+    BOOST_CHECK(pool.GetPrecomputedTxData(tb->GetWitnessHash()) == nullptr);
+
+    // The data is found by wtxid, and counted in the memory usage of the entry
+    CTxMemPoolEntry entry_b{entry.FromTx(tb)};
+    const size_t usage{entry_b.DynamicMemoryUsage()};
+    auto txdata{std::make_shared<PrecomputedTransactionData>()};
+    txdata->Init(*tb, std::vector<CTxOut>{ta->vout[0]});
+    entry_b.SetPrecomputedTxData(txdata);
+    BOOST_CHECK_GT(entry_b.DynamicMemoryUsage(), usage);
+    const size_t pool_usage{pool.DynamicMemoryUsage()};
+    pool.addUnchecked(entry_b);
+    BOOST_CHECK_GE(pool.DynamicMemoryUsage(), pool_usage + entry_b.DynamicMemoryUsage());
+    const auto found{pool.GetPrecomputedTxData(tb->GetWitnessHash())};
+    BOOST_CHECK(found == txdata);
+    BOOST_CHECK(found->m_spent_outputs_ready);
+
+    entry_b.SetPrecomputedTxData(nullptr);
+    BOOST_CHECK_EQUAL(entry_b.DynamicMemoryUsage(), usage);
+}
+
+BOOST_AUTO_TEST_CASE(MempoolDeltaEventsTest)
+{
+    CTxMemPool::Options opts{MemPoolOptionsForTest(m_node)};
+    opts.max_delta_events = 3;
+    CTxMemPool pool{opts};
+    LOCK2(::cs_main, pool.cs);
+    TestMemPoolEntryHelper entry;
+
+    const uint64_t start{pool.GetSequence()};
+    BOOST_CHECK(pool.GetDeltaEvents(start)->empty());
+    BOOST_CHECK(!pool.GetDeltaEvents(start + 1));
+
+    CTransactionRef ta = make_tx(/*output_values=*/{10 * COIN});
+    CTransactionRef tb = make_tx(/*output_values=*/{5 * COIN}, /*inputs=*/{ta});
+    pool.addUnchecked(entry.FromTx(ta));
+    BOOST_CHECK_EQUAL(pool.GetAndIncrementSequence(ta->GetHash(), /*added=*/true), start);
+    pool.addUnchecked(entry.FromTx(tb));
+    BOOST_CHECK_EQUAL(pool.GetAndIncrementSequence(tb->GetHash(), /*added=*/true), start + 1);
+
+    // Removals are numbered too, whatever the reason
+    pool.removeRecursive(*ta, MemPoolRemovalReason::CONFLICT);
+    BOOST_CHECK_EQUAL(pool.GetSequence(), start + 4);
+    auto events{pool.GetDeltaEvents(start + 1)};
+    BOOST_REQUIRE(events);
+    BOOST_REQUIRE_EQUAL(events->size(), 3U);
+    BOOST_CHECK_EQUAL((*events)[0].sequence, start + 1);
+    BOOST_CHECK((*events)[0].txid == tb->GetHash());
+    BOOST_CHECK((*events)[0].added);
+    BOOST_CHECK(!(*events)[1].added);
+    BOOST_CHECK(!(*events)[2].added);
+    BOOST_CHECK((*events)[1].txid != (*events)[2].txid);
+    BOOST_CHECK(pool.GetDeltaEvents(start + 4)->empty());
+
+    // The first event no longer fits in the ring
+    BOOST_CHECK(!pool.GetDeltaEvents(start));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
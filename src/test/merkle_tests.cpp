@@ -9,19 +9,6 @@
 
 BOOST_FIXTURE_TEST_SUITE(merkle_tests, TestingSetup)
 
-static uint256 ComputeMerkleRootFromBranch(const uint256& leaf, const std::vector<uint256>& vMerkleBranch, uint32_t nIndex) {
-    uint256 hash = leaf;
-    for (std::vector<uint256>::const_iterator it = vMerkleBranch.begin(); it != vMerkleBranch.end(); ++it) {
-        if (nIndex & 1) {
-            hash = Hash(*it, hash);
-        } else {
-            hash = Hash(hash, *it);
-        }
-        nIndex >>= 1;
-    }
-    return hash;
-}
-
 /* This implements a constant-space merkle root/path calculator, limited to 2^32 leaves. */
 static void MerkleComputation(const std::vector<uint256>& leaves, uint256* proot, bool* pmutated, uint32_t branchpos, std::vector<uint256>* pbranch) {
     if (pbranch) pbranch->clear();
@@ -110,20 +97,16 @@ static void MerkleComputation(const std::vector<uint256>& leaves, uint256* proot
     if (proot) *proot = h;
 }
 
-static std::vector<uint256> ComputeMerkleBranch(const std::vector<uint256>& leaves, uint32_t position) {
-    std::vector<uint256> ret;
-    MerkleComputation(leaves, nullptr, nullptr, position, &ret);
-    return ret;
-}
-
-static std::vector<uint256> BlockMerkleBranch(const CBlock& block, uint32_t position)
+static std::vector<uint256> ReferenceMerkleBranch(const CBlock& block, uint32_t position)
 {
     std::vector<uint256> leaves;
     leaves.resize(block.vtx.size());
     for (size_t s = 0; s < block.vtx.size(); s++) {
         leaves[s] = block.vtx[s]->GetHash();
     }
-    return ComputeMerkleBranch(leaves, position);
+    std::vector<uint256> ret;
+    MerkleComputation(leaves, nullptr, nullptr, position, &ret);
+    return ret;
 }
 
 // Older version of the merkle root computation code, for comparison.
@@ -241,6 +224,7 @@ BOOST_AUTO_TEST_CASE(merkle_test)
                     std::vector<uint256> newBranch = BlockMerkleBranch(block, mtx);
                     std::vector<uint256> oldBranch = BlockGetMerkleBranch(block, merkleTree, mtx);
                     BOOST_CHECK(oldBranch == newBranch);
+                    BOOST_CHECK(ReferenceMerkleBranch(block, mtx) == newBranch);
                     BOOST_CHECK(ComputeMerkleRootFromBranch(block.vtx[mtx]->GetHash(), newBranch, mtx) == oldRoot);
                 }
             }
@@ -348,4 +332,27 @@ BOOST_AUTO_TEST_CASE(merkle_test_BlockWitness)
 
     BOOST_CHECK_EQUAL(merkleRootofHashes, blockWitness);
 }
+BOOST_AUTO_TEST_CASE(merkle_test_coinbase_branch)
+{
+    // The branch of the coinbase must not depend on the coinbase itself
+    for (int ntx : {1, 2, 3, 7, 8, 100}) {
+        CBlock block;
+        block.vtx.resize(ntx);
+        for (int j = 0; j < ntx; j++) {
+            CMutableTransaction mtx;
+            mtx.nLockTime = j;
+            block.vtx[j] = MakeTransactionRef(std::move(mtx));
+        }
+        const std::vector<uint256> branch{BlockMerkleBranch(block, 0)};
+        BOOST_CHECK_EQUAL(ComputeMerkleRootFromBranch(block.vtx[0]->GetHash(), branch, 0), BlockMerkleRoot(block));
+
+        CMutableTransaction coinbase;
+        coinbase.nLockTime = ntx + 1000;
+        block.vtx[0] = MakeTransactionRef(std::move(coinbase));
+        BOOST_CHECK(BlockMerkleBranch(block, 0) == branch);
+        BOOST_CHECK_EQUAL(ComputeMerkleRootFromBranch(block.vtx[0]->GetHash(), branch, 0), BlockMerkleRoot(block));
+    }
+    BOOST_CHECK(ComputeMerkleBranch({}, 0).empty());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -3,8 +3,10 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <merkleblock.h>
+#include <streams.h>
 #include <test/util/setup_common.h>
 #include <uint256.h>
+#include <util/strencodings.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -77,4 +79,23 @@ BOOST_AUTO_TEST_CASE(merkleblock_construct_from_txids_not_found)
     BOOST_CHECK_EQUAL(vIndex.size(), 0U);
 }
 
+/**
+ * A CMerkleBlock created from the header and txids of a block is the same as
+ * one created from the block.
+ */
+BOOST_AUTO_TEST_CASE(merkleblock_construct_from_block_txids)
+{
+    CBlock block = getBlock13b8a();
+
+    std::vector<uint256> block_txids;
+    for (const auto& tx : block.vtx) block_txids.push_back(tx->GetHash());
+    std::set<uint256> txids{block_txids[1], block_txids.back()};
+
+    CDataStream from_block{SER_NETWORK, PROTOCOL_VERSION};
+    from_block << CMerkleBlock(block, txids);
+    CDataStream from_txids{SER_NETWORK, PROTOCOL_VERSION};
+    from_txids << CMerkleBlock(block.GetBlockHeader(), block_txids, txids);
+    BOOST_CHECK_EQUAL(HexStr(from_block), HexStr(from_txids));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,45 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <net.h>
+#include <protocol.h>
+#include <test/util/setup_common.h>
+#include <util/metrics.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <chrono>
+
+BOOST_FIXTURE_TEST_SUITE(metrics_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(histogram)
+{
+    MetricHistogram histogram;
+    BOOST_CHECK_EQUAL(histogram.Get().count, 0U);
+
+    // Bucket bounds are inclusive, and durations beyond the last bound land in the unbounded bucket
+    histogram.Observe(std::chrono::microseconds{0});
+    histogram.Observe(std::chrono::microseconds{MetricHistogram::BUCKET_BOUNDS[0]});
+    histogram.Observe(std::chrono::microseconds{MetricHistogram::BUCKET_BOUNDS[0] + 1});
+    histogram.Observe(std::chrono::microseconds{MetricHistogram::BUCKET_BOUNDS.back() + 1});
+
+    const MetricHistogram::Snapshot snapshot{histogram.Get()};
+    BOOST_CHECK_EQUAL(snapshot.count, 4U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[0], 2U);
+    BOOST_CHECK_EQUAL(snapshot.buckets[1], 1U);
+    BOOST_CHECK_EQUAL(snapshot.buckets.back(), 1U);
+    BOOST_CHECK(snapshot.sum == std::chrono::microseconds{2 * MetricHistogram::BUCKET_BOUNDS[0] + 1 + MetricHistogram::BUCKET_BOUNDS.back() + 1});
+}
+
+BOOST_AUTO_TEST_CASE(msg_type_bytes)
+{
+    // Every known message type is reported, along with the bucket for the others
+    const auto bytes{GetTotalBytesPerMsgType()};
+    BOOST_CHECK_EQUAL(bytes.size(), getAllNetMessageTypes().size() + 1);
+    BOOST_CHECK(std::is_sorted(bytes.begin(), bytes.end(), [](const auto& a, const auto& b) { return a.msg_type < b.msg_type; }));
+    BOOST_CHECK(std::any_of(bytes.begin(), bytes.end(), [](const auto& b) { return b.msg_type == NET_MESSAGE_TYPE_OTHER; }));
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -14,6 +14,7 @@
 #include <serialize.h>
 #include <span.h>
 #include <streams.h>
+#include <test/util/net.h>
 #include <test/util/setup_common.h>
 #include <test/util/validation.h>
 #include <timedata.h>
@@ -27,6 +28,7 @@
 
 #include <algorithm>
 #include <ios>
+#include <limits>
 #include <memory>
 #include <optional>
 #include <string>
@@ -816,7 +818,8 @@ BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
     // Pretend that we bound to this port.
     const uint16_t bind_port = 20001;
     m_node.args->ForceSetArg("-bind", strprintf("3.4.5.6:%u", bind_port));
-    m_node.args->ForceSetArg("-capturemessages", "1");
+    auto& connman{static_cast<ConnmanTestMsg&>(*m_node.connman)};
+    connman.SetCaptureMessages(true);
 
     // Our address:port as seen from the peer - 2.3.4.5:20002 (different from the above).
     in_addr peer_us_addr;
@@ -898,7 +901,7 @@ BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
 
     CaptureMessage = CaptureMessageOrig;
     chainstate.ResetIbd();
-    m_node.args->ForceSetArg("-capturemessages", "0");
+    connman.SetCaptureMessages(false);
     m_node.args->ForceSetArg("-bind", "");
     // PeerManager::ProcessMessage() calls AddTimeData() which changes the internal state
     // in timedata.cpp and later confuses the test "timedata_tests/addtimedata". Thus reset
@@ -906,4 +909,153 @@ BOOST_AUTO_TEST_CASE(initial_advertise_from_version_message)
     TestOnlyResetTimeData();
 }
 
+/** A socket taking at most a given number of bytes, which it records */
+class ThrottledSock : public StaticContentsSock
+{
+public:
+    ThrottledSock() : StaticContentsSock{""} {}
+
+    ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int) const override
+    {
+        size_t sent{0};
+        for (size_t i = 0; i < std::min(buffers.size(), MAX_SEND_BUFFERS) && sent < m_budget; ++i) {
+            const size_t len{std::min(buffers[i].size(), m_budget - sent)};
+            m_sent.insert(m_sent.end(), buffers[i].begin(), buffers[i].begin() + len);
+            sent += len;
+        }
+        m_budget -= sent;
+        return sent;
+    }
+
+    mutable size_t m_budget{0};
+    mutable std::vector<unsigned char> m_sent;
+};
+
+BOOST_AUTO_TEST_CASE(send_queue_priority)
+{
+    auto& connman{static_cast<ConnmanTestMsg&>(*m_node.connman)};
+    const auto sock{std::make_shared<ThrottledSock>()};
+    in_addr peer_in_addr;
+    peer_in_addr.s_addr = htonl(0x01020304);
+    CNode peer{/*id=*/0,
+               /*sock=*/sock,
+               /*addrIn=*/CAddress{CService{peer_in_addr, 8333}, NODE_NETWORK},
+               /*nKeyedNetGroupIn=*/0,
+               /*nLocalHostNonceIn=*/0,
+               /*addrBindIn=*/CAddress{},
+               /*addrNameIn=*/std::string{},
+               /*conn_type_in=*/ConnectionType::OUTBOUND_FULL_RELAY,
+               /*inbound_onion=*/false};
+    const CNetMsgMaker msg_maker{PROTOCOL_VERSION};
+
+    BOOST_CHECK(GetSendPriority(NetMsgType::CMPCTBLOCK) == SendPriority::BLOCK);
+    BOOST_CHECK(GetSendPriority(NetMsgType::HEADERS) == SendPriority::BLOCK);
+    BOOST_CHECK(GetSendPriority(NetMsgType::PING) == SendPriority::BLOCK);
+    BOOST_CHECK(GetSendPriority(NetMsgType::TX) == SendPriority::TX);
+    BOOST_CHECK(GetSendPriority(NetMsgType::MERKLEBLOCK) == SendPriority::TX);
+    BOOST_CHECK(GetSendPriority(NetMsgType::ADDRV2) == SendPriority::ADDR);
+
+    // A transaction starts going out while the socket takes part of it
+    connman.PushMessage(&peer, msg_maker.Make(NetMsgType::TX, std::vector<unsigned char>(1000)));
+    BOOST_CHECK(WITH_LOCK(peer.cs_vSend, return peer.HasQueuedMessages()));
+    sock->m_budget = 100;
+    BOOST_CHECK_EQUAL(connman.SendQueuedData(peer), 100U);
+
+    // Queued behind it in time, headers are sent right after it, before the
+    // transaction relay and the address relay queued before them
+    connman.PushMessage(&peer, msg_maker.Make(NetMsgType::ADDR, std::vector<CAddress>{}));
+    connman.PushMessage(&peer, msg_maker.Make(NetMsgType::INV, std::vector<CInv>{}));
+    connman.PushMessage(&peer, msg_maker.Make(NetMsgType::HEADERS, std::vector<CBlockHeader>{}));
+    sock->m_budget = std::numeric_limits<size_t>::max();
+    connman.SendQueuedData(peer);
+    BOOST_CHECK(WITH_LOCK(peer.cs_vSend, return !peer.HasQueuedMessages()));
+
+    std::vector<std::string> sent_types;
+    for (size_t pos = 0; pos < sock->m_sent.size();) {
+        CMessageHeader hdr;
+        CDataStream{Span{sock->m_sent}.subspan(pos, CMessageHeader::HEADER_SIZE), SER_NETWORK, PROTOCOL_VERSION} >> hdr;
+        sent_types.push_back(hdr.GetCommand());
+        pos += CMessageHeader::HEADER_SIZE + hdr.nMessageSize;
+    }
+    BOOST_CHECK_EQUAL(Join(sent_types, ","), "tx,headers,inv,addr");
+
+    CNodeStats stats;
+    peer.CopyStats(stats);
+    const std::array<uint64_t, NUM_SEND_PRIORITIES> sent_msgs{1, 2, 1};
+    for (size_t queue = 0; queue < NUM_SEND_PRIORITIES; ++queue) {
+        BOOST_CHECK_EQUAL(stats.m_send_queue_stats[queue].queued_bytes, 0U);
+        BOOST_CHECK_EQUAL(stats.m_send_queue_stats[queue].sent_msgs, sent_msgs[queue]);
+        BOOST_CHECK(stats.m_send_queue_stats[queue].max_delay <= stats.m_send_queue_stats[queue].total_delay);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(net_buffer_pool)
+{
+    NetBufferPool pool;
+
+    // Buffers come in size classes and are reused once released
+    SerializeData buffer{pool.Acquire(100)};
+    BOOST_CHECK_EQUAL(buffer.capacity(), NetBufferPool::MIN_BUFFER_SIZE);
+    const std::byte* const allocation{buffer.data()};
+    pool.Release(std::move(buffer));
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), NetBufferPool::MIN_BUFFER_SIZE);
+    buffer = pool.Acquire(NetBufferPool::MIN_BUFFER_SIZE);
+    BOOST_CHECK_EQUAL(buffer.data(), allocation);
+    BOOST_CHECK(buffer.empty());
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), 0U);
+
+    // A released buffer is only handed out for sizes it holds
+    buffer.reserve(300);
+    pool.Release(std::move(buffer));
+    BOOST_CHECK_GE(pool.Acquire(301).capacity(), 301U);
+    BOOST_CHECK_GT(pool.PooledBytes(), 0U);
+    BOOST_CHECK_GE(pool.Acquire(256).capacity(), 300U);
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), 0U);
+
+    // Buffers larger than the largest class are neither allocated ahead nor kept
+    BOOST_CHECK_EQUAL(pool.Acquire(NetBufferPool::MAX_BUFFER_SIZE + 1).capacity(), 0U);
+    SerializeData large;
+    large.reserve(NetBufferPool::MAX_BUFFER_SIZE + 1);
+    pool.Release(std::move(large));
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), 0U);
+
+    // The pool keeps no more than its budget
+    for (size_t i = 0; i <= NetBufferPool::MAX_POOLED_BYTES / NetBufferPool::MAX_BUFFER_SIZE; ++i) {
+        SerializeData full;
+        full.reserve(NetBufferPool::MAX_BUFFER_SIZE);
+        pool.Release(std::move(full));
+    }
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), NetBufferPool::MAX_POOLED_BYTES);
+}
+
+BOOST_AUTO_TEST_CASE(net_buffer_pool_deserializer)
+{
+    NetBufferPool pool;
+    V1TransportDeserializer deserializer{Params(), /*node_id=*/0, SER_NETWORK, INIT_PROTO_VERSION, &pool};
+    V1TransportSerializer serializer;
+
+    const auto receive{[&](const std::vector<unsigned char>& payload) {
+        CSerializedNetMsg msg{CNetMsgMaker{INIT_PROTO_VERSION}.Make(NetMsgType::PING, payload)};
+        std::vector<unsigned char> bytes;
+        serializer.prepareForTransport(msg, bytes);
+        bytes.insert(bytes.end(), msg.data.begin(), msg.data.end());
+        Span<const uint8_t> msg_bytes{bytes};
+        while (!msg_bytes.empty()) {
+            BOOST_REQUIRE(deserializer.Read(msg_bytes) > 0);
+        }
+        BOOST_REQUIRE(deserializer.Complete());
+        bool reject_message;
+        CNetMessage received{deserializer.GetMessage(/*time=*/0us, reject_message)};
+        BOOST_CHECK(!reject_message);
+        BOOST_CHECK_EQUAL(HexStr(received.m_recv), HexStr(msg.data));
+        return received.m_recv.data();
+    }};
+
+    // The buffer of a processed message receives the next one
+    const std::byte* const allocation{receive(std::vector<unsigned char>(100, 1))};
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), NetBufferPool::MIN_BUFFER_SIZE);
+    BOOST_CHECK_EQUAL(receive(std::vector<unsigned char>(200, 2)), allocation);
+    BOOST_CHECK_EQUAL(pool.PooledBytes(), NetBufferPool::MIN_BUFFER_SIZE);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,138 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <memusage.h>
+#include <support/allocators/pool.h>
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+/** Access to the internals of a PoolResource. */
+class PoolResourceTester
+{
+public:
+    //! Number of blocks in each free list
+    template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+    static std::vector<std::size_t> FreeListSizes(const PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& resource)
+    {
+        std::vector<std::size_t> sizes;
+        for (const auto* node : resource.m_free_lists) {
+            std::size_t size{0};
+            for (; node != nullptr; node = node->m_next) ++size;
+            sizes.push_back(size);
+        }
+        return sizes;
+    }
+
+    template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+    static std::size_t AvailableMemoryFromChunk(const PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& resource)
+    {
+        return resource.m_available_memory_end - resource.m_available_memory_it;
+    }
+};
+
+BOOST_FIXTURE_TEST_SUITE(pool_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(basic_allocating)
+{
+    auto resource = PoolResource<8, 8>(1024);
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 1024U);
+
+    // Freed blocks are reused by the next allocation of the same size
+    void* block = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 1016U);
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[1], 1U);
+    BOOST_CHECK_EQUAL(resource.Allocate(8, 8), block);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[1], 0U);
+
+    // Zero bytes use one unit, and sizes are rounded up to the alignment
+    void* b0 = resource.Allocate(0, 1);
+    void* b1 = resource.Allocate(1, 1);
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 1000U);
+    resource.Deallocate(b0, 0, 1);
+    resource.Deallocate(b1, 1, 1);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[1], 2U);
+
+    // Larger or over-aligned blocks are not taken from the pool
+    void* big = resource.Allocate(16, 8);
+    void* aligned = resource.Allocate(8, 16);
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 1000U);
+    resource.Deallocate(big, 16, 8);
+    resource.Deallocate(aligned, 8, 16);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[1], 2U);
+
+    resource.Deallocate(block, 8, 8);
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 1U);
+    // Everything was given back
+    BOOST_CHECK_EQUAL(resource.AvailableBytes(), 1024U);
+}
+
+BOOST_AUTO_TEST_CASE(new_chunk_keeps_leftover)
+{
+    // Blocks of up to 16 bytes, in chunks of 40 bytes
+    auto resource = PoolResource<16, 8>(40);
+    std::vector<void*> blocks;
+    blocks.push_back(resource.Allocate(16, 8));
+    blocks.push_back(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 8U);
+
+    // The next 16-byte block needs a new chunk; the 8 bytes left over go onto a free list
+    blocks.push_back(resource.Allocate(16, 8));
+    BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), 2U);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[1], 1U);
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 24U);
+
+    // and serve the next 8-byte allocation
+    void* small = resource.Allocate(8, 8);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[1], 0U);
+    BOOST_CHECK_EQUAL(PoolResourceTester::AvailableMemoryFromChunk(resource), 24U);
+
+    resource.Deallocate(small, 8, 8);
+    for (void* block : blocks) resource.Deallocate(block, 16, 8);
+    BOOST_CHECK_EQUAL(PoolResourceTester::FreeListSizes(resource)[2], 3U);
+}
+
+BOOST_AUTO_TEST_CASE(unordered_map_with_pool)
+{
+    using Map = std::unordered_map<uint64_t, uint64_t, std::hash<uint64_t>, std::equal_to<uint64_t>,
+                                   PoolAllocator<std::pair<const uint64_t, uint64_t>, sizeof(std::pair<const uint64_t, uint64_t>) + sizeof(void*) * 4>>;
+    Map::allocator_type::ResourceType resource(2048);
+    {
+        Map map{0, Map::hasher{}, Map::key_equal{}, &resource};
+        for (uint64_t i = 0; i < 1000; ++i) {
+            map[i] = i * 2;
+        }
+        for (uint64_t i = 0; i < 1000; i += 2) {
+            map.erase(i);
+        }
+        BOOST_CHECK_EQUAL(map.size(), 500U);
+        for (uint64_t i = 1; i < 1000; i += 2) {
+            BOOST_CHECK_EQUAL(map.at(i), i * 2);
+        }
+
+        // Erased nodes are reused, so refilling the map needs no new chunk
+        const std::size_t num_chunks{resource.NumAllocatedChunks()};
+        BOOST_CHECK_GT(num_chunks, 1U);
+        for (uint64_t i = 0; i < 1000; i += 2) {
+            map[i] = i * 2;
+        }
+        BOOST_CHECK_EQUAL(resource.NumAllocatedChunks(), num_chunks);
+
+        // Memory usage accounts for all chunks of the resource
+        BOOST_CHECK_GE(memusage::DynamicUsage(map), num_chunks * resource.ChunkSizeBytes());
+    }
+
+    // All nodes went back to the free lists
+    std::size_t free_blocks{0};
+    for (std::size_t size : PoolResourceTester::FreeListSizes(resource)) free_blocks += size;
+    BOOST_CHECK_GE(free_blocks, 1000U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -4,8 +4,15 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <consensus/merkle.h>
+#include <node/miner.h>
 #include <pow.h>
+#include <primitives/block.h>
+#include <util/system.h>
 #include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <optional>
 
 #include <boost/test/unit_test.hpp>
 
@@ -154,6 +161,54 @@ BOOST_AUTO_TEST_CASE(GetBlockProofEquivalentTime_test)
     }
 }
 
+BOOST_AUTO_TEST_CASE(target_window_sum)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::MAIN);
+    const Consensus::Params& consensus = chainParams->GetConsensus();
+    const uint32_t pow_limit_bits{UintToArith256(consensus.powLimit).GetCompact()};
+
+    // Two copies of the same chain with random block times and targets: the
+    // first one keeps the window state, the second one walks the window.
+    std::vector<CBlockIndex> fast(300), slow(300);
+    for (size_t i = 0; i < fast.size(); i++) {
+        const uint32_t time = 1585921268 + i * consensus.nPowTargetSpacing + InsecureRandRange(4 * consensus.nPowTargetSpacing);
+        const uint32_t bits = i % 7 ? 0x1c000000 | (InsecureRand32() & 0x007fffff) : pow_limit_bits;
+        for (auto* blocks : {&fast, &slow}) {
+            CBlockIndex& block = (*blocks)[i];
+            block.pprev = i ? &(*blocks)[i - 1] : nullptr;
+            block.nHeight = i;
+            block.nTime = time;
+            block.nBits = bits;
+        }
+        fast[i].nTargetWindowSum = GetTargetWindowSum(fast[i]);
+        BOOST_CHECK_EQUAL(GetNextWorkRequired(&fast[i], nullptr, consensus), GetNextWorkRequired(&slow[i], nullptr, consensus));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(difficulty_window)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::MAIN);
+    const Consensus::Params& consensus = chainParams->GetConsensus();
+
+    std::vector<CBlockIndex> blocks(200);
+    std::optional<DifficultyWindow> window;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        blocks[i].pprev = i ? &blocks[i - 1] : nullptr;
+        blocks[i].nHeight = i;
+        blocks[i].nTime = 1585921268 + i * consensus.nPowTargetSpacing + InsecureRandRange(4 * consensus.nPowTargetSpacing);
+        blocks[i].nBits = 0x1c000000 | (InsecureRand32() & 0x007fffff);
+        if (window) {
+            window->Push(blocks[i].nTime, blocks[i].nBits);
+        } else {
+            window.emplace(blocks[i]);
+        }
+        const unsigned int expected{GetNextWorkRequired(&blocks[i], nullptr, consensus)};
+        // both a window that was pushed to and one that was loaded from the index
+        BOOST_CHECK_EQUAL(window->GetNextWorkRequired(consensus), expected);
+        BOOST_CHECK_EQUAL(DifficultyWindow{blocks[i]}.GetNextWorkRequired(consensus), expected);
+    }
+}
+
 void sanity_check_chainparams(const ArgsManager& args, std::string chainName)
 {
     const auto chainParams = CreateChainParams(args, chainName);
@@ -201,4 +256,144 @@ BOOST_AUTO_TEST_CASE(ChainParams_SIGNET_sanity)
     sanity_check_chainparams(*m_node.args, CBaseChainParams::SIGNET);
 }
 
+BOOST_FIXTURE_TEST_CASE(has_valid_proof_of_work, ChainTestingSetup)
+{
+    // ChainTestingSetup starts the header proof-of-work worker threads, so
+    // batches below are checked in parallel.
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::REGTEST);
+    const Consensus::Params& consensus = chainParams->GetConsensus();
+    const uint32_t nbits{UintToArith256(consensus.powLimit).GetCompact()};
+
+    std::vector<CBlockHeader> headers(64);
+    for (CBlockHeader& header : headers) {
+        header.nVersion = 4;
+        header.hashMerkleRoot = InsecureRand256();
+        header.nTime = InsecureRand32();
+        header.nBits = nbits;
+        while (!CheckProofOfWork(header.GetPoWHash(), header.nBits, consensus)) ++header.nNonce;
+    }
+    BOOST_CHECK(HasValidProofOfWork(headers, consensus));
+    BOOST_CHECK(HasValidProofOfWork({headers.front()}, consensus));
+
+    // A single bad header anywhere in the batch fails the whole batch.
+    CBlockHeader& bad = headers[InsecureRandRange(headers.size())];
+    do {
+        ++bad.nNonce;
+    } while (CheckProofOfWork(bad.GetPoWHash(), bad.nBits, consensus));
+    BOOST_CHECK(!HasValidProofOfWork(headers, consensus));
+
+    // The queue is reusable after a failed batch.
+    headers.erase(headers.begin() + (&bad - headers.data()));
+    BOOST_CHECK(HasValidProofOfWork(headers, consensus));
+}
+
+BOOST_FIXTURE_TEST_CASE(block_check_marks_checked, ChainTestingSetup)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::REGTEST);
+    const Consensus::Params& consensus = chainParams->GetConsensus();
+
+    CMutableTransaction coinbase;
+    coinbase.vin.emplace_back(COutPoint{});
+    coinbase.vin[0].scriptSig = CScript{} << 1 << OP_0;
+    coinbase.vout.emplace_back(0, CScript{} << OP_TRUE);
+    CBlock block;
+    block.nVersion = 4;
+    block.nTime = InsecureRand32();
+    block.nBits = UintToArith256(consensus.powLimit).GetCompact();
+    block.vtx.push_back(MakeTransactionRef(coinbase));
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    while (!CheckProofOfWork(block.GetPoWHash(), block.nBits, consensus)) ++block.nNonce;
+
+    // A valid block is marked checked, so AcceptBlock skips CheckBlock
+    BOOST_CHECK(CBlockCheck(block, consensus)());
+    BOOST_CHECK(block.fChecked);
+
+    // A bad block is not, and is left to AcceptBlock to reject
+    CBlock bad{block};
+    bad.fChecked = false;
+    bad.hashMerkleRoot = InsecureRand256();
+    BOOST_CHECK(CBlockCheck(bad, consensus)());
+    BOOST_CHECK(!bad.fChecked);
+}
+
+BOOST_AUTO_TEST_CASE(grind_nonce)
+{
+    const auto chainParams = CreateChainParams(*m_node.args, CBaseChainParams::REGTEST);
+    const Consensus::Params& params{chainParams->GetConsensus()};
+
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashMerkleRoot = InsecureRand256();
+    // About one nonce in 32 meets this target
+    header.nBits = arith_uint256{UintToArith256(params.powLimit) >> 5}.GetCompact();
+
+    // Nonce-by-nonce reference search
+    auto serial = [&](CBlockHeader block, uint64_t max_tries) {
+        while (max_tries > 0 && !CheckProofOfWork(block.GetPoWHash(), block.nBits, params)) {
+            ++block.nNonce;
+            --max_tries;
+        }
+        return std::make_pair(block.nNonce, max_tries);
+    };
+
+    for (int threads : {1, 3}) {
+        header.nNonce = InsecureRand32() >> 1;
+        const auto [nonce, tries_left] = serial(header, 1000);
+        CBlockHeader block{header};
+        uint64_t max_tries{1000};
+        BOOST_CHECK(node::GrindNonce(block, params, max_tries, threads));
+        BOOST_CHECK_EQUAL(block.nNonce, nonce);
+        BOOST_CHECK_EQUAL(max_tries, tries_left);
+
+        // Running out of tries leaves the nonce at the end of the range
+        block = header;
+        max_tries = nonce - header.nNonce;
+        BOOST_CHECK(!node::GrindNonce(block, params, max_tries, threads));
+        BOOST_CHECK_EQUAL(block.nNonce, nonce);
+        BOOST_CHECK_EQUAL(max_tries, 0U);
+    }
+
+    // The search stops short of the last nonce
+    header.nNonce = std::numeric_limits<uint32_t>::max() - 1;
+    uint64_t max_tries{1000};
+    if (!CheckProofOfWork(header.GetPoWHash(), header.nBits, params)) {
+        BOOST_CHECK(!node::GrindNonce(header, params, max_tries, 2));
+        BOOST_CHECK_EQUAL(header.nNonce, std::numeric_limits<uint32_t>::max());
+        BOOST_CHECK_EQUAL(max_tries, 999U);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(fast_pow)
+{
+    ArgsManager args;
+    args.ForceSetArg("-fastpow", "1");
+    for (const std::string& chain : {CBaseChainParams::MAIN, CBaseChainParams::TESTNET, CBaseChainParams::SIGNET}) {
+        BOOST_CHECK_THROW(CreateChainParams(args, chain), std::runtime_error);
+    }
+    BOOST_CHECK(!CreateChainParams(*m_node.args, CBaseChainParams::REGTEST)->GetConsensus().fPowSha256d);
+    const auto chain_params{CreateChainParams(args, CBaseChainParams::REGTEST)};
+    const Consensus::Params& params{chain_params->GetConsensus()};
+    BOOST_CHECK(params.fPowSha256d);
+
+    // The genesis block was mined for NeoScrypt, its SHA256d hash only passes as the genesis block
+    CBlockHeader header{chain_params->GenesisBlock().GetBlockHeader()};
+    BOOST_CHECK(CheckProofOfWork(header.GetHash(), header.nBits, params));
+    BOOST_CHECK(!CheckProofOfWork(header.GetHash(), header.nBits, CreateChainParams(*m_node.args, CBaseChainParams::REGTEST)->GetConsensus()));
+
+    header.hashPrevBlock = header.GetHash();
+    header.nBits = UintToArith256(params.powLimit).GetCompact();
+    const uint256 neoscrypt_hash{header.GetPoWHash()};
+    g_pow_hash_sha256d = true;
+    BOOST_CHECK_EQUAL(header.GetPoWHash(), header.GetHash());
+    uint256 hash;
+    PoWHashMany(hash.begin(), reinterpret_cast<const unsigned char*>(&header.nVersion), 1);
+    BOOST_CHECK_EQUAL(hash, header.GetHash());
+    uint64_t max_tries{1000};
+    BOOST_CHECK(node::GrindNonce(header, params, max_tries, 2));
+    BOOST_CHECK(CheckProofOfWork(header.GetHash(), header.nBits, params));
+    g_pow_hash_sha256d = false;
+    header.nNonce = chain_params->GenesisBlock().nNonce;
+    BOOST_CHECK_EQUAL(header.GetPoWHash(), neoscrypt_hash);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
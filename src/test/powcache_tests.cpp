@@ -0,0 +1,95 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <kernel/validation_cache_sizes.h>
+#include <node/blockstorage.h>
+#include <powcache.h>
+#include <primitives/block.h>
+#include <test/util/setup_common.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+static CBlockHeader RandomHeader()
+{
+    CBlockHeader header;
+    header.nVersion = 4;
+    header.hashPrevBlock = InsecureRand256();
+    header.hashMerkleRoot = InsecureRand256();
+    header.nTime = InsecureRand32();
+    header.nBits = 0x1e0fffff;
+    header.nNonce = InsecureRand32();
+    return header;
+}
+
+BOOST_FIXTURE_TEST_SUITE(powcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(powcache_hit_and_miss)
+{
+    const CBlockHeader header{RandomHeader()};
+    const uint256 expected{header.GetPoWHash()};
+
+    const PoWHashCacheStats before{GetPoWHashCacheStats()};
+    BOOST_CHECK(before.capacity > 0);
+
+    BOOST_CHECK_EQUAL(GetPoWHashCached(header), expected);
+    const PoWHashCacheStats after_miss{GetPoWHashCacheStats()};
+    BOOST_CHECK_EQUAL(after_miss.misses, before.misses + 1);
+    BOOST_CHECK_EQUAL(after_miss.hits, before.hits);
+
+    BOOST_CHECK_EQUAL(GetPoWHashCached(header), expected);
+    const PoWHashCacheStats after_hit{GetPoWHashCacheStats()};
+    BOOST_CHECK_EQUAL(after_hit.misses, before.misses + 1);
+    BOOST_CHECK_EQUAL(after_hit.hits, before.hits + 1);
+
+    // A header differing only in its nonce must not be served the cached hash.
+    CBlockHeader other{header};
+    ++other.nNonce;
+    BOOST_CHECK_EQUAL(GetPoWHashCached(other), other.GetPoWHash());
+    BOOST_CHECK(GetPoWHashCached(other) != expected);
+}
+
+BOOST_AUTO_TEST_CASE(powcache_disabled)
+{
+    BOOST_CHECK(InitPoWHashCache(0));
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().capacity, 0U);
+
+    const CBlockHeader header{RandomHeader()};
+    BOOST_CHECK_EQUAL(GetPoWHashCached(header), header.GetPoWHash());
+    BOOST_CHECK_EQUAL(GetPoWHashCached(header), header.GetPoWHash());
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().hits, 0U);
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().misses, 2U);
+
+    BOOST_CHECK(InitPoWHashCache(kernel::ValidationCacheSizes{}.pow_hash_cache_bytes));
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().capacity, DEFAULT_MAX_POW_CACHE_BYTES / (2 * sizeof(uint256)));
+}
+
+BOOST_FIXTURE_TEST_CASE(read_block_trusts_index, TestChain100Setup)
+{
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+    BOOST_CHECK(WITH_LOCK(::cs_main, return tip->IsValid(BLOCK_VALID_TREE)));
+    CBlock block;
+
+    // Start from a cold cache so every checked read has to look up the hash.
+    BOOST_CHECK(InitPoWHashCache(kernel::ValidationCacheSizes{}.pow_hash_cache_bytes));
+    BOOST_CHECK(node::ReadBlockFromDisk(block, tip, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(block.GetHash(), tip->GetBlockHash());
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().misses, 1U);
+
+    node::fTrustIndexedBlockPoW = true;
+    BOOST_CHECK(node::ReadBlockFromDisk(block, tip->pprev, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(block.GetHash(), tip->pprev->GetBlockHash());
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().misses, 1U);
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().hits, 0U);
+
+    // Reads by position are not tied to an index entry and are always checked.
+    const FlatFilePos pos{WITH_LOCK(::cs_main, return tip->pprev->GetBlockPos())};
+    BOOST_CHECK(node::ReadBlockFromDisk(block, pos, Params().GetConsensus()));
+    BOOST_CHECK_EQUAL(GetPoWHashCacheStats().misses, 2U);
+    node::fTrustIndexedBlockPoW = node::DEFAULT_TRUST_INDEXED_BLOCK_POW;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -6,11 +6,14 @@
 #include <interfaces/chain.h>
 #include <node/context.h>
 #include <rpc/blockchain.h>
+#include <rpc/cbor.h>
 #include <rpc/client.h>
+#include <rpc/request.h>
 #include <rpc/server.h>
 #include <rpc/util.h>
 #include <test/util/setup_common.h>
 #include <univalue.h>
+#include <util/strencodings.h>
 #include <util/time.h>
 
 #include <any>
@@ -433,6 +436,143 @@ BOOST_AUTO_TEST_CASE(rpc_getblockstats_calculate_percentiles_by_weight)
     }
 }
 
+BOOST_FIXTURE_TEST_CASE(rpc_tip_stats_cache, TestChain100Setup)
+{
+    const auto call{[&](const std::string& method, const UniValue& params) {
+        JSONRPCRequest request;
+        request.context = &m_node;
+        request.strMethod = method;
+        request.params = params;
+        if (RPCIsInWarmup(nullptr)) SetRPCWarmupFinished();
+        return tableRPC.execute(request);
+    }};
+    const auto tip{[&] { return WITH_LOCK(cs_main, return m_node.chainman->ActiveChain().Tip()); }};
+
+    // Without a notified tip the values are computed under cs_main
+    RPCNotifyBlockChange(nullptr);
+    BOOST_CHECK(!GetTipStatsCache());
+    const UniValue hashps{call("getnetworkhashps", UniValue{UniValue::VARR})};
+    BOOST_CHECK_EQUAL(call("getdifficulty", UniValue{UniValue::VARR}).get_real(), GetDifficulty(tip()));
+
+    // Estimates at the notified tip are kept until the next tip change
+    RPCNotifyBlockChange(tip());
+    const auto tip_stats{GetTipStatsCache()};
+    BOOST_REQUIRE(tip_stats);
+    BOOST_CHECK_EQUAL(tip_stats->tip, tip());
+    BOOST_CHECK_EQUAL(call("getdifficulty", UniValue{UniValue::VARR}).get_real(), tip_stats->difficulty);
+    BOOST_CHECK_EQUAL(call("getnetworkhashps", UniValue{UniValue::VARR}).write(), hashps.write());
+    UniValue past_params{UniValue::VARR};
+    past_params.push_back(120);
+    past_params.push_back(50);
+    call("getnetworkhashps", past_params);
+    BOOST_CHECK_EQUAL(WITH_LOCK(tip_stats->cs, return tip_stats->network_hashps.size()), 1U);
+    BOOST_CHECK_EQUAL(WITH_LOCK(tip_stats->cs, return tip_stats->network_hashps.count(120)), 1U);
+
+    // A new tip starts with an empty cache
+    CreateAndProcessBlock({}, CScript{} << OP_TRUE);
+    RPCNotifyBlockChange(tip());
+    const auto next_stats{GetTipStatsCache()};
+    BOOST_REQUIRE(next_stats && next_stats != tip_stats);
+    BOOST_CHECK_EQUAL(next_stats->tip, tip());
+    BOOST_CHECK(WITH_LOCK(next_stats->cs, return next_stats->network_hashps.empty()));
+    RPCNotifyBlockChange(nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(json_stream_writer)
+{
+    UniValue entry(UniValue::VOBJ);
+    entry.pushKV("txid", "ab\"cd");
+    entry.pushKV("vsize", 141);
+    entry.pushKV("fee", UniValue(UniValue::VNUM, "0.00001000"));
+    UniValue expected(UniValue::VOBJ);
+    expected.pushKV("hash", "00ff");
+    expected.pushKV("empty", UniValue(UniValue::VARR));
+    UniValue txs(UniValue::VARR);
+    for (int i = 0; i < 10; ++i) txs.push_back(entry);
+    expected.pushKV("tx", txs);
+
+    // Small pieces are flushed, and only the final one is marked last
+    std::string document;
+    int pieces{0};
+    bool got_last{false};
+    JSONStreamWriter writer{[&](std::string&& data, bool last) {
+        BOOST_CHECK(!got_last);
+        got_last = last;
+        document += data;
+        ++pieces;
+    }, /*flush_size=*/16};
+    BOOST_CHECK(writer.Empty());
+    writer.BeginObject();
+    writer.Key("hash");
+    writer.Value("00ff");
+    writer.Key("empty");
+    writer.BeginArray();
+    writer.EndArray();
+    writer.Key("tx");
+    writer.BeginArray();
+    for (int i = 0; i < 10; ++i) writer.Value(entry);
+    writer.EndArray();
+    writer.EndObject();
+    BOOST_CHECK(!writer.Empty());
+    BOOST_CHECK(pieces > 1);
+    BOOST_CHECK(!got_last);
+    writer.Finish();
+    BOOST_CHECK(got_last);
+    BOOST_CHECK_EQUAL(document, expected.write());
+
+    // Fields copy an object into the one being written
+    document.clear();
+    JSONStreamWriter whole{[&](std::string&& data, bool last) {
+        BOOST_CHECK(last);
+        document += data;
+    }};
+    whole.BeginObject();
+    whole.Fields(entry);
+    whole.EndObject();
+    whole.Finish();
+    BOOST_CHECK_EQUAL(document, entry.write());
+}
+
+static std::string CBORHex(const std::string& json)
+{
+    UniValue value;
+    BOOST_REQUIRE(value.read(json));
+    return HexStr(MakeUCharSpan(EncodeCBOR(value)));
+}
+
+BOOST_AUTO_TEST_CASE(rpc_cbor)
+{
+    BOOST_CHECK_EQUAL(CBORHex("null"), "f6");
+    BOOST_CHECK_EQUAL(CBORHex("true"), "f5");
+    BOOST_CHECK_EQUAL(CBORHex("false"), "f4");
+
+    // Integers take the shortest head
+    BOOST_CHECK_EQUAL(CBORHex("0"), "00");
+    BOOST_CHECK_EQUAL(CBORHex("23"), "17");
+    BOOST_CHECK_EQUAL(CBORHex("24"), "1818");
+    BOOST_CHECK_EQUAL(CBORHex("1000"), "1903e8");
+    BOOST_CHECK_EQUAL(CBORHex("4294967296"), "1b0000000100000000");
+    BOOST_CHECK_EQUAL(CBORHex("18446744073709551615"), "1bffffffffffffffff");
+    BOOST_CHECK_EQUAL(CBORHex("-1"), "20");
+    BOOST_CHECK_EQUAL(CBORHex("-1000"), "3903e7");
+
+    // Other numbers are exact decimal fractions of their digits
+    BOOST_CHECK_EQUAL(CBORHex("0.00001000"), "c482271903e8");
+    BOOST_CHECK_EQUAL(CBORHex("-2.5"), "c482203818");
+    BOOST_CHECK_EQUAL(CBORHex("1.5e3"), "c482020f");
+    // Digits beyond 64 bits are kept as written
+    BOOST_CHECK_EQUAL(CBORHex("123456789012345678901"), "75" + HexStr(MakeUCharSpan(std::string{"123456789012345678901"})));
+
+    // Lowercase hex strings are bytes, other strings text
+    BOOST_CHECK_EQUAL(CBORHex("\"00ff\""), "d74200ff");
+    BOOST_CHECK_EQUAL(CBORHex("\"0A\""), "623041");
+    BOOST_CHECK_EQUAL(CBORHex("\"abc\""), "63616263");
+    BOOST_CHECK_EQUAL(CBORHex("\"\""), "60");
+
+    BOOST_CHECK_EQUAL(CBORHex("[1,\"a\",[]]"), "8301616180");
+    BOOST_CHECK_EQUAL(CBORHex("{\"a\":1,\"b\":{}}"), "a26161016162a0");
+}
+
 BOOST_AUTO_TEST_CASE(help_example)
 {
     // test different argument types
@@ -169,6 +169,27 @@ BOOST_AUTO_TEST_CASE(singlethreadedscheduler_ordered)
     BOOST_CHECK_EQUAL(counter2, 100);
 }
 
+BOOST_AUTO_TEST_CASE(due_tasks_ordered)
+{
+    CScheduler scheduler;
+
+    // Tasks that are already due run in the order of their times, whether or
+    // not they were scheduled in that order
+    std::vector<int> order;
+    const auto now{std::chrono::steady_clock::now()};
+    for (const int offset : {-5, -3, -4, -1, -1, -2, 0}) {
+        scheduler.schedule([&order, offset] { order.push_back(offset); }, now + std::chrono::seconds{offset});
+    }
+    std::chrono::steady_clock::time_point first, last;
+    BOOST_CHECK_EQUAL(scheduler.getQueueInfo(first, last), 7ul);
+    BOOST_CHECK(first == now - std::chrono::seconds{5});
+    BOOST_CHECK(last == now);
+
+    scheduler.m_service_thread = std::thread{[&] { scheduler.serviceQueue(); }};
+    scheduler.StopWhenDrained();
+    BOOST_CHECK((order == std::vector<int>{-5, -4, -3, -2, -1, -1, 0}));
+}
+
 BOOST_AUTO_TEST_CASE(mockforward)
 {
     CScheduler scheduler;
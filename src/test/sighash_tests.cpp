@@ -137,6 +137,10 @@ BOOST_AUTO_TEST_CASE(sighash_test)
         uint256 sh, sho;
         sho = SignatureHashOld(scriptCode, CTransaction(txTo), nIn, nHashType);
         sh = SignatureHash(scriptCode, txTo, nIn, nHashType, 0, SigVersion::BASE);
+        // The same through the precomputed legacy serialization, for transactions with several inputs
+        const PrecomputedTransactionData txdata{txTo};
+        BOOST_CHECK_EQUAL(txdata.m_legacy_all_ready, txTo.vin.size() >= 2);
+        BOOST_CHECK(SignatureHash(scriptCode, txTo, nIn, nHashType, 0, SigVersion::BASE, &txdata) == sho);
         #if defined(PRINT_SIGHASH_JSON)
         CDataStream ss(SER_NETWORK, PROTOCOL_VERSION);
         ss << txTo;
@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <compat/compat.h>
+#include <span.h>
 #include <test/util/setup_common.h>
 #include <threadinterrupt.h>
 #include <util/sock.h>
@@ -12,6 +13,7 @@
 
 #include <cassert>
 #include <thread>
+#include <vector>
 
 using namespace std::chrono_literals;
 
@@ -113,6 +115,25 @@ BOOST_AUTO_TEST_CASE(send_and_receive)
     BOOST_CHECK(SocketIsClosed(s[1]));
 }
 
+BOOST_AUTO_TEST_CASE(send_many)
+{
+    int s[2];
+    CreateSocketPair(s);
+
+    Sock sock0(s[0]);
+    Sock sock1(s[1]);
+
+    const std::vector<unsigned char> header{'a', 'b'};
+    const std::vector<unsigned char> payload{'c', 'd', 'e'};
+    const std::vector<Span<const unsigned char>> buffers{header, Span<const unsigned char>{}, payload};
+    BOOST_CHECK_EQUAL(sock0.SendMany(buffers, 0), 5);
+    BOOST_CHECK_EQUAL(sock0.SendMany({}, 0), 0);
+
+    char recv_buf[10];
+    BOOST_CHECK_EQUAL(sock1.Recv(recv_buf, sizeof(recv_buf), 0), 5);
+    BOOST_CHECK_EQUAL(strncmp("abcde", recv_buf, 5), 0);
+}
+
 BOOST_AUTO_TEST_CASE(wait)
 {
     int s[2];
@@ -128,6 +149,53 @@ BOOST_AUTO_TEST_CASE(wait)
     waiter.join();
 }
 
+BOOST_AUTO_TEST_CASE(poller)
+{
+    auto poller{SockPoller::Make()};
+#if defined(__linux__) || defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+    BOOST_REQUIRE(poller);
+#endif
+    if (!poller) return;
+
+    int s[2];
+    CreateSocketPair(s);
+    auto sock0{std::make_shared<const Sock>(s[0])};
+    auto sock1{std::make_shared<const Sock>(s[1])};
+
+    Sock::EventsPerSock events_per_sock;
+    BOOST_REQUIRE(poller->Set(sock0, Sock::RECV));
+    BOOST_REQUIRE(poller->Wait(0ms, events_per_sock));
+    BOOST_CHECK(events_per_sock.empty());
+
+    BOOST_REQUIRE_EQUAL(sock1->Send("a", 1, 0), 1);
+    BOOST_REQUIRE(poller->Wait(24h, events_per_sock));
+    BOOST_REQUIRE_EQUAL(events_per_sock.size(), 1U);
+    BOOST_CHECK(events_per_sock.begin()->first == sock0);
+    BOOST_CHECK(events_per_sock.begin()->second.occurred & Sock::RECV);
+
+    // Readiness is level triggered, and changing the requested events is passed on
+    BOOST_REQUIRE(poller->Wait(0ms, events_per_sock));
+    BOOST_CHECK_EQUAL(events_per_sock.size(), 1U);
+    BOOST_REQUIRE(poller->Set(sock0, 0));
+    BOOST_REQUIRE(poller->Wait(0ms, events_per_sock));
+    BOOST_CHECK(events_per_sock.empty());
+
+    // A socket that was not set again is no longer waited on, nor kept open
+    BOOST_REQUIRE(poller->Set(sock1, Sock::SEND));
+    poller->RemoveUnset();
+    BOOST_CHECK_EQUAL(poller->Size(), 2U);
+    sock0.reset();
+    BOOST_CHECK(!SocketIsClosed(s[0]));
+    BOOST_REQUIRE(poller->Set(sock1, Sock::SEND));
+    poller->RemoveUnset();
+    BOOST_CHECK_EQUAL(poller->Size(), 1U);
+    BOOST_CHECK(SocketIsClosed(s[0]));
+    BOOST_REQUIRE(poller->Wait(24h, events_per_sock));
+    BOOST_REQUIRE_EQUAL(events_per_sock.size(), 1U);
+    BOOST_CHECK(events_per_sock.begin()->first == sock1);
+    BOOST_CHECK(events_per_sock.begin()->second.occurred & Sock::SEND);
+}
+
 BOOST_AUTO_TEST_CASE(recv_until_terminator_limit)
 {
     constexpr auto timeout = 1min; // High enough so that it is never hit.
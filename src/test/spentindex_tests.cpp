@@ -0,0 +1,66 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <consensus/amount.h>
+#include <index/spentindex.h>
+#include <interfaces/chain.h>
+#include <primitives/transaction.h>
+#include <script/standard.h>
+#include <test/util/setup_common.h>
+#include <util/time.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <chrono>
+
+BOOST_AUTO_TEST_SUITE(spentindex_tests)
+
+static void IndexWaitSynced(BaseIndex& index)
+{
+    // Allow the SpentIndex to catch up with the block index that is syncing
+    // in a background thread.
+    const auto timeout = GetTime<std::chrono::seconds>() + 120s;
+    while (!index.BlockUntilSyncedToCurrentChain()) {
+        BOOST_REQUIRE(timeout > GetTime<std::chrono::milliseconds>());
+        UninterruptibleSleep(100ms);
+    }
+}
+
+BOOST_FIXTURE_TEST_CASE(spentindex_find_spender, TestChain100Setup)
+{
+    const CScript coinbase_script{CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG};
+    const CScript dest_script{GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()))};
+
+    // Spend the first coinbase before the index is started, so the initial sync finds it
+    const CMutableTransaction first_spend{CreateValidMempoolTransaction(m_coinbase_txns[0], 0, 1, coinbaseKey, dest_script, 1 * COIN, /*submit=*/false)};
+    CreateAndProcessBlock({first_spend}, coinbase_script);
+
+    SpentIndex index{interfaces::MakeChain(m_node), 1 << 20, true};
+    BOOST_REQUIRE(index.Start());
+    IndexWaitSynced(index);
+
+    SpentIndexEntry spender;
+    BOOST_REQUIRE(index.FindSpender(COutPoint{m_coinbase_txns[0]->GetHash(), 0}, spender));
+    BOOST_CHECK_EQUAL(spender.txid, first_spend.GetHash());
+    BOOST_CHECK_EQUAL(spender.vin, 0U);
+    BOOST_CHECK_EQUAL(spender.height, 101);
+    BOOST_CHECK_EQUAL(spender.block_hash, WITH_LOCK(cs_main, return m_node.chainman->ActiveChain()[101]->GetBlockHash()));
+
+    // Unspent outputs, and outputs that do not exist, have no spender
+    BOOST_CHECK(!index.FindSpender(COutPoint{m_coinbase_txns[1]->GetHash(), 0}, spender));
+    BOOST_CHECK(!index.FindSpender(COutPoint{m_coinbase_txns[0]->GetHash(), 1}, spender));
+
+    // Spends connected after the initial sync are indexed as well
+    const CMutableTransaction second_spend{CreateValidMempoolTransaction(m_coinbase_txns[1], 0, 2, coinbaseKey, dest_script, 1 * COIN, /*submit=*/false)};
+    CreateAndProcessBlock({second_spend}, coinbase_script);
+    BOOST_REQUIRE(index.BlockUntilSyncedToCurrentChain());
+    BOOST_REQUIRE(index.FindSpender(COutPoint{m_coinbase_txns[1]->GetHash(), 0}, spender));
+    BOOST_CHECK_EQUAL(spender.txid, second_spend.GetHash());
+    BOOST_CHECK_EQUAL(spender.height, 102);
+
+    index.Stop();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
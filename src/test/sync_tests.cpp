@@ -7,8 +7,13 @@
 
 #include <boost/test/unit_test.hpp>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <mutex>
+#include <optional>
 #include <stdexcept>
+#include <thread>
 
 namespace {
 template <typename MutexType>
@@ -140,4 +145,64 @@ BOOST_AUTO_TEST_CASE(inconsistent_lock_order_detected)
 #endif // DEBUG_LOCKORDER
 }
 
+BOOST_AUTO_TEST_CASE(lock_stats)
+{
+    const auto find_site = [](const std::string& name) -> std::optional<LockSiteInfo> {
+        for (const LockSiteInfo& info : GetLockStats()) {
+            if (info.name == name) return info;
+        }
+        return std::nullopt;
+    };
+
+    Mutex stats_mutex;
+    // Nothing is recorded while the profiler is disabled
+    SetLockStatsEnabled(false);
+    { LOCK(stats_mutex); }
+    BOOST_CHECK(!find_site("stats_mutex"));
+
+    SetLockStatsEnabled(true);
+    for (int i = 0; i < 3; ++i) {
+        LOCK(stats_mutex);
+    }
+    {
+        TRY_LOCK(stats_mutex, locked);
+        BOOST_CHECK(bool{locked});
+    }
+    {
+        // Make another thread wait for the lock held here
+        WAIT_LOCK(stats_mutex, lock);
+        std::atomic<bool> started{false};
+        std::thread waiter{[&] {
+            started = true;
+            LOCK(stats_mutex);
+        }};
+        while (!started) std::this_thread::yield();
+        UninterruptibleSleep(std::chrono::milliseconds{20});
+        REVERSE_LOCK(lock);
+        waiter.join();
+    }
+
+    uint64_t count{0}, holds{0}, contended{0}, waits{0};
+    std::chrono::microseconds max_wait{0};
+    for (const LockSiteInfo& info : GetLockStats()) {
+        if (info.name != "stats_mutex") continue;
+        BOOST_CHECK_EQUAL(info.file, __FILE__);
+        count += info.count;
+        holds += info.holds;
+        contended += info.contended;
+        max_wait = std::max(max_wait, info.max_wait);
+        for (const uint64_t n : info.wait_histogram) waits += n;
+    }
+    // Three LOCKs, the TRY_LOCK, the WAIT_LOCK and the waiter's LOCK
+    BOOST_CHECK_EQUAL(count, 6U);
+    BOOST_CHECK_EQUAL(holds, 6U);
+    BOOST_CHECK_EQUAL(waits, 6U);
+    BOOST_CHECK_EQUAL(contended, 1U);
+    BOOST_CHECK(max_wait >= std::chrono::milliseconds{10});
+
+    SetLockStatsEnabled(false);
+    ResetLockStats();
+    BOOST_CHECK(!find_site("stats_mutex"));
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -17,6 +17,7 @@
 #include <policy/settings.h>
 #include <script/script.h>
 #include <script/script_error.h>
+#include <script/sigcache.h>
 #include <script/sign.h>
 #include <script/signingprovider.h>
 #include <script/standard.h>
@@ -417,6 +418,48 @@ BOOST_AUTO_TEST_CASE(basic_transaction_tests)
     BOOST_CHECK_MESSAGE(!CheckTransaction(CTransaction(tx), state) || !state.IsValid(), "Transaction with duplicate txins should be invalid.");
 }
 
+BOOST_AUTO_TEST_CASE(tx_duplicate_inputs)
+{
+    const COutPoint blocked{uint256S("2e3cac6c9c4283caae1d11a575bbf9bdce153a35d537917c63a2f3f995983fd8"), 312};
+    const auto check = [](const std::vector<COutPoint>& prevouts, std::vector<COutPoint>& scratch) {
+        CMutableTransaction mtx;
+        for (const COutPoint& prevout : prevouts) mtx.vin.emplace_back(prevout);
+        mtx.vout.emplace_back(CENT, CScript() << OP_1);
+        TxValidationState state;
+        CheckTransaction(CTransaction(mtx), state, scratch);
+        return state.GetRejectReason();
+    };
+
+    std::vector<COutPoint> scratch;
+    // Both the pairwise comparison of small transactions and the sorted check of larger ones
+    for (const size_t size : {2, 3, 8, 9, 100}) {
+        std::vector<COutPoint> prevouts;
+        for (size_t i = 0; i < size; ++i) prevouts.emplace_back(InsecureRand256(), i);
+        BOOST_CHECK_EQUAL(check(prevouts, scratch), "");
+
+        for (size_t i = 1; i < size; ++i) {
+            std::vector<COutPoint> duplicated{prevouts};
+            duplicated[i] = duplicated[InsecureRandRange(i)];
+            BOOST_CHECK_EQUAL(check(duplicated, scratch), "bad-txns-inputs-duplicate");
+        }
+
+        // Same hash, different index: not a duplicate
+        std::vector<COutPoint> same_hash{prevouts};
+        for (size_t i = 0; i < size; ++i) same_hash[i].hash = prevouts[0].hash;
+        BOOST_CHECK_EQUAL(check(same_hash, scratch), "");
+
+        // The first of a duplicate and a blocked input is reported
+        std::vector<COutPoint> with_blocked{prevouts};
+        with_blocked[0] = blocked;
+        with_blocked[size - 1] = with_blocked[size - 2];
+        BOOST_CHECK_EQUAL(check(with_blocked, scratch), "bad-txns-inputs-blocked");
+        with_blocked = prevouts;
+        with_blocked[1] = with_blocked[0];
+        with_blocked[size - 1] = blocked;
+        BOOST_CHECK_EQUAL(check(with_blocked, scratch), "bad-txns-inputs-duplicate");
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_Get)
 {
     FillableSigningProvider keystore;
@@ -591,6 +634,59 @@ BOOST_AUTO_TEST_CASE(test_big_witness_transaction)
     scriptcheckqueue.StopWorkerThreads();
 }
 
+BOOST_AUTO_TEST_CASE(script_check_signature_batch)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    FillableSigningProvider keystore;
+    BOOST_CHECK(keystore.AddKeyPubKey(key, key.GetPubKey()));
+    const CKeyID hash{key.GetPubKey().GetID()};
+    // Pay-to-pubkey-hash and pay-to-witness-pubkey-hash inputs
+    const std::vector<CScript> script_pubkeys{GetScriptForDestination(PKHash(hash)), GetScriptForDestination(WitnessV0KeyHash(hash))};
+
+    CMutableTransaction mtx;
+    for (uint32_t i = 0; i < 8; ++i) {
+        mtx.vin.emplace_back(COutPoint(uint256::ONE, i));
+        mtx.vout.emplace_back(1000, CScript() << OP_1);
+    }
+    for (uint32_t i = 0; i < mtx.vin.size(); ++i) {
+        BOOST_REQUIRE(SignSignature(keystore, script_pubkeys[i % 2], mtx, i, 1000, SIGHASH_ALL));
+    }
+
+    const auto check_all = [&](const CMutableTransaction& spend, bool batched) {
+        const CTransaction tx(spend);
+        PrecomputedTransactionData txdata(tx);
+        SignatureBatch batch;
+        bool ok{true};
+        for (uint32_t i = 0; i < tx.vin.size(); ++i) {
+            CScriptCheck check(CTxOut(1000, script_pubkeys[i % 2]), tx, i, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, false, &txdata);
+            ok &= check(batched ? &batch : nullptr);
+        }
+        // Every ECDSA signature of these scripts can be deferred
+        if (batched) {
+            BOOST_CHECK(ok);
+            BOOST_CHECK_EQUAL(batch.size(), tx.vin.size());
+            ok = batch.Verify();
+            BOOST_CHECK_EQUAL(batch.size(), 0U);
+        }
+        return ok;
+    };
+    BOOST_CHECK(check_all(mtx, /*batched=*/false));
+    BOOST_CHECK(check_all(mtx, /*batched=*/true));
+
+    // Valid signatures for other inputs make the batch fail
+    for (const bool witness : {false, true}) {
+        CMutableTransaction swapped{mtx};
+        if (!witness) {
+            std::swap(swapped.vin[0].scriptSig, swapped.vin[2].scriptSig);
+        } else {
+            std::swap(swapped.vin[1].scriptWitness.stack, swapped.vin[3].scriptWitness.stack);
+        }
+        BOOST_CHECK(!check_all(swapped, /*batched=*/false));
+        BOOST_CHECK(!check_all(swapped, /*batched=*/true));
+    }
+}
+
 SignatureData CombineSignatures(const CMutableTransaction& input1, const CMutableTransaction& input2, const CTransactionRef tx)
 {
     SignatureData sigdata;
@@ -780,6 +876,62 @@ BOOST_AUTO_TEST_CASE(test_witness)
     CheckWithFlag(output1, input1, STANDARD_SCRIPT_VERIFY_FLAGS, true);
 }
 
+BOOST_AUTO_TEST_CASE(tx_hashes)
+{
+    // The txid, wtxid and sizes are computed in one pass, and must match each serialization
+    CMutableTransaction mtx;
+    mtx.nVersion = 2;
+    mtx.nLockTime = 123;
+    for (int i = 0; i < 3; ++i) {
+        mtx.vin.emplace_back(COutPoint{InsecureRand256(), InsecureRand32()}, CScript() << OP_1, i);
+        mtx.vout.emplace_back(i * COIN, CScript() << OP_0 << std::vector<unsigned char>(20, i));
+    }
+    const CTransaction tx_without_witness{mtx};
+    BOOST_CHECK_EQUAL(tx_without_witness.GetHash(), SerializeHash(mtx, SER_GETHASH, SERIALIZE_TRANSACTION_NO_WITNESS));
+    BOOST_CHECK_EQUAL(tx_without_witness.GetWitnessHash(), tx_without_witness.GetHash());
+    BOOST_CHECK_EQUAL(tx_without_witness.GetStrippedSize(), ::GetSerializeSize(mtx, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS));
+    BOOST_CHECK_EQUAL(tx_without_witness.GetTotalSize(), tx_without_witness.GetStrippedSize());
+
+    // Only some of the inputs have a witness
+    mtx.vin[0].scriptWitness.stack = {std::vector<unsigned char>(72, 1), std::vector<unsigned char>(33, 2)};
+    mtx.vin[2].scriptWitness.stack = {{}, std::vector<unsigned char>(300, 3)};
+    const CTransaction tx{mtx};
+    BOOST_CHECK_EQUAL(tx.GetHash(), tx_without_witness.GetHash());
+    BOOST_CHECK_EQUAL(tx.GetWitnessHash(), SerializeHash(mtx, SER_GETHASH, 0));
+    BOOST_CHECK(tx.GetWitnessHash() != tx.GetHash());
+    BOOST_CHECK_EQUAL(tx.GetStrippedSize(), tx_without_witness.GetStrippedSize());
+    BOOST_CHECK_EQUAL(tx.GetTotalSize(), ::GetSerializeSize(mtx, PROTOCOL_VERSION));
+    BOOST_CHECK_EQUAL(GetTransactionWeight(tx), ::GetSerializeSize(mtx, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) * (WITNESS_SCALE_FACTOR - 1) + ::GetSerializeSize(mtx, PROTOCOL_VERSION));
+}
+
+BOOST_AUTO_TEST_CASE(tx_hashes_batch)
+{
+    // The transactions of a block hashed together get the same txids and wtxids as one by one
+    std::vector<CMutableTransaction> mtxs;
+    for (int i = 0; i < 20; ++i) {
+        CMutableTransaction mtx;
+        mtx.nLockTime = i;
+        for (int j = 0; j <= i % 4; ++j) {
+            mtx.vin.emplace_back(COutPoint{InsecureRand256(), InsecureRand32()}, CScript() << g_insecure_rand_ctx.randbytes(i * 7));
+            mtx.vout.emplace_back(j * COIN, CScript() << OP_0 << std::vector<unsigned char>(20, j));
+        }
+        if (i % 3) mtx.vin[0].scriptWitness.stack = {g_insecure_rand_ctx.randbytes(72), g_insecure_rand_ctx.randbytes(33)};
+        mtxs.push_back(mtx);
+    }
+    for (size_t count : {0, 1, 8, 20}) {
+        const std::vector<CTransactionRef> refs{MakeTransactionRefs({mtxs.begin(), mtxs.begin() + count})};
+        BOOST_REQUIRE_EQUAL(refs.size(), count);
+        for (size_t i = 0; i < count; ++i) {
+            const CTransaction tx{mtxs[i]};
+            BOOST_CHECK_EQUAL(refs[i]->GetHash(), tx.GetHash());
+            BOOST_CHECK_EQUAL(refs[i]->GetWitnessHash(), tx.GetWitnessHash());
+            BOOST_CHECK_EQUAL(refs[i]->GetStrippedSize(), tx.GetStrippedSize());
+            BOOST_CHECK_EQUAL(refs[i]->GetTotalSize(), tx.GetTotalSize());
+            BOOST_CHECK(*refs[i] == tx);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_CASE(test_IsStandard)
 {
     FillableSigningProvider keystore;
@@ -813,7 +965,7 @@ BOOST_AUTO_TEST_CASE(test_IsStandard)
     CheckIsStandard(t);
 
     // Check dust with default relay fee:
-    CAmount nDustThreshold = 182 * dustRelayFee.GetFeePerK()/1000;
+    CAmount nDustThreshold = 182 * g_dust.GetFeePerK()/1000;
     BOOST_CHECK_EQUAL(nDustThreshold, 54600);
     // dust:
     t.vout[0].nValue = nDustThreshold - 1;
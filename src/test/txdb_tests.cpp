@@ -0,0 +1,171 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <chain.h>
+#include <chainparams.h>
+#include <coins.h>
+#include <primitives/block.h>
+#include <random.h>
+#include <sync.h>
+#include <test/util/setup_common.h>
+#include <txdb.h>
+#include <validation.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <set>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txdb_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(load_block_index_guts)
+{
+    // A chain with a fork, whose hashes are spread over all key buckets
+    std::deque<uint256> hashes;
+    std::vector<std::unique_ptr<CBlockIndex>> indices;
+    auto add_block = [&](CBlockIndex* prev, uint32_t nonce) {
+        CBlockHeader header;
+        header.nVersion = 4;
+        header.hashPrevBlock = prev ? prev->GetBlockHash() : uint256();
+        header.nTime = 1600000000 + nonce;
+        header.nBits = 0x207fffff;
+        header.nNonce = nonce;
+        auto index{std::make_unique<CBlockIndex>(header)};
+        index->pprev = prev;
+        index->nHeight = prev ? prev->nHeight + 1 : 0;
+        index->nStatus = nonce % 2 ? BLOCK_VALID_TREE : BLOCK_VALID_TRANSACTIONS | BLOCK_HAVE_DATA;
+        index->nFile = nonce / 100;
+        index->nDataPos = nonce;
+        index->nTx = nonce % 7;
+        hashes.push_back(header.GetHash());
+        index->phashBlock = &hashes.back();
+        indices.push_back(std::move(index));
+        return indices.back().get();
+    };
+    CBlockIndex* tip{add_block(nullptr, 0)};
+    CBlockIndex* fork_point{nullptr};
+    for (uint32_t i = 1; i < 3000; ++i) {
+        tip = add_block(tip, i);
+        if (i == 1000) fork_point = tip;
+    }
+    for (uint32_t i = 3000; i < 3500; ++i) {
+        fork_point = add_block(fork_point, i);
+    }
+
+    CBlockTreeDB db{1 << 20, /*fMemory=*/true, /*fWipe=*/true};
+    std::vector<const CBlockIndex*> blockinfo;
+    for (const auto& index : indices) blockinfo.push_back(index.get());
+    BOOST_REQUIRE(db.WriteBatchSync({}, 0, blockinfo));
+
+    LOCK(cs_main);
+    for (int num_threads : {1, 3, 16}) {
+        std::map<uint256, CBlockIndex> loaded;
+        BOOST_REQUIRE(db.LoadBlockIndexGuts(Params().GetConsensus(), [&](const uint256& hash) -> CBlockIndex* {
+            if (hash.IsNull()) return nullptr;
+            const auto [it, inserted]{loaded.try_emplace(hash)};
+            if (inserted) it->second.phashBlock = &it->first;
+            return &it->second;
+        }, num_threads));
+
+        BOOST_REQUIRE_EQUAL(loaded.size(), indices.size());
+        for (const auto& index : indices) {
+            const CBlockIndex& copy{loaded.at(index->GetBlockHash())};
+            BOOST_CHECK_EQUAL(copy.nHeight, index->nHeight);
+            BOOST_CHECK_EQUAL(copy.nStatus, index->nStatus);
+            BOOST_CHECK_EQUAL(copy.nTx, index->nTx);
+            BOOST_CHECK_EQUAL(copy.nFile, (index->nStatus & BLOCK_HAVE_DATA) ? index->nFile : 0);
+            BOOST_CHECK_EQUAL(copy.nTime, index->nTime);
+            BOOST_CHECK_EQUAL(copy.nNonce, index->nNonce);
+            BOOST_CHECK(copy.GetBlockHeader().GetHash() == index->GetBlockHash());
+            if (index->pprev) {
+                BOOST_REQUIRE(copy.pprev);
+                BOOST_CHECK(copy.pprev->GetBlockHash() == index->pprev->GetBlockHash());
+            } else {
+                BOOST_CHECK(!copy.pprev);
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(async_coins_write)
+{
+    CCoinsViewDB db{"test", /*nCacheSize=*/1 << 20, /*fMemory=*/true, /*fWipe=*/true, /*async_write=*/true};
+    std::vector<COutPoint> outpoints;
+    for (uint32_t i = 0; i < 1000; ++i) outpoints.emplace_back(InsecureRand256(), i);
+
+    // Write the coins in one batch per block, spending the coins of the block before
+    uint256 block_hash;
+    for (size_t block = 0; block < 10; ++block) {
+        CCoinsViewCache cache{&db};
+        for (size_t i = block * 100; i < (block + 1) * 100; ++i) {
+            cache.AddCoin(outpoints[i], Coin{CTxOut{int64_t(i) + 1, CScript{}}, /*nHeightIn=*/int(block), /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+            if (block > 0) BOOST_CHECK(cache.SpendCoin(outpoints[i - 100]));
+        }
+        block_hash = InsecureRand256();
+        cache.SetBestBlock(block_hash);
+        BOOST_REQUIRE(cache.Flush());
+
+        // The batch is visible right away, whether it was written yet or not
+        BOOST_CHECK(db.GetBestBlock() == block_hash);
+        for (size_t i = 0; i < (block + 1) * 100; ++i) {
+            Coin coin;
+            const bool unspent{i >= block * 100};
+            BOOST_CHECK_EQUAL(db.HaveCoin(outpoints[i]), unspent);
+            BOOST_CHECK_EQUAL(db.GetCoin(outpoints[i], coin), unspent);
+            if (unspent) BOOST_CHECK_EQUAL(coin.out.nValue, int64_t(i) + 1);
+        }
+    }
+
+    BOOST_REQUIRE(db.WaitForWrites());
+    BOOST_CHECK(db.GetHeadBlocks().empty());
+    BOOST_CHECK(db.GetBestBlock() == block_hash);
+    size_t num_coins{0};
+    for (auto cursor{db.Cursor()}; cursor->Valid(); cursor->Next()) ++num_coins;
+    BOOST_CHECK_EQUAL(num_coins, 100U);
+
+    // Looking the coins up at once gives the same result
+    std::vector<Coin> coins(outpoints.size());
+    db.GetCoins(outpoints, coins);
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        BOOST_CHECK_EQUAL(coins[i].IsSpent(), i < 900);
+        if (i >= 900) BOOST_CHECK_EQUAL(coins[i].out.nValue, int64_t(i) + 1);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(coins_cursor_start)
+{
+    CCoinsViewDB db{"test", /*nCacheSize=*/1 << 20, /*fMemory=*/true, /*fWipe=*/true};
+    std::set<COutPoint> outpoints;
+    {
+        CCoinsViewCache cache{&db};
+        for (uint32_t i = 0; i < 300; ++i) {
+            const COutPoint outpoint{InsecureRand256(), i % 3};
+            outpoints.insert(outpoint);
+            cache.AddCoin(outpoint, Coin{CTxOut{int64_t(i) + 1, CScript{}}, /*nHeightIn=*/1, /*fCoinBaseIn=*/false}, /*possible_overwrite=*/false);
+        }
+        cache.SetBestBlock(InsecureRand256());
+        BOOST_REQUIRE(cache.Flush());
+    }
+
+    // Cursors starting at the ranges of txids by their first byte together see every coin once
+    std::set<COutPoint> seen;
+    for (unsigned int first_byte = 0; first_byte < 0x100; first_byte += 0x40) {
+        uint256 start;
+        *start.begin() = first_byte;
+        for (auto cursor{db.Cursor(start)}; cursor->Valid(); cursor->Next()) {
+            COutPoint outpoint;
+            BOOST_REQUIRE(cursor->GetKey(outpoint));
+            BOOST_CHECK_GE(*outpoint.hash.begin(), first_byte);
+            if (*outpoint.hash.begin() >= first_byte + 0x40) break;
+            BOOST_CHECK(seen.insert(outpoint).second);
+        }
+    }
+    BOOST_CHECK(seen == outpoints);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -54,6 +54,20 @@ BOOST_FIXTURE_TEST_CASE(txindex_initial_sync, TestChain100Setup)
         }
     }
 
+    // Look them up at once, with a hash that is not in the index.
+    std::vector<uint256> tx_hashes;
+    for (const auto& txn : m_coinbase_txns) tx_hashes.push_back(txn->GetHash());
+    tx_hashes.push_back(InsecureRand256());
+    const auto found{txindex.FindTxs(tx_hashes)};
+    BOOST_REQUIRE_EQUAL(found.size(), tx_hashes.size());
+    for (size_t i = 0; i < m_coinbase_txns.size(); ++i) {
+        BOOST_REQUIRE(found[i]);
+        BOOST_CHECK_EQUAL(found[i]->second->GetHash(), tx_hashes[i]);
+        BOOST_CHECK(txindex.FindTx(tx_hashes[i], block_hash, tx_disk));
+        BOOST_CHECK_EQUAL(found[i]->first, block_hash);
+    }
+    BOOST_CHECK(!found.back());
+
     // Check that new transactions in new blocks make it into the index.
     for (int i = 0; i < 10; i++) {
         CScript coinbase_script_pub_key = GetScriptForDestination(PKHash(coinbaseKey.GetPubKey()));
@@ -0,0 +1,190 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <node/txreconciliation.h>
+
+#include <test/util/setup_common.h>
+
+#include <boost/test/unit_test.hpp>
+
+#include <algorithm>
+#include <vector>
+
+BOOST_FIXTURE_TEST_SUITE(txreconciliation_tests, BasicTestingSetup)
+
+/** Register peer 0 of an initiator tracker and peer 1 of a responder tracker with each other. */
+static void RegisterPair(TxReconciliationTracker& initiator, TxReconciliationTracker& responder)
+{
+    const uint64_t initiator_salt{initiator.PreRegisterPeer(0)};
+    const uint64_t responder_salt{responder.PreRegisterPeer(1)};
+    BOOST_REQUIRE(initiator.RegisterPeer(/*peer_id=*/0, /*is_peer_inbound=*/false, TXRECONCILIATION_VERSION, responder_salt) ==
+                  ReconciliationRegisterResult::SUCCESS);
+    BOOST_REQUIRE(responder.RegisterPeer(/*peer_id=*/1, /*is_peer_inbound=*/true, TXRECONCILIATION_VERSION, initiator_salt) ==
+                  ReconciliationRegisterResult::SUCCESS);
+}
+
+/** Run one reconciliation due at now from the request to the difference, with both sides announcing. */
+static void Reconcile(TxReconciliationTracker& initiator, TxReconciliationTracker& responder, std::chrono::microseconds now,
+                      bool& success, std::vector<uint256>& initiator_announces, std::vector<uint256>& responder_announces)
+{
+    const auto request{initiator.InitiateReconciliationRequest(0, now)};
+    BOOST_REQUIRE(request);
+    // Only one reconciliation is in flight at a time
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(0, now + RECON_REQUEST_INTERVAL));
+
+    std::vector<unsigned char> skdata;
+    BOOST_REQUIRE(responder.HandleReconciliationRequest(1, request->first, request->second, skdata));
+    std::vector<uint32_t> ask_shortids;
+    BOOST_REQUIRE(initiator.HandleSketch(0, skdata, success, initiator_announces, ask_shortids));
+    BOOST_REQUIRE(responder.HandleReconciliationDifference(1, success, ask_shortids, responder_announces));
+}
+
+BOOST_AUTO_TEST_CASE(RegisterPeerTest)
+{
+    TxReconciliationTracker tracker(TXRECONCILIATION_VERSION);
+    const uint64_t salt = 0;
+
+    // Prepare a peer for reconciliation.
+    tracker.PreRegisterPeer(0);
+
+    // Invalid version.
+    BOOST_CHECK_EQUAL(tracker.RegisterPeer(/*peer_id=*/0, /*is_peer_inbound=*/true,
+                                           /*peer_recon_version=*/0, salt),
+                      ReconciliationRegisterResult::PROTOCOL_VIOLATION);
+
+    // Valid registration (inbound and outbound peers).
+    BOOST_REQUIRE(!tracker.IsPeerRegistered(0));
+    BOOST_REQUIRE_EQUAL(tracker.RegisterPeer(0, true, 1, salt), ReconciliationRegisterResult::SUCCESS);
+    BOOST_CHECK(tracker.IsPeerRegistered(0));
+    BOOST_REQUIRE(!tracker.IsPeerRegistered(1));
+    tracker.PreRegisterPeer(1);
+    BOOST_REQUIRE(tracker.RegisterPeer(1, false, 1, salt) == ReconciliationRegisterResult::SUCCESS);
+    BOOST_CHECK(tracker.IsPeerRegistered(1));
+
+    // Reconciliation version is higher than ours, should be able to register.
+    BOOST_REQUIRE(!tracker.IsPeerRegistered(2));
+    tracker.PreRegisterPeer(2);
+    BOOST_REQUIRE(tracker.RegisterPeer(2, true, 2, salt) == ReconciliationRegisterResult::SUCCESS);
+    BOOST_CHECK(tracker.IsPeerRegistered(2));
+
+    // Try registering for the second time.
+    BOOST_REQUIRE(tracker.RegisterPeer(1, false, 1, salt) == ReconciliationRegisterResult::ALREADY_REGISTERED);
+
+    // Do not register if there were no pre-registration for the peer.
+    BOOST_REQUIRE_EQUAL(tracker.RegisterPeer(100, true, 1, salt), ReconciliationRegisterResult::NOT_FOUND);
+    BOOST_CHECK(!tracker.IsPeerRegistered(100));
+
+    // Forgotten peers are not registered anymore.
+    tracker.ForgetPeer(1);
+    BOOST_CHECK(!tracker.IsPeerRegistered(1));
+    BOOST_CHECK(!tracker.AddToSet(1, InsecureRand256()));
+    BOOST_CHECK(tracker.ShouldFanoutTo(InsecureRand256(), 1));
+}
+
+BOOST_AUTO_TEST_CASE(ReconcileTest)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION);
+    TxReconciliationTracker responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    // Each side only follows its own role
+    std::vector<unsigned char> skdata;
+    BOOST_CHECK(!initiator.HandleReconciliationRequest(0, 0, 0, skdata));
+    bool success;
+    std::vector<uint256> announces;
+    std::vector<uint32_t> ask_shortids;
+    BOOST_CHECK(!responder.HandleSketch(1, std::vector<unsigned char>(4), success, announces, ask_shortids));
+    BOOST_CHECK(!initiator.HandleReconciliationDifference(0, true, {}, announces));
+    BOOST_CHECK(!responder.InitiateReconciliationRequest(1, GetTime<std::chrono::microseconds>() + RECON_REQUEST_INTERVAL));
+
+    // Both sides know most transactions, and each misses a few
+    std::vector<uint256> shared, initiator_only, responder_only;
+    for (int i = 0; i < 20; ++i) shared.push_back(InsecureRand256());
+    for (int i = 0; i < 3; ++i) initiator_only.push_back(InsecureRand256());
+    for (int i = 0; i < 2; ++i) responder_only.push_back(InsecureRand256());
+    for (const uint256& wtxid : shared) {
+        BOOST_REQUIRE(initiator.AddToSet(0, wtxid));
+        BOOST_REQUIRE(responder.AddToSet(1, wtxid));
+    }
+    for (const uint256& wtxid : initiator_only) BOOST_REQUIRE(initiator.AddToSet(0, wtxid));
+    for (const uint256& wtxid : responder_only) BOOST_REQUIRE(responder.AddToSet(1, wtxid));
+    // A transaction the peer announced has no need to be reconciled
+    const uint256 announced{InsecureRand256()};
+    BOOST_REQUIRE(responder.AddToSet(1, announced));
+    responder.TryRemovingFromSet(1, announced);
+
+    // The first reconciliation is due an interval after the peer connected
+    const auto now{GetTime<std::chrono::microseconds>()};
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(0, now));
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(0, now + RECON_REQUEST_INTERVAL - 1us));
+    std::vector<uint256> initiator_announces, responder_announces;
+    Reconcile(initiator, responder, now + RECON_REQUEST_INTERVAL, success, initiator_announces, responder_announces);
+    BOOST_CHECK(success);
+    std::sort(initiator_announces.begin(), initiator_announces.end());
+    std::sort(initiator_only.begin(), initiator_only.end());
+    BOOST_CHECK(initiator_announces == initiator_only);
+    std::sort(responder_announces.begin(), responder_announces.end());
+    std::sort(responder_only.begin(), responder_only.end());
+    BOOST_CHECK(responder_announces == responder_only);
+
+    // The sets were reconciled, so the next reconciliation has nothing to announce
+    Reconcile(initiator, responder, now + 2 * RECON_REQUEST_INTERVAL, success, initiator_announces, responder_announces);
+    BOOST_CHECK(success);
+    BOOST_CHECK(initiator_announces.empty());
+    BOOST_CHECK(responder_announces.empty());
+}
+
+BOOST_AUTO_TEST_CASE(ReconcileFailureTest)
+{
+    TxReconciliationTracker initiator(TXRECONCILIATION_VERSION);
+    TxReconciliationTracker responder(TXRECONCILIATION_VERSION);
+    RegisterPair(initiator, responder);
+
+    // Sets of the same size without anything in common differ more than estimated
+    for (int i = 0; i < 20; ++i) {
+        BOOST_REQUIRE(initiator.AddToSet(0, InsecureRand256()));
+        BOOST_REQUIRE(responder.AddToSet(1, InsecureRand256()));
+    }
+
+    const auto now{GetTime<std::chrono::microseconds>()};
+    BOOST_CHECK(!initiator.InitiateReconciliationRequest(0, now));
+    bool success;
+    std::vector<uint256> initiator_announces, responder_announces;
+    Reconcile(initiator, responder, now + RECON_REQUEST_INTERVAL, success, initiator_announces, responder_announces);
+    // Both sides fall back to announcing their whole sets
+    BOOST_CHECK(!success);
+    BOOST_CHECK_EQUAL(initiator_announces.size(), 20U);
+    BOOST_CHECK_EQUAL(responder_announces.size(), 20U);
+}
+
+BOOST_AUTO_TEST_CASE(SetLimitTest)
+{
+    TxReconciliationTracker tracker(TXRECONCILIATION_VERSION);
+    tracker.PreRegisterPeer(0);
+    BOOST_REQUIRE(tracker.RegisterPeer(0, true, 1, 1) == ReconciliationRegisterResult::SUCCESS);
+    for (size_t i = 0; i < MAX_RECONSET_SIZE; ++i) {
+        BOOST_REQUIRE(tracker.AddToSet(0, InsecureRand256()));
+    }
+    // Transactions that do not fit in the set are flooded
+    BOOST_CHECK(!tracker.AddToSet(0, InsecureRand256()));
+}
+
+BOOST_AUTO_TEST_CASE(FanoutTest)
+{
+    TxReconciliationTracker tracker(TXRECONCILIATION_VERSION);
+    tracker.PreRegisterPeer(0);
+    BOOST_REQUIRE(tracker.RegisterPeer(0, true, 1, 1) == ReconciliationRegisterResult::SUCCESS);
+
+    // Transactions are flooded to a small share of the inbound peers, always the same way
+    int fanout{0};
+    for (int i = 0; i < 1000; ++i) {
+        const uint256 wtxid{InsecureRand256()};
+        const bool should_fanout{tracker.ShouldFanoutTo(wtxid, 0)};
+        BOOST_CHECK_EQUAL(should_fanout, tracker.ShouldFanoutTo(wtxid, 0));
+        fanout += should_fanout;
+    }
+    BOOST_CHECK(fanout > 0 && fanout < 300);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
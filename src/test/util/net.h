@@ -11,6 +11,7 @@
 #include <net.h>
 #include <util/sock.h>
 
+#include <algorithm>
 #include <array>
 #include <cassert>
 #include <cstring>
@@ -25,6 +26,11 @@ struct ConnmanTestMsg : public CConnman {
         m_peer_connect_timeout = timeout;
     }
 
+    void SetCaptureMessages(bool cap)
+    {
+        m_capture_messages = cap;
+    }
+
     void AddTestNode(CNode& node)
     {
         LOCK(m_nodes_mutex);
@@ -48,6 +54,13 @@ struct ConnmanTestMsg : public CConnman {
 
     void ProcessMessagesOnce(CNode& node) { m_msgproc->ProcessMessages(&node, flagInterruptMsgProc); }
 
+    /** Send what the send queues of node hold, as the socket handler does once the socket can take it. */
+    size_t SendQueuedData(CNode& node) const
+    {
+        LOCK(node.cs_vSend);
+        return SocketSendData(node);
+    }
+
     void NodeReceiveMsgBytes(CNode& node, Span<const uint8_t> msg_bytes, bool& complete) const;
 
     bool ReceiveMsgFrom(CNode& node, CSerializedNetMsg& ser_msg) const;
@@ -118,6 +131,13 @@ public:
 
     ssize_t Send(const void*, size_t len, int) const override { return len; }
 
+    ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int) const override
+    {
+        ssize_t len{0};
+        for (size_t i = 0; i < std::min(buffers.size(), MAX_SEND_BUFFERS); ++i) len += buffers[i].size();
+        return len;
+    }
+
     ssize_t Recv(void* buf, size_t len, int flags) const override
     {
         const size_t consume_bytes{std::min(len, m_contents.size() - m_consumed)};
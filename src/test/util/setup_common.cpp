@@ -112,6 +112,8 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName, const std::ve
             "-debug",
             "-debugexclude=libevent",
             "-debugexclude=leveldb",
+            // Tests read the log right after writing it
+            "-logasync=0",
         },
         extra_args);
     if (G_TEST_COMMAND_LINE_ARGUMENTS) {
@@ -144,6 +146,7 @@ BasicTestingSetup::BasicTestingSetup(const std::string& chainName, const std::ve
     ApplyArgsManOptions(*m_node.args, validation_cache_sizes);
     Assert(InitSignatureCache(validation_cache_sizes.signature_cache_bytes));
     Assert(InitScriptExecutionCache(validation_cache_sizes.script_execution_cache_bytes));
+    Assert(InitPoWHashCache(validation_cache_sizes.pow_hash_cache_bytes));
 
     m_node.chain = interfaces::MakeChain(m_node);
     fCheckBlockIndex = true;
@@ -186,7 +189,7 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     m_node.scheduler->m_service_thread = std::thread(util::TraceThread, "scheduler", [&] { m_node.scheduler->serviceQueue(); });
     GetMainSignals().RegisterBackgroundSignalScheduler(*m_node.scheduler);
 
-    m_node.fee_estimator = std::make_unique<CBlockPolicyEstimator>(FeeestPath(*m_node.args));
+    m_node.fee_estimator = std::make_unique<CBlockPolicyEstimator>(FeeestPath(*m_node.args), chainparams.GetConsensus().PowTargetSpacing());
     m_node.mempool = std::make_unique<CTxMemPool>(MemPoolOptionsForTest(m_node));
 
     m_cache_sizes = CalculateCacheSizes(m_args);
@@ -202,12 +205,20 @@ ChainTestingSetup::ChainTestingSetup(const std::string& chainName, const std::ve
     constexpr int script_check_threads = 2;
     StartScriptCheckWorkerThreads(script_check_threads);
     g_parallel_script_checks = true;
+
+    constexpr int pow_check_threads = 2;
+    StartPoWCheckWorkerThreads(pow_check_threads);
+
+    constexpr int prefetch_threads = 2;
+    StartPrefetchWorkerThreads(prefetch_threads);
 }
 
 ChainTestingSetup::~ChainTestingSetup()
 {
     if (m_node.scheduler) m_node.scheduler->stop();
     StopScriptCheckWorkerThreads();
+    StopPoWCheckWorkerThreads();
+    StopPrefetchWorkerThreads();
     GetMainSignals().FlushBackgroundCallbacks();
     GetMainSignals().UnregisterBackgroundSignalScheduler();
     m_node.connman.reset();
@@ -255,7 +266,7 @@ TestingSetup::TestingSetup(const std::string& chainName, const std::vector<const
     m_node.connman = std::make_unique<ConnmanTestMsg>(0x1337, 0x1337, *m_node.addrman, *m_node.netgroupman); // Deterministic randomness for tests.
     m_node.peerman = PeerManager::make(*m_node.connman, *m_node.addrman,
                                        m_node.banman.get(), *m_node.chainman,
-                                       *m_node.mempool, false);
+                                       *m_node.mempool, {});
     {
         CConnman::Options options;
         options.m_msgproc = m_node.peerman.get();
@@ -181,6 +181,14 @@ BOOST_AUTO_TEST_CASE(parse_hex)
     // Stop parsing at invalid value
     result = ParseHex("1234 invalid 1234");
     BOOST_CHECK(result.size() == 2 && result[0] == 0x12 && result[1] == 0x34);
+
+    // Upper case, spaces and invalid values within runs of digits long enough to be decoded at once
+    result = ParseHex("04678AFDB0FE5548271967F1A67130B7105CD6A828E03909A67962E0EA1F61DEB649F6BC3F4CEF38C4F35504E51EC112DE5C384DF7BA0B8D578A4C702B6BF11D5F");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    result = ParseHex("04678afdb0fe5548 271967f1a67130b7 105cd6a828e03909a67962e0ea1f61deb649f6bc3f4cef38c4f35504e51ec112de5c384df7ba0b8d578a4c702b6bf11d5f");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.end());
+    result = ParseHex("04678afdb0fe5548271967f1a67130b7105cd6g828e03909");
+    BOOST_CHECK_EQUAL_COLLECTIONS(result.begin(), result.end(), expected.begin(), expected.begin() + 19);
 }
 
 BOOST_AUTO_TEST_CASE(util_HexStr)
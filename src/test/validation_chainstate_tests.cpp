@@ -4,6 +4,7 @@
 //
 #include <chainparams.h>
 #include <consensus/validation.h>
+#include <kernel/coinstats.h>
 #include <random.h>
 #include <rpc/blockchain.h>
 #include <sync.h>
@@ -147,4 +148,48 @@ BOOST_FIXTURE_TEST_CASE(chainstate_update_tip, TestChain100Setup)
     BOOST_CHECK_EQUAL(curr_tip, ::g_best_block);
 }
 
+//! The MuHash kept with -utxomuhash matches a scan of the UTXO set as blocks
+//! are connected and disconnected.
+BOOST_FIXTURE_TEST_CASE(chainstate_utxo_muhash, TestChain100Setup)
+{
+    Chainstate& chainstate = Assert(m_node.chainman)->ActiveChainstate();
+    const auto check_muhash = [&] {
+        LOCK(::cs_main);
+        chainstate.ForceFlushStateToDisk();
+        const auto stats{kernel::ComputeUTXOStats(kernel::CoinStatsHashType::MUHASH, &chainstate.CoinsDB(), chainstate.m_blockman, m_node.rpc_interruption_point)};
+        BOOST_REQUIRE(stats && chainstate.m_utxo_muhash);
+        kernel::UTXOSetMuHash utxo_muhash{*chainstate.m_utxo_muhash};
+        uint256 muhash;
+        utxo_muhash.muhash.Finalize(muhash);
+        BOOST_CHECK_EQUAL(muhash, stats->hashSerialized);
+        BOOST_CHECK_EQUAL(utxo_muhash.coins_count, stats->coins_count);
+        BOOST_CHECK_EQUAL(utxo_muhash.bogo_size, stats->nBogoSize);
+        BOOST_CHECK_EQUAL(utxo_muhash.total_amount, *stats->total_amount);
+    };
+
+    BOOST_REQUIRE(WITH_LOCK(::cs_main, return chainstate.InitUTXOMuHash()));
+    check_muhash();
+
+    // Spend a coinbase output, creating a coin
+    const CScript script{CScript{} << OP_TRUE};
+    const CMutableTransaction spend{CreateValidMempoolTransaction(m_coinbase_txns[0], /*input_vout=*/0, /*input_height=*/1,
+                                                                  coinbaseKey, script, /*output_amount=*/CAmount(1 * COIN), /*submit=*/false)};
+    const CBlock block{CreateAndProcessBlock({spend}, script)};
+    BOOST_CHECK_EQUAL(WITH_LOCK(::cs_main, return chainstate.m_chain.Tip()->GetBlockHash()), block.GetHash());
+    check_muhash();
+
+    // The stored MuHash is picked up again
+    WITH_LOCK(::cs_main, chainstate.m_utxo_muhash.reset());
+    BOOST_REQUIRE(WITH_LOCK(::cs_main, return chainstate.CoinsDB().ReadUTXOMuHash().has_value()));
+    BOOST_REQUIRE(WITH_LOCK(::cs_main, return chainstate.InitUTXOMuHash()));
+    check_muhash();
+
+    {
+        LOCK2(::cs_main, m_node.mempool->cs);
+        BlockValidationState state;
+        BOOST_REQUIRE(chainstate.DisconnectTip(state, /*disconnectpool=*/nullptr));
+    }
+    check_muhash();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
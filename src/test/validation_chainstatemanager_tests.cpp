@@ -3,7 +3,9 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 //
 #include <chainparams.h>
+#include <consensus/amount.h>
 #include <consensus/validation.h>
+#include <kernel/coinstats.h>
 #include <node/utxo_snapshot.h>
 #include <random.h>
 #include <rpc/blockchain.h>
@@ -155,6 +157,61 @@ BOOST_AUTO_TEST_CASE(chainstatemanager_rebalance_caches)
 }
 
 //! Test basic snapshot activation.
+BOOST_AUTO_TEST_CASE(chainstatemanager_snapshot_chunk)
+{
+    node::SnapshotCoins coins;
+    for (int i = 0; i < 10; ++i) {
+        const uint256 txid{InsecureRand256()};
+        for (uint32_t n = 0; n < 3; ++n) {
+            Coin coin{CTxOut{CAmount(InsecureRandRange(MAX_MONEY)), CScript{} << OP_TRUE}, /*nHeightIn=*/i, /*fCoinBaseIn=*/n == 0};
+            coins.emplace_back(COutPoint{txid, n * 1000}, std::move(coin));
+        }
+    }
+    const std::vector<unsigned char> data{node::SerializeSnapshotChunk(coins)};
+
+    node::SnapshotCoins parsed;
+    BOOST_REQUIRE(node::DeserializeSnapshotChunk(data, coins.size(), parsed));
+    BOOST_REQUIRE_EQUAL(parsed.size(), coins.size());
+    for (size_t i = 0; i < coins.size(); ++i) {
+        BOOST_CHECK(parsed[i].first == coins[i].first);
+        BOOST_CHECK(parsed[i].second.out == coins[i].second.out);
+        BOOST_CHECK_EQUAL(parsed[i].second.nHeight, coins[i].second.nHeight);
+        BOOST_CHECK_EQUAL(parsed[i].second.fCoinBase, coins[i].second.fCoinBase);
+    }
+
+    // The txid is written once for all its outputs
+    BOOST_CHECK_LT(data.size(), coins.size() * 32);
+
+    // A chunk must hold exactly the announced number of coins
+    BOOST_CHECK(!node::DeserializeSnapshotChunk(data, coins.size() - 1, parsed));
+    BOOST_CHECK(!node::DeserializeSnapshotChunk(data, coins.size() + 1, parsed));
+    BOOST_CHECK(!node::DeserializeSnapshotChunk(Span{data}.first(data.size() - 1), coins.size(), parsed));
+}
+
+//! Hashing the coins in database order, as when loading a snapshot, gives the
+//! same commitment as ComputeUTXOStats.
+BOOST_FIXTURE_TEST_CASE(chainstatemanager_snapshot_hasher, TestChain100Setup)
+{
+    Chainstate& chainstate = Assert(m_node.chainman)->ActiveChainstate();
+    LOCK(::cs_main);
+    chainstate.ForceFlushStateToDisk();
+
+    const auto stats{kernel::ComputeUTXOStats(kernel::CoinStatsHashType::HASH_SERIALIZED, &chainstate.CoinsDB(), chainstate.m_blockman, m_node.rpc_interruption_point)};
+    BOOST_REQUIRE(stats);
+
+    kernel::SerializedUTXOHasher hasher{stats->hashBlock};
+    std::unique_ptr<CCoinsViewCursor> cursor{chainstate.CoinsDB().Cursor()};
+    COutPoint outpoint;
+    Coin coin;
+    for (; cursor->Valid(); cursor->Next()) {
+        BOOST_REQUIRE(cursor->GetKey(outpoint) && cursor->GetValue(coin));
+        BOOST_CHECK(hasher.Add(outpoint, coin));
+    }
+    // A repeated outpoint is not hashed again but rejected
+    BOOST_CHECK(!hasher.Add(outpoint, coin));
+    BOOST_CHECK_EQUAL(hasher.Finalize(), stats->hashSerialized);
+}
+
 BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, TestChain100Setup)
 {
     ChainstateManager& chainman = *Assert(m_node.chainman);
@@ -194,14 +251,13 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, TestChain100Setup)
     // Should not load malleated snapshots
     BOOST_REQUIRE(!CreateAndActivateUTXOSnapshot(
         m_node, m_path_root, [](AutoFile& auto_infile, SnapshotMetadata& metadata) {
-            // A UTXO is missing but count is correct
-            metadata.m_coins_count -= 1;
+            // A chunk is missing but count is correct
+            uint64_t chunk_coins;
+            std::vector<unsigned char> chunk_data;
+            uint256 chunk_hash;
 
-            COutPoint outpoint;
-            Coin coin;
-
-            auto_infile >> outpoint;
-            auto_infile >> coin;
+            auto_infile >> chunk_coins >> chunk_data >> chunk_hash;
+            metadata.m_coins_count -= chunk_coins;
     }));
     BOOST_REQUIRE(!CreateAndActivateUTXOSnapshot(
         m_node, m_path_root, [](AutoFile& auto_infile, SnapshotMetadata& metadata) {
@@ -303,6 +359,24 @@ BOOST_FIXTURE_TEST_CASE(chainstatemanager_activate_snapshot, TestChain100Setup)
         BOOST_CHECK_EQUAL(coins_missing_from_background, new_coins);
     }
 
+    // The background chainstate already reaches the base of the snapshot, which
+    // is as far as the blocks on top of it are any of its concern.
+    {
+        LOCK(::cs_main);
+        BOOST_CHECK(!chainman.BackgroundSyncChainstate());
+        const CBlockIndex* snapshot_base{chainman.GetSnapshotBaseBlock()};
+        BOOST_REQUIRE(snapshot_base);
+        BOOST_CHECK_EQUAL(snapshot_base->nHeight, snapshot_height);
+    }
+    Chainstate& background{*chainman.GetAll().front()};
+    BOOST_REQUIRE(&background != &chainman.ActiveChainstate());
+    for (const CBlockIndex* candidate : WITH_LOCK(::cs_main, return background.setBlockIndexCandidates)) {
+        BOOST_CHECK(candidate->nHeight <= snapshot_height);
+    }
+    BlockValidationState state;
+    BOOST_CHECK(background.ActivateBestChain(state));
+    BOOST_CHECK_EQUAL(WITH_LOCK(::cs_main, return background.m_chain.Height()), snapshot_height);
+
     // Snapshot should refuse to load after one has already loaded.
     BOOST_REQUIRE(!CreateAndActivateUTXOSnapshot(m_node, m_path_root));
 
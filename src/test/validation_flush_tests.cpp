@@ -38,7 +38,7 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
     };
 
     // The number of bytes consumed by coin's heap data, i.e. CScript
-    // (prevector<28, unsigned char>) when assigned 56 bytes of data per above.
+    // (prevector<CSCRIPT_INLINE_SIZE, unsigned char>) when assigned 56 bytes of data per above.
     //
     // See also: Coin::DynamicMemoryUsage().
     constexpr unsigned int COIN_SIZE = is_64_bit ? 80 : 64;
@@ -47,93 +47,51 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
         BOOST_TEST_MESSAGE("CCoinsViewCache memory usage: " << view.DynamicMemoryUsage());
     };
 
-    constexpr size_t MAX_COINS_CACHE_BYTES = 1024;
+    // Map nodes are allocated from the cache's pool resource in chunks. Chunk
+    // memory not used by any node is not counted, so an empty cache uses
+    // next to nothing.
+    print_view_mem_usage(view);
+    BOOST_CHECK_LT(view.DynamicMemoryUsage(), 1024U);
+
+    // Large enough that growing the bucket array cannot skip the LARGE state (the last 10%)
+    constexpr size_t MAX_COINS_CACHE_BYTES{4 << 20};
+    constexpr int MAX_ATTEMPTS{1'000'000};
 
     // Without any coins in the cache, we shouldn't need to flush.
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
         CoinsCacheSizeState::OK);
 
-    // If the initial memory allocations of cacheCoins don't match these common
-    // cases, we can't really continue to make assertions about memory usage.
-    // End the test early.
-    if (view.DynamicMemoryUsage() != 32 && view.DynamicMemoryUsage() != 16) {
-        // Add a bunch of coins to see that we at least flip over to CRITICAL.
-
-        for (int i{0}; i < 1000; ++i) {
-            COutPoint res = add_coin(view);
-            BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
-        }
-
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
-            CoinsCacheSizeState::CRITICAL);
-
-        BOOST_TEST_MESSAGE("Exiting cache flush tests early due to unsupported arch");
-        return;
-    }
-
-    print_view_mem_usage(view);
-    BOOST_CHECK_EQUAL(view.DynamicMemoryUsage(), is_64_bit ? 32U : 16U);
-
-    // We should be able to add COINS_UNTIL_CRITICAL coins to the cache before going CRITICAL.
-    // This is contingent not only on the dynamic memory usage of the Coins
-    // that we're adding (COIN_SIZE bytes per), but also on how much memory the
-    // cacheCoins (unordered_map) preallocates.
-    constexpr int COINS_UNTIL_CRITICAL{3};
-
-    for (int i{0}; i < COINS_UNTIL_CRITICAL; ++i) {
+    // Adding coins goes from OK to LARGE, ...
+    int attempts{0};
+    for (; attempts < MAX_ATTEMPTS; ++attempts) {
+        if (chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0) != CoinsCacheSizeState::OK) break;
         COutPoint res = add_coin(view);
-        print_view_mem_usage(view);
         BOOST_CHECK_EQUAL(view.AccessCoin(res).DynamicMemoryUsage(), COIN_SIZE);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
-            CoinsCacheSizeState::OK);
     }
+    print_view_mem_usage(view);
+    BOOST_CHECK_LT(attempts, MAX_ATTEMPTS);
+    BOOST_CHECK_EQUAL(
+        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
+        CoinsCacheSizeState::LARGE);
+    BOOST_CHECK_GE(float(view.DynamicMemoryUsage()) / MAX_COINS_CACHE_BYTES, 0.9);
 
-    // Adding some additional coins will push us over the edge to CRITICAL.
-    for (int i{0}; i < 4; ++i) {
+    // ... and from LARGE to CRITICAL.
+    for (attempts = 0; attempts < MAX_ATTEMPTS; ++attempts) {
+        if (chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0) != CoinsCacheSizeState::LARGE) break;
         add_coin(view);
-        print_view_mem_usage(view);
-        if (chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0) ==
-            CoinsCacheSizeState::CRITICAL) {
-            break;
-        }
     }
-
+    print_view_mem_usage(view);
+    BOOST_CHECK_LT(attempts, MAX_ATTEMPTS);
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/0),
         CoinsCacheSizeState::CRITICAL);
 
     // Passing non-zero max mempool usage should allow us more headroom.
     BOOST_CHECK_EQUAL(
-        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/1 << 10),
+        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/MAX_COINS_CACHE_BYTES),
         CoinsCacheSizeState::OK);
 
-    for (int i{0}; i < 3; ++i) {
-        add_coin(view);
-        print_view_mem_usage(view);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, /*max_mempool_size_bytes=*/1 << 10),
-            CoinsCacheSizeState::OK);
-    }
-
-    // Adding another coin with the additional mempool room will put us >90%
-    // but not yet critical.
-    add_coin(view);
-    print_view_mem_usage(view);
-
-    // Only perform these checks on 64 bit hosts; I haven't done the math for 32.
-    if (is_64_bit) {
-        float usage_percentage = (float)view.DynamicMemoryUsage() / (MAX_COINS_CACHE_BYTES + (1 << 10));
-        BOOST_TEST_MESSAGE("CoinsTip usage percentage: " << usage_percentage);
-        BOOST_CHECK(usage_percentage >= 0.9);
-        BOOST_CHECK(usage_percentage < 1);
-        BOOST_CHECK_EQUAL(
-            chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 1 << 10),
-            CoinsCacheSizeState::LARGE);
-    }
-
     // Using the default max_* values permits way more coins to be added.
     for (int i{0}; i < 1000; ++i) {
         add_coin(view);
@@ -142,20 +100,33 @@ BOOST_AUTO_TEST_CASE(getcoinscachesizestate)
             CoinsCacheSizeState::OK);
     }
 
-    // Flushing the view doesn't take us back to OK because cacheCoins has
-    // preallocated memory that doesn't get reclaimed even after flush.
-
+    // Syncing the view keeps the coins, ...
+    const unsigned int cache_size{view.GetCacheSize()};
+    view.SetBestBlock(InsecureRand256());
+    BOOST_CHECK(view.Sync());
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), cache_size);
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
         CoinsCacheSizeState::CRITICAL);
 
-    view.SetBestBlock(InsecureRand256());
+    // ... trimming it evicts coins until it is within the limit, ...
+    view.Trim(MAX_COINS_CACHE_BYTES / 2);
+    print_view_mem_usage(view);
+    BOOST_CHECK_LT(view.GetCacheSize(), cache_size);
+    BOOST_CHECK_LE(view.DynamicMemoryUsage(), MAX_COINS_CACHE_BYTES / 2);
+    BOOST_CHECK_EQUAL(
+        chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
+        CoinsCacheSizeState::OK);
+
+    // ... and flushing it gives the pool's chunks back.
     BOOST_CHECK(view.Flush());
     print_view_mem_usage(view);
+    BOOST_CHECK_EQUAL(view.GetCacheSize(), 0U);
+    BOOST_CHECK_LT(view.DynamicMemoryUsage(), 1024U);
 
     BOOST_CHECK_EQUAL(
         chainstate.GetCoinsCacheSizeState(MAX_COINS_CACHE_BYTES, 0),
-        CoinsCacheSizeState::CRITICAL);
+        CoinsCacheSizeState::OK);
 }
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <arith_uint256.h>
 #include <boost/test/unit_test.hpp>
 #include <consensus/validation.h>
 #include <primitives/block.h>
@@ -10,6 +11,10 @@
 #include <util/check.h>
 #include <validationinterface.h>
 
+#include <chrono>
+#include <future>
+#include <vector>
+
 BOOST_FIXTURE_TEST_SUITE(validationinterface_tests, TestingSetup)
 
 struct TestSubscriberNoop final : public CValidationInterface {
@@ -91,4 +96,83 @@ BOOST_AUTO_TEST_CASE(unregister_all_during_call)
     BOOST_CHECK(destroyed);
 }
 
+/** Records the order of ChainStateFlushed notifications, optionally blocking in the first one. */
+class RecordingInterface final : public CValidationInterface
+{
+public:
+    RecordingInterface(std::string name, std::shared_future<void> block_first = {})
+        : m_name{std::move(name)}, m_block_first{std::move(block_first)} {}
+
+    std::vector<uint256> m_seen;
+    std::function<void()> m_on_call;
+
+    std::string ValidationInterfaceName() const override { return m_name; }
+
+protected:
+    void ChainStateFlushed(const CBlockLocator& locator) override
+    {
+        if (m_seen.empty() && m_block_first.valid()) m_block_first.wait();
+        m_seen.push_back(locator.vHave.front());
+        if (m_on_call) m_on_call();
+    }
+
+private:
+    const std::string m_name;
+    std::shared_future<void> m_block_first;
+};
+
+BOOST_FIXTURE_TEST_CASE(subscriber_queues, BasicTestingSetup)
+{
+    // Only the dispatch threads service the queues
+    CScheduler scheduler;
+    GetMainSignals().RegisterBackgroundSignalScheduler(scheduler, /*dispatch_threads=*/2);
+
+    std::promise<void> release;
+    auto slow{std::make_shared<RecordingInterface>("slow", release.get_future().share())};
+    auto fast{std::make_shared<RecordingInterface>("fast")};
+    constexpr size_t count{10};
+    std::promise<void> fast_done;
+    fast->m_on_call = [&] {
+        if (fast->m_seen.size() == count) fast_done.set_value();
+    };
+    RegisterSharedValidationInterface(slow);
+    RegisterSharedValidationInterface(fast);
+
+    std::vector<uint256> sent;
+    for (size_t i = 0; i < count; ++i) {
+        sent.push_back(ArithToUint256(arith_uint256{i + 1}));
+        GetMainSignals().ChainStateFlushed(CBlockLocator{std::vector<uint256>{sent.back()}});
+    }
+
+    // The fast subscriber is not held up by the slow one
+    BOOST_REQUIRE(fast_done.get_future().wait_for(std::chrono::seconds{60}) == std::future_status::ready);
+    const auto stats{GetMainSignals().GetSubscriberStats()};
+    BOOST_REQUIRE_EQUAL(stats.size(), 2U);
+    BOOST_CHECK_EQUAL(stats[0].name, "slow");
+    BOOST_CHECK_EQUAL(stats[0].pending, count - 1);
+    BOOST_CHECK_EQUAL(stats[0].delivered, 0U);
+    BOOST_CHECK_EQUAL(GetMainSignals().CallbacksPending(), count - 1);
+    // Nor is waiting for the queue of the fast subscriber alone
+    GetMainSignals().ChainStateFlushed(CBlockLocator{std::vector<uint256>{ArithToUint256(arith_uint256{count + 1})}});
+    SyncWithValidationInterfaceQueue(*fast);
+    BOOST_CHECK_EQUAL(fast->m_seen.size(), count + 1);
+    sent.push_back(fast->m_seen.back());
+
+    release.set_value();
+    SyncWithValidationInterfaceQueue();
+    // Each subscriber sees the notifications in order
+    BOOST_CHECK(slow->m_seen == sent);
+    BOOST_CHECK(fast->m_seen == sent);
+    for (const auto& s : GetMainSignals().GetSubscriberStats()) {
+        BOOST_CHECK_EQUAL(s.pending, 0U);
+        // The queue is synced once the subscriber handled count notifications and the barrier
+        BOOST_CHECK_GE(s.delivered, count);
+    }
+    BOOST_CHECK(GetMainSignals().GetSubscriberStats()[0].max_lag > 0us);
+
+    UnregisterAllValidationInterfaces();
+    GetMainSignals().FlushBackgroundCallbacks();
+    GetMainSignals().UnregisterBackgroundSignalScheduler();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -11,10 +11,15 @@
 #include <shutdown.h>
 #include <uint256.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <util/vector.h>
 
+#include <algorithm>
+#include <atomic>
+#include <iterator>
 #include <stdint.h>
+#include <thread>
 
 static constexpr uint8_t DB_COIN{'C'};
 static constexpr uint8_t DB_BLOCK_FILES{'f'};
@@ -25,6 +30,8 @@ static constexpr uint8_t DB_HEAD_BLOCKS{'H'};
 static constexpr uint8_t DB_FLAG{'F'};
 static constexpr uint8_t DB_REINDEX_FLAG{'R'};
 static constexpr uint8_t DB_LAST_BLOCK{'l'};
+static constexpr uint8_t DB_BLOCK_INDEX_SNAPSHOT{'S'};
+static constexpr uint8_t DB_UTXO_MUHASH{'M'};
 
 // Keys used in previous version that might still be found in the DB:
 static constexpr uint8_t DB_COINS{'c'};
@@ -70,33 +77,116 @@ struct CoinEntry {
 
 } // namespace
 
-CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe) :
-    m_db(std::make_unique<CDBWrapper>(ldb_path, nCacheSize, fMemory, fWipe, true)),
+CCoinsViewDB::CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe, bool async_write) :
+    m_db(std::make_unique<CDBWrapper>(ldb_path, nCacheSize, fMemory, fWipe, true, GetDBOptions(gArgs, "chainstate"))),
     m_ldb_path(ldb_path),
-    m_is_memory(fMemory) { }
+    m_is_memory(fMemory)
+{
+    if (async_write) {
+        m_write_thread = std::thread(&util::TraceThread, "coinsdb", [this] { WriteThread(); });
+    }
+}
+
+CCoinsViewDB::~CCoinsViewDB()
+{
+    if (m_write_thread.joinable()) {
+        // The thread writes out what is still pending before it exits.
+        WITH_LOCK(m_async_mutex, m_stop = true);
+        m_async_cv.notify_all();
+        m_write_thread.join();
+    }
+}
 
 void CCoinsViewDB::ResizeCache(size_t new_cache_size)
 {
     // We can't do this operation with an in-memory DB since we'll lose all the coins upon
     // reset.
     if (!m_is_memory) {
+        // The write thread must not use the old `m_db`. No new batch can
+        // come in while we hold cs_main.
+        WaitForWrites();
+        LOCK(m_compact_mutex);
         // Have to do a reset first to get the original `m_db` state to release its
         // filesystem lock.
         m_db.reset();
         m_db = std::make_unique<CDBWrapper>(
-            m_ldb_path, new_cache_size, m_is_memory, /*fWipe=*/false, /*obfuscate=*/true);
+            m_ldb_path, new_cache_size, m_is_memory, /*fWipe=*/false, /*obfuscate=*/true, GetDBOptions(gArgs, "chainstate"));
     }
 }
 
+bool CCoinsViewDB::CompactNextRange()
+{
+    LOCK(m_compact_mutex);
+    return m_db->CompactNextRange();
+}
+
+const Coin* CCoinsViewDB::FindPendingCoin(const COutPoint& outpoint) const
+{
+    for (const PendingBatch* batch : {m_queued.get(), m_writing.get()}) {
+        if (batch == nullptr) continue;
+        const auto it{batch->coins.find(outpoint)};
+        if (it != batch->coins.end()) return &it->second.coin;
+    }
+    return nullptr;
+}
+
 bool CCoinsViewDB::GetCoin(const COutPoint &outpoint, Coin &coin) const {
+    {
+        LOCK(m_async_mutex);
+        if (const Coin* pending{FindPendingCoin(outpoint)}) {
+            if (pending->IsSpent()) return false;
+            coin = *pending;
+            return true;
+        }
+    }
     return m_db->Read(CoinEntry(&outpoint), coin);
 }
 
+void CCoinsViewDB::GetCoins(Span<const COutPoint> outpoints, Span<Coin> coins) const
+{
+    assert(outpoints.size() == coins.size());
+    std::vector<CoinEntry> keys;
+    std::vector<size_t> positions;
+    {
+        LOCK(m_async_mutex);
+        for (size_t i = 0; i < outpoints.size(); ++i) {
+            if (const Coin* pending{FindPendingCoin(outpoints[i])}) {
+                coins[i] = *pending;
+            } else {
+                keys.emplace_back(&outpoints[i]);
+                positions.push_back(i);
+            }
+        }
+    }
+    std::vector<std::optional<Coin>> values;
+    m_db->ReadMany(keys, values);
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (values[i]) {
+            coins[positions[i]] = std::move(*values[i]);
+        } else {
+            coins[positions[i]].Clear();
+        }
+    }
+}
+
 bool CCoinsViewDB::HaveCoin(const COutPoint &outpoint) const {
+    {
+        LOCK(m_async_mutex);
+        if (const Coin* pending{FindPendingCoin(outpoint)}) return !pending->IsSpent();
+    }
     return m_db->Exists(CoinEntry(&outpoint));
 }
 
 uint256 CCoinsViewDB::GetBestBlock() const {
+    {
+        LOCK(m_async_mutex);
+        if (m_queued) return m_queued->best_block;
+        if (m_writing) return m_writing->best_block;
+    }
+    return GetWrittenBestBlock();
+}
+
+uint256 CCoinsViewDB::GetWrittenBestBlock() const {
     uint256 hashBestChain;
     if (!m_db->Read(DB_BEST_BLOCK, hashBestChain))
         return uint256();
@@ -111,7 +201,71 @@ std::vector<uint256> CCoinsViewDB::GetHeadBlocks() const {
     return vhashHeadBlocks;
 }
 
-bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
+bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
+    if (!m_write_thread.joinable()) return WriteCoins(mapCoins, hashBlock, erase);
+
+    assert(!hashBlock.IsNull());
+    auto batch{std::make_unique<PendingBatch>()};
+    for (CCoinsMap::iterator it = mapCoins.begin(); it != mapCoins.end();) {
+        if (it->second.flags & CCoinsCacheEntry::DIRTY) {
+            CCoinsCacheEntry& entry{batch->coins[it->first]};
+            entry.coin = erase ? std::move(it->second.coin) : it->second.coin;
+            entry.flags = CCoinsCacheEntry::DIRTY;
+        }
+        it = erase ? mapCoins.erase(it) : std::next(it);
+    }
+    batch->best_block = hashBlock;
+
+    WAIT_LOCK(m_async_mutex, lock);
+    // Only one batch can wait while another is written.
+    m_async_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_async_mutex) { return !m_queued || m_write_failed; });
+    if (m_write_failed) return false;
+    LogPrint(BCLog::COINDB, "Queued %u changed transaction outputs for the coin database\n", batch->coins.size());
+    m_queued = std::move(batch);
+    m_async_cv.notify_all();
+    return true;
+}
+
+bool CCoinsViewDB::WaitForWrites() const
+{
+    WAIT_LOCK(m_async_mutex, lock);
+    m_async_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_async_mutex) { return (!m_queued && !m_writing) || m_write_failed; });
+    return !m_write_failed;
+}
+
+void CCoinsViewDB::WriteThread()
+{
+    WAIT_LOCK(m_async_mutex, lock);
+    while (true) {
+        m_async_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_async_mutex) { return m_queued || m_stop; });
+        if (!m_queued) return;
+
+        // Keep the batch readable while it is written, and only drop it
+        // once the database has all of it.
+        m_writing = std::move(m_queued);
+        m_async_cv.notify_all();
+        PendingBatch* batch{m_writing.get()};
+        bool ok{false};
+        {
+            REVERSE_LOCK(lock);
+            try {
+                ok = WriteCoins(batch->coins, batch->best_block, /*erase=*/false);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+            }
+        }
+        if (!ok) {
+            LogPrintf("Failed to write to coin database\n");
+            m_write_failed = true;
+            m_async_cv.notify_all();
+            return;
+        }
+        m_writing.reset();
+        m_async_cv.notify_all();
+    }
+}
+
+bool CCoinsViewDB::WriteCoins(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase) {
     CDBBatch batch(*m_db);
     size_t count = 0;
     size_t changed = 0;
@@ -119,7 +273,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
     int crash_simulate = gArgs.GetIntArg("-dbcrashratio", 0);
     assert(!hashBlock.IsNull());
 
-    uint256 old_tip = GetBestBlock();
+    uint256 old_tip = GetWrittenBestBlock();
     if (old_tip.IsNull()) {
         // We may be in the middle of replaying.
         std::vector<uint256> old_heads = GetHeadBlocks();
@@ -146,8 +300,7 @@ bool CCoinsViewDB::BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) {
             changed++;
         }
         count++;
-        CCoinsMap::iterator itOld = it++;
-        mapCoins.erase(itOld);
+        it = erase ? mapCoins.erase(it) : std::next(it);
         if (batch.SizeEstimate() > batch_size) {
             LogPrint(BCLog::COINDB, "Writing partial batch of %.2f MiB\n", batch.SizeEstimate() * (1.0 / 1048576.0));
             m_db->WriteBatch(batch);
@@ -177,7 +330,19 @@ size_t CCoinsViewDB::EstimateSize() const
     return m_db->EstimateSize(DB_COIN, uint8_t(DB_COIN + 1));
 }
 
-CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.GetDataDirNet() / "blocks" / "index", nCacheSize, fMemory, fWipe) {
+bool CCoinsViewDB::WriteUTXOMuHash(const uint256& block_hash, const kernel::UTXOSetMuHash& muhash)
+{
+    return m_db->Write(DB_UTXO_MUHASH, std::make_pair(block_hash, muhash));
+}
+
+std::optional<kernel::UTXOSetMuHash> CCoinsViewDB::ReadUTXOMuHash() const
+{
+    std::pair<uint256, kernel::UTXOSetMuHash> entry;
+    if (!m_db->Read(DB_UTXO_MUHASH, entry) || entry.first != GetBestBlock()) return std::nullopt;
+    return entry.second;
+}
+
+CBlockTreeDB::CBlockTreeDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(gArgs.GetDataDirNet() / "blocks" / "index", nCacheSize, fMemory, fWipe, /*obfuscate=*/false, GetDBOptions(gArgs, "blockindex")) {
 }
 
 bool CBlockTreeDB::ReadBlockFileInfo(int nFile, CBlockFileInfo &info) {
@@ -224,12 +389,20 @@ private:
 
 std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor() const
 {
+    return Cursor(uint256::ZERO);
+}
+
+std::unique_ptr<CCoinsViewCursor> CCoinsViewDB::Cursor(const uint256& start) const
+{
+    // The cursor only sees what is in the database.
+    WaitForWrites();
     auto i = std::make_unique<CCoinsViewDBCursor>(
         const_cast<CDBWrapper&>(*m_db).NewIterator(), GetBestBlock());
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
        that restriction.  */
-    i->pcursor->Seek(DB_COIN);
+    const COutPoint start_outpoint{start, 0};
+    i->pcursor->Seek(CoinEntry(&start_outpoint));
     // Cache key of first record
     if (i->pcursor->Valid()) {
         CoinEntry entry(&i->keyTmp.second);
@@ -281,9 +454,21 @@ bool CBlockTreeDB::WriteBatchSync(const std::vector<std::pair<int, const CBlockF
     for (std::vector<const CBlockIndex*>::const_iterator it=blockinfo.begin(); it != blockinfo.end(); it++) {
         batch.Write(std::make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
     }
+    // Any change to the block index invalidates a snapshot of it
+    batch.Erase(DB_BLOCK_INDEX_SNAPSHOT);
     return WriteBatch(batch, true);
 }
 
+bool CBlockTreeDB::ReadBlockIndexSnapshotId(uint256& snapshot_id)
+{
+    return Read(DB_BLOCK_INDEX_SNAPSHOT, snapshot_id);
+}
+
+bool CBlockTreeDB::WriteBlockIndexSnapshotId(const uint256& snapshot_id)
+{
+    return Write(DB_BLOCK_INDEX_SNAPSHOT, snapshot_id, /*fSync=*/true);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? uint8_t{'1'} : uint8_t{'0'});
 }
@@ -296,21 +481,56 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int num_threads)
 {
     AssertLockHeld(::cs_main);
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    if (num_threads <= 0) num_threads = GetNumCores();
+    num_threads = std::clamp(num_threads, 1, MAX_BLOCK_INDEX_LOAD_THREADS);
+
+    // Records are keyed by block hash, so its first byte splits them into
+    // evenly sized buckets. A wave of buckets is read and deserialized (which
+    // includes hashing the header) in parallel, then inserted in key order on
+    // this thread, which keeps memory usage to a few buckets at a time.
+    static constexpr int NUM_BUCKETS{256};
+    using Bucket = std::vector<std::pair<uint256, CDiskBlockIndex>>;
+    std::vector<Bucket> buckets(num_threads);
+    std::atomic<bool> failed{false};
+    auto read_bucket = [&](int bucket, Bucket& records) {
+        records.clear();
+        uint256 start;
+        *start.begin() = bucket;
+        std::unique_ptr<CDBIterator> pcursor(NewIterator());
+        pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, start));
+        while (pcursor->Valid()) {
+            if (ShutdownRequested()) return;
+            std::pair<uint8_t, uint256> key;
+            if (!pcursor->GetKey(key) || key.first != DB_BLOCK_INDEX || *key.second.begin() != bucket) break;
+            CDiskBlockIndex diskindex;
+            if (!pcursor->GetValue(diskindex)) {
+                failed = true;
+                return;
+            }
+            records.emplace_back(diskindex.ConstructBlockHash(), diskindex);
+            pcursor->Next();
+        }
+    };
 
     // Load m_block_index
-    while (pcursor->Valid()) {
+    for (int wave = 0; wave < NUM_BUCKETS; wave += num_threads) {
+        const int wave_size{std::min(num_threads, NUM_BUCKETS - wave)};
+        std::vector<std::thread> threads;
+        for (int t = 1; t < wave_size; ++t) {
+            threads.emplace_back(read_bucket, wave + t, std::ref(buckets[t]));
+        }
+        read_bucket(wave, buckets[0]);
+        for (std::thread& thread : threads) thread.join();
+        if (failed) return error("%s: failed to read value", __func__);
         if (ShutdownRequested()) return false;
-        std::pair<uint8_t, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
+
+        for (int t = 0; t < wave_size; ++t) {
+            for (const auto& [hash, diskindex] : buckets[t]) {
                 // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.ConstructBlockHash());
+                CBlockIndex* pindexNew = insertBlockIndex(hash);
                 pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
                 pindexNew->nHeight        = diskindex.nHeight;
                 pindexNew->nFile          = diskindex.nFile;
@@ -323,13 +543,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams,
                 pindexNew->nNonce         = diskindex.nNonce;
                 pindexNew->nStatus        = diskindex.nStatus;
                 pindexNew->nTx            = diskindex.nTx;
-
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
             }
-        } else {
-            break;
         }
     }
 
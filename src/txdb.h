@@ -8,11 +8,16 @@
 
 #include <coins.h>
 #include <dbwrapper.h>
+#include <kernel/coinstats.h>
+#include <span.h>
 #include <sync.h>
+#include <threadsafety.h>
 
+#include <condition_variable>
 #include <memory>
 #include <optional>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -28,6 +33,8 @@ struct bilingual_str;
 static const int64_t nDefaultDbCache = 450;
 //! -dbbatchsize default (bytes)
 static const int64_t nDefaultDbBatchSize = 16 << 20;
+//! -asynccoinsflush default
+static constexpr bool DEFAULT_ASYNC_COINS_FLUSH{false};
 //! max. -dbcache (MiB)
 static const int64_t nMaxDbCache = sizeof(void*) > 4 ? 16384 : 1024;
 //! min. -dbcache (MiB)
@@ -38,40 +45,125 @@ static const int64_t nMaxBlockDBCache = 2;
 // Unlike for the UTXO database, for the txindex scenario the leveldb cache make
 // a meaningful difference: https://github.com/bitcoin/bitcoin/pull/8273#issuecomment-229601991
 static const int64_t nMaxTxIndexCache = 1024;
+//! Max memory allocated to address index DB specific cache in MiB.
+static const int64_t nMaxAddressIndexCache = 1024;
+//! Max memory allocated to spent output index DB specific cache in MiB.
+static const int64_t nMaxSpentIndexCache = 1024;
 //! Max memory allocated to all block filter index caches combined in MiB.
 static const int64_t max_filter_index_cache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! Maximum number of threads used to load the block index
+static const int MAX_BLOCK_INDEX_LOAD_THREADS = 16;
 
 // Actually declared in validation.cpp; can't include because of circular dependency.
 extern RecursiveMutex cs_main;
 
-/** CCoinsView backed by the coin database (chainstate/) */
+/**
+ * CCoinsView backed by the coin database (chainstate/)
+ *
+ * With asynchronous writes, BatchWrite() only takes a copy of the changed
+ * coins, which a background thread then writes to the database. Until that
+ * is done, lookups are answered from the copy. There is at most one batch
+ * being written and one waiting, so BatchWrite() blocks if a third one
+ * comes in before the first is written. Every batch is written with the
+ * same DB_HEAD_BLOCKS marker as a synchronous write, so a crash in the
+ * middle of a batch is recovered from by replaying blocks at startup.
+ */
 class CCoinsViewDB final : public CCoinsView
 {
 protected:
     std::unique_ptr<CDBWrapper> m_db;
     fs::path m_ldb_path;
     bool m_is_memory;
+
+    //! Changed coins and the block they are for, not written to the database yet
+    struct PendingBatch {
+        CCoinsMapMemoryResource resource{};
+        CCoinsMap coins{0, SaltedOutpointHasher{}, std::equal_to<COutPoint>{}, &resource};
+        uint256 best_block;
+    };
+
+    //! Keeps m_db from being replaced while it is compacted without cs_main
+    mutable Mutex m_compact_mutex;
+
+    mutable Mutex m_async_mutex;
+    mutable std::condition_variable m_async_cv;
+    //! Batch waiting for the write thread, newer than m_writing
+    std::unique_ptr<PendingBatch> m_queued GUARDED_BY(m_async_mutex);
+    //! Batch the write thread is writing
+    std::unique_ptr<PendingBatch> m_writing GUARDED_BY(m_async_mutex);
+    //! Set when a write failed. The failed batch is kept in m_writing so lookups stay correct.
+    bool m_write_failed GUARDED_BY(m_async_mutex){false};
+    bool m_stop GUARDED_BY(m_async_mutex){false};
+    //! Runs WriteThread(), only with asynchronous writes
+    std::thread m_write_thread;
+
+    //! Write the dirty entries of mapCoins to the database, marking it as in transition to hashBlock until done.
+    bool WriteCoins(CCoinsMap& mapCoins, const uint256& hashBlock, bool erase);
+    //! Best block according to the database, without pending batches
+    uint256 GetWrittenBestBlock() const;
+    //! Look up outpoint in the pending batches, newest first.
+    const Coin* FindPendingCoin(const COutPoint& outpoint) const EXCLUSIVE_LOCKS_REQUIRED(m_async_mutex);
+    void WriteThread() EXCLUSIVE_LOCKS_REQUIRED(!m_async_mutex);
+
 public:
     /**
      * @param[in] ldb_path    Location in the filesystem where leveldb data will be stored.
+     * @param[in] async_write Write batches on a background thread.
      */
-    explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe);
+    explicit CCoinsViewDB(fs::path ldb_path, size_t nCacheSize, bool fMemory, bool fWipe, bool async_write = false);
+    ~CCoinsViewDB();
 
     bool GetCoin(const COutPoint &outpoint, Coin &coin) const override;
+    /**
+     * Look up many coins at once, as GetCoin() would, but reading them from
+     * the database in key order. A coin that is not found is left spent.
+     */
+    void GetCoins(Span<const COutPoint> outpoints, Span<Coin> coins) const;
     bool HaveCoin(const COutPoint &outpoint) const override;
     uint256 GetBestBlock() const override;
     std::vector<uint256> GetHeadBlocks() const override;
-    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock) override;
+    bool BatchWrite(CCoinsMap &mapCoins, const uint256 &hashBlock, bool erase = true) override;
     std::unique_ptr<CCoinsViewCursor> Cursor() const override;
+    /**
+     * Get a cursor positioned at the first coin whose txid is not less than
+     * start, in the byte order of the database. Cursors created while
+     * holding cs_main see the same state of the database.
+     */
+    std::unique_ptr<CCoinsViewCursor> Cursor(const uint256& start) const;
 
     //! Whether an unsupported database format is used.
     bool NeedsUpgrade();
+    DBStats GetDBStats() const { return m_db->GetStats(); }
     size_t EstimateSize() const override;
 
+    /**
+     * Pause background compactions of the database while the returned
+     * object is alive, see CDBWrapper::CompactionPause. It must not outlive
+     * the database, which ResizeCache() replaces.
+     */
+    std::unique_ptr<CDBWrapper::CompactionPause> PauseCompactions() { return std::make_unique<CDBWrapper::CompactionPause>(*m_db); }
+    /**
+     * Compact the next range of keys of the database at an idle time, see
+     * CDBWrapper::CompactNextRange(). As it takes long, it can be called
+     * without holding cs_main.
+     */
+    bool CompactNextRange() EXCLUSIVE_LOCKS_REQUIRED(!m_compact_mutex);
+
+    /**
+     * Wait until all batches passed to BatchWrite() are in the database.
+     * Returns false if writing one of them failed.
+     */
+    bool WaitForWrites() const EXCLUSIVE_LOCKS_REQUIRED(!m_async_mutex);
+
     //! Dynamically alter the underlying leveldb cache size.
-    void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+    void ResizeCache(size_t new_cache_size) EXCLUSIVE_LOCKS_REQUIRED(cs_main, !m_async_mutex, !m_compact_mutex);
+
+    //! Store the MuHash of the coins as of block_hash, see -utxomuhash.
+    bool WriteUTXOMuHash(const uint256& block_hash, const kernel::UTXOSetMuHash& muhash);
+    //! The stored MuHash if it is for the best block, so still matches the coins.
+    std::optional<kernel::UTXOSetMuHash> ReadUTXOMuHash() const;
 };
 
 /** Access to the block database (blocks/index/) */
@@ -87,7 +179,20 @@ public:
     void ReadReindexing(bool &fReindexing);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /**
+     * Load all block index records, calling insertBlockIndex for every block
+     * and parent hash. Records are read and deserialized on up to num_threads
+     * threads (0 for one per core, at most MAX_BLOCK_INDEX_LOAD_THREADS), but
+     * inserted on the calling thread in key order.
+     */
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex, int num_threads = 0) EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /**
+     * Read or write the id of the block index snapshot file that matches the
+     * block index records. WriteBatchSync() erases it, so a snapshot is only
+     * used if no block index record was written after it.
+     */
+    bool ReadBlockIndexSnapshotId(uint256& snapshot_id);
+    bool WriteBlockIndexSnapshotId(const uint256& snapshot_id);
     bool ReadSyncCheckpoint(uint256& hashCheckpoint);
     bool WriteSyncCheckpoint(uint256 hashCheckpoint);
     bool ReadCheckpointPubKey(std::string& strPubKey);
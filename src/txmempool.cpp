@@ -10,10 +10,12 @@
 #include <consensus/consensus.h>
 #include <consensus/tx_verify.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
 #include <policy/settings.h>
 #include <reverse_iterator.h>
+#include <script/interpreter.h>
 #include <util/check.h>
 #include <util/moneystr.h>
 #include <util/overflow.h>
@@ -23,6 +25,7 @@
 
 #include <cmath>
 #include <optional>
+#include <queue>
 
 bool TestLockPointValidity(CChain& active_chain, const LockPoints& lp)
 {
@@ -60,6 +63,21 @@ CTxMemPoolEntry::CTxMemPoolEntry(const CTransactionRef& tx, CAmount fee,
       nModFeesWithAncestors{nFee},
       nSigOpCostWithAncestors{sigOpCost} {}
 
+static size_t PrecomputedTxDataUsage(const std::shared_ptr<const PrecomputedTransactionData>& txdata)
+{
+    if (!txdata) return 0;
+    size_t usage{memusage::DynamicUsage(txdata) + memusage::DynamicUsage(txdata->m_spent_outputs)};
+    for (const CTxOut& out : txdata->m_spent_outputs) usage += RecursiveDynamicUsage(out);
+    return usage;
+}
+
+void CTxMemPoolEntry::SetPrecomputedTxData(std::shared_ptr<const PrecomputedTransactionData> txdata)
+{
+    nUsageSize -= PrecomputedTxDataUsage(m_precomputed_txdata);
+    m_precomputed_txdata = std::move(txdata);
+    nUsageSize += PrecomputedTxDataUsage(m_precomputed_txdata);
+}
+
 void CTxMemPoolEntry::UpdateModifiedFee(CAmount fee_diff)
 {
     nModFeesWithDescendants = SaturatingAdd(nModFeesWithDescendants, fee_diff);
@@ -80,8 +98,9 @@ size_t CTxMemPoolEntry::GetTxSize() const
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendants,
                                       const std::set<uint256>& setExclude, std::set<uint256>& descendants_to_remove)
 {
-    CTxMemPoolEntry::Children stageEntries, descendants;
-    stageEntries = updateIt->GetMemPoolChildrenConst();
+    // The descendants may be many, so walk them with std::sets
+    const CTxMemPoolEntry::Children& update_children = updateIt->GetMemPoolChildrenConst();
+    std::set<CTxMemPoolEntry::CTxMemPoolEntryRef, CompareIteratorByHash> stageEntries(update_children.begin(), update_children.end()), descendants;
 
     while (!stageEntries.empty()) {
         const CTxMemPoolEntry& descendant = *stageEntries.begin();
@@ -195,12 +214,24 @@ bool CTxMemPool::CalculateAncestorsAndCheckLimits(size_t entry_size,
 {
     size_t totalSizeWithAncestors = entry_size;
 
-    while (!staged_ancestors.empty()) {
-        const CTxMemPoolEntry& stage = staged_ancestors.begin()->get();
-        txiter stageit = mapTx.iterator_to(stage);
+    // Walk the ancestors depth first, marking each one visited in a fresh
+    // epoch instead of looking it up in a staging set.
+    std::vector<txiter>& stage{m_walk_buffer};
+    stage.clear();
+    WITH_FRESH_EPOCH(m_epoch);
+    for (txiter ancestor_it : setAncestors) {
+        visited(ancestor_it);
+    }
+    for (const CTxMemPoolEntry& ancestor : staged_ancestors) {
+        txiter ancestor_it = mapTx.iterator_to(ancestor);
+        if (!visited(ancestor_it)) stage.push_back(ancestor_it);
+    }
+
+    while (!stage.empty()) {
+        txiter stageit = stage.back();
+        stage.pop_back();
 
         setAncestors.insert(stageit);
-        staged_ancestors.erase(stage);
         totalSizeWithAncestors += stageit->GetTxSize();
 
         if (stageit->GetSizeWithDescendants() + entry_size > limitDescendantSize) {
@@ -219,10 +250,10 @@ bool CTxMemPool::CalculateAncestorsAndCheckLimits(size_t entry_size,
             txiter parent_it = mapTx.iterator_to(parent);
 
             // If this is a new ancestor, add it.
-            if (setAncestors.count(parent_it) == 0) {
-                staged_ancestors.insert(parent);
+            if (!visited(parent_it)) {
+                stage.push_back(parent_it);
             }
-            if (staged_ancestors.size() + setAncestors.size() + entry_count > limitAncestorCount) {
+            if (stage.size() + setAncestors.size() + entry_count > limitAncestorCount) {
                 errString = strprintf("too many unconfirmed ancestors [limit: %u]", limitAncestorCount);
                 return false;
             }
@@ -306,7 +337,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry,
                                             limitDescendantCount, limitDescendantSize, errString);
 }
 
-void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
+void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, const std::vector<txiter>& ancestors)
 {
     const CTxMemPoolEntry::Parents& parents = it->GetMemPoolParentsConst();
     // add or remove this tx as a child of each parent
@@ -316,7 +347,7 @@ void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors
     const int64_t updateCount = (add ? 1 : -1);
     const int64_t updateSize = updateCount * it->GetTxSize();
     const CAmount updateFee = updateCount * it->GetModifiedFee();
-    for (txiter ancestorIt : setAncestors) {
+    for (txiter ancestorIt : ancestors) {
         mapTx.modify(ancestorIt, [=](CTxMemPoolEntry& e) { e.UpdateDescendantState(updateSize, updateFee, updateCount); });
     }
 }
@@ -347,7 +378,7 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
 {
     // For each entry, walk back all ancestors and decrement size associated with this
     // transaction
-    const uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
+    std::vector<txiter>& walked{m_walk_buffer};
     if (updateDescendants) {
         // updateDescendants should be true whenever we're not recursively
         // removing a tx and all its descendants, eg when a transaction is
@@ -356,25 +387,24 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // and CTxMemPoolEntry::Children (which we need to preserve until we're
         // finished with all operations that need to traverse the mempool).
         for (txiter removeIt : entriesToRemove) {
-            setEntries setDescendants;
-            CalculateDescendants(removeIt, setDescendants);
-            setDescendants.erase(removeIt); // don't update state for self
+            walked.clear();
+            {
+                WITH_FRESH_EPOCH(m_epoch);
+                WalkDescendants(removeIt, walked);
+            }
             int64_t modifySize = -((int64_t)removeIt->GetTxSize());
             CAmount modifyFee = -removeIt->GetModifiedFee();
             int modifySigOps = -removeIt->GetSigOpCost();
-            for (txiter dit : setDescendants) {
-                mapTx.modify(dit, [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(modifySize, modifyFee, -1, modifySigOps); });
+            // The walk starts at removeIt: don't update state for self
+            for (size_t i = 1; i < walked.size(); ++i) {
+                mapTx.modify(walked[i], [=](CTxMemPoolEntry& e){ e.UpdateAncestorState(modifySize, modifyFee, -1, modifySigOps); });
             }
         }
     }
     for (txiter removeIt : entriesToRemove) {
-        setEntries setAncestors;
-        const CTxMemPoolEntry &entry = *removeIt;
-        std::string dummy;
-        // Since this is a tx that is already in the mempool, we can call CMPA
-        // with fSearchForParents = false.  If the mempool is in a consistent
-        // state, then using true or false should both be correct, though false
-        // should be a bit faster.
+        // Walk the cached parents rather than searching mapNextTx. If the
+        // mempool is in a consistent state, then both should be correct,
+        // though the cached parents should be a bit faster.
         // However, if we happen to be in the middle of processing a reorg, then
         // the mempool can be in an inconsistent state.  In this case, the set
         // of ancestors reachable via GetMemPoolParents()/GetMemPoolChildren()
@@ -390,10 +420,14 @@ void CTxMemPool::UpdateForRemoveFromMempool(const setEntries &entriesToRemove, b
         // mempool parents we'd calculate by searching, and it's important that
         // we use the cached notion of ancestor transactions as the set of
         // things to update for removal.
-        CalculateMemPoolAncestors(entry, setAncestors, nNoLimit, nNoLimit, nNoLimit, nNoLimit, dummy, false);
+        walked.clear();
+        {
+            WITH_FRESH_EPOCH(m_epoch);
+            WalkAncestors(removeIt, walked);
+        }
         // Note that UpdateAncestorsOf severs the child links that point to
         // removeIt in the entries for the parents of removeIt.
-        UpdateAncestorsOf(false, removeIt, setAncestors);
+        UpdateAncestorsOf(false, removeIt, walked);
     }
     // After updating all the ancestor sizes, we can now sever the link between each
     // transaction being removed and any mempool children (ie, update CTxMemPoolEntry::m_parents
@@ -435,6 +469,8 @@ CTxMemPool::CTxMemPool(const Options& opts)
       m_max_datacarrier_bytes{opts.max_datacarrier_bytes},
       m_require_standard{opts.require_standard},
       m_full_rbf{opts.full_rbf},
+      m_cluster_mode{opts.cluster_mode},
+      m_max_delta_events{opts.max_delta_events},
       m_limits{opts.limits}
 {
     _clear(); //lock free clear
@@ -494,7 +530,9 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     for (const auto& pit : GetIterSet(setParentTransactions)) {
             UpdateParent(newit, pit, true);
     }
-    UpdateAncestorsOf(true, newit, setAncestors);
+    std::vector<txiter>& ancestors{m_walk_buffer};
+    ancestors.assign(setAncestors.begin(), setAncestors.end());
+    UpdateAncestorsOf(true, newit, ancestors);
     UpdateEntryForAncestors(newit, setAncestors);
 
     nTransactionsUpdated++;
@@ -508,11 +546,29 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, setEntries &setAnces
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 }
 
+uint64_t CTxMemPool::GetAndIncrementSequence(const uint256& txid, bool added)
+{
+    AssertLockHeld(cs);
+    if (m_max_delta_events > 0) {
+        if (m_delta_events.size() >= m_max_delta_events) m_delta_events.pop_front();
+        m_delta_events.push_back({m_sequence_number, txid, added});
+    }
+    return m_sequence_number++;
+}
+
+std::optional<std::vector<MempoolDeltaEvent>> CTxMemPool::GetDeltaEvents(uint64_t since) const
+{
+    AssertLockHeld(cs);
+    const uint64_t oldest{m_sequence_number - m_delta_events.size()};
+    if (since < oldest || since > m_sequence_number) return std::nullopt;
+    return std::vector<MempoolDeltaEvent>(m_delta_events.begin() + (since - oldest), m_delta_events.end());
+}
+
 void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 {
     // We increment mempool sequence value no matter removal reason
     // even if not directly reported below.
-    uint64_t mempool_sequence = GetAndIncrementSequence();
+    uint64_t mempool_sequence = GetAndIncrementSequence(it->GetTx().GetHash(), /*added=*/false);
 
     if (reason != MemPoolRemovalReason::BLOCK) {
         // Notify clients that a transaction has been removed from the mempool
@@ -540,7 +596,7 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     totalTxSize -= it->GetTxSize();
     m_total_fee -= it->GetFee();
     cachedInnerUsage -= it->DynamicMemoryUsage();
-    cachedInnerUsage -= memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+    cachedInnerUsage -= it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
     mapTx.erase(it);
     nTransactionsUpdated++;
     if (minerPolicyEstimator) {minerPolicyEstimator->removeTx(hash, false);}
@@ -554,26 +610,54 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
 // can save time by not iterating over those entries.
 void CTxMemPool::CalculateDescendants(txiter entryit, setEntries& setDescendants) const
 {
-    setEntries stage;
-    if (setDescendants.count(entryit) == 0) {
-        stage.insert(entryit);
-    }
+    if (setDescendants.count(entryit)) return;
+    std::vector<txiter>& stage{m_walk_buffer};
+    stage.clear();
+    stage.push_back(entryit);
     // Traverse down the children of entry, only adding children that are not
     // accounted for in setDescendants already (because those children have either
     // already been walked, or will be walked in this iteration).
-    while (!stage.empty()) {
-        txiter it = *stage.begin();
-        setDescendants.insert(it);
-        stage.erase(it);
-
-        const CTxMemPoolEntry::Children& children = it->GetMemPoolChildrenConst();
+    WITH_FRESH_EPOCH(m_epoch);
+    visited(entryit);
+    for (size_t i = 0; i < stage.size(); ++i) {
+        const CTxMemPoolEntry::Children& children = stage[i]->GetMemPoolChildrenConst();
         for (const CTxMemPoolEntry& child : children) {
             txiter childiter = mapTx.iterator_to(child);
-            if (!setDescendants.count(childiter)) {
-                stage.insert(childiter);
+            if (!visited(childiter) && !setDescendants.count(childiter)) {
+                stage.push_back(childiter);
             }
         }
     }
+    setDescendants.insert(stage.begin(), stage.end());
+}
+
+void CTxMemPool::WalkDescendants(txiter it, std::vector<txiter>& descendants) const
+{
+    if (visited(it)) return;
+    // The entries appended to descendants double as the queue of the walk
+    size_t i{descendants.size()};
+    descendants.push_back(it);
+    for (; i < descendants.size(); ++i) {
+        for (const CTxMemPoolEntry& child : descendants[i]->GetMemPoolChildrenConst()) {
+            txiter child_it = mapTx.iterator_to(child);
+            if (!visited(child_it)) descendants.push_back(child_it);
+        }
+    }
+}
+
+void CTxMemPool::WalkAncestors(txiter it, std::vector<txiter>& ancestors) const
+{
+    size_t i{ancestors.size()};
+    for (const CTxMemPoolEntry& parent : it->GetMemPoolParentsConst()) {
+        txiter parent_it = mapTx.iterator_to(parent);
+        if (!visited(parent_it)) ancestors.push_back(parent_it);
+    }
+    for (; i < ancestors.size(); ++i) {
+        for (const CTxMemPoolEntry& parent : ancestors[i]->GetMemPoolParentsConst()) {
+            txiter parent_it = mapTx.iterator_to(parent);
+            if (!visited(parent_it)) ancestors.push_back(parent_it);
+        }
+    }
 }
 
 void CTxMemPool::removeRecursive(const CTransaction &origTx, MemPoolRemovalReason reason)
@@ -717,7 +801,7 @@ void CTxMemPool::check(const CCoinsViewCache& active_coins_tip, int64_t spendhei
         check_total_fee += it->GetFee();
         innerUsage += it->DynamicMemoryUsage();
         const CTransaction& tx = it->GetTx();
-        innerUsage += memusage::DynamicUsage(it->GetMemPoolParentsConst()) + memusage::DynamicUsage(it->GetMemPoolChildrenConst());
+        innerUsage += it->GetMemPoolParentsConst().DynamicMemoryUsage() + it->GetMemPoolChildrenConst().DynamicMemoryUsage();
         CTxMemPoolEntry::Parents setParentCheck;
         for (const CTxIn &txin : tx.vin) {
             // Check that every mempool transaction's inputs refer to available coins, or other mempool tx's.
@@ -888,6 +972,15 @@ CTransactionRef CTxMemPool::get(const uint256& hash) const
     return i->GetSharedTx();
 }
 
+std::shared_ptr<const PrecomputedTransactionData> CTxMemPool::GetPrecomputedTxData(const uint256& wtxid) const
+{
+    LOCK(cs);
+    const auto& index = mapTx.get<index_by_wtxid>();
+    const auto i = index.find(wtxid);
+    if (i == index.end()) return nullptr;
+    return i->GetPrecomputedTxData();
+}
+
 TxMempoolInfo CTxMemPool::info(const GenTxid& gtxid) const
 {
     LOCK(cs);
@@ -1012,6 +1105,22 @@ size_t CTxMemPool::DynamicMemoryUsage() const {
     return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
 }
 
+CTxMemPool::MemoryUsage CTxMemPool::GetMemoryUsage() const
+{
+    LOCK(cs);
+    MemoryUsage usage;
+    usage.entries = memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size();
+    for (const CTxMemPoolEntry& entry : mapTx) {
+        usage.relatives += entry.GetMemPoolParentsConst().DynamicMemoryUsage() + entry.GetMemPoolChildrenConst().DynamicMemoryUsage();
+    }
+    // cachedInnerUsage holds the usage of the transactions and their relatives
+    usage.transactions = cachedInnerUsage - usage.relatives;
+    usage.spends = memusage::DynamicUsage(mapNextTx);
+    usage.deltas = memusage::DynamicUsage(mapDeltas);
+    usage.tx_hashes = memusage::DynamicUsage(vTxHashes);
+    return usage;
+}
+
 void CTxMemPool::RemoveUnbroadcastTx(const uint256& txid, const bool unchecked) {
     LOCK(cs);
 
@@ -1058,23 +1167,29 @@ void CTxMemPool::addUnchecked(const CTxMemPoolEntry &entry, bool validFeeEstimat
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Children s;
-    if (add && entry->GetMemPoolChildren().insert(*child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolChildren().erase(*child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Children& children = entry->GetMemPoolChildren();
+    // The set may reallocate, so account for its whole usage
+    cachedInnerUsage -= children.DynamicMemoryUsage();
+    if (add) {
+        children.insert(*child);
+    } else {
+        children.erase(*child);
     }
+    cachedInnerUsage += children.DynamicMemoryUsage();
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
     AssertLockHeld(cs);
-    CTxMemPoolEntry::Parents s;
-    if (add && entry->GetMemPoolParents().insert(*parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && entry->GetMemPoolParents().erase(*parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
+    CTxMemPoolEntry::Parents& parents = entry->GetMemPoolParents();
+    // The set may reallocate, so account for its whole usage
+    cachedInnerUsage -= parents.DynamicMemoryUsage();
+    if (add) {
+        parents.insert(*parent);
+    } else {
+        parents.erase(*parent);
     }
+    cachedInnerUsage += parents.DynamicMemoryUsage();
 }
 
 CFeeRate CTxMemPool::GetMinFee(size_t sizelimit) const {
@@ -1109,25 +1224,176 @@ void CTxMemPool::trackPackageRemoved(const CFeeRate& rate) {
     }
 }
 
+/** Whether chunk a has a lower feerate than chunk b */
+static bool LowerChunkFeerate(const CTxMemPool::Chunk& a, const CTxMemPool::Chunk& b)
+{
+    return (double)a.fee * b.size < (double)b.fee * a.size;
+}
+
+void CTxMemPool::GatherCluster(txiter it, std::vector<txiter>& cluster) const
+{
+    AssertLockHeld(cs);
+    const size_t first{cluster.size()};
+    if (visited(it)) return;
+    cluster.push_back(it);
+    for (size_t i = first; i < cluster.size(); ++i) {
+        for (const CTxMemPoolEntry& parent : cluster[i]->GetMemPoolParentsConst()) {
+            const txiter parent_it{mapTx.iterator_to(parent)};
+            if (!visited(parent_it)) cluster.push_back(parent_it);
+        }
+        for (const CTxMemPoolEntry& child : cluster[i]->GetMemPoolChildrenConst()) {
+            const txiter child_it{mapTx.iterator_to(child)};
+            if (!visited(child_it)) cluster.push_back(child_it);
+        }
+    }
+}
+
+std::vector<CTxMemPool::Chunk> CTxMemPool::LinearizeCluster(const std::vector<txiter>& cluster) const
+{
+    AssertLockHeld(cs);
+    const size_t n{cluster.size()};
+    std::map<txiter, size_t, CompareIteratorByHash> positions;
+    for (size_t i = 0; i < n; ++i) positions.emplace(cluster[i], i);
+
+    // The ancestors and descendants of each transaction, including itself.
+    // All of them are in the cluster.
+    std::vector<std::vector<size_t>> ancestors(n), descendants(n);
+    std::vector<size_t> seen(n, n);
+    for (size_t i = 0; i < n; ++i) {
+        std::vector<size_t> todo{i};
+        seen[i] = i;
+        while (!todo.empty()) {
+            const size_t a{todo.back()};
+            todo.pop_back();
+            ancestors[i].push_back(a);
+            descendants[a].push_back(i);
+            for (const CTxMemPoolEntry& parent : cluster[a]->GetMemPoolParentsConst()) {
+                const size_t p{positions.at(mapTx.iterator_to(parent))};
+                if (seen[p] != i) {
+                    seen[p] = i;
+                    todo.push_back(p);
+                }
+            }
+        }
+    }
+
+    // Fee and size of the ancestors of each transaction that are not picked yet
+    std::vector<Chunk> left(n);
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t a : ancestors[i]) {
+            left[i].fee += cluster[a]->GetModifiedFee();
+            left[i].size += cluster[a]->GetTxSize();
+        }
+    }
+
+    std::vector<txiter> linearization;
+    linearization.reserve(n);
+    std::vector<bool> picked(n, false);
+    while (linearization.size() < n) {
+        size_t best{n};
+        for (size_t i = 0; i < n; ++i) {
+            if (picked[i]) continue;
+            if (best == n || LowerChunkFeerate(left[best], left[i]) ||
+                (!LowerChunkFeerate(left[i], left[best]) && left[i].size < left[best].size)) {
+                best = i;
+            }
+        }
+
+        // Ancestor counts order the set topologically
+        std::vector<txiter> set;
+        for (size_t a : ancestors[best]) {
+            if (!picked[a]) set.push_back(cluster[a]);
+        }
+        std::sort(set.begin(), set.end(), [](txiter a, txiter b) {
+            if (a->GetCountWithAncestors() != b->GetCountWithAncestors()) {
+                return a->GetCountWithAncestors() < b->GetCountWithAncestors();
+            }
+            return CompareIteratorByHash()(a, b);
+        });
+        for (txiter it : set) picked[positions.at(it)] = true;
+        for (txiter it : set) {
+            linearization.push_back(it);
+            for (size_t d : descendants[positions.at(it)]) {
+                if (picked[d]) continue;
+                left[d].fee -= it->GetModifiedFee();
+                left[d].size -= it->GetTxSize();
+            }
+        }
+    }
+
+    // Merge each transaction into the chunks before it while it raises their feerate
+    std::vector<Chunk> chunks;
+    for (txiter it : linearization) {
+        chunks.push_back({{it}, it->GetModifiedFee(), static_cast<int64_t>(it->GetTxSize()), it->GetSigOpCost()});
+        while (chunks.size() > 1 && LowerChunkFeerate(chunks[chunks.size() - 2], chunks.back())) {
+            Chunk& prev{chunks[chunks.size() - 2]};
+            prev.txs.insert(prev.txs.end(), chunks.back().txs.begin(), chunks.back().txs.end());
+            prev.fee += chunks.back().fee;
+            prev.size += chunks.back().size;
+            prev.sigops_cost += chunks.back().sigops_cost;
+            chunks.pop_back();
+        }
+    }
+    return chunks;
+}
+
+std::vector<std::vector<CTxMemPool::Chunk>> CTxMemPool::GetClusterChunks() const
+{
+    AssertLockHeld(cs);
+    std::vector<std::vector<Chunk>> clusters;
+    std::vector<txiter>& cluster{m_walk_buffer};
+    WITH_FRESH_EPOCH(m_epoch);
+    for (txiter it = mapTx.begin(); it != mapTx.end(); ++it) {
+        cluster.clear();
+        GatherCluster(it, cluster);
+        if (cluster.empty()) continue;
+        clusters.push_back(LinearizeCluster(cluster));
+    }
+    return clusters;
+}
+
 void CTxMemPool::TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining) {
     AssertLockHeld(cs);
 
     unsigned nTxnRemoved = 0;
     CFeeRate maxFeeRateRemoved(0);
+
+    // In cluster mode, the worst chunk is the one with the lowest feerate of
+    // the last chunks of all clusters. Removing the last chunk of a cluster
+    // removes all its descendants, and leaves the chunks before it unchanged.
+    std::vector<std::vector<Chunk>> clusters;
+    auto higher_last_chunk = [&](size_t a, size_t b) { return LowerChunkFeerate(clusters[b].back(), clusters[a].back()); };
+    std::priority_queue<size_t, std::vector<size_t>, decltype(higher_last_chunk)> worst_clusters(higher_last_chunk);
+    if (m_cluster_mode && DynamicMemoryUsage() > sizelimit) {
+        clusters = GetClusterChunks();
+        for (size_t i = 0; i < clusters.size(); ++i) worst_clusters.push(i);
+    }
+
     while (!mapTx.empty() && DynamicMemoryUsage() > sizelimit) {
-        indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+        CFeeRate removed;
+        setEntries stage;
+        if (m_cluster_mode) {
+            const size_t worst{worst_clusters.top()};
+            worst_clusters.pop();
+            const Chunk chunk{std::move(clusters[worst].back())};
+            clusters[worst].pop_back();
+            if (!clusters[worst].empty()) worst_clusters.push(worst);
+            removed = CFeeRate(chunk.fee, static_cast<uint32_t>(chunk.size));
+            stage.insert(chunk.txs.begin(), chunk.txs.end());
+        } else {
+            indexed_transaction_set::index<descendant_score>::type::iterator it = mapTx.get<descendant_score>().begin();
+            removed = CFeeRate(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
+            CalculateDescendants(mapTx.project<0>(it), stage);
+        }
 
         // We set the new mempool min fee to the feerate of the removed set, plus the
         // "minimum reasonable fee rate" (ie some value under which we consider txn
         // to have 0 fee). This way, we don't allow txn to enter mempool with feerate
         // equal to txn which were removed with no block in between.
-        CFeeRate removed(it->GetModFeesWithDescendants(), it->GetSizeWithDescendants());
         removed += m_incremental_relay_feerate;
         trackPackageRemoved(removed);
         maxFeeRateRemoved = std::max(maxFeeRateRemoved, removed);
 
-        setEntries stage;
-        CalculateDescendants(mapTx.project<0>(it), stage);
         nTxnRemoved += stage.size();
 
         std::vector<CTransaction> txn;
@@ -6,8 +6,11 @@
 #ifndef BITCOIN_TXMEMPOOL_H
 #define BITCOIN_TXMEMPOOL_H
 
+#include <algorithm>
 #include <atomic>
+#include <deque>
 #include <map>
+#include <memory>
 #include <optional>
 #include <set>
 #include <string>
@@ -20,8 +23,10 @@
 #include <coins.h>
 #include <consensus/amount.h>
 #include <indirectmap.h>
+#include <memusage.h>
 #include <policy/feerate.h>
 #include <policy/packages.h>
+#include <prevector.h>
 #include <primitives/transaction.h>
 #include <random.h>
 #include <sync.h>
@@ -36,6 +41,7 @@
 class CBlockIndex;
 class CChain;
 class Chainstate;
+struct PrecomputedTransactionData;
 extern RecursiveMutex cs_main;
 
 /** Fake height value used in Coin to signify they are only in the memory pool (since 0.8) */
@@ -73,6 +79,57 @@ struct CompareIteratorByHash {
     }
 };
 
+/** A set kept as a sorted prevector. The first N elements are stored inline,
+ *  so small sets need no allocation at all, unlike a std::set which allocates
+ *  a node per element. Insertion and removal are linear in the size of the set.
+ */
+template <unsigned int N, typename T, typename Compare>
+class SortedPrevectorSet
+{
+    prevector<N, T> m_elems;
+
+public:
+    using const_iterator = typename prevector<N, T>::const_iterator;
+
+    SortedPrevectorSet() = default;
+    SortedPrevectorSet(const SortedPrevectorSet&) = default;
+    // prevector assignment needs T to be default constructible
+    SortedPrevectorSet& operator=(const SortedPrevectorSet& other)
+    {
+        prevector<N, T> elems{other.m_elems};
+        m_elems.swap(elems);
+        return *this;
+    }
+
+    const_iterator begin() const { return m_elems.begin(); }
+    const_iterator end() const { return m_elems.end(); }
+    size_t size() const { return m_elems.size(); }
+    bool empty() const { return m_elems.empty(); }
+
+    size_t count(const T& value) const
+    {
+        const auto it{std::lower_bound(m_elems.begin(), m_elems.end(), value, Compare{})};
+        return it != m_elems.end() && !Compare{}(value, *it);
+    }
+
+    std::pair<const_iterator, bool> insert(const T& value)
+    {
+        auto it{std::lower_bound(m_elems.begin(), m_elems.end(), value, Compare{})};
+        if (it != m_elems.end() && !Compare{}(value, *it)) return {it, false};
+        return {m_elems.insert(it, value), true};
+    }
+
+    size_t erase(const T& value)
+    {
+        const auto it{std::lower_bound(m_elems.begin(), m_elems.end(), value, Compare{})};
+        if (it == m_elems.end() || Compare{}(value, *it)) return 0;
+        m_elems.erase(it);
+        return 1;
+    }
+
+    size_t DynamicMemoryUsage() const { return memusage::DynamicUsage(m_elems); }
+};
+
 /** \class CTxMemPoolEntry
  *
  * CTxMemPoolEntry stores data about the corresponding transaction, as well
@@ -89,9 +146,10 @@ class CTxMemPoolEntry
 {
 public:
     typedef std::reference_wrapper<const CTxMemPoolEntry> CTxMemPoolEntryRef;
-    // two aliases, should the types ever diverge
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Parents;
-    typedef std::set<CTxMemPoolEntryRef, CompareIteratorByHash> Children;
+    // two aliases, should the types ever diverge. Most transactions have only
+    // one or two in-mempool parents or children, which are stored inline.
+    typedef SortedPrevectorSet<2, CTxMemPoolEntryRef, CompareIteratorByHash> Parents;
+    typedef SortedPrevectorSet<2, CTxMemPoolEntryRef, CompareIteratorByHash> Children;
 
 private:
     const CTransactionRef tx;
@@ -99,13 +157,15 @@ private:
     mutable Children m_children;
     const CAmount nFee;             //!< Cached to avoid expensive parent-transaction lookups
     const size_t nTxWeight;         //!< ... and avoid recomputing tx weight (also used for GetTxSize())
-    const size_t nUsageSize;        //!< ... and total memory usage
+    size_t nUsageSize;              //!< ... and total memory usage
     const int64_t nTime;            //!< Local time when entering the mempool
     const unsigned int entryHeight; //!< Chain height when entering the mempool
     const bool spendsCoinbase;      //!< keep track of transactions that spend a coinbase
     const int64_t sigOpCost;        //!< Total sigop cost
     CAmount m_modified_fee;         //!< Used for determining the priority of the transaction for mining in a block
     LockPoints lockPoints;     //!< Track the height and time at which tx was final
+    //! Signature hash midstates computed when the transaction was accepted, reused by ConnectBlock
+    std::shared_ptr<const PrecomputedTransactionData> m_precomputed_txdata;
 
     // Information about descendants of this transaction that are in the
     // mempool; if we remove this transaction we must remove all of these
@@ -137,6 +197,10 @@ public:
     CAmount GetModifiedFee() const { return m_modified_fee; }
     size_t DynamicMemoryUsage() const { return nUsageSize; }
     const LockPoints& GetLockPoints() const { return lockPoints; }
+    const std::shared_ptr<const PrecomputedTransactionData>& GetPrecomputedTxData() const { return m_precomputed_txdata; }
+
+    //! Keep the precomputed data of the transaction. Must be called before the entry is added to the mempool, as it changes its memory usage.
+    void SetPrecomputedTxData(std::shared_ptr<const PrecomputedTransactionData> txdata);
 
     // Adjusts the descendant state.
     void UpdateDescendantState(int64_t modifySize, CAmount modifyFee, int64_t modifyCount);
@@ -355,6 +419,13 @@ enum class MemPoolRemovalReason {
     REPLACED,    //!< Removed for replacement
 };
 
+/** A transaction entering or leaving the mempool, numbered by the mempool sequence it was assigned */
+struct MempoolDeltaEvent {
+    uint64_t sequence;
+    uint256 txid;
+    bool added;
+};
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -448,6 +519,9 @@ protected:
     // This number is incremented once every time a transaction
     // is added or removed from the mempool for any reason.
     mutable uint64_t m_sequence_number GUARDED_BY(cs){1};
+    //! The events of the last sequence values, as every value is assigned to one transaction entering or leaving
+    std::deque<MempoolDeltaEvent> m_delta_events GUARDED_BY(cs);
+    const size_t m_max_delta_events;
 
     void trackPackageRemoved(const CFeeRate& rate) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -530,6 +604,8 @@ public:
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
+    //! Reused by the ancestor and descendant walks so they do not allocate
+    mutable std::vector<txiter> m_walk_buffer GUARDED_BY(cs);
 
     void UpdateParent(txiter entry, txiter parent, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
     void UpdateChild(txiter entry, txiter child, bool add) EXCLUSIVE_LOCKS_REQUIRED(cs);
@@ -575,6 +651,7 @@ public:
     const std::optional<unsigned> m_max_datacarrier_bytes;
     const bool m_require_standard;
     const bool m_full_rbf;
+    const bool m_cluster_mode;
 
     using Limits = kernel::MemPoolLimits;
 
@@ -723,6 +800,32 @@ public:
       */
     void TrimToSize(size_t sizelimit, std::vector<COutPoint>* pvNoSpendsRemaining = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
+    /** Transactions of a cluster that are mined or evicted together: a run of
+     *  the linearization of the cluster with a higher feerate than the runs
+     *  after it. Fees are modified fees and sizes virtual sizes. */
+    struct Chunk {
+        //! The transactions, in an order that is valid in a block
+        std::vector<txiter> txs;
+        CAmount fee{0};
+        int64_t size{0};
+        int64_t sigops_cost{0};
+    };
+
+    /** Partition the mempool into clusters, the sets of transactions connected
+     *  by spending each other, and linearize each cluster into chunks of
+     *  decreasing feerate. A chunk only depends on chunks before it in its
+     *  cluster, so chunks can be merged across clusters by feerate. */
+    std::vector<std::vector<Chunk>> GetClusterChunks() const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+private:
+    /** Append the cluster of it to cluster, marking its transactions visited. */
+    void GatherCluster(txiter it, std::vector<txiter>& cluster) const EXCLUSIVE_LOCKS_REQUIRED(cs, m_epoch);
+    /** Linearize a cluster by repeatedly taking the highest feerate ancestor set
+     *  of what is left, and split the linearization into chunks. */
+    std::vector<Chunk> LinearizeCluster(const std::vector<txiter>& cluster) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
+public:
+
     /** Expire all transaction (and their dependencies) in the mempool older than time. Return the number of removed transactions. */
     int Expire(std::chrono::seconds time) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
@@ -781,9 +884,29 @@ public:
     }
     TxMempoolInfo info(const GenTxid& gtxid) const;
     std::vector<TxMempoolInfo> infoAll() const;
+    /** The precomputed data of the transaction with this wtxid, or nullptr if it is not in the mempool or has none. */
+    std::shared_ptr<const PrecomputedTransactionData> GetPrecomputedTxData(const uint256& wtxid) const;
 
     size_t DynamicMemoryUsage() const;
 
+    /** The parts DynamicMemoryUsage() adds up, in bytes */
+    struct MemoryUsage {
+        //! The entries, including the overhead of the mapTx indexes
+        size_t entries{0};
+        //! The transactions and their precomputed signature data
+        size_t transactions{0};
+        //! The sets of in-mempool parents and children of the entries
+        size_t relatives{0};
+        //! mapNextTx
+        size_t spends{0};
+        //! mapDeltas
+        size_t deltas{0};
+        //! vTxHashes
+        size_t tx_hashes{0};
+    };
+    /** Break down DynamicMemoryUsage(). Iterates over the whole mempool. */
+    MemoryUsage GetMemoryUsage() const;
+
     /** Adds a transaction to the unbroadcast set */
     void AddUnbroadcastTx(const uint256& txid)
     {
@@ -810,15 +933,24 @@ public:
         return m_unbroadcast_txids.count(txid) != 0;
     }
 
-    /** Guards this internal counter for external reporting */
-    uint64_t GetAndIncrementSequence() const EXCLUSIVE_LOCKS_REQUIRED(cs) {
-        return m_sequence_number++;
-    }
+    /**
+     * Guards this internal counter for external reporting. Each value is
+     * assigned to a transaction entering (added) or leaving the mempool, which
+     * is kept in a bounded ring for getmempooldelta.
+     */
+    uint64_t GetAndIncrementSequence(const uint256& txid, bool added) EXCLUSIVE_LOCKS_REQUIRED(cs);
 
     uint64_t GetSequence() const EXCLUSIVE_LOCKS_REQUIRED(cs) {
         return m_sequence_number;
     }
 
+    /**
+     * Return the transactions that entered or left the mempool from sequence
+     * value since on, in order, or std::nullopt if they are no longer all kept
+     * (or since is beyond the current sequence) and the caller has to resync.
+     */
+    std::optional<std::vector<MempoolDeltaEvent>> GetDeltaEvents(uint64_t since) const EXCLUSIVE_LOCKS_REQUIRED(cs);
+
 private:
     /** UpdateForDescendants is used by UpdateTransactionsFromBlock to update
      *  the descendants for a single transaction that has been added to the
@@ -850,8 +982,14 @@ private:
      */
     void UpdateForDescendants(txiter updateIt, cacheMap& cachedDescendants,
                               const std::set<uint256>& setExclude, std::set<uint256>& descendants_to_remove) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    /** Append it and all its in-mempool descendants not visited in the current
+     *  epoch to descendants, marking them visited. */
+    void WalkDescendants(txiter it, std::vector<txiter>& descendants) const EXCLUSIVE_LOCKS_REQUIRED(cs, m_epoch);
+    /** Append all in-mempool ancestors of it not visited in the current epoch
+     *  to ancestors, marking them visited. Uses the cached parents of it. */
+    void WalkAncestors(txiter it, std::vector<txiter>& ancestors) const EXCLUSIVE_LOCKS_REQUIRED(cs, m_epoch);
     /** Update ancestors of hash to add/remove it as a descendant transaction. */
-    void UpdateAncestorsOf(bool add, txiter hash, setEntries &setAncestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
+    void UpdateAncestorsOf(bool add, txiter hash, const std::vector<txiter>& ancestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** Set ancestor state for an entry */
     void UpdateEntryForAncestors(txiter it, const setEntries &setAncestors) EXCLUSIVE_LOCKS_REQUIRED(cs);
     /** For each transaction being removed, update ancestors and any direct children.
@@ -39,9 +39,11 @@ bool TxOrphanage::AddTx(const CTransactionRef& tx, NodeId peer)
         return false;
     }
 
-    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, m_orphan_list.size()});
+    std::vector<OrphanMap::iterator>& peer_orphans = m_peer_orphans[peer];
+    auto ret = m_orphans.emplace(hash, OrphanTx{tx, peer, GetTime() + ORPHAN_TX_EXPIRE_TIME, m_orphan_list.size(), peer_orphans.size()});
     assert(ret.second);
     m_orphan_list.push_back(ret.first);
+    peer_orphans.push_back(ret.first);
     // Allow for lookups in the orphan pool by wtxid, as well as txid
     m_wtxid_to_orphan_it.emplace(tx->GetWitnessHash(), ret.first);
     for (const CTxIn& txin : tx->vin) {
@@ -79,6 +81,21 @@ int TxOrphanage::EraseTx(const uint256& txid)
         it_last->second.list_pos = old_pos;
     }
     m_orphan_list.pop_back();
+
+    // Likewise in the orphans of its peer
+    auto peer_it = m_peer_orphans.find(it->second.fromPeer);
+    assert(peer_it != m_peer_orphans.end());
+    std::vector<OrphanMap::iterator>& peer_orphans = peer_it->second;
+    old_pos = it->second.peer_pos;
+    assert(peer_orphans[old_pos] == it);
+    if (old_pos + 1 != peer_orphans.size()) {
+        auto it_last = peer_orphans.back();
+        peer_orphans[old_pos] = it_last;
+        it_last->second.peer_pos = old_pos;
+    }
+    peer_orphans.pop_back();
+    if (peer_orphans.empty()) m_peer_orphans.erase(peer_it);
+
     m_wtxid_to_orphan_it.erase(it->second.tx->GetWitnessHash());
 
     m_orphans.erase(it);
@@ -90,14 +107,9 @@ void TxOrphanage::EraseForPeer(NodeId peer)
     AssertLockHeld(g_cs_orphans);
 
     int nErased = 0;
-    std::map<uint256, OrphanTx>::iterator iter = m_orphans.begin();
-    while (iter != m_orphans.end())
-    {
-        std::map<uint256, OrphanTx>::iterator maybeErase = iter++; // increment to avoid iterator becoming invalid
-        if (maybeErase->second.fromPeer == peer)
-        {
-            nErased += EraseTx(maybeErase->second.tx->GetHash());
-        }
+    // EraseTx() drops the entry of the peer along with its last orphan
+    for (auto it = m_peer_orphans.find(peer); it != m_peer_orphans.end(); it = m_peer_orphans.find(peer)) {
+        nErased += EraseTx(it->second.back()->first);
     }
     if (nErased > 0) LogPrint(BCLog::MEMPOOL, "Erased %d orphan tx from peer=%d\n", nErased, peer);
 }
@@ -9,6 +9,12 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <sync.h>
+#include <util/hasher.h>
+
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
 
 /** Guards orphan transactions and extra txs for compact blocks */
 extern RecursiveMutex g_cs_orphans;
@@ -60,6 +66,7 @@ protected:
         NodeId fromPeer;
         int64_t nTimeExpire;
         size_t list_pos;
+        size_t peer_pos;
     };
 
     /** Map from txid to orphan transaction record. Limited by
@@ -79,14 +86,18 @@ protected:
 
     /** Index from the parents' COutPoint into the m_orphans. Used
      *  to remove orphan transactions from the m_orphans */
-    std::map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>> m_outpoint_to_orphan_it GUARDED_BY(g_cs_orphans);
+    std::unordered_map<COutPoint, std::set<OrphanMap::iterator, IteratorComparator>, SaltedOutpointHasher> m_outpoint_to_orphan_it GUARDED_BY(g_cs_orphans);
 
     /** Orphan transactions in vector for quick random eviction */
     std::vector<OrphanMap::iterator> m_orphan_list GUARDED_BY(g_cs_orphans);
 
+    /** Orphan transactions of each peer, at their peer_pos, so that those of
+     *  a peer are erased without going through all of them */
+    std::map<NodeId, std::vector<OrphanMap::iterator>> m_peer_orphans GUARDED_BY(g_cs_orphans);
+
     /** Index from wtxid into the m_orphans to lookup orphan
      *  transactions using their witness ids. */
-    std::map<uint256, OrphanMap::iterator> m_wtxid_to_orphan_it GUARDED_BY(g_cs_orphans);
+    std::unordered_map<uint256, OrphanMap::iterator, SaltedTxidHasher> m_wtxid_to_orphan_it GUARDED_BY(g_cs_orphans);
 };
 
 #endif // BITCOIN_TXORPHANAGE_H
@@ -53,12 +53,17 @@ enum class State : uint8_t {
 //! Type alias for sequence numbers.
 using SequenceNumber = uint64_t;
 
+//! Type alias for priorities.
+using Priority = uint64_t;
+
 /** An announcement. This is the data we track for each txid or wtxid that is announced to us by each peer. */
 struct Announcement {
     /** Txid or wtxid that was announced. */
     const uint256 m_txhash;
     /** For CANDIDATE_{DELAYED,BEST,READY} the reqtime; for REQUESTED the expiry. */
     std::chrono::microseconds m_time;
+    /** The priority of this announcement, computed once as the ByTxHash index compares it on every lookup. */
+    const Priority m_priority;
     /** What peer the request was from. */
     const NodeId m_peer;
     /** What sequence number this announcement has. */
@@ -99,14 +104,11 @@ struct Announcement {
 
     /** Construct a new announcement from scratch, initially in CANDIDATE_DELAYED state. */
     Announcement(const GenTxid& gtxid, NodeId peer, bool preferred, std::chrono::microseconds reqtime,
-        SequenceNumber sequence) :
-        m_txhash(gtxid.GetHash()), m_time(reqtime), m_peer(peer), m_sequence(sequence), m_preferred(preferred),
+        SequenceNumber sequence, Priority priority) :
+        m_txhash(gtxid.GetHash()), m_time(reqtime), m_priority(priority), m_peer(peer), m_sequence(sequence), m_preferred(preferred),
         m_is_wtxid(gtxid.IsWtxid()), m_state(static_cast<uint8_t>(State::CANDIDATE_DELAYED)) {}
 };
 
-//! Type alias for priorities.
-using Priority = uint64_t;
-
 /** A functor with embedded salt that computes priority of an announcement.
  *
  * Higher priorities are selected first.
@@ -166,14 +168,12 @@ struct ByPeerViewExtractor
 //   deleted.
 struct ByTxHash {};
 using ByTxHashView = std::tuple<const uint256&, State, Priority>;
-class ByTxHashViewExtractor {
-    const PriorityComputer& m_computer;
-public:
-    explicit ByTxHashViewExtractor(const PriorityComputer& computer) : m_computer(computer) {}
+struct ByTxHashViewExtractor
+{
     using result_type = ByTxHashView;
     result_type operator()(const Announcement& ann) const
     {
-        const Priority prio = (ann.GetState() == State::CANDIDATE_READY) ? m_computer(ann) : 0;
+        const Priority prio = (ann.GetState() == State::CANDIDATE_READY) ? ann.m_priority : 0;
         return ByTxHashView{ann.m_txhash, ann.GetState(), prio};
     }
 };
@@ -280,6 +280,8 @@ std::map<uint256, TxHashInfo> ComputeTxHashInfo(const Index& index, const Priori
     std::map<uint256, TxHashInfo> ret;
     for (const Announcement& ann : index) {
         TxHashInfo& info = ret[ann.m_txhash];
+        // The priority was computed when the announcement was created.
+        assert(ann.m_priority == computer(ann));
         // Classify how many announcements of each state we have for this txhash.
         info.m_candidate_delayed += (ann.GetState() == State::CANDIDATE_DELAYED);
         info.m_candidate_ready += (ann.GetState() == State::CANDIDATE_READY);
@@ -414,8 +416,8 @@ private:
             // already.
             Modify<ByTxHash>(it, [](Announcement& ann){ ann.SetState(State::CANDIDATE_BEST); });
         } else if (it_next->GetState() == State::CANDIDATE_BEST) {
-            Priority priority_old = m_computer(*it_next);
-            Priority priority_new = m_computer(*it);
+            Priority priority_old = it_next->m_priority;
+            Priority priority_new = it->m_priority;
             if (priority_new > priority_old) {
                 // There is a CANDIDATE_BEST announcement already, but this one is better.
                 Modify<ByTxHash>(it_next, [](Announcement& ann){ ann.SetState(State::CANDIDATE_READY); });
@@ -522,15 +524,9 @@ private:
 
 public:
     explicit Impl(bool deterministic) :
-        m_computer(deterministic),
-        // Explicitly initialize m_index as we need to pass a reference to m_computer to ByTxHashViewExtractor.
-        m_index(boost::make_tuple(
-            boost::make_tuple(ByPeerViewExtractor(), std::less<ByPeerView>()),
-            boost::make_tuple(ByTxHashViewExtractor(m_computer), std::less<ByTxHashView>()),
-            boost::make_tuple(ByTimeViewExtractor(), std::less<ByTimeView>())
-        )) {}
-
-    // Disable copying and assigning (a default copy won't work due the stateful ByTxHashViewExtractor).
+        m_computer(deterministic) {}
+
+    // Disable copying and assigning.
     Impl(const Impl&) = delete;
     Impl& operator=(const Impl&) = delete;
 
@@ -584,7 +580,8 @@ public:
         // Try creating the announcement with CANDIDATE_DELAYED state (which will fail due to the uniqueness
         // of the ByPeer index if a non-CANDIDATE_BEST announcement already exists with the same txhash and peer).
         // Bail out in that case.
-        auto ret = m_index.get<ByPeer>().emplace(gtxid, peer, preferred, reqtime, m_current_sequence);
+        auto ret = m_index.get<ByPeer>().emplace(gtxid, peer, preferred, reqtime, m_current_sequence,
+            m_computer(gtxid.GetHash(), peer, preferred));
         if (!ret.second) return;
 
         // Update accounting metadata.
@@ -13,6 +13,12 @@
 #include <serialize.h>
 #include <version.h>
 
+#include <cstdint>
+#include <ios>
+#include <limits>
+#include <optional>
+#include <vector>
+
 /** Formatter for undo information for a CTxIn
  *
  *  Contains the prevout's CTxOut being spent, and its metadata as well
@@ -59,6 +65,73 @@ public:
     SERIALIZE_METHODS(CTxUndo, obj) { READWRITE(Using<VectorFormatter<TxInUndoFormatter>>(obj.vprevout)); }
 };
 
+/**
+ * Formatter for the undo information of a CTxUndo in compact undo records.
+ *
+ * Unlike TxInUndoFormatter, there is no dummy version byte, and a prevout
+ * paying to the same script as one of the few prevouts before it refers back
+ * to that one instead of storing the script again, as happens when a
+ * transaction spends several outputs of the same address.
+ */
+struct CompactTxUndoFormatter
+{
+    //! How many earlier prevouts are looked at for a script to refer back to
+    static constexpr size_t MAX_SCRIPT_BACK_REFERENCE{16};
+
+    template<typename Stream>
+    void Ser(Stream& s, const CTxUndo& txundo)
+    {
+        const std::vector<Coin>& prevouts{txundo.vprevout};
+        WriteCompactSize(s, prevouts.size());
+        for (size_t i = 0; i < prevouts.size(); ++i) {
+            const Coin& coin{prevouts[i]};
+            std::optional<uint64_t> back;
+            for (size_t j = i; j > 0 && i - j < MAX_SCRIPT_BACK_REFERENCE; --j) {
+                if (prevouts[j - 1].out.scriptPubKey == coin.out.scriptPubKey) {
+                    back = i - j;
+                    break;
+                }
+            }
+            ::Serialize(s, VARINT(uint64_t{coin.nHeight} * 4 + coin.fCoinBase * 2 + back.has_value()));
+            ::Serialize(s, Using<AmountCompression>(coin.out.nValue));
+            if (back) {
+                ::Serialize(s, VARINT(*back));
+            } else {
+                ::Serialize(s, Using<ScriptCompression>(coin.out.scriptPubKey));
+            }
+        }
+    }
+
+    template<typename Stream>
+    void Unser(Stream& s, CTxUndo& txundo)
+    {
+        std::vector<Coin>& prevouts{txundo.vprevout};
+        prevouts.clear();
+        const uint64_t count{ReadCompactSize(s)};
+        for (uint64_t i = 0; i < count; ++i) {
+            uint64_t code{0};
+            ::Unserialize(s, VARINT(code));
+            if ((code >> 2) > std::numeric_limits<uint32_t>::max() >> 1) {
+                throw std::ios_base::failure("Undo prevout height out of range");
+            }
+            Coin& coin{prevouts.emplace_back()};
+            coin.nHeight = code >> 2;
+            coin.fCoinBase = (code >> 1) & 1;
+            ::Unserialize(s, Using<AmountCompression>(coin.out.nValue));
+            if (code & 1) {
+                uint64_t back{0};
+                ::Unserialize(s, VARINT(back));
+                if (back >= i || back >= MAX_SCRIPT_BACK_REFERENCE) {
+                    throw std::ios_base::failure("Undo script back reference out of range");
+                }
+                coin.out.scriptPubKey = prevouts[i - 1 - back].out.scriptPubKey;
+            } else {
+                ::Unserialize(s, Using<ScriptCompression>(coin.out.scriptPubKey));
+            }
+        }
+    }
+};
+
 /** Undo information for a CBlock */
 class CBlockUndo
 {
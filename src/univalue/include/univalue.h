@@ -10,9 +10,11 @@
 #include <cstdint>
 #include <cstring>
 #include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 class UniValue {
@@ -44,6 +46,10 @@ public:
             setStr(std::string{std::forward<Ref>(val)});
         }
     }
+    UniValue(const UniValue& other);
+    UniValue(UniValue&& other) noexcept = default;
+    UniValue& operator=(const UniValue& other);
+    UniValue& operator=(UniValue&& other) noexcept = default;
 
     void clear();
 
@@ -99,13 +105,20 @@ public:
     }
 
 private:
+    //! Objects with at least this many keys also index them, so that lookups need not scan them
+    static constexpr size_t KEY_INDEX_MIN_SIZE{32};
+
     UniValue::VType typ;
     std::string val;                       // numbers are stored as C++ strings
     std::vector<std::string> keys;
     std::vector<UniValue> values;
+    //! Position of the first occurrence of each key, for large objects only
+    std::unique_ptr<std::unordered_map<std::string, size_t>> keyIndex;
 
     void checkType(const VType& expected) const;
+    void appendKey(std::string key);
     bool findKey(const std::string& key, size_t& retIdx) const;
+    void writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeArray(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
     void writeObject(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const;
 
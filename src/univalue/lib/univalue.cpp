@@ -5,6 +5,7 @@
 
 #include <univalue.h>
 
+#include <charconv>
 #include <iomanip>
 #include <map>
 #include <memory>
@@ -15,12 +16,28 @@
 
 const UniValue NullUniValue;
 
+UniValue::UniValue(const UniValue& other)
+    : typ{other.typ}, val{other.val}, keys{other.keys}, values{other.values},
+      keyIndex{other.keyIndex ? std::make_unique<std::unordered_map<std::string, size_t>>(*other.keyIndex) : nullptr}
+{
+}
+
+UniValue& UniValue::operator=(const UniValue& other)
+{
+    if (this != &other) {
+        UniValue copy{other};
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
 void UniValue::clear()
 {
     typ = VNULL;
     val.clear();
     keys.clear();
     values.clear();
+    keyIndex.reset();
 }
 
 void UniValue::setNull()
@@ -55,22 +72,27 @@ void UniValue::setNumStr(const std::string& val_)
     val = val_;
 }
 
-void UniValue::setInt(uint64_t val_)
+/** Format an integer, which is always a valid JSON number, without going through a stream */
+template <typename Int>
+static std::string FormatInt(Int val)
 {
-    std::ostringstream oss;
-
-    oss << val_;
+    char buf[24];
+    const auto [end, ec] = std::to_chars(buf, buf + sizeof(buf), val);
+    return std::string(buf, end);
+}
 
-    return setNumStr(oss.str());
+void UniValue::setInt(uint64_t val_)
+{
+    clear();
+    typ = VNUM;
+    val = FormatInt(val_);
 }
 
 void UniValue::setInt(int64_t val_)
 {
-    std::ostringstream oss;
-
-    oss << val_;
-
-    return setNumStr(oss.str());
+    clear();
+    typ = VNUM;
+    val = FormatInt(val_);
 }
 
 void UniValue::setFloat(double val_)
@@ -119,7 +141,7 @@ void UniValue::__pushKV(std::string key, UniValue val)
 {
     checkType(VOBJ);
 
-    keys.push_back(std::move(key));
+    appendKey(std::move(key));
     values.push_back(std::move(val));
 }
 
@@ -153,8 +175,27 @@ void UniValue::getObjMap(std::map<std::string,UniValue>& kv) const
         kv[keys[i]] = values[i];
 }
 
+void UniValue::appendKey(std::string key)
+{
+    keys.push_back(std::move(key));
+    if (keyIndex) {
+        keyIndex->emplace(keys.back(), keys.size() - 1);
+    } else if (keys.size() >= KEY_INDEX_MIN_SIZE) {
+        keyIndex = std::make_unique<std::unordered_map<std::string, size_t>>();
+        keyIndex->reserve(keys.size() * 2);
+        for (size_t i = 0; i < keys.size(); i++)
+            keyIndex->emplace(keys[i], i);
+    }
+}
+
 bool UniValue::findKey(const std::string& key, size_t& retIdx) const
 {
+    if (keyIndex) {
+        const auto it = keyIndex->find(key);
+        if (it == keyIndex->end()) return false;
+        retIdx = it->second;
+        return true;
+    }
     for (size_t i = 0; i < keys.size(); i++) {
         if (keys[i] == key) {
             retIdx = i;
@@ -232,9 +273,9 @@ const char *uvTypeName(UniValue::VType t)
 
 const UniValue& find_value(const UniValue& obj, const std::string& name)
 {
-    for (unsigned int i = 0; i < obj.keys.size(); i++)
-        if (obj.keys[i] == name)
-            return obj.values.at(i);
+    size_t idx;
+    if (obj.findKey(name, idx))
+        return obj.values.at(idx);
 
     return NullUniValue;
 }
@@ -9,11 +9,8 @@
 #include <string>
 #include <vector>
 
-static std::string json_escape(const std::string& inS)
+static void json_escape(const std::string& inS, std::string& outS)
 {
-    std::string outS;
-    outS.reserve(inS.size() * 2);
-
     for (unsigned int i = 0; i < inS.size(); i++) {
         unsigned char ch = static_cast<unsigned char>(inS[i]);
         const char *escStr = escapes[ch];
@@ -23,8 +20,6 @@ static std::string json_escape(const std::string& inS)
         else
             outS += static_cast<char>(ch);
     }
-
-    return outS;
 }
 
 std::string UniValue::write(unsigned int prettyIndent,
@@ -37,18 +32,27 @@ std::string UniValue::write(unsigned int prettyIndent,
     if (modIndent == 0)
         modIndent = 1;
 
+    writeValue(prettyIndent, modIndent, s);
+
+    return s;
+}
+
+void UniValue::writeValue(unsigned int prettyIndent, unsigned int indentLevel, std::string& s) const
+{
     switch (typ) {
     case VNULL:
         s += "null";
         break;
     case VOBJ:
-        writeObject(prettyIndent, modIndent, s);
+        writeObject(prettyIndent, indentLevel, s);
         break;
     case VARR:
-        writeArray(prettyIndent, modIndent, s);
+        writeArray(prettyIndent, indentLevel, s);
         break;
     case VSTR:
-        s += "\"" + json_escape(val) + "\"";
+        s += '"';
+        json_escape(val, s);
+        s += '"';
         break;
     case VNUM:
         s += val;
@@ -57,8 +61,6 @@ std::string UniValue::write(unsigned int prettyIndent,
         s += (val == "1" ? "true" : "false");
         break;
     }
-
-    return s;
 }
 
 static void indentStr(unsigned int prettyIndent, unsigned int indentLevel, std::string& s)
@@ -75,7 +77,7 @@ void UniValue::writeArray(unsigned int prettyIndent, unsigned int indentLevel, s
     for (unsigned int i = 0; i < values.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += values[i].write(prettyIndent, indentLevel + 1);
+        values[i].writeValue(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1)) {
             s += ",";
         }
@@ -97,10 +99,12 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
     for (unsigned int i = 0; i < keys.size(); i++) {
         if (prettyIndent)
             indentStr(prettyIndent, indentLevel, s);
-        s += "\"" + json_escape(keys[i]) + "\":";
+        s += '"';
+        json_escape(keys[i], s);
+        s += "\":";
         if (prettyIndent)
             s += " ";
-        s += values.at(i).write(prettyIndent, indentLevel + 1);
+        values.at(i).writeValue(prettyIndent, indentLevel + 1, s);
         if (i != (values.size() - 1))
             s += ",";
         if (prettyIndent)
@@ -111,4 +115,3 @@ void UniValue::writeObject(unsigned int prettyIndent, unsigned int indentLevel,
         indentStr(prettyIndent, indentLevel - 1, s);
     s += "}";
 }
-
@@ -7,6 +7,7 @@
 
 #include <cassert>
 #include <cstdint>
+#include <limits>
 #include <map>
 #include <memory>
 #include <stdexcept>
@@ -176,6 +177,12 @@ void univalue_set()
     BOOST_CHECK(v.isNum());
     BOOST_CHECK_EQUAL(v.getValStr(), "1023");
 
+    v.setInt(std::numeric_limits<int64_t>::min());
+    BOOST_CHECK_EQUAL(v.getValStr(), "-9223372036854775808");
+
+    v.setInt(std::numeric_limits<uint64_t>::max());
+    BOOST_CHECK_EQUAL(v.getValStr(), "18446744073709551615");
+
     v.setNumStr("-688");
     BOOST_CHECK(v.isNum());
     BOOST_CHECK_EQUAL(v.getValStr(), "-688");
@@ -373,6 +380,47 @@ void univalue_object()
 
 }
 
+void univalue_large_object()
+{
+    // Large objects find their keys through an index, which must agree with the keys
+    UniValue obj(UniValue::VOBJ);
+    for (int i = 0; i < 100; i++) {
+        obj.pushKV("key" + std::to_string(i), i);
+    }
+    BOOST_CHECK_EQUAL(obj.size(), 100);
+    for (int i = 0; i < 100; i++) {
+        BOOST_CHECK_EQUAL(find_value(obj, "key" + std::to_string(i)).getInt<int>(), i);
+    }
+    BOOST_CHECK(find_value(obj, "key100").isNull());
+    BOOST_CHECK(!obj.exists("missing"));
+
+    // Replacing a value keeps the position of its key
+    obj.pushKV("key50", "fifty");
+    BOOST_CHECK_EQUAL(obj.size(), 100);
+    BOOST_CHECK_EQUAL(obj.getKeys()[50], "key50");
+    BOOST_CHECK_EQUAL(obj["key50"].get_str(), "fifty");
+
+    // Copies are independent
+    UniValue copy{obj};
+    copy.pushKV("key100", 100);
+    BOOST_CHECK_EQUAL(copy["key100"].getInt<int>(), 100);
+    BOOST_CHECK(!obj.exists("key100"));
+    UniValue assigned;
+    assigned = copy;
+    BOOST_CHECK_EQUAL(assigned["key99"].getInt<int>(), 99);
+    BOOST_CHECK_EQUAL(assigned.write(), copy.write());
+
+    // The first of duplicate keys is found, also when parsing
+    UniValue parsed;
+    BOOST_CHECK(parsed.read(obj.write().substr(0, obj.write().size() - 1) + ",\"key0\":\"dup\"}"));
+    BOOST_CHECK_EQUAL(parsed.size(), 101);
+    BOOST_CHECK_EQUAL(parsed["key0"].getInt<int>(), 0);
+    BOOST_CHECK_EQUAL(parsed["key99"].getInt<int>(), 99);
+
+    parsed.setObject();
+    BOOST_CHECK(!parsed.exists("key0"));
+}
+
 static const char *json1 =
 "[1.10000000,{\"key1\":\"str\\u0000\",\"key2\":800,\"key3\":{\"name\":\"martian http://test.com\"}}]";
 
@@ -427,6 +475,7 @@ int main(int argc, char* argv[])
     univalue_set();
     univalue_array();
     univalue_object();
+    univalue_large_object();
     univalue_readwrite();
     return 0;
 }
@@ -194,6 +194,70 @@ bool SanityCheckASMap(const std::vector<bool>& asmap, int bits)
     return false; // Reached EOF without RETURN instruction
 }
 
+CompiledAsmap::CompiledAsmap(const std::vector<bool>& asmap)
+{
+    // A sane asmap is a sequence of instructions, in which every jump lands on the start of
+    // one, followed by at most 7 bits of padding. No instruction fits in 7 bits.
+    std::vector<uint32_t> offsets;
+    std::vector<bool>::const_iterator pos = asmap.begin();
+    const std::vector<bool>::const_iterator endpos = asmap.end();
+    while (endpos - pos > 7) {
+        offsets.push_back(pos - asmap.begin());
+        const Instruction opcode = DecodeType(pos, endpos);
+        DecodedInstruction& decoded{m_instructions.emplace_back(DecodedInstruction{static_cast<uint8_t>(opcode), 0, 0})};
+        if (opcode == Instruction::RETURN || opcode == Instruction::DEFAULT) {
+            decoded.value = DecodeASN(pos, endpos);
+        } else if (opcode == Instruction::JUMP) {
+            // Store the target offset until all instructions are known
+            decoded.value = DecodeJump(pos, endpos) + (pos - asmap.begin());
+        } else {
+            assert(opcode == Instruction::MATCH);
+            decoded.value = DecodeMatch(pos, endpos);
+            decoded.matchlen = CountBits(decoded.value) - 1;
+        }
+    }
+    for (DecodedInstruction& decoded : m_instructions) {
+        if (decoded.opcode != static_cast<uint8_t>(Instruction::JUMP)) continue;
+        const auto target{std::lower_bound(offsets.begin(), offsets.end(), decoded.value)};
+        assert(target != offsets.end() && *target == decoded.value);
+        decoded.value = target - offsets.begin();
+    }
+}
+
+uint32_t CompiledAsmap::Interpret(const std::vector<bool>& ip) const
+{
+    size_t bits = ip.size();
+    uint32_t default_asn = 0;
+    size_t index = 0;
+    while (index < m_instructions.size()) {
+        const DecodedInstruction& decoded{m_instructions[index]};
+        switch (Instruction{decoded.opcode}) {
+        case Instruction::RETURN:
+            return decoded.value;
+        case Instruction::JUMP:
+            assert(bits > 0); // No input bits left
+            index = ip[ip.size() - bits] ? decoded.value : index + 1;
+            bits--;
+            continue;
+        case Instruction::MATCH:
+            assert(bits >= decoded.matchlen); // Not enough input bits
+            for (uint32_t bit = 0; bit < decoded.matchlen; bit++) {
+                if ((ip[ip.size() - bits]) != ((decoded.value >> (decoded.matchlen - 1 - bit)) & 1)) {
+                    return default_asn;
+                }
+                bits--;
+            }
+            break;
+        case Instruction::DEFAULT:
+            default_asn = decoded.value;
+            break;
+        } // no default case, so the compiler can warn about missing cases
+        index++;
+    }
+    assert(false); // Reached the end without RETURN - should have been caught by SanityCheckASMap
+    return 0; // 0 is not a valid ASN
+}
+
 std::vector<bool> DecodeAsmap(fs::path path)
 {
     std::vector<bool> bits;
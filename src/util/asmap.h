@@ -14,6 +14,31 @@ uint32_t Interpret(const std::vector<bool> &asmap, const std::vector<bool> &ip);
 
 bool SanityCheckASMap(const std::vector<bool>& asmap, int bits);
 
+/**
+ * An asmap decoded once into a table of instructions, with jumps resolved to table
+ * indexes, so that lookups do not decode the bit-packed program again.
+ */
+class CompiledAsmap
+{
+public:
+    /** Compile asmap, which must be empty or pass SanityCheckASMap(). */
+    explicit CompiledAsmap(const std::vector<bool>& asmap);
+
+    /** Same as Interpret() on the asmap this was compiled from. */
+    uint32_t Interpret(const std::vector<bool>& ip) const;
+
+    bool empty() const { return m_instructions.empty(); }
+
+private:
+    struct DecodedInstruction {
+        uint8_t opcode;
+        uint32_t value;  //!< ASN of RETURN and DEFAULT, bits to match of MATCH, target index of JUMP
+        uint8_t matchlen; //!< number of bits of MATCH
+    };
+
+    std::vector<DecodedInstruction> m_instructions;
+};
+
 /** Read asmap from provided binary file */
 std::vector<bool> DecodeAsmap(fs::path path);
 
@@ -5,11 +5,15 @@
 #ifndef BITCOIN_UTIL_GOLOMBRICE_H
 #define BITCOIN_UTIL_GOLOMBRICE_H
 
+#include <crypto/common.h>
+#include <span.h>
 #include <util/fastrange.h>
 
 #include <streams.h>
 
 #include <cstdint>
+#include <ios>
+#include <vector>
 
 template <typename OStream>
 void GolombRiceEncode(BitStreamWriter<OStream>& bitwriter, uint8_t P, uint64_t x)
@@ -42,4 +46,142 @@ uint64_t GolombRiceDecode(BitStreamReader<IStream>& bitreader, uint8_t P)
     return (q << P) + r;
 }
 
+/**
+ * Golomb-Rice encoder producing the same bits as GolombRiceEncode with a
+ * BitStreamWriter, but buffering them in a 64-bit word so that a whole code
+ * is usually written with one shift and one or two byte stores.
+ */
+class GolombRiceWriter
+{
+private:
+    std::vector<unsigned char>& m_out;
+
+    /// Pending bits, aligned to the most significant bit. Fewer than 8 are
+    /// left after each Write, so up to 56 more always fit.
+    uint64_t m_buffer{0};
+    int m_bits{0};
+
+    /// Append the nbits (at most 56) least significant bits of data.
+    void Write(uint64_t data, int nbits)
+    {
+        if (nbits == 0) return;
+        m_buffer |= (data << (64 - nbits)) >> m_bits;
+        m_bits += nbits;
+        while (m_bits >= 8) {
+            m_out.push_back(static_cast<unsigned char>(m_buffer >> 56));
+            m_buffer <<= 8;
+            m_bits -= 8;
+        }
+    }
+
+public:
+    explicit GolombRiceWriter(std::vector<unsigned char>& out) : m_out(out) {}
+
+    ~GolombRiceWriter()
+    {
+        Flush();
+    }
+
+    void Encode(uint8_t P, uint64_t x)
+    {
+        // Write quotient as unary-encoded: q 1's followed by one 0, then the
+        // remainder in P bits. Most codes fit in a single write.
+        uint64_t q = x >> P;
+        while (q > 55) {
+            Write(~0ULL, 55);
+            q -= 55;
+        }
+        const uint64_t unary{((1ULL << q) - 1) << 1};
+        if (q + 1 + P <= 56) {
+            Write((unary << P) | (P ? x & (~0ULL >> (64 - P)) : 0), q + 1 + P);
+        } else {
+            Write(unary, q + 1);
+            for (int remaining = P; remaining > 0;) {
+                const int nbits{std::min(remaining, 56)};
+                remaining -= nbits;
+                Write(x >> remaining, nbits);
+            }
+        }
+    }
+
+    /** Write the pending bits, padding with 0's to the next byte boundary. */
+    void Flush()
+    {
+        if (m_bits == 0) return;
+        m_out.push_back(static_cast<unsigned char>(m_buffer >> 56));
+        m_buffer = 0;
+        m_bits = 0;
+    }
+};
+
+/**
+ * Golomb-Rice decoder reading the codes of GolombRiceDecode with a
+ * BitStreamReader, loading up to 8 bytes at a time and counting the unary
+ * quotient a word at a time.
+ */
+class GolombRiceReader
+{
+private:
+    Span<const unsigned char> m_data;
+
+    /// Loaded bits, aligned to the most significant bit
+    uint64_t m_buffer{0};
+    int m_bits{0};
+
+    void Refill()
+    {
+        while (m_bits <= 56 && !m_data.empty()) {
+            m_buffer |= uint64_t{m_data[0]} << (56 - m_bits);
+            m_data = m_data.subspan(1);
+            m_bits += 8;
+        }
+    }
+
+    void Consume(int nbits)
+    {
+        m_buffer = nbits == 64 ? 0 : m_buffer << nbits;
+        m_bits -= nbits;
+    }
+
+public:
+    explicit GolombRiceReader(Span<const unsigned char> data) : m_data(data) {}
+
+    /** Decode the next value. Throws std::ios_base::failure at the end of the data. */
+    uint64_t Decode(uint8_t P)
+    {
+        // Read unary-encoded quotient: q 1's followed by one 0.
+        uint64_t q = 0;
+        while (true) {
+            Refill();
+            if (m_bits == 0) throw std::ios_base::failure("GolombRiceReader::Decode(): end of data");
+            const int ones{64 - static_cast<int>(CountBits(~m_buffer))};
+            if (ones < m_bits) {
+                q += ones;
+                Consume(ones + 1);
+                break;
+            }
+            q += m_bits;
+            Consume(m_bits);
+        }
+
+        uint64_t r = 0;
+        for (int remaining = P; remaining > 0;) {
+            Refill();
+            const int nbits{std::min(remaining, 56)};
+            if (m_bits < nbits) throw std::ios_base::failure("GolombRiceReader::Decode(): end of data");
+            r = (r << nbits) | (m_buffer >> (64 - nbits));
+            Consume(nbits);
+            remaining -= nbits;
+        }
+
+        return (q << P) + r;
+    }
+
+    /** Whether all bytes were at least partly read. */
+    bool empty() const
+    {
+        return m_data.empty() && m_bits < 8;
+    }
+};
+
 #endif // BITCOIN_UTIL_GOLOMBRICE_H
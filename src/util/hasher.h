@@ -5,6 +5,10 @@
 #ifndef BITCOIN_UTIL_HASHER_H
 #define BITCOIN_UTIL_HASHER_H
 
+#if defined(HAVE_CONFIG_H)
+#include <config/bitcoin-config.h>
+#endif
+
 #include <crypto/common.h>
 #include <crypto/siphash.h>
 #include <primitives/transaction.h>
@@ -15,6 +19,31 @@
 
 template <typename C> class Span;
 
+/**
+ * SaltedTxidHasher and SaltedOutpointHasher key the maps that validation looks
+ * up most, like CCoinsMap and the mempool and orphanage indexes. Unless built
+ * with --disable-fast-hashers they use SipHash-1-3, which still takes the
+ * random salt as a 128-bit key against hash flooding but costs about half the
+ * rounds of SipHash-2-4.
+ */
+inline uint64_t SaltedHashUint256(uint64_t k0, uint64_t k1, const uint256& val)
+{
+#ifdef USE_FAST_HASHERS
+    return SipHash13Uint256(k0, k1, val);
+#else
+    return SipHashUint256(k0, k1, val);
+#endif
+}
+
+inline uint64_t SaltedHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint32_t extra)
+{
+#ifdef USE_FAST_HASHERS
+    return SipHash13Uint256Extra(k0, k1, val, extra);
+#else
+    return SipHashUint256Extra(k0, k1, val, extra);
+#endif
+}
+
 class SaltedTxidHasher
 {
 private:
@@ -25,7 +54,7 @@ public:
     SaltedTxidHasher();
 
     size_t operator()(const uint256& txid) const {
-        return SipHashUint256(k0, k1, txid);
+        return SaltedHashUint256(k0, k1, txid);
     }
 };
 
@@ -48,7 +77,7 @@ public:
      * @see https://gcc.gnu.org/onlinedocs/gcc-9.2.0/libstdc++/manual/manual/unordered_associative.html
      */
     size_t operator()(const COutPoint& id) const noexcept {
-        return SipHashUint256Extra(k0, k1, id.hash, id.n);
+        return SaltedHashUint256Extra(k0, k1, id.hash, id.n);
     }
 };
 
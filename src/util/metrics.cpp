@@ -0,0 +1,32 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <util/metrics.h>
+
+#include <algorithm>
+
+void MetricHistogram::Observe(std::chrono::microseconds duration)
+{
+    const auto bucket{std::lower_bound(BUCKET_BOUNDS.begin(), BUCKET_BOUNDS.end(), duration.count()) - BUCKET_BOUNDS.begin()};
+    m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(duration.count(), std::memory_order_relaxed);
+}
+
+MetricHistogram::Snapshot MetricHistogram::Get() const
+{
+    Snapshot snapshot;
+    for (size_t i = 0; i < m_buckets.size(); ++i) {
+        snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+        snapshot.count += snapshot.buckets[i];
+    }
+    snapshot.sum = std::chrono::microseconds{m_sum.load(std::memory_order_relaxed)};
+    return snapshot;
+}
+
+NodeMetrics& Metrics()
+{
+    // Leaked like the logger, so that it outlives the threads updating it
+    static NodeMetrics* g_metrics{new NodeMetrics()};
+    return *g_metrics;
+}
@@ -0,0 +1,73 @@
+// Copyright (c) 2022 The Bitcoin Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BITCOIN_UTIL_METRICS_H
+#define BITCOIN_UTIL_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+/** A monotonically increasing count, updated and read without locking. */
+class MetricCounter
+{
+    std::atomic<uint64_t> m_value{0};
+
+public:
+    void Add(uint64_t value = 1) { m_value.fetch_add(value, std::memory_order_relaxed); }
+    uint64_t Value() const { return m_value.load(std::memory_order_relaxed); }
+};
+
+/**
+ * A distribution of durations over fixed buckets, updated and read without
+ * locking. A snapshot taken while the histogram is updated may be off by the
+ * observations in flight, which is acceptable for monitoring.
+ */
+class MetricHistogram
+{
+public:
+    //! Upper bounds of the buckets in microseconds, followed by an unbounded one
+    static constexpr std::array<int64_t, 12> BUCKET_BOUNDS{100, 250, 500, 1'000, 2'500, 5'000, 10'000, 25'000, 100'000, 250'000, 1'000'000, 10'000'000};
+
+    struct Snapshot {
+        //! Observations per bucket, not cumulative, the last one unbounded
+        std::array<uint64_t, BUCKET_BOUNDS.size() + 1> buckets{};
+        uint64_t count{0};
+        std::chrono::microseconds sum{0};
+    };
+
+    void Observe(std::chrono::microseconds duration);
+    Snapshot Get() const;
+
+private:
+    std::array<std::atomic<uint64_t>, BUCKET_BOUNDS.size() + 1> m_buckets{};
+    std::atomic<int64_t> m_sum{0};
+};
+
+/** Counters of node internals exported for monitoring, see -metrics. */
+struct NodeMetrics {
+    //! Phases of connecting a block to the tip, as timed for -debug=bench
+    MetricHistogram block_load;
+    MetricHistogram block_sanity;
+    MetricHistogram block_connect_txs;
+    MetricHistogram block_verify;
+    MetricHistogram block_index;
+    MetricHistogram block_connect;
+    MetricHistogram block_flush;
+    MetricHistogram block_chainstate;
+    MetricHistogram block_postprocess;
+    MetricHistogram block_total;
+    //! Time AcceptToMemoryPool takes for a transaction
+    MetricHistogram mempool_accept;
+    //! Time writing the coins cache to the database takes
+    MetricHistogram coins_db_flush;
+    //! Checks run by the check queue threads, and the time they spent running them
+    MetricCounter checkqueue_checks;
+    MetricCounter checkqueue_busy_micros;
+};
+
+NodeMetrics& Metrics();
+
+#endif // BITCOIN_UTIL_METRICS_H
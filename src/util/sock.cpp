@@ -11,9 +11,13 @@
 #include <util/system.h>
 #include <util/time.h>
 
+#include <algorithm>
+#include <array>
 #include <memory>
+#include <optional>
 #include <stdexcept>
 #include <string>
+#include <vector>
 
 #ifdef WIN32
 #include <codecvt>
@@ -24,6 +28,18 @@
 #include <poll.h>
 #endif
 
+#ifndef WIN32
+#include <sys/uio.h>
+#endif
+
+#if defined(__linux__)
+#define USE_EPOLL
+#include <sys/epoll.h>
+#elif defined(__APPLE__) || defined(__FreeBSD__) || defined(__NetBSD__) || defined(__OpenBSD__) || defined(__DragonFly__)
+#define USE_KQUEUE
+#include <sys/event.h>
+#endif
+
 static inline bool IOErrorIsPermanent(int err)
 {
     return err != WSAEAGAIN && err != WSAEINTR && err != WSAEWOULDBLOCK && err != WSAEINPROGRESS;
@@ -56,6 +72,25 @@ ssize_t Sock::Send(const void* data, size_t len, int flags) const
     return send(m_socket, static_cast<const char*>(data), len, flags);
 }
 
+ssize_t Sock::SendMany(Span<const Span<const unsigned char>> buffers, int flags) const
+{
+    if (buffers.empty()) return 0;
+#ifdef WIN32
+    return Send(buffers[0].data(), buffers[0].size(), flags);
+#else
+    std::array<iovec, MAX_SEND_BUFFERS> iov;
+    const size_t count{std::min(buffers.size(), iov.size())};
+    for (size_t i = 0; i < count; ++i) {
+        iov[i].iov_base = const_cast<unsigned char*>(buffers[i].data());
+        iov[i].iov_len = buffers[i].size();
+    }
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = count;
+    return sendmsg(m_socket, &msg, flags);
+#endif
+}
+
 ssize_t Sock::Recv(void* buf, size_t len, int flags) const
 {
     return recv(m_socket, static_cast<char*>(buf), len, flags);
@@ -388,6 +423,130 @@ void Sock::Close()
     m_socket = INVALID_SOCKET;
 }
 
+/** Most events to take from the kernel in one wait */
+static constexpr size_t MAX_POLLER_EVENTS{1024};
+
+std::unique_ptr<SockPoller> SockPoller::Make()
+{
+#if defined(USE_EPOLL)
+    const int fd{epoll_create1(EPOLL_CLOEXEC)};
+#elif defined(USE_KQUEUE)
+    const int fd{kqueue()};
+#else
+    const int fd{-1};
+#endif
+    if (fd < 0) return nullptr;
+    return std::unique_ptr<SockPoller>{new SockPoller{fd}};
+}
+
+SockPoller::~SockPoller()
+{
+#if defined(USE_EPOLL) || defined(USE_KQUEUE)
+    close(m_fd);
+#endif
+}
+
+bool SockPoller::Control(SOCKET s, std::optional<Sock::Event> old_requested, std::optional<Sock::Event> requested)
+{
+#if defined(USE_EPOLL)
+    if (!requested) return epoll_ctl(m_fd, EPOLL_CTL_DEL, s, nullptr) == 0;
+    // Errors and hang-ups are always reported, also when nothing is requested
+    epoll_event event{};
+    event.data.fd = s;
+    if (*requested & Sock::RECV) event.events |= EPOLLIN;
+    if (*requested & Sock::SEND) event.events |= EPOLLOUT;
+    return epoll_ctl(m_fd, old_requested ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, s, &event) == 0;
+#elif defined(USE_KQUEUE)
+    // kqueue has a filter per event rather than a registration per socket
+    const Sock::Event old_events{old_requested.value_or(0)};
+    const Sock::Event new_events{requested.value_or(0)};
+    struct kevent changes[2];
+    int count{0};
+    if ((old_events ^ new_events) & Sock::RECV) {
+        EV_SET(&changes[count++], s, EVFILT_READ, (new_events & Sock::RECV) ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+    }
+    if ((old_events ^ new_events) & Sock::SEND) {
+        EV_SET(&changes[count++], s, EVFILT_WRITE, (new_events & Sock::SEND) ? EV_ADD : EV_DELETE, 0, 0, nullptr);
+    }
+    return count == 0 || kevent(m_fd, changes, count, nullptr, 0, nullptr) == 0;
+#else
+    return false;
+#endif
+}
+
+bool SockPoller::Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested)
+{
+    requested &= Sock::RECV | Sock::SEND;
+
+    const auto it{m_entries.find(sock->Get())};
+    if (it == m_entries.end()) {
+        if (!Control(sock->Get(), std::nullopt, requested)) return false;
+        m_entries.emplace(sock->Get(), Entry{sock, requested, /*set=*/true});
+        return true;
+    }
+    Entry& entry{it->second};
+    entry.set = true;
+    if (entry.requested == requested) return true;
+    if (!Control(sock->Get(), entry.requested, requested)) return false;
+    entry.requested = requested;
+    return true;
+}
+
+void SockPoller::RemoveUnset()
+{
+    for (auto it = m_entries.begin(); it != m_entries.end();) {
+        if (it->second.set) {
+            it->second.set = false;
+            ++it;
+            continue;
+        }
+        // Unregister before the socket may be closed by releasing it
+        if (!Control(it->first, it->second.requested, std::nullopt)) {
+            LogPrint(BCLog::NET, "Failed to stop polling socket %d: %s\n", it->first, NetworkErrorString(WSAGetLastError()));
+        }
+        it = m_entries.erase(it);
+    }
+}
+
+bool SockPoller::Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& events_per_sock)
+{
+    events_per_sock.clear();
+#if defined(USE_EPOLL)
+    std::vector<epoll_event> events(std::clamp<size_t>(m_entries.size(), 1, MAX_POLLER_EVENTS));
+    const int count{epoll_wait(m_fd, events.data(), int(events.size()), int(count_milliseconds(timeout)))};
+    if (count < 0) return false;
+    for (int i = 0; i < count; ++i) {
+        const auto it{m_entries.find(events[i].data.fd)};
+        if (it == m_entries.end()) continue;
+        Sock::Event occurred{0};
+        if (events[i].events & EPOLLIN) occurred |= Sock::RECV;
+        if (events[i].events & EPOLLOUT) occurred |= Sock::SEND;
+        if (events[i].events & (EPOLLERR | EPOLLHUP)) occurred |= Sock::ERR;
+        events_per_sock.emplace(it->second.sock, Sock::Events{it->second.requested}).first->second.occurred |= occurred;
+    }
+    return true;
+#elif defined(USE_KQUEUE)
+    std::vector<struct kevent> events(std::clamp<size_t>(m_entries.size() * 2, 1, MAX_POLLER_EVENTS));
+    const auto seconds{std::chrono::duration_cast<std::chrono::seconds>(timeout)};
+    const timespec ts{time_t(seconds.count()), long((timeout - seconds).count()) * 1'000'000};
+    const int count{kevent(m_fd, nullptr, 0, events.data(), int(events.size()), &ts)};
+    if (count < 0) return false;
+    for (int i = 0; i < count; ++i) {
+        const auto it{m_entries.find(SOCKET(events[i].ident))};
+        if (it == m_entries.end()) continue;
+        Sock::Event occurred{0};
+        if (events[i].filter == EVFILT_READ) occurred |= Sock::RECV;
+        if (events[i].filter == EVFILT_WRITE) occurred |= Sock::SEND;
+        if (events[i].flags & (EV_EOF | EV_ERROR)) occurred |= Sock::ERR;
+        // A socket can occur once per filter
+        events_per_sock.emplace(it->second.sock, Sock::Events{it->second.requested}).first->second.occurred |= occurred;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
 #ifdef WIN32
 std::string NetworkErrorString(int err)
 {
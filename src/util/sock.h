@@ -6,11 +6,13 @@
 #define BITCOIN_UTIL_SOCK_H
 
 #include <compat/compat.h>
+#include <span.h>
 #include <threadinterrupt.h>
 #include <util/time.h>
 
 #include <chrono>
 #include <memory>
+#include <optional>
 #include <string>
 #include <unordered_map>
 
@@ -74,6 +76,18 @@ public:
      */
     [[nodiscard]] virtual ssize_t Send(const void* data, size_t len, int flags) const;
 
+    /** Maximum number of buffers passed to one `SendMany()` call. */
+    static constexpr size_t MAX_SEND_BUFFERS{64};
+
+    /**
+     * sendmsg(2) wrapper sending several buffers in one call, the way `writev(2)` does. At most
+     * `MAX_SEND_BUFFERS` buffers are sent; the rest is ignored. Where scatter-gather is not
+     * available only the first buffer is sent. Code that uses this wrapper can be unit tested if
+     * this method is overridden by a mock Sock implementation.
+     * @return the number of bytes sent across all buffers, or -1 on error
+     */
+    [[nodiscard]] virtual ssize_t SendMany(Span<const Span<const unsigned char>> buffers, int flags) const;
+
     /**
      * recv(2) wrapper. Equivalent to `recv(this->Get(), buf, len, flags);`. Code that uses this
      * wrapper can be unit tested if this method is overridden by a mock Sock implementation.
@@ -267,6 +281,64 @@ private:
     void Close();
 };
 
+/**
+ * A persistent set of sockets to wait for events on, backed by epoll(7) on
+ * Linux and kqueue(2) on the BSDs and macOS. Unlike `Sock::WaitMany()`, which
+ * hands every socket to the kernel on every call, sockets are registered
+ * once and only changes to the requested events are passed on, so a wait
+ * costs in proportion to the sockets that are ready. Readiness is level
+ * triggered, as for `Sock::WaitMany()`.
+ */
+class SockPoller
+{
+public:
+    /** Create a poller, or return nullptr if the platform has none or it cannot be created. */
+    static std::unique_ptr<SockPoller> Make();
+
+    ~SockPoller();
+
+    SockPoller(const SockPoller&) = delete;
+    SockPoller& operator=(const SockPoller&) = delete;
+
+    /**
+     * Wait for the requested events on a socket from now on, replacing any
+     * earlier request for it. The poller shares ownership of the socket
+     * until it is no longer waited on, so its descriptor isn't reused.
+     * @return false if the socket could not be registered
+     */
+    [[nodiscard]] bool Set(const std::shared_ptr<const Sock>& sock, Sock::Event requested);
+
+    /** Stop waiting on the sockets that were not passed to `Set()` since the last call. */
+    void RemoveUnset();
+
+    /**
+     * Wait for at least one of the requested events to occur.
+     * @param[in] timeout Wait this long for an event.
+     * @param[out] events_per_sock Cleared, then set to the sockets on which events occurred.
+     * @return true on success (or timeout, if no sockets are returned), false otherwise
+     */
+    [[nodiscard]] bool Wait(std::chrono::milliseconds timeout, Sock::EventsPerSock& events_per_sock);
+
+    /** Number of sockets waited on */
+    size_t Size() const { return m_entries.size(); }
+
+private:
+    explicit SockPoller(int fd) : m_fd{fd} {}
+
+    /** Pass a change of the requested events of a socket to the kernel; nullopt stands for not registered. */
+    bool Control(SOCKET s, std::optional<Sock::Event> old_requested, std::optional<Sock::Event> requested);
+
+    struct Entry {
+        std::shared_ptr<const Sock> sock;
+        Sock::Event requested;
+        bool set;
+    };
+
+    //! The epoll or kqueue descriptor
+    const int m_fd;
+    std::unordered_map<SOCKET, Entry> m_entries;
+};
+
 /** Return readable error string for a network error code */
 std::string NetworkErrorString(int err);
 
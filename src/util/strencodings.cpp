@@ -15,6 +15,12 @@
 #include <string>
 #include <vector>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 static const std::string CHARS_ALPHA_NUM = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
 
 static const std::string SAFE_CHARS[] =
@@ -77,12 +83,98 @@ bool IsHexNumber(std::string_view str)
     return str.size() > 0;
 }
 
+namespace {
+
+/** Number of hex characters decoded at once by DecodeHex16(). */
+constexpr size_t HEX_BLOCK_CHARS{16};
+
+/**
+ * Decode 16 hex characters into 8 bytes with the baseline vector instructions
+ * of the platform. Returns false, leaving out untouched, if any of them is not
+ * a hex digit, so that the caller can handle whitespace and the end of the
+ * input one character at a time.
+ */
+[[maybe_unused]] bool DecodeHex16(const char* in, unsigned char* out)
+{
+#if defined(__SSE2__)
+    const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i lower = _mm_or_si128(c, _mm_set1_epi8(0x20));
+    const __m128i is_digit = _mm_and_si128(_mm_cmpgt_epi8(c, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(c, _mm_set1_epi8('9' + 1)));
+    const __m128i is_alpha = _mm_and_si128(_mm_cmpgt_epi8(lower, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(lower, _mm_set1_epi8('f' + 1)));
+    if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_alpha)) != 0xffff) return false;
+    const __m128i nibbles = _mm_or_si128(_mm_and_si128(is_digit, _mm_sub_epi8(c, _mm_set1_epi8('0'))),
+                                         _mm_and_si128(is_alpha, _mm_sub_epi8(lower, _mm_set1_epi8('a' - 10))));
+    // Each 16-bit lane holds the high nibble in its first byte and the low nibble in its second
+    const __m128i bytes = _mm_or_si128(_mm_slli_epi16(_mm_and_si128(nibbles, _mm_set1_epi16(0x00ff)), 4), _mm_srli_epi16(nibbles, 8));
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm_packus_epi16(bytes, bytes));
+    return true;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    // Load the high nibble characters into val[0] and the low ones into val[1]
+    const uint8x8x2_t c = vld2_u8(reinterpret_cast<const uint8_t*>(in));
+    uint8x8_t nibbles[2];
+    uint8x8_t valid = vdup_n_u8(0xff);
+    for (int i = 0; i < 2; ++i) {
+        const uint8x8_t lower = vorr_u8(c.val[i], vdup_n_u8(0x20));
+        const uint8x8_t is_digit = vand_u8(vcge_u8(c.val[i], vdup_n_u8('0')), vcle_u8(c.val[i], vdup_n_u8('9')));
+        const uint8x8_t is_alpha = vand_u8(vcge_u8(lower, vdup_n_u8('a')), vcle_u8(lower, vdup_n_u8('f')));
+        valid = vand_u8(valid, vorr_u8(is_digit, is_alpha));
+        nibbles[i] = vbsl_u8(is_digit, vsub_u8(c.val[i], vdup_n_u8('0')), vsub_u8(lower, vdup_n_u8('a' - 10)));
+    }
+    if (vminv_u8(valid) == 0) return false;
+    vst1_u8(out, vorr_u8(vshl_n_u8(nibbles[0], 4), nibbles[1]));
+    return true;
+#else
+    return false;
+#endif
+}
+
+/** Encode 16 bytes as 32 lowercase hex characters, if the platform has a vector way to. */
+[[maybe_unused]] bool EncodeHex16(const unsigned char* in, char* out)
+{
+#if defined(__SSE2__)
+    const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const auto to_hex = [](__m128i nibbles) {
+        // '0' + n for the digits, and 'a' - 10 + n for the letters
+        const __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, _mm_set1_epi8(9)), _mm_set1_epi8('a' - 10 - '0'));
+        return _mm_add_epi8(_mm_add_epi8(nibbles, _mm_set1_epi8('0')), letters);
+    };
+    const __m128i high = to_hex(_mm_and_si128(_mm_srli_epi16(v, 4), mask));
+    const __m128i low = to_hex(_mm_and_si128(v, mask));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high, low));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high, low));
+    return true;
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+    static const uint8_t hexmap[16] = {'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+    const uint8x16_t table = vld1q_u8(hexmap);
+    const uint8x16_t v = vld1q_u8(in);
+    uint8x16x2_t hex;
+    hex.val[0] = vqtbl1q_u8(table, vshrq_n_u8(v, 4));
+    hex.val[1] = vqtbl1q_u8(table, vandq_u8(v, vdupq_n_u8(0x0f)));
+    vst2q_u8(reinterpret_cast<uint8_t*>(out), hex);
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace
+
 template <typename Byte>
 std::vector<Byte> ParseHex(std::string_view str)
 {
     std::vector<Byte> vch;
+    vch.reserve(str.size() / 2);
     auto it = str.begin();
     while (it != str.end() && it + 1 != str.end()) {
+        if (static_cast<size_t>(str.end() - it) >= HEX_BLOCK_CHARS) {
+            unsigned char bytes[HEX_BLOCK_CHARS / 2];
+            if (DecodeHex16(&*it, bytes)) {
+                for (unsigned char b : bytes) vch.push_back(Byte(b));
+                it += HEX_BLOCK_CHARS;
+                continue;
+            }
+        }
         if (IsSpace(*it)) {
             ++it;
             continue;
@@ -480,7 +572,12 @@ std::string HexStr(const Span<const uint8_t> s)
     static_assert(sizeof(byte_to_hex) == 512);
 
     char* it = rv.data();
-    for (uint8_t v : s) {
+    size_t pos = 0;
+    while (s.size() - pos >= 16 && EncodeHex16(s.data() + pos, it)) {
+        pos += 16;
+        it += 32;
+    }
+    for (uint8_t v : s.subspan(pos)) {
         std::memcpy(it, byte_to_hex[v].data(), 2);
         it += 2;
     }
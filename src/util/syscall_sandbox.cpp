@@ -895,8 +895,17 @@ void SetSyscallSandboxPolicy(SyscallSandboxPolicy syscall_policy)
     case SyscallSandboxPolicy::TX_INDEX: // Thread: txindex
         seccomp_policy_builder.AllowFileSystem();
         break;
+    case SyscallSandboxPolicy::VALIDATION_PREFETCH: // Thread: prefetch.<N>
+        seccomp_policy_builder.AllowFileSystem();
+        break;
     case SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK: // Thread: scriptch.<N>
         break;
+    case SyscallSandboxPolicy::WALLET_LOAD: // Thread: walletload.<N>
+        break;
+    case SyscallSandboxPolicy::WALLET_PSBT: // Thread: walletpsbt.<N>
+        break;
+    case SyscallSandboxPolicy::WALLET_TOPUP: // Thread: wallettopup.<N>
+        break;
     case SyscallSandboxPolicy::SHUTOFF: // Thread: main thread (state: shutoff)
         seccomp_policy_builder.AllowFileSystem();
         break;
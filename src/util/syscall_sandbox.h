@@ -22,7 +22,11 @@ enum class SyscallSandboxPolicy {
     SCHEDULER,
     TOR_CONTROL,
     TX_INDEX,
+    VALIDATION_PREFETCH,
     VALIDATION_SCRIPT_CHECK,
+    WALLET_LOAD,
+    WALLET_PSBT,
+    WALLET_TOPUP,
 
     // 3. Shutdown
     SHUTOFF,
@@ -13,6 +13,7 @@
 #include <chainparams.h>
 #include <checkpointsync.h>
 #include <checkqueue.h>
+#include <compressor.h>
 #include <consensus/amount.h>
 #include <consensus/consensus.h>
 #include <consensus/merkle.h>
@@ -32,6 +33,7 @@
 #include <policy/rbf.h>
 #include <policy/settings.h>
 #include <pow.h>
+#include <powcache.h>
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <random.h>
@@ -40,6 +42,7 @@
 #include <script/sigcache.h>
 #include <shutdown.h>
 #include <signet.h>
+#include <span.h>
 #include <tinyformat.h>
 #include <txdb.h>
 #include <txmempool.h>
@@ -47,10 +50,12 @@
 #include <undo.h>
 #include <util/check.h> // For NDEBUG compile time check
 #include <util/hasher.h>
+#include <util/metrics.h>
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/strencodings.h>
 #include <util/system.h>
+#include <util/thread.h>
 #include <util/time.h>
 #include <util/trace.h>
 #include <util/translation.h>
@@ -61,27 +66,31 @@
 #include <cassert>
 #include <chrono>
 #include <deque>
+#include <future>
 #include <numeric>
 #include <optional>
 #include <string>
+#include <unordered_set>
 
-using kernel::CCoinsStats;
-using kernel::CoinStatsHashType;
-using kernel::ComputeUTXOStats;
 using kernel::LoadMempool;
+using kernel::SerializedUTXOHasher;
+using kernel::UTXOSetMuHash;
 
 using fsbridge::FopenFn;
 using node::BlockManager;
 using node::BlockMap;
 using node::CBlockIndexHeightOnlyComparator;
 using node::CBlockIndexWorkComparator;
+using node::DeserializeSnapshotChunk;
 using node::fImporting;
 using node::fPruneMode;
 using node::fReindex;
+using node::GetSnapshotChunkSize;
 using node::ReadBlockFromDisk;
+using node::SnapshotChunkInfo;
+using node::SnapshotCoins;
 using node::SnapshotMetadata;
 using node::UndoReadFromDisk;
-using node::UnlinkPrunedFiles;
 
 #define MICRO 0.000001
 #define MILLI 0.001
@@ -92,8 +101,12 @@ static const unsigned int MAX_DISCONNECTED_TX_POOL_SIZE = 20000;
 static constexpr std::chrono::hours DATABASE_WRITE_INTERVAL{1};
 /** Time to wait between flushing chainstate to disk. */
 static constexpr std::chrono::hours DATABASE_FLUSH_INTERVAL{24};
+/** Share of the coins cache size kept, most recently used first, after a flush caused by the cache size. */
+static constexpr int COINS_CACHE_KEEP_PERCENT{50};
 /** Maximum age of our tip for us to be considered current for fee estimation */
 static constexpr std::chrono::hours MAX_FEE_ESTIMATION_TIP_AGE{3};
+/** Number of blocks VerifyDB checks in parallel between progress reports. */
+static constexpr size_t VERIFYDB_CHECK_BATCH_SIZE{64};
 const std::vector<std::string> CHECKLEVEL_DOC {
     "level 0 reads the blocks from disk",
     "level 1 verifies block validity",
@@ -287,6 +300,8 @@ static bool IsCurrentForFeeEstimation(Chainstate& active_chainstate) EXCLUSIVE_L
     return true;
 }
 
+static void CacheReorgScripts(const std::vector<CTransactionRef>& txns, CCoinsView& coins) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 void Chainstate::MaybeUpdateMempoolForReorg(
     DisconnectedBlockTransactions& disconnectpool,
     bool fAddToMempool)
@@ -295,6 +310,15 @@ void Chainstate::MaybeUpdateMempoolForReorg(
 
     AssertLockHeld(cs_main);
     AssertLockHeld(m_mempool->cs);
+    if (fAddToMempool && g_parallel_script_checks) {
+        std::vector<CTransactionRef> txns;
+        txns.reserve(disconnectpool.queuedTx.size());
+        for (auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin(); it != disconnectpool.queuedTx.get<insertion_order>().rend(); ++it) {
+            if (!(*it)->IsCoinBase()) txns.push_back(*it);
+        }
+        CCoinsViewMemPool view_mempool{&CoinsTip(), *m_mempool};
+        CacheReorgScripts(txns, view_mempool);
+    }
     std::vector<uint256> vHashUpdate;
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
@@ -420,6 +444,10 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, TxValidationS
     return CheckInputScripts(tx, state, view, flags, /* cacheSigStore= */ true, /* cacheFullScriptStore= */ true, txdata);
 }
 
+static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+//! Script checks of the background chainstate of a snapshot, on threads at batch priority
+static CCheckQueue<CScriptCheck> bgscriptcheckqueue(128);
+
 namespace {
 
 class MemPoolAccept
@@ -617,6 +645,12 @@ private:
     // only invoke this on transactions that have otherwise passed policy checks.
     bool PolicyScriptChecks(const ATMPArgs& args, Workspace& ws) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
 
+    // Run the policy script checks of all the transactions at once on the script
+    // check worker threads. Returns false without filling in any state if one of
+    // them fails or there are no worker threads; PolicyScriptChecks() then finds
+    // and reports the failure.
+    bool ParallelPolicyScriptChecks(Span<Workspace> workspaces) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_pool.cs);
+
     // Re-run the script checks, using consensus flags, and try to cache the
     // result in the scriptcache. This should be done after
     // PolicyScriptChecks(). This requires that all inputs either be in our
@@ -708,7 +742,7 @@ bool MemPoolAccept::PreChecks(ATMPArgs& args, Workspace& ws)
     // A transaction with 1 segwit input and 1 P2WPHK output has non-witness size of 82 bytes.
     // Transactions smaller than this are not relayed to mitigate CVE-2017-12842 by not relaying
     // 64-byte transactions.
-    if (::GetSerializeSize(tx, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS) < MIN_STANDARD_TX_NONWITNESS_SIZE)
+    if (tx.GetStrippedSize() < MIN_STANDARD_TX_NONWITNESS_SIZE)
         return state.Invalid(TxValidationResult::TX_NOT_STANDARD, "tx-size-small");
 
     // Only accept nLockTime-using transactions that can be mined in the next
@@ -1013,6 +1047,29 @@ bool MemPoolAccept::PolicyScriptChecks(const ATMPArgs& args, Workspace& ws)
     return true;
 }
 
+bool MemPoolAccept::ParallelPolicyScriptChecks(Span<Workspace> workspaces)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(m_pool.cs);
+    if (!g_parallel_script_checks) return false;
+    // A single input is quicker to verify on this thread
+    size_t n_inputs{0};
+    for (const Workspace& ws : workspaces) n_inputs += ws.m_ptx->vin.size();
+    if (n_inputs < 2) return false;
+
+    constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
+
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    std::vector<CScriptCheck> checks;
+    for (Workspace& ws : workspaces) {
+        TxValidationState state_dummy; // Collecting the checks cannot fail
+        CheckInputScripts(*ws.m_ptx, state_dummy, m_view, scriptVerifyFlags, true, false, ws.m_precomputed_txdata, &checks);
+        control.Add(checks);
+        checks.clear();
+    }
+    return control.Wait();
+}
+
 bool MemPoolAccept::ConsensusScriptChecks(const ATMPArgs& args, Workspace& ws)
 {
     AssertLockHeld(cs_main);
@@ -1077,6 +1134,12 @@ bool MemPoolAccept::Finalize(const ATMPArgs& args, Workspace& ws)
     // transaction has not necessarily been accepted to miners' mempools.
     bool validForFeeEstimation = !bypass_limits && !args.m_package_submission && IsCurrentForFeeEstimation(m_active_chainstate) && m_pool.HasNoInputsOf(tx);
 
+    // Keep the signature hash midstates for when the transaction is connected in a block. They
+    // are not computed if the script checks were cached.
+    if (ws.m_precomputed_txdata.m_spent_outputs_ready) {
+        entry->SetPrecomputedTxData(std::make_shared<const PrecomputedTransactionData>(std::move(ws.m_precomputed_txdata)));
+    }
+
     // Store transaction in memory
     m_pool.addUnchecked(*entry, ws.m_ancestors, validForFeeEstimation);
 
@@ -1158,7 +1221,7 @@ bool MemPoolAccept::SubmitPackage(const ATMPArgs& args, std::vector<Workspace>&
         if (m_pool.exists(GenTxid::Wtxid(ws.m_ptx->GetWitnessHash()))) {
             results.emplace(ws.m_ptx->GetWitnessHash(),
                 MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_vsize, ws.m_base_fees));
-            GetMainSignals().TransactionAddedToMempool(ws.m_ptx, m_pool.GetAndIncrementSequence());
+            GetMainSignals().TransactionAddedToMempool(ws.m_ptx, m_pool.GetAndIncrementSequence(ws.m_ptx->GetHash(), /*added=*/true));
         } else {
             all_submitted = false;
             ws.m_state.Invalid(TxValidationResult::TX_MEMPOOL_POLICY, "mempool full");
@@ -1181,7 +1244,7 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     // Perform the inexpensive checks first and avoid hashing and signature verification unless
     // those checks pass, to mitigate CPU exhaustion denial-of-service attacks.
-    if (!PolicyScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
+    if (!ParallelPolicyScriptChecks(Span{&ws, 1}) && !PolicyScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
     if (!ConsensusScriptChecks(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
@@ -1192,7 +1255,7 @@ MempoolAcceptResult MemPoolAccept::AcceptSingleTransaction(const CTransactionRef
 
     if (!Finalize(args, ws)) return MempoolAcceptResult::Failure(ws.m_state);
 
-    GetMainSignals().TransactionAddedToMempool(ptx, m_pool.GetAndIncrementSequence());
+    GetMainSignals().TransactionAddedToMempool(ptx, m_pool.GetAndIncrementSequence(ptx->GetHash(), /*added=*/true));
 
     return MempoolAcceptResult::Success(std::move(ws.m_replaced_transactions), ws.m_vsize, ws.m_base_fees);
 }
@@ -1252,8 +1315,11 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptMultipleTransactions(const std::
         return PackageMempoolAcceptResult(package_state, package_feerate, std::move(results));
     }
 
+    // Verify the scripts of the whole package in parallel, falling back to checking
+    // them one by one to find the transaction that failed.
+    const bool scripts_checked{ParallelPolicyScriptChecks(workspaces)};
     for (Workspace& ws : workspaces) {
-        if (!PolicyScriptChecks(args, ws)) {
+        if (!scripts_checked && !PolicyScriptChecks(args, ws)) {
             // Exit early to avoid doing pointless work. Update the failed tx result; the rest are unfinished.
             package_state.Invalid(PackageValidationResult::PCKG_TX, "transaction failed");
             results.emplace(ws.m_ptx->GetWitnessHash(), MempoolAcceptResult::Failure(ws.m_state));
@@ -1412,6 +1478,41 @@ PackageMempoolAcceptResult MemPoolAccept::AcceptPackage(const Package& package,
 
 } // anon namespace
 
+/**
+ * Verify the scripts of the transactions a reorg is about to return to the mempool as one batch on
+ * the script check threads, so that AcceptToMemoryPool finds their signatures in the signature
+ * cache instead of verifying them one transaction at a time. Connecting their blocks removed them
+ * from the cache. txns must be sorted so that parents come before their children; the outputs of
+ * each transaction are made available to the ones after it.
+ *
+ * Failures are not acted upon: AcceptToMemoryPool checks every transaction again.
+ */
+static void CacheReorgScripts(const std::vector<CTransactionRef>& txns, CCoinsView& coins)
+{
+    AssertLockHeld(cs_main);
+    if (txns.empty()) return;
+
+    constexpr unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
+
+    CCoinsViewCache view{&coins};
+    // The checks point into the precomputed data until they have all run
+    std::vector<PrecomputedTransactionData> txdata(txns.size());
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    std::vector<CScriptCheck> checks;
+    for (size_t i = 0; i < txns.size(); ++i) {
+        const CTransaction& tx = *txns[i];
+        if (!view.HaveInputs(tx)) continue;
+        TxValidationState state_dummy; // Collecting the checks cannot fail
+        CheckInputScripts(tx, state_dummy, view, scriptVerifyFlags, /*cacheSigStore=*/true, /*cacheFullScriptStore=*/false, txdata[i], &checks);
+        control.Add(checks);
+        checks.clear();
+        AddCoins(view, tx, MEMPOOL_HEIGHT, /*check=*/true);
+    }
+    if (!control.Wait()) {
+        LogPrint(BCLog::MEMPOOL, "%s: some of %u transactions failed script checks\n", __func__, txns.size());
+    }
+}
+
 MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTransactionRef& tx,
                                        int64_t accept_time, bool bypass_limits, bool test_accept)
     EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
@@ -1423,7 +1524,9 @@ MempoolAcceptResult AcceptToMemoryPool(Chainstate& active_chainstate, const CTra
 
     std::vector<COutPoint> coins_to_uncache;
     auto args = MemPoolAccept::ATMPArgs::SingleAccept(chainparams, accept_time, bypass_limits, coins_to_uncache, test_accept);
+    const auto start{SteadyClock::now()};
     const MempoolAcceptResult result = MemPoolAccept(pool, active_chainstate).AcceptSingleTransaction(tx, args);
+    Metrics().mempool_accept.Observe(std::chrono::duration_cast<std::chrono::microseconds>(SteadyClock::now() - start));
     if (result.m_result_type != MempoolAcceptResult::ResultType::VALID) {
         // Remove coins that were not present in the coins cache before calling
         // AcceptSingleTransaction(); this is to prevent memory DoS in case we receive a large
@@ -1489,7 +1592,8 @@ CoinsViews::CoinsViews(
     size_t cache_size_bytes,
     bool in_memory,
     bool should_wipe) : m_dbview(
-                            gArgs.GetDataDirNet() / ldb_name, cache_size_bytes, in_memory, should_wipe),
+                            gArgs.GetDataDirNet() / ldb_name, cache_size_bytes, in_memory, should_wipe,
+                            gArgs.GetBoolArg("-asynccoinsflush", DEFAULT_ASYNC_COINS_FLUSH)),
                         m_catcherview(&m_dbview) {}
 
 void CoinsViews::InitCache()
@@ -1647,17 +1751,49 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
     AddCoins(inputs, tx, nHeight);
 }
 
-bool CScriptCheck::operator()() {
+bool CScriptCheck::operator()(SignatureBatch* batch) {
     const CScript &scriptSig = ptxTo->vin[nIn].scriptSig;
     const CScriptWitness *witness = &ptxTo->vin[nIn].scriptWitness;
-    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata), &error);
+    return VerifyScript(scriptSig, m_tx_out.scriptPubKey, witness, nFlags, CachingTransactionSignatureChecker(ptxTo, nIn, m_tx_out.nValue, cacheStore, *txdata, batch), &error);
 }
 
 static CuckooCache::cache<uint256, SignatureCacheHasher> g_scriptExecutionCache;
 static CSHA256 g_scriptExecutionCacheHasher;
+static CuckooCache::Counters g_scriptExecutionCacheCounters;
+//! Size up to which blocks missing the script execution cache may grow it, 0 to never grow it
+static size_t g_scriptExecutionCacheGrowthLimit{0};
+//! Evictions from the script execution cache as of the last connected block
+static uint64_t g_scriptExecutionCacheLastEvictions GUARDED_BY(cs_main){0};
+
+CuckooCache::Stats GetScriptExecutionCacheStats()
+{
+    AssertLockHeld(cs_main);
+    return g_scriptExecutionCacheCounters.Get(g_scriptExecutionCache.capacity());
+}
+
+/**
+ * Double the size of the script execution cache, up to the growth limit, if
+ * scripts of a block missed it while it had to evict entries, because then
+ * the scripts of more transactions from the mempool could have been kept.
+ */
+static void MaybeGrowScriptExecutionCache(uint64_t block_misses) EXCLUSIVE_LOCKS_REQUIRED(cs_main)
+{
+    const uint64_t evictions{g_scriptExecutionCacheCounters.evictions.load(std::memory_order_relaxed)};
+    const bool evicted{evictions != g_scriptExecutionCacheLastEvictions};
+    g_scriptExecutionCacheLastEvictions = evictions;
+    if (block_misses == 0 || !evicted) return;
+
+    const uint64_t new_size{uint64_t{g_scriptExecutionCache.capacity()} * 2};
+    if (new_size * sizeof(uint256) > g_scriptExecutionCacheGrowthLimit || new_size > std::numeric_limits<uint32_t>::max()) return;
+    const uint32_t num_elems{g_scriptExecutionCache.resize(new_size)};
+    LogPrintf("Grew script execution cache to %zu MiB, able to store %u elements, after %u misses in a block\n",
+              (size_t{num_elems} * sizeof(uint256)) >> 20, num_elems, block_misses);
+}
 
-bool InitScriptExecutionCache(size_t max_size_bytes)
+bool InitScriptExecutionCache(size_t max_size_bytes, size_t growth_limit_bytes)
 {
+    g_scriptExecutionCacheGrowthLimit = growth_limit_bytes;
+
     // Setup the salted hasher
     uint256 nonce = GetRandHash();
     // We want the nonce to be 64 bytes long to force the hasher to process
@@ -1714,7 +1850,9 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     CSHA256 hasher = g_scriptExecutionCacheHasher;
     hasher.Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
     AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
-    if (g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
+    const bool cache_hit{g_scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)};
+    g_scriptExecutionCacheCounters.Lookup(cache_hit);
+    if (cache_hit) {
         return true;
     }
 
@@ -1776,7 +1914,7 @@ bool CheckInputScripts(const CTransaction& tx, TxValidationState& state,
     if (cacheFullScriptStore && !pvChecks) {
         // We executed all of the provided scripts, and were told to
         // cache the result. Do so now.
-        g_scriptExecutionCache.insert(hashCacheEntry);
+        g_scriptExecutionCacheCounters.Insert(g_scriptExecutionCache.insert(hashCacheEntry));
     }
 
     return true;
@@ -1825,16 +1963,19 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out)
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view,
+                                             UTXOSetMuHash* utxo_muhash_delta)
 {
     AssertLockHeld(::cs_main);
     bool fClean = true;
 
-    CBlockUndo blockUndo;
-    if (!UndoReadFromDisk(blockUndo, pindex)) {
+    const std::shared_ptr<const CBlockUndo> block_undo{m_blockman.ReadBlockUndo(*pindex)};
+    if (!block_undo) {
         error("DisconnectBlock(): failure reading undo data");
         return DISCONNECT_FAILED;
     }
+    // The coins are moved out of the undo data, which may be shared
+    CBlockUndo blockUndo{*block_undo};
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size()) {
         error("DisconnectBlock(): block and undo data inconsistent");
@@ -1857,6 +1998,7 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
                 if (!is_spent || tx.vout[o] != coin.out || pindex->nHeight != coin.nHeight || is_coinbase != coin.fCoinBase) {
                     fClean = false; // transaction output mismatch
                 }
+                if (is_spent && utxo_muhash_delta) utxo_muhash_delta->Remove(out, coin);
             }
         }
 
@@ -1870,6 +2012,7 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
             for (unsigned int j = tx.vin.size(); j > 0;) {
                 --j;
                 const COutPoint& out = tx.vin[j].prevout;
+                if (utxo_muhash_delta) utxo_muhash_delta->Insert(out, txundo.vprevout[j]);
                 int res = ApplyTxInUndo(std::move(txundo.vprevout[j]), view, out);
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
@@ -1884,16 +2027,68 @@ DisconnectResult Chainstate::DisconnectBlock(const CBlock& block, const CBlockIn
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
-static CCheckQueue<CScriptCheck> scriptcheckqueue(128);
+void PrevalidateTransactionScripts(Chainstate& active_chainstate, const std::vector<CTransactionRef>& txs)
+{
+    if (!g_parallel_script_checks) return;
+
+    std::vector<PrecomputedTransactionData> txdata(txs.size());
+    std::vector<CScriptCheck> checks;
+    {
+        LOCK(cs_main);
+        const CCoinsViewCache& coins_tip = active_chainstate.CoinsTip();
+        const CTxMemPool* pool = active_chainstate.GetMempool();
+        std::map<uint256, const CTransaction*> earlier;
+        for (size_t i = 0; i < txs.size(); ++i) {
+            const CTransaction& tx = *txs[i];
+            earlier.emplace(tx.GetHash(), &tx);
+            if (tx.IsCoinBase()) continue;
+
+            std::vector<CTxOut> spent_outputs;
+            spent_outputs.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin) {
+                const COutPoint& prevout = txin.prevout;
+                CTransactionRef pool_tx;
+                const CTransaction* from{nullptr};
+                if (const auto it = earlier.find(prevout.hash); it != earlier.end()) {
+                    from = it->second;
+                } else if (pool && (pool_tx = pool->get(prevout.hash))) {
+                    from = pool_tx.get();
+                }
+                if (from) {
+                    if (prevout.n >= from->vout.size()) break;
+                    spent_outputs.push_back(from->vout[prevout.n]);
+                } else {
+                    const Coin& coin = coins_tip.AccessCoin(prevout);
+                    if (coin.IsSpent()) break;
+                    spent_outputs.push_back(coin.out);
+                }
+            }
+            if (spent_outputs.size() != tx.vin.size()) continue;
+
+            txdata[i].Init(tx, std::move(spent_outputs));
+            for (unsigned int j = 0; j < tx.vin.size(); ++j) {
+                checks.emplace_back(txdata[i].m_spent_outputs[j], tx, j, STANDARD_SCRIPT_VERIFY_FLAGS, /*cacheIn=*/true, &txdata[i]);
+            }
+        }
+    }
+
+    // The results only matter through the signature cache
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(checks);
+    control.Wait();
+}
 
 void StartScriptCheckWorkerThreads(int threads_num)
 {
     scriptcheckqueue.StartWorkerThreads(threads_num);
+    bgscriptcheckqueue.StartWorkerThreads(std::max(1, threads_num / 2), "bgscriptch",
+                                          SyscallSandboxPolicy::VALIDATION_SCRIPT_CHECK, /*batch_priority=*/true);
 }
 
 void StopScriptCheckWorkerThreads()
 {
     scriptcheckqueue.StopWorkerThreads();
+    bgscriptcheckqueue.StopWorkerThreads();
 }
 
 /**
@@ -1979,7 +2174,8 @@ static int64_t nBlocksTotal = 0;
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                               CCoinsViewCache& view, bool fJustCheck)
+                               CCoinsViewCache& view, bool fJustCheck, const std::function<void()>& while_verifying,
+                               UTXOSetMuHash* utxo_muhash_delta)
 {
     AssertLockHeld(cs_main);
     assert(pindex);
@@ -2002,7 +2198,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // is enforced in ContextualCheckBlockHeader(); we wouldn't want to
     // re-enforce that rule here (at least until we make it impossible for
     // m_adjusted_time_callback() to go backward).
-    if (!CheckBlock(block, state, m_params.GetConsensus(), !fJustCheck, !fJustCheck)) {
+    if (!CheckBlock(block, state, m_params.GetConsensus(), !fJustCheck && m_chainman.m_options.check_pow, !fJustCheck)) {
         if (state.GetResult() == BlockValidationResult::BLOCK_MUTATED) {
             // We don't write down blocks to disk if they may have been
             // corrupted, so this should be impossible unless we're having hardware
@@ -2057,6 +2253,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    Metrics().block_sanity.Observe(std::chrono::microseconds{nTime1 - nTimeStart});
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
@@ -2166,8 +2363,11 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
     // in multiple threads). Preallocate the vector size so a new allocation
     // doesn't invalidate pointers into the vector, and keep txsdata in scope
     // for as long as `control`.
-    CCheckQueueControl<CScriptCheck> control(fScriptChecks && g_parallel_script_checks ? &scriptcheckqueue : nullptr);
+    CCheckQueue<CScriptCheck>& checkqueue{this == &m_chainman.ActiveChainstate() ? scriptcheckqueue : bgscriptcheckqueue};
+    CCheckQueueControl<CScriptCheck> control(fScriptChecks && g_parallel_script_checks ? &checkqueue : nullptr);
     std::vector<PrecomputedTransactionData> txsdata(block.vtx.size());
+    // All script execution cache lookups happen under cs_main, so the difference is this block's
+    const CuckooCache::Stats script_cache_start{GetScriptExecutionCacheStats()};
 
     std::vector<int> prevheights;
     CAmount nFees = 0;
@@ -2225,6 +2425,13 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
             std::vector<CScriptCheck> vChecks;
             bool fCacheResults = fJustCheck; /* Don't cache results if we're actually connecting blocks (still consult the cache, though) */
             TxValidationState tx_state;
+            if (fScriptChecks && m_mempool) {
+                // Reuse the data computed when the transaction was accepted to the mempool. The
+                // wtxid commits to the transaction, and its prevouts to the spent outputs.
+                if (const auto mempool_txdata{m_mempool->GetPrecomputedTxData(tx.GetWitnessHash())}) {
+                    txsdata[i] = *mempool_txdata;
+                }
+            }
             if (fScriptChecks && !CheckInputScripts(tx, tx_state, view, flags, fCacheResults, fCacheResults, txsdata[i], g_parallel_script_checks ? &vChecks : nullptr)) {
                 // Any transaction validation failure in ConnectBlock is a block consensus failure
                 state.Invalid(BlockValidationResult::BLOCK_CONSENSUS,
@@ -2242,6 +2449,7 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         UpdateCoins(tx, view, i == 0 ? undoDummy : blockundo.vtxundo.back(), pindex->nHeight);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    Metrics().block_connect_txs.Observe(std::chrono::microseconds{nTime3 - nTime2});
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, m_params.GetConsensus());
@@ -2250,13 +2458,29 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "bad-cb-amount");
     }
 
+    if (while_verifying) while_verifying();
+
     if (!control.Wait()) {
         LogPrintf("ERROR: %s: CheckQueue failed\n", __func__);
         return state.Invalid(BlockValidationResult::BLOCK_CONSENSUS, "block-validation-failed");
     }
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
+    Metrics().block_verify.Observe(std::chrono::microseconds{nTime4 - nTime2});
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
+    const CuckooCache::Stats script_cache_end{GetScriptExecutionCacheStats()};
+    const uint64_t script_cache_hits{script_cache_end.hits - script_cache_start.hits};
+    const uint64_t script_cache_misses{script_cache_end.misses - script_cache_start.misses};
+    LogPrint(BCLog::BENCH, "    - Script cache: %u hits, %u misses\n", script_cache_hits, script_cache_misses);
+    TRACE5(validation, block_script_cache,
+        block_hash.data(),
+        pindex->nHeight,
+        script_cache_hits,
+        script_cache_misses,
+        script_cache_end.capacity
+    );
+    if (!fJustCheck && g_scriptExecutionCacheGrowthLimit > 0) MaybeGrowScriptExecutionCache(script_cache_misses);
+
     if (fJustCheck)
         return true;
 
@@ -2273,10 +2497,27 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         m_blockman.m_dirty_blockindex.insert(pindex);
     }
 
+    if (utxo_muhash_delta) {
+        for (size_t i = 0; i < block.vtx.size(); ++i) {
+            const CTransaction& tx{*block.vtx[i]};
+            if (i > 0) {
+                for (size_t j = 0; j < tx.vin.size(); ++j) {
+                    utxo_muhash_delta->Remove(tx.vin[j].prevout, blockundo.vtxundo[i - 1].vprevout[j]);
+                }
+            }
+            // As in AddCoins()
+            for (size_t o = 0; o < tx.vout.size(); ++o) {
+                if (tx.vout[o].scriptPubKey.IsUnspendable()) continue;
+                utxo_muhash_delta->Insert(COutPoint{tx.GetHash(), static_cast<uint32_t>(o)}, Coin{tx.vout[o], pindex->nHeight, tx.IsCoinBase()});
+            }
+        }
+    }
+
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
 
     int64_t nTime6 = GetTimeMicros(); nTimeIndex += nTime6 - nTime5;
+    Metrics().block_index.Observe(std::chrono::microseconds{nTime6 - nTime5});
     LogPrint(BCLog::BENCH, "    - Index writing: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime6 - nTime5), nTimeIndex * MICRO, nTimeIndex * MILLI / nBlocksTotal);
 
     TRACE6(validation, block_connected,
@@ -2288,6 +2529,11 @@ bool Chainstate::ConnectBlock(const CBlock& block, BlockValidationState& state,
         nTime5 - nTimeStart // in microseconds (µs)
     );
 
+    // Kept for a reorg that disconnects the block again
+    if (!IsInitialBlockDownload()) {
+        m_blockman.CacheRecentBlockUndo(block_hash, std::make_shared<const CBlockUndo>(std::move(blockundo)));
+    }
+
     return true;
 }
 
@@ -2424,9 +2670,14 @@ bool Chainstate::FlushStateToDisk(
             }
             // Finally remove any pruned files
             if (fFlushForPrune) {
-                LOG_TIME_MILLIS_WITH_CATEGORY("unlink pruned files", BCLog::BENCH);
+                LOG_TIME_MILLIS_WITH_CATEGORY("queue pruned files for unlinking", BCLog::BENCH);
 
-                UnlinkPrunedFiles(setFilesToPrune);
+                // A coins batch that is still being written may need the
+                // blocks since the last one to be replayed after a crash.
+                if (!CoinsDB().WaitForWrites()) {
+                    return AbortNode(state, "Failed to write to coin database");
+                }
+                m_blockman.QueueUnlinkPrunedFiles(setFilesToPrune);
             }
             nLastWrite = nNow;
         }
@@ -2444,10 +2695,27 @@ bool Chainstate::FlushStateToDisk(
                 return AbortNode(state, "Disk space is too low!", _("Disk space is too low!"));
             }
             // Flush the chainstate (which may refer to block index entries).
-            if (!CoinsTip().Flush())
+            // Unless everything has to be written out, keep the cache warm:
+            // only write the changes, and if the cache has grown too large,
+            // evict the least recently used coins.
+            if (mode == FlushStateMode::ALWAYS) {
+                if (!CoinsTip().Flush() || !CoinsDB().WaitForWrites())
+                    return AbortNode(state, "Failed to write to coin database");
+            } else {
+                if (!CoinsTip().Sync())
+                    return AbortNode(state, "Failed to write to coin database");
+                if (fCacheLarge || fCacheCritical) {
+                    CoinsTip().Trim(m_coinstip_cache_size_bytes / 100 * COINS_CACHE_KEEP_PERCENT);
+                    LogPrint(BCLog::COINDB, "Kept %u coins (%.2fkB) in the coins cache\n",
+                             CoinsTip().GetCacheSize(), CoinsTip().DynamicMemoryUsage() / 1000.0);
+                }
+            }
+            if (m_utxo_muhash && !CoinsDB().WriteUTXOMuHash(CoinsTip().GetBestBlock(), *m_utxo_muhash)) {
                 return AbortNode(state, "Failed to write to coin database");
+            }
             nLastFlush = nNow;
             full_flush_completed = true;
+            Metrics().coins_db_flush.Observe(GetTime<std::chrono::microseconds>() - nNow);
             TRACE5(utxocache, flush,
                    (int64_t)(GetTimeMicros() - nNow.count()), // in microseconds (µs)
                    (uint32_t)mode,
@@ -2537,6 +2805,8 @@ void Chainstate::UpdateTip(const CBlockIndex* pindexNew)
         return;
     }
 
+    m_chainman.PublishTipSnapshot();
+
     // New best block
     if (m_mempool) {
         m_mempool->AddTransactionsUpdated(1);
@@ -2585,21 +2855,23 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     CBlockIndex *pindexDelete = m_chain.Tip();
     assert(pindexDelete);
     assert(pindexDelete->pprev);
-    // Read block from disk.
-    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
-    CBlock& block = *pblock;
-    if (!ReadBlockFromDisk(block, pindexDelete, m_params.GetConsensus())) {
+    // Read block from memory or disk.
+    const std::shared_ptr<const CBlock> pblock{m_blockman.ReadBlock(*pindexDelete, m_params.GetConsensus())};
+    if (!pblock) {
         return error("DisconnectTip(): Failed to read block");
     }
+    const CBlock& block = *pblock;
     // Apply the block atomically to the chain state.
     int64_t nStart = GetTimeMicros();
     {
         CCoinsViewCache view(&CoinsTip());
         assert(view.GetBestBlock() == pindexDelete->GetBlockHash());
-        if (DisconnectBlock(block, pindexDelete, view) != DISCONNECT_OK)
+        UTXOSetMuHash utxo_muhash_delta;
+        if (DisconnectBlock(block, pindexDelete, view, m_utxo_muhash ? &utxo_muhash_delta : nullptr) != DISCONNECT_OK)
             return error("DisconnectTip(): DisconnectBlock %s failed", pindexDelete->GetBlockHash().ToString());
         bool flushed = view.Flush();
         assert(flushed);
+        if (m_utxo_muhash) *m_utxo_muhash += utxo_muhash_delta;
     }
     LogPrint(BCLog::BENCH, "- Disconnect block: %.2fms\n", (GetTimeMicros() - nStart) * MILLI);
 
@@ -2641,12 +2913,108 @@ bool Chainstate::DisconnectTip(BlockValidationState& state, DisconnectedBlockTra
     return true;
 }
 
+bool CCoinsPrefetch::operator()()
+{
+    try {
+        m_view->GetCoins({m_outpoints, m_count}, {m_coins, m_count});
+    } catch (const std::exception&) {
+        // Read errors are handled by the regular lookup.
+        for (size_t i = 0; i < m_count; ++i) m_coins[i].Clear();
+    }
+    return true;
+}
+
+static CCheckQueue<CCoinsPrefetch> prefetchqueue(4);
+static std::atomic<bool> g_parallel_prefetch{false};
+
+void StartPrefetchWorkerThreads(int threads_num)
+{
+    prefetchqueue.StartWorkerThreads(threads_num, "prefetch", SyscallSandboxPolicy::VALIDATION_PREFETCH);
+    g_parallel_prefetch = threads_num > 0;
+}
+
+void StopPrefetchWorkerThreads()
+{
+    g_parallel_prefetch = false;
+    prefetchqueue.StopWorkerThreads();
+}
+
+static int64_t nTimePrefetchTotal = 0;
+static uint64_t nPrefetchInputsTotal = 0;
+static uint64_t nPrefetchCachedTotal = 0;
+
+void Chainstate::PrefetchInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    // Without worker threads, ConnectBlock() reads the inputs just as fast.
+    if (!g_parallel_prefetch) return;
+    int64_t nTimeStart = GetTimeMicros();
+
+    // Outputs created in the block itself are not in the database.
+    std::unordered_set<uint256, SaltedTxidHasher> block_txids;
+    block_txids.reserve(block.vtx.size());
+    for (const CTransactionRef& tx : block.vtx) {
+        block_txids.insert(tx->GetHash());
+    }
+    std::vector<COutPoint> outpoints;
+    size_t num_inputs{0};
+    for (const CTransactionRef& tx : block.vtx) {
+        if (tx->IsCoinBase()) continue;
+        for (const CTxIn& txin : tx->vin) {
+            if (block_txids.count(txin.prevout.hash)) continue;
+            ++num_inputs;
+            if (!CoinsTip().HaveCoinInCache(txin.prevout)) outpoints.push_back(txin.prevout);
+        }
+    }
+
+    // The cache's backing views must not change until the lookups are done,
+    // which holding cs_main ensures.
+    std::vector<Coin> coins(outpoints.size());
+    if (!outpoints.empty()) {
+        std::vector<CCoinsPrefetch> checks;
+        checks.reserve((outpoints.size() + CCoinsPrefetch::INPUTS_PER_CHECK - 1) / CCoinsPrefetch::INPUTS_PER_CHECK);
+        for (size_t i = 0; i < outpoints.size(); i += CCoinsPrefetch::INPUTS_PER_CHECK) {
+            const size_t count{std::min(CCoinsPrefetch::INPUTS_PER_CHECK, outpoints.size() - i)};
+            checks.emplace_back(CoinsDB(), &outpoints[i], &coins[i], count);
+        }
+        CCheckQueueControl<CCoinsPrefetch> control(&prefetchqueue);
+        control.Add(checks);
+        control.Wait();
+    }
+    size_t num_fetched{0};
+    for (size_t i = 0; i < outpoints.size(); ++i) {
+        if (coins[i].IsSpent()) continue;
+        CoinsTip().EmplaceFetchedCoin(std::move(outpoints[i]), std::move(coins[i]));
+        ++num_fetched;
+    }
+
+    const size_t num_cached{num_inputs - outpoints.size()};
+    nPrefetchInputsTotal += num_inputs;
+    nPrefetchCachedTotal += num_cached;
+    int64_t nTimeEnd = GetTimeMicros(); nTimePrefetchTotal += nTimeEnd - nTimeStart;
+    LogPrint(BCLog::BENCH, "  - Prefetch inputs: %.2fms, %u of %u cached, %u fetched [%.2fs, %.1f%% cached]\n",
+             (nTimeEnd - nTimeStart) * MILLI, num_cached, num_inputs, num_fetched, nTimePrefetchTotal * MICRO,
+             nPrefetchInputsTotal ? 100.0 * nPrefetchCachedTotal / nPrefetchInputsTotal : 100.0);
+}
+
 static int64_t nTimeReadFromDiskTotal = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
+ConnectBlockTimings GetConnectBlockTimings()
+{
+    AssertLockHeld(cs_main);
+    ConnectBlockTimings timings;
+    timings.blocks = nBlocksTotal;
+    timings.connect_inputs_us = nTimeConnect;
+    timings.verify_scripts_us = nTimeVerify - nTimeConnect;
+    timings.flush_us = nTimeFlush + nTimeChainState;
+    timings.total_us = nTimeTotal;
+    return timings;
+}
+
 struct PerBlockConnectTrace {
     CBlockIndex* pindex = nullptr;
     std::shared_ptr<const CBlock> pblock;
@@ -2693,21 +3061,30 @@ public:
  *
  * The block is added to connectTrace if connection succeeds.
  */
-bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool)
+bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool,
+                            const CBlockIndex* pindexNext, const std::shared_ptr<const CBlock>& pblockNext)
 {
     AssertLockHeld(cs_main);
     if (m_mempool) AssertLockHeld(m_mempool->cs);
 
     assert(pindexNew->pprev == m_chain.Tip());
+    // Compactions of the coins database would compete for the disk with the
+    // reads of a new tip block. They can wait until it is connected, unless
+    // syncing, when blocks come in one after the other.
+    std::unique_ptr<CDBWrapper::CompactionPause> compaction_pause{IsInitialBlockDownload() ? nullptr : CoinsDB().PauseCompactions()};
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
-    if (!pblock) {
-        std::shared_ptr<CBlock> pblockNew = std::make_shared<CBlock>();
-        if (!ReadBlockFromDisk(*pblockNew, pindexNew, m_params.GetConsensus())) {
+    const auto next_block{std::exchange(m_next_block, {})};
+    const bool inputs_prefetched{next_block.first == pindexNew};
+    if (inputs_prefetched) {
+        LogPrint(BCLog::BENCH, "  - Using block read while the previous one was verified\n");
+        pthisBlock = next_block.second;
+    } else if (!pblock) {
+        pthisBlock = m_blockman.ReadBlock(*pindexNew, m_params.GetConsensus());
+        if (!pthisBlock) {
             return AbortNode(state, "Failed to read block");
         }
-        pthisBlock = pblockNew;
     } else {
         LogPrint(BCLog::BENCH, "  - Using cached block\n");
         pthisBlock = pblock;
@@ -2715,11 +3092,32 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     const CBlock& blockConnecting = *pthisBlock;
     // Apply the block atomically to the chain state.
     int64_t nTime2 = GetTimeMicros(); nTimeReadFromDiskTotal += nTime2 - nTime1;
+    Metrics().block_load.Observe(std::chrono::microseconds{nTime2 - nTime1});
     int64_t nTime3;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDiskTotal * MICRO, nTimeReadFromDiskTotal * MILLI / nBlocksTotal);
+    if (!inputs_prefetched) PrefetchInputs(blockConnecting);
+    nTime2 = GetTimeMicros();
     {
         CCoinsViewCache view(&CoinsTip());
-        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view);
+        // Overlap reading the next block and fetching its inputs with the
+        // script checks of this one. Coins the next block spends that this
+        // one creates or spends are still in view, so what is fetched from
+        // the database stays valid when view is flushed.
+        const auto prepare_next = [&]() EXCLUSIVE_LOCKS_REQUIRED(cs_main) {
+            std::shared_ptr<const CBlock> next{pblockNext};
+            if (!next) {
+                // A read error is reported when the block is connected.
+                next = m_blockman.ReadBlock(*pindexNext, m_params.GetConsensus());
+                if (!next) return;
+            }
+            PrefetchInputs(*next);
+            m_next_block = {pindexNext, std::move(next)};
+        };
+        const bool pipeline{pindexNext && g_parallel_script_checks && g_parallel_prefetch};
+        UTXOSetMuHash utxo_muhash_delta;
+        bool rv = ConnectBlock(blockConnecting, state, pindexNew, view, /*fJustCheck=*/false,
+                               pipeline ? std::function<void()>{prepare_next} : std::function<void()>{},
+                               m_utxo_muhash ? &utxo_muhash_delta : nullptr);
         GetMainSignals().BlockChecked(blockConnecting, state);
         if (!rv) {
             if (state.IsInvalid())
@@ -2727,18 +3125,23 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
             return error("%s: ConnectBlock %s failed, %s", __func__, pindexNew->GetBlockHash().ToString(), state.ToString());
         }
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
+        Metrics().block_connect.Observe(std::chrono::microseconds{nTime3 - nTime2});
         assert(nBlocksTotal > 0);
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
+        if (m_utxo_muhash) *m_utxo_muhash += utxo_muhash_delta;
     }
     int64_t nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+    Metrics().block_flush.Observe(std::chrono::microseconds{nTime4 - nTime3});
     LogPrint(BCLog::BENCH, "  - Flush: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
+    compaction_pause.reset();
     // Write the chain state to disk, if necessary.
     if (!FlushStateToDisk(state, FlushStateMode::IF_NEEDED)) {
         return false;
     }
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    Metrics().block_chainstate.Observe(std::chrono::microseconds{nTime5 - nTime4});
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
     if (m_mempool) {
@@ -2748,8 +3151,16 @@ bool Chainstate::ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew,
     // Update m_chain & related variables.
     m_chain.SetTip(*pindexNew);
     UpdateTip(pindexNew);
+    // Merkle proofs are mostly asked for recent blocks, and short reorgs
+    // disconnect them again.
+    if (!IsInitialBlockDownload()) {
+        m_blockman.CacheBlockTxids(blockConnecting);
+        m_blockman.CacheRecentBlock(pthisBlock);
+    }
 
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
+    Metrics().block_postprocess.Observe(std::chrono::microseconds{nTime6 - nTime5});
+    Metrics().block_total.Observe(std::chrono::microseconds{nTime6 - nTime1});
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
 
@@ -2819,6 +3230,17 @@ CBlockIndex* Chainstate::FindMostWorkChain()
     } while(true);
 }
 
+void Chainstate::TryAddBlockIndexCandidate(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+    if (m_chain.Tip() != nullptr && setBlockIndexCandidates.value_comp()(pindex, m_chain.Tip())) return;
+    if (!reliesOnAssumedValid() && m_chainman.IsSnapshotActive()) {
+        const CBlockIndex* snapshot_base{m_chainman.GetSnapshotBaseBlock()};
+        if (!snapshot_base || snapshot_base->GetAncestor(pindex->nHeight) != pindex) return;
+    }
+    setBlockIndexCandidates.insert(pindex);
+}
+
 /** Delete all entries in setBlockIndexCandidates that are worse than the current tip. */
 void Chainstate::PruneBlockIndexCandidates() {
     // Note that we can't delete the current block itself, as we may need to return to it later in case a
@@ -2882,7 +3304,9 @@ bool Chainstate::ActivateBestChainStep(BlockValidationState& state, CBlockIndex*
 
         // Connect new blocks.
         for (CBlockIndex* pindexConnect : reverse_iterate(vpindexToConnect)) {
-            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool)) {
+            const CBlockIndex* pindexNext{pindexConnect == pindexMostWork ? nullptr : pindexMostWork->GetAncestor(pindexConnect->nHeight + 1)};
+            if (!ConnectTip(state, pindexConnect, pindexConnect == pindexMostWork ? pblock : std::shared_ptr<const CBlock>(), connectTrace, disconnectpool,
+                            pindexNext, pindexNext == pindexMostWork ? pblock : std::shared_ptr<const CBlock>())) {
                 if (state.IsInvalid()) {
                     // The block violates a consensus rule.
                     if (state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
@@ -2977,7 +3401,7 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
 
     CBlockIndex *pindexMostWork = nullptr;
     CBlockIndex *pindexNewTip = nullptr;
-    int nStopAtHeight = gArgs.GetIntArg("-stopatheight", DEFAULT_STOPATHEIGHT);
+    const int nStopAtHeight{m_chainman.m_options.stop_at_height};
     do {
         // Block until the validation queue drains. This should largely
         // never happen in normal operation, however may happen during
@@ -3021,6 +3445,9 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
                 }
                 pindexNewTip = m_chain.Tip();
 
+                // The blocks of the background chainstate of a snapshot are
+                // already known to listeners through the snapshot chainstate
+                if (this != &m_chainman.ActiveChainstate()) continue;
                 for (const PerBlockConnectTrace& trace : connectTrace.GetBlocksConnected()) {
                     assert(trace.pblock && trace.pindex);
                     GetMainSignals().BlockConnected(trace.pblock, trace.pindex);
@@ -3033,7 +3460,7 @@ bool Chainstate::ActivateBestChain(BlockValidationState& state, std::shared_ptr<
 
             // Notify external listeners about the new tip.
             // Enqueue while holding cs_main to ensure that UpdatedBlockTip is called in the order in which blocks are connected
-            if (pindexFork != pindexNewTip) {
+            if (pindexFork != pindexNewTip && this == &m_chainman.ActiveChainstate()) {
                 // Notify ValidationInterface subscribers
                 GetMainSignals().UpdatedBlockTip(pindexNewTip, pindexFork, fInitialDownload);
 
@@ -3294,8 +3721,8 @@ void Chainstate::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pin
             queue.pop_front();
             pindex->nChainTx = (pindex->pprev ? pindex->pprev->nChainTx : 0) + pindex->nTx;
             pindex->nSequenceId = nBlockSequenceId++;
-            if (m_chain.Tip() == nullptr || !setBlockIndexCandidates.value_comp()(pindex, m_chain.Tip())) {
-                setBlockIndexCandidates.insert(pindex);
+            for (Chainstate* chainstate : m_chainman.GetAll()) {
+                chainstate->TryAddBlockIndexCandidate(pindex);
             }
             std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = m_blockman.m_blocks_unlinked.equal_range(pindex);
             while (range.first != range.second) {
@@ -3315,7 +3742,7 @@ void Chainstate::ReceivedBlockTransactions(const CBlock& block, CBlockIndex* pin
 static bool CheckBlockHeader(const CBlockHeader& block, BlockValidationState& state, const Consensus::Params& consensusParams, bool fCheckPOW = true)
 {
     // Check proof of work matches claimed amount
-    if (fCheckPOW && !CheckProofOfWork(block.GetPoWHash(), block.nBits, consensusParams))
+    if (fCheckPOW && !CheckProofOfWork(GetPoWHashCached(block), block.nBits, consensusParams))
         return state.Invalid(BlockValidationResult::BLOCK_INVALID_HEADER, "high-hash", "proof of work failed");
 
     return true;
@@ -3371,9 +3798,10 @@ bool CheckBlock(const CBlock& block, BlockValidationState& state, const Consensu
 
     // Check transactions
     // Must check for duplicate inputs (see CVE-2018-17144)
+    std::vector<COutPoint> outpoints_scratch;
     for (const auto& tx : block.vtx) {
         TxValidationState tx_state;
-        if (!CheckTransaction(*tx, tx_state)) {
+        if (!CheckTransaction(*tx, tx_state, outpoints_scratch)) {
             // CheckBlock() does context-free validation checks. The only
             // possible failures are consensus failures.
             assert(tx_state.GetResult() == TxValidationResult::TX_CONSENSUS);
@@ -3434,10 +3862,102 @@ std::vector<unsigned char> ChainstateManager::GenerateCoinbaseCommitment(CBlock&
     return commitment;
 }
 
+bool CPoWCheck::operator()()
+{
+    uint256 pow_hashes[HEADERS_PER_CHECK];
+    assert(m_count <= HEADERS_PER_CHECK);
+    GetPoWHashesCached(m_headers, m_count, pow_hashes);
+    for (size_t i = 0; i < m_count; ++i) {
+        if (!CheckProofOfWork(pow_hashes[i], m_headers[i].nBits, *m_params)) return false;
+    }
+    return true;
+}
+
+bool CBlockCheck::operator()()
+{
+    BlockValidationState state;
+    CheckBlock(*m_block, state, *m_params);
+    return true;
+}
+
+bool CVerifyBlockCheck::operator()()
+{
+    CBlock block;
+    // check level 0: read from disk
+    if (!ReadBlockFromDisk(block, m_index, *m_params)) {
+        *m_error = strprintf("ReadBlockFromDisk failed at %d, hash=%s", m_index->nHeight, m_index->GetBlockHash().ToString());
+        return true;
+    }
+    // check level 1: verify block validity
+    BlockValidationState state;
+    if (m_check_level >= 1 && !CheckBlock(block, state, *m_params)) {
+        *m_error = strprintf("found bad block at %d, hash=%s (%s)", m_index->nHeight, m_index->GetBlockHash().ToString(), state.ToString());
+        return true;
+    }
+    // check level 2: verify undo validity
+    if (m_check_level >= 2 && !WITH_LOCK(cs_main, return m_index->GetUndoPos().IsNull())) {
+        CBlockUndo undo;
+        if (!UndoReadFromDisk(undo, m_index)) {
+            *m_error = strprintf("found bad undo data at %d, hash=%s", m_index->nHeight, m_index->GetBlockHash().ToString());
+        }
+    }
+    return true;
+}
+
+static CCheckQueue<CPoWCheck> powcheckqueue(16);
+//! Every block check hashes a header and a merkle tree, so they are handed out one at a time
+static CCheckQueue<CBlockCheck> blockcheckqueue(1);
+//! The same goes for the checks of VerifyDB, which read the block from disk as well
+static CCheckQueue<CVerifyBlockCheck> verifyblockcheckqueue(1);
+static std::atomic<bool> g_parallel_pow_checks{false};
+
+void StartPoWCheckWorkerThreads(int threads_num)
+{
+    powcheckqueue.StartWorkerThreads(threads_num, "powcheck");
+    blockcheckqueue.StartWorkerThreads(threads_num, "blockcheck");
+    verifyblockcheckqueue.StartWorkerThreads(threads_num, "verifycheck", SyscallSandboxPolicy::INITIALIZATION_LOAD_BLOCKS);
+    g_parallel_pow_checks = threads_num > 0;
+}
+
+void StopPoWCheckWorkerThreads()
+{
+    g_parallel_pow_checks = false;
+    powcheckqueue.StopWorkerThreads();
+    blockcheckqueue.StopWorkerThreads();
+    verifyblockcheckqueue.StopWorkerThreads();
+}
+
 bool HasValidProofOfWork(const std::vector<CBlockHeader>& headers, const Consensus::Params& consensusParams)
 {
-    return std::all_of(headers.cbegin(), headers.cend(),
-            [&](const auto& header) { return CheckProofOfWork(header.GetPoWHash(), header.nBits, consensusParams);});
+    const auto time_start{SteadyClock::now()};
+    std::vector<CPoWCheck> checks;
+    checks.reserve((headers.size() + CPoWCheck::HEADERS_PER_CHECK - 1) / CPoWCheck::HEADERS_PER_CHECK);
+    for (size_t i = 0; i < headers.size(); i += CPoWCheck::HEADERS_PER_CHECK) {
+        const size_t count{std::min(CPoWCheck::HEADERS_PER_CHECK, headers.size() - i)};
+        checks.emplace_back(&headers[i], count, consensusParams);
+    }
+    const size_t num_checks{checks.size()};
+    const bool parallel{g_parallel_pow_checks && num_checks >= 2};
+
+    bool valid;
+    if (!parallel) {
+        valid = std::all_of(checks.begin(), checks.end(), [](auto& check) { return check(); });
+    } else {
+        // Spread the NeoScrypt work over the worker threads. Workers stop hashing
+        // as soon as one of them finds a header with invalid proof of work.
+        CCheckQueueControl<CPoWCheck> control(&powcheckqueue);
+        control.Add(checks);
+        valid = control.Wait();
+    }
+
+    TRACE5(pow, check_headers,
+        (uint64_t)headers.size(),
+        (uint64_t)num_checks,
+        parallel,
+        valid,
+        Ticks<std::chrono::microseconds>(SteadyClock::now() - time_start)
+    );
+    return valid;
 }
 
 arith_uint256 CalculateHeadersWork(const std::vector<CBlockHeader>& headers)
@@ -3610,7 +4130,7 @@ bool ChainstateManager::AcceptBlockHeader(const CBlockHeader& block, BlockValida
             return true;
         }
 
-        if (!CheckBlockHeader(block, state, GetConsensus())) {
+        if (!CheckBlockHeader(block, state, GetConsensus(), m_options.check_pow)) {
             LogPrint(BCLog::VALIDATION, "%s: Consensus::CheckBlockHeader: %s, %s\n", __func__, hash.ToString(), state.ToString());
             return false;
         }
@@ -3788,7 +4308,7 @@ bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockV
         if (pindex->nChainWork < nMinimumChainWork) return true;
     }
 
-    if (!CheckBlock(block, state, m_params.GetConsensus()) ||
+    if (!CheckBlock(block, state, m_params.GetConsensus(), m_chainman.m_options.check_pow) ||
         !ContextualCheckBlock(block, state, m_chainman, pindex->pprev)) {
         if (state.IsInvalid() && state.GetResult() != BlockValidationResult::BLOCK_MUTATED) {
             pindex->nStatus |= BLOCK_FAILED_VALID;
@@ -3819,6 +4339,8 @@ bool Chainstate::AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockV
             return false;
         }
         ReceivedBlockTransactions(block, pindex, blockPos);
+        // A block that loses a race may be connected by a reorg soon after
+        if (!dbp && !IsInitialBlockDownload()) m_blockman.CacheRecentBlock(pblock);
     } catch (const std::runtime_error& e) {
         return AbortNode(state, std::string("System error: ") + e.what());
     }
@@ -3851,7 +4373,7 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         // malleability that cause CheckBlock() to fail; see e.g. CVE-2012-2459 and
         // https://lists.linuxfoundation.org/pipermail/bitcoin-dev/2019-February/016697.html.  Because CheckBlock() is
         // not very expensive, the anti-DoS benefits of caching failure (of a definitely-invalid block) are not substantial.
-        bool ret = CheckBlock(*block, state, GetConsensus());
+        bool ret = CheckBlock(*block, state, GetConsensus(), m_options.check_pow);
         if (ret) {
             // Store to disk
             ret = ActiveChainstate().AcceptBlock(block, state, &pindex, force_processing, nullptr, new_block, min_pow_checked);
@@ -3869,6 +4391,12 @@ bool ChainstateManager::ProcessNewBlock(const std::shared_ptr<const CBlock>& blo
         return error("%s: ActivateBestChain failed (%s)", __func__, state.ToString());
     }
 
+    // Leave blocks for the background chainstate of a snapshot to its own thread
+    if (m_background_validation.joinable() && WITH_LOCK(::cs_main, return BackgroundSyncChainstate() != nullptr)) {
+        WITH_LOCK(m_background_validation_mutex, m_background_validation_pending = true);
+        m_background_validation_cv.notify_one();
+    }
+
     // If responsible for sync-checkpoint send it
     if (!CSyncCheckpoint::strMasterPrivKey.empty())
         SendSyncCheckpoint(AutoSelectSyncCheckpoint(ActiveChain()), g_connman.get(), *this);
@@ -3931,6 +4459,8 @@ void PruneBlockFilesManual(Chainstate& active_chainstate, int nManualPruneHeight
             state, FlushStateMode::NONE, nManualPruneHeight)) {
         LogPrintf("%s: failed to flush state (%s)\n", __func__, state.ToString());
     }
+    // The caller expects the files to be gone
+    active_chainstate.m_blockman.WaitForUnlinks();
 }
 
 void Chainstate::LoadMempool(const fs::path& load_path, FopenFn mockable_fopen_function)
@@ -3940,6 +4470,18 @@ void Chainstate::LoadMempool(const fs::path& load_path, FopenFn mockable_fopen_f
     m_mempool->SetLoadTried(!ShutdownRequested());
 }
 
+bool Chainstate::InitUTXOMuHash()
+{
+    AssertLockHeld(::cs_main);
+    ForceFlushStateToDisk();
+    m_utxo_muhash = CoinsDB().ReadUTXOMuHash();
+    if (m_utxo_muhash) return true;
+
+    LogPrintf("Computing the MuHash of the UTXO set at %s\n", CoinsDB().GetBestBlock().ToString());
+    m_utxo_muhash = kernel::ComputeUTXOSetMuHash(&CoinsDB());
+    return m_utxo_muhash && CoinsDB().WriteUTXOMuHash(CoinsDB().GetBestBlock(), *m_utxo_muhash);
+}
+
 bool Chainstate::LoadChainTip()
 {
     AssertLockHeld(cs_main);
@@ -3957,6 +4499,7 @@ bool Chainstate::LoadChainTip()
         return false;
     }
     m_chain.SetTip(*pindex);
+    if (this == &m_chainman.ActiveChainstate()) m_chainman.PublishTipSnapshot();
     PruneBlockIndexCandidates();
 
     tip = m_chain.Tip();
@@ -3968,9 +4511,10 @@ bool Chainstate::LoadChainTip()
     return true;
 }
 
-CVerifyDB::CVerifyDB()
+CVerifyDB::CVerifyDB(VerifyDBStatus* status) : m_status{status}
 {
     uiInterface.ShowProgress(_("Verifying blocks…").translated, 0, false);
+    if (m_status) m_status->progress = 0;
 }
 
 CVerifyDB::~CVerifyDB()
@@ -3984,68 +4528,110 @@ bool CVerifyDB::VerifyDB(
     CCoinsView& coinsview,
     int nCheckLevel, int nCheckDepth)
 {
-    AssertLockHeld(cs_main);
+    AssertLockNotHeld(cs_main);
 
-    if (chainstate.m_chain.Tip() == nullptr || chainstate.m_chain.Tip()->pprev == nullptr) {
-        return true;
-    }
+    // Collect the blocks to verify in the best chain, from the tip back
+    std::vector<const CBlockIndex*> blocks;
+    {
+        LOCK(cs_main);
+        if (chainstate.m_chain.Tip() == nullptr || chainstate.m_chain.Tip()->pprev == nullptr) {
+            return true;
+        }
 
-    // Verify blocks in the best chain
-    if (nCheckDepth <= 0 || nCheckDepth > chainstate.m_chain.Height()) {
-        nCheckDepth = chainstate.m_chain.Height();
-    }
-    nCheckLevel = std::max(0, std::min(4, nCheckLevel));
-    LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
-    CCoinsViewCache coins(&coinsview);
-    CBlockIndex* pindex;
-    CBlockIndex* pindexFailure = nullptr;
-    int nGoodTransactions = 0;
-    BlockValidationState state;
-    int reportDone = 0;
-    LogPrintf("[0%%]..."); /* Continued */
+        if (nCheckDepth <= 0 || nCheckDepth > chainstate.m_chain.Height()) {
+            nCheckDepth = chainstate.m_chain.Height();
+        }
+        nCheckLevel = std::max(0, std::min(4, nCheckLevel));
+        LogPrintf("Verifying last %i blocks at level %i\n", nCheckDepth, nCheckLevel);
 
-    const bool is_snapshot_cs{!chainstate.m_from_snapshot_blockhash};
+        const bool is_snapshot_cs{!chainstate.m_from_snapshot_blockhash};
 
-    for (pindex = chainstate.m_chain.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
-        const int percentageDone = std::max(1, std::min(99, (int)(((double)(chainstate.m_chain.Height() - pindex->nHeight)) / (double)nCheckDepth * (nCheckLevel >= 4 ? 50 : 100))));
+        for (const CBlockIndex* pindex = chainstate.m_chain.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
+            if (pindex->nHeight <= chainstate.m_chain.Height() - nCheckDepth) {
+                break;
+            }
+            if ((fPruneMode || is_snapshot_cs) && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
+                // If pruning or running under an assumeutxo snapshot, only go
+                // back as far as we have data.
+                LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+                break;
+            }
+            blocks.push_back(pindex);
+        }
+    }
+
+    // Every block is checked once for levels 0 to 2, and once more for each of levels 3 and 4
+    const size_t total_steps{std::max<size_t>(1, blocks.size() * (nCheckLevel >= 4 ? 3 : nCheckLevel >= 3 ? 2 : 1))};
+    int reportDone = 0;
+    const auto report_progress{[&](size_t steps_done) {
+        const int percentageDone = std::max(1, std::min(99, (int)(steps_done * 100 / total_steps)));
         if (reportDone < percentageDone / 10) {
             // report every 10% step
             LogPrintf("[%d%%]...", percentageDone); /* Continued */
             reportDone = percentageDone / 10;
         }
         uiInterface.ShowProgress(_("Verifying blocks…").translated, percentageDone, false);
-        if (pindex->nHeight <= chainstate.m_chain.Height() - nCheckDepth) {
-            break;
-        }
-        if ((fPruneMode || is_snapshot_cs) && !(pindex->nStatus & BLOCK_HAVE_DATA)) {
-            // If pruning or running under an assumeutxo snapshot, only go
-            // back as far as we have data.
-            LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
-            break;
-        }
-        CBlock block;
-        // check level 0: read from disk
-        if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
-            return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-        }
-        // check level 1: verify block validity
-        if (nCheckLevel >= 1 && !CheckBlock(block, state, consensus_params)) {
-            return error("%s: *** found bad block at %d, hash=%s (%s)\n", __func__,
-                         pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString());
-        }
-        // check level 2: verify undo validity
-        if (nCheckLevel >= 2 && pindex) {
-            CBlockUndo undo;
-            if (!pindex->GetUndoPos().IsNull()) {
-                if (!UndoReadFromDisk(undo, pindex)) {
-                    return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
-                }
+        if (m_status) m_status->progress = percentageDone;
+    }};
+    LogPrintf("[0%%]..."); /* Continued */
+
+    // check levels 0 to 2: read the blocks and their undo data from disk and
+    // verify the blocks, in batches spread over the worker threads
+    std::vector<std::string> errors(blocks.size());
+    size_t num_checked{0};
+    while (num_checked < blocks.size()) {
+        const size_t end{std::min(blocks.size(), num_checked + VERIFYDB_CHECK_BATCH_SIZE)};
+        std::vector<CVerifyBlockCheck> checks;
+        checks.reserve(end - num_checked);
+        for (size_t i = num_checked; i < end; ++i) {
+            checks.emplace_back(*blocks[i], consensus_params, nCheckLevel, errors[i]);
+        }
+        if (g_parallel_pow_checks && checks.size() >= 2) {
+            CCheckQueueControl<CVerifyBlockCheck> control(&verifyblockcheckqueue);
+            control.Add(checks);
+            control.Wait();
+        } else {
+            for (CVerifyBlockCheck& check : checks) check();
+        }
+        for (; num_checked < end; ++num_checked) {
+            if (errors[num_checked].empty()) continue;
+            const CBlockIndex* pindex{blocks[num_checked]};
+            if (fPruneMode && WITH_LOCK(cs_main, return !(pindex->nStatus & BLOCK_HAVE_DATA))) {
+                // Pruned while it was being read
+                LogPrintf("VerifyDB(): block verification stopping at height %d (pruning, no data)\n", pindex->nHeight);
+                blocks.resize(num_checked);
+                break;
             }
+            return error("VerifyDB(): *** %s", errors[num_checked]);
         }
+        report_progress(num_checked);
+        if (ShutdownRequested()) return true;
+    }
+
+    int nGoodTransactions = 0;
+    if (nCheckLevel >= 3) {
+        LOCK(cs_main);
+        // The chain may have moved on since the blocks were collected: as
+        // many blocks as were checked above are disconnected from the tip
+        // it has now, which the coins must be consistent with.
+        CCoinsViewCache coins(&coinsview);
+        CBlockIndex* pindex;
+        CBlockIndex* pindexFailure = nullptr;
+        BlockValidationState state;
+        const int tip_height{chainstate.m_chain.Height()};
+
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
-        size_t curr_coins_usage = coins.DynamicMemoryUsage() + chainstate.CoinsTip().DynamicMemoryUsage();
+        for (pindex = chainstate.m_chain.Tip(); pindex && pindex->pprev; pindex = pindex->pprev) {
+            const size_t num_disconnected = tip_height - pindex->nHeight;
+            if (num_disconnected >= blocks.size()) break;
+            report_progress(blocks.size() + num_disconnected);
+            size_t curr_coins_usage = coins.DynamicMemoryUsage() + chainstate.CoinsTip().DynamicMemoryUsage();
+            if (curr_coins_usage > chainstate.m_coinstip_cache_size_bytes) break;
 
-        if (nCheckLevel >= 3 && curr_coins_usage <= chainstate.m_coinstip_cache_size_bytes) {
+            CBlock block;
+            if (!ReadBlockFromDisk(block, pindex, consensus_params)) {
+                return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+            }
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
             DisconnectResult res = chainstate.DisconnectBlock(block, pindex, coins);
             if (res == DISCONNECT_FAILED) {
@@ -4057,39 +4643,31 @@ bool CVerifyDB::VerifyDB(
             } else {
                 nGoodTransactions += block.vtx.size();
             }
+            if (ShutdownRequested()) return true;
         }
-        if (ShutdownRequested()) return true;
-    }
-    if (pindexFailure) {
-        return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", chainstate.m_chain.Height() - pindexFailure->nHeight + 1, nGoodTransactions);
-    }
-
-    // store block count as we move pindex at check level >= 4
-    int block_count = chainstate.m_chain.Height() - pindex->nHeight;
-
-    // check level 4: try reconnecting blocks
-    if (nCheckLevel >= 4) {
-        while (pindex != chainstate.m_chain.Tip()) {
-            const int percentageDone = std::max(1, std::min(99, 100 - (int)(((double)(chainstate.m_chain.Height() - pindex->nHeight)) / (double)nCheckDepth * 50)));
-            if (reportDone < percentageDone / 10) {
-                // report every 10% step
-                LogPrintf("[%d%%]...", percentageDone); /* Continued */
-                reportDone = percentageDone / 10;
-            }
-            uiInterface.ShowProgress(_("Verifying blocks…").translated, percentageDone, false);
-            pindex = chainstate.m_chain.Next(pindex);
-            CBlock block;
-            if (!ReadBlockFromDisk(block, pindex, consensus_params))
-                return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!chainstate.ConnectBlock(block, state, pindex, coins)) {
-                return error("VerifyDB(): *** found unconnectable block at %d, hash=%s (%s)", pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString());
+        if (pindexFailure) {
+            return error("VerifyDB(): *** coin database inconsistencies found (last %i blocks, %i good transactions before that)\n", tip_height - pindexFailure->nHeight + 1, nGoodTransactions);
+        }
+
+        // check level 4: try reconnecting blocks
+        if (nCheckLevel >= 4) {
+            const int first_height{pindex->nHeight};
+            while (pindex != chainstate.m_chain.Tip()) {
+                report_progress(2 * blocks.size() + pindex->nHeight - first_height);
+                pindex = chainstate.m_chain.Next(pindex);
+                CBlock block;
+                if (!ReadBlockFromDisk(block, pindex, consensus_params))
+                    return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
+                if (!chainstate.ConnectBlock(block, state, pindex, coins)) {
+                    return error("VerifyDB(): *** found unconnectable block at %d, hash=%s (%s)", pindex->nHeight, pindex->GetBlockHash().ToString(), state.ToString());
+                }
+                if (ShutdownRequested()) return true;
             }
-            if (ShutdownRequested()) return true;
         }
     }
 
     LogPrintf("[DONE].\n");
-    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", block_count, nGoodTransactions);
+    LogPrintf("No coin database inconsistencies in last %i blocks (%i transactions)\n", blocks.size(), nGoodTransactions);
 
     return true;
 }
@@ -4326,6 +4904,11 @@ bool Chainstate::LoadGenesisBlock()
     return true;
 }
 
+/** Blocks read from a file during -reindex or -loadblock are checked in batches of at most this many blocks... */
+static constexpr size_t MAX_IMPORT_BATCH_BLOCKS{64};
+/** ...or of about this many bytes */
+static constexpr size_t MAX_IMPORT_BATCH_BYTES{16 << 20};
+
 void Chainstate::LoadExternalBlockFile(
     FILE* fileIn,
     FlatFilePos* dbp,
@@ -4338,45 +4921,87 @@ void Chainstate::LoadExternalBlockFile(
 
     const auto start{SteadyClock::now()};
 
+    //! A block read from the file, and where it was found
+    struct ImportedBlock {
+        std::shared_ptr<CBlock> block;
+        FlatFilePos pos;
+    };
+
     int nLoaded = 0;
     try {
         // This takes over fileIn and calls fclose() on it in the CBufferedFile destructor
         CBufferedFile blkdat(fileIn, 2*MAX_BLOCK_SERIALIZED_SIZE, MAX_BLOCK_SERIALIZED_SIZE+8, SER_DISK, CLIENT_VERSION);
         uint64_t nRewind = blkdat.GetPos();
-        while (!blkdat.eof()) {
-            if (ShutdownRequested()) return;
+        bool end_of_file{false};
+        bool shutdown{false};
+
+        // Read the next blocks from the file
+        const auto read_batch = [&](std::vector<ImportedBlock>& batch) {
+            batch.clear();
+            size_t batch_bytes{0};
+            while (!end_of_file && !blkdat.eof() && batch.size() < MAX_IMPORT_BATCH_BLOCKS && batch_bytes < MAX_IMPORT_BATCH_BYTES) {
+                if (ShutdownRequested()) {
+                    shutdown = true;
+                    return;
+                }
 
-            blkdat.SetPos(nRewind);
-            nRewind++; // start one byte further next time, in case of failure
-            blkdat.SetLimit(); // remove former limit
-            unsigned int nSize = 0;
-            try {
-                // locate a header
-                unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
-                blkdat.FindByte(m_params.MessageStart()[0]);
-                nRewind = blkdat.GetPos() + 1;
-                blkdat >> buf;
-                if (memcmp(buf, m_params.MessageStart(), CMessageHeader::MESSAGE_START_SIZE)) {
-                    continue;
+                blkdat.SetPos(nRewind);
+                nRewind++; // start one byte further next time, in case of failure
+                blkdat.SetLimit(); // remove former limit
+                unsigned int nSize = 0;
+                bool compressed{false};
+                try {
+                    // locate a header
+                    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+                    blkdat.FindByte(m_params.MessageStart()[0]);
+                    nRewind = blkdat.GetPos() + 1;
+                    blkdat >> buf;
+                    compressed = node::IsCompressedBlockRecord(buf, m_params.MessageStart());
+                    if (!compressed && memcmp(buf, m_params.MessageStart(), CMessageHeader::MESSAGE_START_SIZE)) {
+                        continue;
+                    }
+                    // read size
+                    blkdat >> nSize;
+                    if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
+                        continue;
+                } catch (const std::exception&) {
+                    // no valid block header found; don't complain
+                    end_of_file = true;
+                    break;
+                }
+                try {
+                    // read block
+                    uint64_t nBlockPos = blkdat.GetPos();
+                    FlatFilePos pos;
+                    if (dbp) {
+                        pos = FlatFilePos{dbp->nFile, static_cast<unsigned int>(nBlockPos)};
+                    }
+                    blkdat.SetLimit(nBlockPos + nSize);
+                    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                    CBlock& block = *pblock;
+                    if (compressed) {
+                        std::vector<unsigned char> record(nSize);
+                        blkdat.read(MakeWritableByteSpan(record));
+                        SpanReader{SER_DISK, CLIENT_VERSION, record} >> Using<CompressedBlockFormatter>(block);
+                    } else {
+                        blkdat >> block;
+                    }
+                    nRewind = blkdat.GetPos();
+                    batch.push_back({std::move(pblock), pos});
+                    batch_bytes += nSize;
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
                 }
-                // read size
-                blkdat >> nSize;
-                if (nSize < 80 || nSize > MAX_BLOCK_SERIALIZED_SIZE)
-                    continue;
-            } catch (const std::exception&) {
-                // no valid block header found; don't complain
-                break;
             }
+        };
+
+        // Accept a block read from the file, and any blocks found earlier that
+        // are now connectable. Return false if the import should stop.
+        const auto accept_block = [&](ImportedBlock& imported) {
             try {
-                // read block
-                uint64_t nBlockPos = blkdat.GetPos();
-                if (dbp)
-                    dbp->nPos = nBlockPos;
-                blkdat.SetLimit(nBlockPos + nSize);
-                std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>();
+                const std::shared_ptr<CBlock>& pblock{imported.block};
                 CBlock& block = *pblock;
-                blkdat >> block;
-                nRewind = blkdat.GetPos();
+                FlatFilePos* const block_pos{dbp ? &imported.pos : nullptr};
 
                 uint256 hash = block.GetHash();
                 {
@@ -4386,20 +5011,20 @@ void Chainstate::LoadExternalBlockFile(
                         LogPrint(BCLog::REINDEX, "%s: Out of order block %s, parent %s not known\n", __func__, hash.ToString(),
                                 block.hashPrevBlock.ToString());
                         if (dbp && blocks_with_unknown_parent) {
-                            blocks_with_unknown_parent->emplace(block.hashPrevBlock, *dbp);
+                            blocks_with_unknown_parent->emplace(block.hashPrevBlock, imported.pos);
                         }
-                        continue;
+                        return true;
                     }
 
                     // process in case the block isn't known yet
                     const CBlockIndex* pindex = m_blockman.LookupBlockIndex(hash);
                     if (!pindex || (pindex->nStatus & BLOCK_HAVE_DATA) == 0) {
                       BlockValidationState state;
-                      if (AcceptBlock(pblock, state, nullptr, true, dbp, nullptr, true)) {
+                      if (AcceptBlock(pblock, state, nullptr, true, block_pos, nullptr, true)) {
                           nLoaded++;
                       }
                       if (state.IsError()) {
-                          break;
+                          return false;
                       }
                     } else if (hash != m_params.GetConsensus().hashGenesisBlock && pindex->nHeight % 1000 == 0) {
                         LogPrint(BCLog::REINDEX, "Block Import: already had block %s at height %d\n", hash.ToString(), pindex->nHeight);
@@ -4410,13 +5035,13 @@ void Chainstate::LoadExternalBlockFile(
                 if (hash == m_params.GetConsensus().hashGenesisBlock) {
                     BlockValidationState state;
                     if (!ActivateBestChain(state, nullptr)) {
-                        break;
+                        return false;
                     }
                 }
 
                 NotifyHeaderTip(*this);
 
-                if (!blocks_with_unknown_parent) continue;
+                if (!blocks_with_unknown_parent) return true;
 
                 // Recursively process earlier encountered successors of this block
                 std::deque<uint256> queue;
@@ -4446,7 +5071,48 @@ void Chainstate::LoadExternalBlockFile(
             } catch (const std::exception& e) {
                 LogPrintf("%s: Deserialize or I/O error - %s\n", __func__, e.what());
             }
+            return true;
+        };
+
+        // Blocks are read, checked and accepted in a pipeline: while one batch
+        // is accepted in file order on this thread, the proof of work and
+        // merkle roots of the next one are verified by the worker threads.
+        std::vector<ImportedBlock> batch, next;
+        std::optional<CCheckQueueControl<CBlockCheck>> control;
+        const auto check_batch = [&](const std::vector<ImportedBlock>& blocks) {
+            if (!g_parallel_pow_checks || blocks.size() < 2) return;
+            std::vector<CBlockCheck> checks;
+            checks.reserve(blocks.size());
+            for (const ImportedBlock& imported : blocks) {
+                checks.emplace_back(*imported.block, m_params.GetConsensus());
+            }
+            control.emplace(&blockcheckqueue);
+            control->Add(checks);
+        };
+
+        read_batch(batch);
+        check_batch(batch);
+        while (!batch.empty()) {
+            read_batch(next);
+            // Wait for the checks of batch
+            control.reset();
+            if (shutdown) return;
+            check_batch(next);
+            bool stop{false};
+            for (ImportedBlock& imported : batch) {
+                if (!accept_block(imported)) {
+                    stop = true;
+                    break;
+                }
+            }
+            if (stop) {
+                // The checks of next must not outlive its blocks
+                control.reset();
+                break;
+            }
+            std::swap(batch, next);
         }
+        if (shutdown) return;
     } catch (const std::runtime_error& e) {
         AbortNode(std::string("System error: ") + e.what());
     }
@@ -4870,6 +5536,7 @@ bool ChainstateManager::ActivateSnapshot(
         assert(chaintip_loaded);
 
         m_active_chainstate = m_snapshot_chainstate.get();
+        PublishTipSnapshot();
 
         LogPrintf("[snapshot] successfully activated snapshot %s\n", base_blockhash.ToString());
         LogPrintf("[snapshot] (%.2f MB)\n",
@@ -4905,7 +5572,7 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     CBlockIndex* snapshot_start_block = WITH_LOCK(::cs_main, return m_blockman.LookupBlockIndex(base_blockhash));
 
     if (!snapshot_start_block) {
-        // Needed for ComputeUTXOStats and ExpectedAssumeutxo to determine the
+        // Needed for ExpectedAssumeutxo to determine the
         // height and to avoid a crash when base_blockhash.IsNull()
         LogPrintf("[snapshot] Did not find snapshot start blockheader %s\n",
                   base_blockhash.ToString());
@@ -4924,65 +5591,105 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     const AssumeutxoData& au_data = *maybe_au_data;
 
     COutPoint outpoint;
-    Coin coin;
     const uint64_t coins_count = metadata.m_coins_count;
     uint64_t coins_left = metadata.m_coins_count;
 
     LogPrintf("[snapshot] loading coins from snapshot %s\n", base_blockhash.ToString());
     int64_t coins_processed{0};
 
+    // The snapshot is written in database order, so its hash can be computed
+    // from the file instead of reading the coins back after they are loaded.
+    // Each read chunk is hashed on a separate thread while it is added to the
+    // cache and the next chunk is read.
+    SerializedUTXOHasher hasher{base_blockhash};
+    std::vector<SnapshotChunkInfo> chunk_infos;
+    uint64_t offset{::GetSerializeSize(metadata, CLIENT_VERSION)};
+    std::vector<unsigned char> chunk_data;
+    SnapshotCoins chunk;
+    SnapshotCoins hashing_chunk;
+    std::future<bool> hashed_chunk;
+    const auto wait_for_hash = [&] {
+        if (hashed_chunk.valid() && !hashed_chunk.get()) {
+            LogPrintf("[snapshot] bad snapshot - duplicate coin\n");
+            return false;
+        }
+        return true;
+    };
+
     while (coins_left > 0) {
+        SnapshotChunkInfo info;
+        info.m_offset = offset;
         try {
-            coins_file >> outpoint;
-            coins_file >> coin;
+            coins_file >> info.m_coins_count >> chunk_data >> info.m_hash;
         } catch (const std::ios_base::failure&) {
             LogPrintf("[snapshot] bad snapshot format or truncated snapshot after deserializing %d coins\n",
                       coins_count - coins_left);
             return false;
         }
-        if (coin.nHeight > base_height ||
-            outpoint.n >= std::numeric_limits<decltype(outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
-        ) {
-            LogPrintf("[snapshot] bad snapshot data after deserializing %d coins\n",
+        if (info.m_coins_count == 0 || info.m_coins_count > coins_left ||
+            Hash(chunk_data) != info.m_hash ||
+            !DeserializeSnapshotChunk(chunk_data, info.m_coins_count, chunk)) {
+            LogPrintf("[snapshot] bad snapshot chunk after deserializing %d coins\n",
                       coins_count - coins_left);
             return false;
         }
+        for (const auto& [chunk_outpoint, chunk_coin] : chunk) {
+            if (chunk_coin.nHeight > base_height ||
+                chunk_outpoint.n >= std::numeric_limits<decltype(chunk_outpoint.n)>::max() // Avoid integer wrap-around in coinstats.cpp:ApplyHash
+            ) {
+                LogPrintf("[snapshot] bad snapshot data after deserializing %d coins\n",
+                          coins_count - coins_left);
+                return false;
+            }
+        }
+        coins_left -= info.m_coins_count;
+        offset += GetSnapshotChunkSize(chunk_data.size());
+        chunk_infos.push_back(info);
+
+        if (!wait_for_hash()) return false;
+        hashing_chunk.swap(chunk);
+        chunk.clear();
+        hashed_chunk = std::async(std::launch::async, [&hasher, &hashing_chunk] {
+            for (const auto& [chunk_outpoint, chunk_coin] : hashing_chunk) {
+                if (!hasher.Add(chunk_outpoint, chunk_coin)) return false;
+            }
+            return true;
+        });
 
-        coins_cache.EmplaceCoinInternalDANGER(std::move(outpoint), std::move(coin));
+        // The coins are copied, since the hashing thread is still reading them.
+        for (const auto& [chunk_outpoint, chunk_coin] : hashing_chunk) {
+            coins_cache.EmplaceCoinInternalDANGER(COutPoint{chunk_outpoint}, Coin{chunk_coin});
 
-        --coins_left;
-        ++coins_processed;
+            ++coins_processed;
 
-        if (coins_processed % 1000000 == 0) {
-            LogPrintf("[snapshot] %d coins loaded (%.2f%%, %.2f MB)\n",
-                coins_processed,
-                static_cast<float>(coins_processed) * 100 / static_cast<float>(coins_count),
-                coins_cache.DynamicMemoryUsage() / (1000 * 1000));
+            if (coins_processed % 1000000 == 0) {
+                LogPrintf("[snapshot] %d coins loaded (%.2f%%, %.2f MB)\n",
+                    coins_processed,
+                    static_cast<float>(coins_processed) * 100 / static_cast<float>(coins_count),
+                    coins_cache.DynamicMemoryUsage() / (1000 * 1000));
+            }
         }
 
-        // Batch write and flush (if we need to) every so often.
-        //
-        // If our average Coin size is roughly 41 bytes, checking every 120,000 coins
+        // Batch write and flush (if we need to) after every chunk, which
         // means <5MB of memory imprecision.
-        if (coins_processed % 120000 == 0) {
-            if (ShutdownRequested()) {
-                return false;
-            }
+        if (ShutdownRequested()) {
+            return false;
+        }
 
-            const auto snapshot_cache_state = WITH_LOCK(::cs_main,
-                return snapshot_chainstate.GetCoinsCacheSizeState());
+        const auto snapshot_cache_state = WITH_LOCK(::cs_main,
+            return snapshot_chainstate.GetCoinsCacheSizeState());
 
-            if (snapshot_cache_state >= CoinsCacheSizeState::CRITICAL) {
-                // This is a hack - we don't know what the actual best block is, but that
-                // doesn't matter for the purposes of flushing the cache here. We'll set this
-                // to its correct value (`base_blockhash`) below after the coins are loaded.
-                coins_cache.SetBestBlock(GetRandHash());
+        if (snapshot_cache_state >= CoinsCacheSizeState::CRITICAL) {
+            // This is a hack - we don't know what the actual best block is, but that
+            // doesn't matter for the purposes of flushing the cache here. We'll set this
+            // to its correct value (`base_blockhash`) below after the coins are loaded.
+            coins_cache.SetBestBlock(GetRandHash());
 
-                // No need to acquire cs_main since this chainstate isn't being used yet.
-                FlushSnapshotToDisk(coins_cache, /*snapshot_loaded=*/false);
-            }
+            // No need to acquire cs_main since this chainstate isn't being used yet.
+            FlushSnapshotToDisk(coins_cache, /*snapshot_loaded=*/false);
         }
     }
+    if (!wait_for_hash()) return false;
 
     // Important that we set this. This and the coins_cache accesses above are
     // sort of a layer violation, but either we reach into the innards of
@@ -4991,6 +5698,19 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
     // method.
     coins_cache.SetBestBlock(base_blockhash);
 
+    std::vector<SnapshotChunkInfo> chunk_index;
+    uint64_t index_offset;
+    try {
+        coins_file >> chunk_index >> index_offset;
+    } catch (const std::ios_base::failure&) {
+        LogPrintf("[snapshot] bad snapshot - missing chunk index\n");
+        return false;
+    }
+    if (chunk_index != chunk_infos || index_offset != offset) {
+        LogPrintf("[snapshot] bad snapshot - chunk index does not match the chunks\n");
+        return false;
+    }
+
     bool out_of_coins{false};
     try {
         coins_file >> outpoint;
@@ -5004,6 +5724,14 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
         return false;
     }
 
+    // Assert that the deserialized chainstate contents match the expected assumeutxo value.
+    const uint256 hash_serialized{hasher.Finalize()};
+    if (AssumeutxoHash{hash_serialized} != au_data.hash_serialized) {
+        LogPrintf("[snapshot] bad snapshot content hash: expected %s, got %s\n",
+            au_data.hash_serialized.ToString(), hash_serialized.ToString());
+        return false;
+    }
+
     LogPrintf("[snapshot] loaded %d (%.2f MB) coins from snapshot %s\n",
         coins_count,
         coins_cache.DynamicMemoryUsage() / (1000 * 1000),
@@ -5014,25 +5742,6 @@ bool ChainstateManager::PopulateAndValidateSnapshot(
 
     assert(coins_cache.GetBestBlock() == base_blockhash);
 
-    auto breakpoint_fnc = [] { /* TODO insert breakpoint here? */ };
-
-    // As above, okay to immediately release cs_main here since no other context knows
-    // about the snapshot_chainstate.
-    CCoinsViewDB* snapshot_coinsdb = WITH_LOCK(::cs_main, return &snapshot_chainstate.CoinsDB());
-
-    const std::optional<CCoinsStats> maybe_stats = ComputeUTXOStats(CoinStatsHashType::HASH_SERIALIZED, snapshot_coinsdb, m_blockman, breakpoint_fnc);
-    if (!maybe_stats.has_value()) {
-        LogPrintf("[snapshot] failed to generate coins stats\n");
-        return false;
-    }
-
-    // Assert that the deserialized chainstate contents match the expected assumeutxo value.
-    if (AssumeutxoHash{maybe_stats->hashSerialized} != au_data.hash_serialized) {
-        LogPrintf("[snapshot] bad snapshot content hash: expected %s, got %s\n",
-            au_data.hash_serialized.ToString(), maybe_stats->hashSerialized.ToString());
-        return false;
-    }
-
     snapshot_chainstate.m_chain.SetTip(*snapshot_start_block);
 
     // The remainder of this function requires modifying data protected by cs_main.
@@ -5119,10 +5828,11 @@ void ChainstateManager::MaybeRebalanceCaches()
         //
         // Note: shrink caches first so that we don't inadvertently overwhelm available memory.
         if (m_snapshot_chainstate->IsInitialBlockDownload()) {
+            const double background_share{m_options.background_cache_percent / 100.0};
             m_ibd_chainstate->ResizeCoinsCaches(
-                m_total_coinstip_cache * 0.05, m_total_coinsdb_cache * 0.05);
+                m_total_coinstip_cache * background_share, m_total_coinsdb_cache * background_share);
             m_snapshot_chainstate->ResizeCoinsCaches(
-                m_total_coinstip_cache * 0.95, m_total_coinsdb_cache * 0.95);
+                m_total_coinstip_cache * (1 - background_share), m_total_coinsdb_cache * (1 - background_share));
         } else {
             m_snapshot_chainstate->ResizeCoinsCaches(
                 m_total_coinstip_cache * 0.05, m_total_coinsdb_cache * 0.05);
@@ -5132,8 +5842,97 @@ void ChainstateManager::MaybeRebalanceCaches()
     }
 }
 
+void ChainstateManager::PublishTipSnapshot()
+{
+    AssertLockHeld(::cs_main);
+    const CBlockIndex* tip{ActiveTip()};
+    std::shared_ptr<const ChainTipSnapshot> snapshot;
+    if (tip) {
+        snapshot = std::make_shared<const ChainTipSnapshot>(ChainTipSnapshot{
+            tip, tip->nHeight, tip->GetMedianTimePast(), tip->nChainWork});
+    }
+    std::atomic_store(&m_tip_snapshot, std::move(snapshot));
+}
+
+const CBlockIndex* ChainstateManager::GetSnapshotBaseBlock() const
+{
+    AssertLockHeld(::cs_main);
+    const std::optional<uint256> blockhash{SnapshotBlockhash()};
+    return blockhash ? m_blockman.LookupBlockIndex(*blockhash) : nullptr;
+}
+
+Chainstate* ChainstateManager::BackgroundSyncChainstate() const
+{
+    AssertLockHeld(::cs_main);
+    if (!m_ibd_chainstate || !m_snapshot_chainstate || m_snapshot_validated) return nullptr;
+    const CBlockIndex* snapshot_base{GetSnapshotBaseBlock()};
+    if (!snapshot_base || m_ibd_chainstate->m_chain.Contains(snapshot_base)) return nullptr;
+    return m_ibd_chainstate.get();
+}
+
+std::optional<std::chrono::seconds> ChainstateManager::BackgroundSyncETA() const
+{
+    AssertLockHeld(::cs_main);
+    const Chainstate* background{BackgroundSyncChainstate()};
+    if (!background || !m_background_sync_start) return std::nullopt;
+    const auto& [start_time, start_height] = *m_background_sync_start;
+    const int done{background->m_chain.Height() - start_height};
+    if (done <= 0) return std::nullopt;
+    const int left{GetSnapshotBaseBlock()->nHeight - background->m_chain.Height()};
+    return std::chrono::duration_cast<std::chrono::seconds>((SteadyClock::now() - start_time) * left / done);
+}
+
+void ChainstateManager::StartBackgroundValidation()
+{
+    assert(!m_background_validation.joinable());
+    {
+        LOCK(m_background_validation_mutex);
+        m_background_validation_stop = false;
+        // The background chainstate may already have blocks to connect
+        m_background_validation_pending = true;
+    }
+    m_background_validation = std::thread(&util::TraceThread, "bgvalid", [this] { BackgroundValidationThread(); });
+}
+
+void ChainstateManager::StopBackgroundValidation()
+{
+    WITH_LOCK(m_background_validation_mutex, m_background_validation_stop = true);
+    m_background_validation_cv.notify_all();
+    if (m_background_validation.joinable()) m_background_validation.join();
+}
+
+void ChainstateManager::BackgroundValidationThread()
+{
+    // Leave the cores to the active chainstate where the scheduler allows it
+    ScheduleBatchPriority();
+    while (true) {
+        {
+            WAIT_LOCK(m_background_validation_mutex, lock);
+            m_background_validation_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_background_validation_mutex) {
+                return m_background_validation_pending || m_background_validation_stop;
+            });
+            if (m_background_validation_stop) return;
+            m_background_validation_pending = false;
+        }
+        Chainstate* background;
+        {
+            LOCK(::cs_main);
+            background = BackgroundSyncChainstate();
+            if (background && !m_background_sync_start) {
+                m_background_sync_start.emplace(SteadyClock::now(), background->m_chain.Height());
+            }
+        }
+        if (!background) continue;
+        BlockValidationState state;
+        if (!background->ActivateBestChain(state)) {
+            LogPrintf("[snapshot] background validation failed (%s)\n", state.ToString());
+        }
+    }
+}
+
 ChainstateManager::~ChainstateManager()
 {
+    StopBackgroundValidation();
     LOCK(::cs_main);
 
     m_versionbitscache.Clear();
@@ -15,6 +15,7 @@
 #include <chain.h>
 #include <chainparams.h>
 #include <kernel/chainstatemanager_opts.h>
+#include <kernel/coinstats.h>
 #include <consensus/amount.h>
 #include <deploymentstatus.h>
 #include <fs.h>
@@ -33,6 +34,9 @@
 #include <versionbits.h>
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <map>
 #include <memory>
 #include <optional>
@@ -47,9 +51,18 @@ class Chainstate;
 class CBlockTreeDB;
 class CTxMemPool;
 class ChainstateManager;
+
+/** Immutable view of the tip of the active chain, published on every tip change */
+struct ChainTipSnapshot {
+    const CBlockIndex* tip;
+    int height;
+    int64_t median_time_past;
+    arith_uint256 chain_work;
+};
 struct ChainTxData;
 struct DisconnectedBlockTransactions;
 struct PrecomputedTransactionData;
+class SignatureBatch;
 struct LockPoints;
 struct AssumeutxoData;
 namespace node {
@@ -58,15 +71,30 @@ class SnapshotMetadata;
 namespace Consensus {
 struct Params;
 } // namespace Consensus
+namespace CuckooCache {
+struct Stats;
+} // namespace CuckooCache
 
 /** Maximum number of dedicated script-checking threads allowed */
 static const int MAX_SCRIPTCHECK_THREADS = 15;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Maximum number of dedicated header proof-of-work checking threads allowed */
+static const int MAX_POWCHECK_THREADS = 15;
+/** -powthreads default (number of header proof-of-work checking threads, 0 = auto) */
+static const int DEFAULT_POWCHECK_THREADS = 0;
+/** Maximum number of dedicated block input prefetching threads allowed */
+static const int MAX_PREFETCH_THREADS = 15;
+/** -prefetchthreads default (number of block input prefetching threads, 0 = auto) */
+static const int DEFAULT_PREFETCH_THREADS = 0;
 static const int64_t DEFAULT_MAX_TIP_AGE = 24 * 60 * 60;
 static const bool DEFAULT_CHECKPOINTS_ENABLED = true;
 static const bool DEFAULT_TXINDEX = false;
 static constexpr bool DEFAULT_COINSTATSINDEX{false};
+static constexpr bool DEFAULT_BLOCKSTATSINDEX{false};
+static constexpr bool DEFAULT_ADDRESSINDEX{false};
+static constexpr bool DEFAULT_SPENTINDEX{false};
+static constexpr bool DEFAULT_UTXO_MUHASH{false};
 static const char* const DEFAULT_BLOCKFILTERINDEX = "0";
 /** Default for -stopatheight */
 static const int DEFAULT_STOPATHEIGHT = 0;
@@ -75,6 +103,7 @@ static const unsigned int MIN_BLOCKS_TO_KEEP = 288;
 static const signed int DEFAULT_AUTOCHECKPOINT = 5;
 static const signed int DEFAULT_CHECKBLOCKS = 60;
 static const unsigned int DEFAULT_CHECKLEVEL = 3;
+static const bool DEFAULT_CHECKBLOCKS_BACKGROUND = true;
 // Require that user allocate at least 550 MiB for block & undo files (blk???.dat and rev???.dat)
 // At 1MB per block, 288 blocks = 288MB.
 // Add 15% for Undo data = 331MB
@@ -115,10 +144,32 @@ extern arith_uint256 nMinimumChainWork;
 /** Documentation for argument 'checklevel'. */
 extern const std::vector<std::string> CHECKLEVEL_DOC;
 
+/** Cumulative time spent connecting blocks, per phase, as logged in the bench category. */
+struct ConnectBlockTimings {
+    int64_t blocks{0};
+    //! Microseconds spent fetching and spending the coins of the inputs, and queueing their script checks
+    int64_t connect_inputs_us{0};
+    //! Microseconds spent waiting for the script checks once the inputs were connected
+    int64_t verify_scripts_us{0};
+    //! Microseconds spent flushing the coins cache and writing the chainstate after each block
+    int64_t flush_us{0};
+    //! Microseconds spent connecting blocks to the tip in total
+    int64_t total_us{0};
+};
+ConnectBlockTimings GetConnectBlockTimings() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
 /** Run instances of script checking worker threads */
 void StartScriptCheckWorkerThreads(int threads_num);
 /** Stop all of the script checking worker threads */
 void StopScriptCheckWorkerThreads();
+/** Run instances of header proof-of-work and imported block checking worker threads */
+void StartPoWCheckWorkerThreads(int threads_num);
+/** Stop all of the header proof-of-work and imported block checking worker threads */
+void StopPoWCheckWorkerThreads();
+/** Run instances of block input prefetching worker threads */
+void StartPrefetchWorkerThreads(int threads_num);
+/** Stop all of the block input prefetching worker threads */
+void StopPrefetchWorkerThreads();
 
 CAmount GetBlockSubsidy(int nHeight, const Consensus::Params& consensusParams);
 
@@ -293,6 +344,10 @@ bool CheckSequenceLocksAtTip(CBlockIndex* tip,
  */
 class CScriptCheck
 {
+public:
+    //! Signatures of the checks a CCheckQueue runs together are looked up and verified as one batch
+    using Batch = SignatureBatch;
+
 private:
     CTxOut m_tx_out;
     const CTransaction *ptxTo;
@@ -307,7 +362,8 @@ public:
     CScriptCheck(const CTxOut& outIn, const CTransaction& txToIn, unsigned int nInIn, unsigned int nFlagsIn, bool cacheIn, PrecomputedTransactionData* txdataIn) :
         m_tx_out(outIn), ptxTo(&txToIn), nIn(nInIn), nFlags(nFlagsIn), cacheStore(cacheIn), error(SCRIPT_ERR_UNKNOWN_ERROR), txdata(txdataIn) { }
 
-    bool operator()();
+    /** Verify the script. If batch is not nullptr, the signatures it can defer are added to it instead of being verified. */
+    bool operator()(SignatureBatch* batch = nullptr);
 
     void swap(CScriptCheck& check) noexcept
     {
@@ -323,8 +379,146 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
-/** Initializes the script-execution cache */
-[[nodiscard]] bool InitScriptExecutionCache(size_t max_size_bytes);
+/** Initializes the script-execution cache. If growth_limit_bytes is larger, blocks that miss the cache may grow it up to that size. */
+[[nodiscard]] bool InitScriptExecutionCache(size_t max_size_bytes, size_t growth_limit_bytes = 0);
+
+/** Usage statistics of the script-execution cache */
+CuckooCache::Stats GetScriptExecutionCacheStats() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+/**
+ * Verify the scripts of transactions about to be submitted to the mempool on the
+ * script check worker threads, so that their signatures are cached when they are
+ * accepted one by one. The transactions must be in topological order; inputs are
+ * looked up in the UTXO set, the mempool and the transactions before them.
+ * Failures are ignored: accepting the transaction finds and reports them.
+ */
+void PrevalidateTransactionScripts(Chainstate& active_chainstate, const std::vector<CTransactionRef>& txs) LOCKS_EXCLUDED(cs_main);
+
+/**
+ * Closure representing the proof-of-work check of a run of consecutive
+ * headers, so that the headers of a batch can be NeoScrypt-hashed in parallel
+ * by a CCheckQueue. Each run is hashed with the multi-buffer implementation.
+ * The referenced headers and parameters must outlive the check.
+ */
+class CPoWCheck
+{
+private:
+    const CBlockHeader* m_headers{nullptr};
+    size_t m_count{0};
+    const Consensus::Params* m_params{nullptr};
+
+public:
+    //! Number of headers handed to one check, matching the widest NeoScryptMany() kernel
+    static constexpr size_t HEADERS_PER_CHECK{8};
+
+    CPoWCheck() = default;
+    CPoWCheck(const CBlockHeader* headers, size_t count, const Consensus::Params& params)
+        : m_headers(headers), m_count(count), m_params(&params) {}
+
+    bool operator()();
+
+    void swap(CPoWCheck& check) noexcept
+    {
+        std::swap(m_headers, check.m_headers);
+        std::swap(m_count, check.m_count);
+        std::swap(m_params, check.m_params);
+    }
+};
+
+/**
+ * Closure representing the context-free checks of a block read during
+ * -reindex or -loadblock, so that the proof of work and merkle roots of the
+ * blocks read from a file can be verified in parallel. A block that passes
+ * is marked as checked, so AcceptBlock does not check it again; a failure is
+ * left to AcceptBlock to report. The block and parameters must outlive the
+ * check.
+ */
+class CBlockCheck
+{
+private:
+    const CBlock* m_block{nullptr};
+    const Consensus::Params* m_params{nullptr};
+
+public:
+    CBlockCheck() = default;
+    CBlockCheck(const CBlock& block, const Consensus::Params& params)
+        : m_block(&block), m_params(&params) {}
+
+    //! Always succeeds, so that one bad block does not stop the checks of the others.
+    bool operator()();
+
+    void swap(CBlockCheck& check) noexcept
+    {
+        std::swap(m_block, check.m_block);
+        std::swap(m_params, check.m_params);
+    }
+};
+
+/**
+ * Closure representing the checks of levels 0 to 2 of CVerifyDB on one block:
+ * reading it, checking it and reading its undo data, so that the blocks of a
+ * verification can be checked in parallel by a CCheckQueue. A failure is
+ * described in error, for CVerifyDB to report the one closest to the tip. The
+ * block index entry, parameters and error must outlive the check.
+ */
+class CVerifyBlockCheck
+{
+private:
+    const CBlockIndex* m_index{nullptr};
+    const Consensus::Params* m_params{nullptr};
+    int m_check_level{0};
+    std::string* m_error{nullptr};
+
+public:
+    CVerifyBlockCheck() = default;
+    CVerifyBlockCheck(const CBlockIndex& index, const Consensus::Params& params, int check_level, std::string& error)
+        : m_index(&index), m_params(&params), m_check_level(check_level), m_error(&error) {}
+
+    //! Always succeeds, so that one bad block does not stop the checks of the others.
+    bool operator()() LOCKS_EXCLUDED(::cs_main);
+
+    void swap(CVerifyBlockCheck& check) noexcept
+    {
+        std::swap(m_index, check.m_index);
+        std::swap(m_params, check.m_params);
+        std::swap(m_check_level, check.m_check_level);
+        std::swap(m_error, check.m_error);
+    }
+};
+
+/**
+ * Closure representing the lookup of a run of block inputs in the coin
+ * database, so that the inputs of a block can be read in parallel by a
+ * CCheckQueue. A coin that is not found, or cannot be read, is left spent.
+ * The view, outpoints and coins must outlive the check.
+ */
+class CCoinsPrefetch
+{
+private:
+    const CCoinsViewDB* m_view{nullptr};
+    const COutPoint* m_outpoints{nullptr};
+    Coin* m_coins{nullptr};
+    size_t m_count{0};
+
+public:
+    //! Number of inputs handed to one check
+    static constexpr size_t INPUTS_PER_CHECK{16};
+
+    CCoinsPrefetch() = default;
+    CCoinsPrefetch(const CCoinsViewDB& view, const COutPoint* outpoints, Coin* coins, size_t count)
+        : m_view(&view), m_outpoints(outpoints), m_coins(coins), m_count(count) {}
+
+    //! Always succeeds; a coin that is missing here is looked up again when the block is connected.
+    bool operator()();
+
+    void swap(CCoinsPrefetch& check) noexcept
+    {
+        std::swap(m_view, check.m_view);
+        std::swap(m_outpoints, check.m_outpoints);
+        std::swap(m_coins, check.m_coins);
+        std::swap(m_count, check.m_count);
+    }
+};
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -347,17 +541,37 @@ bool HasValidProofOfWork(const std::vector<CBlockHeader>& headers, const Consens
 /** Return the sum of the work on a given set of headers */
 arith_uint256 CalculateHeadersWork(const std::vector<CBlockHeader>& headers);
 
+/** Status of a verification of the block and coin databases that runs in the background. */
+struct VerifyDBStatus {
+    std::atomic<bool> running{false};
+    //! Whether the last verification that finished succeeded
+    std::atomic<bool> ok{true};
+    std::atomic<int> check_level{0};
+    std::atomic<int> check_blocks{0};
+    //! Percentage done of the running or last verification
+    std::atomic<int> progress{0};
+};
+
 /** RAII wrapper for VerifyDB: Verify consistency of the block and coin databases */
 class CVerifyDB {
+private:
+    VerifyDBStatus* const m_status;
+
 public:
-    CVerifyDB();
+    //! Report the progress of VerifyDB to status, if not nullptr.
+    explicit CVerifyDB(VerifyDBStatus* status = nullptr);
     ~CVerifyDB();
+    /**
+     * Check levels 0 to 2 on the worker threads of the proof-of-work checks,
+     * without holding cs_main, and then levels 3 and 4 with cs_main held, on
+     * coinsview, which must be consistent with the tip of chainstate.
+     */
     bool VerifyDB(
         Chainstate& chainstate,
         const Consensus::Params& consensus_params,
         CCoinsView& coinsview,
         int nCheckLevel,
-        int nCheckDepth) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+        int nCheckDepth) LOCKS_EXCLUDED(cs_main);
 };
 
 enum DisconnectResult
@@ -581,6 +795,17 @@ public:
     bool ResizeCoinsCaches(size_t coinstip_size, size_t coinsdb_size)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
+    //! MuHash of the UTXO set at the tip, kept up to date as blocks are
+    //! (dis)connected and stored with the coins, if -utxomuhash is set.
+    std::optional<kernel::UTXOSetMuHash> m_utxo_muhash GUARDED_BY(::cs_main);
+
+    /**
+     * Start keeping m_utxo_muhash. It is read from the coins database, or
+     * computed from all coins if none was stored for the current tip.
+     * @returns false if the UTXO set could not be read.
+     */
+    bool InitUTXOMuHash() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     /**
      * Import blocks from an external file
      *
@@ -660,10 +885,18 @@ public:
     bool AcceptBlock(const std::shared_ptr<const CBlock>& pblock, BlockValidationState& state, CBlockIndex** ppindex, bool fRequested, const FlatFilePos* dbp, bool* fNewBlock, bool min_pow_checked) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Block (dis)connection on a given view:
-    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view)
+    /** utxo_muhash_delta, if set, gets the changes to the UTXOSetMuHash. */
+    DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view,
+                                     kernel::UTXOSetMuHash* utxo_muhash_delta = nullptr)
         EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+    /**
+     * while_verifying, if set, is called while the script checks of the block run on the worker threads.
+     * utxo_muhash_delta, if set, gets the changes to the UTXOSetMuHash.
+     */
     bool ConnectBlock(const CBlock& block, BlockValidationState& state, CBlockIndex* pindex,
-                      CCoinsViewCache& view, bool fJustCheck = false) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+                      CCoinsViewCache& view, bool fJustCheck = false,
+                      const std::function<void()>& while_verifying = {},
+                      kernel::UTXOSetMuHash* utxo_muhash_delta = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
 
     // Apply the effects of a block disconnection on the UTXO set.
     bool DisconnectTip(BlockValidationState& state, DisconnectedBlockTransactions* disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
@@ -695,6 +928,14 @@ public:
 
     void PruneBlockIndexCandidates();
 
+    /**
+     * Add a block whose transactions and those of its ancestors are known to
+     * setBlockIndexCandidates, unless it has less work than the tip. The
+     * background chainstate of a snapshot only takes the ancestors of the
+     * snapshot base, so that it stops there.
+     */
+    void TryAddBlockIndexCandidate(CBlockIndex* pindex) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
     void UnloadBlockIndex() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
 
     /** Check whether we are doing an initial block download (synchronizing from disk or network) */
@@ -729,7 +970,23 @@ public:
 
 private:
     bool ActivateBestChainStep(BlockValidationState& state, CBlockIndex* pindexMostWork, const std::shared_ptr<const CBlock>& pblock, bool& fInvalidFound, ConnectTrace& connectTrace) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
-    bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    /**
+     * Connect pindexNew. If pindexNext, the block that will likely be
+     * connected next, is given, it is read from disk (unless pblockNext is
+     * given) and its inputs are prefetched while the scripts of pindexNew
+     * are verified.
+     */
+    bool ConnectTip(BlockValidationState& state, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions& disconnectpool,
+                    const CBlockIndex* pindexNext = nullptr, const std::shared_ptr<const CBlock>& pblockNext = nullptr) EXCLUSIVE_LOCKS_REQUIRED(cs_main, m_mempool->cs);
+    /**
+     * Look up the inputs of block that are not in the coins cache in the
+     * coin database, on the prefetch worker threads, and add them to the
+     * cache, so that ConnectBlock() does not have to read them one by one.
+     */
+    void PrefetchInputs(const CBlock& block) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
+
+    //! The block ConnectTip() got ready for the next call, with its inputs prefetched
+    std::pair<const CBlockIndex*, std::shared_ptr<const CBlock>> m_next_block GUARDED_BY(::cs_main);
 
     void InvalidBlockFound(CBlockIndex* pindex, const BlockValidationState& state) EXCLUSIVE_LOCKS_REQUIRED(cs_main);
     CBlockIndex* FindMostWorkChain() EXCLUSIVE_LOCKS_REQUIRED(cs_main);
@@ -845,6 +1102,20 @@ private:
 
     CBlockIndex* m_best_invalid GUARDED_BY(::cs_main){nullptr};
 
+    //! Read with std::atomic_load, so TipSnapshot needs no lock
+    std::shared_ptr<const ChainTipSnapshot> m_tip_snapshot;
+
+    //! Connects the blocks of BackgroundSyncChainstate() when woken by ProcessNewBlock
+    std::thread m_background_validation;
+    Mutex m_background_validation_mutex;
+    std::condition_variable m_background_validation_cv;
+    bool m_background_validation_pending GUARDED_BY(m_background_validation_mutex){false};
+    bool m_background_validation_stop GUARDED_BY(m_background_validation_mutex){false};
+    //! When m_background_validation first connected blocks, and the height it started from
+    std::optional<std::pair<SteadyClock::time_point, int>> m_background_sync_start GUARDED_BY(::cs_main);
+
+    void BackgroundValidationThread() EXCLUSIVE_LOCKS_REQUIRED(!m_background_validation_mutex);
+
     //! Internal helper for ActivateSnapshot().
     [[nodiscard]] bool PopulateAndValidateSnapshot(
         Chainstate& snapshot_chainstate,
@@ -894,6 +1165,9 @@ public:
 
     const Options m_options;
     std::thread m_load_block;
+    //! Verification of the last blocks started by VerifyLoadedChainstate, when it runs in the background
+    std::thread m_verify_blocks;
+    VerifyDBStatus m_verify_blocks_status;
     //! A single BlockManager instance is shared across each constructed
     //! chainstate to avoid duplicating block metadata.
     node::BlockManager m_blockman;
@@ -967,6 +1241,14 @@ public:
     int ActiveHeight() const EXCLUSIVE_LOCKS_REQUIRED(GetMutex()) { return ActiveChain().Height(); }
     CBlockIndex* ActiveTip() const EXCLUSIVE_LOCKS_REQUIRED(GetMutex()) { return ActiveChain().Tip(); }
 
+    //! Return the tip of the active chain as of the last tip change without
+    //! taking cs_main, or nullptr before a chain tip is loaded. Block index
+    //! entries are never freed before shutdown, so the tip and its ancestors
+    //! may be read, but whether it is still the tip needs cs_main.
+    std::shared_ptr<const ChainTipSnapshot> TipSnapshot() const { return std::atomic_load(&m_tip_snapshot); }
+    //! Publish the tip of the active chain to TipSnapshot() readers.
+    void PublishTipSnapshot() EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
     node::BlockMap& BlockIndex() EXCLUSIVE_LOCKS_REQUIRED(::cs_main)
     {
         AssertLockHeld(::cs_main);
@@ -987,6 +1269,28 @@ public:
     //! Is there a snapshot in use and has it been fully validated?
     bool IsSnapshotValidated() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main) { return m_snapshot_validated; }
 
+    //! The block index entry of the base of the snapshot in use, if any.
+    const CBlockIndex* GetSnapshotBaseBlock() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! The chainstate that validates the blocks below the base of the snapshot
+    //! in use, as long as it has not reached it, or nullptr.
+    Chainstate* BackgroundSyncChainstate() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    //! Estimated time until BackgroundSyncChainstate() reaches the snapshot
+    //! base, from its pace since the background validation thread started
+    //! connecting its blocks, or std::nullopt if it has not yet.
+    std::optional<std::chrono::seconds> BackgroundSyncETA() const EXCLUSIVE_LOCKS_REQUIRED(::cs_main);
+
+    /**
+     * Start the thread that connects the blocks of BackgroundSyncChainstate()
+     * as they arrive, at batch priority and with the script checks on worker
+     * threads of their own, so that it does not hold up the active chainstate.
+     * Without it, the background chainstate only advances where all
+     * chainstates are activated, as in ThreadImport.
+     */
+    void StartBackgroundValidation() EXCLUSIVE_LOCKS_REQUIRED(!m_background_validation_mutex);
+    void StopBackgroundValidation() EXCLUSIVE_LOCKS_REQUIRED(!m_background_validation_mutex);
+
     /**
      * Process an incoming block. This only returns after the best known valid
      * block is made active. Note that it does not, however, guarantee that the
@@ -1011,7 +1315,7 @@ public:
      * @param[out]  new_block A boolean which is set to indicate if the block was first received via this call
      * @returns     If the block was processed, independently of block validity
      */
-    bool ProcessNewBlock(const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked, bool* new_block) LOCKS_EXCLUDED(cs_main);
+    bool ProcessNewBlock(const std::shared_ptr<const CBlock>& block, bool force_processing, bool min_pow_checked, bool* new_block) LOCKS_EXCLUDED(cs_main) EXCLUSIVE_LOCKS_REQUIRED(!m_background_validation_mutex);
 
     /**
      * Process incoming block headers.
@@ -12,90 +12,257 @@
 #include <primitives/block.h>
 #include <primitives/transaction.h>
 #include <scheduler.h>
+#include <sync.h>
+#include <tinyformat.h>
+#include <util/thread.h>
 
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <future>
-#include <unordered_map>
+#include <thread>
 #include <utility>
 
+namespace {
 /**
- * MainSignalsImpl manages a list of shared_ptr<CValidationInterface> callbacks.
+ * A registered callbacks object with its own queue of background callbacks.
+ * The queue is drained one callback at a time, in order, so that each
+ * subscriber keeps single-threaded semantics while others proceed.
+ */
+struct Subscriber {
+    using Callback = std::function<void(Subscriber&)>;
+
+    explicit Subscriber(std::shared_ptr<CValidationInterface> callbacks) : callbacks{std::move(callbacks)} {}
+
+    //! Null for the queue carrying CallFunctionInValidationInterfaceQueue without subscribers
+    const std::shared_ptr<CValidationInterface> callbacks;
+    //! Cleared on unregistration, after which queued notifications are dropped
+    std::atomic<bool> registered{true};
+
+    Mutex m_mutex;
+    std::deque<std::pair<Callback, std::chrono::steady_clock::time_point>> m_pending GUARDED_BY(m_mutex);
+    bool m_running GUARDED_BY(m_mutex){false};
+    uint64_t m_delivered GUARDED_BY(m_mutex){0};
+    std::chrono::microseconds m_last_lag GUARDED_BY(m_mutex){0};
+    std::chrono::microseconds m_max_lag GUARDED_BY(m_mutex){0};
+};
+} // namespace
+
+/**
+ * MainSignalsImpl manages the subscribers and their callback queues.
  *
- * A std::unordered_map is used to track what callbacks are currently
- * registered, and a std::list is used to store the callbacks that are
- * currently registered as well as any callbacks that are just unregistered
- * and about to be deleted when they are done executing.
+ * The queues of the subscribers are drained on the scheduler threads, each by
+ * at most one thread at a time. A scheduled task holds a shared_ptr to its
+ * subscriber, so an unregistered subscriber lives until its queue is done.
  */
 class MainSignalsImpl
 {
 private:
     Mutex m_mutex;
-    //! List entries consist of a callback pointer and reference count. The
-    //! count is equal to the number of current executions of that entry, plus 1
-    //! if it's registered. It cannot be 0 because that would imply it is
-    //! unregistered and also not being executed (so shouldn't exist).
-    struct ListEntry { std::shared_ptr<CValidationInterface> callbacks; int count = 1; };
-    std::list<ListEntry> m_list GUARDED_BY(m_mutex);
-    std::unordered_map<CValidationInterface*, std::list<ListEntry>::iterator> m_map GUARDED_BY(m_mutex);
+    std::vector<std::shared_ptr<Subscriber>> m_subscribers GUARDED_BY(m_mutex);
+    const std::shared_ptr<Subscriber> m_idle_queue{std::make_shared<Subscriber>(nullptr)};
+
+    CScheduler m_dispatch_scheduler;
+    std::vector<std::thread> m_dispatch_threads;
+    CScheduler& m_scheduler;
+
+    void Schedule(std::shared_ptr<Subscriber> subscriber)
+    {
+        m_scheduler.schedule([this, subscriber] {
+            if (Process(*subscriber)) Schedule(subscriber);
+        }, std::chrono::steady_clock::now());
+    }
+
+    //! Deliver the next callback of a subscriber. Returns whether more are
+    //! pending; they are scheduled anew so that subscribers take turns.
+    bool Process(Subscriber& subscriber) EXCLUSIVE_LOCKS_REQUIRED(!subscriber.m_mutex)
+    {
+        Subscriber::Callback callback;
+        {
+            LOCK(subscriber.m_mutex);
+            if (subscriber.m_running || subscriber.m_pending.empty()) return false;
+            subscriber.m_running = true;
+            const auto lag{std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - subscriber.m_pending.front().second)};
+            subscriber.m_last_lag = lag;
+            subscriber.m_max_lag = std::max(subscriber.m_max_lag, lag);
+            callback = std::move(subscriber.m_pending.front().first);
+            subscriber.m_pending.pop_front();
+        }
+
+        callback(subscriber);
+
+        bool more;
+        {
+            LOCK(subscriber.m_mutex);
+            subscriber.m_running = false;
+            ++subscriber.m_delivered;
+            more = !subscriber.m_pending.empty();
+        }
+        return more;
+    }
+
+    void Add(const std::shared_ptr<Subscriber>& subscriber, Subscriber::Callback callback) EXCLUSIVE_LOCKS_REQUIRED(!subscriber->m_mutex)
+    {
+        bool schedule;
+        {
+            LOCK(subscriber->m_mutex);
+            subscriber->m_pending.emplace_back(std::move(callback), std::chrono::steady_clock::now());
+            // Otherwise a task is already scheduled or running for the queue
+            schedule = !subscriber->m_running && subscriber->m_pending.size() == 1;
+        }
+        if (schedule) Schedule(subscriber);
+    }
+
+    std::vector<std::shared_ptr<Subscriber>> Subscribers() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        return m_subscribers;
+    }
 
 public:
-    // We are not allowed to assume the scheduler only runs in one thread,
-    // but must ensure all callbacks happen in-order, so we end up creating
-    // our own queue here :(
-    SingleThreadedSchedulerClient m_schedulerClient;
+    explicit MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND, int dispatch_threads)
+        : m_scheduler{dispatch_threads > 0 ? m_dispatch_scheduler : scheduler}
+    {
+        for (int i = 0; i < dispatch_threads; ++i) {
+            m_dispatch_threads.emplace_back(&util::TraceThread, strprintf("valsig.%i", i), [this] { m_dispatch_scheduler.serviceQueue(); });
+        }
+    }
 
-    explicit MainSignalsImpl(CScheduler& scheduler LIFETIMEBOUND) : m_schedulerClient(scheduler) {}
+    ~MainSignalsImpl() { StopDispatchThreads(); }
+
+    void StopDispatchThreads()
+    {
+        if (m_dispatch_threads.empty()) return;
+        m_dispatch_scheduler.stop();
+        for (auto& thread : m_dispatch_threads) thread.join();
+        m_dispatch_threads.clear();
+    }
 
     void Register(std::shared_ptr<CValidationInterface> callbacks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
+        Unregister(callbacks.get());
         LOCK(m_mutex);
-        auto inserted = m_map.emplace(callbacks.get(), m_list.end());
-        if (inserted.second) inserted.first->second = m_list.emplace(m_list.end());
-        inserted.first->second->callbacks = std::move(callbacks);
+        m_subscribers.push_back(std::make_shared<Subscriber>(std::move(callbacks)));
     }
 
     void Unregister(CValidationInterface* callbacks) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         LOCK(m_mutex);
-        auto it = m_map.find(callbacks);
-        if (it != m_map.end()) {
-            if (!--it->second->count) m_list.erase(it->second);
-            m_map.erase(it);
+        const auto it{std::find_if(m_subscribers.begin(), m_subscribers.end(), [&](const auto& s) { return s->callbacks.get() == callbacks; })};
+        if (it != m_subscribers.end()) {
+            (*it)->registered = false;
+            m_subscribers.erase(it);
         }
     }
 
-    //! Clear unregisters every previously registered callback, erasing every
-    //! map entry. After this call, the list may still contain callbacks that
-    //! are currently executing, but it will be cleared when they are done
-    //! executing.
+    //! Clear unregisters every previously registered callback. Callbacks that
+    //! are currently executing finish, the queued ones are dropped.
     void Clear() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
         LOCK(m_mutex);
-        for (const auto& entry : m_map) {
-            if (!--entry.second->count) m_list.erase(entry.second);
+        for (const auto& subscriber : m_subscribers) {
+            subscriber->registered = false;
         }
-        m_map.clear();
+        m_subscribers.clear();
     }
 
-    template<typename F> void Iterate(F&& f) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    //! Queue a notification for every subscriber. Holding m_mutex keeps the
+    //! order of notifications from several threads the same in every queue.
+    template<typename F> void Enqueue(F&& f) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        for (const auto& subscriber : m_subscribers) {
+            Add(subscriber, [f](Subscriber& s) {
+                if (s.registered) f(*s.callbacks);
+            });
+        }
+    }
+
+    //! Run func once every subscriber is done with the callbacks queued before.
+    void CallWhenDone(std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        LOCK(m_mutex);
+        if (m_subscribers.empty()) {
+            Add(m_idle_queue, [func = std::move(func)](Subscriber&) { func(); });
+            return;
+        }
+        auto remaining{std::make_shared<std::atomic<size_t>>(m_subscribers.size())};
+        auto shared_func{std::make_shared<const std::function<void()>>(std::move(func))};
+        for (const auto& subscriber : m_subscribers) {
+            Add(subscriber, [remaining, shared_func](Subscriber&) {
+                if (--*remaining == 0) (*shared_func)();
+            });
+        }
+    }
+
+    //! Run func once one subscriber is done with the callbacks queued before.
+    void CallWhenDone(const CValidationInterface& callbacks, std::function<void()> func) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
     {
-        WAIT_LOCK(m_mutex, lock);
-        for (auto it = m_list.begin(); it != m_list.end();) {
-            ++it->count;
-            {
-                REVERSE_LOCK(lock);
-                f(*it->callbacks);
+        {
+            LOCK(m_mutex);
+            const auto it{std::find_if(m_subscribers.begin(), m_subscribers.end(), [&](const auto& s) { return s->callbacks.get() == &callbacks; })};
+            if (it != m_subscribers.end()) {
+                Add(*it, [func = std::move(func)](Subscriber&) { func(); });
+                return;
             }
-            it = --it->count ? std::next(it) : m_list.erase(it);
         }
+        func();
+    }
+
+    //! Call f for every subscriber on the calling thread
+    template<typename F> void Iterate(F&& f) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        for (const auto& subscriber : Subscribers()) {
+            if (subscriber->registered) f(*subscriber->callbacks);
+        }
+    }
+
+    //! Deliver all queued callbacks on the calling thread. The scheduler must
+    //! have no threads left servicing its queue.
+    void EmptyQueues() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        StopDispatchThreads();
+        assert(!m_scheduler.AreThreadsServicingQueue());
+        auto subscribers{Subscribers()};
+        subscribers.push_back(m_idle_queue);
+        for (const auto& subscriber : subscribers) {
+            while (Process(*subscriber)) {}
+        }
+    }
+
+    size_t CallbacksPending() EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        auto subscribers{Subscribers()};
+        subscribers.push_back(m_idle_queue);
+        size_t pending{0};
+        for (const auto& subscriber : subscribers) {
+            pending = std::max(pending, WITH_LOCK(subscriber->m_mutex, return subscriber->m_pending.size()));
+        }
+        return pending;
+    }
+
+    template<typename F> std::vector<ValidationSubscriberStats> GetStats(F&& name) EXCLUSIVE_LOCKS_REQUIRED(!m_mutex)
+    {
+        std::vector<ValidationSubscriberStats> result;
+        for (const auto& subscriber : Subscribers()) {
+            ValidationSubscriberStats& stats{result.emplace_back()};
+            stats.name = name(*subscriber->callbacks);
+            LOCK(subscriber->m_mutex);
+            stats.pending = subscriber->m_pending.size();
+            stats.delivered = subscriber->m_delivered;
+            stats.last_lag = subscriber->m_last_lag;
+            stats.max_lag = subscriber->m_max_lag;
+        }
+        return result;
     }
 };
 
 static CMainSignals g_signals;
 
-void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler)
+void CMainSignals::RegisterBackgroundSignalScheduler(CScheduler& scheduler, int dispatch_threads)
 {
     assert(!m_internals);
-    m_internals = std::make_unique<MainSignalsImpl>(scheduler);
+    m_internals = std::make_unique<MainSignalsImpl>(scheduler, dispatch_threads);
 }
 
 void CMainSignals::UnregisterBackgroundSignalScheduler()
@@ -106,14 +273,20 @@ void CMainSignals::UnregisterBackgroundSignalScheduler()
 void CMainSignals::FlushBackgroundCallbacks()
 {
     if (m_internals) {
-        m_internals->m_schedulerClient.EmptyQueue();
+        m_internals->EmptyQueues();
     }
 }
 
 size_t CMainSignals::CallbacksPending()
 {
     if (!m_internals) return 0;
-    return m_internals->m_schedulerClient.CallbacksPending();
+    return m_internals->CallbacksPending();
+}
+
+std::vector<ValidationSubscriberStats> CMainSignals::GetSubscriberStats()
+{
+    if (!m_internals) return {};
+    return m_internals->GetStats([](const CValidationInterface& callbacks) { return callbacks.ValidationInterfaceName(); });
 }
 
 CMainSignals& GetMainSignals()
@@ -157,7 +330,12 @@ void UnregisterAllValidationInterfaces()
 
 void CallFunctionInValidationInterfaceQueue(std::function<void()> func)
 {
-    g_signals.m_internals->m_schedulerClient.AddToProcessQueue(std::move(func));
+    g_signals.m_internals->CallWhenDone(std::move(func));
+}
+
+void CallFunctionInValidationInterfaceQueue(const CValidationInterface& callbacks, std::function<void()> func)
+{
+    g_signals.m_internals->CallWhenDone(callbacks, std::move(func));
 }
 
 void SyncWithValidationInterfaceQueue()
@@ -171,18 +349,30 @@ void SyncWithValidationInterfaceQueue()
     promise.get_future().wait();
 }
 
+void SyncWithValidationInterfaceQueue(const CValidationInterface& callbacks)
+{
+    AssertLockNotHeld(cs_main);
+    // Block until the queue of the subscriber drains
+    std::promise<void> promise;
+    CallFunctionInValidationInterfaceQueue(callbacks, [&promise] {
+        promise.set_value();
+    });
+    promise.get_future().wait();
+}
+
 // Use a macro instead of a function for conditional logging to prevent
 // evaluating arguments when logging is not enabled.
 //
 // NOTE: The lambda captures all local variables by value.
-#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)           \
-    do {                                                       \
-        auto local_name = (name);                              \
-        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);  \
-        m_internals->m_schedulerClient.AddToProcessQueue([=] { \
-            LOG_EVENT(fmt, local_name, __VA_ARGS__);           \
-            event();                                           \
-        });                                                    \
+#define ENQUEUE_AND_LOG_EVENT(event, fmt, name, ...)                         \
+    do {                                                                     \
+        auto local_name = (name);                                            \
+        LOG_EVENT("Enqueuing " fmt, local_name, __VA_ARGS__);                \
+        m_internals->Enqueue([=](CValidationInterface& callbacks) {          \
+            LOG_EVENT(fmt " for %s", local_name, __VA_ARGS__,                \
+                      callbacks.ValidationInterfaceName());                  \
+            event(callbacks);                                                \
+        });                                                                  \
     } while (0)
 
 #define LOG_EVENT(fmt, ...) \
@@ -193,8 +383,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
     // the chain actually updates. One way to ensure this is for the caller to invoke this signal
     // in the same critical section where the chain is updated
 
-    auto event = [pindexNew, pindexFork, fInitialDownload, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload); });
+    auto event = [pindexNew, pindexFork, fInitialDownload](CValidationInterface& callbacks) {
+        callbacks.UpdatedBlockTip(pindexNew, pindexFork, fInitialDownload);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: new block hash=%s fork block hash=%s (in IBD=%s)", __func__,
                           pindexNew->GetBlockHash().ToString(),
@@ -203,8 +393,8 @@ void CMainSignals::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockInd
 }
 
 void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) {
-    auto event = [tx, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionAddedToMempool(tx, mempool_sequence); });
+    auto event = [tx, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionAddedToMempool(tx, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
@@ -212,8 +402,8 @@ void CMainSignals::TransactionAddedToMempool(const CTransactionRef& tx, uint64_t
 }
 
 void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRemovalReason reason, uint64_t mempool_sequence) {
-    auto event = [tx, reason, mempool_sequence, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence); });
+    auto event = [tx, reason, mempool_sequence](CValidationInterface& callbacks) {
+        callbacks.TransactionRemovedFromMempool(tx, reason, mempool_sequence);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: txid=%s wtxid=%s", __func__,
                           tx->GetHash().ToString(),
@@ -221,8 +411,8 @@ void CMainSignals::TransactionRemovedFromMempool(const CTransactionRef& tx, MemP
 }
 
 void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, const CBlockIndex *pindex) {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockConnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockConnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -231,8 +421,8 @@ void CMainSignals::BlockConnected(const std::shared_ptr<const CBlock> &pblock, c
 
 void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex)
 {
-    auto event = [pblock, pindex, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.BlockDisconnected(pblock, pindex); });
+    auto event = [pblock, pindex](CValidationInterface& callbacks) {
+        callbacks.BlockDisconnected(pblock, pindex);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s block height=%d", __func__,
                           pblock->GetHash().ToString(),
@@ -240,8 +430,8 @@ void CMainSignals::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock
 }
 
 void CMainSignals::ChainStateFlushed(const CBlockLocator &locator) {
-    auto event = [locator, this] {
-        m_internals->Iterate([&](CValidationInterface& callbacks) { callbacks.ChainStateFlushed(locator); });
+    auto event = [locator](CValidationInterface& callbacks) {
+        callbacks.ChainStateFlushed(locator);
     };
     ENQUEUE_AND_LOG_EVENT(event, "%s: block hash=%s", __func__,
                           locator.IsNull() ? "null" : locator.vHave.front().ToString());
@@ -9,8 +9,11 @@
 #include <primitives/transaction.h> // CTransaction(Ref)
 #include <sync.h>
 
+#include <chrono>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 extern RecursiveMutex cs_main;
 class BlockValidationState;
@@ -21,6 +24,20 @@ class CValidationInterface;
 class CScheduler;
 enum class MemPoolRemovalReason;
 
+/** Default number of threads delivering background callbacks, besides the scheduler thread */
+static constexpr int DEFAULT_VALIDATION_SIGNAL_THREADS{2};
+
+/** Queue depth and delay of the background callbacks of one subscriber */
+struct ValidationSubscriberStats {
+    std::string name;
+    //! Callbacks waiting to be delivered
+    size_t pending{0};
+    uint64_t delivered{0};
+    //! Time between queueing and delivery of the last and the slowest callback
+    std::chrono::microseconds last_lag{0};
+    std::chrono::microseconds max_lag{0};
+};
+
 /** Register subscriber */
 void RegisterValidationInterface(CValidationInterface* callbacks);
 /** Unregister subscriber. DEPRECATED. This is not safe to use when the RPC server or main message handler thread is running. */
@@ -47,6 +64,12 @@ void UnregisterSharedValidationInterface(std::shared_ptr<CValidationInterface> c
  * will result in a deadlock (that DEBUG_LOCKORDER will miss).
  */
 void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+/**
+ * Pushes a function to callback onto the queue of one subscriber, guaranteeing the callbacks
+ * generated for it prior to now are finished when the function is called. Other subscribers
+ * are not waited for. If the subscriber is not registered, the function is called right away.
+ */
+void CallFunctionInValidationInterfaceQueue(const CValidationInterface& callbacks, std::function<void ()> func);
 /**
  * This is a synonym for the following, which asserts certain locks are not
  * held:
@@ -57,6 +80,8 @@ void CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
  *     promise.get_future().wait();
  */
 void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
+/** Block until the callbacks queued for one subscriber are done, see CallFunctionInValidationInterfaceQueue(). */
+void SyncWithValidationInterfaceQueue(const CValidationInterface& callbacks) LOCKS_EXCLUDED(cs_main);
 
 /**
  * Implement this to subscribe to events generated in validation
@@ -71,7 +96,8 @@ void SyncWithValidationInterfaceQueue() LOCKS_EXCLUDED(cs_main);
  * UpdatedBlockTip() callback may depend on an operation performed in
  * the BlockConnected() callback without worrying about explicit
  * synchronization. No ordering should be assumed across
- * ValidationInterface() subscribers.
+ * ValidationInterface() subscribers: each has its own queue of
+ * background callbacks, so a slow subscriber only delays itself.
  */
 class CValidationInterface {
 protected:
@@ -171,6 +197,8 @@ protected:
      * Notifies listeners that a block which builds directly on our current tip
      * has been received and connected to the headers tree, though not validated yet */
     virtual void NewPoWValidBlock(const CBlockIndex *pindex, const std::shared_ptr<const CBlock>& block) {};
+    /** Name of the subscriber in the queue statistics */
+    virtual std::string ValidationInterfaceName() const { return "unnamed"; }
     friend class CMainSignals;
     friend class ValidationInterfaceTest;
 };
@@ -184,16 +212,22 @@ private:
     friend void ::UnregisterValidationInterface(CValidationInterface*);
     friend void ::UnregisterAllValidationInterfaces();
     friend void ::CallFunctionInValidationInterfaceQueue(std::function<void ()> func);
+    friend void ::CallFunctionInValidationInterfaceQueue(const CValidationInterface& callbacks, std::function<void ()> func);
 
 public:
-    /** Register a CScheduler to give callbacks which should run in the background (may only be called once) */
-    void RegisterBackgroundSignalScheduler(CScheduler& scheduler);
+    /**
+     * Register a CScheduler to give callbacks which should run in the background (may only be called once).
+     * With dispatch_threads, the callbacks run on that many threads of their own instead.
+     */
+    void RegisterBackgroundSignalScheduler(CScheduler& scheduler, int dispatch_threads = 0);
     /** Unregister a CScheduler to give callbacks which should run in the background - these callbacks will now be dropped! */
     void UnregisterBackgroundSignalScheduler();
     /** Call any remaining callbacks on the calling thread */
     void FlushBackgroundCallbacks();
 
+    /** Return the most background callbacks waiting for one subscriber */
     size_t CallbacksPending();
+    std::vector<ValidationSubscriberStats> GetSubscriberStats();
 
 
     void UpdatedBlockTip(const CBlockIndex *, const CBlockIndex *, bool fInitialDownload);
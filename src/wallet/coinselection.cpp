@@ -41,9 +41,10 @@ struct {
  *
  * waste = selectionTotal - target + inputs × (currentFeeRate - longTermFeeRate)
  *
- * The algorithm uses two additional optimizations. A lookahead keeps track of the total value of
+ * The algorithm uses three additional optimizations. A lookahead keeps track of the total value of
  * the unexplored UTXOs. A subtree is not explored if the lookahead indicates that the target range
- * cannot be reached. Further, it is unnecessary to test equivalent combinations. This allows us
+ * cannot be reached. The inclusion branch of a UTXO is not explored if including it would exceed
+ * the target range. Further, it is unnecessary to test equivalent combinations. This allows us
  * to skip testing the inclusion of UTXOs that match the effective value and waste of an omitted
  * predecessor.
  *
@@ -57,12 +58,17 @@ struct {
  *        bound of the range.
  * @param const CAmount& cost_of_change This is the cost of creating and spending a change output.
  *        This plus selection_target is the upper bound of the range.
+ * @param std::optional<SteadyClock::time_point> deadline If set, the search also ends at this time,
+ *        returning the best solution found so far.
  * @returns The result of this coin selection algorithm, or std::nullopt
  */
 
 static const size_t TOTAL_TRIES = 100000;
+//! Number of tries between checks of the deadline
+static const size_t DEADLINE_CHECK_INTERVAL = 1000;
 
-std::optional<SelectionResult> SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& selection_target, const CAmount& cost_of_change)
+std::optional<SelectionResult> SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& selection_target, const CAmount& cost_of_change,
+                                             std::optional<SteadyClock::time_point> deadline)
 {
     SelectionResult result(selection_target, SelectionAlgorithm::BNB);
     CAmount curr_value = 0;
@@ -89,6 +95,7 @@ std::optional<SelectionResult> SelectCoinsBnB(std::vector<OutputGroup>& utxo_poo
 
     // Depth First search loop for choosing the UTXOs
     for (size_t curr_try = 0, utxo_pool_index = 0; curr_try < TOTAL_TRIES; ++curr_try, ++utxo_pool_index) {
+        if (deadline && curr_try % DEADLINE_CHECK_INTERVAL == 0 && SteadyClock::now() > *deadline) break;
         // Conditions for starting a backtrack
         bool backtrack = false;
         if (curr_value + curr_available_value < selection_target || // Cannot possibly reach target with the amount remaining in the curr_available_value.
@@ -139,6 +146,9 @@ std::optional<SelectionResult> SelectCoinsBnB(std::vector<OutputGroup>& utxo_poo
                 utxo.GetSelectionAmount() != utxo_pool.at(utxo_pool_index - 1).GetSelectionAmount() ||
                 utxo.fee != utxo_pool.at(utxo_pool_index - 1).fee)
             {
+                // Skip the inclusion branch if it exceeds the target range right away, larger
+                // UTXOs come first so only the omission branch can lead to a solution
+                if (curr_value + utxo.GetSelectionAmount() > selection_target + cost_of_change) continue;
                 // Inclusion branch first (Largest First Exploration)
                 curr_selection.push_back(utxo_pool_index);
                 curr_value += utxo.GetSelectionAmount();
@@ -9,7 +9,9 @@
 #include <policy/feerate.h>
 #include <primitives/transaction.h>
 #include <random.h>
+#include <util/time.h>
 
+#include <chrono>
 #include <optional>
 
 namespace wallet {
@@ -17,6 +19,10 @@ namespace wallet {
 static constexpr CAmount CHANGE_LOWER{50000};
 //! upper bound for randomly-chosen target change amount
 static constexpr CAmount CHANGE_UPPER{1000000};
+//! Wall-clock time the Branch and Bound search may take when selecting coins for a transaction
+static constexpr std::chrono::milliseconds BNB_MAX_SEARCH_TIME{100};
+//! Number of output groups from which Branch and Bound runs concurrently with the other algorithms
+static constexpr size_t COIN_SELECTION_PARALLEL_MIN_GROUPS{1000};
 
 /** A UTXO under consideration for use in funding a new transaction. */
 struct COutput {
@@ -346,7 +352,8 @@ public:
     SelectionAlgorithm GetAlgo() const { return m_algo; }
 };
 
-std::optional<SelectionResult> SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& selection_target, const CAmount& cost_of_change);
+std::optional<SelectionResult> SelectCoinsBnB(std::vector<OutputGroup>& utxo_pool, const CAmount& selection_target, const CAmount& cost_of_change,
+                                             std::optional<SteadyClock::time_point> deadline = std::nullopt);
 
 /** Select coins by Single Random Draw. OutputGroups are selected randomly from the eligible
  * outputs until the target is satisfied
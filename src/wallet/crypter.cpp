@@ -28,8 +28,8 @@ int CCrypter::BytesToKeySHA512AES(const std::vector<unsigned char>& chSalt, cons
     di.Write(chSalt.data(), chSalt.size());
     di.Finalize(buf);
 
-    for(int i = 0; i != count - 1; i++)
-        di.Reset().Write(buf, sizeof(buf)).Finalize(buf);
+    // Every further round hashes the 64 bytes of the previous one
+    SHA512Iterate64(buf, count - 1);
 
     memcpy(key, buf, WALLET_CRYPTO_KEY_SIZE);
     memcpy(iv, buf + WALLET_CRYPTO_KEY_SIZE, WALLET_CRYPTO_IV_SIZE);
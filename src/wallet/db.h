@@ -140,6 +140,11 @@ public:
 
     virtual void IncrementUpdateCounter() = 0;
 
+    /** Commit the writes of all batches until the matching EndWriteGroup() together, if the
+     *  database supports it. Groups can be nested, the outermost one commits. */
+    virtual void BeginWriteGroup() {}
+    virtual void EndWriteGroup() {}
+
     virtual void ReloadDbEnv() = 0;
 
     /** Return path to main database file for logs and error messages. */
@@ -156,6 +161,20 @@ public:
     virtual std::unique_ptr<DatabaseBatch> MakeBatch(bool flush_on_close = true) = 0;
 };
 
+/** RAII class that groups the writes to a database during its lifetime, see WalletDatabase::BeginWriteGroup(). */
+class DatabaseWriteGroup
+{
+private:
+    WalletDatabase& m_database;
+
+public:
+    explicit DatabaseWriteGroup(WalletDatabase& database) : m_database(database) { m_database.BeginWriteGroup(); }
+    ~DatabaseWriteGroup() { m_database.EndWriteGroup(); }
+
+    DatabaseWriteGroup(const DatabaseWriteGroup&) = delete;
+    DatabaseWriteGroup& operator=(const DatabaseWriteGroup&) = delete;
+};
+
 /** RAII class that provides access to a DummyDatabase. Never fails. */
 class DummyBatch : public DatabaseBatch
 {
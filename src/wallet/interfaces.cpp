@@ -77,6 +77,7 @@ WalletTx MakeWalletTx(CWallet& wallet, const CWalletTx& wtx)
     result.time = wtx.GetTxTime();
     result.value_map = wtx.mapValue;
     result.is_coinbase = wtx.IsCoinBase();
+    result.order_pos = wtx.nOrderPos;
     return result;
 }
 
@@ -320,12 +321,18 @@ public:
         }
         return {};
     }
-    std::set<WalletTx> getWalletTxs() override
+    std::vector<WalletTx> getWalletTxsBefore(const uint256& txid, int64_t order_pos, size_t count) override
     {
         LOCK(m_wallet->cs_wallet);
-        std::set<WalletTx> result;
-        for (const auto& entry : m_wallet->mapWallet) {
-            result.emplace(MakeWalletTx(*m_wallet, entry.second));
+        const CWallet::TxItems& tx_ordered = m_wallet->wtxOrdered;
+        CWallet::TxItems::const_reverse_iterator it = tx_ordered.rbegin();
+        if (!txid.IsNull()) {
+            auto mi = m_wallet->mapWallet.find(txid);
+            it = CWallet::TxItems::const_reverse_iterator{mi != m_wallet->mapWallet.end() ? mi->second.m_it_wtxOrdered : tx_ordered.lower_bound(order_pos)};
+        }
+        std::vector<WalletTx> result;
+        for (; it != tx_ordered.rend() && result.size() < count; ++it) {
+            result.emplace_back(MakeWalletTx(*m_wallet, *it->second));
         }
         return result;
     }
@@ -484,6 +491,7 @@ public:
         RemoveWallet(m_context, m_wallet, false /* load_on_start */);
     }
     bool isLegacy() override { return m_wallet->IsLegacy(); }
+    size_t getMemoryUsage() override { return m_wallet->DynamicMemoryUsage(); }
     std::unique_ptr<Handler> handleUnload(UnloadFn fn) override
     {
         return MakeHandler(m_wallet->NotifyUnload.connect(fn));
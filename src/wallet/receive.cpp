@@ -290,30 +290,97 @@ bool CachedTxIsTrusted(const CWallet& wallet, const CWalletTx& wtx)
     return CachedTxIsTrusted(wallet, wtx, trusted_parents);
 }
 
+/** Add (sign 1) or subtract (sign -1) the amounts of a balance. */
+static void AddBalance(Balance& ret, const Balance& add, int sign)
+{
+    ret.m_mine_trusted += sign * add.m_mine_trusted;
+    ret.m_mine_untrusted_pending += sign * add.m_mine_untrusted_pending;
+    ret.m_mine_immature += sign * add.m_mine_immature;
+    ret.m_watchonly_trusted += sign * add.m_watchonly_trusted;
+    ret.m_watchonly_untrusted_pending += sign * add.m_watchonly_untrusted_pending;
+    ret.m_watchonly_immature += sign * add.m_watchonly_immature;
+}
+
+static bool IsZeroBalance(const Balance& bal)
+{
+    return bal.m_mine_trusted == 0 && bal.m_mine_untrusted_pending == 0 && bal.m_mine_immature == 0 &&
+           bal.m_watchonly_trusted == 0 && bal.m_watchonly_untrusted_pending == 0 && bal.m_watchonly_immature == 0;
+}
+
+/** The amounts a single transaction adds to GetBalance(). */
+static Balance GetTxBalance(const CWallet& wallet, const CWalletTx& wtx, int min_depth, const isminefilter& reuse_filter,
+                            std::set<uint256>& trusted_parents) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    Balance ret;
+    const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
+    const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
+    const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE | reuse_filter)};
+    const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY | reuse_filter)};
+    if (is_trusted && tx_depth >= min_depth) {
+        ret.m_mine_trusted += tx_credit_mine;
+        ret.m_watchonly_trusted += tx_credit_watchonly;
+    }
+    if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
+        ret.m_mine_untrusted_pending += tx_credit_mine;
+        ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
+    }
+    ret.m_mine_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
+    ret.m_watchonly_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+    return ret;
+}
+
+/** Bring the running totals of the default balance up to date and return them. */
+static Balance UpdateBalanceCache(const CWallet& wallet) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    CWallet::BalanceCache& cache{wallet.m_balance_cache};
+    const auto update{[&](const uint256& hash, const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet) {
+        std::set<uint256> trusted_parents;
+        const Balance contribution{GetTxBalance(wallet, wtx, /*min_depth=*/0, ISMINE_NO, trusted_parents)};
+        if (contribution.m_mine_immature != 0 || contribution.m_watchonly_immature != 0) {
+            cache.immature.insert(hash);
+        } else {
+            cache.immature.erase(hash);
+        }
+        if (IsZeroBalance(contribution)) return;
+        AddBalance(cache.total, contribution, 1);
+        cache.contributions.emplace(hash, contribution);
+    }};
+
+    if (cache.all_dirty) {
+        cache.total = Balance{};
+        cache.contributions.clear();
+        cache.immature.clear();
+        for (const auto& [hash, wtx] : wallet.mapWallet) update(hash, wtx);
+        cache.all_dirty = false;
+    } else {
+        for (const uint256& hash : cache.dirty) {
+            const auto old{cache.contributions.find(hash)};
+            if (old != cache.contributions.end()) {
+                AddBalance(cache.total, old->second, -1);
+                cache.contributions.erase(old);
+            }
+            const auto it{wallet.mapWallet.find(hash)};
+            if (it != wallet.mapWallet.end()) {
+                update(hash, it->second);
+            } else {
+                cache.immature.erase(hash);
+            }
+        }
+    }
+    cache.dirty.clear();
+    return cache.total;
+}
+
 Balance GetBalance(const CWallet& wallet, const int min_depth, bool avoid_reuse)
 {
     Balance ret;
     isminefilter reuse_filter = avoid_reuse ? ISMINE_NO : ISMINE_USED;
     {
         LOCK(wallet.cs_wallet);
+        if (min_depth == 0 && avoid_reuse) return UpdateBalanceCache(wallet);
         std::set<uint256> trusted_parents;
-        for (const auto& entry : wallet.mapWallet)
-        {
-            const CWalletTx& wtx = entry.second;
-            const bool is_trusted{CachedTxIsTrusted(wallet, wtx, trusted_parents)};
-            const int tx_depth{wallet.GetTxDepthInMainChain(wtx)};
-            const CAmount tx_credit_mine{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_SPENDABLE | reuse_filter)};
-            const CAmount tx_credit_watchonly{CachedTxGetAvailableCredit(wallet, wtx, ISMINE_WATCH_ONLY | reuse_filter)};
-            if (is_trusted && tx_depth >= min_depth) {
-                ret.m_mine_trusted += tx_credit_mine;
-                ret.m_watchonly_trusted += tx_credit_watchonly;
-            }
-            if (!is_trusted && tx_depth == 0 && wtx.InMempool()) {
-                ret.m_mine_untrusted_pending += tx_credit_mine;
-                ret.m_watchonly_untrusted_pending += tx_credit_watchonly;
-            }
-            ret.m_mine_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE);
-            ret.m_watchonly_immature += CachedTxGetImmatureCredit(wallet, wtx, ISMINE_WATCH_ONLY);
+        for (const auto& entry : wallet.mapWallet) {
+            AddBalance(ret, GetTxBalance(wallet, entry.second, min_depth, reuse_filter, trusted_parents), 1);
         }
     }
     return ret;
@@ -13,6 +13,7 @@
 #include <script/descriptor.h>
 #include <script/script.h>
 #include <script/standard.h>
+#include <streams.h>
 #include <sync.h>
 #include <util/bip32.h>
 #include <util/system.h>
@@ -322,9 +323,9 @@ RPCHelpMan importprunedfunds()
     }
     uint256 hashTx = tx.GetHash();
 
-    CDataStream ssMB(ParseHexV(request.params[1], "proof"), SER_NETWORK, PROTOCOL_VERSION);
+    const std::vector<unsigned char> proof{ParseHexV(request.params[1], "proof")};
     CMerkleBlock merkleBlock;
-    ssMB >> merkleBlock;
+    SpanReader{SER_NETWORK, PROTOCOL_VERSION, proof} >> merkleBlock;
 
     //Search partial merkle tree in proof for our transaction and index in valid block
     std::vector<uint256> vMatch;
@@ -1294,6 +1295,7 @@ RPCHelpMan importmulti()
                     {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED_NAMED_ARG, "",
                         {
                             {"rescan", RPCArg::Type::BOOL, RPCArg::Default{true}, "Scan the chain and mempool for wallet transactions after all imports."},
+                            {"defer_rescan", RPCArg::Type::BOOL, RPCArg::Default{false}, "Rescan in the background after the call returns, in one pass with the rescans that other imports defer meanwhile, from the earliest timestamp of them all. Use \"getdeferredrescaninfo\" to query the pass."},
                         },
                         "\"options\""},
                 },
@@ -1303,6 +1305,7 @@ RPCHelpMan importmulti()
                         {RPCResult::Type::OBJ, "", "",
                         {
                             {RPCResult::Type::BOOL, "success", ""},
+                            {RPCResult::Type::STR, "rescan", /*optional=*/true, "\"deferred\" if the rescan for the import was deferred"},
                             {RPCResult::Type::ARR, "warnings", /*optional=*/true, "",
                             {
                                 {RPCResult::Type::STR, "", ""},
@@ -1337,6 +1340,7 @@ RPCHelpMan importmulti()
 
     //Default options
     bool fRescan = true;
+    bool defer_rescan = false;
 
     if (!mainRequest.params[1].isNull()) {
         const UniValue& options = mainRequest.params[1];
@@ -1344,10 +1348,13 @@ RPCHelpMan importmulti()
         if (options.exists("rescan")) {
             fRescan = options["rescan"].get_bool();
         }
+        if (options.exists("defer_rescan")) {
+            defer_rescan = options["defer_rescan"].get_bool();
+        }
     }
 
     WalletRescanReserver reserver(*pwallet);
-    if (fRescan && !reserver.reserve()) {
+    if (fRescan && !defer_rescan && !reserver.reserve()) {
         throw JSONRPCError(RPC_WALLET_ERROR, "Wallet is currently rescanning. Abort existing rescan or wait.");
     }
 
@@ -1369,7 +1376,10 @@ RPCHelpMan importmulti()
 
         for (const UniValue& data : requests.getValues()) {
             const int64_t timestamp = std::max(GetImportTimestamp(data, now), minimumTimestamp);
-            const UniValue result = ProcessImport(*pwallet, data, timestamp);
+            UniValue result = ProcessImport(*pwallet, data, timestamp);
+            if (fRescan && defer_rescan && result["success"].get_bool()) {
+                result.pushKV("rescan", "deferred");
+            }
             response.push_back(result);
 
             if (!fRescan) {
@@ -1387,7 +1397,9 @@ RPCHelpMan importmulti()
             }
         }
     }
-    if (fRescan && fRunScan && requests.size()) {
+    if (fRescan && fRunScan && requests.size() && defer_rescan) {
+        pwallet->DeferRescan(nLowestTimestamp);
+    } else if (fRescan && fRunScan && requests.size()) {
         int64_t scannedTime = pwallet->RescanFromTime(nLowestTimestamp, reserver, true /* update */);
         pwallet->ResubmitWalletTransactions(/*relay=*/false, /*force=*/true);
 
@@ -1601,6 +1613,11 @@ RPCHelpMan importdescriptors()
                             },
                         },
                         "\"requests\""},
+                    {"options", RPCArg::Type::OBJ, RPCArg::Optional::OMITTED_NAMED_ARG, "",
+                        {
+                            {"defer_rescan", RPCArg::Type::BOOL, RPCArg::Default{false}, "Rescan in the background after the call returns, in one pass with the rescans that other imports defer meanwhile, from the earliest timestamp of them all. Use \"getdeferredrescaninfo\" to query the pass."},
+                        },
+                        "\"options\""},
                 },
                 RPCResult{
                     RPCResult::Type::ARR, "", "Response is an array with the same size as the input that has the execution result",
@@ -1608,6 +1625,7 @@ RPCHelpMan importdescriptors()
                         {RPCResult::Type::OBJ, "", "",
                         {
                             {RPCResult::Type::BOOL, "success", ""},
+                            {RPCResult::Type::STR, "rescan", /*optional=*/true, "\"deferred\" if the rescan for the import was deferred"},
                             {RPCResult::Type::ARR, "warnings", /*optional=*/true, "",
                             {
                                 {RPCResult::Type::STR, "", ""},
@@ -1622,7 +1640,8 @@ RPCHelpMan importdescriptors()
                 RPCExamples{
                     HelpExampleCli("importdescriptors", "'[{ \"desc\": \"<my descriptor>\", \"timestamp\":1455191478, \"internal\": true }, "
                                           "{ \"desc\": \"<my descriptor 2>\", \"label\": \"example 2\", \"timestamp\": 1455191480 }]'") +
-                    HelpExampleCli("importdescriptors", "'[{ \"desc\": \"<my descriptor>\", \"timestamp\":1455191478, \"active\": true, \"range\": [0,100], \"label\": \"<my bech32 wallet>\" }]'")
+                    HelpExampleCli("importdescriptors", "'[{ \"desc\": \"<my descriptor>\", \"timestamp\":1455191478, \"active\": true, \"range\": [0,100], \"label\": \"<my bech32 wallet>\" }]'") +
+                    HelpExampleCli("importdescriptors", "'[{ \"desc\": \"<my descriptor>\", \"timestamp\":1455191478 }]' '{ \"defer_rescan\": true }'")
                 },
         [&](const RPCHelpMan& self, const JSONRPCRequest& main_request) -> UniValue
 {
@@ -1641,8 +1660,11 @@ RPCHelpMan importdescriptors()
 
     RPCTypeCheck(main_request.params, {UniValue::VARR, UniValue::VOBJ});
 
+    const UniValue& options{main_request.params[1]};
+    const bool defer_rescan{!options.isNull() && options.exists("defer_rescan") && options["defer_rescan"].get_bool()};
+
     WalletRescanReserver reserver(*pwallet);
-    if (!reserver.reserve()) {
+    if (!defer_rescan && !reserver.reserve()) {
         throw JSONRPCError(RPC_WALLET_ERROR, "Wallet is currently rescanning. Abort existing rescan or wait.");
     }
 
@@ -1662,7 +1684,10 @@ RPCHelpMan importdescriptors()
         for (const UniValue& request : requests.getValues()) {
             // This throws an error if "timestamp" doesn't exist
             const int64_t timestamp = std::max(GetImportTimestamp(request, now), minimum_timestamp);
-            const UniValue result = ProcessDescriptorImport(*pwallet, request, timestamp);
+            UniValue result = ProcessDescriptorImport(*pwallet, request, timestamp);
+            if (defer_rescan && result["success"].get_bool()) {
+                result.pushKV("rescan", "deferred");
+            }
             response.push_back(result);
 
             if (lowest_timestamp > timestamp ) {
@@ -1678,7 +1703,9 @@ RPCHelpMan importdescriptors()
     }
 
     // Rescan the blockchain using the lowest timestamp
-    if (rescan) {
+    if (rescan && defer_rescan) {
+        pwallet->DeferRescan(lowest_timestamp);
+    } else if (rescan) {
         int64_t scanned_time = pwallet->RescanFromTime(lowest_timestamp, reserver, true /* update */);
         pwallet->ResubmitWalletTransactions(/*relay=*/false, /*force=*/true);
 
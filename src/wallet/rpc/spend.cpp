@@ -1546,6 +1546,112 @@ RPCHelpMan walletprocesspsbt()
     };
 }
 
+RPCHelpMan walletprocesspsbts()
+{
+    return RPCHelpMan{"walletprocesspsbts",
+                "\nUpdate a batch of PSBTs with input information from our wallet and then sign inputs\n"
+                "that we can sign for, like walletprocesspsbt does for each of them. The wallet is\n"
+                "locked once for the whole batch, and large batches are signed in parallel." +
+        HELP_REQUIRING_PASSPHRASE,
+                {
+                    {"psbts", RPCArg::Type::ARR, RPCArg::Optional::NO, "The base64 strings of the transactions",
+                        {
+                            {"psbt", RPCArg::Type::STR, RPCArg::Optional::OMITTED, "A base64 string of a PSBT"},
+                        },
+                    },
+                    {"sign", RPCArg::Type::BOOL, RPCArg::Default{true}, "Also sign the transactions when updating (requires wallet to be unlocked)"},
+                    {"sighashtype", RPCArg::Type::STR, RPCArg::Default{"DEFAULT for Taproot, ALL otherwise"}, "The signature hash type to sign with if not specified by a PSBT. Must be one of\n"
+            "       \"DEFAULT\"\n"
+            "       \"ALL\"\n"
+            "       \"NONE\"\n"
+            "       \"SINGLE\"\n"
+            "       \"ALL|ANYONECANPAY\"\n"
+            "       \"NONE|ANYONECANPAY\"\n"
+            "       \"SINGLE|ANYONECANPAY\""},
+                    {"bip32derivs", RPCArg::Type::BOOL, RPCArg::Default{true}, "Include BIP 32 derivation paths for public keys if we know them"},
+                    {"finalize", RPCArg::Type::BOOL, RPCArg::Default{true}, "Also finalize inputs if possible"},
+                },
+                RPCResult{
+                    RPCResult::Type::ARR, "", "The results in the order of the PSBTs",
+                    {
+                        {RPCResult::Type::OBJ, "", "",
+                        {
+                            {RPCResult::Type::STR, "psbt", /*optional=*/true, "The base64-encoded partially signed transaction, if it could be processed"},
+                            {RPCResult::Type::BOOL, "complete", /*optional=*/true, "If the transaction has a complete set of signatures, if it could be processed"},
+                            {RPCResult::Type::STR, "error", /*optional=*/true, "Why the PSBT could not be processed"},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("walletprocesspsbts", "'[\"psbt\",\"psbt\"]'")
+            + HelpExampleRpc("walletprocesspsbts", "[\"psbt\",\"psbt\"]")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const std::shared_ptr<const CWallet> pwallet = GetWalletForJSONRPCRequest(request);
+    if (!pwallet) return UniValue::VNULL;
+
+    const CWallet& wallet{*pwallet};
+    // Make sure the results are valid at least up to the most recent block
+    // the user could have gotten from another RPC command prior to now
+    wallet.BlockUntilSyncedToCurrentChain();
+
+    RPCTypeCheck(request.params, {UniValue::VARR});
+
+    // Unserialize the transactions, keeping the errors of those that do not decode
+    const UniValue& psbt_strs = request.params[0].get_array();
+    std::vector<PartiallySignedTransaction> psbtxs;
+    std::vector<size_t> positions;
+    std::vector<std::string> decode_errors(psbt_strs.size());
+    for (size_t i = 0; i < psbt_strs.size(); ++i) {
+        PartiallySignedTransaction psbtx;
+        std::string error;
+        if (DecodeBase64PSBT(psbtx, psbt_strs[i].get_str(), error)) {
+            psbtxs.push_back(std::move(psbtx));
+            positions.push_back(i);
+        } else {
+            decode_errors[i] = strprintf("TX decode failed %s", error);
+        }
+    }
+
+    // Get the sighash type
+    int nHashType = ParseSighashString(request.params[2]);
+
+    // Fill the transactions with our data and also sign
+    bool sign = request.params[1].isNull() ? true : request.params[1].get_bool();
+    bool bip32derivs = request.params[3].isNull() ? true : request.params[3].get_bool();
+    bool finalize = request.params[4].isNull() ? true : request.params[4].get_bool();
+
+    if (sign) EnsureWalletIsUnlocked(*pwallet);
+
+    std::vector<PSBTFillResult> fill_results;
+    wallet.FillPSBTs(psbtxs, fill_results, nHashType, sign, bip32derivs, finalize);
+
+    std::vector<UniValue> entries(psbt_strs.size(), UniValue{UniValue::VOBJ});
+    for (size_t i = 0; i < psbt_strs.size(); ++i) {
+        if (!decode_errors[i].empty()) entries[i].pushKV("error", decode_errors[i]);
+    }
+    for (size_t j = 0; j < psbtxs.size(); ++j) {
+        UniValue& entry = entries[positions[j]];
+        if (fill_results[j].error != TransactionError::OK) {
+            entry.pushKV("error", TransactionErrorString(fill_results[j].error).original);
+            continue;
+        }
+        CDataStream ssTx(SER_NETWORK, PROTOCOL_VERSION);
+        ssTx << psbtxs[j];
+        entry.pushKV("psbt", EncodeBase64(ssTx.str()));
+        entry.pushKV("complete", fill_results[j].complete);
+    }
+
+    UniValue result(UniValue::VARR);
+    for (UniValue& entry : entries) {
+        result.push_back(std::move(entry));
+    }
+    return result;
+},
+    };
+}
+
 RPCHelpMan walletcreatefundedpsbt()
 {
     return RPCHelpMan{"walletcreatefundedpsbt",
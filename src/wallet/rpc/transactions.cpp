@@ -6,6 +6,8 @@
 #include <key_io.h>
 #include <policy/rbf.h>
 #include <rpc/util.h>
+#include <util/strencodings.h>
+#include <util/string.h>
 #include <util/vector.h>
 #include <wallet/receive.h>
 #include <wallet/rpc/util.h>
@@ -429,6 +431,32 @@ static const std::vector<RPCResult> TransactionDescriptionString()
            };
 }
 
+/** Encode the position a paged listing continues from as an opaque cursor. */
+static std::string EncodeListCursor(const std::vector<std::string>& fields)
+{
+    return Join(fields, ":");
+}
+
+/** Split a cursor of EncodeListCursor() into its fields, or none for an empty cursor that starts a listing. */
+static std::vector<std::string> DecodeListCursor(const UniValue& cursor, size_t num_fields)
+{
+    if (cursor.get_str().empty()) return {};
+    std::vector<std::string> fields{SplitString(cursor.get_str(), ':')};
+    if (fields.size() != num_fields) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    return fields;
+}
+
+static int64_t ParseListCursorNumber(const std::string& field)
+{
+    int64_t n;
+    if (!ParseInt64(field, &n) || n < 0) {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+    }
+    return n;
+}
+
 RPCHelpMan listtransactions()
 {
     return RPCHelpMan{"listtransactions",
@@ -440,8 +468,11 @@ RPCHelpMan listtransactions()
                     {"count", RPCArg::Type::NUM, RPCArg::Default{10}, "The number of transactions to return"},
                     {"skip", RPCArg::Type::NUM, RPCArg::Default{0}, "The number of transactions to skip"},
                     {"include_watchonly", RPCArg::Type::BOOL, RPCArg::DefaultHint{"true for watch-only wallets, otherwise false"}, "Include transactions to watch-only addresses (see 'importaddress')"},
+                    {"cursor", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "Page through the transactions from newer to older: an empty string for the most recent ones, or\n"
+                          "the next_cursor of the previous page. A page costs its size only, unlike skip, and is not shifted by new transactions."},
                 },
-                RPCResult{
+                RPCResults{
+                    RPCResult{"if cursor is not given",
                     RPCResult::Type::ARR, "", "",
                     {
                         {RPCResult::Type::OBJ, "", "", Cat(Cat<std::vector<RPCResult>>(
@@ -466,13 +497,22 @@ RPCHelpMan listtransactions()
                             {RPCResult::Type::BOOL, "abandoned", /*optional=*/true, "'true' if the transaction has been abandoned (inputs are respendable). Only available for the \n"
                                  "'send' category of transactions."},
                         })},
-                    }
+                    }},
+                    RPCResult{"if cursor is given",
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::ARR, "transactions", "<structure is the same as without cursor>", {{RPCResult::Type::ELISION, "", ""},}},
+                        {RPCResult::Type::STR, "next_cursor", /*optional=*/true, "The cursor of the page of older transactions, if there may be any"},
+                    }},
                 },
                 RPCExamples{
             "\nList the most recent 10 transactions in the systems\n"
             + HelpExampleCli("listtransactions", "") +
             "\nList transactions 100 to 120\n"
             + HelpExampleCli("listtransactions", "\"*\" 20 100") +
+            "\nList the most recent 1000 transactions, then the next 1000 older ones\n"
+            + HelpExampleCli("-named listtransactions", "count=1000 cursor=\"\"")
+            + HelpExampleCli("-named listtransactions", "count=1000 cursor=\"next_cursor\"") +
             "\nAs a JSON-RPC call\n"
             + HelpExampleRpc("listtransactions", "\"*\", 20, 100")
                 },
@@ -509,18 +549,46 @@ RPCHelpMan listtransactions()
     if (nFrom < 0)
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative from");
 
+    // A cursor is the position of the transaction the previous page stopped in, and the number of
+    // its entries that page returned
+    const bool paged{!request.params[4].isNull()};
+    std::optional<std::pair<int64_t, size_t>> cursor;
+    if (paged) {
+        if (nFrom > 0) {
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "skip cannot be combined with cursor");
+        }
+        const std::vector<std::string> fields{DecodeListCursor(request.params[4], 2)};
+        if (!fields.empty()) cursor = std::make_pair(ParseListCursorNumber(fields[0]), ParseListCursorNumber(fields[1]));
+    }
+
     std::vector<UniValue> ret;
+    std::optional<std::pair<int64_t, size_t>> next_cursor;
     {
         LOCK(pwallet->cs_wallet);
 
         const CWallet::TxItems & txOrdered = pwallet->wtxOrdered;
 
         // iterate backwards until we have nCount items to return:
-        for (CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin(); it != txOrdered.rend(); ++it)
+        CWallet::TxItems::const_reverse_iterator it = txOrdered.rbegin();
+        if (cursor) it = CWallet::TxItems::const_reverse_iterator{txOrdered.upper_bound(cursor->first)};
+        for (; it != txOrdered.rend(); ++it)
         {
             CWalletTx *const pwtx = (*it).second;
+            const size_t prev_size{ret.size()};
             ListTransactions(*pwallet, *pwtx, 0, true, ret, filter, filter_label);
-            if ((int)ret.size() >= (nCount+nFrom)) break;
+            // The previous page already returned the first entries of the transaction it stopped in
+            size_t returned{0};
+            if (cursor && it->first == cursor->first) {
+                returned = std::min(cursor->second, ret.size() - prev_size);
+                ret.erase(ret.begin() + prev_size, ret.begin() + prev_size + returned);
+            }
+            if ((int)ret.size() >= (nCount+nFrom)) {
+                const size_t excess{ret.size() - nCount};
+                if (paged && (excess > 0 || std::next(it) != txOrdered.rend())) {
+                    next_cursor = std::make_pair(it->first, returned + ret.size() - prev_size - excess);
+                }
+                break;
+            }
         }
     }
 
@@ -534,7 +602,12 @@ RPCHelpMan listtransactions()
     auto txs_rev_it{std::make_move_iterator(ret.rend())};
     UniValue result{UniValue::VARR};
     result.push_backV(txs_rev_it - nFrom - nCount, txs_rev_it - nFrom); // Return oldest to newest
-    return result;
+    if (!paged) return result;
+
+    UniValue page{UniValue::VOBJ};
+    page.pushKV("transactions", std::move(result));
+    if (next_cursor) page.pushKV("next_cursor", EncodeListCursor({ToString(next_cursor->first), ToString(next_cursor->second)}));
+    return page;
 },
     };
 }
@@ -552,6 +625,10 @@ RPCHelpMan listsinceblock()
                     {"include_removed", RPCArg::Type::BOOL, RPCArg::Default{true}, "Show transactions that were removed due to a reorg in the \"removed\" array\n"
                                                                        "(not guaranteed to work on pruned nodes)"},
                     {"include_change", RPCArg::Type::BOOL, RPCArg::Default{false}, "Also add entries for change outputs.\n"},
+                    {"count", RPCArg::Type::NUM, RPCArg::DefaultHint{"all of them"}, "The number of transaction entries to return in one page"},
+                    {"cursor", RPCArg::Type::STR, RPCArg::Optional::OMITTED_NAMED_ARG, "The next_cursor of the previous page, to continue listing the transactions after it.\n"
+                          "The transactions are listed by block height, with the unconfirmed ones last. Keep the lastblock\n"
+                          "of the first page for the next listsinceblock call, and the removed array is only in the first page."},
                 },
                 RPCResult{
                     RPCResult::Type::OBJ, "", "",
@@ -584,6 +661,7 @@ RPCHelpMan listsinceblock()
                         {RPCResult::Type::ARR, "removed", /*optional=*/true, "<structure is the same as \"transactions\" above, only present if include_removed=true>\n"
                             "Note: transactions that were re-added in the active chain will appear as-is in this array, and may thus have a positive confirmation count."
                         , {{RPCResult::Type::ELISION, "", ""},}},
+                        {RPCResult::Type::STR, "next_cursor", /*optional=*/true, "The cursor of the next page, if count limited this one"},
                         {RPCResult::Type::STR_HEX, "lastblock", "The hash of the block (target_confirmations-1) from the best block on the main chain, or the genesis hash if the referenced block does not exist yet. This is typically used to feed back into listsinceblock the next time you call it. So you would generally use a target_confirmations of say 6, so you will be continually re-notified of transactions until they've reached 6 confirmations plus any new ones"},
                     }
                 },
@@ -634,15 +712,57 @@ RPCHelpMan listsinceblock()
     bool include_removed = (request.params[3].isNull() || request.params[3].get_bool());
     bool include_change = (!request.params[4].isNull() && request.params[4].get_bool());
 
+    std::optional<size_t> count;
+    if (!request.params[5].isNull()) {
+        const int n{request.params[5].getInt<int>()};
+        if (n < 0) throw JSONRPCError(RPC_INVALID_PARAMETER, "Negative count");
+        count = n;
+    }
+    // A cursor is the position of the transaction the previous page stopped in, and the number of
+    // its entries that page returned
+    std::optional<std::pair<CWallet::TxHeightItems::key_type, size_t>> cursor;
+    if (!request.params[6].isNull()) {
+        const std::vector<std::string> fields{DecodeListCursor(request.params[6], 3)};
+        if (!fields.empty()) {
+            const int64_t cursor_height{ParseListCursorNumber(fields[0])};
+            if (cursor_height > std::numeric_limits<int>::max() || !IsHex(fields[1]) || fields[1].size() != 64) {
+                throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+            }
+            cursor = std::make_pair(std::make_pair(int(cursor_height), uint256S(fields[1])), ParseListCursorNumber(fields[2]));
+        }
+        // The transactions removed by a reorg were part of the first page
+        include_removed &= !cursor;
+    }
+
     int depth = height ? wallet.GetLastBlockHeight() + 1 - *height : -1;
 
-    UniValue transactions(UniValue::VARR);
+    std::vector<UniValue> transactions;
+    std::optional<std::pair<CWallet::TxHeightItems::key_type, size_t>> next_cursor;
 
-    for (const std::pair<const uint256, CWalletTx>& pairWtx : wallet.mapWallet) {
-        const CWalletTx& tx = pairWtx.second;
+    // The transactions confirmed or conflicted above the height of the block, and the unconfirmed ones
+    CWallet::TxHeightItems::key_type first{height ? *height + 1 : std::numeric_limits<int>::min(), uint256{}};
+    if (cursor) first = std::max(first, cursor->first);
+    auto it{wallet.m_txs_by_height.lower_bound(first)};
+    for (; it != wallet.m_txs_by_height.end(); ++it) {
+        const CWalletTx& tx = *it->second;
 
         if (depth == -1 || abs(wallet.GetTxDepthInMainChain(tx)) < depth) {
+            const size_t prev_size{transactions.size()};
             ListTransactions(wallet, tx, 0, true, transactions, filter, nullptr /* filter_label */, /*include_change=*/include_change);
+            // The previous page already returned the first entries of the transaction it stopped in
+            size_t returned{0};
+            if (cursor && it->first == cursor->first) {
+                returned = std::min(cursor->second, transactions.size() - prev_size);
+                transactions.erase(transactions.begin() + prev_size, transactions.begin() + prev_size + returned);
+            }
+            if (count && transactions.size() >= *count) {
+                const size_t excess{transactions.size() - *count};
+                if (excess > 0 || std::next(it) != wallet.m_txs_by_height.end()) {
+                    next_cursor = std::make_pair(it->first, returned + transactions.size() - prev_size - excess);
+                }
+                transactions.resize(*count);
+                break;
+            }
         }
     }
 
@@ -671,8 +791,13 @@ RPCHelpMan listsinceblock()
     CHECK_NONFATAL(wallet.chain().findAncestorByHeight(wallet.GetLastBlockHash(), wallet.GetLastBlockHeight() + 1 - target_confirms, FoundBlock().hash(lastblock)));
 
     UniValue ret(UniValue::VOBJ);
-    ret.pushKV("transactions", transactions);
+    UniValue txs_page{UniValue::VARR};
+    txs_page.push_backV(std::make_move_iterator(transactions.begin()), std::make_move_iterator(transactions.end()));
+    ret.pushKV("transactions", std::move(txs_page));
     if (include_removed) ret.pushKV("removed", removed);
+    if (next_cursor) {
+        ret.pushKV("next_cursor", EncodeListCursor({ToString(next_cursor->first.first), next_cursor->first.second.GetHex(), ToString(next_cursor->second)}));
+    }
     ret.pushKV("lastblock", lastblock.GetHex());
 
     return ret;
@@ -946,4 +1071,52 @@ RPCHelpMan abortrescan()
 },
     };
 }
+
+RPCHelpMan getdeferredrescaninfo()
+{
+    return RPCHelpMan{"getdeferredrescaninfo",
+                "\nReturns the state of the rescans deferred by importdescriptors and importmulti calls with defer_rescan set.\n"
+                "Rescans deferred within " + ToString(count_seconds(DEFERRED_RESCAN_DELAY)) + " seconds of each other are merged into one pass from the earliest timestamp of their imports.\n",
+                {},
+                RPCResult{
+                    RPCResult::Type::OBJ, "", "",
+                    {
+                        {RPCResult::Type::NUM, "pending_requests", "The number of imports whose rescan waits for a pass"},
+                        {RPCResult::Type::NUM_TIME, "pending_timestamp", /*optional=*/true, "The timestamp the pending pass scans from, in " + UNIX_EPOCH_TIME},
+                        {RPCResult::Type::BOOL, "scanning", "Whether a pass is running. Use \"getwalletinfo\" to query its progress"},
+                        {RPCResult::Type::OBJ, "last", /*optional=*/true, "The last pass that finished",
+                        {
+                            {RPCResult::Type::NUM, "requests", "The number of imports it rescanned for"},
+                            {RPCResult::Type::NUM_TIME, "timestamp", "The timestamp it scanned from, in " + UNIX_EPOCH_TIME},
+                            {RPCResult::Type::BOOL, "complete", "Whether it read all blocks from the timestamp"},
+                            {RPCResult::Type::BOOL, "aborted", "Whether it was aborted"},
+                        }},
+                    }
+                },
+                RPCExamples{
+                    HelpExampleCli("getdeferredrescaninfo", "")
+            + HelpExampleRpc("getdeferredrescaninfo", "")
+                },
+        [&](const RPCHelpMan& self, const JSONRPCRequest& request) -> UniValue
+{
+    const std::shared_ptr<const CWallet> pwallet = GetWalletForJSONRPCRequest(request);
+    if (!pwallet) return UniValue::VNULL;
+
+    const DeferredRescanInfo info{pwallet->GetDeferredRescanInfo()};
+    UniValue result(UniValue::VOBJ);
+    result.pushKV("pending_requests", info.pending_requests);
+    if (info.pending_time) result.pushKV("pending_timestamp", *info.pending_time);
+    result.pushKV("scanning", info.scanning);
+    if (info.last) {
+        UniValue last(UniValue::VOBJ);
+        last.pushKV("requests", info.last->requests);
+        last.pushKV("timestamp", info.last->time);
+        last.pushKV("complete", info.last->scanned_time <= info.last->time);
+        last.pushKV("aborted", info.last->aborted);
+        result.pushKV("last", last);
+    }
+    return result;
+},
+    };
+}
 } // namespace wallet
@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <checkqueue.h>
 #include <key_io.h>
 #include <logging.h>
 #include <outputtype.h>
@@ -10,11 +11,13 @@
 #include <util/bip32.h>
 #include <util/strencodings.h>
 #include <util/string.h>
+#include <util/syscall_sandbox.h>
 #include <util/system.h>
 #include <util/time.h>
 #include <util/translation.h>
 #include <wallet/scriptpubkeyman.h>
 
+#include <algorithm>
 #include <optional>
 
 namespace wallet {
@@ -2113,6 +2116,57 @@ std::map<CKeyID, CKey> DescriptorScriptPubKeyMan::GetKeys() const
     return m_map_keys;
 }
 
+//! Minimum number of indexes a top-up expands on worker threads
+static constexpr size_t DESCRIPTOR_TOPUP_PARALLEL_MIN_INDEXES{256};
+//! Number of indexes a worker expands in one go while topping up
+static constexpr unsigned int DESCRIPTOR_TOPUP_INDEXES_PER_WORKER{16};
+//! Maximum number of threads expanding a descriptor while topping up
+static constexpr int MAX_DESCRIPTOR_TOPUP_THREADS{8};
+
+/** Scripts, keys and new cache items of a descriptor expanded at one index. */
+struct DescriptorExpansion
+{
+    std::vector<CScript> scripts;
+    FlatSigningProvider out_keys;
+    DescriptorCache cache;
+};
+
+/**
+ * Expands a descriptor at one index, on a worker thread for large top-ups, see
+ * DescriptorScriptPubKeyMan::TopUp(). The descriptor, cache and keys are only read.
+ */
+class DescriptorExpand
+{
+private:
+    const Descriptor* m_descriptor{nullptr};
+    const DescriptorCache* m_cache{nullptr};
+    const FlatSigningProvider* m_provider{nullptr};
+    int32_t m_index{0};
+    DescriptorExpansion* m_expansion{nullptr};
+
+public:
+    DescriptorExpand() = default;
+    DescriptorExpand(const Descriptor& descriptor, const DescriptorCache& cache, const FlatSigningProvider& provider,
+                     int32_t index, DescriptorExpansion& expansion)
+        : m_descriptor(&descriptor), m_cache(&cache), m_provider(&provider), m_index(index), m_expansion(&expansion) {}
+
+    bool operator()()
+    {
+        // Maybe we have a cached xpub and we can expand from the cache first
+        if (m_descriptor->ExpandFromCache(m_index, *m_cache, m_expansion->scripts, m_expansion->out_keys)) return true;
+        return m_descriptor->Expand(m_index, *m_provider, m_expansion->scripts, m_expansion->out_keys, &m_expansion->cache);
+    }
+
+    void swap(DescriptorExpand& check) noexcept
+    {
+        std::swap(m_descriptor, check.m_descriptor);
+        std::swap(m_cache, check.m_cache);
+        std::swap(m_provider, check.m_provider);
+        std::swap(m_index, check.m_index);
+        std::swap(m_expansion, check.m_expansion);
+    }
+};
+
 bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
 {
     LOCK(cs_desc_man);
@@ -2136,42 +2190,72 @@ bool DescriptorScriptPubKeyMan::TopUp(unsigned int size)
     FlatSigningProvider provider;
     provider.keys = GetKeys();
 
+    const int32_t first_index{m_max_cached_index + 1};
+    std::vector<DescriptorExpansion> expansions(std::max(new_range_end - first_index, 0));
+    DescriptorCache new_items;
+    if (!expansions.empty()) {
+        // Expand the first index alone: its cache items hold the parent xpubs, which the others derive from
+        if (!DescriptorExpand{*m_wallet_descriptor.descriptor, m_wallet_descriptor.cache, provider, first_index, expansions[0]}()) return false;
+        new_items = m_wallet_descriptor.cache.MergeAndDiff(expansions[0].cache);
+
+        std::vector<DescriptorExpand> checks;
+        checks.reserve(expansions.size() - 1);
+        for (size_t i = 1; i < expansions.size(); ++i) {
+            checks.emplace_back(*m_wallet_descriptor.descriptor, m_wallet_descriptor.cache, provider, first_index + i, expansions[i]);
+        }
+        if (checks.size() < DESCRIPTOR_TOPUP_PARALLEL_MIN_INDEXES) {
+            for (DescriptorExpand& check : checks) {
+                if (!check()) return false;
+            }
+        } else {
+            CCheckQueue<DescriptorExpand> queue{DESCRIPTOR_TOPUP_INDEXES_PER_WORKER};
+            queue.StartWorkerThreads(std::clamp(GetNumCores() - 1, 0, MAX_DESCRIPTOR_TOPUP_THREADS), "wallettopup",
+                                     SyscallSandboxPolicy::WALLET_TOPUP);
+            bool expanded;
+            {
+                CCheckQueueControl<DescriptorExpand> control(&queue);
+                control.Add(checks);
+                expanded = control.Wait();
+            }
+            queue.StopWorkerThreads();
+            if (!expanded) return false;
+        }
+    }
+
+    // Write the new cache items of all indexes together
+    DatabaseWriteGroup write_group{m_storage.GetDatabase()};
     WalletBatch batch(m_storage.GetDatabase());
     uint256 id = GetID();
-    for (int32_t i = m_max_cached_index + 1; i < new_range_end; ++i) {
-        FlatSigningProvider out_keys;
-        std::vector<CScript> scripts_temp;
-        DescriptorCache temp_cache;
-        // Maybe we have a cached xpub and we can expand from the cache first
-        if (!m_wallet_descriptor.descriptor->ExpandFromCache(i, m_wallet_descriptor.cache, scripts_temp, out_keys)) {
-            if (!m_wallet_descriptor.descriptor->Expand(i, provider, scripts_temp, out_keys, &temp_cache)) return false;
-        }
+    for (size_t i = 0; i < expansions.size(); ++i) {
+        const int32_t index = first_index + i;
+        DescriptorExpansion& expansion{expansions[i]};
         // Add all of the scriptPubKeys to the scriptPubKey set
-        for (const CScript& script : scripts_temp) {
-            m_map_script_pub_keys[script] = i;
+        for (const CScript& script : expansion.scripts) {
+            m_map_script_pub_keys[script] = index;
         }
-        for (const auto& pk_pair : out_keys.pubkeys) {
+        for (const auto& pk_pair : expansion.out_keys.pubkeys) {
             const CPubKey& pubkey = pk_pair.second;
             if (m_map_pubkeys.count(pubkey) != 0) {
                 // We don't need to give an error here.
                 // It doesn't matter which of many valid indexes the pubkey has, we just need an index where we can derive it and it's private key
                 continue;
             }
-            m_map_pubkeys[pubkey] = i;
-        }
-        // Merge and write the cache
-        DescriptorCache new_items = m_wallet_descriptor.cache.MergeAndDiff(temp_cache);
-        if (!batch.WriteDescriptorCacheItems(id, new_items)) {
-            throw std::runtime_error(std::string(__func__) + ": writing cache items failed");
+            m_map_pubkeys[pubkey] = index;
         }
+        // Merge the cache
+        if (i > 0) new_items.MergeAndDiff(m_wallet_descriptor.cache.MergeAndDiff(expansion.cache));
         m_max_cached_index++;
     }
+    if (!batch.WriteDescriptorCacheItems(id, new_items)) {
+        throw std::runtime_error(std::string(__func__) + ": writing cache items failed");
+    }
     m_wallet_descriptor.range_end = new_range_end;
     batch.WriteDescriptor(GetID(), m_wallet_descriptor);
 
     // By this point, the cache size should be the size of the entire range
     assert(m_wallet_descriptor.range_end - 1 == m_max_cached_index);
 
+    if (!expansions.empty()) m_storage.ScriptPubKeysChanged();
     NotifyCanGetAddressesChanged();
     return true;
 }
@@ -2613,6 +2697,7 @@ void DescriptorScriptPubKeyMan::SetCache(const DescriptorCache& cache)
         }
         m_max_cached_index++;
     }
+    m_storage.ScriptPubKeysChanged();
 }
 
 bool DescriptorScriptPubKeyMan::AddKey(const CKeyID& key_id, const CKey& key)
@@ -2654,17 +2739,27 @@ const WalletDescriptor DescriptorScriptPubKeyMan::GetWalletDescriptor() const
 }
 
 const std::unordered_set<CScript, SaltedSipHasher> DescriptorScriptPubKeyMan::GetScriptPubKeys() const
+{
+    return GetScriptPubKeys(0);
+}
+
+const std::unordered_set<CScript, SaltedSipHasher> DescriptorScriptPubKeyMan::GetScriptPubKeys(int32_t minimum_index) const
 {
     LOCK(cs_desc_man);
     std::unordered_set<CScript, SaltedSipHasher> script_pub_keys;
     script_pub_keys.reserve(m_map_script_pub_keys.size());
 
-    for (auto const& script_pub_key: m_map_script_pub_keys) {
-        script_pub_keys.insert(script_pub_key.first);
+    for (auto const& [script_pub_key, index] : m_map_script_pub_keys) {
+        if (index >= minimum_index) script_pub_keys.insert(script_pub_key);
     }
     return script_pub_keys;
 }
 
+int32_t DescriptorScriptPubKeyMan::GetEndRange() const
+{
+    return m_max_cached_index + 1;
+}
+
 bool DescriptorScriptPubKeyMan::GetDescriptorString(std::string& out, const bool priv) const
 {
     LOCK(cs_desc_man);
@@ -2723,6 +2818,7 @@ void DescriptorScriptPubKeyMan::UpdateWalletDescriptor(WalletDescriptor& descrip
     m_map_script_pub_keys.clear();
     m_max_cached_index = -1;
     m_wallet_descriptor = descriptor;
+    m_storage.ScriptPubKeysChanged();
 }
 
 bool DescriptorScriptPubKeyMan::CanUpdateToWalletDescriptor(const WalletDescriptor& descriptor, std::string& error)
@@ -45,6 +45,8 @@ public:
     virtual const CKeyingMaterial& GetEncryptionKey() const = 0;
     virtual bool HasEncryptionKeys() const = 0;
     virtual bool IsLocked() const = 0;
+    //! Called after the scriptPubKeys a ScriptPubKeyMan watches changed
+    virtual void ScriptPubKeysChanged() = 0;
 };
 
 //! Default for -keypool
@@ -643,6 +645,10 @@ public:
 
     const WalletDescriptor GetWalletDescriptor() const EXCLUSIVE_LOCKS_REQUIRED(cs_desc_man);
     const std::unordered_set<CScript, SaltedSipHasher> GetScriptPubKeys() const override;
+    //! Get the scriptPubKeys from descriptor range index minimum_index onwards
+    const std::unordered_set<CScript, SaltedSipHasher> GetScriptPubKeys(int32_t minimum_index) const;
+    //! Get the end of the range of the descriptor, to notice when it was topped up
+    int32_t GetEndRange() const;
 
     bool GetDescriptorString(std::string& out, const bool priv) const;
 
@@ -21,6 +21,7 @@
 #include <wallet/wallet.h>
 
 #include <cmath>
+#include <future>
 
 using interfaces::FoundBlock;
 
@@ -141,6 +142,33 @@ static OutputType GetOutputType(TxoutType type, bool is_from_p2sh)
     }
 }
 
+/** Bring the index of our unspent outputs up to date and return it. */
+static const std::map<uint256, std::vector<unsigned int>>& UpdateUnspentIndex(const CWallet& wallet) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet)
+{
+    CWallet::UnspentIndex& index{wallet.m_unspent_index};
+    const auto update{[&](const uint256& hash, const CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(wallet.cs_wallet) {
+        std::vector<unsigned int> outputs;
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+            if (wallet.IsMine(wtx.tx->vout[i]) != ISMINE_NO && !wallet.IsSpent(COutPoint(hash, i))) outputs.push_back(i);
+        }
+        if (!outputs.empty()) index.outputs.emplace(hash, std::move(outputs));
+    }};
+
+    if (index.all_dirty) {
+        index.outputs.clear();
+        for (const auto& [hash, wtx] : wallet.mapWallet) update(hash, wtx);
+        index.all_dirty = false;
+    } else {
+        for (const uint256& hash : index.dirty) {
+            index.outputs.erase(hash);
+            const auto it{wallet.mapWallet.find(hash)};
+            if (it != wallet.mapWallet.end()) update(hash, it->second);
+        }
+    }
+    index.dirty.clear();
+    return index.outputs;
+}
+
 CoinsResult AvailableCoins(const CWallet& wallet,
                            const CCoinControl* coinControl,
                            std::optional<CFeeRate> feerate,
@@ -161,10 +189,9 @@ CoinsResult AvailableCoins(const CWallet& wallet,
     const bool only_safe = {coinControl ? !coinControl->m_include_unsafe_inputs : true};
 
     std::set<uint256> trusted_parents;
-    for (const auto& entry : wallet.mapWallet)
+    for (const auto& [wtxid, unspent_outputs] : UpdateUnspentIndex(wallet))
     {
-        const uint256& wtxid = entry.first;
-        const CWalletTx& wtx = entry.second;
+        const CWalletTx& wtx = wallet.mapWallet.at(wtxid);
 
         if (wallet.IsTxImmatureCoinBase(wtx))
             continue;
@@ -221,7 +248,7 @@ CoinsResult AvailableCoins(const CWallet& wallet,
 
         bool tx_from_me = CachedTxIsFromMe(wallet, wtx, ISMINE_ALL);
 
-        for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+        for (const unsigned int i : unspent_outputs) {
             const CTxOut& output = wtx.tx->vout[i];
             const COutPoint outpoint(wtxid, i);
 
@@ -501,14 +528,32 @@ std::optional<SelectionResult> ChooseSelectionResult(const CWallet& wallet, cons
     std::vector<SelectionResult> results;
 
     std::vector<OutputGroup> positive_groups = GroupOutputs(wallet, available_coins, coin_selection_params, eligibility_filter, /*positive_only=*/true);
-    if (auto bnb_result{SelectCoinsBnB(positive_groups, nTargetValue, coin_selection_params.m_cost_of_change)}) {
-        results.push_back(*bnb_result);
-    }
-
     // The knapsack solver has some legacy behavior where it will spend dust outputs. We retain this behavior, so don't filter for positive only here.
     std::vector<OutputGroup> all_groups = GroupOutputs(wallet, available_coins, coin_selection_params, eligibility_filter, /*positive_only=*/false);
-    if (auto knapsack_result{KnapsackSolver(all_groups, nTargetValue, coin_selection_params.m_min_change_target, coin_selection_params.rng_fast)}) {
+
+    // BnB only works on (and sorts) positive_groups, so on large pools it runs on a separate
+    // thread while the knapsack solver runs here. SRD waits for it, it selects from the sorted groups.
+    const auto bnb{[&, deadline = SteadyClock::now() + BNB_MAX_SEARCH_TIME] {
+        return SelectCoinsBnB(positive_groups, nTargetValue, coin_selection_params.m_cost_of_change, deadline);
+    }};
+    std::future<std::optional<SelectionResult>> bnb_future;
+    if (positive_groups.size() >= COIN_SELECTION_PARALLEL_MIN_GROUPS) {
+        bnb_future = std::async(std::launch::async, bnb);
+    } else {
+        bnb_future = std::async(std::launch::deferred, bnb);
+        bnb_future.wait();
+    }
+
+    std::optional<SelectionResult> knapsack_result{KnapsackSolver(all_groups, nTargetValue, coin_selection_params.m_min_change_target, coin_selection_params.rng_fast)};
+    if (knapsack_result) {
         knapsack_result->ComputeAndSetWaste(coin_selection_params.min_viable_change, coin_selection_params.m_cost_of_change, coin_selection_params.m_change_fee);
+    }
+
+    // Keep the order of the results of the serial selection
+    if (auto bnb_result{bnb_future.get()}) {
+        results.push_back(*bnb_result);
+    }
+    if (knapsack_result) {
         results.push_back(*knapsack_result);
     }
 
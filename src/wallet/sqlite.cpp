@@ -120,6 +120,21 @@ SQLiteDatabase::SQLiteDatabase(const fs::path& dir_path, const fs::path& file_pa
 
 void SQLiteBatch::SetupSQLStatements()
 {
+    // Reuse the statements a closed batch prepared
+    {
+        LOCK(m_database.m_statements_mutex);
+        if (!m_database.m_statements.empty()) {
+            const auto& statements{m_database.m_statements.back()};
+            m_read_stmt = statements[0];
+            m_insert_stmt = statements[1];
+            m_overwrite_stmt = statements[2];
+            m_delete_stmt = statements[3];
+            m_cursor_stmt = statements[4];
+            m_database.m_statements.pop_back();
+            return;
+        }
+    }
+
     const std::vector<std::pair<sqlite3_stmt**, const char*>> statements{
         {&m_read_stmt, "SELECT value FROM main WHERE key = ?"},
         {&m_insert_stmt, "INSERT INTO main VALUES(?, ?)"},
@@ -144,6 +159,45 @@ SQLiteDatabase::~SQLiteDatabase()
     Cleanup();
 }
 
+bool SQLiteDatabase::Checkpoint(int mode)
+{
+    if (!m_db || m_mock) return true;
+    int log_frames{0};
+    int checkpointed_frames{0};
+    int res = sqlite3_wal_checkpoint_v2(m_db, nullptr, mode, &log_frames, &checkpointed_frames);
+    if (res != SQLITE_OK) {
+        // The log is busy while a transaction is open, try again later
+        if (res != SQLITE_BUSY && res != SQLITE_LOCKED) {
+            LogPrintf("SQLiteDatabase: Failed to checkpoint the write-ahead log: %s\n", sqlite3_errstr(res));
+        }
+        return false;
+    }
+    return log_frames == checkpointed_frames;
+}
+
+void SQLiteDatabase::BeginWriteGroup()
+{
+    if (!m_db || m_write_group_depth++ > 0) return;
+    // If a batch already began a transaction, the writes stay part of it
+    if (sqlite3_get_autocommit(m_db) == 0) return;
+    int res = sqlite3_exec(m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK) {
+        LogPrintf("SQLiteDatabase: Failed to begin the write group transaction: %s\n", sqlite3_errstr(res));
+        return;
+    }
+    m_write_group_txn = true;
+}
+
+void SQLiteDatabase::EndWriteGroup()
+{
+    if (!m_db || m_write_group_depth == 0 || --m_write_group_depth > 0 || !m_write_group_txn) return;
+    m_write_group_txn = false;
+    int res = sqlite3_exec(m_db, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
+    if (res != SQLITE_OK) {
+        LogPrintf("SQLiteDatabase: Failed to commit the write group transaction: %s\n", sqlite3_errstr(res));
+    }
+}
+
 void SQLiteDatabase::Cleanup() noexcept
 {
     Close();
@@ -255,10 +309,14 @@ void SQLiteDatabase::Open()
     // Enable fullfsync for the platforms that use it
     SetPragma(m_db, "fullfsync", "true", "Failed to enable fullfsync");
 
+    // Use a write-ahead log. Commits append to the log, and only checkpoints have to wait
+    // for the database file to be synced, so the normal synchronous mode does not risk corruption.
+    SetPragma(m_db, "journal_mode", "WAL", "Failed to enable the write-ahead log");
     if (m_use_unsafe_sync) {
-        // Use normal synchronous mode for the journal
         LogPrintf("WARNING SQLite is configured to not wait for data to be flushed to disk. Data loss and corruption may occur.\n");
         SetPragma(m_db, "synchronous", "OFF", "Failed to set synchronous mode to OFF");
+    } else {
+        SetPragma(m_db, "synchronous", "NORMAL", "Failed to set synchronous mode to NORMAL");
     }
 
     // Make the table for our key-value pairs
@@ -335,6 +393,15 @@ bool SQLiteDatabase::Backup(const std::string& dest) const
 
 void SQLiteDatabase::Close()
 {
+    {
+        LOCK(m_statements_mutex);
+        for (const auto& statements : m_statements) {
+            for (sqlite3_stmt* stmt : statements) sqlite3_finalize(stmt);
+        }
+        m_statements.clear();
+    }
+    m_write_group_depth = 0;
+    m_write_group_txn = false;
     int res = sqlite3_close(m_db);
     if (res != SQLITE_OK) {
         throw std::runtime_error(strprintf("SQLiteDatabase: Failed to close database: %s\n", sqlite3_errstr(res)));
@@ -359,8 +426,8 @@ SQLiteBatch::SQLiteBatch(SQLiteDatabase& database)
 
 void SQLiteBatch::Close()
 {
-    // If m_db is in a transaction (i.e. not in autocommit mode), then abort the transaction in progress
-    if (m_database.m_db && sqlite3_get_autocommit(m_database.m_db) == 0) {
+    // If this batch began a transaction, then abort the transaction in progress
+    if (m_txn) {
         if (TxnAbort()) {
             LogPrintf("SQLiteBatch: Batch closed unexpectedly without the transaction being explicitly committed or aborted\n");
         } else {
@@ -368,23 +435,16 @@ void SQLiteBatch::Close()
         }
     }
 
-    // Free all of the prepared statements
-    const std::vector<std::pair<sqlite3_stmt**, const char*>> statements{
-        {&m_read_stmt, "read"},
-        {&m_insert_stmt, "insert"},
-        {&m_overwrite_stmt, "overwrite"},
-        {&m_delete_stmt, "delete"},
-        {&m_cursor_stmt, "cursor"},
-    };
-
-    for (const auto& [stmt_prepared, stmt_description] : statements) {
-        int res = sqlite3_finalize(*stmt_prepared);
-        if (res != SQLITE_OK) {
-            LogPrintf("SQLiteBatch: Batch closed but could not finalize %s statement: %s\n",
-                      stmt_description, sqlite3_errstr(res));
-        }
-        *stmt_prepared = nullptr;
+    // Hand the prepared statements to the next batch
+    const std::array<sqlite3_stmt*, 5> statements{m_read_stmt, m_insert_stmt, m_overwrite_stmt, m_delete_stmt, m_cursor_stmt};
+    if (m_read_stmt == nullptr) return;
+    for (sqlite3_stmt* stmt : statements) {
+        sqlite3_reset(stmt);
+        sqlite3_clear_bindings(stmt);
     }
+    m_cursor_init = false;
+    WITH_LOCK(m_database.m_statements_mutex, m_database.m_statements.push_back(statements));
+    m_read_stmt = m_insert_stmt = m_overwrite_stmt = m_delete_stmt = m_cursor_stmt = nullptr;
 }
 
 bool SQLiteBatch::ReadKey(CDataStream&& key, CDataStream& value)
@@ -514,32 +574,42 @@ void SQLiteBatch::CloseCursor()
 
 bool SQLiteBatch::TxnBegin()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) == 0) return false;
-    int res = sqlite3_exec(m_database.m_db, "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
+    if (!m_database.m_db || m_txn) return false;
+    // Within a write group, the transaction is a savepoint of the group's transaction
+    const bool savepoint{m_database.m_write_group_txn};
+    if (!savepoint && sqlite3_get_autocommit(m_database.m_db) == 0) return false;
+    int res = sqlite3_exec(m_database.m_db, savepoint ? "SAVEPOINT batch" : "BEGIN TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to begin the transaction\n");
+        return false;
     }
-    return res == SQLITE_OK;
+    m_txn = true;
+    m_txn_savepoint = savepoint;
+    return true;
 }
 
 bool SQLiteBatch::TxnCommit()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
-    int res = sqlite3_exec(m_database.m_db, "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
+    if (!m_database.m_db || !m_txn) return false;
+    int res = sqlite3_exec(m_database.m_db, m_txn_savepoint ? "RELEASE batch" : "COMMIT TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to commit the transaction\n");
+        return false;
     }
-    return res == SQLITE_OK;
+    m_txn = false;
+    return true;
 }
 
 bool SQLiteBatch::TxnAbort()
 {
-    if (!m_database.m_db || sqlite3_get_autocommit(m_database.m_db) != 0) return false;
-    int res = sqlite3_exec(m_database.m_db, "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
+    if (!m_database.m_db || !m_txn) return false;
+    int res = sqlite3_exec(m_database.m_db, m_txn_savepoint ? "ROLLBACK TO batch; RELEASE batch" : "ROLLBACK TRANSACTION", nullptr, nullptr, nullptr);
     if (res != SQLITE_OK) {
         LogPrintf("SQLiteBatch: Failed to abort the transaction\n");
+        return false;
     }
-    return res == SQLITE_OK;
+    m_txn = false;
+    return true;
 }
 
 std::unique_ptr<SQLiteDatabase> MakeSQLiteDatabase(const fs::path& path, const DatabaseOptions& options, DatabaseStatus& status, bilingual_str& error)
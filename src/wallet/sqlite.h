@@ -5,10 +5,14 @@
 #ifndef BITCOIN_WALLET_SQLITE_H
 #define BITCOIN_WALLET_SQLITE_H
 
+#include <sync.h>
 #include <wallet/db.h>
 
 #include <sqlite3.h>
 
+#include <array>
+#include <vector>
+
 struct bilingual_str;
 
 namespace wallet {
@@ -21,6 +25,9 @@ private:
     SQLiteDatabase& m_database;
 
     bool m_cursor_init = false;
+    //! Whether this batch began a transaction, and whether that is a savepoint within a write group
+    bool m_txn{false};
+    bool m_txn_savepoint{false};
 
     sqlite3_stmt* m_read_stmt{nullptr};
     sqlite3_stmt* m_insert_stmt{nullptr};
@@ -63,8 +70,22 @@ private:
 
     const std::string m_file_path;
 
+    //! Prepared statements of closed batches, to be reused by new ones
+    Mutex m_statements_mutex;
+    std::vector<std::array<sqlite3_stmt*, 5>> m_statements GUARDED_BY(m_statements_mutex);
+
+    //! Nesting depth of the write groups, and whether the outermost one began a transaction.
+    //! Write groups are only used with the wallet lock held.
+    int m_write_group_depth{0};
+    bool m_write_group_txn{false};
+
     void Cleanup() noexcept;
 
+    /** Move the write-ahead log into the database file. Returns false if it could not be done completely. */
+    bool Checkpoint(int mode);
+
+    friend class SQLiteBatch;
+
 public:
     SQLiteDatabase() = delete;
 
@@ -92,18 +113,21 @@ public:
      */
     bool Backup(const std::string& dest) const override;
 
-    /** No-ops
-     *
-     * SQLite always flushes everything to the database file after each transaction
-     * (each Read/Write/Erase that we do is its own transaction unless we called
-     * TxnBegin) so there is no need to have Flush or Periodic Flush.
+    /**
+     * SQLite commits everything to the write-ahead log after each transaction (each
+     * Read/Write/Erase that we do is its own transaction unless we called TxnBegin or
+     * are in a write group). Flush and PeriodicFlush checkpoint the log into the
+     * database file, which SQLite also does by itself once the log grows large.
      *
      * There is no DB env to reload, so ReloadDbEnv has nothing to do
      */
-    void Flush() override {}
-    bool PeriodicFlush() override { return false; }
+    void Flush() override { Checkpoint(SQLITE_CHECKPOINT_TRUNCATE); }
+    bool PeriodicFlush() override { return Checkpoint(SQLITE_CHECKPOINT_PASSIVE); }
     void ReloadDbEnv() override {}
 
+    void BeginWriteGroup() override;
+    void EndWriteGroup() override;
+
     void IncrementUpdateCounter() override { ++nUpdateCounter; }
 
     std::string Filename() override { return m_file_path; }
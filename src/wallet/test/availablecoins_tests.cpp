@@ -103,5 +103,28 @@ BOOST_FIXTURE_TEST_CASE(BasicOutputTypesTest, AvailableCoinsTestingSetup)
     BOOST_CHECK_EQUAL(available_coins.coins[OutputType::LEGACY].size(), 2U);
 }
 
+BOOST_FIXTURE_TEST_CASE(UnspentIndexTest, AvailableCoinsTestingSetup)
+{
+    LOCK(wallet->cs_wallet);
+    const CoinsResult coinbase_coins{AvailableCoins(*wallet)};
+    BOOST_REQUIRE_EQUAL(coinbase_coins.Size(), 1U);
+    const COutPoint coinbase_outpoint{coinbase_coins.All().at(0).outpoint};
+    BOOST_CHECK(wallet->m_unspent_index.outputs.count(coinbase_outpoint.hash));
+
+    // A self transfer spends the coinbase and adds its two outputs to the index
+    const auto dest{wallet->GetNewDestination(OutputType::BECH32, "")};
+    BOOST_REQUIRE(dest);
+    const uint256 txid{AddTx(CRecipient{{GetScriptForDestination(*dest)}, 1 * COIN, /*fSubtractFeeFromAmount=*/true}).GetHash()};
+    BOOST_CHECK_EQUAL(AvailableCoins(*wallet).Size(), 2U);
+    BOOST_CHECK(!wallet->m_unspent_index.outputs.count(coinbase_outpoint.hash));
+    BOOST_CHECK_EQUAL(wallet->m_unspent_index.outputs.at(txid).size(), 2U);
+
+    // Rebuilding the index from all transactions gives the same outputs
+    const auto outputs{wallet->m_unspent_index.outputs};
+    wallet->MarkDirty();
+    BOOST_CHECK_EQUAL(AvailableCoins(*wallet).Size(), 2U);
+    BOOST_CHECK(wallet->m_unspent_index.outputs == outputs);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
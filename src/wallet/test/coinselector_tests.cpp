@@ -252,6 +252,8 @@ BOOST_AUTO_TEST_CASE(bnb_search_test)
     target = make_hard_case(14, utxo_pool);
     const auto result7 = SelectCoinsBnB(GroupCoins(utxo_pool), target, 1); // Should not exhaust
     BOOST_CHECK(result7);
+    // The search ends at the deadline, before finding the solution
+    BOOST_CHECK(!SelectCoinsBnB(GroupCoins(utxo_pool), target, 1, SteadyClock::now() - 1s));
 
     // Test same value early bailout optimization
     utxo_pool.clear();
@@ -3,10 +3,12 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include <key.h>
+#include <script/descriptor.h>
 #include <script/standard.h>
 #include <test/util/setup_common.h>
 #include <wallet/scriptpubkeyman.h>
 #include <wallet/wallet.h>
+#include <wallet/walletdb.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -39,5 +41,44 @@ BOOST_AUTO_TEST_CASE(CanProvide)
     BOOST_CHECK(keyman.CanProvide(p2sh_script, data));
 }
 
+// Test that DescriptorScriptPubKeyMan::TopUp derives the same scripts when expanding
+// large ranges on worker threads, for unhardened and hardened derivation.
+BOOST_AUTO_TEST_CASE(DescriptorTopUp)
+{
+    CWallet wallet(m_node.chain.get(), "", m_args, CreateMockWalletDatabase());
+    LOCK(wallet.cs_wallet);
+    wallet.SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+
+    const std::string xprv{"xprv9s21ZrQH143K31xYSDQpPDxsXRTUcvj2iNHm5NUtrGiGG5e2DtALGdso3pGz6ssrdK4PFmM8NSpSBHNqPqm55Qn3LqFtT2emdEXVYsCzC2U"};
+    for (const std::string& descriptor : {"wpkh(" + xprv + "/0/*)", "wpkh(" + xprv + "/1h/*h)"}) {
+        FlatSigningProvider provider;
+        std::string error;
+        std::unique_ptr<Descriptor> desc = Parse(descriptor, provider, error, /*require_checksum=*/false);
+        BOOST_REQUIRE(desc);
+        // Expand the first indexes one at a time to compare with
+        std::vector<CScript> expected;
+        for (int32_t i = 0; i < 1500; ++i) {
+            std::vector<CScript> scripts;
+            FlatSigningProvider out_keys;
+            BOOST_REQUIRE(desc->Expand(i, provider, scripts, out_keys));
+            expected.insert(expected.end(), scripts.begin(), scripts.end());
+        }
+
+        WalletDescriptor w_desc(std::move(desc), 0, 0, 0, 0);
+        BOOST_REQUIRE(wallet.AddWalletDescriptor(w_desc, provider, "", false));
+        DescriptorScriptPubKeyMan* spk_man = wallet.GetDescriptorScriptPubKeyMan(w_desc);
+        BOOST_REQUIRE(spk_man);
+        BOOST_CHECK_EQUAL(spk_man->GetScriptPubKeys().size(), size_t{DEFAULT_KEYPOOL_SIZE});
+
+        // Extend the range
+        BOOST_REQUIRE(spk_man->TopUp(1500));
+        const auto spks{spk_man->GetScriptPubKeys()};
+        BOOST_CHECK_EQUAL(spks.size(), expected.size());
+        for (const CScript& script : expected) {
+            BOOST_CHECK(spks.count(script));
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
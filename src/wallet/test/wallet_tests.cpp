@@ -376,6 +376,50 @@ BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_immature_credit, TestChain100Setup)
     BOOST_CHECK_EQUAL(CachedTxGetImmatureCredit(wallet, wtx, ISMINE_SPENDABLE), 50*COIN);
 }
 
+// Check that spending an output only invalidates the cached amounts that
+// depend on it, and that a spender seen before its parent debits it.
+BOOST_FIXTURE_TEST_CASE(coin_mark_dirty_spends, TestChain100Setup)
+{
+    CWallet wallet(m_node.chain.get(), "", m_args, CreateDummyWalletDatabase());
+    wallet.SetWalletFlag(WALLET_FLAG_DESCRIPTORS);
+    wallet.SetupDescriptorScriptPubKeyMans();
+    AddKey(wallet, coinbaseKey);
+    LOCK(wallet.cs_wallet);
+
+    CMutableTransaction parent;
+    parent.vin.emplace_back(COutPoint{InsecureRand256(), 0});
+    parent.vout.emplace_back(10 * COIN, GetScriptForRawPubKey(coinbaseKey.GetPubKey()));
+    CMutableTransaction child;
+    child.vin.emplace_back(COutPoint{parent.GetHash(), 0});
+    child.vout.emplace_back(9 * COIN, CScript() << OP_TRUE);
+
+    const CWalletTx* child_wtx{wallet.AddToWallet(MakeTransactionRef(child), TxStateInactive{})};
+    BOOST_REQUIRE(child_wtx);
+    BOOST_CHECK_EQUAL(CachedTxGetDebit(wallet, *child_wtx, ISMINE_SPENDABLE), 0);
+
+    const CWalletTx* parent_wtx{wallet.AddToWallet(MakeTransactionRef(parent), TxStateInactive{})};
+    BOOST_REQUIRE(parent_wtx);
+    BOOST_CHECK_EQUAL(CachedTxGetDebit(wallet, *child_wtx, ISMINE_SPENDABLE), 10 * COIN);
+    BOOST_CHECK_EQUAL(CachedTxGetCredit(wallet, *parent_wtx, ISMINE_SPENDABLE), 10 * COIN);
+    BOOST_CHECK_EQUAL(CachedTxGetAvailableCredit(wallet, *parent_wtx, ISMINE_SPENDABLE), 0);
+
+    // Abandoning the spender makes the output available again, without recomputing the credit
+    BOOST_CHECK(wallet.AbandonTransaction(child.GetHash()));
+    BOOST_CHECK(parent_wtx->m_amounts[CWalletTx::CREDIT].m_cached[ISMINE_SPENDABLE]);
+    BOOST_CHECK(!parent_wtx->m_amounts[CWalletTx::AVAILABLE_CREDIT].m_cached[ISMINE_SPENDABLE]);
+    BOOST_CHECK_EQUAL(CachedTxGetAvailableCredit(wallet, *parent_wtx, ISMINE_SPENDABLE), 10 * COIN);
+
+    BOOST_CHECK(wallet.AddToWallet(MakeTransactionRef(child), TxStateInMempool{}));
+    BOOST_CHECK_EQUAL(CachedTxGetAvailableCredit(wallet, *parent_wtx, ISMINE_SPENDABLE), 0);
+
+    // A state change that keeps the output spent leaves the caches alone
+    const CBlockIndex* tip{WITH_LOCK(::cs_main, return m_node.chainman->ActiveChain().Tip())};
+    wallet.SetLastBlockProcessed(tip->nHeight, tip->GetBlockHash());
+    BOOST_CHECK(wallet.AddToWallet(MakeTransactionRef(child), TxStateConfirmed{tip->GetBlockHash(), tip->nHeight, /*index=*/1}));
+    BOOST_CHECK(parent_wtx->m_amounts[CWalletTx::AVAILABLE_CREDIT].m_cached[ISMINE_SPENDABLE]);
+    BOOST_CHECK(child_wtx->m_amounts[CWalletTx::DEBIT].m_cached[ISMINE_SPENDABLE]);
+}
+
 static int64_t AddTx(ChainstateManager& chainman, CWallet& wallet, uint32_t lockTime, int64_t mockTime, int64_t blockTime)
 {
     CMutableTransaction tx;
@@ -385,7 +429,7 @@ static int64_t AddTx(ChainstateManager& chainman, CWallet& wallet, uint32_t lock
     CBlockIndex* block = nullptr;
     if (blockTime > 0) {
         LOCK(cs_main);
-        auto inserted = chainman.BlockIndex().emplace(std::piecewise_construct, std::make_tuple(GetRandHash()), std::make_tuple());
+        auto inserted = chainman.BlockIndex().try_emplace(GetRandHash());
         assert(inserted.second);
         const uint256& hash = inserted.first->first;
         block = &inserted.first->second;
@@ -622,6 +666,47 @@ BOOST_FIXTURE_TEST_CASE(ListCoinsTest, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2U);
 }
 
+/** Compare the running totals of the default balance with a balance computed from scratch. */
+static void CheckBalanceCache(const CWallet& wallet)
+{
+    const Balance cached{GetBalance(wallet)};
+    // Without WALLET_FLAG_AVOID_REUSE this is the same balance, but it is not cached
+    const Balance uncached{GetBalance(wallet, /*min_depth=*/0, /*avoid_reuse=*/false)};
+    BOOST_CHECK_EQUAL(cached.m_mine_trusted, uncached.m_mine_trusted);
+    BOOST_CHECK_EQUAL(cached.m_mine_untrusted_pending, uncached.m_mine_untrusted_pending);
+    BOOST_CHECK_EQUAL(cached.m_mine_immature, uncached.m_mine_immature);
+    BOOST_CHECK_EQUAL(cached.m_watchonly_trusted, uncached.m_watchonly_trusted);
+    BOOST_CHECK_EQUAL(cached.m_watchonly_untrusted_pending, uncached.m_watchonly_untrusted_pending);
+    BOOST_CHECK_EQUAL(cached.m_watchonly_immature, uncached.m_watchonly_immature);
+}
+
+BOOST_FIXTURE_TEST_CASE(balance_cache, ListCoinsTestingSetup)
+{
+    CheckBalanceCache(*wallet);
+    BOOST_CHECK_EQUAL(GetBalance(*wallet).m_mine_trusted, 50 * COIN);
+
+    // A confirmed payment spends the coinbase and adds the change
+    AddTx(CRecipient{GetScriptForRawPubKey({}), 1 * COIN, /*fSubtractFeeFromAmount=*/false});
+    CheckBalanceCache(*wallet);
+    const CAmount confirmed{GetBalance(*wallet).m_mine_trusted};
+    BOOST_CHECK(confirmed < 49 * COIN && confirmed > 48 * COIN);
+
+    // An unconfirmed payment from the wallet spends the change and is trusted
+    CCoinControl coin_control;
+    auto res{CreateTransaction(*wallet, {CRecipient{GetScriptForRawPubKey({}), 1 * COIN, /*fSubtractFeeFromAmount=*/false}},
+                               /*change_pos=*/-1, coin_control)};
+    BOOST_REQUIRE(res);
+    wallet->CommitTransaction(res->tx, {}, {});
+    CheckBalanceCache(*wallet);
+    const CAmount pending{GetBalance(*wallet).m_mine_trusted};
+    BOOST_CHECK(pending < confirmed - 1 * COIN && pending > confirmed - 2 * COIN);
+
+    // Rebuilding all contributions gives the same totals
+    wallet->MarkDirty();
+    CheckBalanceCache(*wallet);
+    BOOST_CHECK_EQUAL(GetBalance(*wallet).m_mine_trusted, pending);
+}
+
 BOOST_FIXTURE_TEST_CASE(wallet_disableprivkeys, TestChain100Setup)
 {
     {
@@ -724,6 +809,30 @@ BOOST_FIXTURE_TEST_CASE(wallet_descriptor_test, BasicTestingSetup)
 //! wallet rescan and notifications are immediately synced, to verify the wallet
 //! must already have a handler in place for them, and there's no gap after
 //! rescanning where new transactions in new blocks could be lost.
+BOOST_FIXTURE_TEST_CASE(script_pub_key_filter, BasicTestingSetup)
+{
+    ScriptPubKeyFilter filter;
+    const CScript script{GetScriptForDestination(WitnessV0ScriptHash{InsecureRand256()})};
+    BOOST_CHECK(!filter.MayContain(script));
+
+    std::vector<CScript> inserted;
+    for (int i = 0; i < 1000; ++i) {
+        inserted.push_back(GetScriptForDestination(WitnessV0ScriptHash{InsecureRand256()}));
+    }
+    filter.Reset(inserted.size());
+    for (const CScript& spk : inserted) filter.Insert(spk);
+    // Inserted scripts are never ruled out, and few others pass
+    for (const CScript& spk : inserted) BOOST_CHECK(filter.MayContain(spk));
+    int false_positives{0};
+    for (int i = 0; i < 10000; ++i) {
+        false_positives += filter.MayContain(GetScriptForDestination(WitnessV0ScriptHash{InsecureRand256()}));
+    }
+    BOOST_CHECK(false_positives < 100);
+
+    filter.Reset(0);
+    BOOST_CHECK(!filter.MayContain(inserted[0]));
+}
+
 BOOST_FIXTURE_TEST_CASE(CreateWallet, TestChain100Setup)
 {
     m_args.ForceSetArg("-unsafesqlitesync", "1");
@@ -6,6 +6,7 @@
 #include <clientversion.h>
 #include <streams.h>
 #include <uint256.h>
+#include <wallet/walletdb.h>
 
 #include <boost/test/unit_test.hpp>
 
@@ -27,5 +28,36 @@ BOOST_AUTO_TEST_CASE(walletdb_readkeyvalue)
     BOOST_CHECK_THROW(ssValue >> dummy, std::ios_base::failure);
 }
 
+#ifdef USE_SQLITE
+BOOST_AUTO_TEST_CASE(walletdb_sqlite_write_group)
+{
+    DatabaseOptions options;
+    options.require_format = DatabaseFormat::SQLITE;
+    std::unique_ptr<WalletDatabase> database{CreateMockWalletDatabase(options)};
+    {
+        DatabaseWriteGroup group{*database};
+        std::unique_ptr<DatabaseBatch> batch{database->MakeBatch()};
+        BOOST_CHECK(batch->Write(std::string{"kept"}, 1));
+
+        // The transaction of a batch inside the group only rolls back its own writes
+        std::unique_ptr<DatabaseBatch> nested{database->MakeBatch()};
+        BOOST_CHECK(nested->TxnBegin());
+        BOOST_CHECK(nested->Write(std::string{"dropped"}, 2));
+        BOOST_CHECK(nested->TxnAbort());
+        BOOST_CHECK(nested->TxnBegin());
+        BOOST_CHECK(nested->Write(std::string{"committed"}, 3));
+        BOOST_CHECK(nested->TxnCommit());
+    }
+
+    std::unique_ptr<DatabaseBatch> batch{database->MakeBatch()};
+    int value{0};
+    BOOST_CHECK(batch->Read(std::string{"kept"}, value));
+    BOOST_CHECK_EQUAL(value, 1);
+    BOOST_CHECK(batch->Read(std::string{"committed"}, value));
+    BOOST_CHECK_EQUAL(value, 3);
+    BOOST_CHECK(!batch->Exists(std::string{"dropped"}));
+}
+#endif // USE_SQLITE
+
 BOOST_AUTO_TEST_SUITE_END()
 } // namespace wallet
@@ -184,6 +184,7 @@ public:
     bool fFromMe;
     int64_t nOrderPos; //!< position in ordered transaction list
     std::multimap<int64_t, CWalletTx*>::const_iterator m_it_wtxOrdered;
+    std::map<std::pair<int, uint256>, CWalletTx*>::const_iterator m_it_txs_by_height; //!< position in CWallet::m_txs_by_height
 
     // memory only
     enum AmountType { DEBIT, CREDIT, IMMATURE_CREDIT, AVAILABLE_CREDIT, AMOUNTTYPE_ENUM_ELEMENTS };
@@ -242,6 +243,15 @@ public:
 
     template<typename Stream>
     void Unserialize(Stream& s)
+    {
+        CTransactionRef serialized_tx;
+        s >> serialized_tx;
+        Unserialize(s, std::move(serialized_tx));
+    }
+
+    /** Unserialize the fields following the transaction, which was already read from the stream. */
+    template<typename Stream>
+    void Unserialize(Stream& s, CTransactionRef serialized_tx)
     {
         Init();
 
@@ -250,7 +260,8 @@ public:
         bool dummy_bool; //! Used to be fSpent
         uint256 serialized_block_hash;
         int serializedIndex;
-        s >> tx >> serialized_block_hash >> dummy_vector1 >> serializedIndex >> dummy_vector2 >> mapValue >> vOrderForm >> fTimeReceivedIsTxTime >> nTimeReceived >> fFromMe >> dummy_bool;
+        tx = std::move(serialized_tx);
+        s >> serialized_block_hash >> dummy_vector1 >> serializedIndex >> dummy_vector2 >> mapValue >> vOrderForm >> fTimeReceivedIsTxTime >> nTimeReceived >> fFromMe >> dummy_bool;
 
         m_state = TxStateInterpretSerialized({serialized_block_hash, serializedIndex});
 
@@ -281,6 +292,18 @@ public:
         m_is_cache_empty = true;
     }
 
+    //! make sure the debit is recalculated after a transaction it spends from was added
+    void MarkDebitDirty()
+    {
+        m_amounts[DEBIT].Reset();
+    }
+
+    //! make sure the available credit is recalculated after outputs were spent or unspent, or their addresses used
+    void MarkAvailableCreditDirty()
+    {
+        m_amounts[AVAILABLE_CREDIT].Reset();
+    }
+
     /** True if only scriptSigs are different */
     bool IsEquivalentTo(const CWalletTx& tx) const;
 
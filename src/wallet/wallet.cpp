@@ -5,16 +5,21 @@
 
 #include <wallet/wallet.h>
 
+#include <blockfilter.h>
 #include <chain.h>
+#include <checkqueue.h>
 #include <consensus/amount.h>
 #include <consensus/consensus.h>
 #include <consensus/validation.h>
+#include <core_memusage.h>
+#include <crypto/siphash.h>
 #include <external_signer.h>
 #include <fs.h>
 #include <interfaces/chain.h>
 #include <interfaces/wallet.h>
 #include <key.h>
 #include <key_io.h>
+#include <memusage.h>
 #include <outputtype.h>
 #include <policy/fees.h>
 #include <policy/policy.h>
@@ -33,6 +38,8 @@
 #include <util/moneystr.h>
 #include <util/rbf.h>
 #include <util/string.h>
+#include <util/syscall_sandbox.h>
+#include <util/thread.h>
 #include <util/translation.h>
 #include <wallet/coincontrol.h>
 #include <wallet/context.h>
@@ -44,6 +51,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <optional>
+#include <unordered_set>
 
 using interfaces::FoundBlock;
 
@@ -106,6 +114,23 @@ static void RefreshMempoolStatus(CWalletTx& tx, interfaces::Chain& chain)
     }
 }
 
+/** Position of a transaction in CWallet::m_txs_by_height for its current state. */
+static std::pair<int, uint256> TxHeightKey(const CWalletTx& wtx)
+{
+    if (auto* conf = wtx.state<TxStateConfirmed>()) return {conf->confirmed_block_height, wtx.GetHash()};
+    if (auto* conf = wtx.state<TxStateConflicted>()) return {conf->conflicting_block_height, wtx.GetHash()};
+    return {std::numeric_limits<int>::max(), wtx.GetHash()};
+}
+
+void CWallet::UpdateTxHeightIndex(CWalletTx& wtx)
+{
+    AssertLockHeld(cs_wallet);
+    std::pair<int, uint256> key{TxHeightKey(wtx)};
+    if (wtx.m_it_txs_by_height->first == key) return;
+    m_txs_by_height.erase(wtx.m_it_txs_by_height);
+    wtx.m_it_txs_by_height = m_txs_by_height.emplace(std::move(key), &wtx).first;
+}
+
 bool AddWallet(WalletContext& context, const std::shared_ptr<CWallet>& wallet)
 {
     LOCK(context.wallets_mutex);
@@ -434,6 +459,20 @@ const CWalletTx* CWallet::GetWalletTx(const uint256& hash) const
     return &(it->second);
 }
 
+size_t CWallet::DynamicMemoryUsage() const
+{
+    LOCK(cs_wallet);
+    size_t usage{memusage::DynamicUsage(mapWallet)};
+    for (const auto& [_, wtx] : mapWallet) {
+        usage += RecursiveDynamicUsage(wtx.tx);
+    }
+    // memusage does not know multimaps, their nodes are those of the maps
+    usage += memusage::MallocUsage(sizeof(memusage::unordered_node<std::pair<const COutPoint, uint256>>)) * mapTxSpends.size() +
+             memusage::MallocUsage(sizeof(void*) * mapTxSpends.bucket_count());
+    usage += memusage::MallocUsage(sizeof(memusage::stl_tree_node<std::pair<const int64_t, CWalletTx*>>)) * wtxOrdered.size();
+    return usage;
+}
+
 void CWallet::UpgradeKeyMetadata()
 {
     if (IsLocked() || IsWalletFlagSet(WALLET_FLAG_KEY_ORIGIN_METADATA)) {
@@ -658,15 +697,19 @@ bool CWallet::IsSpent(const COutPoint& outpoint) const
     for (TxSpends::const_iterator it = range.first; it != range.second; ++it) {
         const uint256& wtxid = it->second;
         const auto mit = mapWallet.find(wtxid);
-        if (mit != mapWallet.end()) {
-            int depth = GetTxDepthInMainChain(mit->second);
-            if (depth > 0  || (depth == 0 && !mit->second.isAbandoned()))
-                return true; // Spent
+        if (mit != mapWallet.end() && SpendsInputs(mit->second)) {
+            return true; // Spent
         }
     }
     return false;
 }
 
+bool CWallet::SpendsInputs(const CWalletTx& wtx) const
+{
+    int depth = GetTxDepthInMainChain(wtx);
+    return depth > 0 || (depth == 0 && !wtx.isAbandoned());
+}
+
 void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid, WalletBatch* batch)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
@@ -870,6 +913,35 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        m_balance_cache.all_dirty = true;
+        m_unspent_index.all_dirty = true;
+    }
+}
+
+void CWallet::MarkBalanceDirty(const uint256& hash) const
+{
+    AssertLockHeld(cs_wallet);
+    if (!m_unspent_index.all_dirty) m_unspent_index.dirty.insert(hash);
+    if (m_balance_cache.all_dirty) return;
+
+    std::vector<uint256> todo{hash};
+    while (!todo.empty()) {
+        const uint256 now{todo.back()};
+        todo.pop_back();
+        if (!m_balance_cache.dirty.insert(now).second) continue;
+        const auto it{mapWallet.find(now)};
+        if (it == mapWallet.end()) continue;
+        // Whether an unconfirmed spender is trusted depends on this transaction;
+        // confirmed and conflicted ones do not depend on their parents.
+        for (unsigned int i = 0; i < it->second.tx->vout.size(); ++i) {
+            const auto range{mapTxSpends.equal_range(COutPoint(now, i))};
+            for (auto spend = range.first; spend != range.second; ++spend) {
+                const auto spender{mapWallet.find(spend->second)};
+                if (spender != mapWallet.end() && GetTxDepthInMainChain(spender->second) == 0) {
+                    todo.push_back(spend->second);
+                }
+            }
+        }
     }
 }
 
@@ -891,6 +963,8 @@ bool CWallet::MarkReplaced(const uint256& originalHash, const uint256& newHash)
 
     // Refresh mempool status without waiting for transactionRemovedFromMempool or transactionAddedToMempool
     RefreshMempoolStatus(wtx, chain());
+    UpdateTxHeightIndex(wtx);
+    MarkBalanceDirty(originalHash);
 
     WalletBatch batch(GetDatabase());
 
@@ -979,11 +1053,13 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
     auto ret = mapWallet.emplace(std::piecewise_construct, std::forward_as_tuple(hash), std::forward_as_tuple(tx, state));
     CWalletTx& wtx = (*ret.first).second;
     bool fInsertedNew = ret.second;
+    const bool spent_inputs{!fInsertedNew && SpendsInputs(wtx)};
     bool fUpdated = update_wtx && update_wtx(wtx, fInsertedNew);
     if (fInsertedNew) {
         wtx.nTimeReceived = GetTime();
         wtx.nOrderPos = IncOrderPosNext(&batch);
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
+        wtx.m_it_txs_by_height = m_txs_by_height.emplace(TxHeightKey(wtx), &wtx).first;
         wtx.nTimeSmart = ComputeTimeSmart(wtx, rescanning_old_block);
         AddToSpends(wtx, &batch);
     }
@@ -997,6 +1073,7 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
             assert(TxStateSerializedIndex(wtx.m_state) == TxStateSerializedIndex(state));
             assert(TxStateSerializedBlockHash(wtx.m_state) == TxStateSerializedBlockHash(state));
         }
+        UpdateTxHeightIndex(wtx);
         // If we have a witness-stripped version of this transaction, and we
         // see a new version with a witness, then we must be upgrading a pre-segwit
         // wallet.  Store the new version of the transaction with the witness,
@@ -1016,8 +1093,23 @@ CWalletTx* CWallet::AddToWallet(CTransactionRef tx, const TxState& state, const
         if (!batch.WriteTx(wtx))
             return nullptr;
 
-    // Break debit/credit balance caches:
-    wtx.MarkDirty();
+    // Break debit/credit balance caches. The cached amounts of the transaction
+    // itself do not depend on its state, only those of its relatives do.
+    if (fInsertedNew) {
+        // Transactions spending its outputs, if seen first, now debit them
+        for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
+            const auto range{mapTxSpends.equal_range(COutPoint(hash, i))};
+            for (auto spend = range.first; spend != range.second; ++spend) {
+                const auto spender{mapWallet.find(spend->second)};
+                if (spender != mapWallet.end()) spender->second.MarkDebitDirty();
+            }
+        }
+    }
+    // If a transaction starts or stops spending its inputs, like when it is
+    // added or changes 'conflicted' state, that changes the balance available
+    // of the outputs it spends. So force those to be recomputed.
+    if (SpendsInputs(wtx) != spent_inputs) MarkInputsDirty(wtx.tx);
+    MarkBalanceDirty(hash);
 
     // Notify UI of new or updated transaction
     NotifyTransactionChanged(hash, fInsertedNew ? CT_NEW : CT_UPDATED);
@@ -1083,6 +1175,9 @@ bool CWallet::LoadToWallet(const uint256& hash, const UpdateWalletTxFn& fill_wtx
     }
     if (/* insertion took place */ ins.second) {
         wtx.m_it_wtxOrdered = wtxOrdered.insert(std::make_pair(wtx.nOrderPos, &wtx));
+        wtx.m_it_txs_by_height = m_txs_by_height.emplace(TxHeightKey(wtx), &wtx).first;
+    } else {
+        UpdateTxHeightIndex(wtx);
     }
     AddToSpends(wtx);
     for (const CTxIn& txin : wtx.tx->vin) {
@@ -1175,7 +1270,8 @@ void CWallet::MarkInputsDirty(const CTransactionRef& tx)
     for (const CTxIn& txin : tx->vin) {
         auto it = mapWallet.find(txin.prevout.hash);
         if (it != mapWallet.end()) {
-            it->second.MarkDirty();
+            it->second.MarkAvailableCreditDirty();
+            MarkBalanceDirty(it->first);
         }
     }
 }
@@ -1214,7 +1310,8 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
             // If the orig tx was not in block/mempool, none of its spends can be in mempool
             assert(!wtx.InMempool());
             wtx.m_state = TxStateInactive{/*abandoned=*/true};
-            wtx.MarkDirty();
+            UpdateTxHeightIndex(wtx);
+            MarkBalanceDirty(now);
             batch.WriteTx(wtx);
             NotifyTransactionChanged(wtx.GetHash(), CT_UPDATED);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them abandoned too
@@ -1267,7 +1364,8 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
             // Block is 'more conflicted' than current confirm; update.
             // Mark transaction as conflicted with this block.
             wtx.m_state = TxStateConflicted{hashBlock, conflicting_height};
-            wtx.MarkDirty();
+            UpdateTxHeightIndex(wtx);
+            MarkBalanceDirty(now);
             batch.WriteTx(wtx);
             // Iterate over all its outputs, and mark transactions in the wallet that spend them conflicted too
             for (unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
@@ -1287,13 +1385,9 @@ void CWallet::MarkConflicted(const uint256& hashBlock, int conflicting_height, c
 
 void CWallet::SyncTransaction(const CTransactionRef& ptx, const SyncTxState& state, bool update_tx, bool rescanning_old_block)
 {
-    if (!AddToWalletIfInvolvingMe(ptx, state, update_tx, rescanning_old_block))
-        return; // Not one of ours
-
-    // If a transaction changes 'conflicted' state, that changes the balance
-    // available of the outputs it spends. So force those to be
-    // recomputed, also:
-    MarkInputsDirty(ptx);
+    // AddToWallet() marks the outputs the transaction spends dirty if it
+    // starts or stops spending them.
+    AddToWalletIfInvolvingMe(ptx, state, update_tx, rescanning_old_block);
 }
 
 void CWallet::transactionAddedToMempool(const CTransactionRef& tx, uint64_t mempool_sequence) {
@@ -1303,6 +1397,8 @@ void CWallet::transactionAddedToMempool(const CTransactionRef& tx, uint64_t memp
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
+        UpdateTxHeightIndex(it->second);
+        MarkBalanceDirty(it->first);
     }
 }
 
@@ -1311,6 +1407,8 @@ void CWallet::transactionRemovedFromMempool(const CTransactionRef& tx, MemPoolRe
     auto it = mapWallet.find(tx->GetHash());
     if (it != mapWallet.end()) {
         RefreshMempoolStatus(it->second, chain());
+        UpdateTxHeightIndex(it->second);
+        MarkBalanceDirty(it->first);
     }
     // Handle transactions that were removed from the mempool because they
     // conflict with transactions in a newly connected block.
@@ -1350,6 +1448,10 @@ void CWallet::blockConnected(const interfaces::BlockInfo& block)
 
     m_last_block_processed_height = block.height;
     m_last_block_processed = block.hash;
+    // Coinbase outputs mature with every block
+    for (const uint256& hash : m_balance_cache.immature) MarkBalanceDirty(hash);
+    // Commit the transactions of the block together
+    DatabaseWriteGroup write_group{GetDatabase()};
     for (size_t index = 0; index < block.data->vtx.size(); index++) {
         SyncTransaction(block.data->vtx[index], TxStateConfirmed{block.hash, block.height, static_cast<int>(index)});
         transactionRemovedFromMempool(block.data->vtx[index], MemPoolRemovalReason::BLOCK, 0 /* mempool_sequence */);
@@ -1367,6 +1469,9 @@ void CWallet::blockDisconnected(const interfaces::BlockInfo& block)
     // future with a stickier abandoned state or even removing abandontransaction call.
     m_last_block_processed_height = block.height - 1;
     m_last_block_processed = *Assert(block.prev_hash);
+    // The depth of all transactions, including conflicted ones, changes
+    m_balance_cache.all_dirty = true;
+    m_unspent_index.all_dirty = true;
     for (const CTransactionRef& ptx : Assert(block.data)->vtx) {
         SyncTransaction(ptx, TxStateInactive{});
     }
@@ -1384,7 +1489,7 @@ void CWallet::BlockUntilSyncedToCurrentChain() const {
     // for the queue to drain enough to execute it (indicating we are caught up
     // at least with the time we entered this function).
     uint256 last_block_hash = WITH_LOCK(cs_wallet, return m_last_block_processed);
-    chain().waitForNotificationsIfTipChanged(last_block_hash);
+    chain().waitForNotificationsIfTipChanged(last_block_hash, *this);
 }
 
 // Note that this function doesn't distinguish between a 0-valued input,
@@ -1417,9 +1522,65 @@ isminetype CWallet::IsMine(const CTxDestination& dest) const
     return IsMine(GetScriptForDestination(dest));
 }
 
+ScriptPubKeyFilter::ScriptPubKeyFilter()
+    : m_k0{GetRand<uint64_t>()}, m_k1{GetRand<uint64_t>()} {}
+
+uint64_t ScriptPubKeyFilter::Hash(const CScript& script) const
+{
+    return CSipHasher(m_k0, m_k1).Write(script.data(), script.size()).Finalize();
+}
+
+void ScriptPubKeyFilter::Reset(size_t scripts)
+{
+    // Round up to a power of two, so that bits are picked with a mask
+    uint64_t bits{64};
+    while (bits < scripts * BITS_PER_SCRIPT) bits <<= 1;
+    m_bits.assign(bits / 64, 0);
+    m_mask = bits - 1;
+}
+
+void ScriptPubKeyFilter::Insert(const CScript& script)
+{
+    const uint64_t hash{Hash(script)};
+    // Derive the bits from the two halves of the hash; the odd step visits distinct bits
+    const uint64_t step{(hash >> 32) | 1};
+    for (int i = 0; i < HASH_FUNCS; ++i) {
+        const uint64_t bit{(hash + i * step) & m_mask};
+        m_bits[bit / 64] |= uint64_t{1} << (bit % 64);
+    }
+}
+
+bool ScriptPubKeyFilter::MayContain(const CScript& script) const
+{
+    if (m_bits.empty()) return false;
+    const uint64_t hash{Hash(script)};
+    const uint64_t step{(hash >> 32) | 1};
+    for (int i = 0; i < HASH_FUNCS; ++i) {
+        const uint64_t bit{(hash + i * step) & m_mask};
+        if (!(m_bits[bit / 64] & (uint64_t{1} << (bit % 64)))) return false;
+    }
+    return true;
+}
+
 isminetype CWallet::IsMine(const CScript& script) const
 {
     AssertLockHeld(cs_wallet);
+    if (IsWalletFlagSet(WALLET_FLAG_DESCRIPTORS)) {
+        if (m_spk_filter_dirty.exchange(false) || m_spk_filter_managers != m_spk_managers.size()) {
+            std::vector<std::unordered_set<CScript, SaltedSipHasher>> spks;
+            size_t count{0};
+            for (const auto& spk_man_pair : m_spk_managers) {
+                count += spks.emplace_back(spk_man_pair.second->GetScriptPubKeys()).size();
+            }
+            m_spk_filter.Reset(count);
+            for (const auto& spk_man_spks : spks) {
+                for (const CScript& spk : spk_man_spks) m_spk_filter.Insert(spk);
+            }
+            m_spk_filter_managers = m_spk_managers.size();
+        }
+        // Most scripts are not ours
+        if (!m_spk_filter.MayContain(script)) return ISMINE_NO;
+    }
     isminetype result = ISMINE_NO;
     for (const auto& spk_man_pair : m_spk_managers) {
         result = std::max(result, spk_man_pair.second->IsMine(script));
@@ -1494,6 +1655,8 @@ void CWallet::SetWalletFlag(uint64_t flags)
 {
     LOCK(cs_wallet);
     m_wallet_flags |= flags;
+    // Whether used addresses count towards the balance depends on WALLET_FLAG_AVOID_REUSE
+    m_balance_cache.all_dirty = true;
     if (!WalletBatch(GetDatabase()).WriteWalletFlags(m_wallet_flags))
         throw std::runtime_error(std::string(__func__) + ": writing wallet flags failed");
 }
@@ -1508,6 +1671,7 @@ void CWallet::UnsetWalletFlagWithDB(WalletBatch& batch, uint64_t flag)
 {
     LOCK(cs_wallet);
     m_wallet_flags &= ~flag;
+    m_balance_cache.all_dirty = true;
     if (!batch.WriteWalletFlags(m_wallet_flags))
         throw std::runtime_error(std::string(__func__) + ": writing wallet flags failed");
 }
@@ -1722,6 +1886,145 @@ int64_t CWallet::RescanFromTime(int64_t startTime, const WalletRescanReserver& r
     return startTime;
 }
 
+void CWallet::DeferRescan(int64_t time)
+{
+    {
+        LOCK(m_deferred_rescan_mutex);
+        if (m_deferred_rescan_stop) return;
+        auto& pending{m_deferred_rescan.pending_time};
+        pending = pending ? std::min(*pending, time) : time;
+        ++m_deferred_rescan.pending_requests;
+        m_deferred_rescan_start = SteadyClock::now() + DEFERRED_RESCAN_DELAY;
+        if (!m_deferred_rescan_thread.joinable()) {
+            m_deferred_rescan_thread = std::thread(&util::TraceThread, "walletrescan", [this] { ThreadDeferredRescan(); });
+        }
+    }
+    m_deferred_rescan_cv.notify_all();
+    WalletLogPrintf("Deferred rescan from time %d\n", time);
+}
+
+DeferredRescanInfo CWallet::GetDeferredRescanInfo() const
+{
+    return WITH_LOCK(m_deferred_rescan_mutex, return m_deferred_rescan);
+}
+
+void CWallet::StopDeferredRescan()
+{
+    std::thread thread;
+    {
+        LOCK(m_deferred_rescan_mutex);
+        m_deferred_rescan_stop = true;
+        if (m_deferred_rescan.scanning) AbortRescan();
+        thread = std::move(m_deferred_rescan_thread);
+    }
+    m_deferred_rescan_cv.notify_all();
+    if (thread.joinable()) thread.join();
+}
+
+void CWallet::ThreadDeferredRescan()
+{
+    WAIT_LOCK(m_deferred_rescan_mutex, lock);
+    while (true) {
+        m_deferred_rescan_cv.wait(lock, [&]() EXCLUSIVE_LOCKS_REQUIRED(m_deferred_rescan_mutex) { return m_deferred_rescan.pending_time || m_deferred_rescan_stop; });
+        if (m_deferred_rescan_stop) return;
+        // Wait for the imports that follow, until none came for DEFERRED_RESCAN_DELAY
+        if (SteadyClock::now() < m_deferred_rescan_start) {
+            m_deferred_rescan_cv.wait_until(lock, m_deferred_rescan_start);
+            continue;
+        }
+
+        DeferredRescanInfo::Pass pass{*m_deferred_rescan.pending_time, m_deferred_rescan.pending_requests, /*scanned_time=*/0, /*aborted=*/false};
+        m_deferred_rescan.pending_time.reset();
+        m_deferred_rescan.pending_requests = 0;
+        m_deferred_rescan.scanning = true;
+        bool reserved{false};
+        {
+            REVERSE_LOCK(lock);
+            WalletRescanReserver reserver(*this);
+            reserved = reserver.reserve();
+            if (reserved) {
+                WalletLogPrintf("Deferred rescan of %d imports from time %d\n", pass.requests, pass.time);
+                pass.scanned_time = RescanFromTime(pass.time, reserver, /*update=*/true);
+                ResubmitWalletTransactions(/*relay=*/false, /*force=*/true);
+                pass.aborted = IsAbortingRescan();
+            }
+        }
+        m_deferred_rescan.scanning = false;
+        if (!reserved) {
+            // Another rescan is running, merge the pass with the imports that follow
+            auto& pending{m_deferred_rescan.pending_time};
+            pending = pending ? std::min(*pending, pass.time) : pass.time;
+            m_deferred_rescan.pending_requests += pass.requests;
+            m_deferred_rescan_start = SteadyClock::now() + DEFERRED_RESCAN_DELAY;
+            continue;
+        }
+        m_deferred_rescan.last = pass;
+    }
+}
+
+namespace {
+/**
+ * The set of the scriptPubKeys of a descriptor wallet, to skip the blocks of
+ * a rescan whose BIP 158 basic filter matches none of them. Filters include
+ * the scripts of spent outputs, so this finds blocks spending from the wallet
+ * as well as paying to it.
+ */
+class FastWalletRescanFilter
+{
+public:
+    FastWalletRescanFilter(const CWallet& wallet) : m_wallet(wallet)
+    {
+        // create initial filter with scripts from all ScriptPubKeyMans
+        for (auto spkm : m_wallet.GetAllScriptPubKeyMans()) {
+            auto desc_spkm{dynamic_cast<DescriptorScriptPubKeyMan*>(spkm)};
+            assert(desc_spkm != nullptr);
+            AddScriptPubKeys(desc_spkm);
+            // save each range descriptor's end for possible future filter updates
+            if (desc_spkm->IsHDEnabled()) {
+                m_last_range_ends.emplace(desc_spkm->GetID(), desc_spkm->GetEndRange());
+            }
+        }
+    }
+
+    void UpdateIfNeeded()
+    {
+        // repopulate filter with new scripts if top-up has happened since last iteration
+        for (auto& [desc_spkm_id, last_range_end] : m_last_range_ends) {
+            auto desc_spkm{dynamic_cast<DescriptorScriptPubKeyMan*>(m_wallet.GetScriptPubKeyMan(desc_spkm_id))};
+            assert(desc_spkm != nullptr);
+            int32_t current_range_end{desc_spkm->GetEndRange()};
+            if (current_range_end > last_range_end) {
+                AddScriptPubKeys(desc_spkm, last_range_end);
+                last_range_end = current_range_end;
+            }
+        }
+    }
+
+    std::optional<bool> MatchesBlock(const uint256& block_hash) const
+    {
+        return m_wallet.chain().blockFilterMatchesAny(BlockFilterType::BASIC, block_hash, m_filter_set);
+    }
+
+private:
+    const CWallet& m_wallet;
+    /** Map for keeping track of each range descriptor's last seen end range.
+      * This information is used to detect whether new addresses were derived
+      * (that is, if the current end range is larger than the saved end range)
+      * after processing a block and hence a filter set update is needed to
+      * take possible keypool top-ups into account.
+      */
+    std::map<uint256, int32_t> m_last_range_ends;
+    GCSFilter::ElementSet m_filter_set;
+
+    void AddScriptPubKeys(const DescriptorScriptPubKeyMan* desc_spkm, int32_t last_range_end = 0)
+    {
+        for (const auto& script_pub_key : desc_spkm->GetScriptPubKeys(last_range_end)) {
+            m_filter_set.emplace(script_pub_key.begin(), script_pub_key.end());
+        }
+    }
+};
+} // namespace
+
 /**
  * Scan the block chain (starting in start_block) for transactions
  * from or to us. If fUpdate is true, found transactions that already
@@ -1755,7 +2058,11 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
     uint256 block_hash = start_block;
     ScanResult result;
 
-    WalletLogPrintf("Rescan started from block %s...\n", start_block.ToString());
+    std::unique_ptr<FastWalletRescanFilter> fast_rescan_filter;
+    if (!IsLegacy() && chain().hasBlockFilterIndex(BlockFilterType::BASIC)) fast_rescan_filter = std::make_unique<FastWalletRescanFilter>(*this);
+
+    WalletLogPrintf("Rescan started from block %s... (%s)\n", start_block.ToString(),
+                    fast_rescan_filter ? "fast variant using block filters" : "slow variant inspecting all blocks");
 
     fAbortRescan = false;
     ShowProgress(strprintf("%s " + _("Rescanning…").translated, GetDisplayName()), 0); // show rescan progress in GUI as dialog or on splashscreen, if rescan required on startup (e.g. due to corruption)
@@ -1782,46 +2089,70 @@ CWallet::ScanResult CWallet::ScanForWalletTransactions(const uint256& start_bloc
             WalletLogPrintf("Still rescanning. At block %d. Progress=%f\n", block_height, progress_current);
         }
 
-        // Read block data
-        CBlock block;
-        chain().findBlock(block_hash, FoundBlock().data(block));
+        // Only read and inspect blocks whose filter matches the wallet, and
+        // those without a filter
+        bool fetch_block{true};
+        if (fast_rescan_filter) {
+            fast_rescan_filter->UpdateIfNeeded();
+            auto matches_block{fast_rescan_filter->MatchesBlock(block_hash)};
+            if (matches_block.has_value()) {
+                if (*matches_block) {
+                    LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (filter matched)\n", block_height, block_hash.ToString());
+                } else {
+                    result.last_scanned_block = block_hash;
+                    result.last_scanned_height = block_height;
+                    fetch_block = false;
+                }
+            } else {
+                LogPrint(BCLog::SCAN, "Fast rescan: inspect block %d [%s] (WARNING: block filter not found!)\n", block_height, block_hash.ToString());
+            }
+        }
 
-        // Find next block separately from reading data above, because reading
+        // Find next block separately from reading data below, because reading
         // is slow and there might be a reorg while it is read.
         bool block_still_active = false;
         bool next_block = false;
         uint256 next_block_hash;
         chain().findBlock(block_hash, FoundBlock().inActiveChain(block_still_active).nextBlock(FoundBlock().inActiveChain(next_block).hash(next_block_hash)));
 
-        if (!block.IsNull()) {
-            LOCK(cs_wallet);
-            if (!block_still_active) {
-                // Abort scan if current block is no longer active, to prevent
-                // marking transactions as coming from the wrong block.
+        if (fetch_block) {
+            // Read block data, and the blocks after it meanwhile unless a
+            // filter leaves most of them out
+            int prefetch{fast_rescan_filter ? 0 : RESCAN_PREFETCH_BLOCKS};
+            if (max_height) prefetch = std::min(prefetch, *max_height - block_height);
+            const std::shared_ptr<const CBlock> block{chain().readBlockAhead(block_hash, prefetch)};
+
+            if (block) {
+                LOCK(cs_wallet);
+                if (!block_still_active) {
+                    // Abort scan if current block is no longer active, to prevent
+                    // marking transactions as coming from the wrong block.
+                    result.last_failed_block = block_hash;
+                    result.status = ScanResult::FAILURE;
+                    break;
+                }
+                DatabaseWriteGroup write_group{GetDatabase()};
+                for (size_t posInBlock = 0; posInBlock < block->vtx.size(); ++posInBlock) {
+                    SyncTransaction(block->vtx[posInBlock], TxStateConfirmed{block_hash, block_height, static_cast<int>(posInBlock)}, fUpdate, /*rescanning_old_block=*/true);
+                }
+                // scan succeeded, record block as most recent successfully scanned
+                result.last_scanned_block = block_hash;
+                result.last_scanned_height = block_height;
+            } else {
+                // could not scan block, keep scanning but record this block as the most recent failure
                 result.last_failed_block = block_hash;
                 result.status = ScanResult::FAILURE;
-                break;
-            }
-            for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                SyncTransaction(block.vtx[posInBlock], TxStateConfirmed{block_hash, block_height, static_cast<int>(posInBlock)}, fUpdate, /*rescanning_old_block=*/true);
             }
-            // scan succeeded, record block as most recent successfully scanned
-            result.last_scanned_block = block_hash;
-            result.last_scanned_height = block_height;
+        }
 
-            if (save_progress && next_interval) {
-                CBlockLocator loc = m_chain->getActiveChainLocator(block_hash);
+        if (save_progress && next_interval && result.last_scanned_block == block_hash) {
+            CBlockLocator loc = m_chain->getActiveChainLocator(block_hash);
 
-                if (!loc.IsNull()) {
-                    WalletLogPrintf("Saving scan progress %d.\n", block_height);
-                    WalletBatch batch(GetDatabase());
-                    batch.WriteBestBlock(loc);
-                }
+            if (!loc.IsNull()) {
+                WalletLogPrintf("Saving scan progress %d.\n", block_height);
+                WalletBatch batch(GetDatabase());
+                batch.WriteBestBlock(loc);
             }
-        } else {
-            // could not scan block, keep scanning but record this block as the most recent failure
-            result.last_failed_block = block_hash;
-            result.status = ScanResult::FAILURE;
         }
         if (max_height && block_height >= *max_height) {
             break;
@@ -1890,7 +2221,10 @@ bool CWallet::SubmitTxMemoryPoolAndRelay(CWalletTx& wtx, std::string& err_string
     // If transaction was previously in the mempool, it should be updated when
     // TransactionRemovedFromMempool fires.
     bool ret = chain().broadcastTransaction(wtx.tx, m_default_max_tx_fee, relay, err_string);
-    if (ret) wtx.m_state = TxStateInMempool{};
+    if (ret) {
+        wtx.m_state = TxStateInMempool{};
+        MarkBalanceDirty(wtx.GetHash());
+    }
     return ret;
 }
 
@@ -2033,12 +2367,9 @@ bool CWallet::SignTransaction(CMutableTransaction& tx, const std::map<COutPoint,
     return false;
 }
 
-TransactionError CWallet::FillPSBT(PartiallySignedTransaction& psbtx, bool& complete, int sighash_type, bool sign, bool bip32derivs, size_t * n_signed, bool finalize) const
+void CWallet::FillPSBTUtxos(PartiallySignedTransaction& psbtx) const
 {
-    if (n_signed) {
-        *n_signed = 0;
-    }
-    LOCK(cs_wallet);
+    AssertLockHeld(cs_wallet);
     // Get all of the previous transactions
     for (unsigned int i = 0; i < psbtx.tx->vin.size(); ++i) {
         const CTxIn& txin = psbtx.tx->vin[i];
@@ -2060,11 +2391,17 @@ TransactionError CWallet::FillPSBT(PartiallySignedTransaction& psbtx, bool& comp
             }
         }
     }
+}
 
+/** Fills out a PSBT from the given ScriptPubKeyMans once its UTXOs are known, see CWallet::FillPSBT(). */
+static TransactionError FillPSBTFromScriptPubKeyMans(const std::set<ScriptPubKeyMan*>& spk_mans, PartiallySignedTransaction& psbtx,
+                                                     bool& complete, int sighash_type, bool sign, bool bip32derivs,
+                                                     size_t* n_signed, bool finalize)
+{
     const PrecomputedTransactionData txdata = PrecomputePSBTData(psbtx);
 
     // Fill in information from ScriptPubKeyMans
-    for (ScriptPubKeyMan* spk_man : GetAllScriptPubKeyMans()) {
+    for (ScriptPubKeyMan* spk_man : spk_mans) {
         int n_signed_this_spkm = 0;
         TransactionError res = spk_man->FillPSBT(psbtx, txdata, sighash_type, sign, bip32derivs, &n_signed_this_spkm, finalize);
         if (res != TransactionError::OK) {
@@ -2114,6 +2451,95 @@ TransactionError CWallet::FillPSBT(PartiallySignedTransaction& psbtx, bool& comp
     return TransactionError::OK;
 }
 
+TransactionError CWallet::FillPSBT(PartiallySignedTransaction& psbtx, bool& complete, int sighash_type, bool sign, bool bip32derivs, size_t * n_signed, bool finalize) const
+{
+    if (n_signed) {
+        *n_signed = 0;
+    }
+    LOCK(cs_wallet);
+    FillPSBTUtxos(psbtx);
+    return FillPSBTFromScriptPubKeyMans(GetAllScriptPubKeyMans(), psbtx, complete, sighash_type, sign, bip32derivs, n_signed, finalize);
+}
+
+//! Minimum number of PSBTs a batch signs on worker threads
+static constexpr size_t PSBT_BATCH_PARALLEL_MIN{4};
+//! Maximum number of threads signing a batch of PSBTs
+static constexpr int MAX_PSBT_BATCH_THREADS{8};
+
+/** Fills out one PSBT of a batch, on a worker thread for large batches, see CWallet::FillPSBTs(). */
+class PSBTFill
+{
+private:
+    const std::set<ScriptPubKeyMan*>* m_spk_mans{nullptr};
+    PartiallySignedTransaction* m_psbtx{nullptr};
+    PSBTFillResult* m_result{nullptr};
+    int m_sighash_type{SIGHASH_DEFAULT};
+    bool m_sign{true};
+    bool m_bip32derivs{true};
+    bool m_finalize{true};
+
+public:
+    PSBTFill() = default;
+    PSBTFill(const std::set<ScriptPubKeyMan*>& spk_mans, PartiallySignedTransaction& psbtx, PSBTFillResult& result,
+             int sighash_type, bool sign, bool bip32derivs, bool finalize)
+        : m_spk_mans(&spk_mans), m_psbtx(&psbtx), m_result(&result), m_sighash_type(sighash_type), m_sign(sign),
+          m_bip32derivs(bip32derivs), m_finalize(finalize) {}
+
+    bool operator()()
+    {
+        m_result->error = FillPSBTFromScriptPubKeyMans(*m_spk_mans, *m_psbtx, m_result->complete, m_sighash_type,
+                                                       m_sign, m_bip32derivs, /*n_signed=*/nullptr, m_finalize);
+        // An error only concerns its own PSBT, the rest of the batch goes on
+        return true;
+    }
+
+    void swap(PSBTFill& check) noexcept
+    {
+        std::swap(m_spk_mans, check.m_spk_mans);
+        std::swap(m_psbtx, check.m_psbtx);
+        std::swap(m_result, check.m_result);
+        std::swap(m_sighash_type, check.m_sighash_type);
+        std::swap(m_sign, check.m_sign);
+        std::swap(m_bip32derivs, check.m_bip32derivs);
+        std::swap(m_finalize, check.m_finalize);
+    }
+};
+
+void CWallet::FillPSBTs(std::vector<PartiallySignedTransaction>& psbtxs, std::vector<PSBTFillResult>& results, int sighash_type, bool sign, bool bip32derivs, bool finalize) const
+{
+    results.assign(psbtxs.size(), PSBTFillResult{});
+    LOCK(cs_wallet);
+    for (PartiallySignedTransaction& psbtx : psbtxs) {
+        FillPSBTUtxos(psbtx);
+    }
+
+    const std::set<ScriptPubKeyMan*> spk_mans{GetAllScriptPubKeyMans()};
+    std::vector<PSBTFill> checks;
+    checks.reserve(psbtxs.size());
+    for (size_t i = 0; i < psbtxs.size(); ++i) {
+        checks.emplace_back(spk_mans, psbtxs[i], results[i], sighash_type, sign, bip32derivs, finalize);
+    }
+
+    // The keys of an encrypted wallet are only reachable through cs_wallet, which this thread
+    // holds, and an external signer is asked for one transaction at a time
+    if (checks.size() < PSBT_BATCH_PARALLEL_MIN || IsCrypted() || IsWalletFlagSet(WALLET_FLAG_EXTERNAL_SIGNER)) {
+        for (PSBTFill& check : checks) {
+            check();
+        }
+        return;
+    }
+
+    CCheckQueue<PSBTFill> queue{/*nBatchSizeIn=*/1};
+    queue.StartWorkerThreads(std::clamp(GetNumCores() - 1, 0, MAX_PSBT_BATCH_THREADS), "walletpsbt",
+                             SyscallSandboxPolicy::WALLET_PSBT);
+    {
+        CCheckQueueControl<PSBTFill> control(&queue);
+        control.Add(checks);
+        control.Wait();
+    }
+    queue.StopWorkerThreads();
+}
+
 SigningResult CWallet::SignMessage(const std::string& message, const PKHash& pkhash, std::string& str_sig) const
 {
     SignatureData sigdata;
@@ -2212,10 +2638,9 @@ void CWallet::CommitTransaction(CTransactionRef tx, mapValue_t mapValue, std::ve
         throw std::runtime_error(std::string(__func__) + ": Wallet db error, transaction commit failed");
     }
 
-    // Notify that old coins are spent
+    // Notify that old coins are spent, AddToWallet() marked them dirty
     for (const CTxIn& txin : tx->vin) {
         CWalletTx &coin = mapWallet.at(txin.prevout.hash);
-        coin.MarkDirty();
         NotifyTransactionChanged(coin.GetHash(), CT_UPDATED);
     }
 
@@ -2261,11 +2686,14 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     for (const uint256& hash : vHashOut) {
         const auto& it = mapWallet.find(hash);
         wtxOrdered.erase(it->second.m_it_wtxOrdered);
+        m_txs_by_height.erase(it->second.m_it_txs_by_height);
         for (const auto& txin : it->second.tx->vin)
             mapTxSpends.erase(txin.prevout);
         mapWallet.erase(it);
         NotifyTransactionChanged(hash, CT_DELETED);
     }
+    m_balance_cache.all_dirty = true;
+    m_unspent_index.all_dirty = true;
 
     if (nZapSelectTxRet == DBErrors::NEED_REWRITE)
     {
@@ -2371,6 +2799,8 @@ unsigned int CWallet::GetKeyPoolSize() const
 bool CWallet::TopUpKeyPool(unsigned int kpSize)
 {
     LOCK(cs_wallet);
+    // Commit the new keys together rather than one by one
+    DatabaseWriteGroup write_group{GetDatabase()};
     bool res = true;
     for (auto spk_man : GetActiveScriptPubKeyMans()) {
         res &= spk_man->TopUp(kpSize);
@@ -2423,11 +2853,12 @@ std::optional<int64_t> CWallet::GetOldestKeyPoolTime() const
 void CWallet::MarkDestinationsDirty(const std::set<CTxDestination>& destinations) {
     for (auto& entry : mapWallet) {
         CWalletTx& wtx = entry.second;
-        if (wtx.m_is_cache_empty) continue;
+        if (wtx.m_is_cache_empty && !m_balance_cache.contributions.count(entry.first)) continue;
         for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
             CTxDestination dst;
             if (ExtractDestination(wtx.tx->vout[i].scriptPubKey, dst) && destinations.count(dst)) {
-                wtx.MarkDirty();
+                wtx.MarkAvailableCreditDirty();
+                MarkBalanceDirty(entry.first);
                 break;
             }
         }
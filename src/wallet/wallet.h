@@ -20,6 +20,7 @@
 #include <util/strencodings.h>
 #include <util/string.h>
 #include <util/system.h>
+#include <util/time.h>
 #include <util/ui_change_type.h>
 #include <validationinterface.h>
 #include <wallet/crypter.h>
@@ -30,6 +31,8 @@
 
 #include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <map>
 #include <memory>
 #include <optional>
@@ -37,6 +40,7 @@
 #include <stdexcept>
 #include <stdint.h>
 #include <string>
+#include <thread>
 #include <utility>
 #include <unordered_map>
 #include <vector>
@@ -114,6 +118,10 @@ constexpr CAmount HIGH_TX_FEE_PER_KB{COIN / 100};
 constexpr CAmount HIGH_MAX_TX_FEE{100 * HIGH_TX_FEE_PER_KB};
 //! Pre-calculated constants for input size estimation in *virtual size*
 static constexpr size_t DUMMY_NESTED_P2WPKH_INPUT_SIZE = 91;
+//! Blocks a rescan has read ahead of the one it inspects
+static constexpr int RESCAN_PREFETCH_BLOCKS{16};
+//! Time a deferred rescan waits for more imports to merge with after the last one
+static constexpr auto DEFERRED_RESCAN_DELAY{5s};
 
 class CCoinControl;
 class CWalletTx;
@@ -228,7 +236,68 @@ struct CRecipient
     bool fSubtractFeeFromAmount;
 };
 
+struct Balance {
+    CAmount m_mine_trusted{0};           //!< Trusted, at depth=GetBalance.min_depth or more
+    CAmount m_mine_untrusted_pending{0}; //!< Untrusted, but in mempool (pending)
+    CAmount m_mine_immature{0};          //!< Immature coinbases in the main chain
+    CAmount m_watchonly_trusted{0};
+    CAmount m_watchonly_untrusted_pending{0};
+    CAmount m_watchonly_immature{0};
+};
+
+/** Outcome of filling one PSBT of a batch, see CWallet::FillPSBTs(). */
+struct PSBTFillResult {
+    TransactionError error{TransactionError::OK};
+    bool complete{false};
+};
+
+/**
+ * Bloom filter of scriptPubKeys that needs a single salted hash per lookup, with about 0.25%
+ * false positives. It never rules out a scriptPubKey that was inserted.
+ */
+class ScriptPubKeyFilter
+{
+private:
+    //! Bits set for each scriptPubKey
+    static constexpr int HASH_FUNCS{4};
+    //! Minimum size of the filter per scriptPubKey, in bits
+    static constexpr size_t BITS_PER_SCRIPT{16};
+
+    const uint64_t m_k0, m_k1;
+    std::vector<uint64_t> m_bits;
+    uint64_t m_mask{0};
+
+    uint64_t Hash(const CScript& script) const;
+
+public:
+    ScriptPubKeyFilter();
+
+    //! Remove all scriptPubKeys and size the filter for a number of them
+    void Reset(size_t scripts);
+    void Insert(const CScript& script);
+    bool MayContain(const CScript& script) const;
+};
+
 class WalletRescanReserver; //forward declarations for ScanForWalletTransactions/RescanFromTime
+
+/** Rescans deferred by imports, merged into one pass from the earliest time they need, as getdeferredrescaninfo reports them */
+struct DeferredRescanInfo {
+    //! Earliest key time of the imports waiting for a pass, if any
+    std::optional<int64_t> pending_time;
+    int pending_requests{0};
+    //! Whether a pass is running
+    bool scanning{false};
+
+    /** The last pass that finished */
+    struct Pass {
+        int64_t time;
+        int requests;
+        //! Time from which the pass found all transactions, later than time if it could not read some blocks
+        int64_t scanned_time;
+        bool aborted;
+    };
+    std::optional<Pass> last;
+};
 /**
  * A CWallet maintains a set of transactions and balances, and provides the ability to create new transactions.
  */
@@ -239,6 +308,12 @@ private:
 
     bool Unlock(const CKeyingMaterial& vMasterKeyIn, bool accept_no_keys = false);
 
+    /** Fill in the UTXOs we have for the inputs of a PSBT that are not signed yet. */
+    void FillPSBTUtxos(PartiallySignedTransaction& psbtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
+    /** Move a transaction of m_txs_by_height to the position of its current state. */
+    void UpdateTxHeightIndex(CWalletTx& wtx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     std::atomic<bool> fAbortRescan{false};
     std::atomic<bool> fScanningWallet{false}; // controlled by WalletRescanReserver
     std::atomic<bool> m_attaching_chain{false};
@@ -246,6 +321,17 @@ private:
     std::atomic<double> m_scanning_progress{0};
     friend class WalletRescanReserver;
 
+    mutable Mutex m_deferred_rescan_mutex;
+    std::condition_variable m_deferred_rescan_cv;
+    DeferredRescanInfo m_deferred_rescan GUARDED_BY(m_deferred_rescan_mutex);
+    //! When the pending pass starts, unless more imports defer their rescan
+    SteadyClock::time_point m_deferred_rescan_start GUARDED_BY(m_deferred_rescan_mutex);
+    bool m_deferred_rescan_stop GUARDED_BY(m_deferred_rescan_mutex){false};
+    //! Runs the deferred passes, started by the first import deferring its rescan
+    std::thread m_deferred_rescan_thread GUARDED_BY(m_deferred_rescan_mutex);
+
+    void ThreadDeferredRescan() EXCLUSIVE_LOCKS_REQUIRED(!m_deferred_rescan_mutex);
+
     //! the current wallet version: clients below this version are not able to load the wallet
     int nWalletVersion GUARDED_BY(cs_wallet){FEATURE_BASE};
 
@@ -291,6 +377,9 @@ private:
     /** Mark a transaction's inputs dirty, thus forcing the outputs to be recomputed */
     void MarkInputsDirty(const CTransactionRef& tx) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /** Whether IsSpent() counts the outputs spent by a transaction as spent. A change of it invalidates their available credit. */
+    bool SpendsInputs(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     void SyncMetaData(std::pair<TxSpends::iterator, TxSpends::iterator>) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
     void SyncTransaction(const CTransactionRef& tx, const SyncTxState& state, bool update_tx = true, bool rescanning_old_block = false) EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
@@ -382,12 +471,14 @@ public:
 
     ~CWallet()
     {
+        StopDeferredRescan();
         // Should not have slots connected at this point.
         assert(NotifyUnload.empty());
     }
 
     bool IsCrypted() const;
     bool IsLocked() const override;
+    void ScriptPubKeysChanged() override { m_spk_filter_dirty = true; }
     bool Lock();
 
     /** Interface to assert chain access */
@@ -397,8 +488,64 @@ public:
      * interested in, including received and sent transactions. */
     std::unordered_map<uint256, CWalletTx, SaltedTxidHasher> mapWallet GUARDED_BY(cs_wallet);
 
+    /**
+     * Running totals of the default GetBalance(), kept as the sum of the contribution of
+     * each transaction. Only the contributions of transactions marked with
+     * MarkBalanceDirty() are recomputed on the next GetBalance() call.
+     */
+    struct BalanceCache {
+        Balance total;
+        //! Contribution of each transaction with a non-zero one
+        std::unordered_map<uint256, Balance, SaltedTxidHasher> contributions;
+        //! Transactions whose contribution may have changed
+        std::set<uint256> dirty;
+        //! Transactions with immature coinbase credit, which changes with every block
+        std::set<uint256> immature;
+        //! Whether all contributions have to be recomputed
+        bool all_dirty{true};
+    };
+    mutable BalanceCache m_balance_cache GUARDED_BY(cs_wallet);
+
+    /**
+     * Index of the outputs that are ours and not spent, so that AvailableCoins() only
+     * visits the transactions that still have something to spend. Depth, trust and
+     * coin control filters change with the chain and are applied when reading it.
+     */
+    struct UnspentIndex {
+        //! Indices of the unspent outputs that are ours, for each transaction that has any
+        std::map<uint256, std::vector<unsigned int>> outputs;
+        //! Transactions whose outputs may have been spent, unspent or added
+        std::set<uint256> dirty;
+        //! Whether the whole index has to be rebuilt
+        bool all_dirty{true};
+    };
+    mutable UnspentIndex m_unspent_index GUARDED_BY(cs_wallet);
+
+    /**
+     * Filter of the scriptPubKeys of all ScriptPubKeyMans of a descriptor wallet, which rules
+     * out most scripts in IsMine() before any of them is asked. Legacy wallets solve scripts
+     * rather than keep a set of them, and do not use it.
+     */
+    mutable ScriptPubKeyFilter m_spk_filter GUARDED_BY(cs_wallet);
+    //! Number of ScriptPubKeyMans m_spk_filter was built from
+    mutable size_t m_spk_filter_managers GUARDED_BY(cs_wallet){0};
+    //! Whether the scriptPubKeys changed since m_spk_filter was built
+    mutable std::atomic<bool> m_spk_filter_dirty{true};
+
+    /**
+     * Recompute the balance contribution and the unspent outputs of a transaction, and the
+     * balance contribution of its unconfirmed descendants whose trust depends on it.
+     */
+    void MarkBalanceDirty(const uint256& hash) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
+
     typedef std::multimap<int64_t, CWalletTx*> TxItems;
     TxItems wtxOrdered;
+    /**
+     * Transactions by the height of the block they are confirmed or conflicted in, then by txid.
+     * Transactions in neither state come last, so the ones since a block are a suffix of the map.
+     */
+    typedef std::map<std::pair<int, uint256>, CWalletTx*> TxHeightItems;
+    TxHeightItems m_txs_by_height GUARDED_BY(cs_wallet);
 
     int64_t nOrderPosNext GUARDED_BY(cs_wallet) = 0;
     uint64_t nAccountingEntryNumber = 0;
@@ -422,6 +569,9 @@ public:
 
     std::set<uint256> GetTxConflicts(const CWalletTx& wtx) const EXCLUSIVE_LOCKS_REQUIRED(cs_wallet);
 
+    /** Memory used by the transactions of the wallet and the maps indexing them, in bytes. */
+    size_t DynamicMemoryUsage() const EXCLUSIVE_LOCKS_REQUIRED(!cs_wallet);
+
     /**
      * Return depth of transaction in blockchain:
      * <0  : conflicts with a transaction this deep in the blockchain
@@ -521,6 +671,15 @@ public:
     void blockDisconnected(const interfaces::BlockInfo& block) override;
     void updatedBlockTip() override;
     int64_t RescanFromTime(int64_t startTime, const WalletRescanReserver& reserver, bool update);
+    /**
+     * Rescan from time in the background instead of now. Rescans deferred
+     * within DEFERRED_RESCAN_DELAY of each other are merged into one pass from
+     * the earliest of their times.
+     */
+    void DeferRescan(int64_t time) EXCLUSIVE_LOCKS_REQUIRED(!m_deferred_rescan_mutex);
+    DeferredRescanInfo GetDeferredRescanInfo() const EXCLUSIVE_LOCKS_REQUIRED(!m_deferred_rescan_mutex);
+    /** Abort the deferred pass running, if any, and drop the pending one. */
+    void StopDeferredRescan() EXCLUSIVE_LOCKS_REQUIRED(!m_deferred_rescan_mutex);
 
     struct ScanResult {
         enum { SUCCESS, FAILURE, USER_ABORT } status = SUCCESS;
@@ -576,6 +735,18 @@ public:
                   size_t* n_signed = nullptr,
                   bool finalize = true) const;
 
+    /**
+     * Fills out a batch of PSBTs like FillPSBT(), looking up the UTXOs of all of them under a
+     * single wallet lock. A wallet without encryption signs large batches on worker threads.
+     * Each PSBT gets its own entry in `results`, so an error in one leaves the others filled.
+     */
+    void FillPSBTs(std::vector<PartiallySignedTransaction>& psbtxs,
+                   std::vector<PSBTFillResult>& results,
+                   int sighash_type = SIGHASH_DEFAULT,
+                   bool sign = true,
+                   bool bip32derivs = true,
+                   bool finalize = true) const;
+
     /**
      * Submit the transaction to the node's mempool and then relay to peers.
      * Should be called after CreateTransaction unless you want to abort
@@ -5,6 +5,7 @@
 
 #include <wallet/walletdb.h>
 
+#include <checkqueue.h>
 #include <fs.h>
 #include <key_io.h>
 #include <protocol.h>
@@ -22,6 +23,7 @@
 #endif
 #include <wallet/wallet.h>
 
+#include <algorithm>
 #include <atomic>
 #include <optional>
 #include <string>
@@ -315,10 +317,54 @@ public:
     std::map<uint160, CHDChain> m_hd_chains;
     bool tx_corrupt{false};
     bool descriptor_unknown{false};
+    //! Transaction of the current tx record and its serialized size, if it was read ahead
+    std::optional<std::pair<CTransactionRef, size_t>> m_read_tx;
 
     CWalletScanState() = default;
 };
 
+//! Number of records read from the database before they are loaded
+static constexpr size_t WALLET_LOAD_RECORDS_PER_BATCH{10000};
+//! Number of tx records a worker reads ahead in one go
+static constexpr unsigned int WALLET_LOAD_TX_READS_PER_WORKER{64};
+//! Maximum number of threads reading transactions ahead while loading a wallet
+static constexpr int MAX_WALLET_LOAD_THREADS{8};
+
+/**
+ * Reads the transaction at the start of a tx record on a worker thread, see WalletBatch::LoadWallet().
+ * Computing the transaction hashes is most of the work of loading a transaction.
+ */
+class WalletTxRead
+{
+private:
+    const CDataStream* m_value{nullptr};
+    std::optional<std::pair<CTransactionRef, size_t>>* m_tx{nullptr};
+
+public:
+    WalletTxRead() = default;
+    WalletTxRead(const CDataStream& value, std::optional<std::pair<CTransactionRef, size_t>>& tx)
+        : m_value(&value), m_tx(&tx) {}
+
+    //! Always succeeds; a record that cannot be read here fails again when it is loaded.
+    bool operator()()
+    {
+        try {
+            SpanReader reader{m_value->GetType(), m_value->GetVersion(), MakeUCharSpan(*m_value)};
+            CTransactionRef tx;
+            reader >> tx;
+            m_tx->emplace(std::move(tx), m_value->size() - reader.size());
+        } catch (const std::exception&) {
+        }
+        return true;
+    }
+
+    void swap(WalletTxRead& check) noexcept
+    {
+        std::swap(m_value, check.m_value);
+        std::swap(m_tx, check.m_tx);
+    }
+};
+
 static bool
 ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
              CWalletScanState &wss, std::string& strType, std::string& strErr, const KeyFilterFn& filter_fn = nullptr) EXCLUSIVE_LOCKS_REQUIRED(pwallet->cs_wallet)
@@ -355,7 +401,12 @@ ReadKeyValue(CWallet* pwallet, CDataStream& ssKey, CDataStream& ssValue,
                     wss.tx_corrupt = true;
                     return false;
                 }
-                ssValue >> wtx;
+                if (wss.m_read_tx) {
+                    ssValue.ignore(wss.m_read_tx->second);
+                    wtx.Unserialize(ssValue, std::move(wss.m_read_tx->first));
+                } else {
+                    ssValue >> wtx;
+                }
                 if (wtx.GetHash() != hash)
                     return false;
 
@@ -812,56 +863,95 @@ DBErrors WalletBatch::LoadWallet(CWallet* pwallet)
             return DBErrors::CORRUPT;
         }
 
-        while (true)
+        // Records are read in batches. The transactions of the tx records in a batch are
+        // read ahead on worker threads, then the records are loaded in order.
+        CCheckQueue<WalletTxRead> tx_read_queue{WALLET_LOAD_TX_READS_PER_WORKER};
+        tx_read_queue.StartWorkerThreads(std::clamp(GetNumCores() - 1, 0, MAX_WALLET_LOAD_THREADS), "walletload",
+                                         SyscallSandboxPolicy::WALLET_LOAD);
+        struct StopWorkers {
+            CCheckQueue<WalletTxRead>& queue;
+            ~StopWorkers() { queue.StopWorkerThreads(); }
+        } stop_workers{tx_read_queue};
+
+        struct Record {
+            CDataStream key{SER_DISK, CLIENT_VERSION};
+            CDataStream value{SER_DISK, CLIENT_VERSION};
+            std::optional<std::pair<CTransactionRef, size_t>> read_tx;
+        };
+        // The read-ahead checks point into the records, which must not move
+        std::vector<Record> records;
+        records.reserve(WALLET_LOAD_RECORDS_PER_BATCH);
+        std::vector<WalletTxRead> tx_reads;
+
+        bool complete{false};
+        while (!complete)
         {
             // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-            bool complete;
-            bool ret = m_batch->ReadAtCursor(ssKey, ssValue, complete);
+            Record& record{records.emplace_back()};
+            bool ret = m_batch->ReadAtCursor(record.key, record.value, complete);
             if (complete) {
-                break;
+                records.pop_back();
             }
             else if (!ret)
             {
                 m_batch->CloseCursor();
                 pwallet->WalletLogPrintf("Error reading next record from wallet database\n");
                 return DBErrors::CORRUPT;
+            } else {
+                std::string type;
+                try {
+                    SpanReader{SER_DISK, CLIENT_VERSION, MakeUCharSpan(record.key)} >> type;
+                } catch (const std::exception&) {
+                }
+                if (type == DBKeys::TX) tx_reads.emplace_back(record.value, record.read_tx);
             }
+            if (!complete && records.size() < WALLET_LOAD_RECORDS_PER_BATCH) continue;
 
-            // Try to be tolerant of single corrupt records:
-            std::string strType, strErr;
-            if (!ReadKeyValue(pwallet, ssKey, ssValue, wss, strType, strErr))
-            {
-                // losing keys is considered a catastrophic error, anything else
-                // we assume the user can live with:
-                if (IsKeyType(strType) || strType == DBKeys::DEFAULTKEY) {
-                    result = DBErrors::CORRUPT;
-                } else if (strType == DBKeys::FLAGS) {
-                    // reading the wallet flags can only fail if unknown flags are present
-                    result = DBErrors::TOO_NEW;
-                } else if (wss.tx_corrupt) {
-                    pwallet->WalletLogPrintf("Error: Corrupt transaction found. This can be fixed by removing transactions from wallet and rescanning.\n");
-                    // Set tx_corrupt back to false so that the error is only printed once (per corrupt tx)
-                    wss.tx_corrupt = false;
-                    result = DBErrors::CORRUPT;
-                } else if (wss.descriptor_unknown) {
-                    strErr = strprintf("Error: Unrecognized descriptor found in wallet %s. ", pwallet->GetName());
-                    strErr += (last_client > CLIENT_VERSION) ? "The wallet might had been created on a newer version. " :
-                            "The database might be corrupted or the software version is not compatible with one of your wallet descriptors. ";
-                    strErr += "Please try running the latest software version";
-                    pwallet->WalletLogPrintf("%s\n", strErr);
-                    return DBErrors::UNKNOWN_DESCRIPTOR;
-                } else {
-                    // Leave other errors alone, if we try to fix them we might make things worse.
-                    fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
-                    if (strType == DBKeys::TX)
-                        // Rescan if there is a bad transaction record:
-                        rescan_required = true;
+            if (!tx_reads.empty()) {
+                CCheckQueueControl<WalletTxRead> control(&tx_read_queue);
+                control.Add(tx_reads);
+                control.Wait();
+                tx_reads.clear();
+            }
+            for (Record& loaded : records) {
+                wss.m_read_tx = std::move(loaded.read_tx);
+
+                // Try to be tolerant of single corrupt records:
+                std::string strType, strErr;
+                if (!ReadKeyValue(pwallet, loaded.key, loaded.value, wss, strType, strErr))
+                {
+                    // losing keys is considered a catastrophic error, anything else
+                    // we assume the user can live with:
+                    if (IsKeyType(strType) || strType == DBKeys::DEFAULTKEY) {
+                        result = DBErrors::CORRUPT;
+                    } else if (strType == DBKeys::FLAGS) {
+                        // reading the wallet flags can only fail if unknown flags are present
+                        result = DBErrors::TOO_NEW;
+                    } else if (wss.tx_corrupt) {
+                        pwallet->WalletLogPrintf("Error: Corrupt transaction found. This can be fixed by removing transactions from wallet and rescanning.\n");
+                        // Set tx_corrupt back to false so that the error is only printed once (per corrupt tx)
+                        wss.tx_corrupt = false;
+                        result = DBErrors::CORRUPT;
+                    } else if (wss.descriptor_unknown) {
+                        strErr = strprintf("Error: Unrecognized descriptor found in wallet %s. ", pwallet->GetName());
+                        strErr += (last_client > CLIENT_VERSION) ? "The wallet might had been created on a newer version. " :
+                                "The database might be corrupted or the software version is not compatible with one of your wallet descriptors. ";
+                        strErr += "Please try running the latest software version";
+                        pwallet->WalletLogPrintf("%s\n", strErr);
+                        return DBErrors::UNKNOWN_DESCRIPTOR;
+                    } else {
+                        // Leave other errors alone, if we try to fix them we might make things worse.
+                        fNoncriticalErrors = true; // ... but do warn the user there is something wrong.
+                        if (strType == DBKeys::TX)
+                            // Rescan if there is a bad transaction record:
+                            rescan_required = true;
+                    }
                 }
+                if (!strErr.empty())
+                    pwallet->WalletLogPrintf("%s\n", strErr);
             }
-            if (!strErr.empty())
-                pwallet->WalletLogPrintf("%s\n", strErr);
+            wss.m_read_tx.reset();
+            records.clear();
         }
     } catch (...) {
         result = DBErrors::CORRUPT;
@@ -13,6 +13,11 @@ CZMQAbstractNotifier::~CZMQAbstractNotifier()
     assert(!psocket);
 }
 
+std::chrono::steady_clock::time_point CZMQAbstractNotifier::SendQueued(std::chrono::steady_clock::time_point /*now*/)
+{
+    return std::chrono::steady_clock::time_point::max();
+}
+
 bool CZMQAbstractNotifier::NotifyBlock(const CBlockIndex * /*CBlockIndex*/)
 {
     return true;
@@ -42,3 +47,8 @@ bool CZMQAbstractNotifier::NotifyTransactionRemoval(const CTransaction &/*transa
 {
     return true;
 }
+
+bool CZMQAbstractNotifier::NotifyBlockTemplate(const CBlock &/*block*/)
+{
+    return true;
+}
@@ -5,10 +5,13 @@
 #ifndef BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 #define BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
 
-
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
 #include <string>
 
+class CBlock;
 class CBlockIndex;
 class CTransaction;
 class CZMQAbstractNotifier;
@@ -19,6 +22,19 @@ class CZMQAbstractNotifier
 {
 public:
     static const int DEFAULT_ZMQ_SNDHWM {1000};
+    //! Default time for which messages are collected before they are sent together
+    static constexpr std::chrono::milliseconds DEFAULT_ZMQ_BATCH{0};
+    //! Default maximum number of messages waiting to be sent, later ones are dropped
+    static constexpr int64_t DEFAULT_ZMQ_SEND_QUEUE{10000};
+
+    /** Accounting of the messages of a notifier */
+    struct SendStats {
+        //! Messages waiting to be sent
+        uint64_t queued{0};
+        uint64_t sent{0};
+        //! Messages dropped because the queue was full or sending failed
+        uint64_t dropped{0};
+    };
 
     CZMQAbstractNotifier() : psocket(nullptr), outbound_message_high_water_mark(DEFAULT_ZMQ_SNDHWM) { }
     virtual ~CZMQAbstractNotifier();
@@ -39,6 +55,25 @@ public:
             outbound_message_high_water_mark = sndhwm;
         }
     }
+    std::chrono::milliseconds GetBatchInterval() const { return m_batch_interval; }
+    void SetBatchInterval(std::chrono::milliseconds interval) {
+        if (interval >= std::chrono::milliseconds{0}) {
+            m_batch_interval = interval;
+        }
+    }
+    int64_t GetMaxSendQueue() const { return m_max_send_queue; }
+    void SetMaxSendQueue(int64_t max_queue) {
+        if (max_queue > 0) {
+            m_max_send_queue = max_queue;
+        }
+    }
+    //! Set the function waking up the thread that sends the queued messages
+    void SetSendWakeup(std::function<void()> wakeup) { m_send_wakeup = std::move(wakeup); }
+
+    virtual SendStats GetSendStats() const { return {}; }
+    // Sends the queued messages that are due at now, from the send thread only.
+    // Returns when the next queued message is due, or time_point::max() if none is queued.
+    virtual std::chrono::steady_clock::time_point SendQueued(std::chrono::steady_clock::time_point now);
 
     virtual bool Initialize(void *pcontext) = 0;
     virtual void Shutdown() = 0;
@@ -55,12 +90,17 @@ public:
     virtual bool NotifyTransactionRemoval(const CTransaction &transaction, uint64_t mempool_sequence);
     // Notifies of transactions added to mempool or appearing in blocks
     virtual bool NotifyTransaction(const CTransaction &transaction);
+    // Notifies of new block templates, on tip changes and fee improvements
+    virtual bool NotifyBlockTemplate(const CBlock &block);
 
 protected:
     void *psocket;
     std::string type;
     std::string address;
     int outbound_message_high_water_mark; // aka SNDHWM
+    std::chrono::milliseconds m_batch_interval{DEFAULT_ZMQ_BATCH};
+    int64_t m_max_send_queue{DEFAULT_ZMQ_SEND_QUEUE};
+    std::function<void()> m_send_wakeup;
 };
 
 #endif // BITCOIN_ZMQ_ZMQABSTRACTNOTIFIER_H
@@ -8,8 +8,15 @@
 
 #include <zmq.h>
 
+#include <node/miner.h>
 #include <primitives/block.h>
 #include <util/system.h>
+#include <util/thread.h>
+
+#include <exception>
+
+//! Minimum time between template rebuilds triggered by new mempool transactions
+static constexpr auto TEMPLATE_UPDATE_INTERVAL{std::chrono::seconds{1}};
 
 CZMQNotificationInterface::CZMQNotificationInterface() : pcontext(nullptr)
 {
@@ -29,7 +36,7 @@ std::list<const CZMQAbstractNotifier*> CZMQNotificationInterface::GetActiveNotif
     return result;
 }
 
-CZMQNotificationInterface* CZMQNotificationInterface::Create()
+CZMQNotificationInterface* CZMQNotificationInterface::Create(CZMQCreateTemplateFn create_template)
 {
     std::map<std::string, CZMQNotifierFactory> factories;
     factories["pubhashblock"] = CZMQAbstractNotifier::Create<CZMQPublishHashBlockNotifier>;
@@ -37,6 +44,7 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     factories["pubrawblock"] = CZMQAbstractNotifier::Create<CZMQPublishRawBlockNotifier>;
     factories["pubrawtx"] = CZMQAbstractNotifier::Create<CZMQPublishRawTransactionNotifier>;
     factories["pubsequence"] = CZMQAbstractNotifier::Create<CZMQPublishSequenceNotifier>;
+    factories["pubtemplate"] = CZMQAbstractNotifier::Create<CZMQPublishTemplateNotifier>;
 
     std::list<std::unique_ptr<CZMQAbstractNotifier>> notifiers;
     for (const auto& entry : factories)
@@ -48,6 +56,8 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
             notifier->SetType(entry.first);
             notifier->SetAddress(address);
             notifier->SetOutboundMessageHighWaterMark(static_cast<int>(gArgs.GetIntArg(arg + "hwm", CZMQAbstractNotifier::DEFAULT_ZMQ_SNDHWM)));
+            notifier->SetBatchInterval(std::chrono::milliseconds{gArgs.GetIntArg(arg + "batch", CZMQAbstractNotifier::DEFAULT_ZMQ_BATCH.count())});
+            notifier->SetMaxSendQueue(gArgs.GetIntArg(arg + "queue", CZMQAbstractNotifier::DEFAULT_ZMQ_SEND_QUEUE));
             notifiers.push_back(std::move(notifier));
         }
     }
@@ -56,6 +66,10 @@ CZMQNotificationInterface* CZMQNotificationInterface::Create()
     {
         std::unique_ptr<CZMQNotificationInterface> notificationInterface(new CZMQNotificationInterface());
         notificationInterface->notifiers = std::move(notifiers);
+        if (gArgs.IsArgSet("-zmqpubtemplate")) {
+            notificationInterface->m_create_template = std::move(create_template);
+            notificationInterface->m_template_fee_delta = gArgs.GetIntArg("-zmqpubtemplatefeedelta", DEFAULT_TEMPLATE_FEE_DELTA);
+        }
 
         if (notificationInterface->Initialize()) {
             return notificationInterface.release();
@@ -90,15 +104,53 @@ bool CZMQNotificationInterface::Initialize()
             LogPrint(BCLog::ZMQ, "Notifier %s failed (address = %s)\n", notifier->GetType(), notifier->GetAddress());
             return false;
         }
+        notifier->SetSendWakeup([this] { WakeSendThread(); });
     }
 
+    m_send_thread = std::thread(&util::TraceThread, "zmqsend", [this] { ThreadSend(); });
+
     return true;
 }
 
+void CZMQNotificationInterface::WakeSendThread()
+{
+    WITH_LOCK(m_send_mutex, m_send_wakeup = true);
+    m_send_cv.notify_one();
+}
+
+void CZMQNotificationInterface::ThreadSend()
+{
+    while (true) {
+        auto next_send{std::chrono::steady_clock::time_point::max()};
+        {
+            LOCK(m_notifiers_mutex);
+            const auto now{std::chrono::steady_clock::now()};
+            for (auto& notifier : notifiers) {
+                next_send = std::min(next_send, notifier->SendQueued(now));
+            }
+        }
+
+        WAIT_LOCK(m_send_mutex, lock);
+        const auto woken{[&]() EXCLUSIVE_LOCKS_REQUIRED(m_send_mutex) { return m_send_wakeup || m_send_stop; }};
+        if (next_send == std::chrono::steady_clock::time_point::max()) {
+            m_send_cv.wait(lock, woken);
+        } else {
+            m_send_cv.wait_until(lock, next_send, woken);
+        }
+        if (m_send_stop) break;
+        m_send_wakeup = false;
+    }
+}
+
 // Called during shutdown sequence
 void CZMQNotificationInterface::Shutdown()
 {
     LogPrint(BCLog::ZMQ, "Shutdown notification interface\n");
+    if (m_send_thread.joinable()) {
+        WITH_LOCK(m_send_mutex, m_send_stop = true);
+        m_send_cv.notify_one();
+        m_send_thread.join();
+    }
     if (pcontext)
     {
         for (auto& notifier : notifiers) {
@@ -114,13 +166,14 @@ void CZMQNotificationInterface::Shutdown()
 namespace {
 
 template <typename Function>
-void TryForEachAndRemoveFailed(std::list<std::unique_ptr<CZMQAbstractNotifier>>& notifiers, const Function& func)
+void TryForEachAndRemoveFailed(std::list<std::unique_ptr<CZMQAbstractNotifier>>& notifiers, Mutex& notifiers_mutex, const Function& func)
 {
     for (auto i = notifiers.begin(); i != notifiers.end(); ) {
         CZMQAbstractNotifier* notifier = i->get();
         if (func(notifier)) {
             ++i;
         } else {
+            LOCK(notifiers_mutex);
             notifier->Shutdown();
             i = notifiers.erase(i);
         }
@@ -129,23 +182,57 @@ void TryForEachAndRemoveFailed(std::list<std::unique_ptr<CZMQAbstractNotifier>>&
 
 } // anonymous namespace
 
+void CZMQNotificationInterface::UpdateTemplate(bool tip_changed)
+{
+    if (!m_create_template) return;
+    const auto now{std::chrono::steady_clock::now()};
+    if (!tip_changed && now < m_next_template_update) return;
+    m_next_template_update = now + TEMPLATE_UPDATE_INTERVAL;
+
+    std::unique_ptr<node::CBlockTemplate> block_template;
+    try {
+        block_template = m_create_template(m_template.get());
+    } catch (const std::exception& e) {
+        LogPrint(BCLog::ZMQ, "Unable to create block template: %s\n", e.what());
+    }
+    if (!block_template) return;
+
+    // The coinbase entry of vTxFees is minus the total fees
+    const CAmount fees{-block_template->vTxFees[0]};
+    const bool publish{!m_template || block_template->block.hashPrevBlock != m_template->block.hashPrevBlock ||
+                       fees >= m_published_template_fees + m_template_fee_delta};
+    // Keep the latest template either way, so the next one can extend it
+    m_template = std::move(block_template);
+    if (!publish) return;
+
+    m_published_template_fees = fees;
+    const CBlock& block{m_template->block};
+    TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [&block](CZMQAbstractNotifier* notifier) {
+        return notifier->NotifyBlockTemplate(block);
+    });
+}
+
 void CZMQNotificationInterface::UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload)
 {
     if (fInitialDownload || pindexNew == pindexFork) // In IBD or blocks were disconnected without any new ones
         return;
 
-    TryForEachAndRemoveFailed(notifiers, [pindexNew](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [pindexNew](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlock(pindexNew);
     });
+
+    UpdateTemplate(/*tip_changed=*/true);
 }
 
 void CZMQNotificationInterface::TransactionAddedToMempool(const CTransactionRef& ptx, uint64_t mempool_sequence)
 {
     const CTransaction& tx = *ptx;
 
-    TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyTransaction(tx) && notifier->NotifyTransactionAcceptance(tx, mempool_sequence);
     });
+
+    UpdateTemplate(/*tip_changed=*/false);
 }
 
 void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransactionRef& ptx, MemPoolRemovalReason reason, uint64_t mempool_sequence)
@@ -153,7 +240,7 @@ void CZMQNotificationInterface::TransactionRemovedFromMempool(const CTransaction
     // Called for all non-block inclusion reasons
     const CTransaction& tx = *ptx;
 
-    TryForEachAndRemoveFailed(notifiers, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [&tx, mempool_sequence](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyTransactionRemoval(tx, mempool_sequence);
     });
 }
@@ -162,13 +249,13 @@ void CZMQNotificationInterface::BlockConnected(const std::shared_ptr<const CBloc
 {
     for (const CTransactionRef& ptx : pblock->vtx) {
         const CTransaction& tx = *ptx;
-        TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
+        TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [&tx](CZMQAbstractNotifier* notifier) {
             return notifier->NotifyTransaction(tx);
         });
     }
 
     // Next we notify BlockConnect listeners for *all* blocks
-    TryForEachAndRemoveFailed(notifiers, [pindexConnected](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [pindexConnected](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlockConnect(pindexConnected);
     });
 }
@@ -177,13 +264,13 @@ void CZMQNotificationInterface::BlockDisconnected(const std::shared_ptr<const CB
 {
     for (const CTransactionRef& ptx : pblock->vtx) {
         const CTransaction& tx = *ptx;
-        TryForEachAndRemoveFailed(notifiers, [&tx](CZMQAbstractNotifier* notifier) {
+        TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [&tx](CZMQAbstractNotifier* notifier) {
             return notifier->NotifyTransaction(tx);
         });
     }
 
     // Next we notify BlockDisconnect listeners for *all* blocks
-    TryForEachAndRemoveFailed(notifiers, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
+    TryForEachAndRemoveFailed(notifiers, m_notifiers_mutex, [pindexDisconnected](CZMQAbstractNotifier* notifier) {
         return notifier->NotifyBlockDisconnect(pindexDisconnected);
     });
 }
@@ -5,12 +5,25 @@
 #ifndef BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 #define BITCOIN_ZMQ_ZMQNOTIFICATIONINTERFACE_H
 
+#include <consensus/amount.h>
+#include <sync.h>
 #include <validationinterface.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
 #include <list>
 #include <memory>
+#include <thread>
 
 class CBlockIndex;
 class CZMQAbstractNotifier;
+namespace node {
+struct CBlockTemplate;
+} // namespace node
+
+/** Build a new block template, extending the previous one if given. Returns nullptr if none can be built now. */
+using CZMQCreateTemplateFn = std::function<std::unique_ptr<node::CBlockTemplate>(const node::CBlockTemplate* previous)>;
 
 class CZMQNotificationInterface final : public CValidationInterface
 {
@@ -19,7 +32,10 @@ public:
 
     std::list<const CZMQAbstractNotifier*> GetActiveNotifiers() const;
 
-    static CZMQNotificationInterface* Create();
+    static CZMQNotificationInterface* Create(CZMQCreateTemplateFn create_template);
+
+    //! Default minimum fee improvement, in satoshis, for a new template to be published
+    static constexpr CAmount DEFAULT_TEMPLATE_FEE_DELTA{10000};
 
 protected:
     bool Initialize();
@@ -31,12 +47,37 @@ protected:
     void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexConnected) override;
     void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) override;
     void UpdatedBlockTip(const CBlockIndex *pindexNew, const CBlockIndex *pindexFork, bool fInitialDownload) override;
+    std::string ValidationInterfaceName() const override { return "zmq"; }
 
 private:
     CZMQNotificationInterface();
 
+    /** Build a template and publish it if the tip changed or its fees improved by the threshold. */
+    void UpdateTemplate(bool tip_changed);
+
+    /** Send the messages queued by the notifiers, so slow subscribers never hold up validation callbacks. */
+    void ThreadSend();
+    void WakeSendThread() EXCLUSIVE_LOCKS_REQUIRED(!m_send_mutex);
+
     void *pcontext;
+    //! Only modified on the validation callback thread, with m_notifiers_mutex held
+    //! as the send thread iterates the list under it.
     std::list<std::unique_ptr<CZMQAbstractNotifier>> notifiers;
+    Mutex m_notifiers_mutex;
+
+    std::thread m_send_thread;
+    Mutex m_send_mutex;
+    std::condition_variable m_send_cv;
+    bool m_send_wakeup GUARDED_BY(m_send_mutex){false};
+    bool m_send_stop GUARDED_BY(m_send_mutex){false};
+
+    // Template notifications. Validation interface callbacks are run one at a
+    // time, so these need no locking.
+    CZMQCreateTemplateFn m_create_template;
+    CAmount m_template_fee_delta{DEFAULT_TEMPLATE_FEE_DELTA};
+    std::unique_ptr<node::CBlockTemplate> m_template;
+    CAmount m_published_template_fees{0};
+    std::chrono::steady_clock::time_point m_next_template_update;
 };
 
 extern CZMQNotificationInterface* g_zmq_notification_interface;
@@ -6,7 +6,9 @@
 
 #include <chain.h>
 #include <chainparams.h>
+#include <consensus/merkle.h>
 #include <netbase.h>
+#include <node/miner.h>
 #include <node/blockstorage.h>
 #include <rpc/server.h>
 #include <streams.h>
@@ -21,7 +23,9 @@
 #include <optional>
 #include <string>
 #include <utility>
+#include <vector>
 
+using node::GetTemplateId;
 using node::ReadBlockFromDisk;
 
 static std::multimap<std::string, CZMQAbstractPublishNotifier*> mapPublishNotifiers;
@@ -31,6 +35,7 @@ static const char *MSG_HASHTX    = "hashtx";
 static const char *MSG_RAWBLOCK  = "rawblock";
 static const char *MSG_RAWTX     = "rawtx";
 static const char *MSG_SEQUENCE  = "sequence";
+static const char *MSG_TEMPLATE  = "template";
 
 // Internal function to send multipart message
 static int zmq_send_multipart(void *sock, const void* data, size_t size, ...)
@@ -161,6 +166,8 @@ void CZMQAbstractPublishNotifier::Shutdown()
     // Early return if Initialize was not called
     if (!psocket) return;
 
+    WITH_LOCK(m_queue_mutex, m_queue.clear());
+
     int count = mapPublishNotifiers.count(address);
 
     // remove this notifier from the list of publishers using this address
@@ -191,19 +198,60 @@ bool CZMQAbstractPublishNotifier::SendZmqMessage(const char *command, const void
 {
     assert(psocket);
 
-    /* send three parts, command & data & a LE 4byte sequence number */
-    unsigned char msgseq[sizeof(uint32_t)];
-    WriteLE32(msgseq, nSequence);
-    int rc = zmq_send_multipart(psocket, command, strlen(command), data, size, msgseq, (size_t)sizeof(uint32_t), nullptr);
-    if (rc == -1)
-        return false;
-
-    /* increment memory only sequence number after sending */
-    nSequence++;
+    bool wakeup;
+    {
+        LOCK(m_queue_mutex);
+        if (m_queue.size() >= static_cast<size_t>(m_max_send_queue)) {
+            ++m_dropped;
+            nSequence++;
+            return true;
+        }
+        // The send thread takes the whole queue, so it only needs a wakeup for the first message
+        wakeup = m_queue.empty();
+        const auto* bytes{static_cast<const unsigned char*>(data)};
+        m_queue.push_back({command, std::vector<unsigned char>(bytes, bytes + size), nSequence++, std::chrono::steady_clock::now()});
+    }
+    if (wakeup && m_send_wakeup) m_send_wakeup();
 
     return true;
 }
 
+CZMQAbstractNotifier::SendStats CZMQAbstractPublishNotifier::GetSendStats() const
+{
+    SendStats stats;
+    stats.queued = WITH_LOCK(m_queue_mutex, return m_queue.size());
+    stats.sent = m_sent;
+    stats.dropped = m_dropped;
+    return stats;
+}
+
+std::chrono::steady_clock::time_point CZMQAbstractPublishNotifier::SendQueued(std::chrono::steady_clock::time_point now)
+{
+    std::deque<QueuedMessage> messages;
+    {
+        LOCK(m_queue_mutex);
+        if (m_queue.empty()) return std::chrono::steady_clock::time_point::max();
+        // Collect messages for the batch interval after the first one, then send them together
+        const auto due{m_queue.front().time + m_batch_interval};
+        if (now < due) return due;
+        messages.swap(m_queue);
+    }
+
+    for (const QueuedMessage& message : messages) {
+        /* send three parts, command & data & a LE 4byte sequence number */
+        unsigned char msgseq[sizeof(uint32_t)];
+        WriteLE32(msgseq, message.sequence);
+        int rc = zmq_send_multipart(psocket, message.command, strlen(message.command), message.data.data(), message.data.size(), msgseq, (size_t)sizeof(uint32_t), nullptr);
+        if (rc == -1) {
+            ++m_dropped;
+        } else {
+            ++m_sent;
+        }
+    }
+
+    return std::chrono::steady_clock::time_point::max();
+}
+
 bool CZMQPublishHashBlockNotifier::NotifyBlock(const CBlockIndex *pindex)
 {
     uint256 hash = pindex->GetBlockHash();
@@ -296,3 +344,29 @@ bool CZMQPublishSequenceNotifier::NotifyTransactionRemoval(const CTransaction &t
     LogPrint(BCLog::ZMQ, "Publish hashtx mempool removal %s to %s\n", hash.GetHex(), this->address);
     return SendSequenceMsg(*this, hash, /* Mempool (R)emoval */ 'R', mempool_sequence);
 }
+
+bool CZMQPublishTemplateNotifier::NotifyBlockTemplate(const CBlock &block)
+{
+    const uint256 template_id{GetTemplateId(block)};
+    LogPrint(BCLog::ZMQ, "Publish template %s to %s\n", template_id.GetHex(), this->address);
+
+    // prevhash, templateid, bits, curtime, then the merkle branch of the coinbase
+    const std::vector<uint256> branch{BlockMerkleBranch(block, 0)};
+    std::vector<unsigned char> data(2 * sizeof(uint256) + 2 * sizeof(uint32_t) + branch.size() * sizeof(uint256));
+    unsigned char* pos{data.data()};
+    auto write_hash = [&pos](const uint256& hash) {
+        for (unsigned int i = 0; i < sizeof(hash); ++i) {
+            pos[sizeof(hash) - 1 - i] = hash.begin()[i];
+        }
+        pos += sizeof(hash);
+    };
+    write_hash(block.hashPrevBlock);
+    write_hash(template_id);
+    WriteLE32(pos, block.nBits);
+    WriteLE32(pos + sizeof(uint32_t), block.nTime);
+    pos += 2 * sizeof(uint32_t);
+    for (const uint256& hash : branch) {
+        write_hash(hash);
+    }
+    return SendZmqMessage(MSG_TEMPLATE, data.data(), data.size());
+}
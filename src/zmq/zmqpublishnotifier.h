@@ -5,25 +5,46 @@
 #ifndef BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 #define BITCOIN_ZMQ_ZMQPUBLISHNOTIFIER_H
 
+#include <sync.h>
 #include <zmq/zmqabstractnotifier.h>
 
+#include <atomic>
+#include <deque>
+#include <vector>
+
 class CBlockIndex;
 
 class CZMQAbstractPublishNotifier : public CZMQAbstractNotifier
 {
 private:
-    uint32_t nSequence {0U}; //!< upcounting per message sequence number
+    struct QueuedMessage {
+        const char* command;
+        std::vector<unsigned char> data;
+        uint32_t sequence;
+        std::chrono::steady_clock::time_point time;
+    };
+
+    mutable Mutex m_queue_mutex;
+    uint32_t nSequence GUARDED_BY(m_queue_mutex) {0U}; //!< upcounting per message sequence number
+    std::deque<QueuedMessage> m_queue GUARDED_BY(m_queue_mutex);
+    std::atomic<uint64_t> m_sent{0};
+    std::atomic<uint64_t> m_dropped{0};
 
 public:
 
-    /* send zmq multipart message
+    /* queue zmq multipart message for the send thread
        parts:
           * command
           * data
           * message sequence number
+       A message dropped because the queue is full still takes a sequence
+       number, so subscribers can notice the gap.
     */
     bool SendZmqMessage(const char *command, const void* data, size_t size);
 
+    SendStats GetSendStats() const override;
+    std::chrono::steady_clock::time_point SendQueued(std::chrono::steady_clock::time_point now) override;
+
     bool Initialize(void *pcontext) override;
     void Shutdown() override;
 };
@@ -52,6 +73,12 @@ public:
     bool NotifyTransaction(const CTransaction &transaction) override;
 };
 
+class CZMQPublishTemplateNotifier : public CZMQAbstractPublishNotifier
+{
+public:
+    bool NotifyBlockTemplate(const CBlock &block) override;
+};
+
 class CZMQPublishSequenceNotifier : public CZMQAbstractPublishNotifier
 {
 public:
@@ -6,6 +6,7 @@
 
 #include <rpc/server.h>
 #include <rpc/util.h>
+#include <util/time.h>
 #include <zmq/zmqabstractnotifier.h>
 #include <zmq/zmqnotificationinterface.h>
 
@@ -26,6 +27,11 @@ static RPCHelpMan getzmqnotifications()
                             {RPCResult::Type::STR, "type", "Type of notification"},
                             {RPCResult::Type::STR, "address", "Address of the publisher"},
                             {RPCResult::Type::NUM, "hwm", "Outbound message high water mark"},
+                            {RPCResult::Type::NUM, "batch", "Time in milliseconds for which messages are collected before they are sent together"},
+                            {RPCResult::Type::NUM, "maxqueue", "Maximum number of messages waiting to be sent"},
+                            {RPCResult::Type::NUM, "queued", "Number of messages waiting to be sent"},
+                            {RPCResult::Type::NUM, "sent", "Number of messages sent"},
+                            {RPCResult::Type::NUM, "dropped", "Number of messages dropped because the queue was full or sending failed"},
                         }},
                     }
                 },
@@ -42,6 +48,12 @@ static RPCHelpMan getzmqnotifications()
             obj.pushKV("type", n->GetType());
             obj.pushKV("address", n->GetAddress());
             obj.pushKV("hwm", n->GetOutboundMessageHighWaterMark());
+            obj.pushKV("batch", count_milliseconds(n->GetBatchInterval()));
+            obj.pushKV("maxqueue", n->GetMaxSendQueue());
+            const CZMQAbstractNotifier::SendStats stats{n->GetSendStats()};
+            obj.pushKV("queued", stats.queued);
+            obj.pushKV("sent", stats.sent);
+            obj.pushKV("dropped", stats.dropped);
             result.push_back(obj);
         }
     }
@@ -0,0 +1,60 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test loading the block index from the -blockindexsnapshot file.
+
+- A clean shutdown writes the snapshot, and the next start loads it.
+- A block index written after the snapshot makes it stale.
+- A corrupted snapshot is ignored.
+In every case the node must end up with the same block index.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class BlockIndexSnapshotTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 1
+        self.extra_args = [["-blockindexsnapshot"]]
+
+    def block_headers(self):
+        node = self.nodes[0]
+        return [node.getblockheader(node.getblockhash(height)) for height in range(node.getblockcount() + 1)]
+
+    def run_test(self):
+        node = self.nodes[0]
+        snapshot_path = node.chain_path / "blocks" / "index.snapshot"
+        self.generate(node, 10)
+        headers = self.block_headers()
+
+        self.log.info("Write the snapshot at shutdown and load it at startup")
+        with node.assert_debug_log(["Wrote block index snapshot with 11 entries"]):
+            self.stop_node(0)
+        assert snapshot_path.exists()
+        with node.assert_debug_log(["Loaded 11 block index entries from snapshot"]):
+            self.start_node(0)
+        assert_equal(self.block_headers(), headers)
+
+        self.log.info("Ignore a snapshot that is older than the block index database")
+        self.restart_node(0, extra_args=[])
+        self.generate(node, 5)
+        headers = self.block_headers()
+        with node.assert_debug_log(["No up-to-date block index snapshot"]):
+            self.restart_node(0)
+        assert_equal(self.block_headers(), headers)
+
+        self.log.info("Ignore a corrupted snapshot")
+        self.stop_node(0)
+        data = bytearray(snapshot_path.read_bytes())
+        data[100] ^= 1
+        snapshot_path.write_bytes(data)
+        with node.assert_debug_log(["Ignoring block index snapshot: checksum mismatch"]):
+            self.start_node(0)
+        assert_equal(self.block_headers(), headers)
+
+
+if __name__ == '__main__':
+    BlockIndexSnapshotTest().main()
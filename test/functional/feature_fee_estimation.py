@@ -109,6 +109,14 @@ def check_smart_estimates(node, fees_seen):
         else:
             assert_greater_than_or_equal(i + 1, e["blocks"])
 
+    # The fee curve returns the same conservative estimates in one call
+    curve = node.estimatefeecurve()
+    for i, e in enumerate(all_smart_estimates):
+        assert_equal(curve["estimates"][i]["target"], i + 1)
+        assert_equal(curve["estimates"][i]["blocks"], e["blocks"])
+        assert_equal(curve["estimates"][i]["conservative"], e["feerate"])
+    assert_equal(len(curve["mempool_feerate_percentiles"]), 5 if node.getmempoolinfo()["size"] else 0)
+
 
 def check_estimates(node, fees_seen):
     check_raw_estimates(node, fees_seen)
@@ -0,0 +1,82 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test dumpheaders and the -loadheaders option importing its file on startup."""
+
+from io import BytesIO
+import os
+
+from test_framework.messages import CBlockHeader
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.test_node import ErrorMatch
+from test_framework.util import (
+    assert_equal,
+    assert_raises_rpc_error,
+)
+
+HEADER_SIZE = 80
+
+
+class LoadHeadersTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.setup_clean_chain = True
+        self.num_nodes = 2
+
+    def setup_network(self):
+        # The second node only learns about the chain from the headers file
+        self.setup_nodes()
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.generate(node, 200, sync_fun=self.no_op)
+
+        self.log.info("Test dumpheaders")
+        headers_file = os.path.join(self.options.tmpdir, "headers.dat")
+        result = node.dumpheaders(headers_file)
+        assert_equal(result['headers_written'], 201)
+        assert_equal(result['base_height'], 200)
+        assert_equal(result['base_hash'], node.getbestblockhash())
+        assert_equal(result['path'], headers_file)
+        assert_equal(os.path.getsize(headers_file), 201 * HEADER_SIZE)
+        with open(headers_file, 'rb') as f:
+            data = f.read()
+        assert_raises_rpc_error(-8, "already exists", node.dumpheaders, headers_file)
+
+        self.log.info("Test that -loadheaders imports the headers without the blocks")
+        self.restart_node(1, extra_args=[f"-loadheaders={headers_file}"])
+        info = self.nodes[1].getblockchaininfo()
+        assert_equal(info['headers'], 200)
+        assert_equal(info['blocks'], 0)
+        assert {'height': 200, 'hash': node.getbestblockhash(), 'branchlen': 200, 'status': 'headers-only'} in self.nodes[1].getchaintips()
+
+        self.log.info("Test that importing known headers again succeeds")
+        self.restart_node(1, extra_args=[f"-loadheaders={headers_file}"])
+        assert_equal(self.nodes[1].getblockchaininfo()['headers'], 200)
+
+        self.log.info("Test that a file that does not start at a known header is rejected")
+        orphan_file = os.path.join(self.options.tmpdir, "orphan.dat")
+        with open(orphan_file, 'wb') as f:
+            f.write(data[150 * HEADER_SIZE:])
+        self.stop_node(1)
+        self.nodes[1].assert_start_raises_init_error([f"-loadheaders={orphan_file}", "-reindex"], "does not connect to a known header", match=ErrorMatch.PARTIAL_REGEX)
+
+        self.log.info("Test that a truncated file is rejected")
+        truncated_file = os.path.join(self.options.tmpdir, "truncated.dat")
+        with open(truncated_file, 'wb') as f:
+            f.write(data[:-1])
+        self.nodes[1].assert_start_raises_init_error([f"-loadheaders={truncated_file}"], "is truncated", match=ErrorMatch.PARTIAL_REGEX)
+
+        self.log.info("Test that a header with the wrong difficulty is rejected")
+        header = CBlockHeader()
+        header.deserialize(BytesIO(data[100 * HEADER_SIZE:101 * HEADER_SIZE]))
+        header.nBits = 0x1f00ffff
+        header.rehash()
+        invalid_file = os.path.join(self.options.tmpdir, "invalid.dat")
+        with open(invalid_file, 'wb') as f:
+            f.write(data[:100 * HEADER_SIZE] + header.serialize() + data[101 * HEADER_SIZE:])
+        self.nodes[1].assert_start_raises_init_error([f"-loadheaders={invalid_file}", "-reindex"], "A header after height 99 of headers file .* (has invalid proof of work|is invalid)", match=ErrorMatch.PARTIAL_REGEX)
+
+
+if __name__ == '__main__':
+    LoadHeadersTest().main()
@@ -5,6 +5,7 @@
 """Test bitcoin-cli"""
 
 from decimal import Decimal
+import json
 import re
 
 from test_framework.blocktools import COINBASE_MATURITY
@@ -94,6 +95,15 @@ class TestBitcoinCli(BitcoinTestFramework):
         assert_equal(['foo', 'bar'], self.nodes[0].cli(f'-rpcuser={user}', '-stdin', '-stdinrpcpass', input=f'{password}\nfoo\nbar').echo())
         assert_raises_process_error(1, 'Incorrect rpcuser or rpcpassword', self.nodes[0].cli(f'-rpcuser={user}', '-stdin', '-stdinrpcpass', input='foo').echo)
 
+        self.log.info("Test -batch sends the commands from standard input and prints the results in input order")
+        commands = [f'getblockhash {height}' for height in range(BLOCKS + 1)] + ['', '# a comment', 'echo "a b" c']
+        output = self.nodes[0].cli('-batch', '-batchconnections=3', input='\n'.join(commands)).send_cli().split('\n')
+        assert_equal(output[:BLOCKS + 1], [self.nodes[0].getblockhash(height) for height in range(BLOCKS + 1)])
+        assert_equal(json.loads('\n'.join(output[BLOCKS + 1:])), ['a b', 'c'])
+        assert_raises_rpc_error(-8, 'Block height out of range', self.nodes[0].cli('-batch', input=f'getblockhash 0\ngetblockhash {BLOCKS + 1}').send_cli)
+        assert_raises_process_error(1, '-batch reads the commands from standard input', self.nodes[0].cli('-batch').echo)
+        assert_raises_process_error(1, '-batch cannot be combined with -stdin', self.nodes[0].cli('-batch', '-stdin').send_cli)
+
         self.log.info("Test connecting to a non-existing server")
         assert_raises_process_error(1, "Could not connect to the server", self.nodes[0].cli('-rpcport=1').echo)
 
@@ -7,9 +7,55 @@
 from test_framework.test_framework import BitcoinTestFramework
 from test_framework.util import assert_equal, str_to_b64str
 
+from decimal import Decimal
 import http.client
+import json
 import urllib.parse
 
+
+def decode_cbor(data):
+    """Decode the subset of CBOR that RPC replies use into Python values."""
+    def decode(pos):
+        major, info = data[pos] >> 5, data[pos] & 0x1f
+        pos += 1
+        if info < 24:
+            arg = info
+        else:
+            size = 1 << (info - 24)
+            arg = int.from_bytes(data[pos:pos + size], 'big')
+            pos += size
+        if major == 0:
+            return arg, pos
+        if major == 1:
+            return -1 - arg, pos
+        if major in (2, 3):
+            raw = data[pos:pos + arg]
+            return (raw if major == 2 else raw.decode()), pos + arg
+        if major == 4:
+            items = []
+            for _ in range(arg):
+                item, pos = decode(pos)
+                items.append(item)
+            return items, pos
+        if major == 5:
+            obj = {}
+            for _ in range(arg):
+                key, pos = decode(pos)
+                obj[key], pos = decode(pos)
+            return obj, pos
+        if major == 6:
+            value, pos = decode(pos)
+            if arg == 4:
+                exponent, mantissa = value
+                return Decimal(mantissa).scaleb(exponent), pos
+            assert_equal(arg, 23)
+            return value, pos
+        return {20: False, 21: True, 22: None}[info], pos
+    value, end = decode(0)
+    assert_equal(end, len(data))
+    return value
+
+
 class HTTPBasicsTest (BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 3
@@ -104,6 +150,48 @@ class HTTPBasicsTest (BitcoinTestFramework):
         out1 = conn.getresponse()
         assert_equal(out1.status, http.client.BAD_REQUEST)
 
+        self.log.info("Check that concurrent connections are served by several event threads")
+        self.restart_node(2, extra_args=["-rpceventthreads=3"])
+        conns = []
+        for _ in range(12):
+            conn = http.client.HTTPConnection(urlNode2.hostname, urlNode2.port)
+            conn.connect()
+            conn.request('POST', '/', '{"method": "getbestblockhash"}', headers)
+            conns.append(conn)
+        for conn in conns:
+            out1 = conn.getresponse().read()
+            assert b'"error":null' in out1
+            # Persistent connections keep being answered by their own event thread
+            conn.request('POST', '/', '{"method": "getchaintips"}', headers)
+            assert b'"error":null' in conn.getresponse().read()
+            conn.close()
+
+        self.log.info("Check replies encoded as CBOR")
+        url = urllib.parse.urlparse(self.nodes[0].url)
+        headers = {"Authorization": f"Basic {str_to_b64str(f'{url.username}:{url.password}')}", "Accept": "application/cbor"}
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.connect()
+        genesis = self.nodes[0].getblockhash(0)
+        conn.request('POST', '/', json.dumps({"method": "getblockheader", "params": [genesis, False], "id": 1}), headers)
+        response = conn.getresponse()
+        assert_equal(response.getheader('Content-Type'), 'application/cbor')
+        reply = decode_cbor(response.read())
+        # Hex fields arrive as raw bytes
+        assert_equal(reply, {"result": bytes.fromhex(self.nodes[0].getblockheader(genesis, False)), "error": None, "id": 1})
+
+        conn.request('POST', '/', json.dumps([{"method": "getblockcount", "id": 2}, {"method": "getblockheader", "params": [genesis], "id": 3}]), headers)
+        replies = decode_cbor(conn.getresponse().read())
+        assert_equal(replies[0]["result"], self.nodes[0].getblockcount())
+        header = self.nodes[0].getblockheader(genesis)
+        assert_equal(replies[1]["result"]["hash"], bytes.fromhex(header["hash"]))
+        assert_equal(replies[1]["result"]["difficulty"], Decimal(str(header["difficulty"])))
+
+        conn.request('POST', '/', json.dumps({"method": "invalidmethod", "id": 4}), headers)
+        response = conn.getresponse()
+        assert_equal(response.status, http.client.NOT_FOUND)
+        assert_equal(decode_cbor(response.read())["error"]["code"], -32601)
+        conn.close()
+
 
 if __name__ == '__main__':
     HTTPBasicsTest ().main ()
@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the /metrics endpoint enabled by -metrics."""
+
+import http.client
+import re
+import urllib.parse
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import (
+    assert_equal,
+    assert_greater_than,
+)
+from test_framework.wallet import MiniWallet
+
+
+class MetricsTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.extra_args = [["-metrics"], []]
+
+    def get_metrics(self, node, method='GET'):
+        url = urllib.parse.urlparse(node.url)
+        conn = http.client.HTTPConnection(url.hostname, url.port)
+        conn.request(method, '/metrics')
+        resp = conn.getresponse()
+        return resp.status, resp.getheader('Content-Type'), resp.read().decode('utf-8')
+
+    def parse_samples(self, text):
+        samples = {}
+        for line in text.splitlines():
+            if line.startswith('#'):
+                continue
+            name, value = line.rsplit(' ', 1)
+            samples[name] = float(value)
+        return samples
+
+    def run_test(self):
+        node = self.nodes[0]
+        wallet = MiniWallet(node)
+        self.generate(wallet, 10)
+        wallet.send_self_transfer(from_node=node)
+
+        self.log.info("Test the metrics of a node serving them")
+        status, content_type, text = self.get_metrics(node)
+        assert_equal(status, 200)
+        assert content_type.startswith('text/plain; version=0.0.4')
+        for line in text.splitlines():
+            assert re.match(r'^(# (HELP|TYPE) \w+ .+|\w+(\{[^}]*\})? [0-9.e+-]+)$', line), line
+        samples = self.parse_samples(text)
+        assert_equal(samples['certurium_chain_height'], node.getblockcount())
+        # The cached chain was loaded from disk, only the blocks generated here were connected
+        assert_equal(samples['certurium_block_connect_seconds_count{phase="total"}'], 10)
+        assert_equal(samples['certurium_block_connect_seconds_bucket{phase="total",le="+Inf"}'], 10)
+        assert_greater_than(samples['certurium_mempool_accept_seconds_count'], 0)
+        assert_greater_than(samples['certurium_net_message_bytes_total{direction="sent",type="version"}'], 0)
+        assert_greater_than(samples['certurium_net_message_bytes_total{direction="received",type="verack"}'], 0)
+        # Measured at startup, before anything was generated here
+        assert_greater_than(samples['certurium_memory_usage_bytes{subsystem="block_index"}'], 0)
+        assert_greater_than(samples['certurium_memory_usage_bytes{subsystem="signature_cache"}'], 0)
+
+        self.log.info("Test that only GET is served")
+        status, _, _ = self.get_metrics(node, 'POST')
+        assert_equal(status, 405)
+
+        self.log.info("Test that metrics are not served by default")
+        status, _, _ = self.get_metrics(self.nodes[1])
+        assert_equal(status, 404)
+
+
+if __name__ == '__main__':
+    MetricsTest().main()
@@ -313,6 +313,27 @@ class RESTTest (BitcoinTestFramework):
                 self.test_rest_request(f"/headers/{bb_hash}", ret_type=RetType.BYTES, status=400, query_params={"count": num}),
             )
 
+        self.log.info("Test the /blockrange and /headerrange URIs")
+        tip_height = self.nodes[0].getblockcount()
+        start = tip_height - 5
+        hashes = [self.nodes[0].getblockhash(h) for h in range(start, tip_height + 1)]
+        blocks = self.test_rest_request(f"/blockrange/{start}/{tip_height}", req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(blocks, b''.join(bytes.fromhex(self.nodes[0].getblock(h, 0)) for h in hashes))
+        blocks_hex = self.test_rest_request(f"/blockrange/{start}/{tip_height}", req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(blocks_hex.decode().split(), [self.nodes[0].getblock(h, 0) for h in hashes])
+        headers = self.test_rest_request(f"/headerrange/{start}/{tip_height}", req_type=ReqType.BIN, ret_type=RetType.BYTES)
+        assert_equal(headers, b''.join(bytes.fromhex(self.nodes[0].getblockheader(h, False)) for h in hashes))
+        headers_hex = self.test_rest_request(f"/headerrange/0/{tip_height}", req_type=ReqType.HEX, ret_type=RetType.BYTES)
+        assert_equal(len(headers_hex.decode().split()), tip_height + 1)
+        assert_equal(headers_hex.decode().split()[-1], self.nodes[0].getblockheader(hashes[-1], False))
+
+        # Check invalid range requests
+        self.test_rest_request(f"/blockrange/{start}/{tip_height + 1}", req_type=ReqType.BIN, status=404, ret_type=RetType.OBJ)
+        self.test_rest_request(f"/blockrange/{tip_height}/{start}", req_type=ReqType.BIN, status=400, ret_type=RetType.OBJ)
+        self.test_rest_request("/blockrange/0/1000", req_type=ReqType.BIN, status=400, ret_type=RetType.OBJ)
+        self.test_rest_request(f"/blockrange/{start}", req_type=ReqType.BIN, status=400, ret_type=RetType.OBJ)
+        self.test_rest_request(f"/headerrange/0/{tip_height}", req_type=ReqType.JSON, status=404, ret_type=RetType.OBJ)
+
         self.log.info("Test tx inclusion in the /mempool and /block URIs")
 
         # Make 3 chained txs and mine them on node 1
@@ -74,6 +74,24 @@ class RPCInterfaceTest(BitcoinTestFramework):
         assert_equal(result_by_id[3]['error'], None)
         assert result_by_id[3]['result'] is not None
 
+        self.log.info("Testing JSON-RPC batch request of read-only calls executed in parallel...")
+        genesis = self.nodes[0].getblockhash(0)
+        calls = []
+        for i in range(50):
+            calls.append({"method": "getblockheader", "id": 2 * i, "params": [genesis]})
+            calls.append({"method": "getblockhash", "id": 2 * i + 1, "params": [i]})
+        calls.append({"method": "getblockcount", "id": 100})
+        results = self.nodes[0].batch(calls)
+        # Replies come back in the order of the calls
+        assert_equal([res["id"] for res in results], list(range(101)))
+        for i in range(50):
+            assert_equal(results[2 * i]['result']['hash'], genesis)
+            if i == 0:
+                assert_equal(results[1]['result'], genesis)
+            else:
+                assert_equal(results[2 * i + 1]['error']['code'], -8)
+        assert_equal(results[100]['result'], 0)
+
     def test_http_status_codes(self):
         self.log.info("Testing HTTP status codes for JSON-RPC requests...")
 
@@ -0,0 +1,179 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+""" Tests the pow:* tracepoint API interface.
+    See doc/tracing.md#context-pow
+"""
+
+import ctypes
+
+# Test will be skipped if we don't have bcc installed
+try:
+    from bcc import BPF, USDT # type: ignore[import]
+except ImportError:
+    pass
+
+from test_framework.address import ADDRESS_BCRT1_UNSPENDABLE
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+pow_neoscrypt_hash_program = """
+#include <uapi/linux/ptrace.h>
+
+typedef signed long long i64;
+
+struct neoscrypt_hash
+{
+    char        hash[32];
+    u32         options;
+    i64         duration;
+};
+
+BPF_PERF_OUTPUT(neoscrypt_hash);
+int trace_neoscrypt_hash(struct pt_regs *ctx) {
+    struct neoscrypt_hash event = {};
+    bpf_usdt_readarg_p(1, ctx, &event.hash, 32);
+    bpf_usdt_readarg(2, ctx, &event.options);
+    bpf_usdt_readarg(3, ctx, &event.duration);
+    neoscrypt_hash.perf_submit(ctx, &event, sizeof(event));
+    return 0;
+}
+"""
+
+pow_check_headers_program = """
+#include <uapi/linux/ptrace.h>
+
+typedef signed long long i64;
+
+struct check_headers
+{
+    u64         headers;
+    u64         checks;
+    bool        parallel;
+    bool        valid;
+    i64         duration;
+};
+
+BPF_PERF_OUTPUT(check_headers);
+int trace_check_headers(struct pt_regs *ctx) {
+    struct check_headers event = {};
+    bpf_usdt_readarg(1, ctx, &event.headers);
+    bpf_usdt_readarg(2, ctx, &event.checks);
+    bpf_usdt_readarg(3, ctx, &event.parallel);
+    bpf_usdt_readarg(4, ctx, &event.valid);
+    bpf_usdt_readarg(5, ctx, &event.duration);
+    check_headers.perf_submit(ctx, &event, sizeof(event));
+    return 0;
+}
+"""
+
+
+class NeoScryptHash(ctypes.Structure):
+    _fields_ = [
+        ("hash", ctypes.c_ubyte * 32),
+        ("options", ctypes.c_uint32),
+        ("duration", ctypes.c_int64),
+    ]
+
+    def __repr__(self):
+        return "NeoScryptHash(hash=%s options=%d duration=%d)" % (
+            bytes(self.hash[::-1]).hex(), self.options, self.duration)
+
+
+class CheckHeaders(ctypes.Structure):
+    _fields_ = [
+        ("headers", ctypes.c_uint64),
+        ("checks", ctypes.c_uint64),
+        ("parallel", ctypes.c_bool),
+        ("valid", ctypes.c_bool),
+        ("duration", ctypes.c_int64),
+    ]
+
+    def __repr__(self):
+        return "CheckHeaders(headers=%d checks=%d parallel=%s valid=%s duration=%d)" % (
+            self.headers, self.checks, self.parallel, self.valid, self.duration)
+
+
+class PoWTracepointTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_platform_not_linux()
+        self.skip_if_no_bitcoind_tracepoints()
+        self.skip_if_no_python_bcc()
+        self.skip_if_no_bpf_permissions()
+
+    def run_test(self):
+        self.test_neoscrypt_hash()
+        self.test_check_headers()
+
+    def test_neoscrypt_hash(self):
+        """ Tests the pow:neoscrypt_hash tracepoint by mining blocks, which
+        hashes the header of each of them at least once."""
+        BLOCKS_EXPECTED = 2
+        hashes = 0
+
+        self.log.info("hook into the pow:neoscrypt_hash tracepoint")
+        ctx = USDT(pid=self.nodes[0].process.pid)
+        ctx.enable_probe(probe="pow:neoscrypt_hash", fn_name="trace_neoscrypt_hash")
+        bpf = BPF(text=pow_neoscrypt_hash_program, usdt_contexts=[ctx], debug=0)
+
+        def handle_neoscrypt_hash(_, data, __):
+            nonlocal hashes
+            event = ctypes.cast(data, ctypes.POINTER(NeoScryptHash)).contents
+            self.log.debug(f"handle_neoscrypt_hash(): {event}")
+            hashes += 1
+
+        bpf["neoscrypt_hash"].open_perf_buffer(handle_neoscrypt_hash)
+
+        self.log.info(f"mine {BLOCKS_EXPECTED} blocks")
+        self.generatetoaddress(self.nodes[0], BLOCKS_EXPECTED, ADDRESS_BCRT1_UNSPENDABLE)
+
+        bpf.perf_buffer_poll(timeout=200)
+        bpf.cleanup()
+
+        self.log.info(f"check that we traced at least {BLOCKS_EXPECTED} hashes")
+        assert hashes >= BLOCKS_EXPECTED
+
+    def test_check_headers(self):
+        """ Tests the pow:check_headers tracepoint by letting the second node
+        sync the headers of blocks it missed while disconnected."""
+        BLOCKS_EXPECTED = 10
+        headers_checked = 0
+        batches_invalid = 0
+
+        self.disconnect_nodes(0, 1)
+        self.log.info(f"mine {BLOCKS_EXPECTED} blocks the second node does not know about")
+        self.generatetoaddress(self.nodes[0], BLOCKS_EXPECTED, ADDRESS_BCRT1_UNSPENDABLE, sync_fun=self.no_op)
+
+        self.log.info("hook into the pow:check_headers tracepoint")
+        ctx = USDT(pid=self.nodes[1].process.pid)
+        ctx.enable_probe(probe="pow:check_headers", fn_name="trace_check_headers")
+        bpf = BPF(text=pow_check_headers_program, usdt_contexts=[ctx], debug=0)
+
+        def handle_check_headers(_, data, __):
+            nonlocal headers_checked, batches_invalid
+            event = ctypes.cast(data, ctypes.POINTER(CheckHeaders)).contents
+            self.log.info(f"handle_check_headers(): {event}")
+            headers_checked += event.headers
+            batches_invalid += not event.valid
+
+        bpf["check_headers"].open_perf_buffer(handle_check_headers)
+
+        self.connect_nodes(0, 1)
+        self.sync_blocks()
+
+        bpf.perf_buffer_poll(timeout=200)
+        bpf.cleanup()
+
+        self.log.info(f"check that the headers of the {BLOCKS_EXPECTED} blocks were checked")
+        assert headers_checked >= BLOCKS_EXPECTED
+        assert_equal(0, batches_invalid)
+
+
+if __name__ == '__main__':
+    PoWTracepointTest().main()
@@ -21,6 +21,7 @@ from test_framework.messages import (
 )
 from test_framework.util import (
     assert_equal,
+    assert_greater_than_or_equal,
     assert_raises_rpc_error,
 )
 from test_framework.wallet import (
@@ -120,7 +121,9 @@ class ZMQTest (BitcoinTestFramework):
             self.test_mempool_sync()
             self.test_reorg()
             self.test_multiple_interfaces()
+            self.test_batch()
             self.test_ipv6()
+            self.test_template()
         finally:
             # Destroy the ZMQ context.
             self.log.debug("Destroying ZMQ context")
@@ -128,7 +131,7 @@ class ZMQTest (BitcoinTestFramework):
 
     # Restart node with the specified zmq notifications enabled, subscribe to
     # all of them and return the corresponding ZMQSubscriber objects.
-    def setup_zmq_test(self, services, *, recv_timeout=60, sync_blocks=True, ipv6=False):
+    def setup_zmq_test(self, services, *, recv_timeout=60, sync_blocks=True, ipv6=False, extra_args=[]):
         subscribers = []
         for topic, address in services:
             socket = self.ctx.socket(zmq.SUB)
@@ -137,7 +140,7 @@ class ZMQTest (BitcoinTestFramework):
             subscribers.append(ZMQSubscriber(socket, topic.encode()))
 
         self.restart_node(0, [f"-zmqpub{topic}={address}" for topic, address in services] +
-                             self.extra_args[0])
+                             self.extra_args[0] + extra_args)
 
         for i, sub in enumerate(subscribers):
             sub.socket.connect(services[i][1])
@@ -235,12 +238,15 @@ class ZMQTest (BitcoinTestFramework):
 
 
         self.log.info("Test the getzmqnotifications RPC")
-        assert_equal(self.nodes[0].getzmqnotifications(), [
-            {"type": "pubhashblock", "address": address, "hwm": 1000},
-            {"type": "pubhashtx", "address": address, "hwm": 1000},
-            {"type": "pubrawblock", "address": address, "hwm": 1000},
-            {"type": "pubrawtx", "address": address, "hwm": 1000},
+        notifications = self.nodes[0].getzmqnotifications()
+        assert_equal([{key: n[key] for key in ["type", "address", "hwm", "batch", "maxqueue", "dropped"]} for n in notifications], [
+            {"type": "pubhashblock", "address": address, "hwm": 1000, "batch": 0, "maxqueue": 10000, "dropped": 0},
+            {"type": "pubhashtx", "address": address, "hwm": 1000, "batch": 0, "maxqueue": 10000, "dropped": 0},
+            {"type": "pubrawblock", "address": address, "hwm": 1000, "batch": 0, "maxqueue": 10000, "dropped": 0},
+            {"type": "pubrawtx", "address": address, "hwm": 1000, "batch": 0, "maxqueue": 10000, "dropped": 0},
         ])
+        # Every block and transaction of this test was sent
+        assert all(n["sent"] >= num_blocks for n in notifications)
 
         assert_equal(self.nodes[1].getzmqnotifications(), [])
 
@@ -560,6 +566,24 @@ class ZMQTest (BitcoinTestFramework):
         assert_equal(self.nodes[0].getbestblockhash(), subscribers[0].receive().hex())
         assert_equal(self.nodes[0].getbestblockhash(), subscribers[1].receive().hex())
 
+    def test_batch(self):
+        self.log.info("Testing batched notifications")
+        address = "tcp://127.0.0.1:28334"
+        [hashtx] = self.setup_zmq_test([("hashtx", address)], sync_blocks=False,
+                                       extra_args=["-zmqpubhashtxbatch=100", "-zmqpubhashtxqueue=50"])
+
+        num_blocks = 5
+        genhashes = self.generatetoaddress(self.nodes[0], num_blocks, ADDRESS_BCRT1_UNSPENDABLE, sync_fun=self.no_op)
+        # The coinbase txids arrive in order, with consecutive sequence numbers
+        for blockhash in genhashes:
+            assert_equal(self.nodes[0].getblock(blockhash)["tx"], [hashtx.receive().hex()])
+
+        [notification] = self.nodes[0].getzmqnotifications()
+        assert_equal(notification["batch"], 100)
+        assert_equal(notification["maxqueue"], 50)
+        assert_equal(notification["dropped"], 0)
+        assert_greater_than_or_equal(notification["sent"], num_blocks)
+
     def test_ipv6(self):
         if not test_ipv6_local():
             self.log.info("Skipping IPv6 test, because IPv6 is not supported.")
@@ -576,6 +600,41 @@ class ZMQTest (BitcoinTestFramework):
         # Should receive the same block hash
         assert_equal(self.nodes[0].getbestblockhash(), subscribers[0].receive().hex())
 
+    def test_template(self):
+        self.log.info("Testing template notifications")
+        subscribers = self.setup_zmq_test([
+            ("template", "tcp://127.0.0.1:28336")
+        ], sync_blocks=False, extra_args=["-zmqpubtemplatefeedelta=0"])
+        template = subscribers[0]
+
+        def receive_template():
+            body = template.receive()
+            assert_equal((len(body) - 72) % 32, 0)
+            prevhash, templateid = body[:32].hex(), body[32:64].hex()
+            bits, curtime = struct.unpack("<II", body[64:72])
+            branch = [body[i:i + 32].hex() for i in range(72, len(body), 32)]
+            return prevhash, templateid, bits, curtime, branch
+
+        self.generatetoaddress(self.nodes[0], 1, ADDRESS_BCRT1_UNSPENDABLE, sync_fun=self.no_op)
+        tip = self.nodes[0].getbestblockhash()
+        prevhash, templateid, bits, curtime, branch = receive_template()
+        gbt = self.nodes[0].getblocktemplate({"rules": ["segwit"]})
+        assert_equal(prevhash, tip)
+        assert_equal(templateid, gbt["templateid"])
+        assert_equal(f"{bits:08x}", gbt["bits"])
+        assert curtime >= gbt["mintime"]
+        assert_equal(branch, [])
+
+        self.log.info("A new transaction improves the template fees")
+        # Rebuilds for new transactions are rate limited to one a second
+        sleep(1.1)
+        self.wallet.rescan_utxos()
+        txid = self.wallet.send_self_transfer(from_node=self.nodes[0])["txid"]
+        prevhash, templateid, bits, curtime, branch = receive_template()
+        assert_equal(prevhash, tip)
+        assert_equal(branch, [txid])
+        assert templateid != gbt["templateid"]
+
 
 if __name__ == '__main__':
     ZMQTest().main()
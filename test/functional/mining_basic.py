@@ -6,12 +6,15 @@
 
 - getmininginfo
 - getblocktemplate proposal mode
-- submitblock"""
+- submitblock
+- submitsolution"""
 
 import copy
 from decimal import Decimal
 
 from test_framework.blocktools import (
+    add_witness_commitment,
+    create_block,
     create_coinbase,
     get_witness_script,
     NORMAL_GBT_REQUEST_PARAMS,
@@ -22,6 +25,7 @@ from test_framework.messages import (
     CBlockHeader,
     BLOCK_HEADER_SIZE,
     ser_uint256,
+    uint256_from_compact,
 )
 from test_framework.p2p import P2PDataStore
 from test_framework.test_framework import BitcoinTestFramework
@@ -278,6 +282,45 @@ class MiningTest(BitcoinTestFramework):
         node.submitheader(hexdata=CBlockHeader(bad_block_root).serialize().hex())
         assert_equal(node.submitblock(hexdata=block.serialize().hex()), 'duplicate')  # valid
 
+        self.test_submitsolution()
+
+    def test_submitsolution(self):
+        node = self.nodes[0]
+        self.log.info("submitsolution: Test a solution of a template")
+        txid = self.wallet.send_self_transfer(from_node=node)['txid']
+        tmpl = node.getblocktemplate(NORMAL_GBT_REQUEST_PARAMS)
+        coinbase = create_coinbase(height=tmpl['height'])
+        coinbase.vout[0].nValue = tmpl['coinbasevalue']
+        block = create_block(tmpl=tmpl, coinbase=coinbase, txlist=[tx['data'] for tx in tmpl['transactions']])
+        add_witness_commitment(block)
+        block.solve()
+        header = CBlockHeader(block).serialize().hex()
+        coinbase_hex = block.vtx[0].serialize().hex()
+
+        assert_raises_rpc_error(-8, "Unknown templateid", node.submitsolution, "00" * 32, header, coinbase_hex)
+        assert_raises_rpc_error(-22, "Block header decode failed", node.submitsolution, tmpl['templateid'], header[:-2], coinbase_hex)
+        assert_raises_rpc_error(-22, "Transaction is not a coinbase", node.submitsolution, tmpl['templateid'], header, block.vtx[1].serialize().hex())
+
+        bad_prev = copy.deepcopy(block)
+        bad_prev.hashPrevBlock = 123
+        assert_raises_rpc_error(-8, "does not build on the previous block of the template", node.submitsolution, tmpl['templateid'], CBlockHeader(bad_prev).serialize().hex(), coinbase_hex)
+
+        bad_root = copy.deepcopy(block)
+        bad_root.hashMerkleRoot += 1
+        bad_root.solve()
+        assert_equal(node.submitsolution(tmpl['templateid'], CBlockHeader(bad_root).serialize().hex(), coinbase_hex), 'bad-txnmrklroot')
+
+        high_hash = copy.deepcopy(block)
+        while high_hash.sha256 <= uint256_from_compact(high_hash.nBits):
+            high_hash.nNonce += 1
+            high_hash.rehash()
+        assert_equal(node.submitsolution(tmpl['templateid'], CBlockHeader(high_hash).serialize().hex(), coinbase_hex), 'high-hash')
+
+        assert_equal(node.submitsolution(tmpl['templateid'], header, coinbase_hex), None)
+        assert_equal(node.getbestblockhash(), block.hash)
+        assert_equal(node.getrawtransaction(txid, True, block.hash)['confirmations'], 1)
+        assert_equal(node.submitsolution(tmpl['templateid'], header, coinbase_hex), 'duplicate')
+
 
 if __name__ == '__main__':
     MiningTest().main()
@@ -0,0 +1,58 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""
+Test that a child received over P2P pays for a parent whose feerate is too
+low on its own, whether the parent or the child arrives first.
+"""
+from decimal import Decimal
+
+from test_framework.messages import msg_tx
+from test_framework.p2p import P2PInterface
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+from test_framework.wallet import MiniWallet
+
+
+class P2PTxPackageTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def create_package(self):
+        parent = self.wallet.create_self_transfer(fee_rate=0)
+        child = self.wallet.create_self_transfer(utxo_to_spend=parent["new_utxo"], fee_rate=Decimal("0.01"))
+        return parent, child
+
+    def run_test(self):
+        node = self.nodes[0]
+        self.wallet = MiniWallet(node)
+        self.wallet.rescan_utxos()
+        peer = node.add_p2p_connection(P2PInterface())
+
+        self.log.info("A parent with a feerate too low on its own is accepted along with its child")
+        parent, child = self.create_package()
+        peer.send_and_ping(msg_tx(parent["tx"]))
+        assert_equal(node.getrawmempool(), [])
+        peer.send_and_ping(msg_tx(child["tx"]))
+        assert_equal(sorted(node.getrawmempool()), sorted([parent["txid"], child["txid"]]))
+
+        self.log.info("The same goes for a child in the orphanage when its parent arrives")
+        self.generate(node, 1)
+        parent, child = self.create_package()
+        peer.send_and_ping(msg_tx(child["tx"]))
+        assert_equal(node.getrawmempool(), [])
+        peer.send_and_ping(msg_tx(parent["tx"]))
+        assert_equal(sorted(node.getrawmempool()), sorted([parent["txid"], child["txid"]]))
+
+        self.log.info("A child that does not pay enough leaves both out of the mempool")
+        self.generate(node, 1)
+        parent = self.wallet.create_self_transfer(fee_rate=0)
+        child = self.wallet.create_self_transfer(utxo_to_spend=parent["new_utxo"], fee_rate=0)
+        peer.send_and_ping(msg_tx(parent["tx"]))
+        peer.send_and_ping(msg_tx(child["tx"]))
+        assert_equal(node.getrawmempool(), [])
+
+
+if __name__ == '__main__':
+    P2PTxPackageTest().main()
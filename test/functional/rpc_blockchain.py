@@ -82,6 +82,7 @@ class BlockchainTest(BitcoinTestFramework):
         self._test_getblockchaininfo()
         self._test_getchaintxstats()
         self._test_gettxoutsetinfo()
+        self._test_getscriptstats()
         self._test_getblockheader()
         self._test_getdifficulty()
         self._test_getnetworkhashps()
@@ -89,7 +90,7 @@ class BlockchainTest(BitcoinTestFramework):
         self._test_waitforblockheight()
         self._test_getblock()
         self._test_getdeploymentinfo()
-        assert self.nodes[0].verifychain(4, 0)
+        self._test_verifychain()
 
     def mine_chain(self):
         self.log.info(f"Generate {HEIGHT} blocks after the genesis block in ten-minute steps")
@@ -370,6 +371,41 @@ class BlockchainTest(BitcoinTestFramework):
         # Unknown hash_type raises an error
         assert_raises_rpc_error(-8, "'foo hash' is not a valid hash_type", node.gettxoutsetinfo, "foo hash")
 
+    def _test_verifychain(self):
+        self.log.info("Test verifychain")
+        node = self.nodes[0]
+        # The node was restarted with -checkblocks=-1, which are verified in the background
+        self.wait_until(lambda: not node.verifychain(status=True)['running'])
+        status = node.verifychain(status=True)
+        assert_equal(status['checklevel'], 3)
+        assert_equal(status['nblocks'], -1)
+        assert_equal(status['progress'], 100)
+        assert status['verified']
+        assert node.verifychain(4, 0)
+
+    def _test_getscriptstats(self):
+        self.log.info("Test getscriptstats")
+        node = self.nodes[0]
+        res = node.getscriptstats()
+        utxo = res['utxo']
+        assert_equal(utxo['count'], node.gettxoutsetinfo()['txouts'])
+        assert_equal(sum(utxo['sizes'].values()), utxo['count'])
+        assert_equal(sum(utxo['types'].values()), utxo['count'])
+        assert_equal(utxo['heap_allocated'], sum(n for size, n in utxo['sizes'].items() if int(size) > res['inline_size']))
+        assert 'blocks' not in res
+
+        res = node.getscriptstats(10)
+        blocks = res['blocks']
+        assert_equal(blocks['start_height'], HEIGHT - 9)
+        assert_equal(blocks['end_height'], HEIGHT)
+        outputs = sum(len(node.getblock(node.getblockhash(h), 2)['tx'][0]['vout']) for h in range(HEIGHT - 9, HEIGHT + 1))
+        assert_equal(blocks['outputs']['count'], outputs)
+        # The blocks only have coinbase transactions
+        assert_equal(blocks['scriptsigs']['count'], 0)
+        assert 'types' not in blocks['scriptsigs']
+
+        assert_raises_rpc_error(-8, "Negative number of blocks", node.getscriptstats, -1)
+
     def _test_getblockheader(self):
         self.log.info("Test getblockheader")
         node = self.nodes[0]
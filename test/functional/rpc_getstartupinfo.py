@@ -0,0 +1,51 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the getstartupinfo RPC.
+
+Test corresponds to code in rpc/node.cpp.
+"""
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class GetStartupInfoTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 2
+        self.setup_clean_chain = True
+        self.extra_args = [[], ["-blocksonly"]]
+
+    def stages(self, node):
+        return {stage["name"]: stage for stage in node.getstartupinfo()["stages"]}
+
+    def run_test(self):
+        self.log.info("Test that every stage of startup is reported")
+        info = self.nodes[0].getstartupinfo()
+        stages = self.stages(self.nodes[0])
+        for name in ["verify_wallets", "addrman", "banlist", "fee_estimates", "load_chainstate",
+                     "verify_chainstate", "indexes", "load_wallets", "start_node"]:
+            assert name in stages
+            assert stages[name]["start"] + stages[name]["duration"] <= info["total"]
+
+        self.log.info("Test that the databases of the network and fee estimation load in parallel")
+        for name in ["addrman", "banlist", "fee_estimates"]:
+            assert stages[name]["parallel"]
+        for name in ["load_chainstate", "indexes", "start_node"]:
+            assert not stages[name]["parallel"]
+
+        self.log.info("Test that the block import shows up once done")
+        self.wait_until(lambda: "import" in self.stages(self.nodes[0]))
+        assert self.stages(self.nodes[0])["import"]["parallel"]
+
+        self.log.info("Test that fee estimates are not read with -blocksonly")
+        assert "fee_estimates" not in self.stages(self.nodes[1])
+
+        self.log.info("Test that the stages are timed again after a restart")
+        self.restart_node(0)
+        assert_equal(len([s for s in self.nodes[0].getstartupinfo()["stages"] if s["name"] == "load_chainstate"]), 1)
+
+
+if __name__ == '__main__':
+    GetStartupInfoTest().main()
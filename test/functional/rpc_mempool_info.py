@@ -15,6 +15,7 @@ from test_framework.wallet import MiniWallet
 class RPCMempoolInfoTest(BitcoinTestFramework):
     def set_test_params(self):
         self.num_nodes = 1
+        self.extra_args = [["-mempooldeltaevents=10"]]
 
     def run_test(self):
         self.wallet = MiniWallet(self.nodes[0])
@@ -95,6 +96,30 @@ class RPCMempoolInfoTest(BitcoinTestFramework):
         self.log.info("Missing txid")
         assert_raises_rpc_error(-3, "Missing txid", self.nodes[0].gettxspendingprevout, [{'vout' : 3}])
 
+        self.log.info("Changes since a mempool sequence")
+        node = self.nodes[0]
+        sequence = node.getrawmempool(verbose=False, mempool_sequence=True)["mempool_sequence"]
+        assert_equal(node.getmempooldelta(sequence), {"full_resync": False, "events": [], "mempool_sequence": sequence})
+        txid = self.wallet.send_self_transfer(from_node=node)["txid"]
+        delta = node.getmempooldelta(sequence)
+        assert_equal(delta, {"full_resync": False, "events": [{"sequence": sequence, "txid": txid, "type": "added"}], "mempool_sequence": sequence + 1})
+
+        self.log.info("Transactions leaving the mempool for a block are reported")
+        mempool = node.getrawmempool()
+        self.generate(node, 1)
+        delta = node.getmempooldelta(sequence + 1)
+        assert_equal(delta["full_resync"], False)
+        assert_equal(sorted(event["txid"] for event in delta["events"]), sorted(mempool))
+        assert all(event["type"] == "removed" for event in delta["events"])
+        assert_equal(delta["mempool_sequence"], sequence + 1 + len(mempool))
+
+        self.log.info("Full resync when the changes are no longer kept")
+        txid = self.wallet.send_self_transfer(from_node=node)["txid"]
+        delta = node.getmempooldelta(0)
+        assert_equal(delta, {"full_resync": True, "txids": [txid], "mempool_sequence": sequence + 2 + len(mempool)})
+        assert_equal(node.getmempooldelta(delta["mempool_sequence"] + 1)["full_resync"], True)
+        assert_raises_rpc_error(-8, "since_sequence must not be negative", node.getmempooldelta, -1)
+
 
 if __name__ == '__main__':
     RPCMempoolInfoTest().main()
@@ -54,6 +54,17 @@ class RpcMiscTest(BitcoinTestFramework):
 
         assert_raises_rpc_error(-8, "unknown mode foobar", node.getmemoryinfo, mode="foobar")
 
+        self.log.info("test getmemoryusage")
+        usage = node.getmemoryusage()
+        subsystems = usage['subsystems']
+        for name in ['coins_cache', 'coins_db', 'block_index', 'block_index_db', 'script_cache', 'signature_cache', 'pow_cache', 'mempool', 'addrman', 'peer_buffers', 'indexes']:
+            assert_greater_than_or_equal(subsystems[name], 0)
+        # The cached chain and the caches sized at startup always take memory
+        assert_greater_than(subsystems['coins_cache'], 0)
+        assert_greater_than(subsystems['block_index'], 0)
+        assert_greater_than(subsystems['signature_cache'], 0)
+        assert_equal(usage['total'], sum(subsystems.values()))
+
         self.log.info("test logging rpc and help")
 
         # Test toggling a logging category on/off/on with the logging RPC.
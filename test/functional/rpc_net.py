@@ -104,6 +104,14 @@ class NetTest(BitcoinTestFramework):
         assert_equal(peer_info[1][0]['connection_type'], 'manual')
         assert_equal(peer_info[1][1]['connection_type'], 'inbound')
 
+        # The block and transaction relayed went out of their send queues
+        for info in peer_info:
+            assert_equal(sorted(info[0]['send_queues'].keys()), ['addr', 'block', 'tx'])
+            for queue in info[0]['send_queues'].values():
+                assert_equal(queue['queued_bytes'], 0)
+                assert queue['max_delay'] >= queue['mean_delay'] >= 0
+            assert info[0]['send_queues']['block']['sent_msgs'] > 0
+
         # Check dynamically generated networks list in getpeerinfo help output.
         assert "(ipv4, ipv6, onion, i2p, cjdns, not_publicly_routable)" in self.nodes[0].help("getpeerinfo")
 
@@ -315,6 +315,21 @@ class PSBTTest(BitcoinTestFramework):
         rawtx = self.nodes[1].createrawtransaction([{"txid":txid,"vout":p2wpkh_pos}], {self.nodes[1].getnewaddress():9.99})
         assert_raises_rpc_error(-22, "TX decode failed", self.nodes[1].walletprocesspsbt, rawtx)
 
+        self.log.info("Test walletprocesspsbts processes each PSBT of a batch like walletprocesspsbt")
+        batch = [self.nodes[1].walletcreatefundedpsbt([], {self.nodes[0].getnewaddress(): 1 + i})['psbt'] for i in range(5)]
+        batch_out = self.nodes[1].walletprocesspsbts(batch + [rawtx])
+        assert_equal(len(batch_out), len(batch) + 1)
+        for psbt, out in zip(batch, batch_out):
+            assert_equal(out, self.nodes[1].walletprocesspsbt(psbt))
+            assert_equal(out['complete'], True)
+        assert "TX decode failed" in batch_out[-1]['error']
+        assert 'psbt' not in batch_out[-1]
+        batch_out = self.nodes[1].walletprocesspsbts(psbts=batch, sign=False)
+        for psbt, out in zip(batch, batch_out):
+            assert_equal(out, self.nodes[1].walletprocesspsbt(psbt=psbt, sign=False))
+            assert_equal(out['complete'], False)
+        assert_equal(self.nodes[1].walletprocesspsbts([]), [])
+
         # Convert a non-psbt to psbt and make sure we can decode it
         rawtx = self.nodes[0].createrawtransaction([], {self.nodes[1].getnewaddress():10})
         rawtx = self.nodes[0].fundrawtransaction(rawtx)
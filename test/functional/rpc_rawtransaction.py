@@ -83,6 +83,7 @@ class RawTransactionsTest(BitcoinTestFramework):
         self.createrawtransaction_tests()
         self.sendrawtransaction_tests()
         self.sendrawtransaction_testmempoolaccept_tests()
+        self.sendrawtransactions_tests()
         self.decoderawtransaction_tests()
         self.transaction_version_number_tests()
         if self.requires_wallet and not self.options.descriptors:
@@ -305,6 +306,32 @@ class RawTransactionsTest(BitcoinTestFramework):
             assert_equal(testres['reject-reason'], 'txn-already-known')
             assert_raises_rpc_error(-27, 'Transaction already in block chain', node.sendrawtransaction, tx['hex'])
 
+    def sendrawtransactions_tests(self):
+        self.log.info("Test sendrawtransactions")
+        parent = self.wallet.create_self_transfer()
+        child = self.wallet.create_self_transfer(utxo_to_spend=parent["new_utxo"])
+        address = getnewdestination()[2]
+        missing_inputs = self.nodes[2].createrawtransaction([{'txid': TXID, 'vout': 1}], {address: 4.998})
+        # Later transactions may spend earlier ones, and a failure does not stop the others
+        results = self.nodes[2].sendrawtransactions([parent["hex"], missing_inputs, child["hex"]])
+        assert_equal([result["txid"] for result in results], [parent["txid"], self.nodes[2].decoderawtransaction(missing_inputs)["txid"], child["txid"]])
+        assert "error" not in results[0]
+        assert "bad-txns-inputs-missingorspent" in results[1]["error"]
+        assert "error" not in results[2]
+        for tx in [parent, child]:
+            self.wallet.scan_tx(self.nodes[2].decoderawtransaction(tx["hex"]))
+            assert tx["txid"] in self.nodes[2].getrawmempool()
+
+        # Transactions already in the mempool are announced again
+        assert "error" not in self.nodes[2].sendrawtransactions([child["hex"]])[0]
+
+        tx = self.wallet.create_self_transfer(fee_rate=Decimal("0.20000000"))
+        assert_equal(self.nodes[2].sendrawtransactions([tx["hex"]])[0]["error"], "Fee exceeds maximum configured by user (e.g. -maxtxfee, maxfeerate)")
+        assert "error" not in self.nodes[2].sendrawtransactions(rawtxs=[tx["hex"]], maxfeerate="0.20000000")[0]
+        self.wallet.scan_tx(self.nodes[2].decoderawtransaction(tx["hex"]))
+
+        assert_raises_rpc_error(-8, "Array must contain between 1 and 1000 transactions.", self.nodes[2].sendrawtransactions, [])
+
     def decoderawtransaction_tests(self):
         self.log.info("Test decoderawtransaction")
         # witness transaction
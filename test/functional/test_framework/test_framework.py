@@ -193,6 +193,8 @@ class BitcoinTestFramework(metaclass=BitcoinTestMetaClass):
         parser.add_argument("--randomseed", type=int,
                             help="set a random seed for deterministically reproducing a previous test run")
         parser.add_argument('--timeout-factor', dest="timeout_factor", type=float, default=1.0, help='adjust test timeouts by a factor. Setting it to 0 disables all timeouts')
+        parser.add_argument("--neoscrypt", dest="neoscrypt", default=False, action="store_true",
+                            help="mine and validate regtest blocks with NeoScrypt proof of work, instead of the SHA256d proof of work of -fastpow")
 
         group = parser.add_mutually_exclusive_group()
         group.add_argument("--descriptors", action='store_const', const=True,
@@ -231,6 +233,9 @@ class BitcoinTestFramework(metaclass=BitcoinTestMetaClass):
         check_json_precision()
 
         self.options.cachedir = os.path.abspath(self.options.cachedir)
+        if self.options.neoscrypt:
+            # The blocks of the cache are only valid with the proof of work they were mined with
+            self.options.cachedir = os.path.join(self.options.cachedir, "neoscrypt")
 
         config = self.config
 
@@ -515,6 +520,7 @@ class BitcoinTestFramework(metaclass=BitcoinTestMetaClass):
                 start_perf=self.options.perf,
                 use_valgrind=self.options.valgrind,
                 descriptors=self.options.descriptors,
+                fast_pow=not self.options.neoscrypt,
             )
             self.nodes.append(test_node_i)
             if not test_node_i.version_is_at_least(170000):
@@ -776,6 +782,7 @@ class BitcoinTestFramework(metaclass=BitcoinTestMetaClass):
                     coverage_dir=None,
                     cwd=self.options.tmpdir,
                     descriptors=self.options.descriptors,
+                    fast_pow=not self.options.neoscrypt,
                 ))
             self.start_node(CACHE_NODE_ID)
             cache_node = self.nodes[CACHE_NODE_ID]
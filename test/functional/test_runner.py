@@ -132,6 +132,7 @@ BASE_SCRIPTS = [
     'p2p_feefilter.py',
     'rpc_packages.py',
     'feature_reindex.py',
+    'feature_blockindex_snapshot.py',
     'feature_abortnode.py',
     # vv Tests less than 30s vv
     'wallet_keypool_topup.py --legacy-wallet',
@@ -153,6 +154,7 @@ BASE_SCRIPTS = [
     'rpc_getchaintips.py',
     'rpc_misc.py',
     'interface_rest.py',
+    'interface_metrics.py',
     'mempool_spend_coinbase.py',
     'wallet_avoidreuse.py --legacy-wallet',
     'wallet_avoidreuse.py --descriptors',
@@ -175,6 +177,7 @@ BASE_SCRIPTS = [
     'interface_rpc.py',
     'interface_usdt_coinselection.py',
     'interface_usdt_net.py',
+    'interface_usdt_pow.py',
     'interface_usdt_utxocache.py',
     'interface_usdt_validation.py',
     'rpc_psbt.py --legacy-wallet',
@@ -207,6 +210,9 @@ BASE_SCRIPTS = [
     'wallet_keypool.py --legacy-wallet',
     'wallet_keypool.py --descriptors',
     'wallet_descriptor.py --descriptors',
+    'wallet_fast_rescan.py --descriptors',
+    'wallet_deferred_rescan.py --legacy-wallet',
+    'wallet_deferred_rescan.py --descriptors',
     'wallet_miniscript.py',
     'feature_maxtipage.py',
     'p2p_nobloomfilter_messages.py',
@@ -277,6 +283,7 @@ BASE_SCRIPTS = [
     'feature_dersig.py',
     'feature_cltv.py',
     'rpc_uptime.py',
+    'rpc_getstartupinfo.py',
     'wallet_resendwallettransactions.py --legacy-wallet',
     'wallet_resendwallettransactions.py --descriptors',
     'wallet_fallbackfee.py --legacy-wallet',
@@ -301,6 +308,7 @@ BASE_SCRIPTS = [
     'wallet_coinbase_category.py --descriptors',
     'feature_filelock.py',
     'feature_loadblock.py',
+    'feature_loadheaders.py',
     'p2p_dos_header_tree.py',
     'p2p_add_connections.py',
     'feature_bind_port_discover.py',
@@ -317,6 +325,7 @@ BASE_SCRIPTS = [
     'rpc_deriveaddresses.py --usecli',
     'p2p_ping.py',
     'p2p_tx_privacy.py',
+    'p2p_tx_package.py',
     'rpc_scantxoutset.py',
     'feature_txindex_compatibility.py',
     'feature_unsupported_utxo_db.py',
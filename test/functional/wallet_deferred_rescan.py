@@ -0,0 +1,74 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that imports with defer_rescan return before rescanning, and that
+   the rescans they defer are merged into one pass."""
+from test_framework.descriptors import descsum_create
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal
+
+
+class WalletDeferredRescanTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+
+    def run_test(self):
+        node = self.nodes[0]
+        funding_wallet = node.get_wallet_rpc(self.default_wallet_name)
+        self.generate(node, 101)
+
+        addresses = [funding_wallet.getnewaddress() for _ in range(3)]
+        for address in addresses:
+            funding_wallet.sendtoaddress(address, 1)
+            self.generate(node, 1)
+
+        info = funding_wallet.getdeferredrescaninfo()
+        assert_equal(info, {'pending_requests': 0, 'scanning': False})
+
+        if self.options.descriptors:
+            self.log.info("Defer the rescans of importdescriptors calls")
+            node.createwallet(wallet_name='deferred', disable_private_keys=True)
+            w = node.get_wallet_rpc('deferred')
+            for address in addresses:
+                result = w.importdescriptors([{'desc': descsum_create(f'addr({address})'), 'timestamp': 0}], {'defer_rescan': True})
+                assert_equal(result, [{'success': True, 'rescan': 'deferred'}])
+        else:
+            self.log.info("Defer the rescans of importmulti calls")
+            node.createwallet(wallet_name='deferred', disable_private_keys=True, descriptors=False)
+            w = node.get_wallet_rpc('deferred')
+            for address in addresses:
+                result = w.importmulti([{'scriptPubKey': {'address': address}, 'timestamp': 0, 'watchonly': True}], {'defer_rescan': True})
+                assert_equal(result, [{'success': True, 'rescan': 'deferred'}])
+
+        info = w.getdeferredrescaninfo()
+        assert_equal(info['pending_requests'], len(addresses))
+        assert_equal(info['pending_timestamp'], 1)
+
+        self.log.info("Check that one pass rescans for all imports")
+        self.wait_until(lambda: 'last' in w.getdeferredrescaninfo())
+        info = w.getdeferredrescaninfo()
+        assert_equal(info['pending_requests'], 0)
+        assert 'pending_timestamp' not in info
+        assert_equal(info['last'], {'requests': len(addresses), 'timestamp': 1, 'complete': True, 'aborted': False})
+        assert_equal(w.getbalance(), len(addresses))
+        assert_equal(len(w.listtransactions('*', 10, 0, True)), len(addresses))
+
+        self.log.info("Check that imports without defer_rescan still rescan before returning")
+        address = funding_wallet.getnewaddress()
+        funding_wallet.sendtoaddress(address, 1)
+        self.generate(node, 1)
+        if self.options.descriptors:
+            result = w.importdescriptors([{'desc': descsum_create(f'addr({address})'), 'timestamp': 0}])
+        else:
+            result = w.importmulti([{'scriptPubKey': {'address': address}, 'timestamp': 0, 'watchonly': True}])
+        assert_equal(result, [{'success': True}])
+        assert_equal(len(w.listtransactions('*', 10, 0, True)), len(addresses) + 1)
+        assert_equal(w.getdeferredrescaninfo()['last']['requests'], len(addresses))
+
+
+if __name__ == '__main__':
+    WalletDeferredRescanTest().main()
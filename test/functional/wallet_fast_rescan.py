@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Bitcoin Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test that fast rescan using block filters for descriptor wallets detects
+   top-ups correctly and finds the same transactions as the slow variant."""
+from test_framework.test_framework import BitcoinTestFramework, SkipTest
+from test_framework.util import assert_equal
+
+
+KEYPOOL_SIZE = 10
+
+
+class WalletFastRescanTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+        self.extra_args = [[f'-keypool={KEYPOOL_SIZE}', '-blockfilterindex=1']]
+
+    def skip_test_if_missing_module(self):
+        self.skip_if_no_wallet()
+        self.skip_if_no_sqlite()
+        if not self.options.descriptors:
+            raise SkipTest("fast rescan is only available for descriptor wallets")
+
+    def get_wallet_txids(self, node, wallet_name):
+        w = node.get_wallet_rpc(wallet_name)
+        txs = w.listtransactions('*', 1000000)
+        return [tx['txid'] for tx in txs]
+
+    def run_test(self):
+        node = self.nodes[0]
+        funding_wallet = node.get_wallet_rpc(self.default_wallet_name)
+
+        self.log.info("Create descriptor wallet and back up its descriptors")
+        node.createwallet(wallet_name='topup_test', descriptors=True)
+        w = node.get_wallet_rpc('topup_test')
+        descriptors = w.listdescriptors()['descriptors']
+        assert_equal(len(descriptors), 8)
+        for desc in descriptors:
+            desc['timestamp'] = 0
+
+        self.log.info("Send coins to addresses beyond the initial keypool, so rescans have to top it up")
+        for _ in range(3 * KEYPOOL_SIZE):
+            funding_wallet.sendtoaddress(w.getnewaddress(), 0.1)
+            self.generate(node, 1)
+        self.log.info("Spend from the wallet in a later block")
+        w.sendtoaddress(funding_wallet.getnewaddress(), 0.5)
+        self.generate(node, 1)
+        txids = self.get_wallet_txids(node, 'topup_test')
+
+        self.log.info("Import the descriptors into a new wallet with the fast rescan")
+        node.createwallet(wallet_name='rescan_fast', disable_private_keys=True, descriptors=True)
+        w_fast = node.get_wallet_rpc('rescan_fast')
+        with node.assert_debug_log(['fast variant using block filters']):
+            w_fast.importdescriptors([{k: desc[k] for k in ('desc', 'timestamp', 'active', 'internal', 'range') if k in desc} for desc in descriptors])
+        assert_equal(sorted(self.get_wallet_txids(node, 'rescan_fast')), sorted(txids))
+
+        self.log.info("Rescan the wallet again and find the same transactions")
+        with node.assert_debug_log(['fast variant using block filters']):
+            w_fast.rescanblockchain()
+        assert_equal(sorted(self.get_wallet_txids(node, 'rescan_fast')), sorted(txids))
+
+        self.log.info("Without the filter index, the slow variant finds the same transactions")
+        self.restart_node(0, [f'-keypool={KEYPOOL_SIZE}', '-blockfilterindex=0'])
+        node.loadwallet('rescan_fast')
+        w_slow = node.get_wallet_rpc('rescan_fast')
+        with node.assert_debug_log(['slow variant inspecting all blocks']):
+            w_slow.rescanblockchain()
+        assert_equal(sorted(self.get_wallet_txids(node, 'rescan_fast')), sorted(txids))
+
+
+if __name__ == '__main__':
+    WalletFastRescanTest().main()
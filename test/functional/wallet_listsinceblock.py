@@ -45,6 +45,7 @@ class ListSinceBlockTest(BitcoinTestFramework):
         if self.options.descriptors:
             self.test_desc()
         self.test_send_to_self()
+        self.test_cursor()
         self.test_op_return()
 
     def test_no_blockhash(self):
@@ -449,6 +450,31 @@ class ListSinceBlockTest(BitcoinTestFramework):
         assert any(c["address"] == addr for c in coins)
         assert all(self.nodes[2].getaddressinfo(c["address"])["ischange"] for c in coins)
 
+    def test_cursor(self):
+        self.log.info("Test paging through listsinceblock with a cursor")
+        node = self.nodes[2]
+        block_hash = node.getblockhash(50)
+        for blockhash in [None, block_hash]:
+            full = node.listsinceblock(blockhash=blockhash)
+            for count in [1, 7, len(full["transactions"]), len(full["transactions"]) + 1]:
+                txs = []
+                page = node.listsinceblock(blockhash=blockhash, count=count)
+                assert_equal(page["lastblock"], full["lastblock"])
+                while True:
+                    assert len(page["transactions"]) <= count
+                    txs += page["transactions"]
+                    if "next_cursor" not in page:
+                        break
+                    page = node.listsinceblock(blockhash=blockhash, count=count, cursor=page["next_cursor"])
+                    assert "removed" not in page
+                assert_equal(sorted(txs, key=lambda tx: (tx["txid"], tx["category"], tx["vout"])),
+                             sorted(full["transactions"], key=lambda tx: (tx["txid"], tx["category"], tx["vout"])))
+                assert_equal(len(txs), len(full["transactions"]))
+
+        assert_raises_rpc_error(-8, "Invalid cursor", node.listsinceblock, cursor="1:2")
+        assert_raises_rpc_error(-8, "Invalid cursor", node.listsinceblock, cursor="1:00:0")
+        assert_raises_rpc_error(-8, "Negative count", node.listsinceblock, count=-1)
+
     def test_op_return(self):
         """Test if OP_RETURN outputs will be displayed correctly."""
         block_hash = self.nodes[2].getbestblockhash()
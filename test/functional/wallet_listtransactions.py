@@ -109,6 +109,7 @@ class ListTransactionsTest(BitcoinTestFramework):
         self.run_rbf_opt_in_test()
         self.run_externally_generated_address_test()
         self.run_invalid_parameters_test()
+        self.test_cursor()
         self.test_op_return()
 
     def run_rbf_opt_in_test(self):
@@ -284,6 +285,31 @@ class ListTransactionsTest(BitcoinTestFramework):
         self.nodes[0].listtransactions(label="*")
         assert_raises_rpc_error(-8, "Negative count", self.nodes[0].listtransactions, count=-1)
         assert_raises_rpc_error(-8, "Negative from", self.nodes[0].listtransactions, skip=-1)
+        assert_raises_rpc_error(-8, "skip cannot be combined with cursor", self.nodes[0].listtransactions, skip=1, cursor="")
+        for cursor in ["1", "a:0", "1:-1", "1:2:3"]:
+            assert_raises_rpc_error(-8, "Invalid cursor", self.nodes[0].listtransactions, cursor=cursor)
+
+    def test_cursor(self):
+        self.log.info("Test paging through listtransactions with a cursor")
+        node = self.nodes[0]
+        all_txs = node.listtransactions(count=1000)
+        # Pages go from newer to older, and each page is ordered from older to newer like without cursor
+        for count in [1, 2, 5, len(all_txs), len(all_txs) + 1]:
+            pages = []
+            page = node.listtransactions(count=count, cursor="")
+            while True:
+                assert len(page["transactions"]) <= count
+                pages.insert(0, page["transactions"])
+                if "next_cursor" not in page:
+                    break
+                page = node.listtransactions(count=count, cursor=page["next_cursor"])
+            assert_equal([tx for txs in pages for tx in txs], all_txs)
+
+        # New transactions do not shift the pages after the first one
+        first_page = node.listtransactions(count=3, cursor="")
+        second_page = node.listtransactions(count=3, cursor=first_page["next_cursor"])
+        node.sendtoaddress(node.getnewaddress(), 0.1)
+        assert_equal(node.listtransactions(count=3, cursor=first_page["next_cursor"]), second_page)
 
     def test_op_return(self):
         """Test if OP_RETURN outputs will be displayed correctly."""